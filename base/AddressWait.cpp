@@ -0,0 +1,96 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/synchronization/AddressWait.h"
+
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#else
+#include "aemu/base/system/System.h"
+#endif
+
+#ifdef __APPLE__
+// Not in the public SDK, but stable and used by libc++ for atomic waits.
+extern "C" int __ulock_wait(uint32_t operation, void* addr, uint64_t value,
+                            uint32_t timeout_us);
+extern "C" int __ulock_wake(uint32_t operation, void* addr, uint64_t wake_value);
+#define UL_COMPARE_AND_WAIT 1
+#define ULF_WAKE_ALL 0x00000100
+#endif
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "waitOnAddress() needs a plain 32-bit word");
+
+namespace android {
+namespace base {
+
+void waitOnAddress(std::atomic<uint32_t>* addr, uint32_t expected,
+                   uint64_t timeoutUs) {
+#if defined(__linux__)
+    struct timespec ts;
+    struct timespec* tsp = nullptr;
+    if (timeoutUs != kAddressWaitForever) {
+        ts.tv_sec = timeoutUs / 1000000;
+        ts.tv_nsec = (timeoutUs % 1000000) * 1000;
+        tsp = &ts;
+    }
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, tsp, nullptr, 0);
+#elif defined(_WIN32)
+    DWORD timeoutMs = INFINITE;
+    if (timeoutUs != kAddressWaitForever) {
+        timeoutMs = (DWORD)std::min<uint64_t>((timeoutUs + 999) / 1000, INFINITE - 1);
+    }
+    WaitOnAddress(addr, &expected, sizeof(expected), timeoutMs);
+#elif defined(__APPLE__)
+    // A zero timeout means forever for __ulock_wait().
+    uint32_t us = 0;
+    if (timeoutUs != kAddressWaitForever) {
+        us = (uint32_t)std::max<uint64_t>(1, std::min<uint64_t>(timeoutUs, UINT32_MAX));
+    }
+    __ulock_wait(UL_COMPARE_AND_WAIT, addr, expected, us);
+#else
+    // No native address wait; poll with a short sleep instead.
+    if (addr->load(std::memory_order_acquire) == expected) {
+        sleepUs(std::min<uint64_t>(timeoutUs, 1000));
+    }
+#endif
+}
+
+void wakeAddress(std::atomic<uint32_t>* addr, bool all) {
+#if defined(__linux__)
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, all ? INT32_MAX : 1, nullptr,
+            nullptr, 0);
+#elif defined(_WIN32)
+    if (all) {
+        WakeByAddressAll(addr);
+    } else {
+        WakeByAddressSingle(addr);
+    }
+#elif defined(__APPLE__)
+    __ulock_wake(UL_COMPARE_AND_WAIT | (all ? ULF_WAKE_ALL : 0), addr, 0);
+#else
+    (void)addr;
+    (void)all;
+#endif
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,537 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/files/AsyncWriteStream.h"
+
+#include "aemu/base/EintrWrapper.h"
+#include "aemu/base/files/preadwrite.h"
+#include "aemu/base/synchronization/MessageChannel.h"
+#include "aemu/base/threads/FunctorThread.h"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace android {
+namespace base {
+
+class AsyncWriteStream::Writer {
+public:
+    virtual ~Writer() = default;
+
+    virtual const char* name() const = 0;
+
+    // Queues |size| bytes at |data|, which belong to buffer |index|, to be
+    // written at |offset|.
+    virtual void submit(int index,
+                        const uint8_t* data,
+                        size_t size,
+                        uint64_t offset) = 0;
+
+    // Blocks until a submitted buffer is done and returns its index, with 0
+    // or a -errno value in |*result|.
+    virtual int wait(int* result) = 0;
+};
+
+// Portable fallback: one thread doing blocking pwrite() calls in order.
+class AsyncWriteStream::ThreadWriter : public Writer {
+public:
+    explicit ThreadWriter(int fd)
+        : mFd(fd), mThread([this] { threadLoop(); }) {
+        mThread.start();
+    }
+
+    ~ThreadWriter() override {
+        mJobs.send(Job());
+        mThread.wait();
+    }
+
+    const char* name() const override { return "thread"; }
+
+    void submit(int index,
+                const uint8_t* data,
+                size_t size,
+                uint64_t offset) override {
+        mJobs.send(Job{index, data, size, offset});
+    }
+
+    int wait(int* result) override {
+        Done done;
+        mDone.receive(&done);
+        *result = done.result;
+        return done.index;
+    }
+
+private:
+    struct Job {
+        int index = -1;
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        uint64_t offset = 0;
+    };
+
+    struct Done {
+        int index;
+        int result;
+    };
+
+    void threadLoop() {
+        Job job;
+        while (mJobs.receive(&job) && job.index >= 0) {
+            int result = 0;
+            while (job.size) {
+                const auto written = HANDLE_EINTR(base::pwrite(
+                        mFd, job.data, job.size, job.offset));
+                if (written <= 0) {
+                    result = written < 0 ? -errno : -EIO;
+                    break;
+                }
+                job.data += written;
+                job.size -= written;
+                job.offset += written;
+            }
+            mDone.send(Done{job.index, result});
+        }
+    }
+
+    const int mFd;
+    MessageChannel<Job, kMaxBuffers + 1> mJobs;
+    MessageChannel<Done, kMaxBuffers> mDone;
+    FunctorThread mThread;
+};
+
+#ifdef __linux__
+
+// A minimal io_uring driven through the raw system calls: one submission
+// per buffer, writing from the registered staging buffers when the kernel
+// lets us pin them.
+class AsyncWriteStream::UringWriter : public Writer {
+public:
+    static std::unique_ptr<Writer> create(int fd,
+                                          std::vector<Buffer>& buffers) {
+        std::unique_ptr<UringWriter> writer(new UringWriter(fd));
+        if (!writer->init(buffers)) {
+            return nullptr;
+        }
+        return writer;
+    }
+
+    ~UringWriter() override {
+        if (mSqes) {
+            ::munmap(mSqes, mSqesSize);
+        }
+        if (mCqRing && mCqRing != mSqRing) {
+            ::munmap(mCqRing, mCqRingSize);
+        }
+        if (mSqRing) {
+            ::munmap(mSqRing, mSqRingSize);
+        }
+        if (mRingFd >= 0) {
+            ::close(mRingFd);
+        }
+    }
+
+    const char* name() const override { return "io_uring"; }
+
+    void submit(int index,
+                const uint8_t* data,
+                size_t size,
+                uint64_t offset) override {
+        mPending[index] = Pending{data, size, offset};
+        push(index);
+    }
+
+    int wait(int* result) override {
+        for (;;) {
+            if (!mFailed.empty()) {
+                const int index = mFailed.back();
+                mFailed.pop_back();
+                *result = mPending[index].result;
+                return index;
+            }
+            const unsigned head = *mCqHead;
+            if (head == __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE)) {
+                if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+                    errno != EINTR) {
+                    // Nothing can complete any more; fail whatever is
+                    // outstanding rather than hanging.
+                    return failOutstanding(result);
+                }
+                continue;
+            }
+            const io_uring_cqe& cqe = mCqes[head & *mCqMask];
+            const int index = static_cast<int>(cqe.user_data);
+            const int res = cqe.res;
+            __atomic_store_n(mCqHead, head + 1, __ATOMIC_RELEASE);
+
+            Pending& pending = mPending[index];
+            pending.inFlight = false;
+            if (res <= 0) {
+                *result = res < 0 ? res : -EIO;
+                return index;
+            }
+            if (static_cast<size_t>(res) < pending.size) {
+                pending.data += res;
+                pending.size -= res;
+                pending.offset += res;
+                push(index);
+                continue;
+            }
+            *result = 0;
+            return index;
+        }
+    }
+
+private:
+    struct Pending {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        uint64_t offset = 0;
+        int result = 0;
+        bool inFlight = false;
+    };
+
+    explicit UringWriter(int fd) : mFd(fd) {}
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, mRingFd,
+                                          toSubmit, minComplete, flags,
+                                          nullptr, 0));
+    }
+
+    bool init(std::vector<Buffer>& buffers) {
+        unsigned entries = 1;
+        while (entries < buffers.size()) {
+            entries <<= 1;
+        }
+        io_uring_params params = {};
+        mRingFd = static_cast<int>(
+                ::syscall(__NR_io_uring_setup, entries, &params));
+        if (mRingFd < 0) {
+            return false;
+        }
+
+        mSqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        mCqRingSize =
+                params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap) {
+            mSqRingSize = mCqRingSize = std::max(mSqRingSize, mCqRingSize);
+        }
+        mSqRing = map(mSqRingSize, IORING_OFF_SQ_RING);
+        if (!mSqRing) {
+            return false;
+        }
+        mCqRing = singleMmap ? mSqRing : map(mCqRingSize, IORING_OFF_CQ_RING);
+        mSqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        mSqes = static_cast<io_uring_sqe*>(map(mSqesSize, IORING_OFF_SQES));
+        if (!mCqRing || !mSqes) {
+            return false;
+        }
+
+        auto sq = static_cast<uint8_t*>(mSqRing);
+        mSqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        mSqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        mSqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        auto cq = static_cast<uint8_t*>(mCqRing);
+        mCqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        mCqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        mCqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        mCqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        // Registration pins the buffers and counts against RLIMIT_MEMLOCK;
+        // plain writes work without it.
+        std::vector<iovec> iovs;
+        for (Buffer& buffer : buffers) {
+            iovs.push_back(iovec{buffer.data(), buffer.size()});
+        }
+        mFixed = ::syscall(__NR_io_uring_register, mRingFd,
+                           IORING_REGISTER_BUFFERS, iovs.data(),
+                           static_cast<unsigned>(iovs.size())) == 0;
+        mPending.resize(buffers.size());
+        return true;
+    }
+
+    void* map(size_t size, off_t offset) {
+        void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, mRingFd, offset);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+
+    void push(int index) {
+        Pending& pending = mPending[index];
+        const unsigned tail = *mSqTail;
+        const unsigned slot = tail & *mSqMask;
+        io_uring_sqe& sqe = mSqes[slot];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = mFixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe.fd = mFd;
+        sqe.addr = reinterpret_cast<uint64_t>(pending.data);
+        sqe.len = static_cast<uint32_t>(pending.size);
+        sqe.off = pending.offset;
+        sqe.buf_index = mFixed ? static_cast<uint16_t>(index) : 0;
+        sqe.user_data = static_cast<uint64_t>(index);
+        mSqArray[slot] = slot;
+        __atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+
+        int submitted;
+        do {
+            submitted = enter(1, 0, 0);
+        } while (submitted < 0 && (errno == EINTR || errno == EAGAIN));
+        if (submitted < 0) {
+            // Take the entry back so the ring stays consistent.
+            __atomic_store_n(mSqTail, tail, __ATOMIC_RELEASE);
+            pending.result = -errno;
+            mFailed.push_back(index);
+            return;
+        }
+        pending.inFlight = true;
+    }
+
+    int failOutstanding(int* result) {
+        for (size_t i = 0; i < mPending.size(); ++i) {
+            if (mPending[i].inFlight) {
+                mPending[i].inFlight = false;
+                *result = -EIO;
+                return static_cast<int>(i);
+            }
+        }
+        *result = -EIO;
+        return 0;
+    }
+
+    const int mFd;
+    int mRingFd = -1;
+    bool mFixed = false;
+    void* mSqRing = nullptr;
+    void* mCqRing = nullptr;
+    size_t mSqRingSize = 0;
+    size_t mCqRingSize = 0;
+    io_uring_sqe* mSqes = nullptr;
+    size_t mSqesSize = 0;
+    unsigned* mSqTail = nullptr;
+    unsigned* mSqMask = nullptr;
+    unsigned* mSqArray = nullptr;
+    unsigned* mCqHead = nullptr;
+    unsigned* mCqTail = nullptr;
+    unsigned* mCqMask = nullptr;
+    io_uring_cqe* mCqes = nullptr;
+    std::vector<Pending> mPending;
+    std::vector<int> mFailed;
+};
+
+#endif  // __linux__
+
+// static
+std::unique_ptr<AsyncWriteStream> AsyncWriteStream::create(
+        const std::string& path,
+        const AsyncWriteOptions& options) {
+#ifdef _WIN32
+    const int fd = ::_open(path.c_str(),
+                           _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+                           _S_IREAD | _S_IWRITE);
+    const bool direct = false;
+#else
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    int fd = -1;
+    bool direct = false;
+#ifdef O_DIRECT
+    if (options.direct) {
+        // Not every file system supports it (tmpfs doesn't).
+        fd = HANDLE_EINTR(::open(path.c_str(), flags | O_DIRECT, 0644));
+        direct = fd >= 0;
+    }
+#endif
+    if (fd < 0) {
+        fd = HANDLE_EINTR(::open(path.c_str(), flags, 0644));
+    }
+#ifdef __APPLE__
+    if (fd >= 0 && options.direct) {
+        // F_NOCACHE has no alignment rules, so buffers need no padding.
+        ::fcntl(fd, F_NOCACHE, 1);
+    }
+#endif
+#endif
+    if (fd < 0) {
+        return nullptr;
+    }
+    return std::unique_ptr<AsyncWriteStream>(
+            new AsyncWriteStream(fd, direct, options));
+}
+
+AsyncWriteStream::AsyncWriteStream(int fd,
+                                   bool direct,
+                                   const AsyncWriteOptions& options)
+    : mFd(fd),
+      mDirect(direct),
+      mBufferSize(std::max(kAlignment, (options.bufferSize + kAlignment - 1) &
+                                               ~(kAlignment - 1))) {
+    const int count = std::min(std::max(options.bufferCount, 1), kMaxBuffers);
+    for (int i = 0; i < count; ++i) {
+        mBuffers.emplace_back(mBufferSize);
+        mFree.push_back(count - 1 - i);
+    }
+#ifdef __linux__
+    if (!options.forceThreadWriter) {
+        mWriter = UringWriter::create(mFd, mBuffers);
+    }
+#endif
+    if (!mWriter) {
+        mWriter.reset(new ThreadWriter(mFd));
+    }
+}
+
+AsyncWriteStream::~AsyncWriteStream() {
+    close();
+}
+
+const char* AsyncWriteStream::backendName() const {
+    return mWriter->name();
+}
+
+ssize_t AsyncWriteStream::read(void*, size_t) {
+    return -EINVAL;
+}
+
+ssize_t AsyncWriteStream::write(const void* buffer, size_t size) {
+    if (mFd < 0) {
+        return -EBADF;
+    }
+    auto src = static_cast<const uint8_t*>(buffer);
+    size_t left = size;
+    while (left) {
+        if (mError || (mCurrent < 0 && !acquireBuffer())) {
+            return mError;
+        }
+        const size_t chunk = std::min(left, mBufferSize - mFill);
+        memcpy(mBuffers[mCurrent].data() + mFill, src, chunk);
+        mFill += chunk;
+        src += chunk;
+        left -= chunk;
+        if (mFill == mBufferSize) {
+            submitCurrent();
+            mOffset += mBufferSize;
+            mCurrent = -1;
+            mFill = 0;
+        }
+    }
+    mSize += size;
+    return static_cast<ssize_t>(size);
+}
+
+int AsyncWriteStream::flush() {
+    if (mFd < 0) {
+        return -EBADF;
+    }
+    if (mFill && !mError) {
+        const int index = mCurrent;
+        submitCurrent();
+        reapAll();
+        if (mDirect) {
+            // The tail went out padded to a whole block. Keep it staged at
+            // the same offset so the next write carries on from it, and cut
+            // the padding off the file.
+            mFree.erase(std::find(mFree.begin(), mFree.end(), index));
+            mCurrent = index;
+#ifndef _WIN32
+            if (HANDLE_EINTR(::ftruncate(mFd, static_cast<off_t>(mSize))) &&
+                !mError) {
+                mError = -errno;
+            }
+#endif
+        } else {
+            mOffset += mFill;
+            mCurrent = -1;
+            mFill = 0;
+        }
+    }
+    reapAll();
+    return mError;
+}
+
+int AsyncWriteStream::close() {
+    if (mFd < 0) {
+        return mError;
+    }
+    flush();
+    reapAll();
+    mWriter.reset();
+#ifdef _WIN32
+    ::_close(mFd);
+#else
+    ::close(mFd);
+#endif
+    mFd = -1;
+    return mError;
+}
+
+bool AsyncWriteStream::acquireBuffer() {
+    if (mFree.empty()) {
+        reap();
+    }
+    if (mError) {
+        return false;
+    }
+    mCurrent = mFree.back();
+    mFree.pop_back();
+    return true;
+}
+
+void AsyncWriteStream::submitCurrent() {
+    uint8_t* data = mBuffers[mCurrent].data();
+    size_t size = mFill;
+    if (mDirect && size % kAlignment) {
+        const size_t padded = (size + kAlignment - 1) & ~(kAlignment - 1);
+        memset(data + size, 0, padded - size);
+        size = padded;
+    }
+    mWriter->submit(mCurrent, data, size, mOffset);
+    ++mInFlight;
+}
+
+void AsyncWriteStream::reap() {
+    int result;
+    const int index = mWriter->wait(&result);
+    --mInFlight;
+    mFree.push_back(index);
+    if (result && !mError) {
+        mError = result;
+    }
+}
+
+void AsyncWriteStream::reapAll() {
+    while (mInFlight) {
+        reap();
+    }
+}
+
+}  // namespace base
+}  // namespace android
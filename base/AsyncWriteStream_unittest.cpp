@@ -0,0 +1,120 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/files/AsyncWriteStream.h"
+
+#include <gtest/gtest.h>
+
+#include <errno.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+std::vector<uint8_t> readFile(const std::string& path) {
+    std::vector<uint8_t> contents;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return contents;
+    }
+    uint8_t chunk[4096];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        contents.insert(contents.end(), chunk, chunk + count);
+    }
+    fclose(file);
+    return contents;
+}
+
+struct Config {
+    bool thread;
+    bool direct;
+};
+
+class AsyncWriteStreamTest : public ::testing::TestWithParam<Config> {
+protected:
+    std::string path() const {
+        return ::testing::TempDir() + "async_write_stream_" +
+               std::to_string(GetParam().thread) +
+               std::to_string(GetParam().direct);
+    }
+
+    std::unique_ptr<AsyncWriteStream> create() const {
+        AsyncWriteOptions options;
+        options.bufferSize = 3 * AsyncWriteStream::kAlignment;
+        options.bufferCount = 3;
+        options.direct = GetParam().direct;
+        options.forceThreadWriter = GetParam().thread;
+        return AsyncWriteStream::create(path(), options);
+    }
+};
+
+// Tests that odd sized writes, spanning and filling buffers, land in order,
+// including across flushes of a partial buffer.
+TEST_P(AsyncWriteStreamTest, WritesInOrder) {
+    std::unique_ptr<AsyncWriteStream> stream = create();
+    ASSERT_TRUE(stream);
+    if (GetParam().thread) {
+        EXPECT_STREQ("thread", stream->backendName());
+    }
+
+    std::vector<uint8_t> expected;
+    uint32_t seed = 1;
+    const size_t sizes[] = {1, 7, 4096, 12288, 5000, 100000, 3, 12287, 40000};
+    int round = 0;
+    for (size_t size : sizes) {
+        std::vector<uint8_t> data(size);
+        for (uint8_t& byte : data) {
+            seed = seed * 1103515245 + 12345;
+            byte = static_cast<uint8_t>(seed >> 16);
+        }
+        ASSERT_EQ(static_cast<ssize_t>(size),
+                  stream->write(data.data(), data.size()));
+        expected.insert(expected.end(), data.begin(), data.end());
+        if (++round % 3 == 0) {
+            ASSERT_EQ(0, stream->flush());
+            EXPECT_EQ(expected, readFile(path()));
+        }
+    }
+    stream->putBe32(0xdeadbeef);
+    for (uint8_t byte : {0xde, 0xad, 0xbe, 0xef}) {
+        expected.push_back(byte);
+    }
+    EXPECT_EQ(expected.size(), stream->size());
+    EXPECT_EQ(0, stream->close());
+    EXPECT_EQ(-EBADF, stream->write("x", 1));
+    EXPECT_EQ(expected, readFile(path()));
+    remove(path().c_str());
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends,
+                         AsyncWriteStreamTest,
+                         ::testing::Values(Config{false, false},
+                                           Config{false, true},
+                                           Config{true, false},
+                                           Config{true, true}));
+
+TEST(AsyncWriteStream, OpenFailure) {
+    EXPECT_FALSE(AsyncWriteStream::create(::testing::TempDir() +
+                                          "no/such/dir/file"));
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
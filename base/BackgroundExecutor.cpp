@@ -0,0 +1,62 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/threads/BackgroundExecutor.h"
+
+#include "aemu/base/system/System.h"
+#include "aemu/base/threads/ThreadPool.h"
+
+#include <algorithm>
+
+namespace android {
+namespace base {
+
+namespace {
+
+// Enough to overlap a few jobs blocked on I/O without a thread per core.
+constexpr int kMaxWorkers = 4;
+
+}  // namespace
+
+// static
+BackgroundExecutor& BackgroundExecutor::get() {
+    static BackgroundExecutor* const sInstance = new BackgroundExecutor();
+    return *sInstance;
+}
+
+BackgroundExecutor::BackgroundExecutor() {
+    const int workers = std::clamp(getCpuCoreCount(), 2, kMaxWorkers);
+    mPool = std::make_unique<ThreadPool<Job>>(
+            workers, [](Job&& job) { job(); },
+            ThreadPoolScheduling::WorkStealing);
+    if (!mPool->start()) {
+        mPool.reset();
+    }
+}
+
+bool BackgroundExecutor::post(Job&& job) {
+    if (!mPool) {
+        return false;
+    }
+    mPool->enqueue(std::move(job));
+    return true;
+}
+
+int BackgroundExecutor::numWorkers() const {
+    return mPool ? mPool->numWorkers() : 0;
+}
+
+}  // namespace base
+}  // namespace android
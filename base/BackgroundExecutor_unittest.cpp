@@ -0,0 +1,116 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/threads/BackgroundExecutor.h"
+
+#include "aemu/base/async/EventLooper.h"
+#include "aemu/base/synchronization/Event.h"
+#include "aemu/base/threads/Async.h"
+#include "aemu/base/threads/ParallelTask.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+namespace android {
+namespace base {
+namespace {
+
+TEST(BackgroundExecutor, RunsJobs) {
+    BackgroundExecutor& executor = BackgroundExecutor::get();
+    EXPECT_GE(executor.numWorkers(), 1);
+    EXPECT_LE(executor.numWorkers(), 4);
+
+    constexpr int kJobs = 100;
+    std::atomic<int> done{0};
+    Event allDone;
+    for (int i = 0; i < kJobs; ++i) {
+        ASSERT_TRUE(executor.post([&done, &allDone] {
+            if (++done == kJobs) {
+                allDone.signal();
+            }
+        }));
+    }
+    allDone.wait();
+    EXPECT_EQ(kJobs, done.load());
+}
+
+TEST(BackgroundExecutor, Async) {
+    Event ran;
+    std::thread::id worker;
+    EXPECT_TRUE(async([&ran, &worker] {
+        worker = std::this_thread::get_id();
+        ran.signal();
+    }));
+    ran.wait();
+    EXPECT_NE(std::this_thread::get_id(), worker);
+}
+
+// Tests that the result is posted back to the looper, which keeps running
+// while the task is in flight.
+TEST(BackgroundExecutor, ParallelTaskCompletes) {
+    EventLooper looper;
+    int result = 0;
+    std::thread::id doneThread;
+    ParallelTask<int> task(
+            &looper, [](int* out) { *out = 42; },
+            [&](const int& value) {
+                result = value;
+                doneThread = std::this_thread::get_id();
+            });
+    EXPECT_TRUE(task.start());
+    EXPECT_FALSE(task.start());
+    EXPECT_TRUE(task.inFlight());
+
+    looper.runWithTimeoutMs(10000);
+    EXPECT_FALSE(task.inFlight());
+    EXPECT_EQ(42, result);
+    EXPECT_EQ(std::this_thread::get_id(), doneThread);
+}
+
+TEST(BackgroundExecutor, RunParallelTask) {
+    EventLooper looper;
+    int result = 0;
+    EXPECT_TRUE(runParallelTask<int>(
+            &looper, [](int* out) { *out = 7; },
+            [&result](const int& value) { result = value; }));
+    looper.runWithTimeoutMs(10000);
+    EXPECT_EQ(7, result);
+}
+
+// Tests that a task destroyed before its completion ran never calls back.
+TEST(BackgroundExecutor, ParallelTaskDestroyedFirst) {
+    EventLooper looper;
+    Event ran;
+    bool doneCalled = false;
+    {
+        ParallelTask<int> task(
+                &looper,
+                [&ran](int* out) {
+                    *out = 1;
+                    ran.signal();
+                },
+                [&doneCalled](const int&) { doneCalled = true; });
+        EXPECT_TRUE(task.start());
+        ran.wait();
+    }
+    looper.runWithTimeoutMs(100);
+    EXPECT_FALSE(doneCalled);
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
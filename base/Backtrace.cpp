@@ -0,0 +1,271 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/Backtrace.h"
+
+#include "aemu/base/StringFormat.h"
+#include "aemu/base/synchronization/Lock.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <unwind.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace android {
+namespace base {
+
+#ifdef _WIN32
+
+size_t captureBacktrace(void** frames, size_t maxFrames, size_t skip) {
+    return RtlCaptureStackBackTrace(static_cast<DWORD>(skip + 1),
+                                    static_cast<DWORD>(maxFrames), frames,
+                                    nullptr);
+}
+
+#else  // !_WIN32
+
+namespace {
+
+struct UnwindState {
+    void** frames;
+    size_t maxFrames;
+    size_t skip;
+    size_t count;
+};
+
+_Unwind_Reason_Code unwindFrame(_Unwind_Context* context, void* opaque) {
+    auto* state = static_cast<UnwindState*>(opaque);
+    const uintptr_t pc = _Unwind_GetIP(context);
+    if (!pc) {
+        return _URC_END_OF_STACK;
+    }
+    if (state->skip) {
+        --state->skip;
+        return _URC_NO_REASON;
+    }
+    state->frames[state->count++] = reinterpret_cast<void*>(pc);
+    return state->count == state->maxFrames ? _URC_END_OF_STACK
+                                            : _URC_NO_REASON;
+}
+
+}  // namespace
+
+size_t captureBacktrace(void** frames, size_t maxFrames, size_t skip) {
+    if (!maxFrames) {
+        return 0;
+    }
+    UnwindState state = {frames, maxFrames, skip + 1, 0};
+    _Unwind_Backtrace(unwindFrame, &state);
+    return state.count;
+}
+
+#endif  // !_WIN32
+
+namespace {
+
+// Open addressing over a table that only grows, with an id being a slot
+// index plus one. The load is capped so that a probe for a stack that is
+// not there soon reaches an empty slot.
+constexpr size_t kStackTableSize = 1 << 14;
+constexpr size_t kMaxStacks = kStackTableSize / 4 * 3;
+
+struct InternedStack {
+    uint64_t hash;
+    size_t depth;
+    void* frames[kMaxStackFrames];
+};
+
+std::atomic<InternedStack*> sStackTable[kStackTableSize];
+std::atomic<size_t> sStackCount{0};
+
+uint64_t hashFrames(void* const* frames, size_t count) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < count; ++i) {
+        hash = (hash ^ reinterpret_cast<uintptr_t>(frames[i])) *
+               0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool sameStack(const InternedStack* stack, uint64_t hash,
+               void* const* frames, size_t count) {
+    return stack->hash == hash && stack->depth == count &&
+           !memcmp(stack->frames, frames, count * sizeof(void*));
+}
+
+struct SymbolCache {
+    StaticLock lock;
+    std::unordered_map<const void*, std::string> symbols;
+};
+
+SymbolCache& symbolCache() {
+    static SymbolCache* sCache = new SymbolCache;
+    return *sCache;
+}
+
+std::string describeAddress(const void* pc) {
+#ifdef _WIN32
+    HMODULE module = nullptr;
+    if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+                                    GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                            static_cast<LPCSTR>(pc), &module)) {
+        return "??";
+    }
+    char path[MAX_PATH];
+    const DWORD length = GetModuleFileNameA(module, path, MAX_PATH);
+    const char* name = path;
+    for (DWORD i = 0; i < length; ++i) {
+        if (path[i] == '\\' || path[i] == '/') {
+            name = path + i + 1;
+        }
+    }
+    return StringFormat("%s+0x%zx", length ? name : "??",
+                        static_cast<size_t>(static_cast<const char*>(pc) -
+                                            reinterpret_cast<char*>(module)));
+#else
+    Dl_info info;
+    if (!dladdr(pc, &info) || !info.dli_fname) {
+        return "??";
+    }
+    const char* module = strrchr(info.dli_fname, '/');
+    module = module ? module + 1 : info.dli_fname;
+    if (!info.dli_sname) {
+        return StringFormat("%s+0x%zx", module,
+                            static_cast<size_t>(static_cast<const char*>(pc) -
+                                                static_cast<char*>(info.dli_fbase)));
+    }
+    int status = 0;
+    char* demangled =
+            abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    std::string result = StringFormat(
+            "%s+0x%zx (%s)", status == 0 ? demangled : info.dli_sname,
+            static_cast<size_t>(static_cast<const char*>(pc) -
+                                static_cast<char*>(info.dli_saddr)),
+            module);
+    free(demangled);
+    return result;
+#endif
+}
+
+}  // namespace
+
+std::string bt() {
+    void* frames[kMaxStackFrames];
+    const size_t count = captureBacktrace(frames, kMaxStackFrames, 1);
+    return formatBacktrace(frames, count);
+}
+
+StackId captureStack(size_t skip) {
+    void* frames[kMaxStackFrames];
+    return internStack(frames,
+                       captureBacktrace(frames, kMaxStackFrames, skip + 1));
+}
+
+StackId internStack(void* const* frames, size_t count) {
+    count = std::min(count, kMaxStackFrames);
+    if (!count) {
+        return kInvalidStackId;
+    }
+    const uint64_t hash = hashFrames(frames, count);
+    InternedStack* fresh = nullptr;
+    size_t slot = hash & (kStackTableSize - 1);
+    for (;;) {
+        InternedStack* stack = sStackTable[slot].load(std::memory_order_acquire);
+        if (!stack) {
+            if (!fresh) {
+                if (sStackCount.fetch_add(1, std::memory_order_relaxed) >=
+                    kMaxStacks) {
+                    sStackCount.fetch_sub(1, std::memory_order_relaxed);
+                    return kInvalidStackId;
+                }
+                fresh = new InternedStack;
+                fresh->hash = hash;
+                fresh->depth = count;
+                std::copy(frames, frames + count, fresh->frames);
+            }
+            if (sStackTable[slot].compare_exchange_strong(
+                        stack, fresh, std::memory_order_acq_rel,
+                        std::memory_order_acquire)) {
+                return static_cast<StackId>(slot + 1);
+            }
+            // Another thread filled the slot first; |stack| is its entry.
+        }
+        if (sameStack(stack, hash, frames, count)) {
+            if (fresh) {
+                delete fresh;
+                sStackCount.fetch_sub(1, std::memory_order_relaxed);
+            }
+            return static_cast<StackId>(slot + 1);
+        }
+        slot = (slot + 1) & (kStackTableSize - 1);
+    }
+}
+
+size_t getStackFrames(StackId id, void* const** frames) {
+    if (id == kInvalidStackId || id > kStackTableSize) {
+        return 0;
+    }
+    const InternedStack* stack =
+            sStackTable[id - 1].load(std::memory_order_acquire);
+    if (!stack) {
+        return 0;
+    }
+    *frames = stack->frames;
+    return stack->depth;
+}
+
+std::string symbolizeAddress(const void* pc) {
+    SymbolCache& cache = symbolCache();
+    {
+        AutoLock lock(cache.lock);
+        auto it = cache.symbols.find(pc);
+        if (it != cache.symbols.end()) {
+            return it->second;
+        }
+    }
+    // Symbolize without the lock; a racing thread computes the same text.
+    std::string symbol = describeAddress(pc);
+    AutoLock lock(cache.lock);
+    return cache.symbols.emplace(pc, std::move(symbol)).first->second;
+}
+
+std::string formatBacktrace(void* const* frames, size_t count) {
+    std::string result;
+    for (size_t i = 0; i < count; ++i) {
+        StringAppendFormat(&result, "#%zu %p %s\n", i, frames[i],
+                           symbolizeAddress(frames[i]).c_str());
+    }
+    return result;
+}
+
+std::string formatStack(StackId id) {
+    void* const* frames = nullptr;
+    const size_t count = getStackFrames(id, &frames);
+    return formatBacktrace(frames, count);
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,85 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/Backtrace.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace base {
+
+namespace {
+
+void* fakeFrame(uintptr_t index) {
+    return reinterpret_cast<void*>(0x1000 + index * 16);
+}
+
+}  // namespace
+
+// Tests that a stack is interned once and its frames read back.
+TEST(Backtrace, InternStack) {
+    void* frames[] = {fakeFrame(1), fakeFrame(2), fakeFrame(3)};
+    const StackId id = internStack(frames, 3);
+    ASSERT_NE(kInvalidStackId, id);
+    EXPECT_EQ(id, internStack(frames, 3));
+    EXPECT_NE(id, internStack(frames, 2));
+    EXPECT_EQ(kInvalidStackId, internStack(frames, 0));
+
+    void* const* stored = nullptr;
+    ASSERT_EQ(3u, getStackFrames(id, &stored));
+    EXPECT_EQ(fakeFrame(1), stored[0]);
+    EXPECT_EQ(fakeFrame(3), stored[2]);
+    EXPECT_EQ(0u, getStackFrames(kInvalidStackId, &stored));
+}
+
+// Tests that threads racing to intern the same stack get one id.
+TEST(Backtrace, InternStackConcurrently) {
+    void* frames[] = {fakeFrame(7), fakeFrame(8)};
+    std::vector<StackId> ids(4);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        threads.emplace_back([&ids, &frames, i] {
+            ids[i] = internStack(frames, 2);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (StackId id : ids) {
+        EXPECT_EQ(ids[0], id);
+    }
+}
+
+// Tests capture and formatting of the current stack.
+TEST(Backtrace, CaptureAndFormat) {
+    const StackId id = captureStack();
+    ASSERT_NE(kInvalidStackId, id);
+    void* const* frames = nullptr;
+    const size_t depth = getStackFrames(id, &frames);
+    EXPECT_GT(depth, 1u);
+
+    const std::string text = formatStack(id);
+    EXPECT_EQ(0u, text.find("#0 "));
+    EXPECT_NE(std::string::npos, text.find(symbolizeAddress(frames[0])));
+    EXPECT_EQ(symbolizeAddress(frames[0]), symbolizeAddress(frames[0]));
+
+    EXPECT_NE(std::string::npos, bt().find("#0 "));
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,211 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/memory/BlockMemory.h"
+
+#include "aemu/base/AlignedBuf.h"
+#include "aemu/base/StatsPage.h"
+
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace android {
+namespace base {
+
+namespace {
+
+struct BlockStats {
+    Stat backings[3];
+    Stat numaBound;
+
+    BlockStats() {
+        for (int i = 0; i < 3; ++i) {
+            const std::string name =
+                    std::string("memory.blocks.") +
+                    blockBackingName(static_cast<BlockBacking>(i));
+            backings[i] = StatsPage::get().add(name.c_str(), StatKind::kCounter);
+        }
+        numaBound = StatsPage::get().add("memory.blocks.numa_bound",
+                                         StatKind::kCounter);
+    }
+};
+
+const BlockStats& blockStats() {
+    static const BlockStats* sStats = new BlockStats();
+    return *sStats;
+}
+
+#ifdef __linux__
+
+// Maps |size| bytes at a kBlockHugePageSize boundary, by over-reserving and
+// trimming the ends.
+void* mapHugeAligned(uint64_t size) {
+    const uint64_t reserved = size + kBlockHugePageSize;
+    void* raw = mmap(nullptr, reserved, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return nullptr;
+    }
+    const uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    const uintptr_t aligned =
+            (start + kBlockHugePageSize - 1) & ~(kBlockHugePageSize - 1);
+    if (aligned > start) {
+        munmap(raw, aligned - start);
+    }
+    const uintptr_t end = aligned + size;
+    if (start + reserved > end) {
+        munmap(reinterpret_cast<void*>(end), start + reserved - end);
+    }
+    return reinterpret_cast<void*>(aligned);
+}
+
+bool allocateMapped(uint64_t size, BlockMemory* memory) {
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED) {
+        memory->ptr = ptr;
+        memory->backing = BlockBacking::kExplicitHuge;
+        return true;
+    }
+
+    ptr = mapHugeAligned(size);
+    if (!ptr) {
+        return false;
+    }
+    memory->ptr = ptr;
+#ifdef MADV_HUGEPAGE
+    memory->backing = madvise(ptr, size, MADV_HUGEPAGE) == 0
+                              ? BlockBacking::kTransparentHuge
+                              : BlockBacking::kRegular;
+#else
+    memory->backing = BlockBacking::kRegular;
+#endif
+    return true;
+}
+
+#endif  // __linux__
+
+}  // namespace
+
+BlockMemory allocateBlockMemory(uint64_t size,
+                                uint64_t alignment,
+                                const BlockMemoryOptions& options) {
+    BlockMemory memory;
+    memory.size = size;
+
+#ifdef __linux__
+    if (options.hugePages && size && size % kBlockHugePageSize == 0 &&
+        alignment <= kBlockHugePageSize) {
+        memory.mapped = allocateMapped(size, &memory);
+    }
+    if (memory.mapped) {
+        const int node = options.numaNode == BlockMemoryOptions::kLocalNode
+                                 ? currentNumaNode()
+                                 : options.numaNode;
+        // Before the memory is first touched, so pages come from there.
+        if (preferNumaNode(memory.ptr, size, node)) {
+            memory.numaNode = node;
+            blockStats().numaBound.add(1);
+        }
+    }
+#endif
+
+    if (!memory.mapped) {
+        memory.ptr = aligned_buf_alloc(alignment, size);
+        memory.backing = BlockBacking::kRegular;
+    }
+
+    blockStats().backings[static_cast<int>(memory.backing)].add(1);
+    return memory;
+}
+
+void freeBlockMemory(BlockMemory* memory) {
+    if (!memory->ptr) {
+        return;
+    }
+#ifdef __linux__
+    if (memory->mapped) {
+        munmap(memory->ptr, memory->size);
+        *memory = BlockMemory();
+        return;
+    }
+#endif
+    aligned_buf_free(memory->ptr);
+    *memory = BlockMemory();
+}
+
+const char* blockBackingName(BlockBacking backing) {
+    switch (backing) {
+        case BlockBacking::kRegular:
+            return "regular";
+        case BlockBacking::kTransparentHuge:
+            return "transparent_huge";
+        case BlockBacking::kExplicitHuge:
+            return "explicit_huge";
+    }
+    return "unknown";
+}
+
+int currentNumaNode() {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+        return static_cast<int>(node);
+    }
+#elif defined(_WIN32)
+    PROCESSOR_NUMBER processor;
+    GetCurrentProcessorNumberEx(&processor);
+    USHORT node = 0;
+    if (GetNumaProcessorNodeEx(&processor, &node)) {
+        return static_cast<int>(node);
+    }
+#endif
+    return BlockMemoryOptions::kAnyNode;
+}
+
+bool preferNumaNode(void* ptr, uint64_t size, int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+    // From <linux/mempolicy.h>, which is not always installed.
+    constexpr int kMpolPreferred = 1;
+    constexpr int kMaxNodes = 1024;
+    if (node < 0 || node >= kMaxNodes) {
+        return false;
+    }
+    constexpr int kBitsPerWord = 8 * sizeof(unsigned long);
+    unsigned long mask[kMaxNodes / kBitsPerWord] = {};
+    mask[node / kBitsPerWord] = 1UL << (node % kBitsPerWord);
+    // The kernel reads one bit fewer than |maxnode|.
+    return syscall(SYS_mbind, ptr, size, kMpolPreferred, mask, kMaxNodes + 1,
+                   0) == 0;
+#else
+    (void)ptr;
+    (void)size;
+    (void)node;
+    return false;
+#endif
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,86 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/memory/BlockMemory.h"
+
+#include "aemu/base/StatsPage.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+namespace android {
+namespace base {
+namespace {
+
+int64_t statValue(const char* name) {
+    return StatsPage::get().add(name, StatKind::kCounter).value();
+}
+
+// Tests that a huge page sized block is usable however it ends up backed,
+// and that the backing is counted.
+TEST(BlockMemory, HugePageSized) {
+    const uint64_t size = 2 * kBlockHugePageSize;
+    BlockMemory first = allocateBlockMemory(size, 4096);
+    const std::string stat =
+            std::string("memory.blocks.") + blockBackingName(first.backing);
+    const int64_t before = statValue(stat.c_str());
+
+    BlockMemory memory = allocateBlockMemory(size, 4096);
+    ASSERT_NE(nullptr, memory.ptr);
+    EXPECT_EQ(size, memory.size);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(memory.ptr) % 4096);
+    EXPECT_EQ(first.backing, memory.backing);
+    EXPECT_EQ(before + 1, statValue(stat.c_str()));
+    if (memory.backing != BlockBacking::kRegular) {
+        EXPECT_TRUE(memory.mapped);
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(memory.ptr) %
+                              kBlockHugePageSize);
+    }
+    if (memory.mapped) {
+        const char* bytes = static_cast<const char*>(memory.ptr);
+        EXPECT_EQ(0, bytes[0]);
+        EXPECT_EQ(0, bytes[size - 1]);
+    }
+
+    memset(memory.ptr, 0x5a, size);
+    EXPECT_EQ(0x5a, static_cast<unsigned char*>(memory.ptr)[size - 1]);
+
+    freeBlockMemory(&memory);
+    EXPECT_EQ(nullptr, memory.ptr);
+    freeBlockMemory(&memory);
+    freeBlockMemory(&first);
+}
+
+// Tests the aligned_buf_alloc() fallback for sizes huge pages cannot back.
+TEST(BlockMemory, Fallback) {
+    BlockMemory memory = allocateBlockMemory(3 * 4096, 4096);
+    ASSERT_NE(nullptr, memory.ptr);
+    EXPECT_EQ(BlockBacking::kRegular, memory.backing);
+    EXPECT_FALSE(memory.mapped);
+    EXPECT_EQ(BlockMemoryOptions::kAnyNode, memory.numaNode);
+    freeBlockMemory(&memory);
+
+    BlockMemoryOptions options;
+    options.hugePages = false;
+    memory = allocateBlockMemory(kBlockHugePageSize, 4096, options);
+    EXPECT_EQ(BlockBacking::kRegular, memory.backing);
+    EXPECT_FALSE(memory.mapped);
+    freeBlockMemory(&memory);
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
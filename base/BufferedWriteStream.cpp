@@ -0,0 +1,68 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/files/BufferedWriteStream.h"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <string.h>
+
+namespace android {
+namespace base {
+
+BufferedWriteStream::BufferedWriteStream(Stream& output, size_t bufferSize)
+    : mOutput(output), mBuffer(std::max<size_t>(bufferSize, 16)) {}
+
+BufferedWriteStream::~BufferedWriteStream() {
+    flush();
+}
+
+ssize_t BufferedWriteStream::read(void*, size_t) {
+    return -EPERM;
+}
+
+ssize_t BufferedWriteStream::write(const void* buffer, size_t size) {
+    if (mError) {
+        return -EIO;
+    }
+    if (mUsed + size > mBuffer.size()) {
+        if (!flush()) {
+            return -EIO;
+        }
+        if (size >= mBuffer.size()) {
+            // Too big to be worth copying.
+            const ssize_t res = mOutput.write(buffer, size);
+            if (res != static_cast<ssize_t>(size)) {
+                mError = true;
+            }
+            return res;
+        }
+    }
+    memcpy(mBuffer.data() + mUsed, buffer, size);
+    mUsed += size;
+    return size;
+}
+
+bool BufferedWriteStream::flush() {
+    if (mUsed && !mError) {
+        const ssize_t res = mOutput.write(mBuffer.data(), mUsed);
+        mError = res != static_cast<ssize_t>(mUsed);
+    }
+    mUsed = 0;
+    return !mError;
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,99 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/BumpPool.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <vector>
+
+namespace android {
+namespace base {
+
+// Test: allocations within a generation stay valid and don't overlap, also
+// across chunks and for allocations larger than a chunk.
+TEST(BumpPool, KeepsAllocationsUntilFreeAll) {
+    BumpPool pool(1024);
+    std::vector<std::pair<unsigned char*, size_t>> allocs;
+    for (size_t i = 0; i < 500; ++i) {
+        const size_t size = (i % 50 == 0) ? 5000 : 1 + i % 97;
+        auto ptr = static_cast<unsigned char*>(pool.alloc(size));
+        ASSERT_NE(nullptr, ptr);
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) % sizeof(uint64_t));
+        memset(ptr, (unsigned char)i, size);
+        allocs.emplace_back(ptr, size);
+    }
+    for (size_t i = 0; i < allocs.size(); ++i) {
+        for (size_t j = 0; j < allocs[i].second; ++j) {
+            ASSERT_EQ((unsigned char)i, allocs[i].first[j]);
+        }
+    }
+    EXPECT_GT(pool.stats().chunkCount, 1u);
+}
+
+TEST(BumpPool, AllocAligned) {
+    BumpPool pool;
+    for (size_t alignment : {8, 16, 64, 256, 4096}) {
+        pool.alloc(3);
+        void* ptr = pool.allocAligned(100, alignment);
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) % alignment) << alignment;
+    }
+}
+
+// Test: a pool reset every generation with the same workload stops
+// allocating chunks after the first one.
+TEST(BumpPool, ReusesChunksAcrossGenerations) {
+    BumpPool pool(4096);
+    size_t chunkCount = 0;
+    for (int generation = 0; generation < 100; ++generation) {
+        for (int i = 0; i < 200; ++i) {
+            pool.alloc(24 + i);
+        }
+        pool.alloc(10000);
+        if (generation == 0) {
+            chunkCount = pool.stats().chunkCount;
+        }
+        EXPECT_EQ(chunkCount, pool.stats().chunkCount);
+        pool.freeAll();
+    }
+    BumpPool::Stats stats = pool.stats();
+    EXPECT_EQ(100u, stats.generation);
+    EXPECT_EQ(0u, stats.bytesInUse);
+    EXPECT_GE(stats.peakBytes, 10000u + 200 * 24);
+}
+
+// Test: after a spike, spare chunks are trimmed back to the recent usage.
+TEST(BumpPool, TrimsAfterPeak) {
+    BumpPool pool(4096);
+    for (int i = 0; i < 1000; ++i) {
+        pool.alloc(1000);
+    }
+    pool.freeAll();
+    const size_t spikeReserved = pool.stats().bytesReserved;
+    const size_t spikePeak = pool.stats().peakBytes;
+    EXPECT_GE(spikeReserved, 1000u * 1000);
+
+    for (size_t generation = 0; generation < 2 * BumpPool::kTrimGenerations;
+         ++generation) {
+        pool.alloc(1000);
+        pool.freeAll();
+    }
+    EXPECT_LE(pool.stats().bytesReserved, 4096u);
+    EXPECT_EQ(spikePeak, pool.stats().peakBytes);
+}
+
+}  // namespace base
+}  // namespace android
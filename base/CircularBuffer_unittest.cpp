@@ -0,0 +1,101 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/containers/CircularBuffer.h"
+
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace base {
+
+namespace {
+
+template <class T>
+std::vector<T> contents(const CircularBuffer<T>& buffer) {
+    std::vector<T> result;
+    auto [first, second] = buffer.spans();
+    result.insert(result.end(), first.data, first.data + first.size);
+    result.insert(result.end(), second.data, second.data + second.size);
+    return result;
+}
+
+}  // namespace
+
+// Tests that single element operations keep the newest elements, for both
+// masked and divided capacities.
+TEST(CircularBuffer, PushPop) {
+    for (int capacity : {4, 5}) {
+        CircularBuffer<int> buffer(capacity);
+        for (int i = 0; i < 7; ++i) {
+            buffer.push_back(i);
+        }
+        EXPECT_EQ(capacity, buffer.size());
+        EXPECT_EQ(7 - capacity, buffer.front());
+        EXPECT_EQ(6, buffer.back());
+        EXPECT_EQ(7 - capacity + 1, buffer[1]);
+        buffer.pop_back();
+        EXPECT_EQ(5, buffer.back());
+        buffer.pop_front();
+        EXPECT_EQ(8 - capacity, buffer.front());
+        EXPECT_EQ(capacity - 2, buffer.size());
+    }
+}
+
+// Tests that bulk pushes and pops match pushing one element at a time, and
+// that spans() covers the contents in order.
+TEST(CircularBuffer, BulkMatchesSingle) {
+    for (int capacity : {8, 7}) {
+        CircularBuffer<int> buffer(capacity);
+        std::deque<int> expected;
+        int next = 0;
+        for (int round = 0; round < 50; ++round) {
+            const int count = (round * 5) % 11;
+            std::vector<int> values;
+            for (int i = 0; i < count; ++i) {
+                values.push_back(next++);
+            }
+            buffer.push_back(values.data(), count);
+            for (int value : values) {
+                expected.push_back(value);
+                if (static_cast<int>(expected.size()) > capacity) {
+                    expected.pop_front();
+                }
+            }
+            const int popped = std::min<int>(round % 3, expected.size());
+            buffer.pop_front(popped);
+            expected.erase(expected.begin(), expected.begin() + popped);
+
+            ASSERT_EQ(static_cast<int>(expected.size()), buffer.size());
+            EXPECT_EQ(std::vector<int>(expected.begin(), expected.end()),
+                      contents(buffer));
+        }
+    }
+}
+
+// Tests bulk pushes of elements that are not trivially copyable.
+TEST(CircularBuffer, BulkStrings) {
+    CircularBuffer<std::string> buffer(4);
+    const std::string values[] = {"a", "b", "c", "d", "e"};
+    buffer.push_back(values, 3);
+    buffer.push_back(values + 3, 2);
+    EXPECT_EQ((std::vector<std::string>{"b", "c", "d", "e"}), contents(buffer));
+}
+
+}  // namespace base
+}  // namespace android
@@ -14,21 +14,103 @@
 
 #include "aemu/base/files/CompressingStream.h"
 
+#include "aemu/base/Hash.h"
 #include "aemu/base/files/StreamSerializing.h"
+#include "aemu/base/system/System.h"
+#include "aemu/base/threads/ThreadPool.h"
 
 #include "lz4.h"
 
+#include <algorithm>
 #include <errno.h>
 
 namespace android {
 namespace base {
 
+struct CompressingStream::Block {
+    uint32_t index = 0;
+    uint32_t rawSize = 0;
+    uint64_t checksum = 0;
+    std::vector<char> input;
+    std::vector<char> output;
+    // Guarded by CompressingStream::mLock.
+    bool done = false;
+    bool failed = false;
+};
+
+// Also hashes |input| into |checksum|, unless that is null.
+static void compressBlock(const CodecOptions& codec,
+                          std::vector<char>* output,
+                          const std::vector<char>& input,
+                          uint64_t* checksum,
+                          bool* failed) {
+    if (checksum) {
+        *checksum = xxh3Hash64(input.data(), input.size());
+    }
+    output->resize(codecCompressBound(codec.codec, input.size()));
+    const size_t written = codecCompress(codec, input.data(), input.size(),
+                                         output->data(), output->size());
+    *failed = written == 0;
+    output->resize(written);
+}
+
 CompressingStream::CompressingStream(Stream& output)
     : mOutput(output) {
     mLzStream = reinterpret_cast<void *>(LZ4_createStream());
 }
 
+CompressingStream::CompressingStream(Stream& output, const BlockOptions& options)
+    : mOutput(output), mBlockMode(true), mOptions(options) {
+    mOptions.blockSize = std::max<uint32_t>(mOptions.blockSize, 4096);
+    mOptions.blockSize = std::min<uint32_t>(mOptions.blockSize, LZ4_MAX_INPUT_SIZE);
+    int threads = mOptions.threadCount > 0 ? mOptions.threadCount : getCpuCoreCount();
+    threads = std::max(threads, 1);
+    if (!mOptions.maxBlocksInFlight) {
+        mOptions.maxBlocksInFlight = 2 * threads;
+    }
+    CodecOptions& codec = mOptions.codec;
+    if (!isCodecAvailable(codec.codec)) {
+        codec = CodecOptions();
+    } else if (codec.dictionaryId && !hasCompressionDictionary(codec.dictionaryId)) {
+        codec.dictionaryId = 0;
+    }
+
+    mPool = std::make_unique<ThreadPool<Block*>>(threads, [this](Block*&& block) {
+        bool failed;
+        compressBlock(mOptions.codec, &block->output, block->input,
+                      mOptions.checksums ? &block->checksum : nullptr, &failed);
+        block->input = std::vector<char>();
+        AutoLock lock(mLock);
+        block->done = true;
+        block->failed = failed;
+        mBlockDone.broadcastAndUnlock(&lock);
+    });
+    if (!mPool->start()) {
+        // Compress on the calling thread instead.
+        mPool.reset();
+    }
+
+    // Plain LZ4 keeps the original header, for older readers.
+    if (codec.codec == CompressionCodec::Lz4 && !codec.dictionaryId &&
+        !mOptions.checksums) {
+        mOutput.putBe32(kBlockFormatMagic);
+        mOutput.putBe32(mOptions.blockSize);
+        mBytesWritten = 8;
+    } else {
+        mOutput.putBe32(mOptions.checksums ? kChecksumFormatMagic
+                                           : kCodecFormatMagic);
+        mOutput.putBe32(mOptions.blockSize);
+        mOutput.putBe32(static_cast<uint32_t>(codec.codec));
+        mOutput.putBe32(codec.dictionaryId);
+        mBytesWritten = 16;
+    }
+}
+
 CompressingStream::~CompressingStream() {
+    if (mBlockMode) {
+        finishBlocks();
+        return;
+    }
     saveBuffer(&mOutput, mBuffer);
     LZ4_freeStream((LZ4_stream_t*)mLzStream);
 }
@@ -41,6 +123,9 @@ ssize_t CompressingStream::write(const void* buffer, size_t size) {
     if (!size) {
         return 0;
     }
+    if (mBlockMode) {
+        return writeBlocks(buffer, size);
+    }
 
     size_t outSize = 0;
     outSize = LZ4_compressBound(size);
@@ -59,5 +144,102 @@ ssize_t CompressingStream::write(const void* buffer, size_t size) {
     return size;
 }
 
+ssize_t CompressingStream::writeBlocks(const void* buffer, size_t size) {
+    if (mError) {
+        return -EIO;
+    }
+    auto src = static_cast<const char*>(buffer);
+    size_t remaining = size;
+    while (remaining) {
+        if (!mCurrent) {
+            mCurrent = std::make_unique<Block>();
+            mCurrent->index = mNextIndex++;
+            mCurrent->input.reserve(mOptions.blockSize);
+        }
+        auto& input = mCurrent->input;
+        const size_t chunk = std::min<size_t>(remaining, mOptions.blockSize - input.size());
+        input.insert(input.end(), src, src + chunk);
+        src += chunk;
+        remaining -= chunk;
+        if (input.size() == mOptions.blockSize) {
+            submitBlock();
+        }
+    }
+    return mError ? -EIO : size;
+}
+
+void CompressingStream::submitBlock() {
+    Block* block = mCurrent.get();
+    block->rawSize = block->input.size();
+    mInFlight.push_back(std::move(mCurrent));
+    if (mPool) {
+        mPool->enqueue(std::move(block));
+    } else {
+        compressBlock(mOptions.codec, &block->output, block->input,
+                      mOptions.checksums ? &block->checksum : nullptr,
+                      &block->failed);
+        block->done = true;
+    }
+    // Throttle before the next block is filled in.
+    flushBlocks(false);
+}
+
+void CompressingStream::flushBlocks(bool waitForAll) {
+    while (!mInFlight.empty()) {
+        Block* block = mInFlight.front().get();
+        {
+            AutoLock lock(mLock);
+            const bool mustWait =
+                waitForAll || mInFlight.size() >= mOptions.maxBlocksInFlight;
+            if (!block->done && !mustWait) {
+                return;
+            }
+            mBlockDone.wait(&lock, [block] { return block->done; });
+            if (block->failed) {
+                mError = true;
+            }
+        }
+        writeBlock(*block);
+        mInFlight.pop_front();
+    }
+}
+
+void CompressingStream::writeBlock(const Block& block) {
+    if (mError) {
+        return;
+    }
+    mBlockOffsets.push_back(mBytesWritten);
+    mOutput.putBe32(block.index);
+    mOutput.putBe32(block.rawSize);
+    mOutput.putBe32(block.output.size());
+    if (mOptions.checksums) {
+        mOutput.putBe64(block.checksum);
+        mBytesWritten += 8;
+    }
+    const ssize_t res = mOutput.write(block.output.data(), block.output.size());
+    if (res != (ssize_t)block.output.size()) {
+        mError = true;
+    }
+    mBytesWritten += 12 + block.output.size();
+}
+
+void CompressingStream::finishBlocks() {
+    if (mCurrent && !mCurrent->input.empty()) {
+        submitBlock();
+    }
+    mCurrent.reset();
+    flushBlocks(true);
+    if (mPool) {
+        mPool->done();
+        mPool->join();
+    }
+
+    mOutput.putBe32(kBlockFormatEnd);
+    mOutput.putBe32(mBlockOffsets.size());
+    for (uint64_t offset : mBlockOffsets) {
+        mOutput.putBe64(offset);
+    }
+}
+
 }  // namespace base
 }  // namespace android
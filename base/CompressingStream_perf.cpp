@@ -0,0 +1,107 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/files/CompressingStream.h"
+#include "aemu/base/files/DecompressingStream.h"
+#include "aemu/base/files/MemStream.h"
+
+#include "benchmark/benchmark.h"
+
+#include <memory>
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+constexpr size_t kDataSize = 4 * 1024 * 1024;
+constexpr size_t kChunk = 64 * 1024;
+
+// The same data as CompressingStream_unittest: compressible, but not trivially.
+std::vector<char> makeData(size_t size) {
+    std::vector<char> data(size);
+    uint32_t x = 1;
+    for (size_t i = 0; i < size; ++i) {
+        x = x * 1103515245 + 12345;
+        data[i] = (i % 7) ? char(i / 64) : char(x >> 24);
+    }
+    return data;
+}
+
+// |threads| is the thread count in block mode, or -1 for the legacy format.
+void compress(const std::vector<char>& data,
+              int threads,
+              MemStream& out,
+              bool checksums = false) {
+    CompressingStream::BlockOptions options;
+    options.blockSize = 256 * 1024;
+    options.threadCount = threads;
+    options.checksums = checksums;
+    auto stream = threads < 0 ? std::make_unique<CompressingStream>(out)
+                              : std::make_unique<CompressingStream>(out, options);
+    for (size_t pos = 0; pos < data.size(); pos += kChunk) {
+        stream->write(data.data() + pos, kChunk);
+    }
+}
+
+void BM_CompressingStream_Write(benchmark::State& state) {
+    const auto data = makeData(kDataSize);
+    for (auto _ : state) {
+        MemStream out(int(kDataSize / 2));
+        compress(data, int(state.range(0)), out);
+        benchmark::DoNotOptimize(out.writtenSize());
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * kDataSize);
+}
+BENCHMARK(BM_CompressingStream_Write)->Arg(-1)->Arg(1)->Arg(4)->UseRealTime();
+
+void BM_DecompressingStream_Read(benchmark::State& state) {
+    const int threads = int(state.range(0));
+    const auto data = makeData(kDataSize);
+    MemStream compressed;
+    compress(data, threads, compressed, state.range(1));
+
+    std::vector<char> out(kDataSize);
+    for (auto _ : state) {
+        MemStream in(MemStream::Buffer(compressed.buffer()));
+        if (threads < 0) {
+            DecompressingStream stream(in);
+            // Reads must mirror the writes in this format.
+            for (size_t pos = 0; pos < out.size(); pos += kChunk) {
+                stream.read(out.data() + pos, kChunk);
+            }
+        } else {
+            DecompressingStream::BlockOptions options;
+            options.threadCount = threads;
+            DecompressingStream stream(in, options);
+            stream.read(out.data(), out.size());
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * kDataSize);
+}
+// Checksums are verified on the decompression threads.
+BENCHMARK(BM_DecompressingStream_Read)
+        ->ArgNames({"threads", "checksums"})
+        ->Args({-1, 0})
+        ->Args({1, 0})
+        ->Args({1, 1})
+        ->Args({4, 0})
+        ->Args({4, 1})
+        ->UseRealTime();
+
+}  // namespace
+}  // namespace base
+}  // namespace android
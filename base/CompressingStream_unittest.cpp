@@ -0,0 +1,377 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/files/CompressingStream.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "aemu/base/files/DecompressingStream.h"
+#include "aemu/base/files/MemStream.h"
+
+namespace android {
+namespace base {
+namespace {
+
+std::vector<char> makeData(size_t size) {
+    std::vector<char> data(size);
+    uint32_t x = 1;
+    for (size_t i = 0; i < size; ++i) {
+        // Compressible, but not trivially so.
+        x = x * 1103515245 + 12345;
+        data[i] = (i % 7) ? char(i / 64) : char(x >> 24);
+    }
+    return data;
+}
+
+// Hides the seeking of the stream it wraps, like a pipe would.
+class SequentialStream : public Stream {
+public:
+    explicit SequentialStream(Stream& stream) : mStream(stream) {}
+
+    ssize_t read(void* buffer, size_t size) override {
+        return mStream.read(buffer, size);
+    }
+    ssize_t write(const void* buffer, size_t size) override {
+        return mStream.write(buffer, size);
+    }
+
+private:
+    Stream& mStream;
+};
+
+TEST(CompressingStream, LegacyRoundTrip) {
+    const auto data = makeData(300000);
+    constexpr size_t kChunk = 10000;
+    MemStream mem;
+    {
+        CompressingStream stream(mem);
+        for (size_t pos = 0; pos < data.size(); pos += kChunk) {
+            EXPECT_EQ((ssize_t)kChunk, stream.write(data.data() + pos, kChunk));
+        }
+    }
+    mem.putBe32(0xdeadbeef);
+
+    std::vector<char> out(data.size());
+    {
+        DecompressingStream stream(mem);
+        // Reads must mirror the writes in this format.
+        for (size_t pos = 0; pos < 100000; pos += kChunk) {
+            EXPECT_EQ((ssize_t)kChunk, stream.read(out.data() + pos, kChunk));
+        }
+        EXPECT_TRUE(std::equal(out.begin(), out.begin() + 100000, data.begin()));
+    }
+    // The rest of the compressed data was skipped.
+    EXPECT_EQ(0xdeadbeef, mem.getBe32());
+}
+
+TEST(CompressingStream, BlockRoundTrip) {
+    const auto data = makeData(1000000);
+    CompressingStream::BlockOptions options;
+    options.blockSize = 64 * 1024;
+    options.threadCount = 3;
+    options.maxBlocksInFlight = 4;
+
+    MemStream mem;
+    {
+        CompressingStream stream(mem, options);
+        // Odd-sized writes straddle block boundaries.
+        for (size_t pos = 0; pos < data.size(); pos += 1000) {
+            const size_t size = std::min<size_t>(1000, data.size() - pos);
+            EXPECT_EQ((ssize_t)size, stream.write(data.data() + pos, size));
+        }
+    }
+    EXPECT_LT(mem.writtenSize(), (int)data.size());
+
+    DecompressingStream::BlockOptions readOptions;
+    readOptions.threadCount = 2;
+    DecompressingStream stream(mem, readOptions);
+    EXPECT_EQ(16u, stream.blockCount());
+    EXPECT_EQ(64u * 1024, stream.blockSize());
+
+    std::vector<char> out(data.size() + 10);
+    EXPECT_EQ((ssize_t)data.size(), stream.read(out.data(), out.size()));
+    out.resize(data.size());
+    EXPECT_EQ(data, out);
+    EXPECT_EQ(0, stream.read(out.data(), 1));
+}
+
+TEST(CompressingStream, BlockSeek) {
+    const auto data = makeData(300000);
+    CompressingStream::BlockOptions options;
+    options.blockSize = 64 * 1024;
+    MemStream mem;
+    {
+        CompressingStream stream(mem, options);
+        stream.write(data.data(), data.size());
+    }
+    mem.putBe32(0xdeadbeef);
+
+    {
+        DecompressingStream stream(mem, DecompressingStream::BlockOptions());
+        ASSERT_EQ(5u, stream.blockCount());
+        EXPECT_FALSE(stream.seekToBlock(5));
+
+        std::vector<char> out(100);
+        for (size_t block : {3u, 1u, 4u, 0u}) {
+            ASSERT_TRUE(stream.seekToBlock(block));
+            EXPECT_EQ(100, stream.read(out.data(), out.size()));
+            const auto begin = data.begin() + block * options.blockSize;
+            EXPECT_TRUE(std::equal(out.begin(), out.end(), begin));
+        }
+        // Reading on runs into the next block.
+        std::vector<char> rest(data.end() - data.begin() - 100);
+        EXPECT_EQ((ssize_t)rest.size(), stream.read(rest.data(), rest.size()));
+        EXPECT_TRUE(std::equal(rest.begin(), rest.end(), data.begin() + 100));
+    }
+    EXPECT_EQ(0xdeadbeef, mem.getBe32());
+}
+
+TEST(CompressingStream, BlockSeekForwardOnly) {
+    const auto data = makeData(300000);
+    CompressingStream::BlockOptions options;
+    options.blockSize = 64 * 1024;
+    MemStream mem;
+    {
+        CompressingStream stream(mem, options);
+        stream.write(data.data(), data.size());
+    }
+    mem.putBe32(0xdeadbeef);
+
+    {
+        SequentialStream input(mem);
+        DecompressingStream::BlockOptions readOptions;
+        readOptions.maxBlocksInFlight = 1;
+        DecompressingStream stream(input, readOptions);
+        EXPECT_EQ(0u, stream.blockCount());
+        std::vector<char> out(100);
+        for (size_t block : {1u, 3u, 3u}) {
+            ASSERT_TRUE(stream.seekToBlock(block));
+            EXPECT_EQ(100, stream.read(out.data(), out.size()));
+            const auto begin = data.begin() + block * options.blockSize;
+            EXPECT_TRUE(std::equal(out.begin(), out.end(), begin));
+        }
+        EXPECT_FALSE(stream.seekToBlock(2));
+        EXPECT_FALSE(stream.seekToBlock(5));
+    }
+    EXPECT_EQ(0xdeadbeef, mem.getBe32());
+}
+
+TEST(CompressingStream, BlockDestroyedEarlyLeavesInputAfterData) {
+    const auto data = makeData(500000);
+    CompressingStream::BlockOptions options;
+    options.blockSize = 16 * 1024;
+    MemStream mem;
+    {
+        CompressingStream stream(mem, options);
+        stream.write(data.data(), data.size());
+    }
+    mem.putBe32(0xdeadbeef);
+
+    for (bool seekable : {true, false}) {
+        mem.rewind();
+        SequentialStream sequential(mem);
+        Stream& input = seekable ? static_cast<Stream&>(mem) : sequential;
+        {
+            DecompressingStream stream(input, DecompressingStream::BlockOptions());
+            char c;
+            EXPECT_EQ(1, stream.read(&c, 1));
+            EXPECT_EQ(data[0], c);
+        }
+        EXPECT_EQ(0xdeadbeef, mem.getBe32()) << seekable;
+    }
+}
+
+TEST(CompressingStream, BlockRejectsGarbage) {
+    MemStream mem;
+    mem.putBe32(0x12345678);
+    DecompressingStream stream(mem, DecompressingStream::BlockOptions());
+    char c;
+    EXPECT_EQ(-EIO, stream.read(&c, 1));
+    EXPECT_EQ(0u, stream.blockCount());
+    EXPECT_FALSE(stream.seekToBlock(0));
+}
+
+// Tests that every codec round-trips, and that plain LZ4 keeps the header
+// older readers know.
+TEST(CompressingStream, Codecs) {
+    const auto data = makeData(200000);
+    for (CompressionCodec codec : {CompressionCodec::Lz4, CompressionCodec::Lz4Hc,
+                                   CompressionCodec::Zstd}) {
+        SCOPED_TRACE(static_cast<int>(codec));
+        CompressingStream::BlockOptions options;
+        options.blockSize = 64 * 1024;
+        options.codec.codec = codec;
+        MemStream mem;
+        {
+            CompressingStream stream(mem, options);
+            stream.write(data.data(), data.size());
+        }
+        const uint32_t magic = mem.getBe32();
+        mem.rewind();
+        // Unavailable codecs fall back to LZ4.
+        if (codec == CompressionCodec::Lz4 || !isCodecAvailable(codec)) {
+            EXPECT_EQ(CompressingStream::kBlockFormatMagic, magic);
+        } else {
+            EXPECT_EQ(CompressingStream::kCodecFormatMagic, magic);
+        }
+
+        DecompressingStream stream(mem, DecompressingStream::BlockOptions());
+        std::vector<char> out(data.size());
+        EXPECT_EQ((ssize_t)data.size(), stream.read(out.data(), out.size()));
+        EXPECT_EQ(data, out);
+    }
+}
+
+// Tests that streams of a codec or dictionary the reader lacks fail
+// cleanly.
+TEST(CompressingStream, UnknownCodecFails) {
+    for (uint32_t codec : {7u, static_cast<uint32_t>(CompressionCodec::Zstd)}) {
+        if (isCodecAvailable(static_cast<CompressionCodec>(codec))) {
+            continue;
+        }
+        MemStream mem;
+        mem.putBe32(CompressingStream::kCodecFormatMagic);
+        mem.putBe32(4096);
+        mem.putBe32(codec);
+        mem.putBe32(0);
+        DecompressingStream stream(mem, DecompressingStream::BlockOptions());
+        char c;
+        EXPECT_EQ(-EIO, stream.read(&c, 1));
+    }
+    MemStream mem;
+    mem.putBe32(CompressingStream::kCodecFormatMagic);
+    mem.putBe32(4096);
+    mem.putBe32(static_cast<uint32_t>(CompressionCodec::Lz4));
+    mem.putBe32(0x7fffffff);
+    DecompressingStream stream(mem, DecompressingStream::BlockOptions());
+    char c;
+    EXPECT_EQ(-EIO, stream.read(&c, 1));
+}
+
+// Tests that checksummed blocks read back, and that a block whose data was
+// changed on disk is reported by index even though it still decompresses.
+TEST(CompressingStream, Checksums) {
+    std::vector<char> data(5 * 4096);
+    uint32_t x = 1;
+    for (char& c : data) {
+        // Incompressible: every byte is an LZ4 literal.
+        x = x * 1103515245 + 12345;
+        c = char(x >> 24);
+    }
+    CompressingStream::BlockOptions options;
+    options.blockSize = 4096;
+    options.checksums = true;
+    MemStream mem;
+    {
+        CompressingStream stream(mem, options);
+        stream.write(data.data(), data.size());
+    }
+    MemStream::Buffer saved = mem.buffer();
+    EXPECT_EQ(CompressingStream::kChecksumFormatMagic, mem.getBe32());
+    mem.rewind();
+    {
+        DecompressingStream stream(mem, DecompressingStream::BlockOptions());
+        EXPECT_TRUE(stream.hasChecksums());
+        std::vector<char> out(data.size());
+        EXPECT_EQ((ssize_t)data.size(), stream.read(out.data(), out.size()));
+        EXPECT_EQ(data, out);
+        EXPECT_FALSE(stream.failedBlock());
+    }
+
+    // Past the 16-byte header, each block is a 20-byte header and its data.
+    size_t pos = 16;
+    for (int i = 0; i < 2; ++i) {
+        pos += 20 + MemStream(MemStream::Buffer(saved.begin() + pos + 8,
+                                                saved.begin() + pos + 12))
+                            .getBe32();
+    }
+    saved[pos + 20 + 100] ^= 1;
+    MemStream corrupt(std::move(saved));
+    DecompressingStream stream(corrupt, DecompressingStream::BlockOptions());
+    std::vector<char> out(data.size());
+    EXPECT_EQ((ssize_t)(2 * 4096), stream.read(out.data(), 2 * 4096));
+    EXPECT_EQ(-EIO, stream.read(out.data(), 4096));
+    EXPECT_EQ(2u, stream.failedBlock());
+}
+
+// Tests the codecs picked per payload class.
+TEST(CompressionCodec, ForPayload) {
+    EXPECT_EQ(CompressionCodec::Lz4,
+              CodecOptions::forPayload(PayloadClass::Default).codec);
+    const CodecOptions device = CodecOptions::forPayload(PayloadClass::DeviceState);
+    if (isCodecAvailable(CompressionCodec::Zstd)) {
+        EXPECT_EQ(CompressionCodec::Zstd, device.codec);
+        EXPECT_EQ(CompressionCodec::Zstd,
+                  CodecOptions::forPayload(PayloadClass::Ram).codec);
+    } else {
+        EXPECT_EQ(CompressionCodec::Lz4Hc, device.codec);
+        EXPECT_FALSE(registerCompressionDictionary(5, "abc", 3));
+    }
+}
+
+#ifdef AEMU_BASE_USE_ZSTD
+// Tests that a dictionary trained on small records shrinks them, and that
+// streams using it read back with it.
+TEST(CompressionCodec, TrainedDictionary) {
+    std::vector<std::string> samples;
+    for (int i = 0; i < 2000; ++i) {
+        samples.push_back("pipe:qemud:service" + std::to_string(i % 17) +
+                          " flags=0x" + std::to_string(i % 5) +
+                          " wanted=read|write|close timeline=" +
+                          std::to_string(i * 3));
+    }
+    const std::vector<char> dict = trainCompressionDictionary(samples, 4096);
+    ASSERT_FALSE(dict.empty());
+    constexpr uint32_t kId = 0x7e57;
+    ASSERT_TRUE(registerCompressionDictionary(kId, dict.data(), dict.size()));
+    EXPECT_FALSE(registerCompressionDictionary(kId, dict.data(), dict.size()));
+
+    const std::string record = samples[1234];
+    std::vector<char> plain(codecCompressBound(CompressionCodec::Zstd, record.size()));
+    std::vector<char> trained(plain.size());
+    CodecOptions options;
+    options.codec = CompressionCodec::Zstd;
+    const size_t plainSize = codecCompress(options, record.data(), record.size(),
+                                           plain.data(), plain.size());
+    options.dictionaryId = kId;
+    const size_t trainedSize = codecCompress(
+            options, record.data(), record.size(), trained.data(), trained.size());
+    ASSERT_NE(0u, plainSize);
+    ASSERT_NE(0u, trainedSize);
+    EXPECT_LT(trainedSize, plainSize);
+
+    std::string out(record.size(), 0);
+    EXPECT_TRUE(codecDecompress(CompressionCodec::Zstd, kId, trained.data(),
+                                trainedSize, &out[0], out.size()));
+    EXPECT_EQ(record, out);
+
+    CompressingStream::BlockOptions streamOptions;
+    streamOptions.codec = options;
+    MemStream mem;
+    {
+        CompressingStream stream(mem, streamOptions);
+        stream.write(record.data(), record.size());
+    }
+    DecompressingStream stream(mem, DecompressingStream::BlockOptions());
+    EXPECT_EQ((ssize_t)record.size(), stream.read(&out[0], out.size()));
+    EXPECT_EQ(record, out);
+}
+#endif  // AEMU_BASE_USE_ZSTD
+
+}  // namespace
+}  // namespace base
+}  // namespace android
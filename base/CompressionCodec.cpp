@@ -0,0 +1,299 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/files/CompressionCodec.h"
+
+#include "aemu/base/synchronization/Lock.h"
+
+#include "lz4.h"
+#include "lz4hc.h"
+
+#ifdef AEMU_BASE_USE_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+
+namespace android {
+namespace base {
+
+namespace {
+
+#ifdef AEMU_BASE_USE_ZSTD
+
+// Dictionaries are never unregistered, so pointers into them stay valid.
+class DictionaryRegistry {
+public:
+    static DictionaryRegistry& get() {
+        static DictionaryRegistry* sRegistry = new DictionaryRegistry;
+        return *sRegistry;
+    }
+
+    bool add(uint32_t id, const void* data, size_t size) {
+        ZSTD_DDict* ddict = ZSTD_createDDict(data, size);
+        if (!ddict) {
+            return false;
+        }
+        AutoLock lock(mLock);
+        if (mDictionaries.count(id)) {
+            ZSTD_freeDDict(ddict);
+            return false;
+        }
+        auto& dict = mDictionaries[id];
+        dict.reset(new Dictionary);
+        dict->bytes.assign(static_cast<const char*>(data),
+                           static_cast<const char*>(data) + size);
+        dict->ddict = ddict;
+        return true;
+    }
+
+    bool has(uint32_t id) {
+        AutoLock lock(mLock);
+        return mDictionaries.count(id) != 0;
+    }
+
+    // Digested dictionaries are made per level on first use.
+    ZSTD_CDict* compressionDict(uint32_t id, int level) {
+        AutoLock lock(mLock);
+        auto it = mDictionaries.find(id);
+        if (it == mDictionaries.end()) {
+            return nullptr;
+        }
+        Dictionary& dict = *it->second;
+        ZSTD_CDict*& cdict = dict.cdicts[level];
+        if (!cdict) {
+            cdict = ZSTD_createCDict(dict.bytes.data(), dict.bytes.size(),
+                                     level);
+        }
+        return cdict;
+    }
+
+    ZSTD_DDict* decompressionDict(uint32_t id) {
+        AutoLock lock(mLock);
+        auto it = mDictionaries.find(id);
+        return it == mDictionaries.end() ? nullptr : it->second->ddict;
+    }
+
+private:
+    struct Dictionary {
+        std::vector<char> bytes;
+        ZSTD_DDict* ddict = nullptr;
+        std::unordered_map<int, ZSTD_CDict*> cdicts;
+    };
+
+    Lock mLock;
+    std::unordered_map<uint32_t, std::unique_ptr<Dictionary>> mDictionaries;
+};
+
+// Contexts are big enough to be worth keeping around per thread.
+struct ZstdContexts {
+    ZSTD_CCtx* compress = nullptr;
+    ZSTD_DCtx* decompress = nullptr;
+
+    ~ZstdContexts() {
+        ZSTD_freeCCtx(compress);
+        ZSTD_freeDCtx(decompress);
+    }
+};
+
+thread_local ZstdContexts tZstdContexts;
+
+#endif  // AEMU_BASE_USE_ZSTD
+
+}  // namespace
+
+CodecOptions CodecOptions::forPayload(PayloadClass payload) {
+    CodecOptions options;
+    const bool zstd = isCodecAvailable(CompressionCodec::Zstd);
+    switch (payload) {
+        case PayloadClass::Default:
+            break;
+        case PayloadClass::DeviceState:
+            if (zstd) {
+                options.codec = CompressionCodec::Zstd;
+                if (hasCompressionDictionary(kDeviceStateDictionaryId)) {
+                    options.dictionaryId = kDeviceStateDictionaryId;
+                }
+            } else {
+                options.codec = CompressionCodec::Lz4Hc;
+            }
+            break;
+        case PayloadClass::Texture:
+        case PayloadClass::Ram:
+            // Both are large and written while the guest is paused, so
+            // speed matters as much as size.
+            if (zstd) {
+                options.codec = CompressionCodec::Zstd;
+                options.level = 1;
+            }
+            break;
+    }
+    return options;
+}
+
+bool isCodecAvailable(CompressionCodec codec) {
+    switch (codec) {
+        case CompressionCodec::Lz4:
+        case CompressionCodec::Lz4Hc:
+            return true;
+        case CompressionCodec::Zstd:
+#ifdef AEMU_BASE_USE_ZSTD
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+bool registerCompressionDictionary(uint32_t id, const void* data, size_t size) {
+#ifdef AEMU_BASE_USE_ZSTD
+    return id && size && DictionaryRegistry::get().add(id, data, size);
+#else
+    return false;
+#endif
+}
+
+bool hasCompressionDictionary(uint32_t id) {
+#ifdef AEMU_BASE_USE_ZSTD
+    return DictionaryRegistry::get().has(id);
+#else
+    return false;
+#endif
+}
+
+std::vector<char> trainCompressionDictionary(
+        const std::vector<std::string>& samples,
+        size_t maxSize) {
+    std::vector<char> dict;
+#ifdef AEMU_BASE_USE_ZSTD
+    std::string joined;
+    std::vector<size_t> sizes;
+    sizes.reserve(samples.size());
+    for (const std::string& sample : samples) {
+        joined += sample;
+        sizes.push_back(sample.size());
+    }
+    dict.resize(maxSize);
+    const size_t size = ZDICT_trainFromBuffer(dict.data(), dict.size(),
+                                              joined.data(), sizes.data(),
+                                              sizes.size());
+    dict.resize(ZDICT_isError(size) ? 0 : size);
+#endif
+    return dict;
+}
+
+size_t codecCompressBound(CompressionCodec codec, size_t size) {
+    switch (codec) {
+        case CompressionCodec::Lz4:
+        case CompressionCodec::Lz4Hc:
+            return LZ4_compressBound(size);
+        case CompressionCodec::Zstd:
+#ifdef AEMU_BASE_USE_ZSTD
+            return ZSTD_compressBound(size);
+#else
+            break;
+#endif
+    }
+    return 0;
+}
+
+size_t codecCompress(const CodecOptions& options,
+                     const void* src, size_t size,
+                     void* dst, size_t capacity) {
+    const auto in = static_cast<const char*>(src);
+    const auto out = static_cast<char*>(dst);
+    switch (options.codec) {
+        case CompressionCodec::Lz4: {
+            const int written = LZ4_compress_fast(
+                    in, out, size, capacity, std::max(options.level, 1));
+            return std::max(written, 0);
+        }
+        case CompressionCodec::Lz4Hc: {
+            const int written = LZ4_compress_HC(
+                    in, out, size, capacity,
+                    options.level ? options.level : LZ4HC_CLEVEL_DEFAULT);
+            return std::max(written, 0);
+        }
+        case CompressionCodec::Zstd: {
+#ifdef AEMU_BASE_USE_ZSTD
+            ZstdContexts& contexts = tZstdContexts;
+            if (!contexts.compress) {
+                contexts.compress = ZSTD_createCCtx();
+            }
+            const int level = options.level ? options.level : ZSTD_CLEVEL_DEFAULT;
+            size_t written;
+            if (options.dictionaryId) {
+                ZSTD_CDict* cdict = DictionaryRegistry::get().compressionDict(
+                        options.dictionaryId, level);
+                if (!cdict) {
+                    return 0;
+                }
+                written = ZSTD_compress_usingCDict(contexts.compress, dst,
+                                                   capacity, src, size, cdict);
+            } else {
+                written = ZSTD_compressCCtx(contexts.compress, dst, capacity,
+                                            src, size, level);
+            }
+            return ZSTD_isError(written) ? 0 : written;
+#else
+            break;
+#endif
+        }
+    }
+    return 0;
+}
+
+bool codecDecompress(CompressionCodec codec, uint32_t dictionaryId,
+                     const void* src, size_t size,
+                     void* dst, size_t rawSize) {
+    switch (codec) {
+        case CompressionCodec::Lz4:
+        case CompressionCodec::Lz4Hc:
+            return LZ4_decompress_safe(static_cast<const char*>(src),
+                                       static_cast<char*>(dst), size,
+                                       rawSize) == (int)rawSize;
+        case CompressionCodec::Zstd: {
+#ifdef AEMU_BASE_USE_ZSTD
+            ZstdContexts& contexts = tZstdContexts;
+            if (!contexts.decompress) {
+                contexts.decompress = ZSTD_createDCtx();
+            }
+            size_t read;
+            if (dictionaryId) {
+                ZSTD_DDict* ddict =
+                        DictionaryRegistry::get().decompressionDict(dictionaryId);
+                if (!ddict) {
+                    return false;
+                }
+                read = ZSTD_decompress_usingDDict(contexts.decompress, dst,
+                                                  rawSize, src, size, ddict);
+            } else {
+                read = ZSTD_decompressDCtx(contexts.decompress, dst, rawSize,
+                                           src, size);
+            }
+            return read == rawSize;
+#else
+            break;
+#endif
+        }
+    }
+    return false;
+}
+
+}  // namespace base
+}  // namespace android
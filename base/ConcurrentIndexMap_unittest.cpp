@@ -0,0 +1,195 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/containers/ConcurrentIndexMap.h"
+
+#include "aemu/base/threads/FunctorThread.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace base {
+
+TEST(ConcurrentIndexMap, Basic) {
+    ConcurrentIndexMap<int> map;
+    EXPECT_EQ(nullptr, map.find(1));
+
+    auto res = map.emplace(1, 10);
+    EXPECT_TRUE(res.second);
+    EXPECT_EQ(10, *res.first);
+    res = map.emplace(1, 20);
+    EXPECT_FALSE(res.second);
+    EXPECT_EQ(10, *res.first);
+    EXPECT_EQ(10, *map.find(1));
+    EXPECT_EQ(1u, map.size());
+
+    EXPECT_TRUE(map.erase(1));
+    EXPECT_FALSE(map.erase(1));
+    EXPECT_EQ(nullptr, map.find(1));
+    EXPECT_TRUE(map.empty());
+}
+
+// Test: values don't move when the table grows, and erased slots don't hide
+// keys that probed past them.
+TEST(ConcurrentIndexMap, ManyEntries) {
+    ConcurrentIndexMap<uint64_t> map;
+    std::vector<uint64_t*> values;
+    for (uint64_t i = 0; i < 10000; ++i) {
+        values.push_back(map.emplace(i << 20, i).first);
+    }
+    for (uint64_t i = 0; i < 10000; i += 2) {
+        EXPECT_TRUE(map.erase(i << 20));
+    }
+    for (uint64_t i = 0; i < 10000; ++i) {
+        if (i % 2) {
+            EXPECT_EQ(values[i], map.find(i << 20));
+            EXPECT_EQ(i, *values[i]);
+        } else {
+            EXPECT_EQ(nullptr, map.find(i << 20));
+        }
+    }
+
+    size_t count = 0;
+    map.forEach([&count](uint64_t key, uint64_t& value) {
+        EXPECT_EQ(key, value << 20);
+        ++count;
+    });
+    EXPECT_EQ(5000u, count);
+
+    map.clear();
+    EXPECT_EQ(nullptr, map.find(1 << 20));
+    EpochReclaimer::get().reclaim();
+}
+
+// Test: readers look up keys while a writer keeps inserting, erasing and
+// growing the table.
+TEST(ConcurrentIndexMap, ConcurrentReaders) {
+    constexpr uint64_t kStableKeys = 256;
+    constexpr int kReaders = 4;
+
+    ConcurrentIndexMap<uint64_t> map;
+    for (uint64_t i = 0; i < kStableKeys; ++i) {
+        map.emplace(i, i * 3);
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> failures{0};
+    std::vector<std::unique_ptr<FunctorThread>> readers;
+    for (int t = 0; t < kReaders; ++t) {
+        readers.emplace_back(new FunctorThread([&map, &stop, &failures] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (uint64_t i = 0; i < kStableKeys; ++i) {
+                    const uint64_t* value = map.find(i);
+                    if (!value || *value != i * 3) {
+                        ++failures;
+                    }
+                }
+            }
+        }));
+        readers.back()->start();
+    }
+
+    for (uint64_t round = 0; round < 200; ++round) {
+        const uint64_t base = kStableKeys + round * 100;
+        for (uint64_t i = base; i < base + 100; ++i) {
+            map.emplace(i, i);
+        }
+        for (uint64_t i = base; i < base + 100; ++i) {
+            map.erase(i);
+        }
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader->wait();
+    }
+    EXPECT_EQ(0, failures.load());
+    EXPECT_EQ(kStableKeys, map.size());
+
+    EpochReclaimer::get().reclaim();
+    EXPECT_EQ(0u, EpochReclaimer::get().pendingCount());
+}
+
+// Test: memory retired while a reader is inside a ReadScope is only freed
+// after the scope closes.
+TEST(EpochReclaimer, WaitsForReaders) {
+    static std::atomic<int> freed{0};
+    auto deleter = [](void* ptr) {
+        delete static_cast<int*>(ptr);
+        ++freed;
+    };
+    freed = 0;
+
+    std::atomic<bool> entered{false};
+    std::atomic<bool> release{false};
+    FunctorThread reader([&entered, &release] {
+        EpochReclaimer::ReadScope scope;
+        entered = true;
+        while (!release) {
+        }
+    });
+    reader.start();
+    while (!entered) {
+    }
+
+    EpochReclaimer::get().retire(new int(1), deleter);
+    EpochReclaimer::get().reclaim();
+    EXPECT_EQ(0, freed.load());
+
+    release = true;
+    reader.wait();
+    EpochReclaimer::get().reclaim();
+    EXPECT_EQ(1, freed.load());
+}
+
+// Test: synchronize() returns only once a reader that was already inside a
+// ReadScope has left it.
+TEST(EpochReclaimer, SynchronizeWaitsForReaders) {
+    std::atomic<bool> entered{false};
+    std::atomic<bool> release{false};
+    std::atomic<bool> synchronized{false};
+    FunctorThread reader([&entered, &release] {
+        EpochReclaimer::ReadScope scope;
+        entered = true;
+        while (!release) {
+        }
+    });
+    reader.start();
+    while (!entered) {
+    }
+
+    FunctorThread writer([&synchronized] {
+        EpochReclaimer::get().synchronize();
+        synchronized = true;
+    });
+    writer.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(synchronized.load());
+
+    release = true;
+    reader.wait();
+    writer.wait();
+    EXPECT_TRUE(synchronized.load());
+
+    // Nobody is reading now, so this doesn't block.
+    EpochReclaimer::get().synchronize();
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,171 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/memory/ContiguousRangeMapper.h"
+
+#include "aemu/base/threads/ThreadPool.h"
+
+#include <algorithm>
+
+namespace android {
+namespace base {
+
+namespace {
+
+using Range = ContiguousRangeMapper::Range;
+
+// Below this many pieces a comparison sort is cheaper than the histograms.
+constexpr size_t kRadixSortThreshold = 64;
+
+// Sorts |ranges| by start address with an LSD radix sort, one byte per pass.
+// Passes over a byte that is the same in every start address are skipped,
+// which for pieces of one guest region leaves only two or three.
+void radixSortByStart(std::vector<Range>* ranges, std::vector<Range>* scratch) {
+    constexpr size_t kDigits = sizeof(uintptr_t);
+    const size_t count = ranges->size();
+
+    size_t histograms[kDigits][256] = {};
+    for (const Range& range : *ranges) {
+        for (size_t digit = 0; digit < kDigits; ++digit) {
+            ++histograms[digit][(range.start >> (digit * 8)) & 0xff];
+        }
+    }
+
+    scratch->resize(count);
+    Range* src = ranges->data();
+    Range* dst = scratch->data();
+    for (size_t digit = 0; digit < kDigits; ++digit) {
+        size_t* histogram = histograms[digit];
+        const unsigned shift = digit * 8;
+        if (histogram[(src[0].start >> shift) & 0xff] == count) {
+            continue;
+        }
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < 256; ++bucket) {
+            const size_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            dst[histogram[(src[i].start >> shift) & 0xff]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+    if (src != ranges->data()) {
+        ranges->swap(*scratch);
+    }
+}
+
+}  // namespace
+
+ContiguousRangeMapper::ContiguousRangeMapper(Func&& mapFunc,
+                                             uintptr_t batchSize,
+                                             int flushThreads)
+    : mMapFunc(std::move(mapFunc)), mBatchSize(batchSize) {
+    if (!flushThreads) {
+        return;
+    }
+    mPool = std::make_unique<ThreadPool<Range>>(
+            flushThreads,
+            [this](Range&& range) { mMapFunc(range.start, range.size); },
+            ThreadPoolScheduling::WorkStealing);
+    if (!mPool->start()) {
+        // Run mMapFunc on the calling thread instead.
+        mPool.reset();
+    }
+}
+
+ContiguousRangeMapper::~ContiguousRangeMapper() {
+    finish();
+}
+
+void ContiguousRangeMapper::add(uintptr_t start, uintptr_t size) {
+    if (mHasRange && mEnd == start) {
+        mEnd += size;
+    } else {
+        flushRange();
+        mHasRange = true;
+        mStart = start;
+        mEnd = start + size;
+    }
+
+    if (mBatchSize && mEnd - mStart >= mBatchSize) {
+        flushRange();
+    }
+}
+
+void ContiguousRangeMapper::addAll(const Range* ranges, size_t count) {
+    mSorted.assign(ranges, ranges + count);
+    auto byStart = [](const Range& a, const Range& b) {
+        return a.start < b.start;
+    };
+    if (!std::is_sorted(mSorted.begin(), mSorted.end(), byStart)) {
+        if (count < kRadixSortThreshold) {
+            std::sort(mSorted.begin(), mSorted.end(), byStart);
+        } else {
+            radixSortByStart(&mSorted, &mScratch);
+        }
+    }
+
+    size_t i = 0;
+    while (i < count) {
+        uintptr_t start = mSorted[i].start;
+        uintptr_t end = start + mSorted[i].size;
+        for (++i; i < count && mSorted[i].start <= end; ++i) {
+            end = std::max(end, mSorted[i].start + mSorted[i].size);
+        }
+
+        while (start < end) {
+            uintptr_t size = end - start;
+            if (mBatchSize) {
+                // add() flushes once the batch is full, so an outstanding
+                // range always leaves some room.
+                const uintptr_t used =
+                        mHasRange && mEnd == start ? mEnd - mStart : 0;
+                size = std::min(size, mBatchSize - used);
+            }
+            add(start, size);
+            start += size;
+        }
+    }
+}
+
+void ContiguousRangeMapper::finish() {
+    flushRange();
+    if (mPool) {
+        mPool->waitAllItems();
+    }
+}
+
+void ContiguousRangeMapper::flushRange() {
+    if (!mHasRange) {
+        return;
+    }
+    emit(mStart, mEnd - mStart);
+    mHasRange = false;
+    mStart = 0;
+    mEnd = 0;
+}
+
+void ContiguousRangeMapper::emit(uintptr_t start, uintptr_t size) {
+    if (mPool) {
+        mPool->enqueue({start, size});
+    } else {
+        mMapFunc(start, size);
+    }
+}
+
+}  // namespace base
+}  // namespace android
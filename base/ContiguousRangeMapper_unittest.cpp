@@ -12,10 +12,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include "android/base/ContiguousRangeMapper.h"
+#include "aemu/base/memory/ContiguousRangeMapper.h"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <utility>
 #include <vector>
 
 using android::base::ContiguousRangeMapper;
@@ -116,5 +120,97 @@ TEST(ContiguousRangeMapper, PagesBatched) {
     EXPECT_EQ(6, numTotalRanges);
 }
 
+// Tests that addAll() merges unsorted, overlapping and touching pieces.
+TEST(ContiguousRangeMapper, AddAllMerges) {
+    std::vector<ContiguousRangeMapper::Range> pieces = {
+        {0x7000, 0x1000}, {0x1000, 0x1000}, {0x3000, 0x1000},
+        {0x2000, 0x1800}, {0x5000, 0x2000}, {0xa000, 0},
+    };
+
+    std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+    ContiguousRangeMapper rm([&ranges](uintptr_t start, uintptr_t size) {
+        ranges.emplace_back(start, size);
+    });
+    rm.addAll(pieces.data(), pieces.size());
+    rm.finish();
+
+    std::vector<std::pair<uintptr_t, uintptr_t>> expected = {
+        {0x1000, 0x3000},
+        {0x5000, 0x3000},
+    };
+    EXPECT_EQ(expected, ranges);
+}
+
+// Tests that merged runs are cut at the batch size, including the part that
+// extends a range left outstanding by add().
+TEST(ContiguousRangeMapper, AddAllBatched) {
+    std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+    ContiguousRangeMapper rm(
+        [&ranges](uintptr_t start, uintptr_t size) {
+            ranges.emplace_back(start, size);
+        }, 0x4000);
+
+    std::vector<ContiguousRangeMapper::Range> pieces = {
+        {0x2000, 0x5000},
+    };
+    rm.add(0x1000, 0x1000);
+    rm.addAll(pieces.data(), pieces.size());
+    rm.finish();
+
+    std::vector<std::pair<uintptr_t, uintptr_t>> expected = {
+        {0x1000, 0x4000},
+        {0x5000, 0x2000},
+    };
+    EXPECT_EQ(expected, ranges);
+}
+
+// Tests the radix sort path on shuffled pages with a few gaps.
+TEST(ContiguousRangeMapper, AddAllShuffledPages) {
+    constexpr uintptr_t kBase = 0x7f1234560000;
+    std::vector<ContiguousRangeMapper::Range> pieces;
+    for (uintptr_t page = 0; page < 4096; ++page) {
+        if (page % 1000 == 999) continue;
+        pieces.push_back({kBase + page * 0x1000, 0x1000});
+    }
+    std::shuffle(pieces.begin(), pieces.end(), std::mt19937(1));
+
+    std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+    ContiguousRangeMapper rm([&ranges](uintptr_t start, uintptr_t size) {
+        ranges.emplace_back(start, size);
+    });
+    rm.addAll(pieces.data(), pieces.size());
+    rm.finish();
+
+    std::vector<std::pair<uintptr_t, uintptr_t>> expected = {
+        {kBase, 999 * 0x1000},
+        {kBase + 1000 * 0x1000, 999 * 0x1000},
+        {kBase + 2000 * 0x1000, 999 * 0x1000},
+        {kBase + 3000 * 0x1000, 999 * 0x1000},
+        {kBase + 4000 * 0x1000, 96 * 0x1000},
+    };
+    EXPECT_EQ(expected, ranges);
+}
+
+// Tests that finish() waits for ranges handed to flush threads.
+TEST(ContiguousRangeMapper, ParallelFlush) {
+    std::atomic<uintptr_t> total{0};
+    std::atomic<int> calls{0};
+    ContiguousRangeMapper rm(
+        [&total, &calls](uintptr_t start, uintptr_t size) {
+            total += size;
+            ++calls;
+        }, 0x10000, 4);
+
+    std::vector<ContiguousRangeMapper::Range> pieces;
+    for (uintptr_t page = 0; page < 1024; ++page) {
+        pieces.push_back({(1023 - page) * 0x1000, 0x1000});
+    }
+    rm.addAll(pieces.data(), pieces.size());
+    rm.finish();
+
+    EXPECT_EQ(1024u * 0x1000, total.load());
+    EXPECT_EQ(64, calls.load());
+}
+
 }  // namespace base
 }  // namespace android
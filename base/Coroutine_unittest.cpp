@@ -0,0 +1,225 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/async/Coroutine.h"
+
+#include <gtest/gtest.h>
+
+// Only built as C++20; the tests are empty otherwise.
+#if AEMU_BASE_HAS_COROUTINES
+
+#include "aemu/base/async/EventLooper.h"
+
+#include <string.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+// Runs |looper| until |scheduler| has no tasks left, or gives up.
+void runUntilDone(Looper* looper, const CoScheduler& scheduler) {
+    for (int i = 0; i < 1000 && scheduler.liveTasks(); ++i) {
+        looper->runWithTimeoutMs(10);
+    }
+}
+
+CoTask<int> add(int a, int b) {
+    co_return a + b;
+}
+
+CoTask<int> sum(int n) {
+    int total = 0;
+    for (int i = 0; i < n; ++i) {
+        total = co_await add(total, i);
+    }
+    co_return total;
+}
+
+// Tests that awaited tasks run to completion and hand back their results.
+TEST(Coroutine, NestedTasks) {
+    EventLooper looper;
+    CoScheduler scheduler(&looper);
+    int result = 0;
+    scheduler.spawn([](int* out) -> CoTask<void> {
+        *out = co_await sum(100);
+    }(&result));
+    EXPECT_EQ(1u, scheduler.liveTasks());
+    EXPECT_EQ(0, result);  // lazy
+    runUntilDone(&looper, scheduler);
+    EXPECT_EQ(0u, scheduler.liveTasks());
+    EXPECT_EQ(4950, result);
+}
+
+// Tests that many sleeping tasks share one looper thread and wake up in
+// deadline order.
+TEST(Coroutine, Sleep) {
+    EventLooper looper;
+    CoScheduler scheduler(&looper);
+    std::vector<int> woken;
+    constexpr int kTasks = 200;
+    for (int i = kTasks - 1; i >= 0; --i) {
+        scheduler.spawn([](Looper* looper, int id, std::vector<int>* woken)
+                                -> CoTask<void> {
+            co_await coSleep(looper, 1 + id / 50 * 5);
+            woken->push_back(id / 50);
+        }(&looper, i, &woken));
+    }
+    runUntilDone(&looper, scheduler);
+    ASSERT_EQ(size_t(kTasks), woken.size());
+    EXPECT_TRUE(std::is_sorted(woken.begin(), woken.end()));
+}
+
+// Tests that yield() lets other ready tasks run in between.
+TEST(Coroutine, Yield) {
+    EventLooper looper;
+    CoScheduler scheduler(&looper);
+    std::string trace;
+    for (char id : {'a', 'b'}) {
+        scheduler.spawn([](CoScheduler* scheduler, char id,
+                           std::string* trace) -> CoTask<void> {
+            for (int i = 0; i < 3; ++i) {
+                *trace += id;
+                co_await scheduler->yield();
+            }
+        }(&scheduler, id, &trace));
+    }
+    runUntilDone(&looper, scheduler);
+    EXPECT_EQ("ababab", trace);
+}
+
+// Tests that destroying the scheduler destroys suspended tasks and their
+// timers.
+TEST(Coroutine, DestroySuspended) {
+    EventLooper looper;
+    bool finished = false;
+    bool destroyed = false;
+    {
+        CoScheduler scheduler(&looper);
+        struct Flag {
+            bool* destroyed;
+            ~Flag() { *destroyed = true; }
+        };
+        scheduler.spawn([](Looper* looper, bool* finished,
+                           bool* destroyed) -> CoTask<void> {
+            Flag flag{destroyed};
+            co_await coSleep(looper, 60 * 1000);
+            *finished = true;
+        }(&looper, &finished, &destroyed));
+        looper.runWithTimeoutMs(10);
+        EXPECT_EQ(1u, scheduler.liveTasks());
+        EXPECT_FALSE(destroyed);
+    }
+    EXPECT_TRUE(destroyed);
+    EXPECT_FALSE(finished);
+    EXPECT_EQ(EWOULDBLOCK, looper.runWithTimeoutMs(10));
+}
+
+// An in-memory socket: recv() returns what the test pushed, or EAGAIN.
+class FakeSocket : public AsyncSocketAdapter {
+public:
+    void push(const std::string& data) {
+        mIncoming += data;
+        mListener->onRead(this);
+    }
+    void hangUp() { mListener->onClose(this, 0); }
+
+    ssize_t recv(char* buffer, uint64_t bufferSize) override {
+        if (mIncoming.empty()) {
+            errno = EAGAIN;
+            return -1;
+        }
+        const size_t n = std::min<size_t>(bufferSize, mIncoming.size());
+        memcpy(buffer, mIncoming.data(), n);
+        mIncoming.erase(0, n);
+        return n;
+    }
+    ssize_t send(const char* buffer, uint64_t bufferSize) override {
+        sent.append(buffer, bufferSize);
+        return bufferSize;
+    }
+    void close() override {}
+    bool connected() override { return true; }
+    bool connect() override { return true; }
+    bool connectSync(std::chrono::milliseconds) override { return true; }
+    void dispose() override {}
+
+    std::string sent;
+
+private:
+    std::string mIncoming;
+};
+
+// Tests that reads wait for data, echo works, and a hang-up ends the loop.
+TEST(Coroutine, SocketEcho) {
+    EventLooper looper;
+    CoScheduler scheduler(&looper);
+    FakeSocket socket;
+    scheduler.spawn([](AsyncSocketAdapter* socket) -> CoTask<void> {
+        CoSocket conn(socket);
+        char buf[4];
+        ssize_t n;
+        while ((n = co_await conn.read(buf)) > 0) {
+            conn.send({buf, size_t(n)});
+        }
+    }(&socket));
+    looper.runWithTimeoutMs(10);
+    EXPECT_EQ(1u, scheduler.liveTasks());
+
+    socket.push("hello");
+    socket.push(" world");
+    EXPECT_EQ("hello world", socket.sent);
+    EXPECT_EQ(1u, scheduler.liveTasks());
+
+    socket.hangUp();
+    EXPECT_EQ(0u, scheduler.liveTasks());
+}
+
+// Tests that a ring wait resumes once a producer thread has written
+// enough.
+TEST(Coroutine, RingReadable) {
+    EventLooper looper;
+    CoScheduler scheduler(&looper);
+    ring_buffer ring;
+    ring_buffer_init(&ring);
+    uint32_t received = 0;
+    scheduler.spawn([](Looper* looper, ring_buffer* ring,
+                       uint32_t* received) -> CoTask<void> {
+        co_await coRingReadable(looper, ring, nullptr, 8);
+        uint32_t values[2];
+        ring_buffer_read(ring, values, sizeof(values), 1);
+        *received = values[0] + values[1];
+    }(&looper, &ring, &received));
+    looper.runWithTimeoutMs(10);
+    EXPECT_EQ(1u, scheduler.liveTasks());
+
+    std::thread producer([&ring] {
+        const uint32_t values[2] = {20, 22};
+        ring_buffer_write(&ring, &values[0], 4, 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ring_buffer_write(&ring, &values[1], 4, 1);
+    });
+    runUntilDone(&looper, scheduler);
+    producer.join();
+    EXPECT_EQ(42u, received);
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
+
+#endif  // AEMU_BASE_HAS_COROUTINES
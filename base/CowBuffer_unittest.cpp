@@ -0,0 +1,94 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/containers/CowBuffer.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace android {
+namespace base {
+
+static std::string str(const uint8_t* data, size_t size) {
+    return std::string(reinterpret_cast<const char*>(data), size);
+}
+
+static std::string str(const CowBuffer& buffer) {
+    return str(buffer.data(), buffer.size());
+}
+
+static std::string str(const CowBuffer::View& view) {
+    return str(view.data(), view.size());
+}
+
+TEST(CowBuffer, Fifo) {
+    CowBuffer buffer;
+    EXPECT_TRUE(buffer.empty());
+    buffer.append("hello ", 6);
+    buffer.append("world", 5);
+    EXPECT_EQ("hello world", str(buffer));
+    buffer.consume(6);
+    EXPECT_EQ("world", str(buffer));
+    buffer.append("!", 1);
+    EXPECT_EQ("world!", str(buffer));
+    buffer.consume(100);
+    EXPECT_TRUE(buffer.empty());
+}
+
+// Tests that views keep their bytes while the owner moves on, and that
+// only appends copy.
+TEST(CowBuffer, ViewsAreImmutable) {
+    CowBuffer buffer;
+    buffer.append("abcdef", 6);
+    buffer.consume(1);
+    const uint8_t* before = buffer.data();
+
+    CowBuffer::View view = buffer.view();
+    EXPECT_TRUE(buffer.isShared());
+    EXPECT_EQ(before, view.data());
+
+    buffer.consume(2);
+    EXPECT_EQ(before + 2, buffer.data());
+    EXPECT_EQ("bcdef", str(view));
+
+    buffer.append("gh", 2);
+    EXPECT_FALSE(buffer.isShared());
+    EXPECT_EQ("defgh", str(buffer));
+    EXPECT_EQ("bcdef", str(view));
+
+    CowBuffer::View second = buffer.view();
+    buffer.clear();
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ("defgh", str(second));
+    view = CowBuffer::View();
+    EXPECT_TRUE(view.empty());
+}
+
+// Tests that a dropped view stops sharing, so the owner writes in place.
+TEST(CowBuffer, DroppedViews) {
+    CowBuffer buffer;
+    buffer.append("abcd", 4);
+    {
+        CowBuffer::View view = buffer.view();
+        EXPECT_TRUE(buffer.isShared());
+    }
+    EXPECT_FALSE(buffer.isShared());
+    buffer.consume(1);
+    buffer.append("e", 1);
+    EXPECT_EQ("bcde", str(buffer));
+}
+
+}  // namespace base
+}  // namespace android
@@ -14,40 +14,116 @@
 
 #include "aemu/base/files/DecompressingStream.h"
 
-#include "aemu/base/files/StreamSerializing.h"
+#include "aemu/base/Hash.h"
+#include "aemu/base/files/CompressingStream.h"
+#include "aemu/base/system/System.h"
+#include "aemu/base/threads/FunctorThread.h"
+#include "aemu/base/threads/ThreadPool.h"
 
 #include "lz4.h"
 
+#include <algorithm>
 #include <errno.h>
-#include <cassert>
+#include <limits>
+#include <string.h>
 
 namespace android {
 namespace base {
 
-DecompressingStream::DecompressingStream(Stream& input) {
+// The legacy window never shrinks below this, so that small reads don't each
+// go to |mInput|.
+static constexpr size_t kMinWindowSize = 64 * 1024;
+
+struct DecompressingStream::Block {
+    size_t index = 0;
+    uint32_t rawSize = 0;
+    uint64_t checksum = 0;
+    std::vector<char> compressed;
+    std::vector<char> decoded;
+    // Guarded by DecompressingStream::mLock.
+    bool done = false;
+    bool failed = false;
+};
+
+static bool readFully(Stream& input, void* buffer, size_t size) {
+    auto dst = static_cast<char*>(buffer);
+    while (size) {
+        const ssize_t res = input.read(dst, size);
+        if (res <= 0) {
+            return false;
+        }
+        dst += res;
+        size -= res;
+    }
+    return true;
+}
+
+static bool skipFully(Stream& input, size_t size) {
+    char scratch[4096];
+    while (size) {
+        const size_t chunk = std::min(size, sizeof(scratch));
+        if (!readFully(input, scratch, chunk)) {
+            return false;
+        }
+        size -= chunk;
+    }
+    return true;
+}
+
+DecompressingStream::DecompressingStream(Stream& input) : mInput(input) {
     mLzStream = reinterpret_cast<void *>(LZ4_createStreamDecode());
-    loadBuffer(&input, &mBuffer);
+    mInputRemaining = mInput.getBe32();
+}
+
+DecompressingStream::DecompressingStream(Stream& input, const BlockOptions& options)
+    : mInput(input), mBlockMode(true), mOptions(options) {
+    startBlocks();
 }
 
 DecompressingStream::~DecompressingStream() {
-    LZ4_freeStreamDecode((LZ4_streamDecode_t*)mLzStream);
+    if (!mBlockMode) {
+        skipFully(mInput, mInputRemaining);
+        LZ4_freeStreamDecode((LZ4_streamDecode_t*)mLzStream);
+        return;
+    }
+    if (mEndPosition >= 0) {
+        // Jump over whatever the reader didn't get to.
+        stopReader();
+        mInput.seekRead(mEndPosition);
+    } else if (mReader) {
+        // Let the reader run through the rest of the input without decoding
+        // it, then wait for the blocks already handed to the pool.
+        {
+            AutoLock lock(mLock);
+            mSkipBefore = std::numeric_limits<size_t>::max();
+            mRoomForBlock.broadcastAndUnlock(&lock);
+        }
+        mReader->wait();
+    }
+    if (mPool) {
+        mPool->done();
+        mPool->join();
+    }
 }
 
 ssize_t DecompressingStream::read(void* buffer, size_t size) {
-    assert(mBufferPos < mBuffer.size() ||
-           (mBufferPos == mBuffer.size() && size == 0));
+    if (mBlockMode) {
+        return readBlocks(buffer, size);
+    }
     if (!size) {
         return 0;
     }
+    if (!fillWindow(LZ4_compressBound(size))) {
+        return -EIO;
+    }
     int read = 0;
     read = LZ4_decompress_fast_continue(
-           (LZ4_streamDecode_t*)mLzStream, mBuffer.data() + mBufferPos,
+           (LZ4_streamDecode_t*)mLzStream, mWindow.data() + mWindowPos,
            (char*)buffer, size);
-    if (!read) {
+    if (read <= 0 || mWindowPos + read > mWindow.size()) {
         return -EIO;
     }
-    mBufferPos += read;
-    assert(mBufferPos <= mBuffer.size());
+    mWindowPos += read;
     return size;
 }
 
@@ -55,5 +131,334 @@ ssize_t DecompressingStream::write(const void*, size_t) {
     return -EPERM;
 }
 
+// Makes sure that at least |wanted| compressed bytes, or all that is left of
+// the buffer, follow mWindowPos in mWindow.
+bool DecompressingStream::fillWindow(size_t wanted) {
+    const size_t buffered = mWindow.size() - mWindowPos;
+    wanted = std::min(wanted, buffered + mInputRemaining);
+    if (buffered >= wanted) {
+        return true;
+    }
+    const size_t toRead =
+        std::min(mInputRemaining, std::max(wanted, kMinWindowSize) - buffered);
+    if (mWindowPos) {
+        memmove(mWindow.data(), mWindow.data() + mWindowPos, buffered);
+        mWindowPos = 0;
+    }
+    mWindow.resize(buffered + toRead);
+    if (!readFully(mInput, mWindow.data() + buffered, toRead)) {
+        mWindow.resize(buffered);
+        mInputRemaining = 0;
+        return false;
+    }
+    mInputRemaining -= toRead;
+    return true;
+}
+
+void DecompressingStream::startBlocks() {
+    const int64_t start = mInput.readPosition();
+    const uint32_t magic = mInput.getBe32();
+    if (magic != CompressingStream::kBlockFormatMagic &&
+        magic != CompressingStream::kCodecFormatMagic &&
+        magic != CompressingStream::kChecksumFormatMagic) {
+        mError = true;
+        return;
+    }
+    mBlockSize = mInput.getBe32();
+    if (!mBlockSize || mBlockSize > LZ4_MAX_INPUT_SIZE) {
+        mError = true;
+        return;
+    }
+    mChecksums = magic == CompressingStream::kChecksumFormatMagic;
+    if (magic != CompressingStream::kBlockFormatMagic) {
+        mCodec = static_cast<CompressionCodec>(mInput.getBe32());
+        mDictionaryId = mInput.getBe32();
+        // Also catches codecs from a newer version.
+        if (!isCodecAvailable(mCodec) ||
+            (mDictionaryId && !hasCompressionDictionary(mDictionaryId))) {
+            mError = true;
+            return;
+        }
+    }
+
+    if (start >= 0 && !indexBlocks(start)) {
+        mBlockOffsets.clear();
+        mEndPosition = -1;
+        mError = true;
+        return;
+    }
+
+    int threads = mOptions.threadCount > 0 ? mOptions.threadCount : getCpuCoreCount();
+    threads = std::max(threads, 1);
+    if (!mOptions.maxBlocksInFlight) {
+        mOptions.maxBlocksInFlight = 2 * threads;
+    }
+    mPool = std::make_unique<ThreadPool<Block*>>(
+        threads, [this](Block*&& block) { decodeBlock(block); });
+    if (!mPool->start()) {
+        // The reader thread decodes on its own instead.
+        mPool.reset();
+    }
+    startReader(0);
+}
+
+// |start| is where the format header began; the trailer's offsets are
+// relative to it.
+bool DecompressingStream::indexBlocks(int64_t start) {
+    const int64_t first = mInput.readPosition();
+    const uint32_t maxCompressedSize = codecCompressBound(mCodec, mBlockSize);
+    const int64_t headerSize = mChecksums ? 20 : 12;
+    for (int64_t pos = first;;) {
+        const uint32_t header = mInput.getBe32();
+        if (header == CompressingStream::kBlockFormatEnd) {
+            break;
+        }
+        const uint32_t rawSize = mInput.getBe32();
+        const uint32_t compressedSize = mInput.getBe32();
+        if (header != mBlockOffsets.size() || !rawSize || rawSize > mBlockSize ||
+            compressedSize > maxCompressedSize) {
+            return false;
+        }
+        mBlockOffsets.push_back(pos);
+        pos += headerSize + compressedSize;
+        if (!mInput.seekRead(pos)) {
+            return false;
+        }
+    }
+
+    if (mInput.getBe32() != mBlockOffsets.size()) {
+        return false;
+    }
+    for (int64_t offset : mBlockOffsets) {
+        if (mInput.getBe64() != uint64_t(offset - start)) {
+            return false;
+        }
+    }
+    mEndPosition = mInput.readPosition();
+    return mEndPosition >= 0 && mInput.seekRead(first);
+}
+
+void DecompressingStream::startReader(size_t firstIndex) {
+    mReader = std::make_unique<FunctorThread>(
+        [this, firstIndex] { readerLoop(firstIndex); });
+    if (!mReader->start()) {
+        mReader.reset();
+        AutoLock lock(mLock);
+        mError = true;
+    }
+}
+
+void DecompressingStream::stopReader() {
+    {
+        AutoLock lock(mLock);
+        mStopReader = true;
+        mRoomForBlock.broadcastAndUnlock(&lock);
+    }
+    if (mReader) {
+        mReader->wait();
+        mReader.reset();
+    }
+    AutoLock lock(mLock);
+    while (!mBlocks.empty()) {
+        popBlockLocked();
+    }
+    mCurrentPos = 0;
+    mStopReader = false;
+    mInputDone = false;
+}
+
+void DecompressingStream::readerLoop(size_t firstIndex) {
+    const uint32_t maxCompressedSize = codecCompressBound(mCodec, mBlockSize);
+    for (size_t index = firstIndex;; ++index) {
+        bool skip;
+        {
+            AutoLock lock(mLock);
+            mRoomForBlock.wait(&lock, [this, index] {
+                return mBlocks.size() < mOptions.maxBlocksInFlight ||
+                       index < mSkipBefore || mStopReader;
+            });
+            if (mStopReader) {
+                return;
+            }
+            skip = index < mSkipBefore;
+        }
+
+        const uint32_t header = mInput.getBe32();
+        if (header == CompressingStream::kBlockFormatEnd) {
+            // The trailing index is for readers that can seek in the
+            // underlying file; here it only serves as a consistency check.
+            const uint32_t count = mInput.getBe32();
+            bool ok = count == index;
+            for (uint32_t i = 0; ok && i < count; ++i) {
+                mInput.getBe64();
+            }
+            AutoLock lock(mLock);
+            mError |= !ok;
+            mInputDone = true;
+            mBlockReady.broadcastAndUnlock(&lock);
+            return;
+        }
+
+        auto block = std::make_unique<Block>();
+        block->index = index;
+        block->rawSize = mInput.getBe32();
+        const uint32_t compressedSize = mInput.getBe32();
+        if (mChecksums) {
+            block->checksum = mInput.getBe64();
+        }
+        bool ok = header == index && block->rawSize && block->rawSize <= mBlockSize &&
+                  compressedSize <= maxCompressedSize;
+        if (ok && skip) {
+            ok = skipFully(mInput, compressedSize);
+            if (ok) {
+                continue;
+            }
+        } else if (ok) {
+            block->compressed.resize(compressedSize);
+            ok = readFully(mInput, block->compressed.data(), compressedSize);
+        }
+        if (!ok) {
+            AutoLock lock(mLock);
+            mError = true;
+            mInputDone = true;
+            mBlockReady.broadcastAndUnlock(&lock);
+            return;
+        }
+
+        Block* blockPtr = block.get();
+        {
+            AutoLock lock(mLock);
+            mBlocks.push_back(std::move(block));
+            mBlockReady.broadcast();
+        }
+        if (mPool) {
+            mPool->enqueue(std::move(blockPtr));
+        } else {
+            decodeBlock(blockPtr);
+        }
+    }
+}
+
+void DecompressingStream::decodeBlock(Block* block) {
+    block->decoded.resize(block->rawSize);
+    bool ok = codecDecompress(mCodec, mDictionaryId, block->compressed.data(),
+                              block->compressed.size(), block->decoded.data(),
+                              block->rawSize);
+    block->compressed = std::vector<char>();
+    // Hashing the block that was just written is cheap next to decoding it,
+    // and happens on the same thread.
+    if (ok && mChecksums) {
+        ok = xxh3Hash64(block->decoded.data(), block->rawSize) == block->checksum;
+    }
+    AutoLock lock(mLock);
+    block->failed = !ok;
+    block->done = true;
+    mBlockReady.broadcastAndUnlock(&lock);
+}
+
+void DecompressingStream::popBlockLocked() {
+    Block* block = mBlocks.front().get();
+    mBlockReady.wait(&mLock, [block] { return block->done; });
+    mNextBlock = block->index + 1;
+    mBlocks.pop_front();
+    mRoomForBlock.broadcast();
+}
+
+bool DecompressingStream::seekToBlock(size_t index) {
+    if (!mBlockMode) {
+        return false;
+    }
+    if (mEndPosition >= 0) {
+        return seekToIndexedBlock(index);
+    }
+    AutoLock lock(mLock);
+    if (mError || index < mNextBlock) {
+        return false;
+    }
+    mCurrentPos = 0;
+    mSkipBefore = std::max(mSkipBefore, index);
+    mRoomForBlock.broadcast();
+    // The reader may still hand over a block it started on before it saw
+    // mSkipBefore, so keep dropping until the wanted one shows up.
+    for (;;) {
+        while (!mBlocks.empty() && mBlocks.front()->index < index) {
+            popBlockLocked();
+        }
+        if (!mBlocks.empty() || mInputDone) {
+            break;
+        }
+        mBlockReady.wait(&lock);
+    }
+    mNextBlock = index;
+    return !mError && !mBlocks.empty();
+}
+
+bool DecompressingStream::seekToIndexedBlock(size_t index) {
+    {
+        AutoLock lock(mLock);
+        if (mError || index >= mBlockOffsets.size()) {
+            return false;
+        }
+        // Blocks already read ahead are kept if the wanted one is among them.
+        if (!mBlocks.empty() && mBlocks.front()->index <= index &&
+            index <= mBlocks.back()->index) {
+            while (mBlocks.front()->index < index) {
+                popBlockLocked();
+            }
+            mCurrentPos = 0;
+            mNextBlock = index;
+            return true;
+        }
+    }
+    stopReader();
+    if (!mInput.seekRead(mBlockOffsets[index])) {
+        AutoLock lock(mLock);
+        mError = true;
+        return false;
+    }
+    {
+        AutoLock lock(mLock);
+        mNextBlock = index;
+    }
+    startReader(index);
+    return mReader != nullptr;
+}
+
+ssize_t DecompressingStream::readBlocks(void* buffer, size_t size) {
+    auto dst = static_cast<char*>(buffer);
+    size_t done = 0;
+    AutoLock lock(mLock);
+    while (done < size) {
+        mBlockReady.wait(&lock, [this] {
+            return mError || (mBlocks.empty() ? mInputDone : mBlocks.front()->done);
+        });
+        if (mError) {
+            return -EIO;
+        }
+        if (mBlocks.empty()) {
+            break;
+        }
+        if (mBlocks.front()->failed) {
+            mError = true;
+            mFailedBlock = mBlocks.front()->index;
+            return -EIO;
+        }
+        // The reader only appends, so the front block stays put while the
+        // lock is released.
+        Block* block = mBlocks.front().get();
+        const size_t chunk = std::min<size_t>(size - done, block->rawSize - mCurrentPos);
+        lock.unlock();
+        memcpy(dst + done, block->decoded.data() + mCurrentPos, chunk);
+        lock.lock();
+        done += chunk;
+        mCurrentPos += chunk;
+        if (mCurrentPos == block->rawSize) {
+            popBlockLocked();
+            mCurrentPos = 0;
+        }
+    }
+    return done;
+}
+
 }  // namespace base
 }  // namespace android
@@ -0,0 +1,484 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/network/Dns.h"
+
+#include "aemu/base/async/Looper.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/system/System.h"
+#include "aemu/base/threads/ThreadPool.h"
+
+#ifdef _WIN32
+#include "aemu/base/sockets/Winsock.h"
+#include <iphlpapi.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <list>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <errno.h>
+#include <string.h>
+
+namespace android {
+namespace base {
+
+namespace {
+
+// Upper bound on the number of names kept in the cache.
+constexpr size_t kMaxCacheEntries = 256;
+
+// Threads that run asynchronous queries.
+constexpr int kResolverThreads = 4;
+
+class SystemResolver : public Dns::Resolver {
+public:
+    SystemResolver() {
+#ifdef _WIN32
+        WSADATA data;
+        WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+    }
+
+    int resolveName(std::string_view server_name,
+                    Dns::AddressList* out) override {
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        // One socket type, or every address is listed once per type.
+        hints.ai_socktype = SOCK_STREAM;
+
+        addrinfo* res = nullptr;
+        const std::string name(server_name);
+        const int ret = getaddrinfo(name.c_str(), nullptr, &hints, &res);
+        if (ret != 0) {
+            return mapError(ret);
+        }
+
+        const size_t start = out->size();
+        for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+            IpAddress ip;
+            if (ai->ai_family == AF_INET) {
+                auto* sin = reinterpret_cast<const sockaddr_in*>(ai->ai_addr);
+                ip = IpAddress(ntohl(sin->sin_addr.s_addr));
+            } else if (ai->ai_family == AF_INET6) {
+                auto* sin6 =
+                        reinterpret_cast<const sockaddr_in6*>(ai->ai_addr);
+                ip = IpAddress(
+                        reinterpret_cast<const uint8_t*>(&sin6->sin6_addr),
+                        sin6->sin6_scope_id);
+            } else {
+                continue;
+            }
+            if (std::find(out->begin() + start, out->end(), ip) ==
+                out->end()) {
+                out->push_back(std::move(ip));
+            }
+        }
+        freeaddrinfo(res);
+        return out->size() > start ? 0 : -ENOENT;
+    }
+
+    int getSystemServerList(Dns::AddressList* out) override {
+#ifdef _WIN32
+        ULONG size = 0;
+        if (GetNetworkParams(nullptr, &size) != ERROR_BUFFER_OVERFLOW) {
+            return -EINVAL;
+        }
+        std::string buffer(size, '\0');
+        auto* info = reinterpret_cast<FIXED_INFO*>(&buffer[0]);
+        if (GetNetworkParams(info, &size) != ERROR_SUCCESS) {
+            return -EINVAL;
+        }
+        for (IP_ADDR_STRING* entry = &info->DnsServerList; entry;
+             entry = entry->Next) {
+            IpAddress ip(entry->IpAddress.String);
+            if (ip.valid()) {
+                out->push_back(std::move(ip));
+            }
+        }
+        return 0;
+#else
+        std::ifstream conf("/etc/resolv.conf");
+        if (!conf) {
+            return -ENOENT;
+        }
+        std::string line;
+        while (std::getline(conf, line)) {
+            std::istringstream words(line);
+            std::string keyword;
+            std::string address;
+            if (words >> keyword >> address && keyword == "nameserver") {
+                IpAddress ip(address);
+                if (ip.valid()) {
+                    out->push_back(std::move(ip));
+                }
+            }
+        }
+        return 0;
+#endif
+    }
+
+private:
+    static int mapError(int error) {
+        switch (error) {
+            case EAI_NONAME:
+#if defined(EAI_NODATA) && EAI_NODATA != EAI_NONAME
+            case EAI_NODATA:
+#endif
+                return -ENOENT;
+            case EAI_AGAIN:
+                return -EAGAIN;
+            case EAI_MEMORY:
+                return -ENOMEM;
+#ifdef EAI_SYSTEM
+            case EAI_SYSTEM:
+                return errno ? -errno : -EIO;
+#endif
+            default:
+                return -EINVAL;
+        }
+    }
+};
+
+struct Waiter {
+    Looper* looper;
+    Dns::ResolveCallback callback;
+};
+
+struct CacheEntry {
+    Dns::AddressList list;
+    uint64_t expiryUs = 0;
+    // Value of Cache::generation when the query was started.
+    uint64_t generation = 0;
+    bool pending = false;
+    std::vector<Waiter> waiters;
+    std::list<std::string>::iterator recency;
+};
+
+struct Cache {
+    Lock lock;
+    std::unordered_map<std::string, CacheEntry> entries;
+    // Most recently used name first.
+    std::list<std::string> recency;
+    uint64_t generation = 0;
+    Dns::Resolver* resolver = nullptr;
+};
+
+Cache& cache() {
+    static Cache* const sCache = new Cache();
+    return *sCache;
+}
+
+Dns::Resolver* currentResolverLocked(Cache& c) {
+    if (!c.resolver) {
+        static SystemResolver* const sSystem = new SystemResolver();
+        return sSystem;
+    }
+    return c.resolver;
+}
+
+void touchLocked(Cache& c, CacheEntry& entry) {
+    c.recency.splice(c.recency.begin(), c.recency, entry.recency);
+}
+
+CacheEntry& insertLocked(Cache& c, const std::string& name) {
+    auto result = c.entries.emplace(name, CacheEntry());
+    CacheEntry& entry = result.first->second;
+    if (result.second) {
+        c.recency.push_front(name);
+        entry.recency = c.recency.begin();
+    } else {
+        touchLocked(c, entry);
+    }
+    return entry;
+}
+
+void eraseLocked(Cache& c,
+                 std::unordered_map<std::string, CacheEntry>::iterator it) {
+    c.recency.erase(it->second.recency);
+    c.entries.erase(it);
+}
+
+void evictLocked(Cache& c) {
+    // Pending entries hold waiters and are never evicted, so the walk
+    // steps over them.
+    auto it = c.recency.end();
+    while (c.entries.size() > kMaxCacheEntries && it != c.recency.begin()) {
+        --it;
+        auto found = c.entries.find(*it);
+        if (found->second.pending) {
+            continue;
+        }
+        it = c.recency.erase(it);
+        c.entries.erase(found);
+    }
+}
+
+void storeLocked(Cache& c, CacheEntry& entry, Dns::AddressList list,
+                 uint32_t ttlSeconds) {
+    entry.list = std::move(list);
+    entry.expiryUs = getHighResTimeUs() + ttlSeconds * 1000000ULL;
+    entry.pending = false;
+}
+
+// Runs a query on the current thread, returning the ordered result and
+// how long it may be cached.
+Dns::AddressList query(Dns::Resolver* resolver, const std::string& name,
+                       uint32_t* ttlSeconds) {
+    Dns::AddressList list;
+    *ttlSeconds = 0;
+    if (resolver->resolveNameWithTtl(name, &list, ttlSeconds) < 0) {
+        list.clear();
+        *ttlSeconds = Dns::Resolver::kNegativeTtlSeconds;
+    }
+    Dns::interleaveAddressFamilies(&list);
+    return list;
+}
+
+void deliver(Waiter&& waiter, const Dns::AddressList& list) {
+    if (waiter.looper) {
+        waiter.looper->scheduleCallback(
+                [callback = std::move(waiter.callback), list]() {
+                    callback(list);
+                });
+    } else {
+        waiter.callback(list);
+    }
+}
+
+void runQuery(const std::string& name) {
+    Cache& c = cache();
+    Dns::Resolver* resolver;
+    {
+        AutoLock lock(c.lock);
+        resolver = currentResolverLocked(c);
+    }
+
+    uint32_t ttlSeconds;
+    Dns::AddressList list = query(resolver, name, &ttlSeconds);
+
+    std::vector<Waiter> waiters;
+    {
+        AutoLock lock(c.lock);
+        auto it = c.entries.find(name);
+        if (it == c.entries.end() || !it->second.pending) {
+            return;
+        }
+        waiters = std::move(it->second.waiters);
+        if (ttlSeconds && it->second.generation == c.generation) {
+            storeLocked(c, it->second, list, ttlSeconds);
+        } else {
+            eraseLocked(c, it);
+        }
+    }
+    for (auto& waiter : waiters) {
+        deliver(std::move(waiter), list);
+    }
+}
+
+// Answers the waiters of a query that can't run with an empty list.
+void failQuery(const std::string& name) {
+    Cache& c = cache();
+    std::vector<Waiter> waiters;
+    {
+        AutoLock lock(c.lock);
+        auto it = c.entries.find(name);
+        if (it == c.entries.end() || !it->second.pending) {
+            return;
+        }
+        waiters = std::move(it->second.waiters);
+        eraseLocked(c, it);
+    }
+    for (auto& waiter : waiters) {
+        deliver(std::move(waiter), {});
+    }
+}
+
+// Queries block in the system resolver, for seconds when a server times
+// out, so they run on threads of their own rather than on
+// BackgroundExecutor's few shared workers. Idle threads steal queued names
+// from busy ones, so one slow name doesn't hold up the others. Null if no
+// thread could be started.
+ThreadPool<std::string>* resolverThreads() {
+    static ThreadPool<std::string>* const sPool = [] {
+        auto* pool = new ThreadPool<std::string>(
+                kResolverThreads, [](std::string&& name) { runQuery(name); },
+                ThreadPoolScheduling::WorkStealing);
+        if (!pool->start()) {
+            delete pool;
+            return static_cast<ThreadPool<std::string>*>(nullptr);
+        }
+        return pool;
+    }();
+    return sPool;
+}
+
+}  // namespace
+
+int Dns::Resolver::resolveNameWithTtl(std::string_view server_name,
+                                      AddressList* out,
+                                      uint32_t* ttl_seconds) {
+    const int ret = resolveName(server_name, out);
+    if (ret == 0) {
+        *ttl_seconds = kDefaultTtlSeconds;
+    }
+    return ret;
+}
+
+// static
+Dns::Resolver* Dns::Resolver::get() {
+    Cache& c = cache();
+    AutoLock lock(c.lock);
+    return currentResolverLocked(c);
+}
+
+// static
+Dns::Resolver* Dns::Resolver::setForTesting(Resolver* resolver) {
+    Cache& c = cache();
+    Resolver* old;
+    {
+        AutoLock lock(c.lock);
+        old = c.resolver;
+        c.resolver = resolver;
+    }
+    clearCache();
+    return old;
+}
+
+// static
+Dns::AddressList Dns::resolveName(std::string_view server_name) {
+    Cache& c = cache();
+    const std::string name(server_name);
+    Resolver* resolver;
+    uint64_t generation;
+    {
+        AutoLock lock(c.lock);
+        auto it = c.entries.find(name);
+        if (it != c.entries.end() && !it->second.pending &&
+            it->second.expiryUs > getHighResTimeUs()) {
+            touchLocked(c, it->second);
+            return it->second.list;
+        }
+        resolver = currentResolverLocked(c);
+        generation = c.generation;
+    }
+
+    uint32_t ttlSeconds;
+    AddressList list = query(resolver, name, &ttlSeconds);
+
+    if (ttlSeconds) {
+        AutoLock lock(c.lock);
+        // A pending asynchronous query for the same name stores its own
+        // result when it completes.
+        auto it = c.entries.find(name);
+        if (generation == c.generation &&
+            (it == c.entries.end() || !it->second.pending)) {
+            storeLocked(c, insertLocked(c, name), list, ttlSeconds);
+            evictLocked(c);
+        }
+    }
+    return list;
+}
+
+// static
+void Dns::resolveNameAsync(std::string_view server_name,
+                           Looper* looper,
+                           ResolveCallback&& callback) {
+    Cache& c = cache();
+    const std::string name(server_name);
+    {
+        AutoLock lock(c.lock);
+        CacheEntry& entry = insertLocked(c, name);
+        if (entry.pending) {
+            entry.waiters.push_back({looper, std::move(callback)});
+            return;
+        }
+        if (entry.expiryUs > getHighResTimeUs()) {
+            AddressList list = entry.list;
+            lock.unlock();
+            deliver({looper, std::move(callback)}, list);
+            return;
+        }
+        entry.pending = true;
+        entry.generation = c.generation;
+        entry.waiters.push_back({looper, std::move(callback)});
+        evictLocked(c);
+    }
+
+    if (ThreadPool<std::string>* threads = resolverThreads()) {
+        threads->enqueue(std::string(name));
+    } else {
+        failQuery(name);
+    }
+}
+
+// static
+void Dns::interleaveAddressFamilies(AddressList* list) {
+    if (list->size() < 2) {
+        return;
+    }
+    const bool firstIsIpv6 = list->front().isIpv6();
+    AddressList primary;
+    AddressList secondary;
+    for (auto& ip : *list) {
+        (ip.isIpv6() == firstIsIpv6 ? primary : secondary)
+                .push_back(std::move(ip));
+    }
+    list->clear();
+    for (size_t i = 0; i < std::max(primary.size(), secondary.size()); ++i) {
+        if (i < primary.size()) {
+            list->push_back(std::move(primary[i]));
+        }
+        if (i < secondary.size()) {
+            list->push_back(std::move(secondary[i]));
+        }
+    }
+}
+
+// static
+void Dns::clearCache() {
+    Cache& c = cache();
+    AutoLock lock(c.lock);
+    ++c.generation;
+    for (auto it = c.entries.begin(); it != c.entries.end();) {
+        if (it->second.pending) {
+            ++it;
+        } else {
+            c.recency.erase(it->second.recency);
+            it = c.entries.erase(it);
+        }
+    }
+}
+
+// static
+Dns::AddressList Dns::getSystemServerList() {
+    AddressList list;
+    if (Resolver::get()->getSystemServerList(&list) < 0) {
+        list.clear();
+    }
+    return list;
+}
+
+}  // namespace base
+}  // namespace android
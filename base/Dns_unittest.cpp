@@ -0,0 +1,220 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/network/Dns.h"
+
+#include "aemu/base/async/Looper.h"
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/system/System.h"
+#include "aemu/base/testing/TestDnsResolver.h"
+#include "aemu/base/threads/BackgroundExecutor.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+
+namespace android {
+namespace base {
+
+namespace {
+
+// Counts queries and optionally holds them until release() is called.
+class CountingResolver : public TestDnsResolver {
+public:
+    int resolveNameWithTtl(std::string_view server_name,
+                           AddressList* out,
+                           uint32_t* ttl_seconds) override {
+        ++mQueries;
+        {
+            AutoLock lock(mLock);
+            mCv.wait(&lock, [this] { return !mHeld; });
+        }
+        const int ret = resolveName(server_name, out);
+        *ttl_seconds = mTtlSeconds;
+        return ret;
+    }
+
+    void hold() {
+        AutoLock lock(mLock);
+        mHeld = true;
+    }
+
+    void release() {
+        AutoLock lock(mLock);
+        mHeld = false;
+        mCv.broadcast();
+    }
+
+    int queries() const { return mQueries; }
+    void setTtlSeconds(uint32_t ttl) { mTtlSeconds = ttl; }
+
+private:
+    Lock mLock;
+    ConditionVariable mCv;
+    bool mHeld = false;
+    std::atomic<int> mQueries{0};
+    uint32_t mTtlSeconds = 60;
+};
+
+}  // namespace
+
+TEST(Dns, InterleaveAddressFamilies) {
+    const uint8_t v6a[16] = {0x20, 0x01, 0, 0, 0, 0, 0, 0,
+                             0,    0,    0, 0, 0, 0, 0, 1};
+    const uint8_t v6b[16] = {0x20, 0x01, 0, 0, 0, 0, 0, 0,
+                             0,    0,    0, 0, 0, 0, 0, 2};
+    Dns::AddressList list = {IpAddress(1u), IpAddress(2u), IpAddress(v6a),
+                             IpAddress(v6b), IpAddress(3u)};
+    Dns::interleaveAddressFamilies(&list);
+    const Dns::AddressList expected = {IpAddress(1u), IpAddress(v6a),
+                                       IpAddress(2u), IpAddress(v6b),
+                                       IpAddress(3u)};
+    EXPECT_EQ(expected, list);
+}
+
+TEST(Dns, ResolveNameIsCached) {
+    CountingResolver resolver;
+    resolver.addEntryIpv4("example.test", 0x0a000001);
+
+    Dns::AddressList list = Dns::resolveName("example.test");
+    ASSERT_EQ(1u, list.size());
+    EXPECT_EQ(0x0a000001u, list[0].ipv4());
+    EXPECT_EQ(list, Dns::resolveName("example.test"));
+    EXPECT_EQ(1, resolver.queries());
+
+    // Failures are cached too.
+    EXPECT_TRUE(Dns::resolveName("missing.test").empty());
+    EXPECT_TRUE(Dns::resolveName("missing.test").empty());
+    EXPECT_EQ(2, resolver.queries());
+
+    Dns::clearCache();
+    EXPECT_EQ(list, Dns::resolveName("example.test"));
+    EXPECT_EQ(3, resolver.queries());
+}
+
+TEST(Dns, ZeroTtlIsNotCached) {
+    CountingResolver resolver;
+    resolver.setTtlSeconds(0);
+    resolver.addEntryIpv4("example.test", 0x0a000001);
+
+    EXPECT_EQ(1u, Dns::resolveName("example.test").size());
+    EXPECT_EQ(1u, Dns::resolveName("example.test").size());
+    EXPECT_EQ(2, resolver.queries());
+}
+
+TEST(Dns, ResolveNameAsyncSharesQuery) {
+    CountingResolver resolver;
+    resolver.addEntryIpv4("example.test", 0x0a000001);
+    resolver.hold();
+
+    std::unique_ptr<Looper> looper(Looper::create());
+    // Keeps the loop alive while the queries run, and bounds the test.
+    std::unique_ptr<Looper::Timer> guard(looper->createTimer(
+            [](void* opaque, Looper::Timer*) {
+                ADD_FAILURE() << "Timed out";
+                static_cast<Looper*>(opaque)->forceQuit();
+            },
+            looper.get()));
+    guard->startRelative(5000);
+
+    int delivered = 0;
+    auto callback = [&delivered, &looper](const Dns::AddressList& list) {
+        EXPECT_TRUE(looper->onLooperThread());
+        EXPECT_EQ(1u, list.size());
+        if (++delivered == 3) {
+            looper->forceQuit();
+        }
+    };
+    for (int i = 0; i < 3; ++i) {
+        Dns::resolveNameAsync("example.test", looper.get(), callback);
+    }
+    resolver.release();
+    looper->runWithTimeoutMs(5000);
+    EXPECT_EQ(3, delivered);
+    EXPECT_EQ(1, resolver.queries());
+
+    // A cached answer still arrives through the looper.
+    delivered = 2;
+    Dns::resolveNameAsync("example.test", looper.get(), callback);
+    EXPECT_EQ(2, delivered);
+    looper->runWithTimeoutMs(5000);
+    EXPECT_EQ(3, delivered);
+    EXPECT_EQ(1, resolver.queries());
+}
+
+TEST(Dns, ResolveNameAsyncWithoutLooper) {
+    CountingResolver resolver;
+    resolver.addEntryIpv4("example.test", 0x0a000001);
+
+    Lock lock;
+    ConditionVariable cv;
+    bool done = false;
+    Dns::resolveNameAsync("example.test", nullptr,
+                          [&](const Dns::AddressList& list) {
+                              EXPECT_EQ(1u, list.size());
+                              AutoLock l(lock);
+                              done = true;
+                              cv.broadcast();
+                          });
+    {
+        AutoLock l(lock);
+        cv.wait(&l, [&done] { return done; });
+    }
+
+    // Cache hits run the callback before returning.
+    bool hit = false;
+    Dns::resolveNameAsync("example.test", nullptr,
+                          [&hit](const Dns::AddressList& list) {
+                              EXPECT_EQ(1u, list.size());
+                              hit = true;
+                          });
+    EXPECT_TRUE(hit);
+    EXPECT_EQ(1, resolver.queries());
+}
+
+// Tests that queries stuck in the resolver don't hold up the
+// BackgroundExecutor's shared workers.
+TEST(Dns, ResolveNameAsyncLeavesBackgroundExecutorFree) {
+    CountingResolver resolver;
+    resolver.hold();
+
+    Lock lock;
+    ConditionVariable cv;
+    int delivered = 0;
+    for (int i = 0; i < 8; ++i) {
+        Dns::resolveNameAsync("slow" + std::to_string(i) + ".test", nullptr,
+                              [&](const Dns::AddressList&) {
+                                  AutoLock l(lock);
+                                  ++delivered;
+                                  cv.broadcast();
+                              });
+    }
+
+    std::atomic<bool> ran{false};
+    ASSERT_TRUE(BackgroundExecutor::get().post([&ran] { ran = true; }));
+    for (int i = 0; i < 500 && !ran; ++i) {
+        sleepMs(10);
+    }
+    EXPECT_TRUE(ran);
+
+    resolver.release();
+    AutoLock l(lock);
+    cv.wait(&l, [&delivered] { return delivered == 8; });
+}
+
+}  // namespace base
+}  // namespace android
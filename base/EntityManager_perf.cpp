@@ -0,0 +1,103 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/containers/EntityManager.h"
+#include "aemu/base/containers/HybridEntityManager.h"
+
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+using BenchEM = EntityManager<32, 16, 16, int>;
+
+void BM_EntityManager_AddRemove(benchmark::State& state) {
+    BenchEM m;
+    for (auto _ : state) {
+        auto h = m.add(1, 1);
+        m.remove(h);
+    }
+}
+BENCHMARK(BM_EntityManager_AddRemove);
+
+void BM_EntityManager_Get(benchmark::State& state) {
+    const size_t count = size_t(state.range(0));
+    BenchEM m;
+    std::vector<BenchEM::EntityHandle> handles;
+    for (size_t i = 0; i < count; ++i) {
+        handles.push_back(m.add(int(i), 1));
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.get(handles[i]));
+        i = i + 1 == count ? 0 : i + 1;
+    }
+}
+BENCHMARK(BM_EntityManager_Get)->Arg(64)->Arg(64 * 1024);
+
+// Fill and drain, which exercises the free list.
+void BM_EntityManager_Churn(benchmark::State& state) {
+    constexpr size_t kCount = 1024;
+    BenchEM m;
+    std::vector<BenchEM::EntityHandle> handles(kCount);
+    for (auto _ : state) {
+        for (size_t i = 0; i < kCount; ++i) {
+            handles[i] = m.add(int(i), 1);
+        }
+        for (size_t i = 0; i < kCount; ++i) {
+            m.remove(handles[i]);
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * kCount);
+}
+BENCHMARK(BM_EntityManager_Churn);
+
+// Like BM_EntityManager_Churn, in one batch each way, as at scene load and
+// context teardown.
+void BM_EntityManager_ChurnMany(benchmark::State& state) {
+    constexpr size_t kCount = 1024;
+    BenchEM m;
+    std::vector<int> items(kCount);
+    std::vector<BenchEM::EntityHandle> handles(kCount);
+    for (auto _ : state) {
+        m.addMany(items.data(), kCount, 1, handles.data());
+        m.removeMany(handles.data(), kCount);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * kCount);
+}
+BENCHMARK(BM_EntityManager_ChurnMany);
+
+void BM_HybridEntityManager_Get(benchmark::State& state) {
+    const size_t count = size_t(state.range(0));
+    HybridEntityManager<1024, uint64_t, int> m;
+    std::vector<uint64_t> handles;
+    for (size_t i = 0; i < count; ++i) {
+        handles.push_back(m.add(int(i), 1));
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.get(handles[i]));
+        i = i + 1 == count ? 0 : i + 1;
+    }
+}
+// Past 1024 the handles spill into the locked map.
+BENCHMARK(BM_HybridEntityManager_Get)->Arg(512)->Arg(4096);
+
+}  // namespace
+}  // namespace base
+}  // namespace android
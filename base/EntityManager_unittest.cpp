@@ -0,0 +1,172 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/containers/EntityManager.h"
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+
+namespace android {
+namespace base {
+
+using TestEM = EntityManager<32, 16, 16, int>;
+using TestCM = ComponentManager<32, 16, 16, int>;
+using TestDenseCM = DenseComponentManager<32, 16, 16, int>;
+
+// Test: batch adds and removes behave like the single ones, and reuse freed
+// entries.
+TEST(EntityManager, AddRemoveMany) {
+    TestEM m;
+    m.reserve(1000);
+    const auto firstFree = m.nextFreeIndex();
+
+    std::vector<int> items(1000);
+    for (int i = 0; i < 1000; i++) items[i] = i;
+    std::vector<uint64_t> handles(items.size());
+    EXPECT_FALSE(m.addMany(items.data(), items.size(), 0, handles.data()));
+    ASSERT_TRUE(m.addMany(items.data(), items.size(), 1, handles.data()));
+    EXPECT_EQ(1000u, m.size());
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_NE(nullptr, m.get(handles[i]));
+        EXPECT_EQ(i, *m.get(handles[i]));
+        EXPECT_EQ(firstFree + i, TestEM::getHandleIndex(handles[i]));
+    }
+
+    // Every other one, plus a stale handle and a duplicate.
+    std::vector<uint64_t> removed;
+    for (int i = 0; i < 1000; i += 2) removed.push_back(handles[i]);
+    removed.push_back(handles[0]);
+    removed.push_back(TestEM::withGeneration(handles[1], 7));
+    m.removeMany(removed.data(), removed.size());
+    EXPECT_EQ(500u, m.size());
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(i % 2 == 1, m.isLive(handles[i])) << i;
+    }
+
+    // The freed entries come back in the order they were removed.
+    std::vector<uint64_t> again(3);
+    ASSERT_TRUE(m.addMany(items.data(), again.size(), 1, again.data()));
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(TestEM::getHandleIndex(handles[2 * i]),
+                  TestEM::getHandleIndex(again[i]));
+        EXPECT_NE(handles[2 * i], again[i]);
+    }
+    EXPECT_NE(INVALID_ENTITY_HANDLE, m.add(5, 1));
+    EXPECT_NE(INVALID_ENTITY_HANDLE, m.add(6, 1));
+    EXPECT_EQ(505u, m.size());
+
+    int live = 0;
+    m.forEachLiveEntry([&](bool, uint64_t, int&) { live++; });
+    EXPECT_EQ(505, live);
+}
+
+// Test: the templated and std::function iteration visit the same live
+// components.
+TEST(ComponentManager, ForEachLive) {
+    TestCM m;
+    std::vector<uint64_t> handles;
+    for (int i = 0; i < 300; i++) {
+        handles.push_back(m.add(1000 + i, i, 1));
+    }
+    for (int i = 0; i < 300; i += 3) {
+        m.removeByComponent(handles[i]);
+    }
+
+    int sum = 0;
+    int count = 0;
+    m.forEachLiveComponent([&](bool live, uint64_t, uint64_t entity, int& data) {
+        EXPECT_TRUE(live);
+        EXPECT_EQ(1000 + data, (int)entity);
+        sum += data;
+        count++;
+    });
+
+    int functionSum = 0;
+    TestCM::ConstComponentIteratorFunc func =
+        [&](bool, uint64_t, uint64_t, const int& data) { functionSum += data; };
+    m.forEachLiveComponent_const(func);
+
+    EXPECT_EQ(200, count);
+    EXPECT_EQ(sum, functionSum);
+}
+
+TEST(DenseComponentManager, Basic) {
+    TestDenseCM m;
+    uint64_t a = m.add(10, 1, 1, true /* tracked */);
+    uint64_t b = m.add(20, 2, 1);
+    uint64_t c = m.add(30, 3, 1, true /* tracked */);
+
+    EXPECT_EQ(3u, m.size());
+    EXPECT_EQ(1, *m.getByComponent(a));
+    EXPECT_EQ(2, *m.getByComponent(b));
+    EXPECT_EQ(3, *m.getByEntity(30));
+    EXPECT_EQ(20u, m.getEntityHandle(b));
+    EXPECT_EQ(c, m.getComponentHandle(30));
+    EXPECT_EQ((uint64_t)INVALID_COMPONENT_HANDLE, m.getComponentHandle(20));
+
+    m.removeByEntity(10);
+    EXPECT_EQ(nullptr, m.getByComponent(a));
+    EXPECT_EQ(nullptr, m.getByEntity(10));
+    EXPECT_EQ(2, *m.getByComponent(b));
+    EXPECT_EQ(3, *m.getByComponent(c));
+
+    // The freed index is reused with a new generation, so the old handle
+    // stays dead.
+    uint64_t d = m.add(40, 4, 1);
+    EXPECT_NE(a, d);
+    EXPECT_EQ(nullptr, m.getByComponent(a));
+    EXPECT_EQ(4, *m.getByComponent(d));
+
+    m.clear();
+    EXPECT_EQ(0u, m.size());
+    EXPECT_EQ(nullptr, m.getByComponent(b));
+    EXPECT_EQ(nullptr, m.getByEntity(30));
+}
+
+// Test: after many removals, iteration visits exactly the live components
+// and the packed arrays agree with handle lookups.
+TEST(DenseComponentManager, PackedIteration) {
+    TestDenseCM m;
+    std::vector<uint64_t> handles;
+    for (int i = 0; i < 1000; i++) {
+        handles.push_back(m.add(i, i, 1));
+    }
+    std::set<int> expected;
+    for (int i = 0; i < 1000; i++) {
+        if (i % 7 == 0) {
+            m.removeByComponent(handles[i]);
+        } else {
+            expected.insert(i);
+        }
+    }
+
+    std::set<int> seen;
+    m.forEachLiveComponent([&](bool live, uint64_t component, uint64_t entity, int& data) {
+        EXPECT_TRUE(live);
+        EXPECT_EQ(component, handles[data]);
+        EXPECT_EQ((uint64_t)data, entity);
+        seen.insert(data);
+    });
+    EXPECT_EQ(expected, seen);
+
+    ASSERT_EQ(expected.size(), m.size());
+    for (size_t i = 0; i < m.size(); i++) {
+        EXPECT_EQ(&m.data()[i], m.getByComponent(m.componentHandles()[i]));
+    }
+}
+
+}  // namespace base
+}  // namespace android
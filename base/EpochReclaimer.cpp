@@ -0,0 +1,197 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/synchronization/EpochReclaimer.h"
+
+#include <algorithm>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace android {
+namespace base {
+
+namespace {
+
+// retire() tries to free memory once this many pointers are waiting.
+constexpr size_t kReclaimBatch = 64;
+
+// Whether writers can make every running thread of the process execute a
+// full memory barrier, so that readers need none of their own.
+bool canFenceAllThreads() {
+#if defined(_WIN32)
+    return true;
+#elif defined(__linux__) && defined(__NR_membarrier)
+    const long commands = ::syscall(__NR_membarrier, MEMBARRIER_CMD_QUERY, 0);
+    return commands >= 0 && (commands & MEMBARRIER_CMD_PRIVATE_EXPEDITED) &&
+           ::syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0;
+#else
+    return false;
+#endif
+}
+
+// The calling thread's record. Trivial, so that reading it is a plain TLS
+// access; sThreadRecord below, touched once per thread, gives it back.
+thread_local EpochReclaimer::Record* tRecord = nullptr;
+
+// Gives the record back when the thread exits.
+struct ThreadRecord {
+    EpochReclaimer::Record* record = nullptr;
+    ~ThreadRecord() {
+        if (record) {
+            tRecord = nullptr;
+            record->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadRecord sThreadRecord;
+
+}  // namespace
+
+EpochReclaimer::EpochReclaimer() : mFenceAllThreads(canFenceAllThreads()) {}
+
+// static
+EpochReclaimer& EpochReclaimer::get() {
+    // Leaked: threads may still read during static destruction.
+    static EpochReclaimer* const sInstance = new EpochReclaimer();
+    return *sInstance;
+}
+
+EpochReclaimer::Record* EpochReclaimer::acquireRecord() {
+    for (Record* record = mRecords.load(std::memory_order_acquire); record;
+         record = record->next) {
+        bool inUse = false;
+        if (!record->inUse.load(std::memory_order_relaxed) &&
+            record->inUse.compare_exchange_strong(inUse, true,
+                                                  std::memory_order_acquire)) {
+            return record;
+        }
+    }
+    Record* record = new Record();
+    record->next = mRecords.load(std::memory_order_relaxed);
+    while (!mRecords.compare_exchange_weak(record->next, record,
+                                           std::memory_order_release)) {
+    }
+    return record;
+}
+
+// static
+EpochReclaimer::Record* EpochReclaimer::enterRead() {
+    EpochReclaimer& self = get();
+    Record* record = tRecord;
+    if (!record) {
+        record = tRecord = sThreadRecord.record = self.acquireRecord();
+    }
+    if (record->depth++) {
+        return record;
+    }
+    // Acquire pairs with the increment in retire(): a reader that sees the
+    // new epoch also sees everything unlinked before it.
+    record->epoch.store(self.mEpoch.load(std::memory_order_acquire),
+                        std::memory_order_relaxed);
+    // Pairs with fenceAllThreads() in reclaim() and synchronize(): either
+    // they see this record as reading, or this thread sees the pointers
+    // already unlinked. When they can fence this thread from the outside, it
+    // only has to keep the compiler from reordering.
+    if (self.mFenceAllThreads) {
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    } else {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+    return record;
+}
+
+void EpochReclaimer::retire(void* ptr, Deleter deleter) {
+    bool shouldReclaim;
+    {
+        AutoLock lock(mLock);
+        mRetired.push_back(
+            {ptr, deleter, mEpoch.fetch_add(1, std::memory_order_acq_rel)});
+        shouldReclaim = mRetired.size() >= kReclaimBatch;
+    }
+    if (shouldReclaim) {
+        reclaim();
+    }
+}
+
+void EpochReclaimer::reclaim() {
+    std::vector<Retired> freeable;
+    {
+        AutoLock lock(mLock);
+        fenceAllThreads();
+        uint64_t oldestReader = UINT64_MAX;
+        for (Record* record = mRecords.load(std::memory_order_acquire); record;
+             record = record->next) {
+            const uint64_t epoch = record->epoch.load(std::memory_order_acquire);
+            if (epoch) {
+                oldestReader = std::min(oldestReader, epoch);
+            }
+        }
+        // Anything retired before the oldest reader entered is unreachable.
+        auto unreachable = std::stable_partition(
+            mRetired.begin(), mRetired.end(),
+            [oldestReader](const Retired& r) { return r.epoch >= oldestReader; });
+        freeable.assign(unreachable, mRetired.end());
+        mRetired.erase(unreachable, mRetired.end());
+    }
+    // Outside the lock, in case a deleter retires more memory.
+    for (const Retired& r : freeable) {
+        r.deleter(r.ptr);
+    }
+}
+
+void EpochReclaimer::synchronize() {
+    // Readers that enter after this see the new epoch, and whatever the
+    // caller unlinked before it.
+    const uint64_t epoch = mEpoch.fetch_add(1, std::memory_order_acq_rel);
+    fenceAllThreads();
+    for (Record* record = mRecords.load(std::memory_order_acquire); record;
+         record = record->next) {
+        for (;;) {
+            const uint64_t seen = record->epoch.load(std::memory_order_acquire);
+            if (!seen || seen > epoch) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+    }
+}
+
+void EpochReclaimer::fenceAllThreads() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!mFenceAllThreads) {
+        return;
+    }
+#if defined(_WIN32)
+    ::FlushProcessWriteBuffers();
+#elif defined(__linux__) && defined(__NR_membarrier)
+    ::syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+#endif
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+size_t EpochReclaimer::pendingCount() {
+    AutoLock lock(mLock);
+    return mRetired.size();
+}
+
+}  // namespace base
+}  // namespace android
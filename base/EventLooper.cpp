@@ -0,0 +1,1080 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/async/EventLooper.h"
+
+#include "aemu/base/EintrWrapper.h"
+#include "aemu/base/system/System.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <errno.h>
+
+#ifdef _WIN32
+#include "aemu/base/sockets/Winsock.h"
+#elif defined(__APPLE__)
+#include <poll.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#include <unistd.h>
+#else
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace android {
+namespace base {
+
+// Timer expiry is aligned to at most this many milliseconds, however
+// large the slack.
+static constexpr Looper::Duration kMaxSlackAlign = Looper::Duration(1) << 16;
+
+class EventLooper::FdWatch : public Looper::FdWatch {
+public:
+    FdWatch(EventLooper* looper, int fd, Callback callback, void* opaque);
+    ~FdWatch() override;
+
+    EventLooper* eventLooper() const {
+        return static_cast<EventLooper*>(mLooper);
+    }
+
+    void addEvents(unsigned events) override;
+    void removeEvents(unsigned events) override;
+
+    unsigned poll() const override { return mReady & mWanted; }
+
+    // Called by the poller with the events the kernel reported.
+    void onReady(unsigned events);
+
+    unsigned mWanted = 0;
+    unsigned mReady = 0;
+    // Set when the descriptor cannot be polled (e.g. a regular file), which
+    // select() treats as always ready.
+    bool mAlwaysReady = false;
+    int mPollIndex = -1;
+
+    bool mQueued = false;
+    uint64_t mGeneration = 0;
+    FdWatch* mPrev = nullptr;
+    FdWatch* mNext = nullptr;
+
+    void fire(unsigned events) { mCallback(mOpaque, mFd, events); }
+};
+
+class EventLooper::Timer : public Looper::Timer {
+public:
+    Timer(EventLooper* looper, Callback callback, void* opaque,
+          ClockType clock);
+    ~Timer() override;
+
+    EventLooper* eventLooper() const {
+        return static_cast<EventLooper*>(mLooper);
+    }
+    TimerWheel& wheel() const {
+        return *eventLooper()->mWheels[static_cast<int>(mClockType)];
+    }
+
+    void startRelative(Duration timeoutMs) override;
+    void startAbsolute(Duration deadlineMs) override;
+    void stop() override;
+    bool isActive() const override { return mList >= 0; }
+
+    void save(Stream* stream) const override;
+    void load(Stream* stream) override;
+
+    void fire() { mCallback(mOpaque, this); }
+
+    // As requested by the owner.
+    Duration mDeadline = kDurationInfinite;
+    // When the wheel expires the timer: |mDeadline| rounded up within the
+    // slack.
+    Duration mExpiry = kDurationInfinite;
+    // Index of the TimerWheel list holding this timer, -1 when stopped.
+    int mList = -1;
+    Timer* mPrev = nullptr;
+    Timer* mNext = nullptr;
+};
+
+class EventLooper::Task : public Looper::Task {
+public:
+    Task(EventLooper* looper, Looper::Task::Callback&& callback,
+         bool selfDeleting = false)
+        : Looper::Task(looper, std::move(callback)),
+          mSelfDeleting(selfDeleting) {}
+    ~Task() override { cancel(); }
+
+    EventLooper* eventLooper() const {
+        return static_cast<EventLooper*>(mLooper);
+    }
+
+    void schedule() override;
+    void cancel() override;
+
+    void run() {
+        mCallback();
+        if (mSelfDeleting) {
+            delete this;
+        }
+    }
+
+    // Guarded by EventLooper::mTasksLock.
+    bool mScheduled = false;
+
+private:
+    const bool mSelfDeleting;
+};
+
+// Hierarchical timer wheel with millisecond ticks: four levels of 64 slots,
+// each level covering 64 times the span of the one below, for about 4.6
+// hours. Timers due further out sit in the last level and get re-filed when
+// it cascades. Start and stop are O(1); advancing visits one slot per tick
+// while the first level has timers and one per 64 ticks otherwise.
+class EventLooper::TimerWheel {
+public:
+    static constexpr int kBits = 6;
+    static constexpr int kSlots = 1 << kBits;
+    static constexpr int kLevels = 4;
+    static constexpr Duration kSpan = Duration(1) << (kBits * kLevels);
+
+    TimerWheel(EventLooper* looper, ClockType clock)
+        : mLooper(looper), mClock(clock) {}
+
+    ~TimerWheel() {
+        for (List& list : mLists) {
+            while (list.head) {
+                unlink(list.head);
+            }
+        }
+    }
+
+    bool empty() const { return mCount == 0; }
+    bool hasExpired() const { return mLists[kExpired].head != nullptr; }
+
+    void insert(Timer* timer) {
+        sync();
+        const Duration deadline = timer->mExpiry;
+        if (deadline == kDurationInfinite) {
+            link(kParked, timer);
+        } else if (deadline <= mCurrent) {
+            link(kExpired, timer);
+        } else {
+            link(slotFor(deadline), timer);
+        }
+    }
+
+    void remove(Timer* timer) {
+        if (timer->mList >= 0) {
+            unlink(timer);
+        }
+    }
+
+    // Moves timers due at |now| to the expired list, in deadline order.
+    void advance(Duration now) {
+        sync();
+        if (now <= mCurrent) {
+            return;
+        }
+        if (!mOccupied[0] && !mOccupied[1] && !mOccupied[2] &&
+            !mOccupied[3]) {
+            mCurrent = now;
+            return;
+        }
+        if (now - mCurrent >= Duration(kSlots) * kSlots) {
+            // A long stall (or a virtual clock jump): re-filing everything
+            // is cheaper than ticking through it.
+            List all;
+            for (int i = 0; i < kLevels * kSlots; ++i) {
+                while (Timer* timer = mLists[i].head) {
+                    unlink(timer);
+                    append(all, timer);
+                }
+            }
+            mCurrent = now;
+            refile(all);
+            return;
+        }
+        while (mCurrent < now) {
+            if (!mOccupied[0]) {
+                // Nothing to expire before the next cascade.
+                const Duration next = mCurrent | (kSlots - 1);
+                if (next >= now) {
+                    mCurrent = now;
+                    break;
+                }
+                mCurrent = next;
+            }
+            tick();
+        }
+    }
+
+    // Marks the expired timers as the ones to fire now; timers that expire
+    // while they run wait for the next pass.
+    void beginFiring() {
+        List& expired = mLists[kExpired];
+        while (Timer* timer = expired.head) {
+            unlink(timer);
+            link(kFiring, timer);
+        }
+    }
+
+    Timer* takeFiring() {
+        Timer* timer = mLists[kFiring].head;
+        if (timer) {
+            unlink(timer);
+        }
+        return timer;
+    }
+
+    // The earliest time at which a timer is due or a cascade has to run,
+    // or kDurationInfinite.
+    Duration nextDeadline() const {
+        if (hasExpired()) {
+            return mCurrent;
+        }
+        Duration next = kDurationInfinite;
+        for (int level = 0; level < kLevels; ++level) {
+            const uint64_t occupied = mOccupied[level];
+            if (!occupied) {
+                continue;
+            }
+            const int shift = kBits * level;
+            const Duration base = mCurrent >> shift;
+            const int from = static_cast<int>((base + 1) & (kSlots - 1));
+            const int offset = 1 + ctz(rotr(occupied, from));
+            next = std::min(next, (base + offset) << shift);
+        }
+        return next;
+    }
+
+private:
+    struct List {
+        Timer* head = nullptr;
+        Timer* tail = nullptr;
+    };
+
+    static constexpr int kExpired = kLevels * kSlots;
+    static constexpr int kFiring = kExpired + 1;
+    static constexpr int kParked = kExpired + 2;
+    static constexpr int kListCount = kExpired + 3;
+
+    static uint64_t rotr(uint64_t value, int count) {
+        return count ? (value >> count) | (value << (64 - count)) : value;
+    }
+
+    static int ctz(uint64_t value) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+
+    // Starts the wheel at the clock's current time on first use, since the
+    // clock may be virtual and overridden by a subclass.
+    void sync() {
+        if (!mStarted) {
+            mCurrent = mLooper->nowMs(mClock);
+            mStarted = true;
+        }
+    }
+
+    int slotFor(Duration deadline) const {
+        const Duration delta = deadline - mCurrent;
+        for (int level = 0; level < kLevels - 1; ++level) {
+            const int shift = kBits * (level + 1);
+            if (delta < (Duration(1) << shift)) {
+                return level * kSlots +
+                       static_cast<int>((deadline >> (kBits * level)) &
+                                        (kSlots - 1));
+            }
+        }
+        const Duration capped = std::min(deadline, mCurrent + kSpan - 1);
+        const int shift = kBits * (kLevels - 1);
+        return (kLevels - 1) * kSlots +
+               static_cast<int>((capped >> shift) & (kSlots - 1));
+    }
+
+    void tick() {
+        ++mCurrent;
+        for (int level = 1; level < kLevels; ++level) {
+            if ((mCurrent >> (kBits * (level - 1))) & (kSlots - 1)) {
+                break;
+            }
+            cascade(level);
+        }
+        List& slot = mLists[mCurrent & (kSlots - 1)];
+        while (Timer* timer = slot.head) {
+            unlink(timer);
+            link(kExpired, timer);
+        }
+    }
+
+    // Re-files the timers of the slot that the current tick just entered.
+    void cascade(int level) {
+        const int index =
+                level * kSlots +
+                static_cast<int>((mCurrent >> (kBits * level)) & (kSlots - 1));
+        List pending;
+        while (Timer* timer = mLists[index].head) {
+            unlink(timer);
+            append(pending, timer);
+        }
+        refile(pending);
+    }
+
+    void refile(List& list) {
+        while (Timer* timer = list.head) {
+            list.head = timer->mNext;
+            timer->mPrev = timer->mNext = nullptr;
+            insert(timer);
+        }
+        list.tail = nullptr;
+    }
+
+    // Chains a detached timer on a scratch list without touching counts.
+    static void append(List& list, Timer* timer) {
+        timer->mNext = nullptr;
+        timer->mPrev = list.tail;
+        if (list.tail) {
+            list.tail->mNext = timer;
+        } else {
+            list.head = timer;
+        }
+        list.tail = timer;
+    }
+
+    void link(int index, Timer* timer) {
+        append(mLists[index], timer);
+        timer->mList = index;
+        if (index < kExpired) {
+            mOccupied[index / kSlots] |= uint64_t(1) << (index % kSlots);
+        }
+        ++mCount;
+    }
+
+    void unlink(Timer* timer) {
+        const int index = timer->mList;
+        List& list = mLists[index];
+        (timer->mPrev ? timer->mPrev->mNext : list.head) = timer->mNext;
+        (timer->mNext ? timer->mNext->mPrev : list.tail) = timer->mPrev;
+        timer->mPrev = timer->mNext = nullptr;
+        timer->mList = -1;
+        if (index < kExpired && !list.head) {
+            mOccupied[index / kSlots] &= ~(uint64_t(1) << (index % kSlots));
+        }
+        --mCount;
+    }
+
+    EventLooper* const mLooper;
+    const ClockType mClock;
+    bool mStarted = false;
+    // Every tick up to and including this one has been processed.
+    Duration mCurrent = 0;
+    size_t mCount = 0;
+    uint64_t mOccupied[kLevels] = {};
+    List mLists[kListCount];
+};
+
+//
+//  P O L L E R
+//
+
+#if defined(_WIN32)
+
+// WSAPoll is level-triggered and has no wakeup handle of its own, so the
+// first entry of the poll set is a loopback UDP socket that wake() sends a
+// datagram to. If the socket can't be set up, waits are capped instead, so
+// tasks scheduled from other threads still run soon.
+struct EventLooper::Poller {
+    static constexpr bool kEdgeTriggered = false;
+    static constexpr int kMaxWaitWithoutWakeMs = 10;
+
+    std::vector<WSAPOLLFD> fds;
+    // Null for the wake socket.
+    std::vector<FdWatch*> watches;
+    SOCKET wakeSocket = INVALID_SOCKET;
+    sockaddr_in wakeAddress = {};
+
+    Poller() {
+        WSADATA data;
+        WSAStartup(MAKEWORD(2, 2), &data);
+        wakeSocket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (wakeSocket == INVALID_SOCKET) {
+            return;
+        }
+        wakeAddress.sin_family = AF_INET;
+        wakeAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int addressSize = sizeof(wakeAddress);
+        u_long nonBlocking = 1;
+        if (::bind(wakeSocket, reinterpret_cast<const sockaddr*>(&wakeAddress),
+                   sizeof(wakeAddress)) != 0 ||
+            ::getsockname(wakeSocket, reinterpret_cast<sockaddr*>(&wakeAddress),
+                          &addressSize) != 0 ||
+            ::ioctlsocket(wakeSocket, FIONBIO, &nonBlocking) != 0) {
+            ::closesocket(wakeSocket);
+            wakeSocket = INVALID_SOCKET;
+            return;
+        }
+        WSAPOLLFD pfd = {};
+        pfd.fd = wakeSocket;
+        pfd.events = POLLRDNORM;
+        fds.push_back(pfd);
+        watches.push_back(nullptr);
+    }
+
+    ~Poller() {
+        if (wakeSocket != INVALID_SOCKET) {
+            ::closesocket(wakeSocket);
+        }
+        WSACleanup();
+    }
+
+    bool add(FdWatch* watch) {
+        watch->mPollIndex = static_cast<int>(fds.size());
+        WSAPOLLFD pfd = {};
+        pfd.fd = static_cast<SOCKET>(watch->fd());
+        fds.push_back(pfd);
+        watches.push_back(watch);
+        return true;
+    }
+
+    void remove(FdWatch* watch) {
+        const int index = watch->mPollIndex;
+        if (index < 0) {
+            return;
+        }
+        fds[index] = fds.back();
+        watches[index] = watches.back();
+        watches[index]->mPollIndex = index;
+        fds.pop_back();
+        watches.pop_back();
+        watch->mPollIndex = -1;
+    }
+
+    void update(FdWatch* watch) {
+        if (watch->mPollIndex < 0) {
+            return;
+        }
+        SHORT events = 0;
+        if (watch->mWanted & FdWatch::kEventRead) events |= POLLRDNORM;
+        if (watch->mWanted & FdWatch::kEventWrite) events |= POLLWRNORM;
+        fds[watch->mPollIndex].events = events;
+    }
+
+    void wait(int timeoutMs) {
+        if (wakeSocket == INVALID_SOCKET &&
+            (timeoutMs < 0 || timeoutMs > kMaxWaitWithoutWakeMs)) {
+            timeoutMs = kMaxWaitWithoutWakeMs;
+        }
+        if (fds.empty()) {
+            if (timeoutMs != 0) {
+                ::Sleep(timeoutMs < 0 ? INFINITE
+                                      : static_cast<DWORD>(timeoutMs));
+            }
+            return;
+        }
+        if (WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), timeoutMs) <=
+            0) {
+            return;
+        }
+        for (size_t i = 0; i < fds.size(); ++i) {
+            const SHORT revents = fds[i].revents;
+            if (!revents) {
+                continue;
+            }
+            unsigned events = 0;
+            if (revents & (POLLRDNORM | POLLHUP | POLLERR)) {
+                events |= FdWatch::kEventRead;
+            }
+            if (revents & (POLLWRNORM | POLLHUP | POLLERR)) {
+                events |= FdWatch::kEventWrite;
+            }
+            fds[i].revents = 0;
+            if (!watches[i]) {
+                char buffer[64];
+                while (::recv(wakeSocket, buffer, sizeof(buffer), 0) > 0) {
+                }
+                continue;
+            }
+            watches[i]->onReady(events);
+        }
+    }
+
+    void wake() {
+        if (wakeSocket == INVALID_SOCKET) {
+            return;
+        }
+        // If the socket's buffer is full, a wake is pending anyway.
+        const char byte = 0;
+        ::sendto(wakeSocket, &byte, 1, 0, reinterpret_cast<const sockaddr*>(&wakeAddress),
+                 sizeof(wakeAddress));
+    }
+
+    unsigned probe(FdWatch*, unsigned) { return 0; }
+};
+
+#else  // !_WIN32
+
+struct EventLooper::Poller {
+    static constexpr bool kEdgeTriggered = true;
+    static constexpr int kMaxEvents = 64;
+
+    void update(FdWatch*) {}
+
+    // Re-checks |events| on a descriptor whose callback just ran. Edge
+    // notifications stop once the kernel has reported readiness, so this
+    // is what keeps partially drained descriptors firing.
+    unsigned probe(FdWatch* watch, unsigned events) {
+        if (watch->mAlwaysReady) {
+            return events;
+        }
+        struct pollfd pfd = {};
+        pfd.fd = watch->fd();
+        if (events & FdWatch::kEventRead) pfd.events |= POLLIN;
+        if (events & FdWatch::kEventWrite) pfd.events |= POLLOUT;
+        if (HANDLE_EINTR(::poll(&pfd, 1, 0)) <= 0) {
+            return 0;
+        }
+        unsigned ready = 0;
+        if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+            ready |= FdWatch::kEventRead;
+        }
+        if (pfd.revents & (POLLOUT | POLLHUP | POLLERR)) {
+            ready |= FdWatch::kEventWrite;
+        }
+        return ready & events;
+    }
+
+#if defined(__APPLE__)
+    int kq = -1;
+
+    Poller() {
+        kq = ::kqueue();
+        struct kevent change;
+        EV_SET(&change, 0, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+        ::kevent(kq, &change, 1, nullptr, 0, nullptr);
+    }
+
+    ~Poller() { ::close(kq); }
+
+    bool add(FdWatch* watch) {
+        struct kevent change;
+        EV_SET(&change, watch->fd(), EVFILT_READ, EV_ADD | EV_CLEAR, 0, 0,
+               watch);
+        if (::kevent(kq, &change, 1, nullptr, 0, nullptr) < 0) {
+            return false;
+        }
+        // Some descriptors only support reads; those never report write.
+        EV_SET(&change, watch->fd(), EVFILT_WRITE, EV_ADD | EV_CLEAR, 0, 0,
+               watch);
+        ::kevent(kq, &change, 1, nullptr, 0, nullptr);
+        return true;
+    }
+
+    void remove(FdWatch* watch) {
+        struct kevent changes[2];
+        EV_SET(&changes[0], watch->fd(), EVFILT_READ, EV_DELETE, 0, 0,
+               nullptr);
+        EV_SET(&changes[1], watch->fd(), EVFILT_WRITE, EV_DELETE, 0, 0,
+               nullptr);
+        ::kevent(kq, &changes[0], 1, nullptr, 0, nullptr);
+        ::kevent(kq, &changes[1], 1, nullptr, 0, nullptr);
+    }
+
+    void wait(int timeoutMs) {
+        struct kevent events[kMaxEvents];
+        struct timespec ts;
+        struct timespec* tsp = nullptr;
+        if (timeoutMs >= 0) {
+            ts.tv_sec = timeoutMs / 1000;
+            ts.tv_nsec = (timeoutMs % 1000) * 1000000L;
+            tsp = &ts;
+        }
+        const int count = ::kevent(kq, nullptr, 0, events, kMaxEvents, tsp);
+        for (int i = 0; i < count; ++i) {
+            if (events[i].filter == EVFILT_USER) {
+                continue;
+            }
+            auto watch = static_cast<FdWatch*>(events[i].udata);
+            watch->onReady(events[i].filter == EVFILT_WRITE
+                                   ? FdWatch::kEventWrite
+                                   : FdWatch::kEventRead);
+        }
+    }
+
+    void wake() {
+        struct kevent change;
+        EV_SET(&change, 0, EVFILT_USER, 0, NOTE_TRIGGER, 0, nullptr);
+        ::kevent(kq, &change, 1, nullptr, 0, nullptr);
+    }
+#else   // Linux
+    int epfd = -1;
+    int wakeFd = -1;
+
+    Poller() {
+        epfd = ::epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+        ::epoll_ctl(epfd, EPOLL_CTL_ADD, wakeFd, &event);
+    }
+
+    ~Poller() {
+        ::close(wakeFd);
+        ::close(epfd);
+    }
+
+    bool add(FdWatch* watch) {
+        struct epoll_event event = {};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = watch;
+        return ::epoll_ctl(epfd, EPOLL_CTL_ADD, watch->fd(), &event) == 0;
+    }
+
+    // Fails harmlessly if the descriptor was already closed, which removes
+    // it from the epoll set unless it was duplicated.
+    void remove(FdWatch* watch) {
+        if (watch->mAlwaysReady) {
+            return;
+        }
+        struct epoll_event event = {};
+        ::epoll_ctl(epfd, EPOLL_CTL_DEL, watch->fd(), &event);
+    }
+
+    void wait(int timeoutMs) {
+        struct epoll_event events[kMaxEvents];
+        const int count = ::epoll_wait(epfd, events, kMaxEvents, timeoutMs);
+        for (int i = 0; i < count; ++i) {
+            auto watch = static_cast<FdWatch*>(events[i].data.ptr);
+            if (!watch) {
+                uint64_t value;
+                (void)::read(wakeFd, &value, sizeof(value));
+                continue;
+            }
+            const uint32_t ev = events[i].events;
+            unsigned ready = 0;
+            if (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                ready |= FdWatch::kEventRead;
+            }
+            if (ev & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+                ready |= FdWatch::kEventWrite;
+            }
+            watch->onReady(ready);
+        }
+    }
+
+    void wake() {
+        const uint64_t value = 1;
+        (void)::write(wakeFd, &value, sizeof(value));
+    }
+#endif  // Linux
+};
+
+#endif  // !_WIN32
+
+//
+//  F D   W A T C H E S
+//
+
+EventLooper::FdWatch::FdWatch(EventLooper* looper,
+                              int fd,
+                              Callback callback,
+                              void* opaque)
+    : Looper::FdWatch(looper, fd, callback, opaque) {
+    if (!looper->mPoller->add(this)) {
+        mAlwaysReady = true;
+        mReady = kEventMask;
+    }
+    ++looper->mFdWatchCount;
+}
+
+EventLooper::FdWatch::~FdWatch() {
+    EventLooper* looper = eventLooper();
+    looper->unqueueFdWatch(this);
+    if (looper->mFiring == this) {
+        looper->mFiring = nullptr;
+    }
+    looper->mPoller->remove(this);
+    --looper->mFdWatchCount;
+}
+
+void EventLooper::FdWatch::addEvents(unsigned events) {
+    mWanted |= events & kEventMask;
+    eventLooper()->mPoller->update(this);
+    if (mReady & mWanted) {
+        eventLooper()->queueFdWatch(this);
+    }
+}
+
+void EventLooper::FdWatch::removeEvents(unsigned events) {
+    mWanted &= ~events;
+    eventLooper()->mPoller->update(this);
+    if (!Poller::kEdgeTriggered) {
+        // Level-triggered readiness is reported again when wanted.
+        mReady &= mWanted;
+    }
+    if (!(mReady & mWanted)) {
+        eventLooper()->unqueueFdWatch(this);
+    }
+}
+
+void EventLooper::FdWatch::onReady(unsigned events) {
+    mReady |= events;
+    if (mReady & mWanted) {
+        eventLooper()->queueFdWatch(this);
+    }
+}
+
+void EventLooper::queueFdWatch(FdWatch* watch) {
+    if (watch->mQueued) {
+        return;
+    }
+    watch->mQueued = true;
+    watch->mGeneration = mFireGeneration;
+    watch->mNext = nullptr;
+    watch->mPrev = mPendingTail;
+    (mPendingTail ? mPendingTail->mNext : mPendingHead) = watch;
+    mPendingTail = watch;
+}
+
+void EventLooper::unqueueFdWatch(FdWatch* watch) {
+    if (!watch->mQueued) {
+        return;
+    }
+    (watch->mPrev ? watch->mPrev->mNext : mPendingHead) = watch->mNext;
+    (watch->mNext ? watch->mNext->mPrev : mPendingTail) = watch->mPrev;
+    watch->mPrev = watch->mNext = nullptr;
+    watch->mQueued = false;
+}
+
+void EventLooper::fireFdWatches() {
+    const uint64_t generation = ++mFireGeneration;
+    while (FdWatch* watch = mPendingHead) {
+        if (watch->mGeneration == generation) {
+            // Queued by a callback in this pass.
+            break;
+        }
+        unqueueFdWatch(watch);
+        const unsigned events = watch->mReady & watch->mWanted;
+        if (!events) {
+            continue;
+        }
+        mFiring = watch;
+        watch->fire(events);
+        if (mFiring != watch) {
+            // Deleted by its callback.
+            continue;
+        }
+        mFiring = nullptr;
+        if (Poller::kEdgeTriggered) {
+            watch->mReady = (watch->mReady & ~events) |
+                            mPoller->probe(watch, events);
+        } else {
+            watch->mReady &= ~events;
+        }
+        if (watch->mReady & watch->mWanted) {
+            queueFdWatch(watch);
+        }
+    }
+}
+
+Looper::FdWatch* EventLooper::createFdWatch(int fd,
+                                            Looper::FdWatch::Callback callback,
+                                            void* opaque) {
+    return new FdWatch(this, fd, callback, opaque);
+}
+
+//
+//  T I M E R S
+//
+
+EventLooper::Timer::Timer(EventLooper* looper,
+                          Callback callback,
+                          void* opaque,
+                          ClockType clock)
+    : Looper::Timer(looper, callback, opaque, clock) {}
+
+EventLooper::Timer::~Timer() {
+    stop();
+}
+
+void EventLooper::Timer::startRelative(Duration timeoutMs) {
+    if (timeoutMs != kDurationInfinite) {
+        timeoutMs += mLooper->nowMs(mClockType);
+    }
+    startAbsolute(timeoutMs);
+}
+
+void EventLooper::Timer::startAbsolute(Duration deadlineMs) {
+    TimerWheel& timers = wheel();
+    timers.remove(this);
+    mDeadline = deadlineMs;
+    mExpiry = deadlineMs;
+    if (mSlackMs > 0 && deadlineMs != kDurationInfinite) {
+        // Aligning to a power of two, rather than just adding the slack,
+        // lines up timers with different slack on common ticks too.
+        Duration granularity = 1;
+        while (granularity <= mSlackMs / 2 && granularity < kMaxSlackAlign) {
+            granularity *= 2;
+        }
+        const Duration aligned =
+                (deadlineMs + granularity - 1) & ~(granularity - 1);
+        if (aligned >= deadlineMs) {
+            mExpiry = aligned;
+        }
+    }
+    timers.insert(this);
+}
+
+void EventLooper::Timer::stop() {
+    wheel().remove(this);
+}
+
+void EventLooper::Timer::save(Stream* stream) const {
+    stream->putBe64(
+            static_cast<uint64_t>(isActive() ? mDeadline : kDurationInfinite));
+}
+
+void EventLooper::Timer::load(Stream* stream) {
+    const Duration deadline = static_cast<Duration>(stream->getBe64());
+    if (deadline != kDurationInfinite) {
+        startAbsolute(deadline);
+    } else {
+        stop();
+    }
+}
+
+Looper::Timer* EventLooper::createTimer(Looper::Timer::Callback callback,
+                                        void* opaque,
+                                        ClockType clock) {
+    return new Timer(this, callback, opaque, clock);
+}
+
+void EventLooper::fireTimers() {
+    for (auto& timers : mWheels) {
+        if (timers->empty()) {
+            continue;
+        }
+        const int clock = static_cast<int>(&timers - &mWheels[0]);
+        timers->advance(nowMs(static_cast<ClockType>(clock)));
+        timers->beginFiring();
+        const Duration now = nowMs(static_cast<ClockType>(clock));
+        while (Timer* timer = timers->takeFiring()) {
+            const Duration lateness = std::max<Duration>(
+                    now - timer->mDeadline, 0);
+            ++mTimerStats.timersFired;
+            mTimerStats.totalLatenessMs += lateness;
+            mTimerStats.maxLatenessMs =
+                    std::max(mTimerStats.maxLatenessMs, lateness);
+            timer->fire();
+        }
+    }
+}
+
+Looper::Duration EventLooper::nextTimerDelayMs() {
+    Duration delay = kDurationInfinite;
+    for (int clock = 0; clock < 3; ++clock) {
+        TimerWheel& timers = *mWheels[clock];
+        if (timers.empty()) {
+            continue;
+        }
+        const Duration next = timers.nextDeadline();
+        if (next == kDurationInfinite) {
+            continue;
+        }
+        delay = std::min(delay, next - nowMs(static_cast<ClockType>(clock)));
+    }
+    return std::max<Duration>(delay, 0);
+}
+
+//
+//  T A S K S
+//
+
+void EventLooper::Task::schedule() {
+    EventLooper* looper = eventLooper();
+    {
+        std::lock_guard<std::mutex> lock(looper->mTasksLock);
+        if (mScheduled) {
+            return;
+        }
+        mScheduled = true;
+        looper->mScheduledTasks.push_back(this);
+    }
+    if (!looper->onLooperThread()) {
+        looper->mPoller->wake();
+    }
+}
+
+void EventLooper::Task::cancel() {
+    EventLooper* looper = eventLooper();
+    std::lock_guard<std::mutex> lock(looper->mTasksLock);
+    if (!mScheduled) {
+        return;
+    }
+    mScheduled = false;
+    auto& tasks = looper->mScheduledTasks;
+    tasks.erase(std::find(tasks.begin(), tasks.end(), this));
+}
+
+Looper::TaskPtr EventLooper::createTask(TaskCallback&& callback) {
+    return TaskPtr(new Task(this, std::move(callback)));
+}
+
+void EventLooper::scheduleCallback(TaskCallback&& callback) {
+    (new Task(this, std::move(callback), true))->schedule();
+}
+
+void EventLooper::runTasks() {
+    // Only what was scheduled before this pass runs now, so tasks that
+    // reschedule themselves cannot starve the loop.
+    size_t count;
+    {
+        std::lock_guard<std::mutex> lock(mTasksLock);
+        count = mScheduledTasks.size();
+    }
+    while (count--) {
+        Task* task;
+        {
+            std::lock_guard<std::mutex> lock(mTasksLock);
+            if (mScheduledTasks.empty()) {
+                break;
+            }
+            task = mScheduledTasks.front();
+            mScheduledTasks.pop_front();
+            task->mScheduled = false;
+        }
+        task->run();
+    }
+}
+
+//
+//  M A I N   L O O P
+//
+
+EventLooper::EventLooper()
+    : mPoller(new Poller()), mThreadId(std::this_thread::get_id()) {
+    for (int clock = 0; clock < 3; ++clock) {
+        mWheels[clock].reset(
+                new TimerWheel(this, static_cast<ClockType>(clock)));
+    }
+    mTimerStats.sinceMs = EventLooper::nowMs();
+}
+
+EventLooper::~EventLooper() = default;
+
+void EventLooper::resetTimerStats() {
+    mTimerStats = TimerStats();
+    mTimerStats.sinceMs = nowMs();
+}
+
+// static
+const char* EventLooper::backendName() {
+#if defined(_WIN32)
+    return "WSAPoll";
+#elif defined(__APPLE__)
+    return "kqueue";
+#else
+    return "epoll";
+#endif
+}
+
+bool EventLooper::onLooperThread() const {
+    return mThreadId == std::this_thread::get_id();
+}
+
+Looper::Duration EventLooper::nowMs(ClockType clockType) {
+    return static_cast<Duration>(nowNs(clockType) / 1000000LL);
+}
+
+Looper::DurationNs EventLooper::nowNs(ClockType clockType) {
+    if (clockType == ClockType::kRealtime) {
+        return getUnixTimeUs() * 1000LL;
+    }
+    return getHighResTimeUs() * 1000LL;
+}
+
+void EventLooper::forceQuit() {
+    mForcedExit = true;
+}
+
+bool EventLooper::runOneIterationWithDeadlineMs(Duration deadlineMs) {
+    bool haveTasks;
+    {
+        std::lock_guard<std::mutex> lock(mTasksLock);
+        haveTasks = !mScheduledTasks.empty();
+    }
+    bool haveTimers = false;
+    bool timersDue = false;
+    for (auto& timers : mWheels) {
+        haveTimers |= !timers->empty();
+        timersDue |= timers->hasExpired();
+    }
+    if (!mFdWatchCount && !haveTimers && !haveTasks) {
+        return false;
+    }
+
+    Duration timeoutMs = 0;
+    if (!mPendingHead && !haveTasks && !timersDue) {
+        timeoutMs = haveTimers ? nextTimerDelayMs() : kDurationInfinite;
+        if (deadlineMs != kDurationInfinite) {
+            timeoutMs = std::min(timeoutMs,
+                                 std::max<Duration>(deadlineMs - nowMs(), 0));
+        }
+    }
+    if (timeoutMs) {
+        ++mTimerStats.wakeups;
+    }
+    mPoller->wait(timeoutMs == kDurationInfinite
+                          ? -1
+                          : static_cast<int>(std::min<Duration>(
+                                    timeoutMs,
+                                    std::numeric_limits<int>::max())));
+
+    fireFdWatches();
+    fireTimers();
+    runTasks();
+    return true;
+}
+
+int EventLooper::runWithDeadlineMs(Duration deadlineMs) {
+    mForcedExit = false;
+    for (;;) {
+        if (!runOneIterationWithDeadlineMs(deadlineMs)) {
+            return EWOULDBLOCK;
+        }
+        if (mForcedExit) {
+            return 0;
+        }
+        if (deadlineMs != kDurationInfinite && nowMs() >= deadlineMs) {
+            return ETIMEDOUT;
+        }
+    }
+}
+
+// static
+Looper* Looper::create() {
+    return new EventLooper();
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,381 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/async/EventLooper.h"
+
+#include <gtest/gtest.h>
+
+#include <errno.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace android {
+namespace base {
+namespace {
+
+// Exposes single iterations and drives the virtual clock by hand.
+class ManualLooper : public EventLooper {
+public:
+    Duration nowMs(ClockType clockType = ClockType::kHost) override {
+        if (clockType == ClockType::kVirtual) {
+            return mVirtualMs;
+        }
+        return EventLooper::nowMs(clockType);
+    }
+
+    void setVirtualMs(Duration ms) { mVirtualMs = ms; }
+
+    using EventLooper::runOneIterationWithDeadlineMs;
+
+    // Runs iterations until nothing is immediately pending.
+    void drain() {
+        for (int i = 0; i < 100; ++i) {
+            runOneIterationWithDeadlineMs(EventLooper::nowMs());
+        }
+    }
+
+private:
+    Duration mVirtualMs = 0;
+};
+
+struct Fired {
+    std::vector<int> ids;
+};
+
+struct TimerArg {
+    Fired* fired;
+    int id;
+};
+
+void onTimer(void* opaque, Looper::Timer*) {
+    auto arg = static_cast<TimerArg*>(opaque);
+    arg->fired->ids.push_back(arg->id);
+}
+
+TEST(EventLooper, NothingToDo) {
+    EventLooper looper;
+    EXPECT_EQ(EWOULDBLOCK, looper.runWithTimeoutMs(1000));
+}
+
+// Tests that timers fire in deadline order, through every wheel level and
+// past the end of the wheel, and not before they are due.
+TEST(EventLooper, TimerWheel) {
+    ManualLooper looper;
+    Fired fired;
+    const Looper::Duration deadlines[] = {3,    70,       64,       5000,
+                                          4095, 300000,   20000000, 100000000};
+    const int count = sizeof(deadlines) / sizeof(deadlines[0]);
+    std::vector<TimerArg> args(count);
+    std::vector<std::unique_ptr<Looper::Timer>> timers;
+    for (int i = 0; i < count; ++i) {
+        args[i] = {&fired, i};
+        timers.emplace_back(looper.createTimer(&onTimer, &args[i],
+                                               Looper::ClockType::kVirtual));
+        timers.back()->startAbsolute(deadlines[i]);
+        EXPECT_TRUE(timers.back()->isActive());
+    }
+
+    std::vector<int> expected;
+    for (int i = 0; i < count; ++i) {
+        expected.push_back(i);
+    }
+    std::sort(expected.begin(), expected.end(), [&](int a, int b) {
+        return deadlines[a] < deadlines[b];
+    });
+
+    Looper::Duration now = 0;
+    for (size_t seen = 0; seen < expected.size(); ++seen) {
+        const Looper::Duration next = deadlines[expected[seen]];
+        // Jump halfway, then close in a tick at a time.
+        for (Looper::Duration at : {(now + next) / 2, next - 10}) {
+            if (at > now) {
+                now = at;
+            }
+            looper.setVirtualMs(now);
+            looper.drain();
+            EXPECT_EQ(seen, fired.ids.size()) << "early at " << now;
+        }
+        while (now + 1 < next) {
+            looper.setVirtualMs(++now);
+            looper.runOneIterationWithDeadlineMs(looper.EventLooper::nowMs());
+        }
+        EXPECT_EQ(seen, fired.ids.size()) << "early at " << now;
+        looper.setVirtualMs(now = next);
+        looper.drain();
+        ASSERT_EQ(seen + 1, fired.ids.size()) << "late at " << now;
+        EXPECT_EQ(expected[seen], fired.ids[seen]);
+        EXPECT_FALSE(timers[expected[seen]]->isActive());
+    }
+}
+
+TEST(EventLooper, TimerStopAndRestart) {
+    ManualLooper looper;
+    Fired fired;
+    TimerArg arg = {&fired, 1};
+    std::unique_ptr<Looper::Timer> timer(
+            looper.createTimer(&onTimer, &arg, Looper::ClockType::kVirtual));
+
+    timer->startRelative(10);
+    timer->stop();
+    EXPECT_FALSE(timer->isActive());
+    looper.setVirtualMs(20);
+    EXPECT_EQ(EWOULDBLOCK, looper.runWithTimeoutMs(0));
+    EXPECT_TRUE(fired.ids.empty());
+
+    timer->startRelative(10);
+    timer->startRelative(100);
+    looper.setVirtualMs(50);
+    looper.drain();
+    EXPECT_TRUE(fired.ids.empty());
+    looper.setVirtualMs(120);
+    looper.drain();
+    EXPECT_EQ(1u, fired.ids.size());
+
+    timer->startAbsolute(Looper::kDurationInfinite);
+    EXPECT_TRUE(timer->isActive());
+    looper.setVirtualMs(1000000000);
+    looper.drain();
+    EXPECT_EQ(1u, fired.ids.size());
+}
+
+// Tests that timers with slack expire together on an aligned tick, while a
+// timer without slack still fires on time, and that lateness is counted
+// against the requested deadlines.
+TEST(EventLooper, TimerSlack) {
+    ManualLooper looper;
+    looper.setVirtualMs(100);
+    looper.resetTimerStats();
+
+    Fired fired;
+    const Looper::Duration deadlines[] = {101, 103, 107, 105};
+    const int count = sizeof(deadlines) / sizeof(deadlines[0]);
+    std::vector<TimerArg> args(count);
+    std::vector<std::unique_ptr<Looper::Timer>> timers;
+    for (int i = 0; i < count; ++i) {
+        args[i] = {&fired, i};
+        timers.emplace_back(looper.createTimer(&onTimer, &args[i],
+                                               Looper::ClockType::kVirtual));
+        if (i < 3) {
+            timers.back()->setSlackMs(20);
+        }
+        timers.back()->startAbsolute(deadlines[i]);
+    }
+
+    for (Looper::Duration now = 101; now < 112; ++now) {
+        looper.setVirtualMs(now);
+        looper.drain();
+        EXPECT_EQ(now >= 105 ? std::vector<int>{3} : std::vector<int>{},
+                  fired.ids)
+                << "at " << now;
+    }
+    looper.setVirtualMs(112);
+    looper.drain();
+    EXPECT_EQ((std::vector<int>{3, 0, 1, 2}), fired.ids);
+
+    const EventLooper::TimerStats stats = looper.timerStats();
+    EXPECT_EQ(4u, stats.timersFired);
+    EXPECT_EQ(11 + 9 + 5, stats.totalLatenessMs);
+    EXPECT_EQ(11, stats.maxLatenessMs);
+}
+
+TEST(EventLooper, HostTimerWakesWait) {
+    EventLooper looper;
+    std::unique_ptr<Looper::Timer> timer(looper.createTimer(
+            [](void* opaque, Looper::Timer*) {
+                static_cast<Looper*>(opaque)->forceQuit();
+            },
+            &looper, Looper::ClockType::kHost));
+    timer->startRelative(20);
+    const Looper::Duration start = looper.nowMs();
+    EXPECT_EQ(0, looper.runWithTimeoutMs(5000));
+    EXPECT_GE(looper.nowMs() - start, 20);
+}
+
+// Tests that tasks scheduled from another thread wake a looper blocked
+// without a deadline, each time, rather than when its wait times out.
+TEST(EventLooper, ScheduleFromOtherThread) {
+    EventLooper looper;
+    // Keeps the loop from running out of things to wait for.
+    std::unique_ptr<Looper::Timer> idle(
+            looper.createTimer([](void*, Looper::Timer*) {}, nullptr,
+                               Looper::ClockType::kHost));
+    idle->startAbsolute(Looper::kDurationInfinite);
+
+    constexpr int kTasks = 3;
+    int ran = 0;
+    std::thread other([&] {
+        for (int i = 0; i < kTasks; ++i) {
+            // Long enough for the looper to be blocked again.
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            looper.scheduleCallback([&] {
+                if (++ran == kTasks) {
+                    looper.forceQuit();
+                }
+            });
+        }
+    });
+    const Looper::Duration start = looper.nowMs();
+    EXPECT_EQ(0, looper.runWithTimeoutMs(30000));
+    other.join();
+    EXPECT_EQ(kTasks, ran);
+    EXPECT_LT(looper.nowMs() - start, 10000);
+}
+
+TEST(EventLooper, TaskCancel) {
+    EventLooper looper;
+    int runs = 0;
+    Looper::TaskPtr task = looper.createTask([&runs] { ++runs; });
+    task->schedule();
+    task->schedule();
+    EXPECT_EQ(EWOULDBLOCK, looper.runWithTimeoutMs(1000));
+    EXPECT_EQ(1, runs);
+
+    task->schedule();
+    task->cancel();
+    EXPECT_EQ(EWOULDBLOCK, looper.runWithTimeoutMs(1000));
+    EXPECT_EQ(1, runs);
+
+    task->schedule();
+    task.reset();
+    EXPECT_EQ(EWOULDBLOCK, looper.runWithTimeoutMs(1000));
+    EXPECT_EQ(1, runs);
+}
+
+#ifndef _WIN32
+
+class EventLooperFdTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        for (int* fds : {mPipe, mOther}) {
+            ASSERT_EQ(0, ::pipe(fds));
+            for (int i = 0; i < 2; ++i) {
+                ::fcntl(fds[i], F_SETFL, O_NONBLOCK);
+            }
+        }
+    }
+
+    void TearDown() override {
+        for (int fd : {mPipe[0], mPipe[1], mOther[0], mOther[1]}) {
+            ::close(fd);
+        }
+    }
+
+    ManualLooper mLooper;
+    int mPipe[2];
+    int mOther[2];
+};
+
+struct ReadOne {
+    int calls = 0;
+    unsigned events = 0;
+    Looper::FdWatch* toDelete = nullptr;
+};
+
+void readOne(void* opaque, int fd, unsigned events) {
+    auto state = static_cast<ReadOne*>(opaque);
+    ++state->calls;
+    state->events |= events;
+    char c;
+    if (events & Looper::FdWatch::kEventRead) {
+        (void)::read(fd, &c, 1);
+    }
+    if (state->toDelete) {
+        delete state->toDelete;
+        state->toDelete = nullptr;
+    }
+}
+
+// Tests that a partially drained descriptor keeps firing, as with select().
+TEST_F(EventLooperFdTest, LevelTriggered) {
+    ReadOne state;
+    std::unique_ptr<Looper::FdWatch> watch(
+            mLooper.createFdWatch(mPipe[0], &readOne, &state));
+    watch->wantRead();
+    ASSERT_EQ(10, ::write(mPipe[1], "0123456789", 10));
+
+    EXPECT_EQ(ETIMEDOUT, mLooper.runWithTimeoutMs(50));
+    EXPECT_EQ(10, state.calls);
+    EXPECT_EQ(unsigned(Looper::FdWatch::kEventRead), state.events);
+
+    ASSERT_EQ(1, ::write(mPipe[1], "x", 1));
+    EXPECT_EQ(ETIMEDOUT, mLooper.runWithTimeoutMs(50));
+    EXPECT_EQ(11, state.calls);
+}
+
+// Tests that readiness seen while nothing was wanted fires once wanted.
+TEST_F(EventLooperFdTest, WantAfterReady) {
+    ReadOne state;
+    std::unique_ptr<Looper::FdWatch> watch(
+            mLooper.createFdWatch(mPipe[0], &readOne, &state));
+    ASSERT_EQ(1, ::write(mPipe[1], "x", 1));
+    mLooper.drain();
+    EXPECT_EQ(0, state.calls);
+
+    watch->wantRead();
+    watch->dontWantRead();
+    mLooper.drain();
+    EXPECT_EQ(0, state.calls);
+
+    watch->wantRead();
+    EXPECT_EQ(unsigned(Looper::FdWatch::kEventRead), watch->poll());
+    mLooper.drain();
+    EXPECT_EQ(1, state.calls);
+}
+
+TEST_F(EventLooperFdTest, Write) {
+    ReadOne state;
+    std::unique_ptr<Looper::FdWatch> watch(
+            mLooper.createFdWatch(mPipe[1], &readOne, &state));
+    mLooper.drain();
+    EXPECT_EQ(0, state.calls);
+    watch->wantWrite();
+    mLooper.runOneIterationWithDeadlineMs(mLooper.nowMs());
+    EXPECT_EQ(1, state.calls);
+    EXPECT_EQ(unsigned(Looper::FdWatch::kEventWrite), state.events);
+    watch->dontWantWrite();
+    mLooper.drain();
+    EXPECT_EQ(1, state.calls);
+}
+
+// Tests that a callback may delete another watch that is already queued.
+TEST_F(EventLooperFdTest, DeleteQueuedWatch) {
+    ReadOne first;
+    ReadOne second;
+    Looper::FdWatch* a = mLooper.createFdWatch(mPipe[0], &readOne, &first);
+    Looper::FdWatch* b = mLooper.createFdWatch(mOther[0], &readOne, &second);
+    a->wantRead();
+    b->wantRead();
+    ASSERT_EQ(1, ::write(mPipe[1], "x", 1));
+    ASSERT_EQ(1, ::write(mOther[1], "x", 1));
+    first.toDelete = b;
+    second.toDelete = a;
+    mLooper.drain();
+    EXPECT_EQ(1, first.calls + second.calls);
+    delete (first.calls ? a : b);
+}
+
+#endif  // !_WIN32
+
+}  // namespace
+}  // namespace base
+}  // namespace android
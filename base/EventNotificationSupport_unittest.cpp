@@ -0,0 +1,120 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/EventNotificationSupport.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace base {
+
+namespace {
+
+struct TestEvent {
+    int value;
+};
+
+class TestSource : public EventNotificationSupport<TestEvent> {
+public:
+    using EventNotificationSupport<TestEvent>::fireEvent;
+};
+
+using TestListener = RaiiEventListener<TestSource, TestEvent>;
+
+}  // namespace
+
+// Tests that both kinds of listeners get every event, and that a removed
+// listener gets no more.
+TEST(EventNotificationSupport, Dispatch) {
+    TestSource source;
+    source.fireEvent({0});
+
+    std::vector<int> once;
+    source.registerOnce([&once](const TestEvent& evt) { once.push_back(evt.value); });
+    std::vector<int> removable;
+    {
+        TestListener listener(&source, [&removable](const TestEvent& evt) {
+            removable.push_back(evt.value);
+        });
+        source.fireEvent({1});
+    }
+    source.fireEvent({2});
+
+    EXPECT_EQ(std::vector<int>({1, 2}), once);
+    EXPECT_EQ(std::vector<int>({1}), removable);
+}
+
+// Tests that a listener can add another while an event is being delivered;
+// the new one gets the next event.
+TEST(EventNotificationSupport, AddDuringDispatch) {
+    TestSource source;
+    int added = 0;
+    source.registerOnce([&source, &added](const TestEvent& evt) {
+        if (evt.value == 1) {
+            source.registerOnce([&added](const TestEvent&) { ++added; });
+        }
+    });
+
+    source.fireEvent({1});
+    EXPECT_EQ(0, added);
+    source.fireEvent({2});
+    EXPECT_EQ(1, added);
+}
+
+// Tests that a listener can remove a listener of another source, which must
+// not wait for the delivery it is part of.
+TEST(EventNotificationSupport, RemoveFromOtherSourceDuringDispatch) {
+    TestSource first;
+    TestSource second;
+    int secondEvents = 0;
+    auto secondListener = std::make_unique<TestListener>(
+            &second, [&secondEvents](const TestEvent&) { ++secondEvents; });
+    first.registerOnce([&secondListener](const TestEvent&) { secondListener.reset(); });
+
+    first.fireEvent({1});
+    EXPECT_FALSE(secondListener);
+    second.fireEvent({2});
+    EXPECT_EQ(0, secondEvents);
+}
+
+// Tests that removing a listener waits for a delivery on another thread
+// that is still calling it.
+TEST(EventNotificationSupport, RemoveWaitsForDelivery) {
+    TestSource source;
+    std::atomic<bool> inListener{false};
+    std::atomic<bool> finished{false};
+    auto listener = std::make_unique<TestListener>(&source, [&](const TestEvent&) {
+        inListener = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        finished = true;
+    });
+
+    std::thread delivery([&source] { source.fireEvent({1}); });
+    while (!inListener) {
+        std::this_thread::yield();
+    }
+    listener.reset();
+    EXPECT_TRUE(finished);
+    delivery.join();
+}
+
+}  // namespace base
+}  // namespace android
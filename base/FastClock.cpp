@@ -0,0 +1,267 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/system/FastClock.h"
+
+#include <algorithm>
+#include <atomic>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace android {
+namespace base {
+namespace {
+
+// Rates are ns per tick, in 32.32 fixed point.
+constexpr int kRateShift = 32;
+// How long the first calibration measures the rate over.
+constexpr uint64_t kInitialCalibrationNs = 1000000;
+// How often the clock is compared to the monotonic clock again.
+constexpr uint64_t kRecalibrationNs = 1000000000;
+// The fastest errors are slewed out at, relative to the rate.
+constexpr double kMaxSlew = 500e-6;
+// Errors larger than this, with the clock behind, are stepped over.
+constexpr int64_t kMaxSlewedErrorNs = 1000000;
+// Paired reads per calibration sample.
+constexpr int kReadsPerSample = 8;
+
+// The clock getHighResTimeUs() reads, in ns.
+uint64_t monotonicNs() {
+#ifdef _WIN32
+    static const uint64_t sFreq = [] {
+        LARGE_INTEGER freq;
+        QueryPerformanceFrequency(&freq);
+        return uint64_t(freq.QuadPart);
+    }();
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    const uint64_t count = now.QuadPart;
+    return count / sFreq * 1000000000ULL + count % sFreq * 1000000000ULL / sFreq;
+#elif defined(__APPLE__)
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+bool hasCounter() {
+#ifdef __APPLE__
+    return true;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int regs[4];
+    __cpuid(regs, 0x80000000);
+    if (unsigned(regs[0]) < 0x80000007) {
+        return false;
+    }
+    __cpuid(regs, 0x80000007);
+    return regs[3] & (1 << 8);
+#elif defined(__x86_64__) || defined(__i386__)
+    // Invariant TSC: constant rate across P-, C- and T-states.
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return edx & (1u << 8);
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline uint64_t readCounter() {
+#ifdef __APPLE__
+    return mach_absolute_time();
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || \
+        defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return 0;
+#endif
+}
+
+// (ticks * rate) >> kRateShift, exactly, without a 128-bit multiply.
+inline uint64_t scale(uint64_t ticks, uint64_t rate) {
+    const uint64_t ticksLo = ticks & 0xffffffff;
+    const uint64_t ticksHi = ticks >> 32;
+    const uint64_t rateLo = rate & 0xffffffff;
+    const uint64_t rateHi = rate >> 32;
+    return ((ticksHi * rateHi) << 32) + ticksHi * rateLo + ticksLo * rateHi +
+           ((ticksLo * rateLo) >> 32);
+}
+
+struct Sample {
+    uint64_t ticks;
+    uint64_t ns;
+};
+
+// Reads the counter on both sides of the monotonic clock, and keeps the
+// tightest of a few tries.
+Sample pairedSample() {
+    Sample best = {};
+    uint64_t bestSpread = UINT64_MAX;
+    for (int i = 0; i < kReadsPerSample; ++i) {
+        const uint64_t before = readCounter();
+        const uint64_t ns = monotonicNs();
+        const uint64_t after = readCounter();
+        if (after >= before && after - before < bestSpread) {
+            bestSpread = after - before;
+            best = {before + (after - before) / 2, ns};
+        }
+    }
+    return best;
+}
+
+// Maps counter ticks to ns as base + (ticks - baseTicks) * rate. Readers
+// take the three under a seqlock; one caller at a time recalibrates.
+class Calibration {
+public:
+    static Calibration& get() {
+        static Calibration* sCalibration = new Calibration;
+        return *sCalibration;
+    }
+
+    bool counterBased() const { return mCounterBased; }
+
+    uint64_t nowNs() {
+        const uint64_t ticks = readCounter();
+        uint64_t baseTicks, baseNs, rate;
+        load(&baseTicks, &baseNs, &rate);
+        // Another core's counter may lag a little behind the base.
+        if (ticks < baseTicks) {
+            return baseNs - scale(baseTicks - ticks, rate);
+        }
+        if (ticks - baseTicks >= mRecalibrationTicks) {
+            recalibrate();
+        }
+        return baseNs + scale(ticks - baseTicks, rate);
+    }
+
+private:
+    Calibration() {
+        if (!hasCounter()) {
+            return;
+        }
+        const Sample first = pairedSample();
+        Sample last;
+        do {
+            last = pairedSample();
+        } while (last.ns - first.ns < kInitialCalibrationNs);
+        if (last.ticks <= first.ticks) {
+            return;
+        }
+        mOrigin = first;
+        const double nsPerTick =
+                double(last.ns - first.ns) / double(last.ticks - first.ticks);
+        mRecalibrationTicks = uint64_t(kRecalibrationNs / nsPerTick);
+        store(last.ticks, last.ns, toRate(nsPerTick));
+        mCounterBased = true;
+    }
+
+    static uint64_t toRate(double nsPerTick) {
+        return uint64_t(nsPerTick * double(uint64_t(1) << kRateShift));
+    }
+
+    void load(uint64_t* baseTicks, uint64_t* baseNs, uint64_t* rate) const {
+        uint32_t seq;
+        do {
+            seq = mSeq.load(std::memory_order_acquire);
+            *baseTicks = mBaseTicks.load(std::memory_order_relaxed);
+            *baseNs = mBaseNs.load(std::memory_order_relaxed);
+            *rate = mRate.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((seq & 1) || seq != mSeq.load(std::memory_order_relaxed));
+    }
+
+    void store(uint64_t baseTicks, uint64_t baseNs, uint64_t rate) {
+        const uint32_t seq = mSeq.load(std::memory_order_relaxed);
+        mSeq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        mBaseTicks.store(baseTicks, std::memory_order_relaxed);
+        mBaseNs.store(baseNs, std::memory_order_relaxed);
+        mRate.store(rate, std::memory_order_relaxed);
+        mSeq.store(seq + 2, std::memory_order_release);
+    }
+
+    // Takes the rate measured since the first calibration, which gets more
+    // precise as time goes on, and bends it to cancel the current error
+    // over the next period. The clock continues from where it is.
+    void recalibrate() {
+        if (mRecalibrating.exchange(true, std::memory_order_acquire)) {
+            return;
+        }
+        uint64_t baseTicks, baseNs, rate;
+        load(&baseTicks, &baseNs, &rate);
+        const Sample now = pairedSample();
+        if (now.ticks >= baseTicks &&
+            now.ticks - baseTicks >= mRecalibrationTicks) {
+            uint64_t clockNs = baseNs + scale(now.ticks - baseTicks, rate);
+            const int64_t errorNs = int64_t(now.ns - clockNs);
+            const double nsPerTick = double(now.ns - mOrigin.ns) /
+                                     double(now.ticks - mOrigin.ticks);
+            double slew = 0;
+            if (errorNs > kMaxSlewedErrorNs) {
+                clockNs = now.ns;
+            } else {
+                slew = std::min(kMaxSlew,
+                                std::max(-kMaxSlew, double(errorNs) /
+                                                            kRecalibrationNs));
+            }
+            store(now.ticks, clockNs, toRate(nsPerTick * (1 + slew)));
+        }
+        mRecalibrating.store(false, std::memory_order_release);
+    }
+
+    bool mCounterBased = false;
+    Sample mOrigin = {};
+    uint64_t mRecalibrationTicks = UINT64_MAX;
+    std::atomic<uint32_t> mSeq{0};
+    std::atomic<uint64_t> mBaseTicks{0};
+    std::atomic<uint64_t> mBaseNs{0};
+    std::atomic<uint64_t> mRate{0};
+    std::atomic<bool> mRecalibrating{false};
+};
+
+}  // namespace
+
+uint64_t FastClock::nowNs() {
+    Calibration& calibration = Calibration::get();
+    return calibration.counterBased() ? calibration.nowNs() : monotonicNs();
+}
+
+bool FastClock::isCounterBased() {
+    return Calibration::get().counterBased();
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,74 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/system/FastClock.h"
+
+#include "aemu/base/system/System.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace base {
+
+// Tests that the clock follows getHighResTimeUs(), origin included.
+TEST(FastClock, TracksHighResTime) {
+    const uint64_t beforeUs = getHighResTimeUs();
+    const uint64_t fastUs = FastClock::nowUs();
+    const uint64_t afterUs = getHighResTimeUs();
+    // Calibration error, plus the first call calibrating.
+    EXPECT_GE(fastUs + 100, beforeUs);
+    EXPECT_LE(fastUs, afterUs + 100);
+}
+
+// Tests that elapsed times agree with the monotonic clock's.
+TEST(FastClock, MeasuresElapsedTime) {
+    // Calibrates first, if this runs on its own.
+    FastClock::nowNs();
+    const uint64_t startUs = getHighResTimeUs();
+    const uint64_t fastStartNs = FastClock::nowNs();
+    sleepMs(50);
+    const uint64_t fastElapsedNs = FastClock::nowNs() - fastStartNs;
+    const uint64_t elapsedUs = getHighResTimeUs() - startUs;
+    EXPECT_NEAR(double(elapsedUs), fastElapsedNs / 1000.0, elapsedUs * 0.01 + 50);
+}
+
+// Tests that no thread sees the clock go back, including across the
+// recalibrations some of them run.
+TEST(FastClock, MonotonicPerThread) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([] {
+            const uint64_t endUs = getHighResTimeUs() + 1200000;
+            uint64_t last = FastClock::nowNs();
+            uint64_t backwards = 0;
+            while (getHighResTimeUs() < endUs) {
+                const uint64_t now = FastClock::nowNs();
+                backwards += now < last;
+                last = now;
+            }
+            EXPECT_EQ(0u, backwards);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    EXPECT_NEAR(double(getHighResTimeUs()), double(FastClock::nowUs()), 100);
+}
+
+}  // namespace base
+}  // namespace android
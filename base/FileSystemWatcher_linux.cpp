@@ -0,0 +1,449 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/files/FileSystemWatcher.h"
+
+#include "aemu/base/threads/FunctorThread.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace android {
+namespace base {
+
+namespace {
+
+using Change = FileSystemWatcher::Change;
+using ChangeType = FileSystemWatcher::WatcherChangeType;
+using Path = FileSystemWatcher::Path;
+
+constexpr uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MODIFY |
+                                IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO |
+                                IN_ONLYDIR | IN_MASK_ADD;
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
+bool isDirectory(const Path& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+class InotifyWatcher;
+
+// The one inotify instance of the process, read by a thread that also
+// delivers the callbacks.
+class InotifyHub {
+public:
+    static InotifyHub& get() {
+        static InotifyHub* const sHub = new InotifyHub();
+        return *sHub;
+    }
+
+    bool add(InotifyWatcher* watcher);
+    void remove(InotifyWatcher* watcher);
+
+private:
+    struct Dir {
+        Path path;
+        std::vector<InotifyWatcher*> watchers;
+    };
+
+    InotifyHub();
+
+    // Watches |path|, and with |recursive| everything below it, for
+    // |watcher|. With |reportExisting|, what is already there is reported
+    // as created, since it may have appeared before the watch.
+    bool addDirLocked(InotifyWatcher* watcher,
+                      const Path& path,
+                      bool recursive,
+                      bool reportExisting);
+    void dropWatchLocked(InotifyWatcher* watcher, int wd);
+    void handleEventLocked(const inotify_event* event, int64_t now);
+    int pollTimeoutMs(int64_t now);
+    void deliverDue(int64_t now);
+    void threadMain();
+
+    const int mFd;
+    std::mutex mLock;
+    std::unordered_map<int, Dir> mDirs;
+    std::vector<InotifyWatcher*> mWatchers;
+    // Held while callbacks run, so that remove() can wait them out.
+    std::mutex mDeliveryLock;
+    FunctorThread mThread;
+    static thread_local bool sOnHubThread;
+};
+
+class InotifyWatcher : public FileSystemWatcher {
+public:
+    InotifyWatcher(Path path,
+                   FileSystemWatcherBatchCallback onChanges,
+                   Options options)
+        : FileSystemWatcher(nullptr),
+          mPath(std::move(path)),
+          mOnChanges(std::move(onChanges)),
+          mOptions(options) {}
+
+    ~InotifyWatcher() override { stop(); }
+
+    bool start() override {
+        if (mStarted) {
+            return true;
+        }
+        mStarted = InotifyHub::get().add(this);
+        return mStarted;
+    }
+
+    void stop() override {
+        if (!mStarted) {
+            return;
+        }
+        InotifyHub::get().remove(this);
+        mStarted = false;
+    }
+
+private:
+    friend class InotifyHub;
+
+    // Merges a change into the pending batch. Guarded by InotifyHub::mLock,
+    // like everything below.
+    void queue(ChangeType type, const Path& path, int64_t now) {
+        auto it = mPendingIndex.find(path);
+        if (it == mPendingIndex.end()) {
+            if (mPending.empty()) {
+                mDeadlineMs = now + mOptions.debounce.count();
+            }
+            mPendingIndex.emplace(path, mPending.size());
+            mPending.push_back({type, path});
+            mPendingLive.push_back(true);
+            return;
+        }
+        const size_t index = it->second;
+        if (!mPendingLive[index]) {
+            mPending[index].type = type;
+            mPendingLive[index] = true;
+            return;
+        }
+        ChangeType& pending = mPending[index].type;
+        if (pending == ChangeType::Created && type == ChangeType::Deleted) {
+            mPendingLive[index] = false;
+        } else if (pending == ChangeType::Deleted &&
+                   type == ChangeType::Created) {
+            pending = ChangeType::Changed;
+        } else if (pending != ChangeType::Created) {
+            pending = type;
+        }
+    }
+
+    std::vector<Change> takePending() {
+        std::vector<Change> changes;
+        changes.reserve(mPending.size());
+        for (size_t i = 0; i < mPending.size(); ++i) {
+            if (mPendingLive[i]) {
+                changes.push_back(std::move(mPending[i]));
+            }
+        }
+        mPending.clear();
+        mPendingLive.clear();
+        mPendingIndex.clear();
+        return changes;
+    }
+
+    const Path mPath;
+    const FileSystemWatcherBatchCallback mOnChanges;
+    const Options mOptions;
+    bool mStarted = false;
+
+    std::vector<int> mWatches;
+    std::vector<Change> mPending;
+    // False for a path whose changes cancelled out.
+    std::vector<bool> mPendingLive;
+    std::unordered_map<Path, size_t> mPendingIndex;
+    int64_t mDeadlineMs = 0;
+};
+
+thread_local bool InotifyHub::sOnHubThread = false;
+
+InotifyHub::InotifyHub()
+    : mFd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+      mThread([this] {
+          threadMain();
+          return intptr_t(0);
+      }) {
+    if (mFd >= 0) {
+        mThread.start();
+    }
+}
+
+bool InotifyHub::add(InotifyWatcher* watcher) {
+    if (mFd < 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!addDirLocked(watcher, watcher->mPath, watcher->mOptions.recursive,
+                      false)) {
+        for (int wd : std::vector<int>(watcher->mWatches)) {
+            dropWatchLocked(watcher, wd);
+        }
+        return false;
+    }
+    mWatchers.push_back(watcher);
+    return true;
+}
+
+void InotifyHub::remove(InotifyWatcher* watcher) {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        for (int wd : std::vector<int>(watcher->mWatches)) {
+            dropWatchLocked(watcher, wd);
+        }
+        mWatchers.erase(
+                std::find(mWatchers.begin(), mWatchers.end(), watcher));
+        watcher->takePending();
+    }
+    if (!sOnHubThread) {
+        std::lock_guard<std::mutex> wait(mDeliveryLock);
+    }
+}
+
+bool InotifyHub::addDirLocked(InotifyWatcher* watcher,
+                              const Path& path,
+                              bool recursive,
+                              bool reportExisting) {
+    const int wd = inotify_add_watch(mFd, path.c_str(), kWatchMask);
+    if (wd < 0) {
+        return false;
+    }
+    Dir& dir = mDirs[wd];
+    if (dir.path.empty()) {
+        dir.path = path;
+    }
+    if (std::find(dir.watchers.begin(), dir.watchers.end(), watcher) ==
+        dir.watchers.end()) {
+        dir.watchers.push_back(watcher);
+        watcher->mWatches.push_back(wd);
+    }
+
+    if (!recursive && !reportExisting) {
+        return true;
+    }
+    DIR* entries = ::opendir(path.c_str());
+    if (!entries) {
+        return true;
+    }
+    const int64_t now = nowMs();
+    while (const dirent* entry = ::readdir(entries)) {
+        const Path name = entry->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        const Path child = path + "/" + name;
+        if (reportExisting) {
+            watcher->queue(ChangeType::Created, child, now);
+        }
+        const bool subdir = entry->d_type == DT_DIR ||
+                            (entry->d_type == DT_UNKNOWN && isDirectory(child));
+        if (recursive && subdir) {
+            // A subdirectory that can't be watched, e.g. for lack of
+            // permission, doesn't fail the rest.
+            addDirLocked(watcher, child, true, reportExisting);
+        }
+    }
+    ::closedir(entries);
+    return true;
+}
+
+void InotifyHub::dropWatchLocked(InotifyWatcher* watcher, int wd) {
+    auto& watches = watcher->mWatches;
+    watches.erase(std::remove(watches.begin(), watches.end(), wd),
+                  watches.end());
+    auto it = mDirs.find(wd);
+    if (it == mDirs.end()) {
+        return;
+    }
+    auto& watchers = it->second.watchers;
+    watchers.erase(std::remove(watchers.begin(), watchers.end(), watcher),
+                   watchers.end());
+    if (watchers.empty()) {
+        inotify_rm_watch(mFd, wd);
+        mDirs.erase(it);
+    }
+}
+
+void InotifyHub::handleEventLocked(const inotify_event* event, int64_t now) {
+    if (event->mask & IN_Q_OVERFLOW) {
+        // Events were lost; all we can say is that something changed.
+        for (InotifyWatcher* watcher : mWatchers) {
+            watcher->queue(ChangeType::Changed, watcher->mPath, now);
+        }
+        return;
+    }
+    auto it = mDirs.find(event->wd);
+    if (it == mDirs.end()) {
+        return;
+    }
+    if (event->mask & IN_IGNORED) {
+        // The directory is gone, and the kernel dropped the watch.
+        for (InotifyWatcher* watcher : it->second.watchers) {
+            auto& watches = watcher->mWatches;
+            watches.erase(
+                    std::remove(watches.begin(), watches.end(), event->wd),
+                    watches.end());
+        }
+        mDirs.erase(it);
+        return;
+    }
+
+    ChangeType type;
+    if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+        type = ChangeType::Created;
+    } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        type = ChangeType::Deleted;
+    } else if (event->mask & (IN_MODIFY | IN_ATTRIB)) {
+        type = ChangeType::Changed;
+    } else {
+        return;
+    }
+    const Path path = event->len ? it->second.path + "/" + event->name
+                                 : it->second.path;
+    const bool newDir =
+            type == ChangeType::Created && (event->mask & IN_ISDIR);
+
+    // Adding a watch below may rehash |mDirs|.
+    const std::vector<InotifyWatcher*> watchers = it->second.watchers;
+    for (InotifyWatcher* watcher : watchers) {
+        watcher->queue(type, path, now);
+        if (newDir && watcher->mOptions.recursive) {
+            addDirLocked(watcher, path, true, true);
+        }
+    }
+}
+
+int InotifyHub::pollTimeoutMs(int64_t now) {
+    std::lock_guard<std::mutex> lock(mLock);
+    int64_t deadline = INT64_MAX;
+    for (InotifyWatcher* watcher : mWatchers) {
+        if (!watcher->mPending.empty()) {
+            deadline = std::min(deadline, watcher->mDeadlineMs);
+        }
+    }
+    if (deadline == INT64_MAX) {
+        return -1;
+    }
+    return static_cast<int>(std::max<int64_t>(deadline - now, 0));
+}
+
+void InotifyHub::deliverDue(int64_t now) {
+    std::lock_guard<std::mutex> delivery(mDeliveryLock);
+    std::vector<std::pair<InotifyWatcher*, std::vector<Change>>> due;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        for (InotifyWatcher* watcher : mWatchers) {
+            if (!watcher->mPending.empty() && watcher->mDeadlineMs <= now) {
+                due.emplace_back(watcher, watcher->takePending());
+            }
+        }
+    }
+    for (auto& [watcher, changes] : due) {
+        FileSystemWatcher::FileSystemWatcherBatchCallback callback;
+        {
+            // An earlier callback may have stopped or deleted this one.
+            std::lock_guard<std::mutex> lock(mLock);
+            if (std::find(mWatchers.begin(), mWatchers.end(), watcher) ==
+                mWatchers.end()) {
+                continue;
+            }
+            callback = watcher->mOnChanges;
+        }
+        if (!changes.empty()) {
+            callback(changes);
+        }
+    }
+}
+
+void InotifyHub::threadMain() {
+    sOnHubThread = true;
+    alignas(inotify_event) char buffer[64 * 1024];
+    for (;;) {
+        pollfd fd = {mFd, POLLIN, 0};
+        const int ready = ::poll(&fd, 1, pollTimeoutMs(nowMs()));
+        if (ready < 0 && errno != EINTR) {
+            return;
+        }
+        if (ready > 0) {
+            std::lock_guard<std::mutex> lock(mLock);
+            const int64_t now = nowMs();
+            for (;;) {
+                const ssize_t size = ::read(mFd, buffer, sizeof(buffer));
+                if (size <= 0) {
+                    break;
+                }
+                for (ssize_t offset = 0; offset < size;) {
+                    const auto* event =
+                            reinterpret_cast<const inotify_event*>(buffer +
+                                                                   offset);
+                    handleEventLocked(event, now);
+                    offset += sizeof(inotify_event) + event->len;
+                }
+            }
+        }
+        deliverDue(nowMs());
+    }
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<FileSystemWatcher> FileSystemWatcher::getFileSystemWatcher(
+        Path path,
+        FileSystemWatcherCallback onChangeCallback) {
+    return getFileSystemWatcher(
+            std::move(path),
+            [onChangeCallback](const std::vector<Change>& changes) {
+                for (const Change& change : changes) {
+                    onChangeCallback(change.type, change.path);
+                }
+            },
+            Options());
+}
+
+// static
+std::unique_ptr<FileSystemWatcher> FileSystemWatcher::getFileSystemWatcher(
+        Path path,
+        FileSystemWatcherBatchCallback onChanges,
+        Options options) {
+    while (path.size() > 1 && path.back() == '/') {
+        path.pop_back();
+    }
+    if (!isDirectory(path)) {
+        return nullptr;
+    }
+    return std::make_unique<InotifyWatcher>(std::move(path),
+                                            std::move(onChanges), options);
+}
+
+}  // namespace base
+}  // namespace android
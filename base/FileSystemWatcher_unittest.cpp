@@ -0,0 +1,188 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/files/FileSystemWatcher.h"
+
+#include "aemu/base/testing/TestTempDir.h"
+
+#include <gtest/gtest.h>
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+
+#include <sys/stat.h>
+
+namespace android {
+namespace base {
+namespace {
+
+using Change = FileSystemWatcher::Change;
+using ChangeType = FileSystemWatcher::WatcherChangeType;
+using Options = FileSystemWatcher::Options;
+
+// Collects batches from the watcher thread.
+class Batches {
+public:
+    FileSystemWatcher::FileSystemWatcherBatchCallback callback() {
+        return [this](const std::vector<Change>& changes) {
+            std::lock_guard<std::mutex> lock(mLock);
+            mBatches.push_back(changes);
+            mCv.notify_all();
+        };
+    }
+
+    // Waits until some batch has a change of |type| to |path|.
+    bool waitFor(ChangeType type, const std::string& path) {
+        std::unique_lock<std::mutex> lock(mLock);
+        return mCv.wait_for(lock, std::chrono::seconds(10), [&] {
+            for (const auto& batch : mBatches) {
+                for (const Change& change : batch) {
+                    if (change.type == type && change.path == path) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        });
+    }
+
+    std::vector<std::vector<Change>> batches() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mBatches;
+    }
+
+private:
+    std::mutex mLock;
+    std::condition_variable mCv;
+    std::vector<std::vector<Change>> mBatches;
+};
+
+void writeFile(const std::string& path, const char* text) {
+    std::ofstream(path, std::ios::app) << text;
+}
+
+TEST(FileSystemWatcher, NotADirectory) {
+    TestTempDir dir("fswatcher");
+    ASSERT_TRUE(dir.makeSubFile("file"));
+    EXPECT_FALSE(FileSystemWatcher::getFileSystemWatcher(
+            dir.makeSubPath("file"), [](ChangeType, const std::string&) {}));
+}
+
+TEST(FileSystemWatcher, PerEventCallback) {
+    TestTempDir dir("fswatcher");
+    std::mutex lock;
+    std::condition_variable cv;
+    std::vector<Change> changes;
+    auto watcher = FileSystemWatcher::getFileSystemWatcher(
+            dir.pathString(),
+            [&](ChangeType type, const std::string& path) {
+                std::lock_guard<std::mutex> guard(lock);
+                changes.push_back({type, path});
+                cv.notify_all();
+            });
+    ASSERT_TRUE(watcher);
+    ASSERT_TRUE(watcher->start());
+
+    ASSERT_TRUE(dir.makeSubFile("created"));
+    std::unique_lock<std::mutex> guard(lock);
+    ASSERT_TRUE(cv.wait_for(guard, std::chrono::seconds(10),
+                            [&] { return !changes.empty(); }));
+    EXPECT_EQ(ChangeType::Created, changes[0].type);
+    EXPECT_EQ(dir.makeSubPath("created"), changes[0].path);
+}
+
+// Tests that a burst of changes within the window arrives as one batch,
+// with the changes to each path merged.
+TEST(FileSystemWatcher, Debounced) {
+    TestTempDir dir("fswatcher");
+    Batches batches;
+    Options options;
+    options.debounce = std::chrono::milliseconds(300);
+    auto watcher = FileSystemWatcher::getFileSystemWatcher(
+            dir.pathString(), batches.callback(), options);
+    ASSERT_TRUE(watcher);
+    ASSERT_TRUE(watcher->start());
+
+    const std::string kept = dir.makeSubPath("kept");
+    const std::string temp = dir.makeSubPath("temp");
+    for (int i = 0; i < 20; ++i) {
+        writeFile(kept, "x");
+    }
+    writeFile(temp, "y");
+    ASSERT_EQ(0, ::unlink(temp.c_str()));
+    const std::string done = dir.makeSubPath("done");
+    writeFile(done, "z");
+
+    ASSERT_TRUE(batches.waitFor(ChangeType::Created, done));
+    const auto all = batches.batches();
+    ASSERT_EQ(1u, all.size());
+    ASSERT_EQ(2u, all[0].size());
+    EXPECT_EQ(ChangeType::Created, all[0][0].type);
+    EXPECT_EQ(kept, all[0][0].path);
+    EXPECT_EQ(done, all[0][1].path);
+}
+
+TEST(FileSystemWatcher, Recursive) {
+    TestTempDir dir("fswatcher");
+    ASSERT_TRUE(dir.makeSubDir("old"));
+    Batches batches;
+    Options options;
+    options.recursive = true;
+    auto watcher = FileSystemWatcher::getFileSystemWatcher(
+            dir.pathString(), batches.callback(), options);
+    ASSERT_TRUE(watcher);
+    ASSERT_TRUE(watcher->start());
+
+    const std::string inOld = dir.makeSubPath("old/file");
+    writeFile(inOld, "a");
+    EXPECT_TRUE(batches.waitFor(ChangeType::Created, inOld));
+
+    ASSERT_TRUE(dir.makeSubDir("new"));
+    EXPECT_TRUE(batches.waitFor(ChangeType::Created, dir.makeSubPath("new")));
+    const std::string inNew = dir.makeSubPath("new/file");
+    writeFile(inNew, "b");
+    EXPECT_TRUE(batches.waitFor(ChangeType::Created, inNew));
+}
+
+// Tests that watchers of one directory share its watch, and that stopping
+// one leaves the other running.
+TEST(FileSystemWatcher, SharedDirectory) {
+    TestTempDir dir("fswatcher");
+    Batches first;
+    Batches second;
+    auto a = FileSystemWatcher::getFileSystemWatcher(dir.pathString(),
+                                                     first.callback(), {});
+    auto b = FileSystemWatcher::getFileSystemWatcher(dir.pathString(),
+                                                     second.callback(), {});
+    ASSERT_TRUE(a->start());
+    ASSERT_TRUE(b->start());
+
+    const std::string one = dir.makeSubPath("one");
+    writeFile(one, "1");
+    EXPECT_TRUE(first.waitFor(ChangeType::Created, one));
+    EXPECT_TRUE(second.waitFor(ChangeType::Created, one));
+
+    a->stop();
+    const size_t firstCount = first.batches().size();
+    const std::string two = dir.makeSubPath("two");
+    writeFile(two, "2");
+    EXPECT_TRUE(second.waitFor(ChangeType::Created, two));
+    EXPECT_EQ(firstCount, first.batches().size());
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
@@ -16,6 +16,7 @@
 #include "aemu/base/EintrWrapper.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -30,7 +31,13 @@
 #include <io.h>
 #endif
 
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#include <algorithm>
 #include <fstream>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -99,4 +106,106 @@ bool setFileSize(int fd, int64_t size) {
 #endif
 }
 
+std::vector<FileDataRange> getFileDataRanges(int fd, int64_t size) {
+    std::vector<FileDataRange> ranges;
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    int64_t pos = 0;
+    while (pos < size) {
+        const off_t data = lseek(fd, pos, SEEK_DATA);
+        if (data == (off_t)-1) {
+            if (errno == ENXIO) {
+                // Only a hole is left.
+                return ranges;
+            }
+            // No hole support here; treat it all as data.
+            ranges.clear();
+            break;
+        }
+        if (data >= size) {
+            return ranges;
+        }
+        off_t hole = lseek(fd, data, SEEK_HOLE);
+        if (hole == (off_t)-1) {
+            ranges.clear();
+            break;
+        }
+        hole = std::min<int64_t>(hole, size);
+        ranges.push_back({data, hole - data});
+        pos = hole;
+    }
+    if (pos >= size) {
+        return ranges;
+    }
+#endif
+    if (size > 0) {
+        ranges.push_back({0, size});
+    }
+    return ranges;
+}
+
+bool copyFileData(int srcFd, int64_t srcOffset, int dstFd, int64_t size) {
+#ifdef __linux__
+    // Both calls may refuse some pairs of files (across file systems, or
+    // with an old kernel); fall back to the next way then.
+    {
+        loff_t offset = srcOffset;
+        while (size > 0) {
+            const ssize_t n = HANDLE_EINTR(
+                    copy_file_range(srcFd, &offset, dstFd, nullptr, size, 0));
+            if (n <= 0) {
+                break;
+            }
+            size -= n;
+        }
+        srcOffset = offset;
+    }
+    {
+        off_t offset = srcOffset;
+        while (size > 0) {
+            const ssize_t n =
+                    HANDLE_EINTR(sendfile(dstFd, srcFd, &offset, size));
+            if (n <= 0) {
+                break;
+            }
+            size -= n;
+        }
+        srcOffset = offset;
+    }
+#endif
+    // Also rejects negative sizes, which the loops above leave alone.
+    if (size <= 0) {
+        return size == 0;
+    }
+    constexpr size_t kCopyBufferSize = 1 << 20;
+    const size_t bufferSize = std::min<int64_t>(size, kCopyBufferSize);
+    std::unique_ptr<char[]> buffer(new char[bufferSize]);
+    while (size > 0) {
+        const size_t chunk = std::min<int64_t>(size, bufferSize);
+#ifdef _WIN32
+        // No pread() here; seek and read instead.
+        if (lseek(srcFd, srcOffset, SEEK_SET) == (off_t)-1) {
+            return false;
+        }
+        const ssize_t n = HANDLE_EINTR(read(srcFd, buffer.get(), chunk));
+#else
+        const ssize_t n =
+                HANDLE_EINTR(pread(srcFd, buffer.get(), chunk, srcOffset));
+#endif
+        if (n <= 0) {
+            return false;
+        }
+        for (ssize_t written = 0; written < n;) {
+            const ssize_t w = HANDLE_EINTR(
+                    write(dstFd, buffer.get() + written, n - written));
+            if (w <= 0) {
+                return false;
+            }
+            written += w;
+        }
+        srcOffset += n;
+        size -= n;
+    }
+    return true;
+}
+
 }  // namespace android
@@ -89,4 +89,62 @@ TEST(FileUtils, fileToString) {
     }
 }
 
+// Tests that holes are skipped and every data byte is inside a range.
+TEST(FileUtils, dataRanges) {
+    TempFile* tf = tempfile_create();
+    ScopedFd fd(HANDLE_EINTR(open(tempfile_path(tf), O_RDWR, 0600)));
+    EXPECT_NE(-1, fd.get());
+
+    const int64_t size = 16 << 20;
+    const int64_t dataOffset = 8 << 20;
+    EXPECT_TRUE(setFileSize(fd.get(), size));
+    std::vector<char> data(100000, 'a');
+    EXPECT_EQ((ssize_t)data.size(),
+              HANDLE_EINTR(pwrite(fd.get(), data.data(), data.size(),
+                                  dataOffset)));
+
+    const auto ranges = getFileDataRanges(fd.get(), size);
+    ASSERT_FALSE(ranges.empty());
+    int64_t prevEnd = 0;
+    bool covered = false;
+    for (const auto& range : ranges) {
+        EXPECT_GE(range.offset, prevEnd);
+        EXPECT_LE(range.offset + range.size, size);
+        prevEnd = range.offset + range.size;
+        covered |= range.offset <= dataOffset &&
+                   dataOffset + (int64_t)data.size() <= prevEnd;
+    }
+    EXPECT_TRUE(covered);
+
+    tempfile_close(tf);
+}
+
+// Tests copying a range of one file to the end of another.
+TEST(FileUtils, copyFileData) {
+    TempFile* src = tempfile_create();
+    TempFile* dst = tempfile_create();
+    ScopedFd srcFd(HANDLE_EINTR(open(tempfile_path(src), O_RDWR, 0600)));
+    ScopedFd dstFd(HANDLE_EINTR(open(tempfile_path(dst), O_RDWR, 0600)));
+
+    std::string contents(3 << 20, 0);
+    for (size_t i = 0; i < contents.size(); ++i) {
+        contents[i] = char(i * 31);
+    }
+    EXPECT_TRUE(writeStringToFile(srcFd.get(), contents));
+    EXPECT_TRUE(writeStringToFile(dstFd.get(), "head"));
+
+    EXPECT_TRUE(copyFileData(srcFd.get(), 10, dstFd.get(),
+                             contents.size() - 20));
+    EXPECT_TRUE(copyFileData(srcFd.get(), 0, dstFd.get(), 0));
+    EXPECT_FALSE(copyFileData(srcFd.get(), 0, dstFd.get(), -1));
+    dstFd.close();
+
+    const auto copied = readFileIntoString(tempfile_path(dst));
+    EXPECT_TRUE(copied);
+    EXPECT_EQ("head" + contents.substr(10, contents.size() - 20), *copied);
+
+    tempfile_close(src);
+    tempfile_close(dst);
+}
+
 }  // namespace android
@@ -0,0 +1,103 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/containers/FlatMap.h"
+
+#include "benchmark/benchmark.h"
+
+#include <map>
+#include <unordered_map>
+
+#include <stdint.h>
+
+namespace android {
+namespace base {
+namespace {
+
+// Sparse keys, like guest addresses.
+uint64_t keyOf(int64_t i) {
+    return 0x100000000ull + uint64_t(i) * 0x3000;
+}
+
+template <class Map>
+Map makeMap(int64_t size) {
+    Map map;
+    for (int64_t i = 0; i < size; ++i) {
+        map.emplace(keyOf(i), uint64_t(i));
+    }
+    return map;
+}
+
+template <class Map>
+void BM_Find(benchmark::State& state) {
+    const Map map = makeMap<Map>(state.range(0));
+    int64_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(map.find(keyOf(i)));
+        i = (i + 7) % state.range(0);
+    }
+}
+BENCHMARK_TEMPLATE(BM_Find, std::map<uint64_t, uint64_t>)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_Find, FlatMap<uint64_t, uint64_t>)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_Find, std::unordered_map<uint64_t, uint64_t>)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_Find, FlatHashMap<uint64_t, uint64_t>)->Range(8, 4096);
+
+template <class Map>
+void BM_FindMiss(benchmark::State& state) {
+    const Map map = makeMap<Map>(state.range(0));
+    int64_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(map.find(keyOf(i) + 1));
+        i = (i + 7) % state.range(0);
+    }
+}
+BENCHMARK_TEMPLATE(BM_FindMiss, std::unordered_map<uint64_t, uint64_t>)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_FindMiss, FlatHashMap<uint64_t, uint64_t>)->Range(8, 4096);
+
+template <class Map>
+void BM_Iterate(benchmark::State& state) {
+    const Map map = makeMap<Map>(state.range(0));
+    for (auto _ : state) {
+        uint64_t sum = 0;
+        for (const auto& entry : map) {
+            sum += entry.second;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK_TEMPLATE(BM_Iterate, std::map<uint64_t, uint64_t>)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_Iterate, FlatMap<uint64_t, uint64_t>)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_Iterate, std::unordered_map<uint64_t, uint64_t>)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_Iterate, FlatHashMap<uint64_t, uint64_t>)->Range(8, 4096);
+
+// Adding and removing one entry, like a pipe wake or a DMA buffer.
+template <class Map>
+void BM_InsertErase(benchmark::State& state) {
+    Map map = makeMap<Map>(state.range(0));
+    int64_t i = 0;
+    for (auto _ : state) {
+        const uint64_t key = keyOf(i) + 1;
+        map.emplace(key, uint64_t(i));
+        map.erase(key);
+        i = (i + 7) % state.range(0);
+    }
+}
+BENCHMARK_TEMPLATE(BM_InsertErase, std::map<uint64_t, uint64_t>)->Range(8, 512);
+BENCHMARK_TEMPLATE(BM_InsertErase, FlatMap<uint64_t, uint64_t>)->Range(8, 512);
+BENCHMARK_TEMPLATE(BM_InsertErase, std::unordered_map<uint64_t, uint64_t>)->Range(8, 512);
+BENCHMARK_TEMPLATE(BM_InsertErase, FlatHashMap<uint64_t, uint64_t>)->Range(8, 512);
+
+}  // namespace
+}  // namespace base
+}  // namespace android
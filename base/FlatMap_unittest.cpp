@@ -0,0 +1,225 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/containers/FlatMap.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "aemu/base/containers/Lookup.h"
+
+namespace android {
+namespace base {
+namespace {
+
+// Tests the std::map operations FlatMap stands in for.
+TEST(FlatMap, Basic) {
+    FlatMap<int, std::string> map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_TRUE(map.emplace(3, "three").second);
+    EXPECT_TRUE(map.insert({1, "one"}).second);
+    map[2] = "two";
+    EXPECT_FALSE(map.try_emplace(2, "deux").second);
+    EXPECT_FALSE(map.insert_or_assign(1, "un").second);
+    EXPECT_EQ(3u, map.size());
+
+    std::string joined;
+    for (const auto& entry : map) {
+        joined += std::to_string(entry.first) + entry.second;
+    }
+    EXPECT_EQ("1un2two3three", joined);
+
+    EXPECT_EQ(2, map.lower_bound(2)->first);
+    EXPECT_EQ(3, map.upper_bound(2)->first);
+    EXPECT_EQ(map.end(), map.upper_bound(3));
+    EXPECT_EQ(1u, map.count(3));
+    EXPECT_FALSE(map.contains(4));
+    ASSERT_TRUE(find(map, 3));
+    EXPECT_EQ("three", *find(map, 3));
+
+    EXPECT_EQ(1u, map.erase(2));
+    EXPECT_EQ(0u, map.erase(2));
+    auto next = map.erase(map.begin());
+    EXPECT_EQ(3, next->first);
+    EXPECT_EQ(1u, map.size());
+
+    FlatMap<int, std::string> copy = map;
+    EXPECT_EQ(copy, map);
+    copy.clear();
+    EXPECT_NE(copy, map);
+}
+
+// Tests that values need only be movable.
+TEST(FlatMap, MoveOnly) {
+    FlatMap<int, std::unique_ptr<int>> map;
+    for (int i = 10; i > 0; --i) {
+        map.emplace(i, std::make_unique<int>(i * i));
+    }
+    map.try_emplace(11, std::make_unique<int>(121));
+    int key = 1;
+    for (const auto& entry : map) {
+        EXPECT_EQ(key, entry.first);
+        EXPECT_EQ(key * key, *entry.second);
+        ++key;
+    }
+}
+
+// Tests FlatHashMap against std::unordered_map through a long run of mixed
+// inserts, lookups and erases, so that tables grow, fill with deleted slots
+// and get swept.
+TEST(FlatHashMap, MatchesUnorderedMap) {
+    std::mt19937 random(42);
+    FlatHashMap<uint64_t, uint64_t> map;
+    std::unordered_map<uint64_t, uint64_t> expected;
+    for (int i = 0; i < 200000; ++i) {
+        // Few distinct keys, so that lookups hit and erases find something.
+        const uint64_t key = random() % 3000;
+        switch (random() % 4) {
+            case 0:
+            case 1: {
+                const auto result = map.emplace(key, uint64_t(i));
+                EXPECT_EQ(expected.emplace(key, i).second, result.second);
+                EXPECT_EQ(expected[key], result.first->second);
+                break;
+            }
+            case 2:
+                EXPECT_EQ(expected.erase(key), map.erase(key));
+                break;
+            case 3: {
+                const auto it = map.find(key);
+                const auto expectedIt = expected.find(key);
+                ASSERT_EQ(expectedIt == expected.end(), it == map.end());
+                if (it != map.end()) {
+                    EXPECT_EQ(expectedIt->second, it->second);
+                }
+                break;
+            }
+        }
+        ASSERT_EQ(expected.size(), map.size());
+    }
+
+    size_t seen = 0;
+    for (const auto& entry : map) {
+        ASSERT_EQ(expected[entry.first], entry.second);
+        ++seen;
+    }
+    EXPECT_EQ(expected.size(), seen);
+}
+
+// Tests FlatMap against std::map the same way, comparing whole contents.
+TEST(FlatMap, MatchesMap) {
+    std::mt19937 random(7);
+    FlatMap<uint32_t, uint32_t> map;
+    std::map<uint32_t, uint32_t> expected;
+    for (int i = 0; i < 20000; ++i) {
+        const uint32_t key = random() % 300;
+        if (random() % 3) {
+            EXPECT_EQ(expected.emplace(key, i).second, map.emplace(key, i).second);
+        } else {
+            EXPECT_EQ(expected.erase(key), map.erase(key));
+        }
+    }
+    ASSERT_EQ(expected.size(), map.size());
+    EXPECT_TRUE(std::equal(map.begin(), map.end(), expected.begin(),
+                           [](const auto& a, const auto& b) {
+                               return a.first == b.first && a.second == b.second;
+                           }));
+}
+
+// Tests erasing while walking, the way callers drain a map.
+TEST(FlatHashMap, EraseWhileIterating) {
+    FlatHashMap<int, int> map;
+    for (int i = 0; i < 1000; ++i) {
+        map[i] = i;
+    }
+    for (auto it = map.begin(); it != map.end();) {
+        if (it->first % 3) {
+            it = map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    EXPECT_EQ(334u, map.size());
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(i % 3 == 0, map.contains(i)) << i;
+    }
+}
+
+// Tests that a table that only ever holds a few keys doesn't grow while
+// keys come and go.
+TEST(FlatHashMap, ChurnDoesNotGrow) {
+    FlatHashMap<uint64_t, int> map;
+    for (uint64_t i = 0; i < 100000; ++i) {
+        map.emplace(i, 0);
+        if (i >= 4) {
+            map.erase(i - 4);
+        }
+    }
+    EXPECT_EQ(4u, map.size());
+    EXPECT_EQ(16u, map.capacity());
+}
+
+// Tests copies, moves and swaps, and values with destructors.
+TEST(FlatHashMap, CopyAndMove) {
+    FlatHashMap<std::string, std::shared_ptr<int>> map;
+    auto shared = std::make_shared<int>(5);
+    for (int i = 0; i < 100; ++i) {
+        map.emplace(std::to_string(i), shared);
+    }
+    EXPECT_EQ(101, shared.use_count());
+
+    FlatHashMap<std::string, std::shared_ptr<int>> copy(map);
+    EXPECT_EQ(201, shared.use_count());
+    EXPECT_EQ(copy, map);
+
+    FlatHashMap<std::string, std::shared_ptr<int>> moved(std::move(copy));
+    EXPECT_TRUE(copy.empty());
+    EXPECT_EQ(201, shared.use_count());
+    ASSERT_TRUE(find(moved, "42"));
+
+    moved.erase("42");
+    EXPECT_NE(moved, map);
+    moved.swap(map);
+    EXPECT_EQ(99u, map.size());
+    EXPECT_EQ(100u, moved.size());
+
+    moved = map;
+    EXPECT_EQ(map, moved);
+    map.clear();
+    moved.clear();
+    EXPECT_EQ(1, shared.use_count());
+    moved["after clear"] = shared;
+    EXPECT_EQ(1u, moved.size());
+}
+
+// Tests an empty map, which has no table at all.
+TEST(FlatHashMap, Empty) {
+    const FlatHashMap<int, int> map;
+    EXPECT_EQ(map.begin(), map.end());
+    EXPECT_EQ(map.end(), map.find(1));
+    EXPECT_FALSE(find(map, 1));
+    FlatHashMap<int, int> other;
+    other.reserve(100);
+    EXPECT_EQ(map, other);
+    EXPECT_EQ(0u, other.erase(1));
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
@@ -25,6 +25,12 @@ FunctorThread::FunctorThread(Functor&& func, ThreadFlags flags)
     assert(mThreadFunc);
 }
 
+FunctorThread::FunctorThread(Functor&& func, ThreadOptions options)
+    : Thread(std::move(options))
+    , mThreadFunc(std::move(func)) {
+    assert(mThreadFunc);
+}
+
 intptr_t FunctorThread::main() {
     return mThreadFunc();
 }
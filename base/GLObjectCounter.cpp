@@ -13,8 +13,10 @@
 // limitations under the License.
 #include "aemu/base/GLObjectCounter.h"
 
+#include "aemu/base/ShardedCounter.h"
+#include "aemu/base/StatsPage.h"
+
 #include <array>
-#include <atomic>
 #include <sstream>
 
 namespace android {
@@ -40,54 +42,77 @@ static constexpr size_t toIndex(NamedObjectType type) {
 
 class GLObjectCounter::Impl {
 public:
+    Impl() {
+        static constexpr const char* kStatNames[] = {
+                nullptr,
+                "gl.vertex_buffers",
+                "gl.textures",
+                "gl.renderbuffers",
+                "gl.framebuffers",
+                "gl.shaders_and_programs",
+                "gl.samplers",
+                "gl.queries",
+                "gl.vertex_array_objects",
+                "gl.transform_feedbacks",
+        };
+        static_assert(sizeof(kStatNames) / sizeof(kStatNames[0]) ==
+                              toIndex(NamedObjectType::NUM_OBJECT_TYPES),
+                      "one stat per object type");
+        for (size_t i = 1; i < mStats.size(); ++i) {
+            mStats[i] = StatsPage::get().add(kStatNames[i], StatKind::kGauge);
+        }
+    }
+
     void incCount(size_t type) {
         if (type > toIndex(NamedObjectType::NULLTYPE) &&
             type < toIndex(NamedObjectType::NUM_OBJECT_TYPES)) {
-            mCounter[type] += 1;
+            if (mCounter.add(type, 1)) {
+                getCounts();
+            }
         }
     }
 
     void decCount(size_t type) {
         if (type > toIndex(NamedObjectType::NULLTYPE) &&
             type < toIndex(NamedObjectType::NUM_OBJECT_TYPES)) {
-            mCounter[type] -= 1;
+            if (mCounter.add(type, -1)) {
+                getCounts();
+            }
         }
     }
 
+    // Also refreshes the gauges.
     std::vector<size_t> getCounts() {
+        const std::vector<int64_t> totals = mCounter.sum();
         std::vector<size_t> v;
-        for (auto& it : mCounter) {
-            v.push_back(it.load());
+        for (size_t i = 0; i < totals.size(); ++i) {
+            mStats[i].set(totals[i]);
+            v.push_back(static_cast<size_t>(totals[i]));
         }
         return v;
     }
 
     std::string printUsage() {
+        const std::vector<size_t> c = getCounts();
         std::stringstream ss;
-        ss << "VertexBuffer: "
-           << mCounter[toIndex(NamedObjectType::VERTEXBUFFER)].load();
-        ss << " Texture: "
-           << mCounter[toIndex(NamedObjectType::TEXTURE)].load();
-        ss << " RenderBuffer: "
-           << mCounter[toIndex(NamedObjectType::RENDERBUFFER)].load();
-        ss << " FrameBuffer: "
-           << mCounter[toIndex(NamedObjectType::FRAMEBUFFER)].load();
+        ss << "VertexBuffer: " << c[toIndex(NamedObjectType::VERTEXBUFFER)];
+        ss << " Texture: " << c[toIndex(NamedObjectType::TEXTURE)];
+        ss << " RenderBuffer: " << c[toIndex(NamedObjectType::RENDERBUFFER)];
+        ss << " FrameBuffer: " << c[toIndex(NamedObjectType::FRAMEBUFFER)];
         ss << " ShaderOrProgram: "
-           << mCounter[toIndex(NamedObjectType::SHADER_OR_PROGRAM)].load();
-        ss << " Sampler: "
-           << mCounter[toIndex(NamedObjectType::SAMPLER)].load();
-        ss << " Query: " << mCounter[toIndex(NamedObjectType::QUERY)].load();
+           << c[toIndex(NamedObjectType::SHADER_OR_PROGRAM)];
+        ss << " Sampler: " << c[toIndex(NamedObjectType::SAMPLER)];
+        ss << " Query: " << c[toIndex(NamedObjectType::QUERY)];
         ss << " VertexArrayObject: "
-           << mCounter[toIndex(NamedObjectType::VERTEX_ARRAY_OBJECT)].load();
+           << c[toIndex(NamedObjectType::VERTEX_ARRAY_OBJECT)];
         ss << " TransformFeedback: "
-           << mCounter[toIndex(NamedObjectType::TRANSFORM_FEEDBACK)].load()
-           << "\n";
+           << c[toIndex(NamedObjectType::TRANSFORM_FEEDBACK)] << "\n";
         return ss.str();
     }
 
 private:
-    std::array<std::atomic<size_t>, toIndex(NamedObjectType::NUM_OBJECT_TYPES)>
-            mCounter = {};
+    ShardedCounter mCounter{toIndex(NamedObjectType::NUM_OBJECT_TYPES)};
+    std::array<Stat, toIndex(NamedObjectType::NUM_OBJECT_TYPES)> mStats;
 };
 
 static GLObjectCounter* sGlobal() {
@@ -97,6 +122,8 @@ static GLObjectCounter* sGlobal() {
 
 GLObjectCounter::GLObjectCounter() : mImpl(new GLObjectCounter::Impl()) {}
 
+GLObjectCounter::~GLObjectCounter() = default;
+
 void GLObjectCounter::incCount(size_t type) {
     mImpl->incCount(type);
 }
@@ -13,8 +13,10 @@
 // limitations under the License.
 #include "aemu/base/GraphicsObjectCounter.h"
 
+#include "aemu/base/ShardedCounter.h"
+#include "aemu/base/StatsPage.h"
+
 #include <array>
-#include <atomic>
 #include <iostream>
 #include <sstream>
 
@@ -23,37 +25,52 @@ namespace base {
 
 class GraphicsObjectCounter::Impl {
    public:
+    Impl() {
+        mStats[toIndex(GraphicsObjectType::COLORBUFFER)] =
+            StatsPage::get().add("graphics.colorbuffers", StatKind::kGauge);
+    }
+
     void incCount(size_t type) {
         if (type > toIndex(GraphicsObjectType::NULLTYPE) &&
             type < toIndex(GraphicsObjectType::NUM_OBJECT_TYPES)) {
-            mCounter[type] += 1;
+            if (mCounter.add(type, 1)) {
+                getCounts();
+            }
         }
     }
 
     void decCount(size_t type) {
         if (type > toIndex(GraphicsObjectType::NULLTYPE) &&
             type < toIndex(GraphicsObjectType::NUM_OBJECT_TYPES)) {
-            mCounter[type] -= 1;
+            if (mCounter.add(type, -1)) {
+                getCounts();
+            }
         }
     }
 
+    // Also refreshes the gauges, so they are never staler than the last
+    // read.
     std::vector<size_t> getCounts() {
+        const std::vector<int64_t> totals = mCounter.sum();
         std::vector<size_t> v;
-        for (auto& it : mCounter) {
-            v.push_back(it.load());
+        for (size_t i = 0; i < totals.size(); ++i) {
+            mStats[i].set(totals[i]);
+            v.push_back(static_cast<size_t>(totals[i]));
         }
         return v;
     }
 
     std::string printUsage() {
+        const std::vector<size_t> counts = getCounts();
         std::stringstream ss;
-        ss << "ColorBuffer: " << mCounter[toIndex(GraphicsObjectType::COLORBUFFER)].load();
+        ss << "ColorBuffer: " << counts[toIndex(GraphicsObjectType::COLORBUFFER)];
         // TODO: Fill with the rest of the counters we are interested in
         return ss.str();
     }
 
    private:
-    std::array<std::atomic<size_t>, toIndex(GraphicsObjectType::NUM_OBJECT_TYPES)> mCounter = {};
+    ShardedCounter mCounter{toIndex(GraphicsObjectType::NUM_OBJECT_TYPES)};
+    std::array<Stat, toIndex(GraphicsObjectType::NUM_OBJECT_TYPES)> mStats;
 };
 
 static GraphicsObjectCounter* sGlobal() {
@@ -63,6 +80,8 @@ static GraphicsObjectCounter* sGlobal() {
 
 GraphicsObjectCounter::GraphicsObjectCounter() : mImpl(new GraphicsObjectCounter::Impl()) {}
 
+GraphicsObjectCounter::~GraphicsObjectCounter() = default;
+
 void GraphicsObjectCounter::incCount(size_t type) { mImpl->incCount(type); }
 
 void GraphicsObjectCounter::decCount(size_t type) { mImpl->decCount(type); }
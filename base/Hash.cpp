@@ -0,0 +1,1049 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/Hash.h"
+
+#include "aemu/base/system/System.h"
+#include "aemu/base/threads/ParallelFor.h"
+#include "aemu/base/threads/ThreadPool.h"
+
+#include <algorithm>
+#include <functional>
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define HASH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC allows any intrinsic without per-function target flags.
+#define HASH_TARGET(isa)
+#else
+#define HASH_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define HASH_NEON 1
+#include <arm_neon.h>
+#if defined(__ARM_FEATURE_CRC32) || defined(_M_ARM64)
+#define HASH_ARM_CRC_TARGET
+#else
+#define HASH_ARM_CRC_TARGET __attribute__((target("+crc")))
+#endif
+#if defined(_M_ARM64)
+#include <intrin.h>
+#else
+#include <arm_acle.h>
+#endif
+#if defined(__linux__)
+#include <sys/auxv.h>
+#endif
+#endif
+
+namespace android {
+namespace base {
+namespace {
+
+// XXH3, following the xxHash reference implementation.
+
+constexpr uint32_t kPrime32_1 = 0x9E3779B1U;
+constexpr uint32_t kPrime32_2 = 0x85EBCA77U;
+constexpr uint32_t kPrime32_3 = 0xC2B2AE3DU;
+constexpr uint64_t kPrime64_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime64_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime64_5 = 0x27D4EB2F165667C5ULL;
+constexpr uint64_t kPrimeMx1 = 0x165667919E3779F9ULL;
+constexpr uint64_t kPrimeMx2 = 0x9FB21C651E98DF25ULL;
+
+constexpr size_t kStripeSize = 64;
+constexpr size_t kSecretConsumeRate = 8;
+constexpr size_t kSecretSize = 192;
+constexpr size_t kSecretSizeMin = 136;
+constexpr size_t kMidSizeMax = 240;
+constexpr size_t kMidSizeStartOffset = 3;
+constexpr size_t kMidSizeLastOffset = 17;
+constexpr size_t kSecretLastAccStart = 7;
+constexpr size_t kSecretMergeAccsStart = 11;
+// The last 64 bytes of the secret scramble the accumulators.
+constexpr size_t kSecretLimit = kSecretSize - kStripeSize;
+constexpr size_t kStripesPerBlock = kSecretLimit / kSecretConsumeRate;
+constexpr size_t kBlockSize = kStripeSize * kStripesPerBlock;
+constexpr size_t kBufferSize = 256;
+constexpr size_t kBufferStripes = kBufferSize / kStripeSize;
+
+alignas(64) constexpr uint8_t kSecret[kSecretSize] = {
+        0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+        0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+        0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+        0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+        0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+        0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+        0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+        0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+        0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+        0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+        0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+        0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+        0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+        0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+        0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+        0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+constexpr uint64_t kInitAcc[8] = {kPrime32_3, kPrime64_1, kPrime64_2,
+                                  kPrime64_3, kPrime64_4, kPrime32_2,
+                                  kPrime64_5, kPrime32_1};
+
+inline uint32_t swap32(uint32_t v) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _byteswap_ulong(v);
+#else
+    return __builtin_bswap32(v);
+#endif
+}
+
+inline uint64_t swap64(uint64_t v) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _byteswap_uint64(v);
+#else
+    return __builtin_bswap64(v);
+#endif
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+inline uint32_t fromLE32(uint32_t v) {
+    return swap32(v);
+}
+inline uint64_t fromLE64(uint64_t v) {
+    return swap64(v);
+}
+#else
+inline uint32_t fromLE32(uint32_t v) {
+    return v;
+}
+inline uint64_t fromLE64(uint64_t v) {
+    return v;
+}
+#endif
+
+inline uint32_t readLE32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return fromLE32(v);
+}
+
+inline uint64_t readLE64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return fromLE64(v);
+}
+
+inline void writeLE64(uint8_t* p, uint64_t v) {
+    v = fromLE64(v);
+    memcpy(p, &v, sizeof(v));
+}
+
+inline uint32_t rotl32(uint32_t v, int r) {
+    return (v << r) | (v >> (32 - r));
+}
+
+inline uint64_t rotl64(uint64_t v, int r) {
+    return (v << r) | (v >> (64 - r));
+}
+
+inline Hash128 mult64to128(uint64_t lhs, uint64_t rhs) {
+#if defined(__SIZEOF_INT128__)
+    const unsigned __int128 product = (unsigned __int128)lhs * rhs;
+    return {static_cast<uint64_t>(product),
+            static_cast<uint64_t>(product >> 64)};
+#else
+    const uint64_t loLo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+    const uint64_t hiLo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+    const uint64_t loHi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+    const uint64_t hiHi = (lhs >> 32) * (rhs >> 32);
+    const uint64_t cross = (loLo >> 32) + (hiLo & 0xFFFFFFFF) + loHi;
+    const uint64_t upper = (hiLo >> 32) + (cross >> 32) + hiHi;
+    const uint64_t lower = (cross << 32) | (loLo & 0xFFFFFFFF);
+    return {lower, upper};
+#endif
+}
+
+inline uint64_t mul128Fold64(uint64_t lhs, uint64_t rhs) {
+    const Hash128 product = mult64to128(lhs, rhs);
+    return product.low ^ product.high;
+}
+
+inline uint64_t xorshift64(uint64_t v, int shift) {
+    return v ^ (v >> shift);
+}
+
+uint64_t xxh64Avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= kPrime64_2;
+    h ^= h >> 29;
+    h *= kPrime64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t avalanche(uint64_t h) {
+    h = xorshift64(h, 37);
+    h *= kPrimeMx1;
+    return xorshift64(h, 32);
+}
+
+uint64_t rrmxmx(uint64_t h, uint64_t len) {
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= kPrimeMx2;
+    h ^= (h >> 35) + len;
+    h *= kPrimeMx2;
+    return xorshift64(h, 28);
+}
+
+inline uint64_t mix16B(const uint8_t* input,
+                       const uint8_t* secret,
+                       uint64_t seed) {
+    return mul128Fold64(readLE64(input) ^ (readLE64(secret) + seed),
+                        readLE64(input + 8) ^ (readLE64(secret + 8) - seed));
+}
+
+uint64_t hash0to16(const uint8_t* input,
+                   size_t len,
+                   const uint8_t* secret,
+                   uint64_t seed) {
+    if (len > 8) {
+        const uint64_t bitflip1 =
+                (readLE64(secret + 24) ^ readLE64(secret + 32)) + seed;
+        const uint64_t bitflip2 =
+                (readLE64(secret + 40) ^ readLE64(secret + 48)) - seed;
+        const uint64_t lo = readLE64(input) ^ bitflip1;
+        const uint64_t hi = readLE64(input + len - 8) ^ bitflip2;
+        return avalanche(len + swap64(lo) + hi + mul128Fold64(lo, hi));
+    }
+    if (len >= 4) {
+        seed ^= uint64_t(swap32(uint32_t(seed))) << 32;
+        const uint64_t bitflip =
+                (readLE64(secret + 8) ^ readLE64(secret + 16)) - seed;
+        const uint64_t input64 =
+                readLE32(input + len - 4) + (uint64_t(readLE32(input)) << 32);
+        return rrmxmx(input64 ^ bitflip, len);
+    }
+    if (len) {
+        const uint32_t combined =
+                (uint32_t(input[0]) << 16) | (uint32_t(input[len >> 1]) << 24) |
+                uint32_t(input[len - 1]) | (uint32_t(len) << 8);
+        const uint64_t bitflip =
+                (readLE32(secret) ^ readLE32(secret + 4)) + seed;
+        return xxh64Avalanche(combined ^ bitflip);
+    }
+    return xxh64Avalanche(seed ^ readLE64(secret + 56) ^ readLE64(secret + 64));
+}
+
+uint64_t hash17to128(const uint8_t* input,
+                     size_t len,
+                     const uint8_t* secret,
+                     uint64_t seed) {
+    uint64_t acc = len * kPrime64_1;
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc += mix16B(input + 48, secret + 96, seed);
+                acc += mix16B(input + len - 64, secret + 112, seed);
+            }
+            acc += mix16B(input + 32, secret + 64, seed);
+            acc += mix16B(input + len - 48, secret + 80, seed);
+        }
+        acc += mix16B(input + 16, secret + 32, seed);
+        acc += mix16B(input + len - 32, secret + 48, seed);
+    }
+    acc += mix16B(input, secret, seed);
+    acc += mix16B(input + len - 16, secret + 16, seed);
+    return avalanche(acc);
+}
+
+uint64_t hash129to240(const uint8_t* input,
+                      size_t len,
+                      const uint8_t* secret,
+                      uint64_t seed) {
+    uint64_t acc = len * kPrime64_1;
+    for (size_t i = 0; i < 8; ++i) {
+        acc += mix16B(input + 16 * i, secret + 16 * i, seed);
+    }
+    uint64_t accEnd = mix16B(input + len - 16,
+                             secret + kSecretSizeMin - kMidSizeLastOffset, seed);
+    acc = avalanche(acc);
+    const size_t rounds = len / 16;
+    for (size_t i = 8; i < rounds; ++i) {
+        accEnd += mix16B(input + 16 * i,
+                         secret + 16 * (i - 8) + kMidSizeStartOffset, seed);
+    }
+    return avalanche(acc + accEnd);
+}
+
+Hash128 hash0to16_128(const uint8_t* input,
+                      size_t len,
+                      const uint8_t* secret,
+                      uint64_t seed) {
+    if (len > 8) {
+        const uint64_t bitflipl =
+                (readLE64(secret + 32) ^ readLE64(secret + 40)) - seed;
+        const uint64_t bitfliph =
+                (readLE64(secret + 48) ^ readLE64(secret + 56)) + seed;
+        const uint64_t lo = readLE64(input);
+        uint64_t hi = readLE64(input + len - 8);
+        Hash128 m = mult64to128(lo ^ hi ^ bitflipl, kPrime64_1);
+        m.low += uint64_t(len - 1) << 54;
+        hi ^= bitfliph;
+        m.high += hi + uint64_t(uint32_t(hi)) * (kPrime32_2 - 1);
+        m.low ^= swap64(m.high);
+        Hash128 h = mult64to128(m.low, kPrime64_2);
+        h.high += m.high * kPrime64_2;
+        return {avalanche(h.low), avalanche(h.high)};
+    }
+    if (len >= 4) {
+        seed ^= uint64_t(swap32(uint32_t(seed))) << 32;
+        const uint64_t input64 =
+                readLE32(input) + (uint64_t(readLE32(input + len - 4)) << 32);
+        const uint64_t bitflip =
+                (readLE64(secret + 16) ^ readLE64(secret + 24)) + seed;
+        Hash128 m = mult64to128(input64 ^ bitflip, kPrime64_1 + (len << 2));
+        m.high += m.low << 1;
+        m.low ^= m.high >> 3;
+        m.low = xorshift64(m.low, 35);
+        m.low *= kPrimeMx2;
+        m.low = xorshift64(m.low, 28);
+        m.high = avalanche(m.high);
+        return m;
+    }
+    if (len) {
+        const uint32_t combinedl =
+                (uint32_t(input[0]) << 16) | (uint32_t(input[len >> 1]) << 24) |
+                uint32_t(input[len - 1]) | (uint32_t(len) << 8);
+        const uint32_t combinedh = rotl32(swap32(combinedl), 13);
+        const uint64_t bitflipl =
+                (readLE32(secret) ^ readLE32(secret + 4)) + seed;
+        const uint64_t bitfliph =
+                (readLE32(secret + 8) ^ readLE32(secret + 12)) - seed;
+        return {xxh64Avalanche(combinedl ^ bitflipl),
+                xxh64Avalanche(combinedh ^ bitfliph)};
+    }
+    return {xxh64Avalanche(seed ^ readLE64(secret + 64) ^ readLE64(secret + 72)),
+            xxh64Avalanche(seed ^ readLE64(secret + 80) ^ readLE64(secret + 88))};
+}
+
+inline Hash128 mix32B(Hash128 acc,
+                      const uint8_t* input1,
+                      const uint8_t* input2,
+                      const uint8_t* secret,
+                      uint64_t seed) {
+    acc.low += mix16B(input1, secret, seed);
+    acc.low ^= readLE64(input2) + readLE64(input2 + 8);
+    acc.high += mix16B(input2, secret + 16, seed);
+    acc.high ^= readLE64(input1) + readLE64(input1 + 8);
+    return acc;
+}
+
+Hash128 finish128(Hash128 acc, size_t len, uint64_t seed) {
+    const uint64_t low = acc.low + acc.high;
+    const uint64_t high = acc.low * kPrime64_1 + acc.high * kPrime64_4 +
+                          (len - seed) * kPrime64_2;
+    return {avalanche(low), uint64_t(0) - avalanche(high)};
+}
+
+Hash128 hash17to128_128(const uint8_t* input,
+                        size_t len,
+                        const uint8_t* secret,
+                        uint64_t seed) {
+    Hash128 acc = {len * kPrime64_1, 0};
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc = mix32B(acc, input + 48, input + len - 64, secret + 96,
+                             seed);
+            }
+            acc = mix32B(acc, input + 32, input + len - 48, secret + 64, seed);
+        }
+        acc = mix32B(acc, input + 16, input + len - 32, secret + 32, seed);
+    }
+    acc = mix32B(acc, input, input + len - 16, secret, seed);
+    return finish128(acc, len, seed);
+}
+
+Hash128 hash129to240_128(const uint8_t* input,
+                         size_t len,
+                         const uint8_t* secret,
+                         uint64_t seed) {
+    Hash128 acc = {len * kPrime64_1, 0};
+    for (size_t i = 32; i < 160; i += 32) {
+        acc = mix32B(acc, input + i - 32, input + i - 16, secret + i - 32,
+                     seed);
+    }
+    acc = {avalanche(acc.low), avalanche(acc.high)};
+    for (size_t i = 160; i <= len; i += 32) {
+        acc = mix32B(acc, input + i - 32, input + i - 16,
+                     secret + kMidSizeStartOffset + i - 160, seed);
+    }
+    acc = mix32B(acc, input + len - 16, input + len - 32,
+                 secret + kSecretSizeMin - kMidSizeLastOffset - 16,
+                 uint64_t(0) - seed);
+    return finish128(acc, len, seed);
+}
+
+// The long input kernels: accumulate() folds |stripes| 64-byte stripes into
+// the eight accumulators, moving 8 bytes along the secret per stripe, and
+// scramble() mixes them at the end of each block.
+struct Xxh3Kernels {
+    void (*accumulate)(uint64_t* acc,
+                       const uint8_t* input,
+                       const uint8_t* secret,
+                       size_t stripes);
+    void (*scramble)(uint64_t* acc, const uint8_t* secret);
+};
+
+void accumulateScalar(uint64_t* acc,
+                      const uint8_t* input,
+                      const uint8_t* secret,
+                      size_t stripes) {
+    for (size_t n = 0; n < stripes; ++n) {
+        const uint8_t* in = input + n * kStripeSize;
+        const uint8_t* key = secret + n * kSecretConsumeRate;
+        for (size_t lane = 0; lane < 8; ++lane) {
+            const uint64_t data = readLE64(in + lane * 8);
+            const uint64_t dataKey = data ^ readLE64(key + lane * 8);
+            acc[lane ^ 1] += data;
+            acc[lane] += (dataKey & 0xFFFFFFFF) * (dataKey >> 32);
+        }
+    }
+}
+
+void scrambleScalar(uint64_t* acc, const uint8_t* secret) {
+    for (size_t lane = 0; lane < 8; ++lane) {
+        uint64_t a = xorshift64(acc[lane], 47);
+        a ^= readLE64(secret + lane * 8);
+        acc[lane] = a * kPrime32_1;
+    }
+}
+
+constexpr Xxh3Kernels kScalarXxh3Kernels = {&accumulateScalar,
+                                            &scrambleScalar};
+
+#if HASH_X86
+
+HASH_TARGET("sse2")
+void accumulateSse2(uint64_t* acc,
+                    const uint8_t* input,
+                    const uint8_t* secret,
+                    size_t stripes) {
+    __m128i a[4];
+    for (int i = 0; i < 4; ++i) {
+        a[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc) + i);
+    }
+    for (size_t n = 0; n < stripes; ++n) {
+        const __m128i* in =
+                reinterpret_cast<const __m128i*>(input + n * kStripeSize);
+        const __m128i* key = reinterpret_cast<const __m128i*>(
+                secret + n * kSecretConsumeRate);
+        for (int i = 0; i < 4; ++i) {
+            const __m128i data = _mm_loadu_si128(in + i);
+            const __m128i dataKey = _mm_xor_si128(data, _mm_loadu_si128(key + i));
+            const __m128i dataKeyHi =
+                    _mm_shuffle_epi32(dataKey, _MM_SHUFFLE(0, 3, 0, 1));
+            const __m128i product = _mm_mul_epu32(dataKey, dataKeyHi);
+            const __m128i swapped =
+                    _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            a[i] = _mm_add_epi64(product, _mm_add_epi64(a[i], swapped));
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc) + i, a[i]);
+    }
+}
+
+HASH_TARGET("sse2")
+void scrambleSse2(uint64_t* acc, const uint8_t* secret) {
+    const __m128i prime = _mm_set1_epi32(int(kPrime32_1));
+    for (int i = 0; i < 4; ++i) {
+        __m128i* lane = reinterpret_cast<__m128i*>(acc) + i;
+        __m128i a = _mm_loadu_si128(lane);
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(
+                a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+        const __m128i hi = _mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1));
+        const __m128i productLo = _mm_mul_epu32(a, prime);
+        const __m128i productHi = _mm_mul_epu32(hi, prime);
+        _mm_storeu_si128(lane, _mm_add_epi64(productLo,
+                                             _mm_slli_epi64(productHi, 32)));
+    }
+}
+
+HASH_TARGET("avx2")
+void accumulateAvx2(uint64_t* acc,
+                    const uint8_t* input,
+                    const uint8_t* secret,
+                    size_t stripes) {
+    __m256i a[2];
+    for (int i = 0; i < 2; ++i) {
+        a[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc) + i);
+    }
+    for (size_t n = 0; n < stripes; ++n) {
+        const __m256i* in =
+                reinterpret_cast<const __m256i*>(input + n * kStripeSize);
+        const __m256i* key = reinterpret_cast<const __m256i*>(
+                secret + n * kSecretConsumeRate);
+        for (int i = 0; i < 2; ++i) {
+            const __m256i data = _mm256_loadu_si256(in + i);
+            const __m256i dataKey =
+                    _mm256_xor_si256(data, _mm256_loadu_si256(key + i));
+            const __m256i dataKeyHi =
+                    _mm256_shuffle_epi32(dataKey, _MM_SHUFFLE(0, 3, 0, 1));
+            const __m256i product = _mm256_mul_epu32(dataKey, dataKeyHi);
+            const __m256i swapped =
+                    _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            a[i] = _mm256_add_epi64(product, _mm256_add_epi64(a[i], swapped));
+        }
+    }
+    for (int i = 0; i < 2; ++i) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc) + i, a[i]);
+    }
+}
+
+HASH_TARGET("avx2")
+void scrambleAvx2(uint64_t* acc, const uint8_t* secret) {
+    const __m256i prime = _mm256_set1_epi32(int(kPrime32_1));
+    for (int i = 0; i < 2; ++i) {
+        __m256i* lane = reinterpret_cast<__m256i*>(acc) + i;
+        __m256i a = _mm256_loadu_si256(lane);
+        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+        a = _mm256_xor_si256(a, _mm256_loadu_si256(
+                                        reinterpret_cast<const __m256i*>(secret) +
+                                        i));
+        const __m256i hi = _mm256_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1));
+        const __m256i productLo = _mm256_mul_epu32(a, prime);
+        const __m256i productHi = _mm256_mul_epu32(hi, prime);
+        _mm256_storeu_si256(lane, _mm256_add_epi64(
+                                          productLo,
+                                          _mm256_slli_epi64(productHi, 32)));
+    }
+}
+
+constexpr Xxh3Kernels kSse2Xxh3Kernels = {&accumulateSse2, &scrambleSse2};
+constexpr Xxh3Kernels kAvx2Xxh3Kernels = {&accumulateAvx2, &scrambleAvx2};
+
+struct X86Features {
+    bool sse2 = false;
+    bool sse42 = false;
+    bool avx2 = false;
+};
+
+X86Features detectX86Features() {
+    X86Features features;
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    features.sse2 = info[3] & (1 << 26);
+    features.sse42 = info[2] & (1 << 20);
+    // AVX state must also be enabled by the OS.
+    const bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                       (_xgetbv(0) & 6) == 6;
+    if (osAvx && maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        features.avx2 = info[1] & (1 << 5);
+    }
+#else
+    __builtin_cpu_init();
+    features.sse2 = __builtin_cpu_supports("sse2");
+    features.sse42 = __builtin_cpu_supports("sse4.2");
+    features.avx2 = __builtin_cpu_supports("avx2");
+#endif
+    return features;
+}
+
+const X86Features& x86Features() {
+    static const X86Features features = detectX86Features();
+    return features;
+}
+
+const Xxh3Kernels& pickXxh3Kernels() {
+    if (x86Features().avx2) {
+        return kAvx2Xxh3Kernels;
+    }
+    if (x86Features().sse2) {
+        return kSse2Xxh3Kernels;
+    }
+    return kScalarXxh3Kernels;
+}
+
+#elif HASH_NEON
+
+void accumulateNeon(uint64_t* acc,
+                    const uint8_t* input,
+                    const uint8_t* secret,
+                    size_t stripes) {
+    uint64x2_t a[4];
+    for (int i = 0; i < 4; ++i) {
+        a[i] = vld1q_u64(acc + 2 * i);
+    }
+    for (size_t n = 0; n < stripes; ++n) {
+        const uint8_t* in = input + n * kStripeSize;
+        const uint8_t* key = secret + n * kSecretConsumeRate;
+        for (int i = 0; i < 4; ++i) {
+            const uint64x2_t data = vreinterpretq_u64_u8(vld1q_u8(in + 16 * i));
+            const uint64x2_t dataKey = veorq_u64(
+                    data, vreinterpretq_u64_u8(vld1q_u8(key + 16 * i)));
+            a[i] = vaddq_u64(a[i], vextq_u64(data, data, 1));
+            a[i] = vmlal_u32(a[i], vmovn_u64(dataKey),
+                             vshrn_n_u64(dataKey, 32));
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        vst1q_u64(acc + 2 * i, a[i]);
+    }
+}
+
+void scrambleNeon(uint64_t* acc, const uint8_t* secret) {
+    const uint32x2_t prime = vdup_n_u32(kPrime32_1);
+    for (int i = 0; i < 4; ++i) {
+        uint64x2_t a = vld1q_u64(acc + 2 * i);
+        a = veorq_u64(a, vshrq_n_u64(a, 47));
+        a = veorq_u64(a, vreinterpretq_u64_u8(vld1q_u8(secret + 16 * i)));
+        const uint64x2_t productHi =
+                vshlq_n_u64(vmull_u32(vshrn_n_u64(a, 32), prime), 32);
+        vst1q_u64(acc + 2 * i, vmlal_u32(productHi, vmovn_u64(a), prime));
+    }
+}
+
+constexpr Xxh3Kernels kNeonXxh3Kernels = {&accumulateNeon, &scrambleNeon};
+
+const Xxh3Kernels& pickXxh3Kernels() {
+    return kNeonXxh3Kernels;
+}
+
+#else
+
+const Xxh3Kernels& pickXxh3Kernels() {
+    return kScalarXxh3Kernels;
+}
+
+#endif
+
+const Xxh3Kernels& xxh3Kernels() {
+    static const Xxh3Kernels& kernels = pickXxh3Kernels();
+    return kernels;
+}
+
+void initCustomSecret(uint8_t* secret, uint64_t seed) {
+    for (size_t i = 0; i < kSecretSize / 16; ++i) {
+        writeLE64(secret + 16 * i, readLE64(kSecret + 16 * i) + seed);
+        writeLE64(secret + 16 * i + 8, readLE64(kSecret + 16 * i + 8) - seed);
+    }
+}
+
+uint64_t mergeAccs(const uint64_t* acc, const uint8_t* secret, uint64_t start) {
+    uint64_t result = start;
+    for (size_t i = 0; i < 4; ++i) {
+        result += mul128Fold64(acc[2 * i] ^ readLE64(secret + 16 * i),
+                               acc[2 * i + 1] ^ readLE64(secret + 16 * i + 8));
+    }
+    return avalanche(result);
+}
+
+Hash128 mergeAccs128(const uint64_t* acc, const uint8_t* secret, uint64_t len) {
+    return {mergeAccs(acc, secret + kSecretMergeAccsStart, len * kPrime64_1),
+            mergeAccs(acc, secret + kSecretSize - 64 - kSecretMergeAccsStart,
+                      ~(len * kPrime64_2))};
+}
+
+// Inputs over kMidSizeMax: whole blocks, then the stripes left, then the
+// last 64 bytes (overlapping what came before) with their own secret.
+void hashLong(uint64_t* acc,
+              const uint8_t* input,
+              size_t len,
+              const uint8_t* secret) {
+    const Xxh3Kernels& kernels = xxh3Kernels();
+    memcpy(acc, kInitAcc, sizeof(kInitAcc));
+    const size_t blocks = (len - 1) / kBlockSize;
+    for (size_t n = 0; n < blocks; ++n) {
+        kernels.accumulate(acc, input + n * kBlockSize, secret,
+                           kStripesPerBlock);
+        kernels.scramble(acc, secret + kSecretLimit);
+    }
+    const size_t stripes = ((len - 1) - kBlockSize * blocks) / kStripeSize;
+    kernels.accumulate(acc, input + blocks * kBlockSize, secret, stripes);
+    kernels.accumulate(acc, input + len - kStripeSize,
+                       secret + kSecretLimit - kSecretLastAccStart, 1);
+}
+
+// A secret for |seed| that long inputs need; short ones use the seed as is.
+const uint8_t* longSecret(uint64_t seed, uint8_t* custom) {
+    if (!seed) {
+        return kSecret;
+    }
+    initCustomSecret(custom, seed);
+    return custom;
+}
+
+// Accumulates |stripes| stripes into |acc| for the streaming state, which
+// is |*stripesSoFar| into the current block.
+const uint8_t* consumeStripes(uint64_t* acc,
+                              size_t* stripesSoFar,
+                              const uint8_t* input,
+                              size_t stripes,
+                              const uint8_t* secret) {
+    const Xxh3Kernels& kernels = xxh3Kernels();
+    const uint8_t* initialSecret = secret + *stripesSoFar * kSecretConsumeRate;
+    if (stripes >= kStripesPerBlock - *stripesSoFar) {
+        size_t stripesThisIter = kStripesPerBlock - *stripesSoFar;
+        do {
+            kernels.accumulate(acc, input, initialSecret, stripesThisIter);
+            kernels.scramble(acc, secret + kSecretLimit);
+            input += stripesThisIter * kStripeSize;
+            stripes -= stripesThisIter;
+            stripesThisIter = kStripesPerBlock;
+            initialSecret = secret;
+        } while (stripes >= kStripesPerBlock);
+        *stripesSoFar = 0;
+    }
+    if (stripes > 0) {
+        kernels.accumulate(acc, input, initialSecret, stripes);
+        input += stripes * kStripeSize;
+        *stripesSoFar += stripes;
+    }
+    return input;
+}
+
+// CRC-32C. The table driven version reads 8 bytes per step ("slicing by
+// 8"); the hardware ones take 8 bytes per instruction.
+
+constexpr uint32_t kCrc32cPolynomial = 0x82F63B78;  // Reflected 0x1EDC6F41.
+
+struct Crc32cTables {
+    uint32_t table[8][256] = {};
+
+    constexpr Crc32cTables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ ((crc & 1) ? kCrc32cPolynomial : 0);
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int t = 1; t < 8; ++t) {
+                table[t][i] = (table[t - 1][i] >> 8) ^
+                              table[0][table[t - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+constexpr Crc32cTables kCrc32cTables;
+
+uint32_t crc32cScalar(uint32_t crc, const uint8_t* p, size_t size) {
+    const auto& t = kCrc32cTables.table;
+    while (size >= 8) {
+        const uint64_t word = readLE64(p) ^ crc;
+        crc = t[7][word & 0xFF] ^ t[6][(word >> 8) & 0xFF] ^
+              t[5][(word >> 16) & 0xFF] ^ t[4][(word >> 24) & 0xFF] ^
+              t[3][(word >> 32) & 0xFF] ^ t[2][(word >> 40) & 0xFF] ^
+              t[1][(word >> 48) & 0xFF] ^ t[0][word >> 56];
+        p += 8;
+        size -= 8;
+    }
+    while (size--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+    }
+    return crc;
+}
+
+#if HASH_X86
+
+HASH_TARGET("sse4.2")
+uint32_t crc32cSse42(uint32_t crc, const uint8_t* p, size_t size) {
+#if defined(__x86_64__) || defined(_M_X64)
+    uint64_t crc64 = crc;
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    for (; size >= 4; p += 4, size -= 4) {
+        uint32_t word;
+        memcpy(&word, p, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+    }
+    while (size--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+using Crc32cFn = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+Crc32cFn pickCrc32c() {
+    return x86Features().sse42 ? &crc32cSse42 : &crc32cScalar;
+}
+
+#elif HASH_NEON
+
+HASH_ARM_CRC_TARGET
+uint32_t crc32cArm(uint32_t crc, const uint8_t* p, size_t size) {
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        crc = __crc32cd(crc, word);
+    }
+    while (size--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+
+using Crc32cFn = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+Crc32cFn pickCrc32c() {
+#if defined(__ARM_FEATURE_CRC32) || defined(__APPLE__) || defined(_M_ARM64)
+    return &crc32cArm;
+#elif defined(__linux__) && defined(HWCAP_CRC32)
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) ? &crc32cArm : &crc32cScalar;
+#else
+    return &crc32cScalar;
+#endif
+}
+
+#else
+
+using Crc32cFn = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+Crc32cFn pickCrc32c() {
+    return &crc32cScalar;
+}
+
+#endif
+
+// Runs |tasks| tasks numbered from 0 on up to |threads| threads, or on
+// the shared parallelFor() threads if 0, and returns when all are done.
+void runParallel(size_t tasks,
+                 int threads,
+                 const std::function<void(size_t)>& fn) {
+    if (threads <= 0) {
+        parallelFor(0, tasks, 1, [&fn](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                fn(i);
+            }
+        });
+        return;
+    }
+    threads = static_cast<int>(std::min<size_t>(threads, tasks));
+    if (threads > 1) {
+        ThreadPool<std::function<void()>> pool(
+                threads, [](std::function<void()>&& task) { task(); });
+        if (pool.start()) {
+            for (size_t i = 0; i < tasks; ++i) {
+                pool.enqueue([&fn, i] { fn(i); });
+            }
+            pool.done();
+            pool.join();
+            return;
+        }
+    }
+    for (size_t i = 0; i < tasks; ++i) {
+        fn(i);
+    }
+}
+
+// Hashes |chunks| chunks with |hash|, spread over a few tasks per thread so
+// that a slow one doesn't hold up the rest.
+template <class Hash>
+void hashChunksParallel(const uint8_t* data,
+                        size_t size,
+                        size_t chunkSize,
+                        int threads,
+                        Hash* out,
+                        Hash (*hash)(const void*, size_t, uint64_t)) {
+    const size_t chunks = (size + chunkSize - 1) / chunkSize;
+    const size_t tasks =
+            std::min<size_t>(chunks, std::max(1, getCpuCoreCount()) * 4);
+    runParallel(tasks, threads, [=](size_t task) {
+        const size_t begin = chunks * task / tasks;
+        const size_t end = chunks * (task + 1) / tasks;
+        for (size_t i = begin; i < end; ++i) {
+            const size_t offset = i * chunkSize;
+            out[i] = hash(data + offset, std::min(chunkSize, size - offset), 0);
+        }
+    });
+}
+
+}  // namespace
+
+uint64_t xxh3Hash64(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* input = static_cast<const uint8_t*>(data);
+    if (size <= 16) {
+        return hash0to16(input, size, kSecret, seed);
+    }
+    if (size <= 128) {
+        return hash17to128(input, size, kSecret, seed);
+    }
+    if (size <= kMidSizeMax) {
+        return hash129to240(input, size, kSecret, seed);
+    }
+    alignas(64) uint8_t custom[kSecretSize];
+    const uint8_t* secret = longSecret(seed, custom);
+    alignas(64) uint64_t acc[8];
+    hashLong(acc, input, size, secret);
+    return mergeAccs(acc, secret + kSecretMergeAccsStart, size * kPrime64_1);
+}
+
+Hash128 xxh3Hash128(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* input = static_cast<const uint8_t*>(data);
+    if (size <= 16) {
+        return hash0to16_128(input, size, kSecret, seed);
+    }
+    if (size <= 128) {
+        return hash17to128_128(input, size, kSecret, seed);
+    }
+    if (size <= kMidSizeMax) {
+        return hash129to240_128(input, size, kSecret, seed);
+    }
+    alignas(64) uint8_t custom[kSecretSize];
+    const uint8_t* secret = longSecret(seed, custom);
+    alignas(64) uint64_t acc[8];
+    hashLong(acc, input, size, secret);
+    return mergeAccs128(acc, secret, size);
+}
+
+Xxh3Hasher::Xxh3Hasher(uint64_t seed) {
+    reset(seed);
+}
+
+void Xxh3Hasher::reset(uint64_t seed) {
+    memcpy(mAcc, kInitAcc, sizeof(mAcc));
+    if (seed) {
+        initCustomSecret(mSecret, seed);
+    } else {
+        memcpy(mSecret, kSecret, sizeof(mSecret));
+    }
+    mBufferedSize = 0;
+    mStripesSoFar = 0;
+    mTotalSize = 0;
+    mSeed = seed;
+}
+
+// As in the reference, the buffer is only consumed once more input
+// arrives, so the last stripe is always at hand for the digest.
+void Xxh3Hasher::update(const void* data, size_t size) {
+    const uint8_t* input = static_cast<const uint8_t*>(data);
+    const uint8_t* const end = input + size;
+    mTotalSize += size;
+    if (size <= kBufferSize - mBufferedSize) {
+        memcpy(mBuffer + mBufferedSize, input, size);
+        mBufferedSize += size;
+        return;
+    }
+    if (mBufferedSize) {
+        const size_t fill = kBufferSize - mBufferedSize;
+        memcpy(mBuffer + mBufferedSize, input, fill);
+        input += fill;
+        consumeStripes(mAcc, &mStripesSoFar, mBuffer, kBufferStripes, mSecret);
+        mBufferedSize = 0;
+    }
+    if (size_t(end - input) > kBufferSize) {
+        const size_t stripes = size_t(end - 1 - input) / kStripeSize;
+        input = consumeStripes(mAcc, &mStripesSoFar, input, stripes, mSecret);
+        memcpy(mBuffer + kBufferSize - kStripeSize, input - kStripeSize,
+               kStripeSize);
+    }
+    memcpy(mBuffer, input, end - input);
+    mBufferedSize = end - input;
+}
+
+void Xxh3Hasher::digestLong(uint64_t* acc) const {
+    memcpy(acc, mAcc, sizeof(mAcc));
+    uint8_t lastStripe[kStripeSize];
+    const uint8_t* lastStripePtr;
+    if (mBufferedSize >= kStripeSize) {
+        const size_t stripes = (mBufferedSize - 1) / kStripeSize;
+        size_t stripesSoFar = mStripesSoFar;
+        consumeStripes(acc, &stripesSoFar, mBuffer, stripes, mSecret);
+        lastStripePtr = mBuffer + mBufferedSize - kStripeSize;
+    } else {
+        // The rest of the last stripe is still at the end of the buffer.
+        const size_t catchup = kStripeSize - mBufferedSize;
+        memcpy(lastStripe, mBuffer + kBufferSize - catchup, catchup);
+        memcpy(lastStripe + catchup, mBuffer, mBufferedSize);
+        lastStripePtr = lastStripe;
+    }
+    xxh3Kernels().accumulate(acc, lastStripePtr,
+                             mSecret + kSecretLimit - kSecretLastAccStart, 1);
+}
+
+uint64_t Xxh3Hasher::digest64() const {
+    if (mTotalSize > kMidSizeMax) {
+        alignas(64) uint64_t acc[8];
+        digestLong(acc);
+        return mergeAccs(acc, mSecret + kSecretMergeAccsStart,
+                         mTotalSize * kPrime64_1);
+    }
+    return xxh3Hash64(mBuffer, mTotalSize, mSeed);
+}
+
+Hash128 Xxh3Hasher::digest128() const {
+    if (mTotalSize > kMidSizeMax) {
+        alignas(64) uint64_t acc[8];
+        digestLong(acc);
+        return mergeAccs128(acc, mSecret, mTotalSize);
+    }
+    return xxh3Hash128(mBuffer, mTotalSize, mSeed);
+}
+
+uint32_t crc32c(const void* data, size_t size, uint32_t crc) {
+    static const Crc32cFn impl = pickCrc32c();
+    return ~impl(~crc, static_cast<const uint8_t*>(data), size);
+}
+
+std::vector<uint64_t> xxh3HashChunks(const void* data,
+                                     size_t size,
+                                     size_t chunkSize,
+                                     int threads) {
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    std::vector<uint64_t> hashes((size + chunkSize - 1) / chunkSize);
+    hashChunksParallel(static_cast<const uint8_t*>(data), size, chunkSize,
+                       threads, hashes.data(), &xxh3Hash64);
+    return hashes;
+}
+
+Hash128 xxh3HashParallel(const void* data,
+                         size_t size,
+                         size_t chunkSize,
+                         int threads) {
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    std::vector<Hash128> hashes((size + chunkSize - 1) / chunkSize);
+    hashChunksParallel(static_cast<const uint8_t*>(data), size, chunkSize,
+                       threads, hashes.data(), &xxh3Hash128);
+    std::vector<uint8_t> bytes(hashes.size() * 16);
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        writeLE64(bytes.data() + 16 * i, hashes[i].low);
+        writeLE64(bytes.data() + 16 * i + 8, hashes[i].high);
+    }
+    return xxh3Hash128(bytes.data(), bytes.size());
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,130 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/Hash.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+std::vector<uint8_t> makeData(size_t size) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<uint8_t>(i * 31 + 7);
+    }
+    return data;
+}
+
+// Results from the xxHash reference implementation, one row per size on
+// either side of each code path's limits.
+struct Xxh3Vector {
+    size_t size;
+    uint64_t hash64;
+    uint64_t hash64Seed42;
+    Hash128 hash128Seed42;
+};
+
+constexpr uint64_t kSeed = 42;
+
+const Xxh3Vector kXxh3Vectors[] = {
+        {0, 0x2d06800538d394c2ULL, 0xb029411ff43d84d2ULL,
+         {0x3c1d09e9fe249164ULL, 0x16c20acd33f7af2fULL}},
+        {3, 0x15f7093b173d005cULL, 0x0322c472f9dd3c8aULL,
+         {0x0322c472f9dd3c8aULL, 0x5c291892a9981241ULL}},
+        {8, 0xdec6a9a43575982eULL, 0xb18293e9a9982b58ULL,
+         {0x925e9cbd6b9d6856ULL, 0x4eba1888652c0237ULL}},
+        {16, 0x7e484c18d74895d0ULL, 0x0126fe5707ca8f2bULL,
+         {0x5aac6c3b573a84abULL, 0x3c216dd14f4ec5dcULL}},
+        {100, 0x8c97158042fbf926ULL, 0x4ca5c3a331119e67ULL,
+         {0x145aaf80746eba85ULL, 0x50524dac88f99c9aULL}},
+        {200, 0x12fdb864685f344dULL, 0x9b4d9e4b4078c30fULL,
+         {0x82236c396c3fee2dULL, 0x652994ae1565b773ULL}},
+        {240, 0xccc7375172c41f03ULL, 0x4b05be6354f2e1c7ULL,
+         {0x2bf543ceda592328ULL, 0x11852fc45d1b1405ULL}},
+        {1000, 0x989765d0ea7a5ecdULL, 0x210176ac002574adULL,
+         {0x210176ac002574adULL, 0x3a57f1243ccc56b5ULL}},
+        {5000, 0x559fff92c2b7f8eeULL, 0x9280bd17564fdf91ULL,
+         {0x9280bd17564fdf91ULL, 0x101eadafa339a6ecULL}},
+};
+
+TEST(Hash, Xxh3MatchesReference) {
+    const std::vector<uint8_t> data = makeData(5000);
+    for (const Xxh3Vector& v : kXxh3Vectors) {
+        EXPECT_EQ(v.hash64, xxh3Hash64(data.data(), v.size)) << v.size;
+        EXPECT_EQ(v.hash64Seed42, xxh3Hash64(data.data(), v.size, kSeed))
+                << v.size;
+        EXPECT_EQ(v.hash128Seed42, xxh3Hash128(data.data(), v.size, kSeed))
+                << v.size;
+    }
+}
+
+// Tests that any split of the input gives the one-shot hash.
+TEST(Hash, Xxh3Streaming) {
+    const std::vector<uint8_t> data = makeData(5000);
+    for (const Xxh3Vector& v : kXxh3Vectors) {
+        for (size_t step : {1, 63, 64, 256, 1000}) {
+            Xxh3Hasher hasher(kSeed);
+            for (size_t i = 0; i < v.size; i += step) {
+                hasher.update(data.data() + i, std::min(step, v.size - i));
+            }
+            EXPECT_EQ(v.hash64Seed42, hasher.digest64()) << v.size;
+            EXPECT_EQ(v.hash128Seed42, hasher.digest128()) << v.size;
+        }
+    }
+
+    Xxh3Hasher hasher;
+    hasher.update(data.data(), 1000);
+    hasher.reset();
+    hasher.update(data.data(), 100);
+    EXPECT_EQ(kXxh3Vectors[4].hash64, hasher.digest64());
+}
+
+TEST(Hash, Crc32c) {
+    EXPECT_EQ(0u, crc32c("", 0));
+    EXPECT_EQ(0xe3069283u, crc32c("123456789", 9));
+
+    // Ends that aren't a multiple of the 8-byte steps, and chaining.
+    const std::vector<uint8_t> data = makeData(1001);
+    const uint32_t whole = crc32c(data.data(), data.size());
+    for (size_t split : {0, 1, 7, 8, 500, 1001}) {
+        EXPECT_EQ(whole, crc32c(data.data() + split, data.size() - split,
+                                crc32c(data.data(), split)));
+    }
+}
+
+TEST(Hash, Chunks) {
+    const std::vector<uint8_t> data = makeData(100000);
+    const std::vector<uint64_t> hashes =
+            xxh3HashChunks(data.data(), data.size(), 4096, 4);
+    ASSERT_EQ(25u, hashes.size());
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        const size_t size = std::min<size_t>(4096, data.size() - i * 4096);
+        EXPECT_EQ(xxh3Hash64(data.data() + i * 4096, size), hashes[i]);
+    }
+    EXPECT_TRUE(xxh3HashChunks(data.data(), 0, 4096).empty());
+
+    // The same for any thread count, and different for other data.
+    const Hash128 hash = xxh3HashParallel(data.data(), data.size(), 4096, 4);
+    EXPECT_EQ(hash, xxh3HashParallel(data.data(), data.size(), 4096, 1));
+    EXPECT_NE(hash, xxh3HashParallel(data.data(), data.size() - 1, 4096, 4));
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
@@ -17,6 +17,8 @@
 
 #include <map>
 
+#include "aemu/base/ThreadRoles.h"
+#include "aemu/base/ThreadSampler.h"
 #include "aemu/base/system/System.h"
 #include "aemu/base/testing/TestClock.h"
 #include "host-common/logging.h"
@@ -27,7 +29,9 @@ namespace emugl {
 using android::base::AutoLock;
 using android::base::MetricEventHang;
 using android::base::MetricEventUnHang;
+using android::base::ScopedThreadRole;
 using android::base::TestClock;
+using android::base::ThreadRole;
 using std::chrono::duration_cast;
 using emugl::ABORT_REASON_OTHER;
 using emugl::FatalError;
@@ -70,6 +74,12 @@ typename HealthMonitor<Clock>::Id HealthMonitor<Clock>::startMonitoringTask(
 
     AutoLock lock(mLock);
     auto id = mNextId++;
+    TouchSlot& slot = mTouchSlots[id % kTouchSlots];
+    if (slot.id.load(std::memory_order_relaxed) == kNoTask) {
+        slot.touched.store(std::numeric_limits<typename Clock::rep>::lowest(),
+                           std::memory_order_relaxed);
+        slot.id.store(id, std::memory_order_release);
+    }
     auto event = std::make_unique<MonitoredEvent>(typename MonitoredEventType::Start{
         .id = id,
         .metadata = std::move(metadata),
@@ -83,6 +93,11 @@ typename HealthMonitor<Clock>::Id HealthMonitor<Clock>::startMonitoringTask(
 
 template <class Clock>
 void HealthMonitor<Clock>::touchMonitoredTask(Id id) {
+    TouchSlot& slot = mTouchSlots[id % kTouchSlots];
+    if (slot.id.load(std::memory_order_acquire) == id) {
+        slot.touched.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        return;
+    }
     auto event = std::make_unique<MonitoredEvent>(
         typename MonitoredEventType::Touch{.id = id, .timeOccurred = Clock::now()});
     AutoLock lock(mLock);
@@ -94,9 +109,20 @@ void HealthMonitor<Clock>::stopMonitoringTask(Id id) {
     auto event = std::make_unique<MonitoredEvent>(
         typename MonitoredEventType::Stop{.id = id, .timeOccurred = Clock::now()});
     AutoLock lock(mLock);
+    // The stop time covers any touch the monitor thread hasn't seen yet.
+    TouchSlot& slot = mTouchSlots[id % kTouchSlots];
+    if (slot.id.load(std::memory_order_relaxed) == id) {
+        slot.id.store(kNoTask, std::memory_order_relaxed);
+    }
     mEventQueue.push(std::move(event));
 }
 
+template <class Clock>
+void HealthMonitor<Clock>::setHangSampling(uint32_t samples, uint64_t intervalUs) {
+    mHangSampleIntervalUs.store(intervalUs, std::memory_order_relaxed);
+    mHangSamples.store(samples, std::memory_order_relaxed);
+}
+
 template <class Clock>
 std::future<void> HealthMonitor<Clock>::poll() {
     auto event = std::make_unique<MonitoredEvent>(typename MonitoredEventType::Poll{});
@@ -112,6 +138,7 @@ std::future<void> HealthMonitor<Clock>::poll() {
 // Thread's main loop
 template <class Clock>
 intptr_t HealthMonitor<Clock>::main() {
+    ScopedThreadRole role(ThreadRole::kHealthMonitor);
     bool keepMonitoring = true;
     std::queue<std::unique_ptr<MonitoredEvent>> events;
 
@@ -131,6 +158,7 @@ intptr_t HealthMonitor<Clock>::main() {
         }
 
         Timestamp now = Clock::now();
+        applySlotTouches(events);
         while (!events.empty()) {
             auto event(std::move(events.front()));
             events.pop();
@@ -220,6 +248,22 @@ intptr_t HealthMonitor<Clock>::main() {
                         auto newAnnotations = (*task.onHangAnnotationsCallback)();
                         task.metadata->mergeAnnotations(std::move(newAnnotations));
                     }
+                    // A stopped task's thread may be gone.
+                    const uint32_t samples = mHangSamples.load(std::memory_order_relaxed);
+                    if (samples && tasksToRemove.find(task_id) == tasksToRemove.end() &&
+                        android::base::threadSamplingSupported()) {
+                        auto stacks = android::base::sampleThreadStacks(
+                            task.metadata->threadId, samples,
+                            mHangSampleIntervalUs.load(std::memory_order_relaxed));
+                        if (stacks.taken) {
+                            // Replaces the stacks of an earlier hang of this task.
+                            if (!task.metadata->data) {
+                                task.metadata->data = std::make_unique<HangAnnotations>();
+                            }
+                            (*task.metadata->data)["hot_stacks"] =
+                                android::base::formatThreadStackSamples(stacks);
+                        }
+                    }
                     mLogger.logMetricEvent(MetricEventHang{.taskId = task.id,
                                                            .metadata = task.metadata.get(),
                                                            .otherHungTasks = newHungTasks});
@@ -260,6 +304,22 @@ intptr_t HealthMonitor<Clock>::main() {
     return 0;
 }
 
+template <class Clock>
+void HealthMonitor<Clock>::applySlotTouches(std::queue<std::unique_ptr<MonitoredEvent>>& events) {
+    // Tasks whose Start is still in |events| get their touches next time.
+    for (auto& [id, task] : mMonitoredTasks) {
+        const TouchSlot& slot = mTouchSlots[id % kTouchSlots];
+        if (slot.id.load(std::memory_order_acquire) != id) {
+            continue;
+        }
+        const Timestamp touched(Duration(slot.touched.load(std::memory_order_relaxed)));
+        if (touched + task.timeoutThreshold > task.timeoutTimestamp) {
+            task.timeoutTimestamp = touched + task.timeoutThreshold;
+            updateTaskParent(events, task, touched);
+        }
+    }
+}
+
 template <class Clock>
 void HealthMonitor<Clock>::updateTaskParent(std::queue<std::unique_ptr<MonitoredEvent>>& events,
                                             const MonitoredTask& task, Timestamp eventTime) {
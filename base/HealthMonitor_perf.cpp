@@ -0,0 +1,72 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Measures what touching a watchdog costs the thread that does it.
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "aemu/base/HealthMonitor.h"
+#include "aemu/base/Metrics.h"
+#include "benchmark/benchmark.h"
+
+using android::base::EventHangMetadata;
+using android::base::MetricEventType;
+using android::base::MetricsLogger;
+using emugl::HealthMonitor;
+
+namespace {
+
+class NullLogger : public MetricsLogger {
+   public:
+    void logMetricEvent(MetricEventType eventType) override {}
+    void setCrashAnnotation(const char* key, const char* value) override {}
+};
+
+// Touches a task that has a touch slot.
+void BM_TouchMonitoredTask(benchmark::State& state) {
+    NullLogger logger;
+    HealthMonitor<> monitor(logger, 100);
+    auto id = monitor.startMonitoringTask(std::make_unique<EventHangMetadata>());
+    for (auto _ : state) {
+        monitor.touchMonitoredTask(id);
+    }
+    monitor.stopMonitoringTask(id);
+}
+BENCHMARK(BM_TouchMonitoredTask);
+
+// Touches a task whose slot another task holds, which queues an event the
+// way every touch used to.
+void BM_TouchMonitoredTaskQueued(benchmark::State& state) {
+    NullLogger logger;
+    HealthMonitor<> monitor(logger, 100);
+    std::vector<HealthMonitor<>::Id> ids;
+    for (int i = 0; i < 1024; i++) {
+        ids.push_back(monitor.startMonitoringTask(std::make_unique<EventHangMetadata>()));
+    }
+    const auto id = ids.back();
+    for (auto _ : state) {
+        monitor.touchMonitoredTask(id);
+    }
+    for (auto taskId : ids) {
+        monitor.stopMonitoringTask(taskId);
+    }
+}
+BENCHMARK(BM_TouchMonitoredTaskQueued);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -23,6 +23,7 @@
 
 #include "aemu/base/testing/TestClock.h"
 #include "aemu/base/Metrics.h"
+#include "aemu/base/ThreadSampler.h"
 
 namespace emugl {
 
@@ -121,6 +122,28 @@ TEST_F(HealthMonitorTest, hangingStartEventTest) {
     step(defaultHangThresholdS + 1);
 }
 
+// Tests that a newly hung task gets the sampled stacks of its thread.
+TEST_F(HealthMonitorTest, hangSamplesStacksTest) {
+    if (!android::base::threadSamplingSupported()) {
+        GTEST_SKIP() << "Thread sampling is not supported here";
+    }
+    healthMonitor.setHangSampling(4, 100);
+    std::string hotStacks;
+    EXPECT_CALL(logger, logMetricEvent(VariantWith<MetricEventHang>(_)))
+        .WillOnce([&hotStacks](MetricEventType event) {
+            const auto& data = std::get<MetricEventHang>(event).metadata->data;
+            ASSERT_NE(nullptr, data);
+            hotStacks = data->at("hot_stacks");
+        });
+
+    auto id = healthMonitor.startMonitoringTask(std::make_unique<EventHangMetadata>());
+    step(defaultHangThresholdS + 1);
+    EXPECT_THAT(hotStacks, HasSubstr("4/4 samples"));
+    healthMonitor.setHangSampling(0);
+    healthMonitor.stopMonitoringTask(id);
+    EXPECT_CALL(logger, logMetricEvent(VariantWith<MetricEventUnHang>(_)));
+}
+
 TEST_F(HealthMonitorTest, lateEndEventTest) {
     int expectedHangDurationS = 5;
     {
@@ -138,6 +161,25 @@ TEST_F(HealthMonitorTest, lateEndEventTest) {
     healthMonitor.stopMonitoringTask(id);
 }
 
+// More tasks than touch slots, so some touches go through the event queue.
+TEST_F(HealthMonitorTest, manyTouchedTasksTest) {
+    EXPECT_CALL(logger, logMetricEvent(_)).Times(0);
+
+    std::vector<HealthMonitor<TestClock>::Id> ids;
+    for (int i = 0; i < 600; i++) {
+        ids.push_back(healthMonitor.startMonitoringTask(std::make_unique<EventHangMetadata>()));
+    }
+    for (int round = 0; round < 3; round++) {
+        step(defaultHangThresholdS - 1);
+        for (auto id : ids) {
+            healthMonitor.touchMonitoredTask(id);
+        }
+    }
+    for (auto id : ids) {
+        healthMonitor.stopMonitoringTask(id);
+    }
+}
+
 TEST_F(HealthMonitorTest, taskHangsTwiceTest) {
     int expectedHangDurationS1 = 3;
     int expectedHangDurationS2 = 5;
@@ -571,6 +613,22 @@ TEST(HealthMonitorWatchdogBuilderTest, OnHangCallbackTest) {
     (*actualOnHangCallback)();
 }
 
+TEST(HealthMonitorWatchdogBuilderTest, CaptureStackTest) {
+    MockHealthMonitor monitor;
+    MockHealthMonitor::Id taskId = 0x3307;
+
+    std::optional<std::function<std::unique_ptr<HangAnnotations>()>> actualOnHangCallback;
+
+    EXPECT_CALL(monitor, startMonitoringTask(_, Ne(std::nullopt), kDefaultTimeoutMs, _))
+        .Times(1)
+        .WillOnce(DoAll(SaveArg<1>(&actualOnHangCallback), Return(taskId)));
+    EXPECT_CALL(monitor, stopMonitoringTask(taskId)).Times(1);
+    WATCHDOG_BUILDER(&monitor, "test message").captureStack().build();
+    auto annotations = (*actualOnHangCallback)();
+    ASSERT_NE(annotations, nullptr);
+    EXPECT_THAT(*annotations, Contains(Pair(StrEq("stack"), HasSubstr("#0 "))));
+}
+
 TEST(HealthMonitorWatchdogBuilderTest, AnnotationsTest) {
     MockHealthMonitor monitor;
     MockHealthMonitor::Id taskId = 0x9271;
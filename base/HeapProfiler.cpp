@@ -0,0 +1,394 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/memory/HeapProfiler.h"
+
+#include "aemu/base/Backtrace.h"
+#include "aemu/base/synchronization/Lock.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+#include <inttypes.h>
+#include <stdio.h>
+
+namespace android {
+namespace base {
+
+namespace {
+
+constexpr int kFilterBits = 14;
+constexpr size_t kFilterSize = size_t(1) << kFilterBits;
+
+// Trivial so that it is zero initialized without a TLS constructor; a
+// generation of zero never matches, so a thread's first allocation seeds it.
+struct ThreadSampler {
+    int64_t untilSample;
+    uint64_t rng;
+    uint32_t generation;
+    // Set while the profiler itself runs on this thread, so that its own
+    // allocations (and the unwinder's) are not recorded.
+    bool busy;
+};
+
+thread_local ThreadSampler tSampler;
+
+// Bumped by every start(), so that threads redraw their countdown for the new
+// interval. Global since the countdowns are shared by all profilers.
+std::atomic<uint32_t> sGeneration{1};
+
+class ScopedBusy {
+public:
+    ScopedBusy() : mWasBusy(tSampler.busy) { tSampler.busy = true; }
+    ~ScopedBusy() { tSampler.busy = mWasBusy; }
+
+private:
+    const bool mWasBusy;
+};
+
+size_t filterSlot(const void* ptr) {
+    const uint64_t bits = reinterpret_cast<uintptr_t>(ptr) >> 4;
+    return (bits * 0x9E3779B97F4A7C15ull) >> (64 - kFilterBits);
+}
+
+// xorshift64*; never yields 0 once seeded non-zero.
+uint64_t nextRandom(uint64_t& state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1Dull;
+}
+
+// Bytes until the next sample: exponentially distributed with mean
+// |interval|.
+int64_t drawCountdown(uint64_t& rng, size_t interval) {
+    // 53 random bits, mapped into (0, 1].
+    const double u = double((nextRandom(rng) >> 11) + 1) * 0x1.0p-53;
+    const double bytes = -std::log(u) * double(interval);
+    return std::min<double>(bytes, double(INT64_MAX / 2)) + 1;
+}
+
+// Expected number of bytes one sample of |size| bytes stands for; the same
+// factor pprof applies to heap_v2 profiles.
+double sampleWeight(size_t size, size_t interval) {
+    if (!interval) {
+        return double(size);
+    }
+    return double(size) / -std::expm1(-double(size) / double(interval));
+}
+
+}  // namespace
+
+class HeapProfiler::Impl {
+public:
+    struct Stack {
+        std::array<void*, kMaxFrames> frames;
+        int depth;
+
+        bool operator==(const Stack& other) const {
+            return depth == other.depth &&
+                   !memcmp(frames.data(), other.frames.data(),
+                           depth * sizeof(void*));
+        }
+    };
+
+    struct StackHash {
+        size_t operator()(const Stack& stack) const {
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (int i = 0; i < stack.depth; ++i) {
+                hash = (hash ^ reinterpret_cast<uintptr_t>(stack.frames[i])) *
+                       0x100000001b3ull;
+            }
+            return size_t(hash);
+        }
+    };
+
+    struct StackStats {
+        uint64_t allocCount = 0;
+        uint64_t allocBytes = 0;
+        uint64_t liveCount = 0;
+        uint64_t liveBytes = 0;
+        double allocEstimate = 0;
+        double liveEstimate = 0;
+    };
+
+    using StackMap = std::unordered_map<Stack, StackStats, StackHash>;
+
+    struct LiveSample {
+        StackMap::value_type* stack;
+        size_t size;
+        double weight;
+    };
+
+    Lock lock;
+    // Number of live samples per hash slot, so that most frees skip the lock.
+    std::array<std::atomic<uint32_t>, kFilterSize> filter = {};
+
+    StackMap stacks;
+    std::unordered_map<const void*, LiveSample> live;
+    uint64_t sampledAllocations = 0;
+    double allocEstimate = 0;
+    double liveEstimate = 0;
+
+    uint64_t dumpStep = 0;
+    double nextDump = 0;
+    std::string dumpPrefix;
+    int dumpCount = 0;
+
+    void eraseLocked(std::unordered_map<const void*, LiveSample>::iterator it) {
+        StackStats& stats = it->second.stack->second;
+        stats.liveCount -= 1;
+        stats.liveBytes -= it->second.size;
+        stats.liveEstimate -= it->second.weight;
+        liveEstimate -= it->second.weight;
+        filter[filterSlot(it->first)].fetch_sub(1, std::memory_order_relaxed);
+        live.erase(it);
+    }
+};
+
+// static
+HeapProfiler& HeapProfiler::get() {
+    static HeapProfiler* profiler = new HeapProfiler;
+    return *profiler;
+}
+
+HeapProfiler::HeapProfiler() : mImpl(new Impl) {}
+
+HeapProfiler::~HeapProfiler() = default;
+
+void HeapProfiler::start(size_t samplingInterval) {
+    mInterval.store(std::max<size_t>(samplingInterval, 1),
+                    std::memory_order_relaxed);
+    sGeneration.fetch_add(1, std::memory_order_relaxed);
+    mEnabled.store(true, std::memory_order_relaxed);
+}
+
+void HeapProfiler::stop() {
+    mEnabled.store(false, std::memory_order_relaxed);
+}
+
+void HeapProfiler::reset() {
+    ScopedBusy busy;
+    AutoLock lock(mImpl->lock);
+    for (auto& slot : mImpl->filter) {
+        slot.store(0, std::memory_order_relaxed);
+    }
+    mLiveSamples.store(0, std::memory_order_relaxed);
+    mImpl->live.clear();
+    mImpl->stacks.clear();
+    mImpl->sampledAllocations = 0;
+    mImpl->allocEstimate = 0;
+    mImpl->liveEstimate = 0;
+    mImpl->nextDump = mImpl->dumpStep;
+}
+
+void HeapProfiler::countAllocation(const void* ptr, size_t size) {
+    ThreadSampler& sampler = tSampler;
+    if (sampler.busy) {
+        return;
+    }
+    const uint32_t generation = sGeneration.load(std::memory_order_relaxed);
+    if (sampler.generation == generation &&
+        int64_t(size) < sampler.untilSample) {
+        sampler.untilSample -= size;
+        return;
+    }
+
+    const size_t interval = samplingInterval();
+    if (sampler.generation != generation) {
+        if (!sampler.rng) {
+            sampler.rng = (reinterpret_cast<uintptr_t>(&sampler) ^
+                           uint64_t(std::chrono::steady_clock::now()
+                                            .time_since_epoch()
+                                            .count())) |
+                          1;
+        }
+        sampler.generation = generation;
+        sampler.untilSample = drawCountdown(sampler.rng, interval);
+        if (int64_t(size) < sampler.untilSample) {
+            sampler.untilSample -= size;
+            return;
+        }
+    }
+    sampler.untilSample = drawCountdown(sampler.rng, interval);
+
+    ScopedBusy busy;
+    Impl::Stack stack;
+    // Leave out this function; the stack starts at the allocator hook.
+    stack.depth = int(captureBacktrace(stack.frames.data(), kMaxFrames, 1));
+    const double weight = sampleWeight(size, interval);
+
+    std::string dumpPath;
+    {
+        AutoLock lock(mImpl->lock);
+        auto existing = mImpl->live.find(ptr);
+        if (existing != mImpl->live.end()) {
+            // The free of the previous block at this address was missed.
+            mImpl->eraseLocked(existing);
+            mLiveSamples.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        auto& entry = *mImpl->stacks.emplace(stack, Impl::StackStats()).first;
+        Impl::StackStats& stats = entry.second;
+        stats.allocCount += 1;
+        stats.allocBytes += size;
+        stats.liveCount += 1;
+        stats.liveBytes += size;
+        stats.allocEstimate += weight;
+        stats.liveEstimate += weight;
+        mImpl->live.emplace(ptr, Impl::LiveSample{&entry, size, weight});
+        mImpl->filter[filterSlot(ptr)].fetch_add(1,
+                                                 std::memory_order_relaxed);
+        mLiveSamples.fetch_add(1, std::memory_order_relaxed);
+
+        mImpl->sampledAllocations += 1;
+        mImpl->allocEstimate += weight;
+        mImpl->liveEstimate += weight;
+
+        if (mImpl->dumpStep && mImpl->liveEstimate >= mImpl->nextDump) {
+            mImpl->nextDump = mImpl->liveEstimate + mImpl->dumpStep;
+            dumpPath = mImpl->dumpPrefix + "." +
+                       std::to_string(++mImpl->dumpCount) + ".heap";
+        }
+    }
+    if (!dumpPath.empty()) {
+        dump(dumpPath);
+    }
+}
+
+void HeapProfiler::checkFree(const void* ptr) {
+    if (tSampler.busy ||
+        !mImpl->filter[filterSlot(ptr)].load(std::memory_order_relaxed)) {
+        return;
+    }
+    ScopedBusy busy;
+    AutoLock lock(mImpl->lock);
+    auto it = mImpl->live.find(ptr);
+    if (it != mImpl->live.end()) {
+        mImpl->eraseLocked(it);
+        mLiveSamples.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+HeapProfiler::Summary HeapProfiler::summary() {
+    ScopedBusy busy;
+    AutoLock lock(mImpl->lock);
+    Summary summary;
+    summary.sampledAllocations = mImpl->sampledAllocations;
+    summary.liveSamples = mImpl->live.size();
+    summary.allocatedBytes = uint64_t(std::llround(mImpl->allocEstimate));
+    summary.liveBytes = uint64_t(std::llround(mImpl->liveEstimate));
+    return summary;
+}
+
+void HeapProfiler::visitStacks(void (*visit)(const StackUsage&, void*),
+                               void* opaque) {
+    ScopedBusy busy;
+    AutoLock lock(mImpl->lock);
+    std::vector<const Impl::StackMap::value_type*> sorted;
+    sorted.reserve(mImpl->stacks.size());
+    for (const auto& entry : mImpl->stacks) {
+        sorted.push_back(&entry);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](auto* a, auto* b) {
+        return a->second.liveEstimate > b->second.liveEstimate;
+    });
+    for (const auto* entry : sorted) {
+        visit(StackUsage{entry->first.frames.data(), entry->first.depth,
+                         uint64_t(std::llround(entry->second.allocEstimate)),
+                         uint64_t(std::llround(entry->second.liveEstimate))},
+              opaque);
+    }
+}
+
+std::string HeapProfiler::pprofText() {
+    ScopedBusy busy;
+    std::string out;
+    char line[128];
+    {
+        AutoLock lock(mImpl->lock);
+        Impl::StackStats total;
+        for (const auto& entry : mImpl->stacks) {
+            total.allocCount += entry.second.allocCount;
+            total.allocBytes += entry.second.allocBytes;
+            total.liveCount += entry.second.liveCount;
+            total.liveBytes += entry.second.liveBytes;
+        }
+        snprintf(line, sizeof(line),
+                 "heap profile: %6" PRIu64 ": %8" PRIu64 " [%6" PRIu64
+                 ": %8" PRIu64 "] @ heap_v2/%zu\n",
+                 total.liveCount, total.liveBytes, total.allocCount,
+                 total.allocBytes, samplingInterval());
+        out += line;
+
+        for (const auto& entry : mImpl->stacks) {
+            const Impl::StackStats& stats = entry.second;
+            snprintf(line, sizeof(line),
+                     "%6" PRIu64 ": %8" PRIu64 " [%6" PRIu64 ": %8" PRIu64
+                     "] @",
+                     stats.liveCount, stats.liveBytes, stats.allocCount,
+                     stats.allocBytes);
+            out += line;
+            for (int i = 0; i < entry.first.depth; ++i) {
+                snprintf(line, sizeof(line), " 0x%" PRIxPTR,
+                         reinterpret_cast<uintptr_t>(entry.first.frames[i]));
+                out += line;
+            }
+            out += '\n';
+        }
+    }
+
+#ifdef __linux__
+    // pprof symbolizes against the mappings listed after the samples.
+    if (FILE* maps = fopen("/proc/self/maps", "r")) {
+        out += "\nMAPPED_LIBRARIES:\n";
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), maps)) > 0) {
+            out.append(buf, n);
+        }
+        fclose(maps);
+    }
+#endif
+    return out;
+}
+
+bool HeapProfiler::dump(const std::string& path) {
+    ScopedBusy busy;
+    FILE* fp = fopen(path.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    const std::string text = pprofText();
+    const bool ok = fwrite(text.data(), 1, text.size(), fp) == text.size();
+    return fclose(fp) == 0 && ok;
+}
+
+void HeapProfiler::setDumpThreshold(uint64_t bytes,
+                                    const std::string& pathPrefix) {
+    ScopedBusy busy;
+    AutoLock lock(mImpl->lock);
+    mImpl->dumpStep = bytes;
+    mImpl->dumpPrefix = pathPrefix;
+    mImpl->nextDump = mImpl->liveEstimate + bytes;
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,141 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/memory/HeapProfiler.h"
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+
+using android::base::HeapProfiler;
+
+namespace {
+
+const void* fakePointer(uintptr_t index) {
+    return reinterpret_cast<const void*>(0x10000 + index * 64);
+}
+
+}  // namespace
+
+// Tests that every allocation is sampled at a tiny interval and that frees
+// retire their samples.
+TEST(HeapProfiler, TracksLiveSamples) {
+    HeapProfiler profiler;
+    profiler.start(1);
+    for (uintptr_t i = 0; i < 100; ++i) {
+        profiler.recordAllocation(fakePointer(i), 64);
+    }
+    for (uintptr_t i = 0; i < 40; ++i) {
+        profiler.recordFree(fakePointer(i));
+    }
+    // Never sampled; must be ignored.
+    profiler.recordFree(fakePointer(1000));
+
+    HeapProfiler::Summary summary = profiler.summary();
+    EXPECT_EQ(100u, summary.sampledAllocations);
+    EXPECT_EQ(60u, summary.liveSamples);
+    EXPECT_EQ(100u * 64, summary.allocatedBytes);
+    EXPECT_EQ(60u * 64, summary.liveBytes);
+
+    int stacks = 0;
+    profiler.forEachStack([&stacks](const HeapProfiler::StackUsage& usage) {
+        EXPECT_GT(usage.depth, 0);
+        ++stacks;
+    });
+    EXPECT_GT(stacks, 0);
+
+    profiler.reset();
+    EXPECT_EQ(0u, profiler.summary().sampledAllocations);
+    EXPECT_EQ(0u, profiler.summary().liveSamples);
+}
+
+// Tests that the totals estimated from the samples come close to what was
+// really allocated.
+TEST(HeapProfiler, EstimatesTotals) {
+    HeapProfiler profiler;
+    profiler.start(4096);
+    constexpr uint64_t kCount = 1000000;
+    constexpr size_t kSize = 256;
+    for (uintptr_t i = 0; i < kCount; ++i) {
+        profiler.recordAllocation(fakePointer(i), kSize);
+        profiler.recordFree(fakePointer(i));
+    }
+    HeapProfiler::Summary summary = profiler.summary();
+    EXPECT_EQ(0u, summary.liveBytes);
+    EXPECT_NEAR(double(kCount * kSize), double(summary.allocatedBytes),
+                0.05 * kCount * kSize);
+    EXPECT_LT(summary.sampledAllocations, kCount / 10);
+}
+
+// Tests that nothing is sampled once stopped.
+TEST(HeapProfiler, Stop) {
+    HeapProfiler profiler;
+    profiler.start(1);
+    profiler.stop();
+    EXPECT_FALSE(profiler.isEnabled());
+    profiler.recordAllocation(fakePointer(0), 64);
+    EXPECT_EQ(0u, profiler.summary().sampledAllocations);
+}
+
+// Tests the legacy text heap format pprof reads.
+TEST(HeapProfiler, PprofText) {
+    HeapProfiler profiler;
+    profiler.start(1);
+    profiler.recordAllocation(fakePointer(0), 100);
+    profiler.recordAllocation(fakePointer(1), 28);
+    profiler.recordFree(fakePointer(1));
+
+    const std::string text = profiler.pprofText();
+    EXPECT_EQ(0u, text.find("heap profile:      1:      100 [     2:      128]"
+                            " @ heap_v2/1\n"))
+            << text;
+    EXPECT_NE(std::string::npos, text.find("] @ 0x")) << text;
+}
+
+// Tests that crossing the threshold writes a profile, and that the next one
+// waits for another threshold's worth of growth.
+TEST(HeapProfiler, DumpsOnThreshold) {
+    const std::string prefix = ::testing::TempDir() + "heap_profiler_test";
+    const std::string first = prefix + ".1.heap";
+    const std::string second = prefix + ".2.heap";
+    const std::string third = prefix + ".3.heap";
+    remove(first.c_str());
+    remove(second.c_str());
+    remove(third.c_str());
+
+    HeapProfiler profiler;
+    profiler.start(1);
+    profiler.setDumpThreshold(1024, prefix);
+    for (uintptr_t i = 0; i < 40; ++i) {
+        profiler.recordAllocation(fakePointer(i), 64);
+    }
+
+    FILE* fp = fopen(first.c_str(), "rb");
+    ASSERT_NE(nullptr, fp);
+    char header[14] = {};
+    EXPECT_EQ(13u, fread(header, 1, 13, fp));
+    EXPECT_STREQ("heap profile:", header);
+    fclose(fp);
+
+    fp = fopen(second.c_str(), "rb");
+    EXPECT_NE(nullptr, fp);
+    if (fp) {
+        fclose(fp);
+    }
+    EXPECT_EQ(nullptr, fopen(third.c_str(), "rb"));
+
+    remove(first.c_str());
+    remove(second.c_str());
+}
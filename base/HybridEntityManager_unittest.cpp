@@ -13,8 +13,14 @@
 // limitations under the License.
 #include "aemu/base/containers/HybridEntityManager.h"
 
+#include "aemu/base/threads/FunctorThread.h"
+
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 namespace android {
 namespace base {
 
@@ -41,5 +47,61 @@ TEST(HybridEntityManager, UpdateIndex) {
     EXPECT_EQ(3, *m.get_const(indices[3]));
 }
 
+// Test: entity manager storage doesn't move as it grows, so items returned
+// by get() stay put.
+TEST(HybridEntityManager, StablePointers) {
+    HybridEntityManager<100000, uint64_t, int> m;
+    std::vector<uint64_t> handles;
+    std::vector<int*> items;
+    for (int i = 0; i < 5000; i++) {
+        handles.push_back(m.add(i, 1));
+        items.push_back(m.get(handles.back()));
+    }
+    for (int i = 0; i < 5000; i++) {
+        EXPECT_EQ(items[i], m.get(handles[i]));
+        EXPECT_EQ(i, *items[i]);
+    }
+    m.remove(handles[10]);
+    EXPECT_EQ(nullptr, m.get(handles[10]));
+    EXPECT_EQ(nullptr, m.get_const(handles[10]));
+}
+
+// Test: lookups on both halves stay correct while another thread adds and
+// removes entries.
+TEST(HybridEntityManager, ConcurrentLookups) {
+    TestHCM m;
+    std::vector<uint64_t> handles;
+    for (uint32_t i = 0; i < 2 * kTestMaxIndex; i++) {
+        handles.push_back(m.add(i, 1));
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> failures{0};
+    std::vector<std::unique_ptr<FunctorThread>> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back(new FunctorThread([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (uint32_t i = 0; i < handles.size(); i++) {
+                    const int* value = m.get_const(handles[i]);
+                    if (!value || *value != (int)i) {
+                        ++failures;
+                    }
+                }
+            }
+        }));
+        readers.back()->start();
+    }
+
+    for (int round = 0; round < 20000; round++) {
+        uint64_t handle = m.add(-1, 1);
+        m.remove(handle);
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader->wait();
+    }
+    EXPECT_EQ(0, failures.load());
+}
+
+}
 }
-}
\ No newline at end of file
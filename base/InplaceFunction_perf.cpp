@@ -0,0 +1,115 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/FunctionView.h"
+#include "aemu/base/InplaceFunction.h"
+
+#include "benchmark/benchmark.h"
+
+#include <functional>
+
+namespace android {
+namespace base {
+namespace {
+
+// A callback shaped like ConsumerCallbacks::getPtr: it captures three
+// pointers, more than std::function keeps without allocating.
+struct Context {
+    char* base = nullptr;
+    uint64_t calls = 0;
+    uint64_t mask = 0xffff;
+};
+
+template <class Function>
+void callLoop(benchmark::State& state, Function& f) {
+    uint64_t addr = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(f(addr++));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_Call_StdFunction(benchmark::State& state) {
+    Context context;
+    Context* c = &context;
+    uint64_t offset = 16;
+    std::function<char*(uint64_t)> f = [c, offset, &context](uint64_t addr) {
+        ++context.calls;
+        return c->base + ((addr + offset) & c->mask);
+    };
+    callLoop(state, f);
+}
+BENCHMARK(BM_Call_StdFunction);
+
+void BM_Call_InplaceFunction(benchmark::State& state) {
+    Context context;
+    Context* c = &context;
+    uint64_t offset = 16;
+    InplaceFunction<char*(uint64_t)> f = [c, offset, &context](uint64_t addr) {
+        ++context.calls;
+        return c->base + ((addr + offset) & c->mask);
+    };
+    callLoop(state, f);
+}
+BENCHMARK(BM_Call_InplaceFunction);
+
+void BM_Call_FunctionView(benchmark::State& state) {
+    Context context;
+    Context* c = &context;
+    uint64_t offset = 16;
+    auto lambda = [c, offset, &context](uint64_t addr) {
+        ++context.calls;
+        return c->base + ((addr + offset) & c->mask);
+    };
+    FunctionView<char*(uint64_t)> f = lambda;
+    callLoop(state, f);
+}
+BENCHMARK(BM_Call_FunctionView);
+
+// Building and copying the callback, as when ConsumerCallbacks are handed
+// to a new consumer.
+void BM_Copy_StdFunction(benchmark::State& state) {
+    Context context;
+    Context* c = &context;
+    uint64_t offset = 16;
+    for (auto _ : state) {
+        std::function<char*(uint64_t)> f = [c, offset, &context](uint64_t addr) {
+            ++context.calls;
+            return c->base + ((addr + offset) & c->mask);
+        };
+        std::function<char*(uint64_t)> copy = f;
+        benchmark::DoNotOptimize(copy);
+    }
+}
+BENCHMARK(BM_Copy_StdFunction);
+
+void BM_Copy_InplaceFunction(benchmark::State& state) {
+    Context context;
+    Context* c = &context;
+    uint64_t offset = 16;
+    for (auto _ : state) {
+        InplaceFunction<char*(uint64_t)> f = [c, offset, &context](uint64_t addr) {
+            ++context.calls;
+            return c->base + ((addr + offset) & c->mask);
+        };
+        InplaceFunction<char*(uint64_t)> copy = f;
+        benchmark::DoNotOptimize(copy);
+    }
+}
+BENCHMARK(BM_Copy_InplaceFunction);
+
+}  // namespace
+}  // namespace base
+}  // namespace android
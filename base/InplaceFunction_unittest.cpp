@@ -0,0 +1,88 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/InplaceFunction.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+namespace android {
+namespace base {
+
+// Tests calls through trivially copyable callables, and copies of them.
+TEST(InplaceFunction, Trivial) {
+    InplaceFunction<int(int)> empty;
+    EXPECT_FALSE(empty);
+
+    int base = 10;
+    InplaceFunction<int(int)> add = [&base](int x) { return base + x; };
+    ASSERT_TRUE(add);
+    EXPECT_EQ(15, add(5));
+
+    InplaceFunction<int(int)> copy = add;
+    base = 20;
+    EXPECT_EQ(25, copy(5));
+
+    InplaceFunction<int(int)> moved = std::move(add);
+    EXPECT_FALSE(add);
+    EXPECT_EQ(21, moved(1));
+
+    InplaceFunction<int(int)> plain = +[](int x) { return x * 2; };
+    EXPECT_EQ(8, plain(4));
+    plain = nullptr;
+    EXPECT_FALSE(plain);
+}
+
+// Tests that callables with destructors are copied, moved and destroyed
+// exactly once each.
+TEST(InplaceFunction, Managed) {
+    auto counter = std::make_shared<int>(0);
+    {
+        InplaceFunction<std::string()> f = [counter] {
+            return std::to_string(++*counter);
+        };
+        EXPECT_EQ(2, counter.use_count());
+        EXPECT_EQ("1", f());
+
+        InplaceFunction<std::string()> copy = f;
+        EXPECT_EQ(3, counter.use_count());
+        InplaceFunction<std::string()> moved = std::move(copy);
+        EXPECT_EQ(3, counter.use_count());
+        EXPECT_EQ("2", moved());
+
+        f = moved;
+        EXPECT_EQ(3, counter.use_count());
+        moved = InplaceFunction<std::string()>();
+        EXPECT_EQ(2, counter.use_count());
+    }
+    EXPECT_EQ(1, counter.use_count());
+}
+
+// Tests move-only arguments and a larger capacity.
+TEST(InplaceFunction, ArgumentsAndCapacity) {
+    struct Big {
+        char data[64] = {};
+    };
+    Big big;
+    big.data[63] = 7;
+    InplaceFunction<int(std::unique_ptr<int>), 80> f =
+            [big](std::unique_ptr<int> p) { return *p + big.data[63]; };
+    EXPECT_EQ(10, f(std::make_unique<int>(3)));
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,109 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/files/InplaceStream.h"
+
+#include <algorithm>
+
+#include <string.h>
+
+namespace android {
+namespace base {
+
+int InplaceStream::writtenSize() const {
+    return mWritePos;
+}
+
+int InplaceStream::readPos() const {
+    return mReadPos;
+}
+
+int InplaceStream::readSize() const {
+    return mWritePos - mReadPos;
+}
+
+const char* InplaceStream::currentRead() const {
+    return mData + mReadPos;
+}
+
+char* InplaceStream::currentWrite() const {
+    return mData + mWritePos;
+}
+
+ssize_t InplaceStream::advanceRead(size_t size) {
+    mReadPos += size;
+    return mReadPos;
+}
+
+ssize_t InplaceStream::advanceWrite(size_t size) {
+    mWritePos += size;
+    return mWritePos;
+}
+
+ssize_t InplaceStream::read(void* buffer, size_t size) {
+    const int sizeToRead = std::min<size_t>(size, readSize());
+    memcpy(buffer, currentRead(), sizeToRead);
+    mReadPos += sizeToRead;
+    return sizeToRead;
+}
+
+ssize_t InplaceStream::write(const void* buffer, size_t size) {
+    const int sizeToWrite = std::min<size_t>(size, mDataLen - mWritePos);
+    memcpy(currentWrite(), buffer, sizeToWrite);
+    mWritePos += sizeToWrite;
+    return sizeToWrite;
+}
+
+const char* InplaceStream::readInPlace(size_t size) {
+    if (size > (size_t)readSize()) {
+        return nullptr;
+    }
+    const char* data = currentRead();
+    mReadPos += size;
+    return data;
+}
+
+void InplaceStream::putStringNullTerminated(const char* str) {
+    const size_t size = strlen(str) + 1;
+    putBe32(size);
+    write(str, size);
+}
+
+const char* InplaceStream::getStringNullTerminated() {
+    const size_t size = getBe32();
+    if (size == 0 || size > (size_t)readSize()) {
+        return nullptr;
+    }
+    const char* str = currentRead();
+    advanceRead(size);
+    return str;
+}
+
+void InplaceStream::save(Stream* stream) const {
+    stream->putBe32(mDataLen);
+    stream->putBe32(mReadPos);
+    stream->putBe32(mWritePos);
+    stream->write(mData, mDataLen);
+}
+
+// The buffer isn't ours to resize, so it must be as large as the saved one.
+void InplaceStream::load(Stream* stream) {
+    mDataLen = stream->getBe32();
+    mReadPos = stream->getBe32();
+    mWritePos = stream->getBe32();
+    stream->read(mData, mDataLen);
+}
+
+}  // namespace base
+}  // namespace android
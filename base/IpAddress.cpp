@@ -0,0 +1,192 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/network/IpAddress.h"
+
+#ifdef _WIN32
+#include "aemu/base/sockets/Winsock.h"
+#else
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace android {
+namespace base {
+
+IpAddress::IpAddress(const Ipv6Address bytes, uint32_t scope_id)
+    : mKind(Kind::Ipv6) {
+    memcpy(mIpv6.mAddr, bytes, sizeof(mIpv6.mAddr));
+    mIpv6.mScopeId = scope_id;
+}
+
+IpAddress::IpAddress(const char* string) {
+    if (!string) {
+        return;
+    }
+
+    in_addr addr4;
+    if (inet_pton(AF_INET, string, &addr4) == 1) {
+        mKind = Kind::Ipv4;
+        mIpv4 = ntohl(addr4.s_addr);
+        return;
+    }
+
+    // Split an optional '%<scope>' suffix, where <scope> is a decimal
+    // interface index or an interface name.
+    std::string address(string);
+    uint32_t scopeId = 0;
+    const size_t percent = address.find('%');
+    if (percent != std::string::npos) {
+        const std::string scope = address.substr(percent + 1);
+        address.resize(percent);
+        if (scope.empty()) {
+            return;
+        }
+        char* end = nullptr;
+        const unsigned long index = strtoul(scope.c_str(), &end, 10);
+        if (*end == '\0') {
+            scopeId = static_cast<uint32_t>(index);
+        } else {
+#ifdef _WIN32
+            return;
+#else
+            scopeId = if_nametoindex(scope.c_str());
+            if (!scopeId) {
+                return;
+            }
+#endif
+        }
+    }
+
+    in6_addr addr6;
+    if (inet_pton(AF_INET6, address.c_str(), &addr6) == 1) {
+        mKind = Kind::Ipv6;
+        memcpy(mIpv6.mAddr, &addr6, sizeof(mIpv6.mAddr));
+        mIpv6.mScopeId = scopeId;
+    }
+}
+
+bool IpAddress::operator==(const IpAddress& other) const {
+    if (mKind != other.mKind) {
+        return false;
+    }
+    switch (mKind) {
+        case Kind::Ipv4:
+            return mIpv4 == other.mIpv4;
+        case Kind::Ipv6:
+            return !memcmp(mIpv6.mAddr, other.mIpv6.mAddr,
+                           sizeof(mIpv6.mAddr)) &&
+                   mIpv6.mScopeId == other.mIpv6.mScopeId;
+        default:
+            return true;
+    }
+}
+
+bool IpAddress::operator<(const IpAddress& other) const {
+    if (mKind != other.mKind) {
+        return mKind < other.mKind;
+    }
+    switch (mKind) {
+        case Kind::Ipv4:
+            return mIpv4 < other.mIpv4;
+        case Kind::Ipv6: {
+            const int cmp = memcmp(mIpv6.mAddr, other.mIpv6.mAddr,
+                                   sizeof(mIpv6.mAddr));
+            if (cmp) {
+                return cmp < 0;
+            }
+            return mIpv6.mScopeId < other.mIpv6.mScopeId;
+        }
+        default:
+            return false;
+    }
+}
+
+std::string IpAddress::toString() const {
+    char buf[INET6_ADDRSTRLEN + 16];
+    switch (mKind) {
+        case Kind::Ipv4: {
+            in_addr addr4;
+            addr4.s_addr = htonl(mIpv4);
+            if (!inet_ntop(AF_INET, &addr4, buf, sizeof(buf))) {
+                return std::string();
+            }
+            return buf;
+        }
+        case Kind::Ipv6: {
+            in6_addr addr6;
+            memcpy(&addr6, mIpv6.mAddr, sizeof(addr6));
+            if (!inet_ntop(AF_INET6, &addr6, buf, sizeof(buf))) {
+                return std::string();
+            }
+            std::string result(buf);
+            if (mIpv6.mScopeId) {
+                result += '%';
+                result += std::to_string(mIpv6.mScopeId);
+            }
+            return result;
+        }
+        default:
+            return "<invalid>";
+    }
+}
+
+size_t IpAddress::hash() const {
+    // FNV-1a over the kind and the address bytes.
+    size_t result = static_cast<size_t>(14695981039346656037ULL);
+    auto mix = [&result](const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            result = (result ^ bytes[i]) * static_cast<size_t>(1099511628211ULL);
+        }
+    };
+    const int kind = static_cast<int>(mKind);
+    mix(&kind, sizeof(kind));
+    switch (mKind) {
+        case Kind::Ipv4:
+            mix(&mIpv4, sizeof(mIpv4));
+            break;
+        case Kind::Ipv6:
+            mix(mIpv6.mAddr, sizeof(mIpv6.mAddr));
+            mix(&mIpv6.mScopeId, sizeof(mIpv6.mScopeId));
+            break;
+        default:
+            break;
+    }
+    return result;
+}
+
+// static
+void IpAddress::copyFrom(IpAddress* dst, const IpAddress* src) {
+    dst->mKind = src->mKind;
+    switch (src->mKind) {
+        case Kind::Ipv4:
+            dst->mIpv4 = src->mIpv4;
+            break;
+        case Kind::Ipv6:
+            memcpy(dst->mIpv6.mAddr, src->mIpv6.mAddr, sizeof(dst->mIpv6.mAddr));
+            dst->mIpv6.mScopeId = src->mIpv6.mScopeId;
+            break;
+        default:
+            break;
+    }
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,68 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/network/IpAddress.h"
+
+#include <gtest/gtest.h>
+
+#include <unordered_set>
+
+namespace android {
+namespace base {
+
+TEST(IpAddress, ParseIpv4) {
+    IpAddress ip("127.0.0.1");
+    ASSERT_TRUE(ip.isIpv4());
+    EXPECT_EQ(0x7f000001u, ip.ipv4());
+    EXPECT_EQ("127.0.0.1", ip.toString());
+    EXPECT_EQ(ip, IpAddress(0x7f000001u));
+}
+
+TEST(IpAddress, ParseIpv6) {
+    IpAddress ip("::1");
+    ASSERT_TRUE(ip.isIpv6());
+    EXPECT_EQ(1, ip.ipv6Addr()[15]);
+    EXPECT_EQ(0u, ip.ipv6ScopeId());
+    EXPECT_EQ("::1", ip.toString());
+
+    IpAddress scoped("fe80::2%3");
+    ASSERT_TRUE(scoped.isIpv6());
+    EXPECT_EQ(3u, scoped.ipv6ScopeId());
+    EXPECT_EQ("fe80::2%3", scoped.toString());
+    EXPECT_NE(scoped, IpAddress("fe80::2"));
+}
+
+TEST(IpAddress, Invalid) {
+    EXPECT_FALSE(IpAddress().valid());
+    EXPECT_FALSE(IpAddress("").valid());
+    EXPECT_FALSE(IpAddress("256.0.0.1").valid());
+    EXPECT_FALSE(IpAddress("::1%").valid());
+    EXPECT_FALSE(IpAddress("example.test").valid());
+}
+
+TEST(IpAddress, OrderingAndHash) {
+    IpAddress a(1u);
+    IpAddress b(2u);
+    IpAddress c("::1");
+    EXPECT_TRUE(a < b);
+    EXPECT_FALSE(b < a);
+    EXPECT_TRUE(a < c);
+
+    std::unordered_set<IpAddress> set = {a, b, c, IpAddress(1u)};
+    EXPECT_EQ(3u, set.size());
+}
+
+}  // namespace base
+}  // namespace android
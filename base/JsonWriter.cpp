@@ -0,0 +1,391 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/JsonWriter.h"
+
+#include "aemu/base/files/Stream.h"
+
+#include <charconv>
+#include <cmath>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace android {
+namespace base {
+
+namespace {
+
+inline bool isPlain(unsigned char c) {
+    return c >= 0x20 && c != '"' && c != '\\';
+}
+
+// True if any byte of |w| is below 0x20, '"' or '\\', checked eight bytes at
+// a time so long plain runs are found without a branch per byte.
+inline bool hasSpecialByte(uint64_t w) {
+    constexpr uint64_t kOnes = 0x0101010101010101ull;
+    constexpr uint64_t kHighs = 0x8080808080808080ull;
+    const uint64_t quotes = w ^ (kOnes * '"');
+    const uint64_t slashes = w ^ (kOnes * '\\');
+    return (((w - kOnes * 0x20) & ~w) | ((quotes - kOnes) & ~quotes) |
+            ((slashes - kOnes) & ~slashes)) &
+           kHighs;
+}
+
+void appendEscaped(std::string* out, unsigned char c) {
+    switch (c) {
+        case '"':
+            *out += "\\\"";
+            break;
+        case '\\':
+            *out += "\\\\";
+            break;
+        case '\b':
+            *out += "\\b";
+            break;
+        case '\f':
+            *out += "\\f";
+            break;
+        case '\n':
+            *out += "\\n";
+            break;
+        case '\r':
+            *out += "\\r";
+            break;
+        case '\t':
+            *out += "\\t";
+            break;
+        default: {
+            static constexpr char kHex[] = "0123456789abcdef";
+            const char buf[6] = {'\\', 'u', '0', '0', kHex[c >> 4],
+                                 kHex[c & 0xf]};
+            out->append(buf, sizeof(buf));
+            break;
+        }
+    }
+}
+
+// Appends |str| as a JSON string, copying runs of plain bytes in one go.
+void appendQuoted(std::string* out, std::string_view str) {
+    *out += '"';
+    const char* p = str.data();
+    const char* const end = p + str.size();
+    while (p < end) {
+        const char* run = p;
+        while (p < end) {
+            uint64_t w;
+            if (end - p >= 8 && (memcpy(&w, p, 8), !hasSpecialByte(w))) {
+                p += 8;
+            } else if (isPlain(*p)) {
+                ++p;
+            } else {
+                break;
+            }
+        }
+        out->append(run, p - run);
+        if (p < end) {
+            appendEscaped(out, *p++);
+        }
+    }
+    *out += '"';
+}
+
+// Formats |val| into |buf| and returns the end of the text.
+template <class T>
+char* formatInt(char* buf, size_t size, T val) {
+    return std::to_chars(buf, buf + size, val).ptr;
+}
+
+// The shortest of 15 or |maxDigits| significant digits that reads back as
+// |val|, as printf's %g would print it. JSON has no NaN or infinity.
+char* formatDouble(char* buf, size_t size, double val, int maxDigits) {
+    if (!std::isfinite(val)) {
+        memcpy(buf, "null", 4);
+        return buf + 4;
+    }
+#if defined(__cpp_lib_to_chars)
+    char* end = std::to_chars(buf, buf + size, val, std::chars_format::general,
+                              15).ptr;
+    double back;
+    std::from_chars(buf, end, back);
+    if (back != val) {
+        end = std::to_chars(buf, buf + size, val, std::chars_format::general,
+                            maxDigits).ptr;
+    }
+    return end;
+#else
+    int len = snprintf(buf, size, "%.15g", val);
+    if (strtod(buf, nullptr) != val) {
+        len = snprintf(buf, size, "%.*g", maxDigits, val);
+    }
+    return buf + len;
+#endif
+}
+
+}  // namespace
+
+JsonWriter::JsonWriter() : mNeedClose(false), mAggregateIndices(1, 0) {}
+
+JsonWriter::JsonWriter(const std::string& outputPath)
+    : mFp(fopen(outputPath.c_str(), "wb")), mAggregateIndices(1, 0) {}
+
+JsonWriter::JsonWriter(Stream* stream)
+    : mNeedClose(false), mStream(stream), mAggregateIndices(1, 0) {
+    mContents.reserve(kStreamChunkSize + kStreamChunkSize / 4);
+}
+
+JsonWriter::~JsonWriter() {
+    flush();
+    if (mFp && mNeedClose) {
+        fclose(static_cast<FILE*>(mFp));
+    }
+}
+
+std::string JsonWriter::contents() const {
+    return mContents;
+}
+
+void JsonWriter::flush() {
+    if (mStream) {
+        // Nothing keeps the text around, so the buffer is reused.
+        mStream->write(mContents.data(), mContents.size());
+        mStreamed += mContents.size();
+        mContents.clear();
+        return;
+    }
+    if (!mFp) {
+        return;
+    }
+    FILE* fp = static_cast<FILE*>(mFp);
+    fwrite(mContents.data() + mFlushed, 1, mContents.size() - mFlushed, fp);
+    fflush(fp);
+    mFlushed = mContents.size();
+}
+
+void JsonWriter::reserve(size_t size) {
+    mContents.reserve(size);
+}
+
+void JsonWriter::setIndent(const std::string& indent) {
+    mIndent = indent;
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    beginValue();
+    mContents += '{';
+    incrAggregateIndex();
+    pushAggregate();
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    endAggregate('}');
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    beginValue();
+    mContents += '[';
+    incrAggregateIndex();
+    pushAggregate();
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    endAggregate(']');
+    return *this;
+}
+
+JsonWriter& JsonWriter::name(std::string_view string) {
+    insertComma();
+    newlineAndIndent();
+    appendQuoted(&mContents, string);
+    mContents += mIndent.empty() ? ":" : ": ";
+    mInKeyVal = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::nameAsStr(int val) {
+    char buf[16];
+    return name(std::string_view(buf, formatInt(buf, sizeof(buf), val) - buf));
+}
+
+JsonWriter& JsonWriter::nameAsStr(long val) {
+    char buf[24];
+    return name(std::string_view(buf, formatInt(buf, sizeof(buf), val) - buf));
+}
+
+JsonWriter& JsonWriter::nameAsStr(float val) {
+    char buf[32];
+    return name(std::string_view(
+            buf, formatDouble(buf, sizeof(buf), double(val), 9) - buf));
+}
+
+JsonWriter& JsonWriter::nameAsStr(double val) {
+    char buf[32];
+    return name(std::string_view(
+            buf, formatDouble(buf, sizeof(buf), val, 17) - buf));
+}
+
+JsonWriter& JsonWriter::nameBoolAsStr(bool val) {
+    return name(val ? "true" : "false");
+}
+
+JsonWriter& JsonWriter::value(std::string_view string) {
+    beginValue();
+    appendQuoted(&mContents, string);
+    endValue();
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(int val) {
+    char buf[16];
+    beginValue();
+    mContents.append(buf, formatInt(buf, sizeof(buf), val) - buf);
+    endValue();
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(long val) {
+    char buf[24];
+    beginValue();
+    mContents.append(buf, formatInt(buf, sizeof(buf), val) - buf);
+    endValue();
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(float val) {
+    char buf[32];
+    beginValue();
+    mContents.append(buf, formatDouble(buf, sizeof(buf), double(val), 9) - buf);
+    endValue();
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double val) {
+    char buf[32];
+    beginValue();
+    mContents.append(buf, formatDouble(buf, sizeof(buf), val, 17) - buf);
+    endValue();
+    return *this;
+}
+
+JsonWriter& JsonWriter::valueBool(bool val) {
+    beginValue();
+    mContents += val ? "true" : "false";
+    endValue();
+    return *this;
+}
+
+JsonWriter& JsonWriter::valueAsStr(int val) {
+    char buf[16];
+    return value(std::string_view(buf, formatInt(buf, sizeof(buf), val) - buf));
+}
+
+JsonWriter& JsonWriter::valueAsStr(long val) {
+    char buf[24];
+    return value(std::string_view(buf, formatInt(buf, sizeof(buf), val) - buf));
+}
+
+JsonWriter& JsonWriter::valueAsStr(float val) {
+    char buf[32];
+    return value(std::string_view(
+            buf, formatDouble(buf, sizeof(buf), double(val), 9) - buf));
+}
+
+JsonWriter& JsonWriter::valueAsStr(double val) {
+    char buf[32];
+    return value(std::string_view(
+            buf, formatDouble(buf, sizeof(buf), val, 17) - buf));
+}
+
+JsonWriter& JsonWriter::valueBoolAsStr(bool val) {
+    return value(val ? "true" : "false");
+}
+
+JsonWriter& JsonWriter::valueNull() {
+    beginValue();
+    mContents += "null";
+    endValue();
+    return *this;
+}
+
+void JsonWriter::newlineAndIndent() {
+    if (mIndent.empty() || (mContents.empty() && mStreamed == 0)) {
+        return;
+    }
+    mContents += '\n';
+    for (size_t i = 1; i < mAggregateIndices.size(); ++i) {
+        mContents += mIndent;
+    }
+}
+
+void JsonWriter::pushAggregate() {
+    mAggregateIndices.push_back(0);
+}
+
+void JsonWriter::popAggregate() {
+    if (mAggregateIndices.size() > 1) {
+        mAggregateIndices.pop_back();
+    }
+}
+
+void JsonWriter::incrAggregateIndex() {
+    ++mAggregateIndices.back();
+}
+
+int JsonWriter::currentAggregateIndex() const {
+    return mAggregateIndices.back();
+}
+
+void JsonWriter::insertComma() {
+    if (currentAggregateIndex() > 0) {
+        mContents += ',';
+    }
+}
+
+// Values after a name() follow it on the same line; anything else is a new
+// element of the current aggregate.
+void JsonWriter::beginValue() {
+    if (mInKeyVal) {
+        mInKeyVal = false;
+    } else {
+        insertComma();
+        newlineAndIndent();
+    }
+}
+
+void JsonWriter::endValue() {
+    incrAggregateIndex();
+    if (mStream && mContents.size() >= kStreamChunkSize) {
+        flush();
+    }
+}
+
+void JsonWriter::endAggregate(char close) {
+    const bool empty = currentAggregateIndex() == 0;
+    popAggregate();
+    if (!empty) {
+        newlineAndIndent();
+    }
+    mContents += close;
+    if (mStream && mContents.size() >= kStreamChunkSize) {
+        flush();
+    }
+}
+
+}  // namespace base
+}  // namespace android
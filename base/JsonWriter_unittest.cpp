@@ -0,0 +1,123 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/JsonWriter.h"
+
+#include "aemu/base/files/MemStream.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <string>
+
+namespace android {
+namespace base {
+namespace {
+
+// Tests commas, nesting and escaping without indentation.
+TEST(JsonWriter, Compact) {
+    JsonWriter writer;
+    writer.beginObject();
+    writer.name("a").value(1);
+    writer.name("b").beginArray().value("x\"y\n").valueBool(true).valueNull();
+    writer.endArray();
+    writer.name("c").beginObject().endObject();
+    writer.name("d").value(0.5).name("e").valueAsStr(2L);
+    writer.endObject();
+    EXPECT_EQ("{\"a\":1,\"b\":[\"x\\\"y\\n\",true,null],\"c\":{},\"d\":0.5,"
+              "\"e\":\"2\"}",
+              writer.contents());
+}
+
+// Tests that each element goes on its own indented line.
+TEST(JsonWriter, Indented) {
+    JsonWriter writer;
+    writer.setIndent("  ");
+    writer.beginObject();
+    writer.name("list").beginArray().value(1).value(2).endArray();
+    writer.name("empty").beginArray().endArray();
+    writer.endObject();
+    EXPECT_EQ("{\n"
+              "  \"list\": [\n"
+              "    1,\n"
+              "    2\n"
+              "  ],\n"
+              "  \"empty\": []\n"
+              "}",
+              writer.contents());
+}
+
+// Tests special characters at every offset of a word-sized scan.
+TEST(JsonWriter, EscapeEverywhere) {
+    for (size_t pos = 0; pos < 20; ++pos) {
+        for (char c : {'"', '\\', '\x01', '\x1f', '\t'}) {
+            std::string str(20, 'a');
+            str[pos] = c;
+            std::string escaped;
+            switch (c) {
+                case '"': escaped = "\\\""; break;
+                case '\\': escaped = "\\\\"; break;
+                case '\x01': escaped = "\\u0001"; break;
+                case '\x1f': escaped = "\\u001f"; break;
+                default: escaped = "\\t"; break;
+            }
+            JsonWriter writer;
+            writer.value(str);
+            EXPECT_EQ("\"" + std::string(pos, 'a') + escaped +
+                              std::string(19 - pos, 'a') + "\"",
+                      writer.contents());
+        }
+    }
+
+    JsonWriter writer;
+    writer.beginArray().value("\xc3\xa9\x7f").value(std::string()).endArray();
+    EXPECT_EQ("[\"\xc3\xa9\x7f\",\"\"]", writer.contents());
+}
+
+// Tests that numbers keep the shortest of 15 digits that round-trips.
+TEST(JsonWriter, Numbers) {
+    JsonWriter writer;
+    writer.beginArray();
+    writer.value(0.1).value(1.0 / 3).value(0.1f).value(1e300).value(-7L);
+    writer.value(std::nan("")).value(-2147483647 - 1);
+    writer.endArray();
+    EXPECT_EQ("[0.1,0.33333333333333331,0.100000001,1e+300,-7,null,"
+              "-2147483648]",
+              writer.contents());
+}
+
+// Tests that a stream sink gets the same text in chunks.
+TEST(JsonWriter, Stream) {
+    MemStream stream;
+    std::string expected = "[";
+    {
+        JsonWriter writer(&stream);
+        writer.beginArray();
+        for (int i = 0; i < 20000; ++i) {
+            writer.value("item").value(i);
+            expected += (i ? ",\"item\"," : "\"item\",") + std::to_string(i);
+        }
+        writer.endArray();
+        EXPECT_GT(stream.writtenSize(), 0);
+        EXPECT_LT(writer.contents().size(), JsonWriter::kStreamChunkSize + 32);
+    }
+    expected += "]";
+    EXPECT_EQ(expected, std::string(stream.buffer().data(),
+                                    stream.buffer().size()));
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,116 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/LatencyHistogram.h"
+
+#include "aemu/base/Metrics.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace base {
+
+// Tests that every value lands in a bucket whose bounds hold it, within
+// 1/kSubBuckets.
+TEST(LatencyHistogram, Buckets) {
+    size_t last = 0;
+    for (uint64_t value = 0; value < 100000; ++value) {
+        const size_t bucket = LatencyHistogram::bucketOf(value);
+        EXPECT_GE(bucket, last);
+        last = bucket;
+        const uint64_t upper = LatencyHistogram::bucketUpperBound(bucket);
+        EXPECT_GE(upper, value);
+        EXPECT_LE(upper - value, value / LatencyHistogram::kSubBuckets);
+        if (bucket > 0) {
+            EXPECT_LT(LatencyHistogram::bucketUpperBound(bucket - 1), value);
+        }
+    }
+    EXPECT_EQ(LatencyHistogram::kBuckets - 1, LatencyHistogram::bucketOf(UINT64_MAX));
+    EXPECT_EQ(UINT64_MAX, LatencyHistogram::bucketUpperBound(LatencyHistogram::kBuckets - 1));
+}
+
+TEST(LatencyHistogram, Percentiles) {
+    LatencyHistogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.record(value);
+    }
+    LatencyHistogram::Summary summary = histogram.takeSummary();
+    EXPECT_EQ(1000u, summary.count);
+    EXPECT_EQ(1000u, summary.max);
+    EXPECT_GE(summary.p50, 500u);
+    EXPECT_LE(summary.p50, 500u + 500u / LatencyHistogram::kSubBuckets);
+    EXPECT_GE(summary.p90, 900u);
+    EXPECT_LE(summary.p90, 1000u);
+    EXPECT_GE(summary.p99, 990u);
+    EXPECT_LE(summary.p99, 1000u);
+
+    summary = histogram.takeSummary();
+    EXPECT_EQ(0u, summary.count);
+    EXPECT_EQ(0u, summary.max);
+}
+
+TEST(LatencyHistogram, ConcurrentRecords) {
+    constexpr int kThreads = 4;
+    constexpr int kRecords = 10000;
+    LatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&histogram, t] {
+            for (int i = 0; i < kRecords; ++i) {
+                histogram.record(t * kRecords + i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const LatencyHistogram::Summary summary = histogram.takeSummary();
+    EXPECT_EQ(uint64_t(kThreads * kRecords), summary.count);
+    EXPECT_EQ(uint64_t(kThreads * kRecords - 1), summary.max);
+}
+
+static std::map<int64_t, int64_t> sReported;
+
+TEST(LatencyHistogram, ReportsThroughMetricsLogger) {
+    auto previous = MetricsLogger::add_instant_event_with_metric_callback;
+    MetricsLogger::add_instant_event_with_metric_callback = [](int64_t code, int64_t value) {
+        sReported[code] = value;
+    };
+    sReported.clear();
+    for (int i = 0; i < static_cast<int>(LatencyMetric::kCount); ++i) {
+        latencyHistogram(static_cast<LatencyMetric>(i)).takeSummary();
+    }
+
+    recordLatency(LatencyMetric::kMediaDecode, 100);
+    recordLatency(LatencyMetric::kMediaDecode, 300);
+    reportLatencySummaries();
+    MetricsLogger::add_instant_event_with_metric_callback = previous;
+
+    // Only the metric recorded into is reported: count, p50, p99 and max.
+    ASSERT_EQ(4u, sReported.size());
+    auto it = sReported.begin();
+    EXPECT_EQ(2, it->second);
+    EXPECT_GE((++it)->second, 100);
+    EXPECT_LE(it->second, 100 + 100 / int64_t(LatencyHistogram::kSubBuckets));
+    EXPECT_EQ(300, (++it)->second);
+    EXPECT_EQ(300, (++it)->second);
+}
+
+}  // namespace base
+}  // namespace android
@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <stdint.h>
 #include <vector>
 
@@ -32,14 +33,30 @@ struct Rect {
     uint32_t pos_y;
     uint32_t width;
     uint32_t height;
+    // The display's own height; |height| grows as children are added.
+    uint32_t displayHeight;
     // indicates that this rectangle is a child of some parent rectangle.
     bool isChild;
 
-    std::vector<uint32_t> children;
+    // IDs and heights of the displays stacked on top of this one.
+    std::vector<std::pair<uint32_t, uint32_t>> children;
     Rect(uint32_t i, uint32_t x, uint32_t y, uint32_t w, uint32_t h)
-        : id(i), pos_x(x), pos_y(y), width(w), height(h), isChild(false) {}
+        : id(i), pos_x(x), pos_y(y), width(w), height(h), displayHeight(h),
+          isChild(false) {}
 };
 
+using Display = LayoutResolver::Display;
+using Layout = LayoutResolver::Layout;
+
+static std::vector<Display> toDisplays(const Layout& rect) {
+    std::vector<Display> displays;
+    displays.reserve(rect.size());
+    for (const auto& iter : rect) {
+        displays.push_back({iter.first, iter.second.first, iter.second.second});
+    }
+    return displays;
+}
+
 static double computeScore(const uint32_t combinedWidth,
                            const uint32_t combinedHeight,
                            const uint32_t firstRowWidth,
@@ -61,12 +78,9 @@ static double computeScore(const uint32_t combinedWidth,
  * Compute the coordinates for each rectangle using the lower left corner as
  * origin. Save the coordinates in @param retVal using id as the key.
  */
-static std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>>
-computeCoordinatesPerRow(
-        std::vector<Rect>& row,
-        uint32_t yOffset,
-        std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>>& displays) {
-    std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> retVal;
+static void computeCoordinatesPerRow(std::vector<Rect>& row,
+                                     uint32_t yOffset,
+                                     Layout& retVal) {
     std::stable_sort(row.begin(), row.end(), [](const Rect& a, const Rect& b) {
         return a.height > b.height || (a.height == b.height && a.id < b.id);
     });
@@ -74,19 +88,17 @@ computeCoordinatesPerRow(
     for (const auto& iter : row) {
         uint32_t displayId = iter.id;
         retVal[displayId] = std::make_pair(width, yOffset);
-        uint32_t cumulativeHeight = displays[displayId].second + yOffset;
-        for (auto id : iter.children) {
-            retVal[id] = std::make_pair(width, cumulativeHeight);
-            cumulativeHeight += displays[id].second;
+        uint32_t cumulativeHeight = iter.displayHeight + yOffset;
+        for (const auto& child : iter.children) {
+            retVal[child.first] = std::make_pair(width, cumulativeHeight);
+            cumulativeHeight += child.second;
         }
         width += iter.width;
     }
-    return retVal;
 }
 
-std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> resolveLayout(
-        std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> rect,
-        const double monitorAspectRatio) {
+static Layout resolveTwoRows(const std::vector<Display>& displays,
+                             const double monitorAspectRatio) {
     // Combine smaller rectangles into bigger ones by trying every pair of
     // rectangles but always maintain these two invariants. 1, Always start
     // combining from rectangle with smaller width. 2, The height of combined
@@ -95,13 +107,16 @@ std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> resolveLayout(
     // rectangle with bigger width as the newly-formed rectangle, the smaller
     // one is marked as children.
 
+    if (displays.empty()) {
+        return {};
+    }
+
     std::vector<Rect> rectangles;
     uint32_t maxHeight = 0;
-    for (const auto& iter : rect) {
-        uint32_t width = iter.second.first;
-        uint32_t height = iter.second.second;
-        rectangles.emplace_back(iter.first, 0, 0, width, height);
-        maxHeight = std::max(maxHeight, height);
+    rectangles.reserve(displays.size());
+    for (const Display& display : displays) {
+        rectangles.emplace_back(display.id, 0, 0, display.width, display.height);
+        maxHeight = std::max(maxHeight, display.height);
     }
 
     std::stable_sort(
@@ -112,9 +127,10 @@ std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> resolveLayout(
         for (int j = i + 1; j < rectangles.size(); j++) {
             if (rectangles[i].height + rectangles[j].height <= maxHeight) {
                 rectangles[i].isChild = true;
-                rectangles[j].children.push_back(rectangles[i].id);
+                rectangles[j].children.emplace_back(rectangles[i].id,
+                                                    rectangles[i].displayHeight);
                 if (!rectangles[i].children.empty()) {
-                    for (uint32_t it : rectangles[i].children) {
+                    for (const auto& it : rectangles[i].children) {
                         rectangles[j].children.push_back(it);
                     }
                 }
@@ -177,18 +193,124 @@ std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> resolveLayout(
         }
     }
 
-    std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> retVal;
+    Layout retVal;
+    retVal.reserve(displays.size());
     uint32_t yOffset = 0;
-    auto resFirstRow = computeCoordinatesPerRow(firstRow, yOffset, rect);
-    retVal.insert(resFirstRow.begin(), resFirstRow.end());
+    computeCoordinatesPerRow(firstRow, yOffset, retVal);
     uint32_t firstRowHeight = (firstRow.empty() ? 0 : firstRow[0].height);
 
     yOffset = firstRowHeight;
-    auto resSecRow = computeCoordinatesPerRow(secondRow, yOffset, rect);
-    retVal.insert(resSecRow.begin(), resSecRow.end());
+    computeCoordinatesPerRow(secondRow, yOffset, retVal);
 
     return retVal;
 }
 
+// |displays| sorted by id.
+static Layout stackDisplays(const std::vector<Display>& displays) {
+    uint32_t maxWidth = 0;
+    uint32_t totalHeight = 0;
+    for (const Display& display : displays) {
+        maxWidth = std::max(maxWidth, display.width);
+        totalHeight += display.height;
+    }
+    Layout retVal;
+    retVal.reserve(displays.size());
+    // The origin is the lower left corner, so the first display sits highest.
+    uint32_t top = totalHeight;
+    for (const Display& display : displays) {
+        top -= display.height;
+        retVal[display.id] = std::make_pair((maxWidth - display.width) / 2, top);
+    }
+    return retVal;
+}
+
+static bool byId(const Display& a, const Display& b) {
+    return a.id < b.id;
+}
+
+std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> resolveLayout(
+        const std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>>& rect,
+        const double monitorAspectRatio) {
+    return resolveTwoRows(toDisplays(rect), monitorAspectRatio);
+}
+
+std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> resolveStackedLayout(
+        const std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>>& rectangles,
+        uint32_t displayType) {
+    (void)displayType;
+    std::vector<Display> displays = toDisplays(rectangles);
+    std::sort(displays.begin(), displays.end(), byId);
+    return stackDisplays(displays);
+}
+
+static uint64_t displayHash(const Display& display) {
+    // splitmix64 of the packed display, so that summing them doesn't cancel
+    // out similar displays.
+    uint64_t x = (uint64_t(display.id) << 32) ^
+                 (uint64_t(display.width) << 16) ^ display.height;
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+size_t LayoutResolver::KeyHash::operator()(const Key& key) const {
+    return static_cast<size_t>(key.setHash ^ (key.param * 0x9E3779B97F4A7C15ull) ^
+                               uint64_t(key.stacked));
+}
+
+void LayoutResolver::setDisplay(uint32_t id, uint32_t width, uint32_t height) {
+    const Display display{id, width, height};
+    auto it = std::lower_bound(mKey.displays.begin(), mKey.displays.end(), display, byId);
+    if (it != mKey.displays.end() && it->id == id) {
+        mKey.setHash -= displayHash(*it);
+        *it = display;
+    } else {
+        mKey.displays.insert(it, display);
+    }
+    mKey.setHash += displayHash(display);
+}
+
+void LayoutResolver::removeDisplay(uint32_t id) {
+    auto it = std::lower_bound(mKey.displays.begin(), mKey.displays.end(),
+                               Display{id, 0, 0}, byId);
+    if (it != mKey.displays.end() && it->id == id) {
+        mKey.setHash -= displayHash(*it);
+        mKey.displays.erase(it);
+    }
+}
+
+void LayoutResolver::clear() {
+    mKey.displays.clear();
+    mKey.setHash = 0;
+}
+
+const LayoutResolver::Layout& LayoutResolver::resolve(double monitorAspectRatio) {
+    mKey.stacked = false;
+    static_assert(sizeof(mKey.param) == sizeof(monitorAspectRatio), "param holds a double");
+    memcpy(&mKey.param, &monitorAspectRatio, sizeof(mKey.param));
+    return lookup();
+}
+
+const LayoutResolver::Layout& LayoutResolver::resolveStacked(uint32_t displayType) {
+    mKey.stacked = true;
+    mKey.param = displayType;
+    return lookup();
+}
+
+const LayoutResolver::Layout& LayoutResolver::lookup() {
+    if (const std::shared_ptr<const Layout>* cached = mCache.get(mKey)) {
+        mCurrent = *cached;
+        return *mCurrent;
+    }
+    double monitorAspectRatio;
+    memcpy(&monitorAspectRatio, &mKey.param, sizeof(monitorAspectRatio));
+    mCurrent = std::make_shared<const Layout>(
+            mKey.stacked ? stackDisplays(mKey.displays)
+                         : resolveTwoRows(mKey.displays, monitorAspectRatio));
+    mCache.set(mKey, std::shared_ptr<const Layout>(mCurrent));
+    return *mCurrent;
+}
+
 }  // namespace base
 }  // namespace android
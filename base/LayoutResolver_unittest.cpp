@@ -85,5 +85,58 @@ TEST(LayoutResolver, FourDifferentDisplays) {
     }
 }
 
+TEST(LayoutResolver, Stacked) {
+    const std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> displays = {
+            {0, {1080, 600}}, {2, {800, 400}}, {1, {1000, 500}}};
+    const auto layout =
+            resolveStackedLayout(displays, AutomotiveDisplay::DISTANT_DISPLAY);
+    ASSERT_EQ(3u, layout.size());
+    EXPECT_EQ(std::make_pair(0u, 900u), layout.at(0));
+    EXPECT_EQ(std::make_pair(40u, 400u), layout.at(1));
+    EXPECT_EQ(std::make_pair(140u, 0u), layout.at(2));
+}
+
+// Tests that the resolver gives the free functions' layouts, and resolves a
+// set again only when it was not seen recently.
+TEST(LayoutResolver, Cached) {
+    const double kMonitorAspectRatio = 16.0 / 9.0;
+    std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> displays = {
+            {0, {1080, 1960}}, {1, {1080, 1860}}, {2, {1200, 1300}}};
+
+    LayoutResolver resolver;
+    for (const auto& display : displays) {
+        resolver.setDisplay(display.first, display.second.first,
+                            display.second.second);
+    }
+    EXPECT_EQ(resolveLayout(displays, kMonitorAspectRatio),
+              resolver.resolve(kMonitorAspectRatio));
+    EXPECT_EQ(0u, resolver.cacheStats().hits);
+
+    // Hotplug one display and back.
+    resolver.setDisplay(3, 1200, 1400);
+    displays[3] = {1200, 1400};
+    EXPECT_EQ(resolveLayout(displays, kMonitorAspectRatio),
+              resolver.resolve(kMonitorAspectRatio));
+    resolver.removeDisplay(3);
+    displays.erase(3);
+    EXPECT_EQ(resolveLayout(displays, kMonitorAspectRatio),
+              resolver.resolve(kMonitorAspectRatio));
+    EXPECT_EQ(1u, resolver.cacheStats().hits);
+    EXPECT_EQ(2u, resolver.cacheStats().misses);
+
+    // Resizing a display is a new set.
+    resolver.setDisplay(2, 1300, 1300);
+    displays[2] = {1300, 1300};
+    EXPECT_EQ(resolveLayout(displays, kMonitorAspectRatio),
+              resolver.resolve(kMonitorAspectRatio));
+    EXPECT_EQ(3u, resolver.cacheStats().misses);
+
+    EXPECT_EQ(resolveStackedLayout(displays, AutomotiveDisplay::GENERIC_DISPLAY),
+              resolver.resolveStacked(AutomotiveDisplay::GENERIC_DISPLAY));
+
+    resolver.clear();
+    EXPECT_TRUE(resolver.resolve(kMonitorAspectRatio).empty());
+}
+
 }  // namespace base
 }  // namespace android
@@ -0,0 +1,71 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/synchronization/Lock.h"
+
+#include <algorithm>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+namespace android {
+namespace base {
+
+namespace {
+
+// The fewest spins a SpinThenPark lock tries, however quickly it freed up
+// lately.
+constexpr int kMinLockSpins = 10;
+
+void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// With one CPU the holder can't make progress while we spin.
+bool spinningHelps() {
+    static const bool sHelps = std::thread::hardware_concurrency() > 1;
+    return sHelps;
+}
+
+}  // namespace
+
+bool StaticLock::spinThenPark() {
+    if (!spinningHelps()) {
+        parkRaw();
+        return false;
+    }
+    // Like glibc's adaptive mutexes: try up to twice what it took lately,
+    // then move the estimate an eighth of the way towards this time's.
+    const int limit = std::min(kMaxLockSpins, mSpinBudget * 2 + kMinLockSpins);
+    for (int spins = 1; spins <= limit; ++spins) {
+        cpuRelax();
+        if (tryLockRaw()) {
+            mSpinBudget += (spins - mSpinBudget) / 8;
+            return true;
+        }
+    }
+    parkRaw();
+    mSpinBudget += (limit - mSpinBudget) / 8;
+    return false;
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,157 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/containers/LockFreeBufferQueue.h"
+
+#include "aemu/base/threads/FunctorThread.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace base {
+
+TEST(SpscBufferQueue, Basic) {
+    SpscBufferQueue<std::string> queue(3);
+    EXPECT_EQ(4u, queue.capacity());
+
+    std::string out;
+    EXPECT_EQ(BufferQueueResult::TryAgain, queue.tryPop(&out));
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(BufferQueueResult::Ok, queue.tryPush(std::to_string(i)));
+    }
+    EXPECT_EQ(BufferQueueResult::TryAgain, queue.tryPush("full"));
+    EXPECT_EQ(BufferQueueResult::Timeout,
+              queue.push("full", getUnixTimeUs() + 1000));
+
+    EXPECT_EQ(BufferQueueResult::Ok, queue.tryPop(&out));
+    EXPECT_EQ("0", out);
+
+    queue.close();
+    EXPECT_EQ(BufferQueueResult::Error, queue.tryPush("closed"));
+    // What was pushed before close() still drains.
+    for (int i = 1; i < 4; ++i) {
+        EXPECT_EQ(BufferQueueResult::Ok, queue.pop(&out));
+        EXPECT_EQ(std::to_string(i), out);
+    }
+    EXPECT_EQ(BufferQueueResult::Error, queue.pop(&out));
+}
+
+TEST(SpscBufferQueue, Batch) {
+    SpscBufferQueue<int> queue(8);
+    int in[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    EXPECT_EQ(8u, queue.tryPushBatch(in, 10));
+    EXPECT_EQ(8u, queue.size());
+
+    int out[5];
+    EXPECT_EQ(5u, queue.tryPopBatch(out, 5));
+    EXPECT_EQ(4, out[4]);
+    // Wraps around the end of the ring.
+    EXPECT_EQ(2u, queue.tryPushBatch(in + 8, 2));
+    int rest[8];
+    EXPECT_EQ(5u, queue.tryPopBatch(rest, 8));
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(5 + i, rest[i]);
+    }
+}
+
+TEST(SpscBufferQueue, Threaded) {
+    constexpr int kCount = 100000;
+    SpscBufferQueue<int> queue(16);
+
+    FunctorThread producer([&queue] {
+        for (int i = 0; i < kCount; ++i) {
+            EXPECT_EQ(BufferQueueResult::Ok, queue.push(int(i)));
+        }
+        queue.close();
+        return 0;
+    });
+    producer.start();
+
+    int expected = 0;
+    int value;
+    while (queue.pop(&value) == BufferQueueResult::Ok) {
+        ASSERT_EQ(expected++, value);
+    }
+    producer.wait();
+    EXPECT_EQ(kCount, expected);
+}
+
+TEST(MpmcBufferQueue, Basic) {
+    MpmcBufferQueue<std::unique_ptr<int>> queue(2);
+    EXPECT_EQ(BufferQueueResult::Ok, queue.tryPush(std::make_unique<int>(1)));
+    EXPECT_EQ(BufferQueueResult::Ok, queue.tryPush(std::make_unique<int>(2)));
+    EXPECT_EQ(BufferQueueResult::TryAgain,
+              queue.tryPush(std::make_unique<int>(3)));
+
+    std::unique_ptr<int> out;
+    EXPECT_EQ(BufferQueueResult::Ok, queue.tryPop(&out));
+    EXPECT_EQ(1, *out);
+    queue.close();
+    EXPECT_EQ(BufferQueueResult::Ok, queue.tryPop(&out));
+    EXPECT_EQ(2, *out);
+    EXPECT_EQ(BufferQueueResult::Error, queue.tryPop(&out));
+    EXPECT_EQ(BufferQueueResult::Error, queue.pop(&out));
+}
+
+// Test: every item pushed by several producers is popped exactly once by
+// several consumers.
+TEST(MpmcBufferQueue, Threaded) {
+    constexpr int kProducers = 3;
+    constexpr int kConsumers = 3;
+    constexpr int kPerProducer = 20000;
+    MpmcBufferQueue<int> queue(8);
+
+    std::vector<std::unique_ptr<FunctorThread>> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back(new FunctorThread([&queue, p] {
+            for (int i = 0; i < kPerProducer; ++i) {
+                EXPECT_EQ(BufferQueueResult::Ok,
+                          queue.push(p * kPerProducer + i));
+            }
+            return 0;
+        }));
+    }
+    std::vector<std::vector<int>> seen(kConsumers);
+    std::vector<std::unique_ptr<FunctorThread>> consumers;
+    for (int c = 0; c < kConsumers; ++c) {
+        consumers.emplace_back(new FunctorThread([&queue, &seen, c] {
+            int value;
+            while (queue.pop(&value) == BufferQueueResult::Ok) {
+                seen[c].push_back(value);
+            }
+            return 0;
+        }));
+    }
+    for (auto& t : producers) t->start();
+    for (auto& t : consumers) t->start();
+    for (auto& t : producers) t->wait();
+    queue.close();
+    for (auto& t : consumers) t->wait();
+
+    std::vector<int> counts(kProducers * kPerProducer);
+    for (const auto& values : seen) {
+        for (int v : values) ++counts[v];
+    }
+    for (int count : counts) {
+        ASSERT_EQ(1, count);
+    }
+}
+
+}  // namespace base
+}  // namespace android
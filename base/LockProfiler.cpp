@@ -0,0 +1,212 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/synchronization/LockProfiler.h"
+
+#include "aemu/base/Tracing.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/system/FastClock.h"
+#include "aemu/base/system/System.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+
+namespace android {
+namespace base {
+
+namespace {
+
+bool enabledFromEnvironment() {
+    return getEnvironmentVariable("AEMU_LOCK_PROFILING") == "1";
+}
+
+struct SiteRegistry {
+    StaticLock lock;
+    std::map<std::string, std::unique_ptr<LockSite>> sites;
+};
+
+SiteRegistry& registry() {
+    static SiteRegistry* sRegistry = new SiteRegistry;
+    return *sRegistry;
+}
+
+}  // namespace
+
+std::atomic<bool> LockProfiler::sEnabled{enabledFromEnvironment()};
+
+LockSite::LockSite(const char* name) : mName(name) {
+    static const char* const kCounterSuffixes[kCounterCount] = {
+        "acquisitions",
+        "contended",
+        "spun",
+        "wait_p99_ns",
+        "hold_p99_ns",
+    };
+    for (int i = 0; i < kCounterCount; ++i) {
+        mCounterNames[i] = "lock:" + mName + ":" + kCounterSuffixes[i];
+    }
+}
+
+void LockSite::recordWaitStack(uint64_t waitNs,
+                               void* const* frames,
+                               size_t depth) {
+    uint64_t max = mMaxWaitNs.load(std::memory_order_relaxed);
+    while (waitNs > max) {
+        if (mMaxWaitNs.compare_exchange_weak(max, waitNs,
+                                             std::memory_order_relaxed)) {
+            mMaxWaitStack.store(internStack(frames, depth),
+                                std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+void LockProfiler::setEnabled(bool enabled) {
+    sEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+LockSite* LockProfiler::site(const char* name) {
+    SiteRegistry& r = registry();
+    AutoLock lock(r.lock);
+    std::unique_ptr<LockSite>& site = r.sites[name];
+    if (!site) {
+        site.reset(new LockSite(name));
+    }
+    return site.get();
+}
+
+uint64_t LockProfiler::nowNs() { return FastClock::nowNs(); }
+
+std::vector<LockSiteStats> LockProfiler::takeStats() {
+    std::vector<LockSiteStats> result;
+    SiteRegistry& r = registry();
+    AutoLock lock(r.lock);
+    for (auto& entry : r.sites) {
+        LockSite* site = entry.second.get();
+        LockSiteStats stats;
+        stats.name = site->mName;
+        stats.acquisitions =
+                site->mAcquisitions.exchange(0, std::memory_order_relaxed);
+        stats.contended = site->mContended.exchange(0, std::memory_order_relaxed);
+        stats.spun = site->mSpun.exchange(0, std::memory_order_relaxed);
+        stats.totalWaitNs =
+                site->mTotalWaitNs.exchange(0, std::memory_order_relaxed);
+        stats.maxWaitNs =
+                site->mMaxWaitNs.exchange(0, std::memory_order_relaxed);
+        stats.maxWaitStack = site->mMaxWaitStack.exchange(
+                kInvalidStackId, std::memory_order_relaxed);
+        stats.waitNs = site->mWaitNs.takeSummary();
+        stats.holdNs = site->mHoldNs.takeSummary();
+        if (stats.acquisitions) {
+            result.push_back(std::move(stats));
+        }
+    }
+    std::stable_sort(result.begin(), result.end(),
+                     [](const LockSiteStats& a, const LockSiteStats& b) {
+                         return a.totalWaitNs > b.totalWaitNs;
+                     });
+    return result;
+}
+
+void LockProfiler::traceStats() {
+    const std::vector<LockSiteStats> stats = takeStats();
+    SiteRegistry& r = registry();
+    AutoLock lock(r.lock);
+    for (const LockSiteStats& s : stats) {
+        const LockSite* site = r.sites[s.name].get();
+        const int64_t values[LockSite::kCounterCount] = {
+            static_cast<int64_t>(s.acquisitions),
+            static_cast<int64_t>(s.contended),
+            static_cast<int64_t>(s.spun),
+            static_cast<int64_t>(s.waitNs.p99),
+            static_cast<int64_t>(s.holdNs.p99),
+        };
+        for (int i = 0; i < LockSite::kCounterCount; ++i) {
+            traceCounter(site->mCounterNames[i].c_str(), values[i]);
+        }
+    }
+}
+
+namespace {
+
+// Times a blocking acquisition done by |lockRaw|, capturing the stack
+// before blocking so that the unwind overlaps the wait.
+template <class LockRaw>
+void timeContendedAcquire(LockSite* site, LockRaw&& lockRaw) {
+    void* frames[kMaxStackFrames];
+    const size_t depth = captureBacktrace(frames, kMaxStackFrames);
+    const uint64_t start = LockProfiler::nowNs();
+    lockRaw();
+    const uint64_t waitNs = LockProfiler::nowNs() - start;
+    site->recordAcquire(true, waitNs);
+    site->recordWaitStack(waitNs, frames, depth);
+}
+
+}  // namespace
+
+void StaticLock::profiledLock() {
+    LockSite* site = LockProfiler::site(mSite, mName);
+    if (tryLockRaw()) {
+        site->recordAcquire(false, 0);
+    } else {
+        bool spun = false;
+        timeContendedAcquire(site, [this, &spun] {
+            if (mWait == LockWait::SpinThenPark) {
+                spun = spinThenPark();
+            } else {
+                parkRaw();
+            }
+        });
+        if (spun) {
+            site->recordSpinAcquire();
+        }
+    }
+    mHoldStartNs = LockProfiler::nowNs();
+}
+
+void StaticLock::recordHold() {
+    mSite.load(std::memory_order_acquire)
+            ->recordHold(LockProfiler::nowNs() - mHoldStartNs);
+    mHoldStartNs = 0;
+}
+
+void ReadWriteLock::profiledLockRead() {
+    LockSite* site = LockProfiler::site(mSite, mName);
+    if (tryLockReadRaw()) {
+        site->recordAcquire(false, 0);
+        return;
+    }
+    timeContendedAcquire(site, [this] { lockReadRaw(); });
+}
+
+void ReadWriteLock::profiledLockWrite() {
+    LockSite* site = LockProfiler::site(mSite, mName);
+    if (tryLockWriteRaw()) {
+        site->recordAcquire(false, 0);
+    } else {
+        timeContendedAcquire(site, [this] { lockWriteRaw(); });
+    }
+    mWriteHoldStartNs = LockProfiler::nowNs();
+}
+
+void ReadWriteLock::recordWriteHold() {
+    mSite.load(std::memory_order_acquire)
+            ->recordHold(LockProfiler::nowNs() - mWriteHoldStartNs);
+    mWriteHoldStartNs = 0;
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,190 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/synchronization/LockProfiler.h"
+
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace base {
+
+namespace {
+
+class LockProfilerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        LockProfiler::setEnabled(true);
+        LockProfiler::takeStats();
+    }
+    void TearDown() override { LockProfiler::setEnabled(false); }
+
+    static LockSiteStats statsFor(const char* name) {
+        for (LockSiteStats& stats : LockProfiler::takeStats()) {
+            if (stats.name == name) {
+                return stats;
+            }
+        }
+        return {};
+    }
+};
+
+}  // namespace
+
+// Tests that uncontended acquisitions are counted and their holds timed.
+TEST_F(LockProfilerTest, Uncontended) {
+    Lock lock("LockProfilerTest.Uncontended");
+    for (int i = 0; i < 10; ++i) {
+        AutoLock autoLock(lock);
+    }
+    EXPECT_TRUE(lock.tryLock());
+    lock.unlock();
+
+    const LockSiteStats stats = statsFor("LockProfilerTest.Uncontended");
+    EXPECT_EQ(11u, stats.acquisitions);
+    EXPECT_EQ(0u, stats.contended);
+    EXPECT_EQ(0u, stats.waitNs.count);
+    EXPECT_EQ(11u, stats.holdNs.count);
+}
+
+// Tests that a thread blocked behind a holder records its wait.
+TEST_F(LockProfilerTest, Contended) {
+    Lock lock("LockProfilerTest.Contended");
+    lock.lock();
+    std::thread waiter([&lock] {
+        AutoLock autoLock(lock);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    lock.unlock();
+    waiter.join();
+
+    const LockSiteStats stats = statsFor("LockProfilerTest.Contended");
+    EXPECT_EQ(2u, stats.acquisitions);
+    EXPECT_EQ(1u, stats.contended);
+    EXPECT_EQ(1u, stats.waitNs.count);
+    EXPECT_GE(stats.waitNs.max, 10000000u);
+    EXPECT_EQ(stats.waitNs.max, stats.totalWaitNs);
+    EXPECT_EQ(stats.totalWaitNs, stats.maxWaitNs);
+    EXPECT_NE(kInvalidStackId, stats.maxWaitStack);
+    EXPECT_GE(stats.holdNs.max, 10000000u);
+}
+
+// Tests that a spinning lock still excludes, and parks when the holder
+// takes long.
+TEST_F(LockProfilerTest, SpinThenPark) {
+    Lock lock("LockProfilerTest.Spin", LockWait::SpinThenPark);
+    int counter = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&lock, &counter] {
+            for (int i = 0; i < 10000; ++i) {
+                AutoLock autoLock(lock);
+                ++counter;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(40000, counter);
+    LockSiteStats stats = statsFor("LockProfilerTest.Spin");
+    EXPECT_EQ(40000u, stats.acquisitions);
+    EXPECT_LE(stats.spun, stats.contended);
+
+    lock.lock();
+    std::thread waiter([&lock] {
+        AutoLock autoLock(lock);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    lock.unlock();
+    waiter.join();
+    stats = statsFor("LockProfilerTest.Spin");
+    EXPECT_EQ(1u, stats.contended);
+    EXPECT_EQ(0u, stats.spun);
+    EXPECT_GE(stats.waitNs.max, 10000000u);
+}
+
+// Tests that locks sharing a name share a site, and that nothing is
+// recorded while profiling is off.
+TEST_F(LockProfilerTest, SharedSiteAndDisabled) {
+    Lock a("LockProfilerTest.Shared");
+    Lock b("LockProfilerTest.Shared");
+    a.lock();
+    a.unlock();
+    b.lock();
+    b.unlock();
+
+    LockProfiler::setEnabled(false);
+    a.lock();
+    a.unlock();
+    LockProfiler::setEnabled(true);
+
+    EXPECT_EQ(LockProfiler::site("LockProfilerTest.Shared"),
+              LockProfiler::site("LockProfilerTest.Shared"));
+    EXPECT_EQ(2u, statsFor("LockProfilerTest.Shared").acquisitions);
+}
+
+// Tests that ConditionVariable waits don't count as holding the lock.
+TEST_F(LockProfilerTest, ConditionVariableWaitIsNotHeld) {
+    Lock lock("LockProfilerTest.CondVar");
+    ConditionVariable cv;
+    bool ready = false;
+    std::thread signaler([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        AutoLock autoLock(lock);
+        ready = true;
+        cv.signal();
+    });
+    {
+        AutoLock autoLock(lock);
+        cv.wait(&autoLock, [&ready] { return ready; });
+    }
+    signaler.join();
+
+    const LockSiteStats stats = statsFor("LockProfilerTest.CondVar");
+    EXPECT_EQ(2u, stats.acquisitions);
+    EXPECT_LT(stats.holdNs.max, 10000000u);
+}
+
+// Tests ReadWriteLock: counted reads, timed writes.
+TEST_F(LockProfilerTest, ReadWriteLock) {
+    ReadWriteLock lock("LockProfilerTest.ReadWrite");
+    {
+        AutoReadLock read(lock);
+        AutoReadLock read2(lock);
+    }
+    lock.lockWrite();
+    std::thread reader([&lock] {
+        AutoReadLock read(lock);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    lock.unlockWrite();
+    reader.join();
+
+    const LockSiteStats stats = statsFor("LockProfilerTest.ReadWrite");
+    EXPECT_EQ(4u, stats.acquisitions);
+    EXPECT_EQ(1u, stats.contended);
+    EXPECT_GE(stats.waitNs.max, 10000000u);
+    EXPECT_EQ(1u, stats.holdNs.count);
+}
+
+}  // namespace base
+}  // namespace android
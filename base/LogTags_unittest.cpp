@@ -0,0 +1,89 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#define VERBOSE_TAG_LIST     \
+    _VERBOSE_TAG(init, "")   \
+    _VERBOSE_TAG(gles, "")   \
+    _VERBOSE_TAG(hidden, "")
+
+// Everything but |hidden| is compiled in.
+#define VERBOSE_COMPILED_TAGS (~(uint64_t{1} << VERBOSE_hidden))
+
+#include "aemu/base/logging/LogTags.h"
+
+#include <gtest/gtest.h>
+
+// Normally provided by the logging library.
+uint64_t android_verbose = 0;
+
+namespace android {
+namespace base {
+namespace {
+
+int sPrinted = 0;
+
+void dprint(const char*, int) {
+    ++sPrinted;
+}
+
+int argument(int* evaluated) {
+    ++*evaluated;
+    return 0;
+}
+
+}  // namespace
+
+// Tests that checks follow the mask and skip the arguments of disabled tags.
+TEST(LogTags, CheckFollowsMask) {
+    android_verbose = 0;
+    EXPECT_FALSE(VERBOSE_CHECK(init));
+    EXPECT_FALSE(VERBOSE_CHECK_ANY());
+
+    int evaluated = 0;
+    sPrinted = 0;
+    VERBOSE_PRINT(gles, "%d", argument(&evaluated));
+    EXPECT_EQ(0, evaluated);
+    EXPECT_EQ(0, sPrinted);
+
+    android_verbose = uint64_t{1} << VERBOSE_gles;
+    EXPECT_FALSE(VERBOSE_CHECK(init));
+    EXPECT_TRUE(VERBOSE_CHECK(gles));
+    EXPECT_TRUE(VERBOSE_CHECK_ANY());
+    VERBOSE_PRINT(gles, "%d", argument(&evaluated));
+    EXPECT_EQ(1, evaluated);
+    EXPECT_EQ(1, sPrinted);
+
+    // Usable as the body of an unbraced if.
+    if (evaluated == 0)
+        VERBOSE_PRINT(gles, "%d", argument(&evaluated));
+    else
+        ++evaluated;
+    EXPECT_EQ(2, evaluated);
+    android_verbose = 0;
+}
+
+// Tests that tags left out of VERBOSE_COMPILED_TAGS never log.
+TEST(LogTags, CompiledOutTag) {
+    android_verbose = uint64_t{1} << VERBOSE_hidden;
+    EXPECT_FALSE(VERBOSE_CHECK(hidden));
+    EXPECT_FALSE(VERBOSE_CHECK_ANY());
+    android_verbose = ~uint64_t{0};
+    EXPECT_FALSE(VERBOSE_CHECK(hidden));
+    EXPECT_TRUE(VERBOSE_CHECK(init));
+    android_verbose = 0;
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,83 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/async/Looper.h"
+
+#include <algorithm>
+
+namespace android {
+namespace base {
+
+Looper::Looper() = default;
+
+Looper::~Looper() = default;
+
+// static
+const char* Looper::clockTypeToString(ClockType clock) {
+    switch (clock) {
+        case ClockType::kRealtime:
+            return "realtime";
+        case ClockType::kVirtual:
+            return "virtual";
+        case ClockType::kHost:
+            return "host";
+    }
+    return "unknown";
+}
+
+void Looper::run() {
+    runWithDeadlineMs(kDurationInfinite);
+}
+
+int Looper::runWithTimeoutMs(Duration timeoutMs) {
+    if (timeoutMs != kDurationInfinite) {
+        timeoutMs += nowMs();
+    }
+    return runWithDeadlineMs(timeoutMs);
+}
+
+Looper::Timer::Timer(Looper* looper,
+                     Callback callback,
+                     void* opaque,
+                     ClockType clock)
+    : mLooper(looper), mCallback(callback), mOpaque(opaque), mClockType(clock) {}
+
+Looper::Timer::~Timer() = default;
+
+Looper* Looper::Timer::parentLooper() const {
+    return mLooper;
+}
+
+void Looper::Timer::setSlackMs(Duration slackMs) {
+    mSlackMs = std::max<Duration>(slackMs, 0);
+}
+
+Looper::FdWatch::FdWatch(Looper* looper, int fd, Callback callback,
+                         void* opaque)
+    : mLooper(looper), mFd(fd), mCallback(callback), mOpaque(opaque) {}
+
+Looper::FdWatch::~FdWatch() = default;
+
+int Looper::FdWatch::fd() const {
+    return mFd;
+}
+
+Looper::Task::Task(Looper* looper, Callback&& callback)
+    : mLooper(looper), mCallback(std::move(callback)) {}
+
+Looper::Task::~Task() = default;
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,69 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/LruCache.h"
+
+#include "benchmark/benchmark.h"
+
+#include <stdint.h>
+
+namespace android {
+namespace base {
+namespace {
+
+constexpr size_t kCacheSize = 4096;
+
+void BM_LruCache_GetHit(benchmark::State& state) {
+    LruCache<uint32_t, uint64_t> cache(kCacheSize);
+    for (uint32_t i = 0; i < kCacheSize; ++i) {
+        cache.set(i, uint64_t(i));
+    }
+    uint32_t key = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.get(key));
+        key = (key + 7) % kCacheSize;
+    }
+}
+BENCHMARK(BM_LruCache_GetHit);
+
+void BM_LruCache_GetMiss(benchmark::State& state) {
+    LruCache<uint32_t, uint64_t> cache(kCacheSize);
+    for (uint32_t i = 0; i < kCacheSize; ++i) {
+        cache.set(i, uint64_t(i));
+    }
+    uint32_t key = kCacheSize;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.get(key++));
+    }
+}
+BENCHMARK(BM_LruCache_GetMiss);
+
+// Inserting into a full cache, so every set() evicts.
+void BM_LruCache_SetEvict(benchmark::State& state) {
+    LruCache<uint32_t, uint64_t> cache(
+            kCacheSize, SIZE_MAX, static_cast<LruCachePolicy>(state.range(0)));
+    uint32_t key = 0;
+    for (auto _ : state) {
+        cache.set(key, uint64_t(key));
+        ++key;
+    }
+}
+BENCHMARK(BM_LruCache_SetEvict)
+        ->Arg(int(LruCachePolicy::Lru))
+        ->Arg(int(LruCachePolicy::TwoQueue));
+
+}  // namespace
+}  // namespace base
+}  // namespace android
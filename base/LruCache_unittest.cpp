@@ -14,8 +14,12 @@
 
 #include "aemu/base/LruCache.h"
 
+#include "aemu/base/threads/FunctorThread.h"
+
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -91,6 +95,144 @@ TEST(LruCache, Basic) {
     ASSERT_THAT(lru.get(3), Pointee(StrEq("foo")));
 }
 
+TEST(LruCache, GetRefreshesEntry) {
+    LruCache<int, int> lru(3);
+    lru.set(1, 1);
+    lru.set(2, 2);
+    lru.set(3, 3);
+    ASSERT_THAT(lru.get(1), Pointee(1));
+    lru.set(4, 4);
+
+    EXPECT_THAT(lru.get(1), Pointee(1));
+    EXPECT_THAT(lru.get(2), IsNull());
+    EXPECT_THAT(lru.get(3), Pointee(3));
+    EXPECT_THAT(lru.get(4), Pointee(4));
+}
+
+TEST(LruCache, EvictsByCost) {
+    LruCache<int, std::string> lru(100, 10);
+    lru.set(1, "a", 4);
+    lru.set(2, "b", 4);
+    EXPECT_EQ(8u, lru.cost());
+    lru.set(3, "c", 4);
+
+    EXPECT_THAT(lru.get(1), IsNull());
+    EXPECT_THAT(lru.get(2), Pointee(StrEq("b")));
+    EXPECT_THAT(lru.get(3), Pointee(StrEq("c")));
+    EXPECT_EQ(8u, lru.cost());
+
+    // Too expensive to ever fit.
+    EXPECT_FALSE(lru.set(4, "d", 11));
+    EXPECT_THAT(lru.get(4), IsNull());
+
+    lru.set(2, "bb", 1);
+    EXPECT_EQ(5u, lru.cost());
+
+    const LruCacheStats stats = lru.stats();
+    EXPECT_EQ(2u, stats.evictions);
+    EXPECT_EQ(2u, stats.misses);
+    EXPECT_EQ(2u, stats.hits);
+    EXPECT_EQ(2u, stats.size);
+}
+
+TEST(LruCache, ManyEntries) {
+    LruCache<int, int> lru(1000);
+    for (int i = 0; i < 100000; ++i) {
+        lru.set(i, i * 2);
+    }
+    EXPECT_EQ(1000u, lru.size());
+    for (int i = 0; i < 99000; ++i) {
+        ASSERT_THAT(lru.get(i), IsNull());
+    }
+    for (int i = 99000; i < 100000; ++i) {
+        ASSERT_THAT(lru.get(i), Pointee(i * 2));
+    }
+    for (int i = 99000; i < 100000; i += 2) {
+        lru.remove(i);
+    }
+    EXPECT_EQ(500u, lru.size());
+}
+
+// Test: with TwoQueue, a scan over keys used once doesn't push out the
+// entries that are used repeatedly.
+TEST(LruCache, TwoQueueResistsScans) {
+    LruCache<int, int> lru(100, SIZE_MAX, LruCachePolicy::TwoQueue);
+    for (int i = 0; i < 50; ++i) {
+        lru.set(i, int(i));
+        lru.get(i);
+    }
+    for (int i = 1000; i < 2000; ++i) {
+        lru.set(i, int(i));
+    }
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_THAT(lru.get(i), Pointee(i)) << i;
+    }
+    EXPECT_EQ(100u, lru.size());
+
+    LruCache<int, int> plain(100);
+    for (int i = 0; i < 50; ++i) {
+        plain.set(i, int(i));
+        plain.get(i);
+    }
+    for (int i = 1000; i < 2000; ++i) {
+        plain.set(i, int(i));
+    }
+    EXPECT_THAT(plain.get(0), IsNull());
+}
+
+TEST(LruCache, TwoQueueTinyCache) {
+    LruCache<int, int> lru(1, SIZE_MAX, LruCachePolicy::TwoQueue);
+    lru.set(1, 1);
+    lru.get(1);
+    lru.set(2, 2);
+    EXPECT_THAT(lru.get(1), IsNull());
+    EXPECT_THAT(lru.get(2), Pointee(2));
+}
+
+TEST(ShardedLruCache, Basic) {
+    ShardedLruCache<int, std::string> cache(64, SIZE_MAX, LruCachePolicy::Lru, 4);
+    EXPECT_EQ(4u, cache.shardCount());
+    EXPECT_FALSE(cache.get(1).has_value());
+    cache.set(1, "one");
+    cache.set(2, "two");
+    EXPECT_EQ("one", cache.get(1).value());
+    EXPECT_EQ("two", cache.get(2).value());
+    cache.remove(1);
+    EXPECT_FALSE(cache.get(1).has_value());
+
+    const LruCacheStats stats = cache.stats();
+    EXPECT_EQ(2u, stats.hits);
+    EXPECT_EQ(2u, stats.misses);
+    EXPECT_EQ(1u, stats.size);
+}
+
+TEST(ShardedLruCache, ConcurrentAccess) {
+    ShardedLruCache<int, int> cache(512, 4096);
+    std::vector<std::unique_ptr<FunctorThread>> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back(new FunctorThread([&cache, t] {
+            for (int i = 0; i < 20000; ++i) {
+                const int key = (i * 7 + t) % 1000;
+                if (auto value = cache.get(key)) {
+                    EXPECT_EQ(key * 3, *value);
+                } else {
+                    cache.set(key, key * 3, 1 + key % 8);
+                }
+                if (i % 97 == 0) {
+                    cache.remove(key);
+                }
+            }
+        }));
+    }
+    for (auto& thread : threads) thread->start();
+    for (auto& thread : threads) thread->wait();
+
+    const LruCacheStats stats = cache.stats();
+    EXPECT_EQ(8u * 20000, stats.hits + stats.misses);
+    EXPECT_LE(stats.cost, 4096u);
+    EXPECT_GT(stats.evictions, 0u);
+}
+
 }  // namespace
 }  // namespace base
 }  // namespace android
\ No newline at end of file
@@ -15,6 +15,9 @@
 #include "aemu/base/files/MemStream.h"
 
 #include "aemu/base/files/StreamSerializing.h"
+#include "aemu/base/IOVector.h"
+#include "aemu/base/memory/NoDestructor.h"
+#include "aemu/base/synchronization/Lock.h"
 
 #include <algorithm>
 #include <utility>
@@ -24,32 +27,201 @@
 namespace android {
 namespace base {
 
+namespace {
+
+// Free segments shared by all segmented streams. Keeps up to
+// kMaxFreeSegments of them around, 64 MiB.
+class SegmentPool {
+public:
+    static constexpr size_t kMaxFreeSegments = 256;
+
+    static SegmentPool& get() {
+        static NoDestructor<SegmentPool> sPool;
+        return *sPool;
+    }
+
+    char* acquire() {
+        {
+            AutoLock lock(mLock);
+            if (!mFree.empty()) {
+                char* segment = mFree.back();
+                mFree.pop_back();
+                return segment;
+            }
+        }
+        return new char[MemStream::kSegmentSize];
+    }
+
+    void release(char* segment) {
+        {
+            AutoLock lock(mLock);
+            if (mFree.size() < kMaxFreeSegments) {
+                mFree.push_back(segment);
+                return;
+            }
+        }
+        delete[] segment;
+    }
+
+private:
+    Lock mLock;
+    std::vector<char*> mFree;
+};
+
+}  // namespace
+
 MemStream::MemStream(int reserveSize) {
     mData.reserve(reserveSize);
 }
 
 MemStream::MemStream(Buffer&& data) : mData(std::move(data)) {}
 
+MemStream::MemStream(Layout layout, size_t reserveSize) : mLayout(layout) {
+    reserve(reserveSize);
+}
+
+MemStream::MemStream(std::pmr::memory_resource* resource, size_t reserveSize)
+    : mLayout(Layout::Segmented), mResource(resource) {
+    reserve(reserveSize);
+}
+
+MemStream::~MemStream() {
+    releaseSegments();
+}
+
+MemStream::MemStream(MemStream&& other) noexcept
+    : mLayout(other.mLayout),
+      mResource(other.mResource),
+      mData(std::move(other.mData)),
+      mSegments(std::move(other.mSegments)),
+      mSize(std::exchange(other.mSize, 0)),
+      mReadPos(std::exchange(other.mReadPos, 0)),
+      mPb(std::exchange(other.mPb, nullptr)) {
+    other.mSegments.clear();
+}
+
+MemStream& MemStream::operator=(MemStream&& other) noexcept {
+    if (this != &other) {
+        releaseSegments();
+        mLayout = other.mLayout;
+        mResource = other.mResource;
+        mData = std::move(other.mData);
+        mSegments = std::move(other.mSegments);
+        other.mSegments.clear();
+        mSize = std::exchange(other.mSize, 0);
+        mReadPos = std::exchange(other.mReadPos, 0);
+        mPb = std::exchange(other.mPb, nullptr);
+    }
+    return *this;
+}
+
+void MemStream::releaseSegments() {
+    for (char* segment : mSegments) {
+        if (mResource) {
+            mResource->deallocate(segment, kSegmentSize);
+        } else {
+            SegmentPool::get().release(segment);
+        }
+    }
+    mSegments.clear();
+    mSize = 0;
+}
+
+void MemStream::reserve(size_t size) {
+    if (!segmented()) {
+        mData.reserve(size);
+        return;
+    }
+    while (mSegments.size() * kSegmentSize < size) {
+        mSegments.push_back(
+                mResource ? static_cast<char*>(mResource->allocate(kSegmentSize))
+                          : SegmentPool::get().acquire());
+    }
+}
+
 ssize_t MemStream::read(void* buffer, size_t size) {
     if (!buffer) {
         return 0;
     }
     const auto sizeToRead = std::min<int>(size, readSize());
-    memcpy(buffer, mData.data() + mReadPos, sizeToRead);
+    if (!segmented()) {
+        memcpy(buffer, mData.data() + mReadPos, sizeToRead);
+    } else {
+        char* out = static_cast<char*>(buffer);
+        size_t pos = mReadPos;
+        for (size_t left = sizeToRead; left;) {
+            const size_t offset = pos % kSegmentSize;
+            const size_t n = std::min(left, kSegmentSize - offset);
+            memcpy(out, mSegments[pos / kSegmentSize] + offset, n);
+            out += n;
+            pos += n;
+            left -= n;
+        }
+    }
     mReadPos += sizeToRead;
     return sizeToRead;
 }
 
+const char* MemStream::readInPlace(size_t size) {
+    if (size > (size_t)readSize()) {
+        return nullptr;
+    }
+    const char* data;
+    if (!segmented()) {
+        data = mData.data() + mReadPos;
+    } else {
+        const size_t offset = mReadPos % kSegmentSize;
+        if (offset + size > kSegmentSize) {
+            return nullptr;
+        }
+        data = mSegments[mReadPos / kSegmentSize] + offset;
+    }
+    mReadPos += size;
+    return data;
+}
+
+bool MemStream::seekRead(int64_t position) {
+    if (position < 0 || position > writtenSize()) {
+        return false;
+    }
+    mReadPos = position;
+    return true;
+}
+
 ssize_t MemStream::write(const void* buffer, size_t size) {
     if (!buffer) {
         return 0;
     }
-    mData.insert(mData.end(), (const char*)buffer, (const char*)buffer + size);
+    append(static_cast<const char*>(buffer), size);
     return size;
 }
 
+ssize_t MemStream::writev(const IOVector& iov) {
+    reserve(writtenSize() + iov.summedLength());
+    for (const auto& entry : iov) {
+        append(static_cast<const char*>(entry.iov_base), entry.iov_len);
+    }
+    return iov.summedLength();
+}
+
+void MemStream::append(const char* data, size_t size) {
+    if (!segmented()) {
+        mData.insert(mData.end(), data, data + size);
+        return;
+    }
+    reserve(mSize + size);
+    for (size_t left = size; left;) {
+        const size_t offset = mSize % kSegmentSize;
+        const size_t n = std::min(left, kSegmentSize - offset);
+        memcpy(mSegments[mSize / kSegmentSize] + offset, data, n);
+        data += n;
+        mSize += n;
+        left -= n;
+    }
+}
+
 int MemStream::writtenSize() const {
-    return (int)mData.size();
+    return segmented() ? (int)mSize : (int)mData.size();
 }
 
 int MemStream::readPos() const {
@@ -57,16 +229,53 @@ int MemStream::readPos() const {
 }
 
 int MemStream::readSize() const {
-    return mData.size() - mReadPos;
+    return writtenSize() - mReadPos;
+}
+
+const MemStream::Buffer& MemStream::buffer() const {
+    if (segmented()) {
+        mData.clear();
+        mData.reserve(mSize);
+        forEachSegment([this](const char* data, size_t size) {
+            mData.insert(mData.end(), data, data + size);
+        });
+    }
+    return mData;
+}
+
+void MemStream::appendSegmentsTo(IOVector* iov) const {
+    forEachSegment([iov](const char* data, size_t size) {
+        iov->push_back({const_cast<char*>(data), size});
+    });
 }
 
 void MemStream::save(Stream* stream) const {
-    saveBuffer(stream, mData);
+    if (!segmented()) {
+        saveBuffer(stream, mData);
+        return;
+    }
+    stream->putBe32(mSize);
+    forEachSegment([stream](const char* data, size_t size) {
+        stream->write(data, size);
+    });
 }
 
 void MemStream::load(Stream* stream) {
-    loadBuffer(stream, &mData);
     mReadPos = 0;
+    if (!segmented()) {
+        loadBuffer(stream, &mData);
+        return;
+    }
+    const size_t size = stream->getBe32();
+    mSize = 0;
+    reserve(size);
+    for (size_t i = 0; mSize < size; ++i) {
+        const size_t n = std::min(size - mSize, kSegmentSize);
+        if (stream->read(mSegments[i], n) != (ssize_t)n) {
+            break;
+        }
+        mSize += n;
+    }
 }
 
 void MemStream::rewind() {
@@ -0,0 +1,106 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/memory/MemoryHints.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace android {
+namespace base {
+
+uint64_t memoryPageSize() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+static void touchMemory(void* start, uint64_t length) {
+    const uint64_t pageSize = memoryPageSize();
+    auto bytes = static_cast<volatile char*>(start);
+    for (uint64_t i = 0; i < length; i += pageSize) {
+        (void)bytes[i];
+    }
+}
+
+bool memoryHint(void* start, uint64_t length, MemoryHint hint) {
+    if (hint == MemoryHint::Touch) {
+        touchMemory(start, length);
+        return true;
+    }
+#ifdef _WIN32
+    switch (hint) {
+        case MemoryHint::WillNeed: {
+            WIN32_MEMORY_RANGE_ENTRY range = {start, static_cast<SIZE_T>(length)};
+            return PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+        }
+        case MemoryHint::DontNeed:
+        case MemoryHint::PageOut:
+            // Drops the pages from the working set; they are still committed.
+            return VirtualUnlock(start, length) ||
+                   GetLastError() == ERROR_NOT_LOCKED;
+        default:
+            return false;
+    }
+#else
+    int advice;
+    switch (hint) {
+        case MemoryHint::DontNeed:
+            advice = MADV_DONTNEED;
+            break;
+        case MemoryHint::PageOut:
+#ifdef MADV_PAGEOUT
+            advice = MADV_PAGEOUT;
+#else
+            advice = MADV_DONTNEED;
+#endif
+            break;
+        case MemoryHint::Normal:
+            advice = MADV_NORMAL;
+            break;
+        case MemoryHint::Random:
+            advice = MADV_RANDOM;
+            break;
+        case MemoryHint::Sequential:
+            advice = MADV_SEQUENTIAL;
+            break;
+        case MemoryHint::WillNeed:
+            advice = MADV_WILLNEED;
+            break;
+        default:
+            return false;
+    }
+    return madvise(start, length, advice) == 0;
+#endif
+}
+
+bool zeroOutMemory(void* start, uint64_t length) {
+    // Not MADV_DONTNEED / MEM_RESET: on private file mappings and on Windows
+    // the pages would not be guaranteed to read back as zero.
+    memset(start, 0, length);
+    return true;
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,69 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/memory/MemoryHints.h"
+
+#include "aemu/base/AlignedBuf.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+using android::aligned_buf_alloc;
+using android::aligned_buf_free;
+
+namespace android {
+namespace base {
+
+TEST(MemoryHints, PageSizeIsPowerOfTwo) {
+    const uint64_t pageSize = memoryPageSize();
+    EXPECT_GT(pageSize, 0u);
+    EXPECT_EQ(0u, pageSize & (pageSize - 1));
+}
+
+TEST(MemoryHints, HintsKeepContents) {
+    const uint64_t pageSize = memoryPageSize();
+    const uint64_t size = 4 * pageSize;
+    auto data = static_cast<unsigned char*>(aligned_buf_alloc(pageSize, size));
+    for (uint64_t i = 0; i < size; i++) {
+        data[i] = i % 251;
+    }
+
+    EXPECT_TRUE(memoryHint(data, size, MemoryHint::WillNeed));
+    EXPECT_TRUE(memoryHint(data, size, MemoryHint::Touch));
+#ifndef _WIN32
+    EXPECT_TRUE(memoryHint(data, size, MemoryHint::Sequential));
+    EXPECT_TRUE(memoryHint(data, size, MemoryHint::Normal));
+#endif
+    for (uint64_t i = 0; i < size; i++) {
+        ASSERT_EQ(i % 251, data[i]);
+    }
+    aligned_buf_free(data);
+}
+
+TEST(MemoryHints, ZeroOutMemory) {
+    const uint64_t pageSize = memoryPageSize();
+    auto data = static_cast<unsigned char*>(aligned_buf_alloc(pageSize, 2 * pageSize));
+    memset(data, 0xab, 2 * pageSize);
+
+    EXPECT_TRUE(zeroOutMemory(data, pageSize));
+    for (uint64_t i = 0; i < pageSize; i++) {
+        ASSERT_EQ(0, data[i]);
+    }
+    EXPECT_EQ(0xab, data[pageSize]);
+    aligned_buf_free(data);
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,376 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/memory/MemoryPressure.h"
+
+#include "aemu/base/Metrics.h"
+#include "aemu/base/StatsPage.h"
+#include "aemu/base/StringParse.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+namespace android {
+namespace base {
+
+struct MemoryTrimmerEntry {
+    const char* name;
+    TrimCost cost;
+    int priority;
+    MemoryTrimCallback callback;
+};
+
+namespace {
+
+struct TrimStats {
+    const Stat trims =
+            StatsPage::get().add("memory_pressure.trims", StatKind::kCounter);
+    const Stat reclaimed = StatsPage::get().add(
+            "memory_pressure.reclaimed_bytes", StatKind::kCounter);
+};
+
+const TrimStats& trimStats() {
+    static const TrimStats sStats;
+    return sStats;
+}
+
+class TrimmerRegistry {
+public:
+    static TrimmerRegistry& get() {
+        static TrimmerRegistry* sRegistry = new TrimmerRegistry;
+        return *sRegistry;
+    }
+
+    void add(MemoryTrimmerEntry* entry) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mEntries.push_back(entry);
+    }
+
+    void remove(MemoryTrimmerEntry* entry) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mEntries.erase(std::find(mEntries.begin(), mEntries.end(), entry));
+    }
+
+    // Holds the lock throughout, so trimmers can't go away under it.
+    uint64_t trim(MemoryPressureLevel level, int* trimmers) {
+        std::lock_guard<std::mutex> lock(mLock);
+        std::vector<MemoryTrimmerEntry*> order;
+        for (MemoryTrimmerEntry* entry : mEntries) {
+            if (level == MemoryPressureLevel::kCritical ||
+                entry->cost == TrimCost::kCheap) {
+                order.push_back(entry);
+            }
+        }
+        std::stable_sort(order.begin(), order.end(),
+                         [](const MemoryTrimmerEntry* a,
+                            const MemoryTrimmerEntry* b) {
+                             if (a->cost != b->cost) {
+                                 return a->cost < b->cost;
+                             }
+                             return a->priority > b->priority;
+                         });
+        uint64_t reclaimed = 0;
+        for (MemoryTrimmerEntry* entry : order) {
+            reclaimed += entry->callback(level);
+        }
+        *trimmers = static_cast<int>(order.size());
+        return reclaimed;
+    }
+
+private:
+    std::mutex mLock;
+    std::vector<MemoryTrimmerEntry*> mEntries;
+};
+
+#ifdef __linux__
+
+// PSI averages, in percent of the last 10 seconds, past which pressure is
+// moderate (some task stalled on memory) or critical (all of them did).
+constexpr float kModerateSomeAvg10 = 10.0f;
+constexpr float kCriticalFullAvg10 = 10.0f;
+
+// The process' cgroup v2 memory.pressure, or the system-wide file if the
+// process isn't in one.
+const std::string& psiPath() {
+    static const std::string sPath = [] {
+        std::string path = "/proc/pressure/memory";
+        FILE* file = fopen("/proc/self/cgroup", "r");
+        if (!file) {
+            return path;
+        }
+        char line[1024];
+        while (fgets(line, sizeof(line), file)) {
+            if (strncmp(line, "0::", 3) != 0) {
+                continue;
+            }
+            std::string cgroup(line + 3);
+            while (!cgroup.empty() && cgroup.back() == '\n') {
+                cgroup.pop_back();
+            }
+            const std::string candidate =
+                    "/sys/fs/cgroup" + cgroup + "/memory.pressure";
+            if (access(candidate.c_str(), R_OK) == 0) {
+                path = candidate;
+            }
+            break;
+        }
+        fclose(file);
+        return path;
+    }();
+    return sPath;
+}
+
+#endif  // __linux__
+
+#ifdef __APPLE__
+
+void onDispatchMemoryPressure(void* context) {
+    auto source = static_cast<dispatch_source_t>(context);
+    const uintptr_t data = dispatch_source_get_data(source);
+    if (data & DISPATCH_MEMORYPRESSURE_CRITICAL) {
+        trimMemory(MemoryPressureLevel::kCritical);
+    } else if (data & DISPATCH_MEMORYPRESSURE_WARN) {
+        trimMemory(MemoryPressureLevel::kModerate);
+    }
+}
+
+class MemoryPressureMonitor {
+public:
+    static MemoryPressureMonitor& get() {
+        static MemoryPressureMonitor* sMonitor = new MemoryPressureMonitor;
+        return *sMonitor;
+    }
+
+    void start(std::chrono::milliseconds, std::chrono::milliseconds) {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mSource) {
+            return;
+        }
+        mSource = dispatch_source_create(
+                DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL,
+                dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+        if (!mSource) {
+            return;
+        }
+        dispatch_set_context(mSource, mSource);
+        dispatch_source_set_event_handler_f(mSource, onDispatchMemoryPressure);
+        dispatch_resume(mSource);
+    }
+
+    void stop() {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mSource) {
+            dispatch_source_cancel(mSource);
+            dispatch_release(mSource);
+            mSource = nullptr;
+        }
+    }
+
+private:
+    std::mutex mLock;
+    dispatch_source_t mSource = nullptr;
+};
+
+#else  // !__APPLE__
+
+class MemoryPressureMonitor {
+public:
+    static MemoryPressureMonitor& get() {
+        static MemoryPressureMonitor* sMonitor = new MemoryPressureMonitor;
+        return *sMonitor;
+    }
+
+    void start(std::chrono::milliseconds pollInterval,
+               std::chrono::milliseconds retrimInterval) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mPollInterval = pollInterval;
+        mRetrimInterval = retrimInterval;
+        if (mThread.joinable()) {
+            mCv.notify_all();
+            return;
+        }
+        mStop = false;
+        mThread = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        std::thread thread;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mStop = true;
+            thread = std::move(mThread);
+        }
+        mCv.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mLock);
+        auto next = std::chrono::steady_clock::now() + mPollInterval;
+        std::chrono::steady_clock::time_point lastTrim;
+        MemoryPressureLevel trimmed = MemoryPressureLevel::kNone;
+        while (!mStop) {
+            const std::chrono::milliseconds interval = mPollInterval;
+            if (mCv.wait_until(lock, next, [this, interval] {
+                    return mStop || mPollInterval != interval;
+                })) {
+                next = std::chrono::steady_clock::now() + mPollInterval;
+                continue;
+            }
+            const std::chrono::milliseconds retrimInterval = mRetrimInterval;
+            lock.unlock();
+            const MemoryPressureLevel level = currentMemoryPressure();
+            const auto now = std::chrono::steady_clock::now();
+            if (level == MemoryPressureLevel::kNone) {
+                trimmed = level;
+            } else if (level > trimmed || now - lastTrim >= retrimInterval) {
+                trimMemory(level);
+                trimmed = level;
+                lastTrim = now;
+            }
+            lock.lock();
+            next += mPollInterval;
+        }
+    }
+
+    std::mutex mLock;
+    std::condition_variable mCv;
+    std::thread mThread;
+    std::chrono::milliseconds mPollInterval{0};
+    std::chrono::milliseconds mRetrimInterval{0};
+    bool mStop = false;
+};
+
+#endif  // !__APPLE__
+
+}  // namespace
+
+const char* memoryPressureLevelName(MemoryPressureLevel level) {
+    switch (level) {
+        case MemoryPressureLevel::kNone:
+            return "none";
+        case MemoryPressureLevel::kModerate:
+            return "moderate";
+        case MemoryPressureLevel::kCritical:
+            return "critical";
+    }
+    return "unknown";
+}
+
+MemoryTrimmer::MemoryTrimmer(const char* name,
+                             TrimCost cost,
+                             int priority,
+                             MemoryTrimCallback callback)
+    : mEntry(new MemoryTrimmerEntry{name, cost, priority, std::move(callback)}) {
+    TrimmerRegistry::get().add(mEntry);
+}
+
+MemoryTrimmer::~MemoryTrimmer() {
+    TrimmerRegistry::get().remove(mEntry);
+    delete mEntry;
+}
+
+void MemoryTrimmer::reportReclaimed(uint64_t bytes) {
+    trimStats().reclaimed.add(static_cast<int64_t>(bytes));
+}
+
+uint64_t trimMemory(MemoryPressureLevel level) {
+    if (level == MemoryPressureLevel::kNone) {
+        return 0;
+    }
+    int trimmers = 0;
+    const uint64_t reclaimed = TrimmerRegistry::get().trim(level, &trimmers);
+    const TrimStats& stats = trimStats();
+    stats.trims.add(1);
+    stats.reclaimed.add(static_cast<int64_t>(reclaimed));
+    CreateMetricsLogger()->logMetricEvent(MetricEventMemoryTrim{
+            .level = level,
+            .trimmers = trimmers,
+            .reclaimedBytes = static_cast<int64_t>(reclaimed),
+    });
+    return reclaimed;
+}
+
+MemoryPressureLevel currentMemoryPressure() {
+#ifdef __linux__
+    FILE* file = fopen(psiPath().c_str(), "r");
+    if (!file) {
+        return MemoryPressureLevel::kNone;
+    }
+    float someAvg10 = 0;
+    float fullAvg10 = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        float avg10;
+        if (scan(line, "some avg10=%f", &avg10) == 1) {
+            someAvg10 = avg10;
+        } else if (scan(line, "full avg10=%f", &avg10) == 1) {
+            fullAvg10 = avg10;
+        }
+    }
+    fclose(file);
+    if (fullAvg10 >= kCriticalFullAvg10) {
+        return MemoryPressureLevel::kCritical;
+    }
+    if (someAvg10 >= kModerateSomeAvg10) {
+        return MemoryPressureLevel::kModerate;
+    }
+    return MemoryPressureLevel::kNone;
+#elif defined(_WIN32)
+    static const HANDLE sLowMemory =
+            CreateMemoryResourceNotification(LowMemoryResourceNotification);
+    BOOL low = FALSE;
+    if (sLowMemory && QueryMemoryResourceNotification(sLowMemory, &low) && low) {
+        return MemoryPressureLevel::kCritical;
+    }
+    // The notification only fires when memory is nearly gone; start with
+    // the cheap trims a bit earlier.
+    MEMORYSTATUSEX status = {sizeof(status)};
+    if (GlobalMemoryStatusEx(&status) && status.dwMemoryLoad >= 90) {
+        return MemoryPressureLevel::kModerate;
+    }
+    return MemoryPressureLevel::kNone;
+#else
+    return MemoryPressureLevel::kNone;
+#endif
+}
+
+void startMemoryPressureMonitor(std::chrono::milliseconds pollInterval,
+                                std::chrono::milliseconds retrimInterval) {
+    MemoryPressureMonitor::get().start(pollInterval, retrimInterval);
+}
+
+void stopMemoryPressureMonitor() { MemoryPressureMonitor::get().stop(); }
+
+}  // namespace base
+}  // namespace android
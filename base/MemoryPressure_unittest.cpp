@@ -0,0 +1,112 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/memory/MemoryPressure.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+// Records the order trimmers ran in.
+struct TrimLog {
+    std::vector<std::string> calls;
+
+    MemoryTrimCallback callback(std::string name, uint64_t bytes) {
+        return [this, name, bytes](MemoryPressureLevel) {
+            calls.push_back(name);
+            return bytes;
+        };
+    }
+};
+
+}  // namespace
+
+// Tests that moderate pressure only runs cheap trimmers, by priority.
+TEST(MemoryPressure, ModerateRunsCheapTrimmers) {
+    TrimLog log;
+    MemoryTrimmer cache("cache", TrimCost::kExpensive, 10,
+                        log.callback("cache", 1000));
+    MemoryTrimmer low("low", TrimCost::kCheap, 0, log.callback("low", 10));
+    MemoryTrimmer high("high", TrimCost::kCheap, 5, log.callback("high", 20));
+
+    EXPECT_EQ(30u, trimMemory(MemoryPressureLevel::kModerate));
+    EXPECT_EQ((std::vector<std::string>{"high", "low"}), log.calls);
+}
+
+// Tests that critical pressure runs every trimmer, cheap ones first.
+TEST(MemoryPressure, CriticalRunsAllCheapFirst) {
+    TrimLog log;
+    MemoryTrimmer cache("cache", TrimCost::kExpensive, 10,
+                        log.callback("cache", 1000));
+    MemoryTrimmer pool("pool", TrimCost::kCheap, 0, log.callback("pool", 10));
+
+    EXPECT_EQ(1010u, trimMemory(MemoryPressureLevel::kCritical));
+    EXPECT_EQ((std::vector<std::string>{"pool", "cache"}), log.calls);
+}
+
+// Tests that no pressure trims nothing, and that trimmers stop running
+// once destroyed.
+TEST(MemoryPressure, NoneAndUnregister) {
+    TrimLog log;
+    auto trimmer = std::make_unique<MemoryTrimmer>(
+            "pool", TrimCost::kCheap, 0, log.callback("pool", 10));
+    EXPECT_EQ(0u, trimMemory(MemoryPressureLevel::kNone));
+    EXPECT_TRUE(log.calls.empty());
+
+    trimmer.reset();
+    EXPECT_EQ(0u, trimMemory(MemoryPressureLevel::kCritical));
+    EXPECT_TRUE(log.calls.empty());
+}
+
+// Tests that the level passed on is the one trimMemory() was called with.
+TEST(MemoryPressure, PassesLevel) {
+    std::vector<MemoryPressureLevel> levels;
+    MemoryTrimmer trimmer("pool", TrimCost::kCheap, 0,
+                          [&levels](MemoryPressureLevel level) {
+                              levels.push_back(level);
+                              return uint64_t(0);
+                          });
+    trimMemory(MemoryPressureLevel::kModerate);
+    trimMemory(MemoryPressureLevel::kCritical);
+    EXPECT_EQ((std::vector<MemoryPressureLevel>{MemoryPressureLevel::kModerate,
+                                                MemoryPressureLevel::kCritical}),
+              levels);
+}
+
+// Tests that the monitor starts, restarts and stops cleanly whatever the
+// host's pressure is.
+TEST(MemoryPressure, MonitorStartStop) {
+    const MemoryPressureLevel level = currentMemoryPressure();
+    EXPECT_NE(nullptr, memoryPressureLevelName(level));
+
+    startMemoryPressureMonitor(std::chrono::milliseconds(1),
+                               std::chrono::milliseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    startMemoryPressureMonitor(std::chrono::milliseconds(2),
+                               std::chrono::milliseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    stopMemoryPressureMonitor();
+    stopMemoryPressureMonitor();
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,126 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/MemoryResource.h"
+
+#include "aemu/base/containers/SmallVector.h"
+#include "aemu/base/files/MemStream.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace base {
+
+// Tests that pmr containers draw from a BumpPool until it is reset.
+TEST(MemoryResource, BumpPool) {
+    BumpPool pool;
+    BumpPoolResource resource(&pool);
+    {
+        std::pmr::vector<uint64_t> values(&resource);
+        for (uint64_t i = 0; i < 1000; ++i) {
+            values.push_back(i);
+        }
+        std::pmr::string text("a string too long for the small buffer", &resource);
+        EXPECT_EQ(999u, values.back());
+        EXPECT_GE(pool.stats().bytesInUse, 1000 * sizeof(uint64_t));
+    }
+    void* aligned = resource.allocate(100, 256);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(aligned) % 256);
+    pool.freeAll();
+    EXPECT_EQ(0u, pool.stats().bytesInUse);
+}
+
+// Tests that Pool allocations keep their alignment, are given back, and
+// over-aligned ones go upstream.
+TEST(MemoryResource, Pool) {
+    Pool pool(8, 4096, 64);
+    PoolResource resource(&pool);
+    for (size_t alignment : {1, 8, 32, 64, 128}) {
+        void* ptr = resource.allocate(24, alignment);
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) % alignment) << alignment;
+        resource.deallocate(ptr, 24, alignment);
+    }
+    EXPECT_EQ(pool.stats().allocCount, pool.stats().freeCount);
+    EXPECT_EQ(4u, pool.stats().allocCount);
+
+    std::pmr::vector<int> values({1, 2, 3}, &resource);
+    EXPECT_EQ(5u, pool.stats().allocCount);
+}
+
+// Tests that a full SubAllocator spills to the upstream resource, and that
+// both kinds of allocations are freed where they came from.
+TEST(MemoryResource, SubAllocatorSpills) {
+    std::vector<char> buffer(4096);
+    SubAllocator allocator(buffer.data(), buffer.size(), 1024);
+    SubAllocatorResource resource(&allocator, 1024);
+
+    void* inside = resource.allocate(4096, 8);
+    EXPECT_TRUE(allocator.contains(inside));
+    void* outside = resource.allocate(100, 8);
+    EXPECT_FALSE(allocator.contains(outside));
+    resource.deallocate(outside, 100, 8);
+    resource.deallocate(inside, 4096, 8);
+    EXPECT_TRUE(allocator.empty());
+}
+
+// Tests that a SmallFixedVector grows into its resource, and that moving
+// between resources moves the elements rather than the array.
+TEST(MemoryResource, SmallVector) {
+    Pool pool(8, 4096, 64);
+    PoolResource resource(&pool);
+    {
+        SmallFixedVector<int, 4> values(&resource);
+        for (int i = 0; i < 10; ++i) {
+            values.push_back(i);
+        }
+        EXPECT_TRUE(values.isAllocated());
+        EXPECT_EQ(&resource, values.resource());
+        EXPECT_GT(pool.stats().bytesInUse, 0u);
+
+        SmallFixedVector<int, 4> onHeap;
+        onHeap = std::move(values);
+        EXPECT_EQ(nullptr, onHeap.resource());
+        ASSERT_EQ(10u, onHeap.size());
+        EXPECT_EQ(9, onHeap.back());
+
+        SmallFixedVector<int, 4> moved(std::move(values));
+        EXPECT_EQ(&resource, moved.resource());
+    }
+    EXPECT_EQ(pool.stats().allocCount, pool.stats().freeCount);
+}
+
+// Tests that a segmented MemStream takes its segments from the resource.
+TEST(MemoryResource, MemStream) {
+    BumpPool pool(MemStream::kSegmentSize);
+    BumpPoolResource resource(&pool);
+    std::vector<char> data(MemStream::kSegmentSize + 100);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = char(i * 13);
+    }
+    {
+        MemStream stream(&resource);
+        EXPECT_TRUE(stream.segmented());
+        stream.write(data.data(), data.size());
+        EXPECT_GE(pool.stats().bytesInUse, 2 * MemStream::kSegmentSize);
+        EXPECT_EQ(data, stream.buffer());
+    }
+    pool.freeAll();
+}
+
+}  // namespace base
+}  // namespace android
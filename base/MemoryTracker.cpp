@@ -14,6 +14,8 @@
 
 #include "aemu/base/memory/MemoryTracker.h"
 
+#include "aemu/base/memory/HeapProfiler.h"
+
 #define AEMU_TCMALLOC_ENABLED 0
 
 #ifndef AEMU_TCMALLOC_ENABLED
@@ -24,7 +26,6 @@
 #include <malloc_extension_c.h>
 #include <malloc_hook.h>
 
-#include <execinfo.h>
 #include <libunwind.h>
 #include <algorithm>
 #include <set>
@@ -89,45 +90,41 @@ public:
         return true;
     }
 
+    // The hooks only feed the sampling profiler; the stack is walked for
+    // sampled allocations alone, instead of on every malloc and free.
     void newHook(const void* ptr, size_t size) {
-        size = std::max(size, MallocExtension_GetAllocatedSize(ptr));
-        void* results[kStackTraceLimit];
-#if defined(__linux__)
-        int ret = unw_backtrace(results, kStackTraceLimit);
-#endif
-        for (int i = 5; i < ret; i++) {
-            intptr_t addr = (intptr_t)results[i];
-            /*
-             * The invariant is that all registered functions will be sorted
-             * based on the starting address. We can use binary search to test
-             * if an address falls within a specific function and reduce the
-             * look up time.
-             */
-            FuncRange func{"", addr, 0};
-            auto it = mData.upper_bound(&func);
-            if (it != mData.end() && (*it)->mAddr <= addr) {
-                (*it)->mStats.mAllocated += size;
-                (*it)->mStats.mLive += size;
-                break;
-            }
-        }
+        HeapProfiler::get().recordAllocation(
+                ptr, std::max(size, MallocExtension_GetAllocatedSize(ptr)));
     }
 
-    void deleteHook(const void* ptr) {
-        size_t size = MallocExtension_GetAllocatedSize(ptr);
-        void* results[kStackTraceLimit];
-#if defined(__linux__)
-        int ret = unw_backtrace(results, kStackTraceLimit);
-#endif
-        for (int i = 5; i < ret; i++) {
-            intptr_t addr = (intptr_t)results[i];
-            FuncRange func{"", addr, 0};
-            auto it = mData.upper_bound(&func);
-            if (it != mData.end() && (*it)->mAddr <= addr) {
-                (*it)->mStats.mLive -= size;
-                break;
-            }
+    void deleteHook(const void* ptr) { HeapProfiler::get().recordFree(ptr); }
+
+    // Attributes each sampled stack to the innermost registered function on
+    // it.
+    void refreshStats() {
+        for (auto it : mData) {
+            it->mStats.mAllocated = 0;
+            it->mStats.mLive = 0;
         }
+        HeapProfiler::get().forEachStack(
+                [this](const HeapProfiler::StackUsage& usage) {
+                    for (int i = 0; i < usage.depth; i++) {
+                        intptr_t addr = (intptr_t)usage.frames[i];
+                        /*
+                         * The invariant is that all registered functions will
+                         * be sorted based on the starting address. We can use
+                         * binary search to test if an address falls within a
+                         * specific function and reduce the look up time.
+                         */
+                        FuncRange func{"", addr, 0};
+                        auto it = mData.upper_bound(&func);
+                        if (it != mData.end() && (*it)->mAddr <= addr) {
+                            (*it)->mStats.mAllocated += usage.allocatedBytes;
+                            (*it)->mStats.mLive += usage.liveBytes;
+                            break;
+                        }
+                    }
+                });
     }
 
     std::string printUsage(int verbosity) {
@@ -137,7 +134,8 @@ public:
             return ss.str();
         }
 
-        auto stats = getUsage("EMUGL");
+        refreshStats();
+        auto stats = getUsage("EMUGL", false);
         ss << "EMUGL memory allocated: ";
         ss << (float)stats->mAllocated.load() / 1048576.0f;
         ss << "mb live: ";
@@ -176,9 +174,11 @@ public:
     }
 
     void start() {
+        HeapProfiler::get().start();
         if (!MallocHook::AddNewHook(&new_hook) ||
             !MallocHook::AddDeleteHook(&delete_hook)) {
             E("Failed to add malloc hooks.");
+            HeapProfiler::get().stop();
             enabled = false;
         } else {
             enabled = true;
@@ -189,12 +189,17 @@ public:
         if (enabled) {
             MallocHook::RemoveNewHook(&new_hook);
             MallocHook::RemoveDeleteHook(&delete_hook);
+            HeapProfiler::get().stop();
         }
     }
 
     bool isEnabled() { return enabled; }
 
-    std::unique_ptr<MallocStats> getUsage(const std::string& group) {
+    std::unique_ptr<MallocStats> getUsage(const std::string& group,
+                                          bool refresh = true) {
+        if (refresh) {
+            refreshStats();
+        }
         std::unique_ptr<MallocStats> ms(new MallocStats());
         for (auto& it : mData) {
             if (it->mName.compare(0, group.size(), group) == 0) {
@@ -209,7 +214,6 @@ private:
     bool enabled = false;
     std::set<FuncRange*, bool (*)(const FuncRange*, const FuncRange*)> mData;
     std::set<std::string> mRegisterFuncs;
-    static const int kStackTraceLimit = 32;
 #else
     bool addToGroup(std::string group, std::string func) {
         (void)group;
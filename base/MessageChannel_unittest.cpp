@@ -0,0 +1,110 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/synchronization/MessageChannel.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "aemu/base/system/System.h"
+
+namespace android {
+namespace base {
+namespace {
+
+template <class QueuePolicy>
+class MessageChannelTest : public ::testing::Test {};
+
+using QueuePolicies = ::testing::Types<LockingQueue, LockFreeQueue>;
+TYPED_TEST_SUITE(MessageChannelTest, QueuePolicies);
+
+TYPED_TEST(MessageChannelTest, SendReceiveInOrder) {
+    MessageChannel<int, 4, TypeParam> channel;
+    EXPECT_EQ(4u, channel.capacity());
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(channel.send(i));
+    }
+    EXPECT_EQ(4u, channel.size());
+    EXPECT_FALSE(channel.trySend(4));
+
+    for (int i = 0; i < 4; ++i) {
+        int msg = -1;
+        EXPECT_TRUE(channel.receive(&msg));
+        EXPECT_EQ(i, msg);
+    }
+    int msg;
+    EXPECT_FALSE(channel.tryReceive(&msg));
+    EXPECT_EQ(0u, channel.size());
+}
+
+TYPED_TEST(MessageChannelTest, TimedReceiveTimesOut) {
+    MessageChannel<int, 2, TypeParam> channel;
+    const uint64_t start = getUnixTimeUs();
+    EXPECT_FALSE(channel.timedReceive(start + 10000));
+    EXPECT_GE(getUnixTimeUs(), start + 10000);
+
+    channel.send(7);
+    auto msg = channel.timedReceive(getUnixTimeUs() + 10000);
+    ASSERT_TRUE(msg);
+    EXPECT_EQ(7, *msg);
+}
+
+TYPED_TEST(MessageChannelTest, StopWakesBlockedReceiverAndSender) {
+    MessageChannel<int, 1, TypeParam> channel;
+    std::thread receiver([&channel] {
+        int msg;
+        EXPECT_FALSE(channel.receive(&msg));
+    });
+    sleepMs(10);
+    channel.stop();
+    receiver.join();
+    EXPECT_TRUE(channel.isStopped());
+    EXPECT_FALSE(channel.send(1));
+    EXPECT_FALSE(channel.receive());
+}
+
+TYPED_TEST(MessageChannelTest, ManyProducersOneConsumer) {
+    constexpr int kProducers = 4;
+    constexpr int kMessagesPerProducer = 2000;
+    MessageChannel<int, 8, TypeParam> channel;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&channel] {
+            for (int i = 1; i <= kMessagesPerProducer; ++i) {
+                EXPECT_TRUE(channel.send(i));
+            }
+        });
+    }
+
+    int64_t sum = 0;
+    for (int i = 0; i < kProducers * kMessagesPerProducer; ++i) {
+        auto msg = channel.receive();
+        ASSERT_TRUE(msg);
+        sum += *msg;
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    EXPECT_EQ(int64_t(kProducers) * kMessagesPerProducer * (kMessagesPerProducer + 1) / 2,
+              sum);
+    channel.waitForEmpty();
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
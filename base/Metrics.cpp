@@ -15,9 +15,16 @@
 
 #include "aemu/base/Metrics.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 #include <variant>
+#include <vector>
 
 #include "host-common/logging.h"
 
@@ -38,6 +45,48 @@ constexpr int64_t kEmulatorGraphicsDuplicateSequenceNum = 10032;
 constexpr int64_t kEmulatorGraphicsVulkanOutOfMemory = 10033;
 constexpr int64_t kEmulatorGraphicsHangOther = 10034;
 constexpr int64_t kEmulatorGraphicsUnHangOther = 10035;
+constexpr int64_t kEmulatorGraphicsAsgWakeLatency = 10036;
+constexpr int64_t kEmulatorGraphicsAsgPollGap = 10037;
+constexpr int64_t kEmulatorGraphicsMediaDecoderPoolHitPercent = 10038;
+constexpr int64_t kEmulatorGraphicsMediaDecoderStartupLatency = 10039;
+constexpr int64_t kEmulatorMemoryTrimModerateBytes = 10076;
+constexpr int64_t kEmulatorMemoryTrimCriticalBytes = 10077;
+
+// Count, p50, p99 and max codes of each LatencyMetric.
+struct LatencyMetricCodes {
+    int64_t count;
+    int64_t p50;
+    int64_t p99;
+    int64_t max;
+};
+constexpr LatencyMetricCodes kLatencyMetricCodes[] = {
+    {10040, 10041, 10042, 10043},  // kAsgWake
+    {10044, 10045, 10046, 10047},  // kMediaPing
+    {10048, 10049, 10050, 10051},  // kMediaDecode
+    {10052, 10053, 10054, 10055},  // kDmaMap
+    {10072, 10073, 10074, 10075},  // kPipeOpen
+    {10078, 10079, 10080, 10081},  // kSleepLateness
+};
+static_assert(sizeof(kLatencyMetricCodes) / sizeof(kLatencyMetricCodes[0]) ==
+                  static_cast<size_t>(LatencyMetric::kCount),
+              "Every LatencyMetric needs event codes");
+
+// Threads, CPU, wakeup and preemption codes of each ThreadRole.
+struct ThreadRoleCodes {
+    int64_t threads;
+    int64_t cpuPermille;
+    int64_t wakeupsPerSec;
+    int64_t preemptionsPerSec;
+};
+constexpr ThreadRoleCodes kThreadRoleCodes[] = {
+    {10056, 10057, 10058, 10059},  // kAsgConsumer
+    {10060, 10061, 10062, 10063},  // kSyncThread
+    {10064, 10065, 10066, 10067},  // kMediaDecoder
+    {10068, 10069, 10070, 10071},  // kHealthMonitor
+};
+static_assert(sizeof(kThreadRoleCodes) / sizeof(kThreadRoleCodes[0]) ==
+                  static_cast<size_t>(ThreadRole::kCount),
+              "Every ThreadRole needs event codes");
 
 constexpr int64_t kHangDepthMetricLimit = 10;
 
@@ -52,6 +101,241 @@ void (*MetricsLogger::add_vulkan_out_of_memory_event)(int64_t result_code, uint3
                                                       bool is_host_side_result,
                                                       bool is_allocation) = nullptr;
 void (*MetricsLogger::set_crash_annotation_callback)(const char* key, const char* value) = nullptr;
+void (*MetricsLogger::add_aggregated_instant_event_callback)(int64_t event_code, int64_t value,
+                                                             int64_t count, int64_t first_us,
+                                                             int64_t last_us) = nullptr;
+
+namespace {
+
+// Which of the instant event callbacks an event goes out through.
+enum class InstantKind : uint8_t { kPlain, kDescriptor, kMetric };
+
+void deliverInstant(InstantKind kind, int64_t code, int64_t value) {
+    switch (kind) {
+        case InstantKind::kPlain:
+            if (MetricsLogger::add_instant_event_callback) {
+                MetricsLogger::add_instant_event_callback(code);
+            }
+            break;
+        case InstantKind::kDescriptor:
+            if (MetricsLogger::add_instant_event_with_descriptor_callback) {
+                MetricsLogger::add_instant_event_with_descriptor_callback(code, value);
+            }
+            break;
+        case InstantKind::kMetric:
+            if (MetricsLogger::add_instant_event_with_metric_callback) {
+                MetricsLogger::add_instant_event_with_metric_callback(code, value);
+            }
+            break;
+    }
+}
+
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Instant events waiting for the flush thread, with identical ones folded
+// together in the order they first came in.
+class MetricEventBuffer {
+   public:
+    static MetricEventBuffer& get() {
+        static MetricEventBuffer* sBuffer = new MetricEventBuffer;
+        return *sBuffer;
+    }
+
+    // False when not buffering, in which case the caller delivers the
+    // event itself.
+    bool add(InstantKind kind, int64_t code, int64_t value) {
+        if (!mActive.load(std::memory_order_acquire)) {
+            return false;
+        }
+        const int64_t now = nowUs();
+        std::lock_guard<std::mutex> lock(mLock);
+        if (!mActive.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        CodeState& state = mCodes[code];
+        if (state.oneIn > 1 && state.seen++ % state.oneIn != 0) {
+            ++mStats.sampledOut;
+            return true;
+        }
+        const Key key{kind, code, value};
+        auto it = mIndex.find(key);
+        if (it != mIndex.end()) {
+            Pending& pending = mPending[it->second];
+            ++pending.count;
+            pending.lastUs = now;
+            ++mStats.aggregated;
+            return true;
+        }
+        if (state.pending >= mOptions.maxPerCode) {
+            ++mStats.rateLimited;
+            return true;
+        }
+        if (mPending.size() >= mOptions.maxPending) {
+            ++mStats.overflowed;
+            return true;
+        }
+        mIndex.emplace(key, mPending.size());
+        mPending.push_back({key, 1, now, now});
+        ++state.pending;
+        return true;
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> flushLock(mFlushLock);
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mDelivering.swap(mPending);
+            mIndex.clear();
+            for (auto& [code, state] : mCodes) {
+                state.pending = 0;
+            }
+            mStats.delivered += mDelivering.size();
+        }
+        for (const Pending& event : mDelivering) {
+            if (MetricsLogger::add_aggregated_instant_event_callback) {
+                MetricsLogger::add_aggregated_instant_event_callback(
+                    event.key.code, event.key.value, event.count, event.firstUs, event.lastUs);
+            } else {
+                deliverInstant(event.key.kind, event.key.code, event.key.value);
+            }
+        }
+        mDelivering.clear();
+    }
+
+    void start(const MetricEventBufferOptions& options) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mOptions = options;
+        mActive.store(true, std::memory_order_release);
+        if (mThread.joinable()) {
+            return;
+        }
+        mStop = false;
+        mThread = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        std::thread thread;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mActive.store(false, std::memory_order_release);
+            mStop = true;
+            thread = std::move(mThread);
+        }
+        mCv.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+        flush();
+    }
+
+    void setSampling(int64_t code, uint32_t oneIn) {
+        std::lock_guard<std::mutex> lock(mLock);
+        CodeState& state = mCodes[code];
+        state.oneIn = oneIn;
+        state.seen = 0;
+    }
+
+    MetricEventBufferStats stats() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mStats;
+    }
+
+   private:
+    struct Key {
+        InstantKind kind;
+        int64_t code;
+        int64_t value;
+
+        bool operator==(const Key& other) const {
+            return kind == other.kind && code == other.code && value == other.value;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            uint64_t h = uint64_t(key.code) * 0x9e3779b97f4a7c15ULL;
+            h ^= uint64_t(key.value) + 0x7f4a7c159e3779b9ULL + (h << 6) + (h >> 2);
+            return size_t(h ^ uint64_t(key.kind));
+        }
+    };
+
+    struct Pending {
+        Key key;
+        int64_t count;
+        int64_t firstUs;
+        int64_t lastUs;
+    };
+
+    struct CodeState {
+        uint32_t oneIn = 1;
+        uint64_t seen = 0;
+        // Distinct events of this code pending in this window.
+        uint32_t pending = 0;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mLock);
+        while (!mStop) {
+            mCv.wait_for(lock, mOptions.window, [this] { return mStop; });
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    }
+
+    std::atomic<bool> mActive{false};
+    std::mutex mLock;
+    std::condition_variable mCv;
+    MetricEventBufferOptions mOptions;
+    std::vector<Pending> mPending;
+    std::unordered_map<Key, size_t, KeyHash> mIndex;
+    std::unordered_map<int64_t, CodeState> mCodes;
+    MetricEventBufferStats mStats;
+    std::thread mThread;
+    bool mStop = false;
+
+    // Serializes deliveries, so events go out in order.
+    std::mutex mFlushLock;
+    std::vector<Pending> mDelivering;
+};
+
+void emitEvent(int64_t code) {
+    if (!MetricEventBuffer::get().add(InstantKind::kPlain, code, 0)) {
+        deliverInstant(InstantKind::kPlain, code, 0);
+    }
+}
+
+void emitDescriptor(int64_t code, int64_t descriptor) {
+    if (!MetricEventBuffer::get().add(InstantKind::kDescriptor, code, descriptor)) {
+        deliverInstant(InstantKind::kDescriptor, code, descriptor);
+    }
+}
+
+void emitMetric(int64_t code, int64_t value) {
+    if (!MetricEventBuffer::get().add(InstantKind::kMetric, code, value)) {
+        deliverInstant(InstantKind::kMetric, code, value);
+    }
+}
+
+}  // namespace
+
+void startMetricEventBuffering(const MetricEventBufferOptions& options) {
+    MetricEventBuffer::get().start(options);
+}
+
+void stopMetricEventBuffering() { MetricEventBuffer::get().stop(); }
+
+void flushMetricEvents() { MetricEventBuffer::get().flush(); }
+
+void setMetricEventSampling(int64_t eventCode, uint32_t oneIn) {
+    MetricEventBuffer::get().setSampling(eventCode, oneIn);
+}
+
+MetricEventBufferStats metricEventBufferStats() { return MetricEventBuffer::get().stats(); }
 
 void logEventHangMetadata(const EventHangMetadata* metadata) {
     ERR("Metadata:");
@@ -73,14 +357,13 @@ struct MetricTypeVisitor {
 
     void operator()(const MetricEventFreeze freezeEvent) const {
         if (MetricsLogger::add_instant_event_callback) {
-            MetricsLogger::add_instant_event_callback(kEmulatorGraphicsFreeze);
+            emitEvent(kEmulatorGraphicsFreeze);
         }
     }
 
     void operator()(const MetricEventUnFreeze unfreezeEvent) const {
         if (MetricsLogger::add_instant_event_with_metric_callback) {
-            MetricsLogger::add_instant_event_with_metric_callback(kEmulatorGraphicsUnfreeze,
-                                                                  unfreezeEvent.frozen_ms);
+            emitMetric(kEmulatorGraphicsUnfreeze, unfreezeEvent.frozen_ms);
         }
     }
 
@@ -156,18 +439,15 @@ struct MetricTypeVisitor {
             unHangEvent.otherHungTasks <= kHangDepthMetricLimit) {
             switch (unHangEvent.metadata->hangType) {
                 case EventHangMetadata::HangType::kRenderThread: {
-                    MetricsLogger::add_instant_event_with_metric_callback(
-                        kEmulatorGraphicsUnHangRenderThread, unHangEvent.hung_ms);
+                    emitMetric(kEmulatorGraphicsUnHangRenderThread, unHangEvent.hung_ms);
                     break;
                 }
                 case EventHangMetadata::HangType::kSyncThread: {
-                    MetricsLogger::add_instant_event_with_metric_callback(
-                        kEmulatorGraphicsUnHangSyncThread, unHangEvent.hung_ms);
+                    emitMetric(kEmulatorGraphicsUnHangSyncThread, unHangEvent.hung_ms);
                     break;
                 }
                 case EventHangMetadata::HangType::kOther: {
-                    MetricsLogger::add_instant_event_with_metric_callback(
-                        kEmulatorGraphicsUnHangOther, unHangEvent.hung_ms);
+                    emitMetric(kEmulatorGraphicsUnHangOther, unHangEvent.hung_ms);
                     break;
                 }
             }
@@ -176,6 +456,7 @@ struct MetricTypeVisitor {
 
     void operator()(const GfxstreamVkAbort abort) const {
         // Ensure clearcut logs are uploaded before aborting.
+        flushMetricEvents();
         if (MetricsLogger::add_instant_event_with_descriptor_callback) {
             MetricsLogger::add_instant_event_with_descriptor_callback(
                 kEmulatorGfxstreamVkAbortReason, abort.abort_reason);
@@ -195,15 +476,14 @@ struct MetricTypeVisitor {
 
     void operator()(const MetricEventBadPacketLength BadPacketLengthEvent) const {
         if (MetricsLogger::add_instant_event_with_metric_callback) {
-            MetricsLogger::add_instant_event_with_metric_callback(kEmulatorGraphicsBadPacketLength,
-                                                                  BadPacketLengthEvent.len);
+            emitMetric(kEmulatorGraphicsBadPacketLength, BadPacketLengthEvent.len);
         }
     }
 
     void operator()(const MetricEventDuplicateSequenceNum DuplicateSequenceNumEvent) const {
         if (MetricsLogger::add_instant_event_with_descriptor_callback) {
-            MetricsLogger::add_instant_event_with_descriptor_callback(
-                kEmulatorGraphicsDuplicateSequenceNum, DuplicateSequenceNumEvent.opcode);
+            emitDescriptor(kEmulatorGraphicsDuplicateSequenceNum,
+                           DuplicateSequenceNumEvent.opcode);
         }
     }
 
@@ -219,11 +499,67 @@ struct MetricTypeVisitor {
                 vkOutOfMemoryEvent.allocationSize.has_value());  // is_allocation
         }
     }
+
+    void operator()(const MetricEventAsgRingStats asgRingStatsEvent) const {
+        if (MetricsLogger::add_instant_event_with_metric_callback) {
+            emitMetric(kEmulatorGraphicsAsgWakeLatency, asgRingStatsEvent.maxWakeLatencyUs);
+            emitMetric(kEmulatorGraphicsAsgPollGap, asgRingStatsEvent.maxPollGapUs);
+        }
+    }
+
+    void operator()(const MetricEventMediaDecoderPoolStats poolStatsEvent) const {
+        const int64_t total = poolStatsEvent.hits + poolStatsEvent.misses;
+        if (MetricsLogger::add_instant_event_with_metric_callback && total > 0) {
+            emitMetric(kEmulatorGraphicsMediaDecoderPoolHitPercent,
+                       poolStatsEvent.hits * 100 / total);
+            emitMetric(kEmulatorGraphicsMediaDecoderStartupLatency, poolStatsEvent.maxStartupUs);
+        }
+    }
+
+    void operator()(const MetricEventLatencySummary summaryEvent) const {
+        if (MetricsLogger::add_instant_event_with_metric_callback && summaryEvent.count > 0) {
+            const LatencyMetricCodes& codes =
+                kLatencyMetricCodes[static_cast<size_t>(summaryEvent.metric)];
+            emitMetric(codes.count, summaryEvent.count);
+            emitMetric(codes.p50, summaryEvent.p50Us);
+            emitMetric(codes.p99, summaryEvent.p99Us);
+            emitMetric(codes.max, summaryEvent.maxUs);
+        }
+    }
+
+    void operator()(const MetricEventThreadRoleUsage usageEvent) const {
+        if (MetricsLogger::add_instant_event_with_metric_callback) {
+            const ThreadRoleCodes& codes =
+                kThreadRoleCodes[static_cast<size_t>(usageEvent.role)];
+            emitMetric(codes.threads, usageEvent.threads);
+            emitMetric(codes.cpuPermille, usageEvent.cpuPermille);
+            emitMetric(codes.wakeupsPerSec, usageEvent.wakeupsPerSec);
+            emitMetric(codes.preemptionsPerSec, usageEvent.preemptionsPerSec);
+        }
+    }
+
+    void operator()(const MetricEventMemoryTrim trimEvent) const {
+        if (MetricsLogger::add_instant_event_with_metric_callback) {
+            emitMetric(trimEvent.level == MemoryPressureLevel::kCritical
+                           ? kEmulatorMemoryTrimCriticalBytes
+                           : kEmulatorMemoryTrimModerateBytes,
+                       trimEvent.reclaimedBytes);
+        }
+    }
 };
 
+static std::atomic<MetricEventObserver> sObserver{nullptr};
+
+void setMetricEventObserver(MetricEventObserver observer) {
+    sObserver.store(observer, std::memory_order_release);
+}
+
 // MetricsLoggerImpl
 class MetricsLoggerImpl : public MetricsLogger {
     void logMetricEvent(MetricEventType eventType) override {
+        if (const MetricEventObserver observer = sObserver.load(std::memory_order_acquire)) {
+            observer(eventType);
+        }
         std::visit(MetricTypeVisitor(), eventType);
     }
 
@@ -238,5 +574,132 @@ std::unique_ptr<MetricsLogger> CreateMetricsLogger() {
     return std::make_unique<MetricsLoggerImpl>();
 }
 
+uint64_t LatencyHistogram::bucketUpperBound(size_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    const int shift = bucket / kSubBuckets - 1;
+    const uint64_t sub = bucket % kSubBuckets;
+    // The last bucket ends at UINT64_MAX, which the shift can't reach.
+    if (shift + kSubBucketBits == 63 && sub == kSubBuckets - 1) {
+        return UINT64_MAX;
+    }
+    return ((kSubBuckets + sub + 1) << shift) - 1;
+}
+
+LatencyHistogram::Summary LatencyHistogram::takeSummary() {
+    uint64_t counts[kBuckets];
+    Summary summary;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        counts[i] = mCounts[i].exchange(0, std::memory_order_relaxed);
+        summary.count += counts[i];
+    }
+    summary.max = mMax.exchange(0, std::memory_order_relaxed);
+    if (summary.count == 0) {
+        return summary;
+    }
+
+    // The smallest values whose rank reaches each percentile.
+    const uint64_t ranks[] = {(summary.count * 50 + 99) / 100, (summary.count * 90 + 99) / 100,
+                              (summary.count * 99 + 99) / 100};
+    uint64_t* percentiles[] = {&summary.p50, &summary.p90, &summary.p99};
+    uint64_t seen = 0;
+    size_t next = 0;
+    for (size_t i = 0; i < kBuckets && next < 3; ++i) {
+        seen += counts[i];
+        while (next < 3 && seen >= ranks[next]) {
+            *percentiles[next++] = std::min(bucketUpperBound(i), summary.max);
+        }
+    }
+    return summary;
+}
+
+LatencyHistogram& latencyHistogram(LatencyMetric metric) {
+    static LatencyHistogram* sHistograms =
+        new LatencyHistogram[static_cast<size_t>(LatencyMetric::kCount)];
+    return sHistograms[static_cast<size_t>(metric)];
+}
+
+void reportLatencySummaries() {
+    auto logger = CreateMetricsLogger();
+    for (size_t i = 0; i < static_cast<size_t>(LatencyMetric::kCount); ++i) {
+        const LatencyMetric metric = static_cast<LatencyMetric>(i);
+        const LatencyHistogram::Summary summary = latencyHistogram(metric).takeSummary();
+        if (summary.count == 0) {
+            continue;
+        }
+        logger->logMetricEvent(MetricEventLatencySummary{
+            .metric = metric,
+            .count = static_cast<int64_t>(summary.count),
+            .p50Us = static_cast<int64_t>(summary.p50),
+            .p99Us = static_cast<int64_t>(summary.p99),
+            .maxUs = static_cast<int64_t>(summary.max),
+        });
+    }
+}
+
+namespace {
+
+class LatencyReporter {
+   public:
+    static LatencyReporter& get() {
+        static LatencyReporter* sReporter = new LatencyReporter;
+        return *sReporter;
+    }
+
+    void start(std::chrono::milliseconds period) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mPeriod = period;
+        if (mThread.joinable()) {
+            mCv.notify_all();
+            return;
+        }
+        mStop = false;
+        mThread = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        std::thread thread;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mStop = true;
+            thread = std::move(mThread);
+        }
+        mCv.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+   private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mLock);
+        auto next = std::chrono::steady_clock::now() + mPeriod;
+        while (!mStop) {
+            const std::chrono::milliseconds period = mPeriod;
+            if (mCv.wait_until(lock, next, [this, period] { return mStop || mPeriod != period; })) {
+                next = std::chrono::steady_clock::now() + mPeriod;
+                continue;
+            }
+            lock.unlock();
+            reportLatencySummaries();
+            lock.lock();
+            next += mPeriod;
+        }
+    }
+
+    std::mutex mLock;
+    std::condition_variable mCv;
+    std::thread mThread;
+    std::chrono::milliseconds mPeriod{0};
+    bool mStop = false;
+};
+
+}  // namespace
+
+void startLatencyReporting(std::chrono::milliseconds period) { LatencyReporter::get().start(period); }
+
+void stopLatencyReporting() { LatencyReporter::get().stop(); }
+
 }  // namespace base
 }  // namespace android
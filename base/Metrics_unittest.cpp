@@ -0,0 +1,170 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/Metrics.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+// Codes from Metrics.cpp.
+constexpr int64_t kBadPacketLength = 10031;
+constexpr int64_t kDuplicateSequenceNum = 10032;
+
+struct Delivered {
+    int64_t code;
+    int64_t value;
+    int64_t count;
+};
+
+std::mutex sLock;
+std::vector<Delivered> sDelivered;
+
+std::vector<Delivered> delivered() {
+    std::lock_guard<std::mutex> lock(sLock);
+    return sDelivered;
+}
+
+class MetricEventBufferTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mPrevious = {MetricsLogger::add_instant_event_with_metric_callback,
+                     MetricsLogger::add_instant_event_with_descriptor_callback};
+        MetricsLogger::add_instant_event_with_metric_callback = [](int64_t code, int64_t value) {
+            std::lock_guard<std::mutex> lock(sLock);
+            sDelivered.push_back({code, value, 1});
+        };
+        MetricsLogger::add_instant_event_with_descriptor_callback =
+            MetricsLogger::add_instant_event_with_metric_callback;
+        sDelivered.clear();
+        mStats = metricEventBufferStats();
+    }
+
+    void TearDown() override {
+        stopMetricEventBuffering();
+        MetricsLogger::add_instant_event_with_metric_callback = mPrevious.first;
+        MetricsLogger::add_instant_event_with_descriptor_callback = mPrevious.second;
+        MetricsLogger::add_aggregated_instant_event_callback = nullptr;
+        setMetricEventSampling(kDuplicateSequenceNum, 1);
+    }
+
+    // Buffers with a window long enough that only flushMetricEvents()
+    // delivers.
+    static void startManual(uint32_t maxPerCode = 16) {
+        MetricEventBufferOptions options;
+        options.window = std::chrono::hours(1);
+        options.maxPerCode = maxPerCode;
+        startMetricEventBuffering(options);
+    }
+
+    std::unique_ptr<MetricsLogger> mLogger = CreateMetricsLogger();
+    std::pair<void (*)(int64_t, int64_t), void (*)(int64_t, int64_t)> mPrevious;
+    MetricEventBufferStats mStats;
+};
+
+// Tests that identical events are held and delivered once per flush, and
+// with their count through the aggregated callback.
+TEST_F(MetricEventBufferTest, Aggregates) {
+    startManual();
+    for (int i = 0; i < 100; ++i) {
+        mLogger->logMetricEvent(MetricEventBadPacketLength{.len = 4});
+    }
+    mLogger->logMetricEvent(MetricEventBadPacketLength{.len = 8});
+    EXPECT_TRUE(delivered().empty());
+
+    flushMetricEvents();
+    auto events = delivered();
+    ASSERT_EQ(2u, events.size());
+    EXPECT_EQ(kBadPacketLength, events[0].code);
+    EXPECT_EQ(4, events[0].value);
+    EXPECT_EQ(8, events[1].value);
+    EXPECT_EQ(mStats.aggregated + 99, metricEventBufferStats().aggregated);
+
+    MetricsLogger::add_aggregated_instant_event_callback =
+        [](int64_t code, int64_t value, int64_t count, int64_t firstUs, int64_t lastUs) {
+            EXPECT_LE(firstUs, lastUs);
+            std::lock_guard<std::mutex> lock(sLock);
+            sDelivered.push_back({code, value, count});
+        };
+    sDelivered.clear();
+    for (int i = 0; i < 50; ++i) {
+        mLogger->logMetricEvent(MetricEventBadPacketLength{.len = 4});
+    }
+    flushMetricEvents();
+    events = delivered();
+    ASSERT_EQ(1u, events.size());
+    EXPECT_EQ(50, events[0].count);
+}
+
+// Tests that each code gets a limited number of distinct events per window,
+// and that sampling keeps one in N.
+TEST_F(MetricEventBufferTest, RateLimitsAndSamples) {
+    startManual(3);
+    for (int i = 0; i < 10; ++i) {
+        mLogger->logMetricEvent(MetricEventBadPacketLength{.len = i});
+    }
+    setMetricEventSampling(kDuplicateSequenceNum, 4);
+    for (int i = 0; i < 8; ++i) {
+        mLogger->logMetricEvent(MetricEventDuplicateSequenceNum{.opcode = i});
+    }
+    flushMetricEvents();
+
+    auto events = delivered();
+    ASSERT_EQ(5u, events.size());
+    EXPECT_EQ(2, events[2].value);
+    EXPECT_EQ(kDuplicateSequenceNum, events[3].code);
+    EXPECT_EQ(0, events[3].value);
+    EXPECT_EQ(4, events[4].value);
+    const MetricEventBufferStats stats = metricEventBufferStats();
+    EXPECT_EQ(mStats.rateLimited + 7, stats.rateLimited);
+    EXPECT_EQ(mStats.sampledOut + 6, stats.sampledOut);
+
+    // The limit is per window.
+    sDelivered.clear();
+    mLogger->logMetricEvent(MetricEventBadPacketLength{.len = 9});
+    flushMetricEvents();
+    EXPECT_EQ(1u, delivered().size());
+}
+
+// Tests that the flush thread delivers on its own, and that stopping
+// flushes and goes back to delivering right away.
+TEST_F(MetricEventBufferTest, FlushThread) {
+    MetricEventBufferOptions options;
+    options.window = std::chrono::milliseconds(10);
+    startMetricEventBuffering(options);
+    mLogger->logMetricEvent(MetricEventBadPacketLength{.len = 1});
+    for (int i = 0; i < 500 && delivered().empty(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(1u, delivered().size());
+
+    startManual();
+    mLogger->logMetricEvent(MetricEventBadPacketLength{.len = 2});
+    stopMetricEventBuffering();
+    EXPECT_EQ(2u, delivered().size());
+    mLogger->logMetricEvent(MetricEventBadPacketLength{.len = 3});
+    EXPECT_EQ(3u, delivered().size());
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
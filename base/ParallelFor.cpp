@@ -0,0 +1,274 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/threads/ParallelFor.h"
+
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/system/System.h"
+#include "aemu/base/threads/FunctorThread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace android {
+namespace base {
+
+namespace {
+
+thread_local bool tInParallel = false;
+
+uint64_t packRange(uint32_t next, uint32_t end) {
+    return uint64_t(next) << 32 | end;
+}
+
+// One thread's share of the chunks, [next, end) in a single word: the owner
+// takes chunks from the front and thieves split off the back, both with a
+// compare and swap. A share only grows again once it is empty, and the
+// chunks it held are gone for good by then, so a stale value never
+// compares equal.
+struct alignas(64) Share {
+    std::atomic<uint64_t> range{0};
+};
+
+class Job {
+public:
+    Job(size_t begin,
+        size_t end,
+        size_t grain,
+        uint32_t chunks,
+        size_t slots,
+        internal::ParallelBody body,
+        void* context)
+        : mBegin(begin),
+          mEnd(end),
+          mGrain(grain),
+          mSlots(slots),
+          mBody(body),
+          mContext(context),
+          mRemaining(chunks),
+          mShares(new Share[slots]) {
+        for (size_t i = 0; i < slots; ++i) {
+            mShares[i].range.store(packRange(uint32_t(chunks * uint64_t(i) / slots),
+                                             uint32_t(chunks * uint64_t(i + 1) / slots)),
+                                   std::memory_order_relaxed);
+        }
+    }
+
+    // Slot 0 is the caller's.
+    bool claimSlot(size_t* slot) {
+        *slot = mNextSlot.fetch_add(1, std::memory_order_relaxed);
+        return *slot < mSlots;
+    }
+
+    bool claimedAll() const { return mNextSlot.load(std::memory_order_relaxed) >= mSlots; }
+
+    // Runs chunks until there are none left to take or steal.
+    void run(size_t slot) {
+        tInParallel = true;
+        do {
+            uint32_t chunk;
+            while (take(slot, &chunk)) {
+                const size_t begin = mBegin + chunk * mGrain;
+                mBody(mContext, begin, begin + std::min(mGrain, mEnd - begin), slot);
+                if (mRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    AutoLock lock(mLock);
+                    mFinished = true;
+                    mDone.broadcastAndUnlock(&lock);
+                }
+            }
+        } while (steal(slot));
+        tInParallel = false;
+    }
+
+    // Waits for the chunks other threads are still running.
+    void wait() {
+        if (mRemaining.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+        AutoLock lock(mLock);
+        mDone.wait(&lock, [this] { return mFinished; });
+    }
+
+private:
+    bool take(size_t slot, uint32_t* chunk) {
+        std::atomic<uint64_t>& range = mShares[slot].range;
+        uint64_t value = range.load(std::memory_order_acquire);
+        for (;;) {
+            const uint32_t next = uint32_t(value >> 32);
+            const uint32_t end = uint32_t(value);
+            if (next >= end) {
+                return false;
+            }
+            if (range.compare_exchange_weak(value, packRange(next + 1, end),
+                                            std::memory_order_acq_rel)) {
+                *chunk = next;
+                return true;
+            }
+        }
+    }
+
+    // Moves the back half of another share into |slot|'s, which is empty.
+    bool steal(size_t slot) {
+        for (size_t i = 1; i < mSlots; ++i) {
+            std::atomic<uint64_t>& victim = mShares[(slot + i) % mSlots].range;
+            uint64_t value = victim.load(std::memory_order_acquire);
+            for (;;) {
+                const uint32_t next = uint32_t(value >> 32);
+                const uint32_t end = uint32_t(value);
+                if (next >= end) {
+                    break;
+                }
+                const uint32_t middle = next + (end - next) / 2;
+                if (victim.compare_exchange_weak(value, packRange(next, middle),
+                                                 std::memory_order_acq_rel)) {
+                    mShares[slot].range.store(packRange(middle, end), std::memory_order_release);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    const size_t mBegin;
+    const size_t mEnd;
+    const size_t mGrain;
+    const size_t mSlots;
+    const internal::ParallelBody mBody;
+    void* const mContext;
+    std::atomic<size_t> mNextSlot{1};
+    std::atomic<size_t> mRemaining;
+    std::unique_ptr<Share[]> mShares;
+    Lock mLock;
+    ConditionVariable mDone;
+    bool mFinished = false;
+};
+
+// The threads behind every parallel loop. Posted jobs stay up for grabs
+// until all their slots are taken or their caller is done with them.
+class ParallelExecutor {
+public:
+    static ParallelExecutor& get() {
+        static ParallelExecutor* const executor = new ParallelExecutor();
+        return *executor;
+    }
+
+    size_t concurrency() const { return mThreads.size() + 1; }
+
+    void post(const std::shared_ptr<Job>& job) {
+        AutoLock lock(mLock);
+        mJobs.push_back(job);
+        mWork.broadcastAndUnlock(&lock);
+    }
+
+    void retire(const Job* job) {
+        AutoLock lock(mLock);
+        mJobs.erase(std::remove_if(mJobs.begin(), mJobs.end(),
+                                   [job](const std::shared_ptr<Job>& posted) {
+                                       return posted.get() == job;
+                                   }),
+                    mJobs.end());
+    }
+
+private:
+    ParallelExecutor() {
+        const int threads = std::max(1, getCpuCoreCount()) - 1;
+        for (int i = 0; i < threads; ++i) {
+            mThreads.emplace_back(new FunctorThread([this] { work(); }));
+            mThreads.back()->start();
+        }
+    }
+
+    void work() {
+        for (;;) {
+            std::shared_ptr<Job> job;
+            size_t slot = 0;
+            {
+                AutoLock lock(mLock);
+                while (!job) {
+                    mWork.wait(&lock, [this] { return !mJobs.empty(); });
+                    // The newest job first: older ones have had their pick
+                    // of threads already.
+                    job = mJobs.back();
+                    if (!job->claimSlot(&slot)) {
+                        mJobs.pop_back();
+                        job.reset();
+                    } else if (job->claimedAll()) {
+                        mJobs.pop_back();
+                    }
+                }
+            }
+            job->run(slot);
+        }
+    }
+
+    Lock mLock;
+    ConditionVariable mWork;
+    std::vector<std::shared_ptr<Job>> mJobs;
+    std::vector<std::unique_ptr<FunctorThread>> mThreads;
+};
+
+}  // namespace
+
+size_t parallelConcurrency() {
+    return ParallelExecutor::get().concurrency();
+}
+
+bool inParallelRegion() {
+    return tInParallel;
+}
+
+namespace internal {
+
+void parallelRun(size_t begin, size_t end, size_t grain, ParallelBody body, void* context) {
+    if (begin >= end) {
+        return;
+    }
+    const size_t size = end - begin;
+    const size_t concurrency = tInParallel ? 1 : parallelConcurrency();
+    if (grain == 0) {
+        grain = std::max<size_t>(1, size / (concurrency * 4));
+    }
+    // Chunk numbers have to fit a share's half word.
+    grain = std::max<size_t>(grain, (size - 1) / UINT32_MAX + 1);
+    const size_t chunks = (size - 1) / grain + 1;
+
+    if (concurrency == 1 || chunks == 1) {
+        const bool nested = tInParallel;
+        tInParallel = true;
+        for (size_t chunk = begin; chunk < end;) {
+            const size_t chunkEnd = chunk + std::min(grain, end - chunk);
+            body(context, chunk, chunkEnd, 0);
+            chunk = chunkEnd;
+        }
+        tInParallel = nested;
+        return;
+    }
+
+    auto job = std::make_shared<Job>(begin, end, grain, uint32_t(chunks),
+                                     std::min(concurrency, chunks), body, context);
+    ParallelExecutor& executor = ParallelExecutor::get();
+    executor.post(job);
+    job->run(0);
+    executor.retire(job.get());
+    job->wait();
+}
+
+}  // namespace internal
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,76 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/threads/ParallelFor.h"
+#include "aemu/base/threads/ThreadPool.h"
+
+#include "benchmark/benchmark.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+constexpr size_t kGrain = 4096;
+
+uint64_t sumRange(const std::vector<uint32_t>& data, size_t begin, size_t end) {
+    uint64_t sum = 0;
+    for (size_t i = begin; i < end; ++i) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+// A sum over range(0) values on the shared executor.
+void BM_ParallelReduce(benchmark::State& state) {
+    const std::vector<uint32_t> data(state.range(0), 3);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parallelReduce(
+                0, data.size(), kGrain, uint64_t(0),
+                [&data](size_t begin, size_t end) { return sumRange(data, begin, end); },
+                [](uint64_t a, uint64_t b) { return a + b; }));
+    }
+    state.SetItemsProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ParallelReduce)->Arg(1 << 14)->Arg(1 << 18)->Arg(1 << 22);
+
+// The same sum on a pool started for each call, as code without a shared
+// executor has to.
+void BM_ThreadPoolPerCallReduce(benchmark::State& state) {
+    const std::vector<uint32_t> data(state.range(0), 3);
+    for (auto _ : state) {
+        std::atomic<uint64_t> total{0};
+        ThreadPool<std::function<void()>> pool(
+                parallelConcurrency(), [](std::function<void()>&& task) { task(); });
+        pool.start();
+        for (size_t begin = 0; begin < data.size(); begin += kGrain) {
+            pool.enqueue([&data, &total, begin] {
+                total += sumRange(data, begin, std::min(data.size(), begin + kGrain));
+            });
+        }
+        pool.done();
+        pool.join();
+        benchmark::DoNotOptimize(total.load());
+    }
+    state.SetItemsProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ThreadPoolPerCallReduce)->Arg(1 << 14)->Arg(1 << 18)->Arg(1 << 22);
+
+}  // namespace
+}  // namespace base
+}  // namespace android
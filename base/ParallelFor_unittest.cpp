@@ -0,0 +1,164 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/threads/ParallelFor.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "aemu/base/system/System.h"
+
+namespace android {
+namespace base {
+namespace {
+
+// Tests that every index is visited once, in chunks of the grain, for
+// ranges that don't start at 0 or split evenly.
+TEST(ParallelFor, VisitsEachIndexOnce) {
+    for (size_t grain : {0, 1, 7, 1000, 5000}) {
+        std::vector<std::atomic<int>> visits(3000);
+        parallelFor(100, 3100, grain, [&](size_t begin, size_t end) {
+            EXPECT_LT(begin, end);
+            if (grain) {
+                EXPECT_LE(end - begin, grain);
+                EXPECT_EQ(0u, (begin - 100) % grain);
+            }
+            for (size_t i = begin; i < end; ++i) {
+                visits[i - 100]++;
+            }
+        });
+        for (size_t i = 0; i < visits.size(); ++i) {
+            EXPECT_EQ(1, visits[i]) << "index " << i + 100 << " grain " << grain;
+        }
+    }
+
+    bool called = false;
+    parallelFor(5, 5, 1, [&](size_t, size_t) { called = true; });
+    EXPECT_FALSE(called);
+}
+
+// Tests that idle threads take chunks from a share whose owner is stuck,
+// so a slow chunk doesn't hold up the ones queued behind it.
+TEST(ParallelFor, StealsFromBusyThread) {
+    if (parallelConcurrency() < 2) {
+        GTEST_SKIP() << "needs more than one core";
+    }
+    constexpr size_t kChunks = 64;
+    std::atomic<size_t> done{0};
+    parallelFor(0, kChunks, 1, [&](size_t begin, size_t) {
+        if (begin == 0) {
+            // The caller starts on chunk 0, the first of its own share.
+            for (int i = 0; i < 5000 && done < kChunks - 1; ++i) {
+                sleepMs(1);
+            }
+            EXPECT_EQ(kChunks - 1, done);
+        }
+        ++done;
+    });
+    EXPECT_EQ(kChunks, done);
+}
+
+// Tests that loops started inside a chunk run serially on that thread.
+TEST(ParallelFor, NestedLoopsRunInline) {
+    EXPECT_FALSE(inParallelRegion());
+    std::atomic<int> inner{0};
+    parallelFor(0, 16, 1, [&](size_t, size_t) {
+        EXPECT_TRUE(inParallelRegion());
+        const std::thread::id outer = std::this_thread::get_id();
+        parallelFor(0, 100, 1, [&](size_t begin, size_t end) {
+            EXPECT_EQ(outer, std::this_thread::get_id());
+            inner += int(end - begin);
+        });
+    });
+    EXPECT_FALSE(inParallelRegion());
+    EXPECT_EQ(1600, inner);
+}
+
+// Tests that loops from several threads at once share the executor.
+TEST(ParallelFor, ConcurrentCallers) {
+    std::vector<std::thread> callers;
+    std::vector<uint64_t> sums(4);
+    for (size_t t = 0; t < sums.size(); ++t) {
+        callers.emplace_back([&sums, t] {
+            for (int round = 0; round < 50; ++round) {
+                std::atomic<uint64_t> sum{0};
+                parallelFor(0, 1000, 10, [&](size_t begin, size_t end) {
+                    uint64_t partial = 0;
+                    for (size_t i = begin; i < end; ++i) {
+                        partial += i;
+                    }
+                    sum += partial;
+                });
+                sums[t] += sum;
+            }
+        });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    for (uint64_t sum : sums) {
+        EXPECT_EQ(50u * 999 * 1000 / 2, sum);
+    }
+}
+
+// Tests that reductions fold every chunk, from the identity, exactly once.
+TEST(ParallelFor, ReduceSums) {
+    const uint64_t sum = parallelReduce(
+            1, 100001, 128, uint64_t(0),
+            [](size_t begin, size_t end) {
+                uint64_t partial = 0;
+                for (size_t i = begin; i < end; ++i) {
+                    partial += i;
+                }
+                return partial;
+            },
+            [](uint64_t a, uint64_t b) { return a + b; });
+    EXPECT_EQ(100000ull * 100001 / 2, sum);
+
+    EXPECT_EQ(1, parallelReduce(
+                         0, 0, 1, 1, [](size_t, size_t) { return 0; },
+                         [](int a, int b) { return a * b; }));
+}
+
+// Tests that each function given to parallelInvoke() runs once.
+TEST(ParallelFor, InvokeRunsEach) {
+    std::atomic<int> a{0}, b{0}, c{0};
+    parallelInvoke([&] { a++; }, [&] { b++; }, [&] { c++; });
+    EXPECT_EQ(1, a);
+    EXPECT_EQ(1, b);
+    EXPECT_EQ(1, c);
+}
+
+// Tests that each function in the list given to parallelInvokeAll() runs
+// once.
+TEST(ParallelFor, InvokeAllRunsEach) {
+    std::vector<std::atomic<int>> counts(17);
+    std::vector<std::function<void()>> fns;
+    for (auto& count : counts) {
+        fns.push_back([&count] { count++; });
+    }
+    parallelInvokeAll(fns);
+    for (const auto& count : counts) {
+        EXPECT_EQ(1, count);
+    }
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
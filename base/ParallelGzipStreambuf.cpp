@@ -0,0 +1,244 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/files/ParallelGzipStreambuf.h"
+
+#include "aemu/base/system/System.h"
+
+#include <algorithm>
+
+#include <string.h>
+
+namespace android {
+namespace base {
+
+struct ParallelGzipOutputStreambuf::Block {
+    std::vector<char> in;
+    std::vector<char> out;
+    bool ok = false;
+    bool done = false;
+};
+
+ParallelGzipOutputStreambuf::ParallelGzipOutputStreambuf(std::streambuf* dst,
+                                                         int level,
+                                                         int threads,
+                                                         size_t blockSize)
+    : mDst(dst), mLevel(level), mBlockSize(std::max<size_t>(blockSize, 4096)) {
+    if (threads <= 0) {
+        threads = std::max(1, getCpuCoreCount());
+    }
+    // Enough to keep every thread busy while the oldest block is written.
+    mMaxPending = threads * 2;
+    if (threads > 1) {
+        mPool.reset(new ThreadPool<std::function<void()>>(
+                threads, [](std::function<void()>&& task) { task(); }));
+        if (!mPool->start()) {
+            mPool.reset();
+        }
+    }
+    mIn.resize(mBlockSize);
+    setp(mIn.data(), mIn.data() + mIn.size());
+}
+
+ParallelGzipOutputStreambuf::~ParallelGzipOutputStreambuf() {
+    sync();
+    if (!mWroteMember && !mFailed) {
+        // A gzip file needs at least one member, even for no data.
+        Block empty;
+        compress(&empty, mLevel);
+        if (empty.ok) {
+            mDst->sputn(empty.out.data(), empty.out.size());
+        }
+    }
+    if (mPool) {
+        mPool->done();
+        mPool->join();
+    }
+}
+
+// static
+void ParallelGzipOutputStreambuf::compress(Block* block, int level) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    // windowBits + 16 writes a gzip header and trailer.
+    if (deflateInit2(&zs, level, Z_DEFLATED, MAX_WBITS + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return;
+    }
+    block->out.resize(deflateBound(&zs, block->in.size()) + 64);
+    zs.next_in = reinterpret_cast<Bytef*>(block->in.data());
+    zs.avail_in = block->in.size();
+    zs.next_out = reinterpret_cast<Bytef*>(block->out.data());
+    zs.avail_out = block->out.size();
+    const int res = deflate(&zs, Z_FINISH);
+    block->ok = res == Z_STREAM_END;
+    block->out.resize(zs.total_out);
+    deflateEnd(&zs);
+    // The input isn't needed any more; don't keep it while queued.
+    std::vector<char>().swap(block->in);
+}
+
+void ParallelGzipOutputStreambuf::submit() {
+    const size_t size = pptr() - pbase();
+    if (!size) {
+        return;
+    }
+    auto block = std::make_shared<Block>();
+    block->in.assign(pbase(), pptr());
+    // Keep the put area's allocation for the next block.
+    setp(mIn.data(), mIn.data() + mIn.size());
+
+    if (!mPool) {
+        compress(block.get(), mLevel);
+        block->done = true;
+        AutoLock lock(mLock);
+        mPending.push_back(std::move(block));
+        return;
+    }
+    {
+        AutoLock lock(mLock);
+        mPending.push_back(block);
+    }
+    mPool->enqueue([this, block, level = mLevel] {
+        compress(block.get(), level);
+        AutoLock lock(mLock);
+        block->done = true;
+        mBlockDone.broadcastAndUnlock(&lock);
+    });
+}
+
+bool ParallelGzipOutputStreambuf::drain(size_t maxPending) {
+    AutoLock lock(mLock);
+    while (!mPending.empty()) {
+        std::shared_ptr<Block> front = mPending.front();
+        if (!front->done) {
+            if (mPending.size() <= maxPending) {
+                break;
+            }
+            mBlockDone.wait(&lock);
+            continue;
+        }
+        mPending.pop_front();
+        lock.unlock();
+        if (!front->ok ||
+            mDst->sputn(front->out.data(), front->out.size()) !=
+                    (std::streamsize)front->out.size()) {
+            mFailed = true;
+        }
+        mWroteMember = true;
+        lock.lock();
+    }
+    return !mFailed;
+}
+
+ParallelGzipOutputStreambuf::int_type ParallelGzipOutputStreambuf::overflow(
+        int_type c) {
+    submit();
+    if (!drain(mMaxPending)) {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int ParallelGzipOutputStreambuf::sync() {
+    submit();
+    if (!drain(0)) {
+        return -1;
+    }
+    return mDst->pubsync();
+}
+
+#ifdef AEMU_BASE_USE_ZSTD
+
+ZstdOutputStreambuf::ZstdOutputStreambuf(std::streambuf* dst,
+                                         int level,
+                                         int threads)
+    : mDst(dst), mContext(ZSTD_createCCtx()) {
+    if (threads <= 0) {
+        threads = std::max(1, getCpuCoreCount());
+    }
+    ZSTD_CCtx_setParameter(mContext, ZSTD_c_compressionLevel, level);
+    ZSTD_CCtx_setParameter(mContext, ZSTD_c_checksumFlag, 1);
+    if (threads > 1) {
+        // Fails harmlessly on a libzstd built without threads.
+        ZSTD_CCtx_setParameter(mContext, ZSTD_c_nbWorkers, threads);
+    }
+    mIn.resize(ZSTD_CStreamInSize());
+    mOut.resize(ZSTD_CStreamOutSize());
+    setp(mIn.data(), mIn.data() + mIn.size());
+}
+
+ZstdOutputStreambuf::~ZstdOutputStreambuf() {
+    compress(ZSTD_e_end);
+    mDst->pubsync();
+    ZSTD_freeCCtx(mContext);
+}
+
+bool ZstdOutputStreambuf::compress(ZSTD_EndDirective mode) {
+    if (mFailed) {
+        return false;
+    }
+    ZSTD_inBuffer in = {pbase(), size_t(pptr() - pbase()), 0};
+    for (;;) {
+        ZSTD_outBuffer out = {mOut.data(), mOut.size(), 0};
+        const size_t remaining =
+                ZSTD_compressStream2(mContext, &out, &in, mode);
+        if (ZSTD_isError(remaining)) {
+            mFailed = true;
+            return false;
+        }
+        if (out.pos && mDst->sputn(mOut.data(), out.pos) !=
+                               (std::streamsize)out.pos) {
+            mFailed = true;
+            return false;
+        }
+        // With ZSTD_e_continue zstd may hold on to output until later;
+        // otherwise keep going until it has flushed everything.
+        const bool finished = mode == ZSTD_e_continue ? in.pos == in.size
+                                                      : remaining == 0;
+        if (finished) {
+            break;
+        }
+    }
+    setp(mIn.data(), mIn.data() + mIn.size());
+    return true;
+}
+
+ZstdOutputStreambuf::int_type ZstdOutputStreambuf::overflow(int_type c) {
+    if (!compress(ZSTD_e_continue)) {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int ZstdOutputStreambuf::sync() {
+    if (!compress(ZSTD_e_flush)) {
+        return -1;
+    }
+    return mDst->pubsync();
+}
+
+#endif  // AEMU_BASE_USE_ZSTD
+
+}  // namespace base
+}  // namespace android
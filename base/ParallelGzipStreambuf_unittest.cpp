@@ -0,0 +1,94 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/files/ParallelGzipStreambuf.h"
+
+#include <gtest/gtest.h>
+
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include <string.h>
+
+namespace android {
+namespace base {
+
+namespace {
+
+// Inflates every gzip member in |data|, one after another, as gunzip does.
+std::string gunzip(const std::string& data) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    EXPECT_EQ(Z_OK, inflateInit2(&zs, MAX_WBITS + 16));
+    zs.next_in = (Bytef*)data.data();
+    zs.avail_in = data.size();
+    std::string res;
+    char out[16384];
+    while (zs.avail_in) {
+        zs.next_out = (Bytef*)out;
+        zs.avail_out = sizeof(out);
+        const int err = inflate(&zs, Z_NO_FLUSH);
+        res.append(out, sizeof(out) - zs.avail_out);
+        if (err == Z_STREAM_END) {
+            inflateReset(&zs);
+        } else if (err != Z_OK) {
+            ADD_FAILURE() << "inflate() failed: " << err;
+            break;
+        }
+    }
+    inflateEnd(&zs);
+    return res;
+}
+
+std::string makeText(int lines) {
+    std::string res;
+    for (int i = 0; i < lines; ++i) {
+        res += "line " + std::to_string(i) + " value " +
+               std::to_string(i * 7919 % 1000) + "\n";
+    }
+    return res;
+}
+
+}  // namespace
+
+TEST(ParallelGzipOutputStreambuf, RoundTrip) {
+    const std::string text = makeText(100000);
+    for (int threads : {1, 4}) {
+        std::stringbuf compressed;
+        {
+            ParallelGzipOutputStreambuf gz(&compressed, Z_DEFAULT_COMPRESSION,
+                                           threads, 16 * 1024);
+            std::ostream os(&gz);
+            os.write(text.data(), text.size() / 2);
+            // Ends a member early; the rest still follows in order.
+            os.flush();
+            os.write(text.data() + text.size() / 2,
+                     text.size() - text.size() / 2);
+        }
+        EXPECT_LT(compressed.str().size(), text.size() / 2);
+        EXPECT_EQ(text, gunzip(compressed.str())) << threads << " threads";
+    }
+}
+
+TEST(ParallelGzipOutputStreambuf, EmptyIsValidGzip) {
+    std::stringbuf compressed;
+    { ParallelGzipOutputStreambuf gz(&compressed); }
+    EXPECT_FALSE(compressed.str().empty());
+    EXPECT_EQ("", gunzip(compressed.str()));
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,95 @@
+// Copyright (C) 2015 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/threads/internal/ParallelTaskBase.h"
+
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/threads/BackgroundExecutor.h"
+
+namespace android {
+namespace base {
+namespace internal {
+
+struct ParallelTaskBase::Completion {
+    Lock lock;
+    ConditionVariable cv;
+    bool finished = false;
+    // Only touched on the looper thread; cleared when the task object is
+    // destroyed before its completion ran.
+    ParallelTaskBase* owner = nullptr;
+};
+
+ParallelTaskBase::ParallelTaskBase(Looper* looper) : mLooper(looper) {}
+
+ParallelTaskBase::~ParallelTaskBase() {
+    detachAndWait();
+}
+
+void ParallelTaskBase::detachAndWait() {
+    if (!mCompletion) {
+        return;
+    }
+    mCompletion->owner = nullptr;
+    AutoLock lock(mCompletion->lock);
+    mCompletion->cv.wait(&lock, [this] { return mCompletion->finished; });
+}
+
+bool ParallelTaskBase::start() {
+    if (mStarted) {
+        return false;
+    }
+
+    auto completion = std::make_shared<Completion>();
+    completion->owner = this;
+    Looper* looper = mLooper;
+    const bool posted = BackgroundExecutor::get().post([this, looper,
+                                                        completion] {
+        taskImpl();
+        looper->scheduleCallback([completion] {
+            if (completion->owner) {
+                completion->owner->onTaskDone();
+            }
+        });
+        AutoLock lock(completion->lock);
+        completion->finished = true;
+        completion->cv.broadcastAndUnlock(&lock);
+    });
+    if (!posted) {
+        return false;
+    }
+
+    mStarted = true;
+    isRunning = true;
+    mCompletion = std::move(completion);
+    mKeepAliveTimer.reset(
+            mLooper->createTimer([](void*, Looper::Timer*) {}, nullptr));
+    mKeepAliveTimer->startAbsolute(Looper::kDurationInfinite);
+    return true;
+}
+
+bool ParallelTaskBase::inFlight() const {
+    return isRunning;
+}
+
+void ParallelTaskBase::onTaskDone() {
+    isRunning = false;
+    mKeepAliveTimer.reset();
+    // May delete this.
+    taskDoneImpl();
+}
+
+}  // namespace internal
+}  // namespace base
+}  // namespace android
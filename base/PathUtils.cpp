@@ -57,30 +57,33 @@ bool PathUtils::isPathSeparator(int ch, HostType hostType) {
 }
 
 // static
-size_t PathUtils::rootPrefixSize(const std::string& path, HostType hostType) {
+size_t PathUtils::rootPrefixSize(std::string_view path, HostType hostType) {
     if (path.empty()) return 0;
 
     if (hostType != HOST_WIN32)
         return (path[0] == '/') ? 1U : 0U;
 
+    // Reads past the end as a NUL, the way the C string version used to.
+    auto at = [path](size_t i) { return i < path.size() ? path[i] : '\0'; };
+
     size_t result = 0;
-    if (path[1] == ':') {
+    if (at(1) == ':') {
         int ch = path[0];
         if ((ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z'))
             result = 2U;
-    } else if (!strncmp(path.c_str(), "\\\\.\\", 4) ||
-               !strncmp(path.c_str(), "\\\\?\\", 4)) {
+    } else if (path.substr(0, 4) == "\\\\.\\" ||
+               path.substr(0, 4) == "\\\\?\\") {
         // UNC prefixes.
         return 4U;
     } else if (isDirSeparator(path[0], hostType)) {
         result = 1;
-        if (isDirSeparator(path[1], hostType)) {
+        if (isDirSeparator(at(1), hostType)) {
             result = 2;
-            while (path[result] && !isDirSeparator(path[result], HOST_WIN32))
+            while (at(result) && !isDirSeparator(at(result), HOST_WIN32))
                 result++;
         }
     }
-    if (result && path[result] && isDirSeparator(path[result], HOST_WIN32))
+    if (result && at(result) && isDirSeparator(at(result), HOST_WIN32))
         result++;
 
     return result;
@@ -88,6 +91,11 @@ size_t PathUtils::rootPrefixSize(const std::string& path, HostType hostType) {
 
 // static
 bool PathUtils::isAbsolute(const char* path, HostType hostType) {
+    return isAbsolute(std::string_view(path ? path : ""), hostType);
+}
+
+// static
+bool PathUtils::isAbsolute(std::string_view path, HostType hostType) {
     size_t prefixSize = rootPrefixSize(path, hostType);
     if (!prefixSize) {
         return false;
@@ -124,12 +132,19 @@ std::string_view PathUtils::extension(const std::string& path,
 // static
 std::string PathUtils::removeTrailingDirSeparator(const char* path,
                                                  HostType hostType) {
-    size_t pathLen = strlen(path);
+    return std::string(
+            removeTrailingDirSeparator(std::string_view(path), hostType));
+}
+
+// static
+std::string_view PathUtils::removeTrailingDirSeparator(std::string_view path,
+                                                       HostType hostType) {
+    size_t pathLen = path.size();
     // NOTE: Don't remove initial path separator for absolute paths.
     while (pathLen > 1U && isDirSeparator(path[pathLen - 1U], hostType)) {
         pathLen--;
     }
-    return std::string(path, pathLen);
+    return path.substr(0, pathLen);
 }
 
 // static
@@ -150,9 +165,31 @@ bool PathUtils::split(const char* path,
     if (sIsEmpty(path)) {
         return false;
     }
+    std::string_view dirView;
+    std::string_view baseView;
+    if (!split(std::string_view(path), hostType, &dirView, &baseView)) {
+        return false;
+    }
+    if (dirName) {
+        *dirName = dirView;
+    }
+    if (baseName) {
+        *baseName = baseView;
+    }
+    return true;
+}
+
+// static
+bool PathUtils::split(std::string_view path,
+                      HostType hostType,
+                      std::string_view* dirName,
+                      std::string_view* baseName) {
+    if (path.empty()) {
+        return false;
+    }
 
     // If there is a trailing directory separator, return an error.
-    size_t end = strlen(path);
+    size_t end = path.size();
     if (isDirSeparator(path[end - 1U], hostType)) {
         return false;
     }
@@ -167,10 +204,10 @@ bool PathUtils::split(const char* path,
     // Handle common case.
     if (pos > prefixLen) {
         if (dirName) {
-            *dirName = std::string(path, pos);
+            *dirName = path.substr(0, pos);
         }
         if (baseName) {
-            *baseName = path + pos;
+            *baseName = path.substr(pos);
         }
         return true;
     }
@@ -180,11 +217,11 @@ bool PathUtils::split(const char* path,
         if (!prefixLen) {
             *dirName = ".";
         } else {
-            *dirName = std::string(path, prefixLen);
+            *dirName = path.substr(0, prefixLen);
         }
     }
     if (baseName) {
-        *baseName = path + prefixLen;
+        *baseName = path.substr(prefixLen);
     }
     return true;
 }
@@ -212,41 +249,99 @@ std::string PathUtils::join(const std::string& path1,
     return result;
 }
 
-template <class String>
-static std::vector<String> decomposeImpl(const String& path, PathUtils::HostType hostType) {
-    std::vector<String> result;
-    if (path.empty())
-        return result;
-
-    size_t prefixLen = PathUtils::rootPrefixSize(path, hostType);
-    auto it = path.begin();
-    if (prefixLen) {
-        result.emplace_back(it, it + prefixLen);
-        it += prefixLen;
-    }
-    for (;;) {
-        auto p = it;
-        while (p != path.end() && !PathUtils::isDirSeparator(*p, hostType))
-            p++;
-        if (p > it) {
-            result.emplace_back(it, p);
+// Appends |path| to |out| the way join() combines its two halves.
+static void appendJoined(SmallVector<char>* out,
+                         std::string_view path,
+                         PathUtils::HostType hostType) {
+    if (path.empty()) {
+        return;
+    }
+    const size_t end = out->size();
+    if (end) {
+        std::string_view current(out->data(), end);
+        if (end > PathUtils::rootPrefixSize(current, hostType) &&
+            !PathUtils::isDirSeparator((*out)[end - 1U], hostType)) {
+            out->push_back(PathUtils::getDirSeparator(hostType));
         }
-        if (p == path.end()) {
-            break;
+    }
+    out->append(path.data(), path.size());
+}
+
+// static
+void PathUtils::join(SmallVector<char>* out,
+                     std::string_view path1,
+                     std::string_view path2,
+                     HostType hostType) {
+    joinMany(out, {path1, path2}, hostType);
+}
+
+// static
+void PathUtils::joinMany(SmallVector<char>* out,
+                         std::initializer_list<std::string_view> paths,
+                         HostType hostType) {
+    out->clear();
+
+    // Everything before the last absolute path is discarded by join(), so
+    // start from there. An empty prefix never turns a path absolute, so a
+    // path absolute on its own stays absolute once joined.
+    auto first = paths.begin();
+    for (auto it = paths.begin(); it != paths.end(); ++it) {
+        if (isAbsolute(*it, hostType)) {
+            first = it;
         }
-        it = p + 1;
     }
-    return result;
+
+    size_t capacity = 0;
+    for (auto it = first; it != paths.end(); ++it) {
+        capacity += it->size() + 1;
+    }
+    out->reserve(capacity);
+
+    for (auto it = first; it != paths.end(); ++it) {
+        appendJoined(out, *it, hostType);
+    }
+}
+
+// static
+PathUtils::Components::iterator PathUtils::Components::begin() const {
+    const size_t prefixLen = rootPrefixSize(mPath, mHostType);
+    iterator it(mPath, mHostType, 0, prefixLen);
+    if (!prefixLen) {
+        it.seek(0);
+    }
+    return it;
+}
+
+void PathUtils::Components::iterator::seek(size_t from) {
+    const size_t size = mPath.size();
+    while (from < size && isDirSeparator(mPath[from], mHostType)) {
+        ++from;
+    }
+    size_t to = from;
+    while (to < size && !isDirSeparator(mPath[to], mHostType)) {
+        ++to;
+    }
+    mPos = from;
+    mLen = to - from;
+}
+
+PathUtils::Components::iterator& PathUtils::Components::iterator::operator++() {
+    seek(mPos + mLen);
+    return *this;
 }
 
 std::vector<std::string> PathUtils::decompose(std::string&& path,
                                               HostType hostType) {
-    return decomposeImpl<std::string>(path, hostType);
+    return decompose(static_cast<const std::string&>(path), hostType);
 }
 
 std::vector<std::string> PathUtils::decompose(const std::string& path,
                                               HostType hostType) {
-    return decomposeImpl<std::string>(path, hostType);
+    std::vector<std::string> result;
+    for (std::string_view component : components(path, hostType)) {
+        result.emplace_back(component);
+    }
+    return result;
 }
 
 template <class String>
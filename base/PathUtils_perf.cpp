@@ -0,0 +1,98 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/files/PathUtils.h"
+
+#include "benchmark/benchmark.h"
+
+#include <string>
+#include <string_view>
+
+namespace android {
+namespace base {
+namespace {
+
+// A typical SDK path built from a few pieces.
+constexpr char kRoot[] = "/home/user/Android/Sdk";
+constexpr char kDir[] = "system-images/android-34/google_apis";
+constexpr char kArch[] = "x86_64";
+constexpr char kFile[] = "system.img";
+
+void BM_PathJoin(benchmark::State& state) {
+    for (auto _ : state) {
+        std::string path = PathUtils::join(kRoot, kDir, kArch, kFile);
+        benchmark::DoNotOptimize(path.data());
+    }
+}
+BENCHMARK(BM_PathJoin);
+
+void BM_PathJoinMany(benchmark::State& state) {
+    SmallFixedVector<char, 128> path;
+    for (auto _ : state) {
+        PathUtils::joinMany(&path, {kRoot, kDir, kArch, kFile});
+        benchmark::DoNotOptimize(path.data());
+    }
+}
+BENCHMARK(BM_PathJoinMany);
+
+void BM_PathSplit(benchmark::State& state) {
+    const std::string path = PathUtils::join(kRoot, kDir, kArch, kFile);
+    std::string dir;
+    std::string base;
+    for (auto _ : state) {
+        PathUtils::split(path.c_str(), &dir, &base);
+        benchmark::DoNotOptimize(dir.data());
+        benchmark::DoNotOptimize(base.data());
+    }
+}
+BENCHMARK(BM_PathSplit);
+
+void BM_PathSplitView(benchmark::State& state) {
+    const std::string path = PathUtils::join(kRoot, kDir, kArch, kFile);
+    std::string_view dir;
+    std::string_view base;
+    for (auto _ : state) {
+        PathUtils::split(std::string_view(path), PathUtils::HOST_TYPE, &dir,
+                         &base);
+        benchmark::DoNotOptimize(dir.data());
+        benchmark::DoNotOptimize(base.data());
+    }
+}
+BENCHMARK(BM_PathSplitView);
+
+void BM_PathDecompose(benchmark::State& state) {
+    const std::string path = PathUtils::join(kRoot, kDir, kArch, kFile);
+    for (auto _ : state) {
+        auto parts = PathUtils::decompose(path);
+        benchmark::DoNotOptimize(parts.data());
+    }
+}
+BENCHMARK(BM_PathDecompose);
+
+void BM_PathComponents(benchmark::State& state) {
+    const std::string path = PathUtils::join(kRoot, kDir, kArch, kFile);
+    for (auto _ : state) {
+        size_t total = 0;
+        for (std::string_view part : PathUtils::components(path)) {
+            total += part.size();
+        }
+        benchmark::DoNotOptimize(total);
+    }
+}
+BENCHMARK(BM_PathComponents);
+
+}  // namespace
+}  // namespace base
+}  // namespace android
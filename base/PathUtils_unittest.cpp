@@ -0,0 +1,109 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/files/PathUtils.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+std::string str(const SmallVector<char>& buf) {
+    return std::string(buf.data(), buf.size());
+}
+
+std::vector<std::string> collect(std::string_view path,
+                                 PathUtils::HostType hostType) {
+    std::vector<std::string> result;
+    for (std::string_view part : PathUtils::components(path, hostType)) {
+        result.emplace_back(part);
+    }
+    return result;
+}
+
+// Tests that the buffer variants of join() agree with the std::string ones.
+TEST(PathUtils, JoinIntoBuffer) {
+    const char* const kCases[][2] = {
+            {"", "foo"},      {"foo", ""},        {"foo", "bar"},
+            {"foo/", "bar"},  {"/", "bar"},       {"foo", "/bar"},
+            {"C:", "foo"},    {"C:\\", "foo"},    {"a\\b", "C:\\c"},
+    };
+    SmallFixedVector<char, 32> out;
+    for (auto hostType : {kHostPosix, kHostWin32}) {
+        for (const auto& c : kCases) {
+            PathUtils::join(&out, c[0], c[1], hostType);
+            EXPECT_EQ(PathUtils::join(c[0], c[1], hostType), str(out))
+                    << c[0] << " + " << c[1];
+        }
+    }
+
+    PathUtils::joinMany(&out, {"a", "", "b/", "c"}, kHostPosix);
+    EXPECT_EQ("a/b/c", str(out));
+    PathUtils::joinMany(&out, {"a", "/b", "c", "/d", "e"}, kHostPosix);
+    EXPECT_EQ("/d/e", str(out));
+    PathUtils::joinMany(&out, {}, kHostPosix);
+    EXPECT_EQ("", str(out));
+}
+
+// Tests that the view variant of split() matches the std::string one.
+TEST(PathUtils, SplitView) {
+    std::string_view dir;
+    std::string_view base;
+    EXPECT_TRUE(PathUtils::split(std::string_view("/foo/bar"), kHostPosix,
+                                 &dir, &base));
+    EXPECT_EQ("/foo/", dir);
+    EXPECT_EQ("bar", base);
+    EXPECT_TRUE(PathUtils::split(std::string_view("bar"), kHostPosix, &dir,
+                                 &base));
+    EXPECT_EQ(".", dir);
+    EXPECT_EQ("bar", base);
+    EXPECT_TRUE(PathUtils::split(std::string_view("C:foo"), kHostWin32, &dir,
+                                 &base));
+    EXPECT_EQ("C:", dir);
+    EXPECT_EQ("foo", base);
+    EXPECT_FALSE(PathUtils::split(std::string_view("/foo/"), kHostPosix,
+                                  &dir, &base));
+    EXPECT_FALSE(PathUtils::split(std::string_view(), kHostPosix, &dir,
+                                  &base));
+
+    EXPECT_EQ("/foo", PathUtils::removeTrailingDirSeparator(
+                              std::string_view("/foo//"), kHostPosix));
+    EXPECT_EQ("/", PathUtils::removeTrailingDirSeparator(
+                           std::string_view("//"), kHostPosix));
+}
+
+// Tests that components() yields the same parts as decompose().
+TEST(PathUtils, Components) {
+    const char* const kPaths[] = {
+            "", "/", "foo", "/foo//bar/", "C:", "C:\\foo\\bar",
+            "\\\\server\\share\\dir", "a\\b/c",
+    };
+    for (auto hostType : {kHostPosix, kHostWin32}) {
+        for (const char* path : kPaths) {
+            EXPECT_EQ(PathUtils::decompose(std::string(path), hostType),
+                      collect(path, hostType))
+                    << path;
+        }
+    }
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,558 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/PersistentMruCache.h"
+
+#include "aemu/base/EintrWrapper.h"
+#include "aemu/base/Hash.h"
+#include "aemu/base/files/preadwrite.h"
+#include "aemu/base/threads/BackgroundExecutor.h"
+
+#include <string.h>
+
+#include <unordered_set>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+
+#include "aemu/base/system/Win32UnicodeString.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace android {
+namespace base {
+namespace {
+
+constexpr uint32_t kFileMagic = 0x43524d50;  // "PMRC"
+constexpr uint32_t kFileVersion = 1;
+constexpr uint32_t kRecordTag = 0x31434552;  // "REC1"
+
+// put() queues a compaction once dead records take at least this much and
+// half of the file.
+constexpr uint64_t kMinDeadBytesToCompact = 1 << 20;
+
+// Compaction writes the new file in chunks of about this size.
+constexpr size_t kCompactionChunkSize = 1 << 20;
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t reserved;
+};
+
+struct RecordHeader {
+    uint32_t tag;
+    uint32_t keySize;
+    uint32_t valueSize;
+    uint32_t checksum;  // crc32c of the key and value bytes
+};
+
+uint64_t recordSize(uint64_t keySize, uint64_t valueSize) {
+    return (sizeof(RecordHeader) + keySize + valueSize + 7) & ~uint64_t(7);
+}
+
+int openFile(const std::string& path, bool truncate) {
+#ifdef _WIN32
+    const int flags = _O_RDWR | _O_CREAT | _O_BINARY | (truncate ? _O_TRUNC : 0);
+    return ::_wopen(Win32UnicodeString(path).c_str(), flags, _S_IREAD | _S_IWRITE);
+#else
+    const int flags = O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+    return HANDLE_EINTR(::open(path.c_str(), flags, 0644));
+#endif
+}
+
+void closeFile(int fd) {
+#ifdef _WIN32
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+void removeFile(const std::string& path) {
+#ifdef _WIN32
+    ::_wunlink(Win32UnicodeString(path).c_str());
+#else
+    ::unlink(path.c_str());
+#endif
+}
+
+uint64_t fileSizeOf(int fd) {
+#ifdef _WIN32
+    const int64_t size = ::_filelengthi64(fd);
+    return size < 0 ? 0 : static_cast<uint64_t>(size);
+#else
+    struct stat st;
+    return ::fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+#endif
+}
+
+bool truncateFile(int fd, uint64_t size) {
+#ifdef _WIN32
+    return ::_chsize_s(fd, static_cast<int64_t>(size)) == 0;
+#else
+    return HANDLE_EINTR(::ftruncate(fd, static_cast<off_t>(size))) == 0;
+#endif
+}
+
+bool syncFile(int fd) {
+#ifdef _WIN32
+    return ::_commit(fd) == 0;
+#else
+    return HANDLE_EINTR(::fsync(fd)) == 0;
+#endif
+}
+
+bool writeAll(int fd, const void* data, size_t size, uint64_t offset) {
+    const char* p = static_cast<const char*>(data);
+    while (size) {
+        const int64_t n = HANDLE_EINTR(base::pwrite(fd, p, size, offset));
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// Moves the file open as |tmpFd| over |path|. On success |*fd| becomes the
+// descriptor of the new file; otherwise it still refers to the old one.
+bool replaceFile(int* fd, int tmpFd, const std::string& tmpPath,
+                 const std::string& path) {
+#ifdef _WIN32
+    // Files that are open can't be renamed, or renamed over, on Windows.
+    closeFile(*fd);
+    closeFile(tmpFd);
+    const bool moved = ::MoveFileExW(Win32UnicodeString(tmpPath).c_str(),
+                                     Win32UnicodeString(path).c_str(),
+                                     MOVEFILE_REPLACE_EXISTING) != 0;
+    *fd = openFile(path, false);
+    return moved && *fd >= 0;
+#else
+    if (::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        return false;
+    }
+    closeFile(*fd);
+    *fd = tmpFd;
+    return true;
+#endif
+}
+
+}  // namespace
+
+// The first |size| bytes of the cache file: mapped read-only, or read into
+// memory on Windows.
+struct PersistentMruCache::Mapping {
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    std::unique_ptr<char[]> buffer;
+#else
+    ~Mapping() {
+        if (data) {
+            ::munmap(const_cast<char*>(data), size);
+        }
+    }
+#endif
+
+    static std::shared_ptr<const Mapping> create(int fd, uint64_t size) {
+        auto mapping = std::make_shared<Mapping>();
+        if (!size) {
+            return mapping;
+        }
+#ifdef _WIN32
+        mapping->buffer.reset(new char[size]);
+        uint64_t done = 0;
+        while (done < size) {
+            const int64_t n = base::pread(fd, mapping->buffer.get() + done,
+                                          size - done, done);
+            if (n <= 0) {
+                return nullptr;
+            }
+            done += static_cast<uint64_t>(n);
+        }
+        mapping->data = mapping->buffer.get();
+#else
+        void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            return nullptr;
+        }
+        mapping->data = static_cast<const char*>(addr);
+#endif
+        mapping->size = size;
+        return mapping;
+    }
+};
+
+// static
+std::unique_ptr<PersistentMruCache> PersistentMruCache::open(
+        const std::string& path,
+        size_t maxEntries) {
+    const int fd = openFile(path, false);
+    if (fd < 0) {
+        return nullptr;
+    }
+    std::unique_ptr<PersistentMruCache> cache(
+            new PersistentMruCache(path, maxEntries, fd));
+    if (!cache->load()) {
+        return nullptr;
+    }
+    return cache;
+}
+
+PersistentMruCache::PersistentMruCache(const std::string& path,
+                                       size_t maxEntries,
+                                       int fd)
+    : mPath(path), mMaxEntries(maxEntries), mFd(fd) {}
+
+PersistentMruCache::~PersistentMruCache() {
+    AutoLock lock(mLock);
+    mCompactionDone.wait(&lock, [this] {
+        return !mCompacting && !mCompactionQueued;
+    });
+    closeFile(mFd);
+}
+
+bool PersistentMruCache::load() {
+    AutoLock lock(mLock);
+    const uint64_t size = fileSizeOf(mFd);
+    FileHeader header;
+    const bool valid =
+            size >= sizeof(header) &&
+            base::pread(mFd, &header, sizeof(header), 0) == sizeof(header) &&
+            header.magic == kFileMagic && header.version == kFileVersion;
+    if (!valid) {
+        const FileHeader fresh = {kFileMagic, kFileVersion, 0};
+        if (!truncateFile(mFd, 0) ||
+            !writeAll(mFd, &fresh, sizeof(fresh), 0)) {
+            return false;
+        }
+        mFileSize = sizeof(fresh);
+        return true;
+    }
+
+    auto mapping = Mapping::create(mFd, size);
+    if (!mapping) {
+        return false;
+    }
+    // Only headers are read here; values stay untouched until get().
+    uint64_t offset = sizeof(FileHeader);
+    while (offset + sizeof(RecordHeader) <= size) {
+        RecordHeader record;
+        memcpy(&record, mapping->data + offset, sizeof(record));
+        const uint64_t total = recordSize(record.keySize, record.valueSize);
+        if (record.tag != kRecordTag || total > size - offset) {
+            break;
+        }
+        const char* key = mapping->data + offset + sizeof(RecordHeader);
+        insertLocked(std::string_view(key, record.keySize),
+                     std::string_view(key + record.keySize, record.valueSize),
+                     mapping, record.checksum, static_cast<uint32_t>(total),
+                     false);
+        offset += total;
+    }
+    if (offset < size) {
+        // Cut off a record torn by a crash, so that appends follow the
+        // last good one.
+        truncateFile(mFd, offset);
+    }
+    mFileSize = offset;
+    mMapping = std::move(mapping);
+    return true;
+}
+
+void PersistentMruCache::insertLocked(std::string_view key,
+                                      std::string_view value,
+                                      std::shared_ptr<const void> owner,
+                                      uint32_t checksum,
+                                      uint32_t recordSize,
+                                      bool verified) {
+    auto it = mIndex.find(key);
+    if (it != mIndex.end()) {
+        mDeadBytes += it->second.recordSize;
+        mRecency.erase(it->second.recency);
+        mIndex.erase(it);
+    }
+    mRecency.push_front(key);
+    mIndex.emplace(key, Entry{std::move(owner), value, checksum, recordSize,
+                              verified, mRecency.begin()});
+}
+
+bool PersistentMruCache::get(std::string_view key, Value* value) {
+    AutoLock lock(mLock);
+    auto it = mIndex.find(key);
+    if (it == mIndex.end()) {
+        return false;
+    }
+    Entry& entry = it->second;
+    if (!entry.verified) {
+        // The key and value are contiguous in the record.
+        const std::string_view stored = it->first;
+        if (crc32c(stored.data(), stored.size() + entry.value.size()) !=
+            entry.checksum) {
+            mDeadBytes += entry.recordSize;
+            mRecency.erase(entry.recency);
+            mIndex.erase(it);
+            return false;
+        }
+        entry.verified = true;
+    }
+    mRecency.splice(mRecency.begin(), mRecency, entry.recency);
+    value->mOwner = entry.owner;
+    value->mData = entry.value;
+    return true;
+}
+
+bool PersistentMruCache::put(std::string_view key, std::string_view value) {
+    if (key.size() > UINT32_MAX || value.size() > UINT32_MAX) {
+        return false;
+    }
+    // The record is built once and serves both as what gets written and as
+    // the entry's storage until the next compaction maps it.
+    const uint64_t total = recordSize(key.size(), value.size());
+    auto record = std::make_shared<std::string>(total, '\0');
+    char* const data = &(*record)[0];
+    char* const keyData = data + sizeof(RecordHeader);
+    memcpy(keyData, key.data(), key.size());
+    memcpy(keyData + key.size(), value.data(), value.size());
+    const RecordHeader header = {
+            kRecordTag, static_cast<uint32_t>(key.size()),
+            static_cast<uint32_t>(value.size()),
+            crc32c(keyData, key.size() + value.size())};
+    memcpy(data, &header, sizeof(header));
+
+    AutoLock lock(mLock);
+    const bool written = writeAll(mFd, data, total, mFileSize);
+    if (written) {
+        mFileSize += total;
+    }
+    insertLocked(std::string_view(keyData, key.size()),
+                 std::string_view(keyData + key.size(), value.size()),
+                 std::move(record), header.checksum,
+                 written ? static_cast<uint32_t>(total) : 0, true);
+    maybeCompactLocked();
+    return written;
+}
+
+void PersistentMruCache::evictLocked() {
+    // MruCache::evictIfNecessary()'s policy: at |mMaxEntries| entries, drop
+    // from the front of the recency list down to 90% of that. MruCache
+    // applies it on every put, so the limit is never overshot by more than
+    // one; entries put here since the last compaction may have, hence the
+    // threshold is taken from the limit rather than the current count.
+    if (mRecency.size() < mMaxEntries) {
+        return;
+    }
+    const double threshold = mMaxEntries * 0.9;
+    while (mRecency.size() > threshold) {
+        auto it = mIndex.find(mRecency.front());
+        mRecency.pop_front();
+        mDeadBytes += it->second.recordSize;
+        mIndex.erase(it);
+    }
+}
+
+void PersistentMruCache::maybeCompactLocked() {
+    if (mCompacting || mCompactionQueued) {
+        return;
+    }
+    if (mIndex.size() < mMaxEntries &&
+        (mDeadBytes < kMinDeadBytesToCompact || mDeadBytes * 2 < mFileSize)) {
+        return;
+    }
+    mCompactionQueued = true;
+    if (!BackgroundExecutor::get().post([this] { runQueuedCompaction(); })) {
+        mCompactionQueued = false;
+    }
+}
+
+void PersistentMruCache::compactAsync() {
+    AutoLock lock(mLock);
+    if (mCompacting || mCompactionQueued) {
+        return;
+    }
+    mCompactionQueued = true;
+    if (!BackgroundExecutor::get().post([this] { runQueuedCompaction(); })) {
+        mCompactionQueued = false;
+    }
+}
+
+void PersistentMruCache::runQueuedCompaction() {
+    compact();
+    // Only now, as the destructor waits for this flag and the job still
+    // refers to the cache until it returns.
+    AutoLock lock(mLock);
+    mCompactionQueued = false;
+    mCompactionDone.broadcast();
+}
+
+bool PersistentMruCache::compact() {
+    struct Item {
+        std::string_view key;
+        std::string_view value;
+        std::shared_ptr<const void> owner;  // keeps the views valid
+        uint32_t checksum;
+        bool verified;
+        uint64_t offset;
+    };
+
+    AutoLock lock(mLock);
+    mCompactionDone.wait(&lock, [this] { return !mCompacting; });
+    mCompacting = true;
+
+    evictLocked();
+    std::vector<Item> items;
+    items.reserve(mIndex.size());
+    for (auto it = mRecency.rbegin(); it != mRecency.rend(); ++it) {
+        const Entry& entry = mIndex.find(*it)->second;
+        items.push_back({*it, entry.value, entry.owner, entry.checksum,
+                         entry.verified, 0});
+    }
+    lock.unlock();
+
+    // Write the snapshot, least recently used first, without holding the
+    // lock; gets and puts go on meanwhile.
+    const std::string tmpPath = mPath + ".tmp";
+    const int tmpFd = openFile(tmpPath, true);
+    bool ok = tmpFd >= 0;
+    uint64_t offset = 0;
+    if (ok) {
+        std::string chunk;
+        chunk.reserve(kCompactionChunkSize);
+        const FileHeader fileHeader = {kFileMagic, kFileVersion, 0};
+        chunk.append(reinterpret_cast<const char*>(&fileHeader),
+                     sizeof(fileHeader));
+        for (Item& item : items) {
+            const RecordHeader header = {
+                    kRecordTag, static_cast<uint32_t>(item.key.size()),
+                    static_cast<uint32_t>(item.value.size()), item.checksum};
+            item.offset = offset + chunk.size();
+            const size_t total = recordSize(item.key.size(), item.value.size());
+            chunk.append(reinterpret_cast<const char*>(&header), sizeof(header));
+            chunk.append(item.key.data(), item.key.size());
+            chunk.append(item.value.data(), item.value.size());
+            chunk.append(total - sizeof(header) - item.key.size() -
+                                 item.value.size(),
+                         '\0');
+            if (chunk.size() >= kCompactionChunkSize) {
+                ok = ok && writeAll(tmpFd, chunk.data(), chunk.size(), offset);
+                offset += chunk.size();
+                chunk.clear();
+            }
+        }
+        ok = ok && writeAll(tmpFd, chunk.data(), chunk.size(), offset);
+        offset += chunk.size();
+    }
+    const uint64_t snapshotSize = offset;
+
+    lock.lock();
+    // Snapshot entries that weren't replaced or dropped meanwhile move to
+    // the new file; anything else only lives in memory or the old file, and
+    // is appended now.
+    std::unordered_set<const char*> moved;
+    for (const Item& item : items) {
+        auto it = mIndex.find(item.key);
+        if (it != mIndex.end() && it->second.value.data() == item.value.data()) {
+            moved.insert(item.value.data());
+        }
+    }
+    std::vector<std::pair<Entry*, uint32_t>> appended;
+    for (auto it = mRecency.rbegin(); ok && it != mRecency.rend(); ++it) {
+        Entry& entry = mIndex.find(*it)->second;
+        if (moved.count(entry.value.data())) {
+            continue;
+        }
+        const char* keyData = it->data();
+        const uint64_t total = recordSize(it->size(), entry.value.size());
+        std::string record(total, '\0');
+        const RecordHeader header = {
+                kRecordTag, static_cast<uint32_t>(it->size()),
+                static_cast<uint32_t>(entry.value.size()), entry.checksum};
+        memcpy(&record[0], &header, sizeof(header));
+        memcpy(&record[sizeof(header)], keyData,
+               it->size() + entry.value.size());
+        ok = writeAll(tmpFd, record.data(), record.size(), offset);
+        appended.emplace_back(&entry, static_cast<uint32_t>(total));
+        offset += total;
+    }
+    ok = ok && syncFile(tmpFd) && replaceFile(&mFd, tmpFd, tmpPath, mPath);
+    if (!ok) {
+        if (tmpFd >= 0) {
+            closeFile(tmpFd);
+        }
+        removeFile(tmpPath);
+    } else {
+        mFileSize = offset;
+        mDeadBytes = 0;
+        for (const auto& [entry, total] : appended) {
+            entry->recordSize = total;
+        }
+        // If the new file can't be mapped, entries keep their old storage,
+        // which holds the same bytes.
+        auto mapping = Mapping::create(mFd, snapshotSize);
+        for (const Item& item : items) {
+            if (!mapping || !moved.count(item.value.data())) {
+                continue;
+            }
+            auto node = mIndex.extract(item.key);
+            const char* keyData =
+                    mapping->data + item.offset + sizeof(RecordHeader);
+            const std::string_view key(keyData, item.key.size());
+            node.key() = key;
+            Entry& entry = node.mapped();
+            entry.owner = mapping;
+            entry.value = std::string_view(keyData + key.size(),
+                                           item.value.size());
+            entry.recordSize = static_cast<uint32_t>(
+                    recordSize(key.size(), item.value.size()));
+            *entry.recency = key;
+            mIndex.insert(std::move(node));
+        }
+        if (mapping) {
+            mMapping = std::move(mapping);
+        }
+    }
+    mCompacting = false;
+    mCompactionDone.broadcast();
+    return ok;
+}
+
+size_t PersistentMruCache::size() const {
+    AutoLock lock(mLock);
+    return mIndex.size();
+}
+
+uint64_t PersistentMruCache::deadBytes() const {
+    AutoLock lock(mLock);
+    return mDeadBytes;
+}
+
+uint64_t PersistentMruCache::fileSize() const {
+    AutoLock lock(mLock);
+    return mFileSize;
+}
+
+}  // namespace base
+}  // namespace android
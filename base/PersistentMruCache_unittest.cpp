@@ -0,0 +1,155 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/PersistentMruCache.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+
+#include "aemu/base/testing/TestTempDir.h"
+
+namespace android {
+namespace base {
+namespace {
+
+std::string valueOf(PersistentMruCache* cache, const std::string& key) {
+    PersistentMruCache::Value value;
+    if (!cache->get(key, &value)) {
+        return "<missing>";
+    }
+    return std::string(value.data());
+}
+
+// Tests that entries survive reopening the file.
+TEST(PersistentMruCache, Reopen) {
+    TestTempDir dir("pmrucache");
+    const std::string path = dir.makeSubPath("cache");
+    {
+        auto cache = PersistentMruCache::open(path, 100);
+        ASSERT_TRUE(cache);
+        EXPECT_TRUE(cache->put("a", "alpha"));
+        EXPECT_TRUE(cache->put("b", std::string(10000, 'b')));
+        EXPECT_TRUE(cache->put("empty", ""));
+    }
+    auto cache = PersistentMruCache::open(path, 100);
+    ASSERT_TRUE(cache);
+    EXPECT_EQ(3u, cache->size());
+    EXPECT_EQ("alpha", valueOf(cache.get(), "a"));
+    EXPECT_EQ(std::string(10000, 'b'), valueOf(cache.get(), "b"));
+    EXPECT_EQ("", valueOf(cache.get(), "empty"));
+    EXPECT_EQ("<missing>", valueOf(cache.get(), "c"));
+}
+
+// Tests that compaction drops replaced records and keeps values handed out
+// earlier valid.
+TEST(PersistentMruCache, Compact) {
+    TestTempDir dir("pmrucache");
+    const std::string path = dir.makeSubPath("cache");
+    auto cache = PersistentMruCache::open(path, 100);
+    ASSERT_TRUE(cache);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_TRUE(cache->put("key", "value" + std::to_string(i)));
+    }
+    EXPECT_TRUE(cache->put("other", "x"));
+    EXPECT_GT(cache->deadBytes(), 0u);
+    const uint64_t before = cache->fileSize();
+
+    PersistentMruCache::Value held;
+    ASSERT_TRUE(cache->get("key", &held));
+    EXPECT_TRUE(cache->compact());
+    EXPECT_EQ(0u, cache->deadBytes());
+    EXPECT_LT(cache->fileSize(), before);
+    EXPECT_EQ("value9", held.data());
+    EXPECT_EQ("value9", valueOf(cache.get(), "key"));
+
+    cache.reset();
+    cache = PersistentMruCache::open(path, 100);
+    ASSERT_TRUE(cache);
+    EXPECT_EQ(2u, cache->size());
+    EXPECT_EQ("value9", valueOf(cache.get(), "key"));
+    EXPECT_EQ("x", valueOf(cache.get(), "other"));
+}
+
+// Tests that a torn record is dropped and a corrupted one is caught.
+TEST(PersistentMruCache, Damage) {
+    TestTempDir dir("pmrucache");
+    const std::string path = dir.makeSubPath("cache");
+    uint64_t goodSize;
+    {
+        auto cache = PersistentMruCache::open(path, 100);
+        ASSERT_TRUE(cache);
+        EXPECT_TRUE(cache->put("good", "value"));
+        EXPECT_TRUE(cache->put("bad", "value"));
+        goodSize = cache->fileSize();
+    }
+    {
+        // A partial record, as a crash during a put could leave.
+        std::ofstream(path, std::ios::binary | std::ios::app) << "REC1\x05";
+        // Flip a byte of the last value.
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(goodSize - 4);
+        file.put('X');
+    }
+    auto cache = PersistentMruCache::open(path, 100);
+    ASSERT_TRUE(cache);
+    EXPECT_EQ(goodSize, cache->fileSize());
+    EXPECT_EQ("value", valueOf(cache.get(), "good"));
+    EXPECT_EQ("<missing>", valueOf(cache.get(), "bad"));
+    EXPECT_TRUE(cache->put("new", "entry"));
+
+    cache.reset();
+    cache = PersistentMruCache::open(path, 100);
+    ASSERT_TRUE(cache);
+    EXPECT_EQ("entry", valueOf(cache.get(), "new"));
+}
+
+// Tests that a file in another format is reset instead of misread.
+TEST(PersistentMruCache, ForeignFile) {
+    TestTempDir dir("pmrucache");
+    const std::string path = dir.makeSubPath("cache");
+    std::ofstream(path) << "not a cache file";
+    auto cache = PersistentMruCache::open(path, 100);
+    ASSERT_TRUE(cache);
+    EXPECT_EQ(0u, cache->size());
+    EXPECT_TRUE(cache->put("a", "b"));
+    EXPECT_EQ("b", valueOf(cache.get(), "a"));
+}
+
+// Tests that reaching the entry limit compacts in the background with the
+// MruCache eviction policy, while puts keep going.
+TEST(PersistentMruCache, Eviction) {
+    TestTempDir dir("pmrucache");
+    const std::string path = dir.makeSubPath("cache");
+    {
+        auto cache = PersistentMruCache::open(path, 10);
+        ASSERT_TRUE(cache);
+        for (int i = 0; i < 30; ++i) {
+            EXPECT_TRUE(cache->put("key" + std::to_string(i), "value"));
+        }
+        EXPECT_TRUE(cache->compact());
+        EXPECT_LT(cache->size(), 10u);
+        EXPECT_EQ(0u, cache->deadBytes());
+    }
+    auto cache = PersistentMruCache::open(path, 10);
+    ASSERT_TRUE(cache);
+    EXPECT_LT(cache->size(), 10u);
+    EXPECT_GT(cache->size(), 0u);
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
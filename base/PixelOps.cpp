@@ -0,0 +1,707 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/PixelOps.h"
+
+#include "aemu/base/threads/BackgroundExecutor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PIXEL_OPS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC allows any intrinsic without per-function target flags.
+#define PIXEL_TARGET(isa)
+#else
+#define PIXEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PIXEL_OPS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace android {
+namespace base {
+namespace {
+
+// As in YuvKernels, each SIMD row function handles as many whole vectors as
+// fit in |width| and returns how many pixels it did; the scalar loop
+// finishes the row.
+using RowFn = int (*)(const uint8_t* src, uint8_t* dst, int width);
+using TailFn = void (*)(const uint8_t* src, uint8_t* dst, int from, int width);
+// Writes the transpose of the 4x4 block of 4-byte pixels at |src| to |dst|.
+// Strides may be negative, to walk rows bottom up.
+using TransposeFn = void (*)(const uint8_t* src, ptrdiff_t srcStride,
+                             uint8_t* dst, ptrdiff_t dstStride);
+
+// Quarter turns walk the source in strips this many columns wide, down to
+// this many rows at a time. The strip's columns become destination rows
+// that are then written front to back, which the prefetchers follow; the
+// source lines the strip only used half of are still cached for the next
+// one. Square tiles were twice as slow on 4K frames.
+constexpr int kRotateStripColumns = 8;
+constexpr int kRotateStripRows = 256;
+// Bands for threads start on a source cache line.
+constexpr int kRotateBandAlign = 16;
+
+int noRow(const uint8_t*, uint8_t*, int) {
+    return 0;
+}
+
+// x * a / 255, rounded to nearest, exactly.
+inline uint8_t mulDiv255(unsigned x, unsigned a) {
+    const unsigned t = x * a + 128;
+    return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+}
+
+void swapRBTail(const uint8_t* src, uint8_t* dst, int from, int width) {
+    for (int x = from; x < width; ++x) {
+        const uint8_t* s = src + 4 * x;
+        uint8_t* d = dst + 4 * x;
+        const uint8_t r = s[0], g = s[1], b = s[2], a = s[3];
+        d[0] = b;
+        d[1] = g;
+        d[2] = r;
+        d[3] = a;
+    }
+}
+
+void premultiplyTail(const uint8_t* src, uint8_t* dst, int from, int width) {
+    for (int x = from; x < width; ++x) {
+        const uint8_t* s = src + 4 * x;
+        uint8_t* d = dst + 4 * x;
+        const uint8_t a = s[3];
+        d[0] = mulDiv255(s[0], a);
+        d[1] = mulDiv255(s[1], a);
+        d[2] = mulDiv255(s[2], a);
+        d[3] = a;
+    }
+}
+
+void rgb565ToRgbaTail(const uint8_t* src, uint8_t* dst, int from, int width) {
+    for (int x = from; x < width; ++x) {
+        const unsigned p = src[2 * x] | (src[2 * x + 1] << 8);
+        const unsigned r = p >> 11, g = (p >> 5) & 63, b = p & 31;
+        uint8_t* d = dst + 4 * x;
+        d[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+        d[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+        d[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+        d[3] = 0xff;
+    }
+}
+
+void rgbaToRgb565Tail(const uint8_t* src, uint8_t* dst, int from, int width) {
+    for (int x = from; x < width; ++x) {
+        const uint8_t* s = src + 4 * x;
+        const unsigned p = ((s[0] >> 3) << 11) | ((s[1] >> 2) << 5) | (s[2] >> 3);
+        dst[2 * x] = static_cast<uint8_t>(p);
+        dst[2 * x + 1] = static_cast<uint8_t>(p >> 8);
+    }
+}
+
+void transposeScalar(const uint8_t* src, ptrdiff_t srcStride,
+                     uint8_t* dst, ptrdiff_t dstStride) {
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            memcpy(dst + i * dstStride + 4 * j, src + j * srcStride + 4 * i, 4);
+        }
+    }
+}
+
+template <RowFn Row, TailFn Tail>
+void mapPlane(const uint8_t* src, size_t srcStride,
+              uint8_t* dst, size_t dstStride,
+              int width, int height) {
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* srcRow = src + y * srcStride;
+        uint8_t* dstRow = dst + y * dstStride;
+        Tail(srcRow, dstRow, Row(srcRow, dstRow, width), width);
+    }
+}
+
+// Moves the pixels of [x0, x1) x [y0, y1) one by one, for the edges the
+// 4x4 blocks don't cover.
+void rotatePixels(const uint8_t* src, ptrdiff_t srcStride,
+                  uint8_t* dst, ptrdiff_t dstStride,
+                  int width, int height, bool clockwise,
+                  int x0, int y0, int x1, int y1) {
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            uint8_t* d = clockwise ? dst + x * dstStride + 4 * (height - 1 - y)
+                                   : dst + (width - 1 - x) * dstStride + 4 * y;
+            memcpy(d, src + y * srcStride + 4 * x, 4);
+        }
+    }
+}
+
+template <TransposeFn Transpose>
+void rotateQuarter(const uint8_t* src, ptrdiff_t srcStride,
+                   uint8_t* dst, ptrdiff_t dstStride,
+                   int width, int height, bool clockwise) {
+    for (int tx = 0; tx < width; tx += kRotateStripColumns) {
+        const int xEnd = std::min(tx + kRotateStripColumns, width);
+        for (int ty = 0; ty < height; ty += kRotateStripRows) {
+            const int yEnd = std::min(ty + kRotateStripRows, height);
+            int y = ty;
+            for (; y + 4 <= yEnd; y += 4) {
+                int x = tx;
+                for (; x + 4 <= xEnd; x += 4) {
+                    if (clockwise) {
+                        // Reading the block's rows bottom up turns the
+                        // transpose into a clockwise turn...
+                        Transpose(src + (y + 3) * srcStride + 4 * x, -srcStride,
+                                  dst + x * dstStride + 4 * (height - 4 - y),
+                                  dstStride);
+                    } else {
+                        // ...and writing them bottom up, a counterclockwise
+                        // one.
+                        Transpose(src + y * srcStride + 4 * x, srcStride,
+                                  dst + (width - 1 - x) * dstStride + 4 * y,
+                                  -dstStride);
+                    }
+                }
+                rotatePixels(src, srcStride, dst, dstStride, width, height,
+                             clockwise, x, y, xEnd, y + 4);
+            }
+            rotatePixels(src, srcStride, dst, dstStride, width, height,
+                         clockwise, tx, y, xEnd, yEnd);
+        }
+    }
+}
+
+// |Reverse| writes the first pixels of |src| to the end of |dst|, in
+// reverse order.
+template <RowFn Reverse>
+void rotateHalf(const uint8_t* src, size_t srcStride,
+                uint8_t* dst, size_t dstStride,
+                int width, int height) {
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* srcRow = src + y * srcStride;
+        uint8_t* dstRow = dst + (height - 1 - y) * dstStride;
+        for (int x = Reverse(srcRow, dstRow, width); x < width; ++x) {
+            memcpy(dstRow + 4 * (width - 1 - x), srcRow + 4 * x, 4);
+        }
+    }
+}
+
+template <TransposeFn Transpose, RowFn Reverse>
+void rotatePlane(const uint8_t* src, size_t srcStride,
+                 uint8_t* dst, size_t dstStride,
+                 int width, int height, int quarterTurns) {
+    switch (quarterTurns & 3) {
+        case 0:
+            for (int y = 0; y < height; ++y) {
+                memcpy(dst + y * dstStride, src + y * srcStride, 4 * size_t(width));
+            }
+            break;
+        case 1:
+            rotateQuarter<Transpose>(src, srcStride, dst, dstStride, width,
+                                     height, true);
+            break;
+        case 2:
+            rotateHalf<Reverse>(src, srcStride, dst, dstStride, width, height);
+            break;
+        case 3:
+            rotateQuarter<Transpose>(src, srcStride, dst, dstStride, width,
+                                     height, false);
+            break;
+    }
+}
+
+constexpr PixelKernels kScalarKernels = {
+        &mapPlane<&noRow, &swapRBTail>,
+        &mapPlane<&noRow, &premultiplyTail>,
+        &mapPlane<&noRow, &rgb565ToRgbaTail>,
+        &mapPlane<&noRow, &rgbaToRgb565Tail>,
+        &rotatePlane<&transposeScalar, &noRow>,
+        "scalar",
+};
+
+#if PIXEL_OPS_X86
+
+PIXEL_TARGET("sse2")
+int swapRBRowSse2(const uint8_t* src, uint8_t* dst, int width) {
+    const __m128i ga = _mm_set1_epi32(int(0xff00ff00u));
+    const __m128i low = _mm_set1_epi32(0xff);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        const __m128i p = _mm_loadu_si128((const __m128i*)(src + 4 * x));
+        const __m128i r = _mm_slli_epi32(_mm_and_si128(p, low), 16);
+        const __m128i b = _mm_and_si128(_mm_srli_epi32(p, 16), low);
+        _mm_storeu_si128((__m128i*)(dst + 4 * x),
+                         _mm_or_si128(_mm_and_si128(p, ga), _mm_or_si128(r, b)));
+    }
+    return x;
+}
+
+// Premultiplies two pixels widened to 16 bits per channel, alpha included.
+PIXEL_TARGET("sse2")
+inline __m128i premultiplyWideSse2(__m128i c) {
+    const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c, 0xff), 0xff);
+    const __m128i t = _mm_add_epi16(_mm_mullo_epi16(c, a), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+PIXEL_TARGET("sse2")
+int premultiplyRowSse2(const uint8_t* src, uint8_t* dst, int width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi32(int(0xff000000u));
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        const __m128i p = _mm_loadu_si128((const __m128i*)(src + 4 * x));
+        const __m128i lo = premultiplyWideSse2(_mm_unpacklo_epi8(p, zero));
+        const __m128i hi = premultiplyWideSse2(_mm_unpackhi_epi8(p, zero));
+        const __m128i c = _mm_packus_epi16(lo, hi);
+        _mm_storeu_si128((__m128i*)(dst + 4 * x),
+                         _mm_or_si128(_mm_andnot_si128(alpha, c),
+                                      _mm_and_si128(p, alpha)));
+    }
+    return x;
+}
+
+PIXEL_TARGET("sse2")
+int rgb565ToRgbaRowSse2(const uint8_t* src, uint8_t* dst, int width) {
+    const __m128i mask6 = _mm_set1_epi16(63);
+    const __m128i mask5 = _mm_set1_epi16(31);
+    const __m128i opaque = _mm_set1_epi16(int16_t(0xff00));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m128i p = _mm_loadu_si128((const __m128i*)(src + 2 * x));
+        const __m128i r5 = _mm_srli_epi16(p, 11);
+        const __m128i g6 = _mm_and_si128(_mm_srli_epi16(p, 5), mask6);
+        const __m128i b5 = _mm_and_si128(p, mask5);
+        const __m128i r = _mm_or_si128(_mm_slli_epi16(r5, 3), _mm_srli_epi16(r5, 2));
+        const __m128i g = _mm_or_si128(_mm_slli_epi16(g6, 2), _mm_srli_epi16(g6, 4));
+        const __m128i b = _mm_or_si128(_mm_slli_epi16(b5, 3), _mm_srli_epi16(b5, 2));
+        const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+        const __m128i ba = _mm_or_si128(b, opaque);
+        _mm_storeu_si128((__m128i*)(dst + 4 * x), _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128((__m128i*)(dst + 4 * x + 16), _mm_unpackhi_epi16(rg, ba));
+    }
+    return x;
+}
+
+// Four RGBA pixels to RGB565 in the low halves of 32-bit lanes, sign
+// extended so that packs_epi32 keeps all 16 bits.
+PIXEL_TARGET("sse2")
+inline __m128i toRgb565Sse2(__m128i p) {
+    const __m128i r = _mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0xf8)), 8);
+    const __m128i g = _mm_srli_epi32(_mm_and_si128(p, _mm_set1_epi32(0xfc00)), 5);
+    const __m128i b = _mm_srli_epi32(_mm_and_si128(p, _mm_set1_epi32(0xf80000)), 19);
+    const __m128i v = _mm_or_si128(r, _mm_or_si128(g, b));
+    return _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+}
+
+PIXEL_TARGET("sse2")
+int rgbaToRgb565RowSse2(const uint8_t* src, uint8_t* dst, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(src + 4 * x));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(src + 4 * x + 16));
+        _mm_storeu_si128((__m128i*)(dst + 2 * x),
+                         _mm_packs_epi32(toRgb565Sse2(a), toRgb565Sse2(b)));
+    }
+    return x;
+}
+
+PIXEL_TARGET("sse2")
+void transposeSse2(const uint8_t* src, ptrdiff_t srcStride,
+                   uint8_t* dst, ptrdiff_t dstStride) {
+    const __m128i r0 = _mm_loadu_si128((const __m128i*)src);
+    const __m128i r1 = _mm_loadu_si128((const __m128i*)(src + srcStride));
+    const __m128i r2 = _mm_loadu_si128((const __m128i*)(src + 2 * srcStride));
+    const __m128i r3 = _mm_loadu_si128((const __m128i*)(src + 3 * srcStride));
+    const __m128i t0 = _mm_unpacklo_epi32(r0, r1);  // a0 b0 a1 b1
+    const __m128i t1 = _mm_unpacklo_epi32(r2, r3);  // c0 d0 c1 d1
+    const __m128i t2 = _mm_unpackhi_epi32(r0, r1);  // a2 b2 a3 b3
+    const __m128i t3 = _mm_unpackhi_epi32(r2, r3);  // c2 d2 c3 d3
+    _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128((__m128i*)(dst + dstStride), _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128((__m128i*)(dst + 2 * dstStride), _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128((__m128i*)(dst + 3 * dstStride), _mm_unpackhi_epi64(t2, t3));
+}
+
+PIXEL_TARGET("sse2")
+int reverseRowSse2(const uint8_t* src, uint8_t* dst, int width) {
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        const __m128i p = _mm_loadu_si128((const __m128i*)(src + 4 * x));
+        _mm_storeu_si128((__m128i*)(dst + 4 * (width - 4 - x)),
+                         _mm_shuffle_epi32(p, 0x1b));
+    }
+    return x;
+}
+
+// The AVX2 unpacks and packs work within 128-bit lanes, which keeps the
+// pixels in order here as both go the same way.
+
+PIXEL_TARGET("avx2")
+int swapRBRowAvx2(const uint8_t* src, uint8_t* dst, int width) {
+    const __m256i ga = _mm256_set1_epi32(int(0xff00ff00u));
+    const __m256i low = _mm256_set1_epi32(0xff);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m256i p = _mm256_loadu_si256((const __m256i*)(src + 4 * x));
+        const __m256i r = _mm256_slli_epi32(_mm256_and_si256(p, low), 16);
+        const __m256i b = _mm256_and_si256(_mm256_srli_epi32(p, 16), low);
+        _mm256_storeu_si256((__m256i*)(dst + 4 * x),
+                            _mm256_or_si256(_mm256_and_si256(p, ga),
+                                            _mm256_or_si256(r, b)));
+    }
+    return x;
+}
+
+PIXEL_TARGET("avx2")
+inline __m256i premultiplyWideAvx2(__m256i c) {
+    const __m256i a =
+            _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(c, 0xff), 0xff);
+    const __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(c, a),
+                                       _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+PIXEL_TARGET("avx2")
+int premultiplyRowAvx2(const uint8_t* src, uint8_t* dst, int width) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha = _mm256_set1_epi32(int(0xff000000u));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m256i p = _mm256_loadu_si256((const __m256i*)(src + 4 * x));
+        const __m256i lo = premultiplyWideAvx2(_mm256_unpacklo_epi8(p, zero));
+        const __m256i hi = premultiplyWideAvx2(_mm256_unpackhi_epi8(p, zero));
+        const __m256i c = _mm256_packus_epi16(lo, hi);
+        _mm256_storeu_si256((__m256i*)(dst + 4 * x),
+                            _mm256_or_si256(_mm256_andnot_si256(alpha, c),
+                                            _mm256_and_si256(p, alpha)));
+    }
+    return x;
+}
+
+constexpr PixelKernels kSse2Kernels = {
+        &mapPlane<&swapRBRowSse2, &swapRBTail>,
+        &mapPlane<&premultiplyRowSse2, &premultiplyTail>,
+        &mapPlane<&rgb565ToRgbaRowSse2, &rgb565ToRgbaTail>,
+        &mapPlane<&rgbaToRgb565RowSse2, &rgbaToRgb565Tail>,
+        &rotatePlane<&transposeSse2, &reverseRowSse2>,
+        "sse2",
+};
+
+// Format conversions and rotation are bound by memory traffic rather than
+// by instructions, so they keep their SSE2 kernels.
+constexpr PixelKernels kAvx2Kernels = {
+        &mapPlane<&swapRBRowAvx2, &swapRBTail>,
+        &mapPlane<&premultiplyRowAvx2, &premultiplyTail>,
+        &mapPlane<&rgb565ToRgbaRowSse2, &rgb565ToRgbaTail>,
+        &mapPlane<&rgbaToRgb565RowSse2, &rgbaToRgb565Tail>,
+        &rotatePlane<&transposeSse2, &reverseRowSse2>,
+        "avx2",
+};
+
+const PixelKernels& pickKernels() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool sse2 = info[3] & (1 << 26);
+    // AVX state must also be enabled by the OS.
+    const bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                       (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (osAvx && maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = info[1] & (1 << 5);
+    }
+#else
+    __builtin_cpu_init();
+    const bool sse2 = __builtin_cpu_supports("sse2");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2) {
+        return kAvx2Kernels;
+    }
+    if (sse2) {
+        return kSse2Kernels;
+    }
+    return kScalarKernels;
+}
+
+#elif PIXEL_OPS_NEON
+
+int swapRBRowNeon(const uint8_t* src, uint8_t* dst, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t p = vld4q_u8(src + 4 * x);
+        const uint8x16_t r = p.val[0];
+        p.val[0] = p.val[2];
+        p.val[2] = r;
+        vst4q_u8(dst + 4 * x, p);
+    }
+    return x;
+}
+
+// (c * a + 128 + ((c * a + 128) >> 8)) >> 8, like mulDiv255().
+inline uint8x16_t premultiplyNeon(uint8x16_t c, uint8x16_t a) {
+    const uint16x8_t lo = vmull_u8(vget_low_u8(c), vget_low_u8(a));
+    const uint16x8_t hi = vmull_u8(vget_high_u8(c), vget_high_u8(a));
+    return vcombine_u8(vrshrn_n_u16(vrsraq_n_u16(lo, lo, 8), 8),
+                       vrshrn_n_u16(vrsraq_n_u16(hi, hi, 8), 8));
+}
+
+int premultiplyRowNeon(const uint8_t* src, uint8_t* dst, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t p = vld4q_u8(src + 4 * x);
+        p.val[0] = premultiplyNeon(p.val[0], p.val[3]);
+        p.val[1] = premultiplyNeon(p.val[1], p.val[3]);
+        p.val[2] = premultiplyNeon(p.val[2], p.val[3]);
+        vst4q_u8(dst + 4 * x, p);
+    }
+    return x;
+}
+
+int rgb565ToRgbaRowNeon(const uint8_t* src, uint8_t* dst, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const uint16x8_t p = vreinterpretq_u16_u8(vld1q_u8(src + 2 * x));
+        const uint16x8_t r5 = vshrq_n_u16(p, 11);
+        const uint16x8_t g6 = vandq_u16(vshrq_n_u16(p, 5), vdupq_n_u16(63));
+        const uint16x8_t b5 = vandq_u16(p, vdupq_n_u16(31));
+        uint8x8x4_t out;
+        out.val[0] = vmovn_u16(vorrq_u16(vshlq_n_u16(r5, 3), vshrq_n_u16(r5, 2)));
+        out.val[1] = vmovn_u16(vorrq_u16(vshlq_n_u16(g6, 2), vshrq_n_u16(g6, 4)));
+        out.val[2] = vmovn_u16(vorrq_u16(vshlq_n_u16(b5, 3), vshrq_n_u16(b5, 2)));
+        out.val[3] = vdup_n_u8(0xff);
+        vst4_u8(dst + 4 * x, out);
+    }
+    return x;
+}
+
+int rgbaToRgb565RowNeon(const uint8_t* src, uint8_t* dst, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const uint8x8x4_t p = vld4_u8(src + 4 * x);
+        const uint16x8_t r = vmovl_u8(vshr_n_u8(p.val[0], 3));
+        const uint16x8_t g = vmovl_u8(vshr_n_u8(p.val[1], 2));
+        const uint16x8_t b = vmovl_u8(vshr_n_u8(p.val[2], 3));
+        const uint16x8_t v = vorrq_u16(
+                vorrq_u16(vshlq_n_u16(r, 11), vshlq_n_u16(g, 5)), b);
+        vst1q_u8(dst + 2 * x, vreinterpretq_u8_u16(v));
+    }
+    return x;
+}
+
+void transposeNeon(const uint8_t* src, ptrdiff_t srcStride,
+                   uint8_t* dst, ptrdiff_t dstStride) {
+    const uint32x4_t r0 = vreinterpretq_u32_u8(vld1q_u8(src));
+    const uint32x4_t r1 = vreinterpretq_u32_u8(vld1q_u8(src + srcStride));
+    const uint32x4_t r2 = vreinterpretq_u32_u8(vld1q_u8(src + 2 * srcStride));
+    const uint32x4_t r3 = vreinterpretq_u32_u8(vld1q_u8(src + 3 * srcStride));
+    const uint32x4x2_t ab = vtrnq_u32(r0, r1);  // a0 b0 a2 b2, a1 b1 a3 b3
+    const uint32x4x2_t cd = vtrnq_u32(r2, r3);  // c0 d0 c2 d2, c1 d1 c3 d3
+    vst1q_u8(dst, vreinterpretq_u8_u32(vcombine_u32(
+                          vget_low_u32(ab.val[0]), vget_low_u32(cd.val[0]))));
+    vst1q_u8(dst + dstStride, vreinterpretq_u8_u32(vcombine_u32(
+                          vget_low_u32(ab.val[1]), vget_low_u32(cd.val[1]))));
+    vst1q_u8(dst + 2 * dstStride, vreinterpretq_u8_u32(vcombine_u32(
+                          vget_high_u32(ab.val[0]), vget_high_u32(cd.val[0]))));
+    vst1q_u8(dst + 3 * dstStride, vreinterpretq_u8_u32(vcombine_u32(
+                          vget_high_u32(ab.val[1]), vget_high_u32(cd.val[1]))));
+}
+
+int reverseRowNeon(const uint8_t* src, uint8_t* dst, int width) {
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        const uint32x4_t p =
+                vrev64q_u32(vreinterpretq_u32_u8(vld1q_u8(src + 4 * x)));
+        vst1q_u8(dst + 4 * (width - 4 - x),
+                 vreinterpretq_u8_u32(
+                         vcombine_u32(vget_high_u32(p), vget_low_u32(p))));
+    }
+    return x;
+}
+
+constexpr PixelKernels kNeonKernels = {
+        &mapPlane<&swapRBRowNeon, &swapRBTail>,
+        &mapPlane<&premultiplyRowNeon, &premultiplyTail>,
+        &mapPlane<&rgb565ToRgbaRowNeon, &rgb565ToRgbaTail>,
+        &mapPlane<&rgbaToRgb565RowNeon, &rgbaToRgb565Tail>,
+        &rotatePlane<&transposeNeon, &reverseRowNeon>,
+        "neon",
+};
+
+// NEON is always there on AArch64.
+const PixelKernels& pickKernels() {
+    return kNeonKernels;
+}
+
+#else
+
+const PixelKernels& pickKernels() {
+    return kScalarKernels;
+}
+
+#endif
+
+// Images below this many pixels are converted on the calling thread; above
+// it, each band gets at least this many.
+constexpr int64_t kPixelsPerBand = 256 * 1024;
+
+// A job split in bands, claimed in order by the calling thread and by
+// BackgroundExecutor workers. The caller only waits for bands someone is
+// running, so it never waits on a worker that is busy elsewhere, and
+// workers that start after it returned find nothing left to do.
+struct BandedJob {
+    std::function<void(int, int)> run;
+    int count;
+    int bands;
+    int align;
+    std::atomic<int> next{0};
+    std::atomic<int> finished{0};
+    std::mutex lock;
+    std::condition_variable done;
+
+    void work() {
+        for (int band; (band = next.fetch_add(1)) < bands;) {
+            run(bandStart(band), bandStart(band + 1));
+            if (finished.fetch_add(1) + 1 == bands) {
+                std::lock_guard<std::mutex> guard(lock);
+                done.notify_all();
+            }
+        }
+    }
+
+    int bandStart(int band) const {
+        if (band == bands) {
+            return count;
+        }
+        return int(int64_t(count) * band / bands) / align * align;
+    }
+};
+
+// Calls |run| over [0, count) in bands of rows (or columns) starting at a
+// multiple of |align|, where each of |count| has |pixels| pixels.
+void forEachBand(int count, int64_t pixels, int align,
+                 std::function<void(int, int)> run) {
+    const int64_t total = int64_t(count) * pixels;
+    BackgroundExecutor& executor = BackgroundExecutor::get();
+    const int bands = int(std::min<int64_t>(
+            {total / kPixelsPerBand, executor.numWorkers() + 1, count / align}));
+    if (bands <= 1) {
+        run(0, count);
+        return;
+    }
+    auto job = std::make_shared<BandedJob>();
+    job->run = std::move(run);
+    job->count = count;
+    job->bands = bands;
+    job->align = align;
+    for (int i = 1; i < bands; ++i) {
+        executor.post([job] { job->work(); });
+    }
+    job->work();
+    std::unique_lock<std::mutex> lock(job->lock);
+    job->done.wait(lock, [&job] { return job->finished.load() == job->bands; });
+}
+
+using PlaneFn = void (*)(const uint8_t*, size_t, uint8_t*, size_t, int, int);
+
+void mapBanded(PlaneFn plane, const void* src, size_t srcStride,
+               void* dst, size_t dstStride, int width, int height) {
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    forEachBand(height, width, 1, [=](int y0, int y1) {
+        plane(s + y0 * srcStride, srcStride, d + y0 * dstStride, dstStride,
+              width, y1 - y0);
+    });
+}
+
+}  // namespace
+
+// static
+const PixelKernels& PixelKernels::get() {
+    static const PixelKernels& sKernels = pickKernels();
+    return sKernels;
+}
+
+// static
+const PixelKernels& PixelKernels::scalar() {
+    return kScalarKernels;
+}
+
+void pixelSwapRB(const void* src, size_t srcStride,
+                 void* dst, size_t dstStride,
+                 int width, int height) {
+    mapBanded(PixelKernels::get().swapRB, src, srcStride, dst, dstStride,
+              width, height);
+}
+
+void pixelPremultiply(const void* src, size_t srcStride,
+                      void* dst, size_t dstStride,
+                      int width, int height) {
+    mapBanded(PixelKernels::get().premultiply, src, srcStride, dst, dstStride,
+              width, height);
+}
+
+void pixelRgb565ToRgba(const void* src, size_t srcStride,
+                       void* dst, size_t dstStride,
+                       int width, int height) {
+    mapBanded(PixelKernels::get().rgb565ToRgba, src, srcStride, dst, dstStride,
+              width, height);
+}
+
+void pixelRgbaToRgb565(const void* src, size_t srcStride,
+                       void* dst, size_t dstStride,
+                       int width, int height) {
+    mapBanded(PixelKernels::get().rgbaToRgb565, src, srcStride, dst, dstStride,
+              width, height);
+}
+
+void pixelRotate(const void* src, size_t srcStride,
+                 void* dst, size_t dstStride,
+                 int width, int height, int quarterTurns) {
+    const auto rotate = PixelKernels::get().rotate;
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const int turns = quarterTurns & 3;
+    if (turns == 0 || turns == 2) {
+        // Source rows [y0, y1) land on destination rows
+        // [height - y1, height - y0) when turned around.
+        forEachBand(height, width, 1, [=](int y0, int y1) {
+            const int dstRow = turns == 2 ? height - y1 : y0;
+            rotate(s + y0 * srcStride, srcStride, d + dstRow * dstStride,
+                   dstStride, width, y1 - y0, turns);
+        });
+        return;
+    }
+    // Source columns [x0, x1) become destination rows [x0, x1) turning
+    // clockwise, and [width - x1, width - x0) the other way.
+    forEachBand(width, height, kRotateBandAlign, [=](int x0, int x1) {
+        const int dstRow = turns == 1 ? x0 : width - x1;
+        rotate(s + 4 * x0, srcStride, d + dstRow * dstStride, dstStride,
+               x1 - x0, height, turns);
+    });
+}
+
+}  // namespace base
+}  // namespace android
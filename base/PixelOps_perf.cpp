@@ -0,0 +1,113 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/PixelOps.h"
+
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+// One RGBA frame; args are width and height, and whether to use the scalar
+// kernels (0), the dispatched ones (1), or the banded functions (2).
+
+void BM_SwapRB(benchmark::State& state) {
+    const int w = state.range(0);
+    const int h = state.range(1);
+    std::vector<uint8_t> src(4 * w * h, 1), dst(src.size());
+    const PixelKernels& kernels =
+            state.range(2) ? PixelKernels::get() : PixelKernels::scalar();
+    for (auto _ : state) {
+        if (state.range(2) == 2) {
+            pixelSwapRB(src.data(), 4 * w, dst.data(), 4 * w, w, h);
+        } else {
+            kernels.swapRB(src.data(), 4 * w, dst.data(), 4 * w, w, h);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * src.size());
+    state.SetLabel(state.range(2) == 2 ? "banded" : kernels.name);
+}
+
+void BM_Premultiply(benchmark::State& state) {
+    const int w = state.range(0);
+    const int h = state.range(1);
+    std::vector<uint8_t> src(4 * w * h, 0x80), dst(src.size());
+    const PixelKernels& kernels =
+            state.range(2) ? PixelKernels::get() : PixelKernels::scalar();
+    for (auto _ : state) {
+        if (state.range(2) == 2) {
+            pixelPremultiply(src.data(), 4 * w, dst.data(), 4 * w, w, h);
+        } else {
+            kernels.premultiply(src.data(), 4 * w, dst.data(), 4 * w, w, h);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * src.size());
+    state.SetLabel(state.range(2) == 2 ? "banded" : kernels.name);
+}
+
+void BM_Rgb565ToRgba(benchmark::State& state) {
+    const int w = state.range(0);
+    const int h = state.range(1);
+    std::vector<uint8_t> src(2 * w * h, 0x55), dst(4 * w * h);
+    const PixelKernels& kernels =
+            state.range(2) ? PixelKernels::get() : PixelKernels::scalar();
+    for (auto _ : state) {
+        if (state.range(2) == 2) {
+            pixelRgb565ToRgba(src.data(), 2 * w, dst.data(), 4 * w, w, h);
+        } else {
+            kernels.rgb565ToRgba(src.data(), 2 * w, dst.data(), 4 * w, w, h);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * dst.size());
+    state.SetLabel(state.range(2) == 2 ? "banded" : kernels.name);
+}
+
+// The fourth arg is the number of quarter turns.
+void BM_Rotate(benchmark::State& state) {
+    const int w = state.range(0);
+    const int h = state.range(1);
+    const int turns = state.range(3);
+    std::vector<uint8_t> src(4 * w * h, 1), dst(src.size());
+    const size_t dstStride = 4 * (turns % 2 ? h : w);
+    const PixelKernels& kernels =
+            state.range(2) ? PixelKernels::get() : PixelKernels::scalar();
+    for (auto _ : state) {
+        if (state.range(2) == 2) {
+            pixelRotate(src.data(), 4 * w, dst.data(), dstStride, w, h, turns);
+        } else {
+            kernels.rotate(src.data(), 4 * w, dst.data(), dstStride, w, h, turns);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * src.size());
+    state.SetLabel(state.range(2) == 2 ? "banded" : kernels.name);
+}
+
+#define PIXEL_SIZES ArgsProduct({{1080, 2160}, {2400, 3840}, {0, 1, 2}})
+
+BENCHMARK(BM_SwapRB)->PIXEL_SIZES;
+BENCHMARK(BM_Premultiply)->PIXEL_SIZES;
+BENCHMARK(BM_Rgb565ToRgba)->PIXEL_SIZES;
+BENCHMARK(BM_Rotate)->ArgsProduct({{2160}, {3840}, {0, 1, 2}, {1, 2}});
+
+}  // namespace
+}  // namespace base
+}  // namespace android
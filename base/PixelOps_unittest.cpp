@@ -0,0 +1,177 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/PixelOps.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+// Widths around the vector sizes, so the scalar tails are covered too.
+constexpr int kWidths[] = {1, 3, 4, 7, 8, 15, 16, 17, 33, 64, 65, 100};
+constexpr int kHeight = 9;
+constexpr size_t kPad = 12;
+
+std::vector<uint8_t> pattern(size_t count, unsigned seed) {
+    std::vector<uint8_t> v(count);
+    for (size_t i = 0; i < count; ++i) {
+        v[i] = static_cast<uint8_t>((i * 2654435761u + seed) >> 7);
+    }
+    return v;
+}
+
+uint32_t pixelAt(const std::vector<uint8_t>& image, size_t stride, int x, int y) {
+    uint32_t p;
+    memcpy(&p, image.data() + y * stride + 4 * x, 4);
+    return p;
+}
+
+using PlaneKernel = void (*PixelKernels::*)(const uint8_t*, size_t, uint8_t*,
+                                            size_t, int, int);
+
+void checkAgainstScalar(PlaneKernel kernel, int srcBytes, int dstBytes) {
+    const PixelKernels& best = PixelKernels::get();
+    const PixelKernels& scalar = PixelKernels::scalar();
+    for (int width : kWidths) {
+        SCOPED_TRACE(width);
+        const size_t srcStride = width * srcBytes + kPad;
+        const size_t dstStride = width * dstBytes + kPad;
+        const std::vector<uint8_t> src = pattern(srcStride * kHeight, width);
+        std::vector<uint8_t> dst1(dstStride * kHeight), dst2(dst1);
+        (best.*kernel)(src.data(), srcStride, dst1.data(), dstStride, width,
+                       kHeight);
+        (scalar.*kernel)(src.data(), srcStride, dst2.data(), dstStride, width,
+                         kHeight);
+        EXPECT_EQ(dst2, dst1);
+    }
+}
+
+}  // namespace
+
+// Tests that the dispatched kernels match the scalar ones.
+TEST(PixelOps, MatchesScalar) {
+    SCOPED_TRACE(PixelKernels::get().name);
+    checkAgainstScalar(&PixelKernels::swapRB, 4, 4);
+    checkAgainstScalar(&PixelKernels::premultiply, 4, 4);
+    checkAgainstScalar(&PixelKernels::rgb565ToRgba, 2, 4);
+    checkAgainstScalar(&PixelKernels::rgbaToRgb565, 4, 2);
+}
+
+// Tests the scalar kernels on known pixels.
+TEST(PixelOps, ScalarValues) {
+    const PixelKernels& k = PixelKernels::scalar();
+    uint8_t rgba[8] = {0x10, 0x20, 0x30, 0x40, 0xff, 0x80, 0x01, 0x80};
+    uint8_t out[8];
+    k.swapRB(rgba, 8, out, 8, 2, 1);
+    EXPECT_EQ(0, memcmp(out, "\x30\x20\x10\x40\x01\x80\xff\x80", 8));
+
+    k.premultiply(rgba, 8, out, 8, 2, 1);
+    // 0xff * 0x80 / 255 = 0x80, 0x80 * 0x80 / 255 = 64.25, 1 * 0x80 / 255 = 0.5
+    EXPECT_EQ(0, memcmp(out + 4, "\x80\x40\x01\x80", 4));
+
+    const uint8_t rgb565[4] = {0x1f, 0xf8, 0xe0, 0x07};  // magenta, green
+    k.rgb565ToRgba(rgb565, 4, out, 8, 2, 1);
+    EXPECT_EQ(0, memcmp(out, "\xff\x00\xff\xff\x00\xff\x00\xff", 8));
+    uint8_t back[4];
+    k.rgbaToRgb565(out, 8, back, 4, 2, 1);
+    EXPECT_EQ(0, memcmp(back, rgb565, 4));
+}
+
+// Tests that every rotation puts each pixel where QFrameBuffer::rotation
+// says, for sizes that leave partial blocks and tiles.
+TEST(PixelOps, Rotate) {
+    for (const PixelKernels* k : {&PixelKernels::get(), &PixelKernels::scalar()}) {
+        SCOPED_TRACE(k->name);
+        for (int turns = 0; turns < 4; ++turns) {
+            SCOPED_TRACE(turns);
+            for (int width : {1, 5, 70, 131}) {
+                const int height = 67;
+                const size_t srcStride = 4 * width + kPad;
+                const int dstWidth = turns % 2 ? height : width;
+                const int dstHeight = turns % 2 ? width : height;
+                const size_t dstStride = 4 * dstWidth + kPad;
+                const std::vector<uint8_t> src = pattern(srcStride * height, 3);
+                std::vector<uint8_t> dst(dstStride * dstHeight);
+                k->rotate(src.data(), srcStride, dst.data(), dstStride, width,
+                          height, turns);
+                for (int y = 0; y < height; ++y) {
+                    for (int x = 0; x < width; ++x) {
+                        int dx = x, dy = y;
+                        if (turns == 1) {
+                            dx = height - 1 - y;
+                            dy = x;
+                        } else if (turns == 2) {
+                            dx = width - 1 - x;
+                            dy = height - 1 - y;
+                        } else if (turns == 3) {
+                            dx = y;
+                            dy = width - 1 - x;
+                        }
+                        ASSERT_EQ(pixelAt(src, srcStride, x, y),
+                                  pixelAt(dst, dstStride, dx, dy))
+                                << width << " " << x << "," << y;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Tests that images large enough to be split in bands come out the same
+// as done in one go.
+TEST(PixelOps, Banded) {
+    const int width = 1283;
+    const int height = 721;
+    const size_t stride = 4 * width;
+    const std::vector<uint8_t> src = pattern(stride * height, 5);
+    const PixelKernels& k = PixelKernels::get();
+
+    std::vector<uint8_t> expected(src.size()), actual(src.size());
+    k.premultiply(src.data(), stride, expected.data(), stride, width, height);
+    pixelPremultiply(src.data(), stride, actual.data(), stride, width, height);
+    EXPECT_EQ(expected, actual);
+
+    // In place.
+    actual = src;
+    k.swapRB(src.data(), stride, expected.data(), stride, width, height);
+    pixelSwapRB(actual.data(), stride, actual.data(), stride, width, height);
+    EXPECT_EQ(expected, actual);
+
+    std::vector<uint8_t> rgb565(2 * width * height);
+    k.rgbaToRgb565(src.data(), stride, expected.data(), 2 * width, width, height);
+    pixelRgbaToRgb565(src.data(), stride, rgb565.data(), 2 * width, width, height);
+    EXPECT_EQ(0, memcmp(expected.data(), rgb565.data(), rgb565.size()));
+    k.rgb565ToRgba(rgb565.data(), 2 * width, expected.data(), stride, width, height);
+    pixelRgb565ToRgba(rgb565.data(), 2 * width, actual.data(), stride, width, height);
+    EXPECT_EQ(expected, actual);
+
+    for (int turns = 0; turns < 4; ++turns) {
+        SCOPED_TRACE(turns);
+        const size_t dstStride = 4 * (turns % 2 ? height : width);
+        k.rotate(src.data(), stride, expected.data(), dstStride, width, height,
+                 turns);
+        pixelRotate(src.data(), stride, actual.data(), dstStride, width, height,
+                    turns);
+        EXPECT_EQ(expected, actual);
+    }
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,498 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/Pool.h"
+
+#include "aemu/base/AlignedBuf.h"
+#include "aemu/base/synchronization/Lock.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace android {
+namespace base {
+
+namespace {
+
+constexpr size_t kSlabHeaderSize = Pool::kMaxAlignment;
+constexpr size_t kMinSlabSize = 64 * 1024;
+constexpr uint32_t kLargeClass = UINT32_MAX;
+// Threads beyond this many share the pool lock instead of having a cache.
+constexpr int kMaxThreadSlots = 64;
+
+uint32_t floorLog2(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+uint64_t roundUpPow2(uint64_t value) {
+    return value <= 1 ? 1 : uint64_t(1) << (floorLog2(value - 1) + 1);
+}
+
+struct FreeNode {
+    FreeNode* next;
+};
+
+// Header at the start of every slab and large allocation.
+struct Slab {
+    uint32_t classIndex;
+    uint32_t live;
+    // Position in Pool::Impl::mSlabs.
+    uint32_t slabIndex;
+    bool inPartialList;
+    FreeNode* freeList;
+    union {
+        // Start of the part of the slab never handed out yet.
+        char* bump;
+        // Total size of a large allocation, header included.
+        size_t largeSize;
+    };
+    // Links in the list of slabs of a class with room in them.
+    Slab* prev;
+    Slab* next;
+};
+static_assert(sizeof(Slab) <= kSlabHeaderSize, "Slab header too big");
+
+// Gives each live thread a small index for the per-thread caches. Indices are
+// reused once their thread exits.
+class ThreadSlot {
+public:
+    ~ThreadSlot() {
+        if (mIndex >= 0) {
+            AutoLock lock(sLock);
+            sUsed &= ~(uint64_t(1) << mIndex);
+        }
+    }
+
+    // Returns -1 if all slots are taken.
+    int index() {
+        if (mIndex == kUnassigned) {
+            AutoLock lock(sLock);
+            mIndex = -1;
+            for (int i = 0; i < kMaxThreadSlots; ++i) {
+                if (!(sUsed & (uint64_t(1) << i))) {
+                    sUsed |= uint64_t(1) << i;
+                    mIndex = i;
+                    break;
+                }
+            }
+        }
+        return mIndex;
+    }
+
+private:
+    static constexpr int kUnassigned = -2;
+    static_assert(kMaxThreadSlots <= 64, "slots are tracked in a uint64_t");
+
+    static StaticLock sLock;
+    static uint64_t sUsed;
+    int mIndex = kUnassigned;
+};
+
+StaticLock ThreadSlot::sLock;
+uint64_t ThreadSlot::sUsed = 0;
+
+thread_local ThreadSlot tThreadSlot;
+
+}  // namespace
+
+class Pool::Impl {
+public:
+    Impl(size_t minSize, size_t maxSize, size_t chunksPerSize, Threading threading)
+        : mThreaded(threading == Threading::PerThreadCache) {
+        mMinShift = floorLog2(roundUpPow2(std::max(minSize, sizeof(FreeNode))));
+        const uint32_t maxShift = std::max<uint32_t>(
+            mMinShift, floorLog2(roundUpPow2(std::max<size_t>(maxSize, 1))));
+        mMaxClassSize = size_t(1) << maxShift;
+        mClasses.resize(maxShift - mMinShift + 1);
+        for (size_t i = 0; i < mClasses.size(); ++i) {
+            mClasses[i].size = size_t(1) << (mMinShift + i);
+        }
+        // Room for at least 8 objects of the largest class.
+        mSlabSize = std::max<size_t>(
+            kMinSlabSize, roundUpPow2(kSlabHeaderSize + 8 * mMaxClassSize));
+        mCacheLimit = std::min<size_t>(std::max<size_t>(chunksPerSize / 8, 8), 256);
+        if (mThreaded) {
+            mCaches.reset(new std::atomic<ThreadCache*>[kMaxThreadSlots]);
+            for (int i = 0; i < kMaxThreadSlots; ++i) {
+                mCaches[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    ~Impl() {
+        freeAll();
+        if (mThreaded) {
+            for (int i = 0; i < kMaxThreadSlots; ++i) {
+                delete mCaches[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void* alloc(size_t wantedSize) {
+        mAllocCount.fetch_add(1, std::memory_order_relaxed);
+        if (wantedSize > mMaxClassSize) {
+            return allocLarge(wantedSize);
+        }
+        const uint32_t classIndex = classIndexFor(wantedSize);
+        mBytesInUse.fetch_add(mClasses[classIndex].size, std::memory_order_relaxed);
+
+        bool grew = false;
+        ThreadCache* cache = threadCache();
+        if (!cache) {
+            AutoLockIf lock(mLock, mThreaded);
+            void* result = allocFromClass(classIndex, &grew);
+            if (grew) {
+                mMissCount.fetch_add(1, std::memory_order_relaxed);
+            }
+            return result;
+        }
+
+        // Threads that exited leave their cache to the next one in their slot.
+        ThreadCache::Bin& bin = cache->bins[classIndex];
+        if (!bin.head) {
+            // Refill half the cache in one go.
+            AutoLock lock(mLock);
+            for (size_t i = 0; i < mCacheLimit / 2; ++i) {
+                auto node = static_cast<FreeNode*>(allocFromClass(classIndex, &grew));
+                node->next = bin.head;
+                bin.head = node;
+                ++bin.count;
+            }
+            if (grew) {
+                mMissCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else {
+            mCacheHitCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        FreeNode* node = bin.head;
+        bin.head = node->next;
+        --bin.count;
+        return node;
+    }
+
+    void free(void* ptr) {
+        if (!ptr) {
+            return;
+        }
+        mFreeCount.fetch_add(1, std::memory_order_relaxed);
+        Slab* slab = slabOf(ptr);
+        if (slab->classIndex == kLargeClass) {
+            AutoLockIf lock(mLock, mThreaded);
+            mBytesInUse.fetch_sub(slab->largeSize - kSlabHeaderSize,
+                                  std::memory_order_relaxed);
+            releaseSlab(slab, slab->largeSize);
+            return;
+        }
+        const uint32_t classIndex = slab->classIndex;
+        mBytesInUse.fetch_sub(mClasses[classIndex].size, std::memory_order_relaxed);
+
+        ThreadCache* cache = threadCache();
+        if (!cache) {
+            AutoLockIf lock(mLock, mThreaded);
+            freeToSlab(slab, ptr);
+            return;
+        }
+
+        ThreadCache::Bin& bin = cache->bins[classIndex];
+        auto node = static_cast<FreeNode*>(ptr);
+        node->next = bin.head;
+        bin.head = node;
+        if (++bin.count > mCacheLimit) {
+            AutoLock lock(mLock);
+            while (bin.count > mCacheLimit / 2) {
+                node = bin.head;
+                bin.head = node->next;
+                --bin.count;
+                freeToSlab(slabOf(node), node);
+            }
+        }
+    }
+
+    void freeAll() {
+        for (Slab* slab : mSlabs) {
+            aligned_buf_free(slab);
+        }
+        mSlabs.clear();
+        for (SizeClass& sizeClass : mClasses) {
+            sizeClass.partial = nullptr;
+        }
+        if (mThreaded) {
+            for (int i = 0; i < kMaxThreadSlots; ++i) {
+                if (ThreadCache* cache = mCaches[i].load(std::memory_order_relaxed)) {
+                    for (ThreadCache::Bin& bin : cache->bins) {
+                        bin = ThreadCache::Bin();
+                    }
+                }
+            }
+        }
+        mSlabCount.store(0, std::memory_order_relaxed);
+        mBytesReserved.store(0, std::memory_order_relaxed);
+        mBytesInUse.store(0, std::memory_order_relaxed);
+    }
+
+    Stats stats() const {
+        Stats stats;
+        stats.allocCount = mAllocCount.load(std::memory_order_relaxed);
+        stats.freeCount = mFreeCount.load(std::memory_order_relaxed);
+        stats.hitCount =
+            stats.allocCount - mMissCount.load(std::memory_order_relaxed);
+        stats.cacheHitCount = mCacheHitCount.load(std::memory_order_relaxed);
+        stats.largeAllocCount = mLargeAllocCount.load(std::memory_order_relaxed);
+        stats.slabCount = mSlabCount.load(std::memory_order_relaxed);
+        stats.bytesReserved = mBytesReserved.load(std::memory_order_relaxed);
+        stats.bytesInUse = mBytesInUse.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    struct SizeClass {
+        size_t size = 0;
+        // Slabs with free objects, most recently freed into first.
+        Slab* partial = nullptr;
+    };
+
+    struct ThreadCache {
+        struct Bin {
+            FreeNode* head = nullptr;
+            size_t count = 0;
+        };
+        std::vector<Bin> bins;
+    };
+
+    // Only locks in PerThreadCache mode.
+    class AutoLockIf {
+    public:
+        AutoLockIf(Lock& lock, bool enabled) : mLock(enabled ? &lock : nullptr) {
+            if (mLock) mLock->lock();
+        }
+        ~AutoLockIf() {
+            if (mLock) mLock->unlock();
+        }
+
+    private:
+        Lock* mLock;
+    };
+
+    uint32_t classIndexFor(size_t size) const {
+        if (size <= (size_t(1) << mMinShift)) {
+            return 0;
+        }
+        return floorLog2(size - 1) + 1 - mMinShift;
+    }
+
+    Slab* slabOf(void* ptr) const {
+        return reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(ptr) &
+                                       ~uintptr_t(mSlabSize - 1));
+    }
+
+    char* slabEnd(Slab* slab) const {
+        return reinterpret_cast<char*>(slab) + mSlabSize;
+    }
+
+    ThreadCache* threadCache() {
+        if (!mThreaded) {
+            return nullptr;
+        }
+        const int slot = tThreadSlot.index();
+        if (slot < 0) {
+            return nullptr;
+        }
+        ThreadCache* cache = mCaches[slot].load(std::memory_order_acquire);
+        if (!cache) {
+            // Only this thread ever installs the cache of its slot.
+            cache = new ThreadCache;
+            cache->bins.resize(mClasses.size());
+            mCaches[slot].store(cache, std::memory_order_release);
+        }
+        return cache;
+    }
+
+    void* allocLarge(size_t wantedSize) {
+        const size_t total = kSlabHeaderSize + wantedSize;
+        // Aligned like slabs so that free() finds the header the same way.
+        auto slab = static_cast<Slab*>(aligned_buf_alloc(mSlabSize, total));
+        slab->classIndex = kLargeClass;
+        slab->live = 1;
+        slab->inPartialList = false;
+        slab->freeList = nullptr;
+        slab->largeSize = total;
+        slab->prev = slab->next = nullptr;
+
+        mLargeAllocCount.fetch_add(1, std::memory_order_relaxed);
+        mMissCount.fetch_add(1, std::memory_order_relaxed);
+        mBytesInUse.fetch_add(wantedSize, std::memory_order_relaxed);
+        AutoLockIf lock(mLock, mThreaded);
+        addSlab(slab, total);
+        return reinterpret_cast<char*>(slab) + kSlabHeaderSize;
+    }
+
+    // Pool lock held. Sets |*grew| if a new slab was needed.
+    void* allocFromClass(uint32_t classIndex, bool* grew) {
+        SizeClass& sizeClass = mClasses[classIndex];
+        Slab* slab = sizeClass.partial;
+        if (!slab) {
+            slab = newSlab(classIndex);
+            *grew = true;
+        }
+
+        void* result;
+        if (slab->freeList) {
+            result = slab->freeList;
+            slab->freeList = slab->freeList->next;
+        } else {
+            result = slab->bump;
+            slab->bump += sizeClass.size;
+        }
+        ++slab->live;
+        if (!slab->freeList && slab->bump + sizeClass.size > slabEnd(slab)) {
+            unlinkPartial(slab);
+        }
+        return result;
+    }
+
+    // Pool lock held.
+    void freeToSlab(Slab* slab, void* ptr) {
+        auto node = static_cast<FreeNode*>(ptr);
+        node->next = slab->freeList;
+        slab->freeList = node;
+        --slab->live;
+        if (!slab->inPartialList) {
+            linkPartial(slab);
+        }
+        // Keep one empty slab around per class to avoid thrashing.
+        if (!slab->live && (slab->prev || slab->next)) {
+            unlinkPartial(slab);
+            releaseSlab(slab, mSlabSize);
+        }
+    }
+
+    Slab* newSlab(uint32_t classIndex) {
+        auto slab = static_cast<Slab*>(aligned_buf_alloc(mSlabSize, mSlabSize));
+        slab->classIndex = classIndex;
+        slab->live = 0;
+        slab->inPartialList = false;
+        slab->freeList = nullptr;
+        // Objects are aligned to their size, up to the header size.
+        slab->bump = reinterpret_cast<char*>(slab) +
+                     std::max(kSlabHeaderSize, mClasses[classIndex].size);
+        slab->prev = slab->next = nullptr;
+        addSlab(slab, mSlabSize);
+        mSlabCount.fetch_add(1, std::memory_order_relaxed);
+        linkPartial(slab);
+        return slab;
+    }
+
+    void addSlab(Slab* slab, size_t bytes) {
+        slab->slabIndex = mSlabs.size();
+        mSlabs.push_back(slab);
+        mBytesReserved.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void releaseSlab(Slab* slab, size_t bytes) {
+        Slab* last = mSlabs.back();
+        last->slabIndex = slab->slabIndex;
+        mSlabs[slab->slabIndex] = last;
+        mSlabs.pop_back();
+        if (slab->classIndex != kLargeClass) {
+            mSlabCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+        mBytesReserved.fetch_sub(bytes, std::memory_order_relaxed);
+        aligned_buf_free(slab);
+    }
+
+    void linkPartial(Slab* slab) {
+        SizeClass& sizeClass = mClasses[slab->classIndex];
+        slab->prev = nullptr;
+        slab->next = sizeClass.partial;
+        if (sizeClass.partial) {
+            sizeClass.partial->prev = slab;
+        }
+        sizeClass.partial = slab;
+        slab->inPartialList = true;
+    }
+
+    void unlinkPartial(Slab* slab) {
+        SizeClass& sizeClass = mClasses[slab->classIndex];
+        if (slab->prev) {
+            slab->prev->next = slab->next;
+        } else {
+            sizeClass.partial = slab->next;
+        }
+        if (slab->next) {
+            slab->next->prev = slab->prev;
+        }
+        slab->prev = slab->next = nullptr;
+        slab->inPartialList = false;
+    }
+
+    const bool mThreaded;
+    uint32_t mMinShift = 0;
+    size_t mMaxClassSize = 0;
+    size_t mSlabSize = 0;
+    size_t mCacheLimit = 0;
+    std::vector<SizeClass> mClasses;
+    // Every slab and large allocation.
+    std::vector<Slab*> mSlabs;
+    mutable Lock mLock;
+    std::unique_ptr<std::atomic<ThreadCache*>[]> mCaches;
+
+    std::atomic<uint64_t> mAllocCount{0};
+    std::atomic<uint64_t> mFreeCount{0};
+    // Allocations that needed a new slab or were large.
+    std::atomic<uint64_t> mMissCount{0};
+    std::atomic<uint64_t> mCacheHitCount{0};
+    std::atomic<uint64_t> mLargeAllocCount{0};
+    std::atomic<uint64_t> mSlabCount{0};
+    std::atomic<uint64_t> mBytesReserved{0};
+    std::atomic<uint64_t> mBytesInUse{0};
+};
+
+Pool::Pool(size_t minSize, size_t maxSize, size_t chunksPerSize,
+           Threading threading)
+    : mImpl(new Pool::Impl(minSize, maxSize, chunksPerSize, threading)) {}
+
+Pool::~Pool() {
+    delete mImpl;
+}
+
+void* Pool::alloc(size_t wantedSize) {
+    return mImpl->alloc(wantedSize);
+}
+
+void Pool::free(void* ptr) {
+    mImpl->free(ptr);
+}
+
+void Pool::freeAll() {
+    mImpl->freeAll();
+}
+
+Pool::Stats Pool::stats() const {
+    return mImpl->stats();
+}
+
+} // namespace base
+} // namespace android
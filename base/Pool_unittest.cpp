@@ -0,0 +1,188 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/Pool.h"
+
+#include "aemu/base/threads/FunctorThread.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace android {
+namespace base {
+
+struct Allocation {
+    unsigned char* ptr;
+    size_t size;
+    unsigned char fill;
+};
+
+static void fillAllocation(const Allocation& a) {
+    memset(a.ptr, a.fill, a.size);
+}
+
+static bool checkAllocation(const Allocation& a) {
+    for (size_t i = 0; i < a.size; ++i) {
+        if (a.ptr[i] != a.fill) return false;
+    }
+    return true;
+}
+
+// Test: allocations of all sizes, in and out of the pool's range, are usable
+// and don't overlap.
+TEST(Pool, Basic) {
+    Pool pool(8, 4096, 64);
+    std::vector<Allocation> allocations;
+    for (size_t size = 1; size <= 3 * 4096; size += 37) {
+        Allocation a = {static_cast<unsigned char*>(pool.alloc(size)), size,
+                        (unsigned char)allocations.size()};
+        ASSERT_NE(nullptr, a.ptr);
+        fillAllocation(a);
+        allocations.push_back(a);
+    }
+    for (const Allocation& a : allocations) {
+        EXPECT_TRUE(checkAllocation(a));
+    }
+    for (const Allocation& a : allocations) {
+        pool.free(a.ptr);
+    }
+
+    Pool::Stats stats = pool.stats();
+    EXPECT_EQ(allocations.size(), stats.allocCount);
+    EXPECT_EQ(allocations.size(), stats.freeCount);
+    EXPECT_GT(stats.largeAllocCount, 0u);
+    EXPECT_EQ(0u, stats.bytesInUse);
+}
+
+// Test: objects are aligned to their size class, up to 64 bytes.
+TEST(Pool, Alignment) {
+    Pool pool(4, 4096);
+    for (size_t size : {1, 8, 16, 24, 64, 100, 1000, 4096, 10000}) {
+        void* ptr = pool.alloc(size);
+        size_t sizeClass = 8;
+        while (sizeClass < size) sizeClass *= 2;
+        const size_t align = std::min<size_t>(64, sizeClass);
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) & (align - 1)) << size;
+        pool.free(ptr);
+    }
+}
+
+// Test: freed objects are reused, so a steady workload stops asking the
+// system for memory.
+TEST(Pool, ReusesFreedObjects) {
+    Pool pool(8, 1024, 256);
+    std::vector<void*> ptrs;
+    for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < 256; ++i) {
+            ptrs.push_back(pool.alloc(8 << (i % 8)));
+        }
+        for (void* ptr : ptrs) {
+            pool.free(ptr);
+        }
+        ptrs.clear();
+    }
+    Pool::Stats stats = pool.stats();
+    EXPECT_GT(stats.hitRate(), 0.99);
+    EXPECT_EQ(0u, stats.bytesInUse);
+    EXPECT_DOUBLE_EQ(1.0, stats.fragmentation());
+    EXPECT_LE(stats.slabCount, 8u);
+}
+
+// Test: empty slabs are given back, except for one per class.
+TEST(Pool, ReleasesEmptySlabs) {
+    Pool pool(64, 64);
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 100000; ++i) {
+        ptrs.push_back(pool.alloc(64));
+    }
+    const Pool::Stats full = pool.stats();
+    EXPECT_GT(full.slabCount, 50u);
+    EXPECT_LT(full.fragmentation(), 0.05);
+
+    std::shuffle(ptrs.begin(), ptrs.end(), std::default_random_engine(0));
+    for (void* ptr : ptrs) {
+        pool.free(ptr);
+    }
+    EXPECT_EQ(1u, pool.stats().slabCount);
+}
+
+// Test: freeAll() releases everything and the pool stays usable.
+TEST(Pool, FreeAll) {
+    Pool pool;
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 1000; ++i) {
+            memset(pool.alloc(i * 7 + 1), 0xab, i * 7 + 1);
+        }
+        pool.freeAll();
+        EXPECT_EQ(0u, pool.stats().bytesReserved);
+        EXPECT_EQ(0u, pool.stats().slabCount);
+    }
+}
+
+// Test: with per-thread caches, many threads can allocate and free at once,
+// including objects allocated by another thread.
+TEST(Pool, PerThreadCache) {
+    Pool pool(8, 4096, 1024, Pool::Threading::PerThreadCache);
+    constexpr int kThreads = 8;
+    constexpr int kAllocsPerThread = 20000;
+
+    std::vector<std::vector<Allocation>> handoff(kThreads);
+    std::vector<std::unique_ptr<FunctorThread>> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back(new FunctorThread([&pool, &handoff, t] {
+            std::default_random_engine generator(t);
+            std::vector<Allocation> live;
+            for (int i = 0; i < kAllocsPerThread; ++i) {
+                const size_t size = 1 + generator() % 5000;
+                Allocation a = {static_cast<unsigned char*>(pool.alloc(size)),
+                                size, (unsigned char)(t * 31 + i)};
+                fillAllocation(a);
+                live.push_back(a);
+                if (live.size() > 64) {
+                    const size_t index = generator() % live.size();
+                    EXPECT_TRUE(checkAllocation(live[index]));
+                    pool.free(live[index].ptr);
+                    live.erase(live.begin() + index);
+                }
+            }
+            handoff[t] = std::move(live);
+        }));
+    }
+    for (auto& thread : threads) {
+        thread->start();
+    }
+    for (auto& thread : threads) {
+        thread->wait();
+    }
+
+    // Free everything from another thread than the one that allocated it.
+    for (const auto& live : handoff) {
+        for (const Allocation& a : live) {
+            EXPECT_TRUE(checkAllocation(a));
+            pool.free(a.ptr);
+        }
+    }
+    Pool::Stats stats = pool.stats();
+    EXPECT_EQ(uint64_t(kThreads * kAllocsPerThread), stats.allocCount);
+    EXPECT_EQ(stats.allocCount, stats.freeCount);
+    EXPECT_EQ(0u, stats.bytesInUse);
+    EXPECT_GT(stats.cacheHitCount, 0u);
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,69 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/process/ProcessSpawn.h"
+
+#include "benchmark/benchmark.h"
+
+#ifndef _WIN32
+
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+namespace {
+
+using android::base::SpawnMethod;
+using android::base::SpawnOptions;
+using android::base::spawnProcess;
+
+// Launching `true` and waiting for it, with |rss_mb| of touched memory
+// mapped in the parent, standing in for guest RAM. fork() has to copy the
+// page tables for all of it; posix_spawn() shouldn't care.
+void BM_Spawn(benchmark::State& state) {
+    SpawnOptions options;
+    options.method = state.range(0) ? SpawnMethod::kFork : SpawnMethod::kPosixSpawn;
+    const size_t rss = size_t(state.range(1)) << 20;
+    void* mem = nullptr;
+    if (rss) {
+        mem = mmap(nullptr, rss, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            state.SkipWithError("can't map memory");
+            return;
+        }
+        memset(mem, 1, rss);
+    }
+    for (auto _ : state) {
+        auto pid = spawnProcess({"true"}, options);
+        if (!pid) {
+            state.SkipWithError("spawn failed");
+            break;
+        }
+        int status;
+        waitpid(*pid, &status, 0);
+    }
+    if (mem) {
+        munmap(mem, rss);
+    }
+}
+BENCHMARK(BM_Spawn)
+        ->ArgNames({"fork", "rss_mb"})
+        ->ArgsProduct({{0, 1}, {0, 256, 2048}})
+        ->UseRealTime()
+        ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+#endif  // !_WIN32
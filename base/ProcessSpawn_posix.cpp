@@ -0,0 +1,165 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/process/ProcessSpawn.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+
+#include <vector>
+
+extern char** environ;
+
+namespace android {
+namespace base {
+
+namespace {
+
+// Whether posix_spawn() here can close everything but the standard streams.
+#if defined(__APPLE__)
+#define SPAWN_CAN_CLOSE_OTHERS 1
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+#define SPAWN_CAN_CLOSE_OTHERS 1
+#else
+#define SPAWN_CAN_CLOSE_OTHERS 0
+#endif
+
+std::vector<char*> makeArgv(const CommandArguments& args) {
+    std::vector<char*> argv;
+    argv.reserve(args.size() + 1);
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    return argv;
+}
+
+bool canPosixSpawn(const SpawnOptions& options) {
+    if (!options.inherit && !SPAWN_CAN_CLOSE_OTHERS) {
+        return false;
+    }
+#ifndef POSIX_SPAWN_SETSID
+    if (options.newSession) {
+        return false;
+    }
+#endif
+    return true;
+}
+
+std::optional<Pid> posixSpawn(char* const* argv, const SpawnOptions& options) {
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_init(&attr);
+
+    const int streams[] = {options.stdinFd, options.stdoutFd, options.stderrFd};
+    for (int i = 0; i < 3; ++i) {
+        if (streams[i] >= 0 && streams[i] != i) {
+            posix_spawn_file_actions_adddup2(&actions, streams[i], i);
+        }
+    }
+
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+    if (!options.inherit) {
+#if defined(__APPLE__)
+        // Closes whatever the file actions don't mention.
+        flags |= POSIX_SPAWN_CLOEXEC_DEFAULT;
+        for (int i = 0; i < 3; ++i) {
+            if (streams[i] < 0 || streams[i] == i) {
+                posix_spawn_file_actions_addinherit_np(&actions, i);
+            }
+        }
+#elif SPAWN_CAN_CLOSE_OTHERS
+        posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+#endif
+    }
+#ifdef POSIX_SPAWN_SETSID
+    if (options.newSession) {
+        flags |= POSIX_SPAWN_SETSID;
+    }
+#endif
+    posix_spawnattr_setflags(&attr, flags);
+    sigset_t none;
+    sigemptyset(&none);
+    posix_spawnattr_setsigmask(&attr, &none);
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+
+    pid_t pid;
+    const int res = posix_spawnp(&pid, argv[0], &actions, &attr, argv, environ);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    if (res) {
+        errno = res;
+        return std::nullopt;
+    }
+    return pid;
+}
+
+std::optional<Pid> forkExec(char* const* argv, const SpawnOptions& options) {
+    // Worked out before forking: the child may only make async-signal-safe
+    // calls.
+    const int streams[] = {options.stdinFd, options.stdoutFd, options.stderrFd};
+    const long maxFd = sysconf(_SC_OPEN_MAX);
+
+    const pid_t pid = fork();
+    if (pid < 0) {
+        return std::nullopt;
+    }
+    if (pid > 0) {
+        return pid;
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        if (streams[i] >= 0 && streams[i] != i) {
+            dup2(streams[i], i);
+        }
+    }
+    if (!options.inherit) {
+        for (long fd = 3; fd < maxFd; ++fd) {
+            close(static_cast<int>(fd));
+        }
+    }
+    if (options.newSession) {
+        setsid();
+    }
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, nullptr);
+    signal(SIGPIPE, SIG_DFL);
+    execvp(argv[0], argv);
+    _exit(127);
+}
+
+}  // namespace
+
+std::optional<Pid> spawnProcess(const CommandArguments& args,
+                                const SpawnOptions& options) {
+    if (args.empty()) {
+        errno = EINVAL;
+        return std::nullopt;
+    }
+    const std::vector<char*> argv = makeArgv(args);
+    if (options.method == SpawnMethod::kPosixSpawn && canPosixSpawn(options)) {
+        return posixSpawn(argv.data(), options);
+    }
+    return forkExec(argv.data(), options);
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,119 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/process/ProcessSpawn.h"
+
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace android {
+namespace base {
+namespace {
+
+class ProcessSpawnTest : public ::testing::TestWithParam<SpawnMethod> {
+protected:
+    SpawnOptions options() const {
+        SpawnOptions options;
+        options.method = GetParam();
+        return options;
+    }
+};
+
+std::string readAll(int fd) {
+    std::string data;
+    char buf[256];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        data.append(buf, n);
+    }
+    return data;
+}
+
+int exitStatus(Pid pid) {
+    int status = 0;
+    EXPECT_EQ(pid, waitpid(pid, &status, 0));
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// Tests that stdout and stderr go where they are pointed, and the exit
+// status comes back.
+TEST_P(ProcessSpawnTest, RedirectsOutput) {
+    int out[2], err[2];
+    ASSERT_EQ(0, pipe(out));
+    ASSERT_EQ(0, pipe(err));
+    SpawnOptions opts = options();
+    opts.stdoutFd = out[1];
+    opts.stderrFd = err[1];
+    auto pid = spawnProcess({"sh", "-c", "echo hello; echo oops >&2; exit 3"}, opts);
+    close(out[1]);
+    close(err[1]);
+    ASSERT_TRUE(pid);
+    EXPECT_EQ("hello\n", readAll(out[0]));
+    EXPECT_EQ("oops\n", readAll(err[0]));
+    EXPECT_EQ(3, exitStatus(*pid));
+    close(out[0]);
+    close(err[0]);
+}
+
+// Tests that descriptors that aren't close-on-exec only reach the child
+// when asked for.
+TEST_P(ProcessSpawnTest, InheritsOnlyWhenAsked) {
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    const std::string test = "test -e /dev/fd/" + std::to_string(fds[1]);
+    for (bool inherit : {false, true}) {
+        SpawnOptions opts = options();
+        opts.inherit = inherit;
+        auto pid = spawnProcess({"sh", "-c", test}, opts);
+        ASSERT_TRUE(pid);
+        EXPECT_EQ(inherit ? 0 : 1, exitStatus(*pid)) << inherit;
+    }
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// Tests that a new session makes the child its leader.
+TEST_P(ProcessSpawnTest, NewSession) {
+    SpawnOptions opts = options();
+    opts.newSession = true;
+    auto pid = spawnProcess({"sh", "-c", "test $(ps -o sid= -p $$) -eq $$"}, opts);
+    ASSERT_TRUE(pid);
+    EXPECT_EQ(0, exitStatus(*pid));
+}
+
+INSTANTIATE_TEST_SUITE_P(Methods,
+                         ProcessSpawnTest,
+                         ::testing::Values(SpawnMethod::kPosixSpawn,
+                                           SpawnMethod::kFork));
+
+// Tests that posix_spawn() reports a missing program right away.
+TEST(ProcessSpawn, MissingProgram) {
+    EXPECT_FALSE(spawnProcess({"/nonexistent/program"}));
+    EXPECT_EQ(ENOENT, errno);
+    EXPECT_FALSE(spawnProcess({}));
+    EXPECT_EQ(EINVAL, errno);
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
+
+#endif  // !_WIN32
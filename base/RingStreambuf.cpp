@@ -30,22 +30,65 @@ RingStreambuf::RingStreambuf(uint32_t capacity, milliseconds timeout) : mTimeout
     mRingbuffer.resize(cap);
 }
 
+template <class Pred>
+bool RingStreambuf::waitLocked(std::unique_lock<std::mutex>& lock,
+                               AddressWaiter& waiter,
+                               milliseconds timeout,
+                               Pred pred) {
+    if (pred()) {
+        return true;
+    }
+    const bool forever = timeout == milliseconds::max();
+    const auto deadline = forever ? std::chrono::steady_clock::time_point::max()
+                                  : std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        uint64_t timeoutUs = kAddressWaitForever;
+        if (!forever) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                return false;
+            }
+            timeoutUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                                deadline - now)
+                                .count() +
+                        1;
+        }
+        // Announced while |pred| is known to be false under the lock, so a
+        // change made after we unlock always wakes us.
+        const uint32_t token = waiter.prepareWait();
+        lock.unlock();
+        waiter.wait(token, timeoutUs);
+        lock.lock();
+        if (pred()) {
+            return true;
+        }
+    }
+}
+
+void RingStreambuf::waitToOverwriteLocked(std::unique_lock<std::mutex>& lock,
+                                          std::streamsize n) {
+    waitLocked(lock, mCanWrite, milliseconds::max(), [this, n]() {
+        return mReaders == 0 || mClosed || n <= showmanyw();
+    });
+}
+
 void RingStreambuf::close() {
     {
         std::unique_lock<std::mutex> lock(mLock);
         mTimeout = std::chrono::milliseconds(0);
         mClosed = true;
     }
-    mCanRead.notify_all();
+    mCanRead.notify();
+    mCanWrite.notify();
 }
 
 std::streamsize RingStreambuf::xsputn(const char* s, std::streamsize n) {
     // Usually n >> 1..
-    mLock.lock();
+    std::unique_lock<std::mutex> lock(mLock);
     std::streamsize capacity = mRingbuffer.capacity();
 
+    waitToOverwriteLocked(lock, n);
     if (mClosed) {
-        mLock.unlock();
         return 0;
     }
 
@@ -56,8 +99,8 @@ std::streamsize RingStreambuf::xsputn(const char* s, std::streamsize n) {
         mHead = capacity;
         mTail = 0;
         mHeadOffset += n;
-        mLock.unlock();
-        mCanRead.notify_all();
+        lock.unlock();
+        mCanRead.notify();
         return n;
     }
 
@@ -91,8 +134,8 @@ std::streamsize RingStreambuf::xsputn(const char* s, std::streamsize n) {
     }
     if (updateTail) mTail = (mHead + 1) & (capacity - 1);
     mHeadOffset += n;
-    mLock.unlock();
-    mCanRead.notify_all();
+    lock.unlock();
+    mCanRead.notify();
     return n;
 }
 
@@ -102,7 +145,8 @@ int RingStreambuf::overflow(int c) {
 
 std::streamsize RingStreambuf::waitForAvailableSpace(std::streamsize n) {
     std::unique_lock<std::mutex> lock(mLock);
-    mCanRead.wait_for(lock, mTimeout, [this, n]() { return showmanyw() >= n || mClosed; });
+    waitLocked(lock, mCanWrite, mTimeout,
+               [this, n]() { return showmanyw() >= n || mClosed; });
     return showmanyw();
 }
 
@@ -122,7 +166,8 @@ std::streamsize RingStreambuf::showmanyc() {
 
 std::streamsize RingStreambuf::xsgetn(char* s, std::streamsize n) {
     std::unique_lock<std::mutex> lock(mLock);
-    if (!mCanRead.wait_for(lock, mTimeout, [this]() { return mTail != mHead; })) {
+    if (!waitLocked(lock, mCanRead, mTimeout,
+                    [this]() { return mTail != mHead; })) {
         return 0;
     }
     std::streamsize toRead = std::min(showmanyc(), n);
@@ -139,12 +184,15 @@ std::streamsize RingStreambuf::xsgetn(char* s, std::streamsize n) {
         memcpy(s, mRingbuffer.data() + mTail, toRead);
     }
     mTail = (mTail + toRead) & (capacity - 1);
+    lock.unlock();
+    mCanWrite.notify();
     return toRead;
 }
 
 int RingStreambuf::underflow() {
     std::unique_lock<std::mutex> lock(mLock);
-    if (!mCanRead.wait_for(lock, mTimeout, [this]() { return mTail != mHead || mClosed; })) {
+    if (!waitLocked(lock, mCanRead, mTimeout,
+                    [this]() { return mTail != mHead || mClosed; })) {
         return traits_type::eof();
     }
     if (mClosed && mTail == mHead) {
@@ -155,7 +203,8 @@ int RingStreambuf::underflow() {
 
 int RingStreambuf::uflow() {
     std::unique_lock<std::mutex> lock(mLock);
-    if (!mCanRead.wait_for(lock, mTimeout, [this]() { return mTail != mHead || mClosed; })) {
+    if (!waitLocked(lock, mCanRead, mTimeout,
+                    [this]() { return mTail != mHead || mClosed; })) {
         return traits_type::eof();
     }
     if (mClosed && mTail == mHead) {
@@ -165,17 +214,109 @@ int RingStreambuf::uflow() {
 
     int val = mRingbuffer[mTail];
     mTail = (mTail + 1) & (mRingbuffer.capacity() - 1);
+    lock.unlock();
+    mCanWrite.notify();
     return val;
 }
 
+RingStreambuf::ReadSpan RingStreambuf::acquireRead(size_t n) {
+    std::unique_lock<std::mutex> lock(mLock);
+    ReadSpan span;
+    if (!waitLocked(lock, mCanRead, mTimeout,
+                    [this]() { return mTail != mHead || mClosed; }) ||
+        mTail == mHead) {
+        span.offset = mHeadOffset;
+        return span;
+    }
+    const size_t available = showmanyc();
+    span.data = mRingbuffer.data() + mTail;
+    span.size = std::min({available, mRingbuffer.capacity() - mTail, n});
+    span.offset = mHeadOffset - available;
+    if (span.size) {
+        ++mReaders;
+    }
+    return span;
+}
+
+void RingStreambuf::releaseRead(size_t consumed) {
+    {
+        std::unique_lock<std::mutex> lock(mLock);
+        mTail = (mTail + consumed) & (mRingbuffer.capacity() - 1);
+        --mReaders;
+    }
+    mCanWrite.notify();
+}
+
+RingStreambuf::ReadSpan RingStreambuf::acquireReadAt(uint64_t offset,
+                                                     size_t n,
+                                                     milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mLock);
+    ReadSpan span;
+    span.offset = mHeadOffset;
+    if (!waitLocked(lock, mCanRead, timeout, [offset, this]() {
+            return offset < mHeadOffset || mClosed;
+        }) ||
+        offset >= mHeadOffset) {
+        span.offset = mHeadOffset;
+        return span;
+    }
+    const size_t available = showmanyc();
+    const uint64_t startOffset = mHeadOffset - available;
+    const size_t skip = std::max(startOffset, offset) - startOffset;
+    const size_t pos = (mTail + skip) & (mRingbuffer.capacity() - 1);
+    span.data = mRingbuffer.data() + pos;
+    span.size = std::min({available - skip, mRingbuffer.capacity() - pos, n});
+    span.offset = startOffset + skip;
+    if (span.size) {
+        ++mReaders;
+    }
+    return span;
+}
+
+void RingStreambuf::releaseReadAt() {
+    {
+        std::unique_lock<std::mutex> lock(mLock);
+        --mReaders;
+    }
+    mCanWrite.notify();
+}
+
+RingStreambuf::WriteSpan RingStreambuf::acquireWrite(size_t n) {
+    std::unique_lock<std::mutex> lock(mLock);
+    const size_t capacity = mRingbuffer.capacity();
+    WriteSpan span;
+    const size_t size = std::min({n, capacity - 1, capacity - mHead});
+    waitToOverwriteLocked(lock, size);
+    if (mClosed || !size) {
+        return span;
+    }
+    const size_t free = showmanyw();
+    if (size > free) {
+        // Drop the oldest bytes to make room, as xsputn() would.
+        mTail = (mTail + size - free) & (capacity - 1);
+    }
+    span.data = mRingbuffer.data() + mHead;
+    span.size = size;
+    return span;
+}
+
+void RingStreambuf::commitWrite(size_t written) {
+    {
+        std::unique_lock<std::mutex> lock(mLock);
+        mHead = (mHead + written) & (mRingbuffer.capacity() - 1);
+        mHeadOffset += written;
+    }
+    mCanRead.notify();
+}
+
 std::pair<int, std::string> RingStreambuf::bufferAtOffset(std::streamsize offset,
                                                           milliseconds timeoutMs) {
     std::unique_lock<std::mutex> lock(mLock);
     std::string res;
-    if (!mCanRead.wait_for(lock, timeoutMs, [offset, this]() { return offset < mHeadOffset; })) {
+    if (!waitLocked(lock, mCanRead, timeoutMs,
+                    [offset, this]() { return offset < mHeadOffset; })) {
         return std::make_pair(mHeadOffset, res);
     }
-
     // Prepare the outgoing buffer.
     std::streamsize capacity = mRingbuffer.capacity();
     std::streamsize toRead = showmanyc();
@@ -183,7 +324,7 @@ std::pair<int, std::string> RingStreambuf::bufferAtOffset(std::streamsize offset
     std::streamsize skip = std::max(startOffset, offset) - startOffset;
 
     // Let's find the starting point where we should be reading.
-    uint16_t read = (mTail + skip) & (capacity - 1);
+    uint32_t read = (mTail + skip) & (capacity - 1);
 
     // We are looking for an offset that is in the future...
     // Return the current start offset, without anything
@@ -13,6 +13,7 @@
 // limitations under the License.
 #include "aemu/base/streams/RingStreambuf.h"
 
+#include <atomic>
 #include <chrono>
 #include <istream>
 #include <ratio>
@@ -21,6 +22,8 @@
 
 #include <gtest/gtest.h>
 
+#include <string.h>
+
 namespace android {
 namespace base {
 namespace streams {
@@ -238,6 +241,88 @@ TEST(RingStreambuf, stream_offset_blocks_until_available) {
     reader.join();
 }
 
+TEST(RingStreambuf, read_span_consumes) {
+    RingStreambuf buf(7, 0ms);
+    std::ostream stream(&buf);
+    stream << "abcdef";
+
+    auto span = buf.acquireRead(4);
+    ASSERT_EQ(4u, span.size);
+    EXPECT_EQ(0u, span.offset);
+    EXPECT_EQ("abcd", std::string(span.data, span.size));
+    buf.releaseRead(4);
+
+    // Stops at the end of the ring; the rest comes in the next span.
+    stream << "ghij";
+    span = buf.acquireRead(100);
+    EXPECT_EQ(4u, span.offset);
+    EXPECT_EQ("efgh", std::string(span.data, span.size));
+    buf.releaseRead(span.size);
+    span = buf.acquireRead(100);
+    EXPECT_EQ(8u, span.offset);
+    EXPECT_EQ("ij", std::string(span.data, span.size));
+    buf.releaseRead(span.size);
+
+    EXPECT_EQ(0u, buf.acquireRead(100).size);
+}
+
+TEST(RingStreambuf, write_span_commits) {
+    RingStreambuf buf(7, 0ms);
+    auto span = buf.acquireWrite(3);
+    ASSERT_EQ(3u, span.size);
+    memcpy(span.data, "xyz", 3);
+    EXPECT_EQ(0, buf.in_avail());
+    buf.commitWrite(3);
+    EXPECT_EQ(3, buf.in_avail());
+
+    auto res = buf.bufferAtOffset(0);
+    EXPECT_EQ("xyz", res.second);
+    buf.close();
+    EXPECT_EQ(0u, buf.acquireWrite(3).size);
+}
+
+TEST(RingStreambuf, read_spans_at_offset_broadcast) {
+    RingStreambuf buf(15);
+    std::ostream stream(&buf);
+    stream << "hello";
+
+    // Two readers see the same bytes; neither consumes them.
+    for (int reader = 0; reader < 2; ++reader) {
+        auto span = buf.acquireReadAt(1, 100);
+        EXPECT_EQ(1u, span.offset);
+        EXPECT_EQ("ello", std::string(span.data, span.size));
+        buf.releaseReadAt();
+    }
+    EXPECT_EQ(5, buf.in_avail());
+
+    auto none = buf.acquireReadAt(5, 100);
+    EXPECT_EQ(0u, none.size);
+    EXPECT_EQ(5u, none.offset);
+}
+
+TEST(RingStreambuf, writer_waits_for_held_span) {
+    RingStreambuf buf(7);
+    std::ostream stream(&buf);
+    stream << "1234567";
+    auto span = buf.acquireReadAt(0, 100);
+    ASSERT_EQ(7u, span.size);
+
+    std::atomic<bool> written{false};
+    std::thread writer([&] {
+        stream << "89";
+        stream.flush();
+        written = true;
+    });
+    std::this_thread::sleep_for(50ms);
+    // Overwriting would clobber the span; the writer holds off.
+    EXPECT_FALSE(written);
+    EXPECT_EQ("1234567", std::string(span.data, span.size));
+    buf.releaseReadAt();
+    writer.join();
+    EXPECT_TRUE(written);
+    EXPECT_EQ("3456789", buf.bufferAtOffset(0).second);
+}
+
 }  // namespace streams
 }  // namespace base
 }  // namespace android
@@ -0,0 +1,79 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/synchronization/Event.h"
+#include "aemu/base/synchronization/MessageChannel.h"
+#include "aemu/base/synchronization/Semaphore.h"
+
+#include "benchmark/benchmark.h"
+
+#include <thread>
+
+namespace android {
+namespace base {
+namespace {
+
+// What Event used to be.
+class ChannelEvent {
+public:
+    void wait() {
+        int res;
+        mChannel.receive(&res);
+    }
+    void signal() { mChannel.trySend(0); }
+
+private:
+    MessageChannel<int, 1> mChannel;
+};
+
+// Signal and take with nobody asleep: no system calls.
+void BM_Semaphore_Uncontended(benchmark::State& state) {
+    Semaphore sem;
+    for (auto _ : state) {
+        sem.signal();
+        benchmark::DoNotOptimize(sem.tryWait());
+    }
+}
+BENCHMARK(BM_Semaphore_Uncontended);
+
+// A round trip between two threads, so every wait sleeps.
+template <class EventType>
+void BM_Event_PingPong(benchmark::State& state) {
+    EventType ping;
+    EventType pong;
+    std::atomic<bool> done{false};
+    std::thread other([&]() {
+        while (true) {
+            ping.wait();
+            if (done.load(std::memory_order_acquire)) {
+                break;
+            }
+            pong.signal();
+        }
+    });
+    for (auto _ : state) {
+        ping.signal();
+        pong.wait();
+    }
+    done.store(true, std::memory_order_release);
+    ping.signal();
+    other.join();
+}
+BENCHMARK_TEMPLATE(BM_Event_PingPong, Event)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Event_PingPong, ChannelEvent)->UseRealTime();
+
+}  // namespace
+}  // namespace base
+}  // namespace android
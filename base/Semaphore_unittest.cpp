@@ -0,0 +1,99 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/synchronization/Semaphore.h"
+
+#include "aemu/base/synchronization/Event.h"
+#include "aemu/base/system/System.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace base {
+
+TEST(Semaphore, Counts) {
+    Semaphore sem(2);
+    EXPECT_TRUE(sem.tryWait());
+    EXPECT_TRUE(sem.tryWait());
+    EXPECT_FALSE(sem.tryWait());
+    sem.signal(3);
+    EXPECT_EQ(3u, sem.count());
+    EXPECT_TRUE(sem.timedWait(0));
+}
+
+TEST(Semaphore, Saturates) {
+    BasicSemaphore<1> sem;
+    sem.signal();
+    sem.signal();
+    EXPECT_EQ(1u, sem.count());
+    EXPECT_TRUE(sem.tryWait());
+    EXPECT_FALSE(sem.tryWait());
+}
+
+TEST(Semaphore, TimedWaitExpires) {
+    Semaphore sem;
+    const uint64_t start = getUnixTimeUs();
+    EXPECT_FALSE(sem.timedWait(start + 20000));
+    EXPECT_GE(getUnixTimeUs(), start + 20000);
+}
+
+// Tests that every signal lets exactly one waiter through.
+TEST(Semaphore, WakesWaiters) {
+    constexpr int kThreads = 4;
+    constexpr int kRounds = 1000;
+    Semaphore sem;
+    std::atomic<int> taken{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&sem, &taken]() {
+            for (int r = 0; r < kRounds; ++r) {
+                sem.wait();
+                taken.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (int i = 0; i < kThreads * kRounds; ++i) {
+        sem.signal();
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(kThreads * kRounds, taken.load());
+    EXPECT_EQ(0u, sem.count());
+}
+
+TEST(Event, PingPong) {
+    Event ping;
+    Event pong;
+    std::thread other([&ping, &pong]() {
+        for (int i = 0; i < 1000; ++i) {
+            ping.wait();
+            pong.signal();
+        }
+    });
+    for (int i = 0; i < 1000; ++i) {
+        ping.signal();
+        pong.wait();
+    }
+    other.join();
+    EXPECT_FALSE(pong.timedWait(getUnixTimeUs() + 1000));
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,159 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/ShardedCounter.h"
+
+#include "aemu/base/synchronization/Lock.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace android {
+namespace base {
+
+namespace {
+
+constexpr size_t kCacheLine = 64;
+constexpr size_t kCountsPerLine = kCacheLine / sizeof(int64_t);
+
+struct alignas(kCacheLine) Line {
+    std::atomic<int64_t> counts[kCountsPerLine];
+};
+
+StaticLock sLock;
+uint64_t sNextId = 1;
+
+// Ids of the counters not destroyed yet, so that an exiting thread only
+// touches shards that still exist.
+std::unordered_set<uint64_t>& liveIds() {
+    static std::unordered_set<uint64_t>* const sIds = new std::unordered_set<uint64_t>();
+    return *sIds;
+}
+
+uint64_t registerCounter() {
+    AutoLock lock(sLock);
+    const uint64_t id = sNextId++;
+    liveIds().insert(id);
+    return id;
+}
+
+}  // namespace
+
+struct ShardedCounter::Shard {
+    // Whole lines, so no other shard shares the last one.
+    std::unique_ptr<Line[]> lines;
+    // Only touched by the owning thread.
+    uint32_t countdown = kRefreshInterval;
+
+    std::atomic<int64_t>* counts() {
+        return reinterpret_cast<std::atomic<int64_t>*>(lines.get());
+    }
+};
+
+// The shards the calling thread owns; retires them when the thread exits.
+struct ShardedCounterThreadState {
+    struct Ref {
+        uint64_t id;
+        ShardedCounter* owner;
+        ShardedCounter::Shard* shard;
+    };
+
+    ~ShardedCounterThreadState() {
+        AutoLock lock(sLock);
+        for (const Ref& ref : refs) {
+            if (liveIds().count(ref.id)) {
+                ShardedCounter* owner = ref.owner;
+                std::atomic<int64_t>* counts = ref.shard->counts();
+                for (size_t i = 0; i < owner->mSlots; ++i) {
+                    owner->mRetired[i] += counts[i].load(std::memory_order_relaxed);
+                }
+                owner->mShards.erase(
+                    std::find_if(owner->mShards.begin(), owner->mShards.end(),
+                                 [&ref](const std::unique_ptr<ShardedCounter::Shard>& s) {
+                                     return s.get() == ref.shard;
+                                 }));
+            }
+        }
+    }
+
+    std::vector<Ref> refs;
+};
+
+namespace {
+
+thread_local ShardedCounterThreadState tState;
+
+}  // namespace
+
+ShardedCounter::ShardedCounter(size_t slots)
+    : mSlots(slots), mId(registerCounter()), mRetired(slots, 0) {}
+
+ShardedCounter::~ShardedCounter() {
+    AutoLock lock(sLock);
+    liveIds().erase(mId);
+    // Threads still holding refs to mShards never match mId again.
+}
+
+std::atomic<int64_t>* ShardedCounter::threadShard(uint32_t** countdown) {
+    std::vector<ShardedCounterThreadState::Ref>& refs = tState.refs;
+    for (const ShardedCounterThreadState::Ref& ref : refs) {
+        if (ref.id == mId) {
+            *countdown = &ref.shard->countdown;
+            return ref.shard->counts();
+        }
+    }
+
+    std::unique_ptr<Shard> shard = newShard();
+    Shard* const raw = shard.get();
+    {
+        AutoLock lock(sLock);
+        // Drop refs to counters destroyed since, while the lock is held.
+        refs.erase(std::remove_if(refs.begin(), refs.end(),
+                                  [](const ShardedCounterThreadState::Ref& ref) {
+                                      return !liveIds().count(ref.id);
+                                  }),
+                   refs.end());
+        mShards.push_back(std::move(shard));
+    }
+    refs.push_back({mId, this, raw});
+    *countdown = &raw->countdown;
+    return raw->counts();
+}
+
+std::unique_ptr<ShardedCounter::Shard> ShardedCounter::newShard() {
+    std::unique_ptr<Shard> shard(new Shard());
+    const size_t lines = std::max<size_t>(1, (mSlots + kCountsPerLine - 1) / kCountsPerLine);
+    shard->lines.reset(new Line[lines]);
+    std::atomic<int64_t>* counts = shard->counts();
+    for (size_t i = 0; i < lines * kCountsPerLine; ++i) {
+        counts[i].store(0, std::memory_order_relaxed);
+    }
+    return shard;
+}
+
+std::vector<int64_t> ShardedCounter::sum() const {
+    AutoLock lock(sLock);
+    std::vector<int64_t> totals = mRetired;
+    for (const std::unique_ptr<Shard>& shard : mShards) {
+        std::atomic<int64_t>* counts = shard->counts();
+        for (size_t i = 0; i < mSlots; ++i) {
+            totals[i] += counts[i].load(std::memory_order_relaxed);
+        }
+    }
+    return totals;
+}
+
+}  // namespace base
+}  // namespace android
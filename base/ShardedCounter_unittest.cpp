@@ -0,0 +1,105 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/ShardedCounter.h"
+
+#include "aemu/base/GraphicsObjectCounter.h"
+#include "aemu/base/synchronization/Event.h"
+#include "aemu/base/threads/FunctorThread.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+namespace android {
+namespace base {
+
+// Tests that updates from many threads all land in the sums, both while the
+// threads run and after they exit.
+TEST(ShardedCounter, SumsAcrossThreads) {
+    ShardedCounter counter(3);
+    constexpr int kThreads = 4;
+    constexpr int kUpdates = 10000;
+
+    std::vector<std::unique_ptr<FunctorThread>> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back(new FunctorThread([&counter] {
+            for (int i = 0; i < kUpdates; ++i) {
+                counter.add(0, 1);
+                counter.add(2, -2);
+            }
+            return intptr_t(0);
+        }));
+        threads.back()->start();
+    }
+    counter.add(1, 5);
+    for (auto& thread : threads) {
+        thread->wait();
+    }
+
+    EXPECT_EQ((std::vector<int64_t>{kThreads * kUpdates, 5, -2 * kThreads * kUpdates}),
+              counter.sum());
+}
+
+// Tests that add() asks for a refresh once per interval on each thread.
+TEST(ShardedCounter, RefreshInterval) {
+    ShardedCounter counter(1);
+    int refreshes = 0;
+    for (uint32_t i = 0; i < 3 * ShardedCounter::kRefreshInterval; ++i) {
+        refreshes += counter.add(0, 1);
+    }
+    EXPECT_EQ(3, refreshes);
+}
+
+// Tests that a thread that used a counter can exit after it is gone, and
+// that a new counter at the same address starts from zero.
+TEST(ShardedCounter, OutlivedByThread) {
+    Event added;
+    Event destroyed;
+    std::unique_ptr<ShardedCounter> counter(new ShardedCounter(1));
+    FunctorThread thread([&counter, &added, &destroyed] {
+        counter->add(0, 7);
+        added.signal();
+        destroyed.wait();
+        return intptr_t(0);
+    });
+    thread.start();
+    added.wait();
+    EXPECT_EQ(7, counter->sum()[0]);
+
+    counter.reset();
+    counter.reset(new ShardedCounter(1));
+    destroyed.signal();
+    thread.wait();
+
+    counter->add(0, 1);
+    EXPECT_EQ(1, counter->sum()[0]);
+}
+
+// Tests the counts GraphicsObjectCounter keeps on top of it.
+TEST(ShardedCounter, GraphicsObjectCounter) {
+    GraphicsObjectCounter counter;
+    const size_t colorBuffer = toIndex(GraphicsObjectType::COLORBUFFER);
+    counter.incCount(colorBuffer);
+    counter.incCount(colorBuffer);
+    counter.decCount(colorBuffer);
+    counter.incCount(toIndex(GraphicsObjectType::NUM_OBJECT_TYPES));
+    EXPECT_EQ(1u, counter.getCounts()[colorBuffer]);
+    EXPECT_EQ("ColorBuffer: 1", counter.printUsage());
+}
+
+}  // namespace base
+}  // namespace android
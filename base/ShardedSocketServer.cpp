@@ -0,0 +1,376 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/async/ShardedSocketServer.h"
+
+#include "aemu/base/async/Looper.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <atomic>
+
+#ifdef _WIN32
+#include "aemu/base/sockets/Winsock.h"
+#else
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace android {
+namespace base {
+
+namespace {
+
+// A burst of connections shouldn't keep a shard's looper from its
+// established ones; the watch fires again for the rest.
+constexpr int kMaxAcceptsPerWake = 64;
+
+void closeSocket(int fd) {
+#ifdef _WIN32
+    ::closesocket(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+bool setNonBlocking(int fd) {
+#ifdef _WIN32
+    u_long on = 1;
+    return ::ioctlsocket(fd, FIONBIO, &on) == 0;
+#else
+    const int flags = ::fcntl(fd, F_GETFL);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+// Returns a non-blocking socket listening on loopback |port| of |family|,
+// or -1.
+int listenLoopback(int family, int port, bool reusePort) {
+    const int fd = static_cast<int>(::socket(family, SOCK_STREAM, 0));
+    if (fd < 0) {
+        return -1;
+    }
+    const int one = 1;
+#ifndef _WIN32
+    // On Windows this would let another process steal the port.
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+#endif
+#if defined(__linux__) && defined(SO_REUSEPORT)
+    if (reusePort &&
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (const char*)&one, sizeof(one))) {
+        closeSocket(fd);
+        return -1;
+    }
+#else
+    (void)reusePort;
+#endif
+
+    struct sockaddr_storage addr;
+    memset(&addr, 0, sizeof(addr));
+    socklen_t len;
+    if (family == AF_INET) {
+        auto* in = reinterpret_cast<struct sockaddr_in*>(&addr);
+        in->sin_family = AF_INET;
+        in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        in->sin_port = htons(static_cast<uint16_t>(port));
+        len = sizeof(*in);
+    } else {
+        // So that the IPv4 socket can have the same port.
+        ::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&one, sizeof(one));
+        auto* in6 = reinterpret_cast<struct sockaddr_in6*>(&addr);
+        in6->sin6_family = AF_INET6;
+        in6->sin6_addr = in6addr_loopback;
+        in6->sin6_port = htons(static_cast<uint16_t>(port));
+        len = sizeof(*in6);
+    }
+    if (::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), len) ||
+        ::listen(fd, SOMAXCONN) || !setNonBlocking(fd)) {
+        closeSocket(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int boundPort(int fd) {
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    if (::getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len)) {
+        return 0;
+    }
+    if (addr.ss_family == AF_INET) {
+        return ntohs(reinterpret_cast<struct sockaddr_in*>(&addr)->sin_port);
+    }
+    return ntohs(reinterpret_cast<struct sockaddr_in6*>(&addr)->sin6_port);
+}
+
+void runOn(Looper* looper, Looper::TaskCallback&& callback) {
+    if (looper->onLooperThread()) {
+        callback();
+    } else {
+        looper->scheduleCallback(std::move(callback));
+    }
+}
+
+}  // namespace
+
+struct ShardedSocketServer::State : std::enable_shared_from_this<State> {
+    struct Shard {
+        Looper* looper;
+        State* state;
+        // Only touched on |looper|'s thread once the server exists.
+        std::vector<int> listeners;
+        std::vector<std::unique_ptr<Looper::FdWatch>> watches;
+        std::atomic<int> load{0};
+    };
+
+    ShardedConnectCallback callback;
+    std::vector<std::unique_ptr<Shard>> shards;
+    int port = 0;
+    LoopbackMode mode = kNone;
+    bool reusePort = false;
+    std::atomic<bool> closed{false};
+
+    ~State() {
+        // Only a server that failed to start still has listeners here.
+        for (auto& shard : shards) {
+            for (int fd : shard->listeners) {
+                closeSocket(fd);
+            }
+        }
+    }
+
+    static void onAccept(void* opaque, int fd, unsigned events) {
+        (void)events;
+        Shard* shard = static_cast<Shard*>(opaque);
+        shard->state->accept(shard, fd);
+    }
+
+    void accept(Shard* shard, int listener) {
+        for (int i = 0; i < kMaxAcceptsPerWake; ++i) {
+            const int socket = static_cast<int>(::accept(listener, nullptr, nullptr));
+            if (socket < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                return;
+            }
+            if (closed) {
+                closeSocket(socket);
+                continue;
+            }
+            Shard* target = pick(shard);
+            ++target->load;
+            if (target == shard) {
+                deliver(target, socket);
+            } else {
+                auto self = shared_from_this();
+                target->looper->scheduleCallback(
+                        [self, target, socket] { self->deliver(target, socket); });
+            }
+        }
+    }
+
+    // Other shards pick at the same time, so loads are only a hint.
+    Shard* pick(Shard* accepting) {
+        Shard* least = shards[0].get();
+        for (auto& shard : shards) {
+            if (shard->load < least->load) {
+                least = shard.get();
+            }
+        }
+        if (reusePort && accepting->load <= least->load + kRebalanceSlack) {
+            return accepting;
+        }
+        return least;
+    }
+
+    void deliver(Shard* shard, int socket) {
+        if (closed || !callback(socket, shard->looper)) {
+            --shard->load;
+            closeSocket(socket);
+        }
+    }
+};
+
+// static
+std::unique_ptr<ShardedSocketServer> ShardedSocketServer::create(
+        int port,
+        ShardedConnectCallback connectCallback,
+        std::vector<Looper*> loopers,
+        LoopbackMode mode,
+        bool reusePort) {
+    if (loopers.empty()) {
+        return {};
+    }
+    auto state = std::make_shared<State>();
+    state->callback = std::move(connectCallback);
+    state->port = port;
+    for (Looper* looper : loopers) {
+        state->shards.emplace_back(new State::Shard{looper, state.get()});
+    }
+#if defined(__linux__) && defined(SO_REUSEPORT)
+    state->reusePort = reusePort && loopers.size() > 1;
+#else
+    (void)reusePort;
+#endif
+
+    struct Family {
+        int family;
+        int wanted;
+        int optional;
+        LoopbackMode bound;
+    };
+    const Family kFamilies[] = {
+            {AF_INET, kIPv4 | kIPv4Optional, kIPv4Optional, kIPv4},
+            {AF_INET6, kIPv6 | kIPv6Optional, kIPv6Optional, kIPv6},
+    };
+    std::vector<int> families;
+    int bound = kNone;
+    for (const Family& f : kFamilies) {
+        if (!(mode & f.wanted)) {
+            continue;
+        }
+        const int fd = listenLoopback(f.family, state->port, state->reusePort);
+        if (fd < 0) {
+            if (mode & f.optional) {
+                continue;
+            }
+            return {};
+        }
+        if (!state->port) {
+            state->port = boundPort(fd);
+        }
+        state->shards[0]->listeners.push_back(fd);
+        families.push_back(f.family);
+        bound |= f.bound;
+    }
+    if (bound == kNone) {
+        return {};
+    }
+    state->mode = static_cast<LoopbackMode>(bound);
+
+    // Either every shard listens, or only the first one does.
+    for (size_t i = 1; i < state->shards.size() && state->reusePort; ++i) {
+        for (int family : families) {
+            const int fd = listenLoopback(family, state->port, true);
+            if (fd < 0) {
+                state->reusePort = false;
+                break;
+            }
+            state->shards[i]->listeners.push_back(fd);
+        }
+    }
+    if (!state->reusePort) {
+        for (size_t i = 1; i < state->shards.size(); ++i) {
+            for (int fd : state->shards[i]->listeners) {
+                closeSocket(fd);
+            }
+            state->shards[i]->listeners.clear();
+        }
+    }
+    return std::unique_ptr<ShardedSocketServer>(
+            new ShardedSocketServer(std::move(state)));
+}
+
+ShardedSocketServer::ShardedSocketServer(std::shared_ptr<State> state)
+    : mState(std::move(state)) {}
+
+ShardedSocketServer::~ShardedSocketServer() {
+    mState->closed = true;
+    for (auto& shard : mState->shards) {
+        if (shard->listeners.empty()) {
+            continue;
+        }
+        State::Shard* s = shard.get();
+        runOn(s->looper, [state = mState, s] {
+            s->watches.clear();
+            for (int fd : s->listeners) {
+                closeSocket(fd);
+            }
+            s->listeners.clear();
+        });
+    }
+}
+
+int ShardedSocketServer::port() const {
+    return mState->port;
+}
+
+void ShardedSocketServer::startListening() {
+    for (auto& shard : mState->shards) {
+        if (shard->listeners.empty()) {
+            continue;
+        }
+        State::Shard* s = shard.get();
+        runOn(s->looper, [state = mState, s] {
+            if (state->closed) {
+                return;
+            }
+            if (s->watches.empty()) {
+                for (int fd : s->listeners) {
+                    s->watches.emplace_back(
+                            s->looper->createFdWatch(fd, &State::onAccept, s));
+                }
+            }
+            for (auto& watch : s->watches) {
+                watch->wantRead();
+            }
+        });
+    }
+}
+
+void ShardedSocketServer::stopListening() {
+    for (auto& shard : mState->shards) {
+        if (shard->listeners.empty()) {
+            continue;
+        }
+        State::Shard* s = shard.get();
+        runOn(s->looper, [state = mState, s] {
+            for (auto& watch : s->watches) {
+                watch->dontWantRead();
+            }
+        });
+    }
+}
+
+AsyncSocketServer::LoopbackMode ShardedSocketServer::getListenMode() const {
+    return mState->mode;
+}
+
+bool ShardedSocketServer::reusePort() const {
+    return mState->reusePort;
+}
+
+void ShardedSocketServer::connectionClosed(Looper* looper) {
+    for (auto& shard : mState->shards) {
+        if (shard->looper == looper) {
+            --shard->load;
+            return;
+        }
+    }
+}
+
+std::vector<int> ShardedSocketServer::load() const {
+    std::vector<int> loads;
+    for (const auto& shard : mState->shards) {
+        loads.push_back(shard->load);
+    }
+    return loads;
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,232 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/async/ShardedSocketServer.h"
+
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+
+#include "aemu/base/async/EventLooper.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+// EventLoopers, each made and run on its own thread.
+class LooperThreads {
+public:
+    explicit LooperThreads(int count) {
+        for (int i = 0; i < count; ++i) {
+            std::promise<Looper*> made;
+            auto future = made.get_future();
+            mThreads.emplace_back([this, &made] {
+                EventLooper looper;
+                made.set_value(&looper);
+                while (!mStop) {
+                    looper.runWithTimeoutMs(5);
+                }
+                // Whatever the server left to clean up.
+                looper.runWithTimeoutMs(0);
+            });
+            loopers.push_back(future.get());
+        }
+    }
+
+    ~LooperThreads() {
+        mStop = true;
+        for (auto& thread : mThreads) {
+            thread.join();
+        }
+    }
+
+    std::vector<Looper*> loopers;
+
+private:
+    std::atomic<bool> mStop{false};
+    std::vector<std::thread> mThreads;
+};
+
+int connectTo(int port) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (::connect(fd, (struct sockaddr*)&addr, sizeof(addr))) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Counts connections; keeps them open until destroyed.
+struct Accepted {
+    std::mutex lock;
+    std::vector<int> sockets;
+    std::atomic<int> onWrongThread{0};
+
+    ShardedSocketServer::ShardedConnectCallback callback() {
+        return [this](int socket, Looper* looper) {
+            if (!looper->onLooperThread()) {
+                ++onWrongThread;
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            sockets.push_back(socket);
+            return true;
+        };
+    }
+
+    bool waitFor(size_t count) {
+        for (int i = 0; i < 1000; ++i) {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (sockets.size() >= count) {
+                    return sockets.size() == count;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        return false;
+    }
+
+    ~Accepted() {
+        for (int fd : sockets) {
+            ::close(fd);
+        }
+    }
+};
+
+void connectMany(int port, int count, std::vector<int>* clients) {
+    for (int i = 0; i < count; ++i) {
+        const int fd = connectTo(port);
+        ASSERT_GE(fd, 0);
+        clients->push_back(fd);
+    }
+}
+
+// Tests that with one accepting shard, connections go round to the least
+// loaded looper, and run their callback there.
+TEST(ShardedSocketServer, HandsOffByLoad) {
+    LooperThreads threads(4);
+    Accepted accepted;
+    auto server = ShardedSocketServer::create(0, accepted.callback(),
+                                              threads.loopers,
+                                              AsyncSocketServer::kIPv4, false);
+    ASSERT_TRUE(server);
+    EXPECT_FALSE(server->reusePort());
+    EXPECT_EQ(AsyncSocketServer::kIPv4, server->getListenMode());
+    server->startListening();
+
+    std::vector<int> clients;
+    connectMany(server->port(), 40, &clients);
+    ASSERT_TRUE(accepted.waitFor(40));
+    EXPECT_EQ(0, accepted.onWrongThread);
+    EXPECT_EQ((std::vector<int>{10, 10, 10, 10}), server->load());
+
+    // New connections fill in where others ended.
+    server->connectionClosed(threads.loopers[2]);
+    server->connectionClosed(threads.loopers[2]);
+    EXPECT_EQ((std::vector<int>{10, 10, 8, 10}), server->load());
+    connectMany(server->port(), 2, &clients);
+    ASSERT_TRUE(accepted.waitFor(42));
+    EXPECT_EQ((std::vector<int>{10, 10, 10, 10}), server->load());
+
+    server.reset();
+    for (int fd : clients) {
+        ::close(fd);
+    }
+}
+
+#ifdef __linux__
+// Tests that with SO_REUSEPORT every shard listens on the same port, and
+// that no shard runs far ahead of the others.
+TEST(ShardedSocketServer, ReusePort) {
+    LooperThreads threads(4);
+    Accepted accepted;
+    auto server = ShardedSocketServer::create(0, accepted.callback(),
+                                              threads.loopers,
+                                              AsyncSocketServer::kIPv4);
+    ASSERT_TRUE(server);
+    EXPECT_TRUE(server->reusePort());
+    server->startListening();
+
+    std::vector<int> clients;
+    connectMany(server->port(), 80, &clients);
+    ASSERT_TRUE(accepted.waitFor(80));
+    EXPECT_EQ(0, accepted.onWrongThread);
+    const std::vector<int> load = server->load();
+    const auto minmax = std::minmax_element(load.begin(), load.end());
+    EXPECT_GT(*minmax.first, 0);
+    EXPECT_LE(*minmax.second - *minmax.first,
+              2 * ShardedSocketServer::kRebalanceSlack);
+
+    server.reset();
+    for (int fd : clients) {
+        ::close(fd);
+    }
+}
+#endif  // __linux__
+
+// Tests that a rejected connection is closed and doesn't count, and that
+// nothing is accepted after stopListening().
+TEST(ShardedSocketServer, RejectAndStop) {
+    LooperThreads threads(2);
+    std::atomic<int> calls{0};
+    auto server = ShardedSocketServer::create(
+            0, [&calls](int, Looper*) { return ++calls > 1; }, threads.loopers,
+            AsyncSocketServer::kIPv4, false);
+    ASSERT_TRUE(server);
+    server->startListening();
+
+    const int rejected = connectTo(server->port());
+    ASSERT_GE(rejected, 0);
+    char c;
+    EXPECT_EQ(0, ::read(rejected, &c, 1));  // closed by the server
+    EXPECT_EQ((std::vector<int>{0, 0}), server->load());
+    ::close(rejected);
+
+    server->stopListening();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const int queued = connectTo(server->port());  // into the backlog
+    ASSERT_GE(queued, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(1, calls);
+    server->startListening();
+    for (int i = 0; i < 500 && calls < 2; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    EXPECT_EQ(2, calls);
+    server.reset();
+    ::close(queued);
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
+
+#endif  // !_WIN32
@@ -22,12 +22,16 @@
 #include <vector>
 
 #include "aemu/base/files/PathUtils.h"
+#include "aemu/base/synchronization/Lock.h"
 #include "host-common/logging.h"
 
 #ifndef _WIN32
 #include <dlfcn.h>
 #include <stdlib.h>
 #endif
+#ifdef __linux__
+#include <link.h>
+#endif
 
 using android::base::PathUtils;
 
@@ -57,8 +61,74 @@ LibrarySearchPaths* sSearchPaths() {
     return paths;
 }
 
+// Library names mapped to the file that opened them, kept in a text file
+// of "<name>\t<path>" lines.
+class LibraryPathCache {
+public:
+    void setFile(const char* file) {
+        mPaths.clear();
+        mFile = file ? file : "";
+        if (mFile.empty()) {
+            return;
+        }
+        FILE* f = fopen(mFile.c_str(), "r");
+        if (!f) {
+            return;
+        }
+        char line[4096];
+        while (fgets(line, sizeof(line), f)) {
+            char* tab = strchr(line, '\t');
+            char* end = strchr(line, '\n');
+            if (!tab || !end) {
+                continue;
+            }
+            *tab = '\0';
+            *end = '\0';
+            mPaths[line] = tab + 1;
+        }
+        fclose(f);
+    }
+
+    const std::string* find(const char* name) const {
+        auto it = mPaths.find(name);
+        return it == mPaths.end() ? nullptr : &it->second;
+    }
+
+    void record(const char* name, const std::string& path) {
+        if (mFile.empty()) {
+            return;
+        }
+        std::string& entry = mPaths[name];
+        if (entry == path) {
+            return;
+        }
+        entry = path;
+        // Rare, so just rewrite the whole file.
+        FILE* f = fopen(mFile.c_str(), "w");
+        if (!f) {
+            INFO("SharedLibrary: can't write path cache [%s]", mFile.c_str());
+            return;
+        }
+        for (const auto& it : mPaths) {
+            fprintf(f, "%s\t%s\n", it.first.c_str(), it.second.c_str());
+        }
+        fclose(f);
+    }
+
+private:
+    std::string mFile;
+    std::unordered_map<std::string, std::string> mPaths;
+};
+
+// Guards s_libraryMap and sPathCache().
+static StaticLock sOpenLock;
 static SharedLibrary::LibraryMap s_libraryMap;
 
+static LibraryPathCache& sPathCache() {
+    static LibraryPathCache* const cache = new LibraryPathCache;
+    return *cache;
+}
+
 // static
 SharedLibrary* SharedLibrary::open(const char* libraryName) {
     INFO("SharedLibrary::open for [%s]", libraryName);
@@ -69,6 +139,7 @@ SharedLibrary* SharedLibrary::open(const char* libraryName) {
 SharedLibrary* SharedLibrary::open(const char* libraryName,
                                    char* error,
                                    size_t errorSize) {
+    AutoLock lock(sOpenLock);
     auto lib = s_libraryMap.find(libraryName);
 
     if (lib == s_libraryMap.end()) {
@@ -91,8 +162,18 @@ SharedLibrary* SharedLibrary::open(const char* libraryName,
 SharedLibrary* SharedLibrary::do_open(const char* libraryName,
                                    char* error,
                                    size_t errorSize) {
+    HMODULE lib = NULL;
+    if (const std::string* cached = sPathCache().find(libraryName)) {
+        INFO("SharedLibrary::open for [%s] (win32): trying cached [%s]", libraryName,
+             cached->c_str());
+        lib = LoadLibraryA(cached->c_str());
+        if (lib) {
+            return new SharedLibrary(lib);
+        }
+    }
+
     INFO("SharedLibrary::open for [%s] (win32): call LoadLibrary", libraryName);
-    HMODULE lib = LoadLibraryA(libraryName);
+    lib = LoadLibraryA(libraryName);
 
     // Try a bit harder to find the shared library if we cannot find it.
     if (!lib) {
@@ -114,6 +195,7 @@ SharedLibrary* SharedLibrary::do_open(const char* libraryName,
         char fullPath[kMaxPathLength];
         GetModuleFileNameA(lib, fullPath, kMaxPathLength);
         INFO("SharedLibrary::open succeeded for [%s]. File name: [%s]", libraryName, fullPath);
+        sPathCache().record(libraryName, fullPath);
         return new SharedLibrary(lib);
     }
 
@@ -185,6 +267,14 @@ SharedLibrary* SharedLibrary::do_open(const char* libraryName,
                                    size_t errorSize) {
     INFO("SharedLibrary::open for [%s] (posix): begin", libraryName);
 
+    if (const std::string* cached = sPathCache().find(libraryName)) {
+        INFO("SharedLibrary::open for [%s] (posix): trying cached [%s]", libraryName,
+             cached->c_str());
+        if (void* lib = dlopen(cached->c_str(), RTLD_NOW)) {
+            return new SharedLibrary(lib);
+        }
+    }
+
     const char* libPath = libraryName;
     char* path = NULL;
 
@@ -260,6 +350,14 @@ SharedLibrary* SharedLibrary::do_open(const char* libraryName,
 
     if (lib) {
         INFO("SharedLibrary::open succeeded for [%s].", libraryName);
+#ifdef __linux__
+        // Cache the file the loader settled on, not the name passed to it.
+        struct link_map* map = nullptr;
+        if (dlinfo(lib, RTLD_DI_LINKMAP, &map) == 0 && map && map->l_name &&
+            map->l_name[0] == '/') {
+            sPathCache().record(libraryName, map->l_name);
+        }
+#endif
         return new SharedLibrary(lib);
     }
 
@@ -286,10 +384,28 @@ SharedLibrary::FunctionPtr SharedLibrary::findSymbol(
 
 #endif  // !_WIN32
 
+size_t SharedLibrary::findSymbols(const char* const* symbolNames,
+                                  FunctionPtr* symbols,
+                                  size_t count) const {
+    size_t found = 0;
+    for (size_t i = 0; i < count; ++i) {
+        symbols[i] = findSymbol(symbolNames[i]);
+        found += symbols[i] != nullptr;
+    }
+    return found;
+}
+
 // static
 void SharedLibrary::addLibrarySearchPath(const char* path) {
+    AutoLock lock(sOpenLock);
     sSearchPaths()->addPath(path);
 }
 
+// static
+void SharedLibrary::setPathCacheFile(const char* path) {
+    AutoLock lock(sOpenLock);
+    sPathCache().setFile(path);
+}
+
 }  // namespace base
 }  // namespace android
@@ -0,0 +1,88 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/SharedLibrary.h"
+
+#include "aemu/base/testing/TestTempDir.h"
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+
+#ifdef __linux__
+#include <dlfcn.h>
+#include <link.h>
+#endif
+
+namespace android {
+namespace base {
+
+#ifdef __linux__
+
+constexpr char kLibm[] = "libm.so.6";
+
+TEST(SharedLibrary, FindSymbols) {
+    SharedLibrary* libm = SharedLibrary::open(kLibm);
+    ASSERT_NE(nullptr, libm);
+    EXPECT_EQ(libm, SharedLibrary::open(kLibm));
+
+    const char* const names[] = {"cos", "no_such_symbol", "sin"};
+    SharedLibrary::FunctionPtr symbols[3];
+    EXPECT_EQ(2u, libm->findSymbols(names, symbols, 3));
+    EXPECT_EQ(libm->findSymbol("cos"), symbols[0]);
+    EXPECT_EQ(nullptr, symbols[1]);
+    EXPECT_NE(nullptr, symbols[2]);
+}
+
+TEST(SharedLibrary, LazySymbol) {
+    static LazySymbol<double(double)> sCos(kLibm, "cos");
+    ASSERT_TRUE(sCos);
+    EXPECT_DOUBLE_EQ(1.0, sCos(0.0));
+
+    static LazySymbol<double(double)> sMissing(kLibm, "no_such_symbol");
+    EXPECT_FALSE(sMissing);
+    static LazySymbol<double(double)> sNoLibrary("libaemu_no_such_library", "cos");
+    EXPECT_FALSE(sNoLibrary);
+}
+
+// Tests that a library is opened from the path cache, under a name nothing
+// else would find.
+TEST(SharedLibrary, PathCache) {
+    void* handle = dlopen(kLibm, RTLD_NOW);
+    ASSERT_NE(nullptr, handle);
+    struct link_map* map = nullptr;
+    ASSERT_EQ(0, dlinfo(handle, RTLD_DI_LINKMAP, &map));
+    const std::string libmPath = map->l_name;
+    dlclose(handle);
+
+    TestTempDir dir("SharedLibrary");
+    const std::string cacheFile = dir.makeSubPath("paths");
+    FILE* f = fopen(cacheFile.c_str(), "w");
+    ASSERT_NE(nullptr, f);
+    fprintf(f, "aemu-cached-libm\t%s\n", libmPath.c_str());
+    fclose(f);
+
+    EXPECT_EQ(nullptr, SharedLibrary::open("aemu-uncached-libm"));
+    SharedLibrary::setPathCacheFile(cacheFile.c_str());
+    SharedLibrary* libm = SharedLibrary::open("aemu-cached-libm");
+    SharedLibrary::setPathCacheFile(nullptr);
+    ASSERT_NE(nullptr, libm);
+    EXPECT_NE(nullptr, libm->findSymbol("cos"));
+}
+
+#endif  // __linux__
+
+}  // namespace base
+}  // namespace android
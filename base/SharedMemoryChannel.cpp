@@ -0,0 +1,276 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/async/SharedMemoryChannel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#include <string.h>
+
+namespace android {
+namespace base {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x4d485341;  // 'ASHM'
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kMaxRingSize = 1u << 30;
+constexpr char kOfferPrefix[] = "aemu-shm/1 ";
+// Waits are split into slices this long so that closing is noticed.
+constexpr uint64_t kWaitSliceUs = 10000;
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+uint32_t roundUpToPowerOfTwo(uint32_t size) {
+    uint32_t rounded = 1;
+    while (rounded < size) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
+}  // namespace
+
+// At the start of the region, followed by the two ring_buffers and then
+// their data. Ring 0 carries data from the creator to the opener.
+struct SharedMemoryChannel::Header {
+    // Written last by the creator, once everything else is set up.
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t ringSize;
+    uint32_t reserved0;
+    std::atomic<uint32_t> closed[2];
+    uint32_t reserved1[10];
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "Header is shared between processes");
+
+SharedMemoryChannel::SharedMemoryChannel(const std::string& name,
+                                         uint32_t ringSize,
+                                         bool creator)
+    : mName(name),
+      mRingSize(ringSize),
+      mMemory(name, regionSize(ringSize)),
+      mSide(creator ? 0 : 1) {}
+
+SharedMemoryChannel::~SharedMemoryChannel() {
+    close();
+}
+
+// static
+size_t SharedMemoryChannel::regionSize(uint32_t ringSize) {
+    return alignUp(sizeof(Header) + 2 * sizeof(ring_buffer), 64) +
+           2 * size_t(ringSize);
+}
+
+void SharedMemoryChannel::attach(bool initialize) {
+    char* base = static_cast<char*>(mMemory.get());
+    mHeader = reinterpret_cast<Header*>(base);
+    ring_buffer* rings = reinterpret_cast<ring_buffer*>(base + sizeof(Header));
+    uint8_t* data = reinterpret_cast<uint8_t*>(
+            base + alignUp(sizeof(Header) + 2 * sizeof(ring_buffer), 64));
+
+    mTx = &rings[mSide];
+    mRx = &rings[1 - mSide];
+    uint8_t* txData = data + size_t(mSide) * mRingSize;
+    uint8_t* rxData = data + size_t(1 - mSide) * mRingSize;
+    if (initialize) {
+        ring_buffer_view_init(mTx, &mTxView, txData, mRingSize);
+        ring_buffer_view_init(mRx, &mRxView, rxData, mRingSize);
+        ring_buffer_set_wait_mode(mTx, RING_BUFFER_WAIT_BLOCKING);
+        ring_buffer_set_wait_mode(mRx, RING_BUFFER_WAIT_BLOCKING);
+    } else {
+        ring_buffer_init_view_only(&mTxView, txData, mRingSize);
+        ring_buffer_init_view_only(&mRxView, rxData, mRingSize);
+    }
+}
+
+// static
+std::unique_ptr<SharedMemoryChannel> SharedMemoryChannel::create(
+        const std::string& name,
+        uint32_t ringSize,
+        mode_t mode) {
+    if (!ringSize || ringSize > kMaxRingSize) {
+        return nullptr;
+    }
+    std::unique_ptr<SharedMemoryChannel> channel(new SharedMemoryChannel(
+            name, roundUpToPowerOfTwo(ringSize), true));
+    if (channel->mMemory.create(mode) != 0) {
+        return nullptr;
+    }
+    memset(channel->mMemory.get(), 0, sizeof(Header));
+    channel->attach(true);
+
+    Header* header = channel->mHeader;
+    header->version = kVersion;
+    header->ringSize = channel->mRingSize;
+    header->magic.store(kMagic, std::memory_order_release);
+    return channel;
+}
+
+// static
+std::unique_ptr<SharedMemoryChannel> SharedMemoryChannel::open(
+        const std::string& name,
+        uint32_t ringSize) {
+    if (!ringSize || ringSize > kMaxRingSize ||
+        roundUpToPowerOfTwo(ringSize) != ringSize) {
+        return nullptr;
+    }
+    std::unique_ptr<SharedMemoryChannel> channel(
+            new SharedMemoryChannel(name, ringSize, false));
+    if (channel->mMemory.open(SharedMemory::AccessMode::READ_WRITE) != 0) {
+        return nullptr;
+    }
+    const Header* header = static_cast<const Header*>(channel->mMemory.get());
+    if (header->magic.load(std::memory_order_acquire) != kMagic ||
+        header->version != kVersion || header->ringSize != ringSize) {
+        return nullptr;
+    }
+    channel->attach(false);
+    return channel;
+}
+
+std::string SharedMemoryChannel::offer() const {
+    return kOfferPrefix + std::to_string(mRingSize) + " " + mName;
+}
+
+// static
+std::unique_ptr<SharedMemoryChannel> SharedMemoryChannel::acceptOffer(
+        std::string_view offer) {
+    const std::string_view prefix(kOfferPrefix);
+    if (offer.substr(0, prefix.size()) != prefix) {
+        return nullptr;
+    }
+    offer.remove_prefix(prefix.size());
+    while (!offer.empty() && (offer.back() == '\n' || offer.back() == '\r')) {
+        offer.remove_suffix(1);
+    }
+
+    uint64_t ringSize = 0;
+    size_t digits = 0;
+    while (digits < offer.size() && offer[digits] >= '0' &&
+           offer[digits] <= '9' && ringSize <= kMaxRingSize) {
+        ringSize = ringSize * 10 + (offer[digits] - '0');
+        ++digits;
+    }
+    if (!digits || digits + 1 >= offer.size() || offer[digits] != ' ' ||
+        ringSize > kMaxRingSize) {
+        return nullptr;
+    }
+    return open(std::string(offer.substr(digits + 1)), uint32_t(ringSize));
+}
+
+ssize_t SharedMemoryChannel::write(const void* data, size_t size) {
+    if (closed() || peerClosed()) {
+        return -1;
+    }
+    const uint32_t n = static_cast<uint32_t>(std::min<size_t>(
+            size, ring_buffer_available_write(mTx, &mTxView)));
+    if (!n) {
+        return 0;
+    }
+    ring_buffer_view_write(mTx, &mTxView, data, n, 1);
+    return n;
+}
+
+bool SharedMemoryChannel::writeFully(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size) {
+        const ssize_t n = write(bytes, size);
+        if (n < 0) {
+            return false;
+        }
+        bytes += n;
+        size -= n;
+        if (size) {
+            waitWritable(kWaitSliceUs);
+        }
+    }
+    return true;
+}
+
+ssize_t SharedMemoryChannel::read(void* data, size_t size) {
+    if (closed()) {
+        return 0;
+    }
+    const uint32_t n = static_cast<uint32_t>(
+            std::min<size_t>(size, ring_buffer_available_read(mRx, &mRxView)));
+    if (!n) {
+        return 0;
+    }
+    ring_buffer_view_read(mRx, &mRxView, data, n, 1);
+    return n;
+}
+
+size_t SharedMemoryChannel::readableBytes() const {
+    return ring_buffer_available_read(mRx, &mRxView);
+}
+
+bool SharedMemoryChannel::waitFor(uint64_t timeoutUs, bool forRead) {
+    const uint64_t deadline = nowUs() + timeoutUs;
+    while (true) {
+        if (closed() || peerClosed()) {
+            return true;
+        }
+        const uint64_t now = nowUs();
+        const uint64_t slice =
+                now >= deadline ? 0 : std::min(deadline - now, kWaitSliceUs);
+        const bool ready =
+                forRead ? ring_buffer_wait_read(mRx, &mRxView, 1, slice)
+                        : ring_buffer_wait_write(mTx, &mTxView, 1, slice);
+        if (ready) {
+            return true;
+        }
+        if (now >= deadline) {
+            return false;
+        }
+    }
+}
+
+bool SharedMemoryChannel::waitReadable(uint64_t timeoutUs) {
+    return waitFor(timeoutUs, true);
+}
+
+bool SharedMemoryChannel::waitWritable(uint64_t timeoutUs) {
+    return waitFor(timeoutUs, false);
+}
+
+void SharedMemoryChannel::close() {
+    if (mHeader) {
+        mHeader->closed[mSide].store(1, std::memory_order_release);
+    }
+}
+
+bool SharedMemoryChannel::closed() const {
+    return mHeader->closed[mSide].load(std::memory_order_acquire) != 0;
+}
+
+bool SharedMemoryChannel::peerClosed() const {
+    return mHeader->closed[1 - mSide].load(std::memory_order_acquire) != 0;
+}
+
+}  // namespace base
+}  // namespace android
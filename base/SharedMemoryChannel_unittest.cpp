@@ -0,0 +1,189 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/async/SharedMemoryChannel.h"
+#include "aemu/base/async/SharedMemorySocket.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace android {
+namespace base {
+
+namespace {
+
+std::string uniqueName(const char* test) {
+    return std::string("aemu-shm-test-") + test + "-" +
+           std::to_string(getpid());
+}
+
+}  // namespace
+
+// Tests that the peer opens the channel from the offer line and bytes flow
+// both ways.
+TEST(SharedMemoryChannel, OfferAndTransfer) {
+    auto host = SharedMemoryChannel::create(uniqueName("offer"), 4096);
+    ASSERT_TRUE(host);
+    EXPECT_EQ(4096u, host->ringSize());
+
+    auto peer = SharedMemoryChannel::acceptOffer(host->offer());
+    ASSERT_TRUE(peer);
+    EXPECT_EQ(host->name(), peer->name());
+
+    EXPECT_EQ(5, host->write("hello", 5));
+    EXPECT_EQ(5u, peer->readableBytes());
+    char buf[16] = {};
+    EXPECT_EQ(5, peer->read(buf, sizeof(buf)));
+    EXPECT_EQ("hello", std::string(buf, 5));
+    EXPECT_EQ(0, peer->read(buf, sizeof(buf)));
+
+    EXPECT_EQ(3, peer->write("bye", 3));
+    EXPECT_TRUE(host->waitReadable(0));
+    EXPECT_EQ(3, host->read(buf, sizeof(buf)));
+    EXPECT_EQ("bye", std::string(buf, 3));
+}
+
+// Tests that malformed offers and mismatched ring sizes are refused.
+TEST(SharedMemoryChannel, RejectsBadOffers) {
+    EXPECT_FALSE(SharedMemoryChannel::acceptOffer(""));
+    EXPECT_FALSE(SharedMemoryChannel::acceptOffer("aemu-shm/2 4096 x"));
+    EXPECT_FALSE(SharedMemoryChannel::acceptOffer("aemu-shm/1 abc x"));
+
+    auto host = SharedMemoryChannel::create(uniqueName("reject"), 4096);
+    ASSERT_TRUE(host);
+    EXPECT_FALSE(SharedMemoryChannel::open(host->name(), 8192));
+}
+
+// Tests a bulk transfer many times the ring size, with both sides waiting
+// on each other.
+TEST(SharedMemoryChannel, BulkTransfer) {
+    auto host = SharedMemoryChannel::create(uniqueName("bulk"), 4096);
+    ASSERT_TRUE(host);
+    auto peer = SharedMemoryChannel::acceptOffer(host->offer());
+    ASSERT_TRUE(peer);
+
+    constexpr size_t kTotal = 1 << 20;
+    std::vector<uint8_t> sent(kTotal);
+    for (size_t i = 0; i < kTotal; ++i) {
+        sent[i] = uint8_t(i * 7 + (i >> 9));
+    }
+
+    std::thread writer([&] {
+        // Odd sizes so that writes straddle the wrap point.
+        for (size_t off = 0; off < kTotal;) {
+            const size_t n = std::min<size_t>(3001, kTotal - off);
+            ASSERT_TRUE(host->writeFully(sent.data() + off, n));
+            off += n;
+        }
+    });
+
+    std::vector<uint8_t> received;
+    received.reserve(kTotal);
+    uint8_t buf[1777];
+    while (received.size() < kTotal) {
+        ASSERT_TRUE(peer->waitReadable(5000000));
+        const ssize_t n = peer->read(buf, sizeof(buf));
+        received.insert(received.end(), buf, buf + n);
+    }
+    writer.join();
+    EXPECT_EQ(sent, received);
+}
+
+// Tests that closing wakes a waiting peer, and data sent before the close
+// can still be read.
+TEST(SharedMemoryChannel, PeerClose) {
+    auto host = SharedMemoryChannel::create(uniqueName("close"), 4096);
+    ASSERT_TRUE(host);
+    auto peer = SharedMemoryChannel::acceptOffer(host->offer());
+    ASSERT_TRUE(peer);
+
+    std::thread closer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_EQ(4, host->write("last", 4));
+        host->close();
+    });
+    char buf[8];
+    size_t got = 0;
+    while (!peer->peerClosed() || peer->readableBytes()) {
+        ASSERT_TRUE(peer->waitReadable(5000000));
+        got += peer->read(buf + got, sizeof(buf) - got);
+    }
+    closer.join();
+
+    EXPECT_EQ(4u, got);
+    EXPECT_TRUE(host->closed());
+    EXPECT_EQ(-1, peer->write("x", 1));
+    EXPECT_FALSE(peer->writeFully("x", 1));
+}
+
+namespace {
+
+class RecordingListener : public AsyncSocketEventListener {
+public:
+    void onRead(AsyncSocketAdapter* socket) override {
+        char buf[64];
+        ssize_t n;
+        while ((n = socket->recv(buf, sizeof(buf))) > 0) {
+            data.append(buf, n);
+        }
+    }
+    void onClose(AsyncSocketAdapter* socket, int err) override {
+        closed = true;
+    }
+    void onConnected(AsyncSocketAdapter* socket) override {}
+
+    std::string data;
+    std::atomic<bool> closed{false};
+};
+
+}  // namespace
+
+// Tests that the socket adapter delivers reads and the close to its
+// listener.
+TEST(SharedMemorySocket, DeliversReadsAndClose) {
+    auto host = SharedMemoryChannel::create(uniqueName("socket"), 4096);
+    ASSERT_TRUE(host);
+    auto peer = SharedMemoryChannel::acceptOffer(host->offer());
+    ASSERT_TRUE(peer);
+
+    RecordingListener listener;
+    SharedMemorySocket socket(std::move(peer));
+    socket.setSocketEventListener(&listener);
+    EXPECT_TRUE(socket.connected());
+
+    EXPECT_TRUE(host->writeFully("ping", 4));
+    host->close();
+
+    const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!listener.closed && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    socket.dispose();
+    EXPECT_TRUE(listener.closed);
+    EXPECT_EQ("ping", listener.data);
+    EXPECT_FALSE(socket.connected());
+    EXPECT_EQ(-1, socket.send("x", 1));
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,120 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/async/SharedMemorySocket.h"
+
+#include <errno.h>
+
+namespace android {
+namespace base {
+
+namespace {
+
+// How long the reader waits per round, so that it notices dispose().
+constexpr uint64_t kReaderWaitUs = 50000;
+
+}  // namespace
+
+SharedMemorySocket::SharedMemorySocket(
+        std::unique_ptr<SharedMemoryChannel> channel)
+    : mChannel(std::move(channel)),
+      mReader([this] { readerLoop(); }) {}
+
+SharedMemorySocket::~SharedMemorySocket() {
+    dispose();
+    mChannel->close();
+}
+
+ssize_t SharedMemorySocket::recv(char* buffer, uint64_t bufferSize) {
+    ssize_t n = mChannel->read(buffer, bufferSize);
+    if (n > 0) {
+        return n;
+    }
+    if (mChannel->closed() || mChannel->peerClosed()) {
+        // The peer may have written more just before it closed.
+        return mChannel->read(buffer, bufferSize);
+    }
+    errno = EAGAIN;
+    return -1;
+}
+
+ssize_t SharedMemorySocket::send(const char* buffer, uint64_t bufferSize) {
+    if (!mChannel->writeFully(buffer, bufferSize)) {
+        return -1;
+    }
+    return bufferSize;
+}
+
+void SharedMemorySocket::close() {
+    mChannel->close();
+    notifyClosed();
+}
+
+bool SharedMemorySocket::connected() {
+    return !mChannel->closed() && !mChannel->peerClosed();
+}
+
+bool SharedMemorySocket::connect() {
+    return connected();
+}
+
+bool SharedMemorySocket::connectSync(std::chrono::milliseconds timeout) {
+    return connected();
+}
+
+void SharedMemorySocket::dispose() {
+    mStop = true;
+    if (mReader.joinable() && mReader.get_id() != std::this_thread::get_id()) {
+        mReader.join();
+    }
+    // Waits for a callback on another thread, e.g. from close().
+    std::lock_guard<std::recursive_mutex> lock(mListenerLock);
+}
+
+void SharedMemorySocket::notifyClosed() {
+    if (mStop || mCloseNotified.exchange(true)) {
+        return;
+    }
+    std::lock_guard<std::recursive_mutex> lock(mListenerLock);
+    if (mListener) {
+        mListener->onClose(this, 0);
+    }
+}
+
+void SharedMemorySocket::readerLoop() {
+    while (!mStop) {
+        if (!mChannel->waitReadable(kReaderWaitUs)) {
+            continue;
+        }
+        if (mChannel->readableBytes()) {
+            std::lock_guard<std::recursive_mutex> lock(mListenerLock);
+            if (mStop) {
+                break;
+            }
+            if (mListener) {
+                mListener->onRead(this);
+                continue;
+            }
+        } else if (mChannel->closed() || mChannel->peerClosed()) {
+            notifyClosed();
+            break;
+        }
+        // Nobody to hand the data to yet; check back shortly.
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+}  // namespace base
+}  // namespace android
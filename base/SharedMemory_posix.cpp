@@ -15,17 +15,39 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
 
 #include "aemu/base/EintrWrapper.h"
+#include "aemu/base/memory/MemoryHints.h"
+#include "aemu/base/misc/FileUtils.h"
 #include "aemu/base/memory/SharedMemory.h"
 #include "aemu/base/files/PathUtils.h"
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
 
+// From <linux/magic.h> and <linux/mman.h>, which may predate them.
+#define AEMU_HUGETLBFS_MAGIC 0x958458f6
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
 namespace android {
 namespace base {
 
+#ifdef __linux__
+// MADV_HUGEPAGE is accepted on shared memory even where the system never
+// backs it with huge pages, so check the policy it is subject to.
+static bool shmemHugePagesAllowed() {
+    const auto policy = readFileIntoString(
+            "/sys/kernel/mm/transparent_hugepage/shmem_enabled");
+    return policy && policy->find("[never]") == std::string::npos &&
+           policy->find("[deny]") == std::string::npos;
+}
+#endif
+
 SharedMemory::SharedMemory(const std::string& name, size_t size) : mSize(size) {
     const std::string& kFileUri = "file://";
     if (name.find(kFileUri, 0) == 0) {
@@ -42,6 +64,10 @@ int SharedMemory::create(mode_t mode) {
     return openInternal(O_CREAT | O_RDWR, mode);
 }
 
+int SharedMemory::create(mode_t mode, const CreateOptions& options) {
+    return openInternal(O_CREAT | O_RDWR, mode, true, &options);
+}
+
 int SharedMemory::createNoMapping(mode_t mode) {
     return openInternal(O_CREAT | O_RDWR, mode, false /* no mapping */);
 }
@@ -61,6 +87,7 @@ void SharedMemory::close(bool forceDestroy) {
         munmap(mAddr, mSize);
         mAddr = unmappedMemory();
     }
+    mBacking = Backing();
     if (mFd) {
         ::close(mFd);
         mFd = invalidHandle();
@@ -82,7 +109,10 @@ bool SharedMemory::isOpen() const {
     return mFd != invalidHandle();
 }
 
-int SharedMemory::openInternal(int oflag, int mode, bool doMapping) {
+int SharedMemory::openInternal(int oflag,
+                               int mode,
+                               bool doMapping,
+                               const CreateOptions* options) {
     if (isOpen()) {
         return EEXIST;
     }
@@ -137,11 +167,58 @@ int SharedMemory::openInternal(int oflag, int mode, bool doMapping) {
             close();
             return err;
         }
+        if (options) {
+            applyCreateOptions(*options);
+        }
     }
 
     mCreate |= (oflag & O_CREAT);
     assert(isOpen());
     return 0;
 }
+
+void SharedMemory::applyCreateOptions(const CreateOptions& options) {
+#ifdef __linux__
+    struct statfs fs;
+    if (fstatfs(mFd, &fs) == 0 && fs.f_type == AEMU_HUGETLBFS_MAGIC) {
+        mBacking.pages = BlockBacking::kExplicitHuge;
+    }
+#ifdef MADV_HUGEPAGE
+    if (options.hugePages && mShareType == ShareType::SHARED_MEMORY &&
+        mBacking.pages == BlockBacking::kRegular &&
+        madvise(mAddr, mSize, MADV_HUGEPAGE) == 0 && shmemHugePagesAllowed()) {
+        mBacking.pages = BlockBacking::kTransparentHuge;
+    }
+#endif
+#endif  // __linux__
+
+    if (options.numaNode != BlockMemoryOptions::kAnyNode) {
+        const int node = options.numaNode == BlockMemoryOptions::kLocalNode
+                                 ? currentNumaNode()
+                                 : options.numaNode;
+        if (preferNumaNode(mAddr, mSize, node)) {
+            mBacking.numaNode = node;
+        }
+    }
+
+    if (options.prefault) {
+#ifdef __linux__
+        // Faults in writable pages without touching their contents, which
+        // may already hold another process's data.
+        mBacking.prefaulted =
+                madvise(mAddr, mSize, MADV_POPULATE_WRITE) == 0;
+#endif
+        if (!mBacking.prefaulted) {
+            // Older kernels: a read per page still allocates it.
+            const uint64_t pageSize = memoryPageSize();
+            const volatile char* bytes = static_cast<const char*>(mAddr);
+            for (size_t offset = 0; offset < mSize; offset += pageSize) {
+                (void)bytes[offset];
+            }
+            mBacking.prefaulted = true;
+        }
+    }
+}
+
 }  // namespace base
 }  // namespace android
@@ -193,5 +193,34 @@ TEST(SharedMemory, CreateNoMapping) {
     ASSERT_FALSE(mem.isOpen());
 }
 
+// Tests that creation options are applied as far as the host allows, and
+// that what was obtained is reported.
+TEST(SharedMemory, CreateOptions) {
+    const size_t size = 4 * 1024 * 1024;
+    base::SharedMemory mem("tst_create_options_2165486981", size);
+    SharedMemory::CreateOptions options;
+    options.hugePages = true;
+    options.prefault = true;
+    options.numaNode = BlockMemoryOptions::kLocalNode;
+    ASSERT_EQ(0, mem.create(0600, options));
+
+    const SharedMemory::Backing& backing = mem.backing();
+    EXPECT_TRUE(backing.prefaulted);
+    EXPECT_NE(BlockBacking::kExplicitHuge, backing.pages);
+    if (backing.numaNode != BlockMemoryOptions::kAnyNode) {
+        EXPECT_EQ(currentNumaNode(), backing.numaNode);
+    }
+    // The region is usable whatever it got.
+    static_cast<char*>(*mem)[size - 1] = 1;
+
+    mem.close();
+    EXPECT_FALSE(mem.backing().prefaulted);
+
+    base::SharedMemory plain("tst_create_options_2165486981", 4096);
+    ASSERT_EQ(0, plain.create(0600));
+    EXPECT_FALSE(plain.backing().prefaulted);
+    EXPECT_EQ(BlockBacking::kRegular, plain.backing().pages);
+}
+
 }  // namespace base
 }  // namespace android
@@ -18,11 +18,35 @@
 #include <string>
 
 #include "aemu/base/files/PathUtils.h"
+#include "aemu/base/memory/MemoryHints.h"
 #include "aemu/base/system/Win32UnicodeString.h"
 
 namespace android {
 namespace base {
 
+// Large page mappings need SeLockMemoryPrivilege enabled on the process
+// token; it is only there to enable if an administrator granted it.
+static bool enableLockMemoryPrivilege() {
+    static const bool sEnabled = [] {
+        HANDLE token;
+        if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES,
+                              &token)) {
+            return false;
+        }
+        TOKEN_PRIVILEGES privileges = {};
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        bool ok = LookupPrivilegeValueW(nullptr, L"SeLockMemoryPrivilege",
+                                        &privileges.Privileges[0].Luid) &&
+                  AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr,
+                                        nullptr) &&
+                  GetLastError() == ERROR_SUCCESS;
+        CloseHandle(token);
+        return ok;
+    }();
+    return sEnabled;
+}
+
 SharedMemory::SharedMemory(const std::string& name, size_t size) : mSize(size) {
     const std::string kFileUri = "file://";
     if (name.find(kFileUri, 0) == 0) {
@@ -47,6 +71,10 @@ int SharedMemory::create(mode_t mode) {
     return openInternal(AccessMode::READ_WRITE);
 }
 
+int SharedMemory::create(mode_t mode, const CreateOptions& options) {
+    return openInternal(AccessMode::READ_WRITE, true, &options);
+}
+
 int SharedMemory::createNoMapping(mode_t mode) {
     return openInternal(AccessMode::READ_WRITE, false /* no mapping */);
 }
@@ -57,7 +85,9 @@ int SharedMemory::open(AccessMode access) {
     return openInternal(access);
 }
 
-int SharedMemory::openInternal(AccessMode access, bool doMapping) {
+int SharedMemory::openInternal(AccessMode access,
+                               bool doMapping,
+                               const CreateOptions* options) {
     if (mCreate) {
         return EEXIST;
     }
@@ -95,13 +125,38 @@ int SharedMemory::openInternal(AccessMode access, bool doMapping) {
         objectName = nullptr;
     }
 
-    HANDLE hMapFile = CreateFileMappingW(
-            mFile,
-            NULL,             // default security
-            protection,       // read/write access
-            memory.HighPart,  // maximum object size (high-order DWORD)
-            memory.LowPart,   // maximum object size (low-order DWORD)
-            objectName);      // name of mapping object
+    int numaNode = BlockMemoryOptions::kAnyNode;
+    bool largePages = false;
+    if (options && doMapping) {
+        numaNode = options->numaNode == BlockMemoryOptions::kLocalNode
+                           ? currentNumaNode()
+                           : options->numaNode;
+        const SIZE_T largePageSize = GetLargePageMinimum();
+        largePages = options->hugePages &&
+                     mShareType == ShareType::SHARED_MEMORY && largePageSize &&
+                     mSize % largePageSize == 0 && enableLockMemoryPrivilege();
+    }
+
+    HANDLE hMapFile = NULL;
+    if (largePages) {
+        // Large pages are committed, and locked, up front. Fall back to a
+        // regular mapping if there aren't enough free.
+        hMapFile = CreateFileMappingNumaW(
+                mFile, NULL, protection | SEC_COMMIT | SEC_LARGE_PAGES,
+                memory.HighPart, memory.LowPart, objectName,
+                numaNode >= 0 ? (DWORD)numaNode : NUMA_NO_PREFERRED_NODE);
+        largePages = hMapFile != NULL;
+    }
+    if (hMapFile == NULL) {
+        hMapFile = CreateFileMappingNumaW(
+                mFile,
+                NULL,             // default security
+                protection,       // read/write access
+                memory.HighPart,  // maximum object size (high-order DWORD)
+                memory.LowPart,   // maximum object size (low-order DWORD)
+                objectName,       // name of mapping object
+                numaNode >= 0 ? (DWORD)numaNode : NUMA_NO_PREFERRED_NODE);
+    }
 
     if (hMapFile == NULL) {
         int err = -GetLastError();
@@ -116,13 +171,39 @@ int SharedMemory::openInternal(AccessMode access, bool doMapping) {
             protection = FILE_MAP_WRITE;
         }
 
-        mAddr = MapViewOfFile(hMapFile, protection, 0, 0, mSize);
+        if (largePages) {
+            protection |= FILE_MAP_LARGE_PAGES;
+        }
+
+        mAddr = MapViewOfFileExNuma(
+                hMapFile, protection, 0, 0, mSize, NULL,
+                numaNode >= 0 ? (DWORD)numaNode : NUMA_NO_PREFERRED_NODE);
 
         if (mAddr == NULL) {
             int err = -GetLastError();
+            CloseHandle(hMapFile);
             close();
             return err;
         }
+
+        if (options) {
+            if (largePages) {
+                mBacking.pages = BlockBacking::kExplicitHuge;
+                // Large pages are never paged out.
+                mBacking.prefaulted = true;
+            }
+            if (numaNode >= 0) {
+                mBacking.numaNode = numaNode;
+            }
+            if (options->prefault && !mBacking.prefaulted) {
+                const uint64_t pageSize = memoryPageSize();
+                const volatile char* bytes = static_cast<const char*>(mAddr);
+                for (size_t offset = 0; offset < mSize; offset += pageSize) {
+                    (void)bytes[offset];
+                }
+                mBacking.prefaulted = true;
+            }
+        }
     }
 
     mFd = hMapFile;
@@ -135,6 +216,7 @@ void SharedMemory::close(bool forceDestroy) {
         UnmapViewOfFile(mAddr);
         mAddr = unmappedMemory();
     }
+    mBacking = Backing();
     if (mFd) {
         CloseHandle(mFd);
         mFd = invalidHandle();
@@ -0,0 +1,366 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/async/SharedRingChannel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include "aemu/base/system/Win32UnicodeString.h"
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#ifdef __APPLE__
+// Not in the public SDK, but stable and used by libc++ for atomic waits.
+extern "C" int __ulock_wait(uint32_t operation, void* addr, uint64_t value,
+                            uint32_t timeout_us);
+extern "C" int __ulock_wake(uint32_t operation, void* addr, uint64_t wake_value);
+#define UL_COMPARE_AND_WAIT_SHARED 3
+#define ULF_WAKE_ALL 0x00000100
+#endif
+
+namespace android {
+namespace base {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x52485341;  // 'ASHR'
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kMaxRingSize = 1u << 30;
+// Waits for room or data are split into slices this long so that closing
+// is noticed.
+constexpr uint64_t kWaitSliceUs = 10000;
+// How long the consumer waits for more data before it hangs up.
+constexpr uint64_t kHangupAfterUs = 200;
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+uint32_t roundUpToPowerOfTwo(uint32_t size) {
+    uint32_t rounded = 1;
+    while (rounded < size) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
+int sideOf(SharedRingChannel::Role role) {
+    return role == SharedRingChannel::Role::Producer ? 0 : 1;
+}
+
+uint32_t ringState(const ring_buffer* ring) {
+    return __atomic_load_n(&ring->state, __ATOMIC_SEQ_CST);
+}
+
+}  // namespace
+
+// At the start of the region, followed by the ring_buffer and then its data.
+struct SharedRingChannel::Header {
+    // Written last by the creator, once everything else is set up.
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t ringSize;
+    uint32_t reserved0;
+    // Indexed by sideOf().
+    std::atomic<uint32_t> closed[2];
+    // Bumped by the producer to wake a hung up consumer.
+    std::atomic<uint32_t> doorbell;
+    uint32_t reserved1[9];
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "Header is shared between processes");
+
+SharedRingChannel::SharedRingChannel(const std::string& name,
+                                     Role role,
+                                     uint32_t ringSize)
+    : mName(name),
+      mRole(role),
+      mRingSize(ringSize),
+      mMemory(name, regionSize(ringSize)) {}
+
+SharedRingChannel::~SharedRingChannel() {
+    close();
+#ifdef _WIN32
+    if (mEvent) {
+        CloseHandle(mEvent);
+    }
+#endif
+}
+
+// static
+size_t SharedRingChannel::regionSize(uint32_t ringSize) {
+    return alignUp(sizeof(Header) + sizeof(ring_buffer), 64) + ringSize;
+}
+
+bool SharedRingChannel::attach(bool initialize) {
+    char* base = static_cast<char*>(mMemory.get());
+    mHeader = reinterpret_cast<Header*>(base);
+    mRing = reinterpret_cast<ring_buffer*>(base + sizeof(Header));
+    uint8_t* data = reinterpret_cast<uint8_t*>(
+            base + alignUp(sizeof(Header) + sizeof(ring_buffer), 64));
+    if (initialize) {
+        ring_buffer_view_init(mRing, &mView, data, mRingSize);
+        ring_buffer_set_wait_mode(mRing, RING_BUFFER_WAIT_BLOCKING);
+        ring_buffer_sync_init(mRing);
+    } else {
+        ring_buffer_init_view_only(&mView, data, mRingSize);
+    }
+#ifdef _WIN32
+    // Opens the event if the other side created it already.
+    const Win32UnicodeString eventName("AEMU_RING_" + mName);
+    mEvent = CreateEventW(nullptr, FALSE, FALSE, eventName.c_str());
+    if (!mEvent) {
+        return false;
+    }
+#endif
+    return true;
+}
+
+// static
+std::unique_ptr<SharedRingChannel> SharedRingChannel::create(
+        const std::string& name,
+        Role role,
+        uint32_t ringSize,
+        mode_t mode) {
+    if (!ringSize || ringSize > kMaxRingSize) {
+        return nullptr;
+    }
+    std::unique_ptr<SharedRingChannel> channel(
+            new SharedRingChannel(name, role, roundUpToPowerOfTwo(ringSize)));
+    if (channel->mMemory.create(mode) != 0) {
+        return nullptr;
+    }
+    memset(channel->mMemory.get(), 0, sizeof(Header));
+    if (!channel->attach(true)) {
+        return nullptr;
+    }
+
+    Header* header = channel->mHeader;
+    header->version = kVersion;
+    header->ringSize = channel->mRingSize;
+    header->magic.store(kMagic, std::memory_order_release);
+    return channel;
+}
+
+// static
+std::unique_ptr<SharedRingChannel> SharedRingChannel::open(
+        const std::string& name,
+        Role role,
+        uint32_t ringSize) {
+    if (!ringSize || ringSize > kMaxRingSize ||
+        roundUpToPowerOfTwo(ringSize) != ringSize) {
+        return nullptr;
+    }
+    std::unique_ptr<SharedRingChannel> channel(
+            new SharedRingChannel(name, role, ringSize));
+    if (channel->mMemory.open(SharedMemory::AccessMode::READ_WRITE) != 0) {
+        return nullptr;
+    }
+    const Header* header = static_cast<const Header*>(channel->mMemory.get());
+    if (header->magic.load(std::memory_order_acquire) != kMagic ||
+        header->version != kVersion || header->ringSize != ringSize) {
+        return nullptr;
+    }
+    if (!channel->attach(false)) {
+        return nullptr;
+    }
+    return channel;
+}
+
+void SharedRingChannel::ringDoorbell() {
+    mHeader->doorbell.fetch_add(1, std::memory_order_seq_cst);
+    void* addr = &mHeader->doorbell;
+#if defined(__linux__)
+    syscall(SYS_futex, addr, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+#elif defined(_WIN32)
+    (void)addr;
+    SetEvent(mEvent);
+#elif defined(__APPLE__)
+    __ulock_wake(UL_COMPARE_AND_WAIT_SHARED | ULF_WAKE_ALL, addr, 0);
+#else
+    (void)addr;
+#endif
+}
+
+void SharedRingChannel::waitDoorbell(uint32_t token, uint64_t timeoutUs) {
+    void* addr = &mHeader->doorbell;
+#if defined(__linux__)
+    struct timespec ts;
+    ts.tv_sec = timeoutUs / 1000000;
+    ts.tv_nsec = (timeoutUs % 1000000) * 1000;
+    syscall(SYS_futex, addr, FUTEX_WAIT, token, &ts, nullptr, 0);
+#elif defined(_WIN32)
+    // The event stays set if the producer rang after |token| was read, so
+    // that ring isn't lost; a stale one just wakes us early.
+    (void)addr;
+    if (mHeader->doorbell.load(std::memory_order_seq_cst) == token) {
+        WaitForSingleObject(
+                mEvent, (DWORD)std::min<uint64_t>((timeoutUs + 999) / 1000,
+                                                  INFINITE - 1));
+    }
+#elif defined(__APPLE__)
+    __ulock_wait(UL_COMPARE_AND_WAIT_SHARED, addr, token,
+                 (uint32_t)std::max<uint64_t>(
+                         1, std::min<uint64_t>(timeoutUs, UINT32_MAX)));
+#else
+    (void)addr;
+    if (mHeader->doorbell.load(std::memory_order_seq_cst) == token) {
+        std::this_thread::sleep_for(std::chrono::microseconds(
+                std::min<uint64_t>(timeoutUs, 1000)));
+    }
+#endif
+}
+
+bool SharedRingChannel::send(const void* data, size_t size) {
+    if (mRole != Role::Producer || closed() || peerClosed()) {
+        return false;
+    }
+    while (!ring_buffer_producer_acquire(mRing)) {
+        if (ring_buffer_producer_acquire_from_hangup(mRing)) {
+            // Wake it now rather than after writing: with the consumer
+            // asleep, a send larger than the ring would never finish.
+            ringDoorbell();
+            ++mDoorbellRings;
+            break;
+        }
+        // The consumer is between hanging up and hung up.
+        if (peerClosed()) {
+            return false;
+        }
+        ring_buffer_yield();
+    }
+
+    const char* bytes = static_cast<const char*>(data);
+    bool ok = true;
+    while (size) {
+        const uint32_t n = static_cast<uint32_t>(std::min<size_t>(
+                size, ring_buffer_available_write(mRing, &mView)));
+        if (n) {
+            ring_buffer_view_write(mRing, &mView, bytes, n, 1);
+            bytes += n;
+            size -= n;
+        } else if (closed() || peerClosed()) {
+            ok = false;
+            break;
+        } else {
+            ring_buffer_wait_write(mRing, &mView, 1, kWaitSliceUs);
+        }
+    }
+    ring_buffer_producer_idle(mRing);
+    return ok;
+}
+
+ssize_t SharedRingChannel::receive(void* data, size_t size, uint64_t timeoutUs) {
+    if (mRole != Role::Consumer || closed()) {
+        return -1;
+    }
+    if (!size) {
+        return 0;
+    }
+    const uint64_t deadline = nowUs() + timeoutUs;
+    while (true) {
+        const uint32_t n = static_cast<uint32_t>(std::min<size_t>(
+                size, ring_buffer_available_read(mRing, &mView)));
+        if (n) {
+            ring_buffer_view_read(mRing, &mView, data, n, 1);
+            return n;
+        }
+        if (peerClosed()) {
+            // Data may have landed between the read above and the close.
+            if (!ring_buffer_available_read(mRing, &mView)) {
+                return -1;
+            }
+            continue;
+        }
+        const uint64_t now = nowUs();
+        if (now >= deadline) {
+            return 0;
+        }
+        const uint64_t remaining = deadline - now;
+
+        switch (ringState(mRing)) {
+            case RING_BUFFER_SYNC_PRODUCER_ACTIVE:
+                ring_buffer_wait_read(mRing, &mView, 1,
+                                      std::min(remaining, kWaitSliceUs));
+                break;
+            case RING_BUFFER_SYNC_PRODUCER_IDLE:
+                // Give the producer a moment to send more before sleeping.
+                if (!ring_buffer_wait_read(mRing, &mView, 1,
+                                           std::min(remaining, kHangupAfterUs)) &&
+                    ring_buffer_consumer_hangup(mRing)) {
+                    ring_buffer_consumer_hung_up(mRing);
+                }
+                break;
+            case RING_BUFFER_SYNC_CONSUMER_HANGING_UP:
+                ring_buffer_consumer_hung_up(mRing);
+                break;
+            case RING_BUFFER_SYNC_CONSUMER_HUNG_UP: {
+                // Read the doorbell before re-checking, so that a producer
+                // acquiring the ring from here on is sure to change it.
+                const uint32_t token =
+                        mHeader->doorbell.load(std::memory_order_seq_cst);
+                if (ringState(mRing) == RING_BUFFER_SYNC_CONSUMER_HUNG_UP &&
+                    !ring_buffer_view_can_read(mRing, &mView, 1) && !peerClosed()) {
+                    waitDoorbell(token, remaining);
+                }
+                break;
+            }
+        }
+    }
+}
+
+size_t SharedRingChannel::readableBytes() const {
+    return ring_buffer_available_read(mRing, &mView);
+}
+
+void SharedRingChannel::close() {
+    if (!mHeader || closed()) {
+        return;
+    }
+    mHeader->closed[sideOf(mRole)].store(1, std::memory_order_release);
+    if (mRole == Role::Producer) {
+        ringDoorbell();
+    }
+}
+
+bool SharedRingChannel::closed() const {
+    return mHeader->closed[sideOf(mRole)].load(std::memory_order_acquire) != 0;
+}
+
+bool SharedRingChannel::peerClosed() const {
+    return mHeader->closed[1 - sideOf(mRole)].load(
+                   std::memory_order_acquire) != 0;
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,139 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/async/SharedRingChannel.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace android {
+namespace base {
+
+namespace {
+
+using Role = SharedRingChannel::Role;
+
+std::string uniqueName(const char* test) {
+    return std::string("aemu-ring-test-") + test + "-" +
+           std::to_string(getpid());
+}
+
+}  // namespace
+
+// Tests that the consumer opens the producer's region and data flows, and
+// that only a send to a hung up consumer rings the doorbell.
+TEST(SharedRingChannel, SendAndHangup) {
+    auto producer =
+            SharedRingChannel::create(uniqueName("hangup"), Role::Producer, 4000);
+    ASSERT_TRUE(producer);
+    EXPECT_EQ(4096u, producer->ringSize());
+    EXPECT_FALSE(SharedRingChannel::open(producer->name(), Role::Consumer, 8192));
+    auto consumer =
+            SharedRingChannel::open(producer->name(), Role::Consumer, 4096);
+    ASSERT_TRUE(consumer);
+
+    EXPECT_TRUE(producer->send("hello", 5));
+    EXPECT_EQ(0u, producer->doorbellRings());
+    char buf[16] = {};
+    EXPECT_EQ(5, consumer->receive(buf, sizeof(buf), 0));
+    EXPECT_EQ("hello", std::string(buf, 5));
+
+    // Finding nothing for a while, the consumer hangs up.
+    EXPECT_EQ(0, consumer->receive(buf, sizeof(buf), 5000));
+    EXPECT_TRUE(producer->send("again", 5));
+    EXPECT_EQ(1u, producer->doorbellRings());
+    EXPECT_TRUE(producer->send("!", 1));
+    EXPECT_EQ(1u, producer->doorbellRings());
+    EXPECT_EQ(6, consumer->receive(buf, sizeof(buf), 0));
+    EXPECT_EQ("again!", std::string(buf, 6));
+
+    // Roles are fixed.
+    EXPECT_FALSE(consumer->send("x", 1));
+    EXPECT_EQ(-1, producer->receive(buf, sizeof(buf), 0));
+}
+
+// Tests that a sleeping consumer is woken for data, and streams larger than
+// the ring arrive intact and in order.
+TEST(SharedRingChannel, Stream) {
+    auto consumer =
+            SharedRingChannel::create(uniqueName("stream"), Role::Consumer, 4096);
+    ASSERT_TRUE(consumer);
+    auto producer =
+            SharedRingChannel::open(consumer->name(), Role::Producer, 4096);
+    ASSERT_TRUE(producer);
+
+    constexpr size_t kTotal = 1 << 20;
+    std::thread sender([&producer] {
+        std::vector<uint8_t> chunk(3000);
+        size_t sent = 0;
+        while (sent < kTotal) {
+            const size_t n = std::min(chunk.size(), kTotal - sent);
+            for (size_t i = 0; i < n; ++i) {
+                chunk[i] = uint8_t((sent + i) * 7);
+            }
+            ASSERT_TRUE(producer->send(chunk.data(), n));
+            sent += n;
+            if (sent % (64 * 1024) < n) {
+                // Let the consumer hang up now and then.
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+        producer->close();
+    });
+
+    std::vector<uint8_t> buf(5000);
+    size_t received = 0;
+    while (true) {
+        const ssize_t n = consumer->receive(buf.data(), buf.size(), 1000000);
+        if (n < 0) {
+            break;
+        }
+        for (ssize_t i = 0; i < n; ++i) {
+            ASSERT_EQ(uint8_t((received + i) * 7), buf[i]);
+        }
+        received += n;
+    }
+    sender.join();
+    EXPECT_EQ(kTotal, received);
+    EXPECT_GT(producer->doorbellRings(), 0u);
+}
+
+// Tests that the producer stops waiting for room once the consumer closes.
+TEST(SharedRingChannel, ConsumerClose) {
+    auto producer =
+            SharedRingChannel::create(uniqueName("close"), Role::Producer, 4096);
+    ASSERT_TRUE(producer);
+    auto consumer =
+            SharedRingChannel::open(producer->name(), Role::Consumer, 4096);
+    ASSERT_TRUE(consumer);
+
+    std::thread closer([&consumer] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        consumer->close();
+    });
+    std::vector<uint8_t> big(16384);
+    EXPECT_FALSE(producer->send(big.data(), big.size()));
+    closer.join();
+    EXPECT_TRUE(producer->peerClosed());
+    EXPECT_FALSE(producer->send("x", 1));
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,72 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/containers/SmallVector.h"
+
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+// range(0) elements, against the inline capacity of 16: up to it nothing is
+// allocated, past it the vector spills to the heap.
+void BM_SmallVector_PushBack(benchmark::State& state) {
+    const int count = int(state.range(0));
+    for (auto _ : state) {
+        SmallFixedVector<int, 16> vec;
+        for (int i = 0; i < count; ++i) {
+            vec.push_back(i);
+        }
+        benchmark::DoNotOptimize(vec.data());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * count);
+}
+BENCHMARK(BM_SmallVector_PushBack)->Arg(8)->Arg(16)->Arg(64);
+
+// The same with std::vector, for comparison.
+void BM_StdVector_PushBack(benchmark::State& state) {
+    const int count = int(state.range(0));
+    for (auto _ : state) {
+        std::vector<int> vec;
+        for (int i = 0; i < count; ++i) {
+            vec.push_back(i);
+        }
+        benchmark::DoNotOptimize(vec.data());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * count);
+}
+BENCHMARK(BM_StdVector_PushBack)->Arg(8)->Arg(16)->Arg(64);
+
+void BM_SmallVector_Iterate(benchmark::State& state) {
+    SmallFixedVector<int, 16> vec;
+    for (int i = 0; i < 16; ++i) {
+        vec.push_back(i);
+    }
+    for (auto _ : state) {
+        int sum = 0;
+        for (int v : vec) {
+            sum += v;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_SmallVector_Iterate);
+
+}  // namespace
+}  // namespace base
+}  // namespace android
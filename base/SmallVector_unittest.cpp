@@ -0,0 +1,71 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/containers/SmallVector.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace android {
+namespace base {
+
+// Tests that trivially copyable elements survive the switch to the heap and
+// later realloc() growth, and that append() copies raw bytes.
+TEST(SmallVector, GrowPod) {
+    SmallFixedVector<unsigned char, 8> vec;
+    EXPECT_FALSE(vec.isAllocated());
+    const char text[] = "0123456789";
+    vec.append(text, 10);
+    EXPECT_TRUE(vec.isAllocated());
+    ASSERT_EQ(10u, vec.size());
+    EXPECT_EQ('9', vec[9]);
+
+    for (int i = 0; i < 1000; ++i) {
+        vec.append(text + i % 10, 1);
+    }
+    ASSERT_EQ(1010u, vec.size());
+    for (size_t i = 0; i < vec.size(); ++i) {
+        ASSERT_EQ(text[i % 10], vec[i]);
+    }
+
+    vec.resize(20);
+    vec.shrink_to_fit();
+    EXPECT_EQ(20u, vec.capacity());
+    EXPECT_EQ('9', vec[19]);
+    vec.clear();
+    vec.shrink_to_fit();
+    EXPECT_EQ(1u, vec.capacity());
+    vec.push_back('x');
+    EXPECT_EQ('x', vec[0]);
+}
+
+// Tests that other types are still moved element by element.
+TEST(SmallVector, GrowNonTrivial) {
+    SmallFixedVector<std::string, 2> vec;
+    for (int i = 0; i < 100; ++i) {
+        vec.emplace_back(std::to_string(i));
+    }
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(std::to_string(i), vec[i]);
+    }
+    vec.resize(3);
+    vec.shrink_to_fit();
+    EXPECT_EQ(3u, vec.capacity());
+    EXPECT_EQ("2", vec[2]);
+}
+
+}  // namespace base
+}  // namespace android
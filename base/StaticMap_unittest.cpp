@@ -0,0 +1,103 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/containers/StaticMap.h"
+
+#include "aemu/base/threads/FunctorThread.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace base {
+
+TEST(StaticMap, Basic) {
+    StaticMap<int, std::string> map;
+    EXPECT_FALSE(map.isPresent(1));
+    EXPECT_FALSE(map.get(1));
+
+    map.set(1, "one");
+    map.set(2, "two");
+    // Like emplace(), set() keeps an existing value.
+    map.set(1, "uno");
+    EXPECT_TRUE(map.isPresent(1));
+    EXPECT_EQ("one", *map.get(1));
+
+    size_t length = 0;
+    EXPECT_TRUE(map.withValue(2, [&length](const std::string& value) {
+        length = value.size();
+    }));
+    EXPECT_EQ(3u, length);
+    EXPECT_FALSE(map.withValue(3, [](const std::string&) { FAIL(); }));
+
+    map.eraseIf([](int key, std::string) { return key == 2; });
+    EXPECT_FALSE(map.isPresent(2));
+    map.erase(1);
+    EXPECT_FALSE(map.isPresent(1));
+
+    map.set(5, "five");
+    map.clear();
+    EXPECT_FALSE(map.isPresent(5));
+    EpochReclaimer::get().reclaim();
+}
+
+// Test: readers keep finding stable keys while a writer churns others.
+TEST(StaticMap, ConcurrentReaders) {
+    constexpr int kStableKeys = 64;
+    constexpr int kReaders = 4;
+
+    StaticMap<int, int> map;
+    for (int i = 0; i < kStableKeys; ++i) {
+        map.set(i, i * 3);
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> failures{0};
+    std::vector<std::unique_ptr<FunctorThread>> readers;
+    for (int t = 0; t < kReaders; ++t) {
+        readers.emplace_back(new FunctorThread([&map, &stop, &failures] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < kStableKeys; ++i) {
+                    if (!map.withValue(i, [&failures, i](const int& value) {
+                            if (value != i * 3) ++failures;
+                        })) {
+                        ++failures;
+                    }
+                }
+            }
+            return 0;
+        }));
+        readers.back()->start();
+    }
+
+    for (int round = 0; round < 2000; ++round) {
+        const int key = kStableKeys + round % 16;
+        map.set(key, round);
+        map.erase(key);
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader->wait();
+    }
+    EXPECT_EQ(0, failures.load());
+    EpochReclaimer::get().reclaim();
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,163 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/StatsPage.h"
+
+#include "aemu/base/memory/SharedMemory.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/system/System.h"
+
+#include <algorithm>
+#include <memory>
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace android {
+namespace base {
+
+static_assert(sizeof(StatsPage::Header) == 64, "Header is part of the ABI");
+static_assert(sizeof(StatsPage::Entry) == 64, "Entry is part of the ABI");
+static_assert(std::atomic<int64_t>::is_always_lock_free,
+              "Agents read values straight from the mapping");
+
+namespace {
+
+// Guards adding stats and publishing.
+StaticLock sLock;
+// Never closed: writers may be about to touch the mapping at any time.
+SharedMemory* sShared = nullptr;
+
+}  // namespace
+
+StatsPage::Page StatsPage::sLocalPage;
+std::atomic<StatsPage::Page*> StatsPage::sPage{&StatsPage::sLocalPage};
+
+StatsPage& StatsPage::get() {
+    static StatsPage* sInstance = new StatsPage;
+    return *sInstance;
+}
+
+StatsPage::StatsPage() {
+    Header& header = sLocalPage.header;
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.headerSize = sizeof(Header);
+    header.entrySize = sizeof(Entry);
+    header.capacity = kMaxEntries;
+    header.pid = static_cast<uint32_t>(getpid());
+    header.startUnixUs = getUnixTimeUs();
+}
+
+Stat StatsPage::add(const char* name, StatKind kind) {
+    AutoLock lock(sLock);
+    Page* page = sPage.load(std::memory_order_relaxed);
+    const uint32_t count = page->header.count.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!strncmp(page->entries[i].name, name, kNameSize - 1)) {
+            return Stat(i);
+        }
+    }
+    if (count == kMaxEntries) {
+        return Stat();
+    }
+
+    Entry& entry = page->entries[count];
+    strncpy(entry.name, name, kNameSize - 1);
+    entry.kind = kind;
+    page->header.count.store(count + 1, std::memory_order_release);
+    return Stat(count);
+}
+
+int StatsPage::publish(const std::string& name, mode_t mode) {
+    AutoLock lock(sLock);
+    if (sShared) {
+        return -EEXIST;
+    }
+
+    auto shared = std::make_unique<SharedMemory>(name, kSize);
+    const int err = shared->create(mode);
+    if (err) {
+        return err;
+    }
+
+    Page* from = sPage.load(std::memory_order_relaxed);
+    Page* to = static_cast<Page*>(shared->get());
+    const uint32_t count = from->header.count.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; ++i) {
+        memcpy(to->entries[i].name, from->entries[i].name, kNameSize);
+        to->entries[i].kind = from->entries[i].kind;
+        to->entries[i].value.store(from->entries[i].value.load(std::memory_order_relaxed),
+                                   std::memory_order_relaxed);
+    }
+    Header& header = to->header;
+    header.version = from->header.version;
+    header.headerSize = from->header.headerSize;
+    header.entrySize = from->header.entrySize;
+    header.capacity = from->header.capacity;
+    header.pid = from->header.pid;
+    header.startUnixUs = from->header.startUnixUs;
+    header.count.store(count, std::memory_order_relaxed);
+    // Last, so an agent that sees the magic sees a consistent header.
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+
+    sPage.store(to, std::memory_order_release);
+    sShared = shared.release();
+    return 0;
+}
+
+std::vector<StatsPage::Value> StatsPage::snapshot() const {
+    std::vector<Value> values;
+    parse(sPage.load(std::memory_order_acquire), kSize, &values);
+    return values;
+}
+
+// static
+bool StatsPage::parse(const void* data, size_t size, std::vector<Value>* out) {
+    out->clear();
+    if (size < sizeof(Header)) {
+        return false;
+    }
+    const Header* header = static_cast<const Header*>(data);
+    if (memcmp(header->magic, kMagic, sizeof(kMagic)) || header->version < 1 ||
+        header->headerSize < sizeof(Header) || header->entrySize < sizeof(Entry)) {
+        return false;
+    }
+
+    const uint32_t count = std::min(header->count.load(std::memory_order_acquire),
+                                    header->capacity);
+    const char* entries = static_cast<const char*>(data) + header->headerSize;
+    for (uint32_t i = 0; i < count; ++i) {
+        const size_t offset = header->headerSize + size_t(i) * header->entrySize;
+        if (offset + sizeof(Entry) > size) {
+            return false;
+        }
+        const Entry* entry = reinterpret_cast<const Entry*>(
+                entries + size_t(i) * header->entrySize);
+        out->push_back({std::string(entry->name, strnlen(entry->name, kNameSize)),
+                        entry->kind, entry->value.load(std::memory_order_relaxed)});
+    }
+    return true;
+}
+
+}  // namespace base
+}  // namespace android
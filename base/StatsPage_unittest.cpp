@@ -0,0 +1,90 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/StatsPage.h"
+
+#include "aemu/base/memory/SharedMemory.h"
+
+#include <gtest/gtest.h>
+
+#include <errno.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace android {
+namespace base {
+
+namespace {
+
+int64_t valueOf(const std::vector<StatsPage::Value>& values, const char* name) {
+    for (const StatsPage::Value& value : values) {
+        if (value.name == name) {
+            return value.value;
+        }
+    }
+    ADD_FAILURE() << "no stat " << name;
+    return -1;
+}
+
+}  // namespace
+
+// Tests that stats keep their values across publishing, and that an agent
+// mapping the region read only sees later updates.
+TEST(StatsPage, PublishAndRead) {
+    StatsPage& page = StatsPage::get();
+    const Stat counter = page.add("StatsPageTest.counter", StatKind::kCounter);
+    const Stat gauge = page.add("StatsPageTest.gauge", StatKind::kGauge);
+    counter.add(3);
+    gauge.set(7);
+    EXPECT_EQ(3, page.add("StatsPageTest.counter", StatKind::kGauge).value());
+
+    const std::string name = "aemu_stats_test_" + std::to_string(getpid());
+    ASSERT_EQ(0, page.publish(name));
+    EXPECT_EQ(-EEXIST, page.publish(name));
+
+    SharedMemory reader(name, StatsPage::kSize);
+    ASSERT_EQ(0, reader.open(SharedMemory::AccessMode::READ_ONLY));
+
+    std::vector<StatsPage::Value> values;
+    ASSERT_TRUE(StatsPage::parse(*reader, reader.size(), &values));
+    EXPECT_EQ(3, valueOf(values, "StatsPageTest.counter"));
+    EXPECT_EQ(7, valueOf(values, "StatsPageTest.gauge"));
+
+    counter.add(2);
+    gauge.set(-1);
+    const Stat late = page.add("StatsPageTest.late", StatKind::kCounter);
+    late.add(5);
+    ASSERT_TRUE(StatsPage::parse(*reader, reader.size(), &values));
+    EXPECT_EQ(5, valueOf(values, "StatsPageTest.counter"));
+    EXPECT_EQ(-1, valueOf(values, "StatsPageTest.gauge"));
+    EXPECT_EQ(5, valueOf(values, "StatsPageTest.late"));
+
+    const auto* header = static_cast<const StatsPage::Header*>(*reader);
+    EXPECT_EQ(StatsPage::kVersion, header->version);
+    EXPECT_EQ(static_cast<uint32_t>(getpid()), header->pid);
+}
+
+TEST(StatsPage, RejectsForeignData) {
+    std::vector<char> junk(StatsPage::kSize, 'x');
+    std::vector<StatsPage::Value> values;
+    EXPECT_FALSE(StatsPage::parse(junk.data(), junk.size(), &values));
+    EXPECT_FALSE(StatsPage::parse(junk.data(), 8, &values));
+}
+
+}  // namespace base
+}  // namespace android
@@ -14,17 +14,127 @@
 
 #include "aemu/base/files/StdioStream.h"
 
+#include "aemu/base/IOVector.h"
+
+#include <algorithm>
+
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#define STDIO_LOCK(f) _lock_file(f)
+#define STDIO_UNLOCK(f) _unlock_file(f)
+#define STDIO_FWRITE _fwrite_nolock
+#elif defined(__linux__) && defined(__GLIBC__)
+#define STDIO_LOCK(f) flockfile(f)
+#define STDIO_UNLOCK(f) funlockfile(f)
+#define STDIO_FWRITE fwrite_unlocked
+#else
+#define STDIO_LOCK(f) flockfile(f)
+#define STDIO_UNLOCK(f) funlockfile(f)
+#define STDIO_FWRITE fwrite
+#endif
+
+#ifdef _WIN32
+#define STDIO_FILENO _fileno
+#define STDIO_FTELL _ftelli64
+#define STDIO_FSEEK _fseeki64
+#else
+#define STDIO_FILENO fileno
+#define STDIO_FTELL ftello
+#define STDIO_FSEEK fseeko
+#endif
 
 namespace android {
 namespace base {
 
+namespace {
+
+// Reserves |size| bytes of disk from |offset| on, leaving the file size
+// alone. Best effort: file systems that can't are no worse off.
+void preallocate(int fd, uint64_t offset, uint64_t size) {
+#ifdef _WIN32
+    FILE_ALLOCATION_INFO info;
+    info.AllocationSize.QuadPart = offset + size;
+    ::SetFileInformationByHandle(
+            reinterpret_cast<HANDLE>(::_get_osfhandle(fd)), FileAllocationInfo,
+            &info, sizeof(info));
+#elif defined(__linux__)
+    ::fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, size);
+#elif defined(__APPLE__)
+    // Allocates past the end of what's allocated already.
+    (void)offset;
+    fstore_t store = {F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0,
+                      static_cast<off_t>(size), 0};
+    if (::fcntl(fd, F_PREALLOCATE, &store) == -1) {
+        store.fst_flags = F_ALLOCATEALL;
+        ::fcntl(fd, F_PREALLOCATE, &store);
+    }
+#else
+    (void)fd;
+    (void)offset;
+    (void)size;
+#endif
+}
+
+}  // namespace
+
 StdioStream::StdioStream(FILE* file, Ownership ownership) :
     mFile(file), mOwnership(ownership) {}
 
+StdioStream::StdioStream(FILE* file,
+                         Ownership ownership,
+                         const StdioOptions& options)
+    : StdioStream(file, ownership) {
+    if (!file) {
+        return;
+    }
+    if (options.bufferSize && ownership == kOwner) {
+        mBuffer.reset(new char[options.bufferSize]);
+        if (::setvbuf(file, mBuffer.get(), _IOFBF, options.bufferSize)) {
+            mBuffer.reset();
+        }
+    }
+    const int fd = STDIO_FILENO(file);
+    const int64_t offset = std::max<int64_t>(STDIO_FTELL(file), 0);
+    if (options.sizeHint) {
+        preallocate(fd, offset, options.sizeHint);
+    }
+#ifdef __linux__
+    if (options.sequential) {
+        ::posix_fadvise(fd, offset, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    mDropCache = options.dropCache;
+    mWritebackInterval = options.writebackInterval;
+    mPosition = mWritebackStart = mWrittenBack = offset;
+#elif defined(__APPLE__)
+    if (options.sequential) {
+        ::fcntl(fd, F_RDAHEAD, 1);
+    }
+    // There's no way to drop pages once cached; don't cache them at all.
+    if (options.dropCache) {
+        ::fcntl(fd, F_NOCACHE, 1);
+    }
+#endif
+}
+
 StdioStream::StdioStream(StdioStream&& other)
-    : mFile(other.mFile), mOwnership(other.mOwnership) {
+    : mFile(other.mFile),
+      mOwnership(other.mOwnership),
+      mBuffer(std::move(other.mBuffer)),
+      mDropCache(other.mDropCache),
+      mWritebackInterval(other.mWritebackInterval),
+      mPosition(other.mPosition),
+      mWritebackStart(other.mWritebackStart),
+      mWrittenBack(other.mWrittenBack) {
     other.mFile = nullptr;
 }
 
@@ -33,6 +143,12 @@ StdioStream& StdioStream::operator=(StdioStream&& other) {
     close();
     mFile = other.mFile;
     mOwnership = other.mOwnership;
+    mBuffer = std::move(other.mBuffer);
+    mDropCache = other.mDropCache;
+    mWritebackInterval = other.mWritebackInterval;
+    mPosition = other.mPosition;
+    mWritebackStart = other.mWritebackStart;
+    mWrittenBack = other.mWrittenBack;
     other.mFile = nullptr;
     return *this;
 }
@@ -58,10 +174,91 @@ ssize_t StdioStream::write(const void* buffer, size_t size) {
             errno = ::ferror(mFile);
         }
     }
+    if (mDropCache || mWritebackInterval) {
+        wrote(res);
+    }
     return static_cast<ssize_t>(res);
 }
 
+// Takes the FILE lock once for the whole vector instead of once per buffer;
+// stdio then coalesces the buffers as usual.
+ssize_t StdioStream::writev(const IOVector& iov) {
+    size_t total = 0;
+    STDIO_LOCK(mFile);
+    for (const auto& entry : iov) {
+        const size_t res = STDIO_FWRITE(entry.iov_base, 1, entry.iov_len, mFile);
+        total += res;
+        if (res < entry.iov_len) {
+            if (!::feof(mFile)) {
+                errno = ::ferror(mFile);
+            }
+            break;
+        }
+    }
+    STDIO_UNLOCK(mFile);
+    if (mDropCache || mWritebackInterval) {
+        wrote(total);
+    }
+    return static_cast<ssize_t>(total);
+}
+
+// Pipes and terminals fail both with ESPIPE.
+int64_t StdioStream::readPosition() const {
+    return mFile ? STDIO_FTELL(mFile) : -1;
+}
+
+bool StdioStream::seekRead(int64_t position) {
+    return mFile && STDIO_FSEEK(mFile, position, SEEK_SET) == 0;
+}
+
+void StdioStream::wrote(size_t size) {
+    mPosition += size;
+#ifdef __linux__
+    if (!mWritebackInterval ||
+        mPosition - mWritebackStart < mWritebackInterval) {
+        return;
+    }
+    // The kernel can only write back what stdio handed it.
+    ::fflush(mFile);
+    const int fd = STDIO_FILENO(mFile);
+    ::sync_file_range(fd, mWritebackStart, mPosition - mWritebackStart,
+                      SYNC_FILE_RANGE_WRITE);
+    // The previous batch had a whole interval to reach the disk; waiting
+    // for it keeps at most two intervals dirty.
+    if (mWrittenBack < mWritebackStart) {
+        ::sync_file_range(fd, mWrittenBack, mWritebackStart - mWrittenBack,
+                          SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                                  SYNC_FILE_RANGE_WAIT_AFTER);
+        if (mDropCache) {
+            ::posix_fadvise(fd, mWrittenBack, mWritebackStart - mWrittenBack,
+                            POSIX_FADV_DONTNEED);
+        }
+        mWrittenBack = mWritebackStart;
+    }
+    mWritebackStart = mPosition;
+#endif
+}
+
+void StdioStream::finishWriteback() {
+#ifdef __linux__
+    if (mPosition <= mWrittenBack) {
+        return;
+    }
+    ::fflush(mFile);
+    const int fd = STDIO_FILENO(mFile);
+    ::sync_file_range(fd, mWrittenBack, mPosition - mWrittenBack,
+                      SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                              SYNC_FILE_RANGE_WAIT_AFTER);
+    ::posix_fadvise(fd, mWrittenBack, mPosition - mWrittenBack,
+                    POSIX_FADV_DONTNEED);
+    mWrittenBack = mWritebackStart = mPosition;
+#endif
+}
+
 void StdioStream::close() {
+    if (mFile && mDropCache) {
+        finishWriteback();
+    }
     if (mOwnership == kOwner && mFile) {
         ::fclose(mFile);
         mFile = nullptr;
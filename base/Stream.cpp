@@ -5,12 +5,114 @@
 
 #include "aemu/base/files/Stream.h"
 
+#include "aemu/base/IOVector.h"
+
+#include <algorithm>
+
 #include <assert.h>
 #include <string.h>
 
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
+
 namespace android {
 namespace base {
 
+namespace {
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr bool kHostIsBigEndian = true;
+#else
+constexpr bool kHostIsBigEndian = false;
+#endif
+
+inline uint16_t byteSwap(uint16_t v) {
+#ifdef _MSC_VER
+    return _byteswap_ushort(v);
+#else
+    return __builtin_bswap16(v);
+#endif
+}
+
+inline uint32_t byteSwap(uint32_t v) {
+#ifdef _MSC_VER
+    return _byteswap_ulong(v);
+#else
+    return __builtin_bswap32(v);
+#endif
+}
+
+inline uint64_t byteSwap(uint64_t v) {
+#ifdef _MSC_VER
+    return _byteswap_uint64(v);
+#else
+    return __builtin_bswap64(v);
+#endif
+}
+
+// Converts |count| values between host and big-endian order. The plain loop
+// over byte swaps is what compilers turn into vector shuffles.
+template <class T>
+void convertBigEndian(T* dst, const T* src, size_t count) {
+    if (kHostIsBigEndian) {
+        if (dst != src) {
+            memcpy(dst, src, count * sizeof(T));
+        }
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = byteSwap(src[i]);
+    }
+}
+
+template <class T>
+void putBeArray(Stream* stream, const T* values, size_t count) {
+    // Convert through a stack buffer so that the caller's array stays intact.
+    constexpr size_t kChunk = 4096 / sizeof(T);
+    T chunk[kChunk];
+    while (count) {
+        const size_t n = std::min(count, kChunk);
+        convertBigEndian(chunk, values, n);
+        stream->write(chunk, n * sizeof(T));
+        values += n;
+        count -= n;
+    }
+}
+
+template <class T>
+bool getBeArray(Stream* stream, T* values, size_t count) {
+    const size_t size = count * sizeof(T);
+    ssize_t res = stream->read(values, size);
+    if (res < 0) {
+        res = 0;
+    }
+    const size_t complete = res / sizeof(T);
+    memset(values + complete, 0, (count - complete) * sizeof(T));
+    convertBigEndian(values, values, complete);
+    return static_cast<size_t>(res) == size;
+}
+
+}  // namespace
+
+ssize_t Stream::writev(const IOVector& iov) {
+    ssize_t total = 0;
+    for (const auto& entry : iov) {
+        if (!entry.iov_len) {
+            continue;
+        }
+        const ssize_t res = write(entry.iov_base, entry.iov_len);
+        if (res < 0) {
+            return total ? total : res;
+        }
+        total += res;
+        if (static_cast<size_t>(res) < entry.iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
 void Stream::putByte(uint8_t value) {
     write(&value, 1U);
 }
@@ -76,6 +178,30 @@ uint64_t Stream::getBe64() {
            (uint64_t)b[7];
 }
 
+void Stream::putBe16Array(const uint16_t* values, size_t count) {
+    putBeArray(this, values, count);
+}
+
+void Stream::putBe32Array(const uint32_t* values, size_t count) {
+    putBeArray(this, values, count);
+}
+
+void Stream::putBe64Array(const uint64_t* values, size_t count) {
+    putBeArray(this, values, count);
+}
+
+bool Stream::getBe16Array(uint16_t* values, size_t count) {
+    return getBeArray(this, values, count);
+}
+
+bool Stream::getBe32Array(uint32_t* values, size_t count) {
+    return getBeArray(this, values, count);
+}
+
+bool Stream::getBe64Array(uint64_t* values, size_t count) {
+    return getBeArray(this, values, count);
+}
+
 void Stream::putFloat(float v) {
     union {
         float f;
@@ -136,6 +262,23 @@ std::string Stream::getString() {
     return result;
 }
 
+std::string_view Stream::getBufferView(size_t size, std::string* scratch) {
+    if (const char* data = readInPlace(size)) {
+        return {data, size};
+    }
+    scratch->resize(size);
+    if (size > 0 &&
+        this->read(&(*scratch)[0], size) != static_cast<ssize_t>(size)) {
+        scratch->clear();
+        return {};
+    }
+    return *scratch;
+}
+
+std::string_view Stream::getStringView(std::string* scratch) {
+    return getBufferView(this->getBe32(), scratch);
+}
+
 void Stream::putPackedNum(uint64_t num) {
     do {
         auto byte = uint8_t(num & 0x7f);
@@ -0,0 +1,87 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/files/MemStream.h"
+#include "aemu/base/files/Stream.h"
+
+#include "benchmark/benchmark.h"
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+// Each iteration starts from a new stream, as saving a snapshot does.
+constexpr int kValues = 1024;
+
+void BM_Stream_PutGetBe32(benchmark::State& state) {
+    for (auto _ : state) {
+        MemStream stream(kValues * 4);
+        for (int i = 0; i < kValues; ++i) {
+            stream.putBe32(uint32_t(i));
+        }
+        uint32_t sum = 0;
+        for (int i = 0; i < kValues; ++i) {
+            sum += stream.getBe32();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * kValues);
+}
+BENCHMARK(BM_Stream_PutGetBe32);
+
+void BM_Stream_PutGetBe32Array(benchmark::State& state) {
+    std::vector<uint32_t> values(kValues, 0x12345678);
+    for (auto _ : state) {
+        MemStream stream(kValues * 4);
+        stream.putBe32Array(values.data(), values.size());
+        stream.getBe32Array(values.data(), values.size());
+        benchmark::DoNotOptimize(values.data());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * kValues);
+}
+BENCHMARK(BM_Stream_PutGetBe32Array);
+
+void BM_Stream_PackedNum(benchmark::State& state) {
+    for (auto _ : state) {
+        MemStream stream(kValues * 10);
+        for (int i = 0; i < kValues; ++i) {
+            stream.putPackedNum(uint64_t(i) << (i % 48));
+        }
+        uint64_t sum = 0;
+        for (int i = 0; i < kValues; ++i) {
+            sum += stream.getPackedNum();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * kValues);
+}
+BENCHMARK(BM_Stream_PackedNum);
+
+void BM_Stream_PutGetString(benchmark::State& state) {
+    const std::string str(size_t(state.range(0)), 'a');
+    for (auto _ : state) {
+        MemStream stream;
+        stream.putString(str);
+        benchmark::DoNotOptimize(stream.getString());
+    }
+}
+BENCHMARK(BM_Stream_PutGetString)->Arg(16)->Arg(4096);
+
+}  // namespace
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,296 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/files/Stream.h"
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "aemu/base/IOVector.h"
+#include "aemu/base/files/BufferedWriteStream.h"
+#include "aemu/base/files/InplaceStream.h"
+#include "aemu/base/files/MemStream.h"
+#include "aemu/base/files/StdioStream.h"
+
+namespace android {
+namespace base {
+namespace {
+
+// Counts write() calls on top of a MemStream.
+class CountingStream : public MemStream {
+public:
+    ssize_t write(const void* buffer, size_t size) override {
+        ++writes;
+        return MemStream::write(buffer, size);
+    }
+    int writes = 0;
+};
+
+TEST(Stream, BulkArraysMatchScalarEncoding) {
+    std::vector<uint16_t> v16(3000);
+    std::vector<uint32_t> v32(3000);
+    std::vector<uint64_t> v64(3000);
+    for (size_t i = 0; i < v32.size(); ++i) {
+        v16[i] = uint16_t(i * 40503u);
+        v32[i] = uint32_t(i * 2654435761u);
+        v64[i] = uint64_t(i) * 0x9E3779B97F4A7C15ull;
+    }
+
+    MemStream scalar;
+    for (auto v : v16) scalar.putBe16(v);
+    for (auto v : v32) scalar.putBe32(v);
+    for (auto v : v64) scalar.putBe64(v);
+
+    MemStream bulk;
+    bulk.putBe16Array(v16.data(), v16.size());
+    bulk.putBe32Array(v32.data(), v32.size());
+    bulk.putBe64Array(v64.data(), v64.size());
+    EXPECT_EQ(scalar.buffer(), bulk.buffer());
+
+    std::vector<uint16_t> r16(v16.size());
+    std::vector<uint32_t> r32(v32.size());
+    std::vector<uint64_t> r64(v64.size());
+    EXPECT_TRUE(bulk.getBe16Array(r16.data(), r16.size()));
+    EXPECT_TRUE(bulk.getBe32Array(r32.data(), r32.size()));
+    EXPECT_TRUE(bulk.getBe64Array(r64.data(), r64.size()));
+    EXPECT_EQ(v16, r16);
+    EXPECT_EQ(v32, r32);
+    EXPECT_EQ(v64, r64);
+}
+
+TEST(Stream, GetArrayShortRead) {
+    MemStream stream;
+    stream.putBe32(7);
+    stream.putByte(1);
+    uint32_t values[3] = {1, 2, 3};
+    EXPECT_FALSE(stream.getBe32Array(values, 3));
+    EXPECT_EQ(7u, values[0]);
+    EXPECT_EQ(0u, values[1]);
+    EXPECT_EQ(0u, values[2]);
+}
+
+TEST(Stream, WritevDefaultAndMemStream) {
+    char a[] = "abc";
+    char b[] = "defgh";
+    IOVector iov;
+    iov.push_back({a, 3});
+    iov.push_back({b, 5});
+
+    CountingStream counting;
+    EXPECT_EQ(8, static_cast<Stream&>(counting).writev(iov));
+    // MemStream takes the vector in one go.
+    EXPECT_EQ(0, counting.writes);
+    EXPECT_EQ(std::string("abcdefgh"),
+              std::string(counting.buffer().begin(), counting.buffer().end()));
+}
+
+// Tests that a segmented stream spans chunks, reads back what was written
+// and saves in the same format as a contiguous one.
+TEST(MemStream, Segmented) {
+    std::vector<char> data(MemStream::kSegmentSize * 2 + 123);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = char(i * 13);
+    }
+
+    MemStream segmented(MemStream::Layout::Segmented);
+    EXPECT_TRUE(segmented.segmented());
+    EXPECT_EQ(100, segmented.write(data.data(), 100));
+    EXPECT_EQ(int(data.size() - 100),
+              segmented.write(data.data() + 100, data.size() - 100));
+    EXPECT_EQ(int(data.size()), segmented.writtenSize());
+
+    size_t segments = 0;
+    size_t total = 0;
+    segmented.forEachSegment([&](const char* bytes, size_t size) {
+        EXPECT_EQ(0, memcmp(data.data() + total, bytes, size));
+        total += size;
+        ++segments;
+    });
+    EXPECT_EQ(3u, segments);
+    EXPECT_EQ(data.size(), total);
+    IOVector iov;
+    segmented.appendSegmentsTo(&iov);
+    EXPECT_EQ(3u, iov.size());
+    EXPECT_EQ(data.size(), iov.summedLength());
+    EXPECT_EQ(data, segmented.buffer());
+
+    std::vector<char> out(data.size());
+    EXPECT_EQ(7, segmented.read(out.data(), 7));
+    EXPECT_EQ(int(data.size() - 7),
+              segmented.read(out.data() + 7, data.size()));
+    EXPECT_EQ(data, out);
+
+    MemStream saved;
+    segmented.save(&saved);
+    MemStream contiguous;
+    contiguous.load(&saved);
+    EXPECT_EQ(data, contiguous.buffer());
+
+    saved.rewind();
+    MemStream reloaded(MemStream::Layout::Segmented);
+    reloaded.load(&saved);
+    EXPECT_EQ(data, reloaded.buffer());
+
+    MemStream moved = std::move(reloaded);
+    EXPECT_EQ(int(data.size()), moved.writtenSize());
+    EXPECT_EQ(0, reloaded.writtenSize());
+}
+
+TEST(Stream, WritevStdioStream) {
+    FILE* file = tmpfile();
+    ASSERT_TRUE(file);
+    StdioStream stream(file, StdioStream::kOwner);
+    char a[] = "hello ";
+    char b[] = "world";
+    IOVector iov;
+    iov.push_back({a, 6});
+    iov.push_back({b, 5});
+    EXPECT_EQ(11, stream.writev(iov));
+
+    rewind(file);
+    char out[12] = {};
+    EXPECT_EQ(11, stream.read(out, 11));
+    EXPECT_STREQ("hello world", out);
+}
+
+// Tests that a tuned stream writes the same bytes, and that preallocation
+// doesn't change the file size.
+TEST(StdioStream, Options) {
+    FILE* file = tmpfile();
+    ASSERT_TRUE(file);
+    StdioOptions options;
+    options.bufferSize = 1 << 20;
+    options.sizeHint = 8 << 20;
+    options.sequential = true;
+    options.dropCache = true;
+    options.writebackInterval = 256 << 10;
+    StdioStream stream(file, StdioStream::kOwner, options);
+
+    std::vector<uint32_t> data(300000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = uint32_t(i * 2654435761u);
+    }
+    for (size_t i = 0; i < data.size(); i += 1000) {
+        ASSERT_EQ(4000, stream.write(&data[i], 4000));
+    }
+    IOVector iov;
+    iov.push_back({data.data(), 100});
+    EXPECT_EQ(100, stream.writev(iov));
+    fflush(file);
+    EXPECT_EQ(long(data.size() * 4 + 100), ftell(file));
+    fseek(file, 0, SEEK_END);
+    EXPECT_EQ(long(data.size() * 4 + 100), ftell(file));
+
+    rewind(file);
+    std::vector<uint32_t> out(data.size());
+    EXPECT_EQ(ssize_t(data.size() * 4), stream.read(out.data(), data.size() * 4));
+    EXPECT_EQ(data, out);
+}
+
+// Tests seeking the read side of files and memory, and that other streams
+// report they can't.
+TEST(Stream, SeekRead) {
+    MemStream mem;
+    mem.putBe32(1);
+    mem.putBe32(2);
+    EXPECT_EQ(0, mem.readPosition());
+    EXPECT_EQ(1u, mem.getBe32());
+    EXPECT_EQ(4, mem.readPosition());
+    EXPECT_TRUE(mem.seekRead(0));
+    EXPECT_EQ(1u, mem.getBe32());
+    EXPECT_FALSE(mem.seekRead(9));
+    EXPECT_EQ(2u, mem.getBe32());
+
+    StdioStream file(tmpfile(), StdioStream::kOwner);
+    ASSERT_TRUE(file.get());
+    file.putBe32(3);
+    file.putBe32(4);
+    ASSERT_TRUE(file.seekRead(4));
+    EXPECT_EQ(4u, file.getBe32());
+    EXPECT_EQ(8, file.readPosition());
+    ASSERT_TRUE(file.seekRead(0));
+    EXPECT_EQ(3u, file.getBe32());
+
+    char buffer[16];
+    InplaceStream inplace(buffer, sizeof(buffer));
+    EXPECT_EQ(-1, inplace.readPosition());
+    EXPECT_FALSE(inplace.seekRead(0));
+}
+
+// Tests that views point into memory-backed streams and fall back to
+// copying elsewhere, with the same results either way.
+TEST(Stream, BufferViews) {
+    MemStream mem;
+    mem.putString("first");
+    mem.putString("second");
+    std::string scratch;
+    const std::string_view first = mem.getStringView(&scratch);
+    EXPECT_EQ("first", first);
+    EXPECT_GE(first.data(), mem.buffer().data());
+    EXPECT_TRUE(scratch.empty());
+    EXPECT_EQ("sec", mem.getBufferView(4 + 3, &scratch).substr(4));
+    // Short reads give nothing.
+    EXPECT_TRUE(mem.getBufferView(4, &scratch).empty());
+
+    InplaceStream inplace(const_cast<char*>(mem.buffer().data()),
+                          mem.writtenSize());
+    inplace.advanceWrite(mem.writtenSize());
+    EXPECT_EQ(mem.buffer().data() + 4, inplace.getStringView(&scratch).data());
+    EXPECT_EQ("second", inplace.getStringView(&scratch));
+
+    // Segmented streams copy views that straddle two segments.
+    MemStream segmented(MemStream::Layout::Segmented);
+    std::vector<char> data(MemStream::kSegmentSize + 10, 'x');
+    segmented.write(data.data(), MemStream::kSegmentSize - 10);
+    segmented.putString("straddles");
+    segmented.read(data.data(), MemStream::kSegmentSize - 10);
+    EXPECT_EQ("straddles", segmented.getStringView(&scratch));
+    EXPECT_EQ("straddles", scratch);
+
+    FILE* file = tmpfile();
+    ASSERT_TRUE(file);
+    StdioStream stdio(file, StdioStream::kOwner);
+    stdio.putString("from a file");
+    rewind(file);
+    EXPECT_EQ("from a file", stdio.getStringView(&scratch));
+    EXPECT_EQ(scratch.data(), stdio.getBufferView(0, &scratch).data());
+}
+
+TEST(BufferedWriteStream, CoalescesSmallWrites) {
+    CountingStream output;
+    {
+        BufferedWriteStream buffered(output, 1024);
+        for (uint32_t i = 0; i < 1000; ++i) {
+            buffered.putBe32(i);
+        }
+        std::vector<char> big(5000, 'x');
+        EXPECT_EQ(5000, buffered.write(big.data(), big.size()));
+        buffered.putByte(1);
+    }
+    // 4000 bytes in 1024-byte chunks, the big write on its own, then the tail.
+    EXPECT_EQ(6, output.writes);
+    EXPECT_EQ(9001, output.writtenSize());
+    for (uint32_t i = 0; i < 1000; ++i) {
+        ASSERT_EQ(i, output.getBe32());
+    }
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
@@ -14,7 +14,13 @@
 
 #include "aemu/base/StringFormat.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+#include <ctype.h>
 #include <stdio.h>
+#include <string.h>
 
 namespace android {
 namespace base {
@@ -43,42 +49,272 @@ void StringAppendFormatRaw(std::string* string, const char* format, ...) {
 void StringAppendFormatWithArgs(std::string* string,
                                 const char* format,
                                 va_list args) {
-    size_t cur_size = string->size();
-    size_t extra = 0;
+    const size_t cur_size = string->size();
+    // Start with whatever capacity is already there, so short strings take
+    // a single vsnprintf() pass.
+    size_t extra = std::max<size_t>(string->capacity() - cur_size, 64);
     for (;;) {
+        string->resize(cur_size + extra);
         va_list args2;
         va_copy(args2, args);
         int ret = vsnprintf(&(*string)[cur_size], extra, format, args2);
         va_end(args2);
 
-        if (ret == 0) {
-            // Nothing to do here.
-            break;
-        }
-
-        if (ret > 0) {
+        if (ret >= 0) {
             size_t ret_sz = static_cast<size_t>(ret);
-            if (extra == 0) {
-                // First pass, resize the string and try again.
-                extra = ret_sz + 1;
-                string->resize(cur_size + extra);
-                continue;
-            }
             if (ret_sz < extra) {
-                // Second pass or later, success!
                 string->resize(cur_size + ret_sz);
                 return;
             }
+            // Too small, try again with the exact size.
+            extra = ret_sz + 1;
+            continue;
         }
 
         // NOTE: The MSVCRT.DLL implementation of snprintf() is broken and
-        // will return -1 in case of truncation. This code path is taken
-        // when this happens, or when |ret_sz| is equal or larger than
-        // |extra|. Grow the buffer to allow for more room, then try again.
+        // will return -1 in case of truncation. Grow the buffer to allow
+        // for more room, then try again.
         extra += (extra >> 1) + 32;
-        string->resize(cur_size + extra);
     }
 }
 
+void StringAppendFormatRaw(SmallVector<char>* buffer, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    StringAppendFormatWithArgs(buffer, format, args);
+    va_end(args);
+}
+
+void StringAppendFormatWithArgs(SmallVector<char>* buffer,
+                                const char* format,
+                                va_list args) {
+    const size_t size = buffer->size();
+    for (;;) {
+        const size_t spare = buffer->capacity() - size;
+        buffer->resize_noinit(buffer->capacity());
+        va_list args2;
+        va_copy(args2, args);
+        int ret = vsnprintf(buffer->data() + size, spare, format, args2);
+        va_end(args2);
+
+        if (ret >= 0 && static_cast<size_t>(ret) < spare) {
+            buffer->resize_noinit(size + ret);
+            return;
+        }
+        buffer->resize_noinit(size);
+        // See the MSVCRT note above for ret < 0.
+        buffer->reserve(ret >= 0 ? size + ret + 1
+                                 : buffer->capacity() * 2);
+    }
+}
+
+namespace internal {
+
+namespace {
+
+// Integer arguments reinterpreted at the width their length modifier
+// names, like printf() does.
+long long toSigned(unsigned long long val, int bits) {
+    return bits >= 64 ? static_cast<long long>(val)
+                      : static_cast<long long>(val << (64 - bits)) >>
+                                (64 - bits);
+}
+
+unsigned long long toUnsigned(unsigned long long val, int bits) {
+    return bits >= 64 ? val : val & ((1ull << bits) - 1);
+}
+
+template <class T>
+void appendChars(SmallVector<char>* buffer, T val, int base) {
+    char chars[24];
+    const char* end = std::to_chars(chars, chars + sizeof(chars), val, base).ptr;
+    buffer->append(chars, end - chars);
+}
+
+// %f, %e and %g with the default precision of 6 are std::to_chars() with
+// that precision. Returns false if printf() has to handle it.
+bool appendDouble(SmallVector<char>* buffer, double val, char conv) {
+#if defined(__cpp_lib_to_chars)
+    if (!std::isfinite(val)) {
+        return false;
+    }
+    std::chars_format fmt;
+    switch (tolower(conv)) {
+        case 'f':
+            fmt = std::chars_format::fixed;
+            break;
+        case 'e':
+            fmt = std::chars_format::scientific;
+            break;
+        default:
+            fmt = std::chars_format::general;
+            break;
+    }
+    char chars[512];  // Enough for DBL_MAX in fixed notation.
+    char* end = std::to_chars(chars, chars + sizeof(chars), val, fmt, 6).ptr;
+    if (isupper(conv)) {
+        std::transform(chars, end, chars, ::toupper);
+    }
+    buffer->append(chars, end - chars);
+    return true;
+#else
+    return false;
+#endif
+}
+
+}  // namespace
+
+void formatArgsTo(SmallVector<char>* buffer,
+                  const char* format,
+                  const FormatArg* args) {
+    const char* f = format;
+    while (*f) {
+        const char* literal = f;
+        while (*f && *f != '%') {
+            ++f;
+        }
+        buffer->append(literal, f - literal);
+        if (!*f) {
+            break;
+        }
+        ++f;
+        if (*f == '%') {
+            buffer->push_back('%');
+            ++f;
+            continue;
+        }
+
+        // checkFormat() has vetted this spec, so it can be parsed loosely.
+        char spec[16] = "%";
+        size_t specLen = 1;
+        while (*f && strchr("-+ #0", *f)) {
+            spec[specLen++] = *f++;
+        }
+        int width = 0;
+        const bool hasWidth = *f == '*' || isdigit(*f);
+        if (*f == '*') {
+            width = static_cast<int>(args++->u);
+            ++f;
+        }
+        while (isdigit(*f)) {
+            width = width * 10 + (*f++ - '0');
+        }
+        int precision = -1;
+        if (*f == '.') {
+            ++f;
+            precision = 0;
+            if (*f == '*') {
+                precision = static_cast<int>(args++->u);
+                ++f;
+            }
+            while (isdigit(*f)) {
+                precision = precision * 10 + (*f++ - '0');
+            }
+        }
+        int bits = sizeof(int) * 8;
+        switch (*f) {
+            case 'h':
+                bits = f[1] == 'h' ? 8 : 16;
+                f += f[1] == 'h' ? 2 : 1;
+                break;
+            case 'l':
+                bits = (f[1] == 'l' ? sizeof(long long) : sizeof(long)) * 8;
+                f += f[1] == 'l' ? 2 : 1;
+                break;
+            case 'z':
+                bits = sizeof(size_t) * 8;
+                ++f;
+                break;
+            case 'j':
+                bits = sizeof(intmax_t) * 8;
+                ++f;
+                break;
+            case 't':
+                bits = sizeof(ptrdiff_t) * 8;
+                ++f;
+                break;
+        }
+        const char conv = *f++;
+        const FormatArg& arg = *args++;
+
+        const bool plain = specLen == 1 && !hasWidth && precision < 0;
+        // Width and precision are always passed as arguments; a negative
+        // precision counts as none.
+        const size_t flagsLen = specLen;
+        spec[specLen++] = '*';
+        spec[specLen++] = '.';
+        spec[specLen++] = '*';
+        switch (conv) {
+            case 'd':
+            case 'i': {
+                const long long val = toSigned(arg.u, bits);
+                if (plain) {
+                    appendChars(buffer, val, 10);
+                } else {
+                    memcpy(spec + specLen, "lld", 4);
+                    StringAppendFormatRaw(buffer, spec, width, precision, val);
+                }
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o': {
+                const unsigned long long val = toUnsigned(arg.u, bits);
+                if (plain) {
+                    const size_t start = buffer->size();
+                    appendChars(buffer, val,
+                                conv == 'u' ? 10 : conv == 'o' ? 8 : 16);
+                    if (conv == 'X') {
+                        std::transform(buffer->begin() + start, buffer->end(),
+                                       buffer->begin() + start, ::toupper);
+                    }
+                } else {
+                    const char ll[] = {'l', 'l', conv, '\0'};
+                    memcpy(spec + specLen, ll, sizeof(ll));
+                    StringAppendFormatRaw(buffer, spec, width, precision, val);
+                }
+                break;
+            }
+            case 'c':
+                if (plain) {
+                    buffer->push_back(static_cast<char>(arg.u));
+                } else {
+                    memcpy(spec + specLen, "c", 2);
+                    StringAppendFormatRaw(buffer, spec, width, precision,
+                                          static_cast<int>(arg.u));
+                }
+                break;
+            case 's':
+                if (plain) {
+                    buffer->append(arg.s, arg.len);
+                } else {
+                    // The string may not be NUL-terminated, so printf()
+                    // is always told its length.
+                    memcpy(spec + specLen, "s", 2);
+                    const size_t len = precision < 0 ? arg.len
+                                       : std::min<size_t>(precision, arg.len);
+                    StringAppendFormatRaw(buffer, spec, width,
+                                          static_cast<int>(len), arg.s);
+                }
+                break;
+            case 'p':
+                memcpy(spec + flagsLen, "*p", 3);
+                StringAppendFormatRaw(buffer, spec, width, arg.p);
+                break;
+            default:
+                if (!plain || !appendDouble(buffer, arg.d, conv)) {
+                    const char fmt[] = {conv, '\0'};
+                    memcpy(spec + specLen, fmt, sizeof(fmt));
+                    StringAppendFormatRaw(buffer, spec, width, precision,
+                                          arg.d);
+                }
+                break;
+        }
+    }
+}
+
+}  // namespace internal
+
 }  // namespace base
 }  // namespace android
@@ -0,0 +1,100 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/StringFormat.h"
+
+#include "benchmark/benchmark.h"
+
+#include <stdint.h>
+
+namespace android {
+namespace base {
+namespace {
+
+// A typical log line: a few integers, a string and a double.
+constexpr char kLogLine[] = "frame %d of %s: %u bytes in %f ms";
+
+void BM_StringFormat(benchmark::State& state) {
+    int frame = 0;
+    for (auto _ : state) {
+        std::string line =
+                StringFormat(kLogLine, frame++, "display0", 8294400U, 16.6);
+        benchmark::DoNotOptimize(line.data());
+    }
+}
+BENCHMARK(BM_StringFormat);
+
+void BM_StringAppendFormat(benchmark::State& state) {
+    std::string line;
+    int frame = 0;
+    for (auto _ : state) {
+        line.clear();
+        StringAppendFormat(&line, kLogLine, frame++, "display0", 8294400U,
+                           16.6);
+        benchmark::DoNotOptimize(line.data());
+    }
+}
+BENCHMARK(BM_StringAppendFormat);
+
+void BM_StringFormatTo(benchmark::State& state) {
+    SmallFixedVector<char, 128> line;
+    int frame = 0;
+    for (auto _ : state) {
+        line.clear();
+        StringFormatTo(&line, kLogLine, frame++, "display0", 8294400U, 16.6);
+        benchmark::DoNotOptimize(line.data());
+    }
+}
+BENCHMARK(BM_StringFormatTo);
+
+void BM_StringFormatTo_Checked(benchmark::State& state) {
+    SmallFixedVector<char, 128> line;
+    int frame = 0;
+    for (auto _ : state) {
+        line.clear();
+        StringFormatTo<kLogLine>(&line, frame++, "display0", 8294400U, 16.6);
+        benchmark::DoNotOptimize(line.data());
+    }
+}
+BENCHMARK(BM_StringFormatTo_Checked);
+
+// Integers only, where std::to_chars() does all the work.
+constexpr char kCounters[] = "%d/%d/%llu";
+
+void BM_StringFormatTo_Integers(benchmark::State& state) {
+    SmallFixedVector<char, 64> line;
+    uint64_t n = 0;
+    for (auto _ : state) {
+        line.clear();
+        StringFormatTo(&line, kCounters, 1, 2, (unsigned long long)n++);
+        benchmark::DoNotOptimize(line.data());
+    }
+}
+BENCHMARK(BM_StringFormatTo_Integers);
+
+void BM_StringFormatTo_IntegersChecked(benchmark::State& state) {
+    SmallFixedVector<char, 64> line;
+    uint64_t n = 0;
+    for (auto _ : state) {
+        line.clear();
+        StringFormatTo<kCounters>(&line, 1, 2, (unsigned long long)n++);
+        benchmark::DoNotOptimize(line.data());
+    }
+}
+BENCHMARK(BM_StringFormatTo_IntegersChecked);
+
+}  // namespace
+}  // namespace base
+}  // namespace android
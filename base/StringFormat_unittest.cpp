@@ -15,6 +15,9 @@
 
 #include <gtest/gtest.h>
 
+#include <math.h>
+#include <stdio.h>
+
 namespace android {
 namespace base {
 
@@ -76,5 +79,64 @@ TEST(StringAppendFormat, VeryLongString) {
     }
 }
 
+static std::string toString(const SmallVector<char>& buffer) {
+    return std::string(buffer.data(), buffer.size());
+}
+
+TEST(StringFormatTo, FixedBuffer) {
+    SmallFixedVector<char, 32> buffer;
+    StringFormatTo(&buffer, "%s=%d", "answer", 42);
+    EXPECT_EQ("answer=42", toString(buffer));
+    EXPECT_EQ(32U, buffer.capacity());
+
+    std::string piece(100, 'x');
+    StringFormatTo(&buffer, " %s.", piece);
+    EXPECT_EQ("answer=42 " + piece + ".", toString(buffer));
+}
+
+static_assert(internal::checkFormat<int, const char*>("%d %s"), "");
+static_assert(internal::checkFormat<>("100%%"), "");
+static_assert(internal::checkFormat<int, double>("%*.3f"), "");
+static_assert(internal::checkFormat<size_t, long, char>("%zu %ld %c"), "");
+static_assert(!internal::checkFormat<int>("%s"), "");
+static_assert(!internal::checkFormat<const char*>("%d"), "");
+static_assert(!internal::checkFormat<int, int>("%d"), "");
+static_assert(!internal::checkFormat<int>("%d %d"), "");
+static_assert(!internal::checkFormat<long long>("%d"), "");
+static_assert(!internal::checkFormat<int*>("%n"), "");
+
+static constexpr char kMixed[] =
+        "[%d|%i|%u|%x|%X|%o|%c|%s|%s|%f|%e|%g|%G|%p|%%]";
+static constexpr char kSpecs[] =
+        "[%5d|%-5d|%+d|%05d|%.3d|%*d|%hhd|%hu|%llx|%#x|%zu|%8.3f|%.0e|%.10g|%"
+        ".2s|%-6s|%*s|%10p|%f|%g]";
+
+// Tests that the checked formatter prints what snprintf() would.
+TEST(StringFormatTo, MatchesPrintf) {
+    char expected[512];
+    int dummy;
+    SmallFixedVector<char, 64> buffer;
+
+    StringFormatTo<kMixed>(&buffer, -12, 7, 4000000000U, 0xbeefU, 0xbeefU,
+                           8U, 'q', "str", std::string("std"), 3.25, 1e-7,
+                           0.0001, 1e20, &dummy);
+    snprintf(expected, sizeof(expected), kMixed, -12, 7, 4000000000U, 0xbeefU,
+             0xbeefU, 8U, 'q', "str", "std", 3.25, 1e-7, 0.0001, 1e20,
+             static_cast<void*>(&dummy));
+    EXPECT_EQ(expected, toString(buffer));
+
+    buffer.clear();
+    StringFormatTo<kSpecs>(&buffer, 42, 42, 42, -42, 7, 6, 42, 300,
+                           static_cast<unsigned short>(65535),
+                           0x123456789abcULL, 255U, sizeof(buffer), 3.14159,
+                           12345.0, 1.0 / 3, std::string_view("abcdef"),
+                           "ab", 4, "cd", nullptr, 1e300, -INFINITY);
+    snprintf(expected, sizeof(expected), kSpecs, 42, 42, 42, -42, 7, 6, 42,
+             300, 65535, 0x123456789abcULL, 255U, sizeof(buffer), 3.14159,
+             12345.0, 1.0 / 3, "abcdef", "ab", 4, "cd",
+             static_cast<void*>(nullptr), 1e300, -INFINITY);
+    EXPECT_EQ(expected, toString(buffer));
+}
+
 }  // namespace base
 }  // namespace android
@@ -0,0 +1,225 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/StringParse.h"
+
+#include <locale.h>
+#include <stdlib.h>
+
+#include <string>
+
+namespace android {
+namespace base {
+
+namespace {
+
+template <class T>
+bool consumeFloat(std::string_view* text, T* out) {
+    std::string_view in = *text;
+    if (!in.empty() && in.front() == '+') {
+        in.remove_prefix(1);
+        if (!in.empty() && in.front() == '-') {
+            return false;
+        }
+    }
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    const auto res = std::from_chars(in.data(), in.data() + in.size(), *out);
+    if (res.ec != std::errc()) {
+        return false;
+    }
+    text->remove_prefix(res.ptr - text->data());
+    return true;
+#else
+    // No floating point from_chars on this standard library. strtod() needs
+    // a terminated string and reads the locale's decimal point; so only
+    // hand it the characters of a plain decimal number.
+    size_t length = 0;
+    while (length < in.size() &&
+           ((in[length] >= '0' && in[length] <= '9') || in[length] == '.' ||
+            in[length] == '-' || in[length] == 'e' || in[length] == 'E' ||
+            (length > 0 && in[length] == '+'))) {
+        ++length;
+    }
+    const std::string copy(in.substr(0, length));
+    if (copy.find('.') != std::string::npos && localeconv()->decimal_point[0] != '.') {
+        return false;
+    }
+    char* end = nullptr;
+    const double value = strtod(copy.c_str(), &end);
+    if (end == copy.c_str()) {
+        return false;
+    }
+    *out = static_cast<T>(value);
+    text->remove_prefix(in.data() - text->data() + (end - copy.c_str()));
+    return true;
+#endif
+}
+
+}  // namespace
+
+bool consumeDouble(std::string_view* text, double* out) {
+    return consumeFloat(text, out);
+}
+
+bool consumeDouble(std::string_view* text, float* out) {
+    return consumeFloat(text, out);
+}
+
+std::optional<uint64_t> parseHex(std::string_view text) {
+    if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        text.remove_prefix(2);
+    }
+    return parseInt<uint64_t>(text, 16);
+}
+
+std::optional<double> parseDouble(std::string_view text) {
+    double value;
+    if (!consumeDouble(&text, &value) || !text.empty()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+bool Tokenizer::next(std::string_view* token) {
+    while (!mDone) {
+        const size_t end = mText.find_first_of(mDelimiters, mPos);
+        const size_t start = mPos;
+        if (end == std::string_view::npos) {
+            mPos = mText.size();
+            mDone = true;
+            *token = mText.substr(start);
+        } else {
+            mPos = end + 1;
+            *token = mText.substr(start, end - start);
+        }
+        if (!token->empty() || !mSkipEmpty) {
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace internal {
+
+bool consumeToken(std::string_view* in, std::string_view* out) {
+    size_t length = 0;
+    while (length < in->size() && !ScanFormat::isSpace((*in)[length])) {
+        ++length;
+    }
+    if (!length) {
+        return false;
+    }
+    *out = in->substr(0, length);
+    in->remove_prefix(length);
+    return true;
+}
+
+namespace {
+
+bool skipField(std::string_view* in, char conv) {
+    switch (conv) {
+        case 'c':
+            if (in->empty()) return false;
+            in->remove_prefix(1);
+            return true;
+        case 's': {
+            std::string_view token;
+            return consumeToken(in, &token);
+        }
+        case 'd':
+        case 'i': {
+            int64_t value;
+            return consumeInt(in, &value, 10);
+        }
+        case 'u': {
+            uint64_t value;
+            return consumeInt(in, &value, 10);
+        }
+        case 'x':
+        case 'X': {
+            uint64_t value;
+            return consumeInt(in, &value, 16);
+        }
+        case 'n':
+            return true;
+        default: {
+            double value;
+            return consumeDouble(in, &value);
+        }
+    }
+}
+
+void skipSpace(std::string_view* in) {
+    while (!in->empty() && ScanFormat::isSpace(in->front())) {
+        in->remove_prefix(1);
+    }
+}
+
+}  // namespace
+
+int runScan(std::string_view input, const ScanFormat& format, const ScanSink* sinks,
+            size_t count) {
+    if (!format.valid()) {
+        return 0;
+    }
+    std::string_view in = input;
+    int stored = 0;
+    size_t sink = 0;
+    for (size_t i = 0; i < format.size(); ++i) {
+        const ScanFormat::Op& op = format.op(i);
+        switch (op.kind) {
+            case ScanFormat::OpKind::kSpace:
+                skipSpace(&in);
+                break;
+            case ScanFormat::OpKind::kLiteral: {
+                const std::string_view literal = format.literal(op);
+                if (in.substr(0, literal.size()) != literal) {
+                    return stored;
+                }
+                in.remove_prefix(literal.size());
+                break;
+            }
+            case ScanFormat::OpKind::kSkip:
+                if (op.conv != 'c' && op.conv != 'n') {
+                    skipSpace(&in);
+                }
+                if (!skipField(&in, op.conv)) {
+                    return stored;
+                }
+                break;
+            case ScanFormat::OpKind::kField:
+                if (sink == count) {
+                    return stored;
+                }
+                if (op.conv != 'c' && op.conv != 'n') {
+                    skipSpace(&in);
+                }
+                if (!sinks[sink].read(&in, op.conv, input.size() - in.size(),
+                                      sinks[sink].ptr)) {
+                    return stored;
+                }
+                ++sink;
+                if (op.conv != 'n') {
+                    ++stored;
+                }
+                break;
+        }
+    }
+    return stored;
+}
+
+}  // namespace internal
+
+}  // namespace base
+}  // namespace android
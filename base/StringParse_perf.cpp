@@ -0,0 +1,67 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/StringParse.h"
+
+#include "benchmark/benchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace android {
+namespace base {
+namespace {
+
+// What ThreadRoles reads from /proc/<pid>/task/<tid>/stat, after the comm.
+constexpr char kStatLine[] =
+        " S 1 2 3 4 5 6 7 8 9 10 123456 7890 0 0 20 0 1 0 100 0 0";
+constexpr char kStatFormat[] =
+        " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu";
+
+void BM_StringParse_Sscanf(benchmark::State& state) {
+    for (auto _ : state) {
+        unsigned long long utime, stime;
+        benchmark::DoNotOptimize(sscanf(kStatLine, kStatFormat, &utime, &stime));
+        benchmark::DoNotOptimize(utime + stime);
+    }
+}
+BENCHMARK(BM_StringParse_Sscanf);
+
+void BM_StringParse_Scan(benchmark::State& state) {
+    static constexpr ScanFormat kFormat(kStatFormat);
+    for (auto _ : state) {
+        uint64_t utime, stime;
+        benchmark::DoNotOptimize(scan(kStatLine, kFormat, &utime, &stime));
+        benchmark::DoNotOptimize(utime + stime);
+    }
+}
+BENCHMARK(BM_StringParse_Scan);
+
+void BM_StringParse_Strtod(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(strtod("0.1234", nullptr));
+    }
+}
+BENCHMARK(BM_StringParse_Strtod);
+
+void BM_StringParse_ParseDouble(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parseDouble("0.1234"));
+    }
+}
+BENCHMARK(BM_StringParse_ParseDouble);
+
+}  // namespace
+}  // namespace base
+}  // namespace android
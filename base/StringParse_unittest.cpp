@@ -8,67 +8,150 @@
 //
 // Unless required by applicable law or agreed to in writing, software
 // distributed under the License is distributed on an "AS IS" BASIS,
-// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either expresso or implied.
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include "android/base/StringParse.h"
+#include "aemu/base/StringParse.h"
 
-#include "android/base/threads/FunctorThread.h"
-#include "aemu/base/testing/Utils.h"
 #include <gtest/gtest.h>
 
+#include <locale.h>
+
+#include <string>
+#include <vector>
+
 namespace android {
 namespace base {
 
-static void testScanf() {
-    static const char comma[] = "1,3";
-    static const char dot[] = "1.3";
-    static const char format[] = "%f%n";
-    float val = 0;
-    int n = 0;
-
-    // Now make sure we parse floating point strings as expected.
-    EXPECT_EQ(1, sscanf(dot, format, &val, &n));
-    EXPECT_FLOAT_EQ(1, val);
-    EXPECT_EQ(1, n);
-    EXPECT_EQ(1, sscanf(comma, format, &val, &n));
-    EXPECT_FLOAT_EQ(1.3, val);
-    EXPECT_EQ(3, n);
-
-    // C-Locale parsing should be able to parse strings with C locale
-    EXPECT_EQ(1, SscanfWithCLocale(dot, format, &val, &n));
-    EXPECT_FLOAT_EQ(1.3, val);
-    EXPECT_EQ(3, n);
-
-    // And the regular parsing still works as it used to.
-    EXPECT_EQ(1, sscanf(dot, format, &val, &n));
-    EXPECT_FLOAT_EQ(1, val);
-    EXPECT_EQ(1, n);
-    EXPECT_EQ(1, sscanf(comma, format, &val, &n));
-    EXPECT_FLOAT_EQ(1.3, val);
-    EXPECT_EQ(3, n);
-}
+// Tests that integers parse whole, in range, with an optional '+'.
+TEST(StringParse, ParseInt) {
+    EXPECT_EQ(42, parseInt<int>("42"));
+    EXPECT_EQ(-7, parseInt<int>("-7"));
+    EXPECT_EQ(7, parseInt<int>("+7"));
+    EXPECT_EQ(255, parseInt<int>("ff", 16));
+    EXPECT_EQ(INT32_MAX, parseInt<int32_t>("2147483647"));
+    EXPECT_EQ(std::nullopt, parseInt<int32_t>("2147483648"));
+    EXPECT_EQ(std::nullopt, parseInt<uint32_t>("-1"));
+    EXPECT_EQ(std::nullopt, parseInt<int>("+-1"));
+    EXPECT_EQ(std::nullopt, parseInt<int>(""));
+    EXPECT_EQ(std::nullopt, parseInt<int>(" 1"));
+    EXPECT_EQ(std::nullopt, parseInt<int>("1x"));
 
-// These are flaky as they depend on the build env.
-TEST(StringParse, DISABLED_SscanfWithCLocale) {
-    auto scopedCommaLocale = setScopedCommaLocale();
-    testScanf();
+    EXPECT_EQ(0x1fu, parseHex("1f"));
+    EXPECT_EQ(0xABCDu, parseHex("0xABCD"));
+    EXPECT_EQ(std::nullopt, parseHex("0x"));
+    EXPECT_EQ(std::nullopt, parseHex("0xg"));
 }
 
-TEST(StringParse, DISABLED_SscanfWithCLocaleThreads) {
-    auto scopedCommaLocale = setScopedCommaLocale();
+// Tests that doubles use '.' whatever the locale says.
+TEST(StringParse, ParseDoubleIgnoresLocale) {
+    EXPECT_EQ(1.5, parseDouble("1.5"));
+    EXPECT_EQ(-2e3, parseDouble("-2e3"));
+    EXPECT_EQ(0.25, parseDouble("+.25"));
+    EXPECT_EQ(std::nullopt, parseDouble("1,5"));
+    EXPECT_EQ(std::nullopt, parseDouble("1.5 "));
+    EXPECT_EQ(std::nullopt, parseDouble(""));
 
-    std::vector<std::unique_ptr<FunctorThread>> threads;
-    for (int i = 0; i < 20; ++i) {
-        threads.emplace_back(new FunctorThread(&testScanf));
+    const std::string saved = setlocale(LC_NUMERIC, nullptr);
+    for (const char* name : {"de_DE.UTF-8", "fr_FR.UTF-8", "ru_RU.UTF-8"}) {
+        if (setlocale(LC_NUMERIC, name)) {
+            EXPECT_EQ(1.5, parseDouble("1.5")) << name;
+            EXPECT_EQ(std::nullopt, parseDouble("1,5")) << name;
+        }
     }
-    for (auto& t : threads) {
-        ASSERT_TRUE(t->start());
-    }
-    for (auto& t : threads) {
-        ASSERT_TRUE(t->wait());
+    setlocale(LC_NUMERIC, saved.c_str());
+}
+
+// Tests that tokens are views into the text, with or without the empty
+// ones between adjacent delimiters.
+TEST(StringParse, Tokenizer) {
+    const std::string_view text = "  cpu  12 ,34\n";
+    std::vector<std::string_view> tokens;
+    std::string_view token;
+    Tokenizer words(text);
+    while (words.next(&token)) {
+        tokens.push_back(token);
     }
+    EXPECT_EQ((std::vector<std::string_view>{"cpu", "12", ",34"}), tokens);
+    EXPECT_EQ(text.data() + 2, tokens[0].data());
+    EXPECT_TRUE(words.rest().empty());
+
+    Tokenizer fields("a,,b,", ",", false);
+    ASSERT_TRUE(fields.next(&token));
+    EXPECT_EQ("a", token);
+    EXPECT_EQ(",b,", fields.rest());
+    ASSERT_TRUE(fields.next(&token));
+    EXPECT_EQ("", token);
+    ASSERT_TRUE(fields.next(&token));
+    EXPECT_EQ("b", token);
+    ASSERT_TRUE(fields.next(&token));
+    EXPECT_EQ("", token);
+    EXPECT_FALSE(fields.next(&token));
+
+    Tokenizer empty("");
+    EXPECT_FALSE(empty.next(&token));
+}
+
+// Tests that formats are parsed at compile time, and that bad ones are
+// caught.
+TEST(StringParse, ScanFormat) {
+    static constexpr ScanFormat kStat(" %*c %*d %llu %llu%n");
+    static_assert(kStat.valid(), "");
+    static_assert(kStat.fields() == 2, "");
+    static_assert(kStat.op(0).kind == ScanFormat::OpKind::kSpace, "");
+    static_assert(kStat.op(1).kind == ScanFormat::OpKind::kSkip, "");
+    static_assert(kStat.op(1).conv == 'c', "");
+
+    static constexpr ScanFormat kLiteral("some avg10=%f 100%%");
+    static_assert(kLiteral.valid(), "");
+    static_assert(kLiteral.fields() == 1, "");
+    EXPECT_EQ("some", kLiteral.literal(kLiteral.op(0)));
+    EXPECT_EQ("avg10=", kLiteral.literal(kLiteral.op(2)));
+
+    static_assert(!ScanFormat("%q").valid(), "");
+    static_assert(!ScanFormat("%").valid(), "");
+    static_assert(!ScanFormat("%ll").valid(), "");
+}
+
+// Tests that scan() reads what sscanf() would, into the types it is given.
+TEST(StringParse, Scan) {
+    uint64_t utime = 0, stime = 0;
+    EXPECT_EQ(2, scan("S 1 2 3 4 5 6 7 8 9 10 1234 5678 99",
+                      " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+                      &utime, &stime));
+    EXPECT_EQ(1234u, utime);
+    EXPECT_EQ(5678u, stime);
+
+    float avg10 = 0;
+    EXPECT_EQ(1, scan("some avg10=1.25 avg60=0.00", "some avg10=%f", &avg10));
+    EXPECT_EQ(1.25f, avg10);
+    EXPECT_EQ(0, scan("full avg10=1.25", "some avg10=%f", &avg10));
+
+    int a = 0, b = 0, consumed = 0;
+    char c = 0;
+    std::string_view word;
+    EXPECT_EQ(4, scan("12:-3 x word rest", "%d:%d %c %s%n", &a, &b, &c, &word, &consumed));
+    EXPECT_EQ(12, a);
+    EXPECT_EQ(-3, b);
+    EXPECT_EQ('x', c);
+    EXPECT_EQ("word", word);
+    EXPECT_EQ(12, consumed);
+
+    unsigned hex = 0;
+    EXPECT_EQ(1, scan("VmRSS:\t  ff kB", "VmRSS: %x kB", &hex));
+    EXPECT_EQ(0xffu, hex);
+
+    // Stops at the first mismatch, keeping what was stored.
+    a = b = 0;
+    EXPECT_EQ(1, scan("5,x", "%d,%d", &a, &b));
+    EXPECT_EQ(5, a);
+    EXPECT_EQ(0, b);
+    EXPECT_EQ(0, scan("", "%d", &a));
+    EXPECT_EQ(0, scan("300", "%d", &c));
+
+    // A conversion that doesn't suit its argument is a mismatch.
+    EXPECT_EQ(0, scan("1.5", "%f", &a));
 }
 
 }  // namespace base
@@ -17,12 +17,20 @@
 #include "aemu/base/files/Stream.h"
 
 #include <iomanip>
+#include <iterator>
+#include <map>
+#include <set>
 #include <sstream>
 #include <string>
+#include <utility>
 
 namespace android {
 namespace base {
 
+// Keeps the same blocks as address_space_allocator, with the same best fit
+// placement, but indexes them instead of keeping one sorted array: all blocks
+// by offset, and the available ones by (size, offset). alloc() and free() are
+// O(log n) in the number of blocks rather than a scan and a memmove.
 class SubAllocator::Impl {
 public:
     Impl(
@@ -34,44 +42,34 @@ public:
         pageSize(_pageSize),
         startAddr((uintptr_t)buffer),
         endAddr(startAddr + totalSize) {
-
-        address_space_allocator_init(
-            &addr_alloc,
-            totalSize,
-            32);
-    }
-
-    ~Impl() {
-        address_space_allocator_destroy_nocleanup(&addr_alloc);
+        clear();
     }
 
     void clear() {
-        address_space_allocator_destroy_nocleanup(&addr_alloc);
-        address_space_allocator_init(
-            &addr_alloc,
-            totalSize,
-            32);
+        blocks.clear();
+        freeBlocks.clear();
+        addBlock(0, totalSize, true);
+        allocCount = 0;
     }
 
+    // The format is the one of address_space_allocator_run(), so that older
+    // snapshots still load.
     bool save(Stream* stream) {
-        address_space_allocator_iter_func_t allocatorSaver =
-            [](void* context, struct address_space_allocator* allocator) {
-                Stream* stream = reinterpret_cast<Stream*>(context);
-                stream->putBe32(allocator->size);
-                stream->putBe32(allocator->capacity);
-                stream->putBe64(allocator->total_bytes);
-            };
-        address_block_iter_func_t allocatorBlockSaver =
-            [](void* context, struct address_block* block) {
-                Stream* stream = reinterpret_cast<Stream*>(context);
-                stream->putBe64(block->offset);
-                stream->putBe64(block->size_available);
-            };
-        address_space_allocator_run(
-            &addr_alloc,
-            (void*)stream,
-            allocatorSaver,
-            allocatorBlockSaver);
+        uint32_t capacity = kInitialCapacity;
+        while (capacity < blocks.size()) {
+            capacity *= 2;
+        }
+        stream->putBe32(blocks.size());
+        stream->putBe32(capacity);
+        stream->putBe64(totalSize);
+        for (const auto& it : blocks) {
+            struct address_block block = {};
+            block.offset = it.first;
+            block.size = it.second.size;
+            block.available = it.second.available;
+            stream->putBe64(block.offset);
+            stream->putBe64(block.size_available);
+        }
 
         stream->putBe64(pageSize);
         stream->putBe64(totalSize);
@@ -81,30 +79,35 @@ public:
     }
 
     bool load(Stream* stream) {
-        clear();
-        address_space_allocator_iter_func_t allocatorLoader =
-            [](void* context, struct address_space_allocator* allocator) {
-                Stream* stream = reinterpret_cast<Stream*>(context);
-                allocator->size = stream->getBe32();
-                allocator->capacity = stream->getBe32();
-                allocator->total_bytes = stream->getBe64();
-            };
-        address_block_iter_func_t allocatorBlockLoader =
-            [](void* context, struct address_block* block) {
-                Stream* stream = reinterpret_cast<Stream*>(context);
-                block->offset = stream->getBe64();
-                block->size_available = stream->getBe64();
-            };
-        address_space_allocator_run(
-            &addr_alloc,
-            (void*)stream,
-            allocatorLoader,
-            allocatorBlockLoader);
+        blocks.clear();
+        freeBlocks.clear();
+        const uint32_t count = stream->getBe32();
+        stream->getBe32();  // capacity
+        const uint64_t totalBytes = stream->getBe64();
+        uint64_t end = 0;
+        bool valid = count > 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            struct address_block block;
+            block.offset = stream->getBe64();
+            block.size_available = stream->getBe64();
+            if (block.offset != end || !block.size) {
+                valid = false;
+            }
+            if (valid) {
+                addBlock(block.offset, block.size, block.available);
+            }
+            end = block.offset + block.size;
+        }
 
         pageSize = stream->getBe64();
         totalSize = stream->getBe64();
         allocCount = stream->getBe32();
 
+        if (!valid || end != totalBytes || totalBytes != totalSize) {
+            clear();
+            return false;
+        }
+        endAddr = startAddr + totalSize;
         return true;
     }
 
@@ -139,18 +142,37 @@ public:
         if (!ptr) return false;
 
         rangeCheck("free", ptr);
-        if (EINVAL == address_space_allocator_deallocate(
-            &addr_alloc, getOffset(ptr))) {
+        auto it = blocks.find(getOffset(ptr));
+        if (it == blocks.end() || it->second.available) {
             return false;
         }
 
+        uint64_t offset = it->first;
+        uint64_t size = it->second.size;
+        if (it != blocks.begin()) {
+            auto prev = std::prev(it);
+            if (prev->second.available) {
+                freeBlocks.erase({prev->second.size, prev->first});
+                offset = prev->first;
+                size += prev->second.size;
+                blocks.erase(prev);
+            }
+        }
+        auto next = std::next(it);
+        if (next != blocks.end() && next->second.available) {
+            freeBlocks.erase({next->second.size, next->first});
+            size += next->second.size;
+            blocks.erase(next);
+        }
+        blocks.erase(it);
+        addBlock(offset, size, true);
+
         --allocCount;
         return true;
     }
 
     void freeAll() {
-        address_space_allocator_reset(&addr_alloc);
-        allocCount = 0;
+        clear();
     }
 
     void* alloc(size_t wantedSize) {
@@ -160,13 +182,25 @@ public:
             pageSize *
             ((wantedSize + pageSize - 1) / pageSize);
 
-        uint64_t offset =
-            address_space_allocator_allocate(
-                &addr_alloc, toPageSize);
-
-        if (offset == ANDROID_EMU_ADDRESS_SPACE_BAD_OFFSET) {
+        // Smallest block that fits, the lowest one among equals.
+        auto best = freeBlocks.lower_bound({toPageSize, 0});
+        if (best == freeBlocks.end()) {
             return nullptr;
         }
+        const uint64_t blockSize = best->first;
+        const uint64_t blockOffset = best->second;
+        freeBlocks.erase(best);
+
+        // Like address_space_allocator_split_block(), take the tail of it.
+        uint64_t offset = blockOffset;
+        if (blockSize > toPageSize) {
+            blocks[blockOffset].size = blockSize - toPageSize;
+            freeBlocks.emplace(blockSize - toPageSize, blockOffset);
+            offset = blockOffset + blockSize - toPageSize;
+            blocks.emplace(offset, Block{toPageSize, false});
+        } else {
+            blocks[blockOffset].available = false;
+        }
 
         ++allocCount;
         return (void*)(uintptr_t)(startAddr + offset);
@@ -180,11 +214,27 @@ public:
             pageSize *
             ((wantedSize + pageSize - 1) / pageSize);
 
-        if (address_space_allocator_allocate_fixed(
-                &addr_alloc, toPageSize, offset)) {
+        auto it = blocks.upper_bound(offset);
+        if (it == blocks.begin()) {
+            return nullptr;
+        }
+        --it;
+        const uint64_t blockOffset = it->first;
+        const uint64_t blockEnd = blockOffset + it->second.size;
+        if (!it->second.available || offset + toPageSize > blockEnd) {
             return nullptr;
         }
 
+        freeBlocks.erase({it->second.size, blockOffset});
+        blocks.erase(it);
+        if (offset > blockOffset) {
+            addBlock(blockOffset, offset - blockOffset, true);
+        }
+        addBlock(offset, toPageSize, false);
+        if (offset + toPageSize < blockEnd) {
+            addBlock(offset + toPageSize, blockEnd - offset - toPageSize, true);
+        }
+
         ++allocCount;
         return (void*)(uintptr_t)(startAddr + offset);
     }
@@ -193,12 +243,35 @@ public:
         return allocCount == 0;
     }
 
+    bool contains(const void* ptr) const {
+        const uint64_t addr = (uintptr_t)ptr;
+        return addr >= startAddr && addr < endAddr;
+    }
+
+    struct Block {
+        uint64_t size;
+        bool available;
+    };
+
+    // address_space_allocator_init() capacity used by older versions.
+    static constexpr uint32_t kInitialCapacity = 32;
+
+    void addBlock(uint64_t offset, uint64_t size, bool available) {
+        blocks.emplace(offset, Block{size, available});
+        if (available) {
+            freeBlocks.emplace(size, offset);
+        }
+    }
+
     void* buffer;
     uint64_t totalSize;
     uint64_t pageSize;
     uint64_t startAddr;
     uint64_t endAddr;
-    struct address_space_allocator addr_alloc;
+    // All blocks by offset; they cover [0, totalSize) without gaps.
+    std::map<uint64_t, Block> blocks;
+    // Available blocks by (size, offset).
+    std::set<std::pair<uint64_t, uint64_t>> freeBlocks;
     uint32_t allocCount = 0;
 };
 
@@ -250,5 +323,9 @@ bool SubAllocator::empty() const {
     return mImpl->empty();
 }
 
+bool SubAllocator::contains(const void* ptr) const {
+    return mImpl->contains(ptr);
+}
+
 } // namespace base
 } // namespace android
@@ -0,0 +1,62 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/SubAllocator.h"
+
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+constexpr uint64_t kBufferSize = 16 * 1024 * 1024;
+constexpr uint64_t kPageSize = 4096;
+
+void BM_SubAllocator_AllocFree(benchmark::State& state) {
+    const size_t size = size_t(state.range(0));
+    std::vector<uint8_t> buffer(kBufferSize);
+    SubAllocator allocator(buffer.data(), kBufferSize, kPageSize);
+    for (auto _ : state) {
+        void* ptr = allocator.alloc(size);
+        benchmark::DoNotOptimize(ptr);
+        allocator.free(ptr);
+    }
+}
+BENCHMARK(BM_SubAllocator_AllocFree)->Arg(64)->Arg(64 * 1024)->Arg(1024 * 1024);
+
+// A fragmented heap: every other block stays allocated.
+void BM_SubAllocator_Fragmented(benchmark::State& state) {
+    std::vector<uint8_t> buffer(kBufferSize);
+    SubAllocator allocator(buffer.data(), kBufferSize, kPageSize);
+    std::vector<void*> blocks;
+    while (void* ptr = allocator.alloc(kPageSize)) {
+        blocks.push_back(ptr);
+    }
+    for (size_t i = 0; i < blocks.size(); i += 2) {
+        allocator.free(blocks[i]);
+    }
+    for (auto _ : state) {
+        void* ptr = allocator.alloc(kPageSize);
+        benchmark::DoNotOptimize(ptr);
+        allocator.free(ptr);
+    }
+}
+BENCHMARK(BM_SubAllocator_Fragmented);
+
+}  // namespace
+}  // namespace base
+}  // namespace android
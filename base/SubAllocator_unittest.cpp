@@ -14,10 +14,12 @@
 #include "aemu/base/SubAllocator.h"
 
 #include "aemu/base/ArraySize.h"
+#include "aemu/base/address_space.h"
 #include "aemu/base/files/MemStream.h"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <random>
 #include <string>
 
@@ -286,5 +288,138 @@ TEST(SubAllocator, Snapshot) {
     }
 }
 
+// Saves |allocator| the way SubAllocator did when it was backed by
+// address_space_allocator.
+static void saveAddressSpaceAllocator(address_space_allocator* allocator,
+                                      uint64_t pageSize,
+                                      uint32_t allocCount,
+                                      Stream* stream) {
+    address_space_allocator_run(
+        allocator, stream,
+        [](void* context, struct address_space_allocator* allocator) {
+            Stream* stream = reinterpret_cast<Stream*>(context);
+            stream->putBe32(allocator->size);
+            stream->putBe32(allocator->capacity);
+            stream->putBe64(allocator->total_bytes);
+        },
+        [](void* context, struct address_block* block) {
+            Stream* stream = reinterpret_cast<Stream*>(context);
+            stream->putBe64(block->offset);
+            stream->putBe64(block->size_available);
+        });
+    stream->putBe64(pageSize);
+    stream->putBe64(allocator->total_bytes);
+    stream->putBe32(allocCount);
+}
+
+// Test: placement and the snapshot format match address_space_allocator, so
+// snapshots taken before SubAllocator indexed its blocks still load.
+TEST(SubAllocator, MatchesAddressSpaceAllocator) {
+    const uint64_t pageSize = 64;
+    const uint64_t bufferSize = 1 << 20;
+    std::vector<uint8_t> buffer(bufferSize);
+    SubAllocator subAlloc(buffer.data(), bufferSize, pageSize);
+
+    address_space_allocator reference;
+    address_space_allocator_init(&reference, bufferSize, 32);
+
+    std::default_random_engine generator;
+    generator.seed(0);
+    std::uniform_int_distribution<uint64_t> pagesDistribution(1, 16);
+    std::vector<uint64_t> live;
+    for (int i = 0; i < 2000; ++i) {
+        if (live.empty() || generator() % 3) {
+            const uint64_t size = pageSize * pagesDistribution(generator);
+            uint64_t expected = address_space_allocator_allocate(&reference, size);
+            void* ptr = subAlloc.alloc(size);
+            if (expected == ANDROID_EMU_ADDRESS_SPACE_BAD_OFFSET) {
+                EXPECT_EQ(nullptr, ptr);
+                continue;
+            }
+            ASSERT_NE(nullptr, ptr);
+            ASSERT_EQ(expected, subAlloc.getOffset(ptr));
+            live.push_back(expected);
+        } else {
+            const size_t index = generator() % live.size();
+            EXPECT_EQ(0u, address_space_allocator_deallocate(&reference, live[index]));
+            EXPECT_TRUE(subAlloc.free(buffer.data() + live[index]));
+            live.erase(live.begin() + index);
+        }
+    }
+
+    MemStream expected;
+    saveAddressSpaceAllocator(&reference, pageSize, live.size(), &expected);
+    MemStream saved;
+    subAlloc.save(&saved);
+    EXPECT_EQ(expected.buffer(), saved.buffer());
+
+    // Load the old format and carry on allocating from it.
+    SubAllocator loaded(buffer.data(), bufferSize, pageSize);
+    EXPECT_TRUE(loaded.load(&expected));
+    EXPECT_TRUE(loaded.postLoad(buffer.data()));
+    for (uint64_t offset : live) {
+        EXPECT_TRUE(loaded.free(buffer.data() + offset));
+    }
+    EXPECT_TRUE(loaded.empty());
+    EXPECT_NE(nullptr, loaded.alloc(bufferSize));
+
+    address_space_allocator_destroy_nocleanup(&reference);
+}
+
+// Test: many live suballocations never overlap, and freeing all of them
+// merges the buffer back into a single block.
+TEST(SubAllocator, ManyAllocations) {
+    const uint64_t pageSize = 4096;
+    const size_t count = 50000;
+    const uint64_t bufferSize = pageSize * count;
+    // Never dereferenced; only needs to keep offset 0 from being nullptr.
+    char* const base = reinterpret_cast<char*>(uintptr_t(0x10000));
+    SubAllocator subAlloc(base, bufferSize, pageSize);
+
+    std::vector<uint64_t> offsets;
+    for (size_t i = 0; i < count; ++i) {
+        void* ptr = subAlloc.alloc(pageSize);
+        ASSERT_NE(nullptr, ptr);
+        offsets.push_back(subAlloc.getOffset(ptr));
+    }
+    EXPECT_EQ(nullptr, subAlloc.alloc(1));
+
+    std::vector<uint64_t> sorted = offsets;
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < count; ++i) {
+        ASSERT_EQ(i * pageSize, sorted[i]);
+    }
+
+    std::default_random_engine generator;
+    generator.seed(0);
+    std::shuffle(offsets.begin(), offsets.end(), generator);
+    for (uint64_t offset : offsets) {
+        ASSERT_TRUE(subAlloc.free(base + offset));
+    }
+    EXPECT_TRUE(subAlloc.empty());
+    EXPECT_NE(nullptr, subAlloc.allocFixed(bufferSize, 0));
+}
+
+// Test: allocFixed() only succeeds inside a single available block.
+TEST(SubAllocator, AllocFixed) {
+    const uint64_t pageSize = 64;
+    std::vector<uint8_t> buffer(64 * pageSize);
+    SubAllocator subAlloc(buffer.data(), buffer.size(), pageSize);
+
+    EXPECT_EQ(buffer.data() + 4 * pageSize,
+              subAlloc.allocFixed(2 * pageSize, 4 * pageSize));
+    EXPECT_EQ(nullptr, subAlloc.allocFixed(pageSize, 5 * pageSize));
+    EXPECT_EQ(nullptr, subAlloc.allocFixed(2 * pageSize, 3 * pageSize));
+    EXPECT_EQ(buffer.data() + 3 * pageSize,
+              subAlloc.allocFixed(pageSize, 3 * pageSize));
+    EXPECT_EQ(nullptr, subAlloc.allocFixed(pageSize, 64 * pageSize));
+
+    EXPECT_TRUE(subAlloc.free(buffer.data() + 4 * pageSize));
+    EXPECT_FALSE(subAlloc.free(buffer.data() + 4 * pageSize));
+    EXPECT_TRUE(subAlloc.free(buffer.data() + 3 * pageSize));
+    EXPECT_TRUE(subAlloc.empty());
+    EXPECT_NE(nullptr, subAlloc.alloc(buffer.size()));
+}
+
 } // namespace base
 } // namespace android
@@ -13,7 +13,9 @@
 // limitations under the License.
 
 #include "aemu/base/EintrWrapper.h"
+#include "aemu/base/LatencyHistogram.h"
 #include "aemu/base/StringFormat.h"
+#include "aemu/base/system/FastClock.h"
 #include "aemu/base/system/System.h"
 #include "aemu/base/threads/Thread.h"
 
@@ -50,6 +52,24 @@
 #include <unistd.h>
 #endif
 
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <memory>
+
+#include <errno.h>
+#include <stddef.h>
 #include <string.h>
 
 using FileSize = uint64_t;
@@ -254,8 +274,9 @@ void sleepToUs(uint64_t absTimeUs) {
     ts.tv_nsec = absTimeUs * 1000ULL - ts.tv_sec * 1000000000ULL;
     int ret;
     do {
+        // Returns the error rather than setting errno.
         ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
-    } while (ret == -1 && errno == EINTR);
+    } while (ret == EINTR);
 #else // _WIN32
 
     // Create a persistent thread local timer object
@@ -310,6 +331,55 @@ void sleepToUs(uint64_t absTimeUs) {
 #endif
 }
 
+namespace {
+
+// How late an OS sleep is assumed to wake before this thread has slept.
+#ifdef _WIN32
+constexpr uint64_t kInitialOversleepUs = 500;
+#else
+constexpr uint64_t kInitialOversleepUs = 100;
+#endif
+// The most sleepUntilUs() spins, however late sleeps have been.
+constexpr uint64_t kMaxSpinUs = 2000;
+
+void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+}  // namespace
+
+uint64_t sleepUntilUs(uint64_t deadlineUs, uint64_t toleranceUs) {
+    static thread_local uint64_t tOversleepUs = kInitialOversleepUs;
+    const uint64_t marginUs =
+            tOversleepUs > toleranceUs ? tOversleepUs - toleranceUs : 0;
+    uint64_t nowUs = FastClock::nowUs();
+    if (nowUs + marginUs < deadlineUs) {
+        const uint64_t wakeUs = deadlineUs - marginUs;
+        sleepToUs(wakeUs);
+        nowUs = FastClock::nowUs();
+        // Follow late wakeups quickly and early ones slowly, as a late one
+        // costs a missed deadline and an early one only a longer spin.
+        const uint64_t oversleepUs =
+                std::min(nowUs > wakeUs ? nowUs - wakeUs : 0, kMaxSpinUs);
+        if (oversleepUs > tOversleepUs) {
+            tOversleepUs += (oversleepUs - tOversleepUs + 1) / 2;
+        } else {
+            tOversleepUs -= (tOversleepUs - oversleepUs) / 16;
+        }
+    }
+    while (nowUs < deadlineUs) {
+        cpuRelax();
+        nowUs = FastClock::nowUs();
+    }
+    const uint64_t lateUs = nowUs - deadlineUs;
+    recordLatency(LatencyMetric::kSleepLateness, lateUs);
+    return lateUs;
+}
+
 uint64_t getUnixTimeUs() {
     timeval tv;
     gettimeofday(&tv, nullptr);
@@ -581,6 +651,202 @@ bool queryFileVersionInfo(const char*, int*, int*, int*, int*) {
 }
 #endif // _WIN32
 
+#ifdef _WIN32
+
+bool scanDirEntries(const std::string& dirPath,
+                    std::vector<DirEntry>* entries,
+                    bool withMetadata) {
+    HANDLE dir = ::CreateFileW(Win32UnicodeString(dirPath).c_str(),
+                               FILE_LIST_DIRECTORY,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS,
+                               nullptr);
+    if (dir == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    // FILE_ID_BOTH_DIR_INFO records must be 8-byte aligned.
+    constexpr DWORD kBufferSize = 64 * 1024;
+    std::unique_ptr<uint64_t[]> buffer(new uint64_t[kBufferSize / sizeof(uint64_t)]);
+    // 100ns ticks between 1601-01-01 and 1970-01-01.
+    constexpr int64_t kUnixEpochTicks = 116444736000000000LL;
+
+    FILE_INFO_BY_HANDLE_CLASS infoClass = FileIdBothDirectoryRestartInfo;
+    while (::GetFileInformationByHandleEx(dir, infoClass, buffer.get(), kBufferSize)) {
+        infoClass = FileIdBothDirectoryInfo;
+        auto info = reinterpret_cast<const FILE_ID_BOTH_DIR_INFO*>(buffer.get());
+        for (;;) {
+            const int len = static_cast<int>(info->FileNameLength / sizeof(WCHAR));
+            const wchar_t* name = info->FileName;
+            const bool dots = (len == 1 && name[0] == L'.') ||
+                              (len == 2 && name[0] == L'.' && name[1] == L'.');
+            if (!dots) {
+                DirEntry entry;
+                entry.name = Win32UnicodeString::convertToUtf8(name, len);
+                const DWORD attrs = info->FileAttributes;
+                if (attrs & FILE_ATTRIBUTE_REPARSE_POINT) {
+                    // For reparse points EaSize holds the reparse tag.
+                    entry.type = info->EaSize == IO_REPARSE_TAG_SYMLINK
+                                         ? DirEntry::Type::Symlink
+                                         : DirEntry::Type::Other;
+                } else if (attrs & FILE_ATTRIBUTE_DIRECTORY) {
+                    entry.type = DirEntry::Type::Directory;
+                } else {
+                    entry.type = DirEntry::Type::File;
+                }
+                entry.fileId = static_cast<uint64_t>(info->FileId.QuadPart);
+                if (withMetadata) {
+                    entry.size = static_cast<uint64_t>(info->EndOfFile.QuadPart);
+                    const int64_t ticks = info->LastWriteTime.QuadPart;
+                    entry.modifiedUs = ticks > kUnixEpochTicks
+                                               ? (ticks - kUnixEpochTicks) / 10
+                                               : 0;
+                }
+                entries->push_back(std::move(entry));
+            }
+            if (!info->NextEntryOffset) {
+                break;
+            }
+            info = reinterpret_cast<const FILE_ID_BOTH_DIR_INFO*>(
+                    reinterpret_cast<const char*>(info) + info->NextEntryOffset);
+        }
+    }
+    const bool ok = ::GetLastError() == ERROR_NO_MORE_FILES;
+    ::CloseHandle(dir);
+    return ok;
+}
+
+#else  // !_WIN32
+
+namespace {
+
+bool isDotOrDotDot(const char* name) {
+    return name[0] == '.' &&
+           (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+DirEntry::Type typeFromMode(mode_t mode) {
+    if (S_ISREG(mode)) return DirEntry::Type::File;
+    if (S_ISDIR(mode)) return DirEntry::Type::Directory;
+    if (S_ISLNK(mode)) return DirEntry::Type::Symlink;
+    return DirEntry::Type::Other;
+}
+
+#ifdef DT_UNKNOWN
+DirEntry::Type typeFromDirent(unsigned char type) {
+    switch (type) {
+        case DT_REG: return DirEntry::Type::File;
+        case DT_DIR: return DirEntry::Type::Directory;
+        case DT_LNK: return DirEntry::Type::Symlink;
+        case DT_UNKNOWN: return DirEntry::Type::Unknown;
+        default: return DirEntry::Type::Other;
+    }
+}
+#endif
+
+// Builds an entry for |name| in the directory open as |dirFd|, calling
+// fstatat() only when metadata is wanted or the type is still unknown.
+void addEntry(int dirFd,
+              const char* name,
+              uint64_t ino,
+              DirEntry::Type type,
+              bool withMetadata,
+              std::vector<DirEntry>* entries) {
+    DirEntry entry;
+    entry.name = name;
+    entry.type = type;
+    entry.fileId = ino;
+    if (withMetadata || type == DirEntry::Type::Unknown) {
+        struct stat st;
+        if (fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+            entry.type = typeFromMode(st.st_mode);
+            if (withMetadata) {
+                entry.size = static_cast<uint64_t>(st.st_size);
+#if defined(__APPLE__)
+                entry.modifiedUs = st.st_mtimespec.tv_sec * 1000000ULL +
+                                   st.st_mtimespec.tv_nsec / 1000;
+#elif defined(__linux__)
+                entry.modifiedUs = st.st_mtim.tv_sec * 1000000ULL +
+                                   st.st_mtim.tv_nsec / 1000;
+#else
+                entry.modifiedUs = st.st_mtime * 1000000ULL;
+#endif
+            }
+        }
+    }
+    entries->push_back(std::move(entry));
+}
+
+}  // namespace
+
+bool scanDirEntries(const std::string& dirPath,
+                    std::vector<DirEntry>* entries,
+                    bool withMetadata) {
+    int fd = HANDLE_EINTR(open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (fd < 0) {
+        return false;
+    }
+
+#ifdef __linux__
+    // Layout of the records getdents64() fills the buffer with.
+    struct LinuxDirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+    constexpr size_t kBufferSize = 64 * 1024;
+    std::unique_ptr<uint64_t[]> buffer(new uint64_t[kBufferSize / sizeof(uint64_t)]);
+    char* const data = reinterpret_cast<char*>(buffer.get());
+
+    bool ok = true;
+    for (;;) {
+        const long n = HANDLE_EINTR(syscall(SYS_getdents64, fd, data, kBufferSize));
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        for (long offset = 0; offset < n;) {
+            auto d = reinterpret_cast<const LinuxDirent64*>(data + offset);
+            offset += d->d_reclen;
+            const char* name = data + (offset - d->d_reclen) +
+                               offsetof(LinuxDirent64, d_name);
+            if (isDotOrDotDot(name)) {
+                continue;
+            }
+            addEntry(fd, name, d->d_ino, typeFromDirent(d->d_type), withMetadata,
+                     entries);
+        }
+    }
+    close(fd);
+    return ok;
+#else   // !__linux__
+    DIR* dir = fdopendir(fd);
+    if (!dir) {
+        close(fd);
+        return false;
+    }
+    errno = 0;
+    while (const struct dirent* d = readdir(dir)) {
+        if (!isDotOrDotDot(d->d_name)) {
+#ifdef DT_UNKNOWN
+            const DirEntry::Type type = typeFromDirent(d->d_type);
+#else
+            const DirEntry::Type type = DirEntry::Type::Unknown;
+#endif
+            addEntry(fd, d->d_name, d->d_ino, type, withMetadata, entries);
+        }
+        errno = 0;
+    }
+    const bool ok = errno == 0;
+    closedir(dir);  // Also closes |fd|.
+    return ok;
+#endif  // !__linux__
+}
+
+#endif  // !_WIN32
+
 int getCpuCoreCount() {
 #ifdef _WIN32
     SYSTEM_INFO si = {};
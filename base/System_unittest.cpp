@@ -0,0 +1,79 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/system/System.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "aemu/base/LatencyHistogram.h"
+#include "aemu/base/testing/TestTempDir.h"
+
+namespace android {
+namespace base {
+namespace {
+
+// Tests that scanDirEntries() reports names, types and, on request, sizes.
+TEST(System, ScanDirEntries) {
+    TestTempDir dir("scandir");
+    ASSERT_TRUE(dir.makeSubDir("sub"));
+    std::ofstream(dir.makeSubPath("data")) << "12345";
+    for (int i = 0; i < 500; ++i) {
+        ASSERT_TRUE(dir.makeSubFile("file" + std::to_string(i)));
+    }
+
+    std::vector<DirEntry> entries;
+    ASSERT_TRUE(scanDirEntries(dir.pathString(), &entries, true));
+    EXPECT_EQ(502u, entries.size());
+    std::sort(entries.begin(), entries.end(),
+              [](const DirEntry& a, const DirEntry& b) { return a.name < b.name; });
+    EXPECT_EQ("data", entries[0].name);
+    EXPECT_EQ(DirEntry::Type::File, entries[0].type);
+    EXPECT_EQ(5u, entries[0].size);
+    EXPECT_NE(0u, entries[0].modifiedUs);
+    EXPECT_NE(0u, entries[0].fileId);
+    EXPECT_EQ("sub", entries.back().name);
+    EXPECT_EQ(DirEntry::Type::Directory, entries.back().type);
+
+    entries.clear();
+    ASSERT_TRUE(scanDirEntries(dir.makeSubPath("sub"), &entries));
+    EXPECT_TRUE(entries.empty());
+    EXPECT_FALSE(scanDirEntries(dir.makeSubPath("missing"), &entries));
+}
+
+// Tests that sleepUntilUs() never returns early, and records how late it
+// returned.
+TEST(System, SleepUntil) {
+    latencyHistogram(LatencyMetric::kSleepLateness).takeSummary();
+    std::vector<uint64_t> lateUs;
+    for (int i = 0; i < 20; ++i) {
+        const uint64_t deadlineUs = getHighResTimeUs() + 2000;
+        lateUs.push_back(sleepUntilUs(deadlineUs, 0));
+        EXPECT_GE(getHighResTimeUs() + 10, deadlineUs);
+    }
+    EXPECT_EQ(20u,
+              latencyHistogram(LatencyMetric::kSleepLateness).takeSummary().count);
+    // Loose, for loaded machines: most wakeups are to the microsecond.
+    std::sort(lateUs.begin(), lateUs.end());
+    EXPECT_LT(lateUs[lateUs.size() / 2], 1000u);
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
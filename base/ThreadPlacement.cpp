@@ -0,0 +1,159 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/threads/ThreadPlacement.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <fstream>
+#include <string>
+#endif
+
+namespace android {
+namespace base {
+
+namespace {
+
+#if defined(__linux__)
+
+int readTopologyValue(int cpu, const char* name) {
+    std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                     "/topology/" + name);
+    int value = -1;
+    if (!(in >> value)) {
+        return -1;
+    }
+    return value;
+}
+
+std::vector<CpuSet> readCpuCores() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return {};
+    }
+    // Keyed by (package, core), which orders cores of a package together.
+    std::map<std::pair<int, int>, CpuSet> cores;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        const int package = readTopologyValue(cpu, "physical_package_id");
+        const int core = readTopologyValue(cpu, "core_id");
+        if (core < 0) {
+            // No topology, as in some containers: one core per CPU.
+            cores[{package, 1 << 20 | cpu}].push_back(cpu);
+        } else {
+            cores[{package, core}].push_back(cpu);
+        }
+    }
+    std::vector<CpuSet> result;
+    for (auto& [key, cpus] : cores) {
+        result.push_back(std::move(cpus));
+    }
+    return result;
+}
+
+#elif defined(_WIN32)
+
+std::vector<CpuSet> readCpuCores() {
+    DWORD size = 0;
+    GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &size);
+    if (GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
+        return {};
+    }
+    std::vector<char> buffer(size);
+    auto* info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(
+            buffer.data());
+    if (!GetLogicalProcessorInformationEx(RelationProcessorCore, info, &size)) {
+        return {};
+    }
+    DWORD_PTR processMask = 0;
+    DWORD_PTR systemMask = 0;
+    GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask);
+
+    // Cores come in processor order, so those of a package are adjacent.
+    std::vector<CpuSet> result;
+    for (DWORD offset = 0; offset < size;) {
+        auto* entry = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(
+                buffer.data() + offset);
+        const GROUP_AFFINITY& group = entry->Processor.GroupMask[0];
+        if (group.Group == 0) {
+            CpuSet cpus;
+            for (int cpu = 0; cpu < static_cast<int>(sizeof(KAFFINITY) * 8); ++cpu) {
+                if (group.Mask & processMask & (KAFFINITY(1) << cpu)) {
+                    cpus.push_back(cpu);
+                }
+            }
+            if (!cpus.empty()) {
+                result.push_back(std::move(cpus));
+            }
+        }
+        offset += entry->Size;
+    }
+    return result;
+}
+
+#else
+
+std::vector<CpuSet> readCpuCores() {
+    return {};
+}
+
+#endif
+
+std::atomic<size_t> sNextCore{0};
+
+}  // namespace
+
+const std::vector<CpuSet>& cpuCores() {
+    static const std::vector<CpuSet>* sCores =
+            new std::vector<CpuSet>(readCpuCores());
+    return *sCores;
+}
+
+CpuSet placeThreadGroup(size_t threads) {
+    const std::vector<CpuSet>& cores = cpuCores();
+    if (cores.empty()) {
+        return {};
+    }
+    // Racing callers may overlap, which only costs some spread.
+    const size_t first = sNextCore.load(std::memory_order_relaxed) % cores.size();
+    CpuSet cpus;
+    size_t taken = 0;
+    while (cpus.size() < std::max<size_t>(threads, 1)) {
+        if (taken == cores.size()) {
+            return {};
+        }
+        const CpuSet& core = cores[(first + taken) % cores.size()];
+        cpus.insert(cpus.end(), core.begin(), core.end());
+        ++taken;
+    }
+    if (taken == cores.size()) {
+        return {};
+    }
+    sNextCore.fetch_add(taken, std::memory_order_relaxed);
+    return cpus;
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,99 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/threads/ThreadPlacement.h"
+
+#include "aemu/base/threads/FunctorThread.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <set>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace android {
+namespace base {
+
+// Tests that every CPU belongs to exactly one core.
+TEST(ThreadPlacement, CoresAreDisjoint) {
+    std::set<int> seen;
+    for (const CpuSet& core : cpuCores()) {
+        EXPECT_FALSE(core.empty());
+        for (int cpu : core) {
+            EXPECT_TRUE(seen.insert(cpu).second) << cpu;
+        }
+    }
+#ifdef __linux__
+    EXPECT_FALSE(cpuCores().empty());
+#endif
+}
+
+// Tests that a group gets CPUs of whole cores, and the next group other
+// cores.
+TEST(ThreadPlacement, GroupsSpread) {
+    const auto& cores = cpuCores();
+    if (cores.size() < 3) {
+        EXPECT_TRUE(placeThreadGroup(cores.size() + 1).empty());
+        GTEST_SKIP() << "Needs at least three cores";
+    }
+    const CpuSet first = placeThreadGroup(1);
+    const CpuSet second = placeThreadGroup(1);
+    ASSERT_FALSE(first.empty());
+    ASSERT_FALSE(second.empty());
+    EXPECT_TRUE(std::find(cores.begin(), cores.end(), first) != cores.end());
+    EXPECT_NE(first, second);
+
+    size_t allCpus = 0;
+    for (const CpuSet& core : cores) {
+        allCpus += core.size();
+    }
+    EXPECT_TRUE(placeThreadGroup(allCpus).empty());
+}
+
+#ifdef __linux__
+
+// Tests that a thread runs on the CPUs and at the priority it was given.
+TEST(ThreadPlacement, ThreadOptionsApply) {
+    const CpuSet cpus = {cpuCores().front().front()};
+    int cpu = -1;
+    int nice = 0;
+    ThreadOptions options;
+    options.cpus = cpus;
+    options.priority = ThreadPriority::Background;
+    options.name = "placement-test";
+    FunctorThread thread(
+            [&] {
+                cpu = sched_getcpu();
+                nice = getpriority(PRIO_PROCESS,
+                                   static_cast<id_t>(syscall(SYS_gettid)));
+            },
+            std::move(options));
+    ASSERT_TRUE(thread.start());
+    thread.wait();
+    EXPECT_EQ(cpus.front(), cpu);
+    EXPECT_EQ(10, nice);
+    EXPECT_FALSE(Thread::setCurrentThreadAffinity({-1}));
+}
+
+#endif
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,82 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/threads/ThreadPool.h"
+#include "aemu/base/threads/WorkerThread.h"
+
+#include "benchmark/benchmark.h"
+
+#include <atomic>
+
+namespace android {
+namespace base {
+namespace {
+
+constexpr int kItemsPerBatch = 1000;
+
+// Enqueue cost plus hand-off, measured over a batch that the pool drains.
+void BM_ThreadPool_Enqueue(benchmark::State& state) {
+    std::atomic<int> processed{0};
+    ThreadPool<int> pool(
+            int(state.range(0)),
+            [&processed](int&&) {
+                processed.fetch_add(1, std::memory_order_relaxed);
+            },
+            static_cast<ThreadPoolScheduling>(state.range(1)));
+    pool.start();
+    for (auto _ : state) {
+        for (int i = 0; i < kItemsPerBatch; ++i) {
+            pool.enqueue(int(i));
+        }
+        pool.waitAllItems();
+    }
+    pool.done();
+    pool.join();
+    state.SetItemsProcessed(int64_t(state.iterations()) * kItemsPerBatch);
+}
+BENCHMARK(BM_ThreadPool_Enqueue)
+        ->ArgsProduct({{1, 4},
+                       {int(ThreadPoolScheduling::RoundRobin),
+                        int(ThreadPoolScheduling::WorkStealing)}})
+        ->UseRealTime();
+
+template <class QueuePolicy>
+void BM_WorkerThread_Enqueue(benchmark::State& state) {
+    std::atomic<int> processed{0};
+    WorkerThread<int, QueuePolicy> worker([&processed](int&& item) {
+        if (item < 0) {
+            return WorkerProcessingResult::Stop;
+        }
+        processed.fetch_add(1, std::memory_order_relaxed);
+        return WorkerProcessingResult::Continue;
+    });
+    worker.start();
+    for (auto _ : state) {
+        for (int i = 0; i < kItemsPerBatch - 1; ++i) {
+            worker.enqueue(int(i));
+        }
+        // The future of the last item is ready once the batch is done.
+        worker.enqueue(int(0)).wait();
+    }
+    worker.enqueue(-1);
+    worker.join();
+    state.SetItemsProcessed(int64_t(state.iterations()) * kItemsPerBatch);
+}
+BENCHMARK_TEMPLATE(BM_WorkerThread_Enqueue, LockingQueue)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_WorkerThread_Enqueue, LockFreeQueue)->UseRealTime();
+
+}  // namespace
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,160 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/threads/ThreadPool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "aemu/base/threads/internal/WorkStealingDeque.h"
+
+namespace android {
+namespace base {
+namespace {
+
+class ThreadPoolTest : public ::testing::TestWithParam<ThreadPoolScheduling> {};
+
+TEST_P(ThreadPoolTest, ProcessesAllItems) {
+    std::atomic<int> sum{0};
+    ThreadPool<int> pool(4, [&sum](int&& item) { sum += item; }, GetParam());
+    ASSERT_TRUE(pool.start());
+
+    for (int i = 1; i <= 1000; ++i) {
+        pool.enqueue(std::move(i));
+    }
+    pool.waitAllItems();
+    EXPECT_EQ(500500, sum);
+
+    pool.done();
+    pool.join();
+}
+
+TEST_P(ThreadPoolTest, DoneProcessesQueuedItems) {
+    std::atomic<int> count{0};
+    {
+        ThreadPool<int> pool(2, [&count](int&&) { ++count; }, GetParam());
+        ASSERT_TRUE(pool.start());
+        for (int i = 0; i < 100; ++i) {
+            pool.enqueue(0);
+        }
+        pool.done();
+        pool.join();
+    }
+    EXPECT_EQ(100, count);
+}
+
+TEST_P(ThreadPoolTest, BroadcastRunsOncePerWorker) {
+    std::mutex mutex;
+    std::multiset<ThreadPoolWorkerId> seen;
+    ThreadPool<ThreadPoolWorkerId> pool(
+        3,
+        [&](ThreadPoolWorkerId&& item, ThreadPoolWorkerId workerId) {
+            EXPECT_EQ(item, workerId);
+            std::lock_guard<std::mutex> lock(mutex);
+            seen.insert(workerId);
+        },
+        GetParam());
+    ASSERT_TRUE(pool.start());
+
+    ThreadPoolWorkerId next = 0;
+    pool.broadcast([&next] { return next++; });
+    pool.waitAllItems();
+
+    EXPECT_EQ((std::multiset<ThreadPoolWorkerId>{0, 1, 2}), seen);
+}
+
+INSTANTIATE_TEST_SUITE_P(ThreadPool, ThreadPoolTest,
+                         ::testing::Values(ThreadPoolScheduling::RoundRobin,
+                                           ThreadPoolScheduling::WorkStealing));
+
+// A worker stuck on a slow item must not hold up items queued behind it.
+TEST(ThreadPoolWorkStealing, IdleWorkersStealFromBusyOne) {
+    std::atomic<bool> release{false};
+    std::atomic<int> fastDone{0};
+
+    ThreadPool<int> pool(
+        3,
+        [&](int&& item) {
+            if (item == 0) {
+                while (!release) sleepMs(1);
+                return;
+            }
+            ++fastDone;
+        },
+        ThreadPoolScheduling::WorkStealing);
+    ASSERT_TRUE(pool.start());
+
+    pool.enqueue(0, 0);
+    // Give a worker time to pick up the slow item.
+    sleepMs(20);
+    for (int i = 0; i < 50; ++i) {
+        pool.enqueue(1, 0);
+    }
+
+    for (int i = 0; i < 2000 && fastDone < 50; ++i) {
+        sleepMs(1);
+    }
+    // All fast items were done by the other workers while one was blocked.
+    EXPECT_EQ(50, fastDone);
+    EXPECT_FALSE(release);
+
+    release = true;
+    pool.waitAllItems();
+}
+
+TEST(ThreadPoolWorkStealing, EnqueueFromWorker) {
+    std::atomic<int> count{0};
+    ThreadPool<int>* poolPtr = nullptr;
+    ThreadPool<int> pool(
+        2,
+        [&](int&& depth) {
+            ++count;
+            if (depth > 0) {
+                poolPtr->enqueue(depth - 1);
+                poolPtr->enqueue(depth - 1);
+            }
+        },
+        ThreadPoolScheduling::WorkStealing);
+    poolPtr = &pool;
+    ASSERT_TRUE(pool.start());
+
+    pool.enqueue(9);
+    pool.waitAllItems();
+    EXPECT_EQ(1023, count);
+}
+
+TEST(WorkStealingDeque, OwnerIsLifoThiefIsFifo) {
+    internal::WorkStealingDeque<int> deque(2);
+    std::vector<int> values(100);
+    for (int i = 0; i < 100; ++i) {
+        values[i] = i;
+        deque.push(&values[i]);
+    }
+    EXPECT_EQ(&values[0], deque.steal());
+    EXPECT_EQ(&values[99], deque.pop());
+    for (int i = 98; i >= 1; --i) {
+        EXPECT_EQ(&values[i], deque.pop());
+    }
+    EXPECT_EQ(nullptr, deque.pop());
+    EXPECT_EQ(nullptr, deque.steal());
+    EXPECT_TRUE(deque.empty());
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
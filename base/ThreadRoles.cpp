@@ -0,0 +1,327 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/ThreadRoles.h"
+
+#include "aemu/base/Metrics.h"
+#include "aemu/base/StringParse.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/system/System.h"
+
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#elif defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace android {
+namespace base {
+
+namespace {
+
+// Cumulative counters of one thread, or of a whole role.
+struct Counters {
+    uint64_t userUs = 0;
+    uint64_t systemUs = 0;
+    uint64_t wakeups = 0;
+    uint64_t preemptions = 0;
+
+    Counters& operator+=(const Counters& other) {
+        userUs += other.userUs;
+        systemUs += other.systemUs;
+        wakeups += other.wakeups;
+        preemptions += other.preemptions;
+        return *this;
+    }
+};
+
+#ifdef __linux__
+// Reads the "<key>:\t<value>" line of /proc/self/task/<tid>/status.
+uint64_t parseStatusField(const char* status, const char* key) {
+    const char* line = strstr(status, key);
+    if (!line) {
+        return 0;
+    }
+    uint64_t value = 0;
+    scan(line + strlen(key), ": %llu", &value);
+    return value;
+}
+#endif
+
+}  // namespace
+
+// One tagged thread: how to read its counters from another thread.
+struct TaggedThread {
+    ThreadRole role;
+#ifdef _WIN32
+    HANDLE handle = nullptr;
+#elif defined(__APPLE__)
+    mach_port_t port = MACH_PORT_NULL;
+#elif defined(__linux__)
+    pid_t tid = 0;
+#endif
+
+    Counters read() const {
+        Counters res;
+#ifdef _WIN32
+        FILETIME creation, exit, kernel, user;
+        if (GetThreadTimes(handle, &creation, &exit, &kernel, &user)) {
+            // FILETIMEs are in 100ns units.
+            res.userUs = ((uint64_t(user.dwHighDateTime) << 32) | user.dwLowDateTime) / 10;
+            res.systemUs =
+                    ((uint64_t(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime) / 10;
+        }
+#elif defined(__APPLE__)
+        thread_basic_info_data_t info;
+        mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+        if (thread_info(port, THREAD_BASIC_INFO, reinterpret_cast<thread_info_t>(&info),
+                        &count) == KERN_SUCCESS) {
+            res.userUs = info.user_time.seconds * 1000000ULL + info.user_time.microseconds;
+            res.systemUs =
+                    info.system_time.seconds * 1000000ULL + info.system_time.microseconds;
+        }
+#elif defined(__linux__)
+        char path[64];
+        char buf[2048];
+        snprintf(path, sizeof(path), "/proc/self/task/%d/stat", static_cast<int>(tid));
+        if (FILE* f = fopen(path, "r")) {
+            const size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+            fclose(f);
+            buf[n] = '\0';
+            // The name in parentheses may contain spaces; the fields after
+            // it are "state ppid ... utime stime", utime being the 12th.
+            static constexpr ScanFormat kStatFields(
+                    " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu");
+            const char* fields = strrchr(buf, ')');
+            uint64_t utime = 0, stime = 0;
+            if (fields && scan(fields + 1, kStatFields, &utime, &stime) == 2) {
+                static const long ticksPerSec = sysconf(_SC_CLK_TCK);
+                res.userUs = utime * 1000000ULL / ticksPerSec;
+                res.systemUs = stime * 1000000ULL / ticksPerSec;
+            }
+        }
+        snprintf(path, sizeof(path), "/proc/self/task/%d/status", static_cast<int>(tid));
+        if (FILE* f = fopen(path, "r")) {
+            const size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+            fclose(f);
+            buf[n] = '\0';
+            res.wakeups = parseStatusField(buf, "\nvoluntary_ctxt_switches");
+            res.preemptions = parseStatusField(buf, "nonvoluntary_ctxt_switches");
+        }
+#endif
+        return res;
+    }
+};
+
+namespace {
+
+class ThreadRoleRegistry {
+public:
+    static ThreadRoleRegistry& get() {
+        static ThreadRoleRegistry* sRegistry = new ThreadRoleRegistry;
+        return *sRegistry;
+    }
+
+    void add(TaggedThread* thread) {
+        AutoLock lock(mLock);
+        mThreads.push_back(thread);
+    }
+
+    // Keeps what |thread| used in its role's totals.
+    void remove(TaggedThread* thread) {
+        const Counters last = thread->read();
+        AutoLock lock(mLock);
+        mRetired[static_cast<size_t>(thread->role)] += last;
+        mThreads.remove(thread);
+    }
+
+    std::vector<ThreadRoleUsage> sample() {
+        AutoLock lock(mLock);
+        Counters totals[kRoles];
+        int threads[kRoles] = {};
+        for (size_t i = 0; i < kRoles; ++i) {
+            totals[i] = mRetired[i];
+        }
+        for (const TaggedThread* thread : mThreads) {
+            const size_t role = static_cast<size_t>(thread->role);
+            totals[role] += thread->read();
+            ++threads[role];
+        }
+
+        const uint64_t nowUs = getHighResTimeUs();
+        std::vector<ThreadRoleUsage> result(kRoles);
+        for (size_t i = 0; i < kRoles; ++i) {
+            ThreadRoleUsage& usage = result[i];
+            usage.role = static_cast<ThreadRole>(i);
+            usage.threads = threads[i];
+            usage.cpu.wall_time_us = nowUs - mLastSampleUs;
+            usage.cpu.user_time_us = totals[i].userUs - mLast[i].userUs;
+            usage.cpu.system_time_us = totals[i].systemUs - mLast[i].systemUs;
+            usage.wakeups = totals[i].wakeups - mLast[i].wakeups;
+            usage.preemptions = totals[i].preemptions - mLast[i].preemptions;
+            mLast[i] = totals[i];
+        }
+        mLastSampleUs = nowUs;
+        return result;
+    }
+
+private:
+    static constexpr size_t kRoles = static_cast<size_t>(ThreadRole::kCount);
+
+    Lock mLock;
+    std::list<TaggedThread*> mThreads;
+    // What exited threads used, by role.
+    Counters mRetired[kRoles];
+    // Totals at the last sample, by role.
+    Counters mLast[kRoles];
+    uint64_t mLastSampleUs = getHighResTimeUs();
+};
+
+class ThreadRoleReporter {
+public:
+    static ThreadRoleReporter& get() {
+        static ThreadRoleReporter* sReporter = new ThreadRoleReporter;
+        return *sReporter;
+    }
+
+    void start(std::chrono::milliseconds period) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mPeriod = period;
+        if (mThread.joinable()) {
+            mCv.notify_all();
+            return;
+        }
+        mStop = false;
+        mThread = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        std::thread thread;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mStop = true;
+            thread = std::move(mThread);
+        }
+        mCv.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mLock);
+        auto next = std::chrono::steady_clock::now() + mPeriod;
+        while (!mStop) {
+            const std::chrono::milliseconds period = mPeriod;
+            if (mCv.wait_until(lock, next,
+                               [this, period] { return mStop || mPeriod != period; })) {
+                next = std::chrono::steady_clock::now() + mPeriod;
+                continue;
+            }
+            lock.unlock();
+            reportThreadRoleUsage();
+            lock.lock();
+            next += mPeriod;
+        }
+    }
+
+    std::mutex mLock;
+    std::condition_variable mCv;
+    std::thread mThread;
+    std::chrono::milliseconds mPeriod{0};
+    bool mStop = false;
+};
+
+}  // namespace
+
+const char* threadRoleName(ThreadRole role) {
+    switch (role) {
+        case ThreadRole::kAsgConsumer:
+            return "asg-consumer";
+        case ThreadRole::kSyncThread:
+            return "sync-thread";
+        case ThreadRole::kMediaDecoder:
+            return "media-decoder";
+        case ThreadRole::kHealthMonitor:
+            return "health-monitor";
+        case ThreadRole::kCount:
+            break;
+    }
+    return "unknown";
+}
+
+ScopedThreadRole::ScopedThreadRole(ThreadRole role) : mThread(new TaggedThread) {
+    mThread->role = role;
+#ifdef _WIN32
+    DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(),
+                    &mThread->handle, THREAD_QUERY_LIMITED_INFORMATION, FALSE, 0);
+#elif defined(__APPLE__)
+    mThread->port = mach_thread_self();
+#elif defined(__linux__)
+    mThread->tid = static_cast<pid_t>(syscall(SYS_gettid));
+#endif
+    ThreadRoleRegistry::get().add(mThread);
+}
+
+ScopedThreadRole::~ScopedThreadRole() {
+    ThreadRoleRegistry::get().remove(mThread);
+#ifdef _WIN32
+    CloseHandle(mThread->handle);
+#elif defined(__APPLE__)
+    mach_port_deallocate(mach_task_self(), mThread->port);
+#endif
+    delete mThread;
+}
+
+std::vector<ThreadRoleUsage> sampleThreadRoles() {
+    return ThreadRoleRegistry::get().sample();
+}
+
+void reportThreadRoleUsage() {
+    auto logger = CreateMetricsLogger();
+    for (const ThreadRoleUsage& usage : sampleThreadRoles()) {
+        if (!usage.threads && !usage.cpu.usageUs()) {
+            continue;
+        }
+        logger->logMetricEvent(MetricEventThreadRoleUsage{
+            .role = usage.role,
+            .threads = usage.threads,
+            .cpuPermille = static_cast<int64_t>(usage.cpu.usage() * 1000),
+            .wakeupsPerSec = static_cast<int64_t>(usage.perSecond(usage.wakeups)),
+            .preemptionsPerSec = static_cast<int64_t>(usage.perSecond(usage.preemptions)),
+        });
+    }
+}
+
+void startThreadRoleReporting(std::chrono::milliseconds period) {
+    ThreadRoleReporter::get().start(period);
+}
+
+void stopThreadRoleReporting() { ThreadRoleReporter::get().stop(); }
+
+}  // namespace base
+}  // namespace android
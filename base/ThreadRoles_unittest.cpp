@@ -0,0 +1,94 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/ThreadRoles.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace android {
+namespace base {
+
+namespace {
+
+ThreadRoleUsage usageOf(ThreadRole role) {
+    for (const ThreadRoleUsage& usage : sampleThreadRoles()) {
+        if (usage.role == role) {
+            return usage;
+        }
+    }
+    return {};
+}
+
+void spin(std::chrono::milliseconds duration) {
+    const auto end = std::chrono::steady_clock::now() + duration;
+    volatile uint64_t sink = 0;
+    while (std::chrono::steady_clock::now() < end) {
+        sink = sink + 1;
+    }
+}
+
+}  // namespace
+
+// Tests that a tagged thread's CPU time lands in its role, including what
+// it used before exiting.
+TEST(ThreadRoles, AttributesCpuTime) {
+    sampleThreadRoles();
+
+    std::atomic<bool> started{false};
+    std::atomic<bool> done{false};
+    std::thread thread([&] {
+        ScopedThreadRole role(ThreadRole::kSyncThread);
+        started = true;
+        spin(std::chrono::milliseconds(100));
+        while (!done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    while (!started) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+
+    const ThreadRoleUsage live = usageOf(ThreadRole::kSyncThread);
+    EXPECT_EQ(1, live.threads);
+    EXPECT_GT(live.cpu.wall_time_us, 0u);
+    EXPECT_GT(live.cpu.usageUs(), 0u);
+#ifdef __linux__
+    EXPECT_GT(live.wakeups, 0u);
+#endif
+
+    done = true;
+    thread.join();
+    const ThreadRoleUsage exited = usageOf(ThreadRole::kSyncThread);
+    EXPECT_EQ(0, exited.threads);
+
+    // Nothing left to count once the thread is gone.
+    const ThreadRoleUsage idle = usageOf(ThreadRole::kSyncThread);
+    EXPECT_EQ(0, idle.threads);
+    EXPECT_EQ(0u, idle.cpu.usageUs());
+    EXPECT_EQ(0u, idle.wakeups);
+}
+
+TEST(ThreadRoles, Names) {
+    EXPECT_STREQ("asg-consumer", threadRoleName(ThreadRole::kAsgConsumer));
+    EXPECT_STREQ("health-monitor", threadRoleName(ThreadRole::kHealthMonitor));
+}
+
+}  // namespace base
+}  // namespace android
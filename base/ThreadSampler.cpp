@@ -0,0 +1,244 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/ThreadSampler.h"
+
+#include "aemu/base/synchronization/Lock.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sched.h>
+#endif
+
+namespace android {
+namespace base {
+
+namespace {
+
+// Serializes sampling, and on Linux the use of the handler's globals.
+StaticLock sSamplingLock;
+
+#if defined(__linux__)
+
+// How long a signalled thread gets to run the handler. Threads blocked in
+// the kernel with the signal masked never do.
+constexpr auto kSampleTimeout = std::chrono::milliseconds(20);
+
+int sampleSignal() {
+    return SIGRTMIN + 5;
+}
+
+// The sampler stores a sequence number in sRequest and signals the target.
+// The handler takes the request by exchanging it with 0, so that a handler
+// running late, after the sampler gave up, finds nothing to do.
+std::atomic<uint32_t> sRequest{0};
+std::atomic<uint32_t> sDone{0};
+void* sFrames[kMaxStackFrames];
+size_t sFrameCount = 0;
+
+void onSampleSignal(int, siginfo_t*, void*) {
+    const int savedErrno = errno;
+    const uint32_t seq = sRequest.exchange(0, std::memory_order_acq_rel);
+    if (seq) {
+        // Leave out this handler and the signal trampoline.
+        sFrameCount = captureBacktrace(sFrames, kMaxStackFrames, 2);
+        sDone.store(seq, std::memory_order_release);
+    }
+    errno = savedErrno;
+}
+
+// The handler stays installed: a signal could still be pending when
+// sampling ends.
+bool installHandler() {
+    static const bool sInstalled = [] {
+        // The first unwind may allocate while the unwinder loads, which the
+        // handler must not do.
+        void* warmUp[1];
+        captureBacktrace(warmUp, 1);
+
+        struct sigaction action = {};
+        action.sa_sigaction = onSampleSignal;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        return sigaction(sampleSignal(), &action, nullptr) == 0;
+    }();
+    return sInstalled;
+}
+
+size_t sampleOnce(unsigned long threadId, void** frames) {
+    static uint32_t sNextSeq = 0;
+    uint32_t seq = ++sNextSeq;
+    if (!seq) {
+        seq = ++sNextSeq;
+    }
+    sRequest.store(seq, std::memory_order_release);
+    if (pthread_kill(static_cast<pthread_t>(threadId), sampleSignal()) != 0) {
+        sRequest.store(0, std::memory_order_relaxed);
+        return 0;
+    }
+    const auto deadline = std::chrono::steady_clock::now() + kSampleTimeout;
+    while (sDone.load(std::memory_order_acquire) != seq) {
+        if (std::chrono::steady_clock::now() > deadline &&
+            sRequest.exchange(0, std::memory_order_acq_rel) == seq) {
+            return 0;
+        }
+        // Otherwise the handler has taken the request and won't block.
+        sched_yield();
+    }
+    std::copy(sFrames, sFrames + sFrameCount, frames);
+    return sFrameCount;
+}
+
+#elif defined(_WIN32)
+
+// Nothing here may allocate while the target is suspended: it could hold
+// the heap lock.
+size_t walkStack(CONTEXT* context, void** frames) {
+#if defined(_M_X64)
+    size_t count = 0;
+    while (count < kMaxStackFrames && context->Rip) {
+        frames[count++] = reinterpret_cast<void*>(context->Rip);
+        DWORD64 imageBase = 0;
+        PRUNTIME_FUNCTION function =
+                RtlLookupFunctionEntry(context->Rip, &imageBase, nullptr);
+        if (!function) {
+            // A leaf function: the return address is on top of the stack.
+            context->Rip = *reinterpret_cast<DWORD64*>(context->Rsp);
+            context->Rsp += 8;
+            continue;
+        }
+        PVOID handlerData = nullptr;
+        DWORD64 establisherFrame = 0;
+        RtlVirtualUnwind(UNW_FLAG_NHANDLER, imageBase, context->Rip, function,
+                         context, &handlerData, &establisherFrame, nullptr);
+    }
+    return count;
+#elif defined(_M_ARM64)
+    frames[0] = reinterpret_cast<void*>(context->Pc);
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+size_t sampleOnce(HANDLE thread, void** frames) {
+    if (SuspendThread(thread) == static_cast<DWORD>(-1)) {
+        return 0;
+    }
+    CONTEXT context = {};
+    context.ContextFlags = CONTEXT_FULL;
+    size_t count = 0;
+    if (GetThreadContext(thread, &context)) {
+        count = walkStack(&context, frames);
+    }
+    ResumeThread(thread);
+    return count;
+}
+
+#endif
+
+}  // namespace
+
+bool threadSamplingSupported() {
+#if defined(__linux__) || defined(_WIN32)
+    return true;
+#else
+    return false;
+#endif
+}
+
+ThreadStackSamples sampleThreadStacks(unsigned long threadId,
+                                      uint32_t samples,
+                                      uint64_t intervalUs) {
+    ThreadStackSamples result;
+    result.requested = samples;
+    if (!threadSamplingSupported() || !samples) {
+        return result;
+    }
+
+    AutoLock lock(sSamplingLock);
+#if defined(__linux__)
+    if (!installHandler()) {
+        return result;
+    }
+#elif defined(_WIN32)
+    HANDLE thread = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT |
+                                       THREAD_QUERY_INFORMATION,
+                               FALSE, static_cast<DWORD>(threadId));
+    if (!thread) {
+        return result;
+    }
+#endif
+
+    std::unordered_map<StackId, uint32_t> counts;
+    void* frames[kMaxStackFrames];
+    for (uint32_t i = 0; i < samples; ++i) {
+        if (i) {
+            std::this_thread::sleep_for(std::chrono::microseconds(intervalUs));
+        }
+#if defined(__linux__)
+        const size_t count = sampleOnce(threadId, frames);
+#elif defined(_WIN32)
+        const size_t count = sampleOnce(thread, frames);
+#else
+        const size_t count = 0;
+#endif
+        const StackId stack = internStack(frames, count);
+        if (stack != kInvalidStackId) {
+            ++counts[stack];
+            ++result.taken;
+        }
+    }
+#ifdef _WIN32
+    CloseHandle(thread);
+#endif
+
+    result.stacks.reserve(counts.size());
+    for (const auto& [stack, n] : counts) {
+        result.stacks.push_back({stack, n});
+    }
+    std::sort(result.stacks.begin(), result.stacks.end(),
+              [](const SampledStack& a, const SampledStack& b) {
+                  return a.samples != b.samples ? a.samples > b.samples
+                                                : a.stack < b.stack;
+              });
+    return result;
+}
+
+std::string formatThreadStackSamples(const ThreadStackSamples& samples,
+                                     size_t maxStacks) {
+    std::string text = std::to_string(samples.taken) + "/" +
+                       std::to_string(samples.requested) + " samples\n";
+    const size_t shown = std::min(maxStacks, samples.stacks.size());
+    for (size_t i = 0; i < shown; ++i) {
+        const SampledStack& stack = samples.stacks[i];
+        text += std::to_string(stack.samples) + " samples:\n";
+        text += formatStack(stack.stack);
+    }
+    return text;
+}
+
+}  // namespace base
+}  // namespace android
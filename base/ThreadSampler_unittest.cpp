@@ -0,0 +1,76 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/ThreadSampler.h"
+
+#include "aemu/base/threads/Thread.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+namespace android {
+namespace base {
+
+// Tests that a busy thread is sampled and its samples are aggregated.
+TEST(ThreadSampler, SamplesBusyThread) {
+    if (!threadSamplingSupported()) {
+        GTEST_SKIP() << "Thread sampling is not supported here";
+    }
+    std::atomic<bool> stop{false};
+    std::atomic<unsigned long> threadId{0};
+    std::thread busy([&] {
+        threadId.store(getCurrentThreadId());
+        while (!stop.load(std::memory_order_relaxed)) {
+        }
+    });
+    while (!threadId.load()) {
+        std::this_thread::yield();
+    }
+
+    const ThreadStackSamples samples = sampleThreadStacks(threadId.load(), 10, 500);
+    stop.store(true);
+    busy.join();
+
+    EXPECT_EQ(10u, samples.requested);
+    // A sample times out if the machine is too loaded to run the handler.
+    EXPECT_GT(samples.taken, 0u);
+    ASSERT_FALSE(samples.stacks.empty());
+    uint32_t total = 0;
+    for (size_t i = 0; i < samples.stacks.size(); ++i) {
+        EXPECT_NE(kInvalidStackId, samples.stacks[i].stack);
+        if (i) {
+            EXPECT_GE(samples.stacks[i - 1].samples, samples.stacks[i].samples);
+        }
+        total += samples.stacks[i].samples;
+    }
+    EXPECT_EQ(samples.taken, total);
+
+    const std::string text = formatThreadStackSamples(samples, 1);
+    EXPECT_EQ(0u, text.find(std::to_string(samples.taken) + "/10 samples\n"));
+    EXPECT_NE(std::string::npos, text.find("#0 "));
+}
+
+// Tests that asking for no samples does nothing.
+TEST(ThreadSampler, NoSamples) {
+    const ThreadStackSamples samples = sampleThreadStacks(getCurrentThreadId(), 0, 0);
+    EXPECT_EQ(0u, samples.taken);
+    EXPECT_TRUE(samples.stacks.empty());
+    EXPECT_EQ("0/0 samples\n", formatThreadStackSamples(samples));
+}
+
+}  // namespace base
+}  // namespace android
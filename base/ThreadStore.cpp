@@ -0,0 +1,70 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/threads/ThreadStore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace android {
+namespace base {
+
+#ifdef _WIN32
+
+// Fiber local storage runs the destructor on thread exit, which plain TLS
+// keys don't.
+ThreadStoreBase::ThreadStoreBase(Destructor* destroy)
+    : mKey(static_cast<int>(FlsAlloc(reinterpret_cast<PFLS_CALLBACK_FUNCTION>(destroy)))) {
+    if (static_cast<DWORD>(mKey) == FLS_OUT_OF_INDEXES) {
+        fprintf(stderr, "%s: out of fiber local storage indices\n", __func__);
+        abort();
+    }
+}
+
+ThreadStoreBase::~ThreadStoreBase() {
+    FlsFree(static_cast<DWORD>(mKey));
+}
+
+void* ThreadStoreBase::get() const {
+    return FlsGetValue(static_cast<DWORD>(mKey));
+}
+
+void ThreadStoreBase::set(void* value) {
+    FlsSetValue(static_cast<DWORD>(mKey), value);
+}
+
+// static
+void ThreadStoreBase::OnThreadExit() {
+    // Values are destroyed by FlsAlloc's callback.
+}
+
+#else  // !_WIN32
+
+ThreadStoreBase::ThreadStoreBase(Destructor* destroy) {
+    const int ret = pthread_key_create(&mKey, destroy);
+    if (ret != 0) {
+        fprintf(stderr, "%s: pthread_key_create failed: %d\n", __func__, ret);
+        abort();
+    }
+}
+
+ThreadStoreBase::~ThreadStoreBase() {
+    pthread_key_delete(mKey);
+}
+
+#endif  // !_WIN32
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,72 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/threads/ThreadStore.h"
+
+#include "benchmark/benchmark.h"
+
+namespace android {
+namespace base {
+namespace {
+
+struct Value {
+    int x = 0;
+};
+
+struct BenchTag {};
+
+// The pthread key (or FLS index) path every ThreadStore takes.
+void BM_ThreadStore_Get(benchmark::State& state) {
+    static ThreadStore<Value> store;
+    store.set(new Value());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(store.get());
+    }
+}
+BENCHMARK(BM_ThreadStore_Get);
+
+void BM_ThreadStore_Swap(benchmark::State& state) {
+    static ThreadStore<Value> store;
+    Value value;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(store.swap(&value));
+    }
+    store.swap(nullptr);
+}
+BENCHMARK(BM_ThreadStore_Swap);
+
+// The same with compiler-native thread_local storage.
+void BM_ThreadLocalStore_Get(benchmark::State& state) {
+    static ThreadLocalStore<Value, BenchTag> store;
+    store.set(new Value());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(store.get());
+    }
+}
+BENCHMARK(BM_ThreadLocalStore_Get);
+
+void BM_ThreadLocalStore_Swap(benchmark::State& state) {
+    static ThreadLocalStore<Value, BenchTag> store;
+    Value value;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(store.swap(&value));
+    }
+    store.swap(nullptr);
+}
+BENCHMARK(BM_ThreadLocalStore_Swap);
+
+}  // namespace
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,76 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/threads/ThreadStore.h"
+
+#include "aemu/base/threads/FunctorThread.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+namespace android {
+namespace base {
+
+namespace {
+
+std::atomic<int> sLive{0};
+
+struct Tracked {
+    Tracked() { ++sLive; }
+    ~Tracked() { --sLive; }
+};
+
+struct LocalTag {};
+
+}  // namespace
+
+// Tests that each thread sees its own value and that values are deleted on
+// replacement and on thread exit.
+template <class Store>
+void checkStore(Store& store) {
+    sLive = 0;
+    EXPECT_EQ(nullptr, store.get());
+    Tracked* mine = new Tracked();
+    store.set(mine);
+
+    FunctorThread thread([&store] {
+        EXPECT_EQ(nullptr, store.get());
+        store.set(new Tracked());
+        store.set(new Tracked());
+        EXPECT_EQ(2, sLive.load());
+        return intptr_t(0);
+    });
+    thread.start();
+    thread.wait();
+
+    EXPECT_EQ(1, sLive.load());
+    EXPECT_EQ(mine, store.get());
+    delete store.swap(nullptr);
+    EXPECT_EQ(0, sLive.load());
+}
+
+TEST(ThreadStore, KeyBased) {
+    ThreadStore<Tracked> store;
+    checkStore(store);
+}
+
+TEST(ThreadStore, ThreadLocal) {
+    static ThreadLocalStore<Tracked, LocalTag> store;
+    checkStore(store);
+}
+
+}  // namespace base
+}  // namespace android
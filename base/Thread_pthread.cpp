@@ -22,6 +22,14 @@
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
+#ifdef __linux__
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+#ifdef __APPLE__
+#include <pthread/qos.h>
+#endif
 
 namespace android {
 namespace base {
@@ -29,6 +37,14 @@ namespace base {
 Thread::Thread(ThreadFlags flags, int stackSize, std::optional<std::string> nameOpt)
     : mThread((pthread_t)NULL), mStackSize(stackSize), mFlags(flags), mNameOpt(std::move(nameOpt)) {}
 
+Thread::Thread(ThreadOptions options)
+    : mNameOpt(std::move(options.name)),
+      mThread((pthread_t)NULL),
+      mStackSize(options.stackSize),
+      mFlags(options.flags),
+      mPriority(options.priority),
+      mCpus(std::move(options.cpus)) {}
+
 Thread::~Thread() {
     assert(!mStarted || mFinished);
     if ((mFlags & ThreadFlags::Detach) == ThreadFlags::NoFlags && mStarted &&
@@ -67,9 +83,9 @@ bool Thread::start() {
         mJoined = true;
     }
 
-    // TODO: implement for mac os
+    // macOS only lets a thread name itself; see thread_main().
 #ifndef __APPLE__
-    if (mNameOpt.has_value()) {
+    if (ret && mNameOpt.has_value()) {
         pthread_setname_np(mThread, (*mNameOpt).c_str());
     }
 #endif  // __APPLE__
@@ -134,6 +150,15 @@ void* Thread::thread_main(void* arg) {
         if ((self->mFlags & ThreadFlags::MaskSignals) != ThreadFlags::NoFlags) {
             Thread::maskAllSignals();
         }
+#ifdef __APPLE__
+        if (self->mNameOpt.has_value()) {
+            pthread_setname_np(self->mNameOpt->c_str());
+        }
+#endif
+        if (self->mPriority != ThreadPriority::Normal) {
+            Thread::setCurrentThreadPriority(self->mPriority);
+        }
+        Thread::setCurrentThreadAffinity(self->mCpus);
 
         if ((self->mFlags & ThreadFlags::Detach) != ThreadFlags::NoFlags) {
             if (pthread_detach(pthread_self())) {
@@ -164,6 +189,79 @@ void Thread::maskAllSignals() {
     pthread_sigmask(SIG_SETMASK, &set, nullptr);
 }
 
+// static
+bool Thread::setCurrentThreadAffinity(const CpuSet& cpus) {
+    if (cpus.empty()) {
+        return true;
+    }
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            return false;
+        }
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+// static
+bool Thread::setCurrentThreadPriority(ThreadPriority priority) {
+#if defined(__linux__)
+    bool ok = true;
+    sched_param param = {};
+    if (priority == ThreadPriority::Realtime) {
+        param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) {
+            return true;
+        }
+        // No CAP_SYS_NICE or RLIMIT_RTPRIO: try for High instead.
+        ok = false;
+    } else {
+        pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+    }
+    // Linux keeps a nice value per thread.
+    int nice = 0;
+    switch (priority) {
+        case ThreadPriority::Background:
+            nice = 10;
+            break;
+        case ThreadPriority::Normal:
+            nice = 0;
+            break;
+        case ThreadPriority::High:
+        case ThreadPriority::Realtime:
+            nice = -10;
+            break;
+    }
+    const auto tid = static_cast<id_t>(syscall(SYS_gettid));
+    return setpriority(PRIO_PROCESS, tid, nice) == 0 && ok;
+#elif defined(__APPLE__)
+    qos_class_t qos = QOS_CLASS_DEFAULT;
+    switch (priority) {
+        case ThreadPriority::Background:
+            qos = QOS_CLASS_UTILITY;
+            break;
+        case ThreadPriority::Normal:
+            qos = QOS_CLASS_DEFAULT;
+            break;
+        case ThreadPriority::High:
+            qos = QOS_CLASS_USER_INITIATED;
+            break;
+        case ThreadPriority::Realtime:
+            qos = QOS_CLASS_USER_INTERACTIVE;
+            break;
+    }
+    return pthread_set_qos_class_self_np(qos, 0) == 0;
+#else
+    return priority == ThreadPriority::Normal;
+#endif
+}
+
 // static
 void Thread::sleepMs(unsigned n) {
     usleep(n * 1000);
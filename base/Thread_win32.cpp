@@ -27,6 +27,13 @@ namespace base {
 Thread::Thread(ThreadFlags flags, int stackSize, std::optional<std::string> nameOpt)
     : mStackSize(stackSize), mFlags(flags), mNameOpt(std::move(nameOpt)) {}
 
+Thread::Thread(ThreadOptions options)
+    : mNameOpt(std::move(options.name)),
+      mStackSize(options.stackSize),
+      mFlags(options.flags),
+      mPriority(options.priority),
+      mCpus(std::move(options.cpus)) {}
+
 Thread::~Thread() {
     if (mThread) {
         assert(!mStarted || mFinished);
@@ -119,6 +126,10 @@ DWORD WINAPI Thread::thread_main(void* arg) {
         // no need to call maskAllSignals() here: we know
         // that on Windows it's a noop
         Thread* self = reinterpret_cast<Thread*>(arg);
+        if (self->mPriority != ThreadPriority::Normal) {
+            Thread::setCurrentThreadPriority(self->mPriority);
+        }
+        Thread::setCurrentThreadAffinity(self->mCpus);
         auto ret = self->main();
 
         {
@@ -140,6 +151,42 @@ void Thread::maskAllSignals() {
     // no such thing as signal in Windows
 }
 
+// static
+bool Thread::setCurrentThreadAffinity(const CpuSet& cpus) {
+    if (cpus.empty()) {
+        return true;
+    }
+    // Processor group 0 only.
+    DWORD_PTR mask = 0;
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= static_cast<int>(sizeof(mask) * 8)) {
+            return false;
+        }
+        mask |= DWORD_PTR(1) << cpu;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+}
+
+// static
+bool Thread::setCurrentThreadPriority(ThreadPriority priority) {
+    int value = THREAD_PRIORITY_NORMAL;
+    switch (priority) {
+        case ThreadPriority::Background:
+            value = THREAD_PRIORITY_BELOW_NORMAL;
+            break;
+        case ThreadPriority::Normal:
+            value = THREAD_PRIORITY_NORMAL;
+            break;
+        case ThreadPriority::High:
+            value = THREAD_PRIORITY_ABOVE_NORMAL;
+            break;
+        case ThreadPriority::Realtime:
+            value = THREAD_PRIORITY_TIME_CRITICAL;
+            break;
+    }
+    return SetThreadPriority(GetCurrentThread(), value) != 0;
+}
+
 // static
 void Thread::sleepMs(unsigned n) {
     ::Sleep(n);
@@ -0,0 +1,130 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/testing/TraceReplay.h"
+
+#include "aemu/base/files/MemStream.h"
+#include "aemu/base/ring_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+namespace android {
+namespace base {
+namespace {
+
+enum Kind : uint32_t { kWrite = 0, kRead = 1, kUnhandled = 2 };
+
+TEST(TraceReplay, SaveLoad) {
+    Trace trace;
+    trace.add(10, kWrite, "abc", 3);
+    trace.add(25, kRead);
+    trace.add(1000000000000, kUnhandled, "z", 1);
+
+    MemStream stream;
+    trace.save(&stream);
+
+    Trace loaded;
+    ASSERT_TRUE(loaded.load(&stream));
+    ASSERT_EQ(3u, loaded.events().size());
+    EXPECT_EQ(10u, loaded.events()[0].timeNs);
+    EXPECT_EQ(kWrite, loaded.events()[0].kind);
+    EXPECT_EQ((std::vector<uint8_t>{'a', 'b', 'c'}),
+              loaded.events()[0].payload);
+    EXPECT_EQ(25u, loaded.events()[1].timeNs);
+    EXPECT_TRUE(loaded.events()[1].payload.empty());
+    EXPECT_EQ(1000000000000u, loaded.events()[2].timeNs);
+
+    MemStream garbage;
+    garbage.putBe32(1234);
+    EXPECT_FALSE(loaded.load(&garbage));
+    EXPECT_TRUE(loaded.empty());
+}
+
+// Tests that events reach their handlers in order, with the clock moved to
+// each one first, and that only handled kinds are reported.
+TEST(TraceReplay, ReplaysInOrder) {
+    Trace trace;
+    for (uint64_t i = 0; i < 10; ++i) {
+        trace.add(i * 100, i % 3 == 0 ? kRead : kWrite);
+    }
+    trace.add(2000, kUnhandled);
+
+    std::vector<std::pair<uint64_t, uint32_t>> seen;
+    uint64_t now = 0;
+    TraceReplayer replayer;
+    replayer.setClock([&now](uint64_t timeNs) { now = timeNs; });
+    auto record = [&](const TraceEvent& event) {
+        EXPECT_EQ(event.timeNs, now);
+        seen.emplace_back(event.timeNs, event.kind);
+    };
+    replayer.setHandler(kWrite, "write", record);
+    replayer.setHandler(kRead, "read", record);
+
+    const auto stats = replayer.replay(trace, 2);
+    ASSERT_EQ(20u, seen.size());
+    for (size_t i = 0; i < 10; ++i) {
+        EXPECT_EQ(seen[i], seen[i + 10]);
+        EXPECT_EQ(i * 100, seen[i].first);
+    }
+
+    ASSERT_EQ(2u, stats.size());
+    EXPECT_EQ("write", stats[0].name);
+    EXPECT_EQ(6u, stats[0].count);
+    EXPECT_EQ("read", stats[1].name);
+    EXPECT_EQ(4u, stats[1].count);
+    EXPECT_LE(stats[1].minCycles, stats[1].medianCycles);
+    EXPECT_LE(stats[1].medianCycles, stats[1].p99Cycles);
+    EXPECT_NE(std::string::npos,
+              TraceReplayer::format(stats).find("read: 4 events"));
+}
+
+// Replays ring traffic against the real ring_buffer code.
+TEST(TraceReplay, RingBufferTraffic) {
+    Trace trace;
+    uint8_t packet[256];
+    memset(packet, 0x5a, sizeof(packet));
+    for (uint64_t i = 0; i < 1000; ++i) {
+        trace.add(i * 1000, kWrite, packet, 1 + i % sizeof(packet));
+        trace.add(i * 1000 + 500, kRead, &i, sizeof(uint32_t));
+    }
+
+    ring_buffer ring;
+    ring_buffer_init(&ring);
+    std::vector<uint32_t> sizes;
+    size_t nextRead = 0;
+    TraceReplayer replayer;
+    replayer.setHandler(kWrite, "ring_write", [&](const TraceEvent& event) {
+        ring_buffer_write(&ring, event.payload.data(), event.payload.size(),
+                          1);
+        sizes.push_back(event.payload.size());
+    });
+    replayer.setHandler(kRead, "ring_read", [&](const TraceEvent&) {
+        uint8_t out[256];
+        EXPECT_EQ(1, ring_buffer_read(&ring, out, sizes[nextRead++], 1));
+        EXPECT_EQ(0x5a, out[0]);
+    });
+
+    const auto stats = replayer.replay(trace);
+    ASSERT_EQ(2u, stats.size());
+    EXPECT_EQ(1000u, stats[0].count);
+    EXPECT_EQ(1000u, stats[1].count);
+    EXPECT_EQ(1000u, nextRead);
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
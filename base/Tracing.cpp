@@ -14,20 +14,481 @@
 // limitations under the License.
 #include "aemu/base/Tracing.h"
 
+#include "aemu/base/system/FastClock.h"
+
 #ifdef USE_PERFETTO_TRACING
 #include "perfetto-tracing-only.h"
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
 
 namespace android {
 namespace base {
 
 const bool* tracingDisabledPtr = nullptr;
 
+#ifdef __cplusplus
+#   define CC_LIKELY( exp )    (__builtin_expect( !!(exp), true ))
+#   define CC_UNLIKELY( exp )  (__builtin_expect( !!(exp), false ))
+#else
+#   define CC_LIKELY( exp )    (__builtin_expect( !!(exp), 1 ))
+#   define CC_UNLIKELY( exp )  (__builtin_expect( !!(exp), 0 ))
+#endif
+
+namespace {
+
+uint64_t traceNowNs() { return FastClock::nowNs(); }
+
+// Clock samples from the guest, and what the guest traced, kept apart from
+// the per-thread rings as both come in rarely and names are owned.
+class GuestTimeline {
+public:
+    static constexpr size_t kClockSamples = 32;
+
+    static GuestTimeline& get() {
+        static GuestTimeline* sTimeline = new GuestTimeline;
+        return *sTimeline;
+    }
+
+    void addClockSample(uint64_t guestBeforeNs, uint64_t hostNs,
+                        uint64_t guestAfterNs) {
+        if (guestAfterNs < guestBeforeNs) {
+            return;
+        }
+        const uint64_t guestNs =
+                guestBeforeNs + (guestAfterNs - guestBeforeNs) / 2;
+        std::lock_guard<std::mutex> g(mLock);
+        if (mSamples.size() == kClockSamples) {
+            mSamples.pop_front();
+        }
+        mSamples.push_back(ClockSample{guestNs,
+                                       int64_t(hostNs - guestNs),
+                                       guestAfterNs - guestBeforeNs});
+    }
+
+    uint64_t toHost(uint64_t guestNs) {
+        std::lock_guard<std::mutex> g(mLock);
+        return toHostLocked(guestNs);
+    }
+
+    void addSpan(GuestTraceSpan span) {
+        std::lock_guard<std::mutex> g(mLock);
+        if (mSpans.size() == kGuestTraceSpans) {
+            mSpans.pop_front();
+        }
+        mSpans.push_back(std::move(span));
+    }
+
+    // Calls |f| with each span and its host begin and end times.
+    template <class F>
+    void forEachSpan(F&& f) {
+        std::lock_guard<std::mutex> g(mLock);
+        for (const GuestTraceSpan& span : mSpans) {
+            f(span, toHostLocked(span.beginNs), toHostLocked(span.endNs));
+        }
+    }
+
+    void clearSpans() {
+        std::lock_guard<std::mutex> g(mLock);
+        mSpans.clear();
+    }
+
+private:
+    struct ClockSample {
+        uint64_t guestNs;  // midway through the round trip
+        int64_t offsetNs;  // host minus guest
+        uint64_t roundTripNs;
+    };
+
+    using SampleIter = std::deque<ClockSample>::const_iterator;
+
+    static SampleIter tightest(SampleIter begin, SampleIter end) {
+        return std::min_element(begin, end,
+                                [](const ClockSample& a, const ClockSample& b) {
+                                    return a.roundTripNs < b.roundTripNs;
+                                });
+    }
+
+    uint64_t toHostLocked(uint64_t guestNs) const {
+        if (mSamples.empty()) {
+            return guestNs;
+        }
+        const SampleIter best = tightest(mSamples.begin(), mSamples.end());
+        double drift = 0;
+        const SampleIter middle = mSamples.begin() + mSamples.size() / 2;
+        if (middle != mSamples.begin()) {
+            const SampleIter older = tightest(mSamples.begin(), middle);
+            const SampleIter newer = tightest(middle, mSamples.end());
+            if (newer->guestNs > older->guestNs) {
+                drift = double(newer->offsetNs - older->offsetNs) /
+                        double(newer->guestNs - older->guestNs);
+            }
+        }
+        const double sinceBest = double(int64_t(guestNs - best->guestNs));
+        return guestNs + best->offsetNs + int64_t(drift * sinceBest);
+    }
+
+    std::mutex mLock;
+    std::deque<ClockSample> mSamples;
+    std::deque<GuestTraceSpan> mSpans;
+};
+
+}  // namespace
+
+uint64_t traceTimeNs() {
+    return traceNowNs();
+}
+
+void addGuestClockSample(uint64_t guestBeforeNs,
+                         uint64_t hostNs,
+                         uint64_t guestAfterNs) {
+    GuestTimeline::get().addClockSample(guestBeforeNs, hostNs, guestAfterNs);
+}
+
+uint64_t guestToHostTraceNs(uint64_t guestNs) {
+    return GuestTimeline::get().toHost(guestNs);
+}
+
+size_t importGuestTraceSpans(const void* data, size_t size) {
+    struct __attribute__((__packed__)) Record {
+        uint32_t nameSize;
+        uint32_t tid;
+        uint64_t beginNs;
+        uint64_t endNs;
+        uint64_t flowId;
+    };
+    auto pos = static_cast<const char*>(data);
+    const char* const end = pos + size;
+    size_t count = 0;
+    while (size_t(end - pos) >= sizeof(Record)) {
+        Record record;
+        memcpy(&record, pos, sizeof(record));
+        pos += sizeof(record);
+        if (size_t(end - pos) < record.nameSize) {
+            break;
+        }
+        addGuestTraceSpan(GuestTraceSpan{std::string(pos, record.nameSize),
+                                         record.tid, record.beginNs,
+                                         record.endNs, record.flowId});
+        pos += record.nameSize;
+        ++count;
+    }
+    return count;
+}
+
+#ifndef USE_PERFETTO_TRACING
+
+// Built-in recorder for builds without perfetto. Every thread that traces
+// gets a ring of the last kTraceRingEvents events, written only by that
+// thread; dumps read the rings without stopping the writers and drop the
+// slots that were overwritten while copying.
+
+namespace {
+
+// Flow events keep their id in the value.
+enum class TraceEventType : uint32_t { Begin, End, Counter, FlowBegin, FlowEnd };
+
+struct TraceSlot {
+    std::atomic<uint64_t> timeNs{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<int64_t> value{0};
+    std::atomic<uint32_t> type{0};
+};
+
+struct TraceRing {
+    // Events written, and events begun; they differ while the owning thread
+    // is in the middle of writing one.
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> writing{0};
+    // Events before this one were cleared. Only the owning thread moves
+    // |head|, so clearing can't simply reset it.
+    std::atomic<uint64_t> cleared{0};
+    uint32_t tid = 0;
+    TraceSlot slots[kTraceRingEvents];
+};
+
+static_assert((kTraceRingEvents & (kTraceRingEvents - 1)) == 0,
+              "kTraceRingEvents must be a power of two");
+
+std::atomic<bool> sRingEnabled{false};
+
+class TraceRegistry {
+public:
+    static TraceRegistry& get() {
+        static TraceRegistry* sRegistry = new TraceRegistry;
+        return *sRegistry;
+    }
+
+    // Rings are never freed; those of exited threads stay readable until
+    // a new thread picks them up.
+    TraceRing* acquire() {
+        std::lock_guard<std::mutex> g(mLock);
+        if (!mRetired.empty()) {
+            TraceRing* ring = mRetired.back();
+            mRetired.pop_back();
+            ring->cleared.store(ring->head.load(std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+            ring->tid = ++mNextTid;
+            return ring;
+        }
+        mRings.emplace_back(new TraceRing);
+        mRings.back()->tid = ++mNextTid;
+        return mRings.back().get();
+    }
+
+    void retire(TraceRing* ring) {
+        std::lock_guard<std::mutex> g(mLock);
+        mRetired.push_back(ring);
+    }
+
+    template <class F>
+    void forEach(F&& f) {
+        std::lock_guard<std::mutex> g(mLock);
+        for (auto& ring : mRings) {
+            f(*ring);
+        }
+    }
+
+private:
+    std::mutex mLock;
+    std::vector<std::unique_ptr<TraceRing>> mRings;
+    std::vector<TraceRing*> mRetired;
+    uint32_t mNextTid = 0;
+};
+
+struct ThreadTraceRing {
+    ~ThreadTraceRing() {
+        if (ring) {
+            TraceRegistry::get().retire(ring);
+        }
+    }
+    TraceRing* ring = nullptr;
+};
+
+thread_local ThreadTraceRing tThreadRing;
+
+void recordTraceEvent(TraceEventType type, const char* name, int64_t value) {
+    TraceRing* ring = tThreadRing.ring;
+    if (CC_UNLIKELY(!ring)) {
+        ring = tThreadRing.ring = TraceRegistry::get().acquire();
+    }
+    uint64_t index = ring->head.load(std::memory_order_relaxed);
+    ring->writing.store(index + 1, std::memory_order_relaxed);
+    // A reader that sees any of the slot stores below also sees |writing|.
+    std::atomic_thread_fence(std::memory_order_release);
+    TraceSlot& slot = ring->slots[index & (kTraceRingEvents - 1)];
+    slot.timeNs.store(traceNowNs(), std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.value.store(value, std::memory_order_relaxed);
+    slot.type.store(static_cast<uint32_t>(type), std::memory_order_relaxed);
+    ring->head.store(index + 1, std::memory_order_release);
+}
+
+struct TraceEvent {
+    uint64_t timeNs;
+    const char* name;
+    int64_t value;
+    TraceEventType type;
+    uint32_t tid;
+};
+
+void copyRing(TraceRing& ring, std::vector<TraceEvent>* out) {
+    const uint64_t end = ring.head.load(std::memory_order_acquire);
+    uint64_t begin = end > kTraceRingEvents ? end - kTraceRingEvents : 0;
+    begin = std::max(begin, ring.cleared.load(std::memory_order_relaxed));
+    if (begin >= end) {
+        return;
+    }
+    const size_t first = out->size();
+    for (uint64_t i = begin; i < end; ++i) {
+        const TraceSlot& slot = ring.slots[i & (kTraceRingEvents - 1)];
+        out->push_back(TraceEvent{
+                slot.timeNs.load(std::memory_order_relaxed),
+                slot.name.load(std::memory_order_relaxed),
+                slot.value.load(std::memory_order_relaxed),
+                static_cast<TraceEventType>(
+                        slot.type.load(std::memory_order_relaxed)),
+                ring.tid});
+    }
+    // The slot of event |i| is reused by event |i + kTraceRingEvents|, so
+    // anything the writer may have reached since is suspect.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t now = ring.writing.load(std::memory_order_relaxed);
+    if (now > begin + kTraceRingEvents) {
+        const uint64_t stale = std::min(now - kTraceRingEvents, end) - begin;
+        out->erase(out->begin() + first, out->begin() + first + stale);
+    }
+}
+
+void appendJsonString(std::string* out, const char* s) {
+    out->push_back('"');
+    for (; s && *s; ++s) {
+        const unsigned char c = *s;
+        if (c == '"' || c == '\\') {
+            out->push_back('\\');
+            out->push_back(c);
+        } else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out->append(buf);
+        } else {
+            out->push_back(c);
+        }
+    }
+    out->push_back('"');
+}
+
+}  // namespace
+
+std::string traceJson() {
+    std::vector<TraceEvent> events;
+    TraceRegistry::get().forEach(
+            [&events](TraceRing& ring) { copyRing(ring, &events); });
+
+    struct HostSpan {
+        GuestTraceSpan span;
+        uint64_t beginNs;
+        uint64_t endNs;
+    };
+    std::vector<HostSpan> guestSpans;
+    uint64_t startNs = UINT64_MAX;
+    for (const TraceEvent& e : events) {
+        startNs = std::min(startNs, e.timeNs);
+    }
+
+    std::string out = "{\"traceEvents\":[";
+    char buf[160];
+    bool first = true;
+    auto separate = [&out, &first] {
+        if (!first) {
+            out.push_back(',');
+        }
+        first = false;
+    };
+    // Times are relative to the earliest event, in microseconds.
+    auto appendTime = [&buf, &out, &startNs](const char* field, uint64_t ns) {
+        ns -= startNs;
+        snprintf(buf, sizeof(buf), ",\"%s\":%" PRIu64 ".%03u", field,
+                 ns / 1000, unsigned(ns % 1000));
+        out.append(buf);
+    };
+    auto appendFlow = [&](char phase, uint64_t id, uint64_t ns, int pid,
+                          uint32_t tid) {
+        separate();
+        snprintf(buf, sizeof(buf),
+                 "{\"name\":\"flow\",\"cat\":\"flow\",\"ph\":\"%c\","
+                 "\"bp\":\"e\",\"id\":%" PRIu64 ",\"pid\":%d,\"tid\":%u",
+                 phase, id, pid, tid);
+        out.append(buf);
+        appendTime("ts", ns);
+        out.push_back('}');
+    };
+
+    GuestTimeline::get().forEachSpan(
+            [&](const GuestTraceSpan& span, uint64_t beginNs, uint64_t endNs) {
+                guestSpans.push_back(HostSpan{span, beginNs, endNs});
+                startNs = std::min(startNs, beginNs);
+            });
+    for (const HostSpan& s : guestSpans) {
+        separate();
+        out.append("{\"name\":");
+        appendJsonString(&out, s.span.name.c_str());
+        snprintf(buf, sizeof(buf), ",\"ph\":\"X\",\"pid\":2,\"tid\":%u",
+                 s.span.tid);
+        out.append(buf);
+        appendTime("ts", s.beginNs);
+        const uint64_t durNs = s.endNs > s.beginNs ? s.endNs - s.beginNs : 0;
+        snprintf(buf, sizeof(buf), ",\"dur\":%" PRIu64 ".%03u}",
+                 durNs / 1000, unsigned(durNs % 1000));
+        out.append(buf);
+        if (s.span.flowId) {
+            appendFlow('s', s.span.flowId, s.beginNs, 2, s.span.tid);
+        }
+    }
+    if (!guestSpans.empty()) {
+        separate();
+        out.append("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+                   "\"args\":{\"name\":\"host\"}},"
+                   "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,"
+                   "\"args\":{\"name\":\"guest\"}}");
+    }
+
+    for (const TraceEvent& e : events) {
+        if (e.type == TraceEventType::FlowBegin ||
+            e.type == TraceEventType::FlowEnd) {
+            appendFlow(e.type == TraceEventType::FlowBegin ? 's' : 'f',
+                       uint64_t(e.value), e.timeNs, 1, e.tid);
+            continue;
+        }
+        separate();
+        const uint64_t ns = e.timeNs - startNs;
+        out.append("{\"name\":");
+        appendJsonString(&out, e.type == TraceEventType::End ? "" : e.name);
+        snprintf(buf, sizeof(buf),
+                 ",\"ph\":\"%c\",\"ts\":%" PRIu64 ".%03u,\"pid\":1,"
+                 "\"tid\":%u",
+                 e.type == TraceEventType::Begin
+                         ? 'B'
+                         : e.type == TraceEventType::End ? 'E' : 'C',
+                 ns / 1000, unsigned(ns % 1000), e.tid);
+        out.append(buf);
+        if (e.type == TraceEventType::Counter) {
+            snprintf(buf, sizeof(buf), ",\"args\":{\"value\":%" PRId64 "}",
+                     e.value);
+            out.append(buf);
+        }
+        out.push_back('}');
+    }
+    out.append("],\"displayTimeUnit\":\"ns\"}\n");
+    return out;
+}
+
+bool writeTraceJson(const char* path) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) {
+        return false;
+    }
+    const std::string json = traceJson();
+    const bool ok = fwrite(json.data(), 1, json.size(), fp) == json.size();
+    return fclose(fp) == 0 && ok;
+}
+
+void clearTrace() {
+    TraceRegistry::get().forEach([](TraceRing& ring) {
+        ring.cleared.store(ring.head.load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+    });
+    GuestTimeline::get().clearSpans();
+}
+
+#define TRACING_ACTIVE() (sRingEnabled.load(std::memory_order_relaxed))
+
+#else  // USE_PERFETTO_TRACING
+
+std::string traceJson() {
+    return std::string();
+}
+
+bool writeTraceJson(const char*) {
+    return false;
+}
+
+void clearTrace() {}
+
+#define TRACING_ACTIVE() (tracingDisabledPtr)
+
+#endif  // USE_PERFETTO_TRACING
+
 void initializeTracing() {
 #ifdef USE_PERFETTO_TRACING
     virtualdeviceperfetto::initialize(&tracingDisabledPtr);
@@ -39,6 +500,8 @@ void enableTracing() {
     if (virtualdeviceperfetto::queryTraceConfig().tracingDisabled) {
         virtualdeviceperfetto::enableTracing();
     }
+#else
+    sRingEnabled.store(true, std::memory_order_relaxed);
 #endif
 }
 
@@ -47,6 +510,8 @@ void disableTracing() {
     if (!virtualdeviceperfetto::queryTraceConfig().tracingDisabled) {
         virtualdeviceperfetto::disableTracing();
     }
+#else
+    sRingEnabled.store(false, std::memory_order_relaxed);
 #endif
 }
 
@@ -54,50 +519,73 @@ bool shouldEnableTracing() {
 #ifdef USE_PERFETTO_TRACING
     return !(virtualdeviceperfetto::queryTraceConfig().tracingDisabled);
 #else
-    return false;
+    return sRingEnabled.load(std::memory_order_relaxed);
 #endif
 }
 
-#ifdef __cplusplus
-#   define CC_LIKELY( exp )    (__builtin_expect( !!(exp), true ))
-#   define CC_UNLIKELY( exp )  (__builtin_expect( !!(exp), false ))
-#else
-#   define CC_LIKELY( exp )    (__builtin_expect( !!(exp), 1 ))
-#   define CC_UNLIKELY( exp )  (__builtin_expect( !!(exp), 0 ))
-#endif
-
 __attribute__((always_inline)) void beginTrace(const char* name) {
-    if (CC_LIKELY(!tracingDisabledPtr)) return;
+    if (CC_LIKELY(!TRACING_ACTIVE())) return;
 #ifdef USE_PERFETTO_TRACING
     virtualdeviceperfetto::beginTrace(name);
+#else
+    recordTraceEvent(TraceEventType::Begin, name, 0);
 #endif
 }
 
 __attribute__((always_inline)) void endTrace() {
-    if (CC_LIKELY(!tracingDisabledPtr)) return;
+    if (CC_LIKELY(!TRACING_ACTIVE())) return;
 #ifdef USE_PERFETTO_TRACING
     virtualdeviceperfetto::endTrace();
+#else
+    recordTraceEvent(TraceEventType::End, nullptr, 0);
 #endif
 }
 
 __attribute__((always_inline)) void traceCounter(const char* name, int64_t value) {
-    if (CC_LIKELY(!tracingDisabledPtr)) return;
+    if (CC_LIKELY(!TRACING_ACTIVE())) return;
 #ifdef USE_PERFETTO_TRACING
     virtualdeviceperfetto::traceCounter(name, value);
+#else
+    recordTraceEvent(TraceEventType::Counter, name, value);
+#endif
+}
+
+void traceFlowBegin(uint64_t id) {
+    if (CC_LIKELY(!TRACING_ACTIVE())) return;
+#ifndef USE_PERFETTO_TRACING
+    recordTraceEvent(TraceEventType::FlowBegin, nullptr, int64_t(id));
+#endif
+}
+
+void traceFlowEnd(uint64_t id) {
+    if (CC_LIKELY(!TRACING_ACTIVE())) return;
+#ifndef USE_PERFETTO_TRACING
+    recordTraceEvent(TraceEventType::FlowEnd, nullptr, int64_t(id));
+#endif
+}
+
+void addGuestTraceSpan(GuestTraceSpan span) {
+    if (CC_LIKELY(!TRACING_ACTIVE())) return;
+#ifndef USE_PERFETTO_TRACING
+    GuestTimeline::get().addSpan(std::move(span));
 #endif
 }
 
 ScopedTrace::ScopedTrace(const char* name) {
-    if (CC_LIKELY(!tracingDisabledPtr)) return;
+    if (CC_LIKELY(!TRACING_ACTIVE())) return;
 #ifdef USE_PERFETTO_TRACING
     virtualdeviceperfetto::beginTrace(name);
+#else
+    recordTraceEvent(TraceEventType::Begin, name, 0);
 #endif
 }
 
 ScopedTrace::~ScopedTrace() {
-    if (CC_LIKELY(!tracingDisabledPtr)) return;
+    if (CC_LIKELY(!TRACING_ACTIVE())) return;
 #ifdef USE_PERFETTO_TRACING
     virtualdeviceperfetto::endTrace();
+#else
+    recordTraceEvent(TraceEventType::End, nullptr, 0);
 #endif
 }
 
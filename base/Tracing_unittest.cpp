@@ -0,0 +1,196 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/Tracing.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+
+namespace android {
+namespace base {
+
+static size_t countOf(const std::string& haystack, const std::string& needle) {
+    size_t count = 0;
+    for (size_t pos = haystack.find(needle); pos != std::string::npos;
+         pos = haystack.find(needle, pos + needle.size())) {
+        ++count;
+    }
+    return count;
+}
+
+// Returns the "tid" field of the first event named |name|.
+static std::string tidOf(const std::string& json, const std::string& name) {
+    const size_t tid = json.find("\"tid\":", json.find(name));
+    return json.substr(tid, json.find('}', tid) - tid);
+}
+
+class TracingTest : public ::testing::Test {
+protected:
+    void SetUp() override { clearTrace(); }
+    void TearDown() override {
+        disableTracing();
+        clearTrace();
+    }
+};
+
+TEST_F(TracingTest, DisabledRecordsNothing) {
+    disableTracing();
+    EXPECT_FALSE(shouldEnableTracing());
+    { AEMU_SCOPED_TRACE("disabled"); }
+    traceCounter("disabledCounter", 1);
+    EXPECT_EQ(std::string::npos, traceJson().find("disabled"));
+}
+
+TEST_F(TracingTest, RecordsSlicesAndCounters) {
+    enableTracing();
+    EXPECT_TRUE(shouldEnableTracing());
+    {
+        AEMU_SCOPED_TRACE("outer");
+        beginTrace("inner");
+        traceCounter("frames", 42);
+        endTrace();
+    }
+    disableTracing();
+
+    const std::string json = traceJson();
+    EXPECT_EQ(0u, json.find("{\"traceEvents\":["));
+    EXPECT_EQ(1u, countOf(json, "\"name\":\"outer\",\"ph\":\"B\""));
+    EXPECT_EQ(1u, countOf(json, "\"name\":\"inner\",\"ph\":\"B\""));
+    EXPECT_EQ(2u, countOf(json, "\"ph\":\"E\""));
+    EXPECT_EQ(1u, countOf(json, "\"name\":\"frames\",\"ph\":\"C\""));
+    EXPECT_EQ(1u, countOf(json, "\"args\":{\"value\":42}"));
+    EXPECT_LT(json.find("outer"), json.find("inner"));
+}
+
+TEST_F(TracingTest, EscapesNames) {
+    enableTracing();
+    traceCounter("a\"b\\c\n", 0);
+    disableTracing();
+    EXPECT_NE(std::string::npos, traceJson().find("\"a\\\"b\\\\c\\u000a\""));
+}
+
+TEST_F(TracingTest, ClearDropsEvents) {
+    enableTracing();
+    traceCounter("beforeClear", 0);
+    clearTrace();
+    traceCounter("afterClear", 0);
+    disableTracing();
+
+    const std::string json = traceJson();
+    EXPECT_EQ(std::string::npos, json.find("beforeClear"));
+    EXPECT_NE(std::string::npos, json.find("afterClear"));
+}
+
+// Tests that a full ring keeps the newest events.
+TEST_F(TracingTest, RingKeepsNewestEvents) {
+    enableTracing();
+    traceCounter("oldest", 0);
+    for (size_t i = 0; i < kTraceRingEvents; ++i) {
+        traceCounter("filler", int64_t(i));
+    }
+    disableTracing();
+
+    const std::string json = traceJson();
+    EXPECT_EQ(std::string::npos, json.find("oldest"));
+    EXPECT_EQ(kTraceRingEvents, countOf(json, "\"filler\""));
+}
+
+TEST_F(TracingTest, ThreadsRecordSeparately) {
+    enableTracing();
+    traceCounter("mainThread", 0);
+    std::thread t([] { traceCounter("otherThread", 0); });
+    t.join();
+    disableTracing();
+
+    const std::string json = traceJson();
+    ASSERT_NE(std::string::npos, json.find("mainThread"));
+    ASSERT_NE(std::string::npos, json.find("otherThread"));
+    EXPECT_NE(tidOf(json, "mainThread"), tidOf(json, "otherThread"));
+}
+
+// Tests that the tightest clock sample sets the offset, and that the best
+// older and newer samples set the drift.
+TEST(TracingClockTest, GuestToHost) {
+    // The guest clock runs 1000 ns behind, and the host's gains 1 ns per
+    // microsecond on it.
+    for (uint64_t guestNs = 1000000; guestNs <= 32000000; guestNs += 1000000) {
+        const uint64_t hostNs = guestNs + 1000 + guestNs / 1000;
+        // The loose samples are off by their round trip.
+        const uint64_t slack = guestNs % 3000000 ? 100000 : 0;
+        addGuestClockSample(guestNs - slack, hostNs, guestNs + slack + 2);
+    }
+    EXPECT_NEAR(50000000.0 + 1000 + 50000,
+                double(guestToHostTraceNs(50000000)), 10.0);
+}
+
+// Tests that guest spans land on the host timeline as a second process,
+// with flows tying them to host slices.
+TEST_F(TracingTest, MergesGuestSpansAndFlows) {
+    enableTracing();
+    const uint64_t flow = traceFlowId(TraceFlowDomain::kAsgTransfer, 4096);
+    // Other tests' clock samples may scale the duration a little.
+    const uint64_t nowNs = traceTimeNs();
+    addGuestTraceSpan(GuestTraceSpan{"glDrawArrays", 7, nowNs, nowNs + 5000,
+                                     flow});
+    {
+        AEMU_SCOPED_TRACE("decode");
+        traceFlowEnd(flow);
+    }
+    disableTracing();
+
+    const std::string json = traceJson();
+    EXPECT_EQ(1u, countOf(json, "\"name\":\"glDrawArrays\",\"ph\":\"X\","
+                                "\"pid\":2,\"tid\":7"));
+    EXPECT_EQ(1u, countOf(json, "\"dur\":5."));
+    EXPECT_EQ(1u, countOf(json, "\"ph\":\"s\""));
+    EXPECT_EQ(1u, countOf(json, "\"ph\":\"f\""));
+    EXPECT_EQ(2u, countOf(json, "\"id\":" + std::to_string(flow)));
+    EXPECT_EQ(1u, countOf(json, "\"args\":{\"name\":\"guest\"}"));
+}
+
+// Tests that spans are imported up to the first truncated record.
+TEST_F(TracingTest, ImportsGuestSpans) {
+    struct __attribute__((__packed__)) Record {
+        uint32_t nameSize;
+        uint32_t tid;
+        uint64_t beginNs;
+        uint64_t endNs;
+        uint64_t flowId;
+    };
+    std::string data;
+    auto append = [&data](const std::string& name, uint32_t tid) {
+        const Record record = {uint32_t(name.size()), tid, 1000, 2000, 0};
+        data.append(reinterpret_cast<const char*>(&record), sizeof(record));
+        data.append(name);
+    };
+    append("eglSwapBuffers", 1);
+    append("vkQueueSubmit", 2);
+    append("truncated", 3);
+    data.resize(data.size() - 1);
+
+    enableTracing();
+    EXPECT_EQ(2u, importGuestTraceSpans(data.data(), data.size()));
+    disableTracing();
+
+    const std::string json = traceJson();
+    EXPECT_EQ(1u, countOf(json, "\"eglSwapBuffers\""));
+    EXPECT_EQ(1u, countOf(json, "\"vkQueueSubmit\""));
+    EXPECT_EQ(0u, countOf(json, "truncated"));
+}
+
+}  // namespace base
+}  // namespace android
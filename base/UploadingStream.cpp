@@ -0,0 +1,246 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/files/UploadingStream.h"
+
+#include "aemu/base/Hash.h"
+#include "aemu/base/threads/ThreadPool.h"
+
+#include <algorithm>
+
+#include <errno.h>
+
+namespace android {
+namespace base {
+
+void UploadManifest::save(Stream* stream) const {
+    stream->putBe32(kMagic);
+    stream->putBe32(kVersion);
+    stream->putBe32(partSize);
+    stream->putBe64(totalSize);
+    stream->putBe32(parts.size());
+    for (const Part& part : parts) {
+        stream->putBe64(part.offset);
+        stream->putBe32(part.size);
+        stream->putBe64(part.checksum);
+    }
+    stream->putBe64(checksum);
+}
+
+bool UploadManifest::load(Stream* stream) {
+    if (stream->getBe32() != kMagic || stream->getBe32() != kVersion) {
+        return false;
+    }
+    partSize = stream->getBe32();
+    totalSize = stream->getBe64();
+    parts.resize(stream->getBe32());
+    for (Part& part : parts) {
+        part.offset = stream->getBe64();
+        part.size = stream->getBe32();
+        part.checksum = stream->getBe64();
+    }
+    checksum = stream->getBe64();
+    return true;
+}
+
+struct UploadingStream::Part {
+    uint32_t index = 0;
+    std::vector<char> data;
+};
+
+UploadingStream::UploadingStream(Stream& output,
+                                 UploadSink& sink,
+                                 const UploadOptions& options)
+    : mOutput(output), mSink(sink), mOptions(options) {
+    mOptions.partSize = std::max<uint32_t>(mOptions.partSize, 4096);
+    mOptions.threadCount = std::max(mOptions.threadCount, 1);
+    if (!mOptions.maxPartsInFlight) {
+        mOptions.maxPartsInFlight = 2 * mOptions.threadCount;
+    }
+    mManifest.partSize = mOptions.partSize;
+
+    mPool = std::make_unique<ThreadPool<Part*>>(mOptions.threadCount,
+                                                [this](Part*&& part) { upload(part); });
+    if (!mPool->start()) {
+        // Upload on the calling thread instead.
+        mPool.reset();
+    }
+}
+
+UploadingStream::~UploadingStream() {
+    stop(false);
+}
+
+ssize_t UploadingStream::read(void*, size_t) {
+    return -EPERM;
+}
+
+ssize_t UploadingStream::write(const void* buffer, size_t size) {
+    if (mStopped) {
+        return -EBADF;
+    }
+    {
+        AutoLock lock(mLock);
+        if (mError) {
+            return mError;
+        }
+    }
+    if (!size) {
+        return 0;
+    }
+    if (mOutput.write(buffer, size) != static_cast<ssize_t>(size)) {
+        AutoLock lock(mLock);
+        mError = -EIO;
+        return mError;
+    }
+
+    auto src = static_cast<const char*>(buffer);
+    size_t left = size;
+    while (left) {
+        if (!mCurrent) {
+            {
+                AutoLock lock(mLock);
+                if (!mFree.empty()) {
+                    mCurrent = std::move(mFree.back());
+                    mFree.pop_back();
+                }
+            }
+            if (!mCurrent) {
+                mCurrent = std::make_unique<Part>();
+                mCurrent->data.reserve(mOptions.partSize);
+            }
+            mCurrent->index = mManifest.parts.size();
+        }
+        auto& data = mCurrent->data;
+        const size_t chunk = std::min<size_t>(left, mOptions.partSize - data.size());
+        data.insert(data.end(), src, src + chunk);
+        src += chunk;
+        left -= chunk;
+        if (data.size() == mOptions.partSize) {
+            submitPart();
+        }
+    }
+    mSize += size;
+
+    AutoLock lock(mLock);
+    return mError ? mError : static_cast<ssize_t>(size);
+}
+
+int UploadingStream::finish() {
+    return stop(false);
+}
+
+void UploadingStream::cancel() {
+    stop(true);
+}
+
+void UploadingStream::submitPart() {
+    Part* part = mCurrent.release();
+    {
+        AutoLock lock(mLock);
+        const uint64_t offset = uint64_t(part->index) * mOptions.partSize;
+        mManifest.parts.push_back(
+                UploadManifest::Part{offset, static_cast<uint32_t>(part->data.size()), 0});
+        ++mInFlight;
+    }
+    if (mPool) {
+        mPool->enqueue(std::move(part));
+    } else {
+        upload(part);
+    }
+    // Hold the writer back until there is room for the next part.
+    waitForParts(mOptions.maxPartsInFlight);
+}
+
+void UploadingStream::upload(Part* part) {
+    bool skip;
+    {
+        AutoLock lock(mLock);
+        skip = mError || mCancelled;
+    }
+    uint64_t checksum = 0;
+    int result = 0;
+    if (!skip) {
+        checksum = xxh3Hash64(part->data.data(), part->data.size());
+        result = mSink.uploadPart(part->index, part->data.data(), part->data.size());
+    }
+    AutoLock lock(mLock);
+    mManifest.parts[part->index].checksum = checksum;
+    if (result && !mError) {
+        mError = result;
+    }
+    part->data.clear();
+    mFree.emplace_back(part);
+    --mInFlight;
+    mPartDone.broadcastAndUnlock(&lock);
+}
+
+void UploadingStream::waitForParts(size_t maxInFlight) {
+    AutoLock lock(mLock);
+    mPartDone.wait(&lock, [this, maxInFlight] { return mInFlight < maxInFlight; });
+}
+
+int UploadingStream::stop(bool cancelled) {
+    if (mStopped) {
+        AutoLock lock(mLock);
+        return mError;
+    }
+    mStopped = true;
+    if (cancelled) {
+        AutoLock lock(mLock);
+        mCancelled = true;
+    } else if (mCurrent && !mCurrent->data.empty()) {
+        submitPart();
+    }
+    mCurrent.reset();
+    waitForParts(1);
+    if (mPool) {
+        mPool->done();
+        mPool->join();
+        mPool.reset();
+    }
+
+    int error;
+    {
+        AutoLock lock(mLock);
+        error = mError;
+    }
+    if (!cancelled && !error) {
+        mManifest.totalSize = mSize;
+        std::vector<uint8_t> checksums(8 * mManifest.parts.size());
+        for (size_t i = 0; i < mManifest.parts.size(); ++i) {
+            const uint64_t checksum = mManifest.parts[i].checksum;
+            for (int byte = 0; byte < 8; ++byte) {
+                checksums[8 * i + byte] = uint8_t(checksum >> (56 - 8 * byte));
+            }
+        }
+        mManifest.checksum = xxh3Hash64(checksums.data(), checksums.size());
+        error = mSink.complete(mManifest);
+    }
+    if (cancelled || error) {
+        mSink.abort();
+    }
+    if (cancelled && !error) {
+        error = -ECANCELED;
+    }
+
+    AutoLock lock(mLock);
+    if (error && !mError) {
+        mError = error;
+    }
+    return mError;
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,226 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/files/UploadingStream.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "aemu/base/Hash.h"
+#include "aemu/base/files/MemStream.h"
+#include "aemu/base/system/System.h"
+
+namespace android {
+namespace base {
+namespace {
+
+constexpr uint32_t kPartSize = 4096;
+
+std::vector<char> makeData(size_t size) {
+    std::vector<char> data(size);
+    uint32_t x = 1;
+    for (char& c : data) {
+        x = x * 1103515245 + 12345;
+        c = char(x >> 24);
+    }
+    return data;
+}
+
+class FakeSink : public UploadSink {
+public:
+    int uploadPart(uint32_t index, const void* data, size_t size) override {
+        const int inFlight = ++mInFlight;
+        mMaxInFlight = std::max(mMaxInFlight.load(), inFlight);
+        while (mBlocked) {
+            sleepMs(1);
+        }
+        int result = 0;
+        {
+            AutoLock lock(mLock);
+            auto bytes = static_cast<const char*>(data);
+            mParts[index].assign(bytes, bytes + size);
+            if (index == mFailPart) {
+                result = -EIO;
+            }
+        }
+        --mInFlight;
+        return result;
+    }
+
+    int complete(const UploadManifest& manifest) override {
+        mCompleted++;
+        mManifest = manifest;
+        return 0;
+    }
+
+    void abort() override { mAborted++; }
+
+    std::vector<char> assemble() {
+        AutoLock lock(mLock);
+        std::vector<char> data;
+        for (const auto& part : mParts) {
+            data.insert(data.end(), part.second.begin(), part.second.end());
+        }
+        return data;
+    }
+
+    Lock mLock;
+    std::map<uint32_t, std::vector<char>> mParts;
+    uint32_t mFailPart = UINT32_MAX;
+    std::atomic<bool> mBlocked{false};
+    std::atomic<int> mInFlight{0};
+    std::atomic<int> mMaxInFlight{0};
+    int mCompleted = 0;
+    int mAborted = 0;
+    UploadManifest mManifest;
+};
+
+UploadOptions smallParts() {
+    UploadOptions options;
+    options.partSize = kPartSize;
+    options.threadCount = 3;
+    options.maxPartsInFlight = 4;
+    return options;
+}
+
+// Tests that odd sized writes reach both the output and the sink intact, and
+// that the manifest describes the parts the sink got.
+TEST(UploadingStream, TeesAndCompletes) {
+    const auto data = makeData(10 * kPartSize + 123);
+    MemStream local;
+    FakeSink sink;
+    {
+        UploadingStream stream(local, sink, smallParts());
+        for (size_t pos = 0; pos < data.size();) {
+            const size_t chunk = std::min<size_t>(data.size() - pos, 1 + pos % 5000);
+            ASSERT_EQ((ssize_t)chunk, stream.write(data.data() + pos, chunk));
+            pos += chunk;
+        }
+        EXPECT_EQ(data.size(), stream.size());
+        EXPECT_EQ(0, stream.finish());
+
+        const UploadManifest& manifest = stream.manifest();
+        EXPECT_EQ(kPartSize, manifest.partSize);
+        EXPECT_EQ(data.size(), manifest.totalSize);
+        ASSERT_EQ(11u, manifest.parts.size());
+        for (size_t i = 0; i < manifest.parts.size(); ++i) {
+            const auto& part = manifest.parts[i];
+            EXPECT_EQ(i * kPartSize, part.offset);
+            EXPECT_EQ(i < 10 ? kPartSize : 123u, part.size);
+            EXPECT_EQ(xxh3Hash64(data.data() + part.offset, part.size), part.checksum);
+        }
+        EXPECT_EQ(-EBADF, stream.write(data.data(), 1));
+    }
+
+    EXPECT_EQ(data, std::vector<char>(local.buffer().begin(), local.buffer().end()));
+    EXPECT_EQ(data, sink.assemble());
+    EXPECT_EQ(1, sink.mCompleted);
+    EXPECT_EQ(0, sink.mAborted);
+    EXPECT_EQ(11u, sink.mManifest.parts.size());
+}
+
+// Tests that the manifest survives a save and load.
+TEST(UploadingStream, ManifestRoundTrip) {
+    const auto data = makeData(3 * kPartSize);
+    MemStream local;
+    FakeSink sink;
+    UploadingStream stream(local, sink, smallParts());
+    stream.write(data.data(), data.size());
+    ASSERT_EQ(0, stream.finish());
+
+    MemStream saved;
+    stream.manifest().save(&saved);
+    UploadManifest loaded;
+    ASSERT_TRUE(loaded.load(&saved));
+    EXPECT_EQ(stream.manifest().totalSize, loaded.totalSize);
+    EXPECT_EQ(stream.manifest().checksum, loaded.checksum);
+    ASSERT_EQ(3u, loaded.parts.size());
+    EXPECT_EQ(stream.manifest().parts[2].checksum, loaded.parts[2].checksum);
+
+    MemStream garbage;
+    garbage.putBe32(0x12345678);
+    EXPECT_FALSE(loaded.load(&garbage));
+}
+
+// Tests that a stalled sink holds the writer back instead of buffering
+// without bound.
+TEST(UploadingStream, WriterWaitsForSlowSink) {
+    const auto data = makeData(20 * kPartSize);
+    MemStream local;
+    FakeSink sink;
+    sink.mBlocked = true;
+    UploadingStream stream(local, sink, smallParts());
+
+    std::atomic<size_t> written{0};
+    std::thread writer([&] {
+        for (size_t pos = 0; pos < data.size(); pos += kPartSize) {
+            stream.write(data.data() + pos, kPartSize);
+            written += kPartSize;
+        }
+    });
+    // Three parts go out and the fourth fills the last slot, so the write
+    // that handed it over doesn't return.
+    for (int i = 0; i < 5000 && written < 3 * kPartSize; ++i) {
+        sleepMs(1);
+    }
+    sleepMs(20);
+    EXPECT_EQ(3 * kPartSize, written);
+    sink.mBlocked = false;
+    writer.join();
+
+    EXPECT_EQ(0, stream.finish());
+    EXPECT_LE(sink.mMaxInFlight, 3);
+    EXPECT_EQ(data, sink.assemble());
+}
+
+// Tests that a failed part fails the stream and aborts the upload.
+TEST(UploadingStream, SinkErrorIsSticky) {
+    const auto data = makeData(8 * kPartSize);
+    MemStream local;
+    FakeSink sink;
+    sink.mFailPart = 2;
+    UploadingStream stream(local, sink, smallParts());
+    ssize_t result = 0;
+    for (size_t pos = 0; pos < data.size() && result >= 0; pos += kPartSize) {
+        result = stream.write(data.data() + pos, kPartSize);
+    }
+    EXPECT_EQ(-EIO, stream.finish());
+    EXPECT_EQ(0, sink.mCompleted);
+    EXPECT_EQ(1, sink.mAborted);
+}
+
+// Tests that cancelling aborts the upload without completing it.
+TEST(UploadingStream, Cancel) {
+    const auto data = makeData(2 * kPartSize + 10);
+    MemStream local;
+    FakeSink sink;
+    {
+        UploadingStream stream(local, sink, smallParts());
+        stream.write(data.data(), data.size());
+        stream.cancel();
+        EXPECT_EQ(-ECANCELED, stream.finish());
+    }
+    EXPECT_EQ(0, sink.mCompleted);
+    EXPECT_EQ(1, sink.mAborted);
+    // The partial last part is never uploaded.
+    EXPECT_EQ(0u, sink.mParts.count(2));
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,397 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/misc/Utf8Utils.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define UTF_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define UTF_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace android {
+namespace base {
+namespace {
+
+constexpr char16_t kReplacement = 0xFFFD;
+// What decodeOne() reports for a malformed sequence.
+constexpr uint32_t kInvalid = 0xFFFFFFFF;
+
+// Return the length of the run of ASCII bytes at the start of |text|.
+size_t asciiPrefix(const uint8_t* text, size_t len) {
+    size_t pos = 0;
+#if UTF_SSE2
+    for (; pos + 16 <= len; pos += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+        if (_mm_movemask_epi8(v)) {
+            break;
+        }
+    }
+#elif UTF_NEON
+    for (; pos + 16 <= len; pos += 16) {
+        if (vmaxvq_u8(vld1q_u8(text + pos)) & 0x80) {
+            break;
+        }
+    }
+#else
+    for (; pos + 8 <= len; pos += 8) {
+        uint64_t word;
+        memcpy(&word, text + pos, sizeof(word));
+        if (word & 0x8080808080808080ULL) {
+            break;
+        }
+    }
+#endif
+    while (pos < len && text[pos] < 0x80) {
+        ++pos;
+    }
+    return pos;
+}
+
+// Copy ASCII |text| widened to UTF-16, as long as it stays ASCII and fits.
+// Return the number of bytes consumed, which is also the number of units
+// written.
+size_t widenAscii(const uint8_t* text, size_t len, char16_t* out) {
+    size_t pos = 0;
+#if UTF_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; pos + 16 <= len; pos += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+        if (_mm_movemask_epi8(v)) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + pos),
+                         _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + pos + 8),
+                         _mm_unpackhi_epi8(v, zero));
+    }
+#elif UTF_NEON
+    for (; pos + 16 <= len; pos += 16) {
+        uint8x16_t v = vld1q_u8(text + pos);
+        if (vmaxvq_u8(v) & 0x80) {
+            break;
+        }
+        vst1q_u16(reinterpret_cast<uint16_t*>(out + pos),
+                  vmovl_u8(vget_low_u8(v)));
+        vst1q_u16(reinterpret_cast<uint16_t*>(out + pos + 8),
+                  vmovl_high_u8(v));
+    }
+#endif
+    for (; pos < len && text[pos] < 0x80; ++pos) {
+        out[pos] = text[pos];
+    }
+    return pos;
+}
+
+// Copy ASCII UTF-16 |text| narrowed to UTF-8, as long as it stays ASCII.
+// Return the number of units consumed, which is also the number of bytes
+// written.
+size_t narrowAscii(const char16_t* text, size_t len, char* out) {
+    size_t pos = 0;
+#if UTF_SSE2
+    const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    for (; pos + 16 <= len; pos += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos + 8));
+        __m128i high = _mm_and_si128(_mm_or_si128(a, b), nonAscii);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, zero)) != 0xFFFF) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + pos),
+                         _mm_packus_epi16(a, b));
+    }
+#elif UTF_NEON
+    for (; pos + 16 <= len; pos += 16) {
+        uint16x8_t a = vld1q_u16(reinterpret_cast<const uint16_t*>(text + pos));
+        uint16x8_t b = vld1q_u16(reinterpret_cast<const uint16_t*>(text + pos + 8));
+        if (vmaxvq_u16(vorrq_u16(a, b)) >= 0x80) {
+            break;
+        }
+        vst1q_u8(reinterpret_cast<uint8_t*>(out + pos),
+                 vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+    }
+#endif
+    for (; pos < len && text[pos] < 0x80; ++pos) {
+        out[pos] = static_cast<char>(text[pos]);
+    }
+    return pos;
+}
+
+// Return the length of the run of ASCII code units at the start of |text|.
+size_t asciiPrefix16(const char16_t* text, size_t len) {
+    size_t pos = 0;
+#if UTF_SSE2
+    const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    for (; pos + 8 <= len; pos += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, nonAscii), zero)) !=
+            0xFFFF) {
+            break;
+        }
+    }
+#elif UTF_NEON
+    for (; pos + 8 <= len; pos += 8) {
+        if (vmaxvq_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(text + pos))) >=
+            0x80) {
+            break;
+        }
+    }
+#endif
+    while (pos < len && text[pos] < 0x80) {
+        ++pos;
+    }
+    return pos;
+}
+
+// Decode the sequence starting with the non-ASCII byte at |text|. Return
+// the number of bytes it takes; on malformed input that is the length of
+// the longest valid prefix (at least one), which gets replaced as a whole
+// as the Unicode standard recommends, and |*codepoint| is set to kInvalid.
+size_t decodeOne(const uint8_t* text, size_t len, uint32_t* codepoint) {
+    const uint8_t lead = text[0];
+    size_t need;
+    uint32_t value;
+    uint8_t lo = 0x80;
+    uint8_t hi = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        need = 1;
+        value = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        need = 2;
+        value = lead & 0x0F;
+        if (lead == 0xE0) lo = 0xA0;       // overlong
+        if (lead == 0xED) hi = 0x9F;       // surrogates
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        need = 3;
+        value = lead & 0x07;
+        if (lead == 0xF0) lo = 0x90;       // overlong
+        if (lead == 0xF4) hi = 0x8F;       // above U+10FFFF
+    } else {
+        *codepoint = kInvalid;
+        return 1;
+    }
+
+    for (size_t i = 1; i <= need; ++i) {
+        if (i >= len || text[i] < lo || text[i] > hi) {
+            *codepoint = kInvalid;
+            return i;
+        }
+        value = (value << 6) | (text[i] & 0x3F);
+        lo = 0x80;
+        hi = 0xBF;
+    }
+    *codepoint = value;
+    return need + 1;
+}
+
+// Decode the UTF-16 character at |text|, turning unpaired surrogates into
+// U+FFFD. Return the number of units it takes.
+size_t decodeOne16(const char16_t* text, size_t len, uint32_t* codepoint) {
+    const uint32_t unit = text[0];
+    if (unit < 0xD800 || unit > 0xDFFF) {
+        *codepoint = unit;
+        return 1;
+    }
+    if (unit <= 0xDBFF && len > 1 && text[1] >= 0xDC00 && text[1] <= 0xDFFF) {
+        *codepoint = 0x10000 + ((unit - 0xD800) << 10) + (text[1] - 0xDC00);
+        return 2;
+    }
+    *codepoint = kReplacement;
+    return 1;
+}
+
+size_t utf8Length(uint32_t codepoint) {
+    return codepoint < 0x80 ? 1 : codepoint < 0x800 ? 2 : codepoint < 0x10000 ? 3 : 4;
+}
+
+}  // namespace
+
+bool utf8IsValid(const char* text, size_t textLen) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(text);
+    size_t pos = 0;
+    while (pos < textLen) {
+        pos += asciiPrefix(p + pos, textLen - pos);
+        if (pos == textLen) {
+            break;
+        }
+        uint32_t codepoint;
+        pos += decodeOne(p + pos, textLen - pos, &codepoint);
+        if (codepoint == kInvalid) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int utf8Decode(const uint8_t* text, size_t textLen, uint32_t* codepoint) {
+    if (!textLen) {
+        return -1;
+    }
+    if (text[0] < 0x80) {
+        *codepoint = text[0];
+        return 1;
+    }
+    uint32_t value;
+    const size_t used = decodeOne(text, textLen, &value);
+    if (value == kInvalid) {
+        return -1;
+    }
+    *codepoint = value;
+    return static_cast<int>(used);
+}
+
+int utf8Encode(uint32_t codepoint, uint8_t* buffer, size_t buffer_len) {
+    if (codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        return -1;
+    }
+    const size_t len = utf8Length(codepoint);
+    if (!buffer) {
+        return static_cast<int>(len);
+    }
+    if (buffer_len < len) {
+        return -1;
+    }
+    switch (len) {
+        case 1:
+            buffer[0] = static_cast<uint8_t>(codepoint);
+            break;
+        case 2:
+            buffer[0] = static_cast<uint8_t>(0xC0 | (codepoint >> 6));
+            buffer[1] = static_cast<uint8_t>(0x80 | (codepoint & 0x3F));
+            break;
+        case 3:
+            buffer[0] = static_cast<uint8_t>(0xE0 | (codepoint >> 12));
+            buffer[1] = static_cast<uint8_t>(0x80 | ((codepoint >> 6) & 0x3F));
+            buffer[2] = static_cast<uint8_t>(0x80 | (codepoint & 0x3F));
+            break;
+        default:
+            buffer[0] = static_cast<uint8_t>(0xF0 | (codepoint >> 18));
+            buffer[1] = static_cast<uint8_t>(0x80 | ((codepoint >> 12) & 0x3F));
+            buffer[2] = static_cast<uint8_t>(0x80 | ((codepoint >> 6) & 0x3F));
+            buffer[3] = static_cast<uint8_t>(0x80 | (codepoint & 0x3F));
+            break;
+    }
+    return static_cast<int>(len);
+}
+
+size_t utf8ToUtf16Length(const char* text, size_t textLen) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(text);
+    size_t pos = 0;
+    size_t result = 0;
+    while (pos < textLen) {
+        const size_t ascii = asciiPrefix(p + pos, textLen - pos);
+        pos += ascii;
+        result += ascii;
+        if (pos == textLen) {
+            break;
+        }
+        uint32_t codepoint;
+        pos += decodeOne(p + pos, textLen - pos, &codepoint);
+        result += (codepoint != kInvalid && codepoint >= 0x10000) ? 2 : 1;
+    }
+    return result;
+}
+
+size_t utf8ToUtf16(const char* text,
+                   size_t textLen,
+                   char16_t* out,
+                   size_t outLen) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(text);
+    size_t pos = 0;
+    size_t written = 0;
+    while (pos < textLen) {
+        const size_t room = outLen - written;
+        const size_t ascii =
+                widenAscii(p + pos, room < textLen - pos ? room : textLen - pos,
+                           out + written);
+        pos += ascii;
+        written += ascii;
+        if (pos == textLen || written == outLen) {
+            break;
+        }
+        uint32_t codepoint;
+        const size_t used = decodeOne(p + pos, textLen - pos, &codepoint);
+        if (codepoint == kInvalid) {
+            codepoint = kReplacement;
+        }
+        if (codepoint >= 0x10000) {
+            if (outLen - written < 2) {
+                break;
+            }
+            codepoint -= 0x10000;
+            out[written++] = static_cast<char16_t>(0xD800 + (codepoint >> 10));
+            out[written++] = static_cast<char16_t>(0xDC00 + (codepoint & 0x3FF));
+        } else {
+            out[written++] = static_cast<char16_t>(codepoint);
+        }
+        pos += used;
+    }
+    return written;
+}
+
+size_t utf16ToUtf8Length(const char16_t* text, size_t textLen) {
+    size_t pos = 0;
+    size_t result = 0;
+    while (pos < textLen) {
+        const size_t ascii = asciiPrefix16(text + pos, textLen - pos);
+        pos += ascii;
+        result += ascii;
+        if (pos == textLen) {
+            break;
+        }
+        uint32_t codepoint;
+        pos += decodeOne16(text + pos, textLen - pos, &codepoint);
+        result += utf8Length(codepoint);
+    }
+    return result;
+}
+
+size_t utf16ToUtf8(const char16_t* text,
+                   size_t textLen,
+                   char* out,
+                   size_t outLen) {
+    size_t pos = 0;
+    size_t written = 0;
+    while (pos < textLen) {
+        const size_t room = outLen - written;
+        const size_t ascii =
+                narrowAscii(text + pos, room < textLen - pos ? room : textLen - pos,
+                            out + written);
+        pos += ascii;
+        written += ascii;
+        if (pos == textLen || written == outLen) {
+            break;
+        }
+        uint32_t codepoint;
+        const size_t used = decodeOne16(text + pos, textLen - pos, &codepoint);
+        const int len = utf8Encode(codepoint, reinterpret_cast<uint8_t*>(out + written),
+                                   outLen - written);
+        if (len < 0) {
+            break;
+        }
+        written += static_cast<size_t>(len);
+        pos += used;
+    }
+    return written;
+}
+
+}  // namespace base
+}  // namespace android
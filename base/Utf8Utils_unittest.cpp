@@ -0,0 +1,112 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/misc/Utf8Utils.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace android {
+namespace base {
+namespace {
+
+std::u16string toUtf16(const std::string& text) {
+    std::u16string result(utf8ToUtf16Length(text.data(), text.size()), u'\0');
+    EXPECT_EQ(result.size(),
+              utf8ToUtf16(text.data(), text.size(), &result[0], result.size()));
+    return result;
+}
+
+std::string toUtf8(const std::u16string& text) {
+    std::string result(utf16ToUtf8Length(text.data(), text.size()), '\0');
+    EXPECT_EQ(result.size(),
+              utf16ToUtf8(text.data(), text.size(), &result[0], result.size()));
+    return result;
+}
+
+// Tests validation, including the classic overlong and surrogate cases.
+TEST(Utf8Utils, IsValid) {
+    const std::string ascii(100, 'a');
+    EXPECT_TRUE(utf8IsValid(ascii.data(), ascii.size()));
+    EXPECT_TRUE(utf8IsValid("", 0));
+    EXPECT_TRUE(utf8IsValid("T\xC3\xA9l\xC3\xA9vision", 12));
+    EXPECT_TRUE(utf8IsValid("\xEF\xBF\xBD", 3));
+    EXPECT_TRUE(utf8IsValid("\xF0\x9F\x98\x80", 4));
+
+    EXPECT_FALSE(utf8IsValid("\xC0\xAF", 2));          // overlong '/'
+    EXPECT_FALSE(utf8IsValid("\xED\xA0\x80", 3));      // surrogate
+    EXPECT_FALSE(utf8IsValid("\xF4\x90\x80\x80", 4));  // above U+10FFFF
+    EXPECT_FALSE(utf8IsValid("\xF0\x9F\x98", 3));      // truncated
+    EXPECT_FALSE(utf8IsValid("\xF0\x9F\x98z", 4));
+    // Non-ASCII after a long ASCII run is still seen.
+    const std::string tail = ascii + "\x80" + ascii;
+    EXPECT_FALSE(utf8IsValid(tail.data(), tail.size()));
+}
+
+TEST(Utf8Utils, DecodeEncode) {
+    const uint8_t euro[] = {0xE2, 0x82, 0xAC};
+    uint32_t codepoint = 0;
+    EXPECT_EQ(3, utf8Decode(euro, 3, &codepoint));
+    EXPECT_EQ(0x20ACu, codepoint);
+    EXPECT_EQ(-1, utf8Decode(euro, 2, &codepoint));
+
+    uint8_t buffer[4];
+    EXPECT_EQ(3, utf8Encode(0x20AC, buffer, sizeof(buffer)));
+    EXPECT_EQ(0, memcmp(euro, buffer, 3));
+    EXPECT_EQ(4, utf8Encode(0x1F600, nullptr, 0));
+    EXPECT_EQ(-1, utf8Encode(0x20AC, buffer, 2));
+    EXPECT_EQ(-1, utf8Encode(0x110000, buffer, sizeof(buffer)));
+}
+
+// Tests round trips across the ASCII fast path boundaries.
+TEST(Utf8Utils, RoundTrip) {
+    for (size_t prefix = 0; prefix < 40; ++prefix) {
+        const std::string text = std::string(prefix, 'x') +
+                                 "T\xC3\xA9l\xE2\x82\xAC\xF0\x9F\x98\x80" +
+                                 std::string(prefix, 'y');
+        const std::u16string wide = toUtf16(text);
+        EXPECT_EQ(std::u16string(prefix, u'x') + u"Tél€\U0001F600" +
+                          std::u16string(prefix, u'y'),
+                  wide);
+        EXPECT_EQ(text, toUtf8(wide));
+    }
+}
+
+// Tests that malformed input becomes U+FFFD per maximal invalid subpart.
+TEST(Utf8Utils, Replacement) {
+    EXPECT_EQ(u"a�b", toUtf16("a\xF0\x9F\x98" "b"));
+    EXPECT_EQ(u"��", toUtf16("\xC0\xAF"));
+    EXPECT_EQ(u"���", toUtf16("\xED\xA0\x80"));
+    EXPECT_EQ("a\xEF\xBF\xBD" "b", toUtf8(std::u16string(u"a") + char16_t(0xD800) + u"b"));
+    EXPECT_EQ("\xEF\xBF\xBD", toUtf8(std::u16string(1, char16_t(0xDC00))));
+}
+
+// Tests that conversions stop cleanly when the output is too small.
+TEST(Utf8Utils, ShortOutput) {
+    char16_t wide[4];
+    EXPECT_EQ(2u, utf8ToUtf16("ab\xF0\x9F\x98\x80", 6, wide, 3));
+    EXPECT_EQ(4u, utf8ToUtf16("ab\xF0\x9F\x98\x80", 6, wide, 4));
+    EXPECT_EQ(char16_t(0xD83D), wide[2]);
+
+    char narrow[4];
+    const std::u16string text = u"ab€";
+    EXPECT_EQ(2u, utf16ToUtf8(text.data(), text.size(), narrow, 4));
+    EXPECT_EQ(5u, utf16ToUtf8Length(text.data(), text.size()));
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
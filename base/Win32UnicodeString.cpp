@@ -14,89 +14,127 @@
 
 #include "aemu/base/system/Win32UnicodeString.h"
 
-#include <algorithm>
-
-#include <windows.h>
+#include "aemu/base/misc/Utf8Utils.h"
 
 #include <string.h>
 
 namespace android {
 namespace base {
 
-Win32UnicodeString::Win32UnicodeString() : mStr(nullptr), mSize(0u) {}
+// wchar_t is UTF-16 on Windows, which is what Utf8Utils works with.
+static_assert(sizeof(wchar_t) == sizeof(char16_t), "wchar_t must be 16 bits");
+
+static const char16_t* asUtf16(const wchar_t* str) {
+    return reinterpret_cast<const char16_t*>(str);
+}
+
+static char16_t* asUtf16(wchar_t* str) {
+    return reinterpret_cast<char16_t*>(str);
+}
+
+Win32UnicodeString::Win32UnicodeString()
+    : mStr(mInline), mSize(0u), mCapacity(kInlineCapacity) {
+    mInline[0] = L'\0';
+}
 
 Win32UnicodeString::Win32UnicodeString(const char* str, size_t len)
-    : mStr(nullptr), mSize(0u) {
-    reset(str, strlen(str));
+    : Win32UnicodeString() {
+    reset(str, len);
 }
 
 Win32UnicodeString::Win32UnicodeString(const char* str)
-    : mStr(nullptr), mSize(0u) {
+    : Win32UnicodeString() {
     reset(str);
 }
 
 Win32UnicodeString::Win32UnicodeString(const std::string& str)
-    : mStr(nullptr), mSize(0u) {
-    reset(str.c_str());
+    : Win32UnicodeString() {
+    reset(str.c_str(), str.size());
 }
 
-Win32UnicodeString::Win32UnicodeString(size_t size) : mStr(nullptr), mSize(0u) {
+Win32UnicodeString::Win32UnicodeString(size_t size) : Win32UnicodeString() {
     resize(size);
 }
 
 Win32UnicodeString::Win32UnicodeString(const wchar_t* str)
-    : mStr(nullptr), mSize(0u) {
-    size_t len = str ? wcslen(str) : 0u;
-    resize(len);
-    ::memcpy(mStr, str ? str : L"", len * sizeof(wchar_t));
+    : Win32UnicodeString() {
+    *this = str;
 }
 
 Win32UnicodeString::Win32UnicodeString(const Win32UnicodeString& other)
-    : mStr(nullptr), mSize(0u) {
-    resize(other.mSize);
-    ::memcpy(mStr, other.c_str(), other.mSize * sizeof(wchar_t));
+    : Win32UnicodeString() {
+    *this = other;
+}
+
+Win32UnicodeString::Win32UnicodeString(Win32UnicodeString&& other)
+    : Win32UnicodeString() {
+    if (other.isInline()) {
+        *this = other;
+    } else {
+        mStr = other.mStr;
+        mSize = other.mSize;
+        mCapacity = other.mCapacity;
+        other.mStr = other.mInline;
+        other.mSize = 0;
+        other.mCapacity = kInlineCapacity;
+        other.mInline[0] = L'\0';
+    }
 }
 
 Win32UnicodeString::~Win32UnicodeString() {
-    delete[] mStr;
+    if (!isInline()) {
+        delete[] mStr;
+    }
 }
 
 Win32UnicodeString& Win32UnicodeString::operator=(
         const Win32UnicodeString& other) {
-    resize(other.mSize);
-    ::memcpy(mStr, other.c_str(), other.mSize * sizeof(wchar_t));
+    if (&other != this) {
+        reserve(other.mSize, false);
+        ::memcpy(mStr, other.mStr, other.mSize * sizeof(wchar_t));
+        mSize = other.mSize;
+        mStr[mSize] = L'\0';
+    }
     return *this;
 }
 
 Win32UnicodeString& Win32UnicodeString::operator=(const wchar_t* str) {
     size_t len = str ? wcslen(str) : 0u;
-    resize(len);
+    reserve(len, false);
     ::memcpy(mStr, str ? str : L"", len * sizeof(wchar_t));
+    mSize = len;
+    mStr[mSize] = L'\0';
     return *this;
 }
 
 wchar_t* Win32UnicodeString::data() {
-    if (!mStr) {
-        // Ensure the function never returns NULL.
-        // it is safe to const_cast the pointer here - user isn't allowed to
-        // write into it anyway
-        return const_cast<wchar_t*>(L"");
-    }
     return mStr;
 }
 
 std::string Win32UnicodeString::toString() const {
-    return convertToUtf8(mStr, mSize);
+    return convertToUtf8(mStr, static_cast<int>(mSize));
 }
 
-void Win32UnicodeString::reset(const char* str, size_t len) {
-    if (mStr) {
+void Win32UnicodeString::reserve(size_t capacity, bool keep) {
+    if (capacity <= mCapacity) {
+        return;
+    }
+    wchar_t* newStr = new wchar_t[capacity + 1u];
+    if (keep) {
+        ::memcpy(newStr, mStr, (mSize + 1u) * sizeof(wchar_t));
+    }
+    if (!isInline()) {
         delete[] mStr;
     }
-    const int utf16Len = calcUtf16BufferLength(str, len);
-    mStr = new wchar_t[utf16Len + 1];
-    mSize = static_cast<size_t>(utf16Len);
-    convertFromUtf8(mStr, utf16Len, str, len);
+    mStr = newStr;
+    mCapacity = capacity;
+}
+
+void Win32UnicodeString::reset(const char* str, size_t len) {
+    // UTF-16 never takes more code units than the UTF-8 input has bytes, so
+    // a single conversion pass straight into storage sized by |len| works.
+    reserve(len, false);
+    mSize = utf8ToUtf16(str, len, asUtf16(mStr), len);
     mStr[mSize] = L'\0';
 }
 
@@ -105,23 +143,12 @@ void Win32UnicodeString::reset(const char* str) {
 }
 
 void Win32UnicodeString::resize(size_t newSize) {
-    if (newSize == 0) {
-        delete [] mStr;
-        mStr = nullptr;
-        mSize = 0;
-    } else if (newSize <= mSize) {
-        mStr[newSize] = 0;
-        mSize = newSize;
-    } else {
-        wchar_t* oldStr = mStr;
-        mStr = new wchar_t[newSize + 1u];
-        size_t copySize = std::min<size_t>(newSize, mSize);
-        ::memcpy(mStr, oldStr ? oldStr : L"", copySize * sizeof(wchar_t));
-        mStr[copySize] = L'\0';
-        mStr[newSize] = L'\0';
-        mSize = newSize;
-        delete[] oldStr;
+    if (newSize > mSize) {
+        reserve(newSize, true);
+        mStr[mSize] = L'\0';
     }
+    mStr[newSize] = L'\0';
+    mSize = newSize;
 }
 
 void Win32UnicodeString::append(const wchar_t* str) {
@@ -144,32 +171,32 @@ void Win32UnicodeString::append(const Win32UnicodeString& other) {
 }
 
 wchar_t* Win32UnicodeString::release() {
-    wchar_t* result = mStr;
-    mStr = nullptr;
+    wchar_t* result = nullptr;
+    if (!isInline()) {
+        result = mStr;
+    } else if (mSize) {
+        result = new wchar_t[mSize + 1u];
+        ::memcpy(result, mStr, (mSize + 1u) * sizeof(wchar_t));
+    }
+    mStr = mInline;
     mSize = 0u;
+    mCapacity = kInlineCapacity;
+    mInline[0] = L'\0';
     return result;
 }
 
 // static
 std::string Win32UnicodeString::convertToUtf8(const wchar_t* str, int len) {
     std::string result;
-    const int utf8Len = calcUtf8BufferLength(str, len);
-    if (utf8Len > 0) {
-        result.resize(static_cast<size_t>(utf8Len));
-        convertToUtf8(&result[0], utf8Len, str, len);
-        if (len == -1) {
-            result.resize(utf8Len - 1);  // get rid of the null-terminator
-        }
+    if (!str || len == 0 || (len < 0 && len != -1)) {
+        return result;
     }
+    const size_t srcLen = len == -1 ? wcslen(str) : static_cast<size_t>(len);
+    result.resize(utf16ToUtf8Length(asUtf16(str), srcLen));
+    utf16ToUtf8(asUtf16(str), srcLen, &result[0], result.size());
     return result;
 }
 
-// returns the return value of a Win32UnicodeString public conversion function
-// from a WinAPI conversion function returned code
-static int convertRetVal(int winapiResult) {
-    return winapiResult ? winapiResult : -1;
-}
-
 // static
 int Win32UnicodeString::calcUtf8BufferLength(const wchar_t* str, int len) {
     if (len < 0 && len != -1) {
@@ -178,16 +205,12 @@ int Win32UnicodeString::calcUtf8BufferLength(const wchar_t* str, int len) {
     if (len == 0) {
         return 0;
     }
-    const int utf8Len = WideCharToMultiByte(CP_UTF8,  // CodePage
-                                            0,        // dwFlags
-                                            str,      // lpWideCharStr
-                                            len,      // cchWideChar
-                                            nullptr,  // lpMultiByteStr
-                                            0,        // cbMultiByte
-                                            nullptr,  // lpDefaultChar
-                                            nullptr); // lpUsedDefaultChar
-
-    return convertRetVal(utf8Len);
+    if (!str) {
+        return -1;
+    }
+    // Like WideCharToMultiByte(), count the terminator for len == -1.
+    const size_t srcLen = len == -1 ? wcslen(str) + 1u : static_cast<size_t>(len);
+    return static_cast<int>(utf16ToUtf8Length(asUtf16(str), srcLen));
 }
 
 // static
@@ -198,14 +221,12 @@ int Win32UnicodeString::calcUtf16BufferLength(const char* str, int len) {
     if (len == 0) {
         return 0;
     }
-    const int utf16Len = MultiByteToWideChar(CP_UTF8,  // CodePage
-                                             0,        // dwFlags
-                                             str,      // lpMultiByteStr
-                                             len,      // cbMultiByte
-                                             nullptr,  // lpWideCharStr
-                                             0);       // cchWideChar
-
-    return convertRetVal(utf16Len);
+    if (!str) {
+        return -1;
+    }
+    // Like MultiByteToWideChar(), count the terminator for len == -1.
+    const size_t srcLen = len == -1 ? strlen(str) + 1u : static_cast<size_t>(len);
+    return static_cast<int>(utf8ToUtf16Length(str, srcLen));
 }
 
 // static
@@ -218,15 +239,16 @@ int Win32UnicodeString::convertToUtf8(char* outStr, int outLen,
         return 0;
     }
 
-    const int utf8Len = WideCharToMultiByte(CP_UTF8,  // CodePage
-                                            0,        // dwFlags
-                                            str,      // lpWideCharStr
-                                            len,      // cchWideChar
-                                            outStr,   // lpMultiByteStr
-                                            outLen,   // cbMultiByte
-                                            nullptr,  // lpDefaultChar
-                                            nullptr); // lpUsedDefaultChar
-    return convertRetVal(utf8Len);
+    const size_t srcLen = len == -1 ? wcslen(str) + 1u : static_cast<size_t>(len);
+    const size_t written = utf16ToUtf8(asUtf16(str), srcLen, outStr,
+                                       static_cast<size_t>(outLen));
+    // A short buffer is a failure, as it is for WideCharToMultiByte(). Three
+    // bytes per code unit always fit, so only count when it may not.
+    if (static_cast<size_t>(outLen) < 3u * srcLen &&
+        utf16ToUtf8Length(asUtf16(str), srcLen) != written) {
+        return -1;
+    }
+    return static_cast<int>(written);
 }
 
 // static
@@ -239,13 +261,16 @@ int Win32UnicodeString::convertFromUtf8(wchar_t* outStr, int outLen,
         return 0;
     }
 
-    const int utf16Len = MultiByteToWideChar(CP_UTF8,  // CodePage
-                                             0,        // dwFlags
-                                             str,      // lpMultiByteStr
-                                             len,      // cbMultiByte
-                                             outStr,   // lpWideCharStr
-                                             outLen);  // cchWideChar
-    return convertRetVal(utf16Len);
+    const size_t srcLen = len == -1 ? strlen(str) + 1u : static_cast<size_t>(len);
+    const size_t written = utf8ToUtf16(str, srcLen, asUtf16(outStr),
+                                       static_cast<size_t>(outLen));
+    // A short buffer is a failure, as it is for MultiByteToWideChar(). The
+    // output can't be longer than the input, so only check when it may be.
+    if (static_cast<size_t>(outLen) < srcLen &&
+        utf8ToUtf16Length(str, srcLen) != written) {
+        return -1;
+    }
+    return static_cast<int>(written);
 }
 
 }  // namespace base
@@ -16,26 +16,166 @@
 
 #include "aemu/base/threads/WorkerThread.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
 
 namespace android {
 namespace base {
 namespace {
-TEST(WorkerThread, TheReturnedFutureFromEnqueueShouldBeReadyWhenTheWorkerStops) {
+
+template <class QueuePolicy>
+class WorkerThreadTest : public ::testing::Test {};
+
+using QueuePolicies = ::testing::Types<LockingQueue, LockFreeQueue, PrioritizedQueue>;
+TYPED_TEST_SUITE(WorkerThreadTest, QueuePolicies);
+
+TYPED_TEST(WorkerThreadTest, TheReturnedFutureFromEnqueueShouldBeReadyWhenTheWorkerStops) {
     struct Item {};
-    WorkerThread<Item> worker([](Item&&) { return WorkerProcessingResult::Stop; });
+    WorkerThread<Item, TypeParam> worker([](Item&&) { return WorkerProcessingResult::Stop; });
     worker.start();
     worker.enqueue(Item{}).wait();
     EXPECT_EQ(worker.enqueue(Item{}).wait_for(std::chrono::milliseconds(500)),
               std::future_status::ready);
 }
 
-TEST(WorkerThread, TheReturnedFutureFromEnqueueShouldBeReadyBeforeTheWorkerStarts) {
+TYPED_TEST(WorkerThreadTest, TheReturnedFutureFromEnqueueShouldBeReadyBeforeTheWorkerStarts) {
     struct Item {};
-    WorkerThread<Item> worker([](Item&&) { return WorkerProcessingResult::Stop; });
+    WorkerThread<Item, TypeParam> worker([](Item&&) { return WorkerProcessingResult::Stop; });
     EXPECT_EQ(worker.enqueue(Item{}).wait_for(std::chrono::milliseconds(0)),
               std::future_status::ready);
 }
+
+TYPED_TEST(WorkerThreadTest, ProcessesItemsFromManyProducers) {
+    constexpr int kProducers = 4;
+    constexpr int kItemsPerProducer = 1000;
+    std::atomic<int> sum{0};
+    WorkerThread<int, TypeParam> worker([&sum](int&& item) {
+        if (item < 0) return WorkerProcessingResult::Stop;
+        sum += item;
+        return WorkerProcessingResult::Continue;
+    });
+    worker.start();
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&worker] {
+            for (int i = 1; i <= kItemsPerProducer; ++i) {
+                worker.enqueue(int(i));
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    worker.waitQueuedItems();
+    EXPECT_EQ(kProducers * kItemsPerProducer * (kItemsPerProducer + 1) / 2, sum);
+
+    worker.enqueue(-1);
+    worker.join();
+}
+
+// Item 0 blocks the worker until release(), so that the test can queue
+// everything else before the worker picks its next item.
+class BlockedWorker {
+public:
+    BlockedWorker()
+        : mWorker([this](int&& item) {
+              if (item == 0) {
+                  mStarted.set_value();
+                  mRelease.get_future().wait();
+              } else if (item < 0) {
+                  return WorkerProcessingResult::Stop;
+              } else {
+                  order.push_back(item);
+              }
+              return WorkerProcessingResult::Continue;
+          }) {
+        mWorker.start();
+        mWorker.enqueue(0);
+        mStarted.get_future().wait();
+    }
+
+    ~BlockedWorker() {
+        mWorker.enqueue(-1);
+        mWorker.join();
+    }
+
+    WorkerThread<int, PrioritizedQueue>& worker() { return mWorker; }
+
+    void release() {
+        mRelease.set_value();
+        mWorker.waitQueuedItems();
+    }
+
+    std::vector<int> order;
+
+private:
+    std::promise<void> mStarted;
+    std::promise<void> mRelease;
+    WorkerThread<int, PrioritizedQueue> mWorker;
+};
+
+// Tests that higher priority items overtake those queued before them.
+TEST(WorkerThreadPrioritizedTest, HigherPriorityFirst) {
+    BlockedWorker blocked;
+    auto& worker = blocked.worker();
+    worker.enqueue(1, WorkPriority::kBulk);
+    worker.enqueue(2, WorkPriority::kNormal);
+    worker.enqueue(3, WorkPriority::kHigh);
+    worker.enqueue(4, WorkPriority::kBulk);
+    worker.enqueue(5, WorkPriority::kHigh);
+    blocked.release();
+    EXPECT_EQ((std::vector<int>{3, 5, 2, 1, 4}), blocked.order);
+}
+
+// Tests that a lane passed over too often is served before more urgent work.
+TEST(WorkerThreadPrioritizedTest, BulkIsNotStarved) {
+    BlockedWorker blocked;
+    auto& worker = blocked.worker();
+    worker.enqueue(100, WorkPriority::kBulk);
+    for (int i = 1; i <= 20; ++i) {
+        worker.enqueue(int(i), WorkPriority::kHigh);
+    }
+    blocked.release();
+    ASSERT_EQ(21u, blocked.order.size());
+    const auto bulk = std::find(blocked.order.begin(), blocked.order.end(), 100);
+    EXPECT_EQ(kMaxWorkLaneSkips, size_t(bulk - blocked.order.begin()));
+}
+
+// Tests that an overdue item goes first and counts as late.
+TEST(WorkerThreadPrioritizedTest, OverdueFirstAndCountedLate) {
+    BlockedWorker blocked;
+    auto& worker = blocked.worker();
+    worker.enqueue(1, WorkPriority::kHigh);
+    worker.enqueue(2, WorkPriority::kBulk,
+                   std::chrono::steady_clock::now() + std::chrono::milliseconds(1));
+    worker.enqueue(3, WorkPriority::kNormal,
+                   std::chrono::steady_clock::now() + std::chrono::hours(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    blocked.release();
+    EXPECT_EQ((std::vector<int>{2, 1, 3}), blocked.order);
+    EXPECT_EQ(1u, worker.lateItems());
+}
+
+// Tests that waitQueuedItems() waits for items of every priority queued
+// before it, even when urgent items keep arriving after it.
+TEST(WorkerThreadPrioritizedTest, WaitQueuedItemsIsABarrier) {
+    BlockedWorker blocked;
+    auto& worker = blocked.worker();
+    worker.enqueue(1, WorkPriority::kHigh);
+    worker.enqueue(2, WorkPriority::kBulk);
+    std::thread waiter([&worker] { worker.waitQueuedItems(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    worker.enqueue(3, WorkPriority::kHigh);
+    blocked.release();
+    waiter.join();
+    EXPECT_EQ((std::vector<int>{1, 3, 2}), blocked.order);
+}
+
 }  // namespace
 }  // namespace base
-}  // namespace android
\ No newline at end of file
+}  // namespace android
@@ -0,0 +1,287 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/sockets/ZeroCopySender.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include "aemu/base/sockets/Winsock.h"
+#include <io.h>
+#else
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/sendfile.h>
+#endif
+
+#ifdef __APPLE__
+#include <sys/uio.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace android {
+namespace base {
+
+namespace {
+
+// Sequence numbers wrap; |a| is at or past |b|.
+bool seqReached(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b) >= 0;
+}
+
+ssize_t plainSend(int socket, const void* data, size_t size) {
+#ifdef _WIN32
+    const int n = ::send(socket, static_cast<const char*>(data),
+                         static_cast<int>(std::min<size_t>(size, INT32_MAX)), 0);
+    if (n == SOCKET_ERROR) {
+        errno = WSAGetLastError() == WSAEWOULDBLOCK ? EAGAIN : EIO;
+        return -1;
+    }
+    return n;
+#else
+    ssize_t n;
+    do {
+        n = ::send(socket, data, size, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n;
+#endif
+}
+
+// Waits up to |timeoutMs| for |events| on |socket|.
+void waitFor(int socket, short events, int timeoutMs) {
+#ifdef _WIN32
+    WSAPOLLFD pfd = {static_cast<SOCKET>(socket), events, 0};
+    WSAPoll(&pfd, 1, timeoutMs);
+#else
+    struct pollfd pfd = {socket, events, 0};
+    poll(&pfd, 1, timeoutMs);
+#endif
+}
+
+}  // namespace
+
+ZeroCopySender::ZeroCopySender(int socket) : mSocket(socket) {
+#if defined(__linux__) && defined(SO_ZEROCOPY)
+    const int one = 1;
+    mZeroCopy = setsockopt(mSocket, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+#endif
+}
+
+ZeroCopySender::~ZeroCopySender() {
+    drain(kDrainTimeoutMs);
+    // The socket is about to go; the kernel holds its own references to
+    // any pages still queued.
+    for (auto& pending : mReleases) {
+        pending.release();
+    }
+}
+
+ssize_t ZeroCopySender::send(const void* data, size_t size) {
+    if (mZeroCopy && size >= kMinZeroCopySize) {
+        const ssize_t n = sendZeroCopy(data, size);
+        if (n >= 0 || errno != ENOBUFS) {
+            return n;
+        }
+        // Out of pinned-memory budget until earlier sends complete; copy
+        // this one.
+        pollCompletions();
+    }
+    const ssize_t n = plainSend(mSocket, data, size);
+    if (n > 0) {
+        mStats.copiedBytes += n;
+    }
+    return n;
+}
+
+ssize_t ZeroCopySender::sendZeroCopy(const void* data, size_t size) {
+#if defined(__linux__) && defined(MSG_ZEROCOPY)
+    ssize_t n;
+    do {
+        n = ::send(mSocket, data, size, MSG_ZEROCOPY | MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    if (n >= 0) {
+        // Even an empty send takes a number.
+        ++mIssued;
+        mStats.zeroCopyBytes += n;
+    }
+    return n;
+#else
+    (void)data;
+    (void)size;
+    errno = ENOBUFS;
+    return -1;
+#endif
+}
+
+bool ZeroCopySender::sendAll(const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t n = send(p, size);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            waitFor(mSocket, POLLOUT, -1);
+            pollCompletions();
+            continue;
+        }
+        if (n == 0) {
+            errno = EPIPE;
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+ssize_t ZeroCopySender::sendFile(int fd, uint64_t offset, size_t size) {
+#if defined(__linux__)
+    off_t off = static_cast<off_t>(offset);
+    ssize_t n;
+    do {
+        n = ::sendfile(mSocket, fd, &off, size);
+    } while (n < 0 && errno == EINTR);
+    if (n > 0) {
+        mStats.fileBytes += n;
+    }
+    return n;
+#elif defined(__APPLE__)
+    off_t len = static_cast<off_t>(size);
+    int res;
+    do {
+        res = ::sendfile(fd, mSocket, static_cast<off_t>(offset), &len, nullptr, 0);
+    } while (res < 0 && errno == EINTR && len == 0);
+    // A short send on a non-blocking socket fails with EAGAIN but still
+    // reports what went out.
+    if (res < 0 && len == 0) {
+        return -1;
+    }
+    mStats.fileBytes += len;
+    return static_cast<ssize_t>(len);
+#else
+    // No sendfile(); TransmitFile() needs an overlapped socket and
+    // mswsock, so read and send instead.
+    char buf[64 * 1024];
+    const size_t chunk = std::min(size, sizeof(buf));
+#ifdef _WIN32
+    if (_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0) {
+        return -1;
+    }
+    const int got = _read(fd, buf, static_cast<unsigned>(chunk));
+#else
+    const ssize_t got = pread(fd, buf, chunk, static_cast<off_t>(offset));
+#endif
+    if (got <= 0) {
+        return got;
+    }
+    const ssize_t n = plainSend(mSocket, buf, got);
+    if (n > 0) {
+        mStats.fileBytes += n;
+    }
+    return n;
+#endif
+}
+
+void ZeroCopySender::releaseWhenSent(Release release) {
+    if (mCompleted == mIssued && mReleases.empty()) {
+        release();
+        return;
+    }
+    mReleases.push_back({mIssued, std::move(release)});
+}
+
+size_t ZeroCopySender::pollCompletions() {
+#if defined(__linux__) && defined(SO_EE_ORIGIN_ZEROCOPY)
+    while (mCompleted != mIssued) {
+        char control[128];
+        struct msghdr msg = {};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(mSocket, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;
+        }
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            const bool recvErr = (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                                 (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+            if (!recvErr) continue;
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cm), sizeof(err));
+            if (err.ee_errno != 0 || err.ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+            if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                // Pinning bought nothing; don't bother from now on.
+                mZeroCopy = false;
+            }
+            complete(err.ee_info, err.ee_data);
+        }
+    }
+#endif
+    return runReleases();
+}
+
+void ZeroCopySender::complete(uint32_t lo, uint32_t hi) {
+    if (lo != mCompleted) {
+        mAhead[lo] = hi;
+        return;
+    }
+    mCompleted = hi + 1;
+    // Ranges that arrived early may now follow on.
+    for (auto it = mAhead.find(mCompleted); it != mAhead.end();
+         it = mAhead.find(mCompleted)) {
+        mCompleted = it->second + 1;
+        mAhead.erase(it);
+    }
+}
+
+size_t ZeroCopySender::runReleases() {
+    size_t ran = 0;
+    while (!mReleases.empty() && seqReached(mCompleted, mReleases.front().after)) {
+        Release release = std::move(mReleases.front().release);
+        mReleases.pop_front();
+        release();
+        ++ran;
+    }
+    return ran;
+}
+
+bool ZeroCopySender::drain(int timeoutMs) {
+    using Clock = std::chrono::steady_clock;
+    const auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    pollCompletions();
+    while (outstanding()) {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - Clock::now()).count();
+        if (left <= 0) break;
+        // Error queue entries show up as POLLERR, whatever is asked for.
+        waitFor(mSocket, 0, static_cast<int>(left));
+        pollCompletions();
+    }
+    return outstanding() == 0;
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,189 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "aemu/base/sockets/ZeroCopySender.h"
+
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace base {
+namespace {
+
+std::vector<char> pattern(size_t size) {
+    std::vector<char> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<char>(i * 7 + i / 4096);
+    }
+    return data;
+}
+
+// Reads |size| bytes from |fd| on a thread.
+class Reader {
+public:
+    Reader(int fd, size_t size)
+        : mThread([this, fd, size] {
+              received.resize(size);
+              size_t got = 0;
+              while (got < size) {
+                  const ssize_t n = read(fd, received.data() + got, size - got);
+                  if (n <= 0) break;
+                  got += n;
+              }
+              received.resize(got);
+          }) {}
+
+    std::vector<char> finish() {
+        mThread.join();
+        return std::move(received);
+    }
+
+    std::vector<char> received;
+
+private:
+    std::thread mThread;
+};
+
+// A connected pair of loopback TCP sockets.
+bool tcpPair(int* client, int* server) {
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (listener < 0 || bind(listener, (struct sockaddr*)&addr, sizeof(addr)) ||
+        listen(listener, 1) || getsockname(listener, (struct sockaddr*)&addr, &len)) {
+        return false;
+    }
+    *client = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(*client, (struct sockaddr*)&addr, sizeof(addr))) {
+        return false;
+    }
+    *server = accept(listener, nullptr, nullptr);
+    close(listener);
+    return *server >= 0;
+}
+
+// Tests that a socket without SO_ZEROCOPY gets plain sends, and releases
+// run right away.
+TEST(ZeroCopySender, FallsBackOnUnixSockets) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    const std::vector<char> data = pattern(1 << 20);
+    Reader reader(fds[1], data.size());
+    {
+        ZeroCopySender sender(fds[0]);
+        EXPECT_FALSE(sender.zeroCopy());
+        EXPECT_TRUE(sender.sendAll(data.data(), data.size()));
+        bool released = false;
+        sender.releaseWhenSent([&released] { released = true; });
+        EXPECT_TRUE(released);
+        EXPECT_EQ(data.size(), sender.stats().copiedBytes);
+    }
+    EXPECT_EQ(data, reader.finish());
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// Tests that a buffer sent over TCP arrives intact, and is only released
+// once the kernel is done with it, whichever way it went out.
+TEST(ZeroCopySender, TcpReleasesAfterCompletion) {
+    int client, server;
+    ASSERT_TRUE(tcpPair(&client, &server));
+    const std::vector<char> data = pattern(4 << 20);
+    Reader reader(server, data.size());
+    {
+        ZeroCopySender sender(client);
+        EXPECT_TRUE(sender.sendAll(data.data(), data.size()));
+        bool released = false;
+        sender.releaseWhenSent([&released] { released = true; });
+        EXPECT_TRUE(sender.drain(5000));
+        EXPECT_TRUE(released);
+        EXPECT_EQ(0u, sender.outstanding());
+        EXPECT_EQ(data.size(),
+                  sender.stats().zeroCopyBytes + sender.stats().copiedBytes);
+    }
+    EXPECT_EQ(data, reader.finish());
+    close(client);
+    close(server);
+}
+
+// Tests that releases queued behind outstanding sends run in order.
+TEST(ZeroCopySender, ReleasesInOrder) {
+    int client, server;
+    ASSERT_TRUE(tcpPair(&client, &server));
+    const std::vector<char> data = pattern(256 << 10);
+    constexpr int kBuffers = 8;
+    Reader reader(server, data.size() * kBuffers);
+    std::vector<int> released;
+    {
+        ZeroCopySender sender(client);
+        for (int i = 0; i < kBuffers; ++i) {
+            EXPECT_TRUE(sender.sendAll(data.data(), data.size()));
+            sender.releaseWhenSent([&released, i] { released.push_back(i); });
+        }
+        sender.drain(5000);
+    }
+    EXPECT_EQ(data.size() * kBuffers, reader.finish().size());
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7}), released);
+    close(client);
+    close(server);
+}
+
+// Tests that a file range is sent as is.
+TEST(ZeroCopySender, SendFile) {
+    char path[] = "/tmp/ZeroCopySenderXXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    unlink(path);
+    const std::vector<char> data = pattern(3 << 20);
+    ASSERT_EQ(ssize_t(data.size()), write(fd, data.data(), data.size()));
+
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    constexpr size_t kOffset = 12345;
+    Reader reader(fds[1], data.size() - kOffset);
+    ZeroCopySender sender(fds[0]);
+    size_t sent = 0;
+    while (sent < data.size() - kOffset) {
+        const ssize_t n =
+                sender.sendFile(fd, kOffset + sent, data.size() - kOffset - sent);
+        ASSERT_GT(n, 0);
+        sent += n;
+    }
+    EXPECT_EQ(sent, sender.stats().fileBytes);
+    EXPECT_EQ(std::vector<char>(data.begin() + kOffset, data.end()),
+              reader.finish());
+    close(fd);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace android
+
+#endif  // !_WIN32
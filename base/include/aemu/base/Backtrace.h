@@ -13,6 +13,8 @@
 // limitations under the License.
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
 #include <string>
 
 namespace android {
@@ -22,6 +24,50 @@ namespace base {
 // Otherwise, returns empty string.
 std::string bt();
 
+// Stores up to |maxFrames| return addresses of the current thread in
+// |frames|, innermost first, leaving out the caller's |skip| innermost frames
+// (this function's own frame is never included). Returns the number stored.
+// The first call may allocate while the unwinder loads, so allocator hooks
+// need to guard against reentry.
+size_t captureBacktrace(void** frames, size_t maxFrames, size_t skip = 0);
+
+// Hot paths record stacks as ids into a process-wide table of interned
+// stacks, and only symbolize them when a report is written:
+//
+//     StackId id = captureStack();        // unwind + lookup, no symbols
+//     ...
+//     std::string text = formatStack(id); // at dump time
+//
+// Stacks are never removed, so an id and its frames stay valid for the
+// life of the process. 0 is never a valid id.
+using StackId = uint32_t;
+constexpr StackId kInvalidStackId = 0;
+
+// Interned stacks keep at most this many innermost frames.
+constexpr size_t kMaxStackFrames = 32;
+
+// Captures the current thread's stack like captureBacktrace() and interns
+// it. Returns kInvalidStackId if the table is full.
+StackId captureStack(size_t skip = 0);
+
+// Returns the id of the stack |frames|, adding it to the table the first
+// time it is seen. Lookups of a known stack take no lock and don't
+// allocate. Returns kInvalidStackId if |count| is 0 or the table is full.
+StackId internStack(void* const* frames, size_t count);
+
+// Points |*frames| at the frames of |id| and returns their number, or
+// returns 0 if |id| is not an interned stack.
+size_t getStackFrames(StackId id, void* const** frames);
+
+// Describes the code at |pc| as "function+0x<offset> (module)", or as
+// much of it as the platform can tell. Results are cached, so repeated
+// frames cost one lookup.
+std::string symbolizeAddress(const void* pc);
+
+// One line per frame: "#<index> <pc> <symbolizeAddress(pc)>".
+std::string formatBacktrace(void* const* frames, size_t count);
+std::string formatStack(StackId id);
+
 } // namespace android
 } // namespace base
 
@@ -4,13 +4,13 @@
  */
 #pragma once
 
-#include "aemu/base/AlignedBuf.h"
 #include "aemu/base/Allocator.h"
 
-#include <vector>
-#include <unordered_set>
+#include <algorithm>
+#include <cstdlib>
 
 #include <inttypes.h>
+#include <stddef.h>
 
 namespace android {
 namespace base {
@@ -20,50 +20,184 @@ namespace base {
 // BUT it's necessary to preserve previous pointer values in between the first
 // alloc() after a freeAll(), and the freeAll() itself, allowing some sloppy use of
 // malloc in the first pass while we find out how much data was needed.
+//
+// Memory comes from a list of chunks of |chunkBytes| each (or larger, for
+// allocations that don't fit in one). freeAll() starts a new generation and
+// keeps the chunks for reuse, so a pool that is reset every frame stops
+// allocating once it has seen its working set. Spare chunks beyond what the
+// busiest of the last kTrimGenerations to 2 * kTrimGenerations generations
+// needed are given back.
 class BumpPool : public Allocator {
 public:
-    BumpPool(size_t startingBytes = 4096) : mStorage(startingBytes / sizeof(uint64_t))  { }
+    static constexpr size_t kTrimGenerations = 16;
+
+    struct Stats {
+        // Bytes handed out in the current generation, alignment included.
+        size_t bytesInUse = 0;
+        // Most bytes handed out in any one generation.
+        size_t peakBytes = 0;
+        // Bytes held in chunks, in use or spare.
+        size_t bytesReserved = 0;
+        size_t chunkCount = 0;
+        uint64_t generation = 0;
+    };
+
+    BumpPool(size_t chunkBytes = 4096)
+        : mChunkBytes(std::max<size_t>(chunkBytes, kMinChunkBytes)) {}
+
     // All memory allocated by this pool
     // is automatically deleted when the pool
     // is deconstructed.
     ~BumpPool() {
-        freeAll();
+        releaseChunks(mUsed);
+        releaseChunks(mSpare);
     }
 
     void* alloc(size_t wantedSize) override {
-        size_t wantedSizeRoundedUp =
-            sizeof(uint64_t) * ((wantedSize + sizeof(uint64_t) - 1) / (sizeof(uint64_t)));
-
-        mTotalWantedThisGeneration += wantedSizeRoundedUp;
-        if (mAllocPos + wantedSizeRoundedUp > mStorage.size() * sizeof(uint64_t)) {
-            mNeedRealloc = true;
-            void* fallbackPtr = malloc(wantedSizeRoundedUp);
-            mFallbackPtrs.insert(fallbackPtr);
-            return fallbackPtr;
+        return allocAligned(wantedSize, sizeof(uint64_t));
+    }
+
+    // |alignment| must be a power of two.
+    void* allocAligned(size_t wantedSize, size_t alignment) {
+        alignment = std::max(alignment, sizeof(uint64_t));
+        if (mCurrent) {
+            void* res = bumpIn(mCurrent, wantedSize, alignment);
+            if (res) {
+                return res;
+            }
         }
-        void* allocPtr = (void*)(((unsigned char*)mStorage.data()) + mAllocPos);
-        mAllocPos += wantedSizeRoundedUp;
-        return allocPtr;
+        mCurrent = takeChunk(wantedSize + alignment);
+        return bumpIn(mCurrent, wantedSize, alignment);
     }
 
     void freeAll() {
-        mAllocPos = 0;
-        if (mNeedRealloc) {
-            mStorage.resize((mTotalWantedThisGeneration * 2) / sizeof(uint64_t));
-            mNeedRealloc = false;
-            for (auto ptr : mFallbackPtrs) {
-                free(ptr);
-            }
-            mFallbackPtrs.clear();
+        ++mGeneration;
+        mPeakBytes = std::max(mPeakBytes, mBytesInUse);
+        mWindowPeak = std::max(mWindowPeak, mChunkBytesInUse);
+        if (mGeneration % kTrimGenerations == 0) {
+            mPreviousWindowPeak = mWindowPeak;
+            mWindowPeak = 0;
+        }
+        mBytesInUse = 0;
+        mChunkBytesInUse = 0;
+
+        // Move every used chunk to the spare list.
+        while (mUsed) {
+            Chunk* chunk = mUsed;
+            mUsed = chunk->next;
+            chunk->used = 0;
+            chunk->next = mSpare;
+            mSpare = chunk;
         }
-        mTotalWantedThisGeneration = 0;
+        mCurrent = nullptr;
+        trim(std::max(mWindowPeak, mPreviousWindowPeak));
+    }
+
+    Stats stats() const {
+        Stats stats;
+        stats.bytesInUse = mBytesInUse;
+        stats.peakBytes = std::max(mPeakBytes, mBytesInUse);
+        stats.bytesReserved = mBytesReserved;
+        stats.chunkCount = mChunkCount;
+        stats.generation = mGeneration;
+        return stats;
     }
+
 private:
-    AlignedBuf<uint64_t, 8> mStorage;
-    std::unordered_set<void*> mFallbackPtrs;
-    size_t mAllocPos = 0;
-    size_t mTotalWantedThisGeneration = 0;
-    bool mNeedRealloc = false;
+    static constexpr size_t kMinChunkBytes = 256;
+
+    struct Chunk {
+        Chunk* next;
+        size_t size;
+        size_t used;
+        // Keeps the data start 16-byte aligned.
+        size_t padding;
+
+        char* data() { return reinterpret_cast<char*>(this + 1); }
+    };
+    static_assert(sizeof(Chunk) % 16 == 0, "chunk data must stay aligned");
+
+    void* bumpIn(Chunk* chunk, size_t wantedSize, size_t alignment) {
+        const uintptr_t start = reinterpret_cast<uintptr_t>(chunk->data());
+        const uintptr_t pos = (start + chunk->used + alignment - 1) & ~(alignment - 1);
+        const size_t end = pos - start + wantedSize;
+        if (end > chunk->size) {
+            return nullptr;
+        }
+        mBytesInUse += end - chunk->used;
+        chunk->used = end;
+        return reinterpret_cast<void*>(pos);
+    }
+
+    // Returns a chunk with room for |bytes|, linked in at the head of mUsed.
+    Chunk* takeChunk(size_t bytes) {
+        Chunk** link = &mSpare;
+        while (*link && (*link)->size < bytes) {
+            link = &(*link)->next;
+        }
+        Chunk* chunk = *link;
+        if (chunk) {
+            *link = chunk->next;
+        } else {
+            const size_t size = std::max(mChunkBytes, bytes);
+            chunk = static_cast<Chunk*>(malloc(sizeof(Chunk) + size));
+            if (!chunk) {
+                abort();
+            }
+            chunk->size = size;
+            chunk->used = 0;
+            mBytesReserved += size;
+            ++mChunkCount;
+        }
+        chunk->next = mUsed;
+        mUsed = chunk;
+        mChunkBytesInUse += chunk->size;
+        return chunk;
+    }
+
+    // Frees spare chunks until the spare capacity is at most |keepBytes|.
+    void trim(size_t keepBytes) {
+        size_t kept = 0;
+        Chunk** link = &mSpare;
+        while (*link) {
+            Chunk* chunk = *link;
+            if (kept + chunk->size <= keepBytes) {
+                kept += chunk->size;
+                link = &chunk->next;
+                continue;
+            }
+            *link = chunk->next;
+            mBytesReserved -= chunk->size;
+            --mChunkCount;
+            free(chunk);
+        }
+    }
+
+    void releaseChunks(Chunk* chunk) {
+        while (chunk) {
+            Chunk* next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+    }
+
+    const size_t mChunkBytes;
+    // Chunks handed out from in this generation, the current one first.
+    Chunk* mUsed = nullptr;
+    Chunk* mCurrent = nullptr;
+    Chunk* mSpare = nullptr;
+
+    size_t mBytesInUse = 0;
+    size_t mPeakBytes = 0;
+    // Size of the chunks in mUsed.
+    size_t mChunkBytesInUse = 0;
+    // Most chunk bytes used by a generation in this and the previous window
+    // of kTrimGenerations.
+    size_t mWindowPeak = 0;
+    size_t mPreviousWindowPeak = 0;
+    size_t mBytesReserved = 0;
+    size_t mChunkCount = 0;
+    uint64_t mGeneration = 0;
 };
 
 } // namespace base
@@ -15,6 +15,12 @@
 
 #include <inttypes.h>
 
+#include <chrono>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
 namespace android {
 namespace base {
 
@@ -36,5 +42,24 @@ struct CpuTime {
 
 CpuTime operator-(const CpuTime& a, const CpuTime& b);
 
+// Reads a free-running cycle counter: the TSC on x86, the virtual counter on
+// arm64 and steady clock nanoseconds elsewhere. Only the difference between
+// two reads on one thread means anything, and its unit depends on the host.
+inline uint64_t readCycleCounter() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+}
+
 } // namespace base
 } // namespace android
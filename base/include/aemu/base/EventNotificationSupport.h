@@ -13,8 +13,13 @@
 // limitations under the License.
 #pragma once
 
+#include "aemu/base/synchronization/EpochReclaimer.h"
+#include "aemu/base/synchronization/Lock.h"
+
+#include <atomic>      // for atomic
 #include <functional>  // for function
-#include <mutex>       // for mutex, lock_guard
+#include <memory>      // for shared_ptr, weak_ptr
+#include <thread>      // for this_thread
 #include <utility>     // for move
 #include <vector>      // for vector
 
@@ -26,9 +31,21 @@ namespace base {
 //
 // You basically specify an EventObject type, subclass from the support class
 // and simply call fireEvent when an event needs to be delivered.
+//
+// fireEvent never takes a lock: the listeners live in an immutable array,
+// shared by reference count, that it reaches through an atomic pointer.
+// Only taking the reference happens inside an EpochReclaimer::ReadScope; the
+// listeners are called after leaving it. Adding or removing a listener
+// copies the array and publishes the copy, so listeners may be added while
+// an event is being delivered; they get the next one.
+//
+// removeListener() waits for the deliveries of this source that may still
+// call the listener, and only those. So a listener may add or remove
+// listeners of any other source, but must not remove one from the source
+// it is listening to.
 template <class EventObject>
 class EventNotificationSupport {
-    using EventListener = std::function<void(const EventObject evt)>;
+    using EventListener = std::function<void(const EventObject& evt)>;
 
    public:
     EventNotificationSupport() = default;
@@ -36,41 +53,94 @@ class EventNotificationSupport {
     // A listener that can be registered that cannot be removed.
     // This listener will live for the lifetime of the object.
     void registerOnce(EventListener listener) {
-        std::lock_guard<std::mutex> lock(mStreamLock);
-        mNonRemovableListeners.push_back(listener);
+        auto shared = std::make_shared<const EventListener>(std::move(listener));
+        update([&shared](Listeners& listeners) {
+            listeners.nonRemovable.push_back(std::move(shared));
+        });
     }
 
     void addListener(EventListener* listener) {
-        std::lock_guard<std::mutex> lock(mStreamLock);
-        mListeners.push_back(listener);
+        update([listener](Listeners& listeners) {
+            listeners.removable.push_back(listener);
+        });
     }
 
     void removeListener(EventListener* listener) {
-        std::lock_guard<std::mutex> lock(mStreamLock);
-        for (auto it = mListeners.begin(); it != mListeners.end();) {
-            if (*it == listener) {
-                it = mListeners.erase(it);
-            } else {
-                ++it;
+        std::weak_ptr<const Listeners> old = update([listener](Listeners& listeners) {
+            for (auto it = listeners.removable.begin(); it != listeners.removable.end();) {
+                if (*it == listener) {
+                    it = listeners.removable.erase(it);
+                } else {
+                    ++it;
+                }
             }
+        });
+        // Deliveries that started before the update may still hold the old
+        // array; once it is released, none can take it again.
+        while (!old.expired()) {
+            std::this_thread::yield();
         }
     }
 
    protected:
-    void fireEvent(EventObject evt) {
-        std::lock_guard<std::mutex> lock(mStreamLock);
-        for (const auto& listener : mListeners) {
+    void fireEvent(const EventObject& evt) {
+        std::shared_ptr<const Listeners> listeners;
+        {
+            EpochReclaimer::ReadScope scope;
+            do {
+                const Listeners* current = mListeners.load(std::memory_order_acquire);
+                if (!current) {
+                    return;
+                }
+                // Fails if it was replaced and released since the load; its
+                // replacement is published by then.
+                listeners = current->self.lock();
+            } while (!listeners);
+        }
+        for (const auto& listener : listeners->removable) {
             (*listener)(evt);
         }
-        for (const auto& listener : mNonRemovableListeners) {
-            listener(evt);
+        for (const auto& listener : listeners->nonRemovable) {
+            (*listener)(evt);
         }
     }
 
    private:
-    std::vector<EventListener*> mListeners;
-    std::vector<EventListener> mNonRemovableListeners;
-    std::mutex mStreamLock;
+    struct Listeners {
+        std::vector<EventListener*> removable;
+        // Shared between copies, so that updates don't copy the functions.
+        std::vector<std::shared_ptr<const EventListener>> nonRemovable;
+        // What fireEvent() takes its reference from. The memory outlives the
+        // last reference until the ReadScopes that may still read this are
+        // closed.
+        std::weak_ptr<const Listeners> self;
+    };
+
+    // Publishes a copy of the listeners changed by |fn|, and returns the
+    // previous array.
+    template <class Fn>
+    std::weak_ptr<const Listeners> update(Fn&& fn) {
+        AutoLock lock(mLock);
+        auto* next = mCurrent ? new Listeners(*mCurrent) : new Listeners();
+        fn(*next);
+        std::shared_ptr<const Listeners> shared(next, &retireListeners);
+        next->self = shared;
+        mListeners.store(next, std::memory_order_release);
+        std::weak_ptr<const Listeners> old = mCurrent;
+        mCurrent = std::move(shared);
+        return old;
+    }
+
+    static void retireListeners(const Listeners* listeners) {
+        EpochReclaimer::get().retire(const_cast<Listeners*>(listeners), &deleteListeners);
+    }
+
+    static void deleteListeners(void* listeners) { delete static_cast<Listeners*>(listeners); }
+
+    Lock mLock;
+    // The published array; guarded by |mLock|.
+    std::shared_ptr<const Listeners> mCurrent;
+    std::atomic<const Listeners*> mListeners{nullptr};
 };
 
 // A RaiiEventListener is an event listener that will register and unregister
@@ -78,7 +148,7 @@ class EventNotificationSupport {
 template <class Source, class EventObject>
 class RaiiEventListener {
    public:
-    using EventListener = std::function<void(const EventObject evt)>;
+    using EventListener = std::function<void(const EventObject& evt)>;
 
     RaiiEventListener(Source* src, EventListener listener)
         : mSource(src), mListener(std::move(listener)) {
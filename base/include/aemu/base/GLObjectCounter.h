@@ -27,6 +27,7 @@ class GLObjectCounter {
 
 public:
     GLObjectCounter();
+    ~GLObjectCounter();
     static GLObjectCounter* get();
     void incCount(size_t type);
     void decCount(size_t type);
@@ -38,6 +38,7 @@ class GraphicsObjectCounter {
 
    public:
     GraphicsObjectCounter();
+    ~GraphicsObjectCounter();
     void incCount(size_t type);
     void decCount(size_t type);
     std::vector<size_t> getCounts() const;
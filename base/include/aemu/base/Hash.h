@@ -0,0 +1,93 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+namespace base {
+
+// Fast non-cryptographic hashing, for deduplicating pages and textures and
+// checking snapshot blocks. Nothing here resists deliberate collisions.
+
+struct Hash128 {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    bool operator==(const Hash128& other) const {
+        return low == other.low && high == other.high;
+    }
+    bool operator!=(const Hash128& other) const { return !(*this == other); }
+};
+
+// XXH3, giving the same results as xxHash 0.8's XXH3_64bits_withSeed() and
+// XXH3_128bits_withSeed(). Long inputs use AVX2, SSE2 or NEON when the CPU
+// has them.
+uint64_t xxh3Hash64(const void* data, size_t size, uint64_t seed = 0);
+Hash128 xxh3Hash128(const void* data, size_t size, uint64_t seed = 0);
+
+// Streaming XXH3: the digests match the one-shot functions over everything
+// passed to update(), however it was split.
+class Xxh3Hasher {
+public:
+    explicit Xxh3Hasher(uint64_t seed = 0);
+
+    void reset(uint64_t seed = 0);
+    void update(const void* data, size_t size);
+
+    uint64_t digest64() const;
+    Hash128 digest128() const;
+
+private:
+    void digestLong(uint64_t* acc) const;
+
+    alignas(64) uint64_t mAcc[8];
+    alignas(64) uint8_t mSecret[192];
+    alignas(64) uint8_t mBuffer[256];
+    size_t mBufferedSize;
+    size_t mStripesSoFar;
+    uint64_t mTotalSize;
+    uint64_t mSeed;
+};
+
+// CRC-32C (Castagnoli), with the SSE4.2 or ARMv8 CRC32 instructions when
+// the CPU has them. Pass the previous result as |crc| to continue it:
+// crc32c(b, bSize, crc32c(a, aSize)) is the CRC of a followed by b.
+uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+// For multi-gigabyte buffers: cuts |data| into |chunkSize| pieces (the last
+// one may be shorter) and hashes them on |threads| threads, or one per core
+// if 0. Returns one xxh3Hash64() per chunk, e.g. one per page for dedup.
+std::vector<uint64_t> xxh3HashChunks(const void* data,
+                                     size_t size,
+                                     size_t chunkSize,
+                                     int threads = 0);
+
+constexpr size_t kParallelHashChunkSize = 4 * 1024 * 1024;
+
+// A single hash of |data| computed the same way: the xxh3Hash128() of the
+// chunks' xxh3Hash128()s. It depends on |chunkSize|, and isn't
+// xxh3Hash128() of the whole buffer.
+Hash128 xxh3HashParallel(const void* data,
+                         size_t size,
+                         size_t chunkSize = kParallelHashChunkSize,
+                         int threads = 0);
+
+}  // namespace base
+}  // namespace android
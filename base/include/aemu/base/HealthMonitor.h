@@ -15,9 +15,11 @@
  */
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <future>
+#include <limits>
 #include <optional>
 #include <queue>
 #include <stack>
@@ -28,6 +30,7 @@
 #include <utility>
 #include <variant>
 
+#include "aemu/base/Backtrace.h"
 #include "aemu/base/synchronization/ConditionVariable.h"
 #include "aemu/base/synchronization/Lock.h"
 #include "aemu/base/Metrics.h"
@@ -54,6 +57,8 @@ using HangAnnotations = EventHangMetadata::HangAnnotations;
 
 static uint64_t kDefaultIntervalMs = 1'000;
 static uint64_t kDefaultTimeoutMs = 5'000;
+static uint32_t kDefaultHangSamples = 20;
+static uint64_t kDefaultHangSampleIntervalUs = 1'000;
 static std::chrono::nanoseconds kTimeEpsilon(1);
 
 // HealthMonitor provides the ability to register arbitrary start/touch/stop events associated
@@ -93,12 +98,18 @@ class HealthMonitor : public android::base::Thread {
                            uint64_t timeout = kDefaultTimeoutMs,
                            std::optional<Id> parentId = std::nullopt);
 
-    // Touch a monitored task. Resets the timeout countdown for that task.
+    // Touch a monitored task. Resets the timeout countdown for that task. This
+    // is usually a single atomic store, cheap enough for every frame.
     void touchMonitoredTask(Id id);
 
     // Stop monitoring a task.
     void stopMonitoringTask(Id id);
 
+    // When a task is newly hung, the monitor thread samples the stack of the thread that started
+    // it `samples` times, `intervalUs` apart, and adds the hottest stacks to the hang annotations
+    // as "hot_stacks". 0 samples turns this off. See ThreadSampler.h for platform support.
+    void setHangSampling(uint32_t samples, uint64_t intervalUs = kDefaultHangSampleIntervalUs);
+
    private:
     using Duration = typename Clock::duration;  // duration<double>;
     using Timestamp = time_point<Clock, Duration>;
@@ -148,6 +159,9 @@ class HealthMonitor : public android::base::Thread {
     // Thread's main loop
     intptr_t main() override;
 
+    // Applies touches recorded in mTouchSlots since the last heartbeat.
+    void applySlotTouches(std::queue<std::unique_ptr<MonitoredEvent>>& events);
+
     // Update the parent task
     void updateTaskParent(std::queue<std::unique_ptr<MonitoredEvent>>& events,
                           const MonitoredTask& task, Timestamp eventTime);
@@ -159,12 +173,28 @@ class HealthMonitor : public android::base::Thread {
     // Immutable. Multi-thread access is safe.
     const Duration mInterval;
 
+    std::atomic<uint32_t> mHangSamples{kDefaultHangSamples};
+    std::atomic<uint64_t> mHangSampleIntervalUs{kDefaultHangSampleIntervalUs};
+
     // Members accessed only on the worker thread. Not protected by mutex.
     int mHungTasks = 0;
     MetricsLogger& mLogger;
     std::unordered_map<Id, MonitoredTask> mMonitoredTasks;
 
-    // Lock and cv control access to queue and id counter
+    // Touches skip the event queue: a task whose id maps to a free slot takes
+    // it at start and gives it back at stop, and touching it just stores the
+    // time there for the monitor thread to pick up. Tasks that find their
+    // slot taken send Touch events instead.
+    static constexpr size_t kTouchSlots = 256;
+    static constexpr Id kNoTask = std::numeric_limits<Id>::max();
+    struct alignas(64) TouchSlot {
+        std::atomic<Id> id{kNoTask};
+        std::atomic<typename Clock::rep> touched{};
+    };
+    TouchSlot mTouchSlots[kTouchSlots];
+
+    // Lock and cv control access to queue and id counter, and the taking and
+    // freeing of touch slots
     android::base::ConditionVariable mCv;
     Lock mLock;
     Id mNextId = 0;
@@ -296,7 +326,23 @@ class HealthWatchdogBuilder {
         return *this;
     }
 
+    // Record the calling stack and add it to the hang annotations as "stack". Only an interned
+    // stack id is kept; it is symbolized on the monitor thread if the task hangs.
+    HealthWatchdogBuilder& captureStack() {
+        if (mHealthMonitor) mStackId = android::base::captureStack();
+        return *this;
+    }
+
     std::unique_ptr<HealthWatchdog<HealthMonitorT>> build() {
+        if (mStackId != android::base::kInvalidStackId) {
+            mOnHangCallback = [callback = std::move(mOnHangCallback), stackId = mStackId]() {
+                std::unique_ptr<HangAnnotations> annotations;
+                if (callback) annotations = (*callback)();
+                if (!annotations) annotations = std::make_unique<HangAnnotations>();
+                (*annotations)["stack"] = android::base::formatStack(stackId);
+                return annotations;
+            };
+        }
         // We are allocating on the heap, so there is a performance hit. However we also allocate
         // EventHangMetadata on the heap, so this should be Ok. If we see performance issues with
         // these allocations, for HealthWatchdog, we can always use placement new + noop deleter to
@@ -310,6 +356,7 @@ class HealthWatchdogBuilder {
     std::unique_ptr<EventHangMetadata> mMetadata;
     uint32_t mTimeoutMs;
     std::optional<std::function<std::unique_ptr<HangAnnotations>()>> mOnHangCallback;
+    android::base::StackId mStackId = android::base::kInvalidStackId;
 };
 
 std::unique_ptr<HealthMonitor<>> CreateHealthMonitor(
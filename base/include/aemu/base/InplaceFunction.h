@@ -0,0 +1,163 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/TypeTraits.h"
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace android {
+namespace base {
+
+//
+// InplaceFunction<Signature, Capacity> - an owning callable wrapper like
+//      std::function<>, that keeps the callable in a fixed buffer of
+//      |Capacity| bytes inside of itself and never allocates.
+//
+// Use it for callbacks that are stored and then called on a hot path, where
+// FunctionView<> can't be used because the callable has to be kept around.
+// Compared to std::function<>:
+//
+//  1. Constructing from a callable that doesn't fit is a compile error
+//     instead of a heap allocation. Raise |Capacity| or capture less.
+//  2. A call is a single indirect call, and copying one that holds a
+//     trivially copyable callable, like a lambda capturing a few pointers,
+//     is a memcpy().
+//
+// Calling an empty InplaceFunction<> crashes, like FunctionView<>.
+//
+constexpr size_t kDefaultInplaceFunctionCapacity = 4 * sizeof(void*);
+
+template <class Signature, size_t Capacity = kDefaultInplaceFunctionCapacity>
+class InplaceFunction;
+
+template <class Ret, class... Args, size_t Capacity>
+class InplaceFunction<Ret(Args...), Capacity> final {
+public:
+    InplaceFunction() = default;
+    InplaceFunction(std::nullptr_t) {}
+
+    template <class Callable,
+              class = enable_if_c<
+                      is_callable_as<Callable, Ret(Args...)>::value &&
+                      !std::is_same<InplaceFunction,
+                                    typename std::decay<Callable>::type>::value>>
+    InplaceFunction(Callable&& c) {
+        using F = typename std::decay<Callable>::type;
+        static_assert(sizeof(F) <= Capacity,
+                      "The callable doesn't fit, raise the capacity");
+        static_assert(alignof(F) <= alignof(std::max_align_t),
+                      "The callable is over-aligned");
+        new (mStorage) F(std::forward<Callable>(c));
+        mInvoke = [](void* storage, Args... args) -> Ret {
+            return (*static_cast<F*>(storage))(std::forward<Args>(args)...);
+        };
+        if (!std::is_trivially_copyable<F>::value) {
+            mManage = &manage<F>;
+        }
+    }
+
+    InplaceFunction(const InplaceFunction& other) { copyFrom(other); }
+
+    InplaceFunction(InplaceFunction&& other) noexcept { moveFrom(other); }
+
+    InplaceFunction& operator=(const InplaceFunction& other) {
+        if (this != &other) {
+            reset();
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    InplaceFunction& operator=(InplaceFunction&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    ~InplaceFunction() { reset(); }
+
+    Ret operator()(Args... args) const {
+        return mInvoke(const_cast<char*>(mStorage), std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const { return mInvoke != nullptr; }
+
+private:
+    enum class Op { Copy, Move, Destroy };
+    using Invoker = Ret (*)(void*, Args...);
+    // Null for trivially copyable callables.
+    using Manager = void (*)(Op, void* dst, void* src);
+
+    template <class F>
+    static void manage(Op op, void* dst, void* src) {
+        switch (op) {
+            case Op::Copy:
+                new (dst) F(*static_cast<const F*>(src));
+                break;
+            case Op::Move:
+                new (dst) F(std::move(*static_cast<F*>(src)));
+                static_cast<F*>(src)->~F();
+                break;
+            case Op::Destroy:
+                static_cast<F*>(dst)->~F();
+                break;
+        }
+    }
+
+    void copyFrom(const InplaceFunction& other) {
+        if (other.mManage) {
+            other.mManage(Op::Copy, mStorage, const_cast<char*>(other.mStorage));
+        } else {
+            memcpy(mStorage, other.mStorage, Capacity);
+        }
+        mInvoke = other.mInvoke;
+        mManage = other.mManage;
+    }
+
+    void moveFrom(InplaceFunction& other) {
+        if (other.mManage) {
+            other.mManage(Op::Move, mStorage, other.mStorage);
+        } else {
+            memcpy(mStorage, other.mStorage, Capacity);
+        }
+        mInvoke = other.mInvoke;
+        mManage = other.mManage;
+        other.mInvoke = nullptr;
+        other.mManage = nullptr;
+    }
+
+    void reset() {
+        if (mManage) {
+            mManage(Op::Destroy, mStorage, nullptr);
+        }
+        mInvoke = nullptr;
+        mManage = nullptr;
+    }
+
+    alignas(std::max_align_t) char mStorage[Capacity];
+    Invoker mInvoke = nullptr;
+    Manager mManage = nullptr;
+};
+
+}  // namespace base
+}  // namespace android
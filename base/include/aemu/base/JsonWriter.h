@@ -14,21 +14,37 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <stddef.h>
+
 namespace android {
 namespace base {
 
+class Stream;
+
+// Writes JSON text, in memory, to a file or to a Stream. Tokens are
+// formatted straight into one growing buffer, so writing them allocates
+// nothing once it is big enough; reserve() can size it up front.
 class JsonWriter {
 public:
     JsonWriter();
     JsonWriter(const std::string& outputPath);
+    // Streams the text to |stream|, which must outlive the writer, in
+    // chunks of about kStreamChunkSize. contents() then only holds what
+    // hasn't been written out yet.
+    explicit JsonWriter(Stream* stream);
     ~JsonWriter();
 
+    static constexpr size_t kStreamChunkSize = 64 * 1024;
+
     std::string contents() const;
 
     void flush();
 
+    void reserve(size_t size);
+
     void setIndent(const std::string& indent);
 
     JsonWriter& beginObject();
@@ -37,14 +53,14 @@ public:
     JsonWriter& beginArray();
     JsonWriter& endArray();
 
-    JsonWriter& name(const std::string& string);
+    JsonWriter& name(std::string_view string);
     JsonWriter& nameAsStr(int val);
     JsonWriter& nameAsStr(long val);
     JsonWriter& nameAsStr(float val);
     JsonWriter& nameAsStr(double val);
     JsonWriter& nameBoolAsStr(bool val);
 
-    JsonWriter& value(const std::string& string);
+    JsonWriter& value(std::string_view string);
     JsonWriter& value(int val);
     JsonWriter& value(long val);
     JsonWriter& value(float val);
@@ -68,12 +84,18 @@ private:
 
     void insertComma();
 
-    void onValue(const std::string& valStr);
+    // Bracket the text of every value: the separator before, the element
+    // count and streaming after.
+    void beginValue();
+    void endValue();
+    void endAggregate(char close);
 
     void* mFp = nullptr;
     bool mNeedClose = true;
+    Stream* mStream = nullptr;
 
     size_t mFlushed = 0;
+    size_t mStreamed = 0;
     std::vector<int> mAggregateIndices;
     bool mInKeyVal = false;
 
@@ -82,4 +104,4 @@ private:
 };
 
 } // namespace base
-} // namespace android
\ No newline at end of file
+} // namespace android
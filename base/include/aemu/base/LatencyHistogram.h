@@ -0,0 +1,99 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <chrono>
+
+namespace android {
+namespace base {
+
+// Hot paths whose latency is reported as percentiles. Each one has its
+// own event codes in Metrics.cpp.
+enum class LatencyMetric {
+    kAsgWake,      // notifying a parked ASG ring until it is polled
+    kMediaPing,    // a host media ping, queueing included
+    kMediaDecode,  // running one decode task
+    kDmaMap,       // mapping a guest DMA buffer into the host
+    kPipeOpen,     // looking up and creating the service for a pipe connection
+    kSleepLateness,  // how late sleepUntilUs() returned
+    kCount,
+};
+
+// Log-linear histogram of microsecond values, in the style of HDR
+// histograms: each power of two is split into kSubBuckets linear buckets,
+// so percentiles are within 1/kSubBuckets of the recorded values. Recording
+// is a relaxed atomic add, plus a compare when |value| is a new maximum.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 3;
+    static constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+    static constexpr size_t kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    struct Summary {
+        uint64_t count = 0;
+        uint64_t p50 = 0;
+        uint64_t p90 = 0;
+        uint64_t p99 = 0;
+        uint64_t max = 0;
+    };
+
+    void record(uint64_t value) {
+        mCounts[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t max = mMax.load(std::memory_order_relaxed);
+        while (value > max &&
+               !mMax.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Summarizes what was recorded since the last call, and starts over.
+    // Each percentile is the upper bound of its bucket, capped at the max.
+    Summary takeSummary();
+
+    static size_t bucketOf(uint64_t value) {
+        if (value < kSubBuckets) {
+            return value;
+        }
+        const int shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+        return (shift + 1) * kSubBuckets + ((value >> shift) & (kSubBuckets - 1));
+    }
+    // Largest value that lands in |bucket|.
+    static uint64_t bucketUpperBound(size_t bucket);
+
+private:
+    std::atomic<uint64_t> mCounts[kBuckets] = {};
+    std::atomic<uint64_t> mMax{0};
+};
+
+LatencyHistogram& latencyHistogram(LatencyMetric metric);
+
+inline void recordLatency(LatencyMetric metric, uint64_t us) {
+    latencyHistogram(metric).record(us);
+}
+
+// Logs a MetricEventLatencySummary for every metric recorded into since
+// the last report, and resets them.
+void reportLatencySummaries();
+
+// Calls reportLatencySummaries() every |period| on a thread of its own,
+// until stopLatencyReporting(). Starting again changes the period.
+void startLatencyReporting(std::chrono::milliseconds period);
+void stopLatencyReporting();
+
+}  // namespace base
+}  // namespace android
@@ -13,9 +13,13 @@
 // limitations under the License.
 
 #pragma once
+#include "aemu/base/LruCache.h"
+
 #include <stdint.h>
+#include <memory>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace android {
 namespace base {
@@ -32,11 +36,77 @@ struct AutomotiveDisplay {
 // This function returns an "optimized" layout represented as a mapping from display
 // ID to x-y coordinates w.r.t the lower left corner of the QT window.
 std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> resolveLayout(
-        std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> rect,
+        const std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>>& rect,
         const double monitorAspectRatio);
 
+// Stacks the displays in one column, the lowest ID on top, each centered on
+// the widest one. |displayType| is one of AutomotiveDisplay; they all stack
+// the same way for now.
 std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> resolveStackedLayout(
-        std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> rectangles,
+        const std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>>& rectangles,
         uint32_t displayType);
+
+// Keeps the set of displays between calls and remembers the layouts it
+// resolved, for callers that recompute the layout on every hotplug or
+// rotation. Adding, resizing or removing a display updates the set and its
+// hash in place; resolving a set that was seen recently, with the same
+// aspect ratio or display type, is a cache lookup. Not thread safe.
+class LayoutResolver {
+public:
+    using Layout = std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>>;
+
+    explicit LayoutResolver(size_t cacheSize = 16) : mCache(cacheSize) {}
+
+    // Adds display |id|, or resizes it if already there.
+    void setDisplay(uint32_t id, uint32_t width, uint32_t height);
+    void removeDisplay(uint32_t id);
+    void clear();
+
+    size_t displayCount() const { return mKey.displays.size(); }
+
+    // The same as the free functions over the current displays. The
+    // reference is valid until the next call on this object.
+    const Layout& resolve(double monitorAspectRatio);
+    const Layout& resolveStacked(uint32_t displayType);
+
+    LruCacheStats cacheStats() const { return mCache.stats(); }
+
+    struct Display {
+        uint32_t id;
+        uint32_t width;
+        uint32_t height;
+
+        bool operator==(const Display& other) const {
+            return id == other.id && width == other.width && height == other.height;
+        }
+    };
+
+private:
+    struct Key {
+        // Sorted by id.
+        std::vector<Display> displays;
+        // Sum of the displays' hashes, so updates don't rehash the set.
+        uint64_t setHash = 0;
+        bool stacked = false;
+        // The aspect ratio's bits, or the display type.
+        uint64_t param = 0;
+
+        bool operator==(const Key& other) const {
+            return setHash == other.setHash && stacked == other.stacked &&
+                   param == other.param && displays == other.displays;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    const Layout& lookup();
+
+    Key mKey;
+    LruCache<Key, std::shared_ptr<const Layout>, KeyHash> mCache;
+    // The last layout returned, which may have been evicted since.
+    std::shared_ptr<const Layout> mCurrent;
+};
 }  // namespace base
 }  // namespace android
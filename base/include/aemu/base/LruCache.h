@@ -14,70 +14,407 @@
 
 #pragma once
 
-#include <list>
-#include <unordered_map>
+#include "aemu/base/synchronization/Lock.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
 
 namespace android {
 namespace base {
 
-template <typename Key, typename Value>
+enum class LruCachePolicy {
+    // Plain least recently used.
+    Lru,
+    // Segmented LRU, the 2Q scheme without its ghost list: new entries start
+    // on probation and only move to the protected segment when hit again, so
+    // a scan over many keys that are used once evicts only other probation
+    // entries.
+    TwoQueue,
+};
+
+struct LruCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t size = 0;
+    size_t cost = 0;
+};
+
+// A cache of at most |maxSize| entries whose total cost doesn't exceed
+// |maxCost|, evicting the least recently used ones first. Costs are supplied
+// by the caller on set(), typically the value's size in bytes.
+//
+// The entries are intrusive nodes, linked in both the recency list and an
+// open hash table, and recycled through a free list, so that a warm cache
+// doesn't allocate on set(). Not thread safe; see ShardedLruCache.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
 class LruCache {
   public:
-    LruCache(std::size_t maxSize) : m_maxSize(maxSize) {
-        m_table.reserve(maxSize);
+    LruCache(std::size_t maxSize)
+        : LruCache(maxSize, SIZE_MAX) {}
+
+    LruCache(std::size_t maxSize, std::size_t maxCost,
+             LruCachePolicy policy = LruCachePolicy::Lru)
+        : m_maxSize(maxSize), m_maxCost(maxCost), m_policy(policy) {
+        m_buckets.resize(bucketCountFor(std::min<std::size_t>(maxSize, 1024)));
     }
 
+    ~LruCache() {
+        clear();
+        for (Node* node : m_slabs) {
+            ::operator delete(node);
+        }
+    }
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+
+    // Returns nullptr if |key| is not cached. The pointer is valid until the
+    // next set() or remove().
     Value* get(const Key& key) {
-        auto tableIt = m_table.find(key);
-        if (tableIt == m_table.end()) {
+        Node* node = find(key, m_hash(key));
+        if (!node) {
+            ++m_stats.misses;
             return nullptr;
         }
-
-        // Move to front.
-        auto elementsIt = tableIt->second;
-        m_elements.splice(elementsIt, m_elements, m_elements.begin());
-        return &elementsIt->value;
+        ++m_stats.hits;
+        touch(node);
+        return &node->value;
     }
 
-    void set(const Key& key, Value&& value) {
-        auto tableIt = m_table.find(key);
-        if (tableIt == m_table.end()) {
-            if (m_table.size() >= m_maxSize) {
-                auto& kv = m_elements.back();
-                m_table.erase(kv.key);
-                m_elements.pop_back();
-            }
-        } else {
-            auto elementsIt = tableIt->second;
-            m_elements.erase(elementsIt);
+    // Returns false if |value| was not cached because |cost| alone is over
+    // the budget.
+    bool set(const Key& key, Value&& value, std::size_t cost = 1) {
+        const std::size_t hash = m_hash(key);
+        if (Node* node = find(key, hash)) {
+            unlink(node);
+            unlinkHash(node);
+            destroyNode(node);
+        }
+        if (cost > m_maxCost || !m_maxSize) {
+            ++m_stats.evictions;
+            return false;
+        }
+
+        Node* node = createNode(key, std::forward<Value>(value), cost, hash);
+        linkHash(node);
+        const Segment segment =
+            m_policy == LruCachePolicy::TwoQueue ? kProbation : kProtected;
+        pushFront(node, segment);
+        while (m_stats.size > m_maxSize || m_stats.cost > m_maxCost) {
+            evictOne(node);
         }
-        m_elements.emplace_front(KeyValue{
-            key,
-            std::forward<Value>(value),
-        });
-        m_table[key] = m_elements.begin();
+        return true;
     }
 
     void remove(const Key& key) {
-        auto tableIt = m_table.find(key);
-        if (tableIt == m_table.end()) {
+        Node* node = find(key, m_hash(key));
+        if (!node) {
             return;
         }
-        auto elementsIt = tableIt->second;
-        m_elements.erase(elementsIt);
-        m_table.erase(tableIt);
+        unlink(node);
+        unlinkHash(node);
+        destroyNode(node);
+    }
+
+    void clear() {
+        for (List& list : m_lists) {
+            while (list.head) {
+                Node* node = list.head;
+                unlink(node);
+                unlinkHash(node);
+                destroyNode(node);
+            }
+        }
     }
 
+    LruCacheStats stats() const { return m_stats; }
+    std::size_t size() const { return m_stats.size; }
+    std::size_t cost() const { return m_stats.cost; }
+
   private:
-    struct KeyValue {
+    enum Segment : uint8_t { kProbation = 0, kProtected = 1 };
+
+    struct Node {
+        Node* prev;
+        Node* next;
+        Node* hashNext;
+        std::size_t hash;
+        std::size_t cost;
+        Segment segment;
         Key key;
         Value value;
     };
 
+    struct List {
+        // Head is the most recently used, tail the least recently used.
+        Node* head = nullptr;
+        Node* tail = nullptr;
+        std::size_t cost = 0;
+        std::size_t size = 0;
+    };
+
+    // Free nodes are kept as raw memory, chained through this.
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    static constexpr std::size_t kNodesPerSlab = 64;
+
+    static std::size_t bucketCountFor(std::size_t entries) {
+        std::size_t count = 8;
+        while (count < entries) count *= 2;
+        return count;
+    }
+
+    Node* find(const Key& key, std::size_t hash) const {
+        Node* node = m_buckets[hash & (m_buckets.size() - 1)];
+        while (node && !(node->hash == hash && node->key == key)) {
+            node = node->hashNext;
+        }
+        return node;
+    }
+
+    void linkHash(Node* node) {
+        if (m_stats.size >= m_buckets.size()) {
+            rehash(m_buckets.size() * 2);
+        }
+        Node*& bucket = m_buckets[node->hash & (m_buckets.size() - 1)];
+        node->hashNext = bucket;
+        bucket = node;
+    }
+
+    void unlinkHash(Node* node) {
+        Node** link = &m_buckets[node->hash & (m_buckets.size() - 1)];
+        while (*link != node) {
+            link = &(*link)->hashNext;
+        }
+        *link = node->hashNext;
+    }
+
+    void rehash(std::size_t bucketCount) {
+        std::vector<Node*> buckets(bucketCount, nullptr);
+        for (Node* head : m_buckets) {
+            while (head) {
+                Node* next = head->hashNext;
+                Node*& bucket = buckets[head->hash & (bucketCount - 1)];
+                head->hashNext = bucket;
+                bucket = head;
+                head = next;
+            }
+        }
+        m_buckets.swap(buckets);
+    }
+
+    void pushFront(Node* node, Segment segment) {
+        List& list = m_lists[segment];
+        node->segment = segment;
+        node->prev = nullptr;
+        node->next = list.head;
+        if (list.head) {
+            list.head->prev = node;
+        } else {
+            list.tail = node;
+        }
+        list.head = node;
+        list.cost += node->cost;
+        ++list.size;
+        m_stats.cost += node->cost;
+        ++m_stats.size;
+    }
+
+    void unlink(Node* node) {
+        List& list = m_lists[node->segment];
+        if (node->prev) {
+            node->prev->next = node->next;
+        } else {
+            list.head = node->next;
+        }
+        if (node->next) {
+            node->next->prev = node->prev;
+        } else {
+            list.tail = node->prev;
+        }
+        list.cost -= node->cost;
+        --list.size;
+        m_stats.cost -= node->cost;
+        --m_stats.size;
+    }
+
+    void touch(Node* node) {
+        unlink(node);
+        pushFront(node, kProtected);
+        if (m_policy != LruCachePolicy::TwoQueue) {
+            return;
+        }
+        // The protected segment gets up to three quarters of the budget; the
+        // entries it pushes out get another chance on probation.
+        List& hot = m_lists[kProtected];
+        while (hot.size > 1 && (hot.size > m_maxSize - m_maxSize / 4 ||
+                                hot.cost > m_maxCost - m_maxCost / 4)) {
+            Node* demoted = hot.tail;
+            unlink(demoted);
+            pushFront(demoted, kProbation);
+        }
+    }
+
+    // Evicts the least recently used probation entry, or protected one if
+    // there is none besides |inserted|.
+    void evictOne(Node* inserted) {
+        Node* node = m_lists[kProbation].tail;
+        if (!node || (node == inserted && m_lists[kProtected].tail)) {
+            node = m_lists[kProtected].tail;
+        }
+        unlink(node);
+        unlinkHash(node);
+        destroyNode(node);
+        ++m_stats.evictions;
+    }
+
+    Node* createNode(const Key& key, Value&& value, std::size_t cost,
+                     std::size_t hash) {
+        if (!m_free) {
+            Node* slab = static_cast<Node*>(
+                ::operator new(sizeof(Node) * kNodesPerSlab));
+            m_slabs.push_back(slab);
+            for (std::size_t i = 0; i < kNodesPerSlab; ++i) {
+                auto slot = reinterpret_cast<FreeSlot*>(slab + i);
+                slot->next = m_free;
+                m_free = slot;
+            }
+        }
+        void* memory = m_free;
+        m_free = m_free->next;
+        return new (memory) Node{nullptr, nullptr, nullptr, hash, cost,
+                                 kProtected, key, std::forward<Value>(value)};
+    }
+
+    void destroyNode(Node* node) {
+        node->~Node();
+        auto slot = reinterpret_cast<FreeSlot*>(node);
+        slot->next = m_free;
+        m_free = slot;
+    }
+
+    static_assert(sizeof(Node) >= sizeof(FreeSlot), "node too small");
+
     const std::size_t m_maxSize;
-    // Front is the most recently used and back is the least recently used.
-    std::list<KeyValue> m_elements;
-    std::unordered_map<Key, typename std::list<KeyValue>::iterator> m_table;
+    const std::size_t m_maxCost;
+    const LruCachePolicy m_policy;
+    Hash m_hash;
+    List m_lists[2];
+    std::vector<Node*> m_buckets;
+    std::vector<Node*> m_slabs;
+    FreeSlot* m_free = nullptr;
+    LruCacheStats m_stats;
+};
+
+// An LruCache that can be shared between threads. Keys are spread over
+// |shardCount| independent caches, each with its own lock and an even share
+// of the size and cost budgets, so threads only contend when they hit the
+// same shard. Values are returned by copy; cache shared_ptrs for values that
+// are expensive to copy.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ShardedLruCache {
+  public:
+    ShardedLruCache(std::size_t maxSize, std::size_t maxCost = SIZE_MAX,
+                    LruCachePolicy policy = LruCachePolicy::Lru,
+                    std::size_t shardCount = 16) {
+        std::size_t shards = 1;
+        while (shards < shardCount) shards *= 2;
+        m_shardShift = 64;
+        for (std::size_t i = shards; i > 1; i /= 2) --m_shardShift;
+        for (std::size_t i = 0; i < shards; ++i) {
+            m_shards.emplace_back(new Shard(divideUp(maxSize, shards),
+                                            maxCost == SIZE_MAX
+                                                ? SIZE_MAX
+                                                : divideUp(maxCost, shards),
+                                            policy));
+        }
+    }
+
+    std::optional<Value> get(const Key& key) {
+        Shard& shard = shardFor(key);
+        AutoLock lock(shard.lock);
+        Value* value = shard.cache.get(key);
+        if (!value) {
+            return std::nullopt;
+        }
+        return *value;
+    }
+
+    bool set(const Key& key, Value&& value, std::size_t cost = 1) {
+        Shard& shard = shardFor(key);
+        AutoLock lock(shard.lock);
+        return shard.cache.set(key, std::forward<Value>(value), cost);
+    }
+
+    void remove(const Key& key) {
+        Shard& shard = shardFor(key);
+        AutoLock lock(shard.lock);
+        shard.cache.remove(key);
+    }
+
+    void clear() {
+        for (auto& shard : m_shards) {
+            AutoLock lock(shard->lock);
+            shard->cache.clear();
+        }
+    }
+
+    // Sum over all shards; not a consistent snapshot while other threads use
+    // the cache.
+    LruCacheStats stats() const {
+        LruCacheStats total;
+        for (const auto& shard : m_shards) {
+            AutoLock lock(shard->lock);
+            const LruCacheStats stats = shard->cache.stats();
+            total.hits += stats.hits;
+            total.misses += stats.misses;
+            total.evictions += stats.evictions;
+            total.size += stats.size;
+            total.cost += stats.cost;
+        }
+        return total;
+    }
+
+    std::size_t shardCount() const { return m_shards.size(); }
+
+  private:
+    struct Shard {
+        Shard(std::size_t maxSize, std::size_t maxCost, LruCachePolicy policy)
+            : cache(maxSize, maxCost, policy) {}
+
+        // Keep shards on separate cache lines.
+        alignas(64) mutable Lock lock;
+        LruCache<Key, Value, Hash> cache;
+    };
+
+    static std::size_t divideUp(std::size_t total, std::size_t parts) {
+        return (total + parts - 1) / parts;
+    }
+
+    Shard& shardFor(const Key& key) {
+        if (m_shards.size() == 1) {
+            return *m_shards[0];
+        }
+        // Use the high bits of a multiplicative mix: the shards' own tables
+        // index by the low bits.
+        const uint64_t mixed =
+            uint64_t(m_hash(key)) * UINT64_C(0x9e3779b97f4a7c15);
+        return *m_shards[mixed >> m_shardShift];
+    }
+
+    Hash m_hash;
+    unsigned m_shardShift = 64;
+    std::vector<std::unique_ptr<Shard>> m_shards;
 };
 
 }  // namespace base
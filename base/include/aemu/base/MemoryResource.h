@@ -0,0 +1,137 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/BumpPool.h"
+#include "aemu/base/Pool.h"
+#include "aemu/base/SubAllocator.h"
+
+#include <algorithm>
+#include <memory_resource>
+
+namespace android {
+namespace base {
+
+// std::pmr::memory_resource adapters, so that std::pmr containers,
+// SmallFixedVector and segmented MemStreams can take their memory from our
+// pools:
+//
+//      BumpPool pool;
+//      BumpPoolResource resource(&pool);
+//      std::pmr::vector<Command> commands(&resource);
+//      ...
+//      pool.freeAll();  // once |commands| is gone
+//
+// The adapters don't own the pools, which must outlive them. None of them
+// is thread safe beyond what the pool itself is.
+
+// Deallocation is a no-op: the memory comes back with BumpPool::freeAll().
+class BumpPoolResource : public std::pmr::memory_resource {
+public:
+    explicit BumpPoolResource(BumpPool* pool) : mPool(pool) {}
+
+    BumpPool* pool() const { return mPool; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        return mPool->allocAligned(bytes, alignment);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    BumpPool* mPool;
+};
+
+// Alignments above Pool::kMaxAlignment go to |upstream|.
+class PoolResource : public std::pmr::memory_resource {
+public:
+    explicit PoolResource(
+            Pool* pool,
+            std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : mPool(pool), mUpstream(upstream) {}
+
+    Pool* pool() const { return mPool; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (alignment > Pool::kMaxAlignment) {
+            return mUpstream->allocate(bytes, alignment);
+        }
+        // Pool aligns to the size class.
+        return mPool->alloc(std::max(bytes, alignment));
+    }
+
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        if (alignment > Pool::kMaxAlignment) {
+            mUpstream->deallocate(ptr, bytes, alignment);
+            return;
+        }
+        mPool->free(ptr);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    Pool* mPool;
+    std::pmr::memory_resource* mUpstream;
+};
+
+// Allocations the SubAllocator's buffer can't hold, or that need more than
+// its page alignment, go to |upstream|.
+class SubAllocatorResource : public std::pmr::memory_resource {
+public:
+    SubAllocatorResource(
+            SubAllocator* allocator,
+            size_t pageSize,
+            std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : mAllocator(allocator), mPageSize(pageSize), mUpstream(upstream) {}
+
+    SubAllocator* allocator() const { return mAllocator; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (alignment <= mPageSize) {
+            if (void* ptr = mAllocator->alloc(std::max<size_t>(bytes, 1))) {
+                return ptr;
+            }
+        }
+        return mUpstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        if (mAllocator->contains(ptr)) {
+            mAllocator->free(ptr);
+            return;
+        }
+        mUpstream->deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    SubAllocator* mAllocator;
+    const size_t mPageSize;
+    std::pmr::memory_resource* mUpstream;
+};
+
+}  // namespace base
+}  // namespace android
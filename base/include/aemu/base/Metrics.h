@@ -16,6 +16,7 @@
 
 #include <inttypes.h>
 
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <string>
@@ -23,6 +24,9 @@
 #include <unordered_map>
 #include <variant>
 
+#include "aemu/base/LatencyHistogram.h"
+#include "aemu/base/ThreadRoles.h"
+#include "aemu/base/memory/MemoryPressure.h"
 #include "aemu/base/threads/Thread.h"
 
 // Library to log metrics.
@@ -100,10 +104,57 @@ struct MetricEventVulkanOutOfMemory {
     std::optional<uint64_t> allocationSize = std::nullopt;
 };
 
+// Aggregated over all rings of an asg::RingPoller since its last report.
+struct MetricEventAsgRingStats {
+    int64_t rings;
+    // Longest time between notifying a parked ring and polling it.
+    int64_t maxWakeLatencyUs;
+    // Longest time an active ring waited for its next poll; a measure of
+    // fairness across the rings sharing a thread.
+    int64_t maxPollGapUs;
+};
+
+// Aggregated over the video decoder helpers handed out by
+// MediaVideoHelperPool since its last report.
+struct MetricEventMediaDecoderPoolStats {
+    int64_t hits;
+    int64_t misses;
+    // Longest time a decoder waited for its helper to be ready.
+    int64_t maxStartupUs;
+};
+
+// Percentiles of a LatencyMetric since its last report, in microseconds.
+struct MetricEventLatencySummary {
+    LatencyMetric metric;
+    int64_t count;
+    int64_t p50Us;
+    int64_t p99Us;
+    int64_t maxUs;
+};
+
+// What the threads of a ThreadRole used since the last report.
+struct MetricEventThreadRoleUsage {
+    ThreadRole role;
+    int64_t threads;
+    // Thousandths of a core.
+    int64_t cpuPermille;
+    int64_t wakeupsPerSec;
+    int64_t preemptionsPerSec;
+};
+
+// One trimMemory() run.
+struct MetricEventMemoryTrim {
+    MemoryPressureLevel level;
+    int64_t trimmers;
+    int64_t reclaimedBytes;
+};
+
 using MetricEventType =
     std::variant<std::monostate, MetricEventBadPacketLength, MetricEventDuplicateSequenceNum,
                  MetricEventFreeze, MetricEventUnFreeze, MetricEventHang, MetricEventUnHang,
-                 MetricEventVulkanOutOfMemory, GfxstreamVkAbort>;
+                 MetricEventVulkanOutOfMemory, GfxstreamVkAbort, MetricEventAsgRingStats,
+                 MetricEventMediaDecoderPoolStats, MetricEventLatencySummary,
+                 MetricEventThreadRoleUsage, MetricEventMemoryTrim>;
 
 class MetricsLogger {
    public:
@@ -125,9 +176,59 @@ class MetricsLogger {
                                                   bool is_host_side_result, bool is_allocation);
     // Crashpad will copy the strings, so these need only persist for the function call
     static void (*set_crash_annotation_callback)(const char* key, const char* value);
+    // Optional. While events are buffered, identical ones are delivered
+    // through this once per flush, with how many there were and when the
+    // first and last came in (steady clock, microseconds). Without it they
+    // are delivered once through the callback they came in on.
+    static void (*add_aggregated_instant_event_callback)(int64_t event_code, int64_t value,
+                                                         int64_t count, int64_t first_us,
+                                                         int64_t last_us);
 };
 
 std::unique_ptr<MetricsLogger> CreateMetricsLogger();
 
+// Called with every event logged through a logger from CreateMetricsLogger(),
+// on the logging thread and before the event is delivered, to keep live
+// copies of the latest figures. Must be quick. There is one observer at a
+// time; nullptr removes it.
+using MetricEventObserver = void (*)(const MetricEventType& event);
+void setMetricEventObserver(MetricEventObserver observer);
+
+struct MetricEventBufferOptions {
+    // How often buffered events are flushed. Identical events (same
+    // callback, code and value) within one window are delivered once.
+    std::chrono::milliseconds window{1000};
+    // Distinct events of one code delivered per window; the rest are
+    // dropped.
+    uint32_t maxPerCode = 16;
+    // Distinct events held between flushes before new ones are dropped.
+    size_t maxPending = 1024;
+};
+
+struct MetricEventBufferStats {
+    uint64_t delivered = 0;
+    // Folded into an identical event already pending.
+    uint64_t aggregated = 0;
+    uint64_t sampledOut = 0;
+    uint64_t rateLimited = 0;
+    uint64_t overflowed = 0;
+};
+
+// Hands the instant events that MetricsLogger reports to a flush thread
+// instead of calling the embedder's callbacks on the thread that logged
+// them, so a storm of hangs or bad packets costs the hot thread a short
+// lock and a hash lookup. Hang and Vulkan out-of-memory events still go out
+// right away, as they set crash annotations or precede a crash; an abort
+// flushes everything pending first. Starting again changes the options.
+void startMetricEventBuffering(const MetricEventBufferOptions& options = {});
+// Flushes, and goes back to delivering on the logging thread.
+void stopMetricEventBuffering();
+// Delivers everything pending now, on the calling thread.
+void flushMetricEvents();
+// While buffering, keeps one in |oneIn| events of |eventCode| and drops
+// the rest. 1 keeps them all.
+void setMetricEventSampling(int64_t eventCode, uint32_t oneIn);
+MetricEventBufferStats metricEventBufferStats();
+
 }  // namespace base
 }  // namespace android
\ No newline at end of file
@@ -0,0 +1,146 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace android {
+namespace base {
+
+// A persistent counterpart to MruCache for blobs such as program binaries,
+// kept in an append-only file:
+//
+//     header | record | record | ...
+//     record: { tag, keySize, valueSize, checksum } key value <pad to 8>
+//
+// open() maps the file and builds a hash index from the record headers
+// alone, so startup doesn't read the values. get() returns views straight
+// into the mapping and checks an entry's checksum the first time it is
+// read. put() appends a single record; a record torn by a crash is cut off
+// by the next open().
+//
+// Replaced entries leave dead records behind. Compaction rewrites the live
+// entries, least recently used first, to a new file that atomically
+// replaces the old one, after applying MruCache's eviction policy once
+// there are |maxEntries| entries. put() queues a compaction on the
+// BackgroundExecutor whenever either limit is crossed.
+//
+// On Windows the indexed part of the file is read into memory instead of
+// being mapped, since a mapped file can't be replaced there.
+//
+// Thread-safe.
+class PersistentMruCache {
+public:
+    // A value returned by get(). It keeps the storage it points to alive,
+    // so it stays valid across later puts and compactions.
+    class Value {
+    public:
+        Value() = default;
+
+        std::string_view data() const { return mData; }
+
+    private:
+        friend class PersistentMruCache;
+
+        std::shared_ptr<const void> mOwner;
+        std::string_view mData;
+    };
+
+    // Opens the cache file at |path|, creating it if needed. A file that
+    // isn't in the expected format is reset to empty. Returns nullptr if
+    // the file can't be opened.
+    static std::unique_ptr<PersistentMruCache> open(const std::string& path,
+                                                    size_t maxEntries);
+
+    // Waits for a queued or running compaction.
+    ~PersistentMruCache();
+
+    // Looks up |key| and makes it the most recently used entry. Returns
+    // false if it isn't there or its record turns out to be corrupted.
+    bool get(std::string_view key, Value* value);
+
+    // Adds or replaces the entry for |key|. Returns false if the record
+    // couldn't be written; the entry is still cached for this session.
+    bool put(std::string_view key, std::string_view value);
+
+    // Rewrites the file with only the live entries and waits for it.
+    bool compact();
+
+    // Queues compact() on the BackgroundExecutor unless one is pending.
+    void compactAsync();
+
+    size_t size() const;
+
+    // Bytes of records in the file that no entry refers to anymore.
+    uint64_t deadBytes() const;
+
+    uint64_t fileSize() const;
+
+private:
+    struct Mapping;
+
+    struct Entry {
+        std::shared_ptr<const void> owner;  // holds the key and value bytes
+        std::string_view value;
+        uint32_t checksum;
+        uint32_t recordSize;
+        bool verified;
+        std::list<std::string_view>::iterator recency;
+    };
+
+    PersistentMruCache(const std::string& path, size_t maxEntries, int fd);
+
+    bool load();
+    void insertLocked(std::string_view key,
+                      std::string_view value,
+                      std::shared_ptr<const void> owner,
+                      uint32_t checksum,
+                      uint32_t recordSize,
+                      bool verified);
+    void evictLocked();
+    void maybeCompactLocked();
+    void runQueuedCompaction();
+
+    const std::string mPath;
+    const size_t mMaxEntries;
+
+    mutable Lock mLock;
+    ConditionVariable mCompactionDone;
+    int mFd;
+    uint64_t mFileSize = 0;
+    uint64_t mDeadBytes = 0;
+    std::shared_ptr<const Mapping> mMapping;
+    std::unordered_map<std::string_view, Entry> mIndex;  // keys view owners
+    std::list<std::string_view> mRecency;  // most recent first, as MruCache
+    bool mCompacting = false;
+    bool mCompactionQueued = false;
+
+    DISALLOW_COPY_AND_ASSIGN(PersistentMruCache);
+};
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,81 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+namespace base {
+
+// Framebuffer conversions for screenshots, recording and displaying rotated
+// screens. Formats are named by byte order in memory: RGBA8888 is R first.
+// RGB565 is a little-endian 16-bit value with R in the top 5 bits. Strides
+// are in bytes, like QFrameBuffer::pitch.
+struct PixelKernels {
+    // Swaps the first and third byte of each 4-byte pixel: RGBA8888 <->
+    // BGRA8888. Works in place.
+    void (*swapRB)(const uint8_t* src, size_t srcStride,
+                   uint8_t* dst, size_t dstStride,
+                   int width, int height);
+    // Scales the color bytes of each 4-byte pixel by its last byte, the
+    // alpha, rounding to nearest. Works in place, for RGBA and BGRA alike.
+    void (*premultiply)(const uint8_t* src, size_t srcStride,
+                        uint8_t* dst, size_t dstStride,
+                        int width, int height);
+    // RGB565 to opaque RGBA8888, repeating the top bits into the low ones
+    // so that 0x1f becomes 0xff.
+    void (*rgb565ToRgba)(const uint8_t* src, size_t srcStride,
+                         uint8_t* dst, size_t dstStride,
+                         int width, int height);
+    // RGBA8888 to RGB565, truncating; alpha is dropped.
+    void (*rgbaToRgb565)(const uint8_t* src, size_t srcStride,
+                         uint8_t* dst, size_t dstStride,
+                         int width, int height);
+    // Rotates 4-byte pixels |quarterTurns| times 90 degrees clockwise, the
+    // way QFrameBuffer::rotation counts. |width| and |height| are the
+    // source's, and swap in |dst| for odd turns. Not in place.
+    void (*rotate)(const uint8_t* src, size_t srcStride,
+                   uint8_t* dst, size_t dstStride,
+                   int width, int height, int quarterTurns);
+    const char* name;
+
+    // The fastest kernels this CPU supports, picked on first use.
+    static const PixelKernels& get();
+    // Plain C++ loops, for comparison.
+    static const PixelKernels& scalar();
+};
+
+// The kernels of PixelKernels::get(), split into bands that run on the
+// BackgroundExecutor workers and the calling thread when the image is large
+// enough for that to pay off, as 4K and foldable displays are.
+void pixelSwapRB(const void* src, size_t srcStride,
+                 void* dst, size_t dstStride,
+                 int width, int height);
+void pixelPremultiply(const void* src, size_t srcStride,
+                      void* dst, size_t dstStride,
+                      int width, int height);
+void pixelRgb565ToRgba(const void* src, size_t srcStride,
+                       void* dst, size_t dstStride,
+                       int width, int height);
+void pixelRgbaToRgb565(const void* src, size_t srcStride,
+                       void* dst, size_t dstStride,
+                       int width, int height);
+void pixelRotate(const void* src, size_t srcStride,
+                 void* dst, size_t dstStride,
+                 int width, int height, int quarterTurns);
+
+}  // namespace base
+}  // namespace android
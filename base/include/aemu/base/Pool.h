@@ -15,8 +15,6 @@
 
 #include "aemu/base/Allocator.h"
 
-#include <unordered_set>
-
 #include <inttypes.h>
 #include <stddef.h>
 #include <string.h>
@@ -27,20 +25,67 @@ namespace base {
 // Class to make it easier to set up memory regions where it is fast
 // to allocate/deallocate buffers that have size within
 // the specified range.
+//
+// Sizes are rounded up to a power of two size class. Each class carves its
+// objects out of slabs: aligned blocks with a header at the start, so free()
+// finds the slab and class of a pointer by masking its address. Free objects
+// form an intrusive list inside their slab, and alloc() and free() are O(1).
+// An empty slab goes back to the system once its class has another one with
+// room in it. Sizes above |maxSize| get an aligned block of their own.
+//
+// With Threading::PerThreadCache, the pool may be used from several threads
+// at once and each of them keeps a small cache of free objects per class, so
+// that most calls don't take the pool lock. Otherwise the pool is not thread
+// safe.
 class Pool : public Allocator {
 public:
+    // alloc(size) returns memory aligned to |size| rounded up to a power of
+    // two, or to kMaxAlignment if that is smaller.
+    static constexpr size_t kMaxAlignment = 64;
+
+    enum class Threading {
+        SingleThreaded,
+        PerThreadCache,
+    };
+
+    struct Stats {
+        uint64_t allocCount = 0;
+        uint64_t freeCount = 0;
+        // Allocations served without asking the system for memory.
+        uint64_t hitCount = 0;
+        // Of those, the ones served from the calling thread's cache.
+        uint64_t cacheHitCount = 0;
+        // Allocations larger than maxSize.
+        uint64_t largeAllocCount = 0;
+        uint64_t slabCount = 0;
+        // Memory held by slabs and large allocations.
+        uint64_t bytesReserved = 0;
+        // Memory handed out, rounded up to the size classes.
+        uint64_t bytesInUse = 0;
+
+        double hitRate() const {
+            return allocCount ? double(hitCount) / allocCount : 0.0;
+        }
+        // Share of the reserved memory that is not handed out.
+        double fragmentation() const {
+            return bytesReserved ? 1.0 - double(bytesInUse) / bytesReserved
+                                 : 0.0;
+        }
+    };
+
     // minSize/maxSize: the target range of sizes for which we want to
     // make allocations fast. the greater the range, the more space
     // traded off.
     // chunksPerSize: the target maximum number of live objects of
     // each size that are expected. the higher it is, the more space
-    // traded off.
+    // traded off. It also sizes the per-thread caches.
     //
     // Rough space cost formula:
     // O(chunksPerSize * log2(maxSize / minSize) * maxSize)
     Pool(size_t minSize = 4,
          size_t maxSize = 4096,
-         size_t chunksPerSize = 1024);
+         size_t chunksPerSize = 1024,
+         Threading threading = Threading::SingleThreaded);
 
     // All memory allocated by this pool
     // is automatically deleted when the pool
@@ -48,16 +93,19 @@ public:
     ~Pool();
 
     void* alloc(size_t wantedSize) override;
+    // |ptr| must come from this pool's alloc(), or be null.
     void free(void* ptr);
 
     // Convenience function to free everything currently allocated.
+    // With Threading::PerThreadCache, no other thread may use the pool
+    // meanwhile.
     void freeAll();
 
+    Stats stats() const;
+
 private:
     class Impl;
     Impl* mImpl = nullptr;
-
-    std::unordered_set<void*> mFallbackPtrs;
 };
 
 } // namespace base
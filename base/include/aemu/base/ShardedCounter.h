@@ -0,0 +1,88 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace android {
+namespace base {
+
+// A fixed set of signed counters that many threads bump and few read, such
+// as object counts updated on every create and destroy.
+//
+// Each thread gets its own cache line aligned shard on first use, and only
+// that thread writes it, with a relaxed load and store rather than an atomic
+// read-modify-write. sum() adds up all the shards under a lock. When a thread
+// exits its shard is folded into a base total, so nothing it counted is
+// lost.
+class ShardedCounter {
+public:
+    explicit ShardedCounter(size_t slots);
+    ~ShardedCounter();
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(ShardedCounter);
+
+    // Per-thread updates between times add() returns true, for callers that
+    // keep something derived from the sums, e.g. a StatsPage gauge, fresh
+    // without paying for a sum() on every update.
+    static constexpr uint32_t kRefreshInterval = 256;
+
+    // Adds |delta| to counter |slot|, which must be below slots(). Returns
+    // true every kRefreshInterval-th call on the calling thread.
+    bool add(size_t slot, int64_t delta) {
+        uint32_t* countdown;
+        std::atomic<int64_t>* counts = threadShard(&countdown);
+        counts[slot].store(counts[slot].load(std::memory_order_relaxed) + delta,
+                           std::memory_order_relaxed);
+        if (--*countdown == 0) {
+            *countdown = kRefreshInterval;
+            return true;
+        }
+        return false;
+    }
+
+    size_t slots() const { return mSlots; }
+
+    // The totals over all threads, one per slot. Updates racing with the
+    // call may or may not be included.
+    std::vector<int64_t> sum() const;
+
+    // A thread's shard and where it is found, defined in the .cpp file.
+    struct Shard;
+
+private:
+    std::atomic<int64_t>* threadShard(uint32_t** countdown);
+    std::unique_ptr<Shard> newShard();
+
+    friend struct ShardedCounterThreadState;
+
+    const size_t mSlots;
+    // Never reused, so a thread can tell a live counter from one destroyed
+    // at the same address.
+    const uint64_t mId;
+    // All guarded by the process-wide shard lock.
+    std::vector<std::unique_ptr<Shard>> mShards;
+    std::vector<int64_t> mRetired;
+};
+
+}  // namespace base
+}  // namespace android
@@ -16,6 +16,7 @@
 #define EMUGL_COMMON_SHARED_LIBRARY_H
 
 #include <stddef.h>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -50,6 +51,11 @@ namespace base {
 //    FunctionPtr my_func = library->findSymbol("my_func");
 //
 //  A shared library will be unloaded on program exit.
+//
+// Libraries that are found through the search paths can be remembered
+// across runs with setPathCacheFile(), so that the next run dlopens the
+// right file first instead of trying each path in turn. open() is thread
+// safe.
 class EMUGL_COMMON_API SharedLibrary {
    private:
     struct Deleter {
@@ -88,6 +94,11 @@ class EMUGL_COMMON_API SharedLibrary {
     // Adds an extra path to search for libraries.
     static void addLibrarySearchPath(const char* path);
 
+    // Loads the library paths resolved by earlier runs from |path|, and
+    // saves there every library open() finds from now on. A cached path
+    // that no longer opens is searched for again. NULL stops caching.
+    static void setPathCacheFile(const char* path);
+
     // Generic function pointer type, for values returned by the
     // findSymbol() method.
     typedef void (*FunctionPtr)(void);
@@ -97,6 +108,12 @@ class EMUGL_COMMON_API SharedLibrary {
     // NULL if the symbol is not found.
     virtual FunctionPtr findSymbol(const char* symbolName) const;
 
+    // Looks up |count| symbols at once, filling |symbols| with their
+    // addresses, or NULL for the missing ones. Returns how many were found.
+    size_t findSymbols(const char* const* symbolNames,
+                       FunctionPtr* symbols,
+                       size_t count) const;
+
    protected:
 #ifdef _WIN32
     typedef HMODULE HandleType;
@@ -119,6 +136,56 @@ class EMUGL_COMMON_API SharedLibrary {
 
 #  define EMUGL_LIBNAME(name) "lib" name
 
+// A function in a shared library that is only looked up, and the library
+// only opened, the first time it is called, so loaders with hundreds of
+// entry points don't pay at startup for the ones never used:
+//
+//     static LazySymbol<CUresult(unsigned int)> sCuInit("libcuda", "cuInit");
+//     if (!sCuInit || sCuInit(0) != CUDA_SUCCESS) { ... }
+//
+// The resolved address is cached, so later calls cost one relaxed load.
+// |libraryName| and |symbolName| must outlive the object.
+template <typename Signature>
+class LazySymbol;
+
+template <typename R, typename... Args>
+class LazySymbol<R(Args...)> {
+public:
+    using Function = R (*)(Args...);
+
+    constexpr LazySymbol(const char* libraryName, const char* symbolName)
+        : mLibraryName(libraryName), mSymbolName(symbolName) {}
+
+    // The function, or NULL if the library or symbol can't be found.
+    Function get() const {
+        if (!mResolved.load(std::memory_order_acquire)) {
+            resolve();
+        }
+        return mFunction.load(std::memory_order_relaxed);
+    }
+
+    explicit operator bool() const { return get() != nullptr; }
+
+    // Must only be called if the function was found.
+    R operator()(Args... args) const { return get()(args...); }
+
+private:
+    void resolve() const {
+        Function function = nullptr;
+        if (SharedLibrary* library = SharedLibrary::open(mLibraryName)) {
+            function = reinterpret_cast<Function>(library->findSymbol(mSymbolName));
+        }
+        // Racing resolvers find the same address.
+        mFunction.store(function, std::memory_order_relaxed);
+        mResolved.store(true, std::memory_order_release);
+    }
+
+    const char* const mLibraryName;
+    const char* const mSymbolName;
+    mutable std::atomic<Function> mFunction{nullptr};
+    mutable std::atomic<bool> mResolved{false};
+};
+
 }  // namespace base
 }  // namespace android
 
@@ -0,0 +1,158 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+namespace android {
+namespace base {
+
+// Counters and gauges kept in a fixed layout that can be published as a
+// SharedMemory region, so an agent outside the emulator can map it read
+// only and poll it without the emulator doing any work:
+//
+//     static Stat sOpenPipes = StatsPage::get().add("pipes.open", StatKind::kGauge);
+//     sOpenPipes.add(1);
+//     ...
+//     StatsPage::get().publish("aemu_stats_<pid>");
+//
+// The region is a Header followed by kMaxEntries Entries. An agent checks
+// |magic| and |version|, then reads the first |count| entries (acquire);
+// names and kinds never change once counted, values are relaxed 64-bit
+// atomics. A reader that doesn't know a newer version can still walk the
+// entries using |headerSize| and |entrySize|.
+enum class StatKind : uint32_t {
+    kCounter = 1,  // only grows; agents derive rates from it
+    kGauge = 2,    // goes up and down
+};
+
+class Stat {
+public:
+    Stat() = default;
+
+    void add(int64_t delta) const;
+    void set(int64_t value) const;
+    int64_t value() const;
+
+private:
+    friend class StatsPage;
+    explicit Stat(uint32_t index) : mIndex(index) {}
+
+    // Out of range when the page was full; updates are then dropped.
+    uint32_t mIndex = UINT32_MAX;
+};
+
+class StatsPage {
+public:
+    static constexpr char kMagic[8] = {'A', 'E', 'M', 'U', 'S', 'T', 'A', 'T'};
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kNameSize = 48;
+    static constexpr uint32_t kMaxEntries = 255;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint32_t entrySize;
+        uint32_t capacity;
+        std::atomic<uint32_t> count;
+        uint32_t pid;
+        uint64_t startUnixUs;
+        uint8_t reserved[24];
+    };
+
+    struct Entry {
+        char name[kNameSize];  // NUL terminated
+        StatKind kind;
+        uint32_t reserved;
+        std::atomic<int64_t> value;
+    };
+
+    static constexpr size_t kSize = sizeof(Header) + kMaxEntries * sizeof(Entry);
+
+    // A name and value read back from a page.
+    struct Value {
+        std::string name;
+        StatKind kind;
+        int64_t value;
+    };
+
+    static StatsPage& get();
+
+    // The stat named |name|, added on first use; later calls with the same
+    // name return the same one whatever |kind| they pass. Names longer than
+    // kNameSize - 1 are truncated.
+    Stat add(const char* name, StatKind kind);
+
+    // Moves the page into a new SharedMemory region |name| (see
+    // SharedMemory for the naming rules), created with |mode|. The region
+    // stays until the process exits. Returns 0, or a negative errno; -EEXIST
+    // if the page is already published. Updates racing with the move may be
+    // lost, so publish early.
+    int publish(const std::string& name, mode_t mode = 0600);
+
+    std::vector<Value> snapshot() const;
+
+    // Reads the stats out of a mapped page, as an agent would; returns
+    // false if |data| doesn't hold a page this version can read.
+    static bool parse(const void* data, size_t size, std::vector<Value>* out);
+
+private:
+    friend class Stat;
+
+    struct Page {
+        Header header;
+        Entry entries[kMaxEntries];
+    };
+
+    StatsPage();
+
+    static Entry& entry(uint32_t index) {
+        return sPage.load(std::memory_order_acquire)->entries[index];
+    }
+
+    static Page sLocalPage;
+    // sLocalPage until publish(), then the shared one.
+    static std::atomic<Page*> sPage;
+};
+
+inline void Stat::add(int64_t delta) const {
+    if (mIndex < StatsPage::kMaxEntries) {
+        StatsPage::entry(mIndex).value.fetch_add(delta, std::memory_order_relaxed);
+    }
+}
+
+inline void Stat::set(int64_t value) const {
+    if (mIndex < StatsPage::kMaxEntries) {
+        StatsPage::entry(mIndex).value.store(value, std::memory_order_relaxed);
+    }
+}
+
+inline int64_t Stat::value() const {
+    if (mIndex < StatsPage::kMaxEntries) {
+        return StatsPage::entry(mIndex).value.load(std::memory_order_relaxed);
+    }
+    return 0;
+}
+
+}  // namespace base
+}  // namespace android
@@ -14,11 +14,16 @@
 
 #pragma once
 
+#include "aemu/base/containers/SmallVector.h"
+
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 
 #include <stdarg.h>
+#include <stdint.h>
 
 namespace android {
 namespace base {
@@ -43,6 +48,15 @@ void StringAppendFormatWithArgs(std::string* string,
                                 const char* format,
                                 va_list args);
 
+// The same for a SmallVector<char>, e.g. a SmallFixedVector<char, 256> on
+// the stack: the text is formatted right into its spare capacity in one
+// pass, and the buffer only grows (followed by a second pass) if it
+// doesn't fit. The text isn't NUL-terminated.
+void StringAppendFormatRaw(SmallVector<char>* buffer, const char* format, ...);
+void StringAppendFormatWithArgs(SmallVector<char>* buffer,
+                                const char* format,
+                                va_list args);
+
 // unpackFormatArg() is a set of overloaded functions needed to unpack
 // an argument of the formatting list to a POD value which can be passed
 // into the sprintf()-like C function
@@ -77,5 +91,244 @@ void StringAppendFormat(std::string* string,
                           unpackFormatArg(std::forward<Args>(args))...);
 }
 
+template <class... Args>
+void StringFormatTo(SmallVector<char>* buffer,
+                    const char* format,
+                    Args&&... args) {
+    StringAppendFormatRaw(buffer, format,
+                          unpackFormatArg(std::forward<Args>(args))...);
+}
+
+namespace internal {
+
+enum class FormatArgKind : uint8_t { None, Int, Float, String, Pointer };
+
+template <class T>
+constexpr FormatArgKind formatArgKind() {
+    if (std::is_integral<T>::value) {
+        return FormatArgKind::Int;
+    }
+    if (std::is_same<T, float>::value || std::is_same<T, double>::value) {
+        return FormatArgKind::Float;
+    }
+    if (std::is_same<T, char*>::value || std::is_same<T, const char*>::value ||
+        std::is_same<T, std::string>::value ||
+        std::is_same<T, std::string_view>::value) {
+        return FormatArgKind::String;
+    }
+    if (std::is_pointer<T>::value || std::is_null_pointer<T>::value) {
+        return FormatArgKind::Pointer;
+    }
+    return FormatArgKind::None;
+}
+
+// The size an integer argument has once promoted, as vararg calls pass it.
+template <class T>
+constexpr size_t formatArgSize() {
+    if constexpr (std::is_integral<T>::value) {
+        return sizeof(decltype(+std::declval<T>()));
+    } else {
+        return 0;
+    }
+}
+
+// Whether |format| has one conversion of the right kind for each argument,
+// in order, like -Wformat checks printf(). Integers must have the size
+// their length modifier asks for; long double, %n and %a aren't supported.
+constexpr bool checkFormat(const char* format,
+                           const FormatArgKind* kinds,
+                           const size_t* sizes,
+                           size_t count) {
+    size_t next = 0;
+    const auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+    const auto takeInt = [&]() {
+        if (next >= count || kinds[next] != FormatArgKind::Int ||
+            sizes[next] > sizeof(int)) {
+            return false;
+        }
+        ++next;
+        return true;
+    };
+    const char* f = format;
+    while (*f) {
+        if (*f++ != '%') {
+            continue;
+        }
+        if (*f == '%') {
+            ++f;
+            continue;
+        }
+        while (*f == '-' || *f == '+' || *f == ' ' || *f == '#' || *f == '0') {
+            ++f;
+        }
+        if (*f == '*') {
+            if (!takeInt()) {
+                return false;
+            }
+            ++f;
+        }
+        while (isDigit(*f)) {
+            ++f;
+        }
+        if (*f == '.') {
+            ++f;
+            if (*f == '*') {
+                if (!takeInt()) {
+                    return false;
+                }
+                ++f;
+            }
+            while (isDigit(*f)) {
+                ++f;
+            }
+        }
+        size_t intSize = sizeof(int);
+        switch (*f) {
+            case 'h':
+                f += f[1] == 'h' ? 2 : 1;
+                break;
+            case 'l':
+                intSize = f[1] == 'l' ? sizeof(long long) : sizeof(long);
+                f += f[1] == 'l' ? 2 : 1;
+                break;
+            case 'z':
+                intSize = sizeof(size_t);
+                ++f;
+                break;
+            case 'j':
+                intSize = sizeof(intmax_t);
+                ++f;
+                break;
+            case 't':
+                intSize = sizeof(ptrdiff_t);
+                ++f;
+                break;
+        }
+        if (next >= count) {
+            return false;
+        }
+        const FormatArgKind kind = kinds[next];
+        const size_t size = sizes[next++];
+        switch (*f++) {
+            case 'd': case 'i': case 'u': case 'x': case 'X': case 'o':
+            case 'c':
+                if (kind != FormatArgKind::Int ||
+                    (intSize == sizeof(int) ? size > intSize
+                                            : size != intSize)) {
+                    return false;
+                }
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+                if (kind != FormatArgKind::Float) {
+                    return false;
+                }
+                break;
+            case 's':
+                if (kind != FormatArgKind::String) {
+                    return false;
+                }
+                break;
+            case 'p':
+                if (kind != FormatArgKind::Pointer) {
+                    return false;
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+    return next == count;
+}
+
+template <class... Args>
+constexpr bool checkFormat(const char* format) {
+    constexpr FormatArgKind kinds[] = {formatArgKind<Args>()...,
+                                       FormatArgKind::None};
+    constexpr size_t sizes[] = {formatArgSize<Args>()..., 0};
+    return checkFormat(format, kinds, sizes, sizeof...(Args));
+}
+
+// One argument of a checked format, widened to a few plain types.
+struct FormatArg {
+    union {
+        unsigned long long u;  // Integers, zero-extended from their size.
+        double d;
+        const void* p;
+        const char* s;
+    };
+    size_t len;  // Of |s|.
+};
+
+template <class T,
+          class = typename std::enable_if<std::is_integral<T>::value>::type>
+FormatArg makeFormatArg(T val) {
+    using Promoted = decltype(+val);
+    FormatArg arg;
+    arg.u = static_cast<typename std::make_unsigned<Promoted>::type>(val);
+    return arg;
+}
+
+inline FormatArg makeFormatArg(double val) {
+    FormatArg arg;
+    arg.d = val;
+    return arg;
+}
+
+inline FormatArg makeFormatArg(std::string_view str) {
+    FormatArg arg;
+    arg.s = str.data();
+    arg.len = str.size();
+    return arg;
+}
+
+inline FormatArg makeFormatArg(const std::string& str) {
+    return makeFormatArg(std::string_view(str));
+}
+
+inline FormatArg makeFormatArg(const char* str) {
+    return makeFormatArg(std::string_view(str ? str : "(null)"));
+}
+
+inline FormatArg makeFormatArg(char* str) {
+    return makeFormatArg(static_cast<const char*>(str));
+}
+
+inline FormatArg makeFormatArg(const void* ptr) {
+    FormatArg arg;
+    arg.p = ptr;
+    return arg;
+}
+
+inline FormatArg makeFormatArg(std::nullptr_t) {
+    return makeFormatArg(static_cast<const void*>(nullptr));
+}
+
+// Formats |format| with |args|, already checked against it, into |buffer|.
+void formatArgsTo(SmallVector<char>* buffer,
+                  const char* format,
+                  const FormatArg* args);
+
+}  // namespace internal
+
+// A printf() whose format is checked against the arguments at compile
+// time and which never allocates once |buffer| is big enough. Plain
+// integer, floating point and string conversions are formatted directly
+// with std::to_chars(); ones with flags, width or precision go through
+// snprintf(). |Format| must be a constexpr char array:
+//
+//     static constexpr char kFormat[] = "%s: %d frames";
+//     SmallFixedVector<char, 128> line;
+//     StringFormatTo<kFormat>(&line, name, count);
+//
+template <const char* Format, class... Args>
+void StringFormatTo(SmallVector<char>* buffer, Args&&... args) {
+    static_assert(internal::checkFormat<std::decay_t<Args>...>(Format),
+                  "The format doesn't match the arguments");
+    const internal::FormatArg list[] = {
+            internal::makeFormatArg(std::forward<Args>(args))...,
+            internal::FormatArg()};
+    internal::formatArgsTo(buffer, Format, list);
+}
+
 }  // namespace base
 }  // namespace android
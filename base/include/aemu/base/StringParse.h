@@ -14,46 +14,253 @@
 
 #pragma once
 
-#include "android/utils/compiler.h"
-#include <stdarg.h>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <type_traits>
 
 //
-// This file defines C and C++ replacements for scanf to parse a string in a
-// locale-independent way. This is useful when parsing input data that comes
-// not from user, but from some kind of a fixed protocol with predefined locale
-// settings.
-// Just use these functions as drop-in replacements of sscanf();
+// Locale-independent parsing for text that comes not from a user but from a
+// fixed protocol: /proc files, config values, wire formats. Nothing here
+// allocates or looks at the locale; numbers are read with std::from_chars(),
+// so "1.5" is one and a half whatever LC_NUMERIC says, and no per-call
+// locale switching is needed the way a C-locale sscanf() needs it.
 //
-// Note1: if the input string contains any dot characters other than decimal
-// separators, the results of parsing will be screwed: in Windows the
-// implementation replaces all dots with the current decimal separator to parse
-// using current locale.
-// Note2: current implementation only supports parsing floating point numbers -
-// no code for monetary values, dates, digit grouping etc.
-// The limitation is because of MinGW's lack of per-thread locales support.
+
+namespace android {
+namespace base {
+
+// Reads a number at the start of |*text| and moves |*text| past it. A
+// leading '+' is accepted, as strtol() and strtod() do; leading whitespace
+// is not. Returns false, leaving |*text| alone, if there is no number or it
+// doesn't fit in |T|.
+template <class T>
+bool consumeInt(std::string_view* text, T* out, int base = 10) {
+    static_assert(std::is_integral_v<T> && !std::is_same_v<T, bool>, "integers only");
+    const char* begin = text->data();
+    const char* end = begin + text->size();
+    if (begin != end && *begin == '+') {
+        ++begin;
+        if (begin != end && *begin == '-') {
+            return false;
+        }
+    }
+    const auto res = std::from_chars(begin, end, *out, base);
+    if (res.ec != std::errc()) {
+        return false;
+    }
+    text->remove_prefix(res.ptr - text->data());
+    return true;
+}
+
+bool consumeDouble(std::string_view* text, double* out);
+bool consumeDouble(std::string_view* text, float* out);
+
+// All of |text| as a number, or nullopt.
+template <class T>
+std::optional<T> parseInt(std::string_view text, int base = 10) {
+    T value;
+    if (!consumeInt(&text, &value, base) || !text.empty()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+// Hex digits with an optional 0x or 0X prefix.
+std::optional<uint64_t> parseHex(std::string_view text);
+
+std::optional<double> parseDouble(std::string_view text);
+
+// Splits |text| at any of |delimiters| without copying: each token is a
+// view into |text|. Runs of delimiters count as one unless |skipEmpty| is
+// false, in which case the empty tokens between them are returned too.
 //
+//     Tokenizer tokens(line);
+//     std::string_view token;
+//     while (tokens.next(&token)) { ... }
+class Tokenizer {
+public:
+    explicit Tokenizer(std::string_view text,
+                       std::string_view delimiters = " \t\r\n",
+                       bool skipEmpty = true)
+        : mText(text), mDelimiters(delimiters), mSkipEmpty(skipEmpty) {}
+
+    bool next(std::string_view* token);
+
+    // What next() hasn't returned yet.
+    std::string_view rest() const { return mText.substr(mPos); }
 
-ANDROID_BEGIN_HEADER
+private:
+    std::string_view mText;
+    std::string_view mDelimiters;
+    bool mSkipEmpty;
+    size_t mPos = 0;
+    bool mDone = false;
+};
 
-int SscanfWithCLocale(const char* string, const char* format, ...);
-int SscanfWithCLocaleWithArgs(const char* string, const char* format,
-                              va_list args);
+// A scanf() format, parsed up front; constexpr, so a format in a static
+// constexpr variable is parsed at compile time and scan() only runs it:
+//
+//     static constexpr ScanFormat kFormat("some avg10=%f");
+//     static_assert(kFormat.valid() && kFormat.fields() == 1);
+//     float avg10;
+//     if (scan(line, kFormat, &avg10) == 1) { ... }
+//
+// The subset covers the patterns this tree parses. Whitespace matches any
+// amount of whitespace, including none. Other characters match themselves.
+// Conversions are %d, %i and %u (decimal), %x, %f, %e and %g (any floating
+// point), %c, %s (up to the next whitespace, into a std::string_view), %n
+// and %%. Length modifiers (hh, h, l, ll, j, z, t, L) are accepted and
+// ignored: each conversion reads into the type its argument points to. A
+// '*' after the '%' skips the field.
+class ScanFormat {
+public:
+    static constexpr size_t kMaxOps = 40;
 
-ANDROID_END_HEADER
+    enum class OpKind : uint8_t { kSpace, kLiteral, kField, kSkip };
 
-#ifdef __cplusplus
+    struct Op {
+        OpKind kind = OpKind::kSpace;
+        char conv = 0;
+        // Of the literal in the format, for kLiteral.
+        uint16_t start = 0;
+        uint16_t length = 0;
+    };
 
-#include <utility>
+    constexpr explicit ScanFormat(std::string_view format) : mFormat(format) {
+        size_t i = 0;
+        while (i < format.size() && mValid) {
+            const char c = format[i];
+            if (isSpace(c)) {
+                while (i < format.size() && isSpace(format[i])) ++i;
+                push({OpKind::kSpace});
+            } else if (c == '%' && i + 1 < format.size() && format[i + 1] == '%') {
+                push({OpKind::kLiteral, 0, uint16_t(i + 1), 1});
+                i += 2;
+            } else if (c == '%') {
+                ++i;
+                const bool skip = i < format.size() && format[i] == '*';
+                if (skip) ++i;
+                while (i < format.size() && isLengthModifier(format[i])) ++i;
+                if (i == format.size() || !isConversion(format[i])) {
+                    mValid = false;
+                    break;
+                }
+                push({skip ? OpKind::kSkip : OpKind::kField, format[i]});
+                if (!skip && format[i] != 'n') ++mFields;
+                ++i;
+            } else {
+                const size_t start = i;
+                while (i < format.size() && format[i] != '%' && !isSpace(format[i])) ++i;
+                push({OpKind::kLiteral, 0, uint16_t(start), uint16_t(i - start)});
+            }
+        }
+    }
 
-namespace android {
-namespace base {
+    constexpr bool valid() const { return mValid; }
+    // Conversions that store a value, not counting %n.
+    constexpr size_t fields() const { return mFields; }
+    constexpr size_t size() const { return mSize; }
+    constexpr const Op& op(size_t i) const { return mOps[i]; }
+    constexpr std::string_view literal(const Op& op) const {
+        return mFormat.substr(op.start, op.length);
+    }
 
+    static constexpr bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+private:
+    static constexpr bool isLengthModifier(char c) {
+        return c == 'h' || c == 'l' || c == 'j' || c == 'z' || c == 't' || c == 'L';
+    }
+
+    static constexpr bool isConversion(char c) {
+        return c == 'd' || c == 'i' || c == 'u' || c == 'x' || c == 'X' || c == 'f' ||
+               c == 'e' || c == 'E' || c == 'g' || c == 'G' || c == 'c' || c == 's' ||
+               c == 'n';
+    }
+
+    constexpr void push(Op op) {
+        if (mSize == kMaxOps || mFormat.size() > UINT16_MAX) {
+            mValid = false;
+            return;
+        }
+        mOps[mSize++] = op;
+    }
+
+    std::string_view mFormat;
+    Op mOps[kMaxOps] = {};
+    size_t mSize = 0;
+    size_t mFields = 0;
+    bool mValid = true;
+};
+
+namespace internal {
+
+// Where one conversion stores its value.
+struct ScanSink {
+    void* ptr = nullptr;
+    // Reads conversion |conv| from |*in|, which has |consumed| characters
+    // of the input before it.
+    bool (*read)(std::string_view* in, char conv, size_t consumed, void* ptr) = nullptr;
+};
+
+bool consumeToken(std::string_view* in, std::string_view* out);
+
+template <class T>
+bool readInto(std::string_view* in, char conv, size_t consumed, void* ptr) {
+    T* out = static_cast<T*>(ptr);
+    if constexpr (std::is_same_v<T, std::string_view>) {
+        return conv == 's' && consumeToken(in, out);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        const bool isFloat = conv == 'f' || conv == 'e' || conv == 'E' || conv == 'g' ||
+                             conv == 'G';
+        return isFloat && consumeDouble(in, out);
+    } else {
+        static_assert(std::is_integral_v<T>, "scan() reads numbers, chars and string_views");
+        switch (conv) {
+            case 'n':
+                *out = static_cast<T>(consumed);
+                return true;
+            case 'c':
+                if (in->empty()) return false;
+                *out = static_cast<T>(in->front());
+                in->remove_prefix(1);
+                return true;
+            case 'x':
+            case 'X':
+                return consumeInt(in, out, 16);
+            case 'd':
+            case 'i':
+            case 'u':
+                return consumeInt(in, out, 10);
+            default:
+                return false;
+        }
+    }
+}
+
+int runScan(std::string_view input, const ScanFormat& format, const ScanSink* sinks,
+            size_t count);
+
+}  // namespace internal
+
+// Scans |input| like sscanf(), and returns how many fields were stored. It
+// stops at the first mismatch or at the end of |input|.
 template <class... Args>
-int SscanfWithCLocale(const char* string, const char* format, Args... args) {
-    return ::SscanfWithCLocale(string, format, std::forward<Args>(args)...);
+int scan(std::string_view input, const ScanFormat& format, Args*... args) {
+    const internal::ScanSink sinks[] = {{args, &internal::readInto<Args>}..., {}};
+    return internal::runScan(input, format, sinks, sizeof...(Args));
+}
+
+// The same, parsing |format| on the way.
+template <class... Args>
+int scan(std::string_view input, std::string_view format, Args*... args) {
+    return scan(input, ScanFormat(format), args...);
 }
 
 }  // namespace base
 }  // namespace android
-
-#endif  // __cplusplus
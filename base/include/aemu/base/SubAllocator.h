@@ -53,6 +53,9 @@ public:
 
     bool empty() const;
 
+    // True if |ptr| points into the buffer.
+    bool contains(const void* ptr) const;
+
     // Convenience function to allocate an array
     // of objects of type T.
     template <class T>
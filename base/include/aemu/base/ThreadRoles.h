@@ -0,0 +1,90 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/CpuTime.h"
+
+#include <chrono>
+#include <vector>
+
+#include <inttypes.h>
+
+namespace android {
+namespace base {
+
+// Long-lived threads whose CPU use is attributed to what they do. Each role
+// has its own event codes in Metrics.cpp.
+enum class ThreadRole {
+    kAsgConsumer,    // draining ASG rings: RingPoller shards, render threads
+    kSyncThread,     // signaling guest fences
+    kMediaDecoder,   // MediaDecodeScheduler workers
+    kHealthMonitor,  // HealthMonitor's watchdog thread
+    kCount,
+};
+
+const char* threadRoleName(ThreadRole role);
+
+struct TaggedThread;
+
+// Tags the calling thread with |role| for as long as it lives. Must be
+// destroyed on the thread that created it; what the thread used until then
+// keeps counting towards its role.
+class ScopedThreadRole {
+    DISALLOW_COPY_ASSIGN_AND_MOVE(ScopedThreadRole);
+
+public:
+    explicit ScopedThreadRole(ThreadRole role);
+    ~ScopedThreadRole();
+
+private:
+    TaggedThread* mThread;
+};
+
+// What the threads of one role did over a sampling interval.
+struct ThreadRoleUsage {
+    ThreadRole role;
+    // Threads holding a ScopedThreadRole at the end of the interval.
+    int threads = 0;
+    // Summed over the role's threads, with wall_time_us the interval, so
+    // cpu.usage() is in cores: 2 means two cores busy throughout.
+    CpuTime cpu;
+    // Voluntary context switches: each is a block, and a wakeup after it.
+    // Linux only; zero elsewhere.
+    uint64_t wakeups = 0;
+    // Involuntary context switches, i.e. preemptions. Linux only.
+    uint64_t preemptions = 0;
+
+    float perSecond(uint64_t count) const {
+        return cpu.wall_time_us ? count * 1e6f / cpu.wall_time_us : 0.0f;
+    }
+};
+
+// Every role's usage since the previous call; the first call covers the
+// time since the process started tagging threads.
+std::vector<ThreadRoleUsage> sampleThreadRoles();
+
+// Logs a MetricEventThreadRoleUsage for each role that had threads over
+// the interval since the last report.
+void reportThreadRoleUsage();
+
+// Calls reportThreadRoleUsage() every |period| on a thread of its own, until
+// stopThreadRoleReporting(). Starting again changes the period.
+void startThreadRoleReporting(std::chrono::milliseconds period);
+void stopThreadRoleReporting();
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,63 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/Backtrace.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace base {
+
+// Samples the stack of another thread at a fixed interval, to see where a
+// stuck thread spends its time.
+//
+// On Linux the target is interrupted with a real-time signal whose handler
+// records its stack; on Windows it is suspended and its stack walked from
+// GetThreadContext(). Elsewhere nothing can be sampled. The target must
+// stay alive while it is being sampled. Only one thread is sampled at a
+// time per process.
+struct SampledStack {
+    StackId stack = kInvalidStackId;
+    uint32_t samples = 0;
+};
+
+struct ThreadStackSamples {
+    uint32_t requested = 0;
+    // Samples that recorded a stack; the others timed out or failed.
+    uint32_t taken = 0;
+    // Distinct stacks, most often seen first.
+    std::vector<SampledStack> stacks;
+};
+
+bool threadSamplingSupported();
+
+// Takes |samples| samples of the thread |threadId|, as returned by
+// getCurrentThreadId() on that thread, |intervalUs| apart.
+ThreadStackSamples sampleThreadStacks(unsigned long threadId,
+                                      uint32_t samples,
+                                      uint64_t intervalUs);
+
+// "<taken>/<requested> samples", then for each of the |maxStacks| hottest
+// stacks a "<n> samples:" line followed by formatStack().
+std::string formatThreadStackSamples(const ThreadStackSamples& samples,
+                                     size_t maxStacks = 3);
+
+}  // namespace base
+}  // namespace android
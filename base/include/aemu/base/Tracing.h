@@ -15,6 +15,9 @@
 #pragma once
 
 #include <inttypes.h>
+#include <stddef.h>
+
+#include <string>
 
 #if defined(AEMU_TRACING_SHARED) && defined(_MSC_VER)
 #if defined(TRACING_EXPORTS)
@@ -60,6 +63,75 @@ TRACING_API void traceCounter(const char* tag, int64_t value);
 TRACING_API void beginTrace(const char* name);
 TRACING_API void endTrace();
 
+// Without perfetto, traces are kept in memory: each thread keeps its last
+// kTraceRingEvents events while tracing is enabled. Names are stored as
+// pointers, so they must outlive the trace (string literals, __func__).
+constexpr size_t kTraceRingEvents = 16384;
+
+// Returns the recorded events in the Chrome trace event format, which
+// chrome://tracing and the Perfetto UI load. Empty with perfetto, which
+// keeps its own buffers.
+TRACING_API std::string traceJson();
+// Writes traceJson() to |path|; returns false on failure.
+TRACING_API bool writeTraceJson(const char* path);
+// Drops everything recorded so far.
+TRACING_API void clearTrace();
+
+// Guest/host correlation, for the built-in recorder; no-ops with perfetto.
+//
+// Guest spans arrive with guest timestamps. traceJson() puts them on the
+// host timeline, as pid 2 next to the host's pid 1, using clock samples
+// the guest sends through the address space device (see ASG_CLOCK_SYNC).
+// Flow events then connect a guest span to the host work it caused.
+
+// The clock host events are recorded with.
+TRACING_API uint64_t traceTimeNs();
+
+// The guest read its clock at |guestBeforeNs|, the host read traceTimeNs()
+// as |hostNs|, and the guest read its clock again at |guestAfterNs|. The
+// sample with the shortest round trip sets the offset; the drift comes
+// from the best ones of older and newer samples.
+TRACING_API void addGuestClockSample(uint64_t guestBeforeNs,
+                                     uint64_t hostNs,
+                                     uint64_t guestAfterNs);
+// |guestNs| in traceTimeNs(); as is without clock samples.
+TRACING_API uint64_t guestToHostTraceNs(uint64_t guestNs);
+
+// Flow ids are unique within a domain, and shared by both sides.
+enum class TraceFlowDomain : uint8_t {
+    kAsgTransfer = 1,  // the guest's to_host ring write position
+    kPipe = 2,         // the pipe's id
+};
+constexpr uint64_t traceFlowId(TraceFlowDomain domain, uint64_t id) {
+    return (uint64_t(domain) << 56) | (id & ((uint64_t(1) << 56) - 1));
+}
+
+// Starts or ends flow |id| in the innermost slice of the calling thread.
+TRACING_API void traceFlowBegin(uint64_t id);
+TRACING_API void traceFlowEnd(uint64_t id);
+
+// The last kGuestTraceSpans guest spans are kept.
+constexpr size_t kGuestTraceSpans = 16384;
+
+struct GuestTraceSpan {
+    std::string name;
+    uint32_t tid;
+    uint64_t beginNs;  // guest clock
+    uint64_t endNs;
+    // Started at the end of the span, if not 0.
+    uint64_t flowId;
+};
+TRACING_API void addGuestTraceSpan(GuestTraceSpan span);
+
+// Parses guest spans sent as a sequence of little-endian records:
+//
+//     uint32_t nameSize, tid
+//     uint64_t beginNs, endNs, flowId
+//     char name[nameSize]
+//
+// and adds them. Returns how many were; a truncated record ends it.
+TRACING_API size_t importGuestTraceSpans(const void* data, size_t size);
+
 class TRACING_API ScopedTrace {
 public:
     ScopedTrace(const char* name);
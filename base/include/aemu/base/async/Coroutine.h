@@ -0,0 +1,464 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// C++20 coroutines on top of Looper, for code that would otherwise be a
+// chain of callbacks or a thread blocking per connection:
+//
+//      CoTask<void> serve(Looper* looper, AsyncSocketAdapter* socket) {
+//          CoSocket conn(socket);
+//          char buf[512];
+//          ssize_t n;
+//          while ((n = co_await conn.read(buf)) > 0) {
+//              conn.send({buf, size_t(n)});
+//              co_await coSleep(looper, 10);
+//          }
+//      }
+//
+//      CoScheduler scheduler(looper);
+//      scheduler.spawn(serve(looper, socket));
+//
+// Coroutines spawned on a CoScheduler run on its looper's thread, a few
+// hundred bytes of frame each instead of a thread. Awaiting never blocks
+// that thread; everything is resumed from looper timers, socket events or
+// the scheduler's task.
+//
+// The rest of base is C++17, so all of this is only there when including
+// code is built as C++20 (AEMU_BASE_HAS_COROUTINES).
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define AEMU_BASE_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifndef AEMU_BASE_HAS_COROUTINES
+#define AEMU_BASE_HAS_COROUTINES 0
+#endif
+
+#if AEMU_BASE_HAS_COROUTINES
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/async/AsyncSocketAdapter.h"
+#include "aemu/base/async/Looper.h"
+#include "aemu/base/ring_buffer.h"
+#include "aemu/base/synchronization/Lock.h"
+
+#include <errno.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <span>
+#include <unordered_set>
+#include <utility>
+
+namespace android {
+namespace base {
+
+class CoScheduler;
+template <class T = void>
+class CoTask;
+
+namespace internal {
+
+struct CoPromiseBase {
+    // Who co_awaits this task, resumed when it finishes.
+    std::coroutine_handle<> continuation;
+    // Set for tasks spawned on a scheduler, which frees them when done.
+    CoScheduler* scheduler = nullptr;
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <class Promise>
+        std::coroutine_handle<> await_suspend(
+                std::coroutine_handle<Promise> handle) noexcept;
+        void await_resume() noexcept {}
+    };
+
+    // Tasks are lazy: nothing runs until they are awaited or spawned.
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { std::terminate(); }
+};
+
+template <class T>
+struct CoPromise : CoPromiseBase {
+    std::optional<T> value;
+    void return_value(T v) { value.emplace(std::move(v)); }
+    T take() { return std::move(*value); }
+};
+
+template <>
+struct CoPromise<void> : CoPromiseBase {
+    void return_void() {}
+    void take() {}
+};
+
+}  // namespace internal
+
+// A coroutine returning T. Awaiting it runs it to completion and yields
+// its co_return value; destroying it before then destroys the coroutine.
+template <class T>
+class CoTask {
+public:
+    struct promise_type : internal::CoPromise<T> {
+        CoTask get_return_object() {
+            return CoTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
+    using Handle = std::coroutine_handle<promise_type>;
+
+    CoTask(CoTask&& other) noexcept : mHandle(std::exchange(other.mHandle, {})) {}
+    CoTask& operator=(CoTask&& other) noexcept {
+        if (this != &other) {
+            reset();
+            mHandle = std::exchange(other.mHandle, {});
+        }
+        return *this;
+    }
+    ~CoTask() { reset(); }
+
+    bool done() const { return !mHandle || mHandle.done(); }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        mHandle.promise().continuation = awaiting;
+        return mHandle;
+    }
+    T await_resume() { return mHandle.promise().take(); }
+
+private:
+    friend class CoScheduler;
+    DISALLOW_COPY_AND_ASSIGN(CoTask);
+
+    explicit CoTask(Handle handle) : mHandle(handle) {}
+
+    Handle release() { return std::exchange(mHandle, {}); }
+    void reset() {
+        if (mHandle) {
+            mHandle.destroy();
+            mHandle = {};
+        }
+    }
+
+    Handle mHandle;
+};
+
+// Runs CoTask<void>s on the thread of |looper|. spawn() may be called from
+// any thread; the tasks themselves only ever run on the looper thread.
+// Destroying the scheduler, on the looper thread, destroys the tasks that
+// haven't finished, along with whatever they were waiting on.
+class CoScheduler {
+public:
+    explicit CoScheduler(Looper* looper)
+        : mLooper(looper), mTask(looper->createTask([this] { runReady(); })) {}
+
+    ~CoScheduler() {
+        mTask.reset();
+        for (void* address : mTasks) {
+            std::coroutine_handle<>::from_address(address).destroy();
+        }
+    }
+
+    Looper* looper() const { return mLooper; }
+
+    // Starts |task| on the next looper iteration.
+    void spawn(CoTask<void> task) {
+        auto handle = task.release();
+        handle.promise().scheduler = this;
+        AutoLock lock(mLock);
+        mTasks.insert(handle.address());
+        mReady.push_back(handle);
+        lock.unlock();
+        mTask->schedule();
+    }
+
+    // Unfinished spawned tasks.
+    size_t liveTasks() const {
+        AutoLock lock(mLock);
+        return mTasks.size();
+    }
+
+    // co_await scheduler.yield() lets the other ready tasks and looper
+    // events run before continuing, on the looper thread.
+    auto yield() {
+        struct Awaiter {
+            CoScheduler* scheduler;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) {
+                AutoLock lock(scheduler->mLock);
+                scheduler->mReady.push_back(handle);
+                lock.unlock();
+                scheduler->mTask->schedule();
+            }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{this};
+    }
+
+private:
+    friend struct internal::CoPromiseBase::FinalAwaiter;
+    DISALLOW_COPY_AND_ASSIGN(CoScheduler);
+
+    void runReady() {
+        AutoLock lock(mLock);
+        std::deque<std::coroutine_handle<>> ready;
+        ready.swap(mReady);
+        lock.unlock();
+        for (auto handle : ready) {
+            handle.resume();
+        }
+    }
+
+    // Called from the final suspend point of a spawned task.
+    void finished(std::coroutine_handle<> handle) {
+        AutoLock lock(mLock);
+        mTasks.erase(handle.address());
+        lock.unlock();
+        handle.destroy();
+    }
+
+    Looper* const mLooper;
+    Looper::TaskPtr mTask;
+    mutable Lock mLock;
+    std::unordered_set<void*> mTasks;
+    std::deque<std::coroutine_handle<>> mReady;
+};
+
+template <class Promise>
+std::coroutine_handle<> internal::CoPromiseBase::FinalAwaiter::await_suspend(
+        std::coroutine_handle<Promise> handle) noexcept {
+    CoPromiseBase& promise = handle.promise();
+    if (promise.continuation) {
+        return promise.continuation;
+    }
+    if (promise.scheduler) {
+        // The frame is suspended for good, so it can go now.
+        promise.scheduler->finished(handle);
+    }
+    return std::noop_coroutine();
+}
+
+// co_await coSleep(looper, ms) resumes after |ms| milliseconds of |clock|,
+// from a timer on |looper|.
+class CoSleep {
+public:
+    CoSleep(Looper* looper,
+            Looper::Duration ms,
+            Looper::ClockType clock = Looper::ClockType::kHost)
+        : mLooper(looper), mMs(ms), mClock(clock) {}
+
+    bool await_ready() const noexcept { return mMs <= 0; }
+    void await_suspend(std::coroutine_handle<> handle) {
+        mHandle = handle;
+        mTimer.reset(mLooper->createTimer(&CoSleep::onTimer, this, mClock));
+        mTimer->startRelative(mMs);
+    }
+    void await_resume() noexcept {}
+
+private:
+    static void onTimer(void* opaque, Looper::Timer*) {
+        static_cast<CoSleep*>(opaque)->mHandle.resume();
+    }
+
+    Looper* const mLooper;
+    const Looper::Duration mMs;
+    const Looper::ClockType mClock;
+    std::coroutine_handle<> mHandle;
+    // Owned here so that destroying a sleeping coroutine stops its timer.
+    std::unique_ptr<Looper::Timer> mTimer;
+};
+
+inline CoSleep coSleep(Looper* looper, Looper::Duration ms) {
+    return CoSleep(looper, ms);
+}
+
+// Awaitable reads from an AsyncSocketAdapter, for one coroutine at a time.
+// Takes over the socket's event listener while it exists.
+class CoSocket : public AsyncSocketEventListener {
+public:
+    class ReadAwaiter {
+    public:
+        ReadAwaiter(CoSocket* socket, std::span<char> buffer)
+            : mSocket(socket), mBuffer(buffer) {}
+        ~ReadAwaiter() {
+            if (mSocket->mReader == this) {
+                mSocket->mReader = nullptr;
+            }
+        }
+
+        bool await_ready() { return tryRead(); }
+        void await_suspend(std::coroutine_handle<> handle) {
+            mHandle = handle;
+            mSocket->mReader = this;
+        }
+        // Bytes read, 0 once the peer has closed, or -1 on error.
+        ssize_t await_resume() const noexcept { return mResult; }
+
+    private:
+        friend class CoSocket;
+
+        // False if there is nothing to read yet.
+        bool tryRead() {
+            if (mBuffer.empty()) {
+                mResult = 0;
+                return true;
+            }
+            const ssize_t n = mSocket->mSocket->recv(mBuffer.data(), mBuffer.size());
+            if (n > 0) {
+                mResult = n;
+                return true;
+            }
+            if (mSocket->mClosed) {
+                mResult = mSocket->mError ? -1 : 0;
+                return true;
+            }
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                mResult = -1;
+                return true;
+            }
+            // Nothing yet; a peer that closed shows up through onClose().
+            return false;
+        }
+
+        CoSocket* const mSocket;
+        const std::span<char> mBuffer;
+        std::coroutine_handle<> mHandle;
+        ssize_t mResult = 0;
+    };
+
+    explicit CoSocket(AsyncSocketAdapter* socket) : mSocket(socket) {
+        mSocket->setSocketEventListener(this);
+    }
+    ~CoSocket() override { mSocket->setSocketEventListener(nullptr); }
+
+    // co_await read(buffer) waits until some bytes are available and reads
+    // at most buffer.size() of them.
+    ReadAwaiter read(std::span<char> buffer) { return ReadAwaiter(this, buffer); }
+
+    // Sends are queued by the socket and don't block.
+    ssize_t send(std::span<const char> data) {
+        return mSocket->send(data.data(), data.size());
+    }
+
+    bool closed() const { return mClosed; }
+
+    void onRead(AsyncSocketAdapter*) override { wakeReader(); }
+    void onClose(AsyncSocketAdapter*, int err) override {
+        mClosed = true;
+        mError = err;
+        wakeReader();
+    }
+    void onConnected(AsyncSocketAdapter*) override {}
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CoSocket);
+
+    void wakeReader() {
+        ReadAwaiter* reader = mReader;
+        if (reader && reader->tryRead()) {
+            mReader = nullptr;
+            reader->mHandle.resume();
+        }
+    }
+
+    AsyncSocketAdapter* const mSocket;
+    ReadAwaiter* mReader = nullptr;
+    bool mClosed = false;
+    int mError = 0;
+};
+
+// co_await CoRingWait(...) resumes once |bytes| can be read from (or
+// written to) the ring |r|, with view |v| or null for the ring's own
+// buffer, as ring_buffer_wait_read/write would report.
+//
+// A looper thread can't park on the ring the way ring_buffer_wait_* does,
+// so this polls from a looper timer instead. That is the latency of the
+// ring's wait protocol towards peers that don't wake parked waiters: at
+// most RING_BUFFER_MAX_PARK_US, rounded up to the looper's millisecond
+// timers. Idle rings cost a timer per waiting coroutine, not a thread.
+class CoRingWait {
+public:
+    enum class Direction { kRead, kWrite };
+
+    CoRingWait(Looper* looper,
+               const ring_buffer* r,
+               const ring_buffer_view* v,
+               uint32_t bytes,
+               Direction direction)
+        : mLooper(looper), mRing(r), mView(v), mBytes(bytes), mDirection(direction) {}
+
+    bool await_ready() const { return ready(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+        mHandle = handle;
+        mTimer.reset(mLooper->createTimer(&CoRingWait::onTimer, this));
+        mTimer->startRelative(kPollMs);
+    }
+    void await_resume() noexcept {}
+
+private:
+    static constexpr Looper::Duration kPollMs =
+            std::max<Looper::Duration>(1, RING_BUFFER_MAX_PARK_US / 1000);
+
+    bool ready() const {
+        if (mDirection == Direction::kRead) {
+            return mView ? ring_buffer_view_can_read(mRing, mView, mBytes)
+                         : ring_buffer_can_read(mRing, mBytes);
+        }
+        return mView ? ring_buffer_view_can_write(mRing, mView, mBytes)
+                     : ring_buffer_can_write(mRing, mBytes);
+    }
+
+    static void onTimer(void* opaque, Looper::Timer* timer) {
+        auto self = static_cast<CoRingWait*>(opaque);
+        if (self->ready()) {
+            self->mHandle.resume();
+        } else {
+            timer->startRelative(kPollMs);
+        }
+    }
+
+    Looper* const mLooper;
+    const ring_buffer* const mRing;
+    const ring_buffer_view* const mView;
+    const uint32_t mBytes;
+    const Direction mDirection;
+    std::coroutine_handle<> mHandle;
+    std::unique_ptr<Looper::Timer> mTimer;
+};
+
+inline CoRingWait coRingReadable(Looper* looper,
+                                 const ring_buffer* r,
+                                 const ring_buffer_view* v,
+                                 uint32_t bytes) {
+    return CoRingWait(looper, r, v, bytes, CoRingWait::Direction::kRead);
+}
+
+inline CoRingWait coRingWritable(Looper* looper,
+                                 const ring_buffer* r,
+                                 const ring_buffer_view* v,
+                                 uint32_t bytes) {
+    return CoRingWait(looper, r, v, bytes, CoRingWait::Direction::kWrite);
+}
+
+}  // namespace base
+}  // namespace android
+
+#endif  // AEMU_BASE_HAS_COROUTINES
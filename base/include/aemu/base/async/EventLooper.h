@@ -0,0 +1,140 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/async/Looper.h"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+namespace android {
+namespace base {
+
+// Looper implementation on top of the platform's readiness notification
+// (edge-triggered epoll on Linux, EV_CLEAR kqueue on macOS, WSAPoll on
+// Windows) instead of select(), so it is not limited to FD_SETSIZE and
+// does not rescan every watched descriptor on each iteration.
+//
+// Descriptors are registered with the kernel once for both directions and
+// the wanted events only live in the FdWatch, so addEvents() and
+// removeEvents() are O(1) and make no system call. Readiness reported by
+// the kernel is remembered per watch, and after a callback the fired
+// events are re-probed, so callbacks see the usual level-triggered
+// behavior and do not have to drain the descriptor.
+//
+// Timers are kept in a hierarchical timer wheel per clock type, with O(1)
+// start and stop. A timer with slack (Timer::setSlackMs()) expires on the
+// next multiple of the largest power of two within its slack, so timers
+// with similar tolerance share wakeups. Tasks may be scheduled from any
+// thread and wake the loop. Create one with Looper::create().
+class EventLooper : public Looper {
+public:
+    EventLooper();
+    ~EventLooper() override;
+
+    std::string_view name() const override { return "Event"; }
+
+    bool onLooperThread() const override;
+
+    Duration nowMs(ClockType clockType = ClockType::kHost) override;
+    DurationNs nowNs(ClockType clockType = ClockType::kHost) override;
+
+    void forceQuit() override;
+
+    Looper::FdWatch* createFdWatch(int fd,
+                                   Looper::FdWatch::Callback callback,
+                                   void* opaque) override;
+
+    Looper::Timer* createTimer(Looper::Timer::Callback callback,
+                               void* opaque,
+                               ClockType clock) override;
+
+    TaskPtr createTask(TaskCallback&& callback) override;
+    void scheduleCallback(TaskCallback&& callback) override;
+
+    int runWithDeadlineMs(Duration deadlineMs) override;
+
+    // Name of the kernel interface in use, for logging.
+    static const char* backendName();
+
+    // Counters for judging how often the loop wakes up and how late timers
+    // fire. Only read them on the looper thread.
+    struct TimerStats {
+        // Host time at which counting started.
+        Duration sinceMs = 0;
+        // Loop iterations that went to sleep, i.e. had nothing already due.
+        uint64_t wakeups = 0;
+        uint64_t timersFired = 0;
+        // Time between each timer's requested deadline and its callback.
+        Duration totalLatenessMs = 0;
+        Duration maxLatenessMs = 0;
+
+        double wakeupsPerSecond(Duration nowMs) const {
+            return nowMs > sinceMs ? wakeups * 1000.0 / (nowMs - sinceMs) : 0;
+        }
+    };
+
+    TimerStats timerStats() const { return mTimerStats; }
+    void resetTimerStats();
+
+protected:
+    // Run a single iteration, waiting no later than |deadlineMs|. Returns
+    // false when there is nothing left to wait for.
+    bool runOneIterationWithDeadlineMs(Duration deadlineMs);
+
+private:
+    class FdWatch;
+    class Timer;
+    class Task;
+    class TimerWheel;
+    struct Poller;
+
+    void queueFdWatch(FdWatch* watch);
+    void unqueueFdWatch(FdWatch* watch);
+    void fireFdWatches();
+    void fireTimers();
+    void runTasks();
+    // Milliseconds until the earliest timer in any clock is due.
+    Duration nextTimerDelayMs();
+
+    std::unique_ptr<Poller> mPoller;
+    std::unique_ptr<TimerWheel> mWheels[3];
+    size_t mFdWatchCount = 0;
+
+    // Watches with wanted events ready, fired in order. Intrusive, so a
+    // callback may delete any watch, including another queued one.
+    FdWatch* mPendingHead = nullptr;
+    FdWatch* mPendingTail = nullptr;
+    // The watch whose callback is running, cleared if it gets deleted.
+    FdWatch* mFiring = nullptr;
+    // Bumped on each firing pass; watches queued during the pass carry the
+    // new value and wait for the next iteration.
+    uint64_t mFireGeneration = 0;
+
+    std::mutex mTasksLock;
+    std::deque<Task*> mScheduledTasks;
+
+    TimerStats mTimerStats;
+
+    bool mForcedExit = false;
+    std::thread::id mThreadId;
+};
+
+}  // namespace base
+}  // namespace android
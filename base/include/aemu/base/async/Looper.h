@@ -126,6 +126,14 @@ public:
         // Returns true iff this timer is active.
         virtual bool isActive() const = 0;
 
+        // Allows the timer to fire up to |slackMs| milliseconds after its
+        // deadline, so that the looper can expire it together with other
+        // timers instead of waking up just for it. Takes effect on the next
+        // start. The default of 0 fires as close to the deadline as the
+        // looper can; loopers without coalescing ignore it.
+        void setSlackMs(Duration slackMs);
+        Duration slackMs() const { return mSlackMs; }
+
         // Serialization to/from streams
         virtual void save(android::base::Stream* stream) const = 0;
         virtual void load(android::base::Stream* stream) = 0;
@@ -138,6 +146,7 @@ public:
         Callback mCallback;
         void* mOpaque;
         ClockType mClockType;
+        Duration mSlackMs = 0;
     };
 
     // Create a new timer for this Looper instance.
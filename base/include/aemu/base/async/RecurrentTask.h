@@ -112,6 +112,17 @@ class RecurrentTask {
         stopAsync();
     }
 
+    /**
+     * @brief Lets each run start up to |slack| late, so that the looper can
+     *        coalesce it with other timers. Applies from the next run.
+     *
+     * @param slack How late a run may start; 0 (the default) means on time.
+     */
+    void setSlack(std::chrono::milliseconds slack) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTimer->setSlackMs(slack.count());
+    }
+
     /**
      * @brief Checks if the task is currently in flight (scheduled or running).
      *
@@ -190,6 +201,8 @@ class SimpleRecurrentTask {
      *        the task.
      * @param interval The interval between successive executions of the task.
      * @param initialDelay The delay before the first execution.
+     * @param slack How late each execution may start so that the looper can
+     *        coalesce it with other timers; see RecurrentTask::setSlack().
      *
      * @note The task will keep running until the provided task function
      *       returns false.
@@ -206,16 +219,19 @@ class SimpleRecurrentTask {
      */
     static void schedule(Looper* looper, RecurrentTask::TaskFunction function,
                          std::chrono::milliseconds interval,
-                         std::chrono::milliseconds initialDelay = std::chrono::milliseconds(0)) {
-        new SimpleRecurrentTask(looper, function, interval, initialDelay);
+                         std::chrono::milliseconds initialDelay = std::chrono::milliseconds(0),
+                         std::chrono::milliseconds slack = std::chrono::milliseconds(0)) {
+        new SimpleRecurrentTask(looper, function, interval, initialDelay, slack);
     }
 
    private:
     SimpleRecurrentTask(Looper* looper, RecurrentTask::TaskFunction function,
-                        std::chrono::milliseconds interval, std::chrono::milliseconds initialDelay)
+                        std::chrono::milliseconds interval, std::chrono::milliseconds initialDelay,
+                        std::chrono::milliseconds slack)
         : mTimer(looper->createTimer(&SimpleRecurrentTask::taskCallback, this)),
           mTaskInterval(interval),
           mFunction(std::move(function)) {
+        mTimer->setSlackMs(slack.count());
         mTimer->startRelative(initialDelay.count());
     }
 
@@ -0,0 +1,92 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "aemu/base/async/AsyncSocketServer.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace android {
+namespace base {
+
+class Looper;
+
+// An AsyncSocketServer that spreads its connections over several loopers,
+// each usually running on its own thread, for servers that take hundreds of
+// connections in bursts, like the console or the gRPC bridge under test
+// automation.
+//
+// On Linux, every looper (shard) gets its own listening socket bound to the
+// same port with SO_REUSEPORT, and accepts on its own thread; the kernel
+// spreads incoming connections across them. A shard that ends up with more
+// than kRebalanceSlack connections above the least loaded one hands new ones
+// over. Elsewhere (SO_REUSEPORT on macOS and the BSDs doesn't spread TCP
+// connections), or if |reusePort| is false, the first looper accepts every
+// connection and hands each to the shard with the fewest live connections.
+//
+// Unlike other AsyncSocketServers, it keeps listening while it calls back.
+// The callback runs on the thread of the looper the connection is assigned
+// to, and gets that looper, so it may run on several threads at once.
+// AsyncSockets for the connection should be created on that looper. Call
+// connectionClosed() with it when the connection ends, so that assignment
+// follows load.
+//
+// The loopers must outlive the server, and keep running until it is
+// destroyed: listening sockets are watched and released on their threads.
+class ShardedSocketServer : public AsyncSocketServer {
+public:
+    // Like ConnectCallback. On failure, the server closes the socket.
+    using ShardedConnectCallback = std::function<bool(int socket, Looper* looper)>;
+
+    static constexpr int kRebalanceSlack = 4;
+
+    // Binds to TCP loopback |port| (0 for any free one) on the interfaces of
+    // |mode|, and assigns connections across |loopers|. Returns an empty
+    // std::unique_ptr<> on error.
+    static std::unique_ptr<ShardedSocketServer> create(
+            int port,
+            ShardedConnectCallback connectCallback,
+            std::vector<Looper*> loopers,
+            LoopbackMode mode = kIPv4AndIPv6,
+            bool reusePort = true);
+
+    ~ShardedSocketServer() override;
+
+    int port() const override;
+    void startListening() override;
+    void stopListening() override;
+    LoopbackMode getListenMode() const override;
+
+    // Whether every shard accepts for itself.
+    bool reusePort() const;
+
+    // Tells the server that a connection handed to |looper| has ended.
+    void connectionClosed(Looper* looper);
+
+    // Live connections per shard, in |loopers| order.
+    std::vector<int> load() const;
+
+    struct State;
+
+private:
+    explicit ShardedSocketServer(std::shared_ptr<State> state);
+
+    std::shared_ptr<State> mState;
+};
+
+}  // namespace base
+}  // namespace android
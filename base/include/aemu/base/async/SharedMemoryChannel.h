@@ -0,0 +1,133 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/memory/SharedMemory.h"
+#include "aemu/base/ring_buffer.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+namespace base {
+
+// A duplex byte channel between two processes on the same host, over one
+// SharedMemory region holding a ring_buffer for each direction. Bulk data
+// such as screenshots or recording frames then moves with one copy in and
+// one out, and no syscall while both sides keep up.
+//
+// The rings run in RING_BUFFER_WAIT_BLOCKING mode, so their positions are
+// the doorbell: a waiting side is parked on the position the other side
+// advances and woken by it (a shared futex on Linux). Where the platform
+// can only wake within a process, parking times out after
+// RING_BUFFER_MAX_PARK_US and waiting still works, just with that much
+// added latency.
+//
+// Typical use negotiates the region over an existing socket:
+//
+//   // Emulator side:
+//   auto channel = SharedMemoryChannel::create("aemu-shm-1234-5");
+//   socket->send(channel->offer());
+//
+//   // Companion side, on receiving |offer|:
+//   auto channel = SharedMemoryChannel::acceptOffer(offer);
+//
+// Each side must only be used by one thread at a time.
+class SharedMemoryChannel {
+public:
+    static constexpr uint32_t kDefaultRingSize = 1 << 20;
+
+    ~SharedMemoryChannel();
+
+    // Creates region |name| with two rings of |ringSize| bytes, rounded up
+    // to a power of two. Returns null if the region can't be created.
+    static std::unique_ptr<SharedMemoryChannel> create(
+            const std::string& name,
+            uint32_t ringSize = kDefaultRingSize,
+            mode_t mode = 0600);
+
+    // Opens the other end of a region made by create(). Returns null if it
+    // doesn't exist or doesn't hold a channel with that ring size.
+    static std::unique_ptr<SharedMemoryChannel> open(const std::string& name,
+                                                     uint32_t ringSize);
+
+    // A single line that describes this channel to acceptOffer().
+    std::string offer() const;
+    // Opens the channel |offer| describes, or returns null if it isn't an
+    // offer or the channel can't be opened.
+    static std::unique_ptr<SharedMemoryChannel> acceptOffer(
+            std::string_view offer);
+
+    // Copies in as much of |data| as fits without waiting. Returns the
+    // number of bytes written, 0 if the ring is full, or -1 once either
+    // side has closed.
+    ssize_t write(const void* data, size_t size);
+    // Writes all of |data|, waiting for room as needed. Returns false if
+    // either side closed first.
+    bool writeFully(const void* data, size_t size);
+
+    // Copies out up to |size| bytes without waiting. Returns the number of
+    // bytes read, or 0 when there is nothing to read; peerClosed() tells
+    // whether more can still come.
+    ssize_t read(void* data, size_t size);
+
+    // Wait up to |timeoutUs| for data to read, or room to write. Both also
+    // return true as soon as either side has closed.
+    bool waitReadable(uint64_t timeoutUs);
+    bool waitWritable(uint64_t timeoutUs);
+
+    size_t readableBytes() const;
+
+    // Tells the peer this side is done; pending data can still be read.
+    void close();
+    bool closed() const;
+    bool peerClosed() const;
+
+    const std::string& name() const { return mName; }
+    uint32_t ringSize() const { return mRingSize; }
+
+private:
+    struct Header;
+
+    SharedMemoryChannel(const std::string& name,
+                        uint32_t ringSize,
+                        bool creator);
+
+    static size_t regionSize(uint32_t ringSize);
+    void attach(bool initialize);
+    bool waitFor(uint64_t timeoutUs, bool forRead);
+
+    std::string mName;
+    uint32_t mRingSize;
+    SharedMemory mMemory;
+    // Which of the two close flags is ours.
+    const int mSide;
+    Header* mHeader = nullptr;
+    ring_buffer* mTx = nullptr;
+    ring_buffer* mRx = nullptr;
+    ring_buffer_view mTxView = {};
+    ring_buffer_view mRxView = {};
+
+    DISALLOW_COPY_AND_ASSIGN(SharedMemoryChannel);
+};
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,71 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/async/AsyncSocketAdapter.h"
+#include "aemu/base/async/SharedMemoryChannel.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace android {
+namespace base {
+
+// An AsyncSocketAdapter over a SharedMemoryChannel, for peers on the same
+// host that have negotiated one (see SharedMemoryChannel.h). Code written
+// against AsyncSocketAdapter, such as SimpleAsyncSocket, works unchanged.
+//
+// A reader thread waits on the channel and delivers onRead() while data is
+// available, and onClose() once the peer has closed and everything it sent
+// has been read. There is nothing to reconnect to, so connect() only
+// reports whether the channel is still open.
+class SharedMemorySocket : public AsyncSocketAdapter {
+public:
+    explicit SharedMemorySocket(std::unique_ptr<SharedMemoryChannel> channel);
+    ~SharedMemorySocket();
+
+    // Returns what is available without waiting: the number of bytes read,
+    // -1 with errno EAGAIN if there is nothing yet, or 0 once the peer has
+    // closed and everything it sent has been read.
+    ssize_t recv(char* buffer, uint64_t bufferSize) override;
+    // Copies all of |buffer| into the channel, waiting for the peer to make
+    // room if needed. Returns |bufferSize|, or -1 if the channel closed.
+    ssize_t send(const char* buffer, uint64_t bufferSize) override;
+    void close() override;
+    bool connected() override;
+    bool connect() override;
+    bool connectSync(std::chrono::milliseconds timeout) override;
+    void dispose() override;
+
+    SharedMemoryChannel* channel() { return mChannel.get(); }
+
+private:
+    void readerLoop();
+    void notifyClosed();
+
+    std::unique_ptr<SharedMemoryChannel> mChannel;
+    std::atomic<bool> mStop{false};
+    std::atomic<bool> mCloseNotified{false};
+    // Held while a callback runs, so that dispose() can wait them out.
+    std::recursive_mutex mListenerLock;
+    std::thread mReader;
+};
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,118 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/memory/SharedMemory.h"
+#include "aemu/base/ring_buffer.h"
+
+#include <memory>
+#include <string>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+namespace base {
+
+// A one-way byte channel from a producer process to a consumer process, over
+// one SharedMemory region holding a ring_buffer and its data. It is meant for
+// handing heavy work (decoding, rendering) to a helper process without
+// copying it through a socket.
+//
+// The two sides follow the ring_buffer sync protocol: the producer acquires
+// the ring for each send(), and a consumer that found nothing to read for a
+// while hangs up and goes to sleep on a doorbell. Only a producer that
+// acquires the ring from a hung up consumer rings the doorbell, so while the
+// consumer keeps up no system call is made on either side.
+//
+// The doorbell is a word in the region, waited on with a process-shared
+// futex on Linux and __ulock on macOS, and a named event on Windows.
+// Elsewhere the consumer polls it every millisecond.
+//
+// Each side must only be used by one thread at a time.
+class SharedRingChannel {
+public:
+    enum class Role { Producer, Consumer };
+
+    static constexpr uint32_t kDefaultRingSize = 1 << 20;
+
+    ~SharedRingChannel();
+
+    // Creates region |name| holding a ring of |ringSize| bytes, rounded up
+    // to a power of two, and returns its |role| end. Returns null if the
+    // region can't be created.
+    static std::unique_ptr<SharedRingChannel> create(
+            const std::string& name,
+            Role role,
+            uint32_t ringSize = kDefaultRingSize,
+            mode_t mode = 0600);
+
+    // Opens the |role| end of a region made by create(). Returns null if it
+    // doesn't exist or doesn't hold a channel with that ring size.
+    static std::unique_ptr<SharedRingChannel> open(const std::string& name,
+                                                   Role role,
+                                                   uint32_t ringSize);
+
+    // Producer: writes all of |data|, waiting for room as needed, and wakes
+    // the consumer if it hung up. Returns false if either side closed first.
+    bool send(const void* data, size_t size);
+
+    // Consumer: copies out up to |size| bytes, waiting up to |timeoutUs| for
+    // some to arrive. Returns the number of bytes read, 0 on timeout, or -1
+    // once the producer closed and everything it sent has been read.
+    ssize_t receive(void* data, size_t size, uint64_t timeoutUs);
+
+    size_t readableBytes() const;
+
+    // Tells the peer this side is done. Pending data can still be received.
+    void close();
+    bool closed() const;
+    bool peerClosed() const;
+
+    // How often this producer had to wake a hung up consumer.
+    uint64_t doorbellRings() const { return mDoorbellRings; }
+
+    const std::string& name() const { return mName; }
+    Role role() const { return mRole; }
+    uint32_t ringSize() const { return mRingSize; }
+
+private:
+    struct Header;
+
+    SharedRingChannel(const std::string& name, Role role, uint32_t ringSize);
+
+    static size_t regionSize(uint32_t ringSize);
+    bool attach(bool initialize);
+    void ringDoorbell();
+    void waitDoorbell(uint32_t token, uint64_t timeoutUs);
+
+    std::string mName;
+    const Role mRole;
+    uint32_t mRingSize;
+    SharedMemory mMemory;
+    Header* mHeader = nullptr;
+    ring_buffer* mRing = nullptr;
+    ring_buffer_view mView = {};
+    uint64_t mDoorbellRings = 0;
+    // The doorbell's named event on Windows, unused elsewhere.
+    void* mEvent = nullptr;
+
+    DISALLOW_COPY_AND_ASSIGN(SharedRingChannel);
+};
+
+}  // namespace base
+}  // namespace android
@@ -17,7 +17,9 @@
 #include <vector>
 #include <utility>
 #include <type_traits>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 namespace android {
 namespace base {
@@ -28,14 +30,22 @@ namespace base {
 // 2. Items can be removed either from the front or from the back.
 // 3. When at maximum capacity, the oldest element is removed to make
 //    space for the new one.
+// A power of two capacity wraps indices with a mask instead of a division.
 template <class T, class A = std::allocator<T>>
 class CircularBuffer {
 public:
     using value_type = T;
 
+    // A contiguous run of elements.
+    struct Span {
+        const T* data = nullptr;
+        int size = 0;
+    };
+
     // Create a new circular buffer with the given |capacity|.
     explicit CircularBuffer(int capacity) :
-        mBuf(capacity), mSize(0), mFrontIdx(0), mBackIdx(0) {
+        mBuf(capacity), mSize(0), mFrontIdx(0), mBackIdx(0),
+        mMask((capacity & (capacity - 1)) == 0 ? capacity - 1 : -1) {
         assert(capacity > 0);
     }
 
@@ -49,6 +59,24 @@ public:
         incrementBackIdx();
     }
 
+    // Adds |count| elements at the end, in order, with at most two copies.
+    // Of more than capacity() elements only the last capacity() are kept.
+    void push_back(const T* values, int count) {
+        assert(count >= 0);
+        const int capacity = this->capacity();
+        if (count > capacity) {
+            values += count - capacity;
+            count = capacity;
+        }
+        const int first = std::min(count, capacity - mBackIdx);
+        copyElements(&mBuf[mBackIdx], values, first);
+        copyElements(&mBuf[0], values + first, count - first);
+        mBackIdx = wrap(mBackIdx + count);
+        const int dropped = std::max(0, mSize + count - capacity);
+        mFrontIdx = wrap(mFrontIdx + dropped);
+        mSize += count - dropped;
+    }
+
     // Returns the first element in the container.
     // Undefined behavior if called on an empty container.
     T& front() {
@@ -66,13 +94,13 @@ public:
     // Undefined behavior if called on an empty container.
     T& back() {
         assert(!empty());
-        return mBuf[(mFrontIdx + mSize - 1) % mBuf.size()];
+        return mBuf[wrap(mFrontIdx + mSize - 1)];
     }
 
     // Same as above, const version.
     const T& back() const {
         assert(!empty());
-        return mBuf[(mFrontIdx + mSize - 1) % mBuf.size()];
+        return mBuf[wrap(mFrontIdx + mSize - 1)];
     }
 
     // Removes the first element in the container.
@@ -80,7 +108,14 @@ public:
     void pop_front() {
         assert(!empty());
         mSize--;
-        mFrontIdx = (mFrontIdx + 1) % mBuf.size();
+        mFrontIdx = wrap(mFrontIdx + 1);
+    }
+
+    // Removes the first |count| elements, which must not exceed size().
+    void pop_front(int count) {
+        assert(count >= 0 && count <= mSize);
+        mSize -= count;
+        mFrontIdx = wrap(mFrontIdx + count);
     }
 
     // Removes the last element in the container.
@@ -102,27 +137,60 @@ public:
         return mSize;
     }
 
+    int capacity() const {
+        return static_cast<int>(mBuf.size());
+    }
+
     // Get a specific element from the buffer.
     // |idx| must be between 0 and |size|.
     T& operator[](int idx) {
-        return mBuf[(mFrontIdx + idx) % mBuf.size()];
+        return mBuf[wrap(mFrontIdx + idx)];
     }
 
     // Same as above, const version.
     const T& operator[](int idx) const {
-        return mBuf[(mFrontIdx + idx) % mBuf.size()];
+        return mBuf[wrap(mFrontIdx + idx)];
+    }
+
+    // The elements oldest first, as at most two contiguous runs; the second
+    // is empty unless the contents wrap around the end of the storage. Lets
+    // window statistics run over plain arrays. Invalidated by any change.
+    std::pair<Span, Span> spans() const {
+        const int first = std::min(mSize, capacity() - mFrontIdx);
+        return {Span{mBuf.data() + mFrontIdx, first},
+                Span{mBuf.data(), mSize - first}};
     }
 
 private:
+    // |idx| must be below twice the capacity.
+    int wrap(int idx) const {
+        if (mMask >= 0) {
+            return idx & mMask;
+        }
+        const int capacity = this->capacity();
+        return idx >= capacity ? idx - capacity : idx;
+    }
+
+    static void copyElements(T* dst, const T* src, int count) {
+        if (count <= 0) {
+            return;
+        }
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            memcpy(dst, src, count * sizeof(T));
+        } else {
+            std::copy(src, src + count, dst);
+        }
+    }
+
     void incrementBackIdx() {
         if (mSize < static_cast<int>(mBuf.size())) {
             mSize++;
         } else {
            // Buffer is at full capacity, erase first
            // element.
-           mFrontIdx = (mFrontIdx + 1) % mBuf.size();
+           mFrontIdx = wrap(mFrontIdx + 1);
         }
-        mBackIdx = (mBackIdx + 1) % mBuf.size();
+        mBackIdx = wrap(mBackIdx + 1);
     }
 
     // Buffer containing the data.
@@ -138,6 +206,9 @@ private:
     // Index at which the next element will be placed
     // in mBuf.
     int mBackIdx;
+
+    // capacity - 1 for a power of two capacity, -1 otherwise.
+    int mMask;
 };
 
 }
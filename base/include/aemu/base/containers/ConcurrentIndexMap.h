@@ -0,0 +1,244 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/synchronization/EpochReclaimer.h"
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include <inttypes.h>
+#include <stddef.h>
+
+namespace android {
+namespace base {
+
+// An open-addressing hash table from uint64_t keys to |Value|, where find()
+// takes no lock and never blocks. find() may run concurrently with anything;
+// the mutating calls and forEach() must be serialized by the caller.
+//
+// Values are allocated individually, so a pointer returned by find() or
+// emplace() stays valid until the key is erased, even across rehashes. Erased
+// values and old tables are freed through EpochReclaimer once no find() can be
+// looking at them any more.
+template <class Value>
+class ConcurrentIndexMap {
+public:
+    ConcurrentIndexMap() = default;
+    ~ConcurrentIndexMap() {
+        Table* table = mTable.load(std::memory_order_relaxed);
+        if (!table) {
+            return;
+        }
+        for (size_t i = 0; i <= table->mask; ++i) {
+            Node* node = table->slots[i].load(std::memory_order_relaxed);
+            if (node && node != tombstone()) {
+                delete node;
+            }
+        }
+        delete table;
+    }
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(ConcurrentIndexMap);
+
+    Value* find(uint64_t key) const {
+        EpochReclaimer::ReadScope scope;
+        const Table* table = mTable.load(std::memory_order_acquire);
+        if (!table) {
+            return nullptr;
+        }
+        size_t i = table->slotOf(key);
+        for (size_t probes = 0; probes <= table->mask; ++probes) {
+            Node* node = table->slots[i].load(std::memory_order_acquire);
+            if (!node) {
+                return nullptr;
+            }
+            if (node != tombstone() && node->key == key) {
+                return &node->value;
+            }
+            i = (i + 1) & table->mask;
+        }
+        return nullptr;
+    }
+
+    // Like std::unordered_map::emplace(): does nothing if |key| is present.
+    // Returns the stored value and whether it was inserted.
+    template <class... Args>
+    std::pair<Value*, bool> emplace(uint64_t key, Args&&... args) {
+        if (Value* existing = find(key)) {
+            return {existing, false};
+        }
+        Table* table = mTable.load(std::memory_order_relaxed);
+        if (!table || (mSize + mTombstones + 1) * 2 > table->mask + 1) {
+            table = rehash();
+        }
+        Node* node = new Node(key, std::forward<Args>(args)...);
+        size_t i = table->slotOf(key);
+        for (;;) {
+            Node* slot = table->slots[i].load(std::memory_order_relaxed);
+            if (!slot || slot == tombstone()) {
+                if (slot) {
+                    --mTombstones;
+                }
+                table->slots[i].store(node, std::memory_order_release);
+                break;
+            }
+            i = (i + 1) & table->mask;
+        }
+        ++mSize;
+        return {&node->value, true};
+    }
+
+    bool erase(uint64_t key) {
+        Table* table = mTable.load(std::memory_order_relaxed);
+        if (!table) {
+            return false;
+        }
+        size_t i = table->slotOf(key);
+        for (size_t probes = 0; probes <= table->mask; ++probes) {
+            Node* node = table->slots[i].load(std::memory_order_relaxed);
+            if (!node) {
+                return false;
+            }
+            if (node != tombstone() && node->key == key) {
+                table->slots[i].store(tombstone(), std::memory_order_release);
+                --mSize;
+                ++mTombstones;
+                EpochReclaimer::get().retire(node, &deleteNode);
+                return true;
+            }
+            i = (i + 1) & table->mask;
+        }
+        return false;
+    }
+
+    void clear() {
+        Table* table = mTable.exchange(nullptr, std::memory_order_acq_rel);
+        if (!table) {
+            return;
+        }
+        for (size_t i = 0; i <= table->mask; ++i) {
+            Node* node = table->slots[i].load(std::memory_order_relaxed);
+            if (node && node != tombstone()) {
+                EpochReclaimer::get().retire(node, &deleteNode);
+            }
+        }
+        EpochReclaimer::get().retire(table, &deleteTable);
+        mSize = 0;
+        mTombstones = 0;
+    }
+
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    // Calls |func(key, value)| for every entry, in no particular order.
+    template <class Func>
+    void forEach(Func&& func) const {
+        const Table* table = mTable.load(std::memory_order_relaxed);
+        if (!table) {
+            return;
+        }
+        for (size_t i = 0; i <= table->mask; ++i) {
+            Node* node = table->slots[i].load(std::memory_order_relaxed);
+            if (node && node != tombstone()) {
+                func(node->key, node->value);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t kMinSlots = 16;
+
+    struct Node {
+        template <class... Args>
+        Node(uint64_t key, Args&&... args)
+            : key(key), value(std::forward<Args>(args)...) {}
+
+        const uint64_t key;
+        Value value;
+    };
+
+    struct Table {
+        explicit Table(size_t slotCount)
+            : mask(slotCount - 1),
+              shift(64 - log2(slotCount)),
+              slots(new std::atomic<Node*>[slotCount]) {
+            for (size_t i = 0; i < slotCount; ++i) {
+                slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        static uint32_t log2(size_t pow2) {
+            uint32_t res = 0;
+            while ((size_t(1) << res) < pow2) ++res;
+            return res;
+        }
+
+        // Fibonacci hashing, so consecutive handles spread out.
+        size_t slotOf(uint64_t key) const {
+            return size_t((key * 0x9e3779b97f4a7c15ULL) >> shift) & mask;
+        }
+
+        const size_t mask;
+        const uint32_t shift;
+        std::unique_ptr<std::atomic<Node*>[]> slots;
+    };
+
+    // Marks an erased slot so probing continues past it.
+    static Node* tombstone() { return reinterpret_cast<Node*>(alignof(Node)); }
+
+    static void deleteNode(void* node) { delete static_cast<Node*>(node); }
+    static void deleteTable(void* table) { delete static_cast<Table*>(table); }
+
+    // Moves the live entries into a table sized for twice as many and
+    // publishes it. Readers still in the old table finish there.
+    Table* rehash() {
+        size_t slotCount = kMinSlots;
+        while (slotCount < (mSize + 1) * 4) {
+            slotCount *= 2;
+        }
+        Table* newTable = new Table(slotCount);
+        Table* oldTable = mTable.load(std::memory_order_relaxed);
+        if (oldTable) {
+            for (size_t i = 0; i <= oldTable->mask; ++i) {
+                Node* node = oldTable->slots[i].load(std::memory_order_relaxed);
+                if (!node || node == tombstone()) {
+                    continue;
+                }
+                size_t j = newTable->slotOf(node->key);
+                while (newTable->slots[j].load(std::memory_order_relaxed)) {
+                    j = (j + 1) & newTable->mask;
+                }
+                newTable->slots[j].store(node, std::memory_order_relaxed);
+            }
+        }
+        mTable.store(newTable, std::memory_order_release);
+        mTombstones = 0;
+        if (oldTable) {
+            EpochReclaimer::get().retire(oldTable, &deleteTable);
+        }
+        return newTable;
+    }
+
+    std::atomic<Table*> mTable{nullptr};
+    // Writer-side bookkeeping.
+    size_t mSize = 0;
+    size_t mTombstones = 0;
+};
+
+}  // namespace base
+}  // namespace android
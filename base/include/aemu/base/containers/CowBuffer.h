@@ -0,0 +1,127 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+namespace base {
+
+// A FIFO byte buffer that can hand out immutable views of its contents
+// without copying them, for state that must be saved while its owner keeps
+// running, e.g. pipe data saved on a background thread after the VM has
+// resumed.
+//
+// view() shares the current bytes. The owner's next append() then copies
+// them first, so views never change; consume() and clear() only move the
+// owner's own window and never copy. With no outstanding view nothing is
+// ever copied. Only the owner mutates the buffer, from a single thread;
+// views may be read and dropped on any thread.
+class CowBuffer {
+public:
+    class View {
+    public:
+        View() = default;
+
+        const uint8_t* data() const {
+            return mBytes ? mBytes->data() + mBegin : nullptr;
+        }
+        size_t size() const { return mSize; }
+        bool empty() const { return !mSize; }
+
+    private:
+        friend class CowBuffer;
+        View(std::shared_ptr<const std::vector<uint8_t>> bytes,
+             size_t begin,
+             size_t size)
+            : mBytes(std::move(bytes)), mBegin(begin), mSize(size) {}
+
+        std::shared_ptr<const std::vector<uint8_t>> mBytes;
+        size_t mBegin = 0;
+        size_t mSize = 0;
+    };
+
+    const uint8_t* data() const {
+        return mBytes ? mBytes->data() + mBegin : nullptr;
+    }
+    size_t size() const { return mBytes ? mBytes->size() - mBegin : 0; }
+    bool empty() const { return !size(); }
+
+    void append(const void* data, size_t size) {
+        if (!size) {
+            return;
+        }
+        makeWritable(size);
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        mBytes->insert(mBytes->end(), bytes, bytes + size);
+    }
+
+    // Drops the first |size| bytes, or all of them if there are fewer.
+    void consume(size_t size) {
+        if (size >= this->size()) {
+            clear();
+            return;
+        }
+        mBegin += size;
+    }
+
+    void clear() {
+        if (mBytes && mBytes.use_count() == 1) {
+            mBytes->clear();
+        } else {
+            mBytes.reset();
+        }
+        mBegin = 0;
+    }
+
+    View view() const { return View(mBytes, mBegin, size()); }
+
+    // Whether a view still shares the bytes, i.e. the next append() copies.
+    bool isShared() const { return mBytes && mBytes.use_count() > 1; }
+
+private:
+    // Makes |mBytes| ours alone, with the consumed prefix dropped once it
+    // dominates, and room for |extra| more bytes.
+    void makeWritable(size_t extra) {
+        if (!mBytes) {
+            mBytes = std::make_shared<std::vector<uint8_t>>();
+            mBytes->reserve(extra);
+            return;
+        }
+        if (mBytes.use_count() > 1) {
+            auto copy = std::make_shared<std::vector<uint8_t>>();
+            copy->reserve(size() + extra);
+            copy->assign(mBytes->begin() + mBegin, mBytes->end());
+            mBytes = std::move(copy);
+            mBegin = 0;
+            return;
+        }
+        if (mBegin && mBegin >= mBytes->size() / 2) {
+            mBytes->erase(mBytes->begin(), mBytes->begin() + mBegin);
+            mBegin = 0;
+        }
+    }
+
+    std::shared_ptr<std::vector<uint8_t>> mBytes;
+    // Start of the unconsumed bytes in |mBytes|.
+    size_t mBegin = 0;
+};
+
+}  // namespace base
+}  // namespace android
@@ -4,13 +4,20 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <unordered_map>
 #include <vector>
 
+#include <assert.h>
 #include <inttypes.h>
 #include <stdio.h>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #define ENTITY_MANAGER_DEBUG 0
 
 #if ENTITY_MANAGER_DEBUG
@@ -30,6 +37,12 @@ namespace base {
 // EntityManager: A way to represent an abstrat space of objects with handles.
 // Each handle is associated with data of type Item for quick access from handles to data.
 // Otherwise, entity data is spread through ComponentManagers.
+//
+// Entries are stored in chunks that never move and are only freed when the
+// manager is destroyed, so get(), get_const() and isLive() take no lock and
+// may run concurrently with one thread calling add(), addFixed(), remove() or
+// clear(), or their batch forms. Those, and the forEach functions, must still
+// be serialized with each other.
 template<size_t indexBits,
          size_t generationBits,
          size_t typeBits,
@@ -86,25 +99,29 @@ public:
     EntityManager() : EntityManager(0) { }
 
     EntityManager(size_t initialItems) :
-        mEntries(initialItems),
         mFirstFreeIndex(0),
         mLiveEntries(0) {
-        reserve(initialItems);
+        resetEntries(initialItems);
     }
 
-    ~EntityManager() { clear(); }
+    ~EntityManager() {
+        clear();
+        for (auto& chunk : mChunks) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
 
     struct EntityEntry {
         EntityHandle handle = 0;
         size_t nextFreeIndex = 0;
         // 0 is a special generation for brand new entries
         // that are not used yet
-        size_t liveGeneration = 1;
+        std::atomic<size_t> liveGeneration{1};
         Item item;
     };
 
 	void clear() {
-		reserve(mEntries.size());
+		resetEntries(mCapacity);
         mFirstFreeIndex = 0;
         mLiveEntries = 0;
     }
@@ -113,6 +130,14 @@ public:
         return mFirstFreeIndex;
     }
 
+    size_t size() const { return mLiveEntries; }
+
+    // Makes room for |capacity| entries up front, so that adding up to that
+    // many doesn't allocate. New entries join the end of the free list.
+    void reserve(size_t capacity) {
+        grow(std::min(capacity, size_t(1ULL << indexBits)), 1);
+    }
+
     EntityHandle add(const Item& item, size_t type) {
 
         if (!type) return INVALID_ENTITY_HANDLE;
@@ -127,37 +152,53 @@ public:
         size_t neededCapacity = newIndex + 1;
         if (maxElements < neededCapacity) return INVALID_ENTITY_HANDLE;
 
-        size_t currentCapacity = mEntries.size();
-        size_t nextCapacity = neededCapacity << 1;
-        if (nextCapacity > maxElements) nextCapacity = maxElements;
-
-        EM_DBG("needed/current/next capacity: %zu %zu %zu",
-               neededCapacity,
-               currentCapacity,
-               nextCapacity);
+        grow(neededCapacity, type);
 
-        if (neededCapacity > mEntries.size()) {
-            mEntries.resize(nextCapacity);
-            for (size_t i = currentCapacity; i < nextCapacity; ++i) {
-                mEntries[i].handle = makeHandle(i, 0, type);
-                mEntries[i].nextFreeIndex = i + 1;
-                EM_DBG("new un-init entry: index %zu nextFree %zu",
-                       i, i + 1);
-            }
-        }
+        auto& entry = entryAt(newIndex);
+        entry.handle = makeHandle(newIndex, currentGeneration(entry), type);
+        entry.item = item;
 
-        mEntries[newIndex].handle =
-            makeHandle(newIndex, mEntries[newIndex].liveGeneration, type);
-        mEntries[newIndex].item = item;
-
-        mFirstFreeIndex = mEntries[newIndex].nextFreeIndex;
+        mFirstFreeIndex = entry.nextFreeIndex;
         EM_DBG("created. new first free: %zu", mFirstFreeIndex);
 
         ++mLiveEntries;
 
-        EM_DBG("result handle: 0x%llx", (unsigned long long)mEntries[newIndex].handle);
+        EM_DBG("result handle: 0x%llx", (unsigned long long)entry.handle);
+
+        return entry.handle;
+    }
+
+    // Adds |count| items at once, writing their handles to |outHandles|.
+    // Either all of them are added or, if there is no room or |type| is
+    // invalid, none and false is returned. Entries are grown once for the
+    // whole batch, and taken off the free list in order, which after a
+    // reserve() or clear() means walking consecutive entries.
+    bool addMany(const Item* items,
+                 size_t count,
+                 size_t type,
+                 EntityHandle* outHandles) {
+        if (!type) return false;
+
+        const size_t maxElements = (1ULL << indexBits);
+        if (count > maxElements - mLiveEntries) return false;
+
+        // Every index below capacity that isn't live is on the free list,
+        // so this is enough for the whole batch.
+        grow(mLiveEntries + count, type);
+
+        size_t index = mFirstFreeIndex;
+        for (size_t i = 0; i < count; ++i) {
+            auto& entry = entryAt(index);
+            entry.handle = makeHandle(index, currentGeneration(entry), type);
+            entry.item = items[i];
+            outHandles[i] = entry.handle;
+            index = entry.nextFreeIndex;
+        }
+        mFirstFreeIndex = index;
+        mLiveEntries += count;
 
-        return mEntries[newIndex].handle;
+        EM_DBG("added %zu. new first free: %zu", count, mFirstFreeIndex);
+        return true;
     }
 
     EntityHandle addFixed(EntityHandle fixedHandle, const Item& item, size_t type) {
@@ -182,50 +223,36 @@ public:
 
         if (maxElements < neededCapacity) return INVALID_ENTITY_HANDLE;
 
-        size_t currentCapacity = mEntries.size();
-        size_t nextCapacity = neededCapacity << 1;
-        if (nextCapacity > maxElements) nextCapacity = maxElements;
-
-        EM_DBG("needed/current/next capacity: %zu %zu %zu",
-               neededCapacity,
-               currentCapacity,
-               nextCapacity);
-
-        if (neededCapacity > mEntries.size()) {
-            mEntries.resize(nextCapacity);
-            for (size_t i = currentCapacity; i < nextCapacity; ++i) {
-                mEntries[i].handle = makeHandle(i, 0, type);
-                mEntries[i].nextFreeIndex = i + 1;
-                EM_DBG("new un-init entry: index %zu nextFree %zu",
-                       i, i + 1);
-            }
-        }
+        grow(neededCapacity, type);
 
         // Now we ensured that there is enough space to talk about the entry of
         // this |fixedHandle|.
+        auto& entry = entryAt(newIndex);
         if (mFirstFreeIndex == newIndex) {
             isFreeListHead = true;
         } else {
-            auto& entry = mEntries[newIndex];
-            if (entry.liveGeneration == getHandleGeneration(entry.handle)) {
+            if (currentGeneration(entry) == getHandleGeneration(entry.handle)) {
                 isAlloced = true;
             } else {
                 isFreeListNonHead = true;
             }
         }
 
-        mEntries[newIndex].handle = fixedHandle;
-        mEntries[newIndex].liveGeneration = getHandleGeneration(fixedHandle);
-        mEntries[newIndex].item = item;
+        entry.handle = fixedHandle;
+        entry.item = item;
+        // Publish the generation last, so a reader holding |fixedHandle|
+        // never sees the entry before |item| is written.
+        entry.liveGeneration.store(getHandleGeneration(fixedHandle),
+                                   std::memory_order_release);
 
         EM_DBG("new index: %zu", newIndex);
 
         if (isFreeListHead) {
 
             EM_DBG("first free index reset from %zu to %zu",
-                    mFirstFreeIndex, mEntries[newIndex].nextFreeIndex);
+                    mFirstFreeIndex, entry.nextFreeIndex);
 
-            mFirstFreeIndex = mEntries[newIndex].nextFreeIndex;
+            mFirstFreeIndex = entry.nextFreeIndex;
 
             ++mLiveEntries;
 
@@ -239,21 +266,20 @@ public:
 
             EM_DBG("in free list but not head. reorganizing freelist. "
                    "start at %zu -> %zu",
-                   mFirstFreeIndex, mEntries[prevEntryIndex].nextFreeIndex);
+                   mFirstFreeIndex, entryAt(prevEntryIndex).nextFreeIndex);
 
-            while (mEntries[prevEntryIndex].nextFreeIndex != newIndex) {
+            while (entryAt(prevEntryIndex).nextFreeIndex != newIndex) {
                 EM_DBG("next: %zu -> %zu",
                        prevEntryIndex,
-                       mEntries[prevEntryIndex].nextFreeIndex);
+                       entryAt(prevEntryIndex).nextFreeIndex);
                 prevEntryIndex =
-                    mEntries[prevEntryIndex].nextFreeIndex;
+                    entryAt(prevEntryIndex).nextFreeIndex;
             }
 
             EM_DBG("finished. set prev entry %zu to new entry's next, %zu",
-                    prevEntryIndex, mEntries[newIndex].nextFreeIndex);
+                    prevEntryIndex, entry.nextFreeIndex);
 
-            mEntries[prevEntryIndex].nextFreeIndex =
-                mEntries[newIndex].nextFreeIndex;
+            entryAt(prevEntryIndex).nextFreeIndex = entry.nextFreeIndex;
 
             ++mLiveEntries;
         }
@@ -268,15 +294,11 @@ public:
 
         EM_DBG("remove handle: 0x%llx -> index %zu", (unsigned long long)h, index);
 
-        auto& entry = mEntries[index];
+        auto& entry = entryAt(index);
 
-        EM_DBG("handle gen: %zu entry gen: %zu", getHandleGeneration(h), entry.liveGeneration);
+        EM_DBG("handle gen: %zu entry gen: %zu", getHandleGeneration(h), currentGeneration(entry));
 
-        ++entry.liveGeneration;
-        if ((entry.liveGeneration == 0) ||
-            (entry.liveGeneration == (1ULL << generationBits))) {
-            entry.liveGeneration = 1;
-        }
+        bumpGeneration(entry);
 
         entry.nextFreeIndex = mFirstFreeIndex;
 
@@ -287,92 +309,214 @@ public:
         --mLiveEntries;
     }
 
+    // Removes each live handle in |handles|; the others are ignored. The
+    // freed entries are chained together and put on the free list in one
+    // go, in order, so adding them back later walks them the same way.
+    void removeMany(const EntityHandle* handles, size_t count) {
+        size_t head = mFirstFreeIndex;
+        size_t* tail = &head;
+        size_t removed = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (!isLive(handles[i])) continue;
+            const size_t index = getHandleIndex(handles[i]);
+            auto& entry = entryAt(index);
+            bumpGeneration(entry);
+            *tail = index;
+            tail = &entry.nextFreeIndex;
+            ++removed;
+        }
+        *tail = mFirstFreeIndex;
+        mFirstFreeIndex = head;
+        mLiveEntries -= removed;
+
+        EM_DBG("removed %zu. new first free: %zu", removed, mFirstFreeIndex);
+    }
+
     Item* get(EntityHandle h) {
         EM_DBG("get 0x%llx", (unsigned long long)h);
-        size_t index = getHandleIndex(h);
-        if (index >= mEntries.size()) {
+        EntityEntry* entry = findEntry(getHandleIndex(h));
+        if (!entry) {
             return nullptr;
         }
 
-        auto& entry = mEntries[index];
-        if (entry.liveGeneration != getHandleGeneration(h)) {
+        if (entry->liveGeneration.load(std::memory_order_acquire) !=
+            getHandleGeneration(h)) {
             return nullptr;
         }
 
-        return &entry.item;
+        return &entry->item;
     }
 
     const Item* get_const(EntityHandle h) const {
-        size_t index = getHandleIndex(h);
-        if (index >= mEntries.size()) return nullptr;
+        const EntityEntry* entry = findEntry(getHandleIndex(h));
+        if (!entry) return nullptr;
 
-        const auto& entry = mEntries.data() + index;
-        if (entry->liveGeneration != getHandleGeneration(h)) return nullptr;
+        if (entry->liveGeneration.load(std::memory_order_acquire) !=
+            getHandleGeneration(h)) return nullptr;
 
         return &entry->item;
     }
 
     bool isLive(EntityHandle h) const {
-        size_t index = getHandleIndex(h);
-        if (index >= mEntries.size()) return false;
+        const EntityEntry* entry = findEntry(getHandleIndex(h));
+        if (!entry) return false;
 
-        const auto& entry = mEntries[index];
+        return (entry->liveGeneration.load(std::memory_order_acquire) ==
+                getHandleGeneration(h));
+    }
 
-        return (entry.liveGeneration == getHandleGeneration(h));
+    // The iteration functions take any callable with the signature of
+    // IteratorFunc; passing a lambda directly lets the loop inline it.
+    template <class Func>
+    void forEachEntry(Func&& func) {
+        forEachChunk([&func](EntityEntry* entries, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                auto& entry = entries[i];
+                func(isLiveEntry(entry), entry.handle, entry.item);
+            }
+        });
     }
 
-    void forEachEntry(IteratorFunc func) {
-        for (auto& entry: mEntries) {
-            auto handle = entry.handle;
-            bool live = isLive(handle);
-            auto& item = entry.item;
-            func(live, handle, item);
-        }
+    template <class Func>
+    void forEachLiveEntry(Func&& func) {
+        forEachChunk([&func](EntityEntry* entries, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                auto& entry = entries[i];
+                if (!isLiveEntry(entry)) continue;
+                func(true, entry.handle, entry.item);
+            }
+        });
     }
 
-    void forEachLiveEntry(IteratorFunc func) {
-        for (auto& entry: mEntries) {
-            auto handle = entry.handle;
-            bool live = isLive(handle);
+    template <class Func>
+    void forEachLiveEntry_const(Func&& func) const {
+        forEachChunk([&func](const EntityEntry* entries, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                const auto& entry = entries[i];
+                if (!isLiveEntry(entry)) continue;
+                func(true, entry.handle, entry.item);
+            }
+        });
+    }
 
-            if (!live) continue;
+private:
+    // Chunk c holds kFirstChunkEntries << c entries, so a handful of chunks
+    // cover the whole index space and an index maps to its chunk with one
+    // bit scan.
+    static constexpr size_t kFirstChunkShift = 6;
+    static constexpr size_t kFirstChunkEntries = size_t(1) << kFirstChunkShift;
+    static constexpr size_t kMaxChunks = 64 - kFirstChunkShift;
+
+    static size_t chunkOf(size_t index) {
+        uint64_t value = (uint64_t(index) >> kFirstChunkShift) + 1;
+#ifdef _MSC_VER
+        unsigned long res;
+        _BitScanReverse64(&res, value);
+        return res;
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
 
-            auto& item = entry.item;
-            func(live, handle, item);
-        }
+    static size_t chunkStart(size_t chunk) {
+        return kFirstChunkEntries * ((size_t(1) << chunk) - 1);
     }
 
-    void forEachLiveEntry_const(ConstIteratorFunc func) const {
-        for (auto& entry: mEntries) {
-            auto handle = entry.handle;
-            bool live = isLive(handle);
+    const EntityEntry* findEntry(size_t index) const {
+        const size_t chunk = chunkOf(index);
+        const EntityEntry* entries = mChunks[chunk].load(std::memory_order_acquire);
+        if (!entries) return nullptr;
+        return entries + (index - chunkStart(chunk));
+    }
 
-            if (!live) continue;
+    EntityEntry* findEntry(size_t index) {
+        return const_cast<EntityEntry*>(
+            static_cast<const EntityManager*>(this)->findEntry(index));
+    }
+
+    // Only for indices below mCapacity, whose chunks are always allocated.
+    const EntityEntry& entryAt(size_t index) const {
+        const size_t chunk = chunkOf(index);
+        const EntityEntry* entries = mChunks[chunk].load(std::memory_order_acquire);
+        assert(entries);
+        return entries[index - chunkStart(chunk)];
+    }
+
+    EntityEntry& entryAt(size_t index) {
+        return const_cast<EntityEntry&>(
+            static_cast<const EntityManager*>(this)->entryAt(index));
+    }
 
-            const auto& item = entry.item;
-            func(live, handle, item);
+    static size_t currentGeneration(const EntityEntry& entry) {
+        return entry.liveGeneration.load(std::memory_order_relaxed);
+    }
+
+    static bool isLiveEntry(const EntityEntry& entry) {
+        return currentGeneration(entry) == getHandleGeneration(entry.handle);
+    }
+
+    // Calls |func(entries, count)| for each allocated chunk, in index order.
+    template <class Func>
+    void forEachChunk(Func&& func) const {
+        for (size_t chunk = 0, start = 0; start < mCapacity;
+             start = chunkStart(++chunk)) {
+            func(mChunks[chunk].load(std::memory_order_relaxed),
+                 std::min(kFirstChunkEntries << chunk, mCapacity - start));
         }
     }
 
-private:
-    void reserve(size_t count) {
-        if (mEntries.size() < count) {
-            mEntries.resize(count);
+    static void bumpGeneration(EntityEntry& entry) {
+        size_t generation = currentGeneration(entry) + 1;
+        if ((generation == 0) ||
+            (generation == (1ULL << generationBits))) {
+            generation = 1;
         }
-        for (size_t i = 0; i < count; ++i) {
-            mEntries[i].handle = makeHandle(i, 0, 1);
-            mEntries[i].nextFreeIndex = i + 1;
-            ++mEntries[i].liveGeneration;
-            if ((mEntries[i].liveGeneration == 0) ||
-                    (mEntries[i].liveGeneration == (1ULL << generationBits))) {
-                mEntries[i].liveGeneration = 1;
+        entry.liveGeneration.store(generation, std::memory_order_release);
+    }
+
+    // Adds chunks until |neededCapacity| entries exist. Existing entries
+    // don't move.
+    void grow(size_t neededCapacity, size_t type) {
+        const size_t maxElements = (1ULL << indexBits);
+        while (mCapacity < neededCapacity) {
+            const size_t chunk = chunkOf(mCapacity);
+            const size_t start = chunkStart(chunk);
+            const size_t count =
+                std::min(kFirstChunkEntries << chunk, maxElements - start);
+
+            EM_DBG("needed/current/next capacity: %zu %zu %zu",
+                   neededCapacity,
+                   mCapacity,
+                   start + count);
+
+            EntityEntry* entries = new EntityEntry[count];
+            for (size_t i = 0; i < count; ++i) {
+                entries[i].handle = makeHandle(start + i, 0, type);
+                entries[i].nextFreeIndex = start + i + 1;
+                EM_DBG("new un-init entry: index %zu nextFree %zu",
+                       start + i, start + i + 1);
             }
+            mChunks[chunk].store(entries, std::memory_order_release);
+            mCapacity = start + count;
+        }
+    }
+
+    // Makes the first |count| entries free, in index order.
+    void resetEntries(size_t count) {
+        grow(count, 1);
+        for (size_t i = 0; i < count; ++i) {
+            auto& entry = entryAt(i);
+            entry.handle = makeHandle(i, 0, 1);
+            entry.nextFreeIndex = i + 1;
+            bumpGeneration(entry);
             EM_DBG("new un-init entry: index %zu nextFree %zu",
                     i, i + 1);
         }
     }
 
-    std::vector<EntityEntry> mEntries;
+    std::atomic<EntityEntry*> mChunks[kMaxChunks] = {};
+    // Number of entries in the allocated chunks.
+    size_t mCapacity = 0;
     size_t mFirstFreeIndex;
     size_t mLiveEntries;
 };
@@ -463,23 +607,28 @@ public:
         return &(item->data);
     }
 
-    void forEachComponent(ComponentIteratorFunc func) {
+    // As with EntityManager, these take any callable with the signature of
+    // ComponentIteratorFunc.
+    template <class Func>
+    void forEachComponent(Func&& func) {
         mData.forEachEntry(
-            [func](bool live, typename InternalEntityManager::EntityHandle componentHandle, InternalItem& item) {
+            [&func](bool live, typename InternalEntityManager::EntityHandle componentHandle, InternalItem& item) {
                 func(live, componentHandle, item.entityHandle, item.data);
         });
     }
 
-    void forEachLiveComponent(ComponentIteratorFunc func) {
+    template <class Func>
+    void forEachLiveComponent(Func&& func) {
         mData.forEachLiveEntry(
-            [func](bool live, typename InternalEntityManager::EntityHandle componentHandle, InternalItem& item) {
+            [&func](bool live, typename InternalEntityManager::EntityHandle componentHandle, InternalItem& item) {
                 func(live, componentHandle, item.entityHandle, item.data);
         });
     }
 
-    void forEachLiveComponent_const(ConstComponentIteratorFunc func) const {
+    template <class Func>
+    void forEachLiveComponent_const(Func&& func) const {
         mData.forEachLiveEntry_const(
-            [func](bool live, typename InternalEntityManager::EntityHandle componentHandle, const InternalItem& item) {
+            [&func](bool live, typename InternalEntityManager::EntityHandle componentHandle, const InternalItem& item) {
                 func(live, componentHandle, item.entityHandle, item.data);
         });
     }
@@ -498,6 +647,201 @@ private:
     EntityToComponentMap mEntityToComponentMap;
 };
 
+// ComponentManager, but with the components packed densely in separate
+// arrays of component handles, entity handles and data, in no particular
+// order. Iterating over all components touches only those arrays, with no
+// generation checks or holes, which suits passes like snapshotting or
+// teardown. Lookups by handle go through a sparse index that holds each
+// handle's generation and position.
+//
+// Removing a component moves the last one into its place, so pointers
+// returned by getByComponent() and getByEntity() are only valid until the
+// next add or remove, and components must not be added or removed while
+// iterating.
+template<size_t indexBits,
+         size_t generationBits,
+         size_t typeBits,
+         class Data>
+class DenseComponentManager {
+public:
+
+    static_assert(64 == (indexBits + generationBits + typeBits),
+                  "bits of index, generation, and type must add to 64");
+
+    using ComponentHandle = uint64_t;
+    using EntityHandle = uint64_t;
+    using ComponentIteratorFunc = std::function<void(bool, ComponentHandle componentHandle, EntityHandle entityHandle, Data& data)>;
+    using ConstComponentIteratorFunc = std::function<void(bool, ComponentHandle componentHandle, EntityHandle entityHandle, const Data& data)>;
+
+    ComponentHandle add(
+        EntityHandle h,
+        const Data& data,
+        size_t type,
+        bool tracked = false) {
+
+        if (!type) return INVALID_COMPONENT_HANDLE;
+
+        size_t index;
+        if (!mFreeIndices.empty()) {
+            index = mFreeIndices.back();
+            mFreeIndices.pop_back();
+        } else {
+            index = mGenerations.size();
+            if (index == (1ULL << indexBits)) return INVALID_COMPONENT_HANDLE;
+            mGenerations.push_back(1);
+            mDenseIndex.push_back(0);
+        }
+
+        auto res = Handles::makeHandle(index, mGenerations[index], type);
+        mDenseIndex[index] = mHandles.size();
+        mHandles.push_back(res);
+        mEntityHandles.push_back(h);
+        mData.push_back(data);
+        mTracked.push_back(tracked);
+
+        if (tracked) {
+            mEntityToComponentMap[h] = res;
+        }
+
+        return res;
+    }
+
+    void clear() {
+        for (auto h : mHandles) {
+            release(Handles::getHandleIndex(h));
+        }
+        mHandles.clear();
+        mEntityHandles.clear();
+        mData.clear();
+        mTracked.clear();
+        mEntityToComponentMap.clear();
+    }
+
+    size_t size() const { return mHandles.size(); }
+
+    // If we didn't explicitly track, just fail.
+    ComponentHandle getComponentHandle(EntityHandle h) const {
+        const auto it = mEntityToComponentMap.find(h);
+        if (it == mEntityToComponentMap.end()) {
+            return INVALID_COMPONENT_HANDLE;
+        }
+        return it->second;
+    }
+
+    EntityHandle getEntityHandle(ComponentHandle h) const {
+        const size_t pos = denseIndexOf(h);
+        if (pos == kNotFound) return INVALID_ENTITY_HANDLE;
+        return mEntityHandles[pos];
+    }
+
+    void removeByEntity(EntityHandle h) {
+        auto componentHandle = getComponentHandle(h);
+        removeByComponent(componentHandle);
+    }
+
+    void removeByComponent(ComponentHandle h) {
+        const size_t pos = denseIndexOf(h);
+        if (pos == kNotFound) return;
+
+        if (mTracked[pos]) {
+            mEntityToComponentMap.erase(mEntityHandles[pos]);
+        }
+
+        // Fill the hole with the last component.
+        const size_t last = mHandles.size() - 1;
+        if (pos != last) {
+            mHandles[pos] = mHandles[last];
+            mEntityHandles[pos] = mEntityHandles[last];
+            mData[pos] = std::move(mData[last]);
+            mTracked[pos] = mTracked[last];
+            mDenseIndex[Handles::getHandleIndex(mHandles[pos])] = pos;
+        }
+        mHandles.pop_back();
+        mEntityHandles.pop_back();
+        mData.pop_back();
+        mTracked.pop_back();
+
+        release(Handles::getHandleIndex(h));
+    }
+
+    Data* getByEntity(EntityHandle h) {
+        return getByComponent(getComponentHandle(h));
+    }
+
+    Data* getByComponent(ComponentHandle h) {
+        const size_t pos = denseIndexOf(h);
+        if (pos == kNotFound) return nullptr;
+        return &mData[pos];
+    }
+
+    const Data* getByComponent_const(ComponentHandle h) const {
+        const size_t pos = denseIndexOf(h);
+        if (pos == kNotFound) return nullptr;
+        return &mData[pos];
+    }
+
+    // Takes any callable with the signature of ComponentIteratorFunc. Only
+    // live components are stored, so |live| is always true.
+    template <class Func>
+    void forEachLiveComponent(Func&& func) {
+        const size_t count = mHandles.size();
+        for (size_t i = 0; i < count; ++i) {
+            func(true, mHandles[i], mEntityHandles[i], mData[i]);
+        }
+    }
+
+    template <class Func>
+    void forEachLiveComponent_const(Func&& func) const {
+        const size_t count = mHandles.size();
+        for (size_t i = 0; i < count; ++i) {
+            func(true, mHandles[i], mEntityHandles[i], mData[i]);
+        }
+    }
+
+    // Direct access to the packed data, in the order forEachLiveComponent()
+    // visits it.
+    Data* data() { return mData.data(); }
+    const Data* data() const { return mData.data(); }
+    const ComponentHandle* componentHandles() const { return mHandles.data(); }
+    const EntityHandle* entityHandles() const { return mEntityHandles.data(); }
+
+private:
+    using Handles = EntityManager<indexBits, generationBits, typeBits, int>;
+    using EntityToComponentMap = std::unordered_map<EntityHandle, ComponentHandle>;
+
+    static constexpr size_t kNotFound = SIZE_MAX;
+
+    size_t denseIndexOf(ComponentHandle h) const {
+        const size_t index = Handles::getHandleIndex(h);
+        if (index >= mGenerations.size()) return kNotFound;
+        if (mGenerations[index] != Handles::getHandleGeneration(h)) return kNotFound;
+        return mDenseIndex[index];
+    }
+
+    // Invalidates outstanding handles to |index| and makes it reusable.
+    void release(size_t index) {
+        size_t generation = mGenerations[index] + 1;
+        if (generation == (1ULL << generationBits)) {
+            generation = 1;
+        }
+        mGenerations[index] = generation;
+        mFreeIndices.push_back(index);
+    }
+
+    // Sparse, by handle index.
+    std::vector<size_t> mGenerations;
+    std::vector<size_t> mDenseIndex;
+    std::vector<size_t> mFreeIndices;
+
+    // Dense, by position.
+    std::vector<ComponentHandle> mHandles;
+    std::vector<EntityHandle> mEntityHandles;
+    std::vector<Data> mData;
+    std::vector<uint8_t> mTracked;
+
+    EntityToComponentMap mEntityToComponentMap;
+};
+
 // ComponentManager, but unpacked; uses the same index space as the associated
 // entities. Takes more space by default, but not more if all entities have this component.
 template<size_t indexBits,
@@ -562,19 +906,22 @@ public:
         return &item->data;
     }
 
-    void forEachComponent(ComponentIteratorFunc func) {
+    template <class Func>
+    void forEachComponent(Func&& func) {
         for (auto& item : mItems) {
             func(item.live, item.handle, item.handle, item.data);
         }
     }
 
-    void forEachLiveComponent(ComponentIteratorFunc func) {
+    template <class Func>
+    void forEachLiveComponent(Func&& func) {
         for (auto& item : mItems) {
             if (item.live) func(item.live, item.handle, item.handle, item.data);
         }
     }
 
-    void forEachLiveComponent_const(ConstComponentIteratorFunc func) const {
+    template <class Func>
+    void forEachLiveComponent_const(Func&& func) const {
         for (auto& item : mItems) {
             if (item.live) func(item.live, item.handle, item.handle, item.data);
         }
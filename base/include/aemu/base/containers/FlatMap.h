@@ -0,0 +1,721 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AEMU_FLAT_MAP_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define AEMU_FLAT_MAP_NEON 1
+#include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Drop-in replacements for small to medium maps on hot paths, where a node
+// per entry costs an allocation on insert and a cache miss on every step of
+// a lookup or walk.
+//
+// FlatMap<K, V> keeps its entries sorted in one vector and replaces
+// std::map: lookups are binary searches over contiguous memory and walks are
+// linear scans. Inserting or erasing moves the entries after that point, so
+// it suits maps of up to a few hundred entries that are read far more often
+// than changed.
+//
+// FlatHashMap<K, V> replaces std::unordered_map with an open addressing
+// table. Each slot has a control byte holding 7 bits of its key's hash, and
+// a lookup compares a whole group of 16 control bytes at once (SSE2 or NEON
+// where available), so it usually touches one cache line of control bytes
+// and one slot.
+//
+// Both have the std::map / std::unordered_map interface this tree uses,
+// with two differences: FlatMap's value_type is std::pair<K, V>, whose key
+// must not be changed through an iterator, and any insert or erase can move
+// entries, so it invalidates every iterator and pointer into the map, not
+// just the ones to the erased entry. Keep values behind a std::unique_ptr
+// where their address has to stay put. Only FlatHashMap::erase() keeps the
+// other entries in place.
+
+namespace android {
+namespace base {
+
+template <class K, class V, class Compare = std::less<K>>
+class FlatMap {
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using key_compare = Compare;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using container_type = std::vector<value_type>;
+    using iterator = typename container_type::iterator;
+    using const_iterator = typename container_type::const_iterator;
+    using reverse_iterator = typename container_type::reverse_iterator;
+    using const_reverse_iterator = typename container_type::const_reverse_iterator;
+
+    FlatMap() = default;
+    explicit FlatMap(const Compare& compare) : mCompare(compare) {}
+    FlatMap(std::initializer_list<value_type> values, const Compare& compare = Compare())
+        : mCompare(compare) {
+        insert(values.begin(), values.end());
+    }
+    template <class InputIt>
+    FlatMap(InputIt first, InputIt last, const Compare& compare = Compare()) : mCompare(compare) {
+        insert(first, last);
+    }
+
+    iterator begin() { return mValues.begin(); }
+    const_iterator begin() const { return mValues.begin(); }
+    const_iterator cbegin() const { return mValues.cbegin(); }
+    iterator end() { return mValues.end(); }
+    const_iterator end() const { return mValues.end(); }
+    const_iterator cend() const { return mValues.cend(); }
+    reverse_iterator rbegin() { return mValues.rbegin(); }
+    const_reverse_iterator rbegin() const { return mValues.rbegin(); }
+    reverse_iterator rend() { return mValues.rend(); }
+    const_reverse_iterator rend() const { return mValues.rend(); }
+
+    bool empty() const { return mValues.empty(); }
+    size_type size() const { return mValues.size(); }
+    size_type capacity() const { return mValues.capacity(); }
+    void reserve(size_type count) { mValues.reserve(count); }
+    void shrink_to_fit() { mValues.shrink_to_fit(); }
+    void clear() { mValues.clear(); }
+    key_compare key_comp() const { return mCompare; }
+
+    iterator lower_bound(const K& key) {
+        return std::lower_bound(mValues.begin(), mValues.end(), key, KeyLess{mCompare});
+    }
+    const_iterator lower_bound(const K& key) const {
+        return std::lower_bound(mValues.begin(), mValues.end(), key, KeyLess{mCompare});
+    }
+    iterator upper_bound(const K& key) {
+        return std::upper_bound(mValues.begin(), mValues.end(), key, KeyLess{mCompare});
+    }
+    const_iterator upper_bound(const K& key) const {
+        return std::upper_bound(mValues.begin(), mValues.end(), key, KeyLess{mCompare});
+    }
+    std::pair<iterator, iterator> equal_range(const K& key) {
+        const iterator it = find(key);
+        return {it, it == end() ? it : std::next(it)};
+    }
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+        const const_iterator it = find(key);
+        return {it, it == end() ? it : std::next(it)};
+    }
+
+    iterator find(const K& key) {
+        const iterator it = lower_bound(key);
+        return it != end() && !mCompare(key, it->first) ? it : end();
+    }
+    const_iterator find(const K& key) const {
+        const const_iterator it = lower_bound(key);
+        return it != end() && !mCompare(key, it->first) ? it : end();
+    }
+    size_type count(const K& key) const { return find(key) != end() ? 1 : 0; }
+    bool contains(const K& key) const { return find(key) != end(); }
+
+    V& operator[](const K& key) { return try_emplace(key).first->second; }
+    V& operator[](K&& key) { return try_emplace(std::move(key)).first->second; }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+        iterator it = lower_bound(key);
+        if (it != end() && !mCompare(key, it->first)) {
+            return {it, false};
+        }
+        it = mValues.emplace(it, std::piecewise_construct, std::forward_as_tuple(key),
+                             std::forward_as_tuple(std::forward<Args>(args)...));
+        return {it, true};
+    }
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+        iterator it = lower_bound(key);
+        if (it != end() && !mCompare(key, it->first)) {
+            return {it, false};
+        }
+        it = mValues.emplace(it, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                             std::forward_as_tuple(std::forward<Args>(args)...));
+        return {it, true};
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return try_emplace(value.first, value.second);
+    }
+    std::pair<iterator, bool> insert(value_type&& value) {
+        return try_emplace(std::move(value.first), std::move(value.second));
+    }
+    template <class InputIt>
+    void insert(InputIt first, InputIt last) {
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const K& key, M&& value) {
+        auto result = try_emplace(key, std::forward<M>(value));
+        if (!result.second) {
+            result.first->second = std::forward<M>(value);
+        }
+        return result;
+    }
+
+    iterator erase(const_iterator pos) { return mValues.erase(pos); }
+    iterator erase(iterator pos) { return mValues.erase(pos); }
+    iterator erase(const_iterator first, const_iterator last) {
+        return mValues.erase(first, last);
+    }
+    size_type erase(const K& key) {
+        const iterator it = find(key);
+        if (it == end()) {
+            return 0;
+        }
+        mValues.erase(it);
+        return 1;
+    }
+
+    void swap(FlatMap& other) {
+        using std::swap;
+        swap(mValues, other.mValues);
+        swap(mCompare, other.mCompare);
+    }
+
+    friend bool operator==(const FlatMap& a, const FlatMap& b) { return a.mValues == b.mValues; }
+    friend bool operator!=(const FlatMap& a, const FlatMap& b) { return !(a == b); }
+
+private:
+    struct KeyLess {
+        const Compare& compare;
+        bool operator()(const value_type& value, const K& key) const {
+            return compare(value.first, key);
+        }
+        bool operator()(const K& key, const value_type& value) const {
+            return compare(key, value.first);
+        }
+    };
+
+    container_type mValues;
+    Compare mCompare;
+};
+
+namespace internal {
+
+// The control byte of a slot that never held a value, of one whose value
+// was erased, and the value of a full slot's byte is its hash's low 7 bits.
+constexpr int8_t kCtrlEmpty = -128;
+constexpr int8_t kCtrlDeleted = -2;
+constexpr size_t kGroupWidth = 16;
+
+inline int countTrailingZeros(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+// The slots of a group whose control bytes match, one bit (or, with NEON,
+// one nibble) per slot.
+class GroupMask {
+public:
+#if AEMU_FLAT_MAP_NEON
+    static constexpr int kShift = 2;
+#else
+    static constexpr int kShift = 0;
+#endif
+
+    explicit GroupMask(uint64_t bits) : mBits(bits) {}
+
+    explicit operator bool() const { return mBits != 0; }
+    size_t lowest() const { return countTrailingZeros(mBits) >> kShift; }
+    void clearLowest() { mBits &= mBits - 1; }
+
+private:
+    uint64_t mBits;
+};
+
+// 16 control bytes starting at any slot.
+class Group {
+public:
+    explicit Group(const int8_t* ctrl) {
+#if AEMU_FLAT_MAP_SSE2
+        mCtrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#elif AEMU_FLAT_MAP_NEON
+        mCtrl = vld1q_s8(ctrl);
+#else
+        memcpy(mCtrl, ctrl, kGroupWidth);
+#endif
+    }
+
+    GroupMask match(int8_t h2) const {
+#if AEMU_FLAT_MAP_SSE2
+        return GroupMask(static_cast<uint16_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(mCtrl, _mm_set1_epi8(h2)))));
+#elif AEMU_FLAT_MAP_NEON
+        return fromNeon(vceqq_s8(mCtrl, vdupq_n_s8(h2)));
+#else
+        uint64_t bits = 0;
+        for (size_t i = 0; i < kGroupWidth; ++i) {
+            bits |= uint64_t(mCtrl[i] == h2) << i;
+        }
+        return GroupMask(bits);
+#endif
+    }
+
+    GroupMask matchEmpty() const { return match(kCtrlEmpty); }
+
+    // Empty or deleted: the bytes with their sign bit set.
+    GroupMask matchFree() const {
+#if AEMU_FLAT_MAP_SSE2
+        return GroupMask(static_cast<uint16_t>(_mm_movemask_epi8(mCtrl)));
+#elif AEMU_FLAT_MAP_NEON
+        return fromNeon(vcltzq_s8(mCtrl));
+#else
+        uint64_t bits = 0;
+        for (size_t i = 0; i < kGroupWidth; ++i) {
+            bits |= uint64_t(mCtrl[i] < 0) << i;
+        }
+        return GroupMask(bits);
+#endif
+    }
+
+private:
+#if AEMU_FLAT_MAP_SSE2
+    __m128i mCtrl;
+#elif AEMU_FLAT_MAP_NEON
+    static GroupMask fromNeon(uint8x16_t matches) {
+        // Narrows each byte to a nibble, and keeps one bit of each.
+        const uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+        return GroupMask(vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) &
+                         0x8888888888888888ull);
+    }
+
+    int8x16_t mCtrl;
+#else
+    int8_t mCtrl[kGroupWidth];
+#endif
+};
+
+// Control bytes for a table with no slots, so that lookups need no check.
+inline const int8_t* emptyGroup() {
+    alignas(16) static const int8_t kEmpty[kGroupWidth] = {
+            kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty,
+            kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty,
+            kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty};
+    return kEmpty;
+}
+
+}  // namespace internal
+
+template <class K, class V, class Hash = std::hash<K>, class KeyEqual = std::equal_to<K>>
+class FlatHashMap {
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+
+    template <bool kConst>
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatHashMap::value_type;
+        using difference_type = ptrdiff_t;
+        using pointer = std::conditional_t<kConst, const value_type*, value_type*>;
+        using reference = std::conditional_t<kConst, const value_type&, value_type&>;
+
+        Iterator() = default;
+        // iterator converts to const_iterator.
+        template <bool kOtherConst, class = std::enable_if_t<kConst && !kOtherConst>>
+        Iterator(const Iterator<kOtherConst>& other)
+            : mCtrl(other.mCtrl), mSlot(other.mSlot), mEnd(other.mEnd) {}
+
+        reference operator*() const { return *mSlot; }
+        pointer operator->() const { return mSlot; }
+
+        Iterator& operator++() {
+            ++mCtrl;
+            ++mSlot;
+            skipFree();
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        friend bool operator==(const Iterator& a, const Iterator& b) { return a.mCtrl == b.mCtrl; }
+        friend bool operator!=(const Iterator& a, const Iterator& b) { return a.mCtrl != b.mCtrl; }
+
+    private:
+        friend class FlatHashMap;
+        template <bool>
+        friend class Iterator;
+
+        Iterator(const int8_t* ctrl, value_type* slot, const int8_t* end)
+            : mCtrl(ctrl), mSlot(slot), mEnd(end) {}
+
+        void skipFree() {
+            while (mCtrl != mEnd && *mCtrl < 0) {
+                ++mCtrl;
+                ++mSlot;
+            }
+        }
+
+        const int8_t* mCtrl = nullptr;
+        value_type* mSlot = nullptr;
+        const int8_t* mEnd = nullptr;
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    FlatHashMap() = default;
+    explicit FlatHashMap(size_type count) { reserve(count); }
+    FlatHashMap(std::initializer_list<value_type> values) {
+        reserve(values.size());
+        insert(values.begin(), values.end());
+    }
+    template <class InputIt>
+    FlatHashMap(InputIt first, InputIt last) {
+        insert(first, last);
+    }
+
+    FlatHashMap(const FlatHashMap& other) : mHash(other.mHash), mEqual(other.mEqual) {
+        reserve(other.size());
+        insert(other.begin(), other.end());
+    }
+    FlatHashMap(FlatHashMap&& other) noexcept { swap(other); }
+    FlatHashMap& operator=(const FlatHashMap& other) {
+        if (this != &other) {
+            FlatHashMap copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+    FlatHashMap& operator=(FlatHashMap&& other) noexcept {
+        if (this != &other) {
+            FlatHashMap moved(std::move(other));
+            swap(moved);
+        }
+        return *this;
+    }
+    ~FlatHashMap() { destroy(); }
+
+    iterator begin() {
+        iterator it(mCtrl, mSlots, mCtrl + mCapacity);
+        it.skipFree();
+        return it;
+    }
+    const_iterator begin() const { return const_cast<FlatHashMap*>(this)->begin(); }
+    const_iterator cbegin() const { return begin(); }
+    iterator end() { return iterator(mCtrl + mCapacity, mSlots + mCapacity, mCtrl + mCapacity); }
+    const_iterator end() const { return const_cast<FlatHashMap*>(this)->end(); }
+    const_iterator cend() const { return end(); }
+
+    bool empty() const { return mSize == 0; }
+    size_type size() const { return mSize; }
+    // Number of slots; the table grows when 7/8 of them are in use.
+    size_type capacity() const { return mCapacity; }
+
+    void clear() {
+        for (size_t i = 0; i < mCapacity; ++i) {
+            if (mCtrl[i] >= 0) {
+                mSlots[i].~value_type();
+            }
+        }
+        if (mCapacity) {
+            memset(mCtrl, internal::kCtrlEmpty, mCapacity + internal::kGroupWidth);
+        }
+        mSize = 0;
+        mDeleted = 0;
+    }
+
+    void reserve(size_type count) {
+        size_t capacity = internal::kGroupWidth;
+        while (maxLoad(capacity) < count) {
+            capacity *= 2;
+        }
+        if (capacity > mCapacity) {
+            rehash(capacity);
+        }
+    }
+
+    iterator find(const K& key) {
+        const size_t index = findIndex(key, hashOf(key));
+        return index == kNotFound ? end() : iteratorAt(index);
+    }
+    const_iterator find(const K& key) const { return const_cast<FlatHashMap*>(this)->find(key); }
+    size_type count(const K& key) const { return find(key) != end() ? 1 : 0; }
+    bool contains(const K& key) const { return find(key) != end(); }
+
+    V& operator[](const K& key) { return try_emplace(key).first->second; }
+    V& operator[](K&& key) { return try_emplace(std::move(key)).first->second; }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+        return emplaceKey(key, std::forward<Args>(args)...);
+    }
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+        return emplaceKey(std::move(key), std::forward<Args>(args)...);
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        std::pair<K, V> value(std::forward<Args>(args)...);
+        return emplaceKey(std::move(value.first), std::move(value.second));
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return emplaceKey(value.first, value.second);
+    }
+    std::pair<iterator, bool> insert(value_type&& value) {
+        return emplaceKey(value.first, std::move(value.second));
+    }
+    template <class InputIt>
+    void insert(InputIt first, InputIt last) {
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const K& key, M&& value) {
+        auto result = emplaceKey(key, std::forward<M>(value));
+        if (!result.second) {
+            result.first->second = std::forward<M>(value);
+        }
+        return result;
+    }
+
+    // Other entries stay where they are.
+    iterator erase(const_iterator pos) {
+        eraseIndex(static_cast<size_t>(pos.mCtrl - mCtrl));
+        iterator next(const_cast<int8_t*>(pos.mCtrl), const_cast<value_type*>(pos.mSlot),
+                      mCtrl + mCapacity);
+        next.skipFree();
+        return next;
+    }
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+    size_type erase(const K& key) {
+        const size_t index = findIndex(key, hashOf(key));
+        if (index == kNotFound) {
+            return 0;
+        }
+        eraseIndex(index);
+        return 1;
+    }
+
+    void swap(FlatHashMap& other) noexcept {
+        using std::swap;
+        swap(mCtrl, other.mCtrl);
+        swap(mSlots, other.mSlots);
+        swap(mCapacity, other.mCapacity);
+        swap(mSize, other.mSize);
+        swap(mDeleted, other.mDeleted);
+        swap(mHash, other.mHash);
+        swap(mEqual, other.mEqual);
+    }
+
+    friend bool operator==(const FlatHashMap& a, const FlatHashMap& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (const auto& value : a) {
+            const auto it = b.find(value.first);
+            if (it == b.end() || !(it->second == value.second)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    friend bool operator!=(const FlatHashMap& a, const FlatHashMap& b) { return !(a == b); }
+
+private:
+    static constexpr size_t kNotFound = ~size_t(0);
+
+    static size_t maxLoad(size_t capacity) { return capacity - capacity / 8; }
+
+    // std::hash of an integer is the integer itself on most standard
+    // libraries; spread it so that both the group and the 7 bit tag vary.
+    size_t hashOf(const K& key) const {
+        const uint64_t hash = static_cast<uint64_t>(mHash(key)) * 0x9e3779b97f4a7c15ull;
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+    static int8_t h2(size_t hash) { return static_cast<int8_t>(hash & 0x7f); }
+    static size_t h1(size_t hash) { return hash >> 7; }
+
+    iterator iteratorAt(size_t index) {
+        return iterator(mCtrl + index, mSlots + index, mCtrl + mCapacity);
+    }
+
+    size_t findIndex(const K& key, size_t hash) const {
+        if (!mCapacity) {
+            return kNotFound;
+        }
+        const size_t mask = mCapacity - 1;
+        size_t pos = h1(hash) & mask;
+        // Triangular steps of whole groups visit every group of a power of
+        // two table once.
+        for (size_t step = internal::kGroupWidth;; step += internal::kGroupWidth) {
+            const internal::Group group(mCtrl + pos);
+            for (auto match = group.match(h2(hash)); match; match.clearLowest()) {
+                const size_t index = (pos + match.lowest()) & mask;
+                if (mEqual(mSlots[index].first, key)) {
+                    return index;
+                }
+            }
+            if (group.matchEmpty()) {
+                return kNotFound;
+            }
+            pos = (pos + step) & mask;
+        }
+    }
+
+    // The first empty or deleted slot on |hash|'s probe sequence.
+    size_t findFree(size_t hash) const {
+        const size_t mask = mCapacity - 1;
+        size_t pos = h1(hash) & mask;
+        for (size_t step = internal::kGroupWidth;; step += internal::kGroupWidth) {
+            const auto free = internal::Group(mCtrl + pos).matchFree();
+            if (free) {
+                return (pos + free.lowest()) & mask;
+            }
+            pos = (pos + step) & mask;
+        }
+    }
+
+    void setCtrl(size_t index, int8_t value) {
+        mCtrl[index] = value;
+        // The first group is mirrored past the end, so that a group read
+        // near the end wraps around.
+        if (index < internal::kGroupWidth) {
+            mCtrl[mCapacity + index] = value;
+        }
+    }
+
+    template <class Key, class... Args>
+    std::pair<iterator, bool> emplaceKey(Key&& key, Args&&... args) {
+        const size_t hash = hashOf(key);
+        size_t index = findIndex(key, hash);
+        if (index != kNotFound) {
+            return {iteratorAt(index), false};
+        }
+        if (mSize + mDeleted + 1 > maxLoad(mCapacity)) {
+            // Mostly erased entries only need sweeping out.
+            const bool grow = !mCapacity || mSize + 1 > maxLoad(mCapacity) / 2;
+            rehash(grow ? std::max(internal::kGroupWidth, mCapacity * 2) : mCapacity);
+        }
+        index = findFree(hash);
+        if (mCtrl[index] == internal::kCtrlDeleted) {
+            --mDeleted;
+        }
+        new (&mSlots[index]) value_type(std::piecewise_construct,
+                                        std::forward_as_tuple(std::forward<Key>(key)),
+                                        std::forward_as_tuple(std::forward<Args>(args)...));
+        setCtrl(index, h2(hash));
+        ++mSize;
+        return {iteratorAt(index), true};
+    }
+
+    void eraseIndex(size_t index) {
+        mSlots[index].~value_type();
+        setCtrl(index, internal::kCtrlDeleted);
+        --mSize;
+        ++mDeleted;
+    }
+
+    void rehash(size_t capacity) {
+        int8_t* oldCtrl = mCtrl;
+        value_type* oldSlots = mSlots;
+        const size_t oldCapacity = mCapacity;
+
+        mCtrl = new int8_t[capacity + internal::kGroupWidth];
+        memset(mCtrl, internal::kCtrlEmpty, capacity + internal::kGroupWidth);
+        mSlots = std::allocator<value_type>().allocate(capacity);
+        mCapacity = capacity;
+        mDeleted = 0;
+        for (size_t i = 0; i < oldCapacity; ++i) {
+            if (oldCtrl[i] < 0) {
+                continue;
+            }
+            const size_t hash = hashOf(oldSlots[i].first);
+            const size_t index = findFree(hash);
+            new (&mSlots[index]) value_type(std::move(oldSlots[i]));
+            setCtrl(index, h2(hash));
+            oldSlots[i].~value_type();
+        }
+        if (oldCapacity) {
+            delete[] oldCtrl;
+            std::allocator<value_type>().deallocate(oldSlots, oldCapacity);
+        }
+    }
+
+    void destroy() {
+        if (!mCapacity) {
+            return;
+        }
+        clear();
+        delete[] mCtrl;
+        std::allocator<value_type>().deallocate(mSlots, mCapacity);
+        mCtrl = const_cast<int8_t*>(internal::emptyGroup());
+        mSlots = nullptr;
+        mCapacity = 0;
+    }
+
+    int8_t* mCtrl = const_cast<int8_t*>(internal::emptyGroup());
+    value_type* mSlots = nullptr;
+    size_t mCapacity = 0;
+    size_t mSize = 0;
+    size_t mDeleted = 0;
+    Hash mHash;
+    KeyEqual mEqual;
+};
+
+}  // namespace base
+}  // namespace android
@@ -13,15 +13,19 @@
 // limitations under the License.
 #pragma once
 
-#include "aemu/base/containers/Lookup.h"
+#include "aemu/base/containers/ConcurrentIndexMap.h"
 #include "aemu/base/containers/EntityManager.h"
 #include "aemu/base/synchronization/Lock.h"
 
-#include <unordered_map>
+#include <algorithm>
 
 namespace android {
 namespace base {
 
+// Handles below |maxIndex| live in an EntityManager, the rest in a hash map.
+// Lookups through get() and get_const() take no lock and never block, so
+// they don't contend with each other or with add() and remove(); writers are
+// serialized with a lock per half.
 template <size_t maxIndex,
           class IndexType, // must be castable to uint64_t
           class Data>
@@ -38,7 +42,7 @@ public:
     uint64_t add(const Data& data, size_t type) {
         uint64_t nextIndex = 0;
         {
-            SeqLock::ScopedWrite sw(&mEntityManagerLock);
+            AutoLock lock(mEntityManagerLock);
             nextIndex = (uint64_t)mEntityManager.nextFreeIndex();
             if (nextIndex < maxIndex) {
                 uint64_t resultHandle = mEntityManager.add(data, type);
@@ -70,7 +74,7 @@ public:
     uint64_t addFixed(IndexType index, const Data& data, size_t type) {
         uint64_t index_u64 = (uint64_t)EM::getHandleIndex(index);
         if (index_u64 < maxIndex) {
-            SeqLock::ScopedWrite sw(&mEntityManagerLock);
+            AutoLock lock(mEntityManagerLock);
             return mEntityManager.addFixed(index, data, type);
         } else {
             AutoLock lock(mMapLock);
@@ -88,7 +92,7 @@ public:
 
     void clear() {
         {
-            SeqLock::ScopedWrite sw(&mEntityManagerLock);
+            AutoLock lock(mEntityManagerLock);
             mEntityManager.clear();
         }
         {
@@ -101,7 +105,7 @@ public:
     void remove(IndexType index) {
         uint64_t index_u64 = (uint64_t)EM::getHandleIndex(index);
         if (index_u64 < maxIndex) {
-            SeqLock::ScopedWrite sw(&mEntityManagerLock);
+            AutoLock lock(mEntityManagerLock);
             mEntityManager.remove(index);
         } else {
             AutoLock lock(mMapLock);
@@ -112,26 +116,18 @@ public:
     Data* get(IndexType index) {
         uint64_t index_u64 = (uint64_t)EM::getHandleIndex(index);
         if (index_u64 < maxIndex) {
-            SeqLock::ScopedWrite sw(&mEntityManagerLock);
             return mEntityManager.get(index);
         } else {
-            AutoLock lock(mMapLock);
-            auto res = android::base::find(mMap, index_u64);
-            return res;
+            return mMap.find(index_u64);
         }
     }
 
     const Data* get_const(IndexType index) const {
         uint64_t index_u64 = (uint64_t)EM::getHandleIndex(index);
         if (index_u64 < maxIndex) {
-            const Data* res;
-            AEMU_SEQLOCK_READ_WITH_RETRY(&mEntityManagerLock,
-                res = mEntityManager.get_const(index));
-            return res;
+            return mEntityManager.get_const(index);
         } else {
-            AutoLock lock(mMapLock);
-            auto res = android::base::find(mMap, index_u64);
-            return res;
+            return mMap.find(index_u64);
         }
     }
 
@@ -151,42 +147,38 @@ public:
 
     void forEach(IterFunc func) {
         {
-            SeqLock::ScopedWrite sw(&mEntityManagerLock);
-            mEntityManager.forEach(func);
+            AutoLock lock(mEntityManagerLock);
+            mEntityManager.forEachEntry(func);
         }
 
         AutoLock lock(mMapLock);
-        for (auto it : mMap) {
-            auto handle = index2Handle(it.first);
-            func(true /* live */, handle, handle, it.second);
-        }
+        mMap.forEach([&func](uint64_t index, Data& data) {
+            func(true /* live */, index2Handle(index), data);
+        });
     }
 
     void forEachLive(IterFunc func) {
         {
-            SeqLock::ScopedWrite sw(&mEntityManagerLock);
-            mEntityManager.forEachLiveComponent(func);
+            AutoLock lock(mEntityManagerLock);
+            mEntityManager.forEachLiveEntry(func);
         }
 
         AutoLock lock(mMapLock);
-        for (auto it : mMap) {
-            auto handle = index2Handle(it.first);
-            func(true /* live */, handle, handle, it.second);
-        }
+        mMap.forEach([&func](uint64_t index, Data& data) {
+            func(true /* live */, index2Handle(index), data);
+        });
     }
 
     void forEachLive_const(ConstIterFunc func) const {
-        mEntityManager.forEachLiveEntry_const([this, func](bool live, Handle h, Data& d) {
-            AEMU_SEQLOCK_READ_WITH_RETRY(
-                &mEntityManagerLock,
-                func(live, h, d));
-        });
+        {
+            AutoLock lock(mEntityManagerLock);
+            mEntityManager.forEachLiveEntry_const(func);
+        }
 
         AutoLock lock(mMapLock);
-        for (const auto it : mMap) {
-            auto handle = index2Handle(it.first);
-            func(true /* live */, handle, handle, it.second);
-        }
+        mMap.forEach([&func](uint64_t index, const Data& data) {
+            func(true /* live */, index2Handle(index), data);
+        });
     }
 
 private:
@@ -195,9 +187,10 @@ private:
     }
 
     EM mEntityManager;
-    std::unordered_map<IndexType, Data> mMap;
+    ConcurrentIndexMap<Data> mMap;
     uint64_t mIndexForMap = 0;
-    mutable SeqLock mEntityManagerLock;
+    // Serialize writers; readers go without.
+    mutable Lock mEntityManagerLock;
     mutable Lock mMapLock;
 };
 
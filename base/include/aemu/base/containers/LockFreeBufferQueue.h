@@ -0,0 +1,354 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/containers/BufferQueue.h"
+#include "aemu/base/synchronization/AddressWait.h"
+#include "aemu/base/system/System.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+namespace base {
+
+// Fixed-capacity, lock-free counterparts of BufferQueue for handing buffers
+// between threads without a shared lock:
+//
+//   SpscBufferQueue - one producer thread and one consumer thread.
+//   MpmcBufferQueue - any number of either, after Dmitry Vyukov's bounded
+//                     MPMC queue.
+//
+// Both return BufferQueueResult like BufferQueue does. |waitUntilUs| is an
+// absolute getUnixTimeUs() deadline, or kAddressWaitForever. A blocked
+// thread sleeps in an AddressWaiter, so the other side only makes a system
+// call when the queue was empty or full and somebody is actually waiting.
+//
+// Unlike BufferQueue they never grow and have no snapshot mode. A push that
+// races with close() may still land; such items are dropped with the queue.
+// |T| must be default-constructible and move-assignable.
+
+namespace internal {
+
+inline size_t bufferQueueCapacity(size_t capacity) {
+    size_t res = 2;
+    while (res < capacity) {
+        res <<= 1;
+    }
+    return res;
+}
+
+// Retries |attempt| until it stops returning TryAgain, sleeping on |waiter|
+// in between.
+template <class Attempt>
+BufferQueueResult bufferQueueWait(AddressWaiter& waiter,
+                                  uint64_t waitUntilUs,
+                                  Attempt&& attempt) {
+    for (;;) {
+        BufferQueueResult res = attempt();
+        if (res != BufferQueueResult::TryAgain) {
+            return res;
+        }
+        uint64_t timeoutUs = kAddressWaitForever;
+        if (waitUntilUs != kAddressWaitForever) {
+            const uint64_t now = getUnixTimeUs();
+            if (now >= waitUntilUs) {
+                return BufferQueueResult::Timeout;
+            }
+            timeoutUs = waitUntilUs - now;
+        }
+        const uint32_t token = waiter.prepareWait();
+        res = attempt();
+        if (res != BufferQueueResult::TryAgain) {
+            waiter.cancelWait();
+            return res;
+        }
+        waiter.wait(token, timeoutUs);
+    }
+}
+
+}  // namespace internal
+
+template <class T>
+class SpscBufferQueue {
+    DISALLOW_COPY_ASSIGN_AND_MOVE(SpscBufferQueue);
+
+public:
+    using value_type = T;
+
+    // |capacity| is rounded up to a power of two.
+    explicit SpscBufferQueue(size_t capacity)
+        : mMask(internal::bufferQueueCapacity(capacity) - 1),
+          mSlots(new T[mMask + 1]) {}
+
+    size_t capacity() const { return mMask + 1; }
+
+    // Any thread; exact only when called by the producer or consumer.
+    size_t size() const {
+        return mTail.load(std::memory_order_acquire) -
+               mHead.load(std::memory_order_acquire);
+    }
+
+    // Producer only. Moves |buffer| in and returns Ok, or returns TryAgain
+    // if the queue is full or Error if it is closed.
+    BufferQueueResult tryPush(T&& buffer) {
+        return tryPushBatch(&buffer, 1) ? BufferQueueResult::Ok
+                                        : pushFailure();
+    }
+
+    // Producer only. Moves in as many of |buffers| as fit, with a single
+    // publish, and returns how many.
+    size_t tryPushBatch(T* buffers, size_t count) {
+        if (mClosed.load(std::memory_order_acquire)) {
+            return 0;
+        }
+        const size_t tail = mTail.load(std::memory_order_relaxed);
+        size_t room = capacity() - (tail - mCachedHead);
+        if (room < count) {
+            mCachedHead = mHead.load(std::memory_order_acquire);
+            room = capacity() - (tail - mCachedHead);
+        }
+        const size_t n = std::min(room, count);
+        if (!n) {
+            return 0;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            mSlots[(tail + i) & mMask] = std::move(buffers[i]);
+        }
+        mTail.store(tail + n, std::memory_order_release);
+        mCanPop.notify();
+        return n;
+    }
+
+    // Producer only. Waits for room; returns Ok, Error once closed, or
+    // Timeout.
+    BufferQueueResult push(T&& buffer,
+                           uint64_t waitUntilUs = kAddressWaitForever) {
+        return internal::bufferQueueWait(
+                mCanPush, waitUntilUs,
+                [this, &buffer] { return tryPush(std::move(buffer)); });
+    }
+
+    // Consumer only. Moves the oldest item into |*buffer| and returns Ok,
+    // or returns TryAgain if the queue is empty, or Error if it is also
+    // closed.
+    BufferQueueResult tryPop(T* buffer) {
+        return tryPopBatch(buffer, 1) ? BufferQueueResult::Ok : popFailure();
+    }
+
+    // Consumer only. Moves up to |maxCount| of the oldest items into
+    // |buffers|, with a single release of their slots, and returns how many.
+    size_t tryPopBatch(T* buffers, size_t maxCount) {
+        const size_t head = mHead.load(std::memory_order_relaxed);
+        size_t avail = mCachedTail - head;
+        if (avail < maxCount) {
+            mCachedTail = mTail.load(std::memory_order_acquire);
+            avail = mCachedTail - head;
+        }
+        const size_t n = std::min(avail, maxCount);
+        if (!n) {
+            return 0;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            buffers[i] = std::move(mSlots[(head + i) & mMask]);
+        }
+        mHead.store(head + n, std::memory_order_release);
+        mCanPush.notify();
+        return n;
+    }
+
+    // Consumer only. Waits for an item; returns Ok, Error once the queue is
+    // closed and empty, or Timeout.
+    BufferQueueResult pop(T* buffer,
+                          uint64_t waitUntilUs = kAddressWaitForever) {
+        return internal::bufferQueueWait(
+                mCanPop, waitUntilUs, [this, buffer] { return tryPop(buffer); });
+    }
+
+    // Any thread. Pushes fail from now on; pops drain what is left and then
+    // fail. Wakes all waiters.
+    void close() {
+        mClosed.store(true, std::memory_order_release);
+        mCanPop.notify();
+        mCanPush.notify();
+    }
+
+    bool isClosed() const { return mClosed.load(std::memory_order_acquire); }
+
+private:
+    BufferQueueResult pushFailure() const {
+        return isClosed() ? BufferQueueResult::Error
+                          : BufferQueueResult::TryAgain;
+    }
+
+    BufferQueueResult popFailure() {
+        // Check |mClosed| before the final emptiness check, so that items
+        // pushed before close() are never missed.
+        if (!isClosed()) {
+            return BufferQueueResult::TryAgain;
+        }
+        return mHead.load(std::memory_order_relaxed) ==
+                               mTail.load(std::memory_order_acquire)
+                       ? BufferQueueResult::Error
+                       : BufferQueueResult::TryAgain;
+    }
+
+    const size_t mMask;
+    std::unique_ptr<T[]> mSlots;
+    std::atomic<bool> mClosed{false};
+    AddressWaiter mCanPush;
+    AddressWaiter mCanPop;
+
+    // Each side has its own cache line: its index, and the last index of
+    // the other side it saw, so it only reads the shared one when it has
+    // to.
+    alignas(64) std::atomic<size_t> mHead{0};
+    size_t mCachedTail = 0;
+    alignas(64) std::atomic<size_t> mTail{0};
+    size_t mCachedHead = 0;
+};
+
+template <class T>
+class MpmcBufferQueue {
+    DISALLOW_COPY_ASSIGN_AND_MOVE(MpmcBufferQueue);
+
+public:
+    using value_type = T;
+
+    // |capacity| is rounded up to a power of two.
+    explicit MpmcBufferQueue(size_t capacity)
+        : mMask(internal::bufferQueueCapacity(capacity) - 1),
+          mCells(new Cell[mMask + 1]) {
+        for (size_t i = 0; i <= mMask; ++i) {
+            mCells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const { return mMask + 1; }
+
+    // Any thread; approximate. Counts slots claimed by producers that have
+    // not been consumed yet.
+    size_t size() const {
+        const size_t enqueued = mEnqueuePos.load(std::memory_order_acquire);
+        const size_t dequeued = mDequeuePos.load(std::memory_order_acquire);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    // Any thread. Same results as SpscBufferQueue::tryPush().
+    BufferQueueResult tryPush(T&& buffer) {
+        if (isClosed()) {
+            return BufferQueueResult::Error;
+        }
+        size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = mCells[pos & mMask];
+            const size_t seq = cell.seq.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (mEnqueuePos.compare_exchange_weak(
+                            pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(buffer);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    mCanPop.notify();
+                    return BufferQueueResult::Ok;
+                }
+            } else if (diff < 0) {
+                return BufferQueueResult::TryAgain;
+            } else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    BufferQueueResult push(T&& buffer,
+                           uint64_t waitUntilUs = kAddressWaitForever) {
+        return internal::bufferQueueWait(
+                mCanPush, waitUntilUs,
+                [this, &buffer] { return tryPush(std::move(buffer)); });
+    }
+
+    // Any thread. Same results as SpscBufferQueue::tryPop(). It may also
+    // return TryAgain for a short while when the next producer in line has
+    // claimed its slot but not filled it yet.
+    BufferQueueResult tryPop(T* buffer) {
+        const bool closed = isClosed();
+        size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = mCells[pos & mMask];
+            const size_t seq = cell.seq.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (mDequeuePos.compare_exchange_weak(
+                            pos, pos + 1, std::memory_order_relaxed)) {
+                    *buffer = std::move(cell.value);
+                    cell.seq.store(pos + mMask + 1, std::memory_order_release);
+                    mCanPush.notify();
+                    return BufferQueueResult::Ok;
+                }
+            } else if (diff < 0) {
+                return closed && !size() ? BufferQueueResult::Error
+                                         : BufferQueueResult::TryAgain;
+            } else {
+                pos = mDequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    BufferQueueResult pop(T* buffer,
+                          uint64_t waitUntilUs = kAddressWaitForever) {
+        return internal::bufferQueueWait(
+                mCanPop, waitUntilUs, [this, buffer] {
+                    BufferQueueResult res = tryPop(buffer);
+                    if (res == BufferQueueResult::TryAgain && size()) {
+                        // A producer is still filling in its slot.
+                        std::this_thread::yield();
+                    }
+                    return res;
+                });
+    }
+
+    void close() {
+        mClosed.store(true, std::memory_order_release);
+        mCanPop.notify();
+        mCanPush.notify();
+    }
+
+    bool isClosed() const { return mClosed.load(std::memory_order_acquire); }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    const size_t mMask;
+    std::unique_ptr<Cell[]> mCells;
+    std::atomic<bool> mClosed{false};
+    AddressWaiter mCanPush;
+    AddressWaiter mCanPop;
+
+    alignas(64) std::atomic<size_t> mEnqueuePos{0};
+    alignas(64) std::atomic<size_t> mDequeuePos{0};
+};
+
+}  // namespace base
+}  // namespace android
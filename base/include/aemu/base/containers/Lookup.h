@@ -15,6 +15,7 @@
 #pragma once
 
 #include "aemu/base/TypeTraits.h"
+#include "aemu/base/containers/FlatMap.h"
 
 #include <initializer_list>
 #include <set>
@@ -46,7 +47,9 @@ template <class T>
 using is_any_map = std::integral_constant<
         bool,
         is_template_instantiation_of<T, std::map>::value ||
-                is_template_instantiation_of<T, std::unordered_map>::value>;
+                is_template_instantiation_of<T, std::unordered_map>::value ||
+                is_template_instantiation_of<T, FlatMap>::value ||
+                is_template_instantiation_of<T, FlatHashMap>::value>;
 
 template <class T>
 using is_any_set = std::integral_constant<
@@ -19,11 +19,14 @@
 #include <algorithm>
 #include <initializer_list>
 #include <memory>
+#include <memory_resource>
 #include <type_traits>
 #include <utility>
 
+#include <assert.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 //
 // SmallVector<T>, SmallFixedVector<T, SmallSize>
@@ -47,6 +50,12 @@
 // Currenly only a limited subset of std::vector<>'s operations is implemented,
 // but fill free to add the ones you need.
 //
+// The dynamic array comes from malloc(), or from the std::pmr::memory_resource
+// a SmallFixedVector<> was constructed with, e.g. an arena from
+// MemoryResource.h. Like std::pmr containers, a moved-to vector takes the
+// resource of the source, a copy uses malloc() again, and assignment keeps
+// the resource of the target.
+//
 
 namespace android {
 namespace base {
@@ -146,6 +155,30 @@ public:
 
     void resize(size_type newSize) { resize_impl<true>(newSize); }
 
+    // Appends |size| bytes from |data|, which must hold whole elements.
+    // Only for trivially copyable types, where it is a single memcpy().
+    void append(const void* data, size_type size) {
+        static_assert(kTriviallyRelocatable,
+                      "append() copies raw bytes, |T| must be trivially "
+                      "copyable");
+        assert(size % sizeof(T) == 0);
+        const size_type count = size / sizeof(T);
+        if (!count) {
+            return;
+        }
+        grow_for_size(this->size() + count);
+        memcpy(this->mEnd, data, count * sizeof(T));
+        this->mEnd += count;
+    }
+
+    // Drops unused dynamically allocated capacity. The vector never goes
+    // back to its in-place storage, so an emptied vector keeps one slot.
+    void shrink_to_fit() {
+        if (isAllocated() && size() < capacity()) {
+            set_capacity(std::max<size_type>(size(), 1));
+        }
+    }
+
     // This version of resizing doesn't initialize the newly allocated elements
     // Useful for the cases when value-initialization is noticeably slow and
     // one wants to directly construct or memcpy the elements into the resized
@@ -155,7 +188,15 @@ public:
     // Returns if the current vector's buffer is dynamically allocated.
     bool isAllocated() const { return this->cbegin() != smallBufferStart(); }
 
+    // The resource the dynamic array comes from, null for malloc().
+    std::pmr::memory_resource* resource() const { return mResource; }
+
 protected:
+    // Elements of such types can be moved around with memcpy() and realloc()
+    // instead of being move-constructed one by one.
+    static constexpr bool kTriviallyRelocatable =
+            std::is_trivially_copyable<T>::value;
+
     // Hide the default constructor so only SmallFixedVector can be
     // instantiated.
     SmallVector() = default;
@@ -165,7 +206,23 @@ protected:
     void dtor() {
         this->destruct(this->begin(), this->end());
         if (isAllocated()) {
-            free(this->mBegin);
+            deallocate(this->mBegin, this->mCapacity);
+        }
+    }
+
+    T* allocate(size_type count) {
+        if (mResource) {
+            return static_cast<T*>(
+                    mResource->allocate(sizeof(T) * count, alignof(T)));
+        }
+        return static_cast<T*>(malloc(sizeof(T) * count));
+    }
+
+    void deallocate(T* array, size_type count) {
+        if (mResource) {
+            mResource->deallocate(array, sizeof(T) * count, alignof(T));
+        } else {
+            free(array);
         }
     }
 
@@ -214,23 +271,40 @@ protected:
         }
     }
 
-    // Sets the capacity() to be exacly |newCap|. Allocates the array
-    // dynamically, moves all elements over and (potentially) deallocates the
-    // old array.
+    // Sets the capacity() to be exacly |newCap|, which must be at least
+    // size(). Allocates the array dynamically, moves all elements over and
+    // (potentially) deallocates the old array. Trivially relocatable
+    // elements are moved with realloc(), which may grow the array in place,
+    // or a single memcpy() out of the in-place storage.
     // Doesn't change size(), only capacity().
     void set_capacity(size_type newCap) {
         // Here we can only be switching to the dynamic vector, as static one
         // always has its capacity on the maximum.
-        const auto newBegin = (T*)malloc(sizeof(T) * newCap);
-        if (!newBegin) {
-            abort();  // what else can we do here?
+        const auto oldSize = this->size();
+        T* newBegin;
+        if (kTriviallyRelocatable && isAllocated() && !mResource) {
+            newBegin = (T*)realloc(this->mBegin, sizeof(T) * newCap);
+            if (!newBegin) {
+                abort();  // what else can we do here?
+            }
+        } else {
+            newBegin = allocate(newCap);
+            if (!newBegin) {
+                abort();  // what else can we do here?
+            }
+            if (kTriviallyRelocatable) {
+                if (oldSize) {
+                    memcpy(newBegin, this->mBegin, sizeof(T) * oldSize);
+                }
+            } else {
+                std::uninitialized_copy(
+                        std::make_move_iterator(this->begin()),
+                        std::make_move_iterator(this->end()), newBegin);
+            }
+            dtor();
         }
-        const auto newEnd = std::uninitialized_copy(
-                std::make_move_iterator(this->begin()),
-                std::make_move_iterator(this->end()), newBegin);
-        dtor();
         this->mBegin = newBegin;
-        this->mEnd = newEnd;
+        this->mEnd = newBegin + oldSize;
         this->mCapacity = newCap;
     }
 
@@ -255,6 +329,8 @@ protected:
     // Standard set of members for a vector - begin, end and capacity.
     // These point to the currently used chunk of memory, no matter if it's a
     // heap-allocated one or an in-place array.
+    // Not between mCapacity and the in-place storage, see smallBufferStart().
+    std::pmr::memory_resource* mResource = nullptr;
     iterator mBegin;
     iterator mEnd;
     size_type mCapacity;
@@ -306,6 +382,12 @@ public:
         init_inplace();
     }
 
+    // An empty vector that grows into memory from |resource|.
+    explicit SmallFixedVector(std::pmr::memory_resource* resource)
+        : SmallFixedVector() {
+        this->mResource = resource;
+    }
+
     // Ctor from a range of iterators
     template <class Iter>
     SmallFixedVector(Iter b, Iter e) : SmallFixedVector() {
@@ -333,6 +415,7 @@ public:
         : SmallFixedVector(other.begin(), other.end()) {}
 
     SmallFixedVector(SmallFixedVector&& other) {
+        this->mResource = other.mResource;
         if (other.isAllocated()) {
             // Just steal the allocated memory from the |other|.
             this->mBegin = other.mBegin;
@@ -358,7 +441,7 @@ public:
     }
 
     SmallFixedVector& operator=(SmallFixedVector&& other) {
-        if (other.isAllocated()) {
+        if (other.isAllocated() && other.mResource == this->mResource) {
             // Steal it and we're done.
             this->dtor();
             this->mBegin = other.mBegin;
@@ -368,7 +451,11 @@ public:
             return *this;
         }
 
-        if (this->isAllocated() && this->mCapacity < other.size()) {
+        if (other.isAllocated()) {
+            // The array belongs to another resource: move the elements.
+            this->clear();
+            this->grow_for_size(other.size());
+        } else if (this->isAllocated() && this->mCapacity < other.size()) {
             // Not enough dynamic memory, switch to in-place.
             this->dtor();
             init_inplace();
@@ -12,9 +12,13 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#pragma once
+
 #include "aemu/base/Optional.h"
+#include "aemu/base/synchronization/EpochReclaimer.h"
 #include "aemu/base/synchronization/Lock.h"
 
+#include <atomic>
 #include <functional>
 #include <unordered_map>
 
@@ -23,60 +27,104 @@ namespace base {
 
 // Static map class for use with LazyInstance or in global structures
 // as a process-wide registry of something. Safe for concurrent accress.
+//
+// Lookups are read-mostly and never take a lock: the items live in an
+// immutable table that readers reach through an atomic pointer, inside an
+// EpochReclaimer::ReadScope. Every change copies the table under |mLock|,
+// publishes the copy and retires the old one, so writes cost O(size) and
+// this is meant for registries that change rarely. Use withValue() to
+// inspect a value in place instead of copying it out with get().
 template <class K, class V>
 class StaticMap {
 public:
     StaticMap() = default;
 
+    ~StaticMap() { delete mTable.load(std::memory_order_relaxed); }
+
     void set(const K& key, const V& value) {
-        AutoLock lock(mLock);
-        mItems.emplace(key, value);
+        update([&key, &value](Table& items) { items.emplace(key, value); });
     }
 
     void erase(const K& key) {
-        AutoLock lock(mLock);
-        mItems.erase(key);
+        update([&key](Table& items) { items.erase(key); });
     }
 
     bool isPresent(const K& key) const {
-        AutoLock lock(mLock);
-        auto it = mItems.find(key);
-        return it != mItems.end();
+        return withValue(key, [](const V&) {});
     }
 
     android::base::Optional<V> get(const K& key) const {
-        AutoLock lock(mLock);
-        auto it = mItems.find(key);
-        if (it == mItems.end()) {
-            return android::base::kNullopt;
+        android::base::Optional<V> res;
+        withValue(key, [&res](const V& value) { res = value; });
+        return res;
+    }
+
+    // Calls |fn| with a reference to the value for |key|, if there is one,
+    // and returns whether there was. The reference is only valid during the
+    // call; |fn| sees the map as it was when the lookup started.
+    template <class Fn>
+    bool withValue(const K& key, Fn&& fn) const {
+        EpochReclaimer::ReadScope scope;
+        const Table* items = mTable.load(std::memory_order_acquire);
+        if (!items) {
+            return false;
+        }
+        auto it = items->find(key);
+        if (it == items->end()) {
+            return false;
         }
-        return it->second;
+        fn(it->second);
+        return true;
     }
 
     using ErasePredicate = std::function<bool(K, V)>;
 
     void eraseIf(ErasePredicate p) {
-        AutoLock lock(mLock);
-        auto it = mItems.begin();
-        for (; it != mItems.end();) {
-            if (p(it->first, it->second)) {
-                it = mItems.erase(it);
-            } else {
-                ++it;
+        update([&p](Table& items) {
+            auto it = items.begin();
+            for (; it != items.end();) {
+                if (p(it->first, it->second)) {
+                    it = items.erase(it);
+                } else {
+                    ++it;
+                }
             }
-        }
+        });
     }
 
     void clear() {
         AutoLock lock(mLock);
-        mItems.clear();
+        publish(nullptr);
     }
 private:
     using AutoLock = android::base::AutoLock;
     using Lock = android::base::Lock;
+    using Table = std::unordered_map<K, V>;
+
+    template <class Fn>
+    void update(Fn&& fn) {
+        AutoLock lock(mLock);
+        const Table* current = mTable.load(std::memory_order_relaxed);
+        Table* next = current ? new Table(*current) : new Table();
+        fn(*next);
+        publish(next);
+    }
+
+    // Requires |mLock|.
+    void publish(Table* next) {
+        const Table* old = mTable.exchange(next, std::memory_order_acq_rel);
+        if (old) {
+            EpochReclaimer::get().retire(const_cast<Table*>(old),
+                                         &deleteTable);
+        }
+    }
+
+    static void deleteTable(void* table) {
+        delete static_cast<Table*>(table);
+    }
 
-    mutable android::base::Lock mLock;
-    std::unordered_map<K, V> mItems;
+    android::base::Lock mLock;
+    std::atomic<const Table*> mTable{nullptr};
 };
 
 } // namespace base
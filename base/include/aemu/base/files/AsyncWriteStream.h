@@ -0,0 +1,124 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/AlignedBuf.h"
+#include "aemu/base/Compiler.h"
+#include "aemu/base/files/Stream.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+namespace base {
+
+struct AsyncWriteOptions {
+    // Size of each staging buffer, rounded up to a multiple of
+    // AsyncWriteStream::kAlignment.
+    size_t bufferSize = 1 << 20;
+    // Number of staging buffers, at most AsyncWriteStream::kMaxBuffers.
+    int bufferCount = 4;
+    // Bypass the page cache (O_DIRECT on Linux, F_NOCACHE on macOS) where
+    // the file system allows it.
+    bool direct = false;
+    // Use the writer thread even where io_uring is available.
+    bool forceThreadWriter = false;
+};
+
+// A write-only Stream to a file that hands full buffers to the kernel
+// asynchronously, so whoever produces the data (e.g. snapshot compression)
+// overlaps with disk writeback instead of alternating with it.
+//
+// Data is copied into a ring of aligned staging buffers. A full buffer is
+// submitted at its file offset and the next free one is used; write() only
+// blocks when every buffer is in flight. On Linux the buffers are
+// registered with an io_uring; elsewhere, or if io_uring is not available,
+// a writer thread issues pwrite() calls instead.
+//
+// Write errors are sticky: once one fails, write(), flush() and close()
+// return its -errno value.
+class AsyncWriteStream : public Stream {
+public:
+    static constexpr size_t kAlignment = 4096;
+    static constexpr int kMaxBuffers = 16;
+
+    // Creates or truncates |path|. Returns nullptr if it can't be opened.
+    static std::unique_ptr<AsyncWriteStream> create(
+            const std::string& path,
+            const AsyncWriteOptions& options = AsyncWriteOptions());
+
+    ~AsyncWriteStream() override;
+
+    // Always fails with -EINVAL.
+    ssize_t read(void* buffer, size_t size) override;
+    ssize_t write(const void* buffer, size_t size) override;
+
+    // Writes out everything buffered so far and waits for it to complete.
+    // Returns 0 or a -errno value.
+    int flush();
+
+    // flush(), then closes the file. Later writes fail with -EBADF.
+    int close();
+
+    // Bytes written to the stream so far.
+    uint64_t size() const { return mSize; }
+
+    // "io_uring" or "thread".
+    const char* backendName() const;
+
+    // True if the page cache is bypassed.
+    bool isDirect() const { return mDirect; }
+
+private:
+    class Writer;
+    class ThreadWriter;
+    class UringWriter;
+
+    using Buffer = AlignedBuf<uint8_t, kAlignment>;
+
+    AsyncWriteStream(int fd, bool direct, const AsyncWriteOptions& options);
+
+    // Makes mCurrent a free buffer, waiting for one if needed.
+    bool acquireBuffer();
+    // Hands mFill bytes of mCurrent to the writer.
+    void submitCurrent();
+    // Waits for one in-flight buffer.
+    void reap();
+    void reapAll();
+
+    int mFd;
+    const bool mDirect;
+    const size_t mBufferSize;
+    std::vector<Buffer> mBuffers;
+    std::vector<int> mFree;
+    int mCurrent = -1;
+    size_t mFill = 0;
+    int mInFlight = 0;
+    // File offset of mCurrent's first byte.
+    uint64_t mOffset = 0;
+    uint64_t mSize = 0;
+    int mError = 0;
+    std::unique_ptr<Writer> mWriter;
+
+    DISALLOW_COPY_AND_ASSIGN(AsyncWriteStream);
+};
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,58 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/files/Stream.h"
+
+#include <vector>
+
+namespace android {
+namespace base {
+
+// A write-only Stream that collects small writes, such as the put*() calls
+// of a snapshot saver, and passes them on to |output| in large chunks:
+//
+//     BufferedWriteStream buffered(stream);
+//     device->save(&buffered);
+//
+// Data reaches |output| on flush() or destruction, so don't write to |output|
+// directly while a BufferedWriteStream on top of it has pending data.
+class BufferedWriteStream : public Stream {
+    DISALLOW_COPY_AND_ASSIGN(BufferedWriteStream);
+
+public:
+    static constexpr size_t kDefaultBufferSize = 64 * 1024;
+
+    explicit BufferedWriteStream(Stream& output,
+                                 size_t bufferSize = kDefaultBufferSize);
+    ~BufferedWriteStream();
+
+    ssize_t read(void* buffer, size_t size) override;
+    ssize_t write(const void* buffer, size_t size) override;
+
+    // Passes the pending data on to |output|. Returns false if that, or any
+    // earlier write to |output|, failed.
+    bool flush();
+
+private:
+    Stream& mOutput;
+    std::vector<char> mBuffer;
+    size_t mUsed = 0;
+    bool mError = false;
+};
+
+}  // namespace base
+}  // namespace android
@@ -15,25 +15,106 @@
 
 #include "aemu/base/Compiler.h"
 #include "aemu/base/containers/SmallVector.h"
+#include "aemu/base/files/CompressionCodec.h"
 #include "aemu/base/files/Stream.h"
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
 
 namespace android {
 namespace base {
 
+template <class ItemT>
+class ThreadPool;
+
+// CompressingStream compresses everything written to it into |output|, with
+// LZ4 or, in block mode, the codec of BlockOptions::codec.
+//
+// The default constructor keeps the original format: one LZ4 stream,
+// buffered in memory and saved with saveBuffer() from the destructor. It must
+// be read back with DecompressingStream(Stream&).
+//
+// The BlockOptions constructor instead splits the input into independent
+// |blockSize| blocks that are compressed on a thread pool, and written to
+// |output| in order as soon as they are done; at most |maxBlocksInFlight|
+// blocks are held in memory at any time. The block format is:
+//
+//   be32 kBlockFormatMagic, be32 blockSize
+//     or, for any codec but plain LZ4 without a dictionary,
+//   be32 kCodecFormatMagic, be32 blockSize, be32 codec, be32 dictionaryId
+//     or, with checksums,
+//   be32 kChecksumFormatMagic, be32 blockSize, be32 codec, be32 dictionaryId
+//   per block: be32 index, be32 rawSize, be32 compressedSize,
+//              [be64 xxh3Hash64() of the raw data, with checksums,] data
+//   be32 kBlockFormatEnd
+//   be32 blockCount, be64 offset of each block header from the start
+//
+// It must be read back with DecompressingStream(Stream&, BlockOptions), which
+// can also decompress in parallel and seek to a block.
 class CompressingStream : public Stream {
     DISALLOW_COPY_AND_ASSIGN(CompressingStream);
 
 public:
+    static constexpr uint32_t kBlockFormatMagic = 0x4c5a3442;  // 'LZ4B'
+    static constexpr uint32_t kCodecFormatMagic = 0x434d5042;  // 'CMPB'
+    static constexpr uint32_t kChecksumFormatMagic = 0x434d5043;  // 'CMPC'
+    static constexpr uint32_t kBlockFormatEnd = 0xffffffff;
+
+    struct BlockOptions {
+        // Uncompressed size of each block.
+        uint32_t blockSize = 1024 * 1024;
+        // Number of compression threads; 0 means one per CPU core.
+        int threadCount = 0;
+        // Blocks queued or being compressed before write() waits for the
+        // oldest one; 0 means twice the thread count.
+        size_t maxBlocksInFlight = 0;
+        // How blocks are compressed; see CodecOptions::forPayload(). Codecs
+        // this build lacks fall back to LZ4.
+        CodecOptions codec;
+        // Stores a hash of each block's uncompressed data, computed on the
+        // compression threads and checked on the decompression threads, so
+        // that a corrupt block is caught at load time and by index.
+        bool checksums = false;
+    };
+
     CompressingStream(Stream& output);
+    CompressingStream(Stream& output, const BlockOptions& options);
     ~CompressingStream();
 
     ssize_t read(void* buffer, size_t size) override;
     ssize_t write(const void* buffer, size_t size) override;
 
 private:
+    struct Block;
+
+    ssize_t writeBlocks(const void* buffer, size_t size);
+    void submitBlock();
+    // Writes out finished blocks from the front of mInFlight, waiting for
+    // them if |waitForAll| or while there are too many blocks in flight.
+    void flushBlocks(bool waitForAll);
+    void writeBlock(const Block& block);
+    void finishBlocks();
+
     Stream& mOutput;
-    void* mLzStream;
+    void* mLzStream = nullptr;
     SmallFixedVector<char, 512> mBuffer;
+
+    // Block mode only.
+    const bool mBlockMode = false;
+    BlockOptions mOptions;
+    std::unique_ptr<ThreadPool<Block*>> mPool;
+    std::unique_ptr<Block> mCurrent;
+    std::deque<std::unique_ptr<Block>> mInFlight;
+    std::vector<uint64_t> mBlockOffsets;
+    uint64_t mBytesWritten = 0;
+    uint32_t mNextIndex = 0;
+    bool mError = false;
+    Lock mLock;
+    ConditionVariable mBlockDone;
 };
 
 }  // namespace base
@@ -0,0 +1,99 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace base {
+
+// The codecs CompressingStream can use in block mode. The values are stored
+// in the stream header, so they must not change.
+enum class CompressionCodec : uint32_t {
+    Lz4 = 0,
+    // Slower to compress than LZ4 for a better ratio; as fast to decompress.
+    Lz4Hc = 1,
+    // Only with AEMU_BASE_USE_ZSTD.
+    Zstd = 2,
+};
+
+// Kinds of snapshot data, each with a codec that suits it.
+enum class PayloadClass {
+    // Anything else: plain LZ4, readable by every version.
+    Default,
+    // Many small, repetitive records such as pipe headers, ASG configs and
+    // sync timelines. Uses the kDeviceStateDictionaryId dictionary if one
+    // is registered.
+    DeviceState,
+    // Texture and decoded frame data.
+    Texture,
+    // Guest RAM pages.
+    Ram,
+};
+
+// The dictionary PayloadClass::DeviceState uses, once registered.
+constexpr uint32_t kDeviceStateDictionaryId = 1;
+
+struct CodecOptions {
+    CompressionCodec codec = CompressionCodec::Lz4;
+    // The LZ4 acceleration, LZ4 HC level or zstd level; 0 picks the codec's
+    // default.
+    int level = 0;
+    // A zstd dictionary passed to registerCompressionDictionary(); 0 for
+    // none.
+    uint32_t dictionaryId = 0;
+
+    // The codec for |payload|, falling back to LZ4 variants when zstd is
+    // not built in.
+    static CodecOptions forPayload(PayloadClass payload);
+};
+
+// Whether this build can compress and decompress with |codec|.
+bool isCodecAvailable(CompressionCodec codec);
+
+// Makes |size| bytes at |data| usable as zstd dictionary |id|. The id is
+// written into the streams that use it, so readers must register the same
+// bytes under the same id. Returns false if zstd is not built in, |id| is 0
+// or already taken, or the dictionary is unusable.
+bool registerCompressionDictionary(uint32_t id, const void* data, size_t size);
+bool hasCompressionDictionary(uint32_t id);
+
+// Trains a zstd dictionary of at most |maxSize| bytes from |samples|, e.g.
+// device state records taken from sample snapshots, for use with
+// registerCompressionDictionary(). Meant to run offline. Returns an empty
+// vector on failure or without zstd.
+std::vector<char> trainCompressionDictionary(
+        const std::vector<std::string>& samples,
+        size_t maxSize = 64 * 1024);
+
+// One-shot compression of single blocks, as CompressingStream does.
+//
+// The most bytes compressing |size| bytes can produce.
+size_t codecCompressBound(CompressionCodec codec, size_t size);
+// Returns the compressed size, or 0 on failure.
+size_t codecCompress(const CodecOptions& options,
+                     const void* src, size_t size,
+                     void* dst, size_t capacity);
+// Returns true if exactly |rawSize| bytes were decompressed.
+bool codecDecompress(CompressionCodec codec, uint32_t dictionaryId,
+                     const void* src, size_t size,
+                     void* dst, size_t rawSize);
+
+}  // namespace base
+}  // namespace android
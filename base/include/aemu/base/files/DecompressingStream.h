@@ -15,26 +15,136 @@
 #pragma once
 
 #include "aemu/base/Compiler.h"
-#include "aemu/base/containers/SmallVector.h"
+#include "aemu/base/files/CompressionCodec.h"
 #include "aemu/base/files/Stream.h"
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <vector>
 
 namespace android {
 namespace base {
 
+class FunctorThread;
+template <class ItemT>
+class ThreadPool;
+
+// Reads back what a CompressingStream wrote. Use the constructor that matches
+// the one the data was written with; see CompressingStream.h for the formats.
+//
+// Compressed data is pulled from |input| as it is needed, so memory use does
+// not depend on the size of the data. In block mode a background thread reads
+// and decompresses up to |maxBlocksInFlight| blocks ahead of read(). Either
+// way, the destructor leaves |input| positioned right after the compressed
+// data, consuming the rest of it unless |input| can seek.
 class DecompressingStream : public Stream {
     DISALLOW_COPY_AND_ASSIGN(DecompressingStream);
 
 public:
+    struct BlockOptions {
+        // Number of decompression threads; 0 means one per CPU core.
+        int threadCount = 0;
+        // Blocks read and decompressed ahead of the read position; 0 means
+        // twice the thread count.
+        size_t maxBlocksInFlight = 0;
+    };
+
     DecompressingStream(Stream& input);
+    DecompressingStream(Stream& input, const BlockOptions& options);
     ~DecompressingStream();
 
+    // In block mode, returns fewer bytes than requested at the end of the
+    // data, and -EIO if the input was malformed.
     ssize_t read(void* buffer, size_t size) override;
     ssize_t write(const void* buffer, size_t size) override;
 
+    // Block mode only: the uncompressed size of every block but the last.
+    uint32_t blockSize() const { return mBlockSize; }
+
+    // Block mode only: the number of blocks if |input| can seek, as they are
+    // indexed up front then; 0 otherwise.
+    size_t blockCount() const { return mBlockOffsets.size(); }
+
+    // Block mode only: whether every block carries a checksum, verified on
+    // the decompression threads as each block is decoded.
+    bool hasChecksums() const { return mChecksums; }
+
+    // Block mode only: once read() has returned -EIO, the index of the block
+    // that didn't decompress or didn't match its checksum, if the fault was
+    // in one block's data rather than in the framing. Call it from the
+    // thread that reads.
+    std::optional<size_t> failedBlock() const { return mFailedBlock; }
+
+    // Block mode only: makes the next read() start at the beginning of block
+    // |index|. If |input| can seek, any block can be reached. Otherwise it is
+    // read sequentially and only forward seeks are possible, skipping over
+    // the data before |index|. Returns false if there is no such block, or
+    // it is behind the current one on an input that can't seek.
+    bool seekToBlock(size_t index);
+
 private:
-    void* mLzStream;
-    SmallFixedVector<char, 512> mBuffer;
-    int mBufferPos = 0;
+    struct Block;
+
+    // Legacy format.
+    bool fillWindow(size_t wanted);
+
+    // Block format.
+    void startBlocks();
+    // Seekable input only: records where each block starts and where the
+    // data ends, then goes back to the first block.
+    bool indexBlocks(int64_t start);
+    void startReader(size_t firstIndex);
+    // Seekable input only: stops the reader and drops the blocks it read.
+    void stopReader();
+    void readerLoop(size_t firstIndex);
+    void decodeBlock(Block* block);
+    bool seekToIndexedBlock(size_t index);
+    ssize_t readBlocks(void* buffer, size_t size);
+    // Drops the front block of mBlocks once it is no longer being decoded.
+    void popBlockLocked();
+
+    Stream& mInput;
+
+    // Legacy format only: a window on the compressed buffer, refilled from
+    // |mInput| on demand.
+    void* mLzStream = nullptr;
+    std::vector<char> mWindow;
+    size_t mWindowPos = 0;
+    size_t mInputRemaining = 0;
+
+    // Block format only.
+    const bool mBlockMode = false;
+    BlockOptions mOptions;
+    uint32_t mBlockSize = 0;
+    CompressionCodec mCodec = CompressionCodec::Lz4;
+    uint32_t mDictionaryId = 0;
+    bool mChecksums = false;
+    // Seekable input only: the position of each block header, and of the
+    // first byte after the compressed data.
+    std::vector<int64_t> mBlockOffsets;
+    int64_t mEndPosition = -1;
+    std::unique_ptr<ThreadPool<Block*>> mPool;
+    std::unique_ptr<FunctorThread> mReader;
+    size_t mCurrentPos = 0;
+    Lock mLock;
+    // Signalled when a block is added or decoded, or the input ends.
+    ConditionVariable mBlockReady;
+    // Signalled when there is room in mBlocks, or the reader should skip.
+    ConditionVariable mRoomForBlock;
+    // Everything below is guarded by mLock.
+    std::deque<std::unique_ptr<Block>> mBlocks;
+    // Index of the block read() expects next.
+    size_t mNextBlock = 0;
+    // The reader discards blocks below this index without decoding them.
+    size_t mSkipBefore = 0;
+    bool mInputDone = false;
+    bool mStopReader = false;
+    bool mError = false;
+    std::optional<size_t> mFailedBlock;
 };
 
 }  // namespace base
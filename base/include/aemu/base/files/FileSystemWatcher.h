@@ -15,10 +15,12 @@
 #pragma once
 
 #include <stddef.h>       // for size_t
+#include <chrono>         // for milliseconds
 #include <functional>     // for function
 #include <memory>         // for unique_ptr
 #include <string>         // for std::string
 #include <unordered_set>  // for unordered_set
+#include <vector>         // for vector
 
 namespace android {
 namespace base {
@@ -26,9 +28,9 @@ namespace base {
 // Listens to the file system change notifications and raises events when a
 // directory, or file in a directory, changes.
 //
-// Note: Each observer consumes one thread.
-// Note: It is very expensive on mac os, so do not observe large directory
-// structures with this.
+// All watchers in the process share one notification handle and one thread,
+// which runs the callbacks; stop() waits for a callback that is running,
+// unless called from one. Only Linux (inotify) is implemented.
 class FileSystemWatcher {
 public:
     // On one day we will have std::filesystem everywhere..
@@ -46,6 +48,25 @@ public:
     using FileSystemWatcherCallback =
             std::function<void(WatcherChangeType, const Path&)>;
 
+    struct Change {
+        WatcherChangeType type;
+        Path path;
+    };
+    // Changes in the order each path first changed, one per path.
+    using FileSystemWatcherBatchCallback =
+            std::function<void(const std::vector<Change>&)>;
+
+    struct Options {
+        // Changes are held for this long after the first one of a batch and
+        // then delivered together, with the changes to each path merged:
+        // e.g. Created then Changed is Created, Created then Deleted is
+        // dropped. 0 delivers whatever a single read of the queue returned.
+        std::chrono::milliseconds debounce{0};
+        // Also watches every subdirectory, and ones created later. Linux has
+        // no recursive watch, so this still takes one watch per directory.
+        bool recursive = false;
+    };
+
     FileSystemWatcher(FileSystemWatcherCallback callback)
         : mChangeCallback(callback) {}
     virtual ~FileSystemWatcher() = default;
@@ -59,6 +80,12 @@ public:
             Path path,
             FileSystemWatcherCallback onChangeCallback);
 
+    // Like the above, but delivers coalesced batches.
+    static std::unique_ptr<FileSystemWatcher> getFileSystemWatcher(
+            Path path,
+            FileSystemWatcherBatchCallback onChanges,
+            Options options);
+
     FileSystemWatcherCallback mChangeCallback;
 };
 }  // namespace base
@@ -40,6 +40,7 @@ public:
     // Stream interface implementation.
     ssize_t read(void* buffer, size_t size) override;
     ssize_t write(const void* buffer, size_t size) override;
+    const char* readInPlace(size_t size) override;
 
     // A way to put/get strings/buffers in-place as well.
     // Returns nullptr if the size of the resulting string
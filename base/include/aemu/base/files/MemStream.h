@@ -17,21 +17,46 @@
 #include "aemu/base/CppMacros.h"
 #include "aemu/base/files/Stream.h"
 
+#include <algorithm>
+#include <memory_resource>
 #include <vector>
 
 namespace android {
 namespace base {
 
 // An implementation of the Stream interface on top of a vector.
+//
+// A Segmented stream instead keeps its bytes in a list of kSegmentSize
+// chunks drawn from a process-wide pool, so growing never reallocates or
+// copies what was written, and the memory is reused by the next segmented
+// stream once this one is gone. Use it for large snapshot sections; the
+// written bytes can be handed out without a copy with forEachSegment() or
+// appendSegmentsTo(). Segments may also come from a memory_resource, like a
+// BumpPoolResource, for streams that are dropped together with their arena.
 class MemStream : public Stream {
 public:
     using Buffer = std::vector<char>;
 
+    enum class Layout { Contiguous, Segmented };
+    static constexpr size_t kSegmentSize = 256 * 1024;
+
     MemStream(int reserveSize = 512);
     MemStream(Buffer&& data);
+    explicit MemStream(Layout layout, size_t reserveSize = 0);
+    // A segmented stream with segments from |resource|, which must outlive
+    // the stream.
+    explicit MemStream(std::pmr::memory_resource* resource,
+                       size_t reserveSize = 0);
+    ~MemStream();
+
+    MemStream(MemStream&& other) noexcept;
+    MemStream& operator=(MemStream&& other) noexcept;
+
+    bool segmented() const { return mLayout == Layout::Segmented; }
 
-    MemStream(MemStream&& other) = default;
-    MemStream& operator=(MemStream&& other) = default;
+    // Makes room for |size| bytes in total, so writing that much doesn't
+    // allocate.
+    void reserve(size_t size);
 
     int writtenSize() const;
     int readPos() const;
@@ -40,23 +65,62 @@ public:
     // Stream interface implementation.
     ssize_t read(void* buffer, size_t size) override;
     ssize_t write(const void* buffer, size_t size) override;
+    ssize_t writev(const IOVector& iov) override;
+    // Segmented streams only point at runs within one segment.
+    const char* readInPlace(size_t size) override;
+    int64_t readPosition() const override { return mReadPos; }
+    bool seekRead(int64_t position) override;
 
     // protobuf support
     void setProtobuf(void* pb) { mPb = pb; }
     void* getProtobuf() override { return mPb; }
 
-    // Snapshot support.
+    // Snapshot support. Both layouts use the same format.
     void save(Stream* stream) const;
     void load(Stream* stream);
 
-    const Buffer& buffer() const { return mData; }
+    // The written bytes as one vector. A segmented stream copies them into
+    // it on every call, so prefer forEachSegment() there.
+    const Buffer& buffer() const;
+
+    // Calls |fn(const char* data, size_t size)| for each contiguous run of
+    // written bytes, in order.
+    template <class Fn>
+    void forEachSegment(Fn&& fn) const {
+        if (!segmented()) {
+            if (!mData.empty()) {
+                fn(mData.data(), mData.size());
+            }
+            return;
+        }
+        size_t left = mSize;
+        for (size_t i = 0; left; ++i) {
+            const size_t n = std::min(left, kSegmentSize);
+            fn(static_cast<const char*>(mSegments[i]), n);
+            left -= n;
+        }
+    }
+
+    // Appends iovecs for the written bytes to |iov|. They point into this
+    // stream and are valid until it is written to or destroyed.
+    void appendSegmentsTo(IOVector* iov) const;
 
     void rewind();
 
 private:
     DISALLOW_COPY_AND_ASSIGN(MemStream);
 
-    Buffer mData;
+    void append(const char* data, size_t size);
+    void releaseSegments();
+
+    Layout mLayout = Layout::Contiguous;
+    // Where segments come from; null for the process-wide pool.
+    std::pmr::memory_resource* mResource = nullptr;
+    // Contiguous bytes, or the flattened copy buffer() made of segments.
+    mutable Buffer mData;
+    // Segmented only: every chunk but the last holding data is full.
+    std::vector<char*> mSegments;
+    size_t mSize = 0;
     int mReadPos = 0;
     void* mPb = nullptr;
 };
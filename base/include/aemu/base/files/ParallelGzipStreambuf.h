@@ -0,0 +1,118 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/threads/ThreadPool.h"
+
+#include <zlib.h>  // for Z_DEFAULT_COMPRESSION
+
+#ifdef AEMU_BASE_USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <streambuf>
+#include <vector>
+
+#include <stddef.h>
+
+namespace android {
+namespace base {
+
+// A drop-in replacement for GzipOutputStreambuf for large outputs, in the
+// style of pigz: input is cut into |blockSize| blocks that are deflated on a
+// ThreadPool, and each block is written to |dst| as its own gzip member, in
+// order. Concatenated members are a valid gzip file that gunzip, zcat and
+// zlib's inflate() with gzip decoding all read as one stream.
+//
+// Every block starts with an empty dictionary, so the output is a little
+// larger than a single-threaded stream's, by well under 1% with 1 MiB
+// blocks. sync() ends the current block early and waits for everything to
+// be written.
+class ParallelGzipOutputStreambuf : public std::streambuf {
+public:
+    static constexpr size_t kDefaultBlockSize = 1 << 20;
+
+    // |threads| of 0 uses one per core.
+    ParallelGzipOutputStreambuf(std::streambuf* dst,
+                                int level = Z_DEFAULT_COMPRESSION,
+                                int threads = 0,
+                                size_t blockSize = kDefaultBlockSize);
+    ~ParallelGzipOutputStreambuf();
+
+protected:
+    int_type overflow(int_type c = traits_type::eof()) override;
+    int sync() override;
+
+private:
+    struct Block;
+
+    // Hands the put area to the pool, or compresses it right here without
+    // one.
+    void submit();
+    // Writes out finished blocks in order, waiting until at most |maxPending|
+    // remain in flight.
+    bool drain(size_t maxPending);
+    static void compress(Block* block, int level);
+
+    std::streambuf* mDst;
+    const int mLevel;
+    const size_t mBlockSize;
+    size_t mMaxPending;
+    std::vector<char> mIn;
+    bool mWroteMember = false;
+    bool mFailed = false;
+
+    Lock mLock;
+    ConditionVariable mBlockDone;
+    std::deque<std::shared_ptr<Block>> mPending;
+    std::unique_ptr<ThreadPool<std::function<void()>>> mPool;
+};
+
+#ifdef AEMU_BASE_USE_ZSTD
+
+// Compresses to a zstd frame, a much faster alternative to gzip at a
+// similar ratio. With |threads| above 1, zstd compresses on that many
+// worker threads of its own.
+class ZstdOutputStreambuf : public std::streambuf {
+public:
+    ZstdOutputStreambuf(std::streambuf* dst,
+                        int level = ZSTD_CLEVEL_DEFAULT,
+                        int threads = 0);
+    ~ZstdOutputStreambuf();
+
+protected:
+    int_type overflow(int_type c = traits_type::eof()) override;
+    int sync() override;
+
+private:
+    bool compress(ZSTD_EndDirective mode);
+
+    std::streambuf* mDst;
+    ZSTD_CCtx* mContext;
+    std::vector<char> mIn;
+    std::vector<char> mOut;
+    bool mFailed = false;
+};
+
+#endif  // AEMU_BASE_USE_ZSTD
+
+}  // namespace base
+}  // namespace android
@@ -15,6 +15,8 @@
 #pragma once
 
 #include <stddef.h>                   // for size_t
+#include <initializer_list>
+#include <iterator>
 #include <optional>
 #include <string>                     // for string, basic_string
 #include <string_view>
@@ -22,6 +24,7 @@
 #include <vector>                     // for vector
 
 #include "aemu/base/Optional.h"    // for Optional
+#include "aemu/base/containers/SmallVector.h"
 
 #ifdef __APPLE__
 
@@ -162,6 +165,10 @@ public:
         return removeTrailingDirSeparator(path, HOST_TYPE);
     }
 
+    // A non-allocating variant that returns a view into |path|.
+    static std::string_view removeTrailingDirSeparator(std::string_view path,
+                                                       HostType hostType);
+
     // Add a trailing separator if needed.
     static std::string addTrailingDirSeparator(const std::string& path,
                                                HostType hostType);
@@ -181,12 +188,12 @@ public:
     //    <drive>:
     //    <drive>:<sep>
     //    <sep><sep>volumeName<sep>
-    static size_t rootPrefixSize(const std::string& path, HostType hostType);
+    static size_t rootPrefixSize(std::string_view path, HostType hostType);
 
     // Return the root prefix for the current platform. See above for
     // documentation.
     static size_t rootPrefixSize(const char* path, HostType hostType) {
-        return rootPrefixSize(path ? std::string(path) : std::string(""), hostType);
+        return rootPrefixSize(std::string_view(path ? path : ""), hostType);
     }
     static size_t rootPrefixSize(const char* path) {
         return rootPrefixSize(path, HOST_TYPE);
@@ -199,6 +206,7 @@ public:
     static bool isAbsolute(const char* path) {
         return isAbsolute(path, HOST_TYPE);
     }
+    static bool isAbsolute(std::string_view path, HostType hostType);
 
     // Return an extension part of the name/path (the part of the name after
     // last dot, including the dot. E.g.:
@@ -236,6 +244,14 @@ public:
         return split(path, HOST_TYPE, dirName, baseName);
     }
 
+    // A non-allocating variant of split(): |dirName| and |baseName| are set
+    // to views into |path|, except for the '.' of a bare file name, which
+    // points to static storage.
+    static bool split(std::string_view path,
+                      HostType hostType,
+                      std::string_view* dirName,
+                      std::string_view* baseName);
+
     // Join two path components together. Note that if |path2| is an
     // absolute path, this function returns a copy of |path2|, otherwise
     // the result will be the concatenation of |path1| and |path2|, if
@@ -258,6 +274,21 @@ public:
         return join(path1, join(path2, std::forward<Paths>(paths)...));
     }
 
+    // Non-allocating variants of join(): the result replaces the contents
+    // of |out| and is not NUL-terminated. Passing a SmallFixedVector that
+    // lives on the stack keeps typical paths off the heap entirely.
+    static void join(SmallVector<char>* out,
+                     std::string_view path1,
+                     std::string_view path2,
+                     HostType hostType = HOST_TYPE);
+
+    // Joins all of |paths| like nested join() calls would, in a single pass
+    // that sizes |out| once; anything before the last absolute path is
+    // skipped without being copied.
+    static void joinMany(SmallVector<char>* out,
+                         std::initializer_list<std::string_view> paths,
+                         HostType hostType = HOST_TYPE);
+
     // Decompose |path| into individual components. If |path| has a root
     // prefix, it will always be the first component. I.e. for Posix
     // systems this will be '/' (for absolute paths). For Win32 systems,
@@ -281,6 +312,72 @@ public:
         return decompose(path, HOST_TYPE);
     }
 
+    // The components decompose() would return, as views into the path
+    // instead of a vector of copies:
+    //
+    //     for (std::string_view part : PathUtils::components(path)) { ... }
+    //
+    // The path must outlive the iteration.
+    class Components {
+    public:
+        class iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = ptrdiff_t;
+            using pointer = const std::string_view*;
+            using reference = std::string_view;
+
+            std::string_view operator*() const {
+                return mPath.substr(mPos, mLen);
+            }
+            iterator& operator++();
+            iterator operator++(int) {
+                iterator old = *this;
+                ++*this;
+                return old;
+            }
+            bool operator==(const iterator& other) const {
+                return mPos == other.mPos;
+            }
+            bool operator!=(const iterator& other) const {
+                return mPos != other.mPos;
+            }
+
+        private:
+            friend class Components;
+            iterator(std::string_view path, HostType hostType, size_t pos,
+                     size_t len)
+                : mPath(path), mHostType(hostType), mPos(pos), mLen(len) {}
+
+            // Positions the iterator on the first component at or after
+            // |from|, or at the end.
+            void seek(size_t from);
+
+            std::string_view mPath;
+            HostType mHostType;
+            size_t mPos;
+            size_t mLen;
+        };
+
+        Components(std::string_view path, HostType hostType)
+            : mPath(path), mHostType(hostType) {}
+
+        iterator begin() const;
+        iterator end() const {
+            return iterator(mPath, mHostType, mPath.size(), 0);
+        }
+
+    private:
+        std::string_view mPath;
+        HostType mHostType;
+    };
+
+    static Components components(std::string_view path,
+                                 HostType hostType = HOST_TYPE) {
+        return Components(path, hostType);
+    }
+
     // Recompose a path from individual components into a file path string.
     // |components| is a vector of strings, and |hostType| the target
     // host type to use. Return a new file path string. Note that if the
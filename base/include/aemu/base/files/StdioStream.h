@@ -17,12 +17,38 @@
 #include "aemu/base/Compiler.h"
 #include "aemu/base/files/Stream.h"
 
+#include <memory>
 
+#include <stdint.h>
 #include <stdio.h>
 
 namespace android {
 namespace base {
 
+// Tuning for large files written or read once, front to back, such as
+// snapshot RAM and texture files. The defaults leave the FILE* as it is.
+struct StdioOptions {
+    // Size of the stdio buffer, e.g. 1-16 MB instead of the usual 4-8 KB.
+    // 0 keeps the FILE's own. Only used with kOwner, before any I/O, since
+    // the stream owns the buffer.
+    size_t bufferSize = 0;
+    // Bytes expected to be written from the current position. That much
+    // disk space is reserved up front, without changing the file size, so
+    // the file system allocates it in few extents.
+    uint64_t sizeHint = 0;
+    // Tell the kernel the file is accessed sequentially, for more
+    // read-ahead.
+    bool sequential = false;
+    // Keep written data out of the page cache once it's on disk, so a
+    // write-once snapshot doesn't evict everything else. Waits for the
+    // last writes on close().
+    bool dropCache = false;
+    // Start disk writeback every this many bytes, and wait for the
+    // previous batch, so dirty pages don't pile up until close. 0 leaves
+    // writeback to the kernel. Linux only.
+    size_t writebackInterval = 0;
+};
+
 // An implementation of android::base::Stream interface on top of an
 // stdio FILE* instance.
 class StdioStream : public Stream {
@@ -30,22 +56,39 @@ public:
     enum Ownership { kNotOwner, kOwner };
 
     StdioStream(FILE* file = nullptr, Ownership ownership = kNotOwner);
+    StdioStream(FILE* file, Ownership ownership, const StdioOptions& options);
     StdioStream(StdioStream&& other);
     StdioStream& operator=(StdioStream&& other);
 
     virtual ~StdioStream();
     virtual ssize_t read(void* buffer, size_t size) override;
     virtual ssize_t write(const void* buffer, size_t size) override;
+    virtual ssize_t writev(const IOVector& iov) override;
+    virtual int64_t readPosition() const override;
+    virtual bool seekRead(int64_t position) override;
 
     FILE* get() const { return mFile; }
     void close();
 
 private:
+    // Bookkeeping for StdioOptions::dropCache and writebackInterval.
+    void wrote(size_t size);
+    // Writes back and waits for everything written so far.
+    void finishWriteback();
 
     DISALLOW_COPY_AND_ASSIGN(StdioStream);
 
     FILE* mFile;
     Ownership mOwnership;
+    std::unique_ptr<char[]> mBuffer;
+    bool mDropCache = false;
+    size_t mWritebackInterval = 0;
+    // Tracked only when one of the above is set: the file offset of the
+    // next byte written, the start of what wasn't handed to writeback yet,
+    // and how far writeback has been waited for.
+    uint64_t mPosition = 0;
+    uint64_t mWritebackStart = 0;
+    uint64_t mWrittenBack = 0;
 };
 
 }  // namespace base
@@ -8,6 +8,9 @@
 #include "aemu/base/msvc.h"
 
 #include <string>
+#include <string_view>
+
+#include <stddef.h>
 
 #include <inttypes.h>
 #include <sys/types.h>
@@ -15,6 +18,8 @@
 namespace android {
 namespace base {
 
+class IOVector;
+
 // Abstract interface to byte streams of all kind.
 // This is mainly used to implement disk serialization.
 class Stream {
@@ -34,8 +39,29 @@ public:
     // error.
     virtual ssize_t write(const void* buffer, size_t size) = 0;
 
+    // Write all buffers of |iov| in order, as if by a single write() call.
+    // Return the total number of bytes transferred, or -errno value on error.
+    // The default implementation calls write() once per buffer; streams that
+    // can take the whole vector at once should override it.
+    virtual ssize_t writev(const IOVector& iov);
+
     virtual void* getProtobuf() { return nullptr; }
 
+    // If the next |size| bytes already sit contiguously in memory, skip
+    // them and return where they are; they stay valid until the stream is
+    // written to or destroyed. Otherwise return nullptr and consume
+    // nothing. Memory-backed streams override this.
+    virtual const char* readInPlace(size_t size) { return nullptr; }
+
+    // Where the next read() starts, or -1 if the stream can't seek, like a
+    // pipe or a socket. Files and memory-backed streams override this and
+    // seekRead().
+    virtual int64_t readPosition() const { return -1; }
+
+    // Makes the next read() start at |position|, a value readPosition()
+    // returned earlier. Returns false if the stream can't seek.
+    virtual bool seekRead(int64_t position) { return false; }
+
     // Write a single byte |value| into the stream. Ignore errors.
     void putByte(uint8_t value);
 
@@ -63,6 +89,20 @@ public:
     // Return 0 on error.
     uint64_t getBe64();
 
+    // Write |count| 16-, 32- or 64-bit |values| as big-endian into the stream,
+    // converting them in bulk and with as few write() calls as possible.
+    // Ignore errors.
+    void putBe16Array(const uint16_t* values, size_t count);
+    void putBe32Array(const uint32_t* values, size_t count);
+    void putBe64Array(const uint64_t* values, size_t count);
+
+    // Read |count| big-endian values written by the matching put*Array()
+    // (or by as many put*() calls) into |values| with a single read(). Return
+    // false on a short read, in which case the missing values are zero.
+    bool getBe16Array(uint16_t* values, size_t count);
+    bool getBe32Array(uint32_t* values, size_t count);
+    bool getBe64Array(uint64_t* values, size_t count);
+
     // Write a 32-bit float |value| to the stream.
     void putFloat(float value);
 
@@ -82,6 +122,12 @@ public:
     // to read strings that were written with putString().
     std::string getString();
 
+    // Like read() and getString(), but without copying when readInPlace()
+    // can point into the stream. Other streams read into |scratch|, which
+    // the view then refers to. Return an empty view on a short read.
+    std::string_view getBufferView(size_t size, std::string* scratch);
+    std::string_view getStringView(std::string* scratch);
+
     // Put/gen an integer number into the stream, making it use as little space
     // there as possible.
     // It uses a simple byte-by-byte encoding scheme, putting 7 bits of the
@@ -0,0 +1,165 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/files/Stream.h"
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
+
+#include <memory>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+namespace base {
+
+template <class ItemT>
+class ThreadPool;
+
+// What an upload consists of, for the remote side to check it against.
+struct UploadManifest {
+    static constexpr uint32_t kMagic = 0x55504d46;  // 'UPMF'
+    static constexpr uint32_t kVersion = 1;
+
+    struct Part {
+        uint64_t offset;
+        uint32_t size;
+        // xxh3Hash64() of the part's bytes.
+        uint64_t checksum;
+    };
+
+    uint32_t partSize = 0;
+    uint64_t totalSize = 0;
+    std::vector<Part> parts;
+    // xxh3Hash64() of the parts' checksums, in order, as be64 values.
+    uint64_t checksum = 0;
+
+    void save(Stream* stream) const;
+    // Returns false if |stream| doesn't hold a manifest of this version.
+    bool load(Stream* stream);
+};
+
+// The remote end of an UploadingStream, e.g. a multipart upload to object
+// storage. uploadPart() runs on the stream's upload threads, complete() and
+// abort() on the thread that finishes or cancels the stream.
+class UploadSink {
+public:
+    virtual ~UploadSink() = default;
+
+    // Uploads part |index|, counting from 0, which is |size| bytes at
+    // |data|. Every part but the last is UploadOptions::partSize bytes.
+    // With more than one upload thread, parts may be uploaded concurrently
+    // and out of order. Returns 0 or a -errno value.
+    virtual int uploadPart(uint32_t index, const void* data, size_t size) = 0;
+
+    // Called once every part is uploaded. Returns 0 or a -errno value.
+    virtual int complete(const UploadManifest& manifest) = 0;
+
+    // Called instead of complete() if the upload failed or was cancelled,
+    // so that the sink can drop the parts it has.
+    virtual void abort() {}
+};
+
+struct UploadOptions {
+    // Bytes per part, at least 4 KiB. Object stores usually want 5 MiB or
+    // more for all parts but the last.
+    uint32_t partSize = 8 * 1024 * 1024;
+    // Threads calling UploadSink::uploadPart().
+    int threadCount = 2;
+    // Parts held in memory, queued or being uploaded, before write() waits
+    // for one to finish; 0 means twice the thread count.
+    size_t maxPartsInFlight = 0;
+};
+
+// A write-only Stream that writes everything to |output| and also uploads
+// it to |sink| as it comes in, so that a snapshot is already uploaded when
+// its save ends instead of being read back from disk and uploaded after.
+//
+//   UploadingStream upload(file, sink);
+//   {
+//       CompressingStream compressed(upload, blockOptions);
+//       ... save into |compressed| ...
+//   }
+//   upload.finish();
+//
+// Data is cut into parts of UploadOptions::partSize bytes, each handed to
+// an upload thread as soon as it is full. Once maxPartsInFlight parts are
+// waiting, write() blocks until one is uploaded: a CompressingStream then
+// stops handing out blocks, and its compression threads wait in turn, so
+// memory stays bounded however slow the upload is.
+//
+// Errors are sticky: once |output| or the sink fails, write() and finish()
+// return -EIO or the sink's -errno value, and the sink is aborted.
+class UploadingStream : public Stream {
+    DISALLOW_COPY_AND_ASSIGN(UploadingStream);
+
+public:
+    UploadingStream(Stream& output,
+                    UploadSink& sink,
+                    const UploadOptions& options = UploadOptions());
+    // finish(), unless finish() or cancel() already ran.
+    ~UploadingStream() override;
+
+    // Always fails with -EPERM.
+    ssize_t read(void* buffer, size_t size) override;
+    ssize_t write(const void* buffer, size_t size) override;
+
+    // Uploads the last part, waits for all of them and completes the upload
+    // with the manifest. Returns 0 or a -errno value.
+    int finish();
+
+    // Drops the parts not uploaded yet and aborts the upload. finish() then
+    // returns -ECANCELED.
+    void cancel();
+
+    // Valid after a successful finish().
+    const UploadManifest& manifest() const { return mManifest; }
+
+    // Bytes written to the stream so far.
+    uint64_t size() const { return mSize; }
+
+private:
+    struct Part;
+
+    void submitPart();
+    // Uploads |part| and puts it back on mFree.
+    void upload(Part* part);
+    // Waits until fewer than |maxInFlight| parts are in flight.
+    void waitForParts(size_t maxInFlight);
+    int stop(bool cancelled);
+
+    Stream& mOutput;
+    UploadSink& mSink;
+    UploadOptions mOptions;
+    std::unique_ptr<ThreadPool<Part*>> mPool;
+    std::unique_ptr<Part> mCurrent;
+    UploadManifest mManifest;
+    uint64_t mSize = 0;
+    bool mStopped = false;
+
+    Lock mLock;
+    ConditionVariable mPartDone;
+    // Guarded by mLock.
+    std::vector<std::unique_ptr<Part>> mFree;
+    size_t mInFlight = 0;
+    int mError = 0;
+    bool mCancelled = false;
+};
+
+}  // namespace base
+}  // namespace android
@@ -73,6 +73,11 @@ LOGGING_API bool verbose_check_any();
 LOGGING_API void set_verbosity_mask(uint64_t mask);
 LOGGING_API uint64_t get_verbosity_mask();
 
+// The enabled verbose tags, one bit per VerboseTag, as set by the calls
+// above. Owned by the logging library; VERBOSE_CHECK() tests it inline so
+// that a disabled tag costs a load and a branch rather than a call.
+extern LOGGING_API uint64_t android_verbose;
+
 // Configure the logging framework.
 LOGGING_API void base_configure_logs(LoggingFlags flags);
 
@@ -12,6 +12,11 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #pragma once
+
+#include <stdint.h>
+
+#include "aemu/base/logging/LogSeverity.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -30,21 +35,44 @@ typedef enum {
 #define VERBOSE_ENABLE(tag) VERBOSE_ENABLE_IMPL(VERBOSE_##tag)
 #define VERBOSE_DISABLE_IMPL(tag) verbose_disable((int64_t)tag)
 #define VERBOSE_DISABLE(tag) VERBOSE_DISABLE_IMPL(VERBOSE_##tag)
-#define VERBOSE_CHECK_IMPL(tag) verbose_check((int64_t)tag)
+
+// The tags that VERBOSE_CHECK() can ever see enabled. Builds that want no
+// verbose logging at all can define this to 0, or to a subset, and the
+// checks and the log calls behind them fold away.
+#ifndef VERBOSE_COMPILED_TAGS
+#define VERBOSE_COMPILED_TAGS (~(uint64_t)0)
+#endif
+
+// A relaxed atomic read of android_verbose, for C and C++ alike.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define VERBOSE_MASK_LOAD() (*(const volatile uint64_t*)&android_verbose)
+#else
+#define VERBOSE_MASK_LOAD() __atomic_load_n(&android_verbose, __ATOMIC_RELAXED)
+#endif
+
+#define VERBOSE_CHECK_IMPL(tag)                                         \
+    (((VERBOSE_COMPILED_TAGS) >> (tag) & 1) &&                          \
+     (VERBOSE_MASK_LOAD() >> (tag) & 1))
 #define VERBOSE_CHECK(tag) VERBOSE_CHECK_IMPL(VERBOSE_##tag)
-#define VERBOSE_CHECK_ANY() verbose_check_any();
+#define VERBOSE_CHECK_ANY() \
+    ((VERBOSE_MASK_LOAD() & (VERBOSE_COMPILED_TAGS)) != 0)
 
-#define VERBOSE_PRINT_IMPL(tag, ...) \
-    if (VERBOSE_CHECK_IMPL(tag)) {   \
-        dprint(__VA_ARGS__);  \
-    }
+// The arguments are only evaluated when the tag is enabled.
+#define VERBOSE_PRINT_IMPL(tag, ...)   \
+    do {                               \
+        if (VERBOSE_CHECK_IMPL(tag)) { \
+            dprint(__VA_ARGS__);       \
+        }                              \
+    } while (0)
 
 #define VERBOSE_PRINT(tag, ...) VERBOSE_PRINT_IMPL(VERBOSE_##tag, __VA_ARGS__)
 
-#define VERBOSE_INFO_IMPL(tag, ...) \
-    if (VERBOSE_CHECK_IMPL(tag)) {  \
-        dinfo(__VA_ARGS__);  \
-    }
+#define VERBOSE_INFO_IMPL(tag, ...)    \
+    do {                               \
+        if (VERBOSE_CHECK_IMPL(tag)) { \
+            dinfo(__VA_ARGS__);        \
+        }                              \
+    } while (0)
 
 #define VERBOSE_INFO(tag, ...) VERBOSE_INFO_IMPL(VERBOSE_##tag, __VA_ARGS__)
 
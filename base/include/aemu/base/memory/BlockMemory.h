@@ -0,0 +1,90 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <stdint.h>
+
+namespace android {
+namespace base {
+
+// Backing memory for large, long lived buffers that are shared with the
+// guest, like the 16 MB address space graphics blocks.
+//
+// allocateBlockMemory() tries, in order: explicit huge pages
+// (MAP_HUGETLB, only if the host has a pool reserved), a huge page aligned
+// anonymous mapping with transparent huge pages requested
+// (MADV_HUGEPAGE), and finally aligned_buf_alloc(). On Linux the memory
+// is also set to prefer a NUMA node, by default the calling thread's, so
+// that it lands next to the thread that sets the block up. Any step that
+// the host does not support is skipped.
+//
+// Every allocation counts towards a "memory.blocks.<backing>" counter on
+// the StatsPage, and "memory.blocks.numa_bound" counts those bound to a
+// node.
+enum class BlockBacking {
+    kRegular,
+    kTransparentHuge,
+    kExplicitHuge,
+};
+
+struct BlockMemoryOptions {
+    static constexpr int kAnyNode = -1;
+    static constexpr int kLocalNode = -2;
+
+    // Try huge pages; only used for sizes that are a multiple of
+    // kBlockHugePageSize.
+    bool hugePages = true;
+    // NUMA node to prefer, kLocalNode for that of the calling thread, or
+    // kAnyNode to leave placement to the system.
+    int numaNode = kLocalNode;
+};
+
+struct BlockMemory {
+    void* ptr = nullptr;
+    uint64_t size = 0;
+    BlockBacking backing = BlockBacking::kRegular;
+    // The node the memory prefers, or kAnyNode if it was not bound.
+    int numaNode = BlockMemoryOptions::kAnyNode;
+    // True if |ptr| came from mmap() rather than aligned_buf_alloc(); such
+    // memory starts out zeroed.
+    bool mapped = false;
+};
+
+static constexpr uint64_t kBlockHugePageSize = 2 * 1024 * 1024;
+
+// Returns |size| bytes aligned to at least |alignment|, which must be a
+// power of two no larger than kBlockHugePageSize. Aborts when out of
+// memory, like aligned_buf_alloc().
+BlockMemory allocateBlockMemory(uint64_t size,
+                                uint64_t alignment,
+                                const BlockMemoryOptions& options = {});
+
+// Frees what allocateBlockMemory() returned and resets |memory|.
+void freeBlockMemory(BlockMemory* memory);
+
+const char* blockBackingName(BlockBacking backing);
+
+// The NUMA node of the CPU the calling thread is running on, or kAnyNode
+// if unknown.
+int currentNumaNode();
+
+// Makes the pages of [ptr, ptr + size) prefer NUMA node |node|. Pages
+// already present stay where they are, so call this before first touch.
+// Returns false if |node| is not a node, or the platform can't do it.
+bool preferNumaNode(void* ptr, uint64_t size, int node);
+
+}  // namespace base
+}  // namespace android
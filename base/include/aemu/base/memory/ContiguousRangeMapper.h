@@ -17,8 +17,11 @@
 #include "aemu/base/Compiler.h"
 
 #include <functional>
+#include <memory>
+#include <vector>
 
 #include <inttypes.h>
+#include <stddef.h>
 
 // Convenience class ContiguousRangeMapper which makes it easier to collect
 // contiguous ranges and run some function over the coalesced range.
@@ -26,31 +29,55 @@
 namespace android {
 namespace base {
 
+template <class ItemT>
+class ThreadPool;
+
 class ContiguousRangeMapper {
 public:
     using Func = std::function<void(uintptr_t, uintptr_t)>;
 
-    ContiguousRangeMapper(Func&& mapFunc, uintptr_t batchSize = 0) :
-        mMapFunc(std::move(mapFunc)), mBatchSize(batchSize) { }
+    struct Range {
+        uintptr_t start;
+        uintptr_t size;
+    };
+
+    // If |flushThreads| is not 0, coalesced ranges are handed to that many
+    // worker threads (a negative value means one per core) instead of running
+    // mMapFunc on the caller, so mMapFunc must then be thread-safe.
+    ContiguousRangeMapper(Func&& mapFunc, uintptr_t batchSize = 0,
+                          int flushThreads = 0);
 
     // add(): adds [start, start + size) to the internally tracked range.
     // mMapFunc on the previous range runs if the new piece is not contiguous.
 
     void add(uintptr_t start, uintptr_t size);
 
+    // addAll(): adds |count| pieces in any order. They are sorted by start
+    // address and overlapping or touching pieces are merged first, so this
+    // produces far fewer mMapFunc calls than add() on unsorted input. With a
+    // batch size, merged runs are cut into pieces of at most that size.
+    void addAll(const Range* ranges, size_t count);
+
     // Signals end of collection of pieces, running mMapFunc over any
-    // outstanding range.
+    // outstanding range. With flush threads, this also waits until every
+    // range handed out so far has been processed.
     void finish();
 
     // Destructor all runs mMapFunc if there is an outstanding range.
     ~ContiguousRangeMapper();
 
 private:
+    void flushRange();
+    void emit(uintptr_t start, uintptr_t size);
+
     Func mMapFunc = {};
     uintptr_t mBatchSize = 0;
     bool mHasRange = false;
     uintptr_t mStart = 0;
     uintptr_t mEnd = 0;
+    std::unique_ptr<ThreadPool<Range>> mPool;
+    std::vector<Range> mSorted;
+    std::vector<Range> mScratch;
     DISALLOW_COPY_ASSIGN_AND_MOVE(ContiguousRangeMapper);
 };
 
@@ -0,0 +1,139 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+
+// Sampling heap profiler.
+//
+// Rather than walking the stack on every malloc the way MemoryTracker used to,
+// each thread counts down a random number of bytes drawn from an exponential
+// distribution with a mean of the sampling interval, and only the allocation
+// that crosses zero is sampled. That makes sampling a Poisson process over
+// allocated bytes: an allocation of S bytes is sampled with probability
+// 1 - exp(-S / interval), independent of how the program slices its
+// allocations, and the unsampled totals can be estimated from it.
+//
+// Sampled allocations are aggregated by call stack, and the profile can be
+// written in the legacy text heap format that pprof reads, either on demand or
+// whenever the estimated live heap crosses a threshold.
+//
+// The profiler does not hook the allocator itself; the allocator's hooks call
+// recordAllocation() and recordFree(). MemoryTracker feeds it from tcmalloc's
+// hooks when that allocator is in use.
+namespace android {
+namespace base {
+
+class HeapProfiler {
+    DISALLOW_COPY_ASSIGN_AND_MOVE(HeapProfiler);
+
+public:
+    // The interval tcmalloc uses by default.
+    static constexpr size_t kDefaultSamplingInterval = 512 * 1024;
+    static constexpr int kMaxFrames = 32;
+
+    struct Summary {
+        uint64_t sampledAllocations = 0;
+        uint64_t liveSamples = 0;
+        // Totals estimated from the samples.
+        uint64_t allocatedBytes = 0;
+        uint64_t liveBytes = 0;
+    };
+
+    // Per call stack totals, estimated from the samples.
+    struct StackUsage {
+        const void* const* frames;
+        int depth;
+        uint64_t allocatedBytes;
+        uint64_t liveBytes;
+    };
+
+    static HeapProfiler& get();
+
+    HeapProfiler();
+    ~HeapProfiler();
+
+    // Starts sampling about once every |samplingInterval| bytes allocated.
+    // Collected samples are kept across stop()/start().
+    void start(size_t samplingInterval = kDefaultSamplingInterval);
+    void stop();
+    bool isEnabled() const { return mEnabled.load(std::memory_order_relaxed); }
+    size_t samplingInterval() const {
+        return mInterval.load(std::memory_order_relaxed);
+    }
+    // Drops every sample collected so far.
+    void reset();
+
+    // Allocator hooks, safe to call from any thread. A disabled profiler
+    // costs one relaxed load per call, an enabled one a thread-local
+    // countdown for allocations and a filter lookup for frees; the stack is
+    // only captured for sampled allocations.
+    void recordAllocation(const void* ptr, size_t size) {
+        if (isEnabled()) {
+            countAllocation(ptr, size);
+        }
+    }
+    void recordFree(const void* ptr) {
+        if (mLiveSamples.load(std::memory_order_relaxed)) {
+            checkFree(ptr);
+        }
+    }
+
+    Summary summary();
+    // Calls |func| for each stack seen, heaviest live usage first.
+    template <class Func>
+    void forEachStack(Func&& func);
+
+    // The profile in pprof's legacy heap format ("heap_v2"). Counts are the
+    // raw samples; pprof scales them by the sampling interval in the header.
+    std::string pprofText();
+    bool dump(const std::string& path);
+
+    // Dumps to "<pathPrefix>.<n>.heap" each time the estimated live heap goes
+    // |bytes| past where it stood at the previous dump. 0 turns it off.
+    void setDumpThreshold(uint64_t bytes, const std::string& pathPrefix);
+
+private:
+    class Impl;
+
+    void countAllocation(const void* ptr, size_t size);
+    void checkFree(const void* ptr);
+    void visitStacks(void (*visit)(const StackUsage&, void*), void* opaque);
+
+    std::atomic<bool> mEnabled{false};
+    std::atomic<size_t> mInterval{kDefaultSamplingInterval};
+    std::atomic<uint64_t> mLiveSamples{0};
+    std::unique_ptr<Impl> mImpl;
+};
+
+template <class Func>
+void HeapProfiler::forEachStack(Func&& func) {
+    visitStacks(
+            [](const StackUsage& usage, void* opaque) {
+                (*static_cast<std::remove_reference_t<Func>*>(opaque))(usage);
+            },
+            &func);
+}
+
+}  // namespace base
+}  // namespace android
@@ -29,14 +29,19 @@ enum class MemoryHint {
     Random,
     Sequential,
     Touch,
+    // Start reading the range in ahead of its use: madvise(MADV_WILLNEED) or
+    // PrefetchVirtualMemory().
+    WillNeed,
 };
 
 // Returns true if successful, false otherwise.
 // |start| must be page-aligned.
 bool memoryHint(void* start, uint64_t length, MemoryHint hint);
 
-// Interface to zero out memory and tell the OS to decommit the page,
-// but leave it accessible later as well.
+// Size of a memory page; |start| above must be a multiple of it.
+uint64_t memoryPageSize();
+
+// Interface to zero out memory, leaving it accessible later as well.
 // Returns true if successful, false otherwise.
 // |start| must be page-aligned.
 bool zeroOutMemory(void* start, uint64_t length);
@@ -0,0 +1,102 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+
+#include <chrono>
+#include <functional>
+
+#include <inttypes.h>
+
+namespace android {
+namespace base {
+
+// Lets the host take memory back from the emulator. Components that hold
+// memory they can do without keep a MemoryTrimmer:
+//
+//     Cache::Cache()
+//         : mTrimmer("cache", TrimCost::kExpensive, 0,
+//                    [this](MemoryPressureLevel) { return dropAll(); }) {}
+//
+// and trimMemory() runs them, either when the memory pressure monitor sees
+// the OS signal pressure or when called directly.
+
+enum class MemoryPressureLevel {
+    kNone,
+    kModerate,  // trimmers of TrimCost::kCheap run
+    kCritical,  // every trimmer runs
+};
+
+const char* memoryPressureLevelName(MemoryPressureLevel level);
+
+// What getting trimmed memory back costs once it is needed again.
+enum class TrimCost {
+    kCheap,      // spare capacity: free lists, idle chunks and buffers
+    kExpensive,  // contents that must be rebuilt: caches
+};
+
+// Gives back memory for |level| and returns how many bytes that was. A
+// trimmer that has to defer the work to its own thread returns 0 and calls
+// MemoryTrimmer::reportReclaimed() once it is done.
+using MemoryTrimCallback = std::function<uint64_t(MemoryPressureLevel level)>;
+
+struct MemoryTrimmerEntry;
+
+// Registers |callback| for as long as it lives. The destructor waits for a
+// trim that is running, so it must not be destroyed while holding a lock
+// the callback takes, and callbacks must not create or destroy trimmers.
+class MemoryTrimmer {
+    DISALLOW_COPY_ASSIGN_AND_MOVE(MemoryTrimmer);
+
+public:
+    // Within a cost, trimmers of higher |priority| run first. |name| must
+    // outlive the trimmer.
+    MemoryTrimmer(const char* name,
+                  TrimCost cost,
+                  int priority,
+                  MemoryTrimCallback callback);
+    ~MemoryTrimmer();
+
+    // Adds |bytes| given back by a deferred trim to the reclaimed stat.
+    static void reportReclaimed(uint64_t bytes);
+
+private:
+    MemoryTrimmerEntry* mEntry;
+};
+
+// Runs the trimmers |level| calls for, cheap ones first, and returns the
+// bytes they gave back. The total is added to the
+// "memory_pressure.reclaimed_bytes" stat and logged as a
+// MetricEventMemoryTrim.
+uint64_t trimMemory(MemoryPressureLevel level);
+
+// The pressure the OS signals right now: PSI of the process' cgroup (or the
+// system's) on Linux, the memory resource notification on Windows. kNone
+// where there is no such signal, and on macOS, which only notifies.
+MemoryPressureLevel currentMemoryPressure();
+
+// Watches the OS signal and calls trimMemory() when pressure rises. Linux
+// and Windows check it every |pollInterval| and trim again every
+// |retrimInterval| while it stays up; macOS trims whenever its dispatch
+// source reports a change. Starting again changes the intervals.
+void startMemoryPressureMonitor(
+        std::chrono::milliseconds pollInterval = std::chrono::seconds(1),
+        std::chrono::milliseconds retrimInterval = std::chrono::seconds(10));
+void stopMemoryPressureMonitor();
+
+}  // namespace base
+}  // namespace android
@@ -28,11 +28,12 @@ MEM_TRACE("<Group name>")
 Implementation:
 The tracker registers hooks to tcmalloc allocator for
 functions explicitly declared as being tracked. Now, we tracker every APIs in
-emugl translator library as "EMUGL".  When the hooks are
-invoked, the callback function gets the backtraces as a list of program
-counters. Then, it walks up the stack and checks if any registerd
-function is used in this malloc/free operation. Once hit, it will record
-stats for total allocation and live memory for each individual function.
+emugl translator library as "EMUGL".  The hooks feed HeapProfiler, which
+samples about one allocation every 512KB and keeps the backtraces of the
+sampled ones. When usage is queried, it walks up each sampled stack and
+checks if any registered function is on it. Once hit, the estimated totals
+of that stack are added to the stats for total allocation and live memory of
+that function.
 
 */
 namespace android {
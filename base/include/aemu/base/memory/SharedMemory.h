@@ -23,6 +23,8 @@
 #endif  // _MSC_VER
 #endif  // _WIN32
 
+#include "aemu/base/memory/BlockMemory.h"
+
 #include <sys/types.h>
 
 #include <string>
@@ -156,6 +158,34 @@ public:
     enum class AccessMode { READ_ONLY, READ_WRITE };
     enum class ShareType { SHARED_MEMORY, FILE_BACKED };
 
+    // How create() should back a large region that is hot from the start,
+    // like a shared framebuffer. Each option is a best effort; backing()
+    // reports what the region actually got.
+    //
+    // |hugePages|: on Linux, asks for transparent huge pages on the mapping
+    // (MADV_HUGEPAGE), which shared memory honors when
+    // /sys/kernel/mm/transparent_hugepage/shmem_enabled allows. A region
+    // that is a file on hugetlbfs always uses explicit huge pages. On
+    // Windows, uses SEC_LARGE_PAGES when |size| is a multiple of the large
+    // page size and the process may lock memory.
+    // |prefault|: populates every page at creation, so that first touches
+    // don't fault on the hot path.
+    // |numaNode|: the NUMA node the pages should prefer, as in
+    // BlockMemoryOptions, applied before anything is touched.
+    struct CreateOptions {
+        bool hugePages = false;
+        bool prefault = false;
+        int numaNode = BlockMemoryOptions::kAnyNode;
+    };
+
+    // What create() obtained.
+    struct Backing {
+        BlockBacking pages = BlockBacking::kRegular;
+        bool prefaulted = false;
+        // The node the region prefers, or kAnyNode if it was not bound.
+        int numaNode = BlockMemoryOptions::kAnyNode;
+    };
+
     // Creates a SharedMemory region either backed by a shared memory handle
     // or by a file. If the string uriOrHandle starts with `file://` it will be
     // file backed otherwise it will be a named shared memory region.
@@ -172,6 +202,7 @@ public:
         mFd = other.mFd;
         mCreate = other.mCreate;
         mShareType = other.mShareType;
+        mBacking = other.mBacking;
         other.clear();
     }
 
@@ -182,6 +213,7 @@ public:
         mShareType = other.mShareType;
         mFd = other.mFd;
         mCreate = other.mCreate;
+        mBacking = other.mBacking;
 
         other.clear();
         return *this;
@@ -195,6 +227,8 @@ public:
     // write access. Returns 0 on success, or an negative error code otheriwse.
     // The error code (errno) is platform dependent.
     int create(mode_t mode);
+    // Same as above, applying |options| to the new mapping.
+    int create(mode_t mode, const CreateOptions& options);
     // Creates a shared object in the same manner as create(), except for
     // performing actual mapping.
     int createNoMapping(mode_t mode);
@@ -221,12 +255,20 @@ public:
         return std::exchange(mFd, invalidHandle());
     }
     bool isMapped() const { return mAddr != unmappedMemory(); }
+    // Reset by close().
+    const Backing& backing() const { return mBacking; }
 
 private:
 #ifdef _WIN32
-    int openInternal(AccessMode access, bool doMapping = true);
+    int openInternal(AccessMode access,
+                     bool doMapping = true,
+                     const CreateOptions* options = nullptr);
 #else
-    int openInternal(int oflag, int mode, bool doMapping = true);
+    int openInternal(int oflag,
+                     int mode,
+                     bool doMapping = true,
+                     const CreateOptions* options = nullptr);
+    void applyCreateOptions(const CreateOptions& options);
 #endif
 
     void clear() {
@@ -235,6 +277,7 @@ private:
         mCreate = false;
         mFd = invalidHandle();
         mAddr = unmappedMemory();
+        mBacking = Backing();
     }
 
     memory_type mAddr = unmappedMemory();
@@ -245,6 +288,7 @@ private:
     std::string mName;
     size_t mSize;
     ShareType mShareType;
+    Backing mBacking;
 };
 }  // namespace base
 }  // namespace android
@@ -17,6 +17,9 @@
 #include "aemu/base/Optional.h"
 
 #include <string>
+#include <vector>
+
+#include <stdint.h>
 
 namespace android {
 
@@ -34,4 +37,23 @@ bool writeStringToFile(int fd, const std::string& file_contents);
 // Sets the file size to |size|, could either extend or truncate it.
 bool setFileSize(int fd, int64_t size);
 
+// A run of bytes in a file that may hold data, as opposed to a hole.
+struct FileDataRange {
+    int64_t offset;
+    int64_t size;
+};
+
+// Returns the ranges of the first |size| bytes of |fd| that hold data, in
+// order, skipping holes such as the untouched parts of a sparse RAM image.
+// Where the file system can't tell, it is all one range. Moves |fd|'s
+// position.
+std::vector<FileDataRange> getFileDataRanges(int fd, int64_t size);
+
+// Copies |size| bytes of |srcFd| starting at |srcOffset| to the current
+// position of |dstFd|. |srcFd|'s position only moves on Windows. Uses
+// copy_file_range() or sendfile() where available, so the bytes need not
+// pass through user space, and large buffered reads and writes otherwise.
+// Returns false if something went wrong, or if |size| is negative.
+bool copyFileData(int srcFd, int64_t srcOffset, int dstFd, int64_t size);
+
 }  // namespace android
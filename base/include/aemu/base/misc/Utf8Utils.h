@@ -37,5 +37,36 @@ int utf8Decode(const uint8_t* text, size_t textLen, uint32_t* codepoint);
 // |buffer_len| is ignored and the full encoding length is returned.
 int utf8Encode(uint32_t codepoint, uint8_t* buffer, size_t buffer_len);
 
+// Conversions between UTF-8 and UTF-16. Runs of ASCII are handled 16 bytes
+// at a time. Malformed input is not an error: each invalid UTF-8 sequence,
+// and each unpaired UTF-16 surrogate, turns into one U+FFFD replacement
+// character, like MultiByteToWideChar() and WideCharToMultiByte() do.
+
+// Return the number of UTF-16 code units utf8ToUtf16() produces for
+// |textLen| bytes of |text|. This is never more than |textLen|.
+size_t utf8ToUtf16Length(const char* text, size_t textLen);
+
+// Convert |textLen| bytes of UTF-8 |text| into at most |outLen| UTF-16 code
+// units at |out|, without a terminator. Return the number of units written;
+// conversion stops early, never splitting a surrogate pair, when |out| is
+// too small.
+size_t utf8ToUtf16(const char* text,
+                   size_t textLen,
+                   char16_t* out,
+                   size_t outLen);
+
+// Return the number of bytes utf16ToUtf8() produces for |textLen| code
+// units of |text|. This is never more than 3 * |textLen|.
+size_t utf16ToUtf8Length(const char16_t* text, size_t textLen);
+
+// Convert |textLen| UTF-16 code units at |text| into at most |outLen| bytes
+// of UTF-8 at |out|, without a terminator. Return the number of bytes
+// written; conversion stops early, never splitting a character, when |out|
+// is too small.
+size_t utf16ToUtf8(const char16_t* text,
+                   size_t textLen,
+                   char* out,
+                   size_t outLen);
+
 }  // namespace base
 }  // namespace android
@@ -18,26 +18,64 @@
 
 #include "aemu/base/network/IpAddress.h"
 
+#include <functional>
 #include <string_view>
 #include <vector>
 
+#include <stdint.h>
+
 namespace android {
 namespace base {
 
+class Looper;
+
 // A convenience class to wrap the system's DNS resolver.
 //
 // Usage:
 //    Dns::AddressList list = Dns::resolveName("<server-name>");
 //    if (list.empty()) { ... error ... }
 //
+//    Dns::resolveNameAsync("<server-name>", looper,
+//                          [](const Dns::AddressList& list) { ... });
+//
+// Both forms share a process-wide cache: results are kept for their
+// time-to-live, up to a bounded number of names evicted least recently
+// used first, and failures are remembered briefly so a dead name is not
+// queried in a loop. Addresses come back in Happy Eyeballs order (RFC 8305),
+// see interleaveAddressFamilies().
 class Dns {
 public:
     using AddressList = std::vector<IpAddress>;
 
+    // Receives the result of resolveNameAsync(). |list| is empty on failure.
+    using ResolveCallback = std::function<void(const AddressList& list)>;
+
     // Resolve name |server_name| into a list of IpAddress instances.
-    // Return an empty list on failure.
+    // Return an empty list on failure. A cached result is returned without
+    // a query; otherwise this blocks on the resolver.
     static AddressList resolveName(std::string_view server_name);
 
+    // Resolve |server_name| without blocking the caller. The query runs on
+    // one of a few resolver threads and |callback| is posted to |looper| with
+    // scheduleCallback(), so it always runs on the looper thread, even for
+    // a cached result. If |looper| is nullptr, |callback| runs on the
+    // thread that completes the query, or before this returns on a cache
+    // hit. Concurrent requests for a name that is being resolved share the
+    // one query.
+    static void resolveNameAsync(std::string_view server_name,
+                                 Looper* looper,
+                                 ResolveCallback&& callback);
+
+    // Reorder |list| in place so address families alternate, starting
+    // with the family of the first entry and keeping the resolver's order
+    // within each family. A client connecting to the entries in turn then
+    // falls back to the other family after one failed attempt.
+    static void interleaveAddressFamilies(AddressList* list);
+
+    // Drop all cached results. Queries in flight still complete and are
+    // delivered, but their results are not cached.
+    static void clearCache();
+
     // Return the list of DNS server addresses used by the system.
     // This works by either parsing /etc/resolver.conf on Posix or
     // calling the appropriate Win32 API.
@@ -60,6 +98,18 @@ public:
         virtual int resolveName(std::string_view server_name,
                                 AddressList* out) = 0;
 
+        // How long results of resolvers that cannot see the records' TTL
+        // are cached, and how long a failure is cached.
+        static constexpr uint32_t kDefaultTtlSeconds = 60;
+        static constexpr uint32_t kNegativeTtlSeconds = 5;
+
+        // Same as resolveName(), but also sets |*ttl_seconds| on success to
+        // how long the result may be cached, 0 meaning not at all. The
+        // default implementation reports kDefaultTtlSeconds.
+        virtual int resolveNameWithTtl(std::string_view server_name,
+                                       AddressList* out,
+                                       uint32_t* ttl_seconds);
+
         // Return the list of DNS servers used by the system. On success,
         // return 0 and append results to |*out|. On failure, just return
         // a negative errno code.
@@ -73,7 +123,8 @@ public:
         // Change the process-global resolver. Return the old one, or
         // nullptr. |resolver| can be nullptr, in which case a future
         // call to get() will create a new system-level resolver
-        // (e.g. reparsing /etc/resolv.conf explicitly).
+        // (e.g. reparsing /etc/resolv.conf explicitly). The cache is
+        // cleared, so results from the old resolver are not returned.
         static Resolver* setForTesting(Resolver* resolver);
     };
 };
@@ -13,6 +13,9 @@
 // limitations under the License.
 #pragma once
 
+#include <string>
+#include <vector>
+
 namespace android {
 namespace base {
 
@@ -39,7 +42,17 @@ public:
         IgnoreDecrease,
     };
 
+    virtual ~Analyzer() = default;
+
     virtual void outputJson(base::JsonWriter*) { }
+
+    // |runs| holds the samples of each recorded run, oldest first and ending
+    // with the current one. Returns why the current run looks like a
+    // regression, or an empty string if it doesn't.
+    virtual std::string findRegression(
+            const std::vector<std::vector<long>>& runs) const {
+        return {};
+    }
 };
 
 } // namespace perflogger
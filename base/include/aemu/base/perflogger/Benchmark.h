@@ -48,6 +48,9 @@ public:
     std::string getDescription() const;
     const Metadata& getMetadata() const;
 
+    // Adds a sample to Metric::get(metricName, <output dir>), with
+    // |analyzer| checking it on commit. Nothing is written until
+    // Metric::commitAll().
     void log(const std::string& metricName, long data);
     void log(const std::string& metricName, long data, Analyzer* analyzer);
 
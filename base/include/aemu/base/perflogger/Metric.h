@@ -14,16 +14,18 @@
 #pragma once
 
 #include "aemu/base/perflogger/Analyzer.h"
+#include "aemu/base/perflogger/Benchmark.h"
 
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 namespace android {
 namespace perflogger {
 
-class Benchmark;
-
+// Samples of one metric from any number of benchmarks. commit() writes them to
+// <outputDir>/<metricName>.json, appends them to the run history kept in
+// <outputDir>/<metricName>.history, and runs each benchmark's analyzers over
+// that history.
 class Metric {
 public:
     struct MetricSample {
@@ -31,8 +33,15 @@ public:
         long data;
     };
 
+    // $AEMU_PERFLOGGER_DIR, or the current directory.
     static std::string getPreferredOutputDirectory();
 
+    // The process-wide metric Benchmark::log() records to.
+    static Metric& get(const std::string& metricName,
+                       const std::string& outputDir);
+    // Commits every metric returned by get(), returning the regressions.
+    static std::vector<std::string> commitAll();
+
     Metric(const std::string& metricName);
     Metric(const std::string& metricName, const std::string& outputDir);
 
@@ -42,16 +51,27 @@ public:
     void addSamples(Benchmark* benchmark,
                     const std::vector<MetricSample>& data);
 
+    // The analyzers are not copied and must outlive commit().
     void setAnalyzers(Benchmark* benchmark,
-                      const std::vector<Analyzer>& analyzers);
+                      const std::vector<Analyzer*>& analyzers);
+    void addAnalyzer(Benchmark* benchmark, Analyzer* analyzer);
 
-    void commit();
+    // Writes the samples added since the last commit and returns the
+    // regressions the analyzers found, one line each.
+    std::vector<std::string> commit();
 
 private:
+    struct Entry {
+        Benchmark benchmark;
+        std::vector<MetricSample> samples;
+        std::vector<Analyzer*> analyzers;
+    };
+
+    Entry& entryFor(const Benchmark& benchmark);
+
     std::string mName;
     std::string mOutputDirectory;
-    std::unordered_map<Benchmark*, std::vector<MetricSample>> mSamples;
-    std::unordered_map<Benchmark*, std::vector<Analyzer>> mAnalyzers;
+    std::vector<Entry> mEntries;
 };
 
 } // namespace perflogger
@@ -28,6 +28,16 @@ class JsonWriter;
 namespace android {
 namespace perflogger {
 
+// Compares the |recentWindowSize| most recent runs against the runs before
+// them, looking back |runInfoQueryLimit| runs at most. Each run is reduced to
+// one value with |aggregate|. The recent runs are a regression if their mean
+// (median) is further from the older runs' mean (median) than any of the
+// tolerances allow:
+//
+//   constTerm + meanCoeff * |mean| + stddevCoeff * stddev
+//   constTerm + medianCoeff * |median| + madCoeff * median absolute deviation
+//
+// |bias| ignores deviations in one direction, e.g. IgnoreDecrease for times.
 class WindowDeviationAnalyzer : public Analyzer {
 public:
     struct MedianToleranceParams {
@@ -47,12 +57,15 @@ public:
         int runInfoQueryLimit,
         int recentWindowSize,
         const std::vector<MeanToleranceParams>& meanTolerances,
-        const std::vector<MedianToleranceParams>& medianTolerances);
+        const std::vector<MedianToleranceParams>& medianTolerances,
+        DirectionBias bias = NoBias);
 
     WindowDeviationAnalyzer(
         const WindowDeviationAnalyzer& other);
 
     void outputJson(base::JsonWriter*) override;
+    std::string findRegression(
+            const std::vector<std::vector<long>>& runs) const override;
 
 private:
     MetricAggregate mAggregate;
@@ -60,6 +73,7 @@ private:
     int mRecentWindowSize;
     std::vector<MeanToleranceParams> mMeanTolerances;
     std::vector<MedianToleranceParams> mMedianTolerances;
+    DirectionBias mBias;
 };
 
 } // namespace perflogger
@@ -0,0 +1,83 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include <optional>
+
+#include "aemu/base/process/Process.h"
+
+namespace android {
+namespace base {
+
+/**
+ * How spawnProcess() starts the child.
+ */
+enum class SpawnMethod {
+    /**
+     * posix_spawn(), which glibc and macOS implement without copying the
+     * parent's page tables, so launching costs the same however much memory
+     * the parent has mapped. Falls back to kFork where the options need
+     * something posix_spawn() can't do on this platform.
+     */
+    kPosixSpawn,
+    /**
+     * fork() then exec. Copies the page tables of the whole parent, which
+     * takes tens of milliseconds for an emulator with gigabytes of guest
+     * RAM mapped.
+     */
+    kFork,
+};
+
+/**
+ * Where a spawned child's standard streams go, and what else it gets.
+ */
+struct SpawnOptions {
+    /**
+     * Descriptors to put in place of the child's stdin, stdout and stderr,
+     * e.g. pipe ends, or -1 to share the parent's.
+     */
+    int stdinFd = -1;
+    int stdoutFd = -1;
+    int stderrFd = -1;
+
+    /**
+     * Whether the child keeps the parent's descriptors that aren't
+     * close-on-exec. If not, it only has its standard streams.
+     */
+    bool inherit = false;
+
+    /**
+     * Whether the child starts a new session, away from the parent's
+     * terminal and process group, as daemons do.
+     */
+    bool newSession = false;
+
+    SpawnMethod method = SpawnMethod::kPosixSpawn;
+};
+
+/**
+ * Starts |args| (the program, looked up in PATH, then its arguments) as a
+ * child process, the way Command::execute() launches its processes on POSIX
+ * systems. The child starts with no blocked signals and SIGPIPE at its
+ * default.
+ *
+ * @return The child's pid, or std::nullopt with errno set if it could not be
+ *         started, including when the program doesn't exist (with
+ *         kPosixSpawn; a forked child exits with status 127 instead).
+ */
+std::optional<Pid> spawnProcess(const CommandArguments& args,
+                                const SpawnOptions& options = {});
+
+}  // namespace base
+}  // namespace android
@@ -22,12 +22,17 @@ struct ring_buffer {
     uint32_t host_version;
     uint32_t guest_version;
     uint32_t write_pos; // Atomically updated for the consumer
-    uint32_t unused0[13]; // Separate cache line
+    uint32_t read_waiters; // Consumers parked on write_pos (blocking mode)
+    uint32_t wait_mode; // enum ring_buffer_wait_mode
+    uint32_t write_spin_us; // Adaptive spin budget of ring_buffer_wait_write
+    uint32_t unused0[10]; // Separate cache line
     uint32_t read_pos; // Atomically updated for the producer
     uint32_t read_live_count;
     uint32_t read_yield_count;
     uint32_t read_sleep_us_count;
-    uint32_t unused1[12]; // Separate cache line
+    uint32_t write_waiters; // Producers parked on read_pos (blocking mode)
+    uint32_t read_spin_us; // Adaptive spin budget of ring_buffer_wait_read
+    uint32_t unused1[10]; // Separate cache line
     uint8_t buf[RING_BUFFER_SIZE];
     uint32_t state; // An atomically updated variable from both
                     // producer and consumer for other forms of
@@ -59,6 +64,10 @@ struct ring_buffer_view {
     uint8_t* buf;
     uint32_t size;
     uint32_t mask;
+    // Nonzero if |buf| is followed by a second mapping of the same pages, so
+    // that any |size| bytes starting inside |buf| are contiguous. See
+    // ring_buffer_view_init_mirrored.
+    uint32_t mirrored;
 };
 
 // Convenience struct that holds a pointer to a ring along with a view.  It's a
@@ -87,6 +96,18 @@ void ring_buffer_init_view_only(
     uint8_t* buf,
     uint32_t size);
 
+// Like ring_buffer_view_init, but allocates the buffer itself and maps it twice
+// back to back ("magic ring"), so spans returned by the reserve/peek functions
+// below never wrap. |size| is rounded up to a power of two that is a multiple
+// of the page size. Returns false (leaving |v| untouched) if the platform
+// can't provide such a mapping; callers should fall back to a regular buffer.
+// The buffer must be released with ring_buffer_view_free_mirrored.
+bool ring_buffer_view_init_mirrored(
+    struct ring_buffer* r,
+    struct ring_buffer_view* v,
+    uint32_t size);
+void ring_buffer_view_free_mirrored(struct ring_buffer_view* v);
+
 // Read/write functions with the view.
 long ring_buffer_view_write(
     struct ring_buffer* r,
@@ -97,12 +118,140 @@ long ring_buffer_view_read(
     struct ring_buffer_view* v,
     void* data, uint32_t step_size, uint32_t steps);
 
+// How ring_buffer_wait_read / ring_buffer_wait_write behave once spinning
+// has not made the ring available.
+//
+// RING_BUFFER_WAIT_POLL (the default) yields and then sleeps in fixed 2 ms
+// steps.
+//
+// RING_BUFFER_WAIT_BLOCKING parks the waiter on write_pos / read_pos (futex on
+// Linux, WaitOnAddress on Windows, ulock on macOS) and has the other side wake
+// it up, but only if a waiter is registered. Both sides need to go through
+// this library for wakeups to be prompt; a peer that updates the positions by
+// other means (e.g. an older guest) is still observed, with at most
+// |RING_BUFFER_MAX_PARK_US| of added latency.
+//
+// In both modes the spin budget adapts to how quickly the other side has been
+// making the ring available.
+enum ring_buffer_wait_mode {
+    RING_BUFFER_WAIT_POLL = 0,
+    RING_BUFFER_WAIT_BLOCKING = 1,
+};
+
+#define RING_BUFFER_MAX_PARK_US 2000
+
+// Must be called after ring_buffer_init / ring_buffer_view_init, which reset
+// the mode to RING_BUFFER_WAIT_POLL.
+void ring_buffer_set_wait_mode(struct ring_buffer* r,
+                               enum ring_buffer_wait_mode mode);
+
+// Zero-copy access to a view. A span is a contiguous region of the view's
+// buffer; a wrapped region is described by two spans, the second of which
+// starts at the beginning of the buffer. Unused spans have size 0.
+struct ring_buffer_span {
+    uint8_t* data;
+    uint32_t size;
+};
+
+// Producer side: reserves |bytes| of free space without copying anything.
+// The caller fills in |span1| then |span2| and publishes the data with
+// ring_buffer_view_commit_write. Returns 0 on success, or -1 with errno set as
+// in ring_buffer_view_write if there isn't enough space.
+int ring_buffer_view_reserve_write(
+    const struct ring_buffer* r,
+    const struct ring_buffer_view* v,
+    uint32_t bytes,
+    struct ring_buffer_span* span1,
+    struct ring_buffer_span* span2);
+// Publishes |bytes| previously reserved with ring_buffer_view_reserve_write.
+void ring_buffer_view_commit_write(
+    struct ring_buffer* r,
+    const struct ring_buffer_view* v,
+    uint32_t bytes);
+
+// Consumer side: returns spans covering the next |bytes| of readable data
+// without consuming them. Returns 0 on success, or -1 with errno set as in
+// ring_buffer_view_read if less than |bytes| is available.
+int ring_buffer_view_peek_read(
+    const struct ring_buffer* r,
+    const struct ring_buffer_view* v,
+    uint32_t bytes,
+    struct ring_buffer_span* span1,
+    struct ring_buffer_span* span2);
+// Releases |bytes| previously returned by ring_buffer_view_peek_read back to
+// the producer.
+void ring_buffer_view_consume_read(
+    struct ring_buffer* r,
+    const struct ring_buffer_view* v,
+    uint32_t bytes);
+
+// Framed records on a view, for variable-length messages. Each record is a
+// 4-byte header holding the payload size, then the payload, padded to 4
+// bytes; header and payload are published with a single write_pos update.
+// Records never wrap: if one doesn't fit before the end of a regular view,
+// the writer fills the rest with a padding record, which readers skip, and
+// starts over at the beginning of the buffer. Mirrored views need no padding.
+//
+// A view carrying records must carry nothing else, and its positions must
+// start 4-byte aligned, as they do after ring_buffer_view_init.
+#define RING_BUFFER_RECORD_HEADER_SIZE 4
+#define RING_BUFFER_RECORD_PAD 0x80000000u
+
+// The largest payload ring_buffer_view_write_record takes on |v|: half the
+// view, less the header, so that a record plus padding always fits once the
+// ring drains, or the whole view for a mirrored one.
+uint32_t ring_buffer_view_max_record(const struct ring_buffer_view* v);
+
+// Writes |bytes| of |data| as one record. Returns 0 on success, or -1 with
+// errno set to -EAGAIN if there isn't room yet, or -EMSGSIZE if |bytes| is
+// over ring_buffer_view_max_record.
+int ring_buffer_view_write_record(
+    struct ring_buffer* r,
+    struct ring_buffer_view* v,
+    const void* data,
+    uint32_t bytes);
+
+// Sets |bytes| to the payload size of the next record without consuming it.
+// Returns 0, or -1 with errno set to -EAGAIN if no record is available.
+int ring_buffer_view_peek_record_size(
+    const struct ring_buffer* r,
+    const struct ring_buffer_view* v,
+    uint32_t* bytes);
+
+// Reads the next record into |data| and sets |bytes| to its size. Returns 0,
+// or -1 with errno set to -EAGAIN if no record is available, or -EMSGSIZE if
+// it is larger than |capacity|, in which case |bytes| is still set and the
+// record is left in the ring.
+int ring_buffer_view_read_record(
+    struct ring_buffer* r,
+    struct ring_buffer_view* v,
+    void* data,
+    uint32_t capacity,
+    uint32_t* bytes);
+
+// Reads as many of the available records as fit, up to |max_records|, back to
+// back into |data|, and their sizes into |sizes|, consuming them with a single
+// read_pos update. Returns how many were read; if none, errno is set as in
+// ring_buffer_view_read_record.
+long ring_buffer_view_read_records(
+    struct ring_buffer* r,
+    struct ring_buffer_view* v,
+    void* data,
+    uint32_t capacity,
+    uint32_t* sizes,
+    uint32_t max_records);
+
 // Usage of ring_buffer as a waitable object.
 // These functions will back off if spinning too long.
 //
 // if |v| is null, it is assumed that the statically allocated ring buffer is
 // used.
 //
+// ring_buffer_wait_read keeps the read_*_count fields up to date:
+// read_live_count counts waits satisfied without sleeping, read_yield_count the
+// number of yields, and read_sleep_us_count the microseconds spent sleeping
+// or parked.
+//
 // Returns true if ring buffer became available, false if timed out.
 bool ring_buffer_wait_write(
     const struct ring_buffer* r,
@@ -146,6 +295,22 @@ uint32_t ring_buffer_read_fully_with_abort(
     uint32_t abort_value,
     const volatile uint32_t* abort_ptr);
 
+// Steps of at least the bulk copy threshold through ring_buffer_view_write()
+// are copied in with non-temporal stores where the CPU has them, so a
+// transfer far bigger than the cache doesn't evict the producer's working
+// set; the matching ring_buffer_view_read() prefetches ahead of its copy,
+// since the data isn't cached. Smaller steps are plain memcpy()s.
+//
+// Off by default: when the last-level cache holds the ring, the consumer
+// reading streamed steps back from memory costs more than the pollution it
+// saves (see BM_RingBuffer_BulkTransfer). RING_BUFFER_BULK_COPY_THRESHOLD is
+// a reasonable threshold for hosts where it pays off.
+#define RING_BUFFER_BULK_COPY_THRESHOLD (256 * 1024)
+#define RING_BUFFER_BULK_COPY_OFF UINT32_MAX
+
+// Sets the bulk copy threshold for the whole process.
+void ring_buffer_set_bulk_copy_threshold(uint32_t bytes);
+
 uint32_t ring_buffer_view_get_ring_pos(
     const struct ring_buffer_view* v,
     uint32_t index);
@@ -221,6 +386,76 @@ void ring_buffer_consumer_wait_producer_idle(struct ring_buffer* r);
 // Sets the state to hung up.
 void ring_buffer_consumer_hung_up(struct ring_buffer* r);
 
+// Multi-producer, single-consumer ring for fan-in within the host, e.g.
+// several decoder workers feeding one render thread, without a mutex around
+// a single-producer ring or one ring per producer. Not for sharing with the
+// guest.
+//
+// Data goes in whole slots of a size fixed at init. Producers claim slots
+// by advancing |reserve_pos| with a compare-and-swap, fill them in, and
+// commit. Commits may finish out of order; each marks the first slot of its
+// claim, and whichever producer finds the claim at |ring.write_pos|
+// committed publishes it and any committed claims after it, so the consumer
+// only ever sees data in claim order.
+//
+// The consumer uses |ring| and |view| like any other ring:
+// ring_buffer_view_read, ring_buffer_view_peek_read /
+// ring_buffer_view_consume_read, ring_buffer_wait_read, including the
+// blocking wait mode. Producers waiting for room park on read_pos the same
+// way. For hang-ups, producers use ring_buffer_mpsc_producer_acquire /
+// ring_buffer_mpsc_producer_idle, which count active producers in |state|;
+// the consumer side of the sync protocol is unchanged.
+struct ring_buffer_mpsc {
+    struct ring_buffer ring;  // write_pos: published; its buf is unused
+    struct ring_buffer_view view;
+    uint32_t slot_shift;
+    // One per slot: (claim start << 32) | claim bytes once committed, 0
+    // otherwise. Tagging with the start keeps a late producer from
+    // publishing a later lap's commit.
+    uint64_t* commits;
+    uint32_t unused0[10]; // Separate cache line
+    uint32_t reserve_pos; // Claimed by producers
+    uint32_t unused1[15]; // Separate cache line
+};
+
+// Initializes |m| over |buf| as in ring_buffer_view_init, with slots of
+// |slot_size| bytes, a power of two no larger than a quarter of the buffer.
+// Returns false if |slot_size| doesn't fit or allocating the commit flags
+// fails. Release with ring_buffer_mpsc_destroy.
+bool ring_buffer_mpsc_init(
+    struct ring_buffer_mpsc* m,
+    uint8_t* buf,
+    uint32_t size,
+    uint32_t slot_size);
+void ring_buffer_mpsc_destroy(struct ring_buffer_mpsc* m);
+
+// Producer side: claims |slots| slots without copying anything, for the
+// caller to fill in through |span1| then |span2| and pass to
+// ring_buffer_mpsc_commit along with |*pos|. Returns 0 on success, or -1
+// with errno set as in ring_buffer_view_write if there isn't enough room.
+int ring_buffer_mpsc_reserve(
+    struct ring_buffer_mpsc* m,
+    uint32_t slots,
+    uint32_t* pos,
+    struct ring_buffer_span* span1,
+    struct ring_buffer_span* span2);
+void ring_buffer_mpsc_commit(
+    struct ring_buffer_mpsc* m,
+    uint32_t pos,
+    uint32_t slots);
+
+// Copies |slots| slots from |data| in one claim, waiting up to |timeout_us|
+// for room. Returns false if it timed out.
+bool ring_buffer_mpsc_write(
+    struct ring_buffer_mpsc* m,
+    const void* data,
+    uint32_t slots,
+    uint64_t timeout_us);
+
+bool ring_buffer_mpsc_producer_acquire(struct ring_buffer_mpsc* m);
+bool ring_buffer_mpsc_producer_acquire_from_hangup(struct ring_buffer_mpsc* m);
+void ring_buffer_mpsc_producer_idle(struct ring_buffer_mpsc* m);
+
 // Convenient function to reschedule thread
 void ring_buffer_yield();
 ANDROID_END_HEADER
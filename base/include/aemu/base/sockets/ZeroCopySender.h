@@ -0,0 +1,129 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#ifdef _MSC_VER
+#include "aemu/base/msvc.h"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+
+namespace android {
+namespace base {
+
+// Sends bulk data to a stream socket without copying it into the socket
+// buffer, where the platform allows. Meant for transfers of many megabytes,
+// like screen recording frames, pulled files or exported snapshots, where
+// socketSend() spends most of its time copying.
+//
+// On Linux, buffers of at least kMinZeroCopySize go out with MSG_ZEROCOPY.
+// The kernel then sends from the caller's pages, so a buffer must stay
+// alive and unchanged until the kernel is done with it: after sending a
+// buffer, pass releaseWhenSent() what frees it. The kernel reports finished
+// sends on the socket's error queue (POLLERR), which pollCompletions()
+// reads. If the socket doesn't take SO_ZEROCOPY, or the kernel says it
+// copied anyway (loopback, some NICs), sends are plain ones from then on and
+// releases run right away.
+//
+// File-backed payloads go through sendFile(), which uses sendfile() on Linux
+// and macOS, and reads and sends elsewhere.
+//
+// Not thread-safe. Errors are returned as -1/errno, like socketSend().
+class ZeroCopySender {
+public:
+    using Release = std::function<void()>;
+
+    // Smaller sends cost more to pin and track than to copy.
+    static constexpr size_t kMinZeroCopySize = 16 * 1024;
+
+    explicit ZeroCopySender(int socket);
+    // Waits up to kDrainTimeoutMs for outstanding sends, then runs the
+    // remaining releases. Close the socket after this.
+    ~ZeroCopySender();
+
+    int socket() const { return mSocket; }
+    // Whether sends may still go out zero-copy.
+    bool zeroCopy() const { return mZeroCopy; }
+
+    // Sends up to |size| bytes of |data|. Returns how many were sent, which
+    // may be fewer on a non-blocking socket, or -1/errno. Loops around EINTR
+    // and never raises SIGPIPE.
+    ssize_t send(const void* data, size_t size);
+
+    // Like send(), until all of |data| is sent or an error other than
+    // EAGAIN occurs; waits for the socket to be writable in between.
+    bool sendAll(const void* data, size_t size);
+
+    // Sends up to |size| bytes of |fd| from |offset|. Returns how many were
+    // sent, or -1/errno.
+    ssize_t sendFile(int fd, uint64_t offset, size_t size);
+
+    // Runs |release| once everything sent so far has left the caller's
+    // memory; right away if it already has.
+    void releaseWhenSent(Release release);
+
+    // Reads finished zero-copy sends from the error queue and runs the
+    // releases they complete. Call it when the socket reports POLLERR, or
+    // now and then. Returns how many releases ran.
+    size_t pollCompletions();
+
+    // Polls for completions until none are outstanding or |timeoutMs|
+    // passes. Returns whether none are.
+    bool drain(int timeoutMs);
+
+    // Zero-copy sends the kernel hasn't finished with.
+    uint32_t outstanding() const { return mIssued - mCompleted; }
+
+    static constexpr int kDrainTimeoutMs = 1000;
+
+    struct Stats {
+        uint64_t zeroCopyBytes = 0;
+        uint64_t copiedBytes = 0;
+        uint64_t fileBytes = 0;
+    };
+    const Stats& stats() const { return mStats; }
+
+private:
+    ssize_t sendZeroCopy(const void* data, size_t size);
+    void complete(uint32_t lo, uint32_t hi);
+    size_t runReleases();
+
+    const int mSocket;
+    bool mZeroCopy = false;
+
+    // Sends are numbered by the kernel from 0, one per zero-copy send.
+    uint32_t mIssued = 0;
+    // Every send below this has completed.
+    uint32_t mCompleted = 0;
+    // Completed ranges past mCompleted, first -> last, inclusive.
+    std::map<uint32_t, uint32_t> mAhead;
+
+    struct PendingRelease {
+        uint32_t after;  // runs once mCompleted reaches this
+        Release release;
+    };
+    std::deque<PendingRelease> mReleases;
+
+    Stats mStats;
+};
+
+}  // namespace base
+}  // namespace android
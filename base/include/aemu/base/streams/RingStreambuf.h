@@ -12,8 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #pragma once
+#include "aemu/base/synchronization/AddressWait.h"
+
 #include <chrono>
-#include <condition_variable>
 #include <cstdint>
 #include <cstdio>
 #include <ios>
@@ -44,8 +45,40 @@ namespace streams {
 // Be very careful when using this as an input stream!
 // - It can block when nothing is available, for up to timeout ms.
 // - It will consume the stream (i.e. read pointers will move)
+//
+// Bulk consumers can skip the streambuf copy and per-call overhead with the
+// span calls, which hand out contiguous views into the ring:
+//
+//   auto span = buf.acquireRead(4096);   // One consumer.
+//   send(span.data, span.size);
+//   buf.releaseRead(span.size);
+//
+//   auto span = buf.acquireReadAt(myOffset, 4096);  // Any number of them.
+//   send(span.data, span.size);
+//   myOffset = span.offset + span.size;
+//   buf.releaseReadAt();
+//
+// acquireReadAt() doesn't consume anything, so several readers can each tail
+// the stream at their own offset, as with bufferAtOffset(). While any read
+// span is held, writers wait instead of overwriting the bytes under it, so
+// spans should be released promptly. A span of size 0 needs no release.
+//
+// Waiting is done with AddressWaiter, so a side only makes a system call to
+// wake the other when it is actually asleep.
 class RingStreambuf : public std::streambuf {
 public:
+    struct ReadSpan {
+        const char* data = nullptr;
+        size_t size = 0;
+        // Stream offset of data[0], see bufferAtOffset().
+        uint64_t offset = 0;
+    };
+
+    struct WriteSpan {
+        char* data = nullptr;
+        size_t size = 0;
+    };
+
     // |capacity| the minimum number of chars that can be stored.
     // |timeout| the max time to wait for data when using it in a stream.
     // The real capacity will be a power of 2 above capacity.
@@ -71,6 +104,32 @@ public:
     // Note: The return value can be less than n, in case of a timeout.
     std::streamsize waitForAvailableSpace(std::streamsize n);
 
+    // Waits up to the stream timeout for data and returns a view of the
+    // oldest unread bytes, at most |n| and never across the end of the ring.
+    // Returns an empty span on timeout, or once closed and drained. Only one
+    // thread may consume at a time.
+    ReadSpan acquireRead(size_t n);
+    // Consumes the first |consumed| bytes of the span from acquireRead().
+    void releaseRead(size_t consumed);
+
+    // Like bufferAtOffset() without the copy: a view of up to |n| bytes
+    // starting at |offset|, or at the oldest byte still stored if that is
+    // later, waiting up to |timeout| for it to be written. Returns an empty
+    // span with |offset| set to the current end of the stream if nothing
+    // came.
+    ReadSpan acquireReadAt(uint64_t offset,
+                           size_t n,
+                           milliseconds timeout = milliseconds(0));
+    void releaseReadAt();
+
+    // Returns a contiguous region of up to |n| bytes to write into, dropping
+    // the oldest unread data if there isn't that much free space, like
+    // xsputn() does. Returns an empty span once closed. Only one thread may
+    // write through spans, and not alongside stream writes.
+    WriteSpan acquireWrite(size_t n);
+    // Publishes the first |written| bytes of the span from acquireWrite().
+    void commitWrite(size_t written);
+
     // The total number of bytes that can be stored in the buffer.
     size_t capacity() { return mRingbuffer.capacity() - 1; }
 
@@ -93,6 +152,18 @@ protected:
     int uflow() override;
 
 private:
+    // Waits on |waiter| until |pred| holds or |timeout| passes, with |lock|
+    // released while asleep. Returns the final value of |pred|.
+    template <class Pred>
+    bool waitLocked(std::unique_lock<std::mutex>& lock,
+                    AddressWaiter& waiter,
+                    milliseconds timeout,
+                    Pred pred);
+    // Blocks while read spans are held and writing |n| bytes would
+    // overwrite some that are unread.
+    void waitToOverwriteLocked(std::unique_lock<std::mutex>& lock,
+                               std::streamsize n);
+
     std::vector<char> mRingbuffer;
 
     uint32_t mHead{0};        // Ringbuffer write pointer (front)
@@ -102,8 +173,12 @@ private:
     bool mClosed{false};
     std::chrono::milliseconds mTimeout;
 
+    int mReaders{0};  // Read spans currently held.
+
     std::mutex mLock;
-    std::condition_variable mCanRead;
+    // Readers wait here for data, writers for free space or released spans.
+    AddressWaiter mCanRead;
+    AddressWaiter mCanWrite;
 };
 
 }  // namespace streams
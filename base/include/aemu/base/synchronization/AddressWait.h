@@ -0,0 +1,80 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace android {
+namespace base {
+
+constexpr uint64_t kAddressWaitForever = UINT64_MAX;
+
+// Blocks the calling thread while |*addr| holds |expected|, until another
+// thread calls wakeAddress() on it or |timeoutUs| elapses. This is a thin
+// wrapper around futex(2) on Linux, WaitOnAddress() on Windows and
+// __ulock_wait() on macOS. Spurious wakeups are possible, so callers must
+// always re-check their condition.
+void waitOnAddress(std::atomic<uint32_t>* addr, uint32_t expected,
+                   uint64_t timeoutUs = kAddressWaitForever);
+
+// Wakes threads blocked in waitOnAddress() on |addr|: all of them if |all| is
+// true, otherwise at least one.
+void wakeAddress(std::atomic<uint32_t>* addr, bool all);
+
+// An event count built on waitOnAddress(), for lock-free structures that need
+// a thread to sleep until some condition becomes true. The waiter announces
+// itself before re-checking the condition, so notify() only does a system call
+// when somebody may actually be asleep:
+//
+//     while (!condition()) {
+//         uint32_t token = waiter.prepareWait();
+//         if (condition()) { waiter.cancelWait(); break; }
+//         waiter.wait(token);
+//     }
+//
+// and on the other side, after making the condition true: waiter.notify().
+class AddressWaiter {
+public:
+    uint32_t prepareWait() {
+        mWaiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return mEpoch.load(std::memory_order_relaxed);
+    }
+
+    void cancelWait() { mWaiters.fetch_sub(1, std::memory_order_relaxed); }
+
+    void wait(uint32_t token, uint64_t timeoutUs = kAddressWaitForever) {
+        waitOnAddress(&mEpoch, token, timeoutUs);
+        mWaiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void notify(bool all = true) {
+        // Pairs with the fetch_add() in prepareWait(): either the waiter sees
+        // the new state when it re-checks, or we see the waiter here.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mWaiters.load(std::memory_order_relaxed)) {
+            mEpoch.fetch_add(1, std::memory_order_seq_cst);
+            wakeAddress(&mEpoch, all);
+        }
+    }
+
+private:
+    std::atomic<uint32_t> mEpoch{0};
+    std::atomic<uint32_t> mWaiters{0};
+};
+
+}  // namespace base
+}  // namespace android
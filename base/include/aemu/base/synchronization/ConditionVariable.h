@@ -105,15 +105,20 @@ public:
     //    if (!condition) { condVar.wait(&lock); }
     //
     void wait(StaticLock* userLock) {
+        userLock->endHold();
         ::SleepConditionVariableSRW(&mCond, &userLock->mLock, INFINITE, 0);
+        userLock->resumeHold();
     }
 
     bool timedWait(StaticLock *userLock, uint64_t waitUntilUs) {
         const auto now = android::base::getUnixTimeUs();
         const auto timeout = waitUntilUs > now ?
                 std::max<uint32_t>(0, waitUntilUs  - now) / 1000 : 0;
-        return ::SleepConditionVariableSRW(
+        userLock->endHold();
+        const bool ret = ::SleepConditionVariableSRW(
                     &mCond, &userLock->mLock, timeout, 0) != 0;
+        userLock->resumeHold();
+        return ret;
     }
 
     // Signal that a condition was reached. This will wake at least (and
@@ -143,14 +148,20 @@ private:
     }
 
     void wait(StaticLock* userLock) {
+        userLock->endHold();
         pthread_cond_wait(&mCond, &userLock->mLock);
+        userLock->resumeHold();
     }
 
     bool timedWait(StaticLock* userLock, uint64_t waitUntilUs) {
         timespec abstime;
         abstime.tv_sec = waitUntilUs / 1000000LL;
         abstime.tv_nsec = (waitUntilUs % 1000000LL) * 1000;
-        return pthread_cond_timedwait(&mCond, &userLock->mLock, &abstime) == 0;
+        userLock->endHold();
+        const bool ret =
+                pthread_cond_timedwait(&mCond, &userLock->mLock, &abstime) == 0;
+        userLock->resumeHold();
+        return ret;
     }
 
     void signal() {
@@ -0,0 +1,117 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/synchronization/Lock.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace android {
+namespace base {
+
+// Epoch-based reclamation for containers whose readers don't take a lock.
+//
+// A reader wraps each lookup in a ReadScope. A writer that unlinks a piece of
+// memory hands it to retire() instead of freeing it; it is freed once every
+// ReadScope that was open when it was retired has closed. Entering and leaving
+// a ReadScope is wait-free: it only stores the current epoch into a slot
+// owned by the calling thread, plus a full fence. The fence is left to the
+// rare writers where the OS lets them run one on every thread of the process
+// (membarrier() on Linux, FlushProcessWriteBuffers() on Windows).
+//
+// There is a single process-wide instance, shared by all containers, so a
+// thread needs one slot no matter how many containers it reads from.
+class EpochReclaimer {
+public:
+    using Deleter = void (*)(void*);
+
+    static EpochReclaimer& get();
+
+    // Per-thread reader state.
+    struct alignas(64) Record {
+        // The epoch the owning thread saw when it entered its outermost
+        // ReadScope, or 0 when it is not reading.
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<bool> inUse{true};
+        // Only touched by the owning thread.
+        uint32_t depth = 0;
+        Record* next = nullptr;
+    };
+
+    // Nests; only the outermost scope on a thread stores anything. The scope
+    // keeps its thread's record, so leaving it needs no lookup.
+    class ReadScope {
+    public:
+        ReadScope() : mRecord(EpochReclaimer::enterRead()) {}
+        ~ReadScope() {
+            if (--mRecord->depth == 0) {
+                mRecord->epoch.store(0, std::memory_order_release);
+            }
+        }
+
+        DISALLOW_COPY_ASSIGN_AND_MOVE(ReadScope);
+
+    private:
+        Record* const mRecord;
+    };
+
+    // Frees |ptr| with |deleter| once no reader can still see it. |ptr| must
+    // already be unreachable for new readers.
+    void retire(void* ptr, Deleter deleter);
+
+    // Blocks until every ReadScope that was open when it was called has
+    // closed, so memory unlinked before the call can be freed by the caller.
+    // Must not be called from inside a ReadScope.
+    void synchronize();
+
+    // Frees what can be freed right now. retire() calls this every so often,
+    // so it is only needed to release memory eagerly, e.g. in tests.
+    void reclaim();
+
+    // Number of retired pointers not freed yet.
+    size_t pendingCount();
+
+private:
+    struct Retired {
+        void* ptr;
+        Deleter deleter;
+        uint64_t epoch;
+    };
+
+    EpochReclaimer();
+
+    // Returns the calling thread's record, with its depth incremented.
+    static Record* enterRead();
+    Record* acquireRecord();
+    // A full fence on the calling thread and, if mFenceAllThreads, on every
+    // other running thread of the process.
+    void fenceAllThreads();
+
+    // Readers copy this on entry; retire() advances it.
+    std::atomic<uint64_t> mEpoch{1};
+    // Set when fenceAllThreads() reaches other threads.
+    const bool mFenceAllThreads;
+    // Never shrinks; records of exited threads are reused.
+    std::atomic<Record*> mRecords{nullptr};
+
+    Lock mLock;
+    std::vector<Retired> mRetired;
+};
+
+}  // namespace base
+}  // namespace android
@@ -13,10 +13,12 @@
 // limitations under the License.
 #pragma once
 
-#include "aemu/base/synchronization/MessageChannel.h"
+#include "aemu/base/synchronization/Semaphore.h"
 
-// super minimal wrapper around MessageChannel to make it less verbose to
-// specify simple events and waiting on them
+#include <cstdint>
+
+// super minimal auto-reset event: signal() lets one wait() through, and
+// signals made while nobody waits collapse into one.
 //
 // WARNING: This does not behave like most 'event' classes; if two threads call
 // wait(), then signal() will only unblock one of the threads (there's no
@@ -30,23 +32,16 @@ namespace base {
 
 class Event {
 public:
-    void wait() {
-        int res;
-        mChannel.receive(&res);
-    }
+    void wait() { mSemaphore.wait(); }
 
     bool timedWait(uint64_t wallTimeUs) {
-        auto res = mChannel.timedReceive(wallTimeUs);
-        if (res) return true;
-        return false;
+        return mSemaphore.timedWait(wallTimeUs);
     }
 
-    void signal() {
-        mChannel.trySend(0);
-    }
+    void signal() { mSemaphore.signal(); }
 
 private:
-    MessageChannel<int, 1> mChannel;
+    BasicSemaphore<1> mSemaphore;
 };
 
 }  // namespace base
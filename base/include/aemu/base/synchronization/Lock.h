@@ -17,6 +17,7 @@
 #include "aemu/base/Compiler.h"
 
 #include "aemu/base/ThreadAnnotations.h"
+#include "aemu/base/synchronization/LockProfiler.h"
 
 #include <atomic>
 
@@ -28,6 +29,7 @@
 #endif
 
 #include <assert.h>
+#include <stdint.h>
 
 namespace android {
 namespace base {
@@ -36,17 +38,73 @@ class AutoLock;
 class AutoWriteLock;
 class AutoReadLock;
 
+// What lock() does while another thread holds the lock.
+enum class LockWait : uint8_t {
+    // Park in the kernel right away.
+    Park,
+    // Spin for a while first, retrying with a pause in between, and park
+    // only if the holder is still at it. For hot locks held for a few hundred
+    // nanoseconds, where the park and wakeup would cost more than the wait.
+    // The spin count adapts to how long the lock recently took to free up,
+    // up to kMaxLockSpins. Machines with a single CPU never spin.
+    SpinThenPark,
+};
+
+constexpr int kMaxLockSpins = 100;
+
 // A wrapper class for mutexes only suitable for using in static context,
 // where it's OK to leak the underlying system object. Use Lock for scoped or
-// member locks.
+// member locks. Give it a name to profile its contention; see LockProfiler.h.
 class CAPABILITY("mutex") StaticLock {
 public:
     using AutoLock = android::base::AutoLock;
 
     constexpr StaticLock() = default;
+    constexpr explicit StaticLock(const char* name) : mName(name) {}
+    constexpr StaticLock(const char* name, LockWait wait)
+        : mName(name), mWait(wait) {}
 
     // Acquire the lock.
     void lock() ACQUIRE() {
+        if (mName && LockProfiler::isEnabled()) {
+            profiledLock();
+            return;
+        }
+        lockRaw();
+    }
+
+    bool tryLock() TRY_ACQUIRE(true) {
+        const bool ret = tryLockRaw();
+        if (ret && mName && LockProfiler::isEnabled()) {
+            LockProfiler::site(mSite, mName)->recordAcquire(false, 0);
+            mHoldStartNs = LockProfiler::nowNs();
+        }
+        return ret;
+    }
+
+    // Release the lock.
+    void unlock() RELEASE() {
+        endHold();
+        unlockRaw();
+    }
+
+protected:
+    friend class ConditionVariable;
+
+    void lockRaw() {
+        if (mWait == LockWait::SpinThenPark) {
+            if (!tryLockRaw()) {
+                spinThenPark();
+            }
+            return;
+        }
+        parkRaw();
+    }
+
+    // Returns true if the lock was taken while spinning.
+    bool spinThenPark();
+
+    void parkRaw() {
 #ifdef _WIN32
         ::AcquireSRWLockExclusive(&mLock);
 #else
@@ -54,18 +112,15 @@ public:
 #endif
     }
 
-    bool tryLock() TRY_ACQUIRE(true) {
-        bool ret = false;
+    bool tryLockRaw() {
 #ifdef _WIN32
-        ret = ::TryAcquireSRWLockExclusive(&mLock);
+        return ::TryAcquireSRWLockExclusive(&mLock);
 #else
-        ret = ::pthread_mutex_trylock(&mLock) == 0;
+        return ::pthread_mutex_trylock(&mLock) == 0;
 #endif
-        return ret;
     }
 
-    // Release the lock.
-    void unlock() RELEASE() {
+    void unlockRaw() {
 #ifdef _WIN32
         ::ReleaseSRWLockExclusive(&mLock);
 #else
@@ -73,8 +128,23 @@ public:
 #endif
     }
 
-protected:
-    friend class ConditionVariable;
+    void profiledLock();
+
+    // Called with the lock held; a no-op unless the hold is being timed.
+    void endHold() {
+        if (mHoldStartNs) {
+            recordHold();
+        }
+    }
+    void recordHold();
+
+    // ConditionVariable waits release the mutex, so they end the hold and
+    // start a new one once they're back.
+    void resumeHold() {
+        if (mName && LockProfiler::isEnabled()) {
+            mHoldStartNs = LockProfiler::nowNs();
+        }
+    }
 
 #ifdef _WIN32
     // Benchmarks show that on Windows SRWLOCK performs a little bit better than
@@ -84,6 +154,14 @@ protected:
 #else
     pthread_mutex_t mLock = PTHREAD_MUTEX_INITIALIZER;
 #endif
+    const char* mName = nullptr;
+    const LockWait mWait = LockWait::Park;
+    // Recent spins before the lock freed up; guarded by mLock.
+    int16_t mSpinBudget = 0;
+    std::atomic<LockSite*> mSite{nullptr};
+    // When the current hold started, if it's being timed; guarded by mLock.
+    uint64_t mHoldStartNs = 0;
+
     // Both POSIX threads and WinAPI don't allow move (undefined behavior).
     DISALLOW_COPY_ASSIGN_AND_MOVE(StaticLock);
 };
@@ -94,6 +172,8 @@ public:
     using StaticLock::AutoLock;
 
     constexpr Lock() = default;
+    constexpr explicit Lock(const char* name) : StaticLock(name) {}
+    constexpr Lock(const char* name, LockWait wait) : StaticLock(name, wait) {}
 #ifndef _WIN32
     // The only difference is that POSIX requires a deallocation function call
     // for its mutexes.
@@ -108,26 +188,68 @@ public:
 
 #ifdef _WIN32
     constexpr ReadWriteLock() = default;
+    constexpr explicit ReadWriteLock(const char* name) : mName(name) {}
     ~ReadWriteLock() = default;
-    void lockRead() { ::AcquireSRWLockShared(&mLock); }
-    void unlockRead() { ::ReleaseSRWLockShared(&mLock); }
-    void lockWrite() { ::AcquireSRWLockExclusive(&mLock); }
-    void unlockWrite() { ::ReleaseSRWLockExclusive(&mLock); }
-
-private:
-    SRWLOCK mLock = SRWLOCK_INIT;
 #else   // !_WIN32
     ReadWriteLock() { ::pthread_rwlock_init(&mLock, NULL); }
+    explicit ReadWriteLock(const char* name) : mName(name) {
+        ::pthread_rwlock_init(&mLock, NULL);
+    }
     ~ReadWriteLock() { ::pthread_rwlock_destroy(&mLock); }
-    void lockRead() { ::pthread_rwlock_rdlock(&mLock); }
-    void unlockRead() { ::pthread_rwlock_unlock(&mLock); }
-    void lockWrite() { ::pthread_rwlock_wrlock(&mLock); }
-    void unlockWrite() { ::pthread_rwlock_unlock(&mLock); }
+#endif  // !_WIN32
+
+    void lockRead() {
+        if (mName && LockProfiler::isEnabled()) {
+            profiledLockRead();
+            return;
+        }
+        lockReadRaw();
+    }
+    void unlockRead() { unlockReadRaw(); }
+    void lockWrite() {
+        if (mName && LockProfiler::isEnabled()) {
+            profiledLockWrite();
+            return;
+        }
+        lockWriteRaw();
+    }
+    void unlockWrite() {
+        if (mWriteHoldStartNs) {
+            recordWriteHold();
+        }
+        unlockWriteRaw();
+    }
 
 private:
+#ifdef _WIN32
+    void lockReadRaw() { ::AcquireSRWLockShared(&mLock); }
+    bool tryLockReadRaw() { return ::TryAcquireSRWLockShared(&mLock); }
+    void unlockReadRaw() { ::ReleaseSRWLockShared(&mLock); }
+    void lockWriteRaw() { ::AcquireSRWLockExclusive(&mLock); }
+    bool tryLockWriteRaw() { return ::TryAcquireSRWLockExclusive(&mLock); }
+    void unlockWriteRaw() { ::ReleaseSRWLockExclusive(&mLock); }
+
+    SRWLOCK mLock = SRWLOCK_INIT;
+#else   // !_WIN32
+    void lockReadRaw() { ::pthread_rwlock_rdlock(&mLock); }
+    bool tryLockReadRaw() { return ::pthread_rwlock_tryrdlock(&mLock) == 0; }
+    void unlockReadRaw() { ::pthread_rwlock_unlock(&mLock); }
+    void lockWriteRaw() { ::pthread_rwlock_wrlock(&mLock); }
+    bool tryLockWriteRaw() { return ::pthread_rwlock_trywrlock(&mLock) == 0; }
+    void unlockWriteRaw() { ::pthread_rwlock_unlock(&mLock); }
+
     pthread_rwlock_t mLock;
 #endif  // !_WIN32
 
+    void profiledLockRead();
+    void profiledLockWrite();
+    void recordWriteHold();
+
+    const char* mName = nullptr;
+    std::atomic<LockSite*> mSite{nullptr};
+    // When the current write hold started, if it's being timed.
+    uint64_t mWriteHoldStartNs = 0;
+
     friend class ConditionVariable;
     DISALLOW_COPY_ASSIGN_AND_MOVE(ReadWriteLock);
 };
@@ -0,0 +1,145 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/Backtrace.h"
+#include "aemu/base/LatencyHistogram.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace android {
+namespace base {
+
+// Contention profiling for named locks. A StaticLock, Lock or ReadWriteLock
+// constructed with a name reports to the LockSite of that name, shared by
+// every lock with the same one:
+//
+//     Lock mContextsLock{"address_space_device.mContextsLock"};
+//
+// While profiling is on, a named lock is taken with a try-lock first, and
+// only when that fails does it time the blocking acquisition. The stack is
+// captured before blocking, and interned for the longest wait of each site.
+// Unnamed locks, and named ones while profiling is off, cost one extra
+// branch.
+//
+// Profiling starts off unless AEMU_LOCK_PROFILING=1 is in the environment.
+class LockSite {
+public:
+    explicit LockSite(const char* name);
+
+    const std::string& name() const { return mName; }
+
+    void recordAcquire(bool contended, uint64_t waitNs) {
+        mAcquisitions.fetch_add(1, std::memory_order_relaxed);
+        if (contended) {
+            mContended.fetch_add(1, std::memory_order_relaxed);
+            mTotalWaitNs.fetch_add(waitNs, std::memory_order_relaxed);
+            mWaitNs.record(waitNs);
+        }
+    }
+
+    void recordHold(uint64_t holdNs) { mHoldNs.record(holdNs); }
+
+    // A contended acquisition of a LockWait::SpinThenPark lock that got the
+    // lock without parking.
+    void recordSpinAcquire() { mSpun.fetch_add(1, std::memory_order_relaxed); }
+
+    // Keeps the stack |frames| if |waitNs| is the longest wait so far.
+    void recordWaitStack(uint64_t waitNs, void* const* frames, size_t depth);
+
+private:
+    friend class LockProfiler;
+
+    enum Counter {
+        kAcquisitions,
+        kContended,
+        kSpun,
+        kWaitP99,
+        kHoldP99,
+        kCounterCount,
+    };
+
+    const std::string mName;
+    // Names for traceCounter(), which keeps the pointers.
+    std::string mCounterNames[kCounterCount];
+
+    std::atomic<uint64_t> mAcquisitions{0};
+    std::atomic<uint64_t> mContended{0};
+    std::atomic<uint64_t> mSpun{0};
+    std::atomic<uint64_t> mTotalWaitNs{0};
+    std::atomic<uint64_t> mMaxWaitNs{0};
+    std::atomic<StackId> mMaxWaitStack{kInvalidStackId};
+    // Waits of contended acquisitions only, in nanoseconds.
+    LatencyHistogram mWaitNs;
+    // Exclusive holds, in nanoseconds; shared ReadWriteLock holds are not
+    // timed. Time spent in a ConditionVariable wait does not count.
+    LatencyHistogram mHoldNs;
+};
+
+// What a LockSite recorded between two takeStats() calls.
+struct LockSiteStats {
+    std::string name;
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;
+    // Of the contended acquisitions, those a spinning lock got without
+    // parking.
+    uint64_t spun = 0;
+    uint64_t totalWaitNs = 0;
+    // The longest wait and where it happened; see formatStack().
+    uint64_t maxWaitNs = 0;
+    StackId maxWaitStack = kInvalidStackId;
+    LatencyHistogram::Summary waitNs;
+    LatencyHistogram::Summary holdNs;
+};
+
+class LockProfiler {
+public:
+    static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled);
+
+    // The site for |name|, created on first use and never freed.
+    static LockSite* site(const char* name);
+
+    // Resolves |name| into |cache| once; for the locks' slow paths.
+    static LockSite* site(std::atomic<LockSite*>& cache, const char* name) {
+        LockSite* site = cache.load(std::memory_order_acquire);
+        if (!site) {
+            site = LockProfiler::site(name);
+            cache.store(site, std::memory_order_release);
+        }
+        return site;
+    }
+
+    static uint64_t nowNs();
+
+    // Returns what every site recorded since the last call, most total wait
+    // first, and starts over. Sites that were not acquired are left out.
+    static std::vector<LockSiteStats> takeStats();
+
+    // Like takeStats(), but emits the results as trace counters named
+    // "lock:<site>:{acquisitions,contended,spun,wait_p99_ns,hold_p99_ns}".
+    static void traceStats();
+
+private:
+    static std::atomic<bool> sEnabled;
+};
+
+}  // namespace base
+}  // namespace android
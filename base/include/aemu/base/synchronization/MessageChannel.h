@@ -15,9 +15,14 @@
 #pragma once
 
 #include "aemu/base/Optional.h"
+#include "aemu/base/synchronization/AddressWait.h"
 #include "aemu/base/synchronization/ConditionVariable.h"
 #include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/synchronization/MpscQueue.h"
+#include "aemu/base/system/System.h"
 
+#include <atomic>
+#include <thread>
 #include <utility>
 #include <stddef.h>
 
@@ -113,7 +118,12 @@ private:
 //   - From the sender thread, call send(msg);
 //   - From the receiver thread, call receive(&msg);
 //   - If you want to stop the IPC, call stop();
-template <typename T, size_t CAPACITY>
+//
+// With LockFreeQueue as |QueuePolicy| the channel is backed by a
+// BoundedMpscQueue instead of a lock, and senders only make a system call when
+// the receiver is asleep. Any number of threads may send, but only one thread
+// may receive (or call waitForEmpty()) at a time.
+template <typename T, size_t CAPACITY, class QueuePolicy = LockingQueue>
 class MessageChannel : public MessageChannelBase {
 public:
     MessageChannel() : MessageChannelBase(CAPACITY) {}
@@ -204,5 +214,139 @@ private:
     T mItems[CAPACITY];
 };
 
+template <typename T, size_t CAPACITY>
+class MessageChannel<T, CAPACITY, LockFreeQueue> {
+public:
+    MessageChannel() = default;
+
+    bool send(const T& msg) { return sendImpl(msg); }
+    bool send(T&& msg) { return sendImpl(std::move(msg)); }
+
+    bool trySend(const T& msg) { return trySendImpl(msg); }
+    bool trySend(T&& msg) { return trySendImpl(std::move(msg)); }
+
+    bool receive(T* msg) { return receiveUntil(msg, kAddressWaitForever); }
+
+    Optional<T> receive() {
+        T msg;
+        if (!receive(&msg)) {
+            return {};
+        }
+        return Optional<T>(std::move(msg));
+    }
+
+    bool tryReceive(T* msg) {
+        if (isStopped() || !mQueue.tryPop(msg)) {
+            return false;
+        }
+        mCanWrite.notify();
+        return true;
+    }
+
+    Optional<T> timedReceive(uint64_t wallTimeUs) {
+        T msg;
+        if (!receiveUntil(&msg, wallTimeUs)) {
+            return {};
+        }
+        return Optional<T>(std::move(msg));
+    }
+
+    // Get the current channel size
+    size_t size() const { return isStopped() ? 0 : mQueue.size(); }
+
+    // Abort the currently pending operations and don't allow any other ones
+    void stop() {
+        mStopped.store(true, std::memory_order_seq_cst);
+        mCanRead.notify();
+        mCanWrite.notify();
+    }
+
+    // Check if the channel is stopped.
+    bool isStopped() const { return mStopped.load(std::memory_order_acquire); }
+
+    // Block until the channel has no pending messages.
+    void waitForEmpty() {
+        while (size() > 0) {
+            uint32_t token = mCanWrite.prepareWait();
+            if (size() == 0) {
+                mCanWrite.cancelWait();
+                break;
+            }
+            mCanWrite.wait(token);
+        }
+    }
+
+    constexpr size_t capacity() const { return CAPACITY; }
+
+private:
+    template <class U>
+    bool sendImpl(U&& msg) {
+        for (;;) {
+            if (isStopped()) {
+                return false;
+            }
+            if (mQueue.tryPush(std::forward<U>(msg))) {
+                mCanRead.notify();
+                return true;
+            }
+            uint32_t token = mCanWrite.prepareWait();
+            if (isStopped() || mQueue.size() < CAPACITY) {
+                mCanWrite.cancelWait();
+                continue;
+            }
+            mCanWrite.wait(token);
+        }
+    }
+
+    template <class U>
+    bool trySendImpl(U&& msg) {
+        if (isStopped() || !mQueue.tryPush(std::forward<U>(msg))) {
+            return false;
+        }
+        mCanRead.notify();
+        return true;
+    }
+
+    // |wallTimeUs| is an absolute getUnixTimeUs() deadline, or
+    // kAddressWaitForever.
+    bool receiveUntil(T* msg, uint64_t wallTimeUs) {
+        for (;;) {
+            if (isStopped()) {
+                return false;
+            }
+            if (mQueue.tryPop(msg)) {
+                mCanWrite.notify();
+                return true;
+            }
+            if (mQueue.size()) {
+                // A sender claimed a slot and is still filling it in.
+                std::this_thread::yield();
+                continue;
+            }
+            uint64_t timeoutUs = kAddressWaitForever;
+            if (wallTimeUs != kAddressWaitForever) {
+                const uint64_t now = getUnixTimeUs();
+                if (now >= wallTimeUs) {
+                    return false;
+                }
+                timeoutUs = wallTimeUs - now;
+            }
+            uint32_t token = mCanRead.prepareWait();
+            if (isStopped() || mQueue.size()) {
+                mCanRead.cancelWait();
+                continue;
+            }
+            mCanRead.wait(token, timeoutUs);
+        }
+    }
+
+    BoundedMpscQueue<T, CAPACITY> mQueue;
+    std::atomic<bool> mStopped{false};
+    // The receiver waits here for messages, senders and waitForEmpty() for
+    // free slots.
+    AddressWaiter mCanRead;
+    AddressWaiter mCanWrite;
+};
+
 }  // namespace base
 }  // namespace android
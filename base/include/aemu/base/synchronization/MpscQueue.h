@@ -0,0 +1,205 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/synchronization/AddressWait.h"
+
+namespace android {
+namespace base {
+
+// Queue backend policies for WorkerThread and MessageChannel.
+//
+// LockingQueue is the default: a Lock and ConditionVariable guard the queue.
+// LockFreeQueue uses the multi-producer / single-consumer queues below, so the
+// producers never contend on a mutex and only make a system call when the
+// consumer is asleep. It requires that only one thread ever receives.
+struct LockingQueue {};
+struct LockFreeQueue {};
+
+// Element of an MpscQueue. Derive from it to make a type queueable.
+struct MpscQueueNode {
+    std::atomic<MpscQueueNode*> mpscNext{nullptr};
+};
+
+// Intrusive, unbounded multi-producer / single-consumer queue after Dmitry
+// Vyukov's design. push() is wait-free (one atomic exchange); pop() is
+// lock-free and may only be called from a single consumer thread. The queue
+// does not own the nodes. |T| must derive from MpscQueueNode.
+//
+// The consumer may block in waitPop() while the queue is empty; producers
+// then wake it up, which costs them one extra atomic load otherwise.
+template <class T>
+class MpscQueue {
+    DISALLOW_COPY_ASSIGN_AND_MOVE(MpscQueue);
+
+public:
+    MpscQueue() = default;
+
+    // Any thread.
+    void push(T* item) {
+        pushNode(item);
+        mSize.fetch_add(1, std::memory_order_release);
+        mConsumer.notify();
+    }
+
+    // Consumer only. Returns nullptr if the queue is empty. It may also return
+    // nullptr for a short while when a producer was preempted in the middle of
+    // push(); size() is non-zero in that case.
+    T* tryPop() {
+        MpscQueueNode* tail = mTail;
+        MpscQueueNode* next = tail->mpscNext.load(std::memory_order_acquire);
+        if (tail == &mStub) {
+            if (!next) return nullptr;
+            mTail = next;
+            tail = next;
+            next = next->mpscNext.load(std::memory_order_acquire);
+        }
+        if (!next) {
+            if (tail != mHead.load(std::memory_order_acquire)) {
+                // A producer has swapped the head but not linked it yet.
+                return nullptr;
+            }
+            // |tail| is the last node; put the stub back behind it so that it
+            // can be unlinked.
+            pushNode(&mStub);
+            next = tail->mpscNext.load(std::memory_order_acquire);
+            if (!next) return nullptr;
+        }
+        mTail = next;
+        mSize.fetch_sub(1, std::memory_order_relaxed);
+        return static_cast<T*>(tail);
+    }
+
+    // Consumer only. Like tryPop(), but sleeps until an item arrives or
+    // |timeoutUs| elapses. With a timeout this may return nullptr early on a
+    // spurious wakeup.
+    T* waitPop(uint64_t timeoutUs = kAddressWaitForever) {
+        for (;;) {
+            if (T* item = tryPop()) return item;
+            if (mSize.load(std::memory_order_acquire)) {
+                // A push is in flight; it will be linked momentarily.
+                std::this_thread::yield();
+                continue;
+            }
+            uint32_t token = mConsumer.prepareWait();
+            if (mSize.load(std::memory_order_relaxed)) {
+                mConsumer.cancelWait();
+                continue;
+            }
+            mConsumer.wait(token, timeoutUs);
+            if (timeoutUs != kAddressWaitForever) return tryPop();
+        }
+    }
+
+    // Any thread. Approximate when called outside of the consumer thread.
+    size_t size() const { return mSize.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+
+private:
+    void pushNode(MpscQueueNode* node) {
+        node->mpscNext.store(nullptr, std::memory_order_relaxed);
+        MpscQueueNode* prev = mHead.exchange(node, std::memory_order_acq_rel);
+        prev->mpscNext.store(node, std::memory_order_release);
+    }
+
+    MpscQueueNode mStub;
+    alignas(64) std::atomic<MpscQueueNode*> mHead{&mStub};
+    alignas(64) MpscQueueNode* mTail = &mStub;  // Consumer only.
+    std::atomic<size_t> mSize{0};
+    AddressWaiter mConsumer;
+};
+
+// Bounded multi-producer / single-consumer ring of |CAPACITY| values, after
+// Dmitry Vyukov's bounded MPMC queue with the consumer side simplified. Each
+// slot carries a sequence number that tells producers and the consumer whose
+// turn it is, so neither side ever takes a lock. Blocking is left to the
+// caller. |T| must be default-constructible.
+template <class T, size_t CAPACITY>
+class BoundedMpscQueue {
+    DISALLOW_COPY_ASSIGN_AND_MOVE(BoundedMpscQueue);
+    static_assert(CAPACITY > 0, "BoundedMpscQueue needs room for one item");
+
+public:
+    BoundedMpscQueue() {
+        for (size_t i = 0; i < CAPACITY; ++i) {
+            mCells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Any thread. Returns false if the queue is full.
+    template <class U>
+    bool tryPush(U&& value) {
+        size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = mCells[pos % CAPACITY];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1,
+                                                      std::memory_order_relaxed)) {
+                    cell.value = std::forward<U>(value);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer only. Returns false if the queue is empty, or if the next
+    // producer in line has not finished writing its value yet.
+    bool tryPop(T* value) {
+        size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+        Cell& cell = mCells[pos % CAPACITY];
+        size_t seq = cell.seq.load(std::memory_order_acquire);
+        if (seq != pos + 1) return false;
+        *value = std::move(cell.value);
+        cell.seq.store(pos + CAPACITY, std::memory_order_release);
+        mDequeuePos.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Any thread; approximate. Counts slots claimed by producers that have
+    // not yet been consumed.
+    size_t size() const {
+        size_t enqueued = mEnqueuePos.load(std::memory_order_acquire);
+        size_t dequeued = mDequeuePos.load(std::memory_order_acquire);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    Cell mCells[CAPACITY];
+    alignas(64) std::atomic<size_t> mEnqueuePos{0};
+    // Only written by the consumer.
+    alignas(64) std::atomic<size_t> mDequeuePos{0};
+};
+
+}  // namespace base
+}  // namespace android
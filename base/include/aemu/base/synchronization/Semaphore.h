@@ -0,0 +1,106 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/synchronization/AddressWait.h"
+#include "aemu/base/system/System.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace android {
+namespace base {
+
+// A counting semaphore on waitOnAddress(). Taking an available count and
+// signaling with nobody asleep are a single atomic operation each; the
+// kernel is only entered to sleep and to wake a sleeper. Up to |kMax|
+// counts are kept, further signals are dropped.
+template <uint32_t kMax = UINT32_MAX>
+class BasicSemaphore {
+public:
+    explicit BasicSemaphore(uint32_t count = 0) : mCount(count) {}
+
+    BasicSemaphore(const BasicSemaphore&) = delete;
+    BasicSemaphore& operator=(const BasicSemaphore&) = delete;
+
+    bool tryWait() {
+        uint32_t count = mCount.load(std::memory_order_relaxed);
+        while (count > 0) {
+            if (mCount.compare_exchange_weak(count, count - 1,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void wait() {
+        while (!tryWait()) {
+            sleep(kAddressWaitForever);
+        }
+    }
+
+    // Waits until the count can be taken or the wall clock reaches
+    // |wallTimeUs|, as returned by getUnixTimeUs().
+    bool timedWait(uint64_t wallTimeUs) {
+        while (!tryWait()) {
+            const uint64_t now = getUnixTimeUs();
+            if (now >= wallTimeUs) {
+                return false;
+            }
+            sleep(wallTimeUs - now);
+        }
+        return true;
+    }
+
+    void signal(uint32_t n = 1) {
+        uint32_t count = mCount.load(std::memory_order_relaxed);
+        uint32_t next;
+        do {
+            next = kMax - count < n ? kMax : count + n;
+            if (next == count) {
+                return;
+            }
+        } while (!mCount.compare_exchange_weak(count, next,
+                                               std::memory_order_seq_cst,
+                                               std::memory_order_relaxed));
+        // Pairs with the fetch_add() in sleep(): either the sleeper sees the
+        // new count before it blocks, or we see the sleeper here.
+        if (mSleepers.load(std::memory_order_seq_cst)) {
+            wakeAddress(&mCount, next - count > 1);
+        }
+    }
+
+    uint32_t count() const { return mCount.load(std::memory_order_relaxed); }
+
+private:
+    void sleep(uint64_t timeoutUs) {
+        mSleepers.fetch_add(1, std::memory_order_seq_cst);
+        if (mCount.load(std::memory_order_seq_cst) == 0) {
+            waitOnAddress(&mCount, 0, timeoutUs);
+        }
+        mSleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> mCount;
+    std::atomic<uint32_t> mSleepers{0};
+};
+
+using Semaphore = BasicSemaphore<>;
+
+}  // namespace base
+}  // namespace android
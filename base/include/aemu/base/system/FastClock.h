@@ -0,0 +1,48 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <inttypes.h>
+
+namespace android {
+namespace base {
+
+// A monotonic clock for timestamps taken on hot paths: trace events, latency
+// histograms, ring waits. It reads a CPU counter in user space instead of
+// asking the OS:
+//
+//   - mach_absolute_time() on macOS,
+//   - the TSC on x86, if the CPU says it is invariant,
+//   - CNTVCT_EL0 on ARM64.
+//
+// Counter ticks are converted with a rate calibrated against the monotonic
+// clock on first use. About once a second, whichever caller notices first
+// compares against the monotonic clock again, refines the rate and slews
+// out the error, so the clock never jumps. Without a usable counter it
+// reads the monotonic clock directly.
+//
+// Either way, it counts from the same origin as getHighResTimeUs(), and
+// stays within a few microseconds of it.
+class FastClock {
+public:
+    static uint64_t nowNs();
+    static uint64_t nowUs() { return nowNs() / 1000; }
+
+    // Whether nowNs() reads a CPU counter rather than calling the OS.
+    static bool isCounterBased();
+};
+
+}  // namespace base
+}  // namespace android
@@ -1,6 +1,11 @@
+#pragma once
+
 #include "aemu/base/CpuTime.h"
 
+#include <stdint.h>
+
 #include <string>
+#include <vector>
 
 namespace android {
 namespace base {
@@ -18,10 +23,39 @@ std::string getLauncherDirectory();
 
 bool getFileSize(int fd, uint64_t* size);
 
+// One entry returned by scanDirEntries().
+struct DirEntry {
+    enum class Type { Unknown, File, Directory, Symlink, Other };
+
+    std::string name;  // UTF-8, without the directory part
+    Type type = Type::Unknown;
+    uint64_t fileId = 0;  // inode number, or the NTFS file id on Windows
+    // Only filled in when scanDirEntries() is asked for metadata.
+    uint64_t size = 0;
+    uint64_t modifiedUs = 0;  // Unix time in microseconds
+};
+
+// Appends the entries of |dirPath| other than '.' and '..' to |entries|, in
+// the order the file system returns them. The directory is read in large
+// batches: getdents64() on Linux, GetFileInformationByHandleEx() on Windows.
+// With |withMetadata|, size and modification time are filled in as well;
+// Windows returns them with the listing, elsewhere this costs one fstatat()
+// per entry relative to the open directory. Returns false if the directory
+// can't be opened or read.
+bool scanDirEntries(const std::string& dirPath,
+                    std::vector<DirEntry>* entries,
+                    bool withMetadata = false);
+
 void sleepMs(uint64_t ms);
 void sleepUs(uint64_t us);
 // Sleep to the specified time in microseconds from getHighResTimeUs().
 void sleepToUs(uint64_t us);
+// Sleeps until |deadlineUs| from getHighResTimeUs(), for frame pacing and
+// the like: returns at most |toleranceUs| late, barring preemption. The OS
+// sleep aims early by how late this thread's sleeps have been waking, less
+// |toleranceUs|, and the rest is spun. Returns how late it was, which is
+// also recorded as LatencyMetric::kSleepLateness.
+uint64_t sleepUntilUs(uint64_t deadlineUs, uint64_t toleranceUs);
 
 CpuTime cpuTime();
 
@@ -35,8 +35,13 @@ namespace base {
 // This is very intentionally *not* a general purpose class. It should only
 // be used to simplify conversions between the Win32 Unicode API and the
 // rest of android::base which uses UTF-8 for all Unicode text.
+//
+// Strings of up to kInlineCapacity code units, which covers any path within
+// MAX_PATH, live inside the object and don't allocate.
 class Win32UnicodeString {
 public:
+    static constexpr size_t kInlineCapacity = 260;
+
     // Default constructor.
     Win32UnicodeString();
 
@@ -56,8 +61,9 @@ public:
     // Initialize from a zero-terminated wchar_t array.
     explicit Win32UnicodeString(const wchar_t* str);
 
-    // Copy-constructor.
+    // Copy and move constructors.
     Win32UnicodeString(const Win32UnicodeString& other);
+    Win32UnicodeString(Win32UnicodeString&& other);
 
     // Destructor.
     ~Win32UnicodeString();
@@ -67,7 +73,7 @@ public:
     Win32UnicodeString& operator=(const wchar_t* str);
 
     // Return pointer to first wchar_t in the string.
-    const wchar_t* c_str() const { return mStr ? mStr : L""; }
+    const wchar_t* c_str() const { return mStr; }
 
     // Return pointer to writable wchar_t array. This can never be NULL
     // but no more than size() items should be accessed.
@@ -98,7 +104,9 @@ public:
     void append(const wchar_t* other, size_t len);
     void append(const Win32UnicodeString& other);
 
-    // Release the Unicode string array to the caller.
+    // Release the Unicode string array to the caller, who must delete[] it.
+    // An inline string is copied to the heap first. Returns NULL for an
+    // empty string.
     wchar_t* release();
 
     // Directly convert a Unicode string to UTF-8 text and back.
@@ -145,8 +153,16 @@ public:
                                 const char* str, int len = -1);
 
 private:
+    bool isInline() const { return mStr == mInline; }
+
+    // Make room for |capacity| units plus a terminator. Keeps the current
+    // content only if |keep| is true.
+    void reserve(size_t capacity, bool keep);
+
     wchar_t* mStr;
     size_t mSize;
+    size_t mCapacity;
+    wchar_t mInline[kInlineCapacity + 1];
 };
 
 }  // namespace base
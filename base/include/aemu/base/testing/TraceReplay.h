@@ -0,0 +1,113 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/files/Stream.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace base {
+
+// Deterministic replay of recorded device traffic for benchmarking.
+//
+// A Trace is a list of timestamped events, each with a small integer kind
+// (e.g. "ASG ring write", "pipe wake", "fence signal") and an opaque payload.
+// TraceReplayer hands every event to the handler registered for its kind,
+// after moving a virtual clock to the event's time, and measures only the
+// handler call with readCycleCounter(). Nothing sleeps or waits on the wall
+// clock, so the per-kind costs it reports are stable enough to compare
+// across runs:
+//
+//      Trace trace;
+//      trace.load(&stream);
+//      TraceReplayer replayer;
+//      replayer.setClock([&](uint64_t ns) { looper.setVirtualMs(ns / 1000000); });
+//      replayer.setHandler(kRingWrite, "ring_write", [&](const TraceEvent& e) {
+//          ring_buffer_write(ring, e.payload.data(), e.payload.size(), 1);
+//      });
+//      for (const auto& stats : replayer.replay(trace, 5)) { ... }
+//
+struct TraceEvent {
+    uint64_t timeNs = 0;
+    uint32_t kind = 0;
+    std::vector<uint8_t> payload;
+};
+
+class Trace {
+public:
+    // Events must be added in time order.
+    void add(uint64_t timeNs, uint32_t kind, const void* data = nullptr,
+             size_t size = 0);
+
+    const std::vector<TraceEvent>& events() const { return mEvents; }
+    bool empty() const { return mEvents.empty(); }
+
+    void save(Stream* stream) const;
+    // Returns false, leaving the trace empty, if |stream| doesn't hold a
+    // trace saved by save().
+    bool load(Stream* stream);
+
+private:
+    std::vector<TraceEvent> mEvents;
+};
+
+class TraceReplayer {
+public:
+    using Handler = std::function<void(const TraceEvent&)>;
+    using Clock = std::function<void(uint64_t timeNs)>;
+
+    struct KindStats {
+        uint32_t kind = 0;
+        std::string name;
+        uint64_t count = 0;
+        // Cycles spent in the handler, less the cost of reading the counter.
+        uint64_t minCycles = 0;
+        uint64_t medianCycles = 0;
+        uint64_t p99Cycles = 0;
+        uint64_t totalCycles = 0;
+    };
+
+    // Events of kinds without a handler are skipped.
+    void setHandler(uint32_t kind, std::string name, Handler handler);
+    // Called untimed before each event with its time, which restarts from
+    // the first event's time on every pass.
+    void setClock(Clock clock);
+
+    // Replays |trace| |passes| times and returns the stats of every kind
+    // with a handler that saw events, ordered by kind. With several
+    // passes, each event's cost is the lowest it had in any pass.
+    std::vector<KindStats> replay(const Trace& trace, int passes = 1);
+
+    // One line per kind, for logs.
+    static std::string format(const std::vector<KindStats>& stats);
+
+private:
+    struct Entry {
+        std::string name;
+        Handler handler;
+    };
+
+    std::vector<Entry> mHandlers;
+    Clock mClock;
+};
+
+}  // namespace base
+}  // namespace android
@@ -22,9 +22,9 @@
 namespace android {
 namespace base {
 
-// Run a specified functor in a separate thread,
+// Run a specified functor on a BackgroundExecutor worker,
 // not waiting for any kind of result
-// returns true if thread starts successfully
+// returns true if the functor was queued successfully
 bool async(const ThreadFunctor& func,
            ThreadFlags flags = ThreadFlags::MaskSignals);
 
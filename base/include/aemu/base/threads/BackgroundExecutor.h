@@ -0,0 +1,58 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+
+#include <functional>
+#include <memory>
+
+namespace android {
+namespace base {
+
+template <class ItemT>
+class ThreadPool;
+
+// A process-wide pool of a few worker threads for short background jobs,
+// such as the ones run through async() and ParallelTask. Posting a job costs
+// a queue push instead of creating a thread; workers are started on first
+// use and live until the process exits.
+//
+// The pool is bounded, so jobs must not block waiting for other posted
+// jobs, and long-running work should keep using its own Thread.
+class BackgroundExecutor {
+public:
+    using Job = std::function<void()>;
+
+    static BackgroundExecutor& get();
+
+    // Runs |job| on one of the workers. Returns false if no worker could be
+    // started, in which case |job| is dropped.
+    bool post(Job&& job);
+
+    int numWorkers() const;
+
+private:
+    BackgroundExecutor();
+    ~BackgroundExecutor() = delete;
+
+    std::unique_ptr<ThreadPool<Job>> mPool;
+
+    DISALLOW_COPY_AND_ASSIGN(BackgroundExecutor);
+};
+
+}  // namespace base
+}  // namespace android
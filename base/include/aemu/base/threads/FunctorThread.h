@@ -39,6 +39,8 @@ public:
     explicit FunctorThread(Functor&& func,
                            ThreadFlags flags = ThreadFlags::MaskSignals);
 
+    FunctorThread(Functor&& func, ThreadOptions options);
+
     // A constructor from a void function in case when result isn't important.
     template <class Func, class = enable_if<is_callable_as<Func, void()>>>
     explicit FunctorThread(Func&& func,
@@ -48,6 +50,13 @@ public:
               return intptr_t();
           }) {}
 
+    template <class Func, class = enable_if<is_callable_as<Func, void()>>>
+    FunctorThread(Func&& func, ThreadOptions options)
+        : Thread(std::move(options)), mThreadFunc([func = std::move(func)]() {
+              func();
+              return intptr_t();
+          }) {}
+
 private:
     intptr_t main() override;
 
@@ -0,0 +1,141 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Data parallel loops on one process wide set of threads, one per core but
+// one, started on first use.
+//
+//   parallelFor(0, pageCount, 64, [&](size_t begin, size_t end) {
+//       for (size_t i = begin; i < end; ++i) {
+//           hashes[i] = hashPage(i);
+//       }
+//   });
+//
+// [begin, end) is cut into chunks of |grain| indices, and |fn| gets one
+// chunk at a time. Each thread starts on its own contiguous share of the
+// chunks and, once through it, steals half of what is left of someone
+// else's, so uneven chunks still even out. The calling thread takes part
+// and returns once every chunk is done.
+//
+// Calls made from inside a chunk, on any thread, run serially on that
+// thread: nesting never adds threads, so a decoder or the snapshot code can
+// use these without knowing whether their caller already does.
+//
+// Pick |grain| so a chunk is at least a few microseconds of work; 0 picks
+// a few chunks per thread. Ranges of a single chunk run inline.
+
+namespace android {
+namespace base {
+
+namespace internal {
+
+// Runs body(context, chunkBegin, chunkEnd, slot), where |slot| is below
+// parallelConcurrency() and no two threads run with the same slot at once.
+using ParallelBody = void (*)(void* context, size_t begin, size_t end, size_t slot);
+void parallelRun(size_t begin, size_t end, size_t grain, ParallelBody body, void* context);
+
+// Keeps per slot values on their own cache lines.
+template <class T>
+struct alignas(64) ParallelSlot {
+    T value;
+};
+
+}  // namespace internal
+
+// The most threads a parallel loop runs on, the calling one included.
+size_t parallelConcurrency();
+
+// True while running a chunk of a parallel loop, where further loops run
+// serially.
+bool inParallelRegion();
+
+template <class Fn>
+void parallelFor(size_t begin, size_t end, size_t grain, Fn&& fn) {
+    using Body = std::remove_reference_t<Fn>;
+    internal::parallelRun(
+            begin, end, grain,
+            [](void* context, size_t chunkBegin, size_t chunkEnd, size_t) {
+                (*static_cast<Body*>(context))(chunkBegin, chunkEnd);
+            },
+            const_cast<void*>(static_cast<const void*>(&fn)));
+}
+
+// Folds map(chunkBegin, chunkEnd) over the chunks with |combine|, starting
+// from |identity| on each thread. The chunks are combined in no particular
+// order, so |combine| must be associative and commutative.
+template <class T, class Map, class Combine>
+T parallelReduce(size_t begin,
+                 size_t end,
+                 size_t grain,
+                 T identity,
+                 Map&& map,
+                 Combine&& combine) {
+    struct Context {
+        std::vector<internal::ParallelSlot<T>> partials;
+        std::remove_reference_t<Map>* map;
+        std::remove_reference_t<Combine>* combine;
+    } context = {std::vector<internal::ParallelSlot<T>>(parallelConcurrency(),
+                                                        internal::ParallelSlot<T>{identity}),
+                 &map, &combine};
+    internal::parallelRun(
+            begin, end, grain,
+            [](void* opaque, size_t chunkBegin, size_t chunkEnd, size_t slot) {
+                auto* context = static_cast<Context*>(opaque);
+                T& partial = context->partials[slot].value;
+                partial = (*context->combine)(std::move(partial),
+                                              (*context->map)(chunkBegin, chunkEnd));
+            },
+            &context);
+    T result = std::move(context.partials[0].value);
+    for (size_t i = 1; i < context.partials.size(); ++i) {
+        result = combine(std::move(result), std::move(context.partials[i].value));
+    }
+    return result;
+}
+
+// Runs each of |fns| once, in parallel, and returns when all are done.
+template <class... Fns>
+void parallelInvoke(Fns&&... fns) {
+    struct Task {
+        void* fn;
+        void (*call)(void*);
+    };
+    const Task tasks[] = {{const_cast<void*>(static_cast<const void*>(&fns)), [](void* fn) {
+                               (*static_cast<std::remove_reference_t<Fns>*>(fn))();
+                           }}...};
+    parallelFor(0, sizeof...(fns), 1, [&tasks](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            tasks[i].call(tasks[i].fn);
+        }
+    });
+}
+
+// Like parallelInvoke(), for a list of functions only known at run time.
+template <class Fn>
+void parallelInvokeAll(std::vector<Fn>& fns) {
+    parallelFor(0, fns.size(), 1, [&fns](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            fns[i]();
+        }
+    });
+}
+
+}  // namespace base
+}  // namespace android
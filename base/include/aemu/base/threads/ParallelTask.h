@@ -26,9 +26,9 @@
 namespace android {
 namespace base {
 
-// A ParallelTask<Result> is an object that allows you to run a task in a
-// separate thread, and take follow up action back on the current thread's event
-// loop. Additionally, the |taskDoneFunction| function is called with a result
+// A ParallelTask<Result> is an object that allows you to run a task on a
+// BackgroundExecutor worker, and take follow up action back on the current
+// thread's event loop. Additionally, the |taskDoneFunction| function is called with a result
 // of type |Result| returned from the launched thread.
 //
 // An example of a thread returning the typical int exitStatus:
@@ -97,19 +97,21 @@ public:
     //             to perform the task.
     //     taskDoneFunction: The function you want to be called on the event
     //             loop in the current thread once the task is completed.
-    //     checkTimeoutMs: The time in milliseconds between consecutive checks
-    //             for thread termination. A bigger value possibly delayes the
-    //             call to |taskDoneFunction|, but leads to fewer checks.
-    //             Default: 1 second.
-    //     flags: See android::base::Thread.
+    //
+    // The task runs on the shared BackgroundExecutor, whose threads always
+    // mask signals, and its completion is posted to |looper| as soon as
+    // |taskFunction| returns. The trailing check timeout and thread flags of
+    // the old thread-per-task version are still accepted, and ignored.
     ParallelTask(android::base::Looper* looper,
                  TaskFunction taskFunction,
                  TaskDoneFunction taskDoneFunction,
-                 android::base::Looper::Duration checkTimeoutMs = 1 * 1000,
-                 ThreadFlags flags = ThreadFlags::MaskSignals)
-        : ParallelTaskBase(looper, checkTimeoutMs, flags),
+                 android::base::Looper::Duration /* checkTimeoutMs */ = 1 * 1000,
+                 ThreadFlags /* flags */ = ThreadFlags::MaskSignals)
+        : ParallelTaskBase(looper),
         mTaskFunction(taskFunction), mTaskDoneFunction(taskDoneFunction) {}
 
+    ~ParallelTask() { detachAndWait(); }
+
     // Start the thread instance. Returns true on success, false otherwise.
     // (e.g. if the thread was already started or terminated).
     bool start() { return ParallelTaskBase::start(); }
@@ -143,15 +145,13 @@ public:
 
     SelfDeletingParallelTask(android::base::Looper* looper,
                              TaskFunction taskFunction,
-                             TaskDoneFunction taskDoneFunction,
-                             android::base::Looper::Duration checkTimeoutMs)
+                             TaskDoneFunction taskDoneFunction)
         : mTaskDoneFunction(taskDoneFunction),
           mParallelTask(looper,
                         taskFunction,
                         std::bind(&SelfDeletingParallelTask::taskDoneFunction,
                                   this,
-                                  std::placeholders::_1),
-                        checkTimeoutMs) {}
+                                  std::placeholders::_1)) {}
 
     bool start() { return mParallelTask.start(); };
 
@@ -169,13 +169,14 @@ private:
 
 }  // namespace internal
 
+// The check timeout is ignored, as by ParallelTask.
 template<class ResultType>
 bool runParallelTask(android::base::Looper* looper,
                      std::function<void(ResultType*)> taskFunction,
                      std::function<void(const ResultType&)> taskDoneFunction,
-                     android::base::Looper::Duration checkTimeoutMs = 1 * 1000) {
+                     android::base::Looper::Duration /* checkTimeoutMs */ = 1 * 1000) {
     auto flyaway = new internal::SelfDeletingParallelTask<ResultType>(
-            looper, taskFunction, taskDoneFunction, checkTimeoutMs);
+            looper, taskFunction, taskDoneFunction);
     return flyaway->start();
 
 }
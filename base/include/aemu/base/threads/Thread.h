@@ -67,6 +67,11 @@ public:
     Thread(ThreadFlags flags = ThreadFlags::MaskSignals, int stackSize = 0,
            std::optional<std::string> name = std::nullopt);
 
+    // The thread applies |options.priority| and |options.cpus| to itself
+    // before main() runs, on a best effort basis. ThreadPriority::Normal
+    // keeps the priority inherited from the creating thread.
+    explicit Thread(ThreadOptions options);
+
     // Virtual destructor.
     virtual ~Thread();
 
@@ -99,6 +104,14 @@ public:
     // NB: noop for Win32
     static void maskAllSignals();
 
+    // Restricts the calling thread to |cpus|; an empty set leaves it as is.
+    // Returns false if the platform can't do it (macOS only has hints).
+    static bool setCurrentThreadAffinity(const CpuSet& cpus);
+
+    // Moves the calling thread to |priority|. Returns false if it did not
+    // get all of it, e.g. for lack of privileges.
+    static bool setCurrentThreadPriority(ThreadPriority priority);
+
     // Sleep for |n| milliseconds
     static void sleepMs(unsigned n);
 
@@ -127,6 +140,8 @@ private:
     intptr_t mExitStatus = 0;
     int mStackSize;
     const ThreadFlags mFlags;
+    const ThreadPriority mPriority = ThreadPriority::Normal;
+    const CpuSet mCpus;
     bool mStarted = false;
     // Access guarded by |mLock|.
     bool mFinished = false;
@@ -0,0 +1,42 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/threads/Types.h"
+
+#include <stddef.h>
+#include <vector>
+
+namespace android {
+namespace base {
+
+// The physical cores this process may run on, each as the set of its SMT
+// sibling logical CPUs. Cores of a package are adjacent. Read once, from
+// sysfs on Linux and GetLogicalProcessorInformationEx() on Windows (group
+// 0 only); empty where the topology is unknown, e.g. on macOS.
+const std::vector<CpuSet>& cpuCores();
+
+// Picks CPUs for a group of |threads| threads that hand work to each other,
+// like an ASG consumer and its decoder, so that they share caches: the
+// siblings of one core, plus neighbouring cores of the same package until
+// there is a CPU per thread. Successive groups go to the next cores, so
+// that groups spread over the machine. Returns an empty set, meaning run
+// anywhere, if the group would need every core or the topology is unknown.
+// Pass the result as ThreadOptions::cpus of each thread in the group.
+CpuSet placeThreadGroup(size_t threads);
+
+}  // namespace base
+}  // namespace android
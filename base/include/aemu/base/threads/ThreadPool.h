@@ -16,16 +16,22 @@
 
 #include <atomic>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <random>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "aemu/base/Compiler.h"
 #include "aemu/base/Optional.h"
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
 #include "aemu/base/system/System.h"
+#include "aemu/base/threads/FunctorThread.h"
 #include "aemu/base/threads/WorkerThread.h"
+#include "aemu/base/threads/internal/WorkStealingDeque.h"
 
 //
 // ThreadPool<Item> - a simple collection of worker threads to process enqueued
@@ -33,9 +39,16 @@
 //
 // To create a thread pool supply a processing function and an optional number
 // of threads to use (default is number of CPU cores).
-// Thread pool distributes the work in simple round robin manner over all its
-// workers - this means individual items should be simple and take similar time
-// to process.
+// By default thread pool distributes the work in simple round robin manner over
+// all its workers - this means individual items should be simple and take
+// similar time to process.
+//
+// If item costs vary a lot, pass ThreadPoolScheduling::WorkStealing instead:
+// every worker then keeps its own deque, and idle workers steal queued items
+// from random other workers. Items enqueued from a worker thread go to that
+// worker's own deque, and enqueue(item, workerId) hints which worker should
+// preferably run an item. In this mode the WorkerId passed to the processor is
+// the worker actually running the item.
 //
 // Usage is very similar to one of WorkerThread, with difference being in the
 // number of worker threads used and in existence of explicit done() method:
@@ -62,6 +75,8 @@ namespace base {
 
 using ThreadPoolWorkerId = uint32_t;
 
+enum class ThreadPoolScheduling { RoundRobin, WorkStealing };
+
 template <class ItemT>
 class ThreadPool {
     DISALLOW_COPY_AND_ASSIGN(ThreadPool);
@@ -87,7 +102,9 @@ public:
     // WorkerId, or have only 1 Item parameter.
     template <class Fn, typename = std::enable_if_t<std::is_invocable_v<Fn, Item, WorkerId> ||
                                                     std::is_invocable_v<Fn, Item>>>
-    ThreadPool(int threads, Fn&& processor) : mProcessor() {
+    ThreadPool(int threads, Fn&& processor,
+               ThreadPoolScheduling scheduling = ThreadPoolScheduling::RoundRobin)
+        : mProcessor(), mScheduling(scheduling) {
         if constexpr (std::is_invocable_v<Fn, Item, WorkerId>) {
             mProcessor = std::move(processor);
         } else if constexpr (std::is_invocable_v<Fn, Item>) {
@@ -97,6 +114,13 @@ public:
         if (threads < 1) {
             threads = android::base::getCpuCoreCount();
         }
+        if (mScheduling == ThreadPoolScheduling::WorkStealing) {
+            for (int i = 0; i < threads; ++i) {
+                mStealingWorkers.push_back(std::make_unique<StealingWorker>(
+                    this, static_cast<WorkerId>(i)));
+            }
+            return;
+        }
         mWorkers = std::vector<Optional<Worker>>(threads);
         for (auto& workerPtr : mWorkers) {
             workerPtr.emplace([this](Optional<Command>&& commandOpt) {
@@ -117,6 +141,15 @@ public:
     }
 
     bool start() {
+        if (mScheduling == ThreadPoolScheduling::WorkStealing) {
+            for (auto& worker : mStealingWorkers) {
+                worker->mValid = worker->mThread.start();
+                if (worker->mValid) {
+                    ++mValidWorkersCount;
+                }
+            }
+            return mValidWorkersCount > 0;
+        }
         for (auto& workerPtr : mWorkers) {
             if (workerPtr->start()) {
                 ++mValidWorkersCount;
@@ -128,6 +161,12 @@ public:
     }
 
     void done() {
+        if (mScheduling == ThreadPoolScheduling::WorkStealing) {
+            AutoLock lock(mSleepLock);
+            mStopping = true;
+            mWorkCv.broadcastAndUnlock(&lock);
+            return;
+        }
         for (auto& workerPtr : mWorkers) {
             if (workerPtr) {
                 workerPtr->enqueue(kNullopt);
@@ -136,6 +175,16 @@ public:
     }
 
     void join() {
+        if (mScheduling == ThreadPoolScheduling::WorkStealing) {
+            for (auto& worker : mStealingWorkers) {
+                if (worker->mValid) {
+                    worker->mThread.wait();
+                }
+            }
+            mStealingWorkers.clear();
+            mValidWorkersCount = 0;
+            return;
+        }
         for (auto& workerPtr : mWorkers) {
             if (workerPtr) {
                 workerPtr->join();
@@ -146,6 +195,10 @@ public:
     }
 
     void enqueue(Item&& item) {
+        if (mScheduling == ThreadPoolScheduling::WorkStealing) {
+            enqueueStealing(std::move(item), nullptr);
+            return;
+        }
         for (;;) {
             int currentIndex =
                     mNextWorkerIndex.fetch_add(1, std::memory_order_relaxed);
@@ -159,9 +212,46 @@ public:
         }
     }
 
+    // Like enqueue(), but preferably runs |item| on |preferredWorker|, e.g.
+    // because its caches are warm for it. With work stealing, another worker
+    // may still pick the item up if |preferredWorker| is busy.
+    void enqueue(Item&& item, WorkerId preferredWorker) {
+        if (mScheduling == ThreadPoolScheduling::WorkStealing) {
+            StealingWorker* target = nullptr;
+            if (preferredWorker < mStealingWorkers.size() &&
+                mStealingWorkers[preferredWorker]->mValid) {
+                target = mStealingWorkers[preferredWorker].get();
+            }
+            enqueueStealing(std::move(item), target);
+            return;
+        }
+        if (preferredWorker < mWorkers.size() && mWorkers[preferredWorker]) {
+            Command command(std::forward<Item>(item), preferredWorker);
+            mWorkers[preferredWorker]->enqueue(std::move(command));
+            return;
+        }
+        enqueue(std::move(item));
+    }
+
     // The itemFactory will be called multiple times to generate one item for each worker thread.
     template <class Fn, typename = std::enable_if_t<std::is_invocable_r_v<Item, Fn>>>
     void broadcast(Fn&& itemFactory) {
+        if (mScheduling == ThreadPoolScheduling::WorkStealing) {
+            for (auto& worker : mStealingWorkers) {
+                if (!worker->mValid) continue;
+                mPending.fetch_add(1, std::memory_order_seq_cst);
+                {
+                    AutoLock lock(worker->mInboxLock);
+                    worker->mPinned.push_back(new Command(itemFactory(), worker->mId));
+                    worker->mPinnedCount.fetch_add(1, std::memory_order_seq_cst);
+                }
+            }
+            // Pinned items can only be run by their worker, so make sure it
+            // is awake.
+            AutoLock lock(mSleepLock);
+            mWorkCv.broadcastAndUnlock(&lock);
+            return;
+        }
         int i = 0;
         for (auto& workerOpt : mWorkers) {
             if (!workerOpt) continue;
@@ -173,6 +263,13 @@ public:
 
     void waitAllItems() {
         if (0 == mValidWorkersCount) return;
+        if (mScheduling == ThreadPoolScheduling::WorkStealing) {
+            AutoLock lock(mSleepLock);
+            mIdleCv.wait(&lock, [this] {
+                return mPending.load(std::memory_order_seq_cst) == 0;
+            });
+            return;
+        }
         for (auto& workerOpt : mWorkers) {
             if (!workerOpt) continue;
             workerOpt->waitQueuedItems();
@@ -182,10 +279,166 @@ public:
     int numWorkers() const { return mValidWorkersCount; }
 
 private:
+    struct StealingWorker {
+        StealingWorker(ThreadPool* pool, WorkerId id)
+            : mId(id), mRandom(id + 1), mThread([pool, this] { pool->stealingWorkerLoop(this); }) {}
+
+        ~StealingWorker() {
+            // Only items that were never run can be left here, e.g. when the
+            // thread failed to start.
+            while (Command* command = mDeque.pop()) delete command;
+            for (Command* command : mInbox) delete command;
+            for (Command* command : mPinned) delete command;
+        }
+
+        const WorkerId mId;
+        bool mValid = false;
+        // Pushed and popped by this worker only, stolen by all others.
+        internal::WorkStealingDeque<Command> mDeque;
+        // Items enqueued from other threads. Moved into |mDeque| by this
+        // worker, and may be stolen directly by others.
+        Lock mInboxLock;
+        std::deque<Command*> mInbox;
+        // broadcast() items; never stolen.
+        std::vector<Command*> mPinned;
+        std::atomic<int> mPinnedCount{0};
+        std::minstd_rand mRandom;
+        FunctorThread mThread;
+    };
+
+    // Identifies the pool and worker the current thread belongs to, if any.
+    struct CurrentWorker {
+        const ThreadPool* pool = nullptr;
+        StealingWorker* worker = nullptr;
+    };
+    static CurrentWorker& currentWorker() {
+        static thread_local CurrentWorker current;
+        return current;
+    }
+
+    void enqueueStealing(Item&& item, StealingWorker* target) {
+        if (!mValidWorkersCount) return;
+
+        Command* command = new Command(std::move(item), 0);
+        mPending.fetch_add(1, std::memory_order_seq_cst);
+
+        CurrentWorker& current = currentWorker();
+        if (!target && current.pool == this) {
+            current.worker->mDeque.push(command);
+        } else {
+            while (!target || !target->mValid) {
+                int index = mNextWorkerIndex.fetch_add(1, std::memory_order_relaxed);
+                target = mStealingWorkers[index % mStealingWorkers.size()].get();
+            }
+            AutoLock lock(target->mInboxLock);
+            target->mInbox.push_back(command);
+        }
+
+        // Sleeping workers register in |mSleepers| before re-checking
+        // |mQueued|, so either they see this item or we see them.
+        mQueued.fetch_add(1, std::memory_order_seq_cst);
+        if (mSleepers.load(std::memory_order_seq_cst)) {
+            AutoLock lock(mSleepLock);
+            mWorkCv.signalAndUnlock(&lock);
+        }
+    }
+
+    Command* takePinned(StealingWorker* self) {
+        if (!self->mPinnedCount.load(std::memory_order_seq_cst)) return nullptr;
+        AutoLock lock(self->mInboxLock);
+        if (self->mPinned.empty()) return nullptr;
+        Command* command = self->mPinned.front();
+        self->mPinned.erase(self->mPinned.begin());
+        self->mPinnedCount.fetch_sub(1, std::memory_order_seq_cst);
+        return command;
+    }
+
+    Command* takeFromInbox(StealingWorker* victim, bool own) {
+        AutoLock lock(victim->mInboxLock);
+        if (victim->mInbox.empty()) return nullptr;
+        Command* command = victim->mInbox.front();
+        victim->mInbox.pop_front();
+        if (own) {
+            // Move the rest over so that other workers can steal it lock-free.
+            while (!victim->mInbox.empty()) {
+                victim->mDeque.push(victim->mInbox.front());
+                victim->mInbox.pop_front();
+            }
+        }
+        return command;
+    }
+
+    // Sets |*pinned| if the item came from broadcast() and thus wasn't
+    // counted in |mQueued|.
+    Command* findWork(StealingWorker* self, bool* pinned) {
+        *pinned = true;
+        if (Command* command = takePinned(self)) return command;
+        *pinned = false;
+        if (Command* command = self->mDeque.pop()) return command;
+        if (Command* command = takeFromInbox(self, true)) return command;
+
+        const size_t count = mStealingWorkers.size();
+        const size_t start = self->mRandom() % count;
+        for (size_t i = 0; i < count; ++i) {
+            StealingWorker* victim = mStealingWorkers[(start + i) % count].get();
+            if (victim == self || !victim->mValid) continue;
+            if (Command* command = victim->mDeque.steal()) return command;
+            if (Command* command = takeFromInbox(victim, false)) return command;
+        }
+        return nullptr;
+    }
+
+    void stealingWorkerLoop(StealingWorker* self) {
+        currentWorker() = {this, self};
+
+        for (;;) {
+            bool pinned = false;
+            Command* command = findWork(self, &pinned);
+            if (command) {
+                if (!pinned) {
+                    mQueued.fetch_sub(1, std::memory_order_seq_cst);
+                }
+                mProcessor(std::move(command->mItem), self->mId);
+                delete command;
+                if (mPending.fetch_sub(1, std::memory_order_seq_cst) == 1) {
+                    AutoLock lock(mSleepLock);
+                    mIdleCv.broadcastAndUnlock(&lock);
+                }
+                continue;
+            }
+
+            AutoLock lock(mSleepLock);
+            mSleepers.fetch_add(1, std::memory_order_seq_cst);
+            while (!mQueued.load(std::memory_order_seq_cst) &&
+                   !self->mPinnedCount.load(std::memory_order_seq_cst)) {
+                if (mStopping) {
+                    mSleepers.fetch_sub(1, std::memory_order_seq_cst);
+                    currentWorker() = {};
+                    return;
+                }
+                mWorkCv.wait(&lock);
+            }
+            mSleepers.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    }
+
     Processor mProcessor;
+    const ThreadPoolScheduling mScheduling;
     std::vector<Optional<Worker>> mWorkers;
     std::atomic<int> mNextWorkerIndex{0};
     int mValidWorkersCount{0};
+
+    // Work stealing state.
+    std::vector<std::unique_ptr<StealingWorker>> mStealingWorkers;
+    // Items enqueued but not finished, for waitAllItems().
+    std::atomic<int64_t> mPending{0};
+    // Stealable items enqueued but not yet picked up by a worker.
+    std::atomic<int64_t> mQueued{0};
+    std::atomic<int> mSleepers{0};
+    Lock mSleepLock;
+    ConditionVariable mWorkCv;
+    ConditionVariable mIdleCv;
+    bool mStopping = false;
 };
 
 }  // namespace base
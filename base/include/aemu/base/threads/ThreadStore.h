@@ -29,14 +29,9 @@ namespace base {
 // A class to model storage of thread-specific values, that can be
 // destroyed on thread exit.
 //
-// Note that on Windows, a thread must call OnThreadExit() explicitly
-// here to ensure that the values are probably discarded. This is an
-// unfortunate requirement of the Win32 API, which doesn't support
-// destructors at all.
-//
-// There are various hacks on the web to try to achieve this automatically
-// (e.g. [1]) but they rely on using the Microsoft build tools,
-// which doesn't work for us.
+// On Windows the store is built on fiber local storage, whose callback
+// destroys the values on thread exit like a pthread key does, so
+// OnThreadExit() has nothing left to do.
 //
 // Note another important issue with ThreadStore instances: if you create
 // one instance in a shared library, you need to make sure that it is
@@ -49,8 +44,6 @@ namespace base {
 // which is impossible to achieve in the most general case. Thus, consider
 // that thread-local values are always leaked on library unload, or on
 // program exit.
-//
-// [1] http://stackoverflow.com/questions/14538159/about-tls-callback-in-windows
 
 // ThreadStoreBase is the base class used by all ThreadStore template
 // instances, used to reduce bloat.
@@ -93,8 +86,7 @@ public:
     }
 
 #ifdef _WIN32
-    // Each thread should call this function on exit to ensure that
-    // all corresponding TLS values are properly freed.
+    // Kept for callers written when Windows values needed it; a no-op.
     static void OnThreadExit();
 #else
     // Nothing to do on Posix.
@@ -150,5 +142,52 @@ private:
     }
 };
 
+// ThreadLocalStore is the same for stores that exist for the whole life of
+// the process, such as globals and function statics, kept in compiler-native
+// thread_local storage: get() is a plain load rather than a library call.
+// The storage belongs to the type, so every store needs its own |Tag|, and
+// stores created at runtime should use ThreadStore instead.
+//
+// The value is deleted when its thread exits, on every platform, including
+// threads not started through android::base::Thread. A thread_local object
+// registers the destructor on the first set(), so get() stays trivial.
+template <typename T, typename Tag = T>
+class ThreadLocalStore {
+public:
+    ThreadLocalStore() = default;
+
+    // The current thread's object, or NULL if set() was never called in it.
+    T* get() const { return tValue; }
+
+    // Sets the object for this thread, deleting any previous one.
+    void set(T* t) { delete swap(t); }
+
+    // Sets the object for this thread and returns the previous one,
+    // transferring its ownership to the caller.
+    T* swap(T* t) {
+        if (t) {
+            tReaper.touch();
+        }
+        T* old = tValue;
+        tValue = t;
+        return old;
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(ThreadLocalStore);
+
+    struct Reaper {
+        // Makes sure the object is constructed, and so destroyed.
+        void touch() {}
+        ~Reaper() {
+            delete tValue;
+            tValue = nullptr;
+        }
+    };
+
+    static inline thread_local T* tValue = nullptr;
+    static inline thread_local Reaper tReaper;
+};
+
 }  // namespace base
 }  // namespace android
@@ -17,7 +17,10 @@
 #include "aemu/base/EnumFlags.h"
 
 #include <functional>
+#include <optional>
 #include <stdint.h>
+#include <string>
+#include <vector>
 
 namespace android {
 namespace base {
@@ -35,5 +38,29 @@ enum class ThreadFlags : unsigned char {
     Detach = 1 << 1
 };
 
+// Scheduling class of a thread. Mapped to nice values and SCHED_FIFO on
+// Linux, QoS classes on macOS and THREAD_PRIORITY_* on Windows. Anything
+// above Normal usually needs privileges the emulator lacks; the thread then
+// keeps running at the priority it could get.
+enum class ThreadPriority {
+    Background,  // e.g. snapshot compression
+    Normal,
+    High,        // latency sensitive, e.g. ASG consumers and decoders
+    Realtime,
+};
+
+// Logical CPU indexes a thread may run on; empty for any.
+using CpuSet = std::vector<int>;
+
+struct ThreadOptions {
+    ThreadFlags flags = ThreadFlags::MaskSignals;
+    // 0 for the platform default.
+    int stackSize = 0;
+    std::optional<std::string> name;
+    ThreadPriority priority = ThreadPriority::Normal;
+    // See placeThreadGroup() for picking CPUs that share a core.
+    CpuSet cpus;
+};
+
 }  // namespace base
 }  // namespace android
@@ -14,14 +14,21 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <functional>
 #include <future>
+#include <memory>
 #include <optional>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "aemu/base/Compiler.h"
 #include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/MpscQueue.h"
 #include "aemu/base/threads/FunctorThread.h"
 #include "aemu/base/synchronization/Lock.h"
 
@@ -56,6 +63,17 @@
 // Note: destructor calls join() implicitly - it's better to send some
 // end-of-work marker before trying to destroy a worker thread.
 //
+// The queue is guarded by a lock by default. Pass LockFreeQueue as the second
+// template argument to use an MpscQueue instead when many threads enqueue at
+// once:
+//      WorkerThread<WorkItem, LockFreeQueue> worker(...);
+//
+// Pass PrioritizedQueue to have latency sensitive items overtake bulk work
+// queued on the same worker:
+//      WorkerThread<WorkItem, PrioritizedQueue> worker(...);
+//      worker.enqueue({1}, WorkPriority::kBulk);
+//      worker.enqueue({2}, WorkPriority::kHigh, steady_clock::now() + 2ms);
+//
 
 namespace android {
 namespace base {
@@ -63,7 +81,221 @@ namespace base {
 // Return values for a worker thread's processing function.
 enum class WorkerProcessingResult { Continue, Stop };
 
-template <class Item>
+// Queue policy for WorkerThread, next to LockingQueue and LockFreeQueue.
+// Items wait in one FIFO lane per WorkPriority and the worker takes the
+// front of the highest non-empty lane, with two exceptions: an item past its
+// deadline goes first, and a lane passed over kMaxWorkLaneSkips times in a
+// row is served next, so bulk work still makes progress under a steady
+// stream of urgent items. waitQueuedItems() still waits for everything
+// queued before it.
+struct PrioritizedQueue {};
+
+enum class WorkPriority { kHigh, kNormal, kBulk };
+constexpr size_t kWorkPriorities = 3;
+constexpr uint32_t kMaxWorkLaneSkips = 8;
+
+namespace internal {
+
+// The queue of a WorkerThread, selected by its QueuePolicy. push() hands over
+// |command| and returns true, or leaves it alone and returns false after
+// close(). popAll() blocks until there is at least one command and moves all
+// of them to |out|. close() returns whatever was still queued.
+//
+// These are implementation details of WorkerThread. DO NOT use them directly.
+template <class Command, class QueuePolicy>
+class WorkerQueue;
+
+template <class Command>
+class WorkerQueue<Command, LockingQueue> {
+public:
+    WorkerQueue() { mQueue.reserve(10); }
+
+    bool push(Command& command) {
+        base::AutoLock lock(mLock);
+        if (mClosed) {
+            return false;
+        }
+        mQueue.emplace_back(std::move(command));
+        mCv.signalAndUnlock(&lock);
+        return true;
+    }
+
+    void popAll(std::vector<Command>* out) {
+        base::AutoLock lock(mLock);
+        while (mQueue.empty()) {
+            mCv.wait(&lock);
+        }
+        out->swap(mQueue);
+    }
+
+    std::vector<Command> close() {
+        base::AutoLock lock(mLock);
+        mClosed = true;
+        return std::move(mQueue);
+    }
+
+private:
+    std::vector<Command> mQueue;
+    base::Lock mLock;
+    base::ConditionVariable mCv;
+    // Must be accessed after grabbing the lock.
+    bool mClosed = false;
+};
+
+template <class Command>
+class WorkerQueue<Command, LockFreeQueue> {
+public:
+    ~WorkerQueue() {
+        while (Node* node = mQueue.tryPop()) {
+            delete node;
+        }
+    }
+
+    bool push(Command& command) {
+        // close() waits for producers that got past the mClosed check, so
+        // nothing can be pushed after it has drained the queue.
+        mProducers.fetch_add(1, std::memory_order_seq_cst);
+        if (mClosed.load(std::memory_order_seq_cst)) {
+            mProducers.fetch_sub(1, std::memory_order_release);
+            return false;
+        }
+        mQueue.push(new Node(std::move(command)));
+        mProducers.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    void popAll(std::vector<Command>* out) {
+        Node* node = mQueue.waitPop();
+        while (node) {
+            out->emplace_back(std::move(node->command));
+            delete node;
+            node = mQueue.tryPop();
+        }
+    }
+
+    std::vector<Command> close() {
+        mClosed.store(true, std::memory_order_seq_cst);
+        while (mProducers.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        std::vector<Command> res;
+        while (!mQueue.empty()) {
+            if (Node* node = mQueue.tryPop()) {
+                res.emplace_back(std::move(node->command));
+                delete node;
+            }
+        }
+        return res;
+    }
+
+private:
+    struct Node : MpscQueueNode {
+        explicit Node(Command&& command) : command(std::move(command)) {}
+        Command command;
+    };
+
+    MpscQueue<Node> mQueue;
+    std::atomic<bool> mClosed{false};
+    std::atomic<int> mProducers{0};
+};
+
+// Hands out one command per popAll(), so that an urgent item queued while
+// the worker is busy is picked up right after the current one.
+template <class Command>
+class WorkerQueue<Command, PrioritizedQueue> {
+public:
+    bool push(Command& command) {
+        base::AutoLock lock(mLock);
+        if (mClosed) {
+            return false;
+        }
+        command.mSequence = mNextSequence++;
+        mLanes[static_cast<size_t>(command.mPriority)].emplace_back(std::move(command));
+        mCv.signalAndUnlock(&lock);
+        return true;
+    }
+
+    void popAll(std::vector<Command>* out) {
+        base::AutoLock lock(mLock);
+        size_t lane;
+        while ((lane = nextLaneLocked()) == kWorkPriorities) {
+            mCv.wait(&lock);
+        }
+        out->emplace_back(std::move(mLanes[lane].front()));
+        mLanes[lane].pop_front();
+    }
+
+    std::vector<Command> close() {
+        base::AutoLock lock(mLock);
+        mClosed = true;
+        std::vector<Command> res;
+        for (auto& lane : mLanes) {
+            for (Command& command : lane) {
+                res.emplace_back(std::move(command));
+            }
+            lane.clear();
+        }
+        return res;
+    }
+
+private:
+    // Returns kWorkPriorities if all lanes are empty.
+    size_t nextLaneLocked() {
+        size_t chosen = kWorkPriorities;
+        const auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < kWorkPriorities; ++i) {
+            if (!mLanes[i].empty() && mLanes[i].front().mDeadline <= now) {
+                chosen = i;
+                break;
+            }
+        }
+        if (chosen == kWorkPriorities) {
+            for (size_t i = 0; i < kWorkPriorities; ++i) {
+                if (mLanes[i].empty()) {
+                    continue;
+                }
+                if (chosen == kWorkPriorities) {
+                    chosen = i;
+                } else if (mSkips[i] >= kMaxWorkLaneSkips) {
+                    chosen = i;
+                    break;
+                }
+            }
+            if (chosen == kWorkPriorities) {
+                return chosen;
+            }
+        }
+        // A waitQueuedItems() marker must not overtake what was queued before it.
+        if (!mLanes[chosen].front().mWorkItem) {
+            for (size_t i = 0; i < kWorkPriorities; ++i) {
+                if (!mLanes[i].empty() &&
+                    mLanes[i].front().mSequence < mLanes[chosen].front().mSequence) {
+                    chosen = i;
+                }
+            }
+        }
+        for (size_t i = 0; i < kWorkPriorities; ++i) {
+            if (i == chosen) {
+                mSkips[i] = 0;
+            } else if (!mLanes[i].empty() && i > chosen) {
+                ++mSkips[i];
+            }
+        }
+        return chosen;
+    }
+
+    std::array<std::deque<Command>, kWorkPriorities> mLanes;
+    std::array<uint32_t, kWorkPriorities> mSkips = {};
+    uint64_t mNextSequence = 0;
+    base::Lock mLock;
+    base::ConditionVariable mCv;
+    // Must be accessed after grabbing the lock.
+    bool mClosed = false;
+};
+
+}  // namespace internal
+
+template <class Item, class QueuePolicy = LockingQueue>
 class WorkerThread {
     DISALLOW_COPY_AND_ASSIGN(WorkerThread);
 
@@ -73,9 +305,7 @@ public:
     using Processor = std::function<Result(Item&&)>;
 
     WorkerThread(Processor&& processor)
-        : mProcessor(std::move(processor)), mThread([this]() { worker(); }) {
-        mQueue.reserve(10);
-    }
+        : mProcessor(std::move(processor)), mThread([this]() { worker(); }) {}
     ~WorkerThread() { join(); }
 
     // Starts the worker thread.
@@ -85,7 +315,6 @@ public:
             return true;
         }
         if (!mThread.start()) {
-            AutoLock lock(mLock);
             setFinishedAndDrainTasks();
             return false;
         }
@@ -107,29 +336,52 @@ public:
         return enqueueImpl(Command(std::move(item)));
     }
 
+    // Same as above, with a |priority| that PrioritizedQueue orders items by;
+    // the other policies keep FIFO order. An item that starts processing after
+    // its |deadline| counts towards lateItems(), and PrioritizedQueue moves it
+    // ahead of everything else once the deadline has passed.
+    std::future<void> enqueue(
+            Item&& item,
+            WorkPriority priority,
+            std::optional<std::chrono::steady_clock::time_point> deadline = std::nullopt) {
+        Command command(std::move(item));
+        command.mPriority = priority;
+        if (deadline) {
+            command.mDeadline = *deadline;
+        }
+        return enqueueImpl(std::move(command));
+    }
+
+    // How many items started processing after their deadline.
+    uint64_t lateItems() const { return mLateItems.load(std::memory_order_relaxed); }
+
    private:
     struct Command {
-        Command() : mWorkItem(std::nullopt) {}
+        // The sync command of waitQueuedItems() goes in the last lane.
+        Command() : mWorkItem(std::nullopt), mPriority(WorkPriority::kBulk) {}
         Command(Item&& it) : mWorkItem(std::move(it)) {}
         Command(Command&& other)
             : mCompletedPromise(std::move(other.mCompletedPromise)),
-              mWorkItem(std::move(other.mWorkItem)) {}
+              mWorkItem(std::move(other.mWorkItem)),
+              mPriority(other.mPriority),
+              mDeadline(other.mDeadline),
+              mSequence(other.mSequence) {}
 
         std::promise<void> mCompletedPromise;
         std::optional<Item> mWorkItem;
+        WorkPriority mPriority = WorkPriority::kNormal;
+        std::chrono::steady_clock::time_point mDeadline =
+                std::chrono::steady_clock::time_point::max();
+        // Set by PrioritizedQueue.
+        uint64_t mSequence = 0;
     };
 
     std::future<void> enqueueImpl(Command command) {
-        base::AutoLock lock(mLock);
-        // We don't enqueue any new items if mFinished is set to true.
-        if (!mStarted || mFinished) {
+        std::future<void> res = command.mCompletedPromise.get_future();
+        // We don't enqueue any new items once the queue is closed.
+        if (!mStarted || !mQueue.push(command)) {
             command.mCompletedPromise.set_value();
-            return command.mCompletedPromise.get_future();
         }
-
-        std::future<void> res = command.mCompletedPromise.get_future();
-        mQueue.emplace_back(std::move(command));
-        mCv.signalAndUnlock(&lock);
         return res;
     }
 
@@ -137,18 +389,16 @@ public:
         std::vector<Command> todo;
         todo.reserve(10);
         for (;;) {
-            {
-                base::AutoLock lock(mLock);
-                while (mQueue.empty()) {
-                    mCv.wait(&lock);
-                }
-                todo.swap(mQueue);
-            }
+            mQueue.popAll(&todo);
 
             bool shouldStop = false;
             for (Command& item : todo) {
                 if (!shouldStop && item.mWorkItem) {
                     // Normal work item
+                    if (item.mDeadline != std::chrono::steady_clock::time_point::max() &&
+                        std::chrono::steady_clock::now() > item.mDeadline) {
+                        mLateItems.fetch_add(1, std::memory_order_relaxed);
+                    }
                     shouldStop = mProcessor(std::move(item.mWorkItem.value())) == Result::Stop;
                 }
                 item.mCompletedPromise.set_value();
@@ -163,25 +413,19 @@ public:
     }
 
     void setFinishedAndDrainTasks() {
-        base::AutoLock lock(mLock);
-        // Set mFinished so that no new tasks will be enqueued.
-        mFinished = true;
-        // Signal pending tasks as if they are completed.
-        for (Command& item : mQueue) {
+        // Close the queue so that no new tasks will be enqueued, and signal
+        // pending tasks as if they are completed.
+        for (Command& item : mQueue.close()) {
             item.mCompletedPromise.set_value();
         }
-        return;
     }
 
     Processor mProcessor;
     base::FunctorThread mThread;
-    std::vector<Command> mQueue;
-    base::Lock mLock;
-    base::ConditionVariable mCv;
+    internal::WorkerQueue<Command, QueuePolicy> mQueue;
 
     std::atomic_bool mStarted = false;
-    // Must be accessd after grabbing the lock.
-    bool mFinished = false;
+    std::atomic<uint64_t> mLateItems{0};
 };
 
 }  // namespace base
@@ -16,8 +16,6 @@
 
 #include "aemu/base/Compiler.h"
 #include "aemu/base/async/Looper.h"
-#include "aemu/base/threads/Thread.h"
-#include "aemu/base/threads/Types.h"
 
 #include <memory>
 
@@ -31,49 +29,38 @@ namespace internal {
 // This is an implementation detail. DO NOT use this class directly.
 class ParallelTaskBase {
 public:
-    virtual ~ParallelTaskBase() = default;
+    virtual ~ParallelTaskBase();
 
 protected:
-    ParallelTaskBase(android::base::Looper* looper,
-                     android::base::Looper::Duration checkTimeoutMs,
-                     ThreadFlags flags);
+    explicit ParallelTaskBase(android::base::Looper* looper);
 
     // API functions.
     bool start();
     bool inFlight() const;
 
+    // Drops a completion that hasn't run yet and waits for taskImpl() to
+    // return. Derived classes call this from their destructor, before the
+    // state taskImpl() uses goes away.
+    void detachAndWait();
+
     // |ParallelTask<T>| implements these hooks.
     virtual void taskImpl() = 0;
     virtual void taskDoneImpl() = 0;
 
 private:
-    class ManagedThread : public ::android::base::Thread {
-    public:
-        ManagedThread(ParallelTaskBase* manager, ThreadFlags flags)
-            : Thread(flags), mManager(manager) {}
-
-        intptr_t main() {
-            mManager->taskImpl();
-            // This return value is ignored.
-            return 0;
-        }
-
-    private:
-        ParallelTaskBase* mManager;
-    };
+    // Shared with the job running on the BackgroundExecutor, so that either
+    // side may go away first.
+    struct Completion;
 
-    // Called prediodically to |tryJoin| the launched thread.
-    static void tryWaitTillJoinedStatic(void* opaqueThis,
-                                        android::base::Looper::Timer* timer);
-
-    void tryWaitTillJoined(android::base::Looper::Timer* timer);
+    void onTaskDone();
 
     android::base::Looper* mLooper;
-    android::base::Looper::Duration mCheckTimeoutMs;
-    ManagedThread mManagedThread;
-
+    bool mStarted = false;
     bool isRunning = false;
-    std::unique_ptr<android::base::Looper::Timer> mTimer;
+    std::shared_ptr<Completion> mCompletion;
+    // Armed while the task is in flight so that |mLooper| keeps running
+    // until the completion is posted to it.
+    std::unique_ptr<android::base::Looper::Timer> mKeepAliveTimer;
 
     DISALLOW_COPY_AND_ASSIGN(ParallelTaskBase);
 };
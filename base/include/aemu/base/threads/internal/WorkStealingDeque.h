@@ -0,0 +1,152 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "aemu/base/Compiler.h"
+
+namespace android {
+namespace base {
+namespace internal {
+
+// Chase-Lev work-stealing deque of T* (Le et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models", PPoPP'13).
+//
+// A single owner thread calls push() and pop() on the bottom end; any number
+// of other threads may call steal() on the top end. The deque does not own the
+// pointed-to objects.
+//
+// This is an implementation detail of ThreadPool. DO NOT use this class
+// directly.
+template <class T>
+class WorkStealingDeque {
+    DISALLOW_COPY_AND_ASSIGN(WorkStealingDeque);
+
+public:
+    explicit WorkStealingDeque(int64_t initialCapacity = 64) {
+        int64_t capacity = 1;
+        while (capacity < initialCapacity) capacity <<= 1;
+        mArrays.push_back(std::make_unique<Array>(capacity));
+        mArray.store(mArrays.back().get(), std::memory_order_relaxed);
+    }
+
+    // Owner only.
+    void push(T* item) {
+        int64_t b = mBottom.load(std::memory_order_relaxed);
+        int64_t t = mTop.load(std::memory_order_acquire);
+        Array* a = mArray.load(std::memory_order_relaxed);
+        if (b - t > a->capacity() - 1) {
+            a = grow(a, t, b);
+        }
+        a->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        mBottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only. Returns nullptr if empty.
+    T* pop() {
+        int64_t b = mBottom.load(std::memory_order_relaxed) - 1;
+        Array* a = mArray.load(std::memory_order_relaxed);
+        mBottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = mTop.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            mBottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T* item = a->get(b);
+        if (t == b) {
+            // Last item; race against thieves for it.
+            if (!mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            mBottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread. Returns nullptr if empty or if it lost a race with another
+    // thief or the owner.
+    T* steal() {
+        int64_t t = mTop.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = mBottom.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+
+        Array* a = mArray.load(std::memory_order_acquire);
+        T* item = a->get(t);
+        if (!mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    // Approximate; only meaningful as a hint.
+    bool empty() const {
+        return mBottom.load(std::memory_order_relaxed) <=
+               mTop.load(std::memory_order_relaxed);
+    }
+
+private:
+    class Array {
+    public:
+        explicit Array(int64_t capacity)
+            : mMask(capacity - 1), mSlots(new std::atomic<T*>[capacity]) {}
+
+        int64_t capacity() const { return mMask + 1; }
+        T* get(int64_t i) const {
+            return mSlots[i & mMask].load(std::memory_order_relaxed);
+        }
+        void put(int64_t i, T* item) {
+            mSlots[i & mMask].store(item, std::memory_order_relaxed);
+        }
+
+    private:
+        const int64_t mMask;
+        std::unique_ptr<std::atomic<T*>[]> mSlots;
+    };
+
+    Array* grow(Array* old, int64_t t, int64_t b) {
+        auto bigger = std::make_unique<Array>(old->capacity() * 2);
+        for (int64_t i = t; i < b; ++i) {
+            bigger->put(i, old->get(i));
+        }
+        Array* res = bigger.get();
+        // Thieves may still be reading from |old|, so retired arrays are kept
+        // until the deque is destroyed. Growth doubles, so this at most
+        // doubles the memory used.
+        mArrays.push_back(std::move(bigger));
+        mArray.store(res, std::memory_order_release);
+        return res;
+    }
+
+    std::atomic<int64_t> mTop{0};
+    std::atomic<int64_t> mBottom{0};
+    std::atomic<Array*> mArray{nullptr};
+    // Owner only.
+    std::vector<std::unique_ptr<Array>> mArrays;
+};
+
+}  // namespace internal
+}  // namespace base
+}  // namespace android
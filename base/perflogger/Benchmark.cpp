@@ -0,0 +1,92 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/perflogger/Benchmark.h"
+
+#include "aemu/base/perflogger/Metric.h"
+#include "aemu/base/system/System.h"
+
+namespace android {
+namespace perflogger {
+
+Benchmark::Benchmark(const std::string& benchmarkName,
+                     const std::string& projectName,
+                     const std::string& description,
+                     const Metadata& metadata)
+    : mName(benchmarkName),
+      mProjectName(projectName),
+      mDescription(description),
+      mMetadata(metadata) {}
+
+Benchmark::Benchmark(const std::string& customOutputDir,
+                     const std::string& benchmarkName,
+                     const std::string& projectName,
+                     const std::string& description,
+                     const Metadata& metadata)
+    : mName(benchmarkName),
+      mProjectName(projectName),
+      mDescription(description),
+      mMetadata(metadata),
+      mCustomOutputDir(customOutputDir) {}
+
+Benchmark::~Benchmark() = default;
+
+base::Optional<std::string> Benchmark::getCustomOutputDir() const {
+    return mCustomOutputDir;
+}
+
+std::string Benchmark::getName() const {
+    return mName;
+}
+
+std::string Benchmark::getProjectName() const {
+    return mProjectName;
+}
+
+std::string Benchmark::getDescription() const {
+    return mDescription;
+}
+
+const Benchmark::Metadata& Benchmark::getMetadata() const {
+    return mMetadata;
+}
+
+void Benchmark::log(const std::string& metricName, long data) {
+    log(metricName, data, nullptr);
+}
+
+void Benchmark::log(const std::string& metricName,
+                    long data,
+                    Analyzer* analyzer) {
+    Metric& metric = Metric::get(
+            metricName, mCustomOutputDir
+                                ? *mCustomOutputDir
+                                : Metric::getPreferredOutputDirectory());
+    const long timestampMs = long(base::getUnixTimeUs() / 1000);
+    metric.addSamples(this, {{timestampMs, data}});
+    if (analyzer) {
+        metric.addAnalyzer(this, analyzer);
+    }
+}
+
+bool Benchmark::operator==(const Benchmark& other) const {
+    return mName == other.mName && mProjectName == other.mProjectName &&
+           mDescription == other.mDescription &&
+           mMetadata == other.mMetadata &&
+           mCustomOutputDir == other.mCustomOutputDir;
+}
+
+}  // namespace perflogger
+}  // namespace android
@@ -0,0 +1,307 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/perflogger/Metric.h"
+
+#include "aemu/base/JsonWriter.h"
+#include "aemu/base/files/PathUtils.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/system/System.h"
+#include "host-common/logging.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unordered_map>
+#include <utility>
+
+namespace android {
+namespace perflogger {
+
+namespace {
+
+// Runs kept per benchmark in the history file.
+constexpr size_t kMaxHistoryRuns = 100;
+
+struct Registry {
+    base::Lock lock;
+    std::map<std::pair<std::string, std::string>, std::unique_ptr<Metric>>
+            metrics;
+};
+
+Registry& registry() {
+    static Registry* r = new Registry;
+    return *r;
+}
+
+// The history has one line per run:
+//   <benchmark name>\t<timestamp ms>\t<sample>,<sample>,...
+struct HistoryRun {
+    std::string benchmark;
+    long timestampMs;
+    std::vector<long> samples;
+};
+
+std::string historyName(const std::string& name) {
+    std::string res = name;
+    std::replace_if(
+            res.begin(), res.end(),
+            [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+    return res;
+}
+
+std::vector<HistoryRun> readHistory(const std::string& path) {
+    std::vector<HistoryRun> runs;
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (!fp) {
+        return runs;
+    }
+    std::string contents;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        contents.append(buf, n);
+    }
+    fclose(fp);
+
+    size_t pos = 0;
+    while (pos < contents.size()) {
+        size_t end = contents.find('\n', pos);
+        if (end == std::string::npos) {
+            end = contents.size();
+        }
+        const std::string line = contents.substr(pos, end - pos);
+        pos = end + 1;
+
+        const size_t tab1 = line.find('\t');
+        const size_t tab2 =
+                tab1 == std::string::npos ? tab1 : line.find('\t', tab1 + 1);
+        if (tab2 == std::string::npos) {
+            continue;
+        }
+        HistoryRun run;
+        run.benchmark = line.substr(0, tab1);
+        run.timestampMs = strtol(line.c_str() + tab1 + 1, nullptr, 10);
+        const char* p = line.c_str() + tab2 + 1;
+        while (*p) {
+            char* next;
+            const long sample = strtol(p, &next, 10);
+            if (next == p) {
+                break;
+            }
+            run.samples.push_back(sample);
+            p = *next == ',' ? next + 1 : next;
+        }
+        if (!run.samples.empty()) {
+            runs.push_back(std::move(run));
+        }
+    }
+    return runs;
+}
+
+bool writeHistory(const std::string& path, const std::vector<HistoryRun>& runs) {
+    FILE* fp = fopen(path.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    bool ok = true;
+    for (const HistoryRun& run : runs) {
+        std::string line = run.benchmark + '\t' +
+                           std::to_string(run.timestampMs) + '\t';
+        for (size_t i = 0; i < run.samples.size(); ++i) {
+            if (i) {
+                line += ',';
+            }
+            line += std::to_string(run.samples[i]);
+        }
+        line += '\n';
+        ok = ok && fwrite(line.data(), 1, line.size(), fp) == line.size();
+    }
+    return fclose(fp) == 0 && ok;
+}
+
+// Drops all but the last kMaxHistoryRuns runs of each benchmark.
+void trimHistory(std::vector<HistoryRun>* runs) {
+    std::unordered_map<std::string, size_t> seen;
+    std::vector<HistoryRun> kept;
+    for (auto it = runs->rbegin(); it != runs->rend(); ++it) {
+        if (++seen[it->benchmark] <= kMaxHistoryRuns) {
+            kept.push_back(std::move(*it));
+        }
+    }
+    std::reverse(kept.begin(), kept.end());
+    *runs = std::move(kept);
+}
+
+}  // namespace
+
+// static
+std::string Metric::getPreferredOutputDirectory() {
+    std::string dir = base::getEnvironmentVariable("AEMU_PERFLOGGER_DIR");
+    return dir.empty() ? std::string(".") : dir;
+}
+
+// static
+Metric& Metric::get(const std::string& metricName,
+                    const std::string& outputDir) {
+    Registry& r = registry();
+    base::AutoLock lock(r.lock);
+    auto& metric = r.metrics[{outputDir, metricName}];
+    if (!metric) {
+        metric.reset(new Metric(metricName, outputDir));
+    }
+    return *metric;
+}
+
+// static
+std::vector<std::string> Metric::commitAll() {
+    Registry& r = registry();
+    base::AutoLock lock(r.lock);
+    std::vector<std::string> regressions;
+    for (auto& it : r.metrics) {
+        std::vector<std::string> found = it.second->commit();
+        regressions.insert(regressions.end(), found.begin(), found.end());
+    }
+    return regressions;
+}
+
+Metric::Metric(const std::string& metricName)
+    : Metric(metricName, getPreferredOutputDirectory()) {}
+
+Metric::Metric(const std::string& metricName, const std::string& outputDir)
+    : mName(metricName), mOutputDirectory(outputDir) {}
+
+std::string Metric::getMetricName() const {
+    return mName;
+}
+
+std::string Metric::getOutputDirectory() const {
+    return mOutputDirectory;
+}
+
+Metric::Entry& Metric::entryFor(const Benchmark& benchmark) {
+    for (Entry& entry : mEntries) {
+        if (entry.benchmark == benchmark) {
+            return entry;
+        }
+    }
+    mEntries.push_back(Entry{benchmark, {}, {}});
+    return mEntries.back();
+}
+
+void Metric::addSamples(Benchmark* benchmark,
+                        const std::vector<MetricSample>& data) {
+    Entry& entry = entryFor(*benchmark);
+    entry.samples.insert(entry.samples.end(), data.begin(), data.end());
+}
+
+void Metric::setAnalyzers(Benchmark* benchmark,
+                          const std::vector<Analyzer*>& analyzers) {
+    entryFor(*benchmark).analyzers = analyzers;
+}
+
+void Metric::addAnalyzer(Benchmark* benchmark, Analyzer* analyzer) {
+    std::vector<Analyzer*>& analyzers = entryFor(*benchmark).analyzers;
+    if (std::find(analyzers.begin(), analyzers.end(), analyzer) ==
+        analyzers.end()) {
+        analyzers.push_back(analyzer);
+    }
+}
+
+std::vector<std::string> Metric::commit() {
+    std::vector<std::string> regressions;
+    if (std::none_of(mEntries.begin(), mEntries.end(),
+                     [](const Entry& e) { return !e.samples.empty(); })) {
+        return regressions;
+    }
+
+    const std::string historyPath =
+            base::pj(mOutputDirectory, mName + ".history");
+    std::vector<HistoryRun> history = readHistory(historyPath);
+
+    base::JsonWriter json(base::pj(mOutputDirectory, mName + ".json"));
+    json.setIndent("  ");
+    json.beginObject();
+    json.name("metric").value(mName);
+    json.name("benchmarks").beginArray();
+    for (Entry& entry : mEntries) {
+        if (entry.samples.empty()) {
+            continue;
+        }
+        const std::string name = historyName(entry.benchmark.getName());
+        HistoryRun current{name, entry.samples.front().timestampMs, {}};
+        for (const MetricSample& sample : entry.samples) {
+            current.samples.push_back(sample.data);
+        }
+        std::vector<std::vector<long>> runs;
+        for (const HistoryRun& run : history) {
+            if (run.benchmark == name) {
+                runs.push_back(run.samples);
+            }
+        }
+        runs.push_back(current.samples);
+        history.push_back(std::move(current));
+
+        json.beginObject();
+        json.name("name").value(entry.benchmark.getName());
+        json.name("project").value(entry.benchmark.getProjectName());
+        json.name("description").value(entry.benchmark.getDescription());
+        json.name("metadata").beginObject();
+        for (const auto& it : entry.benchmark.getMetadata()) {
+            json.name(it.first).value(it.second);
+        }
+        json.endObject();
+        json.name("samples").beginArray();
+        for (const MetricSample& sample : entry.samples) {
+            json.beginObject();
+            json.name("timestampMs").value(sample.timestampMs);
+            json.name("data").value(sample.data);
+            json.endObject();
+        }
+        json.endArray();
+        json.name("analyzers").beginArray();
+        for (Analyzer* analyzer : entry.analyzers) {
+            analyzer->outputJson(&json);
+        }
+        json.endArray();
+        json.name("regressions").beginArray();
+        for (Analyzer* analyzer : entry.analyzers) {
+            std::string found = analyzer->findRegression(runs);
+            if (!found.empty()) {
+                json.value(found);
+                regressions.push_back(mName + " " + entry.benchmark.getName() +
+                                      ": " + found);
+            }
+        }
+        json.endArray();
+        json.endObject();
+
+        entry.samples.clear();
+    }
+    json.endArray();
+    json.endObject();
+    json.flush();
+
+    trimHistory(&history);
+    if (!writeHistory(historyPath, history)) {
+        ERR("Failed to write %s", historyPath.c_str());
+    }
+    return regressions;
+}
+
+}  // namespace perflogger
+}  // namespace android
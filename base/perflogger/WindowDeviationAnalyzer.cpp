@@ -0,0 +1,211 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/perflogger/WindowDeviationAnalyzer.h"
+
+#include "aemu/base/JsonWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+
+namespace android {
+namespace perflogger {
+
+namespace {
+
+double mean(const std::vector<double>& values) {
+    double sum = 0;
+    for (double v : values) {
+        sum += v;
+    }
+    return sum / values.size();
+}
+
+double stddev(const std::vector<double>& values) {
+    const double m = mean(values);
+    double sum = 0;
+    for (double v : values) {
+        sum += (v - m) * (v - m);
+    }
+    return std::sqrt(sum / values.size());
+}
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    const size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid]
+                             : (values[mid - 1] + values[mid]) / 2;
+}
+
+double medianAbsoluteDeviation(const std::vector<double>& values) {
+    const double m = median(values);
+    std::vector<double> deviations;
+    deviations.reserve(values.size());
+    for (double v : values) {
+        deviations.push_back(std::fabs(v - m));
+    }
+    return median(std::move(deviations));
+}
+
+double aggregate(Analyzer::MetricAggregate aggregate,
+                 const std::vector<long>& samples) {
+    std::vector<double> values(samples.begin(), samples.end());
+    switch (aggregate) {
+        case Analyzer::Mean:
+            return mean(values);
+        case Analyzer::Median:
+            return median(std::move(values));
+        case Analyzer::Min:
+            return *std::min_element(values.begin(), values.end());
+        case Analyzer::Max:
+            return *std::max_element(values.begin(), values.end());
+    }
+    return 0;
+}
+
+const char* aggregateName(Analyzer::MetricAggregate aggregate) {
+    switch (aggregate) {
+        case Analyzer::Mean:
+            return "MEAN";
+        case Analyzer::Median:
+            return "MEDIAN";
+        case Analyzer::Min:
+            return "MIN";
+        case Analyzer::Max:
+            return "MAX";
+    }
+    return "";
+}
+
+const char* biasName(Analyzer::DirectionBias bias) {
+    switch (bias) {
+        case Analyzer::NoBias:
+            return "NO_BIAS";
+        case Analyzer::IgnoreIncrease:
+            return "IGNORE_INCREASE";
+        case Analyzer::IgnoreDecrease:
+            return "IGNORE_DECREASE";
+    }
+    return "";
+}
+
+}  // namespace
+
+WindowDeviationAnalyzer::WindowDeviationAnalyzer(
+        MetricAggregate aggregate,
+        int runInfoQueryLimit,
+        int recentWindowSize,
+        const std::vector<MeanToleranceParams>& meanTolerances,
+        const std::vector<MedianToleranceParams>& medianTolerances,
+        DirectionBias bias)
+    : mAggregate(aggregate),
+      mRunInfoQueryLimit(runInfoQueryLimit),
+      mRecentWindowSize(recentWindowSize),
+      mMeanTolerances(meanTolerances),
+      mMedianTolerances(medianTolerances),
+      mBias(bias) {}
+
+WindowDeviationAnalyzer::WindowDeviationAnalyzer(
+        const WindowDeviationAnalyzer& other) = default;
+
+void WindowDeviationAnalyzer::outputJson(base::JsonWriter* writer) {
+    if (!writer) {
+        return;
+    }
+    writer->beginObject();
+    writer->name("windowDeviationAnalyzer").beginObject();
+    writer->name("metricAggregate").value(aggregateName(mAggregate));
+    writer->name("runInfoQueryLimit").value(mRunInfoQueryLimit);
+    writer->name("recentWindowSize").value(mRecentWindowSize);
+    writer->name("directionBias").value(biasName(mBias));
+    writer->name("meanTolerances").beginArray();
+    for (const MeanToleranceParams& params : mMeanTolerances) {
+        writer->beginObject();
+        writer->name("constTerm").value(params.constTerm);
+        writer->name("meanCoeff").value(params.meanCoeff);
+        writer->name("stddevCoeff").value(params.stddevCoeff);
+        writer->endObject();
+    }
+    writer->endArray();
+    writer->name("medianTolerances").beginArray();
+    for (const MedianToleranceParams& params : mMedianTolerances) {
+        writer->beginObject();
+        writer->name("constTerm").value(params.constTerm);
+        writer->name("medianCoeff").value(params.medianCoeff);
+        writer->name("madCoeff").value(params.madCoeff);
+        writer->endObject();
+    }
+    writer->endArray();
+    writer->endObject();
+    writer->endObject();
+}
+
+std::string WindowDeviationAnalyzer::findRegression(
+        const std::vector<std::vector<long>>& runs) const {
+    std::vector<double> values;
+    const size_t first =
+            runs.size() > size_t(std::max(mRunInfoQueryLimit, 0))
+                    ? runs.size() - mRunInfoQueryLimit
+                    : 0;
+    for (size_t i = first; i < runs.size(); ++i) {
+        if (!runs[i].empty()) {
+            values.push_back(aggregate(mAggregate, runs[i]));
+        }
+    }
+    const size_t window = size_t(std::max(mRecentWindowSize, 1));
+    if (values.size() <= window) {
+        return {};
+    }
+    const std::vector<double> baseline(values.begin(), values.end() - window);
+    const std::vector<double> recent(values.end() - window, values.end());
+
+    char buf[160];
+    const auto check = [this, &buf](const char* what, double base,
+                                    double now, double tolerance) {
+        const double delta = now - base;
+        if ((mBias == IgnoreIncrease && delta > 0) ||
+            (mBias == IgnoreDecrease && delta < 0) ||
+            std::fabs(delta) <= tolerance) {
+            return false;
+        }
+        snprintf(buf, sizeof(buf), "%s went from %g to %g (tolerance %g)",
+                 what, base, now, tolerance);
+        return true;
+    };
+
+    for (const MeanToleranceParams& params : mMeanTolerances) {
+        const double base = mean(baseline);
+        const double tolerance = params.constTerm +
+                                 params.meanCoeff * std::fabs(base) +
+                                 params.stddevCoeff * stddev(baseline);
+        if (check("mean", base, mean(recent), tolerance)) {
+            return buf;
+        }
+    }
+    for (const MedianToleranceParams& params : mMedianTolerances) {
+        const double base = median(baseline);
+        const double tolerance =
+                params.constTerm + params.medianCoeff * std::fabs(base) +
+                params.madCoeff * medianAbsoluteDeviation(baseline);
+        if (check("median", base, median(recent), tolerance)) {
+            return buf;
+        }
+    }
+    return {};
+}
+
+}  // namespace perflogger
+}  // namespace android
@@ -4,7 +4,11 @@
  */
 #include "aemu/base/ring_buffer.h"
 
+#include "aemu/base/system/FastClock.h"
+
 #include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #ifdef _MSC_VER
 #include "aemu/base/msvc.h"
@@ -16,13 +20,40 @@
 #include <emmintrin.h>
 #endif
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RING_BUFFER_X86 1
+#include <immintrin.h>
+#define RING_BUFFER_PREFETCH(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#elif defined(__GNUC__) || defined(__clang__)
+#define RING_BUFFER_PREFETCH(p) __builtin_prefetch((p), 0, 3)
+#else
+#define RING_BUFFER_PREFETCH(p)
+#endif
+
 #ifdef _WIN32
 #include <windows.h>
 #else
+#include <fcntl.h>
 #include <sched.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #endif
 
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+#ifdef __APPLE__
+// Not in the public SDK, but stable and used by libc++ for atomic waits.
+extern "C" int __ulock_wait(uint32_t operation, void* addr, uint64_t value,
+                            uint32_t timeout_us);
+extern "C" int __ulock_wake(uint32_t operation, void* addr, uint64_t wake_value);
+#define RING_BUFFER_UL_COMPARE_AND_WAIT 1
+#define RING_BUFFER_ULF_WAKE_ALL 0x00000100
+#endif
+
 #define RING_BUFFER_MASK (RING_BUFFER_SIZE - 1)
 
 #define RING_BUFFER_VERSION 1
@@ -36,9 +67,47 @@ void ring_buffer_init(struct ring_buffer* r) {
     r->read_yield_count = 0;
     r->read_sleep_us_count = 0;
 
+    r->read_waiters = 0;
+    r->write_waiters = 0;
+    r->wait_mode = RING_BUFFER_WAIT_POLL;
+    r->read_spin_us = 0;
+    r->write_spin_us = 0;
+
     r->state = 0;
 }
 
+void ring_buffer_set_wait_mode(struct ring_buffer* r,
+                               enum ring_buffer_wait_mode mode) {
+    __atomic_store_n(&r->wait_mode, (uint32_t)mode, __ATOMIC_SEQ_CST);
+}
+
+static void ring_buffer_wake_address(uint32_t* addr) {
+#if defined(__linux__)
+    syscall(SYS_futex, addr, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+#elif defined(_WIN32)
+    WakeByAddressAll(addr);
+#elif defined(__APPLE__)
+    __ulock_wake(RING_BUFFER_UL_COMPARE_AND_WAIT | RING_BUFFER_ULF_WAKE_ALL, addr, 0);
+#else
+    (void)addr;
+#endif
+}
+
+// Called by the producer after publishing a new write_pos, and by the consumer
+// after publishing a new read_pos. The waiter count shares a cache line with
+// the position that was just updated, so this is cheap when nobody is parked.
+static void ring_buffer_notify_readers(struct ring_buffer* r) {
+    if (__atomic_load_n(&r->read_waiters, __ATOMIC_SEQ_CST)) {
+        ring_buffer_wake_address(&r->write_pos);
+    }
+}
+
+static void ring_buffer_notify_writers(struct ring_buffer* r) {
+    if (__atomic_load_n(&r->write_waiters, __ATOMIC_SEQ_CST)) {
+        ring_buffer_wake_address(&r->read_pos);
+    }
+}
+
 static uint32_t get_ring_pos(uint32_t index) {
     return index & RING_BUFFER_MASK;
 }
@@ -62,6 +131,9 @@ long ring_buffer_write(
 
     for (i = 0; i < steps; ++i) {
         if (!ring_buffer_can_write(r, step_size)) {
+            if (i) {
+                ring_buffer_notify_readers(r);
+            }
             errno = -EAGAIN;
             return (long)i;
         }
@@ -90,6 +162,9 @@ long ring_buffer_write(
         __atomic_add_fetch(&r->write_pos, step_size, __ATOMIC_SEQ_CST);
     }
 
+    if (steps) {
+        ring_buffer_notify_readers(r);
+    }
     errno = 0;
     return (long)steps;
 }
@@ -101,6 +176,9 @@ long ring_buffer_read(
 
     for (i = 0; i < steps; ++i) {
         if (!ring_buffer_can_read(r, step_size)) {
+            if (i) {
+                ring_buffer_notify_writers(r);
+            }
             errno = -EAGAIN;
             return (long)i;
         }
@@ -129,6 +207,9 @@ long ring_buffer_read(
         __atomic_add_fetch(&r->read_pos, step_size, __ATOMIC_SEQ_CST);
     }
 
+    if (steps) {
+        ring_buffer_notify_writers(r);
+    }
     errno = 0;
     return (long)steps;
 }
@@ -139,6 +220,9 @@ long ring_buffer_advance_write(
 
     for (i = 0; i < steps; ++i) {
         if (!ring_buffer_can_write(r, step_size)) {
+            if (i) {
+                ring_buffer_notify_readers(r);
+            }
             errno = -EAGAIN;
             return (long)i;
         }
@@ -146,6 +230,9 @@ long ring_buffer_advance_write(
         __atomic_add_fetch(&r->write_pos, step_size, __ATOMIC_SEQ_CST);
     }
 
+    if (steps) {
+        ring_buffer_notify_readers(r);
+    }
     errno = 0;
     return (long)steps;
 }
@@ -156,6 +243,9 @@ long ring_buffer_advance_read(
 
     for (i = 0; i < steps; ++i) {
         if (!ring_buffer_can_read(r, step_size)) {
+            if (i) {
+                ring_buffer_notify_writers(r);
+            }
             errno = -EAGAIN;
             return (long)i;
         }
@@ -163,6 +253,9 @@ long ring_buffer_advance_read(
         __atomic_add_fetch(&r->read_pos, step_size, __ATOMIC_SEQ_CST);
     }
 
+    if (steps) {
+        ring_buffer_notify_writers(r);
+    }
     errno = 0;
     return (long)steps;
 }
@@ -193,6 +286,7 @@ void ring_buffer_view_init(
     v->buf = buf;
     v->size = (1 << shift);
     v->mask = (1 << shift) - 1;
+    v->mirrored = 0;
 }
 
 void ring_buffer_init_view_only(
@@ -205,6 +299,123 @@ void ring_buffer_init_view_only(
     v->buf = buf;
     v->size = (1 << shift);
     v->mask = (1 << shift) - 1;
+    v->mirrored = 0;
+}
+
+static uint32_t ring_buffer_mirror_granularity() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    // Views must be placed at allocation granularity, not page size.
+    return info.dwAllocationGranularity;
+#else
+    return (uint32_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// Maps |size| bytes of fresh shared memory twice in a row and returns the
+// start of the first mapping, or NULL.
+static uint8_t* ring_buffer_map_mirrored(uint32_t size) {
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL,
+                                        PAGE_READWRITE, 0, size, NULL);
+    if (!mapping) return NULL;
+
+    uint8_t* res = NULL;
+    // Another thread can grab the address range between VirtualFree and
+    // MapViewOfFileEx, so retry a few times.
+    for (int attempt = 0; attempt < 16 && !res; ++attempt) {
+        void* base = VirtualAlloc(NULL, 2 * (SIZE_T)size, MEM_RESERVE,
+                                  PAGE_NOACCESS);
+        if (!base) break;
+        VirtualFree(base, 0, MEM_RELEASE);
+
+        void* first = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size,
+                                      base);
+        void* second = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size,
+                                       (uint8_t*)base + size);
+        if (first && second) {
+            res = (uint8_t*)base;
+        } else {
+            if (first) UnmapViewOfFile(first);
+            if (second) UnmapViewOfFile(second);
+        }
+    }
+
+    // The views keep the section alive.
+    CloseHandle(mapping);
+    return res;
+#else
+    int fd = -1;
+#if defined(__linux__) && defined(SYS_memfd_create)
+    fd = (int)syscall(SYS_memfd_create, "ring_buffer", 1 /* MFD_CLOEXEC */);
+#endif
+    if (fd < 0) {
+        static uint32_t counter = 0;
+        char name[64];
+        snprintf(name, sizeof(name), "/ring_buffer-%d-%u", (int)getpid(),
+                 __atomic_add_fetch(&counter, 1, __ATOMIC_SEQ_CST));
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0) return NULL;
+        shm_unlink(name);
+    }
+
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    uint8_t* base = (uint8_t*)mmap(NULL, 2 * (size_t)size, PROT_NONE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    void* first = mmap(base, size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_FIXED, fd, 0);
+    void* second = mmap(base + size, size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_FIXED, fd, 0);
+    close(fd);
+
+    if (first == MAP_FAILED || second == MAP_FAILED) {
+        munmap(base, 2 * (size_t)size);
+        return NULL;
+    }
+    return base;
+#endif
+}
+
+bool ring_buffer_view_init_mirrored(
+    struct ring_buffer* r,
+    struct ring_buffer_view* v,
+    uint32_t size) {
+
+    uint32_t granularity = ring_buffer_mirror_granularity();
+    uint32_t rounded = granularity;
+    while (rounded < size) {
+        if (rounded & 0x80000000u) return false;
+        rounded <<= 1;
+    }
+
+    uint8_t* buf = ring_buffer_map_mirrored(rounded);
+    if (!buf) return false;
+
+    ring_buffer_view_init(r, v, buf, rounded);
+    v->mirrored = 1;
+    return true;
+}
+
+void ring_buffer_view_free_mirrored(struct ring_buffer_view* v) {
+    if (!v->mirrored || !v->buf) return;
+#ifdef _WIN32
+    UnmapViewOfFile(v->buf);
+    UnmapViewOfFile(v->buf + v->size);
+#else
+    munmap(v->buf, 2 * (size_t)v->size);
+#endif
+    v->buf = NULL;
+    v->mirrored = 0;
 }
 
 uint32_t ring_buffer_view_get_ring_pos(
@@ -282,7 +493,7 @@ int ring_buffer_copy_contents(
     }
 
     if (v) {
-        if (wanted_bytes > available_at_end) {
+        if (!v->mirrored && wanted_bytes > available_at_end) {
             uint32_t remaining = wanted_bytes - available_at_end;
             memcpy(res,
                    &v->buf[ring_buffer_view_get_ring_pos(v, r->read_pos)],
@@ -313,16 +524,125 @@ int ring_buffer_copy_contents(
     return 0;
 }
 
+// Bulk copies, for steps at or past the threshold.
+static uint32_t s_bulk_copy_threshold = RING_BUFFER_BULK_COPY_OFF;
+
+void ring_buffer_set_bulk_copy_threshold(uint32_t bytes) {
+    __atomic_store_n(&s_bulk_copy_threshold, bytes, __ATOMIC_RELAXED);
+}
+
+static bool ring_buffer_is_bulk(uint32_t bytes) {
+    return bytes >= __atomic_load_n(&s_bulk_copy_threshold, __ATOMIC_RELAXED);
+}
+
+#if RING_BUFFER_X86
+
+// Streams whole 64-byte lines to |dst|, which is 64-byte aligned. The fence
+// orders the streaming stores before the write_pos update that publishes them.
+typedef void (*ring_buffer_stream_fn)(uint8_t* dst, const uint8_t* src, uint32_t bytes);
+
+__attribute__((target("sse2")))
+static void ring_buffer_stream_sse2(uint8_t* dst, const uint8_t* src, uint32_t bytes) {
+    for (uint32_t i = 0; i < bytes; i += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(src + i + 32));
+        __m128i d = _mm_loadu_si128((const __m128i*)(src + i + 48));
+        _mm_stream_si128((__m128i*)(dst + i), a);
+        _mm_stream_si128((__m128i*)(dst + i + 16), b);
+        _mm_stream_si128((__m128i*)(dst + i + 32), c);
+        _mm_stream_si128((__m128i*)(dst + i + 48), d);
+    }
+    _mm_sfence();
+}
+
+__attribute__((target("avx")))
+static void ring_buffer_stream_avx(uint8_t* dst, const uint8_t* src, uint32_t bytes) {
+    for (uint32_t i = 0; i < bytes; i += 64) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 32));
+        _mm256_stream_si256((__m256i*)(dst + i), a);
+        _mm256_stream_si256((__m256i*)(dst + i + 32), b);
+    }
+    _mm_sfence();
+}
+
+static ring_buffer_stream_fn ring_buffer_pick_stream() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx")) {
+        return ring_buffer_stream_avx;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return ring_buffer_stream_sse2;
+    }
+    return NULL;
+}
+
+#endif  // RING_BUFFER_X86
+
+// Copies |bytes| from |src| into the ring at |dst|. Bulk copies go around the
+// cache on x86; elsewhere they're memcpy()s. (arm64 has no streaming store
+// that reliably skips the cache, and DC ZVA only helps when zeroing.)
+static void ring_buffer_copy_in(
+    uint8_t* dst, const uint8_t* src, uint32_t bytes, bool bulk) {
+#if RING_BUFFER_X86
+    static const ring_buffer_stream_fn stream = ring_buffer_pick_stream();
+    if (bulk && stream) {
+        uint32_t head = (uint32_t)(-(uintptr_t)dst & 63);
+        if (head > bytes) {
+            head = bytes;
+        }
+        uint32_t body = (bytes - head) & ~63u;
+        memcpy(dst, src, head);
+        stream(dst + head, src + head, body);
+        memcpy(dst + head + body, src + head + body, bytes - head - body);
+        return;
+    }
+#else
+    (void)bulk;
+#endif
+    memcpy(dst, src, bytes);
+}
+
+// Copies |bytes| out of the ring at |src|. A bulk step was written around
+// the cache, so the copy prefetches a block ahead of itself; the hardware
+// prefetchers stop at page boundaries.
+#define RING_BUFFER_PREFETCH_BLOCK 4096
+
+static void ring_buffer_copy_out(
+    uint8_t* dst, const uint8_t* src, uint32_t bytes, bool bulk) {
+    if (!bulk) {
+        memcpy(dst, src, bytes);
+        return;
+    }
+    for (uint32_t done = 0; done < bytes; done += RING_BUFFER_PREFETCH_BLOCK) {
+        uint32_t left = bytes - done;
+        uint32_t n = left < RING_BUFFER_PREFETCH_BLOCK ? left : RING_BUFFER_PREFETCH_BLOCK;
+        uint32_t ahead = left - n;
+        if (ahead > RING_BUFFER_PREFETCH_BLOCK) {
+            ahead = RING_BUFFER_PREFETCH_BLOCK;
+        }
+        for (uint32_t off = 0; off < ahead; off += 64) {
+            RING_BUFFER_PREFETCH(src + done + n + off);
+        }
+        memcpy(dst + done, src + done, n);
+    }
+}
+
 long ring_buffer_view_write(
     struct ring_buffer* r,
     struct ring_buffer_view* v,
     const void* data, uint32_t step_size, uint32_t steps) {
 
     uint8_t* data_bytes = (uint8_t*)data;
+    bool bulk = ring_buffer_is_bulk(step_size);
     uint32_t i;
 
     for (i = 0; i < steps; ++i) {
         if (!ring_buffer_view_can_write(r, v, step_size)) {
+            if (i) {
+                ring_buffer_notify_readers(r);
+            }
             errno = -EAGAIN;
             return (long)i;
         }
@@ -331,26 +651,29 @@ long ring_buffer_view_write(
         uint32_t available_at_end =
             v->size - ring_buffer_view_get_ring_pos(v, r->write_pos);
 
-        if (step_size > available_at_end) {
+        if (!v->mirrored && step_size > available_at_end) {
             uint32_t remaining = step_size - available_at_end;
-            memcpy(
+            ring_buffer_copy_in(
                 &v->buf[ring_buffer_view_get_ring_pos(v, r->write_pos)],
                 data_bytes + i * step_size,
-                available_at_end);
-            memcpy(
+                available_at_end, bulk);
+            ring_buffer_copy_in(
                 &v->buf[ring_buffer_view_get_ring_pos(v, r->write_pos + available_at_end)],
                 data_bytes + i * step_size + available_at_end,
-                remaining);
+                remaining, bulk);
         } else {
-            memcpy(
+            ring_buffer_copy_in(
                 &v->buf[ring_buffer_view_get_ring_pos(v, r->write_pos)],
                 data_bytes + i * step_size,
-                step_size);
+                step_size, bulk);
         }
 
         __atomic_add_fetch(&r->write_pos, step_size, __ATOMIC_SEQ_CST);
     }
 
+    if (steps) {
+        ring_buffer_notify_readers(r);
+    }
     errno = 0;
     return (long)steps;
 
@@ -361,10 +684,14 @@ long ring_buffer_view_read(
     struct ring_buffer_view* v,
     void* data, uint32_t step_size, uint32_t steps) {
     uint8_t* data_bytes = (uint8_t*)data;
+    bool bulk = ring_buffer_is_bulk(step_size);
     uint32_t i;
 
     for (i = 0; i < steps; ++i) {
         if (!ring_buffer_view_can_read(r, v, step_size)) {
+            if (i) {
+                ring_buffer_notify_writers(r);
+            }
             errno = -EAGAIN;
             return (long)i;
         }
@@ -373,28 +700,245 @@ long ring_buffer_view_read(
         uint32_t available_at_end =
             v->size - ring_buffer_view_get_ring_pos(v, r->read_pos);
 
-        if (step_size > available_at_end) {
+        if (!v->mirrored && step_size > available_at_end) {
             uint32_t remaining = step_size - available_at_end;
-            memcpy(
+            ring_buffer_copy_out(
                 data_bytes + i * step_size,
                 &v->buf[ring_buffer_view_get_ring_pos(v, r->read_pos)],
-                available_at_end);
-            memcpy(
+                available_at_end, bulk);
+            ring_buffer_copy_out(
                 data_bytes + i * step_size + available_at_end,
                 &v->buf[ring_buffer_view_get_ring_pos(v, r->read_pos + available_at_end)],
-                remaining);
+                remaining, bulk);
         } else {
-            memcpy(data_bytes + i * step_size,
+            ring_buffer_copy_out(data_bytes + i * step_size,
                    &v->buf[ring_buffer_view_get_ring_pos(v, r->read_pos)],
-                   step_size);
+                   step_size, bulk);
         }
         __atomic_add_fetch(&r->read_pos, step_size, __ATOMIC_SEQ_CST);
     }
 
+    if (steps) {
+        ring_buffer_notify_writers(r);
+    }
     errno = 0;
     return (long)steps;
 }
 
+static void ring_buffer_view_get_spans(
+    const struct ring_buffer_view* v,
+    uint32_t index,
+    uint32_t bytes,
+    struct ring_buffer_span* span1,
+    struct ring_buffer_span* span2) {
+    uint32_t pos = ring_buffer_view_get_ring_pos(v, index);
+    uint32_t available_at_end = v->size - pos;
+
+    span1->data = &v->buf[pos];
+    span2->data = v->buf;
+
+    if (v->mirrored || bytes <= available_at_end) {
+        span1->size = bytes;
+        span2->size = 0;
+    } else {
+        span1->size = available_at_end;
+        span2->size = bytes - available_at_end;
+    }
+}
+
+int ring_buffer_view_reserve_write(
+    const struct ring_buffer* r,
+    const struct ring_buffer_view* v,
+    uint32_t bytes,
+    struct ring_buffer_span* span1,
+    struct ring_buffer_span* span2) {
+    if (!ring_buffer_view_can_write(r, v, bytes)) {
+        errno = -EAGAIN;
+        return -1;
+    }
+    ring_buffer_view_get_spans(v, r->write_pos, bytes, span1, span2);
+    errno = 0;
+    return 0;
+}
+
+void ring_buffer_view_commit_write(
+    struct ring_buffer* r,
+    const struct ring_buffer_view* v,
+    uint32_t bytes) {
+    (void)v;
+    __atomic_add_fetch(&r->write_pos, bytes, __ATOMIC_SEQ_CST);
+    ring_buffer_notify_readers(r);
+}
+
+int ring_buffer_view_peek_read(
+    const struct ring_buffer* r,
+    const struct ring_buffer_view* v,
+    uint32_t bytes,
+    struct ring_buffer_span* span1,
+    struct ring_buffer_span* span2) {
+    if (!ring_buffer_view_can_read(r, v, bytes)) {
+        errno = -EAGAIN;
+        return -1;
+    }
+    ring_buffer_view_get_spans(v, r->read_pos, bytes, span1, span2);
+    errno = 0;
+    return 0;
+}
+
+void ring_buffer_view_consume_read(
+    struct ring_buffer* r,
+    const struct ring_buffer_view* v,
+    uint32_t bytes) {
+    (void)v;
+    __atomic_add_fetch(&r->read_pos, bytes, __ATOMIC_SEQ_CST);
+    ring_buffer_notify_writers(r);
+}
+
+static uint32_t ring_buffer_record_footprint(uint32_t bytes) {
+    return RING_BUFFER_RECORD_HEADER_SIZE + ((bytes + 3) & ~3u);
+}
+
+uint32_t ring_buffer_view_max_record(const struct ring_buffer_view* v) {
+    // The ring holds at most size - 1 bytes, so size - 4 in whole records.
+    if (v->mirrored) {
+        return v->size - 2 * RING_BUFFER_RECORD_HEADER_SIZE;
+    }
+    return v->size / 2 - RING_BUFFER_RECORD_HEADER_SIZE;
+}
+
+int ring_buffer_view_write_record(
+    struct ring_buffer* r,
+    struct ring_buffer_view* v,
+    const void* data,
+    uint32_t bytes) {
+    if (bytes > ring_buffer_view_max_record(v)) {
+        errno = -EMSGSIZE;
+        return -1;
+    }
+
+    uint32_t footprint = ring_buffer_record_footprint(bytes);
+    uint32_t pos = ring_buffer_view_get_ring_pos(v, r->write_pos);
+    uint32_t pad = 0;
+    if (!v->mirrored && footprint > v->size - pos) {
+        pad = v->size - pos;
+    }
+    if (!ring_buffer_view_can_write(r, v, pad + footprint)) {
+        errno = -EAGAIN;
+        return -1;
+    }
+
+    uint32_t header;
+    if (pad) {
+        header = RING_BUFFER_RECORD_PAD | (pad - RING_BUFFER_RECORD_HEADER_SIZE);
+        memcpy(&v->buf[pos], &header, sizeof(header));
+        pos = 0;
+    }
+    header = bytes;
+    memcpy(&v->buf[pos], &header, sizeof(header));
+    memcpy(&v->buf[pos + RING_BUFFER_RECORD_HEADER_SIZE], data, bytes);
+
+    ring_buffer_view_commit_write(r, v, pad + footprint);
+    errno = 0;
+    return 0;
+}
+
+// Looks for a record |index| bytes into the ring with |available| readable
+// from there. Sets |skip| to the padding before it and |bytes| to its size.
+static int ring_buffer_view_find_record(
+    const struct ring_buffer_view* v,
+    uint32_t index,
+    uint32_t available,
+    uint32_t* skip,
+    uint32_t* bytes) {
+    uint32_t header;
+    *skip = 0;
+    if (available < RING_BUFFER_RECORD_HEADER_SIZE) {
+        errno = -EAGAIN;
+        return -1;
+    }
+    memcpy(&header, &v->buf[ring_buffer_view_get_ring_pos(v, index)], sizeof(header));
+    if (header & RING_BUFFER_RECORD_PAD) {
+        // Padding is published together with the record after it.
+        *skip = RING_BUFFER_RECORD_HEADER_SIZE + (header & ~RING_BUFFER_RECORD_PAD);
+        if (available < *skip + RING_BUFFER_RECORD_HEADER_SIZE) {
+            errno = -EAGAIN;
+            return -1;
+        }
+        memcpy(&header, &v->buf[ring_buffer_view_get_ring_pos(v, index + *skip)],
+               sizeof(header));
+    }
+    if (available < *skip + ring_buffer_record_footprint(header)) {
+        errno = -EAGAIN;
+        return -1;
+    }
+    *bytes = header;
+    return 0;
+}
+
+int ring_buffer_view_peek_record_size(
+    const struct ring_buffer* r,
+    const struct ring_buffer_view* v,
+    uint32_t* bytes) {
+    uint32_t skip;
+    if (ring_buffer_view_find_record(
+            v, r->read_pos, ring_buffer_available_read(r, v), &skip, bytes)) {
+        return -1;
+    }
+    errno = 0;
+    return 0;
+}
+
+int ring_buffer_view_read_record(
+    struct ring_buffer* r,
+    struct ring_buffer_view* v,
+    void* data,
+    uint32_t capacity,
+    uint32_t* bytes) {
+    return ring_buffer_view_read_records(r, v, data, capacity, bytes, 1) == 1 ? 0 : -1;
+}
+
+long ring_buffer_view_read_records(
+    struct ring_buffer* r,
+    struct ring_buffer_view* v,
+    void* data,
+    uint32_t capacity,
+    uint32_t* sizes,
+    uint32_t max_records) {
+    uint8_t* out = (uint8_t*)data;
+    uint32_t available = ring_buffer_available_read(r, v);
+    uint32_t consumed = 0;
+    uint32_t copied = 0;
+    uint32_t n = 0;
+
+    while (n < max_records) {
+        uint32_t skip;
+        uint32_t bytes;
+        if (ring_buffer_view_find_record(
+                v, r->read_pos + consumed, available - consumed, &skip, &bytes)) {
+            break;
+        }
+        if (bytes > capacity - copied) {
+            if (!n) {
+                sizes[0] = bytes;
+                errno = -EMSGSIZE;
+            }
+            break;
+        }
+        uint32_t pos = ring_buffer_view_get_ring_pos(
+                v, r->read_pos + consumed + skip + RING_BUFFER_RECORD_HEADER_SIZE);
+        memcpy(out + copied, &v->buf[pos], bytes);
+        sizes[n++] = bytes;
+        copied += bytes;
+        consumed += skip + ring_buffer_record_footprint(bytes);
+    }
+
+    if (n) {
+        ring_buffer_view_consume_read(r, v, consumed);
+        errno = 0;
+    }
+    return (long)n;
+}
+
 void ring_buffer_yield() {
 #ifdef _WIN32
     _mm_pause();
@@ -403,107 +947,175 @@ void ring_buffer_yield() {
 #endif
 }
 
-static void ring_buffer_sleep() {
+static void ring_buffer_sleep(uint32_t us) {
 #ifdef _WIN32
-    Sleep(2);
+    Sleep(us / 1000 ? us / 1000 : 1);
+#else
+    usleep(us);
+#endif
+}
+
+// Parks the calling thread until |*addr| no longer holds |expected|, someone
+// wakes the address, or |timeout_us| elapses, whichever comes first. Spurious
+// returns are fine; callers always re-check the ring.
+static void ring_buffer_park(uint32_t* addr, uint32_t expected,
+                             uint32_t timeout_us) {
+#if defined(__linux__)
+    struct timespec ts;
+    ts.tv_sec = timeout_us / 1000000;
+    ts.tv_nsec = (timeout_us % 1000000) * 1000;
+    syscall(SYS_futex, addr, FUTEX_WAIT, expected, &ts, NULL, 0);
+#elif defined(_WIN32)
+    WaitOnAddress(addr, &expected, sizeof(expected),
+                  timeout_us / 1000 ? timeout_us / 1000 : 1);
+#elif defined(__APPLE__)
+    __ulock_wait(RING_BUFFER_UL_COMPARE_AND_WAIT, addr, expected, timeout_us);
 #else
-    usleep(2000);
+    (void)addr;
+    (void)expected;
+    ring_buffer_sleep(timeout_us);
 #endif
 }
 
 static uint64_t ring_buffer_curr_us() {
-    uint64_t res;
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    res = tv.tv_sec * 1000000ULL + tv.tv_usec;
-    return res;
+    return android::base::FastClock::nowUs();
 }
 
+// Bounds for the adaptive spin budget. The budget starts at the maximum, which
+// matches the fixed spin window used before it became adaptive.
+static const uint32_t min_spin_us = 4;
+static const uint32_t max_spin_us = 1000;
+// How long to keep yielding after the spin budget runs out before sleeping.
 static const uint32_t yield_backoff_us = 1000;
-static const uint32_t sleep_backoff_us = 2000;
 
-bool ring_buffer_wait_write(
+static bool ring_buffer_ready(
     const struct ring_buffer* r,
     const struct ring_buffer_view* v,
     uint32_t bytes,
-    uint64_t timeout_us) {
-
-    uint64_t start_us = ring_buffer_curr_us();
-    uint64_t curr_wait_us;
-
-    bool can_write =
-        v ? ring_buffer_view_can_write(r, v, bytes) :
-            ring_buffer_can_write(r, bytes);
-
-    while (!can_write) {
-#ifdef __x86_64
-        _mm_pause();
-#endif
-        curr_wait_us = ring_buffer_curr_us() - start_us;
+    bool for_read) {
+    if (for_read) {
+        return v ? ring_buffer_view_can_read(r, v, bytes) :
+                   ring_buffer_can_read(r, bytes);
+    }
+    return v ? ring_buffer_view_can_write(r, v, bytes) :
+               ring_buffer_can_write(r, bytes);
+}
 
-        if (curr_wait_us > yield_backoff_us) {
-            ring_buffer_yield();
-        }
+// Moves the spin budget towards twice the wait we just observed if spinning
+// would have caught it, and shrinks it otherwise. Only the waiting side
+// touches its own budget, so plain loads and stores are enough.
+static void ring_buffer_update_spin(uint32_t* spin_us, uint64_t waited_us) {
+    int64_t budget = *spin_us;
+    if (waited_us <= max_spin_us) {
+        budget += ((int64_t)waited_us * 2 - budget) / 4;
+    } else {
+        budget -= budget / 4;
+    }
+    if (budget < min_spin_us) budget = min_spin_us;
+    if (budget > max_spin_us) budget = max_spin_us;
+    *spin_us = (uint32_t)budget;
+}
 
-        if (curr_wait_us > sleep_backoff_us) {
-            ring_buffer_sleep();
-        }
+static bool ring_buffer_wait(
+    struct ring_buffer* r,
+    const struct ring_buffer_view* v,
+    uint32_t bytes,
+    uint64_t timeout_us,
+    bool for_read) {
 
-        if (curr_wait_us > timeout_us) {
-            return false;
+    if (ring_buffer_ready(r, v, bytes, for_read)) {
+        if (for_read) {
+            r->read_live_count++;
         }
-
-        can_write =
-            v ? ring_buffer_view_can_write(r, v, bytes) :
-                ring_buffer_can_write(r, bytes);
+        return true;
     }
 
-    return true;
-}
+    uint32_t* spin_us = for_read ? &r->read_spin_us : &r->write_spin_us;
+    uint32_t* waiters = for_read ? &r->read_waiters : &r->write_waiters;
+    // The position the other side advances to make the ring available.
+    uint32_t* other_pos = for_read ? &r->write_pos : &r->read_pos;
 
-bool ring_buffer_wait_read(
-    const struct ring_buffer* r,
-    const struct ring_buffer_view* v,
-    uint32_t bytes,
-    uint64_t timeout_us) {
+    if (*spin_us < min_spin_us || *spin_us > max_spin_us) {
+        *spin_us = max_spin_us;
+    }
 
+    bool blocking = __atomic_load_n(&r->wait_mode, __ATOMIC_SEQ_CST) ==
+                    RING_BUFFER_WAIT_BLOCKING;
+    uint64_t spin_budget_us = *spin_us;
     uint64_t start_us = ring_buffer_curr_us();
-    uint64_t curr_wait_us;
+    uint64_t curr_wait_us = 0;
+    bool slept = false;
 
-    bool can_read =
-        v ? ring_buffer_view_can_read(r, v, bytes) :
-            ring_buffer_can_read(r, bytes);
+    do {
+        if (curr_wait_us > timeout_us) {
+            return false;
+        }
 
-    while (!can_read) {
-        // TODO(bohu): find aarch64 equivalent
+        if (curr_wait_us < spin_budget_us) {
 #ifdef __x86_64
-        _mm_pause();
+            _mm_pause();
+#elif defined(__aarch64__)
+            __asm__ __volatile__("yield");
 #endif
-        curr_wait_us = ring_buffer_curr_us() - start_us;
-
-        if (curr_wait_us > yield_backoff_us) {
+        } else if (curr_wait_us < spin_budget_us + yield_backoff_us) {
             ring_buffer_yield();
-            ((struct ring_buffer*)r)->read_yield_count++;
-        }
-
-        if (curr_wait_us > sleep_backoff_us) {
-            ring_buffer_sleep();
-            ((struct ring_buffer*)r)->read_sleep_us_count += 2000;
+            if (for_read) {
+                r->read_yield_count++;
+            }
+        } else {
+            uint64_t remaining_us = timeout_us - curr_wait_us;
+            uint32_t park_us = remaining_us < RING_BUFFER_MAX_PARK_US ?
+                (uint32_t)remaining_us + 1 : RING_BUFFER_MAX_PARK_US;
+            uint64_t park_start_us = ring_buffer_curr_us();
+
+            if (blocking) {
+                // Register before re-checking so that the other side either
+                // sees us and wakes us up, or we see its update and don't park.
+                __atomic_add_fetch(waiters, 1, __ATOMIC_SEQ_CST);
+                uint32_t observed = __atomic_load_n(other_pos, __ATOMIC_SEQ_CST);
+                if (!ring_buffer_ready(r, v, bytes, for_read)) {
+                    ring_buffer_park(other_pos, observed, park_us);
+                }
+                __atomic_sub_fetch(waiters, 1, __ATOMIC_SEQ_CST);
+            } else {
+                ring_buffer_sleep(park_us);
+            }
+
+            slept = true;
+            if (for_read) {
+                r->read_sleep_us_count +=
+                    (uint32_t)(ring_buffer_curr_us() - park_start_us);
+            }
         }
 
-        if (curr_wait_us > timeout_us) {
-            return false;
-        }
+        curr_wait_us = ring_buffer_curr_us() - start_us;
+    } while (!ring_buffer_ready(r, v, bytes, for_read));
 
-        can_read =
-            v ? ring_buffer_view_can_read(r, v, bytes) :
-                ring_buffer_can_read(r, bytes);
+    ring_buffer_update_spin(spin_us, curr_wait_us);
+    if (for_read && !slept) {
+        r->read_live_count++;
     }
-
-    ((struct ring_buffer*)r)->read_live_count++;
     return true;
 }
 
+bool ring_buffer_wait_write(
+    const struct ring_buffer* r,
+    const struct ring_buffer_view* v,
+    uint32_t bytes,
+    uint64_t timeout_us) {
+    return ring_buffer_wait((struct ring_buffer*)r, v, bytes, timeout_us,
+                            false /* for_read */);
+}
+
+bool ring_buffer_wait_read(
+    const struct ring_buffer* r,
+    const struct ring_buffer_view* v,
+    uint32_t bytes,
+    uint64_t timeout_us) {
+    return ring_buffer_wait((struct ring_buffer*)r, v, bytes, timeout_us,
+                            true /* for_read */);
+}
+
 static uint32_t get_step_size(
     struct ring_buffer* r,
     struct ring_buffer_view* v,
@@ -669,3 +1281,177 @@ void ring_buffer_consumer_wait_producer_idle(struct ring_buffer* r) {
 void ring_buffer_consumer_hung_up(struct ring_buffer* r) {
     __atomic_store_n(&r->state, RING_BUFFER_SYNC_CONSUMER_HUNG_UP, __ATOMIC_SEQ_CST);
 }
+
+bool ring_buffer_mpsc_init(
+    struct ring_buffer_mpsc* m,
+    uint8_t* buf,
+    uint32_t size,
+    uint32_t slot_size) {
+
+    ring_buffer_view_init(&m->ring, &m->view, buf, size);
+    if (!slot_size || (slot_size & (slot_size - 1)) ||
+        slot_size > (m->view.size >> 2)) {
+        m->commits = NULL;
+        return false;
+    }
+
+    m->slot_shift = ring_buffer_calc_shift(slot_size);
+    m->commits = (uint64_t*)calloc(m->view.size >> m->slot_shift, sizeof(uint64_t));
+    m->reserve_pos = 0;
+    return m->commits != NULL;
+}
+
+void ring_buffer_mpsc_destroy(struct ring_buffer_mpsc* m) {
+    free(m->commits);
+    m->commits = NULL;
+}
+
+int ring_buffer_mpsc_reserve(
+    struct ring_buffer_mpsc* m,
+    uint32_t slots,
+    uint32_t* pos,
+    struct ring_buffer_span* span1,
+    struct ring_buffer_span* span2) {
+    uint32_t bytes = slots << m->slot_shift;
+    if (!slots || bytes >= m->view.size) {
+        errno = -EINVAL;
+        return -1;
+    }
+
+    uint32_t claim = __atomic_load_n(&m->reserve_pos, __ATOMIC_SEQ_CST);
+    do {
+        uint32_t read_view = __atomic_load_n(&m->ring.read_pos, __ATOMIC_SEQ_CST);
+        if (ring_buffer_view_get_ring_pos(&m->view, read_view - claim - 1) < bytes) {
+            errno = -EAGAIN;
+            return -1;
+        }
+    } while (!__atomic_compare_exchange_n(&m->reserve_pos, &claim, claim + bytes,
+                                          true /* weak */, __ATOMIC_SEQ_CST,
+                                          __ATOMIC_SEQ_CST));
+
+    *pos = claim;
+    ring_buffer_view_get_spans(&m->view, claim, bytes, span1, span2);
+    errno = 0;
+    return 0;
+}
+
+void ring_buffer_mpsc_commit(
+    struct ring_buffer_mpsc* m,
+    uint32_t pos,
+    uint32_t slots) {
+    uint32_t bytes = slots << m->slot_shift;
+    __atomic_store_n(
+        &m->commits[ring_buffer_view_get_ring_pos(&m->view, pos) >> m->slot_shift],
+        ((uint64_t)pos << 32) | bytes, __ATOMIC_SEQ_CST);
+
+    // Publish from write_pos for as long as the claims there are committed.
+    // Whoever moves write_pos next to a claim that is being committed
+    // concurrently either sees its flag, or its owner sees the new
+    // write_pos here.
+    bool published = false;
+    for (;;) {
+        uint32_t write_view = __atomic_load_n(&m->ring.write_pos, __ATOMIC_SEQ_CST);
+        uint64_t* commit = &m->commits[
+            ring_buffer_view_get_ring_pos(&m->view, write_view) >> m->slot_shift];
+        uint64_t committed = __atomic_load_n(commit, __ATOMIC_SEQ_CST);
+        if (!committed || (uint32_t)(committed >> 32) != write_view) {
+            break;
+        }
+        if (!__atomic_compare_exchange_n(commit, &committed, 0, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            continue;
+        }
+        __atomic_store_n(&m->ring.write_pos, write_view + (uint32_t)committed,
+                         __ATOMIC_SEQ_CST);
+        published = true;
+    }
+
+    if (published) {
+        ring_buffer_notify_readers(&m->ring);
+    }
+}
+
+bool ring_buffer_mpsc_write(
+    struct ring_buffer_mpsc* m,
+    const void* data,
+    uint32_t slots,
+    uint64_t timeout_us) {
+    uint32_t bytes = slots << m->slot_shift;
+    uint64_t start_us = ring_buffer_curr_us();
+    uint32_t pos;
+    struct ring_buffer_span span1, span2;
+
+    while (ring_buffer_mpsc_reserve(m, slots, &pos, &span1, &span2)) {
+        if (errno != -EAGAIN) {
+            return false;
+        }
+        uint64_t waited_us = ring_buffer_curr_us() - start_us;
+        if (waited_us > timeout_us) {
+            return false;
+        }
+        // Room is measured from write_pos there, so other producers' claims
+        // may still be in the way once it returns.
+        if (!ring_buffer_wait_write(&m->ring, &m->view, bytes,
+                                    timeout_us - waited_us)) {
+            return false;
+        }
+        if (ring_buffer_view_get_ring_pos(
+                &m->view,
+                __atomic_load_n(&m->ring.read_pos, __ATOMIC_SEQ_CST) -
+                    __atomic_load_n(&m->reserve_pos, __ATOMIC_SEQ_CST) - 1) < bytes) {
+            ring_buffer_yield();
+        }
+    }
+
+    memcpy(span1.data, data, span1.size);
+    if (span2.size) {
+        memcpy(span2.data, (const uint8_t*)data + span1.size, span2.size);
+    }
+    ring_buffer_mpsc_commit(m, pos, slots);
+    return true;
+}
+
+// Producers share RING_BUFFER_SYNC_PRODUCER_ACTIVE, counted in the bits
+// above it, so |state| only goes back to idle with the last of them and the
+// consumer side works unchanged.
+#define RING_BUFFER_MPSC_PRODUCER_SHIFT 8
+#define RING_BUFFER_MPSC_ONE_PRODUCER (1u << RING_BUFFER_MPSC_PRODUCER_SHIFT)
+#define RING_BUFFER_MPSC_STATE_MASK (RING_BUFFER_MPSC_ONE_PRODUCER - 1)
+
+static bool ring_buffer_mpsc_join(struct ring_buffer_mpsc* m, uint32_t from) {
+    uint32_t state = __atomic_load_n(&m->ring.state, __ATOMIC_SEQ_CST);
+    for (;;) {
+        uint32_t next;
+        if (state == from) {
+            next = RING_BUFFER_SYNC_PRODUCER_ACTIVE | RING_BUFFER_MPSC_ONE_PRODUCER;
+        } else if ((state & RING_BUFFER_MPSC_STATE_MASK) ==
+                   RING_BUFFER_SYNC_PRODUCER_ACTIVE) {
+            next = state + RING_BUFFER_MPSC_ONE_PRODUCER;
+        } else {
+            return false;
+        }
+        if (__atomic_compare_exchange_n(&m->ring.state, &state, next, false,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            return true;
+        }
+    }
+}
+
+bool ring_buffer_mpsc_producer_acquire(struct ring_buffer_mpsc* m) {
+    return ring_buffer_mpsc_join(m, RING_BUFFER_SYNC_PRODUCER_IDLE);
+}
+
+bool ring_buffer_mpsc_producer_acquire_from_hangup(struct ring_buffer_mpsc* m) {
+    return ring_buffer_mpsc_join(m, RING_BUFFER_SYNC_CONSUMER_HUNG_UP);
+}
+
+void ring_buffer_mpsc_producer_idle(struct ring_buffer_mpsc* m) {
+    uint32_t state = __atomic_load_n(&m->ring.state, __ATOMIC_SEQ_CST);
+    uint32_t next;
+    do {
+        next = (state >> RING_BUFFER_MPSC_PRODUCER_SHIFT) > 1 ?
+            state - RING_BUFFER_MPSC_ONE_PRODUCER :
+            (uint32_t)RING_BUFFER_SYNC_PRODUCER_IDLE;
+    } while (!__atomic_compare_exchange_n(&m->ring.state, &state, next, false,
+                                          __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+}
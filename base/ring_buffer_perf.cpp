@@ -0,0 +1,235 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/ring_buffer.h"
+#include "aemu/base/threads/FunctorThread.h"
+
+#include "benchmark/benchmark.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// One producer and one consumer on the same thread: the cost of the copies and
+// index updates alone.
+void BM_RingBuffer_WriteRead(benchmark::State& state) {
+    const uint32_t size = uint32_t(state.range(0));
+    std::vector<uint8_t> src(size, 1);
+    std::vector<uint8_t> dst(size);
+    ring_buffer r;
+    ring_buffer_init(&r);
+    for (auto _ : state) {
+        ring_buffer_write(&r, src.data(), size, 1);
+        ring_buffer_read(&r, dst.data(), size, 1);
+        benchmark::DoNotOptimize(dst.data());
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * size);
+}
+BENCHMARK(BM_RingBuffer_WriteRead)->RangeMultiplier(4)->Range(4, 1024);
+
+void BM_RingBuffer_ViewWriteRead(benchmark::State& state) {
+    const uint32_t size = uint32_t(state.range(0));
+    std::vector<uint8_t> src(size, 1);
+    std::vector<uint8_t> dst(size);
+    std::vector<uint8_t> buf(64 * 1024);
+    ring_buffer r;
+    ring_buffer_view v;
+    ring_buffer_view_init(&r, &v, buf.data(), uint32_t(buf.size()));
+    for (auto _ : state) {
+        ring_buffer_view_write(&r, &v, src.data(), size, 1);
+        ring_buffer_view_read(&r, &v, dst.data(), size, 1);
+        benchmark::DoNotOptimize(dst.data());
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * size);
+}
+BENCHMARK(BM_RingBuffer_ViewWriteRead)->RangeMultiplier(8)->Range(8, 32 * 1024);
+
+// A wait that is already satisfied, which is what a busy consumer sees.
+// Variable-length messages framed by hand, a size then the payload, as two
+// writes and two reads...
+void BM_RingBuffer_SizeThenPayload(benchmark::State& state) {
+    const uint32_t size = uint32_t(state.range(0));
+    std::vector<uint8_t> src(size, 1);
+    std::vector<uint8_t> dst(size);
+    std::vector<uint8_t> buf(64 * 1024);
+    ring_buffer r;
+    ring_buffer_view v;
+    ring_buffer_view_init(&r, &v, buf.data(), uint32_t(buf.size()));
+    for (auto _ : state) {
+        uint32_t header = size;
+        ring_buffer_view_write(&r, &v, &header, sizeof(header), 1);
+        ring_buffer_view_write(&r, &v, src.data(), size, 1);
+        ring_buffer_view_read(&r, &v, &header, sizeof(header), 1);
+        ring_buffer_view_read(&r, &v, dst.data(), header, 1);
+        benchmark::DoNotOptimize(dst.data());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+BENCHMARK(BM_RingBuffer_SizeThenPayload)->Arg(16)->Arg(256)->Arg(4096);
+
+// ...and as records.
+void BM_RingBuffer_Record(benchmark::State& state) {
+    const uint32_t size = uint32_t(state.range(0));
+    std::vector<uint8_t> src(size, 1);
+    std::vector<uint8_t> dst(size);
+    std::vector<uint8_t> buf(64 * 1024);
+    ring_buffer r;
+    ring_buffer_view v;
+    ring_buffer_view_init(&r, &v, buf.data(), uint32_t(buf.size()));
+    for (auto _ : state) {
+        uint32_t got;
+        ring_buffer_view_write_record(&r, &v, src.data(), size);
+        ring_buffer_view_read_record(&r, &v, dst.data(), size, &got);
+        benchmark::DoNotOptimize(dst.data());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+BENCHMARK(BM_RingBuffer_Record)->Arg(16)->Arg(256)->Arg(4096);
+
+void BM_RingBuffer_WaitReadReady(benchmark::State& state) {
+    ring_buffer r;
+    ring_buffer_init(&r);
+    const uint8_t byte = 0;
+    ring_buffer_write(&r, &byte, 1, 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ring_buffer_wait_read(&r, nullptr, 1, 0));
+    }
+}
+BENCHMARK(BM_RingBuffer_WaitReadReady);
+
+// A producer thread streaming to a blocking consumer.
+void BM_RingBuffer_ProducerConsumer(benchmark::State& state) {
+    const uint32_t chunk = uint32_t(state.range(0));
+    constexpr uint32_t kChunks = 256;
+    std::vector<uint8_t> src(chunk * kChunks, 1);
+    std::vector<uint8_t> dst(src.size());
+    std::vector<uint8_t> buf(64 * 1024);
+    ring_buffer r;
+    ring_buffer_view v;
+    ring_buffer_view_init(&r, &v, buf.data(), uint32_t(buf.size()));
+    for (auto _ : state) {
+        android::base::FunctorThread producer([&]() {
+            for (uint32_t i = 0; i < kChunks; ++i) {
+                ring_buffer_write_fully(&r, &v, src.data() + i * chunk, chunk);
+            }
+        });
+        producer.start();
+        ring_buffer_read_fully(&r, &v, dst.data(), uint32_t(dst.size()));
+        producer.wait();
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * src.size());
+}
+BENCHMARK(BM_RingBuffer_ProducerConsumer)->Arg(256)->Arg(4096)->UseRealTime();
+
+// Several producers feeding one consumer 64-byte records: first through a
+// single-producer ring behind a mutex, then through the multi-producer ring.
+constexpr uint32_t kFanInRecord = 64;
+constexpr uint32_t kFanInRecords = 4096;
+
+void BM_RingBuffer_MutexFanIn(benchmark::State& state) {
+    const uint32_t producers = uint32_t(state.range(0));
+    std::vector<uint8_t> src(kFanInRecord, 1);
+    std::vector<uint8_t> dst(kFanInRecord);
+    std::vector<uint8_t> buf(64 * 1024);
+    ring_buffer r;
+    ring_buffer_view v;
+    ring_buffer_view_init(&r, &v, buf.data(), uint32_t(buf.size()));
+    std::mutex lock;
+    for (auto _ : state) {
+        std::vector<std::unique_ptr<android::base::FunctorThread>> threads;
+        for (uint32_t p = 0; p < producers; ++p) {
+            threads.emplace_back(new android::base::FunctorThread([&]() {
+                for (uint32_t i = 0; i < kFanInRecords;) {
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        if (ring_buffer_view_write(&r, &v, src.data(), kFanInRecord, 1)) {
+                            ++i;
+                            continue;
+                        }
+                    }
+                    ring_buffer_wait_write(&r, &v, kFanInRecord, UINT64_MAX);
+                }
+            }));
+            threads.back()->start();
+        }
+        for (uint32_t i = 0; i < producers * kFanInRecords; ++i) {
+            ring_buffer_read_fully(&r, &v, dst.data(), kFanInRecord);
+        }
+        for (auto& thread : threads) {
+            thread->wait();
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * producers * kFanInRecords);
+}
+BENCHMARK(BM_RingBuffer_MutexFanIn)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+void BM_RingBuffer_MpscFanIn(benchmark::State& state) {
+    const uint32_t producers = uint32_t(state.range(0));
+    std::vector<uint8_t> src(kFanInRecord, 1);
+    std::vector<uint8_t> dst(kFanInRecord);
+    std::vector<uint8_t> buf(64 * 1024);
+    ring_buffer_mpsc m;
+    ring_buffer_mpsc_init(&m, buf.data(), uint32_t(buf.size()), kFanInRecord);
+    for (auto _ : state) {
+        std::vector<std::unique_ptr<android::base::FunctorThread>> threads;
+        for (uint32_t p = 0; p < producers; ++p) {
+            threads.emplace_back(new android::base::FunctorThread([&]() {
+                for (uint32_t i = 0; i < kFanInRecords; ++i) {
+                    ring_buffer_mpsc_write(&m, src.data(), 1, UINT64_MAX);
+                }
+            }));
+            threads.back()->start();
+        }
+        for (uint32_t i = 0; i < producers * kFanInRecords; ++i) {
+            ring_buffer_read_fully(&m.ring, &m.view, dst.data(), kFanInRecord);
+        }
+        for (auto& thread : threads) {
+            thread->wait();
+        }
+    }
+    ring_buffer_mpsc_destroy(&m);
+    state.SetItemsProcessed(int64_t(state.iterations()) * producers * kFanInRecords);
+}
+BENCHMARK(BM_RingBuffer_MpscFanIn)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// Large transfers through a 16 MiB view, as a guest's big texture uploads
+// go through ASG, with bulk copies off (0) and on (1). The source is bigger
+// than the cache so every step comes from memory.
+void BM_RingBuffer_BulkTransfer(benchmark::State& state) {
+    const uint32_t step = uint32_t(state.range(0));
+    ring_buffer_set_bulk_copy_threshold(state.range(1) ? step : RING_BUFFER_BULK_COPY_OFF);
+    std::vector<uint8_t> src(64 << 20, 1);
+    std::vector<uint8_t> dst(step);
+    std::vector<uint8_t> buf(16 << 20);
+    ring_buffer r;
+    ring_buffer_view v;
+    ring_buffer_view_init(&r, &v, buf.data(), uint32_t(buf.size()));
+    size_t offset = 0;
+    for (auto _ : state) {
+        ring_buffer_view_write(&r, &v, src.data() + offset, step, 1);
+        ring_buffer_view_read(&r, &v, dst.data(), step, 1);
+        benchmark::DoNotOptimize(dst.data());
+        offset = (offset + step) % (src.size() - step);
+    }
+    ring_buffer_set_bulk_copy_threshold(RING_BUFFER_BULK_COPY_OFF);
+    state.SetBytesProcessed(int64_t(state.iterations()) * step);
+}
+BENCHMARK(BM_RingBuffer_BulkTransfer)
+        ->ArgNames({"step", "bulk"})
+        ->ArgsProduct({{256 << 10, 4 << 20}, {0, 1}});
+
+}  // namespace
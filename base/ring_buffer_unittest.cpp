@@ -18,7 +18,13 @@
 
 #include <gtest/gtest.h>
 
+#include <memory>
 #include <random>
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <string.h>
 
 #include <errno.h>
 #ifdef _MSC_VER
@@ -560,6 +566,261 @@ TEST(ring_buffer, SpeedTest) {
     fprintf(stderr, "%s: avg mb per sec: %f\n", __func__, mbPerSec);
 }
 
+// The ring is shared with the guest as-is, so its layout must not change.
+TEST(ring_buffer, Layout) {
+    EXPECT_EQ(8u, offsetof(ring_buffer, write_pos));
+    EXPECT_EQ(64u, offsetof(ring_buffer, read_pos));
+    EXPECT_EQ(128u, offsetof(ring_buffer, buf));
+}
+
+// Tests that a slow producer can wake up a consumer parked in blocking mode,
+// and that parked time is accounted for.
+TEST(ring_buffer, BlockingWaitProduceConsume) {
+    std::vector<uint8_t> elements(4096);
+    for (size_t i = 0; i < elements.size(); ++i) {
+        elements[i] = static_cast<uint8_t>(i);
+    }
+    std::vector<uint8_t> result(elements.size());
+    std::vector<uint8_t> buf(256, 0);
+
+    ring_buffer r;
+    ring_buffer_view v;
+    ring_buffer_view_init(&r, &v, buf.data(), buf.size());
+    ring_buffer_set_wait_mode(&r, RING_BUFFER_WAIT_BLOCKING);
+
+    FunctorThread producer([&r, &v, &elements]() {
+        for (size_t i = 0; i < elements.size(); i += 512) {
+            // Long enough for the consumer to exhaust its spin budget.
+            sleepMs(3);
+            ring_buffer_write_fully(&r, &v, elements.data() + i, 512);
+        }
+    });
+
+    FunctorThread consumer([&r, &v, &result]() {
+        ring_buffer_read_fully(&r, &v, result.data(), result.size());
+    });
+
+    producer.start();
+    consumer.start();
+    producer.wait();
+    consumer.wait();
+
+    EXPECT_EQ(elements, result);
+    EXPECT_GT(r.read_sleep_us_count, 0u);
+    EXPECT_EQ(0u, r.read_waiters);
+    EXPECT_EQ(0u, r.write_waiters);
+}
+
+TEST(ring_buffer, BlockingWaitTimesOut) {
+    std::vector<uint8_t> buf(16, 0);
+
+    ring_buffer r;
+    ring_buffer_view v;
+    ring_buffer_view_init(&r, &v, buf.data(), buf.size());
+    ring_buffer_set_wait_mode(&r, RING_BUFFER_WAIT_BLOCKING);
+
+    EXPECT_FALSE(ring_buffer_wait_read(&r, &v, 1, 5000));
+    EXPECT_TRUE(ring_buffer_wait_write(&r, &v, 1, 5000));
+    EXPECT_EQ(0u, r.read_waiters);
+}
+
+// Tests reserving/committing and peeking/consuming spans around the wrap
+// point without an intermediate buffer.
+TEST(ring_buffer, ReserveCommitPeekConsume) {
+    std::vector<uint8_t> buf(8, 0);
+
+    ring_buffer r;
+    ring_buffer_view v;
+    ring_buffer_view_init(&r, &v, buf.data(), buf.size());
+
+    ring_buffer_span span1;
+    ring_buffer_span span2;
+
+    EXPECT_EQ(-1, ring_buffer_view_reserve_write(&r, &v, 8, &span1, &span2));
+    EXPECT_EQ(-1, ring_buffer_view_peek_read(&r, &v, 1, &span1, &span2));
+
+    // Move the positions close to the end of the buffer.
+    EXPECT_EQ(0, ring_buffer_view_reserve_write(&r, &v, 6, &span1, &span2));
+    EXPECT_EQ(buf.data(), span1.data);
+    EXPECT_EQ(6u, span1.size);
+    EXPECT_EQ(0u, span2.size);
+    ring_buffer_view_commit_write(&r, &v, 6);
+    EXPECT_EQ(6u, ring_buffer_available_read(&r, &v));
+    ring_buffer_view_consume_read(&r, &v, 6);
+    EXPECT_EQ(0u, ring_buffer_available_read(&r, &v));
+
+    // Now a 5 byte reservation wraps around.
+    EXPECT_EQ(0, ring_buffer_view_reserve_write(&r, &v, 5, &span1, &span2));
+    EXPECT_EQ(buf.data() + 6, span1.data);
+    EXPECT_EQ(2u, span1.size);
+    EXPECT_EQ(buf.data(), span2.data);
+    EXPECT_EQ(3u, span2.size);
+    const uint8_t data[] = {1, 2, 3, 4, 5};
+    memcpy(span1.data, data, span1.size);
+    memcpy(span2.data, data + span1.size, span2.size);
+
+    // Nothing is visible before the commit.
+    EXPECT_EQ(-1, ring_buffer_view_peek_read(&r, &v, 1, &span1, &span2));
+    ring_buffer_view_commit_write(&r, &v, 5);
+
+    EXPECT_EQ(0, ring_buffer_view_peek_read(&r, &v, 5, &span1, &span2));
+    EXPECT_EQ(2u, span1.size);
+    EXPECT_EQ(3u, span2.size);
+    std::vector<uint8_t> got(span1.data, span1.data + span1.size);
+    got.insert(got.end(), span2.data, span2.data + span2.size);
+    EXPECT_EQ(std::vector<uint8_t>(data, data + 5), got);
+    ring_buffer_view_consume_read(&r, &v, 5);
+    EXPECT_EQ(0u, ring_buffer_available_read(&r, &v));
+}
+
+// Tests that a mirrored view always hands out a single span.
+TEST(ring_buffer, MirroredView) {
+    ring_buffer r;
+    ring_buffer_view v;
+    if (!ring_buffer_view_init_mirrored(&r, &v, 1)) {
+        GTEST_SKIP() << "Mirrored mappings are not supported here";
+    }
+    EXPECT_TRUE(v.mirrored);
+    // Writes through one mapping are visible through the other.
+    v.buf[0] = 0xab;
+    EXPECT_EQ(0xab, v.buf[v.size]);
+
+    ring_buffer_span span1;
+    ring_buffer_span span2;
+
+    const uint32_t offset = v.size - 4;
+    EXPECT_EQ(0, ring_buffer_view_reserve_write(&r, &v, offset, &span1, &span2));
+    ring_buffer_view_commit_write(&r, &v, offset);
+    ring_buffer_view_consume_read(&r, &v, offset);
+
+    EXPECT_EQ(0, ring_buffer_view_reserve_write(&r, &v, 16, &span1, &span2));
+    EXPECT_EQ(16u, span1.size);
+    EXPECT_EQ(0u, span2.size);
+    for (uint8_t i = 0; i < 16; ++i) {
+        span1.data[i] = i;
+    }
+    ring_buffer_view_commit_write(&r, &v, 16);
+
+    uint8_t out[16];
+    EXPECT_EQ(1, ring_buffer_view_read(&r, &v, out, sizeof(out), 1));
+    for (uint8_t i = 0; i < 16; ++i) {
+        EXPECT_EQ(i, out[i]);
+    }
+    // The wrapped part landed at the start of the buffer.
+    EXPECT_EQ(4, v.buf[0]);
+
+    ring_buffer_view_free_mirrored(&v);
+    EXPECT_EQ(nullptr, v.buf);
+}
+
+// Tests that bulk steps, copied with streaming stores, arrive intact at
+// every alignment and across the wrap.
+TEST(ring_buffer, BulkCopy) {
+    ring_buffer_set_bulk_copy_threshold(64);
+    std::vector<uint8_t> buf(64 * 1024);
+    std::vector<uint8_t> src(buf.size() / 2);
+    for (size_t i = 0; i < src.size(); ++i) {
+        src[i] = uint8_t(i * 13 + i / 251);
+    }
+    ring_buffer r;
+    ring_buffer_view v;
+    ring_buffer_view_init(&r, &v, buf.data(), uint32_t(buf.size()));
+    std::vector<uint8_t> dst(src.size());
+    for (uint32_t step : {64u, 100u, 4095u, 8193u, 32767u}) {
+        for (uint32_t skew = 0; skew < 64; skew += 7) {
+            const uint8_t* in = src.data() + skew;
+            const uint32_t size = step - skew;
+            ASSERT_EQ(1, ring_buffer_view_write(&r, &v, in, size, 1));
+            ASSERT_EQ(1, ring_buffer_view_read(&r, &v, dst.data(), size, 1));
+            ASSERT_EQ(0, memcmp(in, dst.data(), size)) << step << " " << skew;
+        }
+    }
+    ring_buffer_set_bulk_copy_threshold(RING_BUFFER_BULK_COPY_OFF);
+}
+
+// Tests that variable-length records come out whole and in order, padding
+// included, one at a time and in batches.
+TEST(ring_buffer, Records) {
+    std::vector<uint8_t> buf(1024);
+    ring_buffer r;
+    ring_buffer_view v;
+    ring_buffer_view_init(&r, &v, buf.data(), uint32_t(buf.size()));
+    EXPECT_EQ(508u, ring_buffer_view_max_record(&v));
+
+    std::vector<uint8_t> in(512);
+    for (size_t i = 0; i < in.size(); ++i) {
+        in[i] = uint8_t(i * 7);
+    }
+    std::vector<uint8_t> out(in.size());
+    uint32_t size = 0;
+    EXPECT_EQ(-1, ring_buffer_view_peek_record_size(&r, &v, &size));
+    EXPECT_EQ(-1, ring_buffer_view_write_record(&r, &v, in.data(), 509));
+    EXPECT_EQ(-EMSGSIZE, errno);
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint32_t> sizes(0, 300);
+    for (int round = 0; round < 200; ++round) {
+        const uint32_t a = sizes(gen);
+        const uint32_t b = sizes(gen);
+        ASSERT_EQ(0, ring_buffer_view_write_record(&r, &v, in.data(), a));
+        ASSERT_EQ(0, ring_buffer_view_write_record(&r, &v, in.data() + 1, b));
+
+        ASSERT_EQ(0, ring_buffer_view_peek_record_size(&r, &v, &size));
+        EXPECT_EQ(a, size);
+        if (a) {
+            EXPECT_EQ(-1, ring_buffer_view_read_record(&r, &v, out.data(), a - 1, &size));
+            EXPECT_EQ(-EMSGSIZE, errno);
+            EXPECT_EQ(a, size);
+        }
+        if (round % 2) {
+            ASSERT_EQ(0, ring_buffer_view_read_record(&r, &v, out.data(), out.size(), &size));
+            ASSERT_EQ(a, size);
+            EXPECT_EQ(0, memcmp(in.data(), out.data(), a));
+            ASSERT_EQ(0, ring_buffer_view_read_record(&r, &v, out.data(), out.size(), &size));
+            ASSERT_EQ(b, size);
+            EXPECT_EQ(0, memcmp(in.data() + 1, out.data(), b));
+        } else {
+            uint32_t both[2];
+            std::vector<uint8_t> batch(a + b);
+            ASSERT_EQ(2, ring_buffer_view_read_records(&r, &v, batch.data(),
+                                                       a + b, both, 2));
+            ASSERT_EQ(a, both[0]);
+            ASSERT_EQ(b, both[1]);
+            EXPECT_EQ(0, memcmp(in.data(), batch.data(), a));
+            EXPECT_EQ(0, memcmp(in.data() + 1, batch.data() + a, b));
+        }
+        EXPECT_EQ(0u, ring_buffer_available_read(&r, &v));
+    }
+}
+
+// Tests that a batch read stops at the first record that doesn't fit.
+TEST(ring_buffer, RecordsBatchCapacity) {
+    std::vector<uint8_t> buf(256);
+    ring_buffer r;
+    ring_buffer_view v;
+    ring_buffer_view_init(&r, &v, buf.data(), uint32_t(buf.size()));
+    const char text[] = "abcdefghij";
+    for (uint32_t n : {3u, 5u, 7u}) {
+        ASSERT_EQ(0, ring_buffer_view_write_record(&r, &v, text, n));
+    }
+    char out[10];
+    uint32_t sizes[3];
+    EXPECT_EQ(2, ring_buffer_view_read_records(&r, &v, out, sizeof(out), sizes, 3));
+    EXPECT_EQ(3u, sizes[0]);
+    EXPECT_EQ(5u, sizes[1]);
+    EXPECT_EQ(0, memcmp("abcabcde", out, 8));
+    EXPECT_EQ(1, ring_buffer_view_read_records(&r, &v, out, sizeof(out), sizes, 3));
+    EXPECT_EQ(7u, sizes[0]);
+    EXPECT_EQ(0, ring_buffer_view_read_records(&r, &v, out, sizeof(out), sizes, 3));
+    EXPECT_EQ(-EAGAIN, errno);
+
+    // Two of the largest don't fit at once, counting the padding.
+    const std::vector<char> big(ring_buffer_view_max_record(&v), 'x');
+    EXPECT_EQ(0, ring_buffer_view_write_record(&r, &v, big.data(), big.size()));
+    EXPECT_EQ(-1, ring_buffer_view_write_record(&r, &v, big.data(), big.size()));
+    EXPECT_EQ(-EAGAIN, errno);
+}
+
 // Tests copying out the contents available for read
 // without incrementing the read index.
 TEST(ring_buffer, CopyContents) {
@@ -624,5 +885,106 @@ TEST(ring_buffer, CopyContents) {
     EXPECT_TRUE(ring_buffer_view_can_write(&r, &v, 3));
 }
 
+// Tests that commits finishing out of order are published in claim order.
+TEST(ring_buffer, MpscOutOfOrderCommit) {
+    std::vector<uint8_t> buf(64, 0);
+    ring_buffer_mpsc m;
+    ASSERT_TRUE(ring_buffer_mpsc_init(&m, buf.data(), buf.size(), 8));
+
+    uint32_t first, second;
+    ring_buffer_span span1, span2;
+    ASSERT_EQ(0, ring_buffer_mpsc_reserve(&m, 1, &first, &span1, &span2));
+    memset(span1.data, 'a', span1.size);
+    ASSERT_EQ(0, ring_buffer_mpsc_reserve(&m, 2, &second, &span1, &span2));
+    memset(span1.data, 'b', span1.size);
+
+    ring_buffer_mpsc_commit(&m, second, 2);
+    EXPECT_EQ(0u, ring_buffer_available_read(&m.ring, &m.view));
+    ring_buffer_mpsc_commit(&m, first, 1);
+    EXPECT_EQ(24u, ring_buffer_available_read(&m.ring, &m.view));
+
+    char out[24];
+    EXPECT_EQ(1, ring_buffer_view_read(&m.ring, &m.view, out, sizeof(out), 1));
+    EXPECT_EQ(std::string(8, 'a') + std::string(16, 'b'),
+              std::string(out, sizeof(out)));
+
+    // A claim that can never fit, and one that doesn't fit for now.
+    EXPECT_EQ(-1, ring_buffer_mpsc_reserve(&m, 8, &first, &span1, &span2));
+    ASSERT_EQ(0, ring_buffer_mpsc_reserve(&m, 7, &first, &span1, &span2));
+    EXPECT_EQ(-1, ring_buffer_mpsc_reserve(&m, 1, &second, &span1, &span2));
+    EXPECT_EQ(-EAGAIN, errno);
+    ring_buffer_mpsc_destroy(&m);
+}
+
+// Tests that records from several producers all arrive, each producer's in
+// order, with the consumer and producers parking in blocking mode.
+TEST(ring_buffer, MpscProduceConsume) {
+    constexpr uint32_t kProducers = 4;
+    constexpr uint32_t kRecords = 5000;
+    struct Record {
+        uint32_t producer;
+        uint32_t seq;
+        uint32_t check;
+        uint32_t pad;
+    };
+    std::vector<uint8_t> buf(1024, 0);
+    ring_buffer_mpsc m;
+    ASSERT_TRUE(ring_buffer_mpsc_init(&m, buf.data(), buf.size(), sizeof(Record)));
+    ring_buffer_set_wait_mode(&m.ring, RING_BUFFER_WAIT_BLOCKING);
+
+    std::vector<std::unique_ptr<FunctorThread>> producers;
+    for (uint32_t p = 0; p < kProducers; ++p) {
+        producers.emplace_back(new FunctorThread([&m, p]() {
+            for (uint32_t i = 0; i < kRecords; ++i) {
+                Record record = {p, i, p * 31 + i, 0};
+                EXPECT_TRUE(ring_buffer_mpsc_write(&m, &record, 1, UINT64_MAX));
+            }
+        }));
+        producers.back()->start();
+    }
+
+    std::vector<uint32_t> next(kProducers, 0);
+    for (uint32_t i = 0; i < kProducers * kRecords; ++i) {
+        Record record;
+        ASSERT_TRUE(ring_buffer_wait_read(&m.ring, &m.view, sizeof(record), UINT64_MAX));
+        ASSERT_EQ(1, ring_buffer_view_read(&m.ring, &m.view, &record, sizeof(record), 1));
+        ASSERT_LT(record.producer, kProducers);
+        EXPECT_EQ(next[record.producer]++, record.seq);
+        EXPECT_EQ(record.producer * 31 + record.seq, record.check);
+    }
+    for (auto& producer : producers) {
+        producer->wait();
+    }
+    EXPECT_EQ(std::vector<uint32_t>(kProducers, kRecords), next);
+    EXPECT_EQ(0u, ring_buffer_available_read(&m.ring, &m.view));
+    ring_buffer_mpsc_destroy(&m);
+}
+
+// Tests that the consumer can only hang up once every producer is idle.
+TEST(ring_buffer, MpscSyncState) {
+    std::vector<uint8_t> buf(64, 0);
+    ring_buffer_mpsc m;
+    ASSERT_TRUE(ring_buffer_mpsc_init(&m, buf.data(), buf.size(), 8));
+    ring_buffer_sync_init(&m.ring);
+
+    EXPECT_TRUE(ring_buffer_mpsc_producer_acquire(&m));
+    EXPECT_TRUE(ring_buffer_mpsc_producer_acquire(&m));
+    EXPECT_FALSE(ring_buffer_consumer_hangup(&m.ring));
+    ring_buffer_mpsc_producer_idle(&m);
+    EXPECT_FALSE(ring_buffer_consumer_hangup(&m.ring));
+    ring_buffer_mpsc_producer_idle(&m);
+    EXPECT_TRUE(ring_buffer_consumer_hangup(&m.ring));
+
+    EXPECT_FALSE(ring_buffer_mpsc_producer_acquire(&m));
+    ring_buffer_consumer_hung_up(&m.ring);
+    EXPECT_FALSE(ring_buffer_mpsc_producer_acquire(&m));
+    EXPECT_TRUE(ring_buffer_mpsc_producer_acquire_from_hangup(&m));
+    EXPECT_TRUE(ring_buffer_mpsc_producer_acquire_from_hangup(&m));
+    ring_buffer_mpsc_producer_idle(&m);
+    ring_buffer_mpsc_producer_idle(&m);
+    EXPECT_EQ(uint32_t(RING_BUFFER_SYNC_PRODUCER_IDLE), m.ring.state);
+    ring_buffer_mpsc_destroy(&m);
+}
+
 } // namespace android
 } // namespace base
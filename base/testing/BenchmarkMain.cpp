@@ -0,0 +1,120 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// main() for aemu-base_benchmarks. Runs the benchmarks like BENCHMARK_MAIN(),
+// and if $AEMU_PERFLOGGER_DIR is set also logs each one's real and CPU time
+// per iteration, in picoseconds, to perflogger metrics in that directory.
+// Those keep the results of earlier runs, and a WindowDeviationAnalyzer
+// compares each run against them; the process fails if it flags any
+// benchmark as slower.
+
+#include "aemu/base/perflogger/Benchmark.h"
+#include "aemu/base/perflogger/Metric.h"
+#include "aemu/base/perflogger/WindowDeviationAnalyzer.h"
+#include "aemu/base/system/System.h"
+
+#include "benchmark/benchmark.h"
+
+#include <map>
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using android::perflogger::Analyzer;
+using android::perflogger::Metric;
+using android::perflogger::WindowDeviationAnalyzer;
+
+namespace {
+
+// Google Benchmark 1.8 replaced error_occurred with skipped.
+template <class Run>
+auto runFailed(const Run& run, int) -> decltype(bool(run.skipped)) {
+    return bool(run.skipped);
+}
+
+template <class Run>
+bool runFailed(const Run& run, long) {
+    return run.error_occurred;
+}
+
+class PerfloggerReporter : public benchmark::ConsoleReporter {
+public:
+    // Slower if the median of this run is more than 10% plus three median
+    // absolute deviations above the median of the previous 20.
+    PerfloggerReporter()
+        : mAnalyzer(Analyzer::Median,
+                    21,
+                    1,
+                    {},
+                    {{0.0, 0.1, 3.0}},
+                    Analyzer::IgnoreDecrease) {}
+
+    void ReportRuns(const std::vector<Run>& runs) override {
+        ConsoleReporter::ReportRuns(runs);
+        for (const Run& run : runs) {
+            if (run.run_type != Run::RT_Iteration || runFailed(run, 0)) {
+                continue;
+            }
+            const double toPs =
+                    1e12 / benchmark::GetTimeUnitMultiplier(run.time_unit);
+            android::perflogger::Benchmark& bench =
+                    benchmarkFor(run.benchmark_name());
+            bench.log("real_time_ps", long(run.GetAdjustedRealTime() * toPs),
+                      &mAnalyzer);
+            bench.log("cpu_time_ps", long(run.GetAdjustedCPUTime() * toPs),
+                      &mAnalyzer);
+        }
+    }
+
+private:
+    android::perflogger::Benchmark& benchmarkFor(const std::string& name) {
+        auto& bench = mBenchmarks[name];
+        if (!bench) {
+            bench.reset(new android::perflogger::Benchmark(
+                    name, "aemu", "aemu-base_benchmarks " + name, {}));
+        }
+        return *bench;
+    }
+
+    WindowDeviationAnalyzer mAnalyzer;
+    std::map<std::string,
+             std::unique_ptr<android::perflogger::Benchmark>>
+            mBenchmarks;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    if (android::base::getEnvironmentVariable("AEMU_PERFLOGGER_DIR").empty()) {
+        benchmark::RunSpecifiedBenchmarks();
+        benchmark::Shutdown();
+        return 0;
+    }
+
+    PerfloggerReporter reporter;
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+
+    const std::vector<std::string> regressions = Metric::commitAll();
+    for (const std::string& regression : regressions) {
+        fprintf(stderr, "Regression: %s\n", regression.c_str());
+    }
+    return regressions.empty() ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "aemu/base/testing/TraceReplay.h"
+
+#include "aemu/base/CpuTime.h"
+#include "aemu/base/StringFormat.h"
+
+#include <algorithm>
+#include <inttypes.h>
+
+namespace android {
+namespace base {
+
+namespace {
+
+constexpr uint32_t kTraceMagic = 0x41545243;  // "ATRC"
+constexpr uint32_t kTraceVersion = 1;
+
+// The smallest difference between two back-to-back counter reads.
+uint64_t cycleCounterOverhead() {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 256; ++i) {
+        const uint64_t start = readCycleCounter();
+        const uint64_t end = readCycleCounter();
+        best = std::min(best, end - start);
+    }
+    return best;
+}
+
+}  // namespace
+
+void Trace::add(uint64_t timeNs, uint32_t kind, const void* data,
+                size_t size) {
+    TraceEvent event;
+    event.timeNs = timeNs;
+    event.kind = kind;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    event.payload.assign(bytes, bytes + size);
+    mEvents.push_back(std::move(event));
+}
+
+void Trace::save(Stream* stream) const {
+    stream->putBe32(kTraceMagic);
+    stream->putBe32(kTraceVersion);
+    stream->putPackedNum(mEvents.size());
+    uint64_t lastNs = 0;
+    for (const TraceEvent& event : mEvents) {
+        stream->putPackedNum(event.timeNs - lastNs);
+        stream->putPackedNum(event.kind);
+        stream->putPackedNum(event.payload.size());
+        stream->write(event.payload.data(), event.payload.size());
+        lastNs = event.timeNs;
+    }
+}
+
+bool Trace::load(Stream* stream) {
+    mEvents.clear();
+    if (stream->getBe32() != kTraceMagic ||
+        stream->getBe32() != kTraceVersion) {
+        return false;
+    }
+    const uint64_t count = stream->getPackedNum();
+    uint64_t timeNs = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        TraceEvent event;
+        timeNs += stream->getPackedNum();
+        event.timeNs = timeNs;
+        event.kind = static_cast<uint32_t>(stream->getPackedNum());
+        event.payload.resize(stream->getPackedNum());
+        if (stream->read(event.payload.data(), event.payload.size()) !=
+            static_cast<ssize_t>(event.payload.size())) {
+            mEvents.clear();
+            return false;
+        }
+        mEvents.push_back(std::move(event));
+    }
+    return true;
+}
+
+void TraceReplayer::setHandler(uint32_t kind, std::string name,
+                               Handler handler) {
+    if (mHandlers.size() <= kind) {
+        mHandlers.resize(kind + 1);
+    }
+    mHandlers[kind] = {std::move(name), std::move(handler)};
+}
+
+void TraceReplayer::setClock(Clock clock) {
+    mClock = std::move(clock);
+}
+
+std::vector<TraceReplayer::KindStats> TraceReplayer::replay(const Trace& trace,
+                                                            int passes) {
+    const std::vector<TraceEvent>& events = trace.events();
+    std::vector<uint64_t> cycles(events.size(), UINT64_MAX);
+    const uint64_t overhead = cycleCounterOverhead();
+
+    for (int pass = 0; pass < std::max(passes, 1); ++pass) {
+        for (size_t i = 0; i < events.size(); ++i) {
+            const TraceEvent& event = events[i];
+            if (event.kind >= mHandlers.size() ||
+                !mHandlers[event.kind].handler) {
+                continue;
+            }
+            if (mClock) {
+                mClock(event.timeNs);
+            }
+            const Handler& handler = mHandlers[event.kind].handler;
+            const uint64_t start = readCycleCounter();
+            handler(event);
+            const uint64_t end = readCycleCounter();
+            const uint64_t spent = end - start > overhead ? end - start - overhead
+                                                          : 0;
+            cycles[i] = std::min(cycles[i], spent);
+        }
+    }
+
+    std::vector<KindStats> result;
+    std::vector<uint64_t> samples;
+    for (uint32_t kind = 0; kind < mHandlers.size(); ++kind) {
+        if (!mHandlers[kind].handler) {
+            continue;
+        }
+        samples.clear();
+        for (size_t i = 0; i < events.size(); ++i) {
+            if (events[i].kind == kind) {
+                samples.push_back(cycles[i]);
+            }
+        }
+        if (samples.empty()) {
+            continue;
+        }
+        std::sort(samples.begin(), samples.end());
+
+        KindStats stats;
+        stats.kind = kind;
+        stats.name = mHandlers[kind].name;
+        stats.count = samples.size();
+        stats.minCycles = samples.front();
+        stats.medianCycles = samples[samples.size() / 2];
+        stats.p99Cycles = samples[(samples.size() - 1) * 99 / 100];
+        for (uint64_t sample : samples) {
+            stats.totalCycles += sample;
+        }
+        result.push_back(std::move(stats));
+    }
+    return result;
+}
+
+// static
+std::string TraceReplayer::format(const std::vector<KindStats>& stats) {
+    std::string text;
+    for (const KindStats& kind : stats) {
+        StringAppendFormatRaw(&text,
+                              "%s: %" PRIu64 " events, min %" PRIu64
+                              " median %" PRIu64 " p99 %" PRIu64
+                              " total %" PRIu64 " cycles\n",
+                              kind.name.c_str(), kind.count, kind.minCycles,
+                              kind.medianCycles, kind.p99Cycles,
+                              kind.totalCycles);
+    }
+    return text;
+}
+
+}  // namespace base
+}  // namespace android
@@ -15,20 +15,31 @@
 #include "AndroidPipe.h"
 #include "android_pipe_base.h"
 
+#include "aemu/base/LatencyHistogram.h"
 #include "aemu/base/Optional.h"
+#include "aemu/base/StatsPage.h"
 #include "aemu/base/StringFormat.h"
+#include "aemu/base/containers/FlatMap.h"
 #include "aemu/base/files/MemStream.h"
 #include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/system/System.h"
+#include "aemu/base/threads/FunctorThread.h"
+#include "aemu/base/threads/ParallelFor.h"
 #include "android_pipe_device.h"
 #include "android_pipe_host.h"
 #include "host-common/GfxstreamFatalError.h"
+#include "host-common/GpaTranslationCache.h"
+#include "host-common/address_space_device.h"
 #include "DeviceContextRunner.h"
 #include "VmLock.h"
 
 #include <algorithm>
+#include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <assert.h>
@@ -66,6 +77,8 @@ using ServiceList = std::vector<std::unique_ptr<Service>>;
 using VmLock = android::VmLock;
 using android::base::MemStream;
 using android::base::StringFormat;
+using android::emulation::GpaTranslationCache;
+using android::emulation::GuestTrafficStats;
 using emugl::ABORT_REASON_OTHER;
 using emugl::FatalError;
 
@@ -107,8 +120,20 @@ static OptionalString readOptionalString(BaseStream* stream) {
     return OptionalString();
 }
 
+// Counts a guest send or receive that moved |bytes|, if it moved any.
+void countGuestTransfer(GuestTrafficStats::Source source,
+                        GuestTrafficStats::Counter direction,
+                        int64_t bytes) {
+    if (bytes > 0) {
+        GuestTrafficStats& stats = GuestTrafficStats::get();
+        stats.add(source, direction, bytes);
+        stats.add(source, GuestTrafficStats::kCommands, 1);
+    }
+}
+
 // forward
 Service* findServiceByName(const char* name);
+Service* findServiceById(uint32_t id);
 
 // Implementation of a special AndroidPipe class used to model the state
 // of a pipe connection before the service name has been written to the
@@ -142,51 +167,123 @@ public:
     }
 
     // TECHNICAL NOTE: This function reads data from the guest until it
-    // finds a zero-terminated C-string. After that it parses it to find
-    // a registered service corresponding to one of the allowed formats
-    // (see below). In case of success, this creates a new AndroidPipe
-    // instance and calls AndroidPipeHwFuncs::resetPipe() to associate it with
-    // the current hardware-side |mHwPipe|, then *deletes* the current
-    // instance! In case of error (e.g. invalid service name, or error during
-    // initialization), PIPE_ERROR_INVAL will be returned, otherwise, the
-    // number of bytes accepted from the guest is returned.
+    // has a whole connection message: either a zero-terminated C-string, or
+    // a binary message (see AndroidPipe::kBinaryConnectMagic). After that it
+    // looks up the registered service it names. In case of success, this
+    // creates a new AndroidPipe instance and calls
+    // AndroidPipeHwFuncs::resetPipe() to associate it with the current
+    // hardware-side |mHwPipe|, then *deletes* the current instance! In case
+    // of error (e.g. invalid service name, or error during initialization),
+    // PIPE_ERROR_INVAL will be returned, otherwise, the number of bytes
+    // accepted from the guest is returned.
     virtual int onGuestSend(const AndroidPipeBuffer* buffers,
                             int numBuffers,
                             void** newPipePtr) override {
         int result = 0;
-        size_t avail = kBufferSize - mPos;
-        bool foundZero = false;
-        for (; !foundZero && avail > 0 && numBuffers > 0;
-             buffers++, numBuffers--) {
+        bool complete = false;
+        for (; !complete && numBuffers > 0; buffers++, numBuffers--) {
             const uint8_t* data = buffers[0].data;
-            size_t count = std::min(avail, buffers[0].size);
-            // Read up to |count| bytes, stopping after the first zero.
+            const size_t count = buffers[0].size;
+            // Read up to |count| bytes, stopping at the end of the message.
             size_t n = 0;
-            while (n < count) {
-                uint8_t byte = data[n++];
-                mBuffer[mPos++] = (char) byte;
-                if (!byte) {
-                    foundZero = true;
-                    break;
+            while (n < count && !complete) {
+                mBuffer[mPos++] = (char) data[n++];
+                complete = isMessageComplete();
+                if (mPos == kBufferSize && !complete) {
+                    DD("%s: connection buffer full, force-closing connection",
+                       __FUNCTION__);
+                    return PIPE_ERROR_IO;
                 }
             }
             result += static_cast<int>(n);
-            avail -= n;
         }
         DD("%s: receiving %d connection bytes from hwpipe=%p", __FUNCTION__,
            result, mHwPipe);
 
-        if (!foundZero) {
-            if (avail == 0) {
-                DD("%s: service name buffer full, force-closing connection",
-                   __FUNCTION__);
-                return PIPE_ERROR_IO;
-            }
-            // Still waiting for terminating zero.
-            DD("%s: still waiting for terminating zero!", __FUNCTION__);
+        if (!complete) {
+            // Still waiting for the rest of the message.
+            DD("%s: still waiting for the end of the message!", __FUNCTION__);
             return result;
         }
 
+        const uint64_t startUs = base::getHighResTimeUs();
+        const int ret = isBinary() ? connectBinary(newPipePtr)
+                                   : connectText(newPipePtr);
+        base::recordLatency(base::LatencyMetric::kPipeOpen,
+                            base::getHighResTimeUs() - startUs);
+        if (ret < 0) {
+            return ret;
+        }
+        // |this| was deleted once the new pipe took over.
+        return result;
+    }
+
+    virtual void onGuestWantWakeOn(int wakeFlags) override {
+        // nothing to do here
+        DD("%s: signaling wakeFlags=%d for hwpipe=%p", __FUNCTION__, wakeFlags,
+           mHwPipe);
+    }
+
+    virtual void onSave(BaseStream* stream) override {
+        DD("%s: saving connector state for hwpipe=%p", __FUNCTION__, mHwPipe);
+        stream->putBe32(mPos);
+        stream->write(mBuffer, mPos);
+    }
+
+    bool onLoad(BaseStream* stream) {
+        DD("%s: loading connector state for hwpipe=%p", __FUNCTION__, mHwPipe);
+        int32_t len = stream->getBe32();
+        if (len < 0 || len > kBufferSize) {
+            D("%s: invalid length %d (expected 0 <= len <= %d)", __FUNCTION__,
+              static_cast<int>(len), kBufferSize);
+            return false;
+        }
+        mPos = (int)len;
+        int ret = (int)stream->read(mBuffer, mPos);
+        DD("%s: read %d bytes (%d expected)", __FUNCTION__, ret, mPos);
+        return (ret == mPos);
+    }
+
+private:
+    bool isBinary() const {
+        return mPos > 0 && mBuffer[0] == AndroidPipe::kBinaryConnectMagic[0];
+    }
+
+    bool isBulk() const {
+        return mPos >= int(sizeof(AndroidPipe::kBulkConnectMagic)) &&
+               memcmp(mBuffer, AndroidPipe::kBulkConnectMagic,
+                      sizeof(AndroidPipe::kBulkConnectMagic)) == 0;
+    }
+
+    // Both binary messages have their magic in before the end of the
+    // shorter header.
+    size_t binaryHeaderSize() const {
+        return isBulk() ? AndroidPipe::kBulkConnectHeaderSize
+                        : AndroidPipe::kBinaryConnectHeaderSize;
+    }
+
+    static uint32_t readLe32(const char* p) {
+        const uint8_t* b = reinterpret_cast<const uint8_t*>(p);
+        return uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 |
+               uint32_t(b[3]) << 24;
+    }
+
+    static uint64_t readLe64(const char* p) {
+        return uint64_t(readLe32(p)) | uint64_t(readLe32(p + 4)) << 32;
+    }
+
+    bool isMessageComplete() const {
+        if (!isBinary()) {
+            return mBuffer[mPos - 1] == '\0';
+        }
+        const size_t headerSize = binaryHeaderSize();
+        if (mPos < int(headerSize)) {
+            return false;
+        }
+        return uint64_t(mPos) == headerSize + uint64_t(readLe32(mBuffer + 8));
+    }
+
+    int connectText(void** newPipePtr) {
         // Acceptable formats for the connection string are:
         //
         //    pipe:<name>
@@ -249,10 +346,45 @@ public:
             D("%s: Unknown server with name %s!", __FUNCTION__, pipeName);
             return PIPE_ERROR_INVAL;
         }
+        return connect(svc, pipeArgs, newPipePtr);
+    }
 
+    int connectBinary(void** newPipePtr) {
+        const bool bulk = isBulk();
+        if (!bulk && memcmp(mBuffer, AndroidPipe::kBinaryConnectMagic,
+                            sizeof(AndroidPipe::kBinaryConnectMagic)) != 0) {
+            D("%s: Unknown binary pipe connection", __FUNCTION__);
+            return PIPE_ERROR_INVAL;
+        }
+        const size_t headerSize = binaryHeaderSize();
+        const uint32_t id = readLe32(mBuffer + 4);
+        const uint32_t size = readLe32(mBuffer + 8);
+        // isMessageComplete() never lets |size| reach past the buffer, but
+        // the arguments still need a terminator.
+        if (headerSize + size >= kBufferSize) {
+            return PIPE_ERROR_INVAL;
+        }
+        Service* svc = findServiceById(id);
+        if (!svc) {
+            D("%s: Unknown server with id 0x%08x!", __FUNCTION__, id);
+            return PIPE_ERROR_INVAL;
+        }
+        char* pipeArgs = nullptr;
+        if (size) {
+            pipeArgs = mBuffer + headerSize;
+            pipeArgs[size] = '\0';
+        }
+        return connect(svc, pipeArgs, newPipePtr, bulk ? readLe64(mBuffer + 12) : 0);
+    }
+
+    // Hands the hardware pipe over to a new |svc| pipe, and deletes this.
+    // A nonzero |bulkGpa| asks for bulk mode with the rings there.
+    int connect(Service* svc, const char* pipeArgs, void** newPipePtr,
+                uint64_t bulkGpa = 0) {
         AndroidPipe* newPipe = svc->create(mHwPipe, pipeArgs, mFlags);
         if (!newPipe) {
-            D("%s: Initialization failed for %s pipe!", __FUNCTION__, pipeName);
+            D("%s: Initialization failed for %s pipe!", __FUNCTION__,
+              svc->name().c_str());
             return PIPE_ERROR_INVAL;
         }
 
@@ -261,42 +393,23 @@ public:
           __FUNCTION__,
           newPipe,
           mHwPipe,
-          pipeName);
+          svc->name().c_str());
 
         newPipe->setFlags(mFlags);
+        newPipe->setTrafficArgs(pipeArgs);
+        // Without the header marked accepted, the guest keeps to the plain
+        // protocol.
+        if (bulkGpa && svc->canUseBulkRing() && mFlags == ANDROID_PIPE_DEFAULT &&
+            !newPipe->attachBulkRing(bulkGpa, true)) {
+            D("%s: no bulk ring at 0x%llx for %s", __FUNCTION__,
+              (unsigned long long)bulkGpa, svc->name().c_str());
+        }
         *newPipePtr = newPipe;
         delete this;
 
-        return result;
-    }
-
-    virtual void onGuestWantWakeOn(int wakeFlags) override {
-        // nothing to do here
-        DD("%s: signaling wakeFlags=%d for hwpipe=%p", __FUNCTION__, wakeFlags,
-           mHwPipe);
-    }
-
-    virtual void onSave(BaseStream* stream) override {
-        DD("%s: saving connector state for hwpipe=%p", __FUNCTION__, mHwPipe);
-        stream->putBe32(mPos);
-        stream->write(mBuffer, mPos);
-    }
-
-    bool onLoad(BaseStream* stream) {
-        DD("%s: loading connector state for hwpipe=%p", __FUNCTION__, mHwPipe);
-        int32_t len = stream->getBe32();
-        if (len < 0 || len > kBufferSize) {
-            D("%s: invalid length %d (expected 0 <= len <= %d)", __FUNCTION__,
-              static_cast<int>(len), kBufferSize);
-            return false;
-        }
-        mPos = (int)len;
-        int ret = (int)stream->read(mBuffer, mPos);
-        DD("%s: read %d bytes (%d expected)", __FUNCTION__, ret, mPos);
-        return (ret == mPos);
+        return 0;
     }
 
-private:
     static constexpr int kBufferSize = 128;
     char mBuffer[kBufferSize];
     int mPos = 0;
@@ -329,82 +442,163 @@ public:
 // A helper class used to send signalWake() and closeFromHost() commands to
 // the device thread, depending on the threading mode setup by the emulation
 // engine.
-struct PipeWakeCommand {
-    void* hwPipe;
-    int wakeFlags;
-};
+//
+// Wakes are coalesced per pipe: flags OR into the pipe's pending mask and
+// the pipe is queued once until it is serviced, so a chatty pipe costs one
+// device call per batch. The runner only carries "drain the batch" tokens,
+// and each drain delivers every queued pipe under one VM lock hold.
+struct PipeWakeBatch {};
 
-class PipeWaker final : public DeviceContextRunner<PipeWakeCommand> {
+class PipeWaker final : public DeviceContextRunner<PipeWakeBatch> {
 public:
+    PipeWaker() : DeviceContextRunner("AndroidPipe.PipeWaker") {}
+
     void signalWake(void* hwPipe, int wakeFlags) {
-        queueDeviceOperation({ hwPipe, wakeFlags });
+        stats().signaled.add(1);
+        {
+            AutoLock lock(mWakesLock);
+            auto inserted = mPendingFlags.emplace(hwPipe, wakeFlags);
+            if (inserted.second) {
+                mOrder.push_back(hwPipe);
+            } else {
+                inserted.first->second |= wakeFlags;
+            }
+            // Callers holding the VM lock deliver right away, as before;
+            // everyone else rides on the drain already queued.
+            if (!willRunImmediately() &&
+                (!inserted.second || mDrainQueued)) {
+                return;
+            }
+            mDrainQueued = true;
+        }
+        queueDeviceOperation({});
     }
     void closeFromHost(void* hwPipe) {
         signalWake(hwPipe, PIPE_WAKE_CLOSED);
     }
+    // Stale mOrder entries are skipped when draining.
     void abortPending(void* hwPipe) {
-        removeAllPendingOperations([hwPipe](const PipeWakeCommand& cmd) {
-            return cmd.hwPipe == hwPipe;
-        });
+        AutoLock lock(mWakesLock);
+        mPendingFlags.erase(hwPipe);
     }
     void abortAllPending() {
-        removeAllPendingOperations([](const PipeWakeCommand& cmd) {
-            return true;
-        });
+        AutoLock lock(mWakesLock);
+        mPendingFlags.clear();
+        mOrder.clear();
     }
 
     int getPendingFlags(void* hwPipe) const {
-        int flags = 0;
-        forEachPendingOperation([hwPipe, &flags](const PipeWakeCommand& cmd) {
-            if (cmd.hwPipe == hwPipe) {
-                flags |= cmd.wakeFlags;
-            }
-        });
-        return flags;
+        AutoLock lock(mWakesLock);
+        auto it = mPendingFlags.find(hwPipe);
+        return it == mPendingFlags.end() ? 0 : it->second;
     }
 
 private:
-    virtual void performDeviceOperation(const PipeWakeCommand& wake_cmd) {
-        void* hwPipe = wake_cmd.hwPipe;
-        int flags = wake_cmd.wakeFlags;
+    struct PipeWake {
+        void* hwPipe;
+        int flags;
+    };
+
+    // signaled / delivered is the coalescing ratio.
+    struct Stats {
+        const base::Stat signaled = base::StatsPage::get().add(
+                "pipes.wakes_signaled", base::StatKind::kCounter);
+        const base::Stat delivered = base::StatsPage::get().add(
+                "pipes.wakes_delivered", base::StatKind::kCounter);
+        const base::Stat batches = base::StatsPage::get().add(
+                "pipes.wake_batches", base::StatKind::kCounter);
+    };
+
+    static const Stats& stats() {
+        static const Stats sStats;
+        return sStats;
+    }
 
-        // Not used when in virtio mode.
-        if (flags & PIPE_WAKE_CLOSED) {
-            getPipeHwFuncs(hwPipe)->closeFromHost(hwPipe);
-        } else {
-            getPipeHwFuncs(hwPipe)->signalWake(hwPipe, flags);
+    // Several tokens in one timer event still need just one drain.
+    void performDeviceOperations(const PipeWakeBatch*, size_t) override {
+        performDeviceOperation({});
+    }
+
+    void performDeviceOperation(const PipeWakeBatch&) override {
+        // Local, since delivering a wake may signal another one and drain
+        // recursively.
+        std::vector<PipeWake> batch;
+        {
+            AutoLock lock(mWakesLock);
+            mDrainQueued = false;
+            for (void* hwPipe : mOrder) {
+                auto it = mPendingFlags.find(hwPipe);
+                if (it != mPendingFlags.end()) {
+                    batch.push_back({hwPipe, it->second});
+                    mPendingFlags.erase(it);
+                }
+            }
+            mOrder.clear();
+        }
+        if (batch.empty()) {
+            return;
+        }
+        stats().batches.add(1);
+        stats().delivered.add(static_cast<int64_t>(batch.size()));
+        for (const PipeWake& wake : batch) {
+            void* hwPipe = wake.hwPipe;
+            // Not used when in virtio mode.
+            if (wake.flags & PIPE_WAKE_CLOSED) {
+                getPipeHwFuncs(hwPipe)->closeFromHost(hwPipe);
+            } else {
+                getPipeHwFuncs(hwPipe)->signalWake(hwPipe, wake.flags);
+            }
         }
     }
+
+    mutable Lock mWakesLock{"AndroidPipe.PipeWaker.wakes"};
+    FlatHashMap<void*, int> mPendingFlags;
+    // Pipes in the order they were first signaled since the last drain.
+    std::vector<void*> mOrder;
+    bool mDrainQueued = false;
 };
 
 struct Globals {
     ServiceList services;
+    // Positions in |services| by name (viewing the service's own string)
+    // and by Service::idForName(). The first service added under a name or
+    // id wins, as with a linear search.
+    std::unordered_map<std::string_view, int> positionsByName;
+    std::unordered_map<uint32_t, int> positionsById;
     ConnectorService connectorService;
     PipeWaker pipeWaker;
 
+    void addService(std::unique_ptr<Service> service) {
+        const int pos = static_cast<int>(services.size());
+        const std::string& name = service->name();
+        positionsByName.emplace(name, pos);
+        const auto inserted =
+                positionsById.emplace(Service::idForName(name.c_str()), pos);
+        if (!inserted.second) {
+            E("%s: pipe service '%s' has the same id as '%s'", __FUNCTION__,
+              name.c_str(), services[inserted.first->second]->name().c_str());
+        }
+        services.push_back(std::move(service));
+    }
+
+    void clearServices() {
+        positionsByName.clear();
+        positionsById.clear();
+        services.clear();
+    }
+
     // Searches for a service position in the |services| list and returns the
-    // index. |startPosHint| is a _hint_ and suggests where to start from.
-    // Returns the index of the service or -1 if there's no |name| service.
+    // index. |startPosHint| is a _hint_ and is checked first, since snapshots
+    // list services in registration order. Returns the index of the service
+    // or -1 if there's no |name| service.
     int findServicePositionByName(const char* name,
                                   const int startPosHint = 0) const {
-        const auto searchByNameFunc =
-                [name](const std::unique_ptr<Service>& service) {
-                    return service->name() == name;
-                };
-
-        // First, try to search starting from the hint position.
-        auto end = services.end();
-        auto it = std::find_if(services.begin() + startPosHint, end,
-                               searchByNameFunc);
-
-        // If there was a hint that didn't help, continue searching from the
-        // beginning of the contatiner to check the rest of it.
-        if (it == end && startPosHint > 0) {
-            end = services.begin() + startPosHint;
-            it = std::find_if(services.begin(), end, searchByNameFunc);
+        if (startPosHint < static_cast<int>(services.size()) &&
+            services[startPosHint]->name() == name) {
+            return startPosHint;
         }
-
-        return it == end ? -1 : it - services.begin();
+        const auto it = positionsByName.find(name);
+        return it == positionsByName.end() ? -1 : it->second;
     }
 
     Service* loadServiceByName(BaseStream* stream) {
@@ -425,7 +619,13 @@ Service* findServiceByName(const char* name) {
     return pos < 0 ? nullptr : sGlobals()->services[pos].get();
 }
 
-AndroidPipe* loadPipeFromStreamCommon(BaseStream* stream,
+Service* findServiceById(uint32_t id) {
+    const auto& positions = sGlobals()->positionsById;
+    const auto it = positions.find(id);
+    return it == positions.end() ? nullptr : sGlobals()->services[it->second].get();
+}
+
+AndroidPipe* loadPipeFromStreamCommon(MemStream* stream,
                                       void* hwPipe,
                                       Service* service,
                                       char* pForceClose) {
@@ -439,13 +639,16 @@ AndroidPipe* loadPipeFromStreamCommon(BaseStream* stream,
         pipe = service->load(hwPipe, args ? args->c_str() : nullptr, stream);
         if (!pipe) {
             *pForceClose = 1;
+        } else {
+            pipe->setTrafficArgs(args ? args->c_str() : nullptr);
         }
     } else {
         DD("%s: force-closing hwpipe=%p", __FUNCTION__, hwPipe);
         *pForceClose = 1;
     }
 
-    const int pendingFlags = stream->getBe32();
+    const uint32_t savedFlags = stream->getBe32();
+    const int pendingFlags = savedFlags & ~AndroidPipe::kSavedBulkRing;
     if (pendingFlags && pipe && !*pForceClose) {
         if (!hwPipe) {
             GFXSTREAM_ABORT(FatalError(ABORT_REASON_OTHER))
@@ -457,6 +660,15 @@ AndroidPipe* loadPipeFromStreamCommon(BaseStream* stream,
            pendingFlags, hwPipe);
     }
 
+    // Pipes in bulk mode end with where their rings are. The rings are
+    // guest memory, so whatever they held is still there.
+    if (savedFlags & AndroidPipe::kSavedBulkRing) {
+        const uint64_t bulkGpa = stream->getBe64();
+        if (pipe && !*pForceClose && !pipe->attachBulkRing(bulkGpa, false)) {
+            *pForceClose = 1;
+        }
+    }
+
     return pipe;
 }
 
@@ -468,16 +680,16 @@ void AndroidPipe::initThreading(VmLock* vmLock) {
     // In virtio land, this won't be needed, so include trivial timer interface.
     sGlobals()->pipeWaker.init(vmLock, {
         // installFunc
-        [](DeviceContextRunner<PipeWakeCommand>* dcr, std::function<void()> installedFunc) {
+        [](DeviceContextRunner<PipeWakeBatch>* dcr, std::function<void()> installedFunc) {
             (void)dcr;
             (void)installedFunc;
         },
         // uninstallFunc
-        [](DeviceContextRunner<PipeWakeCommand>* dcr) {
+        [](DeviceContextRunner<PipeWakeBatch>* dcr) {
             (void)dcr;
         },
         // startWithTimeoutFunc
-        [](DeviceContextRunner<PipeWakeCommand>* dcr, uint64_t timeout) {
+        [](DeviceContextRunner<PipeWakeBatch>* dcr, uint64_t timeout) {
             (void)dcr;
             (void)timeout;
         }
@@ -493,13 +705,13 @@ AndroidPipe::~AndroidPipe() {
 void AndroidPipe::Service::add(std::unique_ptr<Service> service) {
     DD("Adding new pipe service '%s' this=%p", service->name().c_str(),
        service.get());
-    sGlobals()->services.push_back(std::move(service));
+    sGlobals()->addService(std::move(service));
 }
 
 // static
 void AndroidPipe::Service::resetAll() {
     DD("Resetting all pipe services");
-    sGlobals()->services.clear();
+    sGlobals()->clearServices();
 }
 
 void AndroidPipe::signalWake(int wakeFlags) {
@@ -511,6 +723,7 @@ void AndroidPipe::signalWake(int wakeFlags) {
             << unsigned(wakeFlags) << ")";
     }
     sGlobals()->pipeWaker.signalWake(mHwPipe, wakeFlags);
+    GuestTrafficStats::get().add(mTrafficSource, GuestTrafficStats::kWakes, 1);
 }
 
 void AndroidPipe::closeFromHost() {
@@ -535,7 +748,14 @@ void AndroidPipe::abortPendingOperation() {
 }
 
 void AndroidPipe::saveToStream(BaseStream* stream) {
-    // First, write service name.
+    saveServiceName(stream);
+
+    MemStream pipeStream;
+    saveState(&pipeStream);
+    pipeStream.save(stream);
+}
+
+void AndroidPipe::saveServiceName(BaseStream* stream) {
     if (mService == &sGlobals()->connectorService) {
         // A connector pipe
         stream->putByte(0);
@@ -544,20 +764,244 @@ void AndroidPipe::saveToStream(BaseStream* stream) {
         stream->putByte(1);
         stream->putString(mService->name());
     }
+}
 
-    MemStream pipeStream;
-    writeOptionalString(&pipeStream, mArgs.c_str());
+void AndroidPipe::saveState(BaseStream* stream) {
+    writeOptionalString(stream, mArgs.c_str());
 
     // Save pipe-specific state now.
     if (mService->canLoad()) {
-        mService->savePipe(this, &pipeStream);
+        mService->savePipe(this, stream);
     }
 
     // Save the pending wake or close operations as well.
     const int pendingFlags = sGlobals()->pipeWaker.getPendingFlags(mHwPipe);
-    pipeStream.putBe32(pendingFlags);
+    stream->putBe32(pendingFlags | (hasBulkRing() ? kSavedBulkRing : 0));
+    if (hasBulkRing()) {
+        stream->putBe64(mBulkGpa);
+    }
+}
 
-    pipeStream.save(stream);
+AndroidPipe::DeferredSave AndroidPipe::saveStateDeferred() {
+    if (!mService->canLoad()) {
+        return {};
+    }
+    DeferredSave pipeState = mService->savePipeDeferred(this);
+    if (!pipeState) {
+        return {};
+    }
+    const int pendingFlags = sGlobals()->pipeWaker.getPendingFlags(mHwPipe);
+    return [args = mArgs, pipeState = std::move(pipeState), pendingFlags,
+            bulkGpa = hasBulkRing() ? mBulkGpa : 0](BaseStream* stream) {
+        writeOptionalString(stream, args.c_str());
+        pipeState(stream);
+        stream->putBe32(pendingFlags | (bulkGpa ? kSavedBulkRing : 0));
+        if (bulkGpa) {
+            stream->putBe64(bulkGpa);
+        }
+    };
+}
+
+// The pipe may be gone once onGuestRecv() or onGuestSend() returns, e.g. a
+// connector pipe that handed over to a service, so the source is read first.
+int AndroidPipe::guestRecv(AndroidPipeBuffer* buffers, int numBuffers) {
+    if (hasBulkRing()) {
+        return bulkRingMapped() ? bulkRecv(buffers, numBuffers) : PIPE_ERROR_IO;
+    }
+    const GuestTrafficStats::Source source = mTrafficSource;
+    const int received = onGuestRecv(buffers, numBuffers);
+    countGuestTransfer(source, GuestTrafficStats::kBytesToGuest, received);
+    return received;
+}
+
+int AndroidPipe::guestSend(const AndroidPipeBuffer* buffers,
+                           int numBuffers,
+                           void** newPipePtr) {
+    if (hasBulkRing()) {
+        return bulkRingMapped() ? bulkSend(buffers, numBuffers, newPipePtr) : PIPE_ERROR_IO;
+    }
+    const GuestTrafficStats::Source source = mTrafficSource;
+    const int sent = onGuestSend(buffers, numBuffers, newPipePtr);
+    countGuestTransfer(source, GuestTrafficStats::kBytesToHost, sent);
+    return sent;
+}
+
+void AndroidPipe::setTrafficArgs(const char* args) {
+    mTrafficSource = trafficSourceOf(mService, args);
+}
+
+// static
+GuestTrafficStats::Source AndroidPipe::trafficSourceOf(const Service* service,
+                                                       const char* args) {
+    std::string name = "pipe:";
+    name += service ? service->name() : "<null>";
+    if (args && *args) {
+        name += ':';
+        name += args;
+    }
+    return GuestTrafficStats::get().source(name);
+}
+
+// Where the bulk storage at |gpa| is on the host, with how many bytes from
+// there on are mapped, or null if none are.
+static char* bulkStorageAt(uint64_t gpa, uint64_t* mappedSize) {
+    const address_space_device_control_ops* ops =
+            get_address_space_device_control_ops();
+    if (!ops->get_host_range) {
+        return nullptr;
+    }
+    uint64_t rangeGpa = 0;
+    uint64_t rangeSize = 0;
+    char* storage = static_cast<char*>(ops->get_host_range(gpa, &rangeGpa, &rangeSize));
+    if (!storage) {
+        return nullptr;
+    }
+    *mappedSize = rangeGpa + rangeSize - gpa;
+    return storage;
+}
+
+bool AndroidPipe::attachBulkRing(uint64_t gpa, bool reset) {
+    static_assert(sizeof(ring_buffer) <= ANDROID_PIPE_BULK_PAGE_SIZE,
+                  "A ring's positions fit a page");
+    if (!gpa || gpa % ANDROID_PIPE_BULK_PAGE_SIZE) {
+        return false;
+    }
+    // Read before looking up, so a mapping change racing with it is caught
+    // by the next doorbell.
+    const uint64_t generation = GpaTranslationCache::generation();
+    uint64_t mappedSize = 0;
+    char* storage = bulkStorageAt(gpa, &mappedSize);
+    if (!storage || mappedSize < ANDROID_PIPE_BULK_PAGE_SIZE) {
+        return false;
+    }
+    // The guest can change the header at any time; only this copy of the
+    // size is trusted.
+    const auto* header = reinterpret_cast<const android_pipe_bulk_header*>(storage);
+    const uint32_t ringSize = __atomic_load_n(&header->ring_size, __ATOMIC_ACQUIRE);
+    if (header->magic != ANDROID_PIPE_BULK_MAGIC ||
+        header->version != ANDROID_PIPE_BULK_VERSION ||
+        ringSize < ANDROID_PIPE_BULK_MIN_RING_SIZE ||
+        ringSize > ANDROID_PIPE_BULK_MAX_RING_SIZE || (ringSize & (ringSize - 1)) ||
+        android_pipe_bulk_storage_size(ringSize) > mappedSize) {
+        return false;
+    }
+    mBulk = android_pipe_bulk_rings_create(storage, ringSize);
+    mBulkGpa = gpa;
+    mBulkRingSize = ringSize;
+    mBulkGeneration = generation;
+    if (reset) {
+        ring_buffer_init(mBulk.to_host.ring);
+        ring_buffer_init(mBulk.from_host.ring);
+        __atomic_store_n(&mBulk.header->status, ANDROID_PIPE_BULK_ACCEPTED,
+                         __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+// The guest can take the rings away at any time, e.g. by freeing the
+// address space block they are in, which bumps the translation generation.
+// They are looked up again then; once they are gone or shrank, the pipe
+// only fails.
+bool AndroidPipe::bulkRingMapped() {
+    if (!mBulk.header) {
+        return false;
+    }
+    const uint64_t generation = GpaTranslationCache::generation();
+    if (generation == mBulkGeneration) {
+        return true;
+    }
+    uint64_t mappedSize = 0;
+    char* storage = bulkStorageAt(mBulkGpa, &mappedSize);
+    if (!storage || android_pipe_bulk_storage_size(mBulkRingSize) > mappedSize) {
+        D("%s: bulk ring at 0x%llx is gone", __FUNCTION__,
+          (unsigned long long)mBulkGpa);
+        mBulk = {};
+        return false;
+    }
+    if (storage != reinterpret_cast<char*>(mBulk.header)) {
+        mBulk = android_pipe_bulk_rings_create(storage, mBulkRingSize);
+    }
+    mBulkGeneration = generation;
+    return true;
+}
+
+// The positions in the rings are guest memory too, so neither side of a
+// ring is taken to hold more than the ring does.
+int AndroidPipe::bulkSend(const AndroidPipeBuffer* buffers,
+                          int numBuffers,
+                          void** newPipePtr) {
+    ring_buffer_with_view& ring = mBulk.to_host;
+    uint32_t taken = 0;
+    for (;;) {
+        const uint32_t bytes = std::min(ring_buffer_available_read(ring.ring, &ring.view),
+                                        ring.view.size - 1);
+        if (!bytes) {
+            break;
+        }
+        ring_buffer_span spans[2];
+        ring_buffer_view_peek_read(ring.ring, &ring.view, bytes, &spans[0], &spans[1]);
+        const AndroidPipeBuffer chunks[2] = {{spans[0].data, spans[0].size},
+                                             {spans[1].data, spans[1].size}};
+        const int sent = onGuestSend(chunks, spans[1].size ? 2 : 1, newPipePtr);
+        if (sent <= 0) {
+            countGuestTransfer(mTrafficSource, GuestTrafficStats::kBytesToHost, taken);
+            // PIPE_ERROR_AGAIN has the guest wait for PIPE_WAKE_WRITE and
+            // ring again.
+            return sent;
+        }
+        const uint32_t consumed = std::min(static_cast<uint32_t>(sent), bytes);
+        ring_buffer_view_consume_read(ring.ring, &ring.view, consumed);
+        taken += consumed;
+    }
+    countGuestTransfer(mTrafficSource, GuestTrafficStats::kBytesToHost, taken);
+    // The doorbell itself is all taken.
+    size_t doorbell = 0;
+    for (int i = 0; i < numBuffers; ++i) {
+        doorbell += buffers[i].size;
+    }
+    return static_cast<int>(doorbell);
+}
+
+int AndroidPipe::bulkRecv(AndroidPipeBuffer* buffers, int numBuffers) {
+    ring_buffer_with_view& ring = mBulk.from_host;
+    uint32_t added = 0;
+    for (;;) {
+        const uint32_t room = std::min(ring_buffer_available_write(ring.ring, &ring.view),
+                                       ring.view.size - 1);
+        if (!room) {
+            break;
+        }
+        ring_buffer_span spans[2];
+        ring_buffer_view_reserve_write(ring.ring, &ring.view, room, &spans[0], &spans[1]);
+        AndroidPipeBuffer chunks[2] = {{spans[0].data, spans[0].size},
+                                       {spans[1].data, spans[1].size}};
+        const int received = onGuestRecv(chunks, spans[1].size ? 2 : 1);
+        if (received <= 0) {
+            if (!added) {
+                // Nothing yet: EOF, an error, or PIPE_ERROR_AGAIN to have
+                // the guest wait for PIPE_WAKE_READ.
+                return received;
+            }
+            break;
+        }
+        const uint32_t bytes = std::min(static_cast<uint32_t>(received), room);
+        ring_buffer_view_commit_write(ring.ring, &ring.view, bytes);
+        added += bytes;
+    }
+    countGuestTransfer(mTrafficSource, GuestTrafficStats::kBytesToGuest, added);
+    // Tells the guest how much it has to read, le32, as far as its buffers
+    // go.
+    int written = 0;
+    for (int i = 0; i < numBuffers && written < 4; ++i) {
+        for (size_t j = 0; j < buffers[i].size && written < 4; ++j, ++written) {
+            buffers[i].data[j] = static_cast<uint8_t>(added >> (8 * written));
+        }
+    }
+    return written;
+}
+
+bool AndroidPipe::canSnapshotConcurrently() const {
+    return mService && mService->canSnapshotConcurrently();
 }
 
 // static
@@ -601,6 +1045,13 @@ AndroidPipe* AndroidPipe::loadFromStreamLegacy(BaseStream* stream,
 
 // API for the virtual device.
 
+// Pipes the guest has open, for StatsPage.
+static const android::base::Stat& openPipesStat() {
+    static const android::base::Stat sStat = android::base::StatsPage::get().add(
+            "pipes.open", android::base::StatKind::kGauge);
+    return sStat;
+}
+
 void android_pipe_reset_services() {
     AndroidPipe::Service::resetAll();
 }
@@ -608,6 +1059,7 @@ void android_pipe_reset_services() {
 void* android_pipe_guest_open(void* hwpipe) {
     CHECK_VM_STATE_LOCK();
     DD("%s: Creating new connector pipe for hwpipe=%p", __FUNCTION__, hwpipe);
+    openPipesStat().add(1);
     return android::sGlobals()->connectorService.create(hwpipe, nullptr, (AndroidPipeFlags)0);
 }
 
@@ -617,6 +1069,7 @@ void* android_pipe_guest_open_with_flags(void* hwpipe, uint32_t flags) {
     auto pipe =
         android::sGlobals()->connectorService.create(hwpipe, nullptr, (AndroidPipeFlags)flags);
     pipe->setFlags((AndroidPipeFlags)flags);
+    openPipesStat().add(1);
     return pipe;
 }
 
@@ -628,21 +1081,42 @@ void android_pipe_guest_close(void* internalPipe, PipeCloseReason reason) {
             (int)reason);
         pipe->abortPendingOperation();
         pipe->onGuestClose(reason);
+        openPipesStat().add(-1);
     }
 }
 
 template <class Func>
 static void forEachServiceToStream(CStream* stream, Func&& func) {
+    const auto& services = android::sGlobals()->services;
     BaseStream* const bs = asBaseStream(stream);
-    bs->putBe16(android::sGlobals()->services.size());
-    for (const auto& service : android::sGlobals()->services) {
-        bs->putString(service->name());
+    bs->putBe16(services.size());
+
+    // Write to a pipeStream per service first so that we know the length and
+    // can enable skipping loading specific pipes on load, see isPipeOptional.
+    // Services that allow it fill theirs in parallel; the rest go in order
+    // below. Service state can be large, so it goes into pooled segments
+    // rather than a vector that keeps doubling.
+    std::vector<MemStream> pipeStreams;
+    pipeStreams.reserve(services.size());
+    for (size_t i = 0; i < services.size(); ++i) {
+        pipeStreams.emplace_back(MemStream::Layout::Segmented);
+    }
+    std::vector<std::function<void()>> tasks;
+    for (size_t i = 0; i < services.size(); ++i) {
+        if (services[i]->canSnapshotConcurrently()) {
+            tasks.push_back([&func, &services, &pipeStreams, i] {
+                func(services[i].get(), &pipeStreams[i]);
+            });
+        }
+    }
+    parallelInvokeAll(tasks);
 
-        // Write to the pipeStream first so that we know the length and can
-        // enable skipping loading specific pipes on load, see isPipeOptional.
-        MemStream pipeStream;
-        func(service.get(), &pipeStream);
-        pipeStream.save(bs);
+    for (size_t i = 0; i < services.size(); ++i) {
+        bs->putString(services[i]->name());
+        if (!services[i]->canSnapshotConcurrently()) {
+            func(services[i].get(), &pipeStreams[i]);
+        }
+        pipeStreams[i].save(bs);
     }
 }
 
@@ -656,6 +1130,10 @@ static void forEachServiceFromStream(CStream* stream, Func&& func) {
     for (const auto& service : services) {
         missingServices.insert(service.get());
     }
+
+    // Read every service's pipeStream first, so that services that allow it
+    // can load theirs in parallel.
+    std::vector<std::pair<Service*, std::unique_ptr<MemStream>>> found;
     for (int i = 0; i < count; ++i) {
         const auto name = bs->getString();
         servicePos = android::sGlobals()->findServicePositionByName(
@@ -663,12 +1141,12 @@ static void forEachServiceFromStream(CStream* stream, Func&& func) {
 
         // Always load the pipeStream, so that if the pipe is missing it does
         // not corrupt the next pipe.
-        MemStream pipeStream;
-        pipeStream.load(bs);
+        auto pipeStream = std::make_unique<MemStream>();
+        pipeStream->load(bs);
 
         if (servicePos >= 0) {
             const auto& service = services[servicePos];
-            func(service.get(), &pipeStream);
+            found.emplace_back(service.get(), std::move(pipeStream));
             missingServices.erase(service.get());
         } else if (android::isPipeOptional(name)) {
             D("%s: Skipping optional pipe %s\n", __FUNCTION__, name.c_str());
@@ -679,6 +1157,21 @@ static void forEachServiceFromStream(CStream* stream, Func&& func) {
         }
     }
 
+    std::vector<std::function<void()>> tasks;
+    for (auto& entry : found) {
+        if (entry.first->canSnapshotConcurrently()) {
+            tasks.push_back([&func, &entry] {
+                func(entry.first, entry.second.get());
+            });
+        }
+    }
+    parallelInvokeAll(tasks);
+    for (auto& entry : found) {
+        if (!entry.first->canSnapshotConcurrently()) {
+            func(entry.first, entry.second.get());
+        }
+    }
+
     // Now call the same function for all services that weren't in the snapshot.
     // Pass |nullptr| instead of the stream pointer to make sure they know
     // that while we're loading from a snapshot these services aren't part
@@ -738,6 +1231,127 @@ void android_pipe_guest_save(void* internalPipe, CStream* stream) {
     pipe->saveToStream(asBaseStream(stream));
 }
 
+void android_pipe_guest_save_all(void* const* internalPipes,
+                                 int count,
+                                 CStream* stream,
+                                 void (*beforeEach)(void* opaque,
+                                                    int index,
+                                                    CStream* stream),
+                                 void* opaque) {
+    CHECK_VM_STATE_LOCK();
+    BaseStream* const bs = asBaseStream(stream);
+
+    // Pipes that allow it save their state into their own buffers in
+    // parallel; everything is then written out in order.
+    std::vector<std::unique_ptr<MemStream>> pipeStreams(count);
+    std::vector<std::function<void()>> tasks;
+    for (int i = 0; i < count; ++i) {
+        auto pipe = static_cast<android::AndroidPipe*>(internalPipes[i]);
+        if (pipe->canSnapshotConcurrently()) {
+            pipeStreams[i] = std::make_unique<MemStream>();
+            tasks.push_back([pipe, pipeStream = pipeStreams[i].get()] {
+                pipe->saveState(pipeStream);
+            });
+        }
+    }
+    parallelInvokeAll(tasks);
+
+    for (int i = 0; i < count; ++i) {
+        auto pipe = static_cast<android::AndroidPipe*>(internalPipes[i]);
+        DD("%s: host=%p [%s]", __FUNCTION__, pipe, pipe->name());
+        if (beforeEach) {
+            beforeEach(opaque, i, stream);
+        }
+        if (!pipeStreams[i]) {
+            pipe->saveToStream(bs);
+            continue;
+        }
+        pipe->saveServiceName(bs);
+        pipeStreams[i]->save(bs);
+        pipeStreams[i].reset();
+    }
+}
+
+struct AndroidPipeSaveJob {
+    struct Entry {
+        // |before_each| output and the service name.
+        MemStream header;
+        MemStream state;
+        // Fills |state| on |writer|, if set.
+        AndroidPipe::DeferredSave deferred;
+    };
+
+    explicit AndroidPipeSaveJob(int count) : entries(count) {}
+
+    void writeDeferred() {
+        for (Entry& entry : entries) {
+            if (entry.deferred) {
+                entry.deferred(&entry.state);
+                entry.deferred = nullptr;
+            }
+        }
+    }
+
+    std::vector<Entry> entries;
+    std::unique_ptr<FunctorThread> writer;
+};
+
+AndroidPipeSaveJob* android_pipe_guest_save_all_begin(
+        void* const* internalPipes,
+        int count,
+        void (*beforeEach)(void* opaque, int index, CStream* stream),
+        void* opaque) {
+    CHECK_VM_STATE_LOCK();
+    auto job = new AndroidPipeSaveJob(count);
+
+    std::vector<std::function<void()>> tasks;
+    for (int i = 0; i < count; ++i) {
+        auto pipe = static_cast<android::AndroidPipe*>(internalPipes[i]);
+        AndroidPipeSaveJob::Entry& entry = job->entries[i];
+        if (beforeEach) {
+            beforeEach(opaque, i, reinterpret_cast<CStream*>(&entry.header));
+        }
+        pipe->saveServiceName(&entry.header);
+        entry.deferred = pipe->saveStateDeferred();
+        if (entry.deferred) {
+            continue;
+        }
+        if (pipe->canSnapshotConcurrently()) {
+            tasks.push_back([pipe, state = &entry.state] {
+                pipe->saveState(state);
+            });
+        } else {
+            pipe->saveState(&entry.state);
+        }
+    }
+    parallelInvokeAll(tasks);
+
+    job->writer.reset(new FunctorThread([job] { job->writeDeferred(); }));
+    if (!job->writer->start()) {
+        // android_pipe_guest_save_all_end() writes them instead.
+        job->writer.reset();
+    }
+    return job;
+}
+
+void android_pipe_guest_save_all_end(AndroidPipeSaveJob* job,
+                                     CStream* stream) {
+    if (job->writer) {
+        job->writer->wait();
+        job->writer.reset();
+    }
+    job->writeDeferred();
+
+    BaseStream* const bs = asBaseStream(stream);
+    for (AndroidPipeSaveJob::Entry& entry : job->entries) {
+        entry.header.forEachSegment([bs](const char* data, size_t size) {
+            bs->write(data, size);
+        });
+        entry.state.save(bs);
+    }
+    delete job;
+}
+
 void* android_pipe_guest_load(CStream* stream,
                               void* hwPipe,
                               char* pForceClose) {
@@ -774,7 +1388,7 @@ int android_pipe_guest_recv(void* internalPipe,
     auto pipe = static_cast<AndroidPipe*>(internalPipe);
     // Note that pipe may be deleted during this call, so it's not safe to
     // access pipe after this point.
-    return pipe->onGuestRecv(buffers, numBuffers);
+    return pipe->guestRecv(buffers, numBuffers);
 }
 
 void android_pipe_wait_guest_recv(void* internalPipe) {
@@ -792,7 +1406,7 @@ int android_pipe_guest_send(void** internalPipe,
     auto pipe = static_cast<AndroidPipe*>(*internalPipe);
     // Note that pipe may be deleted during this call, so it's not safe to
     // access pipe after this point.
-    return pipe->onGuestSend(buffers, numBuffers, internalPipe);
+    return pipe->guestSend(buffers, numBuffers, internalPipe);
 }
 
 void android_pipe_wait_guest_send(void* internalPipe) {
@@ -0,0 +1,316 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/AndroidPipe.h"
+
+#include "aemu/base/files/MemStream.h"
+#include "host-common/GraphicsAgentFactory.h"
+#include "host-common/address_space_device.h"
+#include "host-common/address_space_device.hpp"
+#include "host-common/address_space_host_memory_allocator.h"
+#include "host-common/android_pipe_bulk.h"
+#include "host-common/android_pipe_device.h"
+#include "host-common/android_pipe_host.h"
+#include "host-common/testing/MockGraphicsAgentFactory.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace android {
+
+using base::MemStream;
+using emulation::AddressSpaceDevicePingInfo;
+using emulation::AddressSpaceHostMemoryAllocatorContext;
+
+namespace {
+
+// Echoes back everything sent to it. Its saved state is a number followed
+// by |padding| bytes its load() doesn't read.
+class EchoPipe : public AndroidPipe {
+public:
+    EchoPipe(void* hwPipe, Service* service, uint32_t padding)
+        : AndroidPipe(hwPipe, service), mPadding(padding) {}
+
+    void onGuestClose(PipeCloseReason reason) override { delete this; }
+    unsigned onGuestPoll() const override {
+        return PIPE_POLL_OUT | (mData.empty() ? 0 : PIPE_POLL_IN);
+    }
+    int onGuestRecv(AndroidPipeBuffer* buffers, int numBuffers) override {
+        if (mData.empty()) return PIPE_ERROR_AGAIN;
+        size_t copied = 0;
+        for (int i = 0; i < numBuffers && copied < mData.size(); i++) {
+            const size_t n = std::min(buffers[i].size, mData.size() - copied);
+            memcpy(buffers[i].data, mData.data() + copied, n);
+            copied += n;
+        }
+        mData.erase(mData.begin(), mData.begin() + copied);
+        return copied;
+    }
+    int onGuestSend(const AndroidPipeBuffer* buffers,
+                    int numBuffers,
+                    void** newPipePtr) override {
+        size_t total = 0;
+        for (int i = 0; i < numBuffers; i++) {
+            mData.insert(mData.end(), buffers[i].data, buffers[i].data + buffers[i].size);
+            total += buffers[i].size;
+        }
+        return total;
+    }
+    void onGuestWantWakeOn(int flags) override {}
+    void onSave(base::Stream* stream) override {
+        stream->putBe32(42);
+        for (uint32_t i = 0; i < mPadding; ++i) {
+            stream->putByte(0);
+        }
+    }
+
+private:
+    const uint32_t mPadding;
+    std::vector<uint8_t> mData;
+};
+
+class EchoService : public AndroidPipe::Service {
+public:
+    EchoService() : Service("androidPipeTestEcho") {}
+
+    AndroidPipe* create(void* hwPipe, const char* args,
+                        enum AndroidPipeFlags flags) override {
+        return new EchoPipe(hwPipe, this, padding);
+    }
+    bool canLoad() const override { return true; }
+    bool canUseBulkRing() const override { return true; }
+    AndroidPipe* load(void* hwPipe, const char* args, base::Stream* stream) override {
+        EXPECT_EQ(42u, stream->getBe32());
+        return new EchoPipe(hwPipe, this, padding);
+    }
+
+    uint32_t padding = 0;
+};
+
+uint32_t getGuestPageSize() {
+    return 4096;
+}
+
+constexpr uint32_t kRingSize = 64 * 1024;
+constexpr uint64_t kRingGpa = 0x100000000ull;
+
+class AndroidPipeTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        emulation::injectGraphicsAgents(emulation::MockGraphicsAgentFactory());
+        emulation::goldfish_address_space_set_vm_operations(getGraphicsAgents()->vm);
+    }
+
+    void SetUp() override {
+        auto service = std::make_unique<EchoService>();
+        mService = service.get();
+        AndroidPipe::Service::add(std::move(service));
+        mHwFuncs.getGuestPageSize = &getGuestPageSize;
+        mAllocator = std::make_unique<AddressSpaceHostMemoryAllocatorContext>(
+                get_address_space_device_control_ops(), &mHwFuncs);
+    }
+
+    void TearDown() override {
+        mAllocator.reset();
+        android_pipe_reset_services();
+    }
+
+    // Has the guest allocate |size| bytes at |gpa| from the host memory
+    // allocator, and returns where they are.
+    char* allocate(uint64_t gpa, uint64_t size) {
+        AddressSpaceDevicePingInfo request = {};
+        request.metadata = static_cast<uint64_t>(
+                AddressSpaceHostMemoryAllocatorContext::HostMemoryAllocatorCommand::Allocate);
+        request.phys_addr = gpa;
+        request.size = size;
+        mAllocator->perform(&request);
+        EXPECT_EQ(0u, request.metadata);
+        return static_cast<char*>(get_address_space_device_control_ops()->get_host_ptr(gpa));
+    }
+
+    void unallocate(uint64_t gpa) {
+        AddressSpaceDevicePingInfo request = {};
+        request.metadata = static_cast<uint64_t>(
+                AddressSpaceHostMemoryAllocatorContext::HostMemoryAllocatorCommand::Unallocate);
+        request.phys_addr = gpa;
+        mAllocator->perform(&request);
+        EXPECT_EQ(0u, request.metadata);
+    }
+
+    // Allocates the rings at kRingGpa and fills in their header.
+    android_pipe_bulk_rings allocateRings() {
+        char* storage = allocate(kRingGpa, android_pipe_bulk_storage_size(kRingSize));
+        android_pipe_bulk_rings rings = android_pipe_bulk_rings_create(storage, kRingSize);
+        *rings.header = {ANDROID_PIPE_BULK_MAGIC, ANDROID_PIPE_BULK_VERSION, kRingSize,
+                         ANDROID_PIPE_BULK_OFFERED};
+        return rings;
+    }
+
+    // Opens a pipe to the echo service asking for bulk mode, as a guest
+    // would.
+    void* connectWithBulkRing() {
+        std::vector<uint8_t> handshake(
+                AndroidPipe::kBulkConnectMagic,
+                AndroidPipe::kBulkConnectMagic + sizeof(AndroidPipe::kBulkConnectMagic));
+        const uint64_t fields[] = {AndroidPipe::Service::idForName(mService->name().c_str()), 0};
+        for (uint64_t value : fields) {
+            for (int shift = 0; shift < 32; shift += 8) {
+                handshake.push_back(static_cast<uint8_t>(value >> shift));
+            }
+        }
+        for (int shift = 0; shift < 64; shift += 8) {
+            handshake.push_back(static_cast<uint8_t>(kRingGpa >> shift));
+        }
+        void* pipe = android_pipe_guest_open(&mHwPipe);
+        const AndroidPipeBuffer buffer = {handshake.data(), handshake.size()};
+        EXPECT_EQ(int(handshake.size()), android_pipe_guest_send(&pipe, &buffer, 1));
+        return pipe;
+    }
+
+    static int ringDoorbell(void** pipe) {
+        uint8_t doorbell = 0;
+        const AndroidPipeBuffer buffer = {&doorbell, 1};
+        return android_pipe_guest_send(pipe, &buffer, 1);
+    }
+
+    // Returns how many bytes the host added to the from_host ring, or an
+    // error.
+    static int readDoorbell(void* pipe) {
+        uint8_t added[4] = {};
+        AndroidPipeBuffer buffer = {added, sizeof(added)};
+        const int result = android_pipe_guest_recv(pipe, &buffer, 1);
+        if (result < 0) {
+            return result;
+        }
+        EXPECT_EQ(4, result);
+        return added[0] | added[1] << 8 | added[2] << 16 | added[3] << 24;
+    }
+
+    static std::unique_ptr<MemStream> save(void* pipe) {
+        auto stream = std::make_unique<MemStream>();
+        static_cast<AndroidPipe*>(pipe)->saveToStream(stream.get());
+        return stream;
+    }
+
+    EchoService* mService = nullptr;
+    AddressSpaceHwFuncs mHwFuncs = {};
+    std::unique_ptr<AddressSpaceHostMemoryAllocatorContext> mAllocator;
+    // Only its address matters.
+    int mHwPipe = 0;
+};
+
+// Tests that a pipe in bulk mode moves its payload through the shared
+// rings, a ring full per doorbell.
+TEST_F(AndroidPipeTest, BulkRing) {
+    android_pipe_bulk_rings rings = allocateRings();
+    void* pipe = connectWithBulkRing();
+    ASSERT_TRUE(static_cast<AndroidPipe*>(pipe)->hasBulkRing());
+    EXPECT_EQ(uint32_t(ANDROID_PIPE_BULK_ACCEPTED), rings.header->status);
+
+    // Enough rounds for both rings to wrap.
+    std::vector<uint8_t> payload(40000);
+    for (int round = 0; round < 3; ++round) {
+        for (size_t i = 0; i < payload.size(); ++i) {
+            payload[i] = static_cast<uint8_t>(i * 7 + round);
+        }
+        ASSERT_EQ(1, ring_buffer_view_write(rings.to_host.ring, &rings.to_host.view,
+                                            payload.data(), payload.size(), 1));
+        EXPECT_EQ(1, ringDoorbell(&pipe));
+        EXPECT_EQ(0u, ring_buffer_available_read(rings.to_host.ring, &rings.to_host.view));
+
+        EXPECT_EQ(int(payload.size()), readDoorbell(pipe));
+        std::vector<uint8_t> echoed(payload.size());
+        ASSERT_EQ(1, ring_buffer_view_read(rings.from_host.ring, &rings.from_host.view,
+                                           echoed.data(), echoed.size(), 1));
+        EXPECT_EQ(payload, echoed);
+
+        // Nothing more to read: the guest waits for a wake.
+        EXPECT_EQ(PIPE_ERROR_AGAIN, readDoorbell(pipe));
+    }
+
+    android_pipe_guest_close(pipe, PIPE_CLOSE_GRACEFUL);
+    unallocate(kRingGpa);
+}
+
+// Tests that the pipe notices when the guest frees the block its rings are
+// in, instead of using the freed host memory, and that unrelated mapping
+// changes don't disturb it.
+TEST_F(AndroidPipeTest, BulkRingUnallocated) {
+    android_pipe_bulk_rings rings = allocateRings();
+    void* pipe = connectWithBulkRing();
+    ASSERT_TRUE(static_cast<AndroidPipe*>(pipe)->hasBulkRing());
+
+    constexpr uint64_t kOtherGpa = 0x200000000ull;
+    allocate(kOtherGpa, 4096);
+    const uint8_t data[] = {1, 2, 3};
+    ASSERT_EQ(1, ring_buffer_view_write(rings.to_host.ring, &rings.to_host.view, data,
+                                        sizeof(data), 1));
+    EXPECT_EQ(1, ringDoorbell(&pipe));
+    EXPECT_EQ(int(sizeof(data)), readDoorbell(pipe));
+    unallocate(kOtherGpa);
+
+    unallocate(kRingGpa);
+    EXPECT_EQ(PIPE_ERROR_IO, ringDoorbell(&pipe));
+    EXPECT_EQ(PIPE_ERROR_IO, readDoorbell(pipe));
+
+    // A smaller block in the same place doesn't bring the rings back.
+    allocate(kRingGpa, 4096);
+    EXPECT_EQ(PIPE_ERROR_IO, ringDoorbell(&pipe));
+    EXPECT_EQ(PIPE_ERROR_IO, readDoorbell(pipe));
+
+    android_pipe_guest_close(pipe, PIPE_CLOSE_GRACEFUL);
+    unallocate(kRingGpa);
+}
+
+// Tests that a snapshot keeps a pipe in bulk mode, and that a plain pipe
+// whose service loads less than it saved stays a plain pipe.
+TEST_F(AndroidPipeTest, SaveLoad) {
+    allocateRings();
+    void* bulkPipe = connectWithBulkRing();
+    ASSERT_TRUE(static_cast<AndroidPipe*>(bulkPipe)->hasBulkRing());
+    auto bulkState = save(bulkPipe);
+    android_pipe_guest_close(bulkPipe, PIPE_CLOSE_GRACEFUL);
+
+    char forceClose = 1;
+    auto* loaded = AndroidPipe::loadFromStream(bulkState.get(), &mHwPipe, &forceClose);
+    ASSERT_TRUE(loaded);
+    EXPECT_EQ(0, forceClose);
+    EXPECT_TRUE(loaded->hasBulkRing());
+    loaded->onGuestClose(PIPE_CLOSE_GRACEFUL);
+
+    // The leftover bytes look just like a saved ring address of 0.
+    mService->padding = 8;
+    void* plainPipe = android_pipe_guest_open(&mHwPipe);
+    const char connect[] = "pipe:androidPipeTestEcho";
+    const AndroidPipeBuffer buffer = {(uint8_t*)connect, sizeof(connect)};
+    ASSERT_EQ(int(sizeof(connect)), android_pipe_guest_send(&plainPipe, &buffer, 1));
+    auto plainState = save(plainPipe);
+    android_pipe_guest_close(plainPipe, PIPE_CLOSE_GRACEFUL);
+
+    forceClose = 1;
+    loaded = AndroidPipe::loadFromStream(plainState.get(), &mHwPipe, &forceClose);
+    ASSERT_TRUE(loaded);
+    EXPECT_EQ(0, forceClose);
+    EXPECT_FALSE(loaded->hasBulkRing());
+    loaded->onGuestClose(PIPE_CLOSE_GRACEFUL);
+
+    unallocate(kRingGpa);
+}
+
+}  // namespace
+}  // namespace android
@@ -0,0 +1,149 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/AsyncMessageBatch.h"
+
+#include <algorithm>
+
+#include <string.h>
+
+namespace android {
+
+namespace {
+
+void putLe16(uint8_t* out, uint16_t value) {
+    out[0] = uint8_t(value);
+    out[1] = uint8_t(value >> 8);
+}
+
+void putLe32(uint8_t* out, uint32_t value) {
+    out[0] = uint8_t(value);
+    out[1] = uint8_t(value >> 8);
+    out[2] = uint8_t(value >> 16);
+    out[3] = uint8_t(value >> 24);
+}
+
+uint16_t getLe16(const uint8_t* in) {
+    return uint16_t(in[0] | (in[1] << 8));
+}
+
+uint32_t getLe32(const uint8_t* in) {
+    return uint32_t(in[0]) | (uint32_t(in[1]) << 8) |
+           (uint32_t(in[2]) << 16) | (uint32_t(in[3]) << 24);
+}
+
+template <class Message, class SizeOf, class DataOf>
+size_t encodeMessages(const Message* messages,
+                      size_t count,
+                      std::vector<uint8_t>* out,
+                      SizeOf sizeOf,
+                      DataOf dataOf) {
+    count = std::min(count, AsyncMessageBatch::kMaxMessages);
+    size_t totalBytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        totalBytes += sizeOf(messages[i]);
+    }
+
+    // One resize for the whole batch, then fill it in place.
+    size_t pos = out->size();
+    out->resize(pos + AsyncMessageBatch::encodedSize(count, totalBytes));
+    uint8_t* dst = out->data();
+    putLe32(dst + pos, AsyncMessageBatch::kMagic);
+    putLe16(dst + pos + 4, AsyncMessageBatch::kVersion);
+    putLe16(dst + pos + 6, uint16_t(count));
+    pos += AsyncMessageBatch::kHeaderSize;
+    for (size_t i = 0; i < count; ++i) {
+        const size_t size = sizeOf(messages[i]);
+        putLe32(dst + pos, uint32_t(size));
+        pos += sizeof(uint32_t);
+        if (size) {
+            memcpy(dst + pos, dataOf(messages[i]), size);
+        }
+        pos += size;
+    }
+    return count;
+}
+
+}  // namespace
+
+// static
+std::vector<uint8_t> AsyncMessageBatch::hello() {
+    std::vector<uint8_t> result(kHeaderSize);
+    putLe32(result.data(), kMagic);
+    putLe16(result.data() + 4, kVersion);
+    putLe16(result.data() + 6, 0);
+    return result;
+}
+
+// static
+bool AsyncMessageBatch::isHello(const uint8_t* data, size_t size) {
+    return size == kHeaderSize && getLe32(data) == kMagic &&
+           getLe16(data + 4) == kVersion && getLe16(data + 6) == 0;
+}
+
+// static
+size_t AsyncMessageBatch::encode(const AsyncMessageView* messages,
+                                 size_t count,
+                                 std::vector<uint8_t>* out) {
+    return encodeMessages(
+            messages, count, out,
+            [](const AsyncMessageView& m) { return m.size; },
+            [](const AsyncMessageView& m) { return m.data; });
+}
+
+// static
+size_t AsyncMessageBatch::encode(const std::vector<uint8_t>* messages,
+                                 size_t count,
+                                 std::vector<uint8_t>* out) {
+    return encodeMessages(
+            messages, count, out,
+            [](const std::vector<uint8_t>& m) { return m.size(); },
+            [](const std::vector<uint8_t>& m) { return m.data(); });
+}
+
+// static
+bool AsyncMessageBatch::decode(const uint8_t* data,
+                               size_t size,
+                               std::vector<AsyncMessageView>* out) {
+    out->clear();
+    if (size < kHeaderSize || getLe32(data) != kMagic ||
+        getLe16(data + 4) != kVersion) {
+        return false;
+    }
+    const size_t count = getLe16(data + 6);
+    size_t pos = kHeaderSize;
+    out->reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (size - pos < sizeof(uint32_t)) {
+            out->clear();
+            return false;
+        }
+        const size_t length = getLe32(data + pos);
+        pos += sizeof(uint32_t);
+        if (size - pos < length) {
+            out->clear();
+            return false;
+        }
+        out->push_back({data + pos, length});
+        pos += length;
+    }
+    if (pos != size) {
+        out->clear();
+        return false;
+    }
+    return true;
+}
+
+}  // namespace android
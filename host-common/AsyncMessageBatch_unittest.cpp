@@ -0,0 +1,108 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/AsyncMessageBatch.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace android {
+namespace {
+
+std::vector<uint8_t> bytes(const std::string& s) {
+    return std::vector<uint8_t>(s.begin(), s.end());
+}
+
+std::string str(const AsyncMessageView& view) {
+    return std::string(reinterpret_cast<const char*>(view.data), view.size);
+}
+
+// Tests that messages survive a round trip, empty ones included.
+TEST(AsyncMessageBatch, RoundTrip) {
+    const std::vector<uint8_t> messages[] = {bytes("accel 0.1 9.8 0"),
+                                             bytes(""), bytes("gyro 0 0 0")};
+    std::vector<uint8_t> packet;
+    EXPECT_EQ(3u, AsyncMessageBatch::encode(messages, 3, &packet));
+    EXPECT_EQ(AsyncMessageBatch::encodedSize(3, 25), packet.size());
+    // Little-endian magic first, as documented.
+    EXPECT_EQ('A', packet[0]);
+    EXPECT_EQ('1', packet[3]);
+
+    std::vector<AsyncMessageView> views;
+    ASSERT_TRUE(AsyncMessageBatch::decode(packet.data(), packet.size(),
+                                          &views));
+    ASSERT_EQ(3u, views.size());
+    EXPECT_EQ("accel 0.1 9.8 0", str(views[0]));
+    EXPECT_EQ("", str(views[1]));
+    EXPECT_EQ("gyro 0 0 0", str(views[2]));
+
+    const AsyncMessageView more[] = {{packet.data(), 4}};
+    std::vector<uint8_t> other;
+    EXPECT_EQ(1u, AsyncMessageBatch::encode(more, 1, &other));
+    ASSERT_TRUE(AsyncMessageBatch::decode(other.data(), other.size(),
+                                          &views));
+    ASSERT_EQ(1u, views.size());
+    EXPECT_EQ(4u, views[0].size);
+}
+
+TEST(AsyncMessageBatch, RejectsMalformed) {
+    const std::vector<uint8_t> messages[] = {bytes("hello"), bytes("world")};
+    std::vector<uint8_t> packet;
+    AsyncMessageBatch::encode(messages, 2, &packet);
+
+    std::vector<AsyncMessageView> views;
+    for (size_t size = 0; size < packet.size(); ++size) {
+        EXPECT_FALSE(AsyncMessageBatch::decode(packet.data(), size, &views))
+                << size;
+        EXPECT_TRUE(views.empty());
+    }
+    packet.push_back(0);
+    EXPECT_FALSE(AsyncMessageBatch::decode(packet.data(), packet.size(),
+                                           &views));
+    const std::vector<uint8_t> plain = bytes("just a message");
+    EXPECT_FALSE(AsyncMessageBatch::decode(plain.data(), plain.size(),
+                                           &views));
+}
+
+TEST(AsyncMessageBatch, Hello) {
+    const std::vector<uint8_t> hello = AsyncMessageBatch::hello();
+    EXPECT_TRUE(AsyncMessageBatch::isHello(hello.data(), hello.size()));
+    std::vector<AsyncMessageView> views;
+    EXPECT_TRUE(AsyncMessageBatch::decode(hello.data(), hello.size(), &views));
+    EXPECT_TRUE(views.empty());
+
+    const std::vector<uint8_t> one[] = {bytes("x")};
+    std::vector<uint8_t> packet;
+    AsyncMessageBatch::encode(one, 1, &packet);
+    EXPECT_FALSE(AsyncMessageBatch::isHello(packet.data(), packet.size()));
+}
+
+// Tests that a batch stops at kMaxMessages and the rest is left over.
+TEST(AsyncMessageBatch, Limit) {
+    std::vector<std::vector<uint8_t>> messages(
+            AsyncMessageBatch::kMaxMessages + 10, bytes("m"));
+    std::vector<uint8_t> packet;
+    EXPECT_EQ(AsyncMessageBatch::kMaxMessages,
+              AsyncMessageBatch::encode(messages.data(), messages.size(),
+                                        &packet));
+    std::vector<AsyncMessageView> views;
+    ASSERT_TRUE(AsyncMessageBatch::decode(packet.data(), packet.size(),
+                                          &views));
+    EXPECT_EQ(AsyncMessageBatch::kMaxMessages, views.size());
+}
+
+}  // namespace
+}  // namespace android
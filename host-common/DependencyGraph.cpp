@@ -0,0 +1,194 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/DependencyGraph.h"
+
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/system/System.h"
+#include "aemu/base/threads/ThreadPool.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
+namespace android {
+
+using base::AutoLock;
+
+bool resolveDependencyGraph(const std::vector<std::string>& names,
+                            const std::vector<const std::vector<std::string>*>& dependsOn,
+                            std::vector<std::vector<size_t>>* deps) {
+    const size_t count = names.size();
+    std::unordered_map<std::string, size_t> index;
+    for (size_t i = 0; i < count; ++i) {
+        index[names[i]] = i;
+    }
+    deps->assign(count, {});
+    for (size_t i = 0; i < count; ++i) {
+        for (const std::string& name : *dependsOn[i]) {
+            auto it = index.find(name);
+            if (it != index.end()) {
+                (*deps)[i].push_back(it->second);
+            }
+        }
+    }
+
+    // Kahn's algorithm, just to reject cycles before anything runs.
+    std::vector<size_t> remaining(count);
+    std::vector<std::vector<size_t>> dependents(count);
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < count; ++i) {
+        remaining[i] = (*deps)[i].size();
+        for (size_t dep : (*deps)[i]) {
+            dependents[dep].push_back(i);
+        }
+        if (!remaining[i]) {
+            ready.push_back(i);
+        }
+    }
+    size_t visited = 0;
+    while (!ready.empty()) {
+        const size_t i = ready.back();
+        ready.pop_back();
+        ++visited;
+        for (size_t dependent : dependents[i]) {
+            if (!--remaining[dependent]) {
+                ready.push_back(dependent);
+            }
+        }
+    }
+    return visited == count;
+}
+
+void runDependencyGraph(const std::vector<std::vector<size_t>>& deps,
+                        const std::vector<bool>& active,
+                        const std::vector<bool>& concurrent,
+                        int threads,
+                        const std::function<void(size_t)>& fn,
+                        std::vector<uint64_t>* durationsUs) {
+    const size_t count = deps.size();
+    durationsUs->assign(count, 0);
+
+    std::vector<size_t> remaining(count, 0);
+    std::vector<std::vector<size_t>> dependents(count);
+    size_t concurrentCount = 0;
+    size_t activeCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!active[i]) {
+            continue;
+        }
+        ++activeCount;
+        concurrentCount += concurrent[i];
+        for (size_t dep : deps[i]) {
+            if (active[dep]) {
+                ++remaining[i];
+                dependents[dep].push_back(i);
+            }
+        }
+    }
+
+    if (threads <= 0) {
+        threads = std::max(1, base::getCpuCoreCount());
+    }
+    threads = std::min<int>(threads, concurrentCount);
+
+    base::Lock lock;
+    base::ConditionVariable cv;
+    size_t finished = 0;
+    // Ready nodes for the calling thread; with no pool, all of them.
+    std::deque<size_t> readyHere;
+    std::unique_ptr<base::ThreadPool<std::function<void()>>> pool;
+
+    auto runOne = [&fn, durationsUs](size_t i) {
+        const uint64_t begin = base::getHighResTimeUs();
+        fn(i);
+        (*durationsUs)[i] = base::getHighResTimeUs() - begin;
+    };
+
+    // Set below, once |pool| exists.
+    std::function<void(size_t)> makeReady;
+    auto complete = [&](size_t i) {
+        std::vector<size_t> nowReady;
+        {
+            AutoLock autoLock(lock);
+            for (size_t dependent : dependents[i]) {
+                if (!--remaining[dependent]) {
+                    nowReady.push_back(dependent);
+                }
+            }
+            ++finished;
+        }
+        for (size_t ready : nowReady) {
+            makeReady(ready);
+        }
+        AutoLock autoLock(lock);
+        cv.broadcastAndUnlock(&autoLock);
+    };
+
+    if (threads > 1) {
+        pool.reset(new base::ThreadPool<std::function<void()>>(
+                threads, [](std::function<void()>&& task) { task(); }));
+        if (!pool->start()) {
+            pool.reset();
+        }
+    }
+    makeReady = [&](size_t i) {
+        if (pool && concurrent[i]) {
+            pool->enqueue([&runOne, &complete, i] {
+                runOne(i);
+                complete(i);
+            });
+            return;
+        }
+        AutoLock autoLock(lock);
+        readyHere.push_back(i);
+        cv.broadcastAndUnlock(&autoLock);
+    };
+
+    // Find the roots before starting any, since workers update |remaining|.
+    std::vector<size_t> roots;
+    for (size_t i = 0; i < count; ++i) {
+        if (active[i] && !remaining[i]) {
+            roots.push_back(i);
+        }
+    }
+    for (size_t i : roots) {
+        makeReady(i);
+    }
+    for (;;) {
+        size_t next;
+        {
+            AutoLock autoLock(lock);
+            cv.wait(&autoLock, [&] {
+                return !readyHere.empty() || finished == activeCount;
+            });
+            if (readyHere.empty()) {
+                break;
+            }
+            next = readyHere.front();
+            readyHere.pop_front();
+        }
+        runOne(next);
+        complete(next);
+    }
+    if (pool) {
+        pool->done();
+        pool->join();
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,156 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/DeviceContextRunner.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace {
+
+class FakeVmLock : public VmLock {
+public:
+    bool isLockedBySelf() const override { return locked; }
+    bool locked = false;
+};
+
+class TestRunner : public DeviceContextRunner<int> {
+public:
+    explicit TestRunner(VmLock* vmLock) {
+        init(vmLock, {
+                [this](DeviceContextRunner<int>*, std::function<void()> func) {
+                    mFire = std::move(func);
+                },
+                [](DeviceContextRunner<int>*) {},
+                [this](DeviceContextRunner<int>*, uint64_t) { ++timerStarts; },
+        });
+    }
+
+    using DeviceContextRunner<int>::numPending;
+    using DeviceContextRunner<int>::queueDeviceOperation;
+    using DeviceContextRunner<int>::queueDeviceOperations;
+    using DeviceContextRunner<int>::removeAllPendingOperations;
+
+    void fireTimer() { mFire(); }
+
+    std::vector<int> performed;
+    std::vector<size_t> batches;
+    int timerStarts = 0;
+
+private:
+    void performDeviceOperation(const int& op) override {
+        performed.push_back(op);
+    }
+
+    void performDeviceOperations(const int* ops, size_t count) override {
+        batches.push_back(count);
+        DeviceContextRunner<int>::performDeviceOperations(ops, count);
+    }
+
+    std::function<void()> mFire;
+};
+
+TEST(DeviceContextRunner, ImmediateWhenLocked) {
+    FakeVmLock vmLock;
+    vmLock.locked = true;
+    TestRunner runner(&vmLock);
+    runner.queueDeviceOperation(1);
+    EXPECT_EQ(std::vector<int>({1}), runner.performed);
+    EXPECT_EQ(0, runner.timerStarts);
+
+    runner.setContextRunMode(ContextRunMode::DeferAlways);
+    runner.queueDeviceOperation(2);
+    EXPECT_EQ(1u, runner.performed.size());
+    EXPECT_EQ(1u, runner.numPending());
+}
+
+// Tests that queued operations arm the timer once and arrive as one batch
+// in queue order.
+TEST(DeviceContextRunner, BatchesInOrder) {
+    FakeVmLock vmLock;
+    TestRunner runner(&vmLock);
+    for (int i = 0; i < 5; ++i) {
+        runner.queueDeviceOperation(i);
+    }
+    EXPECT_EQ(1, runner.timerStarts);
+    EXPECT_EQ(5u, runner.numPending());
+    runner.removeAllPendingOperations([](int op) { return op == 3; });
+    runner.queueDeviceOperation(5);
+
+    runner.fireTimer();
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 4, 5}), runner.performed);
+    EXPECT_EQ(std::vector<size_t>({5}), runner.batches);
+    EXPECT_EQ(0u, runner.numPending());
+
+    runner.fireTimer();
+    EXPECT_EQ(1u, runner.batches.size());
+    runner.queueDeviceOperation(6);
+    EXPECT_EQ(2, runner.timerStarts);
+}
+
+// Tests that a queued batch keeps its order behind earlier operations.
+TEST(DeviceContextRunner, QueueBatch) {
+    FakeVmLock vmLock;
+    TestRunner runner(&vmLock);
+    const int ops[] = {1, 2, 3};
+    runner.queueDeviceOperation(0);
+    runner.queueDeviceOperations(ops, 3);
+    runner.queueDeviceOperations(ops, 0);
+    runner.queueDeviceOperation(4);
+    EXPECT_EQ(1, runner.timerStarts);
+
+    runner.fireTimer();
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4}), runner.performed);
+
+    vmLock.locked = true;
+    runner.queueDeviceOperations(ops, 3);
+    EXPECT_EQ(std::vector<size_t>({5, 3}), runner.batches);
+}
+
+TEST(DeviceContextRunner, ConcurrentProducers) {
+    FakeVmLock vmLock;
+    TestRunner runner(&vmLock);
+    constexpr int kThreads = 4;
+    constexpr int kPerThread = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&runner, t] {
+            for (int i = 0; i < kPerThread; ++i) {
+                runner.queueDeviceOperation(t * kPerThread + i);
+            }
+        });
+    }
+    // Drain while producers are still going.
+    for (int i = 0; i < 10; ++i) {
+        runner.fireTimer();
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    runner.fireTimer();
+
+    ASSERT_EQ(size_t(kThreads * kPerThread), runner.performed.size());
+    std::vector<int> last(kThreads, -1);
+    for (int op : runner.performed) {
+        EXPECT_LT(last[op / kPerThread], op);
+        last[op / kPerThread] = op;
+    }
+}
+
+}  // namespace
+}  // namespace android
@@ -0,0 +1,286 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/DisplayDamage.h"
+
+#include "host-common/display_agent.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace android {
+namespace emulation {
+
+using base::AutoLock;
+
+namespace {
+
+DamageRect unite(const DamageRect& a, const DamageRect& b) {
+    const int x = std::min(a.x, b.x);
+    const int y = std::min(a.y, b.y);
+    return {x, y, std::max(a.right(), b.right()) - x,
+            std::max(a.bottom(), b.bottom()) - y};
+}
+
+DamageRect intersect(const DamageRect& a, const DamageRect& b) {
+    const int x = std::max(a.x, b.x);
+    const int y = std::max(a.y, b.y);
+    return {x, y, std::min(a.right(), b.right()) - x,
+            std::min(a.bottom(), b.bottom()) - y};
+}
+
+// Overlapping or sharing an edge.
+bool touches(const DamageRect& a, const DamageRect& b) {
+    return a.x <= b.right() && b.x <= a.right() && a.y <= b.bottom() &&
+           b.y <= a.bottom();
+}
+
+// Pixels the bounding box of |a| and |b| has that neither of them does.
+int64_t waste(const DamageRect& a, const DamageRect& b) {
+    return unite(a, b).area() - a.area() - b.area() + intersect(a, b).area();
+}
+
+constexpr DamageRect kUnboundedRect = {0, 0, std::numeric_limits<int>::max(),
+                                       std::numeric_limits<int>::max()};
+
+}  // namespace
+
+DamageRegion::DamageRegion(size_t maxRects)
+    : mMaxRects(std::max<size_t>(maxRects, 1)) {}
+
+void DamageRegion::add(const DamageRect& newRect) {
+    if (newRect.empty()) {
+        return;
+    }
+    DamageRect rect = newRect;
+    for (size_t i = 0; i < mRects.size();) {
+        const DamageRect& other = mRects[i];
+        if (other.contains(rect)) {
+            return;
+        }
+        // Merge when the bounding box is at most a quarter bigger than what
+        // the two cover.
+        if (rect.contains(other) ||
+            (touches(rect, other) &&
+             waste(rect, other) * 4 <=
+                     rect.area() + other.area() -
+                             intersect(rect, other).area())) {
+            rect = unite(rect, other);
+            mRects[i] = mRects.back();
+            mRects.pop_back();
+            // The bigger rect may now reach ones already passed.
+            i = 0;
+            continue;
+        }
+        ++i;
+    }
+    mRects.push_back(rect);
+
+    while (mRects.size() > mMaxRects) {
+        size_t bestI = 0;
+        size_t bestJ = 1;
+        int64_t bestWaste = std::numeric_limits<int64_t>::max();
+        for (size_t i = 0; i < mRects.size(); ++i) {
+            for (size_t j = i + 1; j < mRects.size(); ++j) {
+                const int64_t w = waste(mRects[i], mRects[j]);
+                if (w < bestWaste) {
+                    bestWaste = w;
+                    bestI = i;
+                    bestJ = j;
+                }
+            }
+        }
+        mergeAt(bestI, bestJ);
+    }
+}
+
+void DamageRegion::mergeAt(size_t i, size_t j) {
+    const DamageRect merged = unite(mRects[i], mRects[j]);
+    mRects.erase(mRects.begin() + j);
+    mRects.erase(mRects.begin() + i);
+    add(merged);
+}
+
+int64_t DamageRegion::area() const {
+    int64_t total = 0;
+    for (const DamageRect& rect : mRects) {
+        total += rect.area();
+    }
+    return total;
+}
+
+DamageRect DamageRegion::bounds() const {
+    if (mRects.empty()) {
+        return {};
+    }
+    DamageRect result = mRects[0];
+    for (const DamageRect& rect : mRects) {
+        result = unite(result, rect);
+    }
+    return result;
+}
+
+DisplayDamageTracker::~DisplayDamageTracker() {
+    detach();
+}
+
+// static
+DisplayDamageTracker& DisplayDamageTracker::get() {
+    // Leaked: display callbacks may still arrive during static destruction.
+    static DisplayDamageTracker* const sInstance = new DisplayDamageTracker();
+    return *sInstance;
+}
+
+void DisplayDamageTracker::setDisplaySize(uint32_t displayId,
+                                          int width,
+                                          int height) {
+    AutoLock lock(mLock);
+    Display& display = mDisplays[displayId];
+    if (display.width == width && display.height == height) {
+        return;
+    }
+    display.width = width;
+    display.height = height;
+    display.region.clear();
+    display.region.add({0, 0, width, height});
+}
+
+void DisplayDamageTracker::addDamage(uint32_t displayId,
+                                     int x,
+                                     int y,
+                                     int w,
+                                     int h) {
+    AutoLock lock(mLock);
+    addDamageLocked(&mDisplays[displayId], {x, y, w, h});
+}
+
+void DisplayDamageTracker::invalidate(uint32_t displayId) {
+    AutoLock lock(mLock);
+    Display& display = mDisplays[displayId];
+    display.region.clear();
+    if (display.width > 0 && display.height > 0) {
+        display.region.add({0, 0, display.width, display.height});
+    } else {
+        display.region.add(kUnboundedRect);
+    }
+}
+
+void DisplayDamageTracker::addDamageLocked(Display* display, DamageRect rect) {
+    if (display->width > 0 && display->height > 0) {
+        rect = intersect(rect, {0, 0, display->width, display->height});
+    }
+    display->region.add(rect);
+}
+
+void DisplayDamageTracker::takeRegionLocked(
+        uint32_t displayId,
+        Display* display,
+        std::vector<std::pair<uint32_t, DamageRegion>>* out) {
+    if (display->region.empty()) {
+        return;
+    }
+    const int64_t displayArea = int64_t(display->width) * display->height;
+    if (displayArea > 0 &&
+        display->region.area() * 100 > displayArea * kFullDisplayPercent) {
+        display->region.clear();
+        display->region.add({0, 0, display->width, display->height});
+    }
+    out->emplace_back(displayId, std::move(display->region));
+    display->region = DamageRegion();
+}
+
+void DisplayDamageTracker::flush() {
+    std::vector<std::pair<uint32_t, DamageRegion>> regions;
+    {
+        AutoLock lock(mLock);
+        for (auto& kv : mDisplays) {
+            takeRegionLocked(kv.first, &kv.second, &regions);
+        }
+    }
+    notify(regions);
+}
+
+void DisplayDamageTracker::flush(uint32_t displayId) {
+    std::vector<std::pair<uint32_t, DamageRegion>> regions;
+    {
+        AutoLock lock(mLock);
+        auto it = mDisplays.find(displayId);
+        if (it != mDisplays.end()) {
+            takeRegionLocked(displayId, &it->second, &regions);
+        }
+    }
+    notify(regions);
+}
+
+void DisplayDamageTracker::notify(
+        const std::vector<std::pair<uint32_t, DamageRegion>>& regions) {
+    if (regions.empty()) {
+        return;
+    }
+    // Called unlocked, so listeners may add damage or remove themselves.
+    std::vector<std::pair<int, Listener>> listeners;
+    {
+        AutoLock lock(mLock);
+        listeners = mListeners;
+    }
+    for (const auto& region : regions) {
+        for (const auto& listener : listeners) {
+            listener.second(region.first, region.second);
+        }
+    }
+}
+
+int DisplayDamageTracker::addListener(Listener listener) {
+    AutoLock lock(mLock);
+    const int id = mNextListenerId++;
+    mListeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+void DisplayDamageTracker::removeListener(int id) {
+    AutoLock lock(mLock);
+    mListeners.erase(std::remove_if(mListeners.begin(), mListeners.end(),
+                                    [id](const std::pair<int, Listener>& l) {
+                                        return l.first == id;
+                                    }),
+                     mListeners.end());
+}
+
+void DisplayDamageTracker::attach(const QAndroidDisplayAgent* agent) {
+    detach();
+    mAgent = agent;
+    if (mAgent && mAgent->registerUpdateListener) {
+        mAgent->registerUpdateListener(&onDisplayUpdate, this);
+    }
+}
+
+void DisplayDamageTracker::detach() {
+    if (mAgent && mAgent->unregisterUpdateListener) {
+        mAgent->unregisterUpdateListener(&onDisplayUpdate);
+    }
+    mAgent = nullptr;
+}
+
+// static
+void DisplayDamageTracker::onDisplayUpdate(void* opaque,
+                                           int x,
+                                           int y,
+                                           int w,
+                                           int h) {
+    static_cast<DisplayDamageTracker*>(opaque)->addDamage(0, x, y, w, h);
+}
+
+}  // namespace emulation
+}  // namespace android
@@ -0,0 +1,107 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/DisplayDamage.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using android::emulation::DamageRect;
+using android::emulation::DamageRegion;
+using android::emulation::DisplayDamageTracker;
+
+// Tests that covered, adjacent and overlapping rects collapse.
+TEST(DamageRegion, Coalesces) {
+    DamageRegion region;
+    region.add({10, 10, 100, 20});
+    region.add({20, 12, 10, 5});
+    ASSERT_EQ(1u, region.rects().size());
+
+    region.add({110, 10, 50, 20});
+    ASSERT_EQ(1u, region.rects().size());
+    EXPECT_EQ((DamageRect{10, 10, 150, 20}), region.rects()[0]);
+
+    // Far apart: kept separate rather than damaging everything in between.
+    region.add({500, 900, 10, 10});
+    EXPECT_EQ(2u, region.rects().size());
+    EXPECT_EQ((DamageRect{10, 10, 500, 900}), region.bounds());
+
+    region.add({0, 0, 0, 10});
+    EXPECT_EQ(2u, region.rects().size());
+
+    region.clear();
+    EXPECT_TRUE(region.empty());
+}
+
+// Tests that the list stays bounded and still covers everything.
+TEST(DamageRegion, Bounded) {
+    DamageRegion region(4);
+    std::vector<DamageRect> added;
+    for (int i = 0; i < 20; ++i) {
+        const DamageRect rect = {(i % 5) * 200, (i / 5) * 300, 8, 8};
+        added.push_back(rect);
+        region.add(rect);
+        EXPECT_LE(region.rects().size(), 4u);
+    }
+    for (const DamageRect& rect : added) {
+        bool covered = false;
+        for (const DamageRect& r : region.rects()) {
+            covered |= r.contains(rect);
+        }
+        EXPECT_TRUE(covered) << rect.x << "," << rect.y;
+    }
+}
+
+TEST(DisplayDamageTracker, FlushPerFrame) {
+    DisplayDamageTracker tracker;
+    std::vector<std::pair<uint32_t, std::vector<DamageRect>>> reports;
+    const int id = tracker.addListener(
+            [&reports](uint32_t displayId, const DamageRegion& region) {
+                reports.emplace_back(displayId, region.rects());
+            });
+
+    tracker.setDisplaySize(0, 1080, 1920);
+    tracker.flush();
+    ASSERT_EQ(1u, reports.size());
+    EXPECT_EQ((DamageRect{0, 0, 1080, 1920}), reports[0].second[0]);
+
+    // A status bar updated several times in a frame is one rect, clipped.
+    for (int i = 0; i < 5; ++i) {
+        tracker.addDamage(0, 0, 0, 1100, 60);
+    }
+    tracker.addDamage(1, 5, 5, 10, 10);
+    tracker.flush(0);
+    ASSERT_EQ(2u, reports.size());
+    EXPECT_EQ(0u, reports[1].first);
+    ASSERT_EQ(1u, reports[1].second.size());
+    EXPECT_EQ((DamageRect{0, 0, 1080, 60}), reports[1].second[0]);
+
+    // Nothing new on display 0; display 1's rect is still pending.
+    tracker.flush();
+    ASSERT_EQ(3u, reports.size());
+    EXPECT_EQ(1u, reports[2].first);
+
+    // Most of the screen is reported as all of it.
+    tracker.addDamage(0, 0, 0, 1080, 1800);
+    tracker.flush();
+    ASSERT_EQ(4u, reports.size());
+    EXPECT_EQ((DamageRect{0, 0, 1080, 1920}), reports[3].second[0]);
+
+    tracker.removeListener(id);
+    tracker.invalidate(0);
+    tracker.flush();
+    EXPECT_EQ(4u, reports.size());
+}
@@ -14,8 +14,11 @@
 
 #include "DmaMap.h"
 
+#include "aemu/base/LatencyHistogram.h"
+#include "aemu/base/StatsPage.h"
 #include "aemu/base/containers/Lookup.h"
 #include "aemu/base/files/StreamSerializing.h"
+#include "aemu/base/system/System.h"
 #include "host-common/android_pipe_device.h"
 
 #include <type_traits>
@@ -42,6 +45,13 @@ namespace android {
 
 static DmaMap* sInstance = nullptr;
 
+// Guest buffers registered with the DMA map, for StatsPage.
+static const base::Stat& mappingsStat() {
+    static const base::Stat sStat =
+            base::StatsPage::get().add("dma.mappings", base::StatKind::kGauge);
+    return sStat;
+}
+
 DmaMap* DmaMap::get() {
     return sInstance;
 }
@@ -58,22 +68,30 @@ void DmaMap::addBuffer(void* hwpipe,
     D("guest paddr 0x%llx bufferSize %llu",
       (unsigned long long)guest_paddr,
       (unsigned long long)bufferSize);
-    DmaBufferInfo info;
-    info.hwpipe = hwpipe;
-    info.guestAddr = guest_paddr; // guest address
-    info.bufferSize = bufferSize; // size of buffer
-    info.currHostAddr = kNullopt; // no current host address
+    std::unique_ptr<DmaBufferInfo> info(new DmaBufferInfo);
+    info->hwpipe = hwpipe;
+    info->guestAddr = guest_paddr; // guest address
+    info->bufferSize = bufferSize; // size of buffer
+    info->currHostAddr = kNullopt; // no current host address
     android::base::AutoWriteLock lock(mLock);
-    createMappingLocked(&info);
-    mDmaBuffers[guest_paddr] = info;
+    currentHostAddr(info.get());
+    mDmaBuffers[guest_paddr] = std::move(info);
+    bumpVersion();
+    mappingsStat().set(mDmaBuffers.size());
 }
 
 void DmaMap::removeBuffer(uint64_t guest_paddr) {
     D("guest paddr 0x%llx", (unsigned long long)guest_paddr);
     android::base::AutoWriteLock lock(mLock);
-    if (auto info = android::base::find(mDmaBuffers, guest_paddr)) {
-        removeMappingLocked(info);
-        mDmaBuffers.erase(guest_paddr);
+    auto it = mDmaBuffers.find(guest_paddr);
+    if (it != mDmaBuffers.end()) {
+        {
+            android::base::AutoLock infoLock(it->second->lock);
+            removeMappingLocked(it->second.get());
+        }
+        mDmaBuffers.erase(it);
+        bumpVersion();
+        mappingsStat().set(mDmaBuffers.size());
     } else {
         E("guest addr 0x%llx not alloced!",
           (unsigned long long)guest_paddr);
@@ -84,20 +102,10 @@ void* DmaMap::getHostAddr(uint64_t guest_paddr) {
     DD("guest paddr 0x%llx", (unsigned long long)guest_paddr);
     android::base::AutoReadLock rlock(mLock);
     if (auto info = android::base::find(mDmaBuffers, guest_paddr)) {
-        if (info->currHostAddr) {
-            DD("guest paddr 0x%llx -> host 0x%llx valid",
-              (unsigned long long)guest_paddr,
-              (unsigned long long)(*info->currHostAddr));
-            return *(info->currHostAddr);
-        } else {
-            rlock.unlockRead();
-            android::base::AutoWriteLock wlock(mLock);
-            createMappingLocked(info);
-            D("guest paddr 0x%llx -> host 0x%llx valid (new)",
-              (unsigned long long)guest_paddr,
-              (unsigned long long)*(info->currHostAddr));
-            return *(info->currHostAddr);
-        }
+        void* hostAddr = currentHostAddr(info->get());
+        DD("guest paddr 0x%llx -> host 0x%llx",
+           (unsigned long long)guest_paddr, (unsigned long long)hostAddr);
+        return hostAddr;
     } else {
         E("guest paddr 0x%llx not alloced!",
           (unsigned long long)guest_paddr);
@@ -105,35 +113,89 @@ void* DmaMap::getHostAddr(uint64_t guest_paddr) {
     }
 }
 
-void DmaMap::invalidateHostMappings() {
-    android::base::AutoWriteLock lock(mLock);
-    for (auto& it : mDmaBuffers) {
-        removeMappingLocked(&it.second);
+size_t DmaMap::prefetchHostAddrs(const uint64_t* addrs,
+                                 size_t count,
+                                 void** hostAddrs) {
+    size_t found = 0;
+    android::base::AutoReadLock rlock(mLock);
+    for (size_t i = 0; i < count; ++i) {
+        void* hostAddr = nullptr;
+        if (auto info = android::base::find(mDmaBuffers, addrs[i])) {
+            hostAddr = currentHostAddr(info->get());
+            ++found;
+        }
+        if (hostAddrs) {
+            hostAddrs[i] = hostAddr;
+        }
     }
+    return found;
+}
+
+void DmaMap::invalidateHostMappings() {
+    mGeneration.fetch_add(1, std::memory_order_acq_rel);
+    bumpVersion();
 }
 
 void DmaMap::resetHostMappings() {
     android::base::AutoWriteLock lock(mLock);
     for (auto& it : mDmaBuffers) {
-        removeMappingLocked(&it.second);
+        android::base::AutoLock infoLock(it.second->lock);
+        removeMappingLocked(it.second.get());
     }
     mDmaBuffers.clear();
+    bumpVersion();
+    mappingsStat().set(0);
 }
 
 void* DmaMap::getPipeInstance(uint64_t guest_paddr) {
     android::base::AutoReadLock lock(mLock);
     if (auto info = android::base::find(mDmaBuffers, guest_paddr)) {
-        return info->hwpipe;
+        return (*info)->hwpipe;
     } else {
         return nullptr;
     }
 }
 
+void DmaMap::getPipeInstances(const uint64_t* addrs,
+                              size_t count,
+                              void** pipes) {
+    android::base::AutoReadLock lock(mLock);
+    for (size_t i = 0; i < count; ++i) {
+        auto info = android::base::find(mDmaBuffers, addrs[i]);
+        pipes[i] = info ? (*info)->hwpipe : nullptr;
+    }
+}
+
+void* DmaMap::currentHostAddr(DmaBufferInfo* info) {
+    const uint64_t generation = mGeneration.load(std::memory_order_acquire);
+    if (info->mappedGeneration.load(std::memory_order_acquire) == generation) {
+        return info->hostAddr.load(std::memory_order_relaxed);
+    }
+
+    android::base::AutoLock lock(info->lock);
+    if (info->mappedGeneration.load(std::memory_order_relaxed) != generation) {
+        // Drop the mapping from before the last invalidation.
+        removeMappingLocked(info);
+        createMappingLocked(info);
+        info->hostAddr.store(info->currHostAddr ? *info->currHostAddr : nullptr,
+                             std::memory_order_relaxed);
+        info->mappedGeneration.store(generation, std::memory_order_release);
+        D("guest paddr 0x%llx -> host 0x%llx valid (new)",
+          (unsigned long long)info->guestAddr,
+          (unsigned long long)info->hostAddr.load(std::memory_order_relaxed));
+    }
+    return info->hostAddr.load(std::memory_order_relaxed);
+}
+
 void DmaMap::createMappingLocked(DmaBufferInfo* info) {
+    const uint64_t startUs = base::getHighResTimeUs();
     info->currHostAddr = doMap(info->guestAddr, info->bufferSize);
+    base::recordLatency(base::LatencyMetric::kDmaMap,
+                        base::getHighResTimeUs() - startUs);
 }
 
 void DmaMap::removeMappingLocked(DmaBufferInfo* info ) {
+    info->mappedGeneration.store(0, std::memory_order_relaxed);
     if (info->currHostAddr) {
         doUnmap(*(info->currHostAddr), info->bufferSize);
         info->currHostAddr = kNullopt;
@@ -151,26 +213,77 @@ void DmaMap::save(android::base::Stream* stream) const {
                    [](android::base::Stream* stream,
                       const DmaBufferMap::value_type& v) {
         stream->putBe64(v.first); // guest paddr
-        stream->putBe32(android_pipe_get_id(v.second.hwpipe));
-        stream->putBe64(v.second.guestAddr); // guest addr
-        stream->putBe64(v.second.bufferSize); // buffer size
+        stream->putBe32(android_pipe_get_id(v.second->hwpipe));
+        stream->putBe64(v.second->guestAddr); // guest addr
+        stream->putBe64(v.second->bufferSize); // buffer size
         // don't save current host addr as it is invalidated.
     });
 }
 
 void DmaMap::load(android::base::Stream* stream) {
+    android::base::AutoWriteLock lock(mLock);
     mDmaBuffers.clear();
     loadCollection(stream, &mDmaBuffers,
                    [](android::base::Stream* stream) {
         uint64_t gpa = stream->getBe64();
 
-        DmaBufferInfo info;
-        info.hwpipe = android_pipe_lookup_by_id(stream->getBe32()),
-        info.guestAddr = stream->getBe64(),
-        info.bufferSize = stream->getBe64(),
-        info.currHostAddr = kNullopt;
-        return std::make_pair(gpa, info);
+        std::unique_ptr<DmaBufferInfo> info(new DmaBufferInfo);
+        info->hwpipe = android_pipe_lookup_by_id(stream->getBe32()),
+        info->guestAddr = stream->getBe64(),
+        info->bufferSize = stream->getBe64(),
+        info->currHostAddr = kNullopt;
+        return std::make_pair(gpa, std::move(info));
     });
+    bumpVersion();
+    mappingsStat().set(mDmaBuffers.size());
+}
+
+void DmaMappingCache::getHostAddrs(const uint64_t* addrs,
+                                   size_t count,
+                                   void** hostAddrs) {
+    // Read before resolving, so that a change made meanwhile shows up as a
+    // new version next time.
+    const uint64_t version = mDmaMap->version();
+    if (version != mVersion) {
+        mHostAddrs.clear();
+        mVersion = version;
+    }
+    mMissAddrs.clear();
+    for (size_t i = 0; i < count; ++i) {
+        auto it = mHostAddrs.find(addrs[i]);
+        if (it != mHostAddrs.end()) {
+            hostAddrs[i] = it->second;
+        } else {
+            mMissAddrs.push_back(addrs[i]);
+        }
+    }
+    if (mMissAddrs.empty()) {
+        return;
+    }
+    mMissHostAddrs.resize(mMissAddrs.size());
+    mDmaMap->prefetchHostAddrs(mMissAddrs.data(), mMissAddrs.size(),
+                               mMissHostAddrs.data());
+    for (size_t i = 0; i < mMissAddrs.size(); ++i) {
+        // Unknown buffers are not cached; they may be added at any time.
+        if (mMissHostAddrs[i]) {
+            mHostAddrs.emplace(mMissAddrs[i], mMissHostAddrs[i]);
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        auto it = mHostAddrs.find(addrs[i]);
+        hostAddrs[i] = it != mHostAddrs.end() ? it->second : nullptr;
+    }
+}
+
+void* DmaMappingCache::getHostAddr(uint64_t addr) {
+    void* hostAddr = nullptr;
+    getHostAddrs(&addr, 1, &hostAddr);
+    return hostAddr;
+}
+
+void DmaMappingCache::clear() {
+    mHostAddrs.clear();
+    mVersion = 0;
 }
 
 }  // namespace android
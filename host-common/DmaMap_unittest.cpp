@@ -0,0 +1,157 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/DmaMap.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using android::DmaMap;
+
+namespace {
+
+// Hands out fake host addresses and counts map/unmap calls.
+class TestDmaMap : public DmaMap {
+public:
+    std::atomic<int> maps{0};
+    std::atomic<int> unmaps{0};
+
+protected:
+    void* doMap(uint64_t addr, uint64_t bufferSize) override {
+        ++maps;
+        return reinterpret_cast<void*>(addr + 0x1000);
+    }
+    void doUnmap(void* mapped, uint64_t bufferSize) override { ++unmaps; }
+};
+
+}  // namespace
+
+// Tests that invalidation is deferred until a buffer is used again.
+TEST(DmaMap, LazyInvalidate) {
+    TestDmaMap dma;
+    dma.addBuffer(nullptr, 0x10000, 4096);
+    dma.addBuffer(nullptr, 0x20000, 4096);
+    EXPECT_EQ(2, dma.maps);
+
+    EXPECT_EQ(reinterpret_cast<void*>(0x11000), dma.getHostAddr(0x10000));
+    EXPECT_EQ(2, dma.maps);
+
+    dma.invalidateHostMappings();
+    dma.invalidateHostMappings();
+    EXPECT_EQ(0, dma.unmaps);
+
+    EXPECT_EQ(reinterpret_cast<void*>(0x11000), dma.getHostAddr(0x10000));
+    EXPECT_EQ(3, dma.maps);
+    EXPECT_EQ(1, dma.unmaps);
+
+    dma.removeBuffer(0x20000);
+    EXPECT_EQ(3, dma.maps);
+    EXPECT_EQ(2, dma.unmaps);
+    EXPECT_EQ(nullptr, dma.getHostAddr(0x20000));
+
+    dma.resetHostMappings();
+    EXPECT_EQ(3, dma.unmaps);
+}
+
+// Tests that prefetching remaps stale buffers and skips unknown ones.
+TEST(DmaMap, Prefetch) {
+    TestDmaMap dma;
+    dma.addBuffer(nullptr, 0x10000, 4096);
+    dma.addBuffer(nullptr, 0x20000, 4096);
+    dma.invalidateHostMappings();
+
+    const uint64_t addrs[] = {0x10000, 0x30000, 0x20000};
+    void* hostAddrs[3];
+    EXPECT_EQ(2u, dma.prefetchHostAddrs(addrs, 3, hostAddrs));
+    EXPECT_EQ(reinterpret_cast<void*>(0x11000), hostAddrs[0]);
+    EXPECT_EQ(nullptr, hostAddrs[1]);
+    EXPECT_EQ(reinterpret_cast<void*>(0x21000), hostAddrs[2]);
+    EXPECT_EQ(4, dma.maps);
+
+    EXPECT_EQ(reinterpret_cast<void*>(0x21000), dma.getHostAddr(0x20000));
+    EXPECT_EQ(4, dma.maps);
+}
+
+// Tests that concurrent readers of a stale buffer remap it only once.
+TEST(DmaMap, ConcurrentRemap) {
+    TestDmaMap dma;
+    dma.addBuffer(nullptr, 0x10000, 4096);
+    dma.invalidateHostMappings();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&dma] {
+            for (int j = 0; j < 1000; ++j) {
+                EXPECT_EQ(reinterpret_cast<void*>(0x11000),
+                          dma.getHostAddr(0x10000));
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(2, dma.maps);
+    EXPECT_EQ(1, dma.unmaps);
+}
+
+// Tests that the per-pipe cache serves repeat lookups without the map, and
+// refills after the map changes.
+TEST(DmaMap, MappingCache) {
+    TestDmaMap dma;
+    dma.addBuffer(nullptr, 0x10000, 4096);
+    dma.addBuffer(nullptr, 0x20000, 4096);
+    android::DmaMappingCache cache(&dma);
+
+    const uint64_t addrs[] = {0x10000, 0x30000, 0x20000};
+    void* hostAddrs[3];
+    cache.getHostAddrs(addrs, 3, hostAddrs);
+    EXPECT_EQ(reinterpret_cast<void*>(0x11000), hostAddrs[0]);
+    EXPECT_EQ(nullptr, hostAddrs[1]);
+    EXPECT_EQ(reinterpret_cast<void*>(0x21000), hostAddrs[2]);
+    EXPECT_EQ(2, dma.maps);
+
+    // A buffer added later is found, since unknown ones are not cached.
+    dma.addBuffer(nullptr, 0x30000, 4096);
+    EXPECT_EQ(reinterpret_cast<void*>(0x31000), cache.getHostAddr(0x30000));
+    EXPECT_EQ(3, dma.maps);
+
+    // Invalidation is seen, and the stale buffer is remapped on use.
+    dma.invalidateHostMappings();
+    EXPECT_EQ(reinterpret_cast<void*>(0x11000), cache.getHostAddr(0x10000));
+    EXPECT_EQ(4, dma.maps);
+    EXPECT_EQ(reinterpret_cast<void*>(0x11000), cache.getHostAddr(0x10000));
+    EXPECT_EQ(4, dma.maps);
+
+    dma.removeBuffer(0x20000);
+    EXPECT_EQ(nullptr, cache.getHostAddr(0x20000));
+}
+
+// Tests that pipes are looked up for several buffers at once.
+TEST(DmaMap, PipeInstances) {
+    TestDmaMap dma;
+    int pipeA = 0;
+    int pipeB = 0;
+    dma.addBuffer(&pipeA, 0x10000, 4096);
+    dma.addBuffer(&pipeB, 0x20000, 4096);
+
+    const uint64_t addrs[] = {0x20000, 0x30000, 0x10000};
+    void* pipes[3];
+    dma.getPipeInstances(addrs, 3, pipes);
+    EXPECT_EQ(&pipeB, pipes[0]);
+    EXPECT_EQ(nullptr, pipes[1]);
+    EXPECT_EQ(&pipeA, pipes[2]);
+}
@@ -20,6 +20,9 @@
 #include "host-common/address_space_device.h"
 #include "host-common/android_pipe_host.h"
 
+#include <algorithm>
+#include <vector>
+
 static void android_goldfish_dma_add_buffer(void* pipe, uint64_t guest_paddr, uint64_t sz) {
     android::DmaMap::get()->addBuffer(pipe, guest_paddr, sz);
 }
@@ -55,6 +58,47 @@ static void android_goldfish_dma_unlock(uint64_t guest_paddr) {
     }
 }
 
+static void android_goldfish_dma_get_host_addrs(const uint64_t* guest_paddrs,
+                                                size_t count,
+                                                void** host_addrs) {
+    // As in get_host_addr(), address space device memory comes first; the
+    // rest are looked up in the DMA map together.
+    std::vector<uint64_t> missing;
+    std::vector<size_t> missingIndices;
+    for (size_t i = 0; i < count; ++i) {
+        host_addrs[i] = get_address_space_device_control_ops()->get_host_ptr(
+                guest_paddrs[i]);
+        if (!host_addrs[i]) {
+            missing.push_back(guest_paddrs[i]);
+            missingIndices.push_back(i);
+        }
+    }
+    if (missing.empty()) {
+        return;
+    }
+    std::vector<void*> found(missing.size());
+    android::DmaMap::get()->prefetchHostAddrs(missing.data(), missing.size(),
+                                              found.data());
+    for (size_t i = 0; i < missing.size(); ++i) {
+        host_addrs[missingIndices[i]] = found[i];
+    }
+}
+
+static void android_goldfish_dma_unlock_many(const uint64_t* guest_paddrs,
+                                             size_t count) {
+    std::vector<void*> hwpipes(count);
+    android::DmaMap::get()->getPipeInstances(guest_paddrs, count,
+                                             hwpipes.data());
+    std::sort(hwpipes.begin(), hwpipes.end());
+    hwpipes.erase(std::unique(hwpipes.begin(), hwpipes.end()), hwpipes.end());
+    for (void* hwpipe : hwpipes) {
+        // As in unlock(), buffers without a pipe need no wake.
+        if (hwpipe) {
+            android_pipe_host_signal_wake(hwpipe, PIPE_WAKE_UNLOCK_DMA);
+        }
+    }
+}
+
 static void android_goldfish_dma_reset_host_mappings() {
     android::DmaMap::get()->resetHostMappings();
 }
@@ -76,4 +120,6 @@ const GoldfishDmaOps android_goldfish_dma_ops = {
     .reset_host_mappings = android_goldfish_dma_reset_host_mappings,
     .save_mappings = android_goldfish_dma_save_mappings,
     .load_mappings = android_goldfish_dma_load_mappings,
+    .get_host_addrs = android_goldfish_dma_get_host_addrs,
+    .unlock_many = android_goldfish_dma_unlock_many,
 };
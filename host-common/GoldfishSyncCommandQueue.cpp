@@ -16,6 +16,7 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace android {
@@ -51,6 +52,11 @@ void GoldfishSyncCommandQueue::setQueueCommand(queue_device_command_t fx) {
     cmdQueue->tellSyncDevice = fx;
 }
 
+// static
+void GoldfishSyncCommandQueue::setQueueCommands(queue_device_commands_t fx) {
+    sCommandQueue()->tellSyncDeviceBatch = fx;
+}
+
 // static
 void GoldfishSyncCommandQueue::hostSignal(uint32_t cmd,
                                           uint64_t handle,
@@ -68,6 +74,40 @@ void GoldfishSyncCommandQueue::hostSignal(uint32_t cmd,
     queue->queueDeviceOperation(sync_data);
 }
 
+// static
+void GoldfishSyncCommandQueue::hostSignalBatch(const GoldfishSyncWakeInfo* cmds,
+                                               size_t count) {
+    sCommandQueue()->queueDeviceOperations(cmds, count);
+}
+
+// static
+size_t GoldfishSyncCommandQueue::coalesce(GoldfishSyncWakeInfo* cmds,
+                                          size_t count) {
+    // Everything in a drained batch was queued because it already
+    // happened on the host, so delivering an increment at the position of
+    // an earlier one signals nothing early. Other commands on the same
+    // timeline, like fence creation, still have to see the values from
+    // before them.
+    std::unordered_map<uint64_t, size_t> lastInc;
+    size_t out = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const GoldfishSyncWakeInfo& cmd = cmds[i];
+        if (cmd.cmd == CMD_SYNC_TIMELINE_INC && !cmd.hostcmd_handle) {
+            auto it = lastInc.find(cmd.handle);
+            if (it != lastInc.end() &&
+                cmds[it->second].time_arg <= UINT32_MAX - cmd.time_arg) {
+                cmds[it->second].time_arg += cmd.time_arg;
+                continue;
+            }
+            lastInc[cmd.handle] = out;
+        } else if (cmd.handle) {
+            lastInc.erase(cmd.handle);
+        }
+        cmds[out++] = cmd;
+    }
+    return out;
+}
+
 // static
 void GoldfishSyncCommandQueue::save(Stream* stream) {
     GoldfishSyncCommandQueue* queue = sCommandQueue();
@@ -105,4 +145,17 @@ void GoldfishSyncCommandQueue::performDeviceOperation
                    wakeInfo.hostcmd_handle);
 }
 
+void GoldfishSyncCommandQueue::performDeviceOperations
+    (const GoldfishSyncWakeInfo* cmds, size_t count) {
+    std::vector<GoldfishSyncWakeInfo> batch(cmds, cmds + count);
+    batch.resize(coalesce(batch.data(), batch.size()));
+    if (tellSyncDeviceBatch) {
+        tellSyncDeviceBatch(batch.data(), (uint32_t)batch.size());
+        return;
+    }
+    for (const GoldfishSyncWakeInfo& cmd : batch) {
+        performDeviceOperation(cmd);
+    }
+}
+
 } // namespace android
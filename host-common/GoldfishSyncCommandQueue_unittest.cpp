@@ -0,0 +1,59 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/GoldfishSyncCommandQueue.h"
+
+#include <gtest/gtest.h>
+
+namespace android {
+namespace {
+
+GoldfishSyncWakeInfo inc(uint64_t timeline, uint32_t howmuch) {
+    return {timeline, 0, CMD_SYNC_TIMELINE_INC, howmuch};
+}
+
+// Tests that increments of a timeline merge up to the next command on it.
+TEST(GoldfishSyncCommandQueue, Coalesce) {
+    GoldfishSyncWakeInfo cmds[] = {
+            inc(1, 1),
+            inc(2, 1),
+            inc(1, 2),
+            {1, 7, CMD_CREATE_SYNC_FENCE, 5},
+            inc(1, 4),
+            inc(2, 3),
+            inc(1, 8),
+            {0, 9, CMD_CREATE_SYNC_TIMELINE, 0},
+            inc(2, UINT32_MAX),
+    };
+    size_t count = GoldfishSyncCommandQueue::coalesce(
+            cmds, sizeof(cmds) / sizeof(cmds[0]));
+    ASSERT_EQ(6u, count);
+
+    EXPECT_EQ(1u, cmds[0].handle);
+    EXPECT_EQ(3u, cmds[0].time_arg);
+    EXPECT_EQ(2u, cmds[1].handle);
+    EXPECT_EQ(4u, cmds[1].time_arg);
+    EXPECT_EQ(uint32_t(CMD_CREATE_SYNC_FENCE), cmds[2].cmd);
+    EXPECT_EQ(7u, cmds[2].hostcmd_handle);
+    EXPECT_EQ(1u, cmds[3].handle);
+    EXPECT_EQ(12u, cmds[3].time_arg);
+    EXPECT_EQ(uint32_t(CMD_CREATE_SYNC_TIMELINE), cmds[4].cmd);
+    // Would overflow the earlier increment, so it stays separate.
+    EXPECT_EQ(2u, cmds[5].handle);
+    EXPECT_EQ(UINT32_MAX, cmds[5].time_arg);
+}
+
+}  // namespace
+}  // namespace android
@@ -0,0 +1,118 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/GpaTranslationCache.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace android {
+namespace emulation {
+namespace {
+
+// Two pages of guest memory at |base|, plus a mapping that starts in the
+// middle of a page.
+struct FakeMemory {
+    static constexpr uint64_t kBase = 0x100000;
+    static constexpr uint64_t kUnaligned = 0x200800;
+
+    std::vector<char> pages = std::vector<char>(2 * GpaTranslationCache::kPageSize);
+    std::vector<char> unaligned = std::vector<char>(GpaTranslationCache::kPageSize);
+    int calls = 0;
+
+    void* translate(uint64_t gpa) {
+        ++calls;
+        if (gpa >= kBase && gpa < kBase + pages.size()) {
+            return pages.data() + (gpa - kBase);
+        }
+        if (gpa >= kUnaligned && gpa < kUnaligned + unaligned.size()) {
+            return unaligned.data() + (gpa - kUnaligned);
+        }
+        return nullptr;
+    }
+};
+
+TEST(GpaTranslationCache, CachesPages) {
+    FakeMemory memory;
+    GpaTranslationCache cache;
+    auto translate = [&memory](uint64_t gpa) { return memory.translate(gpa); };
+
+    EXPECT_EQ(memory.pages.data() + 16, cache.translate(FakeMemory::kBase + 16, translate));
+    const int missCalls = memory.calls;
+    EXPECT_EQ(memory.pages.data() + 100, cache.translate(FakeMemory::kBase + 100, translate));
+    EXPECT_EQ(missCalls, memory.calls);
+
+    // The second page is its own entry.
+    EXPECT_EQ(memory.pages.data() + GpaTranslationCache::kPageSize,
+              cache.translate(FakeMemory::kBase + GpaTranslationCache::kPageSize, translate));
+    EXPECT_GT(memory.calls, missCalls);
+
+    GpaTranslationCache::invalidateAll();
+    const int beforeInvalidated = memory.calls;
+    EXPECT_EQ(memory.pages.data() + 100, cache.translate(FakeMemory::kBase + 100, translate));
+    EXPECT_GT(memory.calls, beforeInvalidated);
+}
+
+// Tests that pages only partly mapped, and unmapped ones, are translated
+// every time.
+TEST(GpaTranslationCache, PartialPages) {
+    FakeMemory memory;
+    GpaTranslationCache cache;
+    auto translate = [&memory](uint64_t gpa) { return memory.translate(gpa); };
+
+    EXPECT_EQ(memory.unaligned.data() + 8, cache.translate(FakeMemory::kUnaligned + 8, translate));
+    const int calls = memory.calls;
+    EXPECT_EQ(memory.unaligned.data() + 8, cache.translate(FakeMemory::kUnaligned + 8, translate));
+    EXPECT_GT(memory.calls, calls);
+
+    EXPECT_EQ(nullptr, cache.translate(0x5000, translate));
+}
+
+// Tests that a whole mapping is cached after one lookup, up to its end.
+TEST(GpaRangeCache, CachesMappings) {
+    FakeMemory memory;
+    GpaRangeCache cache;
+    int lookups = 0;
+    auto lookup = [&memory, &lookups](uint64_t gpa, GpaRangeCache::Range* range) {
+        ++lookups;
+        char* host = static_cast<char*>(memory.translate(gpa));
+        if (!host) {
+            return false;
+        }
+        const bool inPages = gpa >= FakeMemory::kBase && gpa < FakeMemory::kBase + memory.pages.size();
+        range->gpa = inPages ? FakeMemory::kBase : FakeMemory::kUnaligned;
+        range->size = inPages ? memory.pages.size() : memory.unaligned.size();
+        range->host = inPages ? memory.pages.data() : memory.unaligned.data();
+        return true;
+    };
+
+    EXPECT_EQ(memory.pages.data() + 16, cache.translate(FakeMemory::kBase + 16, lookup));
+    EXPECT_EQ(memory.pages.data() + 5000, cache.translate(FakeMemory::kBase + 5000, lookup));
+    EXPECT_EQ(memory.unaligned.data() + 1, cache.translate(FakeMemory::kUnaligned + 1, lookup));
+    EXPECT_EQ(memory.pages.data() + 8191, cache.translate(FakeMemory::kBase + 8191, lookup));
+    EXPECT_EQ(2, lookups);
+
+    EXPECT_EQ(nullptr, cache.translate(FakeMemory::kBase + 8192, lookup));
+    EXPECT_EQ(3, lookups);
+
+    GpaTranslationCache::invalidateAll();
+    EXPECT_EQ(memory.pages.data() + 16, cache.translate(FakeMemory::kBase + 16, lookup));
+    EXPECT_EQ(4, lookups);
+}
+
+}  // namespace
+}  // namespace emulation
+}  // namespace android
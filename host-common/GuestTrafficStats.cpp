@@ -0,0 +1,165 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/GuestTrafficStats.h"
+
+#include "aemu/base/StringFormat.h"
+#include "aemu/base/Tracing.h"
+#include "aemu/base/containers/Lookup.h"
+
+#include <algorithm>
+
+namespace android {
+namespace emulation {
+
+using base::AutoLock;
+
+namespace {
+
+constexpr const char* kTotalNames[GuestTrafficStats::kNumCounters] = {
+        "guest_traffic.bytes_to_host",
+        "guest_traffic.bytes_to_guest",
+        "guest_traffic.commands",
+        "guest_traffic.wakes",
+};
+
+}  // namespace
+
+GuestTrafficStats::GuestTrafficStats(size_t maxSources, bool publish)
+    : mMaxSources(std::max<size_t>(1, maxSources)),
+      mPublish(publish),
+      mCounts(mMaxSources * kNumCounters) {
+    if (mPublish) {
+        for (uint32_t i = 0; i < kNumCounters; ++i) {
+            mTotals[i] = base::StatsPage::get().add(kTotalNames[i], base::StatKind::kCounter);
+        }
+    }
+    source("(other)");
+}
+
+GuestTrafficStats::~GuestTrafficStats() = default;
+
+GuestTrafficStats& GuestTrafficStats::get() {
+    // Leaked: pipes and render threads may outlive static destruction.
+    static GuestTrafficStats* const sInstance = new GuestTrafficStats(kMaxSources, true);
+    return *sInstance;
+}
+
+GuestTrafficStats::Source GuestTrafficStats::source(std::string_view name) {
+    if (name.empty()) {
+        return kOther;
+    }
+    std::string key(name.substr(0, kMaxNameSize));
+    AutoLock lock(mLock);
+    if (const Source* found = base::find(mSourcesByName, key)) {
+        return *found;
+    }
+    if (mSources.size() == mMaxSources) {
+        return kOther;
+    }
+    const Source source = static_cast<Source>(mSources.size());
+    auto info = std::make_unique<SourceInfo>();
+    info->name = key;
+    info->statName = "guest_traffic." + key;
+    if (mPublish && mSources.size() < kMaxPageSources) {
+        info->bytes = base::StatsPage::get().add(info->statName.c_str(),
+                                                 base::StatKind::kCounter);
+    }
+    mSources.push_back(std::move(info));
+    mSourcesByName.emplace(std::move(key), source);
+    return source;
+}
+
+std::vector<int64_t> GuestTrafficStats::publish() {
+    const std::vector<int64_t> sums = mCounts.sum();
+    if (!mPublish) {
+        return sums;
+    }
+    int64_t totals[kNumCounters] = {};
+    for (size_t i = 0; i < sums.size(); ++i) {
+        totals[i % kNumCounters] += sums[i];
+    }
+    for (uint32_t i = 0; i < kNumCounters; ++i) {
+        mTotals[i].set(totals[i]);
+    }
+
+    AutoLock lock(mLock);
+    for (size_t i = 0; i < mSources.size(); ++i) {
+        SourceInfo& info = *mSources[i];
+        const int64_t bytes =
+                sums[i * kNumCounters + kBytesToHost] + sums[i * kNumCounters + kBytesToGuest];
+        if (bytes == info.lastBytes) {
+            continue;
+        }
+        info.lastBytes = bytes;
+        info.bytes.set(bytes);
+        base::traceCounter(info.statName.c_str(), bytes);
+    }
+    return sums;
+}
+
+std::vector<GuestTrafficStats::Usage> GuestTrafficStats::top(size_t count) {
+    const std::vector<int64_t> sums = publish();
+    std::vector<Usage> usages;
+    {
+        AutoLock lock(mLock);
+        mTopSums.resize(sums.size());
+        for (size_t i = 0; i < mSources.size(); ++i) {
+            Usage usage;
+            bool active = false;
+            for (uint32_t j = 0; j < kNumCounters; ++j) {
+                const size_t slot = i * kNumCounters + j;
+                usage.total[j] = sums[slot];
+                usage.recent[j] = sums[slot] - mTopSums[slot];
+                active |= usage.recent[j] != 0;
+            }
+            if (active) {
+                usage.name = mSources[i]->name;
+                usages.push_back(std::move(usage));
+            }
+        }
+        mTopSums = sums;
+    }
+
+    std::sort(usages.begin(), usages.end(), [](const Usage& a, const Usage& b) {
+        if (a.recentBytes() != b.recentBytes()) {
+            return a.recentBytes() > b.recentBytes();
+        }
+        if (a.recent[kCommands] != b.recent[kCommands]) {
+            return a.recent[kCommands] > b.recent[kCommands];
+        }
+        return a.recent[kWakes] > b.recent[kWakes];
+    });
+    if (usages.size() > count) {
+        usages.resize(count);
+    }
+    return usages;
+}
+
+std::string GuestTrafficStats::report(size_t count) {
+    std::string result = base::StringFormat("%-40s %14s %14s %10s %10s\n", "source",
+                                            "to host", "to guest", "commands", "wakes");
+    for (const Usage& usage : top(count)) {
+        base::StringAppendFormat(&result, "%-40s %14lld %14lld %10lld %10lld\n",
+                                 usage.name.c_str(),
+                                 (long long)usage.recent[kBytesToHost],
+                                 (long long)usage.recent[kBytesToGuest],
+                                 (long long)usage.recent[kCommands],
+                                 (long long)usage.recent[kWakes]);
+    }
+    return result;
+}
+
+}  // namespace emulation
+}  // namespace android
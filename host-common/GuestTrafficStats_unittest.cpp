@@ -0,0 +1,128 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/GuestTrafficStats.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using android::base::StatsPage;
+using android::emulation::GuestTrafficStats;
+
+namespace {
+
+int64_t pageValue(const char* name) {
+    for (const auto& value : StatsPage::get().snapshot()) {
+        if (value.name == name) {
+            return value.value;
+        }
+    }
+    return -1;
+}
+
+// Tests that contexts and pipes of one name share a source, and that
+// sources rank by their bytes since the last look.
+TEST(GuestTrafficStats, RanksRecentTraffic) {
+    GuestTrafficStats stats;
+    const auto game = stats.source("asg:com.example.game");
+    const auto adb = stats.source("pipe:qemud:adb");
+    EXPECT_EQ(game, stats.source("asg:com.example.game"));
+    EXPECT_NE(game, adb);
+    EXPECT_EQ(GuestTrafficStats::kOther, stats.source(""));
+
+    stats.add(game, GuestTrafficStats::kBytesToHost, 1000);
+    stats.add(game, GuestTrafficStats::kCommands, 10);
+    stats.add(adb, GuestTrafficStats::kBytesToGuest, 100);
+    stats.add(adb, GuestTrafficStats::kWakes, 3);
+
+    auto top = stats.top(10);
+    ASSERT_EQ(2u, top.size());
+    EXPECT_EQ("asg:com.example.game", top[0].name);
+    EXPECT_EQ(1000, top[0].recent[GuestTrafficStats::kBytesToHost]);
+    EXPECT_EQ(10, top[0].recent[GuestTrafficStats::kCommands]);
+    EXPECT_EQ("pipe:qemud:adb", top[1].name);
+    EXPECT_EQ(3, top[1].recent[GuestTrafficStats::kWakes]);
+
+    // Now only adb is busy; the game is idle and left out.
+    stats.add(adb, GuestTrafficStats::kBytesToHost, 50);
+    top = stats.top(10);
+    ASSERT_EQ(1u, top.size());
+    EXPECT_EQ("pipe:qemud:adb", top[0].name);
+    EXPECT_EQ(50, top[0].recent[GuestTrafficStats::kBytesToHost]);
+    EXPECT_EQ(100, top[0].total[GuestTrafficStats::kBytesToGuest]);
+
+    EXPECT_TRUE(stats.top(10).empty());
+}
+
+// Tests that sources past the limit, and overlong names, are still counted.
+TEST(GuestTrafficStats, Limits) {
+    GuestTrafficStats stats(3);
+    const auto a = stats.source("a");
+    const auto b = stats.source("b");
+    EXPECT_EQ(GuestTrafficStats::kOther, stats.source("c"));
+    EXPECT_NE(a, b);
+
+    const std::string longName(200, 'x');
+    GuestTrafficStats longStats;
+    EXPECT_EQ(longStats.source(longName),
+              longStats.source(longName.substr(0, GuestTrafficStats::kMaxNameSize)));
+
+    stats.add(stats.source("c"), GuestTrafficStats::kBytesToHost, 7);
+    const auto top = stats.top(1);
+    ASSERT_EQ(1u, top.size());
+    EXPECT_EQ("(other)", top[0].name);
+}
+
+// Tests that updates from many threads all add up.
+TEST(GuestTrafficStats, ManyThreads) {
+    GuestTrafficStats stats;
+    const auto source = stats.source("asg:busy");
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&stats, source] {
+            for (int j = 0; j < 10000; ++j) {
+                stats.add(source, GuestTrafficStats::kBytesToHost, 3);
+                stats.add(source, GuestTrafficStats::kCommands, 1);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const auto top = stats.top(1);
+    ASSERT_EQ(1u, top.size());
+    EXPECT_EQ(120000, top[0].total[GuestTrafficStats::kBytesToHost]);
+    EXPECT_EQ(40000, top[0].total[GuestTrafficStats::kCommands]);
+}
+
+// Tests that the global instance keeps the stats page totals current, and
+// that the report names the busy source.
+TEST(GuestTrafficStats, PublishesToStatsPage) {
+    GuestTrafficStats& stats = GuestTrafficStats::get();
+    const auto source = stats.source("pipe:GuestTrafficStatsTest");
+    stats.top(GuestTrafficStats::kMaxSources);
+    const int64_t before = pageValue("guest_traffic.wakes");
+    ASSERT_GE(before, 0);
+
+    stats.add(source, GuestTrafficStats::kWakes, 5);
+    stats.add(source, GuestTrafficStats::kBytesToHost, 1 << 20);
+    const std::string report = stats.report();
+    EXPECT_NE(std::string::npos, report.find("pipe:GuestTrafficStatsTest")) << report;
+    EXPECT_EQ(before + 5, pageValue("guest_traffic.wakes"));
+}
+
+}  // namespace
@@ -17,6 +17,8 @@
 
 #include "host-common/H264NaluParser.h"
 
+#include "host-common/StartCodeScanner.h"
+
 #define H264_DEBUG 0
 
 #if H264_DEBUG
@@ -157,85 +159,42 @@ H264NaluParser::H264NaluType H264NaluParser::getFrameNaluType(const uint8_t* fra
 }
 
 const uint8_t* H264NaluParser::getNextStartCodeHeader(const uint8_t* frame, size_t szBytes) {
-//    // Start code can either be 0x000001 or 0x00000001. Beware of doing this comparison
-//    // by casting, as the frame may be in network-byte order (big endian).
-//    const uint8_t* res = nullptr;
-//    size_t idx = 0;
-//    const int kHeaderMinSize = 3;
-//    int64_t remaining = szBytes;
-//    
-//    while (remaining >= kHeaderMinSize) {
-//        if (frame[idx] != 0) {
-//            ++idx;
-//            --remaining;
-//            continue;
-//        }
-//
-//        if (frame[idx + 1] != 0) {
-//            idx += 2;
-//            remaining -= 2;
-//            continue;
-//        }
-//
-//        if (frame[idx + 2] == 1) {
-//            res = &frame[idx];
-//            break;
-//        }
-//
-//        // check for four byte header if enough bytes left
-//        if (frame[idx + 2] == 0) {
-//            if (remaining >= 4 && frame[idx + 3] == 1) {
-//                res = &frame[idx];
-//                break;
-//            } else {
-//                idx += 4;
-//                remaining -= 4;
-//                continue;
-//            }
-//        } else {
-//            idx += 3;
-//            remaining -= 3;
-//            continue;
-//        }
-//    }
-//
-//    return res;
-
-    // This implementation uses bit shifting
-    constexpr uint32_t startHeaderMask = 0x00000001;
-    uint32_t window = 0;
-    
-    if (szBytes < 3) {
-        H264_INFO("Not enough bytes for a start code header");
+    // Start code can either be 0x000001 or 0x00000001. The scanner finds the
+    // last three bytes of either.
+    const uint8_t* startCode = findStartCode(frame, szBytes);
+    if (startCode == nullptr) {
+        H264_INFO("No start code header found");
         return nullptr;
     }
-
-    // we can't do a cast to 32-bit int because it is in network-byte format (big endian).
-    window |= (uint32_t)frame[0] << 16;
-    window |= (uint32_t)frame[1] << 8;
-    window |= frame[2];
-
-    if (szBytes == 3) {
-        if (!(window ^ startHeaderMask)) {
-            return &frame[0];
-        } else {
-            return nullptr;
-        }
+    if (startCode > frame && startCode[-1] == 0) {
+        return startCode - 1;
     }
+    return startCode;
+}
 
-    size_t remaining = szBytes - 3;
-    while (remaining > 0) {
-        window = (window << 8) | (uint32_t)frame[szBytes - remaining];
-        if (!(window ^ startHeaderMask)) {
-            // four-byte header match
-            return &frame[szBytes - remaining - 3];
-        } else if (!((window & 0x00ffffff) ^ startHeaderMask)) {
-            // three-byte header match
-            return &frame[szBytes - remaining - 2];
+void H264NaluList::parse(const uint8_t* frame, size_t szBytes, bool stopAtFirstSlice) {
+    mNalus.clear();
+    mTypes = 0;
+    const uint8_t* const end = frame + szBytes;
+    const uint8_t* start = H264NaluParser::getNextStartCodeHeader(frame, szBytes);
+    while (start != nullptr) {
+        const uint8_t* data = start + (start[2] == 0 ? 4 : 3);
+        if (data >= end) {
+            H264_INFO("Got start code header but no NALU type");
+            break;
         }
-        --remaining;
+        // nalu type is the lower 5 bits
+        const H264NaluType type = static_cast<H264NaluType>(0x1f & data[0]);
+        const bool isSlice = type >= H264NaluType::CodedSliceNonIDR &&
+                             type <= H264NaluType::CodedSliceIDR;
+        const uint8_t* next =
+                (stopAtFirstSlice && isSlice)
+                        ? nullptr
+                        : H264NaluParser::getNextStartCodeHeader(data, end - data);
+        mNalus.push_back(Nalu{type, start, size_t((next ? next : end) - start), data});
+        mTypes |= uint64_t(1) << static_cast<uint8_t>(type);
+        start = next;
     }
-    return nullptr;
 }
 
 }  // namespace emulation
@@ -0,0 +1,96 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/H264NaluParser.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using android::emulation::H264NaluList;
+using android::emulation::H264NaluParser;
+using H264NaluType = H264NaluParser::H264NaluType;
+
+namespace {
+
+void appendNalu(std::vector<uint8_t>* packet,
+                bool fourByteStartCode,
+                uint8_t header,
+                size_t payloadSize) {
+    if (fourByteStartCode) {
+        packet->push_back(0);
+    }
+    packet->insert(packet->end(), {0, 0, 1, header});
+    for (size_t i = 0; i < payloadSize; ++i) {
+        packet->push_back(static_cast<uint8_t>(0x80 | i));
+    }
+}
+
+}  // namespace
+
+// Tests that start codes of either length are found from their first byte.
+TEST(H264NaluParser, NextStartCodeHeader) {
+    std::vector<uint8_t> packet;
+    appendNalu(&packet, false, 0x67, 5);
+    appendNalu(&packet, true, 0x68, 40);
+
+    EXPECT_EQ(packet.data(), H264NaluParser::getNextStartCodeHeader(
+                                     packet.data(), packet.size()));
+    EXPECT_EQ(packet.data() + 9,
+              H264NaluParser::getNextStartCodeHeader(packet.data() + 3,
+                                                     packet.size() - 3));
+    EXPECT_EQ(nullptr, H264NaluParser::getNextStartCodeHeader(
+                               packet.data() + 14, packet.size() - 14));
+}
+
+// Tests splitting a packet into its NALUs in one pass.
+TEST(H264NaluList, Parse) {
+    std::vector<uint8_t> packet;
+    appendNalu(&packet, true, 0x09, 1);     // access unit delimiter
+    appendNalu(&packet, true, 0x67, 10);    // SPS
+    appendNalu(&packet, false, 0x68, 4);    // PPS
+    appendNalu(&packet, false, 0x65, 100);  // IDR slice
+    appendNalu(&packet, false, 0x65, 50);   // IDR slice
+
+    H264NaluList list;
+    list.parse(packet.data(), packet.size());
+    ASSERT_EQ(5u, list.nalus().size());
+    EXPECT_EQ(H264NaluType::AccessUnitDelimiter, list.firstType());
+    EXPECT_TRUE(list.contains(H264NaluType::SPS));
+    EXPECT_TRUE(list.contains(H264NaluType::CodedSliceIDR));
+    EXPECT_FALSE(list.contains(H264NaluType::CodedSliceNonIDR));
+
+    const auto& sps = list.nalus()[1];
+    EXPECT_EQ(H264NaluType::SPS, sps.type);
+    EXPECT_EQ(packet.data() + 6, sps.start);
+    EXPECT_EQ(15u, sps.size);
+    EXPECT_EQ(sps.start + 4, sps.data);
+
+    size_t total = 0;
+    for (const auto& nalu : list.nalus()) {
+        total += nalu.size;
+    }
+    EXPECT_EQ(packet.size(), total);
+
+    // Stops at the first slice, which then runs to the end.
+    list.parse(packet.data(), packet.size(), true);
+    ASSERT_EQ(4u, list.nalus().size());
+    EXPECT_EQ(packet.data() + packet.size(),
+              list.nalus()[3].start + list.nalus()[3].size);
+    EXPECT_TRUE(list.contains(H264NaluType::PPS));
+
+    list.parse(packet.data(), 3);
+    EXPECT_TRUE(list.empty());
+    EXPECT_EQ(H264NaluType::Undefined, list.firstType());
+}
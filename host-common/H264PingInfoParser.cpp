@@ -129,5 +129,16 @@ void H264PingInfoParser::parseGetImageParams(void* ptr, GetImageParam& param) {
     param.pDecodedFrame = (uint8_t*)ptr + offset;
 }
 
+void H264PingInfoParser::parseSetOutputBufferParams(
+        void* ptr,
+        SetOutputBufferParam& param) {
+    param.hostDecoderId = parseHostDecoderId(ptr);
+    uint8_t* xptr = (uint8_t*)ptr;
+    // Same offset the guest passes to GetImage; 0 withdraws the buffer.
+    uint64_t offset = *(uint64_t*)(xptr + 8);
+    param.pOutputBuffer = offset ? (uint8_t*)ptr + offset : nullptr;
+    param.size = offset ? *(size_t*)(xptr + 16) : 0;
+}
+
 }  // namespace emulation
 }  // namespace android
@@ -0,0 +1,70 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/HevcNaluParser.h"
+
+#include "host-common/StartCodeScanner.h"
+
+namespace android {
+namespace emulation {
+
+namespace {
+
+// The IRAP types, 16 to 23, as bits of HevcNaluList::mTypes.
+constexpr uint64_t kIrapMask = uint64_t(0xff) << 16;
+constexpr uint64_t kParameterSetMask =
+        (uint64_t(1) << static_cast<uint8_t>(HevcNaluType::VPS)) |
+        (uint64_t(1) << static_cast<uint8_t>(HevcNaluType::SPS));
+
+// Returns the start of the next start code, four byte ones from their
+// first zero, or nullptr.
+const uint8_t* nextStartCode(const uint8_t* frame, const uint8_t* data,
+                             const uint8_t* end) {
+    const uint8_t* p = findStartCode(data, end - data);
+    if (p != nullptr && p > frame && p[-1] == 0) {
+        --p;
+    }
+    return p;
+}
+
+}  // namespace
+
+void HevcNaluList::parse(const uint8_t* frame, size_t szBytes,
+                         bool stopAtFirstSlice) {
+    mNalus.clear();
+    mTypes = 0;
+    const uint8_t* const end = frame + szBytes;
+    const uint8_t* start = nextStartCode(frame, frame, end);
+    while (start != nullptr) {
+        const uint8_t* data = start + (start[2] == 0 ? 4 : 3);
+        if (data + 2 > end) {
+            break;
+        }
+        const HevcNaluType type = static_cast<HevcNaluType>((data[0] >> 1) & 0x3f);
+        const uint8_t* next = (stopAtFirstSlice && hevcIsSlice(type))
+                                      ? nullptr
+                                      : nextStartCode(frame, data + 2, end);
+        mNalus.push_back(Nalu{type, start, size_t((next ? next : end) - start), data});
+        mTypes |= uint64_t(1) << static_cast<uint8_t>(type);
+        start = next;
+    }
+}
+
+bool HevcNaluList::isKeyFrame() const {
+    return (mTypes & (kIrapMask | kParameterSetMask)) != 0;
+}
+
+}  // namespace emulation
+}  // namespace android
@@ -0,0 +1,100 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/HevcNaluParser.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using android::emulation::HevcNaluList;
+using android::emulation::HevcNaluType;
+
+namespace {
+
+void appendNalu(std::vector<uint8_t>* packet,
+                bool fourByteStartCode,
+                HevcNaluType type,
+                size_t payloadSize) {
+    if (fourByteStartCode) {
+        packet->push_back(0);
+    }
+    packet->insert(packet->end(),
+                   {0, 0, 1, static_cast<uint8_t>(static_cast<uint8_t>(type) << 1), 1});
+    for (size_t i = 0; i < payloadSize; ++i) {
+        packet->push_back(static_cast<uint8_t>(0x80 | i));
+    }
+}
+
+}  // namespace
+
+// Tests splitting a key frame packet into its NALUs.
+TEST(HevcNaluList, Parse) {
+    std::vector<uint8_t> packet;
+    appendNalu(&packet, true, HevcNaluType::VPS, 3);
+    appendNalu(&packet, true, HevcNaluType::SPS, 20);
+    appendNalu(&packet, false, HevcNaluType::PPS, 4);
+    appendNalu(&packet, false, HevcNaluType::IdrWRadl, 100);
+
+    HevcNaluList list;
+    list.parse(packet.data(), packet.size());
+    ASSERT_EQ(4u, list.nalus().size());
+    EXPECT_EQ(HevcNaluType::VPS, list.nalus()[0].type);
+    EXPECT_EQ(packet.data(), list.nalus()[0].start);
+    EXPECT_EQ(9u, list.nalus()[0].size);
+    EXPECT_EQ(packet.data() + 4, list.nalus()[0].data);
+    EXPECT_EQ(HevcNaluType::SPS, list.nalus()[1].type);
+    EXPECT_EQ(26u, list.nalus()[1].size);
+    EXPECT_EQ(HevcNaluType::PPS, list.nalus()[2].type);
+    EXPECT_EQ(9u, list.nalus()[2].size);
+    EXPECT_EQ(HevcNaluType::IdrWRadl, list.nalus()[3].type);
+    EXPECT_EQ(105u, list.nalus()[3].size);
+    EXPECT_TRUE(list.contains(HevcNaluType::PPS));
+    EXPECT_FALSE(list.contains(HevcNaluType::PrefixSEI));
+    EXPECT_TRUE(list.isKeyFrame());
+}
+
+// Tests that only IRAP pictures and parameter sets make a key frame.
+TEST(HevcNaluList, KeyFrame) {
+    HevcNaluList list;
+    std::vector<uint8_t> packet;
+    appendNalu(&packet, false, HevcNaluType::PrefixSEI, 2);
+    appendNalu(&packet, false, HevcNaluType::TrailR, 50);
+    list.parse(packet.data(), packet.size());
+    EXPECT_EQ(2u, list.nalus().size());
+    EXPECT_FALSE(list.isKeyFrame());
+
+    packet.clear();
+    appendNalu(&packet, true, HevcNaluType::Cra, 50);
+    list.parse(packet.data(), packet.size());
+    EXPECT_TRUE(list.isKeyFrame());
+
+    list.parse(packet.data(), 3);
+    EXPECT_TRUE(list.empty());
+}
+
+// Tests that parsing can stop at the first slice.
+TEST(HevcNaluList, StopAtFirstSlice) {
+    std::vector<uint8_t> packet;
+    appendNalu(&packet, false, HevcNaluType::AccessUnitDelimiter, 1);
+    appendNalu(&packet, false, HevcNaluType::TrailN, 10);
+    appendNalu(&packet, false, HevcNaluType::TrailN, 10);
+
+    HevcNaluList list;
+    list.parse(packet.data(), packet.size(), true);
+    ASSERT_EQ(2u, list.nalus().size());
+    EXPECT_EQ(packet.data() + packet.size(),
+              list.nalus()[1].start + list.nalus()[1].size);
+}
@@ -17,10 +17,13 @@
 #include "host-common/GraphicsAgentFactory.h"
 #include "host-common/address_space_device.h"
 #include "host-common/address_space_device.hpp"
+#include "host-common/address_space_shared_slots_host_memory_allocator.h"
 #include "host-common/testing/MockGraphicsAgentFactory.h"
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 namespace android {
 
 class HostAddressSpaceTest : public ::testing::Test {
@@ -225,4 +228,54 @@ TEST_F(HostAddressSpaceTest, HostAddressMapping) {
     mDevice->close(handle);
 }
 
+// Tests that a batched ping performs every queued entry in order, across
+// the ring wrapping around.
+TEST_F(HostAddressSpaceTest, PingBatch) {
+    using emulation::AddressSpaceDevicePingInfo;
+    using emulation::AddressSpaceDevicePingRing;
+    using emulation::AddressSpaceSharedSlotsHostMemoryAllocatorContext;
+    constexpr uint32_t kCapacity = 4;
+    const uint64_t kSupported = static_cast<uint64_t>(
+        AddressSpaceSharedSlotsHostMemoryAllocatorContext::
+            HostMemoryAllocatorCommand::CheckIfSharedSlotsSupported);
+
+    std::vector<uint64_t> storage(
+        (sizeof(AddressSpaceDevicePingRing) +
+         kCapacity * sizeof(AddressSpaceDevicePingInfo)) / sizeof(uint64_t));
+    auto ring = reinterpret_cast<AddressSpaceDevicePingRing*>(storage.data());
+    ring->capacity = kCapacity;
+    AddressSpaceDevicePingInfo* entries = ring->entries();
+
+    auto ops = get_address_space_device_control_ops();
+    uint32_t handle = mDevice->open();
+
+    // The first entry creates the context, the rest run on it.
+    entries[0].metadata = static_cast<uint64_t>(
+        emulation::AddressSpaceDeviceType::SharedSlotsHostMemoryAllocator);
+    entries[1].metadata = kSupported;
+    entries[2].metadata = 99;  // unknown command
+    ring->head = 3;
+    ops->ping_batch_at_hva(handle, ring);
+    EXPECT_EQ(3u, ring->tail);
+    EXPECT_EQ(0u, entries[0].metadata);
+    EXPECT_EQ(0u, entries[1].metadata);
+    EXPECT_EQ(~0ULL, entries[2].metadata);
+
+    entries[3].metadata = kSupported;
+    entries[0].metadata = kSupported;
+    entries[1].metadata = kSupported;
+    ring->head = 6;
+    ops->ping_batch_at_hva(handle, ring);
+    EXPECT_EQ(6u, ring->tail);
+    EXPECT_EQ(0u, entries[3].metadata);
+    EXPECT_EQ(0u, entries[0].metadata);
+    EXPECT_EQ(0u, entries[1].metadata);
+
+    // Nothing queued, nothing done.
+    ops->ping_batch_at_hva(handle, ring);
+    EXPECT_EQ(6u, ring->tail);
+
+    mDevice->close(handle);
+}
+
 } // namespace android
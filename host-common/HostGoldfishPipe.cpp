@@ -24,6 +24,7 @@
 #include "host-common/VmLock.h"
 
 #include <algorithm>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -85,7 +86,49 @@ int HostGoldfishPipeDevice::getErrno() const {
 // Also opens.
 int HostGoldfishPipeDevice::connect(const char* name) {
     const auto handshake = std::string("pipe:") + name;
+    return connectWithHandshake(
+        std::vector<uint8_t>(handshake.c_str(),
+                             handshake.c_str() + handshake.size() + 1),
+        name);
+}
+
+int HostGoldfishPipeDevice::connectById(uint32_t serviceId, const char* args) {
+    const size_t argsSize = args ? strlen(args) : 0;
+    std::vector<uint8_t> handshake(AndroidPipe::kBinaryConnectMagic,
+                                   AndroidPipe::kBinaryConnectMagic +
+                                       sizeof(AndroidPipe::kBinaryConnectMagic));
+    for (uint32_t value : {serviceId, static_cast<uint32_t>(argsSize)}) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            handshake.push_back(static_cast<uint8_t>(value >> shift));
+        }
+    }
+    handshake.insert(handshake.end(), args, args + argsSize);
+    const std::string name = "id " + std::to_string(serviceId);
+    return connectWithHandshake(handshake, name.c_str());
+}
+
+int HostGoldfishPipeDevice::connectWithBulkRing(uint32_t serviceId,
+                                                uint64_t ringGpa,
+                                                const char* args) {
+    const size_t argsSize = args ? strlen(args) : 0;
+    std::vector<uint8_t> handshake(AndroidPipe::kBulkConnectMagic,
+                                   AndroidPipe::kBulkConnectMagic +
+                                       sizeof(AndroidPipe::kBulkConnectMagic));
+    for (uint64_t value : {uint64_t(serviceId), uint64_t(argsSize)}) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            handshake.push_back(static_cast<uint8_t>(value >> shift));
+        }
+    }
+    for (int shift = 0; shift < 64; shift += 8) {
+        handshake.push_back(static_cast<uint8_t>(ringGpa >> shift));
+    }
+    handshake.insert(handshake.end(), args, args + argsSize);
+    const std::string name = "id " + std::to_string(serviceId) + " in bulk mode";
+    return connectWithHandshake(handshake, name.c_str());
+}
 
+int HostGoldfishPipeDevice::connectWithHandshake(
+    const std::vector<uint8_t>& handshake, const char* name) {
     ScopedVmLock lock;
     const int hwPipeFd = ++mFdGenerator;
     std::unique_ptr<HostHwPipe> hwPipe = HostHwPipe::create(hwPipeFd);
@@ -97,8 +140,9 @@ int HostGoldfishPipeDevice::connect(const char* name) {
         return kNoFd;
     }
 
-    const ssize_t len = static_cast<ssize_t>(handshake.size()) + 1;
-    const ssize_t ret = writeInternal(&hostPipe, handshake.c_str(), len);
+    const ssize_t len = static_cast<ssize_t>(handshake.size());
+    const AndroidPipeBuffer buf = {(uint8_t*)handshake.data(), (size_t)len};
+    const ssize_t ret = writeInternal(&hostPipe, &buf, 1);
 
     if (ret == len) {
         HostHwPipe* hwPipeWeak = associatePipes(std::move(hwPipe), hostPipe);
@@ -131,6 +175,13 @@ void HostGoldfishPipeDevice::close(const int fd) {
 
 // Read/write/poll but for a particular pipe.
 ssize_t HostGoldfishPipeDevice::read(const int fd, void* buffer, size_t len) {
+    AndroidPipeBuffer buf = { static_cast<uint8_t*>(buffer), len };
+    return readv(fd, &buf, 1);
+}
+
+ssize_t HostGoldfishPipeDevice::readv(const int fd,
+                                      AndroidPipeBuffer* buffers,
+                                      int numBuffers) {
     ScopedVmLock lock;
 
     FdInfo* fdInfo = lookupFdInfo(fd);
@@ -140,27 +191,39 @@ ssize_t HostGoldfishPipeDevice::read(const int fd, void* buffer, size_t len) {
         return PIPE_ERROR_INVAL;
     }
 
-    AndroidPipeBuffer buf = { static_cast<uint8_t*>(buffer), len };
-    ssize_t res = android_pipe_guest_recv(fdInfo->hostPipe, &buf, 1);
+    ssize_t res = android_pipe_guest_recv(fdInfo->hostPipe, buffers, numBuffers);
     setErrno(res);
     return res;
 }
 
+ssize_t HostGoldfishPipeDevice::read(const int fd,
+                                     std::vector<uint8_t>* buffer,
+                                     size_t maxLength) {
+    buffer->resize(maxLength);
+    ssize_t read_size = read(fd, buffer->data(), maxLength);
+    buffer->resize(read_size < 0 ? 0 : read_size);
+    return read_size;
+}
+
 HostGoldfishPipeDevice::ReadResult HostGoldfishPipeDevice::read(int fd, size_t maxLength) {
-    std::vector<uint8_t> resultBuffer(maxLength);
-    ssize_t read_size = read(fd, resultBuffer.data(), maxLength);
+    std::vector<uint8_t> resultBuffer;
+    ssize_t read_size = read(fd, &resultBuffer, maxLength);
 
     if (read_size < 0) {
         return Err(mErrno);
     } else {
-        if (read_size < maxLength) {
-            resultBuffer.resize(read_size);
-        }
-        return Ok(resultBuffer);
+        return Ok(std::move(resultBuffer));
     }
 }
 
 ssize_t HostGoldfishPipeDevice::write(const int fd, const void* buffer, size_t len) {
+    AndroidPipeBuffer buf = { (uint8_t*)buffer, len };
+    return writev(fd, &buf, 1);
+}
+
+ssize_t HostGoldfishPipeDevice::writev(const int fd,
+                                       const AndroidPipeBuffer* buffers,
+                                       int numBuffers) {
     ScopedVmLock lock;
 
     FdInfo* fdInfo = lookupFdInfo(fd);
@@ -170,7 +233,7 @@ ssize_t HostGoldfishPipeDevice::write(const int fd, const void* buffer, size_t l
         return PIPE_ERROR_INVAL;
     }
 
-    return writeInternal(&fdInfo->hostPipe, buffer, len);
+    return writeInternal(&fdInfo->hostPipe, buffers, numBuffers);
 }
 
 HostGoldfishPipeDevice::WriteResult
@@ -222,12 +285,23 @@ void HostGoldfishPipeDevice::saveSnapshot(base::Stream* stream) {
 
     android_pipe_guest_pre_save(cStream);
     stream_put_be32(cStream, mFdInfo.size());
+    std::vector<int> fds;
+    std::vector<void*> hostPipes;
+    fds.reserve(mFdInfo.size());
+    hostPipes.reserve(mFdInfo.size());
     for (const auto& kv : mFdInfo) {
         HOST_PIPE_DLOG("save pipe: fd=%d hwPipe=%p hostPipe=%p",
                        kv.first, kv.second.hwPipe.get(), kv.second.hostPipe);
-        stream_put_be32(cStream, kv.first);
-        android_pipe_guest_save(kv.second.hostPipe, cStream);
+        fds.push_back(kv.first);
+        hostPipes.push_back(kv.second.hostPipe);
     }
+    // Each pipe's state is preceded by its fd.
+    android_pipe_guest_save_all(
+            hostPipes.data(), hostPipes.size(), cStream,
+            [](void* opaque, int index, ::Stream* stream) {
+                stream_put_be32(stream, (*static_cast<std::vector<int>*>(opaque))[index]);
+            },
+            &fds);
     android_pipe_guest_post_save(cStream);
 }
 
@@ -403,10 +477,9 @@ bool HostGoldfishPipeDevice::eraseFdInfo(const int fd) {
 }
 
 ssize_t HostGoldfishPipeDevice::writeInternal(InternalPipe** ppipe,
-                                              const void* buffer,
-                                              size_t len) {
-    AndroidPipeBuffer buf = {(uint8_t*)buffer, len};
-    ssize_t res = android_pipe_guest_send((void**)ppipe, &buf, 1);
+                                              const AndroidPipeBuffer* buffers,
+                                              int numBuffers) {
+    ssize_t res = android_pipe_guest_send((void**)ppipe, buffers, numBuffers);
     setErrno(res);
     return res;
 }
@@ -14,11 +14,188 @@
 #include "host-common/HostGoldfishPipe.h"
 
 #include "host-common/AndroidMessagePipe.h"
+#include "host-common/AndroidPipe.h"
+
+#include "aemu/base/containers/CowBuffer.h"
+#include "aemu/base/files/MemStream.h"
+#include "host-common/android_pipe_device.h"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
 namespace android {
 
+using base::MemStream;
+
+namespace {
+
+// A pipe whose only state is a number, and whose service can be told to
+// allow concurrent snapshots.
+class SnapshotTestPipe : public AndroidPipe {
+public:
+    SnapshotTestPipe(void* hwPipe, Service* service, uint32_t value)
+        : AndroidPipe(hwPipe, service), mValue(value) {}
+
+    void onGuestClose(PipeCloseReason reason) override { delete this; }
+    unsigned onGuestPoll() const override { return 0; }
+    int onGuestRecv(AndroidPipeBuffer* buffers, int numBuffers) override {
+        return PIPE_ERROR_AGAIN;
+    }
+    int onGuestSend(const AndroidPipeBuffer* buffers,
+                    int numBuffers,
+                    void** newPipePtr) override {
+        return PIPE_ERROR_AGAIN;
+    }
+    void onGuestWantWakeOn(int flags) override {}
+    void onSave(base::Stream* stream) override { stream->putBe32(mValue); }
+
+    const uint32_t mValue;
+};
+
+class SnapshotTestService : public AndroidPipe::Service {
+public:
+    SnapshotTestService(const char* name, bool concurrent)
+        : Service(name), mConcurrent(concurrent) {}
+
+    AndroidPipe* create(void* hwPipe, const char* args,
+                        enum AndroidPipeFlags flags) override {
+        return new SnapshotTestPipe(hwPipe, this, mNextValue++);
+    }
+    bool canLoad() const override { return true; }
+    bool canSnapshotConcurrently() const override { return mConcurrent; }
+    AndroidPipe* load(void* hwPipe, const char* args,
+                      base::Stream* stream) override {
+        ++loadedPipes;
+        return new SnapshotTestPipe(hwPipe, this, stream->getBe32());
+    }
+    void preSave(base::Stream* stream) override { stream->putString(name()); }
+    void preLoad(base::Stream* stream) override {
+        if (stream && stream->getString() == name()) {
+            ++preLoads;
+        }
+    }
+
+    std::atomic<int> loadedPipes{0};
+    std::atomic<int> preLoads{0};
+
+private:
+    const bool mConcurrent;
+    uint32_t mNextValue = 100;
+};
+
+// Echoes back everything sent to it, as one stream of bytes.
+class EchoTestPipe : public AndroidPipe {
+public:
+    EchoTestPipe(void* hwPipe, Service* service) : AndroidPipe(hwPipe, service) {}
+
+    void onGuestClose(PipeCloseReason reason) override { delete this; }
+    unsigned onGuestPoll() const override {
+        return PIPE_POLL_OUT | (mData.empty() ? 0 : PIPE_POLL_IN);
+    }
+    int onGuestRecv(AndroidPipeBuffer* buffers, int numBuffers) override {
+        if (mData.empty()) return PIPE_ERROR_AGAIN;
+        size_t copied = 0;
+        for (int i = 0; i < numBuffers && copied < mData.size(); i++) {
+            const size_t n = std::min(buffers[i].size, mData.size() - copied);
+            memcpy(buffers[i].data, mData.data() + copied, n);
+            copied += n;
+        }
+        mData.erase(mData.begin(), mData.begin() + copied);
+        return copied;
+    }
+    int onGuestSend(const AndroidPipeBuffer* buffers,
+                    int numBuffers,
+                    void** newPipePtr) override {
+        size_t total = 0;
+        for (int i = 0; i < numBuffers; i++) {
+            mData.insert(mData.end(), buffers[i].data,
+                         buffers[i].data + buffers[i].size);
+            total += buffers[i].size;
+        }
+        return total;
+    }
+    void onGuestWantWakeOn(int flags) override {}
+
+private:
+    std::vector<uint8_t> mData;
+};
+
+class EchoTestService : public AndroidPipe::Service {
+public:
+    EchoTestService() : Service("echoTest") {}
+    AndroidPipe* create(void* hwPipe, const char* args,
+                        enum AndroidPipeFlags flags) override {
+        lastArgs = args ? args : "<null>";
+        return new EchoTestPipe(hwPipe, this);
+    }
+
+    std::string lastArgs;
+};
+
+// Keeps everything sent to it; every other pipe defers its snapshot.
+class BufferingTestPipe : public AndroidPipe {
+public:
+    BufferingTestPipe(void* hwPipe, Service* service, bool deferred)
+        : AndroidPipe(hwPipe, service), mDeferred(deferred) {}
+
+    void onGuestClose(PipeCloseReason reason) override { delete this; }
+    unsigned onGuestPoll() const override { return PIPE_POLL_OUT; }
+    int onGuestRecv(AndroidPipeBuffer* buffers, int numBuffers) override {
+        return PIPE_ERROR_AGAIN;
+    }
+    int onGuestSend(const AndroidPipeBuffer* buffers,
+                    int numBuffers,
+                    void** newPipePtr) override {
+        size_t total = 0;
+        for (int i = 0; i < numBuffers; i++) {
+            mPending.append(buffers[i].data, buffers[i].size);
+            total += buffers[i].size;
+        }
+        return total;
+    }
+    void onGuestWantWakeOn(int flags) override {}
+    void onSave(base::Stream* stream) override {
+        stream->putBe32(mPending.size());
+        stream->write(mPending.data(), mPending.size());
+    }
+    DeferredSave onSaveDeferred() override {
+        if (!mDeferred) {
+            return {};
+        }
+        return [view = mPending.view()](base::Stream* stream) {
+            stream->putBe32(view.size());
+            stream->write(view.data(), view.size());
+        };
+    }
+
+    base::CowBuffer mPending;
+
+private:
+    const bool mDeferred;
+};
+
+class BufferingTestService : public AndroidPipe::Service {
+public:
+    BufferingTestService() : Service("bufferingTest") {}
+    AndroidPipe* create(void* hwPipe, const char* args,
+                        enum AndroidPipeFlags flags) override {
+        mDeferNext = !mDeferNext;
+        return new BufferingTestPipe(hwPipe, this, mDeferNext);
+    }
+    bool canLoad() const override { return true; }
+
+private:
+    bool mDeferNext = false;
+};
+
+}  // namespace
+
 class HostGoldfishPipeTest : public ::testing::Test {
 protected:
     void SetUp() override {
@@ -79,4 +256,153 @@ TEST_F(HostGoldfishPipeTest, MessagePipe) {
    mDevice->close(pipe);
 }
 
+// Test: services that allow concurrent snapshots produce the same snapshot
+// as serial ones, and it loads back.
+TEST_F(HostGoldfishPipeTest, ConcurrentSnapshot) {
+    std::vector<int> fds;
+    auto saveWith = [this, &fds](bool concurrent) {
+        AndroidPipe::Service::resetAll();
+        std::vector<SnapshotTestService*> services;
+        for (int i = 0; i < 4; i++) {
+            auto service = std::make_unique<SnapshotTestService>(
+                ("snapshotTest" + std::to_string(i)).c_str(), concurrent);
+            services.push_back(service.get());
+            AndroidPipe::Service::add(std::move(service));
+        }
+        fds.clear();
+        for (int i = 0; i < 32; i++) {
+            fds.push_back(mDevice->connect(services[i % 4]->name().c_str()));
+        }
+
+        MemStream snapshot;
+        mDevice->saveSnapshot(&snapshot);
+        for (int fd : fds) {
+            mDevice->close(fd);
+        }
+        return snapshot;
+    };
+
+    MemStream serial = saveWith(false);
+    MemStream concurrent = saveWith(true);
+    ASSERT_EQ(serial.writtenSize(), concurrent.writtenSize());
+    EXPECT_EQ(0, memcmp(serial.buffer().data(), concurrent.buffer().data(),
+                        serial.writtenSize()));
+
+    AndroidPipe::Service::resetAll();
+    auto service = std::make_unique<SnapshotTestService>("snapshotTest0", true);
+    SnapshotTestService* loading = service.get();
+    AndroidPipe::Service::add(std::move(service));
+    for (int i = 1; i < 4; i++) {
+        AndroidPipe::Service::add(std::make_unique<SnapshotTestService>(
+            ("snapshotTest" + std::to_string(i)).c_str(), true));
+    }
+    mDevice->loadSnapshot(&concurrent);
+    EXPECT_EQ(1, loading->preLoads.load());
+    EXPECT_EQ(8, loading->loadedPipes.load());
+    for (int fd : fds) {
+        mDevice->close(fd);
+    }
+}
+
+TEST_F(HostGoldfishPipeTest, ScatterGather) {
+    AndroidPipe::Service::add(std::make_unique<EchoTestService>());
+    int fd = mDevice->connect("echoTest");
+    ASSERT_NE(HostGoldfishPipeDevice::kNoFd, fd);
+
+    uint8_t header[4] = {1, 2, 3, 4};
+    uint8_t payload[8] = {5, 6, 7, 8, 9, 10, 11, 12};
+    const AndroidPipeBuffer out[] = {{header, sizeof(header)},
+                                     {payload, sizeof(payload)}};
+    EXPECT_EQ(12, mDevice->writev(fd, out, 2));
+
+    uint8_t first[6];
+    uint8_t second[6];
+    AndroidPipeBuffer in[] = {{first, sizeof(first)}, {second, sizeof(second)}};
+    EXPECT_EQ(12, mDevice->readv(fd, in, 2));
+    EXPECT_EQ(0, memcmp(first, "\x01\x02\x03\x04\x05\x06", 6));
+    EXPECT_EQ(0, memcmp(second, "\x07\x08\x09\x0a\x0b\x0c", 6));
+
+    // The reused vector keeps its storage between reads.
+    std::vector<uint8_t> buffer;
+    EXPECT_EQ(4, mDevice->write(fd, header, sizeof(header)));
+    EXPECT_EQ(4, mDevice->read(fd, &buffer, 64));
+    EXPECT_EQ(std::vector<uint8_t>(header, header + 4), buffer);
+    const uint8_t* storage = buffer.data();
+    EXPECT_EQ(4, mDevice->write(fd, header, sizeof(header)));
+    EXPECT_EQ(4, mDevice->read(fd, &buffer, 64));
+    EXPECT_EQ(storage, buffer.data());
+
+    mDevice->close(fd);
+}
+
+// Tests that a snapshot taken in two steps matches a regular one, even
+// though the pipes kept receiving data in between.
+TEST_F(HostGoldfishPipeTest, DeferredSnapshot) {
+    AndroidPipe::Service::add(std::make_unique<BufferingTestService>());
+    std::vector<int> fds;
+    std::vector<void*> pipes;
+    for (int i = 0; i < 4; ++i) {
+        fds.push_back(mDevice->connect("bufferingTest"));
+        ASSERT_NE(HostGoldfishPipeDevice::kNoFd, fds.back());
+        const std::vector<uint8_t> data(1000 * (i + 1), 'a' + i);
+        EXPECT_TRUE(mDevice->write(fds.back(), data).ok());
+        pipes.push_back(mDevice->getHostPipe(fds.back()));
+    }
+    const auto beforeEach = [](void* opaque, int index, ::Stream* stream) {
+        reinterpret_cast<base::Stream*>(stream)->putBe32(index);
+    };
+
+    MemStream expected;
+    android_pipe_guest_save_all(pipes.data(), pipes.size(),
+                                reinterpret_cast<::Stream*>(&expected),
+                                beforeEach, nullptr);
+
+    AndroidPipeSaveJob* job = android_pipe_guest_save_all_begin(
+            pipes.data(), pipes.size(), beforeEach, nullptr);
+    const uint8_t more[3] = {1, 2, 3};
+    for (int fd : fds) {
+        EXPECT_EQ(3, mDevice->write(fd, more, sizeof(more)));
+    }
+    EXPECT_EQ(2003u, static_cast<BufferingTestPipe*>(pipes[1])->mPending.size());
+
+    MemStream actual;
+    android_pipe_guest_save_all_end(job, reinterpret_cast<::Stream*>(&actual));
+    EXPECT_EQ(expected.buffer(), actual.buffer());
+
+    for (int fd : fds) {
+        mDevice->close(fd);
+    }
+}
+
+TEST_F(HostGoldfishPipeTest, BinaryConnect) {
+    auto service = std::make_unique<EchoTestService>();
+    EchoTestService* echo = service.get();
+    AndroidPipe::Service::add(std::move(service));
+    constexpr uint32_t kEchoId = AndroidPipe::Service::idForName("echoTest");
+
+    int fd = mDevice->connectById(kEchoId, "some:args");
+    ASSERT_NE(HostGoldfishPipeDevice::kNoFd, fd);
+    EXPECT_EQ("some:args", echo->lastArgs);
+    uint8_t data[3] = {1, 2, 3};
+    EXPECT_EQ(3, mDevice->write(fd, data, sizeof(data)));
+    std::vector<uint8_t> buffer;
+    EXPECT_EQ(3, mDevice->read(fd, &buffer, 64));
+    mDevice->close(fd);
+
+    fd = mDevice->connectById(kEchoId);
+    ASSERT_NE(HostGoldfishPipeDevice::kNoFd, fd);
+    EXPECT_EQ("<null>", echo->lastArgs);
+    mDevice->close(fd);
+
+    EXPECT_EQ(HostGoldfishPipeDevice::kNoFd, mDevice->connectById(kEchoId + 1));
+    EXPECT_EQ(HostGoldfishPipeDevice::kNoFd,
+              mDevice->connectById(kEchoId, std::string(120, 'x').c_str()));
+
+    // The text form still works, and finds the same service.
+    fd = mDevice->connect("echoTest:more");
+    ASSERT_NE(HostGoldfishPipeDevice::kNoFd, fd);
+    EXPECT_EQ("more", echo->lastArgs);
+    mDevice->close(fd);
+}
+
 } // namespace android
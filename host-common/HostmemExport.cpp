@@ -0,0 +1,212 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "host-common/HostmemExport.h"
+
+#include "aemu/base/EintrWrapper.h"
+
+#ifdef _WIN32
+#include "aemu/base/sockets/Winsock.h"
+#else
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+
+using android::base::ManagedDescriptor;
+
+namespace android {
+namespace emulation {
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+HostmemExportInfo makeInfo(uint64_t id, const ManagedDescriptorInfo& descriptorInfo) {
+    HostmemExportInfo info = {};
+    info.magic = HostmemExportInfo::kMagic;
+    info.version = HostmemExportInfo::kVersion;
+    info.id = id;
+    info.size = HostmemIdMapping::get()->get(id).size;
+    info.handleType = descriptorInfo.handleType;
+    info.caching = descriptorInfo.caching;
+    if (descriptorInfo.vulkanInfoOpt) {
+        info.hasVulkanInfo = 1;
+        info.vulkanInfo = *descriptorInfo.vulkanInfoOpt;
+    }
+    return info;
+}
+
+bool sendAll(int socket, const char* data, size_t size) {
+    while (size) {
+#ifdef _WIN32
+        const int sent = ::send(socket, data, static_cast<int>(size), 0);
+#else
+        const ssize_t sent = HANDLE_EINTR(::send(socket, data, size, kSendFlags));
+#endif
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+bool recvAll(int socket, char* data, size_t size) {
+    while (size) {
+#ifdef _WIN32
+        const int got = ::recv(socket, data, static_cast<int>(size), 0);
+#else
+        const ssize_t got = HANDLE_EINTR(::recv(socket, data, size, 0));
+#endif
+        if (got <= 0) {
+            return false;
+        }
+        data += got;
+        size -= got;
+    }
+    return true;
+}
+
+bool isValid(const HostmemExportInfo& info) {
+    return info.magic == HostmemExportInfo::kMagic &&
+           info.version == HostmemExportInfo::kVersion;
+}
+
+}  // namespace
+
+#ifdef _WIN32
+
+int hostmemSendDescriptor(int socket, uint64_t id, HANDLE peerProcess) {
+    auto descriptorInfo = HostmemIdMapping::get()->dupDescriptorInfo(id);
+    if (!descriptorInfo) {
+        return -ENOENT;
+    }
+    HostmemExportInfo info = makeInfo(id, *descriptorInfo);
+    HANDLE remote = nullptr;
+    if (!DuplicateHandle(GetCurrentProcess(), *descriptorInfo->descriptor.get(), peerProcess,
+                         &remote, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+        return -EPERM;
+    }
+    info.handle = reinterpret_cast<uintptr_t>(remote);
+    if (!sendAll(socket, reinterpret_cast<const char*>(&info), sizeof(info))) {
+        // Nobody will close it on the other side.
+        DuplicateHandle(peerProcess, remote, nullptr, nullptr, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+        return -EPIPE;
+    }
+    return 0;
+}
+
+std::optional<ManagedDescriptor> hostmemRecvDescriptor(int socket, HostmemExportInfo* info) {
+    HostmemExportInfo received;
+    if (!recvAll(socket, reinterpret_cast<char*>(&received), sizeof(received)) ||
+        !isValid(received) || !received.handle) {
+        return std::nullopt;
+    }
+    *info = received;
+    return ManagedDescriptor(reinterpret_cast<HANDLE>(static_cast<uintptr_t>(received.handle)));
+}
+
+#else  // !_WIN32
+
+int hostmemSendDescriptor(int socket, uint64_t id) {
+    auto descriptorInfo = HostmemIdMapping::get()->dupDescriptorInfo(id);
+    if (!descriptorInfo) {
+        return -ENOENT;
+    }
+    const HostmemExportInfo info = makeInfo(id, *descriptorInfo);
+    const int fd = *descriptorInfo->descriptor.get();
+
+    iovec iov = {const_cast<HostmemExportInfo*>(&info), sizeof(info)};
+    union {
+        cmsghdr align;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    // The descriptor travels with the first byte; the rest may follow in
+    // plain sends. Our duplicate closes on return, the receiver has its own.
+    const ssize_t sent = HANDLE_EINTR(::sendmsg(socket, &msg, kSendFlags));
+    if (sent <= 0) {
+        return sent < 0 ? -errno : -EPIPE;
+    }
+    if (!sendAll(socket, reinterpret_cast<const char*>(&info) + sent, sizeof(info) - sent)) {
+        return -EPIPE;
+    }
+    return 0;
+}
+
+std::optional<ManagedDescriptor> hostmemRecvDescriptor(int socket, HostmemExportInfo* info) {
+    HostmemExportInfo received;
+    iovec iov = {&received, sizeof(received)};
+    union {
+        cmsghdr align;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+#ifdef MSG_CMSG_CLOEXEC
+    const int flags = MSG_CMSG_CLOEXEC;
+#else
+    const int flags = 0;
+#endif
+    const ssize_t got = HANDLE_EINTR(::recvmsg(socket, &msg, flags));
+    if (got <= 0) {
+        return std::nullopt;
+    }
+    ManagedDescriptor descriptor;
+    bool hasDescriptor = false;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+            cmsg->cmsg_len >= CMSG_LEN(sizeof(int))) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+            descriptor = ManagedDescriptor(fd);
+            hasDescriptor = true;
+        }
+    }
+    if (!hasDescriptor || (msg.msg_flags & MSG_CTRUNC) ||
+        !recvAll(socket, reinterpret_cast<char*>(&received) + got, sizeof(received) - got) ||
+        !isValid(received)) {
+        return std::nullopt;
+    }
+    *info = received;
+    return std::move(descriptor);
+}
+
+#endif  // !_WIN32
+
+}  // namespace emulation
+}  // namespace android
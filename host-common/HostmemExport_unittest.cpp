@@ -0,0 +1,141 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/HostmemExport.h"
+
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using android::base::ManagedDescriptor;
+using android::emulation::HostmemExportInfo;
+using android::emulation::HostmemIdMapping;
+using android::emulation::VulkanInfo;
+
+namespace {
+
+constexpr size_t kSize = 4096;
+
+class HostmemExportTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, mSockets));
+        // A file stands in for a memfd or dma-buf.
+        FILE* file = tmpfile();
+        ASSERT_TRUE(file);
+        mFd = dup(fileno(file));
+        fclose(file);
+        ASSERT_EQ(0, ftruncate(mFd, kSize));
+        mHva = mmap(nullptr, kSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+        ASSERT_NE(MAP_FAILED, mHva);
+    }
+
+    void TearDown() override {
+        // Once registered, mFd belongs to the mapping and closes with it.
+        if (!HostmemIdMapping::get()->removeDescriptorInfo(kId) && !mRegistered) {
+            close(mFd);
+        }
+        HostmemIdMapping::get()->remove(kId);
+        munmap(mHva, kSize);
+        close(mSockets[0]);
+        close(mSockets[1]);
+    }
+
+    // Registers the file as kId, the way a renderer registers a blob.
+    void registerBlob() {
+        MemEntry entry = {};
+        entry.hva = mHva;
+        entry.size = kSize;
+        entry.caching = MAP_CACHE_CACHED;
+        HostmemIdMapping::get()->addMapping(kId, &entry);
+        VulkanInfo vulkanInfo = {};
+        vulkanInfo.memoryIndex = 3;
+        HostmemIdMapping::get()->addDescriptorInfo(kId, ManagedDescriptor(mFd),
+                                                   STREAM_HANDLE_TYPE_MEM_OPAQUE_FD,
+                                                   MAP_CACHE_CACHED, vulkanInfo);
+        mRegistered = true;
+    }
+
+    static constexpr uint64_t kId = 0x7000001;
+    int mSockets[2] = {-1, -1};
+    int mFd = -1;
+    void* mHva = nullptr;
+    bool mRegistered = false;
+};
+
+// Tests that the helper maps the same memory the emulator writes.
+TEST_F(HostmemExportTest, SharesMemory) {
+    registerBlob();
+    ASSERT_EQ(0, android::emulation::hostmemSendDescriptor(mSockets[0], kId));
+
+    HostmemExportInfo info;
+    auto descriptor = android::emulation::hostmemRecvDescriptor(mSockets[1], &info);
+    ASSERT_TRUE(descriptor);
+    EXPECT_EQ(kId, info.id);
+    EXPECT_EQ(kSize, info.size);
+    EXPECT_EQ(uint32_t(STREAM_HANDLE_TYPE_MEM_OPAQUE_FD), info.handleType);
+    EXPECT_EQ(uint32_t(MAP_CACHE_CACHED), info.caching);
+    EXPECT_EQ(1u, info.hasVulkanInfo);
+    EXPECT_EQ(3u, info.vulkanInfo.memoryIndex);
+
+    auto fd = descriptor->get();
+    ASSERT_TRUE(fd);
+    EXPECT_NE(mFd, *fd);
+    void* mapped = mmap(nullptr, kSize, PROT_READ, MAP_SHARED, *fd, 0);
+    ASSERT_NE(MAP_FAILED, mapped);
+    strcpy(static_cast<char*>(mHva), "frame 1");
+    EXPECT_STREQ("frame 1", static_cast<const char*>(mapped));
+    munmap(mapped, kSize);
+}
+
+// Tests that an exported descriptor outlives the registration, and that
+// nothing can be exported once it is gone.
+TEST_F(HostmemExportTest, OutlivesRegistration) {
+    registerBlob();
+    strcpy(static_cast<char*>(mHva), "kept");
+    ASSERT_EQ(0, android::emulation::hostmemSendDescriptor(mSockets[0], kId));
+    HostmemIdMapping::get()->removeDescriptorInfo(kId);
+    HostmemIdMapping::get()->remove(kId);
+    EXPECT_EQ(-ENOENT, android::emulation::hostmemSendDescriptor(mSockets[0], kId));
+
+    HostmemExportInfo info;
+    auto descriptor = android::emulation::hostmemRecvDescriptor(mSockets[1], &info);
+    ASSERT_TRUE(descriptor);
+    void* mapped = mmap(nullptr, kSize, PROT_READ, MAP_SHARED, *descriptor->get(), 0);
+    ASSERT_NE(MAP_FAILED, mapped);
+    EXPECT_STREQ("kept", static_cast<const char*>(mapped));
+    munmap(mapped, kSize);
+}
+
+// Tests that plain data or a closed socket isn't taken for a descriptor.
+TEST_F(HostmemExportTest, RejectsGarbage) {
+    HostmemExportInfo info;
+    const char junk[sizeof(HostmemExportInfo)] = "not a descriptor";
+    ASSERT_EQ(ssize_t(sizeof(junk)), send(mSockets[0], junk, sizeof(junk), 0));
+    EXPECT_FALSE(android::emulation::hostmemRecvDescriptor(mSockets[1], &info));
+
+    shutdown(mSockets[0], SHUT_WR);
+    EXPECT_FALSE(android::emulation::hostmemRecvDescriptor(mSockets[1], &info));
+}
+
+}  // namespace
+
+#endif  // !_WIN32
@@ -13,8 +13,18 @@
 // limitations under the License.
 #include "host-common/HostmemIdMapping.h"
 
+#include "aemu/base/synchronization/EpochReclaimer.h"
+
 #include <utility>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#endif
+
+using android::base::AutoLock;
+using android::base::EpochReclaimer;
 using android::base::ManagedDescriptor;
 
 namespace android {
@@ -35,6 +45,60 @@ HostmemIdMapping* HostmemIdMapping::get() {
     return sMapping();
 }
 
+HostmemIdMapping::HostmemIdMapping() {
+    for (auto& chunk : mChunks) {
+        chunk.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+// No readers are left by the time the mapping goes away.
+HostmemIdMapping::~HostmemIdMapping() {
+    for (auto& chunk : mChunks) {
+        Chunk* c = chunk.load(std::memory_order_relaxed);
+        if (!c) continue;
+        for (auto& slot : c->slots) {
+            delete slot.load(std::memory_order_relaxed);
+        }
+        delete c;
+    }
+}
+
+std::atomic<HostmemIdMapping::Entry*>* HostmemIdMapping::slot(Id id,
+                                                            bool create) const {
+    const Id index = id >> kChunkBits;
+    if (index >= kMaxChunks) return nullptr;
+
+    Chunk* chunk = mChunks[index].load(std::memory_order_acquire);
+    if (!chunk) {
+        if (!create) return nullptr;
+        // Writers hold mLock, so nobody else is creating it.
+        chunk = new Chunk;
+        for (auto& s : chunk->slots) {
+            s.store(nullptr, std::memory_order_relaxed);
+        }
+        mChunks[index].store(chunk, std::memory_order_release);
+    }
+    return &chunk->slots[id & (kChunkSize - 1)];
+}
+
+void HostmemIdMapping::store(Id id, const Entry* entry) {
+    std::atomic<Entry*>* s = slot(id, entry != nullptr);
+    if (!s) {
+        if (entry) {
+            mOverflow.set(id, *entry);
+        } else {
+            mOverflow.erase(id);
+        }
+        return;
+    }
+    Entry* old = s->exchange(entry ? new Entry(*entry) : nullptr,
+                             std::memory_order_acq_rel);
+    if (old) {
+        EpochReclaimer::get().retire(
+                old, [](void* ptr) { delete static_cast<Entry*>(ptr); });
+    }
+}
+
 // TODO: Add registerHostmemFixed version that takes a predetermined id,
 // for snapshots
 Id HostmemIdMapping::add(const struct MemEntry *entry) {
@@ -54,12 +118,15 @@ Id HostmemIdMapping::add(const struct MemEntry *entry) {
     hostmem_entry.hva = entry->hva;
     hostmem_entry.size = entry->size;
     hostmem_entry.caching = entry->caching;
-    mEntries.set(wantedId, hostmem_entry);
+    AutoLock lock(mLock);
+    store(wantedId, &hostmem_entry);
     return wantedId;
 }
 
 void HostmemIdMapping::remove(Id id) {
-    mEntries.erase(id);
+    if (kInvalidHostmemId == id) return;
+    AutoLock lock(mLock);
+    store(id, nullptr);
 }
 
 void HostmemIdMapping::addMapping(Id id, const struct MemEntry *entry) {
@@ -68,7 +135,8 @@ void HostmemIdMapping::addMapping(Id id, const struct MemEntry *entry) {
     hostmem_entry.hva = entry->hva;
     hostmem_entry.size = entry->size;
     hostmem_entry.caching = entry->caching;
-    mEntries.set(id, hostmem_entry);
+    AutoLock lock(mLock);
+    store(id, &hostmem_entry);
 }
 
 void HostmemIdMapping::addDescriptorInfo(Id id, ManagedDescriptor descriptor,
@@ -83,10 +151,12 @@ void HostmemIdMapping::addDescriptorInfo(Id id, ManagedDescriptor descriptor,
         };
 
 
+    AutoLock lock(mLock);
     mDescriptorInfos.insert(std::make_pair(id, std::move(info)));
 }
 
 std::optional<ManagedDescriptorInfo> HostmemIdMapping::removeDescriptorInfo(Id id) {
+    AutoLock lock(mLock);
     auto found = mDescriptorInfos.find(id);
     if (found != mDescriptorInfos.end()) {
         std::optional<ManagedDescriptorInfo> ret = std::move(found->second);
@@ -97,6 +167,37 @@ std::optional<ManagedDescriptorInfo> HostmemIdMapping::removeDescriptorInfo(Id i
     return std::nullopt;
 }
 
+std::optional<ManagedDescriptorInfo> HostmemIdMapping::dupDescriptorInfo(Id id) const {
+    AutoLock lock(mLock);
+    auto found = mDescriptorInfos.find(id);
+    if (found == mDescriptorInfos.end()) {
+        return std::nullopt;
+    }
+    // get() isn't const, but only reads the raw descriptor.
+    auto raw = const_cast<ManagedDescriptor&>(found->second.descriptor).get();
+    if (!raw) {
+        return std::nullopt;
+    }
+#ifdef _WIN32
+    HANDLE dup = nullptr;
+    if (!DuplicateHandle(GetCurrentProcess(), *raw, GetCurrentProcess(), &dup, 0, FALSE,
+                         DUPLICATE_SAME_ACCESS)) {
+        return std::nullopt;
+    }
+#else
+    const int dup = fcntl(*raw, F_DUPFD_CLOEXEC, 0);
+    if (dup < 0) {
+        return std::nullopt;
+    }
+#endif
+    return ManagedDescriptorInfo{
+            .descriptor = ManagedDescriptor(dup),
+            .handleType = found->second.handleType,
+            .caching = found->second.caching,
+            .vulkanInfoOpt = found->second.vulkanInfoOpt,
+    };
+}
+
 HostmemIdMapping::Entry HostmemIdMapping::get(Id id) const {
     const HostmemIdMapping::Entry badEntry {
         kInvalidHostmemId, 0, 0,
@@ -104,7 +205,13 @@ HostmemIdMapping::Entry HostmemIdMapping::get(Id id) const {
 
     if (kInvalidHostmemId == id) return badEntry;
 
-    auto entry = mEntries.get(id);
+    if (const std::atomic<Entry*>* s = slot(id, false)) {
+        EpochReclaimer::ReadScope scope;
+        const Entry* entry = s->load(std::memory_order_acquire);
+        return entry ? *entry : badEntry;
+    }
+
+    auto entry = mOverflow.get(id);
 
     if (!entry) return badEntry;
 
@@ -112,7 +219,17 @@ HostmemIdMapping::Entry HostmemIdMapping::get(Id id) const {
 }
 
 void HostmemIdMapping::clear() {
-    mEntries.clear();
+    AutoLock lock(mLock);
+    for (auto& chunk : mChunks) {
+        Chunk* c = chunk.load(std::memory_order_relaxed);
+        if (!c) continue;
+        for (Id i = 0; i < kChunkSize; ++i) {
+            if (c->slots[i].load(std::memory_order_relaxed)) {
+                store(((&chunk - mChunks) << kChunkBits) | i, nullptr);
+            }
+        }
+    }
+    mOverflow.clear();
 }
 
 } // namespace android
@@ -16,6 +16,9 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <thread>
+
 using android::emulation::HostmemIdMapping;
 
 // Tests creation and destruction.
@@ -107,3 +110,66 @@ TEST(HostmemIdMapping, Clear) {
     EXPECT_EQ(0, entry.size);
 }
 
+
+// Tests that fixed ids work both inside and past the direct-index table.
+TEST(HostmemIdMapping, FixedIds) {
+    HostmemIdMapping m;
+    for (uint64_t fixedId : {uint64_t(5), uint64_t(70000), uint64_t(1) << 40}) {
+        MemEntry entry{
+            .hva = (void *)(uintptr_t) 0x1000,
+            .size = fixedId,
+            .register_fixed = 1,
+            .fixed_id = fixedId,
+            .caching = MAP_CACHE_NONE,
+        };
+        EXPECT_EQ(fixedId, m.add(&entry));
+        EXPECT_EQ(fixedId, m.get(fixedId).size);
+
+        // The next allocated id follows the fixed one.
+        entry.register_fixed = 0;
+        EXPECT_EQ(fixedId + 1, m.add(&entry));
+
+        m.remove(fixedId);
+        EXPECT_EQ(HostmemIdMapping::kInvalidHostmemId, m.get(fixedId).id);
+        EXPECT_EQ(fixedId + 1, m.get(fixedId + 1).id);
+    }
+    m.clear();
+    EXPECT_EQ(HostmemIdMapping::kInvalidHostmemId,
+              m.get((uint64_t(1) << 40) + 1).id);
+}
+
+// Tests that lookups racing with adds and removes only see whole entries.
+TEST(HostmemIdMapping, ConcurrentGet) {
+    HostmemIdMapping m;
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> maxId{0};
+    std::thread reader([&] {
+        while (!done.load()) {
+            const uint64_t top = maxId.load();
+            for (uint64_t id = 1; id <= top; ++id) {
+                auto entry = m.get(id);
+                if (entry.id != HostmemIdMapping::kInvalidHostmemId) {
+                    EXPECT_EQ(id, entry.id);
+                    EXPECT_EQ(id * 2, entry.size);
+                }
+            }
+        }
+    });
+    for (uint64_t i = 1; i <= 20000; ++i) {
+        MemEntry entry{
+            .hva = (void *)(uintptr_t) 1,
+            .size = i * 2,
+            .register_fixed = 0,
+            .fixed_id = 0,
+            .caching = MAP_CACHE_NONE,
+        };
+        const uint64_t id = m.add(&entry);
+        ASSERT_EQ(i, id);
+        maxId.store(id);
+        if (i % 3 == 0) {
+            m.remove(id - 1);
+        }
+    }
+    done.store(true);
+    reader.join();
+}
@@ -0,0 +1,152 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/InstrumentedVmLock.h"
+
+#include "aemu/base/system/System.h"
+
+#include <algorithm>
+
+namespace android {
+
+namespace {
+
+constexpr char kUnknownSite[] = "unknown";
+
+struct ThreadState {
+    const char* site = nullptr;
+    // The lock this thread holds through an InstrumentedVmLock, and how
+    // many times.
+    const InstrumentedVmLock* owner = nullptr;
+    int depth = 0;
+    const char* lockedSite = nullptr;
+    uint64_t waitUs = 0;
+    uint64_t acquiredUs = 0;
+};
+
+thread_local ThreadState tState;
+
+InstrumentedVmLock* sInstalled = nullptr;
+
+}  // namespace
+
+InstrumentedVmLock::InstrumentedVmLock(VmLock* inner) : mInner(inner) {}
+
+InstrumentedVmLock::~InstrumentedVmLock() {
+    if (sInstalled == this) {
+        sInstalled = nullptr;
+    }
+}
+
+// static
+InstrumentedVmLock* InstrumentedVmLock::install() {
+    VmLock* current = VmLock::get();
+    if (sInstalled && current == sInstalled) {
+        return sInstalled;
+    }
+    sInstalled = new InstrumentedVmLock(current);
+    VmLock::set(sInstalled);
+    return sInstalled;
+}
+
+void InstrumentedVmLock::lock() {
+    const char* site = ScopedVmLockSite::current();
+    const uint64_t startUs = base::getHighResTimeUs();
+    mInner->lock();
+    ThreadState& state = tState;
+    if (state.depth++ == 0) {
+        state.owner = this;
+        state.lockedSite = site ? site : kUnknownSite;
+        state.acquiredUs = base::getHighResTimeUs();
+        state.waitUs = state.acquiredUs - startUs;
+    }
+}
+
+void InstrumentedVmLock::unlock() {
+    ThreadState& state = tState;
+    if (state.depth == 0 || state.owner != this) {
+        // Locked behind our back; nothing to attribute.
+        mInner->unlock();
+        return;
+    }
+    if (--state.depth > 0) {
+        mInner->unlock();
+        return;
+    }
+    const uint64_t holdUs = base::getHighResTimeUs() - state.acquiredUs;
+    state.owner = nullptr;
+    mInner->unlock();
+    record(state.lockedSite, state.waitUs, holdUs);
+}
+
+bool InstrumentedVmLock::isLockedBySelf() const {
+    const ThreadState& state = tState;
+    if (state.depth > 0 && state.owner == this) {
+        return true;
+    }
+    return mInner->isLockedBySelf();
+}
+
+void InstrumentedVmLock::record(const char* site,
+                                uint64_t waitUs,
+                                uint64_t holdUs) {
+    base::AutoLock lock(mStatsLock);
+    SiteStats& stats = mStats[site];
+    if (!stats.count) {
+        stats.site = site;
+    }
+    ++stats.count;
+    stats.totalWaitUs += waitUs;
+    stats.maxWaitUs = std::max(stats.maxWaitUs, waitUs);
+    stats.totalHoldUs += holdUs;
+    stats.maxHoldUs = std::max(stats.maxHoldUs, holdUs);
+}
+
+std::vector<InstrumentedVmLock::SiteStats> InstrumentedVmLock::stats() const {
+    std::vector<SiteStats> result;
+    {
+        base::AutoLock lock(mStatsLock);
+        result.reserve(mStats.size());
+        for (const auto& it : mStats) {
+            result.push_back(it.second);
+        }
+    }
+    std::sort(result.begin(), result.end(),
+              [](const SiteStats& a, const SiteStats& b) {
+                  return a.totalHoldUs > b.totalHoldUs;
+              });
+    return result;
+}
+
+void InstrumentedVmLock::resetStats() {
+    base::AutoLock lock(mStatsLock);
+    mStats.clear();
+}
+
+ScopedVmLockSite::ScopedVmLockSite(const char* site)
+    : mPrevious(tState.site) {
+    tState.site = site;
+}
+
+ScopedVmLockSite::~ScopedVmLockSite() {
+    tState.site = mPrevious;
+}
+
+// static
+const char* ScopedVmLockSite::current() {
+    return tState.site;
+}
+
+}  // namespace android
@@ -0,0 +1,95 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/InstrumentedVmLock.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+namespace android {
+namespace {
+
+class FakeVmLock : public VmLock {
+public:
+    void lock() override { ++lockCount; }
+    void unlock() override { ++unlockCount; }
+    bool isLockedBySelf() const override { return lockedOutside; }
+
+    int lockCount = 0;
+    int unlockCount = 0;
+    bool lockedOutside = false;
+};
+
+// Tests that holds are forwarded and attributed to the innermost site.
+TEST(InstrumentedVmLock, PerSiteStats) {
+    FakeVmLock inner;
+    InstrumentedVmLock lock(&inner);
+    EXPECT_FALSE(lock.isLockedBySelf());
+
+    {
+        ScopedVmLockSite site("device");
+        for (int i = 0; i < 3; ++i) {
+            ScopedVmLock scoped(&lock);
+            EXPECT_TRUE(lock.isLockedBySelf());
+        }
+        {
+            ScopedVmLockSite nested("slow");
+            ScopedVmLock scoped(&lock);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        EXPECT_STREQ("device", ScopedVmLockSite::current());
+    }
+    EXPECT_EQ(nullptr, ScopedVmLockSite::current());
+    lock.lock();
+    lock.unlock();
+
+    EXPECT_EQ(5, inner.lockCount);
+    EXPECT_EQ(5, inner.unlockCount);
+    EXPECT_FALSE(lock.isLockedBySelf());
+    inner.lockedOutside = true;
+    EXPECT_TRUE(lock.isLockedBySelf());
+
+    auto stats = lock.stats();
+    ASSERT_EQ(3u, stats.size());
+    EXPECT_EQ("slow", stats[0].site);
+    EXPECT_GE(stats[0].maxHoldUs, 4000u);
+    uint64_t total = 0;
+    for (const auto& s : stats) {
+        total += s.count;
+        if (s.site == "device") {
+            EXPECT_EQ(3u, s.count);
+        }
+    }
+    EXPECT_EQ(5u, total);
+
+    lock.resetStats();
+    EXPECT_TRUE(lock.stats().empty());
+}
+
+TEST(InstrumentedVmLock, Install) {
+    VmLock* original = VmLock::get();
+    InstrumentedVmLock* installed = InstrumentedVmLock::install();
+    EXPECT_EQ(installed, VmLock::get());
+    EXPECT_EQ(original, installed->inner());
+    EXPECT_EQ(installed, InstrumentedVmLock::install());
+
+    VmLock::set(original);
+    delete installed;
+}
+
+}  // namespace
+}  // namespace android
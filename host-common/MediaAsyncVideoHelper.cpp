@@ -0,0 +1,164 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/MediaAsyncVideoHelper.h"
+
+#include <chrono>
+
+#define MEDIA_ASYNC_DEBUG 0
+
+#if MEDIA_ASYNC_DEBUG
+#define MEDIA_DPRINT(fmt, ...)                                                 \
+    fprintf(stderr, "media-async-helper: %s:%d " fmt "\n", __func__, __LINE__, \
+            ##__VA_ARGS__);
+#else
+#define MEDIA_DPRINT(fmt, ...)
+#endif
+
+namespace android {
+namespace emulation {
+
+using base::AutoLock;
+using base::WorkerProcessingResult;
+using FrameInfo = MediaSnapshotState::FrameInfo;
+
+MediaAsyncVideoHelper::MediaAsyncVideoHelper(
+        std::unique_ptr<MediaVideoHelper> helper)
+    : mHelper(std::move(helper)),
+      mWorker([this](Work&& work) { return process(std::move(work)); }) {}
+
+MediaAsyncVideoHelper::~MediaAsyncVideoHelper() {
+    stopWorker();
+}
+
+bool MediaAsyncVideoHelper::init() {
+    if (!mHelper->init()) {
+        return false;
+    }
+    mGood.store(mHelper->good(), std::memory_order_release);
+    mRunning = mWorker.start();
+    return mRunning;
+}
+
+void MediaAsyncVideoHelper::decode(const uint8_t* frame,
+                                   size_t szBytes,
+                                   uint64_t inputPts) {
+    // The packet lives in guest memory that is reused once we return.
+    Work work;
+    work.op = Work::Op::Decode;
+    work.packet.assign(frame, frame + szBytes);
+    work.pts = inputPts;
+    work.ignoreOutput = mIgnoreDecoderOutput;
+
+    while (!mInFlight.empty() &&
+           (mInFlight.size() >= kMaxPacketsInFlight ||
+            mInFlight.front().wait_for(std::chrono::seconds(0)) ==
+                    std::future_status::ready)) {
+        mInFlight.front().wait();
+        mInFlight.pop_front();
+    }
+    mInFlight.push_back(mWorker.enqueue(std::move(work)));
+    MEDIA_DPRINT("queued %zu bytes, %zu in flight", szBytes, mInFlight.size());
+}
+
+void MediaAsyncVideoHelper::flush() {
+    Work work;
+    work.op = Work::Op::Flush;
+    work.ignoreOutput = mIgnoreDecoderOutput;
+    mWorker.enqueue(std::move(work));
+    drain();
+}
+
+void MediaAsyncVideoHelper::drain() {
+    mWorker.waitQueuedItems();
+    mInFlight.clear();
+}
+
+bool MediaAsyncVideoHelper::resetForReuse() {
+    if (!mRunning) {
+        return false;
+    }
+    drain();
+    {
+        AutoLock lock(mFramesLock);
+        mSavedDecodedFrames.clear();
+    }
+    mIgnoreDecoderOutput = false;
+    // The worker is idle until the next decode(), so this can't race it.
+    if (!mHelper->resetForReuse()) {
+        return false;
+    }
+    mError.store(mHelper->error(), std::memory_order_release);
+    mFatal.store(mHelper->fatal(), std::memory_order_release);
+    mGood.store(mHelper->good(), std::memory_order_release);
+    return true;
+}
+
+void MediaAsyncVideoHelper::deInit() {
+    stopWorker();
+    mHelper->deInit();
+}
+
+bool MediaAsyncVideoHelper::receiveFrame(FrameInfo* pFrameInfo) {
+    AutoLock lock(mFramesLock);
+    if (mSavedDecodedFrames.empty()) {
+        return false;
+    }
+    std::swap(*pFrameInfo, mSavedDecodedFrames.front());
+    mSavedDecodedFrames.pop_front();
+    return true;
+}
+
+WorkerProcessingResult MediaAsyncVideoHelper::process(Work&& work) {
+    if (work.op == Work::Op::Stop) {
+        return WorkerProcessingResult::Stop;
+    }
+
+    if (work.ignoreOutput) {
+        mHelper->setIgnoreDecodedFrames();
+    } else {
+        mHelper->setSaveDecodedFrames();
+    }
+    if (work.op == Work::Op::Flush) {
+        mHelper->flush();
+    } else {
+        mHelper->decode(work.packet.data(), work.packet.size(), work.pts);
+    }
+
+    FrameInfo frame;
+    while (mHelper->receiveFrame(&frame)) {
+        AutoLock lock(mFramesLock);
+        mSavedDecodedFrames.push_back(std::move(frame));
+    }
+
+    mError.store(mHelper->error(), std::memory_order_release);
+    mFatal.store(mHelper->fatal(), std::memory_order_release);
+    mGood.store(mHelper->good(), std::memory_order_release);
+    return WorkerProcessingResult::Continue;
+}
+
+void MediaAsyncVideoHelper::stopWorker() {
+    if (!mRunning) {
+        return;
+    }
+    Work work;
+    work.op = Work::Op::Stop;
+    mWorker.enqueue(std::move(work));
+    mWorker.join();
+    mInFlight.clear();
+    mRunning = false;
+}
+
+}  // namespace emulation
+}  // namespace android
@@ -13,7 +13,19 @@
 // limitations under the License.
 
 #include "host-common/MediaCudaDriverHelper.h"
+
+#include "aemu/base/files/PathUtils.h"
+#include "aemu/base/files/ScopedStdioFile.h"
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/system/System.h"
+#include "aemu/base/threads/Async.h"
+#include "host-common/MediaDecoderCapabilityCache.h"
+#include "host-common/StartupGraph.h"
+
+#include <algorithm>
 #include <cstdint>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "android/main-emugl.h"
@@ -22,6 +34,8 @@
 #define WIN32_LEAN_AND_MEAN 1
 #include <windows.h>
 #include <winioctl.h>
+#else
+#include <dirent.h>
 #endif
 
 #include <stdio.h>
@@ -57,10 +71,22 @@ namespace emulation {
 
 bool MediaCudaDriverHelper::s_isCudaInitialized = false;
 
-bool MediaCudaDriverHelper::initCudaDrivers() {
-    if (s_isCudaInitialized) {
-        return true;
-    }
+namespace {
+
+struct CudaProbe {
+    std::once_flag started;
+    base::Lock lock;
+    base::ConditionVariable cv;
+    bool done = false;
+    bool result = false;
+};
+
+CudaProbe& sProbe() {
+    static CudaProbe* const p = new CudaProbe();
+    return *p;
+}
+
+bool probeCudaDrivers() {
 #if defined(WIN32) || defined(_WIN32) || defined(WIN64) || defined(_WIN64)
     typedef HMODULE CUDADRIVER;
 #else
@@ -107,10 +133,92 @@ bool MediaCudaDriverHelper::initCudaDrivers() {
     }
 
     // lukily, we get cuda initialized.
-    s_isCudaInitialized = true;
-
     return true;
 }
 
+constexpr char kCuvidCapability[] = "cuvid";
+
+void runProbe() {
+    // A host known not to have a working driver skips loading it; a good
+    // one still needs the driver loaded, so it probes as before.
+    const std::string fingerprint = MediaCudaDriverHelper::driverFingerprint();
+    MediaDecoderCapabilityCache& cache = MediaDecoderCapabilityCache::get();
+    const bool result = cache.lookup(kCuvidCapability, fingerprint).value_or(true) &&
+                        probeCudaDrivers();
+    cache.store(kCuvidCapability, fingerprint, result);
+    CudaProbe& probe = sProbe();
+    base::AutoLock lock(probe.lock);
+    MediaCudaDriverHelper::s_isCudaInitialized = result;
+    probe.result = result;
+    probe.done = true;
+    probe.cv.broadcastAndUnlock(&lock);
+}
+
+}  // namespace
+
+bool MediaCudaDriverHelper::initCudaDrivers() {
+    CudaProbe& probe = sProbe();
+    std::call_once(probe.started, runProbe);
+    base::AutoLock lock(probe.lock);
+    probe.cv.wait(&lock, [&probe] { return probe.done; });
+    return probe.result;
+}
+
+void MediaCudaDriverHelper::startInitCudaDrivers() {
+    std::call_once(sProbe().started, [] {
+        if (!base::async([] { runProbe(); })) {
+            runProbe();
+        }
+    });
+}
+
+std::string MediaCudaDriverHelper::driverFingerprint() {
+    std::string fingerprint = "api=" + std::to_string(__CUDA_API_VERSION);
+#ifdef _WIN32
+    const std::string dll = base::pj(base::getEnvironmentVariable("SystemRoot"),
+                                     "System32", "nvcuda.dll");
+    int major = 0, minor = 0, build1 = 0, build2 = 0;
+    if (base::queryFileVersionInfo(dll.c_str(), &major, &minor, &build1, &build2)) {
+        fingerprint += " nvcuda=" + std::to_string(major) + "." +
+                       std::to_string(minor) + "." + std::to_string(build1) +
+                       "." + std::to_string(build2);
+    } else {
+        fingerprint += " no-driver";
+    }
+#else
+    // Only there while the NVIDIA kernel module is loaded, and names its
+    // version.
+    base::ScopedStdioFile version(fopen("/proc/driver/nvidia/version", "rb"));
+    char line[256];
+    if (version && fgets(line, sizeof(line), version.get())) {
+        line[strcspn(line, "\r\n")] = '\0';
+        std::replace(line, line + strlen(line), '\t', ' ');
+        fingerprint += " ";
+        fingerprint += line;
+    } else {
+        fingerprint += " no-driver";
+    }
+    // GPUs by PCI address, so swapping cards reprobes.
+    if (DIR* dir = opendir("/proc/driver/nvidia/gpus")) {
+        std::vector<std::string> gpus;
+        while (const dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] != '.') {
+                gpus.push_back(entry->d_name);
+            }
+        }
+        closedir(dir);
+        std::sort(gpus.begin(), gpus.end());
+        for (const std::string& gpu : gpus) {
+            fingerprint += " gpu=" + gpu;
+        }
+    }
+#endif
+    return fingerprint;
+}
+
+void MediaCudaDriverHelper::addStartupStage(StartupGraph* graph) {
+    graph->add({"media-cuda-probe", [] { startInitCudaDrivers(); }});
+}
+
 }  // namespace emulation
 }  // namespace android
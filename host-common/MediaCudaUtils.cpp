@@ -53,53 +53,132 @@ extern "C" {
         }                                                             \
     } while (0)
 
+static constexpr unsigned int kGlTexture2D = 0x0DE1;
+
+namespace android {
+namespace emulation {
+
+CUgraphicsResource MediaCudaTextureRegistry::get(uint32_t texture) {
+    std::lock_guard<std::mutex> g(mLock);
+    auto it = mResources.find(texture);
+    if (it != mResources.end()) {
+        return it->second;
+    }
+    CUgraphicsResource res{0};
+    CUresult errorCode =
+            cuGraphicsGLRegisterImage(&res, texture, kGlTexture2D, 0x0);
+    if (errorCode != CUDA_SUCCESS) {
+        CUVID_DPRINT("failed to register texture %d; error code %d",
+                     (int)texture, (int)errorCode);
+        return nullptr;
+    }
+    mResources[texture] = res;
+    return res;
+}
+
+void MediaCudaTextureRegistry::forget(const uint32_t* textures,
+                                      size_t count) {
+    std::lock_guard<std::mutex> g(mLock);
+    if (mResources.empty()) {
+        return;
+    }
+    NVDEC_API_CALL(cuCtxPushCurrent(mContext));
+    for (size_t i = 0; i < count; ++i) {
+        auto it = mResources.find(textures[i]);
+        if (it != mResources.end()) {
+            NVDEC_API_CALL(cuGraphicsUnregisterResource(it->second));
+            mResources.erase(it);
+        }
+    }
+    NVDEC_API_CALL(cuCtxPopCurrent(NULL));
+}
+
+void MediaCudaTextureRegistry::clear() {
+    std::lock_guard<std::mutex> g(mLock);
+    if (mResources.empty()) {
+        return;
+    }
+    NVDEC_API_CALL(cuCtxPushCurrent(mContext));
+    for (auto& it : mResources) {
+        NVDEC_API_CALL(cuGraphicsUnregisterResource(it.second));
+    }
+    mResources.clear();
+    NVDEC_API_CALL(cuCtxPopCurrent(NULL));
+}
+
+}  // namespace emulation
+}  // namespace android
+
+using android::emulation::MediaCudaTextureRegistry;
+
 extern "C" {
 
 #define MEDIA_CUDA_COPY_Y_TEXTURE 1
 #define MEDIA_CUDA_COPY_UV_TEXTURE 2
 
-static void media_cuda_copy_decoded_frame(void* privData,
+// Returns false if the plane could not be copied into the texture.
+static bool media_cuda_copy_decoded_frame(void* privData,
                                           int mode,
                                           uint32_t dest_texture_handle) {
     media_cuda_utils_copy_context* copy_context =
             static_cast<media_cuda_utils_copy_context*>(privData);
+    MediaCudaTextureRegistry* registry =
+            static_cast<MediaCudaTextureRegistry*>(
+                    copy_context->texture_registry);
 
-    const unsigned int GL_TEXTURE_2D = 0x0DE1;
-    const unsigned int cudaGraphicsMapFlagsNone = 0x0;
-    CUgraphicsResource CudaRes{0};
     CUVID_DPRINT("cuda copy decoded frame testure %d",
                  (int)dest_texture_handle);
-    NVDEC_API_CALL(cuGraphicsGLRegisterImage(&CudaRes, dest_texture_handle,
-                                             GL_TEXTURE_2D, 0x0));
-    CUarray texture_ptr;
-    NVDEC_API_CALL(cuGraphicsMapResources(1, &CudaRes, 0));
-    NVDEC_API_CALL(
-            cuGraphicsSubResourceGetMappedArray(&texture_ptr, CudaRes, 0, 0));
-    CUdeviceptr dpSrcFrame = copy_context->src_frame;
-    CUDA_MEMCPY2D m = {0};
-    m.srcMemoryType = CU_MEMORYTYPE_DEVICE;
-    m.srcDevice = dpSrcFrame;
-    m.srcPitch = copy_context->src_pitch;
-    m.dstMemoryType = CU_MEMORYTYPE_ARRAY;
-    m.dstArray = texture_ptr;
-    m.dstPitch = copy_context->dest_width * 1;
-    m.WidthInBytes = copy_context->dest_width * 1;
-    m.Height = copy_context->dest_height;
-    CUVID_DPRINT("dstPitch %d, WidthInBytes %d Height %d surface-height %d",
-                 (int)m.dstPitch, (int)m.WidthInBytes, (int)m.Height,
-                 (int)copy_context->src_surface_height);
-
-    if (mode == MEDIA_CUDA_COPY_Y_TEXTURE) {  // copy Y data
-        NVDEC_API_CALL(cuMemcpy2D(&m));
-    } else if (mode == MEDIA_CUDA_COPY_UV_TEXTURE) {  // copy UV data
-        m.srcDevice =
-                (CUdeviceptr)((uint8_t*)dpSrcFrame +
-                              m.srcPitch * copy_context->src_surface_height);
-        m.Height = m.Height / 2;
-        NVDEC_API_CALL(cuMemcpy2D(&m));
+    CUgraphicsResource CudaRes{0};
+    if (registry) {
+        CudaRes = registry->get(dest_texture_handle);
+        if (!CudaRes) {
+            return false;
+        }
+    } else if (cuGraphicsGLRegisterImage(&CudaRes, dest_texture_handle,
+                                         kGlTexture2D, 0x0) != CUDA_SUCCESS) {
+        return false;
     }
-    NVDEC_API_CALL(cuGraphicsUnmapResources(1, &CudaRes, 0));
-    NVDEC_API_CALL(cuGraphicsUnregisterResource(CudaRes));
+
+    bool ok = false;
+    if (cuGraphicsMapResources(1, &CudaRes, 0) == CUDA_SUCCESS) {
+        CUarray texture_ptr;
+        CUresult errorCode = cuGraphicsSubResourceGetMappedArray(
+                &texture_ptr, CudaRes, 0, 0);
+        if (errorCode == CUDA_SUCCESS) {
+            CUdeviceptr dpSrcFrame = copy_context->src_frame;
+            CUDA_MEMCPY2D m = {0};
+            m.srcMemoryType = CU_MEMORYTYPE_DEVICE;
+            m.srcDevice = dpSrcFrame;
+            m.srcPitch = copy_context->src_pitch;
+            m.dstMemoryType = CU_MEMORYTYPE_ARRAY;
+            m.dstArray = texture_ptr;
+            m.dstPitch = copy_context->dest_width * 1;
+            m.WidthInBytes = copy_context->dest_width * 1;
+            m.Height = copy_context->dest_height;
+            CUVID_DPRINT(
+                    "dstPitch %d, WidthInBytes %d Height %d surface-height %d",
+                    (int)m.dstPitch, (int)m.WidthInBytes, (int)m.Height,
+                    (int)copy_context->src_surface_height);
+
+            if (mode == MEDIA_CUDA_COPY_UV_TEXTURE) {
+                m.srcDevice = (CUdeviceptr)(
+                        (uint8_t*)dpSrcFrame +
+                        m.srcPitch * copy_context->src_surface_height);
+                m.Height = m.Height / 2;
+            }
+            errorCode = cuMemcpy2D(&m);
+            ok = errorCode == CUDA_SUCCESS;
+        }
+        if (!ok) {
+            CUVID_DPRINT("failed to copy into texture %d; error code %d",
+                         (int)dest_texture_handle, (int)errorCode);
+        }
+        NVDEC_API_CALL(cuGraphicsUnmapResources(1, &CudaRes, 0));
+    }
+    if (!registry) {
+        NVDEC_API_CALL(cuGraphicsUnregisterResource(CudaRes));
+    }
+    return ok;
 }
 
 void media_cuda_utils_nv12_updater(void* privData,
@@ -110,12 +189,15 @@ void media_cuda_utils_nv12_updater(void* privData,
     if (type != kFRAMEWORK_FORMAT_NV12) {
         return;
     }
+    media_cuda_utils_copy_context* copy_context =
+            static_cast<media_cuda_utils_copy_context*>(privData);
     CUVID_DPRINT("copyiong Ytex %d", textures[0]);
     CUVID_DPRINT("copyiong UVtex %d", textures[1]);
-    media_cuda_copy_decoded_frame(privData, MEDIA_CUDA_COPY_Y_TEXTURE,
-                                  textures[0]);
-    media_cuda_copy_decoded_frame(privData, MEDIA_CUDA_COPY_UV_TEXTURE,
-                                  textures[1]);
+    copy_context->copied =
+            media_cuda_copy_decoded_frame(privData, MEDIA_CUDA_COPY_Y_TEXTURE,
+                                          textures[0]) &&
+            media_cuda_copy_decoded_frame(privData, MEDIA_CUDA_COPY_UV_TEXTURE,
+                                          textures[1]);
 }
 
 }  // end extern C
@@ -62,12 +62,33 @@ MediaCudaVideoHelper::MediaCudaVideoHelper(OutputTreatmentMode oMode,
 
 MediaCudaVideoHelper::~MediaCudaVideoHelper() {
     deInit();
+    resetTexturePool();
+}
+
+void MediaCudaVideoHelper::resetTexturePool(MediaTexturePool* pool) {
+    if (mTexturePool) {
+        mTexturePool->setReleaseHook(nullptr);
+    }
+    if (mTextureRegistry) {
+        mTextureRegistry->clear();
+    }
+    mTexturePool = pool;
+    if (mTexturePool) {
+        mTexturePool->setReleaseHook(
+                [this](const uint32_t* textures, size_t count) {
+                    if (mTextureRegistry) {
+                        mTextureRegistry->forget(textures, count);
+                    }
+                });
+    }
 }
 
 void MediaCudaVideoHelper::deInit() {
     CUDA_DPRINT("deInit calling");
 
     mSavedDecodedFrames.clear();
+    // Registrations belong to the context, so they go before it does.
+    mTextureRegistry.reset();
     if (mCudaContext != nullptr) {
         NVDEC_API_CALL(cuCtxPushCurrent(mCudaContext));
         if (mCudaParser != nullptr) {
@@ -145,6 +166,9 @@ bool MediaCudaVideoHelper::init() {
     }
 
     NVDEC_API_CALL(cuvidCtxLockCreate(&mCtxLock, mCudaContext));
+    if (mUseGpuTexture) {
+        mTextureRegistry.reset(new MediaCudaTextureRegistry(mCudaContext));
+    }
 
     CUVIDPARSERPARAMS videoParserParameters = {};
     // videoParserParameters.CodecType = (mType == MediaCodecType::VP8Codec) ?
@@ -165,8 +189,11 @@ bool MediaCudaVideoHelper::init() {
            "mode %s",
            mCudaVideoCodecType == cudaVideoCodec_H264
                    ? "H264"
-                   : (mCudaVideoCodecType == cudaVideoCodec_VP8 ? "VP8"
-                                                                : "VP9"),
+                   : (mCudaVideoCodecType == cudaVideoCodec_HEVC
+                              ? "HEVC"
+                              : (mCudaVideoCodecType == cudaVideoCodec_VP8
+                                         ? "VP8"
+                                         : "VP9")),
            mUseGpuTexture ? "on" : "off");
 
     return true;
@@ -244,7 +271,8 @@ int MediaCudaVideoHelper::HandleVideoSequence(CUVIDEOFORMAT* pVideoFormat) {
     mChromaHeight = mLumaHeight * 0.5;  // NV12
     mBPP = pVideoFormat->bit_depth_luma_minus8 > 0 ? 2 : 1;
 
-    if (mCudaVideoCodecType == cudaVideoCodec_H264) {
+    if (mCudaVideoCodecType == cudaVideoCodec_H264 ||
+        mCudaVideoCodecType == cudaVideoCodec_HEVC) {
         if (pVideoFormat->video_signal_description.video_full_range_flag)
             mColorRange = 2;
         else
@@ -355,8 +383,8 @@ int MediaCudaVideoHelper::HandlePictureDisplay(CUVIDPARSERDISPINFO* pDispInfo) {
 
     NVDEC_API_CALL(cuCtxPushCurrent(mCudaContext));
     unsigned int newOutBufferSize = mOutputWidth * mOutputHeight * 3 / 2;
-    std::vector<uint8_t> myFrame;
-    TextureFrame texFrame;
+    MediaFrameBuffer myFrame;
+    TextureFrame texFrame{0, 0};
     if (mUseGpuTexture && mTexturePool != nullptr) {
         media_cuda_utils_copy_context my_copy_context{
                 .src_frame = dpSrcFrame,
@@ -364,14 +392,28 @@ int MediaCudaVideoHelper::HandlePictureDisplay(CUVIDPARSERDISPINFO* pDispInfo) {
                 .src_surface_height = mSurfaceHeight,
                 .dest_width = mOutputWidth,
                 .dest_height = mOutputHeight,
+                .texture_registry = mTextureRegistry.get(),
+                .copied = 0,
         };
         texFrame = mTexturePool->getTextureFrame(mOutputWidth, mOutputHeight);
         mTexturePool->saveDecodedFrameToTexture(
                 texFrame, &my_copy_context,
                 (void*)media_cuda_utils_nv12_updater);
-    } else {
+        if (!my_copy_context.copied) {
+            // GL interop does not work here (no shared GL context, or a
+            // driver that refuses the textures); copy through host memory
+            // from now on.
+            dprint("WARNING: cannot copy decoded frames into textures, "
+                   "falling back to host memory");
+            mTexturePool->putTextureFrame(texFrame);
+            texFrame = TextureFrame{0, 0};
+            mUseGpuTexture = false;
+            mTextureRegistry.reset();
+        }
+    }
+    if (!mUseGpuTexture || mTexturePool == nullptr) {
         myFrame.resize(newOutBufferSize);
-        uint8_t* pDecodedFrame = &(myFrame[0]);
+        uint8_t* pDecodedFrame = myFrame.data();
 
         CUDA_MEMCPY2D m = {0};
         m.srcMemoryType = CU_MEMORYTYPE_DEVICE;
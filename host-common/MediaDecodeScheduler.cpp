@@ -0,0 +1,214 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/MediaDecodeScheduler.h"
+
+#include "host-common/address_space_host_stats.h"
+
+#include "aemu/base/LatencyHistogram.h"
+#include "aemu/base/StatsPage.h"
+#include "aemu/base/ThreadRoles.h"
+#include "aemu/base/system/System.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace android {
+namespace emulation {
+
+using base::AutoLock;
+
+namespace {
+
+size_t priorityIndex(MediaDecodeScheduler::Priority priority) {
+    return static_cast<size_t>(priority);
+}
+
+}  // namespace
+
+MediaDecodeScheduler::MediaDecodeScheduler(Options options) {
+    const size_t threadCount = std::max<size_t>(1, options.threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        mThreads.emplace_back(
+                new base::FunctorThread([this]() { workerLoop(); }));
+        mThreads.back()->start();
+    }
+}
+
+MediaDecodeScheduler::~MediaDecodeScheduler() {
+    {
+        AutoLock lock(mLock);
+        mStopping = true;
+        mWorkAvailable.broadcastAndUnlock(&lock);
+    }
+    for (auto& thread : mThreads) {
+        thread->wait();
+    }
+}
+
+// static
+MediaDecodeScheduler& MediaDecodeScheduler::get() {
+    // Leaked: media contexts may outlive static destruction.
+    static MediaDecodeScheduler* const sInstance = [] {
+        Options options;
+        options.threadCount = std::min<size_t>(
+                8, std::max<size_t>(2, std::thread::hardware_concurrency()));
+        return new MediaDecodeScheduler(options);
+    }();
+    return *sInstance;
+}
+
+MediaDecodeScheduler::StreamId MediaDecodeScheduler::addStream(
+        Priority priority) {
+    AutoLock lock(mLock);
+    const StreamId id = mNextId++;
+    mStreams[id].priority = priority;
+    return id;
+}
+
+void MediaDecodeScheduler::removeStream(StreamId id) {
+    AutoLock lock(mLock);
+    auto iter = mStreams.find(id);
+    if (iter == mStreams.end()) {
+        return;
+    }
+    // References to unordered_map elements survive other insertions.
+    Stream& stream = iter->second;
+    mStreamIdle.wait(&lock, [&stream]() {
+        return !stream.running && stream.commands.empty();
+    });
+    mStreams.erase(id);
+}
+
+void MediaDecodeScheduler::setPriority(StreamId id, Priority priority) {
+    AutoLock lock(mLock);
+    auto iter = mStreams.find(id);
+    if (iter == mStreams.end() || iter->second.priority == priority) {
+        return;
+    }
+    Stream& stream = iter->second;
+    if (stream.ready) {
+        auto& from = mReady[priorityIndex(stream.priority)];
+        from.erase(std::find(from.begin(), from.end(), id));
+        mReady[priorityIndex(priority)].push_back(id);
+    }
+    stream.priority = priority;
+}
+
+std::future<void> MediaDecodeScheduler::post(StreamId id, Task task) {
+    Command command;
+    command.task = std::move(task);
+    std::future<void> done = command.done.get_future();
+
+    AutoLock lock(mLock);
+    auto iter = mStreams.find(id);
+    if (iter == mStreams.end()) {
+        command.done.set_value();
+        return done;
+    }
+    Stream& stream = iter->second;
+    stream.commands.push_back(std::move(command));
+    ++stream.stats.queueDepth;
+    AddressSpaceHostStatsContext::set(HostStat::kMediaDecodeQueueDepth, ++mQueued);
+    stream.stats.maxQueueDepth =
+            std::max(stream.stats.maxQueueDepth, stream.stats.queueDepth);
+    if (!stream.running && !stream.ready) {
+        makeReadyLocked(id, stream);
+        mWorkAvailable.signalAndUnlock(&lock);
+    }
+    return done;
+}
+
+void MediaDecodeScheduler::run(StreamId id, Task task) {
+    post(id, std::move(task)).wait();
+}
+
+std::optional<MediaDecodeScheduler::StreamStats> MediaDecodeScheduler::getStats(
+        StreamId id) const {
+    AutoLock lock(mLock);
+    auto iter = mStreams.find(id);
+    if (iter == mStreams.end()) {
+        return std::nullopt;
+    }
+    return iter->second.stats;
+}
+
+void MediaDecodeScheduler::makeReadyLocked(StreamId id, Stream& stream) {
+    stream.ready = true;
+    mReady[priorityIndex(stream.priority)].push_back(id);
+}
+
+MediaDecodeScheduler::StreamId MediaDecodeScheduler::takeReadyLocked() {
+    auto& onScreen = mReady[priorityIndex(Priority::OnScreen)];
+    auto& background = mReady[priorityIndex(Priority::Background)];
+    const bool boostBackground =
+            !background.empty() && mOnScreenInARow >= kOnScreenBurst;
+    auto& from = (onScreen.empty() || boostBackground) ? background : onScreen;
+    mOnScreenInARow = (&from == &onScreen) ? mOnScreenInARow + 1 : 0;
+    const StreamId id = from.front();
+    from.pop_front();
+    return id;
+}
+
+void MediaDecodeScheduler::workerLoop() {
+    base::ScopedThreadRole role(base::ThreadRole::kMediaDecoder);
+    AutoLock lock(mLock);
+    for (;;) {
+        mWorkAvailable.wait(&lock, [this]() {
+            return mStopping || !mReady[0].empty() || !mReady[1].empty();
+        });
+        if (mReady[0].empty() && mReady[1].empty()) {
+            // Stopping, and everything posted has run.
+            return;
+        }
+
+        const StreamId id = takeReadyLocked();
+        Stream& stream = mStreams.find(id)->second;
+        stream.ready = false;
+        stream.running = true;
+        Command command = std::move(stream.commands.front());
+        stream.commands.pop_front();
+
+        lock.unlock();
+        const uint64_t startUs = base::getHighResTimeUs();
+        command.task();
+        const uint64_t elapsedUs = base::getHighResTimeUs() - startUs;
+        base::recordLatency(base::LatencyMetric::kMediaDecode, elapsedUs);
+        static const base::Stat sDecodes =
+                base::StatsPage::get().add("media.decodes", base::StatKind::kCounter);
+        sDecodes.add(1);
+        lock.lock();
+
+        // The stream can't have been removed: removeStream() waits for it.
+        stream.running = false;
+        --stream.stats.queueDepth;
+        AddressSpaceHostStatsContext::set(HostStat::kMediaDecodeQueueDepth, --mQueued);
+        ++stream.stats.tasksRun;
+        const size_t bucket =
+                std::upper_bound(kDecodeTimeBucketLimitsUs.begin(),
+                                 kDecodeTimeBucketLimitsUs.end(), elapsedUs) -
+                kDecodeTimeBucketLimitsUs.begin();
+        ++stream.stats.decodeTimeHistogram[bucket];
+        if (!stream.commands.empty()) {
+            makeReadyLocked(id, stream);
+            mWorkAvailable.signal();
+        } else {
+            mStreamIdle.broadcast();
+        }
+        command.done.set_value();
+    }
+}
+
+}  // namespace emulation
+}  // namespace android
@@ -0,0 +1,167 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/MediaDecodeScheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <vector>
+
+using android::emulation::MediaDecodeScheduler;
+using Priority = MediaDecodeScheduler::Priority;
+
+namespace {
+
+MediaDecodeScheduler::Options withThreads(size_t threadCount) {
+    MediaDecodeScheduler::Options options;
+    options.threadCount = threadCount;
+    return options;
+}
+
+}  // namespace
+
+// Tests that each stream runs its tasks one at a time, in order.
+TEST(MediaDecodeScheduler, OrdersTasksWithinStream) {
+    MediaDecodeScheduler scheduler(withThreads(4));
+    const auto a = scheduler.addStream();
+    const auto b = scheduler.addStream();
+
+    std::vector<int> seenA, seenB;
+    std::atomic<int> runningA{0};
+    std::vector<std::future<void>> done;
+    for (int i = 0; i < 100; ++i) {
+        done.push_back(scheduler.post(a, [&, i]() {
+            EXPECT_EQ(1, ++runningA);
+            seenA.push_back(i);
+            --runningA;
+        }));
+        done.push_back(scheduler.post(b, [&, i]() { seenB.push_back(i); }));
+    }
+    for (auto& f : done) {
+        f.wait();
+    }
+    ASSERT_EQ(100u, seenA.size());
+    ASSERT_EQ(100u, seenB.size());
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(i, seenA[i]);
+        EXPECT_EQ(i, seenB[i]);
+    }
+}
+
+// Tests that different streams run at the same time.
+TEST(MediaDecodeScheduler, RunsStreamsInParallel) {
+    MediaDecodeScheduler scheduler(withThreads(2));
+    const auto a = scheduler.addStream();
+    const auto b = scheduler.addStream();
+
+    // Each task waits for the other, so this only finishes if both run at
+    // once.
+    std::promise<void> aStarted, bStarted;
+    auto fa = scheduler.post(a, [&]() {
+        aStarted.set_value();
+        bStarted.get_future().wait();
+    });
+    auto fb = scheduler.post(b, [&]() {
+        bStarted.set_value();
+        aStarted.get_future().wait();
+    });
+    fa.wait();
+    fb.wait();
+}
+
+// Tests that on-screen streams go first, without starving the rest.
+TEST(MediaDecodeScheduler, PrefersOnScreenStreams) {
+    MediaDecodeScheduler scheduler(withThreads(1));
+    const auto gate = scheduler.addStream();
+
+    // Hold the only thread while the queues fill up.
+    std::promise<void> started, release;
+    std::shared_future<void> released = release.get_future().share();
+    scheduler.post(gate, [&started, released]() {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+
+    std::vector<char> order;
+    std::vector<std::future<void>> done;
+    for (int i = 0; i < 6; ++i) {
+        // A stream queues once however many tasks it has, so give each task
+        // its own stream.
+        const auto background = scheduler.addStream(Priority::Background);
+        const auto onScreen = scheduler.addStream(Priority::Background);
+        scheduler.setPriority(onScreen, Priority::OnScreen);
+        done.push_back(
+                scheduler.post(background, [&]() { order.push_back('b'); }));
+        done.push_back(
+                scheduler.post(onScreen, [&]() { order.push_back('o'); }));
+    }
+    release.set_value();
+    for (auto& f : done) {
+        f.wait();
+    }
+
+    const std::vector<char> expected = {'o', 'o', 'o', 'o', 'b', 'o',
+                                        'o', 'b', 'b', 'b', 'b', 'b'};
+    EXPECT_EQ(expected, order);
+}
+
+// Tests queue depth and decode time bookkeeping.
+TEST(MediaDecodeScheduler, RecordsStats) {
+    MediaDecodeScheduler scheduler(withThreads(1));
+    const auto id = scheduler.addStream();
+
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    auto first = scheduler.post(id, [released]() { released.wait(); });
+    scheduler.post(id, []() {});
+    auto last = scheduler.post(id, []() {});
+
+    auto stats = scheduler.getStats(id);
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(3u, stats->queueDepth);
+    EXPECT_EQ(3u, stats->maxQueueDepth);
+
+    release.set_value();
+    last.wait();
+    stats = scheduler.getStats(id);
+    EXPECT_EQ(0u, stats->queueDepth);
+    EXPECT_EQ(3u, stats->tasksRun);
+    uint64_t histogramTotal = 0;
+    for (uint64_t count : stats->decodeTimeHistogram) {
+        histogramTotal += count;
+    }
+    EXPECT_EQ(3u, histogramTotal);
+
+    scheduler.removeStream(id);
+    EXPECT_FALSE(scheduler.getStats(id).has_value());
+}
+
+// Tests that removeStream waits for queued work and later posts are dropped.
+TEST(MediaDecodeScheduler, RemoveStreamWaitsForTasks) {
+    MediaDecodeScheduler scheduler(withThreads(2));
+    const auto id = scheduler.addStream();
+
+    std::atomic<int> ran{0};
+    for (int i = 0; i < 10; ++i) {
+        scheduler.post(id, [&ran]() { ++ran; });
+    }
+    scheduler.removeStream(id);
+    EXPECT_EQ(10, ran.load());
+
+    scheduler.post(id, [&ran]() { ++ran; }).wait();
+    EXPECT_EQ(10, ran.load());
+}
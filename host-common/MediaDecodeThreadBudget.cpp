@@ -0,0 +1,150 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/MediaDecodeThreadBudget.h"
+
+#include "aemu/base/StatsPage.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace android {
+namespace emulation {
+
+using base::AutoLock;
+
+namespace {
+
+struct BudgetGauges {
+    const base::Stat threads = base::StatsPage::get().add(
+            "media.vpx_decode_threads", base::StatKind::kGauge);
+    const base::Stat streams = base::StatsPage::get().add(
+            "media.vpx_decode_streams", base::StatKind::kGauge);
+    const base::Stat rowMtStreams = base::StatsPage::get().add(
+            "media.vpx_row_mt_streams", base::StatKind::kGauge);
+};
+
+const BudgetGauges& budgetGauges() {
+    static const BudgetGauges* const sGauges = new BudgetGauges();
+    return *sGauges;
+}
+
+}  // namespace
+
+MediaDecodeThreadBudget::MediaDecodeThreadBudget(uint32_t budget)
+    : mBudget(std::max<uint32_t>(1, budget)) {}
+
+MediaDecodeThreadBudget& MediaDecodeThreadBudget::get() {
+    // Leaked: decoders may outlive static destruction.
+    static MediaDecodeThreadBudget* const sInstance =
+            new MediaDecodeThreadBudget(std::thread::hardware_concurrency());
+    return *sInstance;
+}
+
+// static
+MediaDecodeThreadBudget::Settings MediaDecodeThreadBudget::select(
+        int vpxVersion, uint32_t width, uint32_t height, uint32_t hostCores) {
+    // Portrait streams are sized by their long side.
+    const uint32_t longSide = std::max(width, height);
+    Settings settings;
+    if (vpxVersion == 8) {
+        settings.threads = longSide >= 1280 ? 2 : 1;
+    } else if (longSide >= 3840) {
+        settings.threads = 8;
+    } else if (longSide >= 2560) {
+        settings.threads = 6;
+    } else if (longSide >= 1920) {
+        settings.threads = 4;
+    } else if (longSide >= 1280) {
+        settings.threads = 3;
+    } else if (longSide >= 640) {
+        settings.threads = 2;
+    }
+    settings.threads = std::max<uint32_t>(1, std::min(settings.threads, hostCores));
+    settings.rowMt = vpxVersion != 8 && longSide >= 1920 && settings.threads > 1;
+    return settings;
+}
+
+MediaDecodeThreadBudget::Lease MediaDecodeThreadBudget::acquire(
+        int vpxVersion, uint32_t width, uint32_t height) {
+    Settings settings = select(vpxVersion, width, height, mBudget);
+
+    AutoLock lock(mLock);
+    const uint32_t left = mBudget > mInUse ? mBudget - mInUse : 0;
+    settings.threads = std::max<uint32_t>(1, std::min(settings.threads, left));
+    settings.rowMt &= settings.threads > 1;
+    mInUse += settings.threads;
+    ++mStreams;
+    mRowMtStreams += settings.rowMt;
+
+    const BudgetGauges& gauges = budgetGauges();
+    gauges.threads.set(mInUse);
+    gauges.streams.set(mStreams);
+    gauges.rowMtStreams.set(mRowMtStreams);
+    return Lease(this, settings, settings.threads);
+}
+
+uint32_t MediaDecodeThreadBudget::inUse() const {
+    AutoLock lock(mLock);
+    return mInUse;
+}
+
+void MediaDecodeThreadBudget::giveBack(uint32_t threads, bool rowMt) {
+    AutoLock lock(mLock);
+    mInUse -= threads;
+    --mStreams;
+    mRowMtStreams -= rowMt;
+
+    const BudgetGauges& gauges = budgetGauges();
+    gauges.threads.set(mInUse);
+    gauges.streams.set(mStreams);
+    gauges.rowMtStreams.set(mRowMtStreams);
+}
+
+MediaDecodeThreadBudget::Lease::Lease(MediaDecodeThreadBudget* owner,
+                                      Settings settings,
+                                      uint32_t taken)
+    : mOwner(owner), mSettings(settings), mTaken(taken) {}
+
+MediaDecodeThreadBudget::Lease::Lease(Lease&& other)
+    : mOwner(other.mOwner), mSettings(other.mSettings), mTaken(other.mTaken) {
+    other.mOwner = nullptr;
+}
+
+MediaDecodeThreadBudget::Lease& MediaDecodeThreadBudget::Lease::operator=(
+        Lease&& other) {
+    if (this != &other) {
+        release();
+        mOwner = other.mOwner;
+        mSettings = other.mSettings;
+        mTaken = other.mTaken;
+        other.mOwner = nullptr;
+    }
+    return *this;
+}
+
+MediaDecodeThreadBudget::Lease::~Lease() {
+    release();
+}
+
+void MediaDecodeThreadBudget::Lease::release() {
+    if (mOwner) {
+        mOwner->giveBack(mTaken, mSettings.rowMt);
+        mOwner = nullptr;
+    }
+}
+
+}  // namespace emulation
+}  // namespace android
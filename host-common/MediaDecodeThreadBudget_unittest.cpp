@@ -0,0 +1,63 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/MediaDecodeThreadBudget.h"
+
+#include <gtest/gtest.h>
+
+using android::emulation::MediaDecodeThreadBudget;
+
+// Tests that VP9 threads follow resolution and host cores.
+TEST(MediaDecodeThreadBudget, Select) {
+    auto vp9 = [](uint32_t w, uint32_t h, uint32_t cores) {
+        return MediaDecodeThreadBudget::select(9, w, h, cores);
+    };
+    EXPECT_EQ(1u, vp9(320, 240, 16).threads);
+    EXPECT_FALSE(vp9(320, 240, 16).rowMt);
+    EXPECT_EQ(3u, vp9(1280, 720, 16).threads);
+    EXPECT_EQ(4u, vp9(1920, 1080, 16).threads);
+    EXPECT_TRUE(vp9(1920, 1080, 16).rowMt);
+    EXPECT_EQ(4u, vp9(1080, 1920, 16).threads);
+    EXPECT_EQ(8u, vp9(3840, 2160, 16).threads);
+    EXPECT_EQ(2u, vp9(3840, 2160, 2).threads);
+    EXPECT_FALSE(vp9(3840, 2160, 1).rowMt);
+
+    EXPECT_EQ(2u, MediaDecodeThreadBudget::select(8, 3840, 2160, 16).threads);
+    EXPECT_FALSE(MediaDecodeThreadBudget::select(8, 3840, 2160, 16).rowMt);
+}
+
+// Tests that leases share the budget and give threads back.
+TEST(MediaDecodeThreadBudget, Leases) {
+    MediaDecodeThreadBudget budget(10);
+    {
+        MediaDecodeThreadBudget::Lease first = budget.acquire(9, 3840, 2160);
+        EXPECT_EQ(8u, first.settings().threads);
+        MediaDecodeThreadBudget::Lease second = budget.acquire(9, 3840, 2160);
+        EXPECT_EQ(2u, second.settings().threads);
+        EXPECT_TRUE(second.settings().rowMt);
+
+        // Exhausted: still one thread each.
+        MediaDecodeThreadBudget::Lease third = budget.acquire(9, 1920, 1080);
+        EXPECT_EQ(1u, third.settings().threads);
+        EXPECT_FALSE(third.settings().rowMt);
+        EXPECT_EQ(11u, budget.inUse());
+
+        MediaDecodeThreadBudget::Lease moved = std::move(first);
+        EXPECT_EQ(11u, budget.inUse());
+        moved = MediaDecodeThreadBudget::Lease();
+        EXPECT_EQ(3u, budget.inUse());
+    }
+    EXPECT_EQ(0u, budget.inUse());
+}
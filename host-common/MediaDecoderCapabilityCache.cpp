@@ -0,0 +1,168 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/MediaDecoderCapabilityCache.h"
+
+#include "aemu/base/files/PathUtils.h"
+#include "aemu/base/files/ScopedStdioFile.h"
+#include "aemu/base/system/System.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace android {
+namespace emulation {
+
+using base::AutoLock;
+
+namespace {
+
+constexpr char kHeader[] = "# aemu media decoder capabilities v1";
+
+// Names and fingerprints are written between tabs, one entry per line.
+bool isWritable(const std::string& s) {
+    return s.find_first_of("\t\r\n") == std::string::npos;
+}
+
+std::string defaultPath() {
+    if (base::getEnvironmentVariable("ANDROID_EMU_MEDIA_CAPS_CACHE") == "0") {
+        return {};
+    }
+    std::string dir = base::getEnvironmentVariable("ANDROID_EMULATOR_HOME");
+    if (dir.empty()) {
+#ifdef _WIN32
+        std::string home = base::getEnvironmentVariable("USERPROFILE");
+#else
+        std::string home = base::getEnvironmentVariable("HOME");
+#endif
+        if (home.empty()) {
+            return {};
+        }
+        dir = base::pj(home, ".android");
+    }
+    if (!base::pathExists(dir.c_str())) {
+        return {};
+    }
+    return base::pj(dir, "media-decoder-caps.txt");
+}
+
+}  // namespace
+
+MediaDecoderCapabilityCache::MediaDecoderCapabilityCache(std::string path)
+    : mPath(std::move(path)) {}
+
+MediaDecoderCapabilityCache& MediaDecoderCapabilityCache::get() {
+    // Leaked: decoders may probe during static destruction.
+    static MediaDecoderCapabilityCache* const sInstance =
+            new MediaDecoderCapabilityCache(defaultPath());
+    return *sInstance;
+}
+
+std::optional<bool> MediaDecoderCapabilityCache::lookup(
+        const std::string& name,
+        const std::string& fingerprint) {
+    AutoLock lock(mLock);
+    loadLocked();
+    auto iter = mEntries.find(name);
+    if (iter == mEntries.end() || iter->second.fingerprint != fingerprint) {
+        return std::nullopt;
+    }
+    return iter->second.available;
+}
+
+void MediaDecoderCapabilityCache::store(const std::string& name,
+                                        const std::string& fingerprint,
+                                        bool available) {
+    if (!isWritable(name) || !isWritable(fingerprint)) {
+        return;
+    }
+    AutoLock lock(mLock);
+    loadLocked();
+    auto iter = mEntries.find(name);
+    if (iter != mEntries.end() && iter->second.fingerprint == fingerprint &&
+        iter->second.available == available) {
+        return;
+    }
+    mEntries[name] = Entry{fingerprint, available};
+    saveLocked();
+}
+
+void MediaDecoderCapabilityCache::loadLocked() {
+    if (mLoaded) {
+        return;
+    }
+    mLoaded = true;
+    if (mPath.empty()) {
+        return;
+    }
+    base::ScopedStdioFile file(fopen(mPath.c_str(), "rb"));
+    if (!file) {
+        return;
+    }
+
+    char line[1024];
+    if (!fgets(line, sizeof(line), file.get()) ||
+        strncmp(line, kHeader, strlen(kHeader))) {
+        // Another version's file is ignored, and replaced by the next store.
+        return;
+    }
+    while (fgets(line, sizeof(line), file.get())) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char* const nameEnd = strchr(line, '\t');
+        char* const fingerprintEnd = nameEnd ? strrchr(nameEnd + 1, '\t') : nullptr;
+        if (!fingerprintEnd || (strcmp(fingerprintEnd + 1, "0") &&
+                                strcmp(fingerprintEnd + 1, "1"))) {
+            continue;
+        }
+        mEntries[std::string(line, nameEnd)] =
+                Entry{std::string(nameEnd + 1, fingerprintEnd),
+                      fingerprintEnd[1] == '1'};
+    }
+}
+
+void MediaDecoderCapabilityCache::saveLocked() const {
+    if (mPath.empty()) {
+        return;
+    }
+    // Written aside and renamed, so a concurrent launch never reads half a
+    // file.
+    const std::string temp = mPath + ".tmp";
+    {
+        base::ScopedStdioFile file(fopen(temp.c_str(), "wb"));
+        if (!file) {
+            return;
+        }
+        fprintf(file.get(), "%s\n", kHeader);
+        for (const auto& kv : mEntries) {
+            fprintf(file.get(), "%s\t%s\t%d\n", kv.first.c_str(),
+                    kv.second.fingerprint.c_str(), kv.second.available ? 1 : 0);
+        }
+        if (fflush(file.get())) {
+            file.reset();
+            remove(temp.c_str());
+            return;
+        }
+    }
+#ifdef _WIN32
+    // rename() doesn't replace on Windows.
+    remove(mPath.c_str());
+#endif
+    if (rename(temp.c_str(), mPath.c_str())) {
+        remove(temp.c_str());
+    }
+}
+
+}  // namespace emulation
+}  // namespace android
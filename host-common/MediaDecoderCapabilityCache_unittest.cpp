@@ -0,0 +1,74 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/MediaDecoderCapabilityCache.h"
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <string>
+
+using android::emulation::MediaDecoderCapabilityCache;
+
+namespace {
+
+std::string cachePath(const char* name) {
+    const std::string path = ::testing::TempDir() + "media_caps_" + name;
+    remove(path.c_str());
+    return path;
+}
+
+}  // namespace
+
+// Tests that entries survive a new instance and only match their
+// fingerprint.
+TEST(MediaDecoderCapabilityCache, Persists) {
+    const std::string path = cachePath("persists");
+    {
+        MediaDecoderCapabilityCache cache(path);
+        EXPECT_FALSE(cache.lookup("cuvid", "driver 1").has_value());
+        cache.store("cuvid", "driver 1", false);
+        cache.store("vtb", "os 14", true);
+        EXPECT_EQ(false, cache.lookup("cuvid", "driver 1"));
+    }
+
+    MediaDecoderCapabilityCache cache(path);
+    EXPECT_EQ(false, cache.lookup("cuvid", "driver 1"));
+    EXPECT_EQ(true, cache.lookup("vtb", "os 14"));
+    EXPECT_FALSE(cache.lookup("cuvid", "driver 2").has_value());
+
+    cache.store("cuvid", "driver 2", true);
+    EXPECT_EQ(true, MediaDecoderCapabilityCache(path).lookup("cuvid", "driver 2"));
+    remove(path.c_str());
+}
+
+// Tests that an unreadable file and unwritable names are ignored.
+TEST(MediaDecoderCapabilityCache, IgnoresBadInput) {
+    const std::string path = cachePath("bad");
+    FILE* file = fopen(path.c_str(), "wb");
+    ASSERT_NE(nullptr, file);
+    fputs("something else\ncuvid\tx\t1\n", file);
+    fclose(file);
+
+    MediaDecoderCapabilityCache cache(path);
+    EXPECT_FALSE(cache.lookup("cuvid", "x").has_value());
+    cache.store("bad\tname", "x", true);
+    EXPECT_FALSE(cache.lookup("bad\tname", "x").has_value());
+
+    MediaDecoderCapabilityCache memoryOnly("");
+    memoryOnly.store("cuvid", "x", true);
+    EXPECT_EQ(true, memoryOnly.lookup("cuvid", "x"));
+    remove(path.c_str());
+}
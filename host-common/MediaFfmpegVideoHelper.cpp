@@ -13,7 +13,7 @@
 // limitations under the License.
 
 #include "host-common/MediaFfmpegVideoHelper.h"
-#include "host-common/YuvConverter.h"
+#include "host-common/YuvKernels.h"
 #include "android/utils/debug.h"
 
 #define MEDIA_FFMPEG_DEBUG 0
@@ -69,6 +69,10 @@ bool MediaFfmpegVideoHelper::init() {
             codecType = AV_CODEC_ID_H264;
             MEDIA_DPRINT("create h264 ffmpeg decoder%d", (int)mType);
             break;
+        case 265:
+            codecType = AV_CODEC_ID_HEVC;
+            MEDIA_DPRINT("create hevc ffmpeg decoder%d", (int)mType);
+            break;
         default:
             MEDIA_DPRINT("invalid codec %d", (int)mType);
             return false;
@@ -95,7 +99,9 @@ bool MediaFfmpegVideoHelper::init() {
                  mCodecCtx);
 
     dprint("successfully created ffmpeg video decoder for %s",
-           mType == 264 ? "H264" : (mType == 8 ? "VP8" : "VP9"));
+           mType == 264 ? "H264"
+                        : (mType == 265 ? "HEVC"
+                                        : (mType == 8 ? "VP8" : "VP9")));
 
     return true;
 }
@@ -120,34 +126,45 @@ void MediaFfmpegVideoHelper::deInit() {
     }
 }
 
+bool MediaFfmpegVideoHelper::resetForReuse() {
+    if (!mCodecCtx || !mFrame) {
+        return false;
+    }
+    // Drops reference frames and anything buffered for frame threading;
+    // the next stream brings its own SPS/PPS.
+    avcodec_flush_buffers(mCodecCtx);
+    mSavedDecodedFrames.clear();
+    mDecodedFrame.clear();
+    mIgnoreDecoderOutput = false;
+    setOutputBuffer(nullptr, 0);
+    return true;
+}
+
 void MediaFfmpegVideoHelper::copyFrame() {
     int w = mFrame->width;
     int h = mFrame->height;
-    mDecodedFrame.resize(w * h * 3 / 2);
+    const size_t frameSize = w * h * 3 / 2;
+    mDecodedFrame = takeOutputBuffer(frameSize);
+    if (mDecodedFrame.empty()) {
+        mDecodedFrame.resize(frameSize);
+    }
     MEDIA_DPRINT("w %d h %d Y line size %d U line size %d V line size %d", w, h,
                  mFrame->linesize[0], mFrame->linesize[1], mFrame->linesize[2]);
-    for (int i = 0; i < h; ++i) {
-        memcpy(mDecodedFrame.data() + i * w,
-               mFrame->data[0] + i * mFrame->linesize[0], w);
-    }
+    uint8_t* dst = mDecodedFrame.data();
+    yuvCopyPlane(mFrame->data[0], mFrame->linesize[0], dst, w, w, h);
     MEDIA_DPRINT("format is %d and NV21 is %d  NV12 is %d", mFrame->format,
                  (int)AV_PIX_FMT_NV21, (int)AV_PIX_FMT_NV12);
     if (mFrame->format == AV_PIX_FMT_NV12) {
-        for (int i = 0; i < h / 2; ++i) {
-            memcpy(w * h + mDecodedFrame.data() + i * w,
-                   mFrame->data[1] + i * mFrame->linesize[1], w);
-        }
-        YuvConverter<uint8_t> convert8(w, h);
-        convert8.UVInterleavedToPlanar(mDecodedFrame.data());
+        // Split straight out of the decoder's buffer instead of copying the
+        // UV plane and converting it in place.
+        yuvDeinterleaveUV(mFrame->data[1], mFrame->linesize[1], dst + w * h,
+                          w / 2, dst + w * h + w * h / 4, w / 2, w / 2,
+                          h / 2);
     } else {
-        for (int i = 0; i < h / 2; ++i) {
-            memcpy(w * h + mDecodedFrame.data() + i * w / 2,
-                   mFrame->data[1] + i * mFrame->linesize[1], w / 2);
-        }
-        for (int i = 0; i < h / 2; ++i) {
-            memcpy(w * h + w * h / 4 + mDecodedFrame.data() + i * w / 2,
-                   mFrame->data[2] + i * mFrame->linesize[2], w / 2);
-        }
+        yuvCopyPlane(mFrame->data[1], mFrame->linesize[1], dst + w * h, w / 2,
+                     w / 2, h / 2);
+        yuvCopyPlane(mFrame->data[2], mFrame->linesize[2],
+                     dst + w * h + w * h / 4, w / 2, w / 2, h / 2);
     }
     MEDIA_DPRINT("copied Frame and it has presentation time at %lld",
                  (long long)(mFrame->pts));
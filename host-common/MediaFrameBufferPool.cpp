@@ -0,0 +1,129 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/MediaFrameBufferPool.h"
+
+#include "aemu/base/AlignedBuf.h"
+
+#include <algorithm>
+
+#include <string.h>
+
+namespace android {
+namespace emulation {
+
+using base::AutoLock;
+
+// static
+MediaFrameBufferPool& MediaFrameBufferPool::get() {
+    // Leaked: frames may still be released during static destruction.
+    static MediaFrameBufferPool* const sInstance = new MediaFrameBufferPool();
+    return *sInstance;
+}
+
+std::shared_ptr<uint8_t> MediaFrameBufferPool::acquire(size_t size,
+                                                       size_t* capacity) {
+    *capacity = std::max<size_t>(kPageSize,
+                                 (size + kPageSize - 1) & ~(kPageSize - 1));
+
+    uint8_t* bytes = nullptr;
+    {
+        AutoLock lock(mLock);
+        auto i = mFree.find(*capacity);
+        if (i != mFree.end() && !i->second.empty()) {
+            bytes = i->second.back();
+            i->second.pop_back();
+        }
+    }
+    if (!bytes) {
+        bytes = static_cast<uint8_t*>(aligned_buf_alloc(kPageSize, *capacity));
+    }
+
+    const size_t cap = *capacity;
+    return std::shared_ptr<uint8_t>(
+            bytes, [this, cap](uint8_t* bytes) { release(bytes, cap); });
+}
+
+void MediaFrameBufferPool::release(uint8_t* bytes, size_t capacity) {
+    {
+        AutoLock lock(mLock);
+        auto& free = mFree[capacity];
+        if (free.size() < kMaxFreePerCapacity) {
+            free.push_back(bytes);
+            return;
+        }
+    }
+    aligned_buf_free(bytes);
+}
+
+void MediaFrameBufferPool::trim() {
+    std::unordered_map<size_t, std::vector<uint8_t*>> free;
+    {
+        AutoLock lock(mLock);
+        free.swap(mFree);
+    }
+    for (auto& kv : free) {
+        for (uint8_t* bytes : kv.second) {
+            aligned_buf_free(bytes);
+        }
+    }
+}
+
+size_t MediaFrameBufferPool::freeCount() const {
+    AutoLock lock(mLock);
+    size_t count = 0;
+    for (const auto& kv : mFree) {
+        count += kv.second.size();
+    }
+    return count;
+}
+
+MediaFrameBuffer::MediaFrameBuffer(const std::vector<uint8_t>& bytes) {
+    resize(bytes.size());
+    if (!bytes.empty()) {
+        memcpy(data(), bytes.data(), bytes.size());
+    }
+}
+
+// static
+MediaFrameBuffer MediaFrameBuffer::wrap(uint8_t* bytes, size_t size) {
+    MediaFrameBuffer buf;
+    buf.mBytes = std::shared_ptr<uint8_t>(bytes, [](uint8_t*) {});
+    buf.mSize = size;
+    buf.mCapacity = size;
+    return buf;
+}
+
+void MediaFrameBuffer::resize(size_t size) {
+    if (size > mCapacity) {
+        size_t capacity;
+        std::shared_ptr<uint8_t> bytes =
+                MediaFrameBufferPool::get().acquire(size, &capacity);
+        if (mSize) {
+            memcpy(bytes.get(), mBytes.get(), mSize);
+        }
+        mBytes = std::move(bytes);
+        mCapacity = capacity;
+    }
+    mSize = size;
+}
+
+void MediaFrameBuffer::clear() {
+    mBytes.reset();
+    mSize = 0;
+    mCapacity = 0;
+}
+
+}  // namespace emulation
+}  // namespace android
@@ -0,0 +1,126 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/MediaFrameBufferPool.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+using android::emulation::MediaFrameBuffer;
+using android::emulation::MediaFrameBufferPool;
+using android::emulation::MediaFrameQueue;
+
+// Tests that a released buffer is handed out again for the same capacity,
+// page aligned.
+TEST(MediaFrameBufferPool, Recycles) {
+    MediaFrameBufferPool::get().trim();
+
+    const uint8_t* first;
+    {
+        MediaFrameBuffer buf(1920 * 1080 * 3 / 2);
+        first = buf.data();
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(first) %
+                              MediaFrameBufferPool::kPageSize);
+    }
+    EXPECT_EQ(1u, MediaFrameBufferPool::get().freeCount());
+
+    MediaFrameBuffer buf(1920 * 1080 * 3 / 2 - 100);
+    EXPECT_EQ(first, buf.data());
+    EXPECT_EQ(0u, MediaFrameBufferPool::get().freeCount());
+}
+
+// Tests that copies share bytes and the buffer returns once all are gone.
+TEST(MediaFrameBufferPool, SharedUntilLastReference) {
+    MediaFrameBufferPool::get().trim();
+
+    MediaFrameBuffer a(std::vector<uint8_t>{1, 2, 3});
+    EXPECT_EQ(3u, a.size());
+    MediaFrameBuffer b = a;
+    EXPECT_EQ(a.data(), b.data());
+
+    a.clear();
+    EXPECT_TRUE(a.empty());
+    EXPECT_EQ(0u, MediaFrameBufferPool::get().freeCount());
+    EXPECT_EQ(3, b.data()[2]);
+
+    MediaFrameBuffer c = std::move(b);
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ(3u, c.size());
+    c.clear();
+    EXPECT_EQ(1u, MediaFrameBufferPool::get().freeCount());
+}
+
+// Tests that growing keeps the contents.
+TEST(MediaFrameBufferPool, Resize) {
+    MediaFrameBuffer buf(10);
+    memset(buf.data(), 7, 10);
+    buf.resize(MediaFrameBufferPool::kPageSize * 3);
+    EXPECT_EQ(MediaFrameBufferPool::kPageSize * 3, buf.size());
+    EXPECT_EQ(7, buf.data()[9]);
+    buf.resize(5);
+    EXPECT_EQ(5u, buf.size());
+    EXPECT_EQ(7, buf.data()[4]);
+}
+
+// Tests FIFO order across wrap-around and growth.
+TEST(MediaFrameQueue, Fifo) {
+    MediaFrameQueue<int> q;
+    EXPECT_TRUE(q.empty());
+
+    int next = 0;
+    int expected = 0;
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < round + 3; ++i) {
+            q.push_back(next++);
+        }
+        for (int i = 0; i < 2; ++i) {
+            ASSERT_FALSE(q.empty());
+            EXPECT_EQ(expected++, q.front());
+            q.pop_front();
+        }
+    }
+    EXPECT_EQ(size_t(next - expected), q.size());
+    for (size_t i = 0; i < q.size(); ++i) {
+        EXPECT_EQ(expected + int(i), q[i]);
+    }
+
+    MediaFrameQueue<int> other = std::move(q);
+    EXPECT_TRUE(q.empty());
+    int seen = expected;
+    other.forEach([&seen](int v) { EXPECT_EQ(seen++, v); });
+    EXPECT_EQ(next, seen);
+
+    other.clear();
+    EXPECT_TRUE(other.empty());
+}
+
+// Tests that wrapped memory is used in place and never joins the pool.
+TEST(MediaFrameBufferPool, Wrap) {
+    MediaFrameBufferPool::get().trim();
+
+    std::vector<uint8_t> external(64, 5);
+    {
+        MediaFrameBuffer buf = MediaFrameBuffer::wrap(external.data(), 64);
+        EXPECT_EQ(external.data(), buf.data());
+        EXPECT_EQ(64u, buf.size());
+        buf.resize(32);
+        EXPECT_EQ(external.data(), buf.data());
+
+        buf.resize(128);
+        EXPECT_NE(external.data(), buf.data());
+        EXPECT_EQ(5, buf.data()[31]);
+    }
+    EXPECT_EQ(1u, MediaFrameBufferPool::get().freeCount());
+}
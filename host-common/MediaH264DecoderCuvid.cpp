@@ -353,9 +353,9 @@ void MediaH264DecoderCuvid::getImage(void* ptr) {
                         param.hostColorBufferId, myOutputWidth, myOutputHeight,
                         decodedTexFrame);
             } else {
-                mRenderer.renderToHostColorBuffer(param.hostColorBufferId,
-                                                  myOutputWidth, myOutputHeight,
-                                                  decodedFrame.data());
+                mRenderer.renderToHostColorBufferAsync(
+                        param.hostColorBufferId, myOutputWidth, myOutputHeight,
+                        decodedFrame.data(), decodedFrame.size());
             }
         } else {
             if (mUseGpuTexture) {
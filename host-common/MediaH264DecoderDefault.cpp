@@ -37,8 +37,9 @@ namespace emulation {
 
 namespace {
 MediaH264DecoderPlugin* makeDecoderPlugin(uint64_t pluginid,
-                                          H264PingInfoParser parser) {
-    return new MediaH264DecoderGeneric(pluginid, parser);
+                                          H264PingInfoParser parser,
+                                          MediaCodecType codec) {
+    return new MediaH264DecoderGeneric(pluginid, parser, codec);
 }
 
 }; // anon namespace
@@ -130,7 +131,8 @@ void MediaH264DecoderDefault::handlePing(MediaCodecType type,
                     "handle init decoder context request from guest version %u",
                     parser.version());
             uint64_t myid = createId();
-            MediaH264DecoderPlugin* mydecoder = makeDecoderPlugin(myid, parser);
+            MediaH264DecoderPlugin* mydecoder =
+                    makeDecoderPlugin(myid, parser, mCodec);
             addDecoder(myid, mydecoder);
             mydecoder->initH264Context(ptr);
             *(param.pHostDecoderId) = myid;
@@ -171,6 +173,14 @@ void MediaH264DecoderDefault::handlePing(MediaCodecType type,
             mydecoder->getImage(ptr);
             break;
         }
+        case MediaOperation::SetOutputBuffer: {
+            H264_DPRINT("handle setoutputbuffer request from guest %p", ptr);
+            MediaH264DecoderPlugin* mydecoder = getDecoder(readId(ptr));
+            if (nullptr == mydecoder)
+                return;
+            mydecoder->setOutputBuffer(ptr);
+            break;
+        }
         case MediaOperation::Reset: {
             H264_DPRINT("handle reset request from guest %p", ptr);
             uint64_t oldId = readId(ptr);
@@ -211,7 +221,8 @@ bool MediaH264DecoderDefault::load(base::Stream* stream) {
         int type = stream->getBe32();
         if (type == MediaH264DecoderPlugin::PLUGIN_TYPE_GENERIC) {
             MediaH264DecoderGeneric* decoder =
-                    new MediaH264DecoderGeneric(id, H264PingInfoParser(100));
+                    new MediaH264DecoderGeneric(id, H264PingInfoParser(100),
+                                                mCodec);
             decoder->load(stream);
             mDecoders[id] = decoder;
             continue;
@@ -15,7 +15,9 @@
 #include "host-common/MediaH264DecoderGeneric.h"
 #include "aemu/base/system/System.h"
 #include "host-common/H264PingInfoParser.h"
+#include "host-common/MediaAsyncVideoHelper.h"
 #include "host-common/MediaFfmpegVideoHelper.h"
+#include "host-common/MediaVideoHelperPool.h"
 #include "android/main-emugl.h"
 
 #ifndef __APPLE__
@@ -50,6 +52,7 @@ using InitContextParam = H264PingInfoParser::InitContextParam;
 using DecodeFrameParam = H264PingInfoParser::DecodeFrameParam;
 using ResetParam = H264PingInfoParser::ResetParam;
 using GetImageParam = H264PingInfoParser::GetImageParam;
+using SetOutputBufferParam = H264PingInfoParser::SetOutputBufferParam;
 using TextureFrame = MediaHostRenderer::TextureFrame;
 
 namespace {
@@ -69,6 +72,20 @@ bool canUseCudaDecoder() {
 #endif
 }
 
+// Whether a hardware decoder could take this stream, given a session.
+bool hasHwDecoder(int parserVersion, bool hevc) {
+#ifndef __APPLE__
+    return canUseCudaDecoder() && parserVersion >= 200;
+#else
+    //TODO: once all the CTS passed with VTB, remove this
+    const bool is_vtb_allowed = android::base::System::getEnvironmentVariable(
+                            "ANDROID_EMU_MEDIA_DECODER_VTB") == "1";
+
+    // The VideoToolbox helper only knows how to build an avcC description.
+    return is_vtb_allowed && !hevc;
+#endif
+}
+
 bool canDecodeToGpuTexture() {
     if (emuglConfig_get_current_renderer() == SELECTED_RENDERER_HOST) {
         return true;
@@ -76,11 +93,27 @@ bool canDecodeToGpuTexture() {
         return false;
     }
 }
+
+// Decoding on a worker thread is opt-in while it gets more testing. Frames
+// decoded into GPU textures stay synchronous: the texture pool is used from
+// the thread that renders them.
+MediaVideoHelper* maybeMakeAsync(MediaVideoHelper* helper,
+                                 bool usesGpuTexture) {
+    static const bool useAsync =
+            android::base::System::getEnvironmentVariable(
+                    "ANDROID_EMU_MEDIA_DECODER_ASYNC") == "1";
+    if (!useAsync || usesGpuTexture) {
+        return helper;
+    }
+    H264_DPRINT("decoding on a worker thread");
+    return new MediaAsyncVideoHelper(std::unique_ptr<MediaVideoHelper>(helper));
+}
 };  // end namespace
 
 MediaH264DecoderGeneric::MediaH264DecoderGeneric(uint64_t id,
-                                                 H264PingInfoParser parser)
-    : mId(id), mParser(parser) {
+                                                 H264PingInfoParser parser,
+                                                 MediaCodecType codec)
+    : mId(id), mParser(parser), mCodec(codec) {
     H264_DPRINT("allocated MediaH264DecoderGeneric %p with version %d", this,
                 (int)mParser.version());
     mUseGpuTexture = canDecodeToGpuTexture();
@@ -119,75 +152,102 @@ void MediaH264DecoderGeneric::initH264ContextInternal(unsigned int width,
     mOutputHeight = outHeight;
     mOutPixFmt = outPixFmt;
 
-#ifndef __APPLE__
-    if (canUseCudaDecoder() && mParser.version() >= 200) {
-        MediaCudaVideoHelper::OutputTreatmentMode oMode =
-                MediaCudaVideoHelper::OutputTreatmentMode::SAVE_RESULT;
-
-        MediaCudaVideoHelper::FrameStorageMode fMode =
-                mUseGpuTexture ? MediaCudaVideoHelper::FrameStorageMode::
-                                         USE_GPU_TEXTURE
-                               : MediaCudaVideoHelper::FrameStorageMode::
-                                         USE_BYTE_BUFFER;
-
-        auto cudavid =
-                new MediaCudaVideoHelper(oMode, fMode, cudaVideoCodec_H264);
-
-        if (mUseGpuTexture) {
-            H264_DPRINT("use gpu texture");
-            cudavid->resetTexturePool(mRenderer.getTexturePool());
-        }
-        mHwVideoHelper.reset(cudavid);
-        if (!mHwVideoHelper->init()) {
-            mHwVideoHelper.reset(nullptr);
-            H264_DPRINT("failed to init cuda decoder");
+    // Any session from a previous context went back in destroyH264Context().
+    mHwCapable = hasHwDecoder(mParser.version(), isHevc());
+    if (mHwCapable) {
+        mHwSession = MediaHwSessionArbiter::get().acquire();
+        if (mHwSession.granted()) {
+            createHwVideoHelper();
         } else {
-            H264_DPRINT("succeeded to init cuda decoder");
+            H264_DPRINT("no hw decode session free; starting in software");
         }
     }
-#else
-    //TODO: once all the CTS passed with VTB, remove this
-    const bool is_vtb_allowed = android::base::System::getEnvironmentVariable(
-                            "ANDROID_EMU_MEDIA_DECODER_VTB") == "1";
 
-    if (is_vtb_allowed) {
-        MediaVideoToolBoxVideoHelper::FrameStorageMode fMode =
-            (mParser.version() >= 200 && mUseGpuTexture)
-                    ? MediaVideoToolBoxVideoHelper::FrameStorageMode::
-                              USE_GPU_TEXTURE
-                    : MediaVideoToolBoxVideoHelper::FrameStorageMode::
-                              USE_BYTE_BUFFER;
-        auto macDecoder = new MediaVideoToolBoxVideoHelper(
-            mOutputWidth, mOutputHeight,
-            MediaVideoToolBoxVideoHelper::OutputTreatmentMode::SAVE_RESULT,
-            fMode);
-
-        if (mUseGpuTexture && mParser.version() >= 200) {
-            H264_DPRINT("use gpu texture on OSX");
-            macDecoder->resetTexturePool(mRenderer.getTexturePool());
-        }
-        mHwVideoHelper.reset(macDecoder);
-        mHwVideoHelper->init();
+    mSnapshotHelper.reset(new MediaSnapshotHelper(
+            isHevc() ? MediaSnapshotHelper::CodecType::HEVC
+                     : MediaSnapshotHelper::CodecType::H264));
+
+    H264_DPRINT("Successfully created h264 decoder context %p", this);
+}
+
+// Only called holding a hardware session.
+void MediaH264DecoderGeneric::createHwVideoHelper() {
+#ifndef __APPLE__
+    MediaCudaVideoHelper::OutputTreatmentMode oMode =
+            MediaCudaVideoHelper::OutputTreatmentMode::SAVE_RESULT;
+
+    MediaCudaVideoHelper::FrameStorageMode fMode =
+            mUseGpuTexture ? MediaCudaVideoHelper::FrameStorageMode::
+                                     USE_GPU_TEXTURE
+                           : MediaCudaVideoHelper::FrameStorageMode::
+                                     USE_BYTE_BUFFER;
+
+    auto cudavid = new MediaCudaVideoHelper(
+            oMode, fMode,
+            isHevc() ? cudaVideoCodec_HEVC : cudaVideoCodec_H264);
+
+    if (mUseGpuTexture) {
+        H264_DPRINT("use gpu texture");
+        cudavid->resetTexturePool(mRenderer.getTexturePool());
+    }
+    mHwVideoHelper.reset(maybeMakeAsync(cudavid, mUseGpuTexture));
+    if (!mHwVideoHelper->init()) {
+        mHwVideoHelper.reset(nullptr);
+        mHwSession.release();
+        mHwCapable = false;
+        H264_DPRINT("failed to init cuda decoder");
+    } else {
+        H264_DPRINT("succeeded to init cuda decoder");
+    }
+#else
+    MediaVideoToolBoxVideoHelper::FrameStorageMode fMode =
+        (mParser.version() >= 200 && mUseGpuTexture)
+                ? MediaVideoToolBoxVideoHelper::FrameStorageMode::
+                          USE_GPU_TEXTURE
+                : MediaVideoToolBoxVideoHelper::FrameStorageMode::
+                          USE_BYTE_BUFFER;
+    auto macDecoder = new MediaVideoToolBoxVideoHelper(
+        mOutputWidth, mOutputHeight,
+        MediaVideoToolBoxVideoHelper::OutputTreatmentMode::SAVE_RESULT,
+        fMode);
+
+    if (mUseGpuTexture && mParser.version() >= 200) {
+        H264_DPRINT("use gpu texture on OSX");
+        macDecoder->resetTexturePool(mRenderer.getTexturePool());
     }
+    mHwVideoHelper.reset(maybeMakeAsync(
+            macDecoder, fMode == MediaVideoToolBoxVideoHelper::
+                                        FrameStorageMode::USE_GPU_TEXTURE));
+    mHwVideoHelper->init();
 #endif
+}
 
-    mSnapshotHelper.reset(
-            new MediaSnapshotHelper(MediaSnapshotHelper::CodecType::H264));
-
-    H264_DPRINT("Successfully created h264 decoder context %p", this);
+MediaVideoHelperPool::Key MediaH264DecoderGeneric::softVideoHelperKey() const {
+    return MediaVideoHelperPool::Key{
+            MediaVideoHelperPool::Key::Backend::Ffmpeg, ffmpegCodec(),
+            mParser.version() < 200 ? 1 : 4};
 }
 
 void MediaH264DecoderGeneric::createAndInitSoftVideoHelper() {
-    mSwVideoHelper.reset(
-            new MediaFfmpegVideoHelper(264, mParser.version() < 200 ? 1 : 4));
+    const int threads = softVideoHelperKey().variant;
+    const int codec = ffmpegCodec();
+    mSwVideoHelper = MediaVideoHelperPool::get().acquire(
+            softVideoHelperKey(), [codec, threads]() {
+                MediaVideoHelper* helper = maybeMakeAsync(
+                        new MediaFfmpegVideoHelper(codec, threads), false);
+                helper->init();
+                return helper;
+            });
     mUseGpuTexture = false;
-    mSwVideoHelper->init();
 }
 
 MediaH264DecoderPlugin* MediaH264DecoderGeneric::clone() {
     H264_DPRINT("clone MediaH264DecoderGeneric %p with version %d", this,
                 (int)mParser.version());
-    return new MediaH264DecoderGeneric(mId, mParser);
+    auto decoder = new MediaH264DecoderGeneric(mId, mParser, mCodec);
+    decoder->mGuestOutputBuffer = mGuestOutputBuffer;
+    decoder->mGuestOutputBufferSize = mGuestOutputBufferSize;
+    return decoder;
 }
 
 void MediaH264DecoderGeneric::destroyH264Context() {
@@ -210,9 +270,11 @@ void MediaH264DecoderGeneric::destroyH264Context() {
         mHwVideoHelper->deInit();
         mHwVideoHelper.reset(nullptr);
     }
+    mHwSession.release();
     if (mVideoHelper != nullptr) {
-        mVideoHelper->deInit();
-        mVideoHelper.reset(nullptr);
+        // Only ever the ffmpeg helper; hand it to the next decoder.
+        MediaVideoHelperPool::get().release(softVideoHelperKey(),
+                                            std::move(mVideoHelper));
     }
 }
 
@@ -228,13 +290,34 @@ void MediaH264DecoderGeneric::decodeFrame(void* ptr) {
     size_t* retSzBytes = param.pConsumedBytes;
     int32_t* retErr = param.pDecoderErrorCode;
 
+    *retSzBytes = szBytes;
+    *retErr = (int32_t)Err::NoErr;
+
+    // The snapshot helper only needs the NALUs before the slice data. It
+    // parses HEVC packets itself.
+    const H264NaluList* nalus = nullptr;
+    if (!isHevc()) {
+        mNalus.parse(frame, szBytes, true);
+        nalus = &mNalus;
+    }
+
+    // After loading a snapshot without packet history there is nothing to
+    // predict from until the next key frame.
+    if (mSnapshotHelper->repeatReferenceFrame(frame, szBytes, inputPts,
+                                              nalus)) {
+        H264_DPRINT("repeated the reference frame");
+        return;
+    }
+
+    if (!isHevc()) {
+        maybeUpgradeToHw();
+    }
+    offerGuestOutputBuffer();
     decodeFrameInternal(frame, szBytes, inputPts);
 
-    mSnapshotHelper->savePacket(frame, szBytes, inputPts);
+    mSnapshotHelper->savePacket(frame, szBytes, inputPts, nalus);
     fetchAllFrames();
-
-    *retSzBytes = szBytes;
-    *retErr = (int32_t)Err::NoErr;
+    withdrawGuestOutputBuffer();
 
     H264_DPRINT("done decoding this frame");
 }
@@ -253,6 +336,15 @@ void MediaH264DecoderGeneric::decodeFrameInternal(const uint8_t* data,
 void MediaH264DecoderGeneric::try_decode(const uint8_t* data,
                                          size_t len,
                                          uint64_t pts) {
+    // Another emulator's foreground stream needs the session. Frames already
+    // decoded may sit in GPU textures, so wait until they have been taken.
+    if (mHwVideoHelper != nullptr && !mSnapshotHelper->frontFrame() &&
+        mHwSession.preempted()) {
+        H264_DPRINT("HW decode session preempted; switch to SW");
+        mHwVideoHelper->deInit();
+        mHwVideoHelper.reset(nullptr);
+    }
+
     // for h264, it needs sps/pps to decide whether decoding is
     // possible;
     if (mHwVideoHelper != nullptr) {
@@ -263,6 +355,8 @@ void MediaH264DecoderGeneric::try_decode(const uint8_t* data,
             H264_DPRINT("Failed to decode with HW decoder %d; switch to SW",
                         mHwVideoHelper->error());
             mHwVideoHelper.reset(nullptr);
+            mHwSession.release();
+            mHwCapable = false;
         }
     }
 
@@ -283,6 +377,47 @@ void MediaH264DecoderGeneric::try_decode(const uint8_t* data,
     mTrialPeriod = false;
 }
 
+void MediaH264DecoderGeneric::maybeUpgradeToHw() {
+    // The hardware decoder can only start at a key frame.
+    if (mTrialPeriod || !mHwCapable || mHwSession.granted() ||
+        !mNalus.contains(H264NaluParser::H264NaluType::CodedSliceIDR) ||
+        !mHwSession.tryUpgrade()) {
+        return;
+    }
+    // Frames already decoded in software are in byte buffers; keep it that
+    // way rather than mix them with textures.
+    createHwVideoHelper();
+    if (mHwVideoHelper == nullptr) {
+        return;
+    }
+
+    // Parameter sets sent before this packet are in the history.
+    if (!mNalus.contains(H264NaluParser::H264NaluType::SPS)) {
+        mHwVideoHelper->setIgnoreDecodedFrames();
+        std::function<void(const uint8_t*, size_t, uint64_t)> func =
+                [this](const uint8_t* data, size_t len, uint64_t pts) {
+                    mHwVideoHelper->decode(data, len, pts);
+                    MediaSnapshotState::FrameInfo frame;
+                    while (mHwVideoHelper->receiveFrame(&frame)) {
+                    }
+                };
+        mSnapshotHelper->replay(func);
+        mHwVideoHelper->setSaveDecodedFrames();
+        if (!mHwVideoHelper->good()) {
+            H264_DPRINT("HW decoder failed to take over; staying on SW");
+            mHwVideoHelper.reset(nullptr);
+            mHwSession.release();
+            mHwCapable = false;
+            return;
+        }
+    }
+
+    H264_DPRINT("HW decode session granted; switch back to HW");
+    MediaVideoHelperPool::get().release(softVideoHelperKey(),
+                                        std::move(mVideoHelper));
+    mTrialPeriod = true;
+}
+
 void MediaH264DecoderGeneric::fetchAllFrames() {
     while (true) {
         MediaSnapshotState::FrameInfo frame;
@@ -300,12 +435,14 @@ void MediaH264DecoderGeneric::fetchAllFrames() {
 
 void MediaH264DecoderGeneric::flush(void* ptr) {
     H264_DPRINT("Flushing...");
+    offerGuestOutputBuffer();
     if (mHwVideoHelper) {
         mHwVideoHelper->flush();
     } else if (mVideoHelper) {
         mVideoHelper->flush();
     }
     fetchAllFrames();
+    withdrawGuestOutputBuffer();
     H264_DPRINT("Flushing done");
 }
 
@@ -329,6 +466,12 @@ void MediaH264DecoderGeneric::getImage(void* ptr) {
                 (int)param.hostColorBufferId);
 
     MediaSnapshotState::FrameInfo* pFrame = mSnapshotHelper->frontFrame();
+    if (pFrame == nullptr) {
+        // An asynchronous helper may have finished frames since the last
+        // decodeFrame.
+        fetchAllFrames();
+        pFrame = mSnapshotHelper->frontFrame();
+    }
     if (pFrame == nullptr) {
         H264_DPRINT("there is no image");
         *retErr = static_cast<int>(Err::NoDecodedFrame);
@@ -350,16 +493,20 @@ void MediaH264DecoderGeneric::getImage(void* ptr) {
             H264_DPRINT(
                     "calling rendering to host side color buffer with id %d",
                     param.hostColorBufferId);
-            mRenderer.renderToHostColorBuffer(param.hostColorBufferId,
-                                              pFrame->width, pFrame->height,
-                                              pFrame->data.data());
+            mRenderer.renderToHostColorBufferAsync(
+                    param.hostColorBufferId, pFrame->width, pFrame->height,
+                    pFrame->data.data(),
+                    pFrame->width * pFrame->height * 3 / 2);
         }
         needToCopyToGuest = false;
     }
 
-    if (needToCopyToGuest) {
-        memcpy(param.pDecodedFrame, pFrame->data.data(),
-               pFrame->width * pFrame->height * 3 / 2);
+    // Frames decoded into the guest's registered buffer are already there.
+    if (needToCopyToGuest && pFrame->data.data() != param.pDecodedFrame) {
+        // memmove: the frame may sit in the registered buffer at an offset
+        // that overlaps where the guest asked for it now.
+        memmove(param.pDecodedFrame, pFrame->data.data(),
+                pFrame->width * pFrame->height * 3 / 2);
     }
 
     *retErr = pFrame->width * pFrame->height * 3 / 2;
@@ -378,6 +525,41 @@ void MediaH264DecoderGeneric::getImage(void* ptr) {
                 (int)mOutputWidth, (int)mOutputHeight);
 }
 
+void MediaH264DecoderGeneric::setOutputBuffer(void* ptr) {
+    SetOutputBufferParam param{};
+    mParser.parseSetOutputBufferParams(ptr, param);
+    H264_DPRINT("guest output buffer %p size %zu", param.pOutputBuffer,
+                param.size);
+    mGuestOutputBuffer = param.pOutputBuffer;
+    mGuestOutputBufferSize = param.size;
+}
+
+void MediaH264DecoderGeneric::offerGuestOutputBuffer() {
+    // Frames only go straight to the guest when it renders them itself; the
+    // host color buffer path never reads the guest buffer.
+    if (!mGuestOutputBuffer || mParser.version() == 200) {
+        return;
+    }
+    // Whatever is at the front still has to reach the guest through
+    // getImage, possibly from the registered buffer itself.
+    if (mSnapshotHelper->frontFrame() != nullptr) {
+        return;
+    }
+    MediaVideoHelper* helper =
+            mHwVideoHelper ? mHwVideoHelper.get() : mVideoHelper.get();
+    if (helper) {
+        helper->setOutputBuffer(mGuestOutputBuffer, mGuestOutputBufferSize);
+    }
+}
+
+void MediaH264DecoderGeneric::withdrawGuestOutputBuffer() {
+    MediaVideoHelper* helper =
+            mHwVideoHelper ? mHwVideoHelper.get() : mVideoHelper.get();
+    if (helper) {
+        helper->setOutputBuffer(nullptr, 0);
+    }
+}
+
 void MediaH264DecoderGeneric::save(base::Stream* stream) const {
     stream->putBe32(mParser.version());
     stream->putBe32(mWidth);
@@ -387,6 +569,14 @@ void MediaH264DecoderGeneric::save(base::Stream* stream) const {
     const int hasContext = (mVideoHelper || mHwVideoHelper) ? 1 : 0;
     stream->putBe32(hasContext);
 
+    // Frames still being decoded asynchronously belong in the snapshot too.
+    MediaVideoHelper* helper =
+            mHwVideoHelper ? mHwVideoHelper.get() : mVideoHelper.get();
+    if (helper) {
+        helper->drain();
+        const_cast<MediaH264DecoderGeneric*>(this)->fetchAllFrames();
+    }
+
     mSnapshotHelper->save(stream);
 }
 
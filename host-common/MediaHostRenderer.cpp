@@ -14,7 +14,12 @@
 
 #include "host-common/MediaHostRenderer.h"
 
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/system/System.h"
+
+#include <algorithm>
 #include <cstdint>
+#include <unordered_map>
 #include <string>
 #include <vector>
 
@@ -34,9 +39,54 @@
 namespace android {
 namespace emulation {
 
+using base::AutoLock;
+using base::WorkerProcessingResult;
 using TextureFrame = MediaTexturePool::TextureFrame;
 
-MediaHostRenderer::MediaHostRenderer() {
+namespace {
+
+// Uploads queued per color buffer, across all renderers.
+class PendingUploads {
+public:
+    static PendingUploads& get() {
+        static PendingUploads* sPending = new PendingUploads;
+        return *sPending;
+    }
+
+    void add(int hostColorBufferId) {
+        AutoLock lock(mLock);
+        ++mPending[hostColorBufferId];
+    }
+
+    void remove(int hostColorBufferId) {
+        AutoLock lock(mLock);
+        auto it = mPending.find(hostColorBufferId);
+        if (it == mPending.end()) {
+            return;
+        }
+        if (--it->second == 0) {
+            mPending.erase(it);
+        }
+        mCv.broadcastAndUnlock(&lock);
+    }
+
+    void wait(int hostColorBufferId) {
+        AutoLock lock(mLock);
+        mCv.wait(&lock, [this, hostColorBufferId] {
+            return mPending.count(hostColorBufferId) == 0;
+        });
+    }
+
+private:
+    base::Lock mLock;
+    base::ConditionVariable mCv;
+    std::unordered_map<int, int> mPending;
+};
+
+}  // namespace
+
+MediaHostRenderer::MediaHostRenderer()
+    : mUploader([this](Upload&& item) { return upload(std::move(item)); }) {
     mVirtioGpuOps = android_getVirtioGpuOps();
     if (mVirtioGpuOps == nullptr) {
         H264_DPRINT("Error, cannot get mVirtioGpuOps");
@@ -44,6 +94,7 @@ MediaHostRenderer::MediaHostRenderer() {
 }
 
 MediaHostRenderer::~MediaHostRenderer() {
+    stopUploads();
     cleanUpTextures();
 }
 
@@ -71,13 +122,16 @@ void MediaHostRenderer::cleanUpTextures() {
 void MediaHostRenderer::renderToHostColorBuffer(int hostColorBufferId,
                                                 unsigned int outputWidth,
                                                 unsigned int outputHeight,
-                                                uint8_t* decodedFrame) {
+                                                uint8_t* decodedFrame,
+                                                void* metadata) {
     H264_DPRINT("Calling %s at %d buffer id %d", __func__, __LINE__,
                 hostColorBufferId);
     if (hostColorBufferId < 0) {
         H264_DPRINT("ERROR: negative buffer id %d", hostColorBufferId);
         return;
     }
+    // Don't let an older frame still queued overwrite this one.
+    waitForColorBuffer(hostColorBufferId);
     if (mVirtioGpuOps) {
         mVirtioGpuOps->update_color_buffer(hostColorBufferId, 0, 0, outputWidth,
                                            outputHeight, kGL_RGBA,
@@ -91,7 +145,8 @@ void MediaHostRenderer::renderToHostColorBufferWithTextures(
         int hostColorBufferId,
         unsigned int outputWidth,
         unsigned int outputHeight,
-        TextureFrame frame) {
+        TextureFrame frame,
+        void* metadata) {
     H264_DPRINT("Calling %s at %d buffer id %d", __func__, __LINE__,
                 hostColorBufferId);
     if (hostColorBufferId < 0) {
@@ -105,6 +160,7 @@ void MediaHostRenderer::renderToHostColorBufferWithTextures(
                     (int)frame.UVtex);
         return;
     }
+    waitForColorBuffer(hostColorBufferId);
     if (mVirtioGpuOps) {
         uint32_t textures[2] = {frame.Ytex, frame.UVtex};
         mVirtioGpuOps->swap_textures_and_update_color_buffer(
@@ -122,5 +178,106 @@ void MediaHostRenderer::renderToHostColorBufferWithTextures(
     }
 }
 
+void MediaHostRenderer::renderToHostColorBufferAsync(
+        int hostColorBufferId,
+        unsigned int outputWidth,
+        unsigned int outputHeight,
+        const uint8_t* decodedFrame,
+        size_t frameBytes,
+        void* metadata) {
+    if (hostColorBufferId < 0) {
+        H264_DPRINT("ERROR: negative buffer id %d", hostColorBufferId);
+        return;
+    }
+    if (!mVirtioGpuOps) {
+        H264_DPRINT("ERROR: there is no virtio Gpu Ops is not setup");
+        return;
+    }
+    if (!mUploading) {
+        mUploading = mUploader.start();
+        if (!mUploading) {
+            renderToHostColorBuffer(hostColorBufferId, outputWidth,
+                                    outputHeight,
+                                    const_cast<uint8_t*>(decodedFrame),
+                                    metadata);
+            return;
+        }
+    }
+
+    // Futures complete in slot order, so the oldest one guards mNextSlot.
+    while (!mUploadsInFlight.empty() &&
+           (mUploadsInFlight.size() >= kUploadSlots ||
+            mUploadsInFlight.front().wait_for(std::chrono::seconds(0)) ==
+                    std::future_status::ready)) {
+        mUploadsInFlight.front().wait();
+        mUploadsInFlight.pop_front();
+    }
+
+    Upload item;
+    item.hostColorBufferId = hostColorBufferId;
+    item.width = outputWidth;
+    item.height = outputHeight;
+    item.slot = mNextSlot;
+    mNextSlot = (mNextSlot + 1) % kUploadSlots;
+
+    MediaFrameBuffer& staging = mStaging[item.slot];
+    staging.resize(frameBytes);
+    memcpy(staging.data(), decodedFrame, frameBytes);
+
+    PendingUploads::get().add(hostColorBufferId);
+    item.queuedUs = base::getHighResTimeUs();
+    mUploadsInFlight.push_back(mUploader.enqueue(std::move(item)));
+    H264_DPRINT("queued upload to buffer id %d, %zu in flight",
+                hostColorBufferId, mUploadsInFlight.size());
+}
+
+WorkerProcessingResult MediaHostRenderer::upload(Upload&& item) {
+    if (item.stop) {
+        return WorkerProcessingResult::Stop;
+    }
+    // update_color_buffer() returns once the GL upload is done, so the color
+    // buffer is ready for the compositor when the fence below is released.
+    mVirtioGpuOps->update_color_buffer(
+            item.hostColorBufferId, 0, 0, item.width, item.height, kGL_RGBA,
+            kGlUnsignedByte, mStaging[item.slot].data());
+    PendingUploads::get().remove(item.hostColorBufferId);
+
+    const uint64_t latencyUs = base::getHighResTimeUs() - item.queuedUs;
+    AutoLock lock(mStatsLock);
+    ++mStats.frames;
+    mStats.lastUs = latencyUs;
+    mStats.maxUs = std::max(mStats.maxUs, latencyUs);
+    mStats.totalUs += latencyUs;
+    return WorkerProcessingResult::Continue;
+}
+
+void MediaHostRenderer::waitForColorBuffer(int hostColorBufferId) {
+    PendingUploads::get().wait(hostColorBufferId);
+}
+
+void MediaHostRenderer::waitForUploads() {
+    if (mUploading) {
+        mUploader.waitQueuedItems();
+    }
+    mUploadsInFlight.clear();
+}
+
+MediaHostRenderer::UploadStats MediaHostRenderer::getUploadStats() const {
+    AutoLock lock(mStatsLock);
+    return mStats;
+}
+
+void MediaHostRenderer::stopUploads() {
+    if (!mUploading) {
+        return;
+    }
+    Upload item;
+    item.stop = true;
+    mUploader.enqueue(std::move(item));
+    mUploader.join();
+    mUploadsInFlight.clear();
+    mUploading = false;
+}
+
 }  // namespace emulation
 }  // namespace android
@@ -0,0 +1,382 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/MediaHwSessionArbiter.h"
+
+#include "aemu/base/files/PathUtils.h"
+#include "aemu/base/system/System.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#include <windows.h>
+#else
+#include <errno.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace android {
+namespace emulation {
+
+using base::AutoLock;
+
+namespace {
+
+constexpr uint32_t kMagic = 0x48574d53;  // "HWMS"
+constexpr uint32_t kVersion = 1;
+// Emulators running at once on one host, with room to spare.
+constexpr int kMaxSlots = 64;
+
+struct Slot {
+    int32_t pid;
+    uint32_t priority;
+    uint32_t held;
+    uint32_t waiting;
+};
+
+struct Table {
+    uint32_t magic;
+    uint32_t version;
+    Slot slots[kMaxSlots];
+};
+
+bool isAlive(int pid) {
+#ifdef _WIN32
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!process) {
+        return GetLastError() == ERROR_ACCESS_DENIED;
+    }
+    DWORD code = 0;
+    const bool alive =
+            GetExitCodeProcess(process, &code) && code == STILL_ACTIVE;
+    CloseHandle(process);
+    return alive;
+#else
+    return kill(pid, 0) == 0 || errno == EPERM;
+#endif
+}
+
+bool lockFile(int fd, bool lock) {
+#ifdef _WIN32
+    HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+    OVERLAPPED overlapped = {};
+    return lock ? LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD,
+                             MAXDWORD, &overlapped)
+                : UnlockFileEx(file, 0, MAXDWORD, MAXDWORD, &overlapped);
+#else
+    int res;
+    do {
+        res = flock(fd, lock ? LOCK_EX : LOCK_UN);
+    } while (res != 0 && errno == EINTR);
+    return res == 0;
+#endif
+}
+
+bool readTable(int fd, Table* table) {
+#ifdef _WIN32
+    return _lseek(fd, 0, SEEK_SET) == 0 &&
+           _read(fd, table, sizeof(*table)) == int(sizeof(*table));
+#else
+    return pread(fd, table, sizeof(*table), 0) == ssize_t(sizeof(*table));
+#endif
+}
+
+bool writeTable(int fd, const Table& table) {
+#ifdef _WIN32
+    return _lseek(fd, 0, SEEK_SET) == 0 &&
+           _write(fd, &table, sizeof(table)) == int(sizeof(table));
+#else
+    return pwrite(fd, &table, sizeof(table), 0) == ssize_t(sizeof(table));
+#endif
+}
+
+uint32_t totalHeld(const Table& table) {
+    uint32_t held = 0;
+    for (const Slot& slot : table.slots) {
+        held += slot.held;
+    }
+    return held;
+}
+
+// Whether a process with higher priority than |self| is waiting.
+bool outranked(const Table& table, const Slot& self) {
+    for (const Slot& slot : table.slots) {
+        if (slot.waiting && slot.priority > self.priority) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool mayTake(const Table& table, const Slot& self, uint32_t budget) {
+    return totalHeld(table) < budget && !outranked(table, self);
+}
+
+std::string defaultPath() {
+    std::string dir = base::getEnvironmentVariable("ANDROID_EMULATOR_HOME");
+    if (dir.empty()) {
+#ifdef _WIN32
+        std::string home = base::getEnvironmentVariable("USERPROFILE");
+#else
+        std::string home = base::getEnvironmentVariable("HOME");
+#endif
+        if (home.empty()) {
+            return {};
+        }
+        dir = base::pj(home, ".android");
+    }
+    if (!base::pathExists(dir.c_str())) {
+        return {};
+    }
+    return base::pj(dir, "media-hw-sessions");
+}
+
+}  // namespace
+
+MediaHwSessionArbiter::MediaHwSessionArbiter(
+        std::string path,
+        uint32_t budget,
+        Priority priority,
+        int pid,
+        std::chrono::milliseconds pollInterval)
+    : mPath(std::move(path)),
+      mBudget(mPath.empty() ? 0 : budget),
+      mPid(pid),
+      mPollInterval(pollInterval),
+      mPriority(priority) {}
+
+MediaHwSessionArbiter::~MediaHwSessionArbiter() {
+    if (mFd >= 0) {
+#ifdef _WIN32
+        _close(mFd);
+#else
+        close(mFd);
+#endif
+    }
+}
+
+MediaHwSessionArbiter& MediaHwSessionArbiter::get() {
+    // Leaked: decoders may give sessions back during static destruction.
+    static MediaHwSessionArbiter* const sInstance = [] {
+        const uint32_t budget = static_cast<uint32_t>(strtoul(
+                base::getEnvironmentVariable("ANDROID_EMU_MEDIA_HW_SESSIONS")
+                        .c_str(),
+                nullptr, 10));
+        const Priority priority =
+                base::getEnvironmentVariable(
+                        "ANDROID_EMU_MEDIA_HW_PRIORITY") == "background"
+                        ? Priority::kBackground
+                        : Priority::kForeground;
+#ifdef _WIN32
+        const int pid = _getpid();
+#else
+        const int pid = getpid();
+#endif
+        return new MediaHwSessionArbiter(budget ? defaultPath() : "", budget,
+                                         priority, pid,
+                                         std::chrono::milliseconds(500));
+    }();
+    return *sInstance;
+}
+
+template <typename Update>
+bool MediaHwSessionArbiter::withTable(Update&& update) {
+    if (mFd < 0) {
+#ifdef _WIN32
+        mFd = _open(mPath.c_str(), _O_RDWR | _O_CREAT | _O_BINARY, 0600);
+#else
+        mFd = open(mPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+#endif
+        if (mFd < 0) {
+            return false;
+        }
+    }
+    if (!lockFile(mFd, true)) {
+        return false;
+    }
+
+    Table table;
+    if (!readTable(mFd, &table) || table.magic != kMagic ||
+        table.version != kVersion) {
+        memset(&table, 0, sizeof(table));
+        table.magic = kMagic;
+        table.version = kVersion;
+    }
+    Slot* self = nullptr;
+    Slot* unused = nullptr;
+    for (Slot& slot : table.slots) {
+        if (slot.pid == mPid) {
+            self = &slot;
+        } else if (slot.pid && !isAlive(slot.pid)) {
+            slot = Slot{};
+        }
+        if (!slot.pid && !unused) {
+            unused = &slot;
+        }
+    }
+    if (!self) {
+        self = unused;
+    }
+
+    bool ok = false;
+    if (self) {
+        self->pid = mPid;
+        self->priority = static_cast<uint32_t>(mPriority);
+        update(table, *self);
+        if (!self->held && !self->waiting) {
+            *self = Slot{};
+        }
+        ok = writeTable(mFd, table);
+    }
+    lockFile(mFd, false);
+    return ok;
+}
+
+MediaHwSessionArbiter::Session MediaHwSessionArbiter::acquire() {
+    if (!enabled()) {
+        return Session(this, true);
+    }
+    AutoLock lock(mLock);
+    // Without the file there is nothing to share; don't hold decoding back.
+    bool granted = true;
+    withTable([this, &granted](Table& table, Slot& self) {
+        granted = mayTake(table, self, mBudget);
+        ++(granted ? self.held : self.waiting);
+    });
+    return Session(this, granted);
+}
+
+void MediaHwSessionArbiter::setPriority(Priority priority) {
+    AutoLock lock(mLock);
+    mPriority = priority;
+    if (enabled()) {
+        withTable([](Table&, Slot&) {});
+    }
+}
+
+MediaHwSessionArbiter::Usage MediaHwSessionArbiter::usage() {
+    Usage usage;
+    if (!enabled()) {
+        return usage;
+    }
+    AutoLock lock(mLock);
+    withTable([&usage](Table& table, Slot&) {
+        for (const Slot& slot : table.slots) {
+            usage.held += slot.held;
+            usage.waiting += slot.waiting;
+        }
+    });
+    return usage;
+}
+
+MediaHwSessionArbiter::Session::Session(MediaHwSessionArbiter* owner,
+                                        bool granted)
+    : mOwner(owner), mGranted(granted) {}
+
+MediaHwSessionArbiter::Session::Session(Session&& other)
+    : mOwner(other.mOwner),
+      mGranted(other.mGranted),
+      mNextPoll(other.mNextPoll) {
+    other.mOwner = nullptr;
+    other.mGranted = false;
+}
+
+MediaHwSessionArbiter::Session& MediaHwSessionArbiter::Session::operator=(
+        Session&& other) {
+    if (this != &other) {
+        release();
+        mOwner = other.mOwner;
+        mGranted = other.mGranted;
+        mNextPoll = other.mNextPoll;
+        other.mOwner = nullptr;
+        other.mGranted = false;
+    }
+    return *this;
+}
+
+MediaHwSessionArbiter::Session::~Session() {
+    release();
+}
+
+bool MediaHwSessionArbiter::Session::due() {
+    const auto now = std::chrono::steady_clock::now();
+    if (now < mNextPoll) {
+        return false;
+    }
+    mNextPoll = now + mOwner->mPollInterval;
+    return true;
+}
+
+bool MediaHwSessionArbiter::Session::tryUpgrade() {
+    if (!mOwner || mGranted) {
+        return mGranted;
+    }
+    if (!due()) {
+        return false;
+    }
+    AutoLock lock(mOwner->mLock);
+    const uint32_t budget = mOwner->mBudget;
+    mOwner->withTable([this, budget](Table& table, Slot& self) {
+        if (self.waiting && mayTake(table, self, budget)) {
+            --self.waiting;
+            ++self.held;
+            mGranted = true;
+        }
+    });
+    return mGranted;
+}
+
+bool MediaHwSessionArbiter::Session::preempted() {
+    if (!mOwner || !mGranted || !mOwner->enabled() || !due()) {
+        return false;
+    }
+    AutoLock lock(mOwner->mLock);
+    const uint32_t budget = mOwner->mBudget;
+    mOwner->withTable([this, budget](Table& table, Slot& self) {
+        if (self.held && totalHeld(table) >= budget &&
+            outranked(table, self)) {
+            --self.held;
+            ++self.waiting;
+            mGranted = false;
+        }
+    });
+    return !mGranted;
+}
+
+void MediaHwSessionArbiter::Session::release() {
+    if (!mOwner) {
+        return;
+    }
+    if (mOwner->enabled()) {
+        AutoLock lock(mOwner->mLock);
+        const bool granted = mGranted;
+        mOwner->withTable([granted](Table&, Slot& self) {
+            uint32_t& count = granted ? self.held : self.waiting;
+            if (count) {
+                --count;
+            }
+        });
+    }
+    mOwner = nullptr;
+    mGranted = false;
+}
+
+}  // namespace emulation
+}  // namespace android
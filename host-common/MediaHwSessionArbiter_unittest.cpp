@@ -0,0 +1,139 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/MediaHwSessionArbiter.h"
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <string>
+
+#ifndef _WIN32
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using android::emulation::MediaHwSessionArbiter;
+using Priority = MediaHwSessionArbiter::Priority;
+
+namespace {
+
+std::string tablePath(const char* name) {
+    const std::string path = ::testing::TempDir() + "media_hw_sessions_" + name;
+    remove(path.c_str());
+    return path;
+}
+
+// Two emulators sharing |budget| sessions. Slots are keyed by pid and the
+// dead ones reclaimed, so they stand in as this process and its parent.
+struct TwoInstances {
+    TwoInstances(const char* name, uint32_t budget)
+        : path(tablePath(name)),
+          first(path, budget, Priority::kBackground, getpid(),
+                std::chrono::milliseconds(0)),
+          second(path, budget, Priority::kForeground, getppid(),
+                 std::chrono::milliseconds(0)) {}
+
+    const std::string path;
+    MediaHwSessionArbiter first;
+    MediaHwSessionArbiter second;
+};
+
+}  // namespace
+
+// Tests that with no budget every session is granted and nothing is
+// tracked.
+TEST(MediaHwSessionArbiter, Unlimited) {
+    MediaHwSessionArbiter arbiter(tablePath("unlimited"), 0,
+                                  Priority::kBackground, getpid(),
+                                  std::chrono::milliseconds(0));
+    auto a = arbiter.acquire();
+    auto b = arbiter.acquire();
+    EXPECT_TRUE(a.granted());
+    EXPECT_TRUE(b.granted());
+    EXPECT_FALSE(a.preempted());
+    EXPECT_EQ(0u, arbiter.usage().held);
+}
+
+// Tests that sessions are granted up to the budget across instances, and
+// given back when released.
+TEST(MediaHwSessionArbiter, SharesBudget) {
+    TwoInstances host("shares", 2);
+    host.second.setPriority(Priority::kBackground);
+
+    auto a = host.first.acquire();
+    auto b = host.second.acquire();
+    EXPECT_TRUE(a.granted());
+    EXPECT_TRUE(b.granted());
+    auto c = host.first.acquire();
+    EXPECT_FALSE(c.granted());
+    EXPECT_EQ(2u, host.second.usage().held);
+    EXPECT_EQ(1u, host.second.usage().waiting);
+
+    // Equal priority: nobody is pushed out.
+    EXPECT_FALSE(b.preempted());
+    EXPECT_FALSE(c.tryUpgrade());
+
+    MediaHwSessionArbiter::Session moved = std::move(b);
+    EXPECT_EQ(2u, host.first.usage().held);
+    moved.release();
+    EXPECT_TRUE(c.tryUpgrade());
+    EXPECT_EQ(2u, host.first.usage().held);
+    EXPECT_EQ(0u, host.first.usage().waiting);
+}
+
+// Tests that a waiting foreground instance takes a session from the
+// background, and that the background can't take it straight back.
+TEST(MediaHwSessionArbiter, ForegroundFirst) {
+    TwoInstances host("foreground", 1);
+
+    auto background = host.first.acquire();
+    ASSERT_TRUE(background.granted());
+    auto foreground = host.second.acquire();
+    EXPECT_FALSE(foreground.granted());
+    EXPECT_FALSE(foreground.tryUpgrade());
+
+    EXPECT_TRUE(background.preempted());
+    EXPECT_FALSE(background.granted());
+    EXPECT_FALSE(background.tryUpgrade());
+    EXPECT_TRUE(foreground.tryUpgrade());
+
+    // Focus moves: the old foreground no longer outranks anyone.
+    host.second.setPriority(Priority::kBackground);
+    host.first.setPriority(Priority::kForeground);
+    EXPECT_TRUE(foreground.preempted());
+    EXPECT_TRUE(background.tryUpgrade());
+}
+
+// Tests that sessions held by a process that died go back to the budget.
+TEST(MediaHwSessionArbiter, ReclaimsDeadProcesses) {
+    const std::string path = tablePath("dead");
+    const pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        MediaHwSessionArbiter arbiter(path, 1, Priority::kForeground,
+                                      getpid(), std::chrono::milliseconds(0));
+        auto session = arbiter.acquire();
+        _exit(session.granted() ? 0 : 1);
+    }
+    int status = 0;
+    ASSERT_EQ(child, waitpid(child, &status, 0));
+    ASSERT_EQ(0, WEXITSTATUS(status));
+
+    MediaHwSessionArbiter arbiter(path, 1, Priority::kBackground, getpid(),
+                                  std::chrono::milliseconds(0));
+    EXPECT_TRUE(arbiter.acquire().granted());
+}
+
+#endif  // !_WIN32
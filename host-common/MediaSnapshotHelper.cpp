@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "host-common/MediaSnapshotHelper.h"
+#include "aemu/base/system/System.h"
 #include "host-common/H264NaluParser.h"
 #include "host-common/VpxFrameParser.h"
 
@@ -32,14 +33,102 @@ namespace emulation {
 using PacketInfo = MediaSnapshotState::PacketInfo;
 using ColorAspects = MediaSnapshotState::ColorAspects;
 
+static MediaSnapshotHelper::Options optionsFromEnvironment() {
+    MediaSnapshotHelper::Options options;
+    options.saveReferenceFrame =
+            android::base::getEnvironmentVariable(
+                    "ANDROID_EMU_MEDIA_SNAPSHOT_FRAMES") == "1";
+    return options;
+}
+
+MediaSnapshotHelper::MediaSnapshotHelper(CodecType type)
+    : MediaSnapshotHelper(type, optionsFromEnvironment()) {}
+
 void MediaSnapshotHelper::savePacket(const uint8_t* frame,
                                      size_t szBytes,
-                                     uint64_t inputPts) {
+                                     uint64_t inputPts,
+                                     const H264NaluList* nalus) {
     if (mType == CodecType::H264) {
-        return saveH264Packet(frame, szBytes, inputPts);
+        saveH264Packet(frame, szBytes, inputPts,
+                       naluList(frame, szBytes, nalus));
+    } else if (mType == CodecType::HEVC) {
+        saveHEVCPacket(frame, szBytes, inputPts);
     } else {
-        return saveVPXPacket(frame, szBytes, inputPts);
+        saveVPXPacket(frame, szBytes, inputPts);
+    }
+    capPacketHistory();
+}
+
+const H264NaluList& MediaSnapshotHelper::naluList(const uint8_t* frame,
+                                                  size_t szBytes,
+                                                  const H264NaluList* nalus) {
+    if (nalus) {
+        return *nalus;
+    }
+    // Only the NALUs up to the first slice matter here.
+    mNalus.parse(frame, szBytes, true);
+    return mNalus;
+}
+
+bool MediaSnapshotHelper::isKeyFrame(const uint8_t* frame,
+                                     size_t szBytes,
+                                     const H264NaluList* nalus) {
+    if (mType == CodecType::H264) {
+        // The history restarts at an SPS, which usually carries the IDR
+        // along.
+        const H264NaluList& list = naluList(frame, szBytes, nalus);
+        return list.contains(H264NaluParser::H264NaluType::SPS) ||
+               list.contains(H264NaluParser::H264NaluType::CodedSliceIDR);
+    }
+    if (mType == CodecType::HEVC) {
+        mHevcNalus.parse(frame, szBytes, true);
+        return mHevcNalus.isKeyFrame();
+    }
+    return VpxFrameParser(mType == CodecType::VP8 ? 8 : 9, frame, szBytes)
+            .isKeyFrame();
+}
+
+void MediaSnapshotHelper::capPacketHistory() {
+    if (mHistoryTruncated ||
+        mSnapshotState.packetBytes() > mOptions.maxPacketHistoryBytes) {
+        SNAPSHOT_DPRINT("dropping %zu bytes of packet history",
+                        mSnapshotState.packetBytes());
+        mSnapshotState.clearPackets();
+        mHistoryTruncated = true;
+    }
+}
+
+bool MediaSnapshotHelper::repeatReferenceFrame(const uint8_t* frame,
+                                               size_t szBytes,
+                                               uint64_t inputPts,
+                                               const H264NaluList* nalus) {
+    if (!mAwaitingKeyFrame) {
+        return false;
+    }
+    if (isKeyFrame(frame, szBytes, nalus)) {
+        SNAPSHOT_DPRINT("key frame after loading a reference frame");
+        mAwaitingKeyFrame = false;
+        return false;
+    }
+    if (mType == CodecType::H264 &&
+        !naluList(frame, szBytes, nalus)
+                 .contains(H264NaluParser::H264NaluType::CodedSliceNonIDR)) {
+        // Parameter sets and such produce no picture; let the decoder have
+        // them.
+        return false;
     }
+    if (mType == CodecType::HEVC && !mHevcNalus.containsSlice()) {
+        // isKeyFrame() above parsed this packet.
+        return false;
+    }
+    const MediaSnapshotState::FrameInfo* reference =
+            mSnapshotState.referenceFrame();
+    if (reference) {
+        MediaSnapshotState::FrameInfo frameInfo = *reference;
+        frameInfo.pts = inputPts;
+        mSnapshotState.saveDecodedFrame(std::move(frameInfo));
+    }
+    return true;
 }
 
 void MediaSnapshotHelper::saveVPXPacket(const uint8_t* data,
@@ -55,7 +144,8 @@ void MediaSnapshotHelper::saveVPXPacket(const uint8_t* data,
         v.assign(data, data + len);
         bool isIFrame = fparser.isKeyFrame();
         if (isIFrame) {
-            mSnapshotState.savedPackets.clear();
+            mSnapshotState.clearPackets();
+            mHistoryTruncated = false;
         }
         const bool saveOK = mSnapshotState.savePacket(v, user_priv);
         if (saveOK) {
@@ -71,30 +161,36 @@ void MediaSnapshotHelper::saveVPXPacket(const uint8_t* data,
 
 void MediaSnapshotHelper::saveH264Packet(const uint8_t* frame,
                                          size_t szBytes,
-                                         uint64_t inputPts) {
+                                         uint64_t inputPts,
+                                         const H264NaluList& nalus) {
     const bool enableSnapshot = true;
     if (enableSnapshot) {
         std::vector<uint8_t> v;
         v.assign(frame, frame + szBytes);
-        bool hasSps = H264NaluParser::checkSpsFrame(frame, szBytes);
+        bool hasSps = nalus.contains(H264NaluParser::H264NaluType::SPS);
         if (hasSps) {
             SNAPSHOT_DPRINT("create new snapshot state");
             MediaSnapshotState newSnapshotState{};
             // we need to keep the frames, the guest might not have retrieved
             // them yet; otherwise, we might loose some frames
-            std::swap(newSnapshotState.savedFrames, mSnapshotState.savedFrames);
+            newSnapshotState.savedFrames.swap(mSnapshotState.savedFrames);
+            std::swap(newSnapshotState.mLastFrame, mSnapshotState.mLastFrame);
             std::swap(newSnapshotState, mSnapshotState);
             mSnapshotState.saveSps(v);
+            mHistoryTruncated = false;
         } else {
-            bool hasPps = H264NaluParser::checkPpsFrame(frame, szBytes);
+            bool hasPps = nalus.contains(H264NaluParser::H264NaluType::PPS);
             if (hasPps) {
                 mSnapshotState.savePps(v);
-                mSnapshotState.savedPackets.clear();
+                mSnapshotState.clearPackets();
                 mSnapshotState.savedDecodedFrame.data.clear();
+                mHistoryTruncated = false;
             } else {
-                bool isIFrame = H264NaluParser::checkIFrame(frame, szBytes);
+                bool isIFrame = nalus.contains(
+                        H264NaluParser::H264NaluType::CodedSliceIDR);
                 if (isIFrame) {
-                    mSnapshotState.savedPackets.clear();
+                    mSnapshotState.clearPackets();
+                    mHistoryTruncated = false;
                 }
                 mSnapshotState.savePacket(std::move(v), inputPts);
                 SNAPSHOT_DPRINT("saving packet; total is %d",
@@ -103,17 +199,56 @@ void MediaSnapshotHelper::saveH264Packet(const uint8_t* frame,
         }
     }
 }
+
+void MediaSnapshotHelper::saveHEVCPacket(const uint8_t* frame,
+                                         size_t szBytes,
+                                         uint64_t inputPts) {
+    mHevcNalus.parse(frame, szBytes, true);
+    std::vector<uint8_t> v(frame, frame + szBytes);
+    if (mHevcNalus.contains(HevcNaluType::VPS) ||
+        mHevcNalus.contains(HevcNaluType::SPS)) {
+        // HEVC encoders put VPS, SPS and PPS, and usually the IRAP picture,
+        // in one packet, so it is kept whole as the "SPS" and replay
+        // doesn't wait for a separate PPS.
+        SNAPSHOT_DPRINT("create new snapshot state");
+        MediaSnapshotState newSnapshotState{};
+        newSnapshotState.savedFrames.swap(mSnapshotState.savedFrames);
+        std::swap(newSnapshotState.mLastFrame, mSnapshotState.mLastFrame);
+        std::swap(newSnapshotState, mSnapshotState);
+        mSnapshotState.saveSps(v);
+        mHistoryTruncated = false;
+    } else if (mHevcNalus.contains(HevcNaluType::PPS) &&
+               !mHevcNalus.containsSlice()) {
+        mSnapshotState.savePps(v);
+        mSnapshotState.clearPackets();
+        mSnapshotState.savedDecodedFrame.data.clear();
+        mHistoryTruncated = false;
+    } else {
+        if (mHevcNalus.isKeyFrame()) {
+            mSnapshotState.clearPackets();
+            mHistoryTruncated = false;
+        }
+        mSnapshotState.savePacket(std::move(v), inputPts);
+    }
+}
+
 void MediaSnapshotHelper::save(base::Stream* stream) const {
     SNAPSHOT_DPRINT("saving packets now %d",
                     (int)(mSnapshotState.savedPackets.size()));
     if (mType == CodecType::H264) {
         stream->putBe32(264);
+    } else if (mType == CodecType::HEVC) {
+        stream->putBe32(265);
     } else if (mType == CodecType::VP8) {
         stream->putBe32(8);
     } else if (mType == CodecType::VP9) {
         stream->putBe32(9);
     }
-    mSnapshotState.save(stream);
+    // A truncated history can't rebuild the decoder, so the reference frame
+    // is all there is to save.
+    const bool saveReference =
+            mOptions.saveReferenceFrame || mHistoryTruncated;
+    mSnapshotState.save(stream, saveReference, mOptions.compressFrames);
 }
 
 void MediaSnapshotHelper::replay(
@@ -121,9 +256,12 @@ void MediaSnapshotHelper::replay(
                 oneShotDecode) {
     if (mSnapshotState.sps.size() > 0) {
         oneShotDecode(mSnapshotState.sps.data(), mSnapshotState.sps.size(), 0);
-        if (mSnapshotState.pps.size() > 0) {
-            oneShotDecode(mSnapshotState.pps.data(), mSnapshotState.pps.size(),
-                          0);
+        // An HEVC PPS normally came along with the SPS.
+        if (mSnapshotState.pps.size() > 0 || mType == CodecType::HEVC) {
+            if (mSnapshotState.pps.size() > 0) {
+                oneShotDecode(mSnapshotState.pps.data(),
+                              mSnapshotState.pps.size(), 0);
+            }
             for (int i = 0; i < mSnapshotState.savedPackets.size(); ++i) {
                 MediaSnapshotState::PacketInfo& pkt =
                         mSnapshotState.savedPackets[i];
@@ -142,6 +280,8 @@ void MediaSnapshotHelper::load(
     int type = stream->getBe32();
     if (type == 264) {
         mType = CodecType::H264;
+    } else if (type == 265) {
+        mType = CodecType::HEVC;
     } else if (type == 8) {
         mType = CodecType::VP8;
     } else if (type == 9) {
@@ -149,6 +289,9 @@ void MediaSnapshotHelper::load(
     }
 
     mSnapshotState.load(stream);
+    // Replays just the parameter sets then.
+    mHistoryTruncated = mSnapshotState.loadedReference();
+    mAwaitingKeyFrame = mSnapshotState.loadedReference();
 
     SNAPSHOT_DPRINT("loaded packets %d, now restore decoder",
                     (int)(mSnapshotState.savedPackets.size()));
@@ -13,6 +13,9 @@
 // limitations under the License.
 #include "host-common/MediaSnapshotState.h"
 
+#include "aemu/base/files/CompressingStream.h"
+#include "aemu/base/files/DecompressingStream.h"
+
 #include <stdio.h>
 #include <cassert>
 
@@ -35,7 +38,8 @@ bool MediaSnapshotState::savePacket(std::vector<uint8_t> data, uint64_t pts) {
     if (pts > 0 && savedPackets.size() > 0 && pts == savedPackets.back().pts) {
         return false;
     }
-    PacketInfo pkt{data, pts};
+    savedPacketBytes += data.size();
+    PacketInfo pkt{std::move(data), pts};
     savedPackets.push_back(std::move(pkt));
     return true;
 }
@@ -47,12 +51,13 @@ bool MediaSnapshotState::savePacket(const uint8_t* frame,
     }
     std::vector<uint8_t> vec;
     vec.assign(frame, frame + size);
-    PacketInfo pkt{vec, pts};
+    savedPacketBytes += size;
+    PacketInfo pkt{std::move(vec), pts};
     savedPackets.push_back(std::move(pkt));
     return true;
 }
 
-void MediaSnapshotState::saveDecodedFrame(std::vector<uint8_t> data,
+void MediaSnapshotState::saveDecodedFrame(MediaFrameBuffer data,
                                           int width,
                                           int height,
                                           uint64_t pts,
@@ -64,13 +69,21 @@ void MediaSnapshotState::saveDecodedFrame(std::vector<uint8_t> data,
     savedFrames.push_back(std::move(frame));
 }
 
+void MediaSnapshotState::saveDecodedFrame(const std::vector<uint8_t>& data,
+                                          int width,
+                                          int height,
+                                          uint64_t pts,
+                                          ColorAspects xcolor) {
+    saveDecodedFrame(MediaFrameBuffer(data), width, height, pts, xcolor);
+}
+
 void MediaSnapshotState::saveDecodedFrame(std::vector<uint32_t> texture,
                                           int width,
                                           int height,
                                           uint64_t pts,
                                           ColorAspects xcolor) {
     SNAPSTATE_DPRINT("save decoded texture");
-    FrameInfo frame{std::vector<uint8_t>{},
+    FrameInfo frame{MediaFrameBuffer{},
                     std::move(texture),
                     width,
                     height,
@@ -96,6 +109,24 @@ void loadVec(base::Stream* stream, std::vector<T>& vec) {
         stream->read(vec.data(), size * sizeof(vec[0]));
     }
 }
+
+// Same format as saveVec()/loadVec() on bytes.
+void saveVec(base::Stream* stream, const MediaFrameBuffer& buf) {
+    stream->putBe32(buf.size());
+    if (!buf.empty()) {
+        stream->write(buf.data(), buf.size());
+    }
+}
+
+void loadVec(base::Stream* stream, MediaFrameBuffer& buf) {
+    int size = stream->getBe32();
+    // Don't write into bytes another frame may share.
+    buf.clear();
+    buf.resize(size);
+    if (size > 0) {
+        stream->read(buf.data(), size);
+    }
+}
 }  // namespace
 
 void MediaSnapshotState::saveFrameInfo(base::Stream* stream,
@@ -150,30 +181,34 @@ void MediaSnapshotState::loadColor(base::Stream* stream,
     color.space = stream->getBe32();
 }
 
-void MediaSnapshotState::save(base::Stream* stream) const {
-    saveVec(stream, sps);
-    saveVec(stream, pps);
-    stream->putBe32(savedPackets.size());
-    for (size_t i = 0; i < savedPackets.size(); ++i) {
-        savePacketInfo(stream, savedPackets[i]);
+const MediaSnapshotState::FrameInfo* MediaSnapshotState::referenceFrame()
+        const {
+    for (size_t i = savedFrames.size(); i > 0; --i) {
+        if (!savedFrames[i - 1].data.empty()) {
+            return &savedFrames[i - 1];
+        }
     }
+    return mLastFrame.data.empty() ? nullptr : &mLastFrame;
+}
+
+void MediaSnapshotState::saveFrames(base::Stream* stream,
+                                    bool saveReference) const {
     stream->putBe32(savedFrames.size());
     SNAPSTATE_DPRINT("save now ");
-    for (auto iter = savedFrames.begin(); iter != savedFrames.end(); ++iter) {
+    savedFrames.forEach([this, stream](const FrameInfo& frame) {
         SNAPSTATE_DPRINT("save now ");
-        saveFrameInfo(stream, *iter);
+        saveFrameInfo(stream, frame);
+    });
+    if (saveReference) {
+        const FrameInfo* reference = referenceFrame();
+        stream->putBe32(reference ? 1 : 0);
+        if (reference) {
+            saveFrameInfo(stream, *reference);
+        }
     }
-    // saveFrameInfo(stream, savedDecodedFrame);
 }
 
-void MediaSnapshotState::load(base::Stream* stream) {
-    loadVec(stream, sps);
-    loadVec(stream, pps);
-    int count = stream->getBe32();
-    savedPackets.resize(count);
-    for (int i = 0; i < count; ++i) {
-        loadPacketInfo(stream, savedPackets[i]);
-    }
+void MediaSnapshotState::loadFrames(base::Stream* stream, bool loadReference) {
     int fcount = stream->getBe32();
     SNAPSTATE_DPRINT("load now ");
     for (int i = 0; i < fcount; ++i) {
@@ -181,6 +216,59 @@ void MediaSnapshotState::load(base::Stream* stream) {
         loadFrameInfo(stream, savedDecodedFrame);
         savedFrames.push_back(std::move(savedDecodedFrame));
     }
+    mLastFrame = FrameInfo{};
+    if (loadReference && stream->getBe32()) {
+        loadFrameInfo(stream, mLastFrame);
+    }
+}
+
+void MediaSnapshotState::save(base::Stream* stream,
+                              bool saveReference,
+                              bool compressFrames) const {
+    saveVec(stream, sps);
+    saveVec(stream, pps);
+    stream->putBe32(saveReference ? 1 : 0);
+    if (!saveReference) {
+        stream->putBe32(savedPackets.size());
+        for (size_t i = 0; i < savedPackets.size(); ++i) {
+            savePacketInfo(stream, savedPackets[i]);
+        }
+    }
+    // Packets are compressed already, but raw frames are a few MB each.
+    stream->putBe32(compressFrames ? 1 : 0);
+    if (compressFrames) {
+        base::CompressingStream::BlockOptions options;
+        options.codec =
+                base::CodecOptions::forPayload(base::PayloadClass::Texture);
+        options.checksums = true;
+        base::CompressingStream compressed(*stream, options);
+        saveFrames(&compressed, saveReference);
+    } else {
+        saveFrames(stream, saveReference);
+    }
+    // saveFrameInfo(stream, savedDecodedFrame);
+}
+
+void MediaSnapshotState::load(base::Stream* stream) {
+    loadVec(stream, sps);
+    loadVec(stream, pps);
+    mLoadedReference = stream->getBe32() != 0;
+    clearPackets();
+    if (!mLoadedReference) {
+        int count = stream->getBe32();
+        savedPackets.resize(count);
+        for (int i = 0; i < count; ++i) {
+            loadPacketInfo(stream, savedPackets[i]);
+            savedPacketBytes += savedPackets[i].data.size();
+        }
+    }
+    if (stream->getBe32()) {
+        base::DecompressingStream compressed(
+                *stream, base::DecompressingStream::BlockOptions{});
+        loadFrames(&compressed, mLoadedReference);
+    } else {
+        loadFrames(stream, mLoadedReference);
+    }
 }
 
 }  // namespace emulation
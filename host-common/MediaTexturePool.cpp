@@ -35,7 +35,16 @@ namespace android {
 namespace emulation {
 
 static int s_texturePoolId = 0;
-MediaTexturePool::MediaTexturePool() {
+MediaTexturePool::MediaTexturePool()
+    : mTrimmer("media.texture_pool", base::TrimCost::kCheap, 0,
+               [this](base::MemoryPressureLevel level) {
+                   int requested = mRequestedTrim.load();
+                   while (requested < int(level) &&
+                          !mRequestedTrim.compare_exchange_weak(requested,
+                                                                int(level))) {
+                   }
+                   return uint64_t(0);
+               }) {
     mVirtioGpuOps = android_getVirtioGpuOps();
     if (mVirtioGpuOps == nullptr) {
         H264_DPRINT("Error, cannot get mVirtioGpuOps");
@@ -59,12 +68,15 @@ constexpr uint32_t kFRAMEWORK_FORMAT_NV12 = 3;
 MediaTexturePool::TextureFrame MediaTexturePool::getTextureFrame(int w, int h) {
     H264_DPRINT("calling %s %d for tex of w %d h %d\n", __func__, __LINE__, w,
                 h);
-    PoolHandle ph = m_WH_to_PoolHandle[TexSizes{w, h}];
-    if (ph == nullptr) {
-        ph = new Pool;
-        m_WH_to_PoolHandle[TexSizes{w, h}] = ph;
-    }
-    if (ph->empty()) {
+    applyRequestedTrim();
+    const uint64_t key = sizeKey(w, h);
+    SizeClass& sizeClass = mSizeClasses[key];
+    sizeClass.width = w;
+    sizeClass.height = h;
+    sizeClass.lastUsed = ++mClock;
+    mCurrentSize = key;
+    if (sizeClass.free.empty()) {
+        ++mStats.misses;
         std::vector<uint32_t> textures(2 * kFRAME_POOL_SIZE);
         mVirtioGpuOps->create_yuv_textures(kFRAMEWORK_FORMAT_NV12,
                                            kFRAME_POOL_SIZE, w, h,
@@ -72,12 +84,17 @@ MediaTexturePool::TextureFrame MediaTexturePool::getTextureFrame(int w, int h) {
         for (uint32_t i = 0; i < kFRAME_POOL_SIZE; ++i) {
             TextureFrame frame{textures[2 * i], textures[2 * i + 1]};
             H264_DPRINT("allocated Y %d UV %d", frame.Ytex, frame.UVtex);
-            m_Frame_to_PoolHandle[TexFrame{frame.Ytex, frame.UVtex}] = ph;
-            ph->push_back(frame);
+            mFrameToSize[frameKey(frame)] = key;
+            sizeClass.free.push_back(frame);
         }
+        sizeClass.frames += kFRAME_POOL_SIZE;
+        mStats.bytes += kFRAME_POOL_SIZE * frameBytes(sizeClass);
+        trimToBudget(key);
+    } else {
+        ++mStats.hits;
     }
-    TextureFrame frame = ph->front();
-    ph->pop_front();
+    TextureFrame frame = sizeClass.free.back();
+    sizeClass.free.pop_back();
     H264_DPRINT("done %s %d ret Y %d UV %d", __func__, __LINE__, frame.Ytex,
                 frame.UVtex);
     return frame;
@@ -99,46 +116,125 @@ void MediaTexturePool::putTextureFrame(TextureFrame frame) {
     H264_DPRINT("try recycle textures %d %d", (int)frame.Ytex,
                 (int)frame.UVtex);
     if (frame.Ytex > 0 && frame.UVtex > 0) {
-        TexFrame tframe{frame.Ytex, frame.UVtex};
-        auto iter = m_Frame_to_PoolHandle.find(tframe);
-        if (iter != m_Frame_to_PoolHandle.end()) {
-            PoolHandle phandle = iter->second;
+        auto iter = mFrameToSize.find(frameKey(frame));
+        if (iter != mFrameToSize.end()) {
             H264_DPRINT("recycle registered textures %d %d", (int)frame.Ytex,
                         (int)frame.UVtex);
-            phandle->push_back(std::move(frame));
+            const uint64_t key = iter->second;
+            mSizeClasses[key].free.push_back(frame);
+            if (mStats.bytes > mBudget) {
+                trimToBudget(mCurrentSize);
+            }
         } else {
             H264_DPRINT("recycle un-registered textures %d %d", (int)frame.Ytex,
                         (int)frame.UVtex);
             deleteTextures(frame);
         }
     }
+    applyRequestedTrim();
 }
 
 void MediaTexturePool::deleteTextures(TextureFrame frame) {
-    if (mVirtioGpuOps && frame.Ytex > 0 && frame.UVtex > 0) {
-        std::vector<uint32_t> textures;
-        textures.push_back(frame.Ytex);
-        textures.push_back(frame.UVtex);
-        mVirtioGpuOps->destroy_yuv_textures(kFRAMEWORK_FORMAT_NV12, 1,
-                                            textures.data());
+    if (frame.Ytex > 0 && frame.UVtex > 0) {
+        const uint32_t textures[2] = {frame.Ytex, frame.UVtex};
+        destroyTextures(textures, 1);
     }
 }
 
-void MediaTexturePool::cleanUpTextures() {
-    if (m_WH_to_PoolHandle.empty()) {
+void MediaTexturePool::destroyTextures(const uint32_t* textures,
+                                       size_t frameCount) {
+    if (mReleaseHook) {
+        mReleaseHook(textures, 2 * frameCount);
+    }
+    if (mVirtioGpuOps) {
+        mVirtioGpuOps->destroy_yuv_textures(kFRAMEWORK_FORMAT_NV12, frameCount,
+                                            const_cast<uint32_t*>(textures));
+    }
+}
+
+void MediaTexturePool::releaseFreeFrames(uint64_t key) {
+    auto iter = mSizeClasses.find(key);
+    if (iter == mSizeClasses.end()) {
         return;
     }
-    for (auto iter : m_WH_to_PoolHandle) {
-        auto& myFramePool = *(iter.second);
+    SizeClass& sizeClass = iter->second;
+    if (!sizeClass.free.empty()) {
         std::vector<uint32_t> textures;
-        for (auto& frame : myFramePool) {
+        textures.reserve(2 * sizeClass.free.size());
+        for (const TextureFrame& frame : sizeClass.free) {
             textures.push_back(frame.Ytex);
             textures.push_back(frame.UVtex);
+            mFrameToSize.erase(frameKey(frame));
             H264_DPRINT("delete Y %d UV %d", frame.Ytex, frame.UVtex);
         }
-        mVirtioGpuOps->destroy_yuv_textures(
-                kFRAMEWORK_FORMAT_NV12, myFramePool.size(), textures.data());
-        myFramePool.clear();
+        destroyTextures(textures.data(), sizeClass.free.size());
+        sizeClass.frames -= sizeClass.free.size();
+        mStats.bytes -= sizeClass.free.size() * frameBytes(sizeClass);
+        sizeClass.free.clear();
+    }
+    if (sizeClass.frames == 0) {
+        mSizeClasses.erase(iter);
+    }
+}
+
+void MediaTexturePool::trimToBudget(uint64_t keep) {
+    while (mStats.bytes > mBudget) {
+        // There are only ever a handful of sizes, so a scan is fine.
+        auto victim = mSizeClasses.end();
+        for (auto iter = mSizeClasses.begin(); iter != mSizeClasses.end();
+             ++iter) {
+            if (iter->first == keep || iter->second.free.empty()) {
+                continue;
+            }
+            if (victim == mSizeClasses.end() ||
+                iter->second.lastUsed < victim->second.lastUsed) {
+                victim = iter;
+            }
+        }
+        if (victim == mSizeClasses.end()) {
+            return;
+        }
+        H264_DPRINT("evicting %d free frames of w %d h %d",
+                    (int)victim->second.free.size(), victim->second.width,
+                    victim->second.height);
+        mStats.evictions += victim->second.free.size();
+        releaseFreeFrames(victim->first);
+    }
+}
+
+void MediaTexturePool::applyRequestedTrim() {
+    const int level = mRequestedTrim.exchange(0);
+    if (level == int(base::MemoryPressureLevel::kNone)) {
+        return;
+    }
+    const size_t bytes = mStats.bytes;
+    std::vector<uint64_t> keys;
+    for (const auto& kv : mSizeClasses) {
+        if (level == int(base::MemoryPressureLevel::kCritical) ||
+            kv.first != mCurrentSize) {
+            keys.push_back(kv.first);
+            mStats.evictions += kv.second.free.size();
+        }
+    }
+    for (uint64_t key : keys) {
+        releaseFreeFrames(key);
+    }
+    base::MemoryTrimmer::reportReclaimed(bytes - mStats.bytes);
+}
+
+void MediaTexturePool::setMemoryBudget(size_t bytes) {
+    mBudget = bytes;
+    trimToBudget(mCurrentSize);
+}
+
+void MediaTexturePool::cleanUpTextures() {
+    std::vector<uint64_t> keys;
+    keys.reserve(mSizeClasses.size());
+    for (const auto& kv : mSizeClasses) {
+        keys.push_back(kv.first);
+    }
+    for (uint64_t key : keys) {
+        releaseFreeFrames(key);
     }
 }
 
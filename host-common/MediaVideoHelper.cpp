@@ -40,5 +40,14 @@ bool MediaVideoHelper::receiveFrame(FrameInfo* pFrameInfo) {
     return true;
 }
 
+MediaFrameBuffer MediaVideoHelper::takeOutputBuffer(size_t size) {
+    if (!mOutputBuffer || size > mOutputBufferSize) {
+        return MediaFrameBuffer();
+    }
+    MediaFrameBuffer buf = MediaFrameBuffer::wrap(mOutputBuffer, size);
+    setOutputBuffer(nullptr, 0);
+    return buf;
+}
+
 }  // namespace emulation
 }  // namespace android
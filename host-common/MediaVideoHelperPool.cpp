@@ -0,0 +1,140 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/MediaVideoHelperPool.h"
+
+#include "aemu/base/Metrics.h"
+#include "aemu/base/system/System.h"
+
+#include <algorithm>
+
+namespace android {
+namespace emulation {
+
+using base::AutoLock;
+
+// static
+MediaVideoHelperPool& MediaVideoHelperPool::get() {
+    // Leaked: decoders may still release helpers during static destruction.
+    static MediaVideoHelperPool* const sInstance = new MediaVideoHelperPool();
+    return *sInstance;
+}
+
+// static
+int MediaVideoHelperPool::resolutionClass(int width, int height) {
+    const int64_t area = int64_t(width) * height;
+    if (area <= 1280 * 720) {
+        return 0;
+    }
+    if (area <= 1920 * 1088) {
+        return 1;
+    }
+    return 2;
+}
+
+std::unique_ptr<MediaVideoHelper> MediaVideoHelperPool::acquire(
+        const Key& key,
+        const std::function<MediaVideoHelper*()>& create) {
+    const uint64_t startUs = base::getHighResTimeUs();
+    std::unique_ptr<MediaVideoHelper> helper;
+    {
+        AutoLock lock(mLock);
+        auto iter = mIdle.find(key);
+        if (iter != mIdle.end() && !iter->second.empty()) {
+            helper = std::move(iter->second.back());
+            iter->second.pop_back();
+            --mIdleCount;
+        }
+    }
+    const bool hit = helper != nullptr;
+    if (!hit) {
+        // Outside the lock: this is the slow part we are trying to avoid.
+        helper.reset(create());
+    }
+    const int64_t elapsedUs = base::getHighResTimeUs() - startUs;
+
+    bool report = false;
+    {
+        AutoLock lock(mLock);
+        if (hit) {
+            ++mStats.hits;
+        } else {
+            ++mStats.misses;
+        }
+        mStats.maxStartupUs = std::max(mStats.maxStartupUs, elapsedUs);
+        report = (mStats.hits + mStats.misses) % kReportInterval == 0;
+    }
+    if (report) {
+        reportMetrics(base::CreateMetricsLogger().get());
+    }
+    return helper;
+}
+
+void MediaVideoHelperPool::release(const Key& key,
+                                   std::unique_ptr<MediaVideoHelper> helper) {
+    if (!helper) {
+        return;
+    }
+    if (helper->good() && !helper->fatal() && helper->resetForReuse()) {
+        AutoLock lock(mLock);
+        auto& idle = mIdle[key];
+        if (idle.size() < kMaxIdlePerKey && mIdleCount < kMaxIdle) {
+            idle.push_back(std::move(helper));
+            ++mIdleCount;
+            return;
+        }
+    }
+    helper->deInit();
+}
+
+void MediaVideoHelperPool::clear() {
+    std::map<Key, std::vector<std::unique_ptr<MediaVideoHelper>>> idle;
+    {
+        AutoLock lock(mLock);
+        idle.swap(mIdle);
+        mIdleCount = 0;
+    }
+    for (auto& kv : idle) {
+        for (auto& helper : kv.second) {
+            helper->deInit();
+        }
+    }
+}
+
+MediaVideoHelperPool::Stats MediaVideoHelperPool::stats() const {
+    AutoLock lock(mLock);
+    return mStats;
+}
+
+size_t MediaVideoHelperPool::idleCount() const {
+    AutoLock lock(mLock);
+    return mIdleCount;
+}
+
+void MediaVideoHelperPool::reportMetrics(base::MetricsLogger* logger) {
+    base::MetricEventMediaDecoderPoolStats event = {};
+    {
+        AutoLock lock(mLock);
+        event.hits = mStats.hits;
+        event.misses = mStats.misses;
+        event.maxStartupUs = mStats.maxStartupUs;
+        mStats = Stats();
+    }
+    if (logger) {
+        logger->logMetricEvent(event);
+    }
+}
+
+}  // namespace emulation
+}  // namespace android
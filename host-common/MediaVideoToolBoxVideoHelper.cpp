@@ -14,9 +14,11 @@
 
 #include "host-common/MediaVideoToolBoxUtils.h"
 #include "host-common/MediaVideoToolBoxVideoHelper.h"
-#include "host-common/YuvConverter.h"
+#include "host-common/YuvKernels.h"
 #include "android/utils/debug.h"
 
+#include <algorithm>
+
 #define MEDIA_VTB_DEBUG 0
 
 #if MEDIA_VTB_DEBUG
@@ -55,6 +57,12 @@ void MediaVideoToolBoxVideoHelper::deInit() {
 
     resetDecoderSession();
 
+    // Frames still waiting are dropped without being converted.
+    for (auto& iter : mVtbBufferMap) {
+        CVPixelBufferRelease(iter.second);
+    }
+    mVtbBufferMap.clear();
+
     resetFormatDesc();
 
     mVtbReady = false;
@@ -191,7 +199,7 @@ void MediaVideoToolBoxVideoHelper::decode(const uint8_t* frame,
 void MediaVideoToolBoxVideoHelper::flush() {
     VTB_DPRINT("started flushing");
     for (auto& iter : mVtbBufferMap) {
-        mSavedDecodedFrames.push_back(std::move(iter.second));
+        emitFrame(iter.second, iter.first.first);
     }
     mVtbBufferMap.clear();
     VTB_DPRINT("done one flushing");
@@ -338,29 +346,29 @@ void MediaVideoToolBoxVideoHelper::videoToolboxDecompressCallback(
     VTB_DPRINT("%s", __func__);
     auto ptr = static_cast<MediaVideoToolBoxVideoHelper*>(opaque);
 
-    // if (ptr->mDecodedFrame) {
-    //     CVPixelBufferRelease(ptr->mDecodedFrame);
-    //     ptr->mDecodedFrame = nullptr;
-    // }
-
     if (!image_buffer) {
         VTB_DPRINT("%s: output image buffer is null", __func__);
         ptr->mIsGood = false;
         return;
     }
 
+    // Keep the decoder's IOSurface until the frame is due; it is only
+    // converted once it leaves the reorder buffer.
     ptr->mOutputPts = pts.value;
-    ptr->mDecodedFrame = CVPixelBufferRetain(image_buffer);
-    CVOpenGLTextureCacheRef _CVGLTextureCache;
-    CVOpenGLTextureRef _CVGLTexture;
-    CGLPixelFormatObj _CGLPixelFormat;
-
-    // Image is ready to be comsumed
-    ptr->copyFrame();
+    CVPixelBufferRef& pending =
+            ptr->mVtbBufferMap[std::make_pair(ptr->mOutputPts, ptr->mTotalFrames)];
+    if (pending) {
+        CVPixelBufferRelease(pending);
+    }
+    pending = CVPixelBufferRetain(image_buffer);
     ptr->mImageReady = true;
     VTB_DPRINT("Got decoded frame");
-    CVPixelBufferRelease(ptr->mDecodedFrame);
-    ptr->mDecodedFrame = nullptr;
+
+    if (ptr->mVtbBufferMap.size() > ptr->mVtbBufferSize) {
+        auto oldest = ptr->mVtbBufferMap.begin();
+        ptr->emitFrame(oldest->second, oldest->first.first);
+        ptr->mVtbBufferMap.erase(oldest);
+    }
 }
 
 // static
@@ -457,10 +465,6 @@ void MediaVideoToolBoxVideoHelper::resetDecoderSession() {
         CFRelease(mDecoderSession);
         mDecoderSession = nullptr;
     }
-    if (mDecodedFrame) {
-        CVPixelBufferRelease(mDecodedFrame);
-        mDecodedFrame = nullptr;
-    }
 }
 
 void MediaVideoToolBoxVideoHelper::getOutputWH() {
@@ -579,17 +583,17 @@ void MediaVideoToolBoxVideoHelper::recreateDecompressionSession() {
     }
 }
 
-void MediaVideoToolBoxVideoHelper::copyFrameToTextures() {
-    // TODO
+void MediaVideoToolBoxVideoHelper::copyFrameToTextures(CVPixelBufferRef buffer) {
     auto startTime = std::chrono::steady_clock::now();
-    TextureFrame texFrame;
-    if (mUseGpuTexture && mTexturePool != nullptr) {
+    TextureFrame texFrame{0, 0};
+    if (mTexturePool != nullptr) {
+        // The IOSurface goes to the textures on the GPU; its pixels never
+        // come through CPU memory.
         VTB_DPRINT("decoded surface is %p w %d h %d",
-                   CVPixelBufferGetIOSurface(mDecodedFrame), mOutputWidth,
+                   CVPixelBufferGetIOSurface(buffer), mOutputWidth,
                    mOutputHeight);
         auto my_copy_context = media_vtb_utils_copy_context{
-                CVPixelBufferGetIOSurface(mDecodedFrame), mOutputWidth,
-                mOutputHeight};
+                CVPixelBufferGetIOSurface(buffer), mOutputWidth, mOutputHeight};
         texFrame = mTexturePool->getTextureFrame(mOutputWidth, mOutputHeight);
         VTB_DPRINT("ask videocore to copy to %d and %d", texFrame.Ytex,
                    texFrame.UVtex);
@@ -602,39 +606,41 @@ void MediaVideoToolBoxVideoHelper::copyFrameToTextures() {
             std::chrono::steady_clock::now() - startTime);
     VTB_DPRINT("used %d ms", (int)elapsed.count());
 
-    auto ptspair = std::make_pair(mOutputPts, mTotalFrames);
-    mVtbBufferMap[ptspair] = MediaSnapshotState::FrameInfo{
-            std::vector<uint8_t>(),
+    mSavedDecodedFrames.push_back(MediaSnapshotState::FrameInfo{
+            MediaFrameBuffer(),
             std::vector<uint32_t>{texFrame.Ytex, texFrame.UVtex},
             (int)mOutputWidth,
             (int)mOutputHeight,
             (uint64_t)(mOutputPts),
-            ColorAspects{mColorAspects}};
+            ColorAspects{mColorAspects}});
 }
 
-void MediaVideoToolBoxVideoHelper::copyFrameToCPU() {
-    int imageSize = CVPixelBufferGetDataSize(mDecodedFrame);
-    int stride = CVPixelBufferGetBytesPerRow(mDecodedFrame);
+void MediaVideoToolBoxVideoHelper::copyFrameToCPU(CVPixelBufferRef buffer) {
+    int imageSize = CVPixelBufferGetDataSize(buffer);
+    int stride = CVPixelBufferGetBytesPerRow(buffer);
 
     mOutBufferSize = mOutputWidth * mOutputHeight * 3 / 2;
 
     VTB_DPRINT("copying size=%d dimension=[%dx%d] stride=%d", imageSize,
                mOutputWidth, mOutputHeight, stride);
 
-    // Copies the image data to the guest.
-    mSavedDecodedFrame.resize(mOutputWidth * mOutputHeight * 3 / 2);
-    uint8_t* dst = mSavedDecodedFrame.data();
+    // Copies the image data to the guest, straight into its buffer when it
+    // offered one.
+    MediaFrameBuffer frame = takeOutputBuffer(mOutBufferSize);
+    if (frame.empty()) {
+        frame = MediaFrameBuffer(mOutBufferSize);
+    }
+    uint8_t* dst = frame.data();
 
-    CVPixelBufferLockBaseAddress(mDecodedFrame, kCVPixelBufferLock_ReadOnly);
-    if (CVPixelBufferIsPlanar(mDecodedFrame)) {
+    CVPixelBufferLockBaseAddress(buffer, kCVPixelBufferLock_ReadOnly);
+    if (CVPixelBufferIsPlanar(buffer)) {
         imageSize = 0;  // add up the size from the planes
-        int planes = CVPixelBufferGetPlaneCount(mDecodedFrame);
+        int planes = CVPixelBufferGetPlaneCount(buffer);
         for (int i = 0; i < planes; ++i) {
-            void* planeData =
-                    CVPixelBufferGetBaseAddressOfPlane(mDecodedFrame, i);
-            int linesize = CVPixelBufferGetBytesPerRowOfPlane(mDecodedFrame, i);
-            int planeWidth = CVPixelBufferGetWidthOfPlane(mDecodedFrame, i);
-            int planeHeight = CVPixelBufferGetHeightOfPlane(mDecodedFrame, i);
+            void* planeData = CVPixelBufferGetBaseAddressOfPlane(buffer, i);
+            int linesize = CVPixelBufferGetBytesPerRowOfPlane(buffer, i);
+            int planeWidth = CVPixelBufferGetWidthOfPlane(buffer, i);
+            int planeHeight = CVPixelBufferGetHeightOfPlane(buffer, i);
             VTB_DPRINT("plane=%d data=%p linesize=%d pwidth=%d pheight=%d", i,
                        planeData, linesize, planeWidth, planeHeight);
             // For kCVPixelFormatType_420YpCbCr8Planar, plane 0 is Y, UV planes
@@ -643,26 +649,19 @@ void MediaVideoToolBoxVideoHelper::copyFrameToCPU() {
                 VTB_DPRINT("ERROR: Unable to determine YUV420 plane type");
                 continue;
             }
+            const int sz = planeHeight * planeWidth;
+            if (imageSize + sz > mOutBufferSize) {
+                VTB_DPRINT("ERROR: planes larger than guestSz");
+                break;
+            }
 
             // Sometimes the buffer stride can be longer than the actual data
             // width. This means that the extra bytes are just padding and need
             // to be discarded.
-            if (linesize <= planeWidth) {
-                int sz = planeHeight * planeWidth;
-                imageSize += sz;
-                memcpy(dst, planeData, sz);
-                dst += sz;
-            } else {
-                // Need to copy line by line
-                int sz = planeWidth;
-                for (int j = 0; j < planeHeight; ++j) {
-                    uint8_t* ptr = (uint8_t*)planeData;
-                    ptr += linesize * j;
-                    memcpy(dst, ptr, sz);
-                    imageSize += sz;
-                    dst += sz;
-                }
-            }
+            yuvCopyPlane(planeData, std::max(linesize, planeWidth), dst,
+                         planeWidth, planeWidth, planeHeight);
+            imageSize += sz;
+            dst += sz;
         }
         if (imageSize != mOutBufferSize) {
             VTB_DPRINT(
@@ -679,35 +678,34 @@ void MediaVideoToolBoxVideoHelper::copyFrameToCPU() {
             imageSize = mOutBufferSize;
         }
 
-        // IMPORTANT: mDecodedFrame must be locked before accessing the contents
+        // IMPORTANT: buffer must be locked before accessing the contents
         // with CPU
-        void* data = CVPixelBufferGetBaseAddress(mDecodedFrame);
+        void* data = CVPixelBufferGetBaseAddress(buffer);
         memcpy(dst, data, imageSize);
     }
-    CVPixelBufferUnlockBaseAddress(mDecodedFrame, kCVPixelBufferLock_ReadOnly);
+    CVPixelBufferUnlockBaseAddress(buffer, kCVPixelBufferLock_ReadOnly);
 
-    auto ptspair = std::make_pair(mOutputPts, mTotalFrames);
-    mVtbBufferMap[ptspair] = MediaSnapshotState::FrameInfo{
-            std::vector<uint8_t>(), std::vector<uint32_t>{},
-            (int)mOutputWidth,      (int)mOutputHeight,
-            (uint64_t)(mOutputPts), ColorAspects{mColorAspects}};
-    mVtbBufferMap[ptspair].data.swap(mSavedDecodedFrame);
+    mSavedDecodedFrames.push_back(MediaSnapshotState::FrameInfo{
+            std::move(frame), std::vector<uint32_t>{},
+            (int)mOutputWidth, (int)mOutputHeight,
+            (uint64_t)(mOutputPts), ColorAspects{mColorAspects}});
 }
 
-void MediaVideoToolBoxVideoHelper::copyFrame() {
-    mOutputWidth = CVPixelBufferGetWidth(mDecodedFrame);
-    mOutputHeight = CVPixelBufferGetHeight(mDecodedFrame);
-
-    if (mUseGpuTexture) {
-        copyFrameToTextures();
-    } else {
-        copyFrameToCPU();
-    }
-
-    if (mVtbBufferMap.size() > mVtbBufferSize) {
-        mSavedDecodedFrames.push_back(std::move(mVtbBufferMap.begin()->second));
-        mVtbBufferMap.erase(mVtbBufferMap.begin());
+void MediaVideoToolBoxVideoHelper::emitFrame(CVPixelBufferRef buffer,
+                                             uint64_t pts) {
+    mOutputWidth = CVPixelBufferGetWidth(buffer);
+    mOutputHeight = CVPixelBufferGetHeight(buffer);
+    mOutputPts = pts;
+
+    // Frames nobody will look at are never converted.
+    if (!mIgnoreDecoderOutput) {
+        if (mUseGpuTexture) {
+            copyFrameToTextures(buffer);
+        } else {
+            copyFrameToCPU(buffer);
+        }
     }
+    CVPixelBufferRelease(buffer);
 }
 
 }  // namespace emulation
@@ -13,6 +13,7 @@
 // limitations under the License.
 #include "host-common/MediaVpxDecoderGeneric.h"
 #include "aemu/base/system/System.h"
+#include "host-common/MediaDecoderCapabilityCache.h"
 #include "host-common/MediaFfmpegVideoHelper.h"
 #include "host-common/MediaVpxVideoHelper.h"
 #include "host-common/VpxFrameParser.h"
@@ -50,6 +51,11 @@ namespace {
 
 static bool s_cuvid_good = true;
 
+#ifndef __APPLE__
+// A cuvid VPX session that failed fatally stays off on later launches until
+// the driver changes.
+constexpr char kCuvidVpxCapability[] = "cuvid-vpx";
+
 static bool cudaVpxAllowed() {
     static std::once_flag once_flag;
     static bool s_cuda_vpx_allowed = false;
@@ -58,12 +64,17 @@ static bool cudaVpxAllowed() {
         {
             s_cuda_vpx_allowed =
                     android::base::System::getEnvironmentVariable(
-                            "ANDROID_EMU_MEDIA_DECODER_CUDA_VPX") == "1";
+                            "ANDROID_EMU_MEDIA_DECODER_CUDA_VPX") == "1" &&
+                    MediaDecoderCapabilityCache::get()
+                                    .lookup(kCuvidVpxCapability,
+                                            MediaCudaDriverHelper::driverFingerprint())
+                                    .value_or(true);
         }
     });
 
     return s_cuda_vpx_allowed && s_cuvid_good;
 }
+#endif
 
 bool canUseCudaDecoder() {
     // TODO: implement a whitelist for
@@ -115,7 +126,12 @@ void MediaVpxDecoderGeneric::initVpxContext(void* ptr) {
     VPX_DPRINT("calling init context");
 
 #ifndef __APPLE__
+    // VP8/VP9 streams take a hardware session only here; one that isn't
+    // granted decodes in software for the rest of the stream.
     if (canUseCudaDecoder() && mParser.version() >= 200) {
+        mHwSession = MediaHwSessionArbiter::get().acquire();
+    }
+    if (mHwSession.granted()) {
         MediaCudaVideoHelper::OutputTreatmentMode oMode =
                 MediaCudaVideoHelper::OutputTreatmentMode::SAVE_RESULT;
 
@@ -136,6 +152,7 @@ void MediaVpxDecoderGeneric::initVpxContext(void* ptr) {
         mHwVideoHelper.reset(cudavid);
         if (!mHwVideoHelper->init()) {
             mHwVideoHelper.reset(nullptr);
+            mHwSession.release();
         }
     }
 #endif
@@ -171,6 +188,13 @@ void MediaVpxDecoderGeneric::decodeFrame(void* ptr) {
     const uint8_t* data = param.p_data;
     unsigned int len = param.size;
 
+    // After loading a snapshot without packet history there is nothing to
+    // predict from until the next key frame.
+    if (mSnapshotHelper.repeatReferenceFrame(data, len, param.user_priv)) {
+        VPX_DPRINT("repeated the reference frame");
+        return;
+    }
+
     mSnapshotHelper.savePacket(data, len, param.user_priv);
     VPX_DPRINT("calling vpx_codec_decode data %p datalen %d userdata %" PRIx64,
                data, (int)len, param.user_priv);
@@ -213,8 +237,14 @@ void MediaVpxDecoderGeneric::try_decode(const uint8_t* data,
             mUseGpuTexture = false;
             if (mHwVideoHelper->fatal()) {
                 s_cuvid_good = false;
+#ifndef __APPLE__
+                MediaDecoderCapabilityCache::get().store(
+                        kCuvidVpxCapability,
+                        MediaCudaDriverHelper::driverFingerprint(), false);
+#endif
             }
             mHwVideoHelper.reset(nullptr);
+            mHwSession.release();
         }
     }
     // just use libvpx, it is better quality in general
@@ -283,9 +313,10 @@ void MediaVpxDecoderGeneric::getImage(void* ptr) {
             VPX_DPRINT(
                     "calling rendering to host side color buffer with id %d",
                     param.hostColorBufferId);
-            mRenderer.renderToHostColorBuffer(param.hostColorBufferId,
-                                              pFrame->width, pFrame->height,
-                                              pFrame->data.data());
+            mRenderer.renderToHostColorBufferAsync(
+                    param.hostColorBufferId, pFrame->width, pFrame->height,
+                    pFrame->data.data(),
+                    pFrame->width * pFrame->height * 3 / 2);
         }
     } else {
         memcpy(param.p_dst, pFrame->data.data(),
@@ -311,6 +342,7 @@ void MediaVpxDecoderGeneric::destroyVpxContext(void* ptr) {
         mVideoHelper->deInit();
         mVideoHelper.reset(nullptr);
     }
+    mHwSession.release();
 }
 
 void MediaVpxDecoderGeneric::save(base::Stream* stream) const {
@@ -13,7 +13,7 @@
 // limitations under the License.
 
 #include "host-common/MediaVpxVideoHelper.h"
-#include "host-common/YuvConverter.h"
+#include "host-common/YuvKernels.h"
 #include "android/utils/debug.h"
 
 #define MEDIA_VPX_DEBUG 0
@@ -43,6 +43,7 @@ void MediaVpxVideoHelper::decode(const uint8_t* data,
                                  size_t len,
                                  uint64_t pts) {
     MEDIA_DPRINT("decoding %d bytes", (int)len);
+    maybeResize(data, len);
     vpx_codec_decode(mCtx.get(), data, len, (void*)pts, 0);
     fetchAllFrames();
 }
@@ -55,104 +56,122 @@ void MediaVpxVideoHelper::flush() {
 
 bool MediaVpxVideoHelper::init() {
     MEDIA_DPRINT("calling init context");
-    mCtx.reset(new vpx_codec_ctx_t);
+    // The resolution is unknown until the first key frame.
+    if (!createContext(0, 0)) {
+        return false;
+    }
+    dprint("successfully created libvpx video decoder for VP%d", mType);
+    return true;
+}
+
+vpx_codec_iface_t* MediaVpxVideoHelper::codecInterface() const {
+    return mType == 8 ? &vpx_codec_vp8_dx_algo : &vpx_codec_vp9_dx_algo;
+}
+
+bool MediaVpxVideoHelper::createContext(uint32_t width, uint32_t height) {
+    MediaDecodeThreadBudget::Lease lease;
+    MediaDecodeThreadBudget::Settings settings;
+    if (mThreadCount > 1) {
+        lease = MediaDecodeThreadBudget::get().acquire(mType, width, height);
+        settings = lease.settings();
+    }
+
+    std::unique_ptr<vpx_codec_ctx_t> ctx(new vpx_codec_ctx_t);
     vpx_codec_err_t vpx_err;
     vpx_codec_dec_cfg_t cfg;
     vpx_codec_flags_t flags;
     memset(&cfg, 0, sizeof(cfg));
     memset(&flags, 0, sizeof(flags));
-    cfg.threads = 1;
-
-    if (mThreadCount > 1) {
-        cfg.threads = std::min(mThreadCount, 4);
-    }
+    cfg.threads = settings.threads;
+    cfg.w = width;
+    cfg.h = height;
 
-    if ((vpx_err = vpx_codec_dec_init(
-                 mCtx.get(),
-                 mType == 8 ? &vpx_codec_vp8_dx_algo : &vpx_codec_vp9_dx_algo,
-                 &cfg, flags))) {
+    if ((vpx_err = vpx_codec_dec_init(ctx.get(), codecInterface(), &cfg, flags))) {
         MEDIA_DPRINT("vpx decoder failed to initialize. (%d)", vpx_err);
-        mCtx.reset();
         return false;
     }
-    MEDIA_DPRINT("vpx decoder initialize context successfully.");
-    dprint("successfully created libvpx video decoder for VP%d", mType);
+#ifdef VPX_CTRL_VP9D_SET_ROW_MT
+    if (settings.rowMt) {
+        vpx_codec_control(ctx.get(), VP9D_SET_ROW_MT, 1);
+    }
+#else
+    settings.rowMt = false;
+#endif
+    MEDIA_DPRINT("vpx decoder initialize context successfully, %ux%u with %u "
+                 "threads, row-mt %d",
+                 width, height, settings.threads, settings.rowMt);
 
+    deInit();
+    mCtx = std::move(ctx);
+    mLease = std::move(lease);
+    mSettings = settings;
     return true;
 }
 
+void MediaVpxVideoHelper::maybeResize(const uint8_t* data, size_t len) {
+    if (mThreadCount <= 1 || mCtx == nullptr) {
+        return;
+    }
+    vpx_codec_stream_info_t info;
+    memset(&info, 0, sizeof(info));
+    info.sz = sizeof(info);
+    if (vpx_codec_peek_stream_info(codecInterface(), data, len, &info) != VPX_CODEC_OK ||
+        !info.is_kf || (info.w == mWidth && info.h == mHeight)) {
+        return;
+    }
+    mWidth = info.w;
+    mHeight = info.h;
+
+    // A key frame needs no earlier state, so the context can be swapped
+    // for one sized to the new resolution. Frames are handed out right
+    // after each decode, so nothing is left in the old one.
+    if (MediaDecodeThreadBudget::select(mType, mWidth, mHeight,
+                                        MediaDecodeThreadBudget::get().budget()) != mSettings) {
+        createContext(mWidth, mHeight);
+    }
+}
+
 void MediaVpxVideoHelper::deInit() {
     if (mCtx != nullptr) {
         MEDIA_DPRINT("calling destroy context");
         vpx_codec_destroy(mCtx.get());
         mCtx.reset();
+        mLease = MediaDecodeThreadBudget::Lease();
     }
 }
 
-void MediaVpxVideoHelper::copyYV12FrameToOutputBuffer(size_t outputBufferWidth,
-                                                      size_t outputBufferHeight,
-                                                      size_t imgWidth,
-                                                      size_t imgHeight,
-                                                      int32_t bpp,
-                                                      uint8_t* dst,
-                                                      const uint8_t* srcY,
-                                                      const uint8_t* srcU,
-                                                      const uint8_t* srcV,
-                                                      size_t srcYStride,
-                                                      size_t srcUStride,
-                                                      size_t srcVStride) {
-    size_t dstYStride = outputBufferWidth * bpp;
-    size_t dstUVStride = dstYStride / 2;
-    size_t dstHeight = outputBufferHeight;
-    uint8_t* dstStart = dst;
-
-    for (size_t i = 0; i < imgHeight; ++i) {
-        memcpy(dst, srcY, imgWidth * bpp);
-        srcY += srcYStride;
-        dst += dstYStride;
-    }
-
-    dst = dstStart + dstYStride * dstHeight;
-    for (size_t i = 0; i < imgHeight / 2; ++i) {
-        memcpy(dst, srcU, imgWidth / 2 * bpp);
-        srcU += srcUStride;
-        dst += dstUVStride;
+void MediaVpxVideoHelper::copyImgToGuest(vpx_image_t* mImg,
+                                         MediaFrameBuffer& byteBuffer) {
+    const int width = mImg->d_w;
+    const int height = mImg->d_h;
+    YuvPlanes planes;
+    planes.y = mImg->planes[VPX_PLANE_Y];
+    planes.u = mImg->planes[VPX_PLANE_U];
+    planes.v = mImg->planes[VPX_PLANE_V];
+    planes.yStride = mImg->stride[VPX_PLANE_Y];
+    planes.uStride = mImg->stride[VPX_PLANE_U];
+    planes.vStride = mImg->stride[VPX_PLANE_V];
+    planes.bytesPerSample = (mImg->fmt & VPX_IMG_FMT_HIGHBITDEPTH) ? 2 : 1;
+    planes.bitDepth = mImg->bit_depth;
+
+    YuvLayout layout = mOutputLayout;
+    if (planes.bytesPerSample == 2 && layout == YuvLayout::NV12) {
+        layout = YuvLayout::P010;
+    } else if (planes.bytesPerSample == 1 && layout == YuvLayout::P010) {
+        layout = YuvLayout::NV12;
     }
-
-    dst = dstStart + (5 * dstYStride * dstHeight) / 4;
-    for (size_t i = 0; i < imgHeight / 2; ++i) {
-        memcpy(dst, srcV, imgWidth / 2 * bpp);
-        srcV += srcVStride;
-        dst += dstUVStride;
+    const size_t size =
+            yuvFrameSize(layout, width, height, planes.bytesPerSample);
+    MEDIA_DPRINT("*** d_w=%d d_h=%d bpp=%d layout=%d", width, height,
+                 planes.bytesPerSample, (int)layout);
+
+    // libvpx reuses the image at the next decode, so this one copy stays;
+    // it goes straight into the guest's buffer when one was offered.
+    byteBuffer = takeOutputBuffer(size);
+    if (byteBuffer.empty()) {
+        byteBuffer = MediaFrameBuffer(size);
     }
-}
-
-void MediaVpxVideoHelper::copyImgToGuest(vpx_image_t* mImg,
-                                         std::vector<uint8_t>& byteBuffer) {
-    size_t outputBufferWidth = mImg->d_w;
-    size_t outputBufferHeight = mImg->d_h;
-    size_t mWidth = mImg->d_w;
-    size_t mHeight = mImg->d_h;
-    // assert(mImg->fmt == VPX_IMG_FMT_I420 || mImg->fmt == VPX_IMG_FMT_I42016)
-    assert(mImg->fmt == VPX_IMG_FMT_I420);
-    int32_t bpp = (mImg->fmt == VPX_IMG_FMT_I420) ? 1 : 2;
-
-    byteBuffer.resize(mWidth * mHeight * bpp * 3 / 2);
-    uint8_t* dst = byteBuffer.data();
-    MEDIA_DPRINT("*** d_w=%d d_h=%d out_w=%d out_h=%d m_w=%d m_h=%d bpp=%d",
-                 mImg->d_w, mImg->d_h, (int)outputBufferWidth,
-                 (int)outputBufferHeight, (int)mWidth, (int)mHeight, (int)bpp);
-
-    const uint8_t* srcY = (const uint8_t*)mImg->planes[VPX_PLANE_Y];
-    const uint8_t* srcU = (const uint8_t*)mImg->planes[VPX_PLANE_U];
-    const uint8_t* srcV = (const uint8_t*)mImg->planes[VPX_PLANE_V];
-    size_t srcYStride = mImg->stride[VPX_PLANE_Y];
-    size_t srcUStride = mImg->stride[VPX_PLANE_U];
-    size_t srcVStride = mImg->stride[VPX_PLANE_V];
-
-    copyYV12FrameToOutputBuffer(outputBufferWidth, outputBufferHeight,
-                                mImg->d_w, mImg->d_h, bpp, dst, srcY, srcU,
-                                srcV, srcYStride, srcUStride, srcVStride);
+    yuvPackFrame(planes, width, height, layout, byteBuffer.data());
 }
 
 void MediaVpxVideoHelper::fetchAllFrames() {
@@ -165,7 +184,7 @@ void MediaVpxVideoHelper::fetchAllFrames() {
         if (mIgnoreDecoderOutput) {
             continue;
         }
-        std::vector<uint8_t> byteBuffer;
+        MediaFrameBuffer byteBuffer;
         copyImgToGuest(mImg, byteBuffer);
         MEDIA_DPRINT("save frame");
         mSavedDecodedFrames.push_back(MediaSnapshotState::FrameInfo{
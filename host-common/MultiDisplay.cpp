@@ -26,6 +26,7 @@
 #include <utility>                                       // for pair, make_pair
 #include <vector>                                        // for vector
 
+#include "aemu/base/synchronization/EpochReclaimer.h"
 #include "android/base/LayoutResolver.h"                 // for resolveLayout
 #include "android/base/Log.h"                            // for LogStreamVoi...
 #include "android/base/files/Stream.h"                   // for Stream
@@ -55,6 +56,10 @@ MultiDisplay::MultiDisplay(const QAndroidEmulatorWindowAgent* const windowAgent,
       mRecordAgent(recordAgent),
       mGuestMode(isGuestMode) { }
 
+MultiDisplay::~MultiDisplay() {
+    delete mLayout.load(std::memory_order_relaxed);
+}
+
 //static
 MultiDisplay* MultiDisplay::getInstance() {
     return sMultiDisplay;
@@ -196,6 +201,12 @@ bool MultiDisplay::getMultiDisplay(uint32_t id,
     return mMultiDisplay[id].enabled;
 }
 
+bool MultiDisplay::isMultiDisplayEnabled() {
+    base::EpochReclaimer::ReadScope scope;
+    const Layout* layout = mLayout.load(std::memory_order_acquire);
+    return layout && layout->displayCount > 1;
+}
+
 bool MultiDisplay::getNextMultiDisplay(int32_t start_id,
                                        uint32_t* id,
                                        int32_t* x,
@@ -206,7 +217,7 @@ bool MultiDisplay::getNextMultiDisplay(int32_t start_id,
                                        uint32_t* flag,
                                        uint32_t* cb) {
     uint32_t key;
-    std::map<uint32_t, MultiDisplayInfo>::iterator i;
+    base::FlatMap<uint32_t, MultiDisplayInfo>::iterator i;
 
     AutoLock lock(mLock);
     if (start_id < 0) {
@@ -251,24 +262,16 @@ bool MultiDisplay::translateCoordination(uint32_t* x, uint32_t* y, uint32_t* dis
         *displayId = 0;
         return true;
     }
-    AutoLock lock(mLock);
-    uint32_t totalH, pos_x, pos_y, w, h;
-    getCombinedDisplaySizeLocked(nullptr, &totalH);
-    for (const auto iter : mMultiDisplay) {
-        if (iter.first != 0 && iter.second.cb == 0) {
-            continue;
-        }
-        // QT window uses the top left corner as the origin.
-        // So we need to transform the (x, y) coordinates from
-        // bottom left corner to top left corner.
-        pos_x = iter.second.pos_x;
-        pos_y = totalH - iter.second.height - iter.second.pos_y;
-        w = iter.second.width;
-        h = iter.second.height;
-        if ((*x - pos_x) < w && (*y - pos_y) < h) {
-            *x = *x - pos_x;
-            *y = *y - pos_y;
-            *displayId = iter.first;
+    base::EpochReclaimer::ReadScope scope;
+    const Layout* layout = mLayout.load(std::memory_order_acquire);
+    if (!layout) {
+        return false;
+    }
+    for (const Layout::Region& region : layout->regions) {
+        if ((*x - region.x) < region.width && (*y - region.y) < region.height) {
+            *x = *x - region.x;
+            *y = *y - region.y;
+            *displayId = region.id;
             return true;
         }
     }
@@ -282,6 +285,7 @@ void MultiDisplay::setGpuMode(bool isGuestMode, uint32_t w, uint32_t h) {
         // default display from FrameBuffer. So we set display 0 here.
         AutoLock lock(mLock);
         mMultiDisplay.emplace(0, MultiDisplayInfo(0, 0, w, h, 0, 0, true, 0));
+        publishLayoutLocked();
     }
 }
 
@@ -322,6 +326,7 @@ int MultiDisplay::createDisplay(uint32_t* displayId) {
     }
 
     mMultiDisplay.emplace(*displayId, MultiDisplayInfo());
+    publishLayoutLocked();
     LOG(VERBOSE) << "create display " << *displayId;
     return 0;
 }
@@ -349,6 +354,7 @@ int MultiDisplay::destroyDisplay(uint32_t displayId) {
                 restoreSkin = true;
             }
         }
+        publishLayoutLocked();
     }
 
     if (needUIUpdate) {
@@ -400,6 +406,7 @@ int MultiDisplay::setDisplayPose(uint32_t displayId,
             getCombinedDisplaySizeLocked(&width, &height);
             UIUpdate = true;
         }
+        publishLayoutLocked();
     }
     if (checkRecording) {
         // stop recording of this display if it is happening.
@@ -465,6 +472,7 @@ int MultiDisplay::setDisplayColorBuffer(uint32_t displayId, uint32_t colorBuffer
             }
         }
         mMultiDisplay[displayId].cb = colorBuffer;
+        publishLayoutLocked();
     }
     if (noSkin) {
         mWindowAgent->setNoSkin();
@@ -493,14 +501,19 @@ int MultiDisplay::getColorBufferDisplay(uint32_t colorBuffer, uint32_t* displayI
     if (mGuestMode) {
         return -1;
     }
-    AutoLock lock(mLock);
-    for (const auto& iter : mMultiDisplay) {
-        if (iter.second.cb == colorBuffer) {
-            *displayId = iter.first;
-            return 0;
-        }
+    base::EpochReclaimer::ReadScope scope;
+    const Layout* layout = mLayout.load(std::memory_order_acquire);
+    if (!layout) {
+        return -1;
+    }
+    auto it = std::lower_bound(layout->colorBuffers.begin(),
+                               layout->colorBuffers.end(),
+                               std::make_pair(colorBuffer, 0u));
+    if (it == layout->colorBuffers.end() || it->first != colorBuffer) {
+        return -1;
     }
-    return -1;
+    *displayId = it->second;
+    return 0;
 }
 
 void MultiDisplay::getCombinedDisplaySize(uint32_t* w, uint32_t* h) {
@@ -533,6 +546,34 @@ int MultiDisplay::getNumberActiveMultiDisplaysLocked() {
     return count;
 }
 
+void MultiDisplay::publishLayoutLocked() {
+    Layout* next = new Layout();
+    next->displayCount = mMultiDisplay.size();
+    uint32_t totalH;
+    getCombinedDisplaySizeLocked(nullptr, &totalH);
+    for (const auto& iter : mMultiDisplay) {
+        next->colorBuffers.emplace_back(iter.second.cb, iter.first);
+        if (iter.first != 0 && iter.second.cb == 0) {
+            continue;
+        }
+        // QT window uses the top left corner as the origin.
+        // So we need to transform the (x, y) coordinates from
+        // bottom left corner to top left corner.
+        next->regions.push_back(
+                {iter.first, uint32_t(iter.second.pos_x),
+                 totalH - iter.second.height - iter.second.pos_y,
+                 iter.second.width, iter.second.height});
+    }
+    std::sort(next->colorBuffers.begin(), next->colorBuffers.end());
+
+    const Layout* old = mLayout.exchange(next, std::memory_order_acq_rel);
+    if (old) {
+        base::EpochReclaimer::get().retire(
+                const_cast<Layout*>(old),
+                [](void* layout) { delete static_cast<Layout*>(layout); });
+    }
+}
+
 /*
  * Given that there are at most 11 displays, we can iterate through all possible
  * ways of showing each display in either the first row or the second row. It is
@@ -560,15 +601,14 @@ void MultiDisplay::recomputeLayoutLocked() {
     } else {
         monitorAspectRatio = (double) monitorHeight / (double) monitorWidth;
     }
-    std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> rectangles;
+    mLayoutResolver.clear();
     for (const auto& iter : mMultiDisplay) {
         if (iter.first == 0 || iter.second.cb != 0) {
-            rectangles[iter.first] =
-                std::make_pair(iter.second.width, iter.second.height);
+            mLayoutResolver.setDisplay(iter.first, iter.second.width,
+                                       iter.second.height);
         }
     }
-    for (const auto& iter :
-        android::base::resolveLayout(rectangles, monitorAspectRatio)) {
+    for (const auto& iter : mLayoutResolver.resolve(monitorAspectRatio)) {
         mMultiDisplay[iter.first].pos_x = iter.second.first;
         mMultiDisplay[iter.first].pos_y = iter.second.second;
     }
@@ -618,8 +658,8 @@ bool MultiDisplay::multiDisplayParamValidate(uint32_t id, uint32_t w, uint32_t h
     return true;
 }
 
-std::map<uint32_t, MultiDisplayInfo> MultiDisplay::parseConfig() {
-    std::map<uint32_t, MultiDisplayInfo> ret;
+base::FlatMap<uint32_t, MultiDisplayInfo> MultiDisplay::parseConfig() {
+    base::FlatMap<uint32_t, MultiDisplayInfo> ret;
     if (!android_cmdLineOptions || !android_cmdLineOptions->multidisplay) {
         return ret;
     }
@@ -677,7 +717,7 @@ void MultiDisplay::loadConfig() {
         return;
     }
 
-    std::map<uint32_t, MultiDisplayInfo> info = parseConfig();
+    base::FlatMap<uint32_t, MultiDisplayInfo> info = parseConfig();
     if (info.size()) {
         LOG(VERBOSE) << "config multidisplay with command-line";
         for (const auto& i : info) {
@@ -746,7 +786,7 @@ void MultiDisplay::onSave(base::Stream* stream) {
     base::saveCollection(
         stream, mMultiDisplay,
         [](base::Stream* s,
-           const std::map<uint32_t, MultiDisplayInfo>::value_type& pair) {
+           const base::FlatMap<uint32_t, MultiDisplayInfo>::value_type& pair) {
         s->putBe32(pair.first);
         s->putBe32(pair.second.pos_x);
         s->putBe32(pair.second.pos_y);
@@ -760,9 +800,9 @@ void MultiDisplay::onSave(base::Stream* stream) {
 }
 
 void MultiDisplay::onLoad(base::Stream* stream) {
-    std::map<uint32_t, MultiDisplayInfo> displaysOnLoad;
+    base::FlatMap<uint32_t, MultiDisplayInfo> displaysOnLoad;
     base::loadCollection(stream, &displaysOnLoad,
-                         [this](base::Stream* stream) -> std::map<uint32_t, MultiDisplayInfo>::value_type {
+                         [this](base::Stream* stream) -> base::FlatMap<uint32_t, MultiDisplayInfo>::value_type {
         const uint32_t idx = stream->getBe32();
         const int32_t pos_x = stream->getBe32();
         const int32_t pos_y = stream->getBe32();
@@ -792,6 +832,7 @@ void MultiDisplay::onLoad(base::Stream* stream) {
         mMultiDisplay = displaysOnLoad;
         activeAfterLoad = getNumberActiveMultiDisplaysLocked() > 1;
         getCombinedDisplaySizeLocked(&combinedDisplayWidth, &combinedDisplayHeight);
+        publishLayoutLocked();
     }
     if (activeAfterLoad) {
         if (!activeBeforeLoad) {
@@ -36,9 +36,7 @@ RefcountPipe::RefcountPipe(void* hwPipe, Service* svc, base::Stream* loadStream)
 }
 
 RefcountPipe::~RefcountPipe() {
-    OnLastColorBufferRef func = *sOnLastColorBufferRef;
-    if (func != nullptr)
-        func(mHandle);
+    onLastColorBufferRef(mHandle);
 }
 
 void RefcountPipe::onGuestClose(PipeCloseReason reason) {
@@ -106,6 +104,12 @@ void registerOnLastRefCallback(OnLastColorBufferRef func) {
     *sOnLastColorBufferRef = func;
 }
 
+void onLastColorBufferRef(uint32_t handle) {
+    OnLastColorBufferRef func = *sOnLastColorBufferRef;
+    if (func != nullptr)
+        func(handle);
+}
+
 }  // namespace emulation
 }  // namespace android
 
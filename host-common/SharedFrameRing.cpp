@@ -0,0 +1,440 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/SharedFrameRing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <type_traits>
+
+#include <string.h>
+
+namespace android {
+namespace emulation {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x4d524641;  // 'AFRM'
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kMaxFrameBytes = 1u << 30;
+constexpr size_t kPageSize = 4096;
+constexpr char kOfferPrefix[] = "aemu-frames/1 ";
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// A slot's lock word is the sequence number of the frame it holds, shifted
+// up one, with the low bit set while the producer writes it. 0 is empty.
+constexpr uint64_t kWritingBit = 1;
+
+uint64_t sequenceOf(uint64_t lock) {
+    return lock >> 1;
+}
+
+bool readable(uint64_t lock) {
+    return lock && !(lock & kWritingBit);
+}
+
+// Parses a decimal number followed by a space off the front of |text|.
+bool takeNumber(std::string_view* text, uint32_t* out) {
+    uint64_t value = 0;
+    size_t digits = 0;
+    while (digits < text->size() && (*text)[digits] >= '0' &&
+           (*text)[digits] <= '9' && value <= UINT32_MAX) {
+        value = value * 10 + ((*text)[digits] - '0');
+        ++digits;
+    }
+    if (!digits || digits >= text->size() || (*text)[digits] != ' ' ||
+        value > UINT32_MAX) {
+        return false;
+    }
+    text->remove_prefix(digits + 1);
+    *out = uint32_t(value);
+    return true;
+}
+
+}  // namespace
+
+static_assert(std::is_trivially_copyable<SharedFrameInfo>::value,
+              "SharedFrameInfo is shared between processes");
+static_assert(sizeof(DamageRect) == 16, "DamageRect is shared");
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) &&
+                      std::atomic<uint64_t>::is_always_lock_free,
+              "Lock words are shared between processes");
+
+void SharedFrameInfo::setDamage(const DamageRegion& region) {
+    const std::vector<DamageRect>& rects = region.rects();
+    if (rects.size() > DamageRegion::kMaxRects) {
+        damageCount = 0;
+        return;
+    }
+    std::copy(rects.begin(), rects.end(), damage);
+    damageCount = uint32_t(rects.size());
+}
+
+// At the start of the region, followed by the slot table and then the
+// page-aligned frame data.
+struct SharedFrameRing::Header {
+    struct Cursor {
+        std::atomic<uint32_t> active;
+        uint32_t reserved0;
+        // Sequence number of the last frame acquired.
+        std::atomic<uint64_t> position;
+        // Lock word of the slot being read, or 0.
+        std::atomic<uint64_t> held;
+        uint64_t reserved1;
+    };
+
+    // Written last by the creator, once everything else is set up.
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t maxFrameBytes;
+    std::atomic<uint64_t> latest;
+    std::atomic<uint32_t> producerClosed;
+    uint32_t reserved0;
+    Cursor cursors[kMaxConsumers];
+    uint32_t reserved1[16];
+};
+
+struct alignas(64) SharedFrameRing::Slot {
+    std::atomic<uint64_t> lock;
+    SharedFrameInfo info;
+};
+
+SharedFrameRing::SharedFrameRing(const std::string& name,
+                                 uint32_t slotCount,
+                                 uint32_t maxFrameBytes,
+                                 bool producer)
+    : mName(name),
+      mSlotCount(slotCount),
+      mMaxFrameBytes(maxFrameBytes),
+      mProducer(producer),
+      mMemory(name, regionSize(slotCount, maxFrameBytes)) {}
+
+SharedFrameRing::~SharedFrameRing() {
+    if (mProducer && mHeader) {
+        mHeader->producerClosed.store(1, std::memory_order_release);
+    }
+}
+
+// static
+bool SharedFrameRing::validSize(uint32_t slotCount, uint32_t maxFrameBytes) {
+    return slotCount && slotCount <= kMaxSlots && maxFrameBytes &&
+           maxFrameBytes <= kMaxFrameBytes;
+}
+
+// static
+size_t SharedFrameRing::slotStride(uint32_t maxFrameBytes) {
+    return alignUp(maxFrameBytes, kPageSize);
+}
+
+// static
+size_t SharedFrameRing::dataOffset() {
+    return alignUp(alignUp(sizeof(Header), alignof(Slot)) +
+                           kMaxSlots * sizeof(Slot),
+                   kPageSize);
+}
+
+// static
+size_t SharedFrameRing::regionSize(uint32_t slotCount,
+                                   uint32_t maxFrameBytes) {
+    return dataOffset() + slotCount * slotStride(maxFrameBytes);
+}
+
+void SharedFrameRing::attach() {
+    char* base = static_cast<char*>(mMemory.get());
+    mHeader = reinterpret_cast<Header*>(base);
+    mSlots = reinterpret_cast<Slot*>(
+            base + alignUp(sizeof(Header), alignof(Slot)));
+}
+
+uint8_t* SharedFrameRing::slotData(uint32_t index) const {
+    return static_cast<uint8_t*>(mMemory.get()) + dataOffset() +
+           index * slotStride(mMaxFrameBytes);
+}
+
+// static
+std::unique_ptr<SharedFrameRing> SharedFrameRing::create(
+        const std::string& name,
+        uint32_t slotCount,
+        uint32_t maxFrameBytes,
+        mode_t mode) {
+    if (!validSize(slotCount, maxFrameBytes)) {
+        return nullptr;
+    }
+    std::unique_ptr<SharedFrameRing> ring(
+            new SharedFrameRing(name, slotCount, maxFrameBytes, true));
+    if (ring->mMemory.create(mode) != 0) {
+        return nullptr;
+    }
+    memset(ring->mMemory.get(), 0, dataOffset());
+    ring->attach();
+
+    Header* header = ring->mHeader;
+    header->version = kVersion;
+    header->slotCount = slotCount;
+    header->maxFrameBytes = maxFrameBytes;
+    header->magic.store(kMagic, std::memory_order_release);
+    return ring;
+}
+
+// static
+std::unique_ptr<SharedFrameRing> SharedFrameRing::open(
+        const std::string& name,
+        uint32_t slotCount,
+        uint32_t maxFrameBytes) {
+    if (!validSize(slotCount, maxFrameBytes)) {
+        return nullptr;
+    }
+    std::unique_ptr<SharedFrameRing> ring(
+            new SharedFrameRing(name, slotCount, maxFrameBytes, false));
+    // Consumers write their cursors, so even readers map it writable.
+    if (ring->mMemory.open(base::SharedMemory::AccessMode::READ_WRITE) != 0) {
+        return nullptr;
+    }
+    const Header* header = static_cast<const Header*>(ring->mMemory.get());
+    if (header->magic.load(std::memory_order_acquire) != kMagic ||
+        header->version != kVersion || header->slotCount != slotCount ||
+        header->maxFrameBytes != maxFrameBytes) {
+        return nullptr;
+    }
+    ring->attach();
+    return ring;
+}
+
+std::string SharedFrameRing::offer() const {
+    return kOfferPrefix + std::to_string(mSlotCount) + " " +
+           std::to_string(mMaxFrameBytes) + " " + mName;
+}
+
+// static
+std::unique_ptr<SharedFrameRing> SharedFrameRing::acceptOffer(
+        std::string_view offer) {
+    const std::string_view prefix(kOfferPrefix);
+    if (offer.substr(0, prefix.size()) != prefix) {
+        return nullptr;
+    }
+    offer.remove_prefix(prefix.size());
+    while (!offer.empty() && (offer.back() == '\n' || offer.back() == '\r')) {
+        offer.remove_suffix(1);
+    }
+    uint32_t slotCount;
+    uint32_t maxFrameBytes;
+    if (!takeNumber(&offer, &slotCount) ||
+        !takeNumber(&offer, &maxFrameBytes) || offer.empty()) {
+        return nullptr;
+    }
+    return open(std::string(offer), slotCount, maxFrameBytes);
+}
+
+bool SharedFrameRing::slotHeld(uint64_t lock) const {
+    if (!lock) {
+        return false;
+    }
+    for (const Header::Cursor& cursor : mHeader->cursors) {
+        if (cursor.active.load(std::memory_order_seq_cst) &&
+            cursor.held.load(std::memory_order_seq_cst) == lock) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t* SharedFrameRing::beginFrame() {
+    if (!mProducer) {
+        return nullptr;
+    }
+    if (mWriting >= 0) {
+        return slotData(mWriting);
+    }
+
+    // Keep the newest frame readable while the next one is written, and
+    // leave alone slots consumers are reading. The lock word is marked
+    // before the cursors are checked, and consumers publish their hold
+    // before re-checking the lock word, so one side always sees the other.
+    const uint64_t latest = mHeader->latest.load(std::memory_order_relaxed);
+    int fallback = -1;
+    for (uint32_t k = 0; k < mSlotCount && mWriting < 0; ++k) {
+        const uint32_t i = (mNextSlot + k) % mSlotCount;
+        Slot& slot = mSlots[i];
+        const uint64_t lock = slot.lock.load(std::memory_order_relaxed);
+        if (mSlotCount > 1 && latest && lock == latest << 1) {
+            continue;
+        }
+        if (fallback < 0) {
+            fallback = int(i);
+        }
+        slot.lock.store(lock | kWritingBit, std::memory_order_seq_cst);
+        if (!slotHeld(lock)) {
+            mWriting = int(i);
+        } else {
+            slot.lock.store(lock, std::memory_order_seq_cst);
+        }
+    }
+    if (mWriting < 0) {
+        // Every other slot is being read; the oldest reader gets torn.
+        mWriting = fallback < 0 ? int(mNextSlot % mSlotCount) : fallback;
+        Slot& slot = mSlots[mWriting];
+        slot.lock.store(slot.lock.load(std::memory_order_relaxed) | kWritingBit,
+                        std::memory_order_seq_cst);
+    }
+    mNextSlot = (uint32_t(mWriting) + 1) % mSlotCount;
+    return slotData(mWriting);
+}
+
+uint64_t SharedFrameRing::publish(const SharedFrameInfo& info) {
+    if (!beginFrame()) {
+        return 0;
+    }
+    Slot& slot = mSlots[mWriting];
+    const uint64_t sequence =
+            mHeader->latest.load(std::memory_order_relaxed) + 1;
+    memcpy(&slot.info, &info, sizeof(info));
+    slot.info.sequence = sequence;
+    slot.info.size = std::min(info.size, mMaxFrameBytes);
+    if (slot.info.damageCount > DamageRegion::kMaxRects) {
+        slot.info.damageCount = 0;
+    }
+    slot.lock.store(sequence << 1, std::memory_order_release);
+    mHeader->latest.store(sequence, std::memory_order_release);
+    mWriting = -1;
+    return sequence;
+}
+
+uint64_t SharedFrameRing::publish(const void* data,
+                                  const SharedFrameInfo& info) {
+    uint8_t* dst = beginFrame();
+    if (!dst) {
+        return 0;
+    }
+    memcpy(dst, data, std::min(info.size, mMaxFrameBytes));
+    return publish(info);
+}
+
+std::unique_ptr<SharedFrameRing::Consumer> SharedFrameRing::addConsumer() {
+    for (uint32_t i = 0; i < kMaxConsumers; ++i) {
+        Header::Cursor& cursor = mHeader->cursors[i];
+        uint32_t expected = 0;
+        if (cursor.active.compare_exchange_strong(expected, 1)) {
+            cursor.held.store(0, std::memory_order_relaxed);
+            cursor.position.store(latestSequence(), std::memory_order_relaxed);
+            return std::unique_ptr<Consumer>(new Consumer(this, i));
+        }
+    }
+    return nullptr;
+}
+
+uint64_t SharedFrameRing::latestSequence() const {
+    return mHeader->latest.load(std::memory_order_acquire);
+}
+
+bool SharedFrameRing::producerClosed() const {
+    return mHeader->producerClosed.load(std::memory_order_acquire) != 0;
+}
+
+SharedFrameRing::Consumer::Consumer(SharedFrameRing* ring, uint32_t index)
+    : mRing(ring), mIndex(index) {}
+
+SharedFrameRing::Consumer::~Consumer() {
+    Header::Cursor& cursor = mRing->mHeader->cursors[mIndex];
+    cursor.held.store(0, std::memory_order_release);
+    cursor.active.store(0, std::memory_order_release);
+}
+
+bool SharedFrameRing::Consumer::acquireNext(Frame* frame) {
+    return acquire(frame, false);
+}
+
+bool SharedFrameRing::Consumer::acquireLatest(Frame* frame) {
+    return acquire(frame, true);
+}
+
+bool SharedFrameRing::Consumer::acquire(Frame* frame, bool latest) {
+    if (mHeldLock) {
+        release();
+    }
+    Header::Cursor& cursor = mRing->mHeader->cursors[mIndex];
+    const uint64_t position = cursor.position.load(std::memory_order_relaxed);
+
+    // A slot can change under every step here, so retry a few times
+    // rather than report nothing while frames are flowing.
+    for (uint32_t attempt = 0; attempt < 2 * kMaxSlots; ++attempt) {
+        int best = -1;
+        uint64_t bestLock = 0;
+        for (uint32_t i = 0; i < mRing->mSlotCount; ++i) {
+            const uint64_t lock =
+                    mRing->mSlots[i].lock.load(std::memory_order_acquire);
+            if (!readable(lock) || sequenceOf(lock) <= position) {
+                continue;
+            }
+            if (best < 0 || (latest ? lock > bestLock : lock < bestLock)) {
+                best = int(i);
+                bestLock = lock;
+            }
+        }
+        if (best < 0) {
+            return false;
+        }
+
+        Slot& slot = mRing->mSlots[best];
+        cursor.held.store(bestLock, std::memory_order_seq_cst);
+        if (slot.lock.load(std::memory_order_seq_cst) != bestLock) {
+            continue;
+        }
+        memcpy(&frame->info, &slot.info, sizeof(frame->info));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.lock.load(std::memory_order_relaxed) != bestLock) {
+            continue;
+        }
+
+        const uint64_t sequence = sequenceOf(bestLock);
+        if (sequence != position + 1) {
+            mDropped += sequence - position - 1;
+        }
+        if (sequence != position + 1 || !mHavePrevious) {
+            frame->info.damageCount = 0;
+        }
+        frame->data = mRing->slotData(best);
+        mHeldLock = bestLock;
+        cursor.position.store(sequence, std::memory_order_relaxed);
+        return true;
+    }
+    cursor.held.store(0, std::memory_order_release);
+    return false;
+}
+
+bool SharedFrameRing::Consumer::release() {
+    if (!mHeldLock) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    bool intact = false;
+    for (uint32_t i = 0; i < mRing->mSlotCount; ++i) {
+        if (mRing->mSlots[i].lock.load(std::memory_order_relaxed) ==
+            mHeldLock) {
+            intact = true;
+            break;
+        }
+    }
+    mRing->mHeader->cursors[mIndex].held.store(0, std::memory_order_release);
+    mHeldLock = 0;
+    mHavePrevious = intact;
+    return intact;
+}
+
+}  // namespace emulation
+}  // namespace android
@@ -0,0 +1,205 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/SharedFrameRing.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <string.h>
+#include <unistd.h>
+
+using android::emulation::DamageRegion;
+using android::emulation::SharedFrameInfo;
+using android::emulation::SharedFrameRing;
+
+namespace {
+
+std::string uniqueName(const char* test) {
+    return std::string("aemu-frames-test-") + test + "-" +
+           std::to_string(getpid());
+}
+
+SharedFrameInfo frameInfo(uint32_t size) {
+    SharedFrameInfo info;
+    info.width = size / 4;
+    info.height = 1;
+    info.stride = size;
+    info.size = size;
+    return info;
+}
+
+}  // namespace
+
+// Tests that frames written in place reach a consumer opened from the
+// offer, in order, with their damage.
+TEST(SharedFrameRing, PublishAndConsume) {
+    auto producer = SharedFrameRing::create(uniqueName("publish"), 3, 4096);
+    ASSERT_TRUE(producer);
+    auto ring = SharedFrameRing::acceptOffer(producer->offer());
+    ASSERT_TRUE(ring);
+    EXPECT_FALSE(ring->beginFrame());
+    auto consumer = ring->addConsumer();
+    ASSERT_TRUE(consumer);
+
+    SharedFrameRing::Frame frame;
+    EXPECT_FALSE(consumer->acquireNext(&frame));
+
+    for (int i = 1; i <= 2; ++i) {
+        uint8_t* pixels = producer->beginFrame();
+        ASSERT_TRUE(pixels);
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(pixels) % 4096);
+        memset(pixels, i, 64);
+        SharedFrameInfo info = frameInfo(64);
+        DamageRegion damage;
+        damage.add({0, 0, 4, 1});
+        info.setDamage(damage);
+        EXPECT_EQ(uint64_t(i), producer->publish(info));
+    }
+    EXPECT_EQ(2u, ring->latestSequence());
+
+    ASSERT_TRUE(consumer->acquireNext(&frame));
+    EXPECT_EQ(1u, frame.info.sequence);
+    EXPECT_EQ(64u, frame.info.size);
+    EXPECT_EQ(1, frame.data[63]);
+    // Nothing before it was seen, so it is all damage.
+    EXPECT_EQ(0u, frame.info.damageCount);
+    EXPECT_TRUE(consumer->release());
+
+    ASSERT_TRUE(consumer->acquireNext(&frame));
+    EXPECT_EQ(2u, frame.info.sequence);
+    EXPECT_EQ(2, frame.data[0]);
+    ASSERT_EQ(1u, frame.info.damageCount);
+    EXPECT_EQ(4, frame.info.damage[0].w);
+    EXPECT_TRUE(consumer->release());
+    EXPECT_FALSE(consumer->acquireNext(&frame));
+    EXPECT_EQ(0u, consumer->dropped());
+
+    EXPECT_FALSE(ring->producerClosed());
+    producer.reset();
+    EXPECT_TRUE(ring->producerClosed());
+}
+
+// Tests that a held frame is not overwritten while other slots are free,
+// and that a slow consumer skips ahead rather than falling behind.
+TEST(SharedFrameRing, HeldFramesSurvive) {
+    auto producer = SharedFrameRing::create(uniqueName("held"), 3, 256);
+    ASSERT_TRUE(producer);
+    auto slow = producer->addConsumer();
+    auto fast = producer->addConsumer();
+    ASSERT_TRUE(slow && fast);
+
+    std::vector<uint8_t> pixels(256, 1);
+    producer->publish(pixels.data(), frameInfo(256));
+
+    SharedFrameRing::Frame held;
+    ASSERT_TRUE(slow->acquireNext(&held));
+    for (int i = 2; i <= 10; ++i) {
+        memset(pixels.data(), i, pixels.size());
+        producer->publish(pixels.data(), frameInfo(256));
+    }
+    EXPECT_EQ(1, held.data[255]);
+    EXPECT_TRUE(slow->release());
+
+    SharedFrameRing::Frame frame;
+    ASSERT_TRUE(fast->acquireLatest(&frame));
+    EXPECT_EQ(10u, frame.info.sequence);
+    EXPECT_EQ(10, frame.data[0]);
+    EXPECT_EQ(9u, fast->dropped());
+    fast->release();
+
+    // The slow reader only finds what is still in the ring.
+    ASSERT_TRUE(slow->acquireNext(&frame));
+    EXPECT_EQ(9u, frame.info.sequence);
+    EXPECT_EQ(7u, slow->dropped());
+    slow->release();
+}
+
+// Tests that with too few slots the overwrite is reported, not hidden.
+TEST(SharedFrameRing, DetectsTornFrames) {
+    auto producer = SharedFrameRing::create(uniqueName("torn"), 1, 64);
+    ASSERT_TRUE(producer);
+    auto consumer = producer->addConsumer();
+    std::vector<uint8_t> pixels(64, 1);
+    producer->publish(pixels.data(), frameInfo(64));
+
+    SharedFrameRing::Frame frame;
+    ASSERT_TRUE(consumer->acquireNext(&frame));
+    producer->publish(pixels.data(), frameInfo(64));
+    EXPECT_FALSE(consumer->release());
+}
+
+TEST(SharedFrameRing, ConsumerLimit) {
+    auto producer = SharedFrameRing::create(uniqueName("limit"), 2, 64);
+    ASSERT_TRUE(producer);
+    EXPECT_FALSE(SharedFrameRing::create(uniqueName("bad"), 0, 64));
+    EXPECT_FALSE(SharedFrameRing::acceptOffer("aemu-frames/1 2 x name"));
+    EXPECT_FALSE(SharedFrameRing::open(producer->name(), 3, 64));
+
+    std::vector<std::unique_ptr<SharedFrameRing::Consumer>> consumers;
+    for (uint32_t i = 0; i < SharedFrameRing::kMaxConsumers; ++i) {
+        consumers.push_back(producer->addConsumer());
+        ASSERT_TRUE(consumers.back());
+    }
+    EXPECT_FALSE(producer->addConsumer());
+    consumers.pop_back();
+    EXPECT_TRUE(producer->addConsumer());
+}
+
+// Tests that a consumer racing the producer never accepts a torn frame.
+TEST(SharedFrameRing, Concurrent) {
+    constexpr uint32_t kSize = 16384;
+    auto producer = SharedFrameRing::create(uniqueName("race"), 3, kSize);
+    ASSERT_TRUE(producer);
+    auto consumer = producer->addConsumer();
+
+    std::atomic<bool> done{false};
+    std::atomic<int> intact{0};
+    std::thread writer([&producer, &done, &intact] {
+        for (int i = 1; i <= 1000000 && intact < 100; ++i) {
+            uint8_t* pixels = producer->beginFrame();
+            memset(pixels, i & 0xff, kSize);
+            producer->publish(frameInfo(kSize));
+        }
+        done = true;
+    });
+
+    uint64_t lastSequence = 0;
+    while (!done) {
+        SharedFrameRing::Frame frame;
+        if (!consumer->acquireNext(&frame)) {
+            continue;
+        }
+        EXPECT_GT(frame.info.sequence, lastSequence);
+        lastSequence = frame.info.sequence;
+        const uint8_t first = frame.data[0];
+        bool uniform = true;
+        for (uint32_t i = 0; i < kSize; i += 512) {
+            uniform &= frame.data[i] == first;
+        }
+        uniform &= frame.data[kSize - 1] == first;
+        if (consumer->release()) {
+            EXPECT_TRUE(uniform);
+            EXPECT_EQ(uint8_t(frame.info.sequence), first);
+            ++intact;
+        }
+    }
+    writer.join();
+    EXPECT_GT(intact, 0);
+}
@@ -0,0 +1,173 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/SnapshotGraph.h"
+
+#include "aemu/base/files/InplaceStream.h"
+#include "aemu/base/files/MemStream.h"
+#include "aemu/base/system/System.h"
+#include "host-common/DependencyGraph.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include <stdio.h>
+
+#define E(fmt, ...) \
+    fprintf(stderr, "SnapshotGraph: ERROR: %s: " fmt "\n", __func__, ##__VA_ARGS__);
+
+namespace android {
+
+using base::AutoLock;
+using base::MemStream;
+
+bool SnapshotGraph::add(Device device) {
+    AutoLock lock(mLock);
+    for (const Device& existing : mDevices) {
+        if (existing.name == device.name) {
+            return false;
+        }
+    }
+    mDevices.push_back(std::move(device));
+    return true;
+}
+
+bool SnapshotGraph::remove(const std::string& name) {
+    AutoLock lock(mLock);
+    auto it = std::find_if(mDevices.begin(), mDevices.end(),
+                           [&name](const Device& d) { return d.name == name; });
+    if (it == mDevices.end()) {
+        return false;
+    }
+    mDevices.erase(it);
+    return true;
+}
+
+std::vector<SnapshotGraph::Timing> SnapshotGraph::lastTimings() const {
+    AutoLock lock(mLock);
+    std::vector<Timing> result;
+    for (size_t i = 0; i < mDevices.size() && i < mLastUs.size(); ++i) {
+        result.push_back({mDevices[i].name, mLastUs[i]});
+    }
+    return result;
+}
+
+uint64_t SnapshotGraph::lastTotalUs() const {
+    AutoLock lock(mLock);
+    return mLastTotalUs;
+}
+
+// Requires |mLock|.
+bool SnapshotGraph::run(const std::vector<bool>& active,
+                        int threads,
+                        const std::function<void(size_t)>& fn) {
+    std::vector<std::string> names;
+    std::vector<const std::vector<std::string>*> dependsOn;
+    std::vector<bool> concurrent;
+    for (const Device& device : mDevices) {
+        names.push_back(device.name);
+        dependsOn.push_back(&device.dependsOn);
+        concurrent.push_back(device.concurrent);
+    }
+    std::vector<std::vector<size_t>> deps;
+    if (!resolveDependencyGraph(names, dependsOn, &deps)) {
+        E("Snapshot device dependencies are circular");
+        return false;
+    }
+    const uint64_t startUs = base::getHighResTimeUs();
+    runDependencyGraph(deps, active, concurrent, threads, fn, &mLastUs);
+    mLastTotalUs = base::getHighResTimeUs() - startUs;
+    return true;
+}
+
+bool SnapshotGraph::save(base::Stream* stream, int threads) {
+    AutoLock lock(mLock);
+    std::vector<MemStream> sections;
+    sections.reserve(mDevices.size());
+    for (size_t i = 0; i < mDevices.size(); ++i) {
+        sections.emplace_back(MemStream::Layout::Segmented);
+    }
+    const std::vector<bool> active(mDevices.size(), true);
+    if (!run(active, threads, [this, &sections](size_t i) {
+            mDevices[i].save(&sections[i]);
+        })) {
+        return false;
+    }
+
+    stream->putBe32(kMagic);
+    stream->putBe32(kVersion);
+    stream->putBe32(uint32_t(mDevices.size()));
+    for (size_t i = 0; i < mDevices.size(); ++i) {
+        stream->putString(mDevices[i].name);
+        stream->putBe64(uint64_t(sections[i].writtenSize()));
+    }
+    for (const MemStream& section : sections) {
+        section.forEachSegment([stream](const char* data, size_t size) {
+            stream->write(data, size);
+        });
+    }
+    return true;
+}
+
+bool SnapshotGraph::load(base::Stream* stream, int threads) {
+    if (stream->getBe32() != kMagic || stream->getBe32() != kVersion) {
+        E("Not a device snapshot container");
+        return false;
+    }
+    const uint32_t count = stream->getBe32();
+    std::vector<std::pair<std::string, uint64_t>> index;
+    index.reserve(std::min<uint32_t>(count, 1024));
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string name = stream->getString();
+        const uint64_t size = stream->getBe64();
+        index.emplace_back(std::move(name), size);
+    }
+
+    AutoLock lock(mLock);
+    std::vector<std::unique_ptr<base::Stream>> sections(mDevices.size());
+    std::vector<bool> active(mDevices.size(), false);
+    for (const auto& entry : index) {
+        // Sections of a snapshot that is already in memory are loaded from
+        // where they are rather than from a copy.
+        std::unique_ptr<base::Stream> section;
+        if (const char* bytes = stream->readInPlace(entry.second)) {
+            auto inplace = std::make_unique<base::InplaceStream>(
+                    const_cast<char*>(bytes), entry.second);
+            inplace->advanceWrite(entry.second);
+            section = std::move(inplace);
+        } else {
+            MemStream::Buffer data(entry.second);
+            if (stream->read(data.data(), data.size()) != ssize_t(data.size())) {
+                E("Device snapshot section %s is truncated",
+                       entry.first.c_str());
+                return false;
+            }
+            section = std::make_unique<MemStream>(std::move(data));
+        }
+        for (size_t i = 0; i < mDevices.size(); ++i) {
+            if (mDevices[i].name == entry.first) {
+                sections[i] = std::move(section);
+                active[i] = true;
+                break;
+            }
+        }
+    }
+    return run(active, threads, [this, &sections](size_t i) {
+        mDevices[i].load(sections[i].get());
+    });
+}
+
+}  // namespace android
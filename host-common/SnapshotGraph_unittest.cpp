@@ -0,0 +1,143 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/SnapshotGraph.h"
+
+#include "aemu/base/files/MemStream.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace android {
+namespace {
+
+using base::MemStream;
+
+// Records the order functions ran in.
+struct Journal {
+    std::mutex mutex;
+    std::vector<std::string> order;
+
+    void add(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(name);
+    }
+    size_t position(const std::string& name) const {
+        return std::find(order.begin(), order.end(), name) - order.begin();
+    }
+};
+
+SnapshotGraph::Device device(const std::string& name,
+                             Journal* journal,
+                             std::vector<std::string> dependsOn = {},
+                             bool concurrent = true) {
+    SnapshotGraph::Device d;
+    d.name = name;
+    d.save = [name, journal](base::Stream* stream) {
+        journal->add(name);
+        stream->putString(name + "-state");
+    };
+    d.load = [name, journal](base::Stream* stream) {
+        EXPECT_EQ(name + "-state", stream->getString());
+        journal->add(name);
+    };
+    d.dependsOn = std::move(dependsOn);
+    d.concurrent = concurrent;
+    return d;
+}
+
+// Tests that every device sees its own bytes and dependencies run first,
+// in both directions.
+TEST(SnapshotGraph, SaveAndLoadInDependencyOrder) {
+    Journal saved;
+    SnapshotGraph graph;
+    ASSERT_TRUE(graph.add(device("pipes", &saved)));
+    ASSERT_TRUE(graph.add(device("address-space", &saved)));
+    ASSERT_TRUE(graph.add(device("dma", &saved, {"address-space"})));
+    ASSERT_TRUE(graph.add(device("sync", &saved, {"pipes", "dma"}, false)));
+    EXPECT_FALSE(graph.add(device("dma", &saved)));
+
+    MemStream stream;
+    ASSERT_TRUE(graph.save(&stream, 4));
+    ASSERT_EQ(4u, saved.order.size());
+    EXPECT_LT(saved.position("address-space"), saved.position("dma"));
+    EXPECT_LT(saved.position("dma"), saved.position("sync"));
+    EXPECT_LT(saved.position("pipes"), saved.position("sync"));
+    EXPECT_EQ(4u, graph.lastTimings().size());
+
+    Journal loaded;
+    SnapshotGraph other;
+    // Registration order need not match, and extra sections are skipped.
+    ASSERT_TRUE(other.add(device("sync", &loaded, {"pipes", "dma"}, false)));
+    ASSERT_TRUE(other.add(device("dma", &loaded, {"address-space"})));
+    ASSERT_TRUE(other.add(device("address-space", &loaded)));
+    ASSERT_TRUE(other.load(&stream, 4));
+    ASSERT_EQ(3u, loaded.order.size());
+    EXPECT_LT(loaded.position("address-space"), loaded.position("dma"));
+    EXPECT_LT(loaded.position("dma"), loaded.position("sync"));
+}
+
+TEST(SnapshotGraph, RejectsCycles) {
+    Journal journal;
+    SnapshotGraph graph;
+    graph.add(device("a", &journal, {"b"}));
+    graph.add(device("b", &journal, {"a"}));
+    MemStream stream;
+    EXPECT_FALSE(graph.save(&stream));
+    EXPECT_EQ(0, stream.writtenSize());
+
+    // Without "b" the dependency is simply met.
+    graph.remove("b");
+    EXPECT_TRUE(graph.save(&stream));
+    EXPECT_EQ((std::vector<std::string>{"a"}), journal.order);
+
+    MemStream garbage;
+    garbage.putBe32(1234);
+    garbage.putBe32(1);
+    EXPECT_FALSE(graph.load(&garbage));
+}
+
+// Tests that independent devices overlap instead of running back to back.
+TEST(SnapshotGraph, RunsIndependentDevicesInParallel) {
+    SnapshotGraph graph;
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    for (int i = 0; i < 4; ++i) {
+        SnapshotGraph::Device d;
+        d.name = "slow" + std::to_string(i);
+        d.save = [&running, &peak](base::Stream* stream) {
+            const int now = ++running;
+            int seen = peak.load();
+            while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            --running;
+            stream->putBe32(1);
+        };
+        d.load = [](base::Stream*) {};
+        graph.add(std::move(d));
+    }
+    MemStream stream;
+    ASSERT_TRUE(graph.save(&stream, 4));
+    EXPECT_GT(peak.load(), 1);
+    EXPECT_LT(graph.lastTotalUs(), 4 * 50000u);
+}
+
+}  // namespace
+}  // namespace android
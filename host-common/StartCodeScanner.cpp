@@ -0,0 +1,186 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/StartCodeScanner.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define START_CODE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC allows any intrinsic without per-function target flags.
+#define START_CODE_TARGET(isa)
+#else
+#define START_CODE_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define START_CODE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace android {
+namespace emulation {
+namespace {
+
+// Looks at every third byte: anything above 1 there can't be part of a
+// start code ending at it or at either of the next two bytes.
+const uint8_t* findScalar(const uint8_t* data, size_t size) {
+    size_t i = 2;
+    while (i < size) {
+        if (data[i] > 1) {
+            i += 3;
+        } else if (data[i] == 1) {
+            if (data[i - 1] == 0 && data[i - 2] == 0) {
+                return data + i - 2;
+            }
+            i += 3;
+        } else {
+            ++i;
+        }
+    }
+    return nullptr;
+}
+
+#if START_CODE_X86
+
+inline unsigned lowestBit(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Compares 16 candidate positions at once: byte 0 and 1 zero, byte 2 one.
+START_CODE_TARGET("sse2")
+const uint8_t* findSse2(const uint8_t* data, size_t size) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    size_t i = 0;
+    for (; i + 16 + 2 <= size; i += 16) {
+        const __m128i b0 = _mm_loadu_si128((const __m128i*)(data + i));
+        const __m128i b1 = _mm_loadu_si128((const __m128i*)(data + i + 1));
+        const __m128i b2 = _mm_loadu_si128((const __m128i*)(data + i + 2));
+        const __m128i hit = _mm_and_si128(
+                _mm_and_si128(_mm_cmpeq_epi8(b0, zero),
+                              _mm_cmpeq_epi8(b1, zero)),
+                _mm_cmpeq_epi8(b2, one));
+        const uint32_t mask = _mm_movemask_epi8(hit);
+        if (mask) {
+            return data + i + lowestBit(mask);
+        }
+    }
+    return findScalar(data + i, size - i);
+}
+
+START_CODE_TARGET("avx2")
+const uint8_t* findAvx2(const uint8_t* data, size_t size) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    size_t i = 0;
+    for (; i + 32 + 2 <= size; i += 32) {
+        const __m256i b0 = _mm256_loadu_si256((const __m256i*)(data + i));
+        const __m256i b1 = _mm256_loadu_si256((const __m256i*)(data + i + 1));
+        const __m256i b2 = _mm256_loadu_si256((const __m256i*)(data + i + 2));
+        const __m256i hit = _mm256_and_si256(
+                _mm256_and_si256(_mm256_cmpeq_epi8(b0, zero),
+                                 _mm256_cmpeq_epi8(b1, zero)),
+                _mm256_cmpeq_epi8(b2, one));
+        const uint32_t mask = _mm256_movemask_epi8(hit);
+        if (mask) {
+            return data + i + lowestBit(mask);
+        }
+    }
+    return findSse2(data + i, size - i);
+}
+
+bool hasAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    // AVX state must also be enabled by the OS.
+    const bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                       (_xgetbv(0) & 6) == 6;
+    if (!osAvx || maxLeaf < 7) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#elif START_CODE_NEON
+
+const uint8_t* findNeon(const uint8_t* data, size_t size) {
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t one = vdupq_n_u8(1);
+    size_t i = 0;
+    for (; i + 16 + 2 <= size; i += 16) {
+        const uint8x16_t hit = vandq_u8(
+                vandq_u8(vceqq_u8(vld1q_u8(data + i), zero),
+                         vceqq_u8(vld1q_u8(data + i + 1), zero)),
+                vceqq_u8(vld1q_u8(data + i + 2), one));
+        // Narrow to four bits per byte to get a scalar mask.
+        const uint64_t mask = vget_lane_u64(
+                vreinterpret_u64_u8(
+                        vshrn_n_u16(vreinterpretq_u16_u8(hit), 4)),
+                0);
+        if (mask) {
+            return data + i + __builtin_ctzll(mask) / 4;
+        }
+    }
+    return findScalar(data + i, size - i);
+}
+
+#endif
+
+constexpr StartCodeScanner kScalarScanner = {&findScalar, "scalar"};
+
+const StartCodeScanner& pickScanner() {
+#if START_CODE_X86
+    // SSE2 is part of x86-64; 32-bit builds without it are long gone.
+    static constexpr StartCodeScanner kSse2Scanner = {&findSse2, "sse2"};
+    static constexpr StartCodeScanner kAvx2Scanner = {&findAvx2, "avx2"};
+    return hasAvx2() ? kAvx2Scanner : kSse2Scanner;
+#elif START_CODE_NEON
+    // NEON is always there on AArch64.
+    static constexpr StartCodeScanner kNeonScanner = {&findNeon, "neon"};
+    return kNeonScanner;
+#else
+    return kScalarScanner;
+#endif
+}
+
+}  // namespace
+
+// static
+const StartCodeScanner& StartCodeScanner::get() {
+    static const StartCodeScanner& sScanner = pickScanner();
+    return sScanner;
+}
+
+// static
+const StartCodeScanner& StartCodeScanner::scalar() {
+    return kScalarScanner;
+}
+
+}  // namespace emulation
+}  // namespace android
@@ -0,0 +1,47 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/StartCodeScanner.h"
+
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+using android::emulation::StartCodeScanner;
+
+// Scans a packet with no start code in it, the worst case and about what a
+// large slice looks like; args are the packet size and whether to use the
+// dispatched scanner (1) or the scalar one (0).
+static void BM_FindStartCode(benchmark::State& state) {
+    const StartCodeScanner& scanner = state.range(1)
+                                              ? StartCodeScanner::get()
+                                              : StartCodeScanner::scalar();
+    std::vector<uint8_t> packet(state.range(0));
+    for (size_t i = 0; i < packet.size(); ++i) {
+        // Plenty of zeros and ones, as in real slice data, but only ever
+        // 00 00 02 after two zeros.
+        const size_t k = i % 8;
+        packet[i] = k < 2 ? 0 : (k == 2 ? 2 : static_cast<uint8_t>(1 + i % 3));
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scanner.find(packet.data(), packet.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * packet.size());
+    state.SetLabel(scanner.name);
+}
+
+BENCHMARK(BM_FindStartCode)
+        ->ArgsProduct({{4096, 256 * 1024, 2 * 1024 * 1024}, {0, 1}});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,80 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/StartCodeScanner.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using android::emulation::StartCodeScanner;
+
+namespace {
+
+// Slice-like payload: no two zeros in a row, so no start codes.
+std::vector<uint8_t> payload(size_t size) {
+    std::vector<uint8_t> bytes(size);
+    for (size_t i = 0; i < size; ++i) {
+        bytes[i] = static_cast<uint8_t>((i * 2654435761u) >> 24) | 1;
+        if (i % 7 == 3) {
+            bytes[i] = 0;
+        }
+    }
+    return bytes;
+}
+
+}  // namespace
+
+// Tests that the dispatched scanner agrees with the scalar one for start
+// codes at every position and offset around the vector sizes.
+TEST(StartCodeScanner, MatchesScalar) {
+    const StartCodeScanner& best = StartCodeScanner::get();
+    const StartCodeScanner& scalar = StartCodeScanner::scalar();
+    for (size_t size : {0, 1, 2, 3, 4, 15, 16, 17, 18, 31, 32, 33, 34, 35,
+                        64, 100}) {
+        SCOPED_TRACE(size);
+        const std::vector<uint8_t> empty = payload(size);
+        EXPECT_EQ(nullptr, best.find(empty.data(), size));
+        EXPECT_EQ(nullptr, scalar.find(empty.data(), size));
+
+        for (size_t pos = 0; pos + 3 <= size; ++pos) {
+            SCOPED_TRACE(pos);
+            std::vector<uint8_t> bytes = payload(size);
+            bytes[pos] = 0;
+            bytes[pos + 1] = 0;
+            bytes[pos + 2] = 1;
+            const uint8_t* expected = scalar.find(bytes.data(), size);
+            // A zero just before it makes its first zero start the match.
+            ASSERT_TRUE(expected == bytes.data() + pos ||
+                        expected == bytes.data() + pos - 1);
+            EXPECT_EQ(expected, best.find(bytes.data(), size));
+
+            // Cut the stream in the middle of it.
+            EXPECT_EQ(nullptr, best.find(bytes.data(), pos + 2));
+        }
+    }
+}
+
+// Tests runs of zeros, which defeat the skip-ahead of the scalar loop.
+TEST(StartCodeScanner, LongZeroRuns) {
+    for (size_t zeros = 2; zeros < 40; ++zeros) {
+        std::vector<uint8_t> bytes(zeros, 0);
+        bytes.push_back(1);
+        bytes.push_back(0x65);
+        EXPECT_EQ(bytes.data() + zeros - 2,
+                  StartCodeScanner::get().find(bytes.data(), bytes.size()));
+        EXPECT_EQ(bytes.data() + zeros - 2,
+                  StartCodeScanner::scalar().find(bytes.data(), bytes.size()));
+    }
+}
@@ -0,0 +1,96 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/StartupGraph.h"
+
+#include "aemu/base/system/System.h"
+#include "host-common/AndroidPipe.h"
+#include "host-common/DependencyGraph.h"
+#include "host-common/GoldfishSyncCommandQueue.h"
+#include "host-common/HostmemIdMapping.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <stdio.h>
+
+#define E(fmt, ...) \
+    fprintf(stderr, "StartupGraph: ERROR: %s: " fmt "\n", __func__, ##__VA_ARGS__);
+
+namespace android {
+
+using base::AutoLock;
+
+bool StartupGraph::add(Stage stage) {
+    AutoLock lock(mLock);
+    for (const Stage& existing : mStages) {
+        if (existing.name == stage.name) {
+            return false;
+        }
+    }
+    mStages.push_back(std::move(stage));
+    return true;
+}
+
+bool StartupGraph::run(int threads) {
+    AutoLock lock(mLock);
+    std::vector<std::string> names;
+    std::vector<const std::vector<std::string>*> dependsOn;
+    std::vector<bool> concurrent;
+    for (const Stage& stage : mStages) {
+        names.push_back(stage.name);
+        dependsOn.push_back(&stage.dependsOn);
+        concurrent.push_back(stage.concurrent);
+    }
+    std::vector<std::vector<size_t>> deps;
+    if (!resolveDependencyGraph(names, dependsOn, &deps)) {
+        E("Startup stage dependencies are circular");
+        return false;
+    }
+
+    const uint64_t startUs = base::getHighResTimeUs();
+    std::vector<uint64_t> durationsUs;
+    runDependencyGraph(deps, std::vector<bool>(mStages.size(), true), concurrent,
+                       threads, [this](size_t i) { mStages[i].init(); }, &durationsUs);
+    mLastTotalUs = base::getHighResTimeUs() - startUs;
+
+    mLastTimings.clear();
+    for (size_t i = 0; i < mStages.size(); ++i) {
+        mLastTimings.push_back({mStages[i].name, durationsUs[i]});
+    }
+    mStages.clear();
+    return true;
+}
+
+std::vector<StartupGraph::Timing> StartupGraph::lastTimings() const {
+    AutoLock lock(mLock);
+    return mLastTimings;
+}
+
+uint64_t StartupGraph::lastTotalUs() const {
+    AutoLock lock(mLock);
+    return mLastTotalUs;
+}
+
+void addHostCommonStartupStages(StartupGraph* graph, VmLock* vmLock) {
+    graph->add({"android-pipe", [vmLock] { AndroidPipe::initThreading(vmLock); }, {}, false});
+    graph->add({"goldfish-sync",
+                [vmLock] { GoldfishSyncCommandQueue::initThreading(vmLock); },
+                {},
+                false});
+    graph->add({"hostmem-id-mapping", [] { emulation::HostmemIdMapping::get(); }});
+}
+
+}  // namespace android
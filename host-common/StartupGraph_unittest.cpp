@@ -0,0 +1,90 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/StartupGraph.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+namespace android {
+namespace {
+
+// Records the order stages ran in, and on which thread.
+struct Journal {
+    std::mutex mutex;
+    std::vector<std::string> order;
+    std::vector<std::thread::id> threads;
+
+    void add(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(name);
+        threads.push_back(std::this_thread::get_id());
+    }
+    size_t position(const std::string& name) const {
+        return std::find(order.begin(), order.end(), name) - order.begin();
+    }
+};
+
+StartupGraph::Stage stage(const std::string& name,
+                          Journal* journal,
+                          std::vector<std::string> dependsOn = {},
+                          bool concurrent = true) {
+    return {name, [name, journal] { journal->add(name); }, std::move(dependsOn),
+            concurrent};
+}
+
+// Tests that stages run once each, after their dependencies, with the
+// non-concurrent ones on the calling thread, and that each gets a timing.
+TEST(StartupGraph, RunsInDependencyOrder) {
+    Journal journal;
+    StartupGraph graph;
+    EXPECT_TRUE(graph.add(stage("features", &journal)));
+    EXPECT_TRUE(graph.add(stage("pipe", &journal, {}, false)));
+    EXPECT_TRUE(graph.add(stage("address-space", &journal, {"features", "missing"})));
+    EXPECT_TRUE(graph.add(stage("media", &journal, {"address-space", "pipe"})));
+    EXPECT_FALSE(graph.add(stage("pipe", &journal)));
+
+    ASSERT_TRUE(graph.run(4));
+    ASSERT_EQ(4u, journal.order.size());
+    EXPECT_LT(journal.position("features"), journal.position("address-space"));
+    EXPECT_LT(journal.position("address-space"), journal.position("media"));
+    EXPECT_LT(journal.position("pipe"), journal.position("media"));
+    EXPECT_EQ(std::this_thread::get_id(), journal.threads[journal.position("pipe")]);
+
+    const std::vector<StartupGraph::Timing> timings = graph.lastTimings();
+    ASSERT_EQ(4u, timings.size());
+    EXPECT_EQ("features", timings[0].name);
+    EXPECT_EQ("media", timings[3].name);
+
+    // Stages only run once.
+    ASSERT_TRUE(graph.run());
+    EXPECT_EQ(4u, journal.order.size());
+    EXPECT_TRUE(graph.lastTimings().empty());
+}
+
+TEST(StartupGraph, RejectsCycles) {
+    Journal journal;
+    StartupGraph graph;
+    graph.add(stage("a", &journal, {"b"}));
+    graph.add(stage("b", &journal, {"a"}));
+    EXPECT_FALSE(graph.run());
+    EXPECT_TRUE(journal.order.empty());
+}
+
+}  // namespace
+}  // namespace android
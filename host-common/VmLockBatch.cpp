@@ -0,0 +1,92 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/VmLockBatch.h"
+
+#include <utility>
+
+namespace android {
+
+VmLockBatch::~VmLockBatch() {
+    Node* node = mHead.exchange(nullptr, std::memory_order_acquire);
+    while (node) {
+        Node* next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+// static
+VmLockBatch& VmLockBatch::get() {
+    static VmLockBatch* const sInstance = new VmLockBatch();
+    return *sInstance;
+}
+
+void VmLockBatch::setKick(Callback kick) {
+    mKick = std::move(kick);
+}
+
+void VmLockBatch::run(Callback callback) {
+    VmLock* lock = vmLock();
+    if (lock->isLockedBySelf()) {
+        callback();
+        return;
+    }
+
+    Node* node = new Node{std::move(callback),
+                          mHead.load(std::memory_order_relaxed)};
+    while (!mHead.compare_exchange_weak(node->next, node,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+    if (mArmed.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    if (mKick) {
+        mKick();
+        return;
+    }
+    ScopedVmLock vmLock(lock);
+    drain();
+}
+
+size_t VmLockBatch::drain() {
+    // Disarm first, so anything queued from here on arranges a new drain.
+    mArmed.store(false, std::memory_order_release);
+    Node* node = mHead.exchange(nullptr, std::memory_order_acquire);
+    Node* reversed = nullptr;
+    while (node) {
+        Node* next = node->next;
+        node->next = reversed;
+        reversed = node;
+        node = next;
+    }
+
+    size_t count = 0;
+    while (reversed) {
+        Node* next = reversed->next;
+        reversed->callback();
+        delete reversed;
+        reversed = next;
+        ++count;
+    }
+    if (count) {
+        mCallbacksRun.fetch_add(count, std::memory_order_relaxed);
+        mBatchesRun.fetch_add(1, std::memory_order_relaxed);
+    }
+    return count;
+}
+
+}  // namespace android
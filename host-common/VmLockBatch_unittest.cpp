@@ -0,0 +1,113 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/VmLockBatch.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace {
+
+// A real mutex that knows its owner, like the QEMU global lock.
+class MutexVmLock : public VmLock {
+public:
+    void lock() override {
+        mMutex.lock();
+        mOwner = std::this_thread::get_id();
+        ++lockCount;
+    }
+    void unlock() override {
+        mOwner = std::thread::id();
+        mMutex.unlock();
+    }
+    bool isLockedBySelf() const override {
+        return mOwner.load() == std::this_thread::get_id();
+    }
+
+    std::atomic<int> lockCount{0};
+
+private:
+    std::mutex mMutex;
+    std::atomic<std::thread::id> mOwner{};
+};
+
+// Tests that callbacks wait for the kicked drain and then run in order.
+TEST(VmLockBatch, KickAndDrain) {
+    MutexVmLock vmLock;
+    VmLockBatch batch;
+    batch.setVmLock(&vmLock);
+    int kicks = 0;
+    batch.setKick([&kicks] { ++kicks; });
+
+    std::vector<int> order;
+    for (int i = 0; i < 5; ++i) {
+        batch.run([&order, i] { order.push_back(i); });
+    }
+    EXPECT_EQ(1, kicks);
+    EXPECT_TRUE(order.empty());
+
+    {
+        ScopedVmLock lock(&vmLock);
+        EXPECT_EQ(5u, batch.drain());
+        // Already locked: no queueing.
+        batch.run([&order] { order.push_back(5); });
+    }
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5}), order);
+    EXPECT_EQ(5u, batch.callbacksRun());
+    EXPECT_EQ(1u, batch.batchesRun());
+
+    batch.run([] {});
+    EXPECT_EQ(2, kicks);
+}
+
+// Tests that without a kick the queuing threads drain for each other, with
+// every callback run under the lock.
+TEST(VmLockBatch, SelfDrain) {
+    MutexVmLock vmLock;
+    VmLockBatch batch;
+    batch.setVmLock(&vmLock);
+
+    constexpr int kThreads = 4;
+    constexpr int kPerThread = 500;
+    std::atomic<int> ran{0};
+    std::atomic<int> unlocked{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < kPerThread; ++i) {
+                batch.run([&] {
+                    if (!vmLock.isLockedBySelf()) {
+                        ++unlocked;
+                    }
+                    ++ran;
+                });
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(kThreads * kPerThread, ran.load());
+    EXPECT_EQ(0, unlocked.load());
+    EXPECT_LE(vmLock.lockCount.load(), kThreads * kPerThread);
+}
+
+}  // namespace
+}  // namespace android
@@ -0,0 +1,587 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/YuvKernels.h"
+
+#include <string.h>
+
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define YUV_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC allows any intrinsic without per-function target flags.
+#define YUV_TARGET(isa)
+#else
+#define YUV_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define YUV_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace android {
+namespace emulation {
+namespace {
+
+// Each SIMD row function handles as many whole vectors as fit in |width| and
+// returns how many samples it did; the scalar loop finishes the row.
+
+template <class T>
+void deinterleaveTail(const T* uv, T* u, T* v, int from, int width) {
+    for (int x = from; x < width; ++x) {
+        u[x] = uv[2 * x];
+        v[x] = uv[2 * x + 1];
+    }
+}
+
+template <class T>
+void interleaveTail(const T* u, const T* v, T* uv, int from, int width) {
+    for (int x = from; x < width; ++x) {
+        uv[2 * x] = u[x];
+        uv[2 * x + 1] = v[x];
+    }
+}
+
+void shiftTail(const uint16_t* src, uint16_t* dst, int from, int width, int shift) {
+    for (int x = from; x < width; ++x) {
+        dst[x] = static_cast<uint16_t>(src[x] << shift);
+    }
+}
+
+void interleaveShiftTail(const uint16_t* u, const uint16_t* v, uint16_t* uv,
+                         int from, int width, int shift) {
+    for (int x = from; x < width; ++x) {
+        uv[2 * x] = static_cast<uint16_t>(u[x] << shift);
+        uv[2 * x + 1] = static_cast<uint16_t>(v[x] << shift);
+    }
+}
+
+int noShiftRow(const uint16_t*, uint16_t*, int, int) {
+    return 0;
+}
+
+int noInterleaveShiftRow(const uint16_t*, const uint16_t*, uint16_t*, int, int) {
+    return 0;
+}
+
+template <class T>
+int noDeinterleaveRow(const T*, T*, T*, int) {
+    return 0;
+}
+
+template <class T>
+int noInterleaveRow(const T*, const T*, T*, int) {
+    return 0;
+}
+
+template <class T, int (*Row)(const T*, T*, T*, int)>
+void deinterleavePlane(const T* uv, int uvStride,
+                       T* u, int uStride,
+                       T* v, int vStride,
+                       int width, int height) {
+    for (int y = 0; y < height; ++y) {
+        const T* srcRow = uv + static_cast<ptrdiff_t>(y) * uvStride;
+        T* uRow = u + static_cast<ptrdiff_t>(y) * uStride;
+        T* vRow = v + static_cast<ptrdiff_t>(y) * vStride;
+        deinterleaveTail(srcRow, uRow, vRow, Row(srcRow, uRow, vRow, width),
+                         width);
+    }
+}
+
+template <class T, int (*Row)(const T*, const T*, T*, int)>
+void interleavePlane(const T* u, int uStride,
+                     const T* v, int vStride,
+                     T* uv, int uvStride,
+                     int width, int height) {
+    for (int y = 0; y < height; ++y) {
+        const T* uRow = u + static_cast<ptrdiff_t>(y) * uStride;
+        const T* vRow = v + static_cast<ptrdiff_t>(y) * vStride;
+        T* dstRow = uv + static_cast<ptrdiff_t>(y) * uvStride;
+        interleaveTail(uRow, vRow, dstRow, Row(uRow, vRow, dstRow, width),
+                       width);
+    }
+}
+
+template <int (*Row)(const uint16_t*, uint16_t*, int, int)>
+void shiftPlane(const uint16_t* src, int srcStride,
+                uint16_t* dst, int dstStride,
+                int width, int height, int shift) {
+    for (int y = 0; y < height; ++y) {
+        const uint16_t* srcRow = src + static_cast<ptrdiff_t>(y) * srcStride;
+        uint16_t* dstRow = dst + static_cast<ptrdiff_t>(y) * dstStride;
+        shiftTail(srcRow, dstRow, Row(srcRow, dstRow, width, shift), width, shift);
+    }
+}
+
+template <int (*Row)(const uint16_t*, const uint16_t*, uint16_t*, int, int)>
+void interleaveShiftPlane(const uint16_t* u, int uStride,
+                          const uint16_t* v, int vStride,
+                          uint16_t* uv, int uvStride,
+                          int width, int height, int shift) {
+    for (int y = 0; y < height; ++y) {
+        const uint16_t* uRow = u + static_cast<ptrdiff_t>(y) * uStride;
+        const uint16_t* vRow = v + static_cast<ptrdiff_t>(y) * vStride;
+        uint16_t* dstRow = uv + static_cast<ptrdiff_t>(y) * uvStride;
+        interleaveShiftTail(uRow, vRow, dstRow,
+                            Row(uRow, vRow, dstRow, width, shift), width, shift);
+    }
+}
+
+constexpr YuvKernels kScalarKernels = {
+        &deinterleavePlane<uint8_t, &noDeinterleaveRow<uint8_t>>,
+        &deinterleavePlane<uint16_t, &noDeinterleaveRow<uint16_t>>,
+        &interleavePlane<uint8_t, &noInterleaveRow<uint8_t>>,
+        &interleavePlane<uint16_t, &noInterleaveRow<uint16_t>>,
+        &shiftPlane<&noShiftRow>,
+        &interleaveShiftPlane<&noInterleaveShiftRow>,
+        "scalar",
+};
+
+#if YUV_KERNELS_X86
+
+YUV_TARGET("sse2")
+int deinterleaveRow8Sse2(const uint8_t* uv, uint8_t* u, uint8_t* v, int width) {
+    const __m128i mask = _mm_set1_epi16(0x00ff);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(uv + 2 * x));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(uv + 2 * x + 16));
+        const __m128i us = _mm_packus_epi16(_mm_and_si128(a, mask),
+                                            _mm_and_si128(b, mask));
+        const __m128i vs = _mm_packus_epi16(_mm_srli_epi16(a, 8),
+                                            _mm_srli_epi16(b, 8));
+        _mm_storeu_si128((__m128i*)(u + x), us);
+        _mm_storeu_si128((__m128i*)(v + x), vs);
+    }
+    return x;
+}
+
+YUV_TARGET("sse2")
+int interleaveRow8Sse2(const uint8_t* u, const uint8_t* v, uint8_t* uv, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i us = _mm_loadu_si128((const __m128i*)(u + x));
+        const __m128i vs = _mm_loadu_si128((const __m128i*)(v + x));
+        _mm_storeu_si128((__m128i*)(uv + 2 * x), _mm_unpacklo_epi8(us, vs));
+        _mm_storeu_si128((__m128i*)(uv + 2 * x + 16), _mm_unpackhi_epi8(us, vs));
+    }
+    return x;
+}
+
+YUV_TARGET("sse2")
+int interleaveRow16Sse2(const uint16_t* u, const uint16_t* v, uint16_t* uv, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m128i us = _mm_loadu_si128((const __m128i*)(u + x));
+        const __m128i vs = _mm_loadu_si128((const __m128i*)(v + x));
+        _mm_storeu_si128((__m128i*)(uv + 2 * x), _mm_unpacklo_epi16(us, vs));
+        _mm_storeu_si128((__m128i*)(uv + 2 * x + 8), _mm_unpackhi_epi16(us, vs));
+    }
+    return x;
+}
+
+YUV_TARGET("sse2")
+int shiftRowSse2(const uint16_t* src, uint16_t* dst, int width, int shift) {
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m128i s = _mm_loadu_si128((const __m128i*)(src + x));
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_sll_epi16(s, count));
+    }
+    return x;
+}
+
+YUV_TARGET("sse2")
+int interleaveShiftRowSse2(const uint16_t* u, const uint16_t* v, uint16_t* uv,
+                           int width, int shift) {
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m128i us = _mm_sll_epi16(_mm_loadu_si128((const __m128i*)(u + x)), count);
+        const __m128i vs = _mm_sll_epi16(_mm_loadu_si128((const __m128i*)(v + x)), count);
+        _mm_storeu_si128((__m128i*)(uv + 2 * x), _mm_unpacklo_epi16(us, vs));
+        _mm_storeu_si128((__m128i*)(uv + 2 * x + 8), _mm_unpackhi_epi16(us, vs));
+    }
+    return x;
+}
+
+// Needs packus_epi32, which SSE2 lacks.
+YUV_TARGET("sse4.1")
+int deinterleaveRow16Sse41(const uint16_t* uv, uint16_t* u, uint16_t* v, int width) {
+    const __m128i mask = _mm_set1_epi32(0x0000ffff);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(uv + 2 * x));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(uv + 2 * x + 8));
+        const __m128i us = _mm_packus_epi32(_mm_and_si128(a, mask),
+                                            _mm_and_si128(b, mask));
+        const __m128i vs = _mm_packus_epi32(_mm_srli_epi32(a, 16),
+                                            _mm_srli_epi32(b, 16));
+        _mm_storeu_si128((__m128i*)(u + x), us);
+        _mm_storeu_si128((__m128i*)(v + x), vs);
+    }
+    return x;
+}
+
+// The AVX2 packs and unpacks work within 128-bit lanes; the permutes put
+// the halves back in order.
+
+YUV_TARGET("avx2")
+int deinterleaveRow8Avx2(const uint8_t* uv, uint8_t* u, uint8_t* v, int width) {
+    const __m256i mask = _mm256_set1_epi16(0x00ff);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const __m256i a = _mm256_loadu_si256((const __m256i*)(uv + 2 * x));
+        const __m256i b = _mm256_loadu_si256((const __m256i*)(uv + 2 * x + 32));
+        const __m256i us = _mm256_packus_epi16(_mm256_and_si256(a, mask),
+                                               _mm256_and_si256(b, mask));
+        const __m256i vs = _mm256_packus_epi16(_mm256_srli_epi16(a, 8),
+                                               _mm256_srli_epi16(b, 8));
+        _mm256_storeu_si256((__m256i*)(u + x), _mm256_permute4x64_epi64(us, 0xd8));
+        _mm256_storeu_si256((__m256i*)(v + x), _mm256_permute4x64_epi64(vs, 0xd8));
+    }
+    return x;
+}
+
+YUV_TARGET("avx2")
+int deinterleaveRow16Avx2(const uint16_t* uv, uint16_t* u, uint16_t* v, int width) {
+    const __m256i mask = _mm256_set1_epi32(0x0000ffff);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m256i a = _mm256_loadu_si256((const __m256i*)(uv + 2 * x));
+        const __m256i b = _mm256_loadu_si256((const __m256i*)(uv + 2 * x + 16));
+        const __m256i us = _mm256_packus_epi32(_mm256_and_si256(a, mask),
+                                               _mm256_and_si256(b, mask));
+        const __m256i vs = _mm256_packus_epi32(_mm256_srli_epi32(a, 16),
+                                               _mm256_srli_epi32(b, 16));
+        _mm256_storeu_si256((__m256i*)(u + x), _mm256_permute4x64_epi64(us, 0xd8));
+        _mm256_storeu_si256((__m256i*)(v + x), _mm256_permute4x64_epi64(vs, 0xd8));
+    }
+    return x;
+}
+
+YUV_TARGET("avx2")
+int interleaveRow8Avx2(const uint8_t* u, const uint8_t* v, uint8_t* uv, int width) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const __m256i us = _mm256_loadu_si256((const __m256i*)(u + x));
+        const __m256i vs = _mm256_loadu_si256((const __m256i*)(v + x));
+        const __m256i lo = _mm256_unpacklo_epi8(us, vs);
+        const __m256i hi = _mm256_unpackhi_epi8(us, vs);
+        _mm256_storeu_si256((__m256i*)(uv + 2 * x), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(uv + 2 * x + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    return x;
+}
+
+YUV_TARGET("avx2")
+int interleaveRow16Avx2(const uint16_t* u, const uint16_t* v, uint16_t* uv, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m256i us = _mm256_loadu_si256((const __m256i*)(u + x));
+        const __m256i vs = _mm256_loadu_si256((const __m256i*)(v + x));
+        const __m256i lo = _mm256_unpacklo_epi16(us, vs);
+        const __m256i hi = _mm256_unpackhi_epi16(us, vs);
+        _mm256_storeu_si256((__m256i*)(uv + 2 * x), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(uv + 2 * x + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    return x;
+}
+
+YUV_TARGET("avx2")
+int shiftRowAvx2(const uint16_t* src, uint16_t* dst, int width, int shift) {
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m256i s = _mm256_loadu_si256((const __m256i*)(src + x));
+        _mm256_storeu_si256((__m256i*)(dst + x), _mm256_sll_epi16(s, count));
+    }
+    return x;
+}
+
+YUV_TARGET("avx2")
+int interleaveShiftRowAvx2(const uint16_t* u, const uint16_t* v, uint16_t* uv,
+                           int width, int shift) {
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m256i us = _mm256_sll_epi16(_mm256_loadu_si256((const __m256i*)(u + x)), count);
+        const __m256i vs = _mm256_sll_epi16(_mm256_loadu_si256((const __m256i*)(v + x)), count);
+        const __m256i lo = _mm256_unpacklo_epi16(us, vs);
+        const __m256i hi = _mm256_unpackhi_epi16(us, vs);
+        _mm256_storeu_si256((__m256i*)(uv + 2 * x), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(uv + 2 * x + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    return x;
+}
+
+constexpr YuvKernels kSse2Kernels = {
+        &deinterleavePlane<uint8_t, &deinterleaveRow8Sse2>,
+        &deinterleavePlane<uint16_t, &noDeinterleaveRow<uint16_t>>,
+        &interleavePlane<uint8_t, &interleaveRow8Sse2>,
+        &interleavePlane<uint16_t, &interleaveRow16Sse2>,
+        &shiftPlane<&shiftRowSse2>,
+        &interleaveShiftPlane<&interleaveShiftRowSse2>,
+        "sse2",
+};
+
+constexpr YuvKernels kSse41Kernels = {
+        &deinterleavePlane<uint8_t, &deinterleaveRow8Sse2>,
+        &deinterleavePlane<uint16_t, &deinterleaveRow16Sse41>,
+        &interleavePlane<uint8_t, &interleaveRow8Sse2>,
+        &interleavePlane<uint16_t, &interleaveRow16Sse2>,
+        &shiftPlane<&shiftRowSse2>,
+        &interleaveShiftPlane<&interleaveShiftRowSse2>,
+        "sse4.1",
+};
+
+constexpr YuvKernels kAvx2Kernels = {
+        &deinterleavePlane<uint8_t, &deinterleaveRow8Avx2>,
+        &deinterleavePlane<uint16_t, &deinterleaveRow16Avx2>,
+        &interleavePlane<uint8_t, &interleaveRow8Avx2>,
+        &interleavePlane<uint16_t, &interleaveRow16Avx2>,
+        &shiftPlane<&shiftRowAvx2>,
+        &interleaveShiftPlane<&interleaveShiftRowAvx2>,
+        "avx2",
+};
+
+struct X86Features {
+    bool sse2 = false;
+    bool sse41 = false;
+    bool avx2 = false;
+};
+
+X86Features detectX86Features() {
+    X86Features features;
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    features.sse2 = info[3] & (1 << 26);
+    features.sse41 = info[2] & (1 << 19);
+    // AVX state must also be enabled by the OS.
+    const bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                       (_xgetbv(0) & 6) == 6;
+    if (osAvx && maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        features.avx2 = info[1] & (1 << 5);
+    }
+#else
+    __builtin_cpu_init();
+    features.sse2 = __builtin_cpu_supports("sse2");
+    features.sse41 = __builtin_cpu_supports("sse4.1");
+    features.avx2 = __builtin_cpu_supports("avx2");
+#endif
+    return features;
+}
+
+const YuvKernels& pickKernels() {
+    const X86Features features = detectX86Features();
+    if (features.avx2) {
+        return kAvx2Kernels;
+    }
+    if (features.sse41) {
+        return kSse41Kernels;
+    }
+    if (features.sse2) {
+        return kSse2Kernels;
+    }
+    return kScalarKernels;
+}
+
+#elif YUV_KERNELS_NEON
+
+int deinterleaveRow8Neon(const uint8_t* uv, uint8_t* u, uint8_t* v, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const uint8x16x2_t pairs = vld2q_u8(uv + 2 * x);
+        vst1q_u8(u + x, pairs.val[0]);
+        vst1q_u8(v + x, pairs.val[1]);
+    }
+    return x;
+}
+
+int deinterleaveRow16Neon(const uint16_t* uv, uint16_t* u, uint16_t* v, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const uint16x8x2_t pairs = vld2q_u16(uv + 2 * x);
+        vst1q_u16(u + x, pairs.val[0]);
+        vst1q_u16(v + x, pairs.val[1]);
+    }
+    return x;
+}
+
+int interleaveRow8Neon(const uint8_t* u, const uint8_t* v, uint8_t* uv, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x2_t pairs;
+        pairs.val[0] = vld1q_u8(u + x);
+        pairs.val[1] = vld1q_u8(v + x);
+        vst2q_u8(uv + 2 * x, pairs);
+    }
+    return x;
+}
+
+int interleaveRow16Neon(const uint16_t* u, const uint16_t* v, uint16_t* uv, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        uint16x8x2_t pairs;
+        pairs.val[0] = vld1q_u16(u + x);
+        pairs.val[1] = vld1q_u16(v + x);
+        vst2q_u16(uv + 2 * x, pairs);
+    }
+    return x;
+}
+
+int shiftRowNeon(const uint16_t* src, uint16_t* dst, int width, int shift) {
+    const int16x8_t count = vdupq_n_s16(static_cast<int16_t>(shift));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        vst1q_u16(dst + x, vshlq_u16(vld1q_u16(src + x), count));
+    }
+    return x;
+}
+
+int interleaveShiftRowNeon(const uint16_t* u, const uint16_t* v, uint16_t* uv,
+                           int width, int shift) {
+    const int16x8_t count = vdupq_n_s16(static_cast<int16_t>(shift));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        uint16x8x2_t pairs;
+        pairs.val[0] = vshlq_u16(vld1q_u16(u + x), count);
+        pairs.val[1] = vshlq_u16(vld1q_u16(v + x), count);
+        vst2q_u16(uv + 2 * x, pairs);
+    }
+    return x;
+}
+
+constexpr YuvKernels kNeonKernels = {
+        &deinterleavePlane<uint8_t, &deinterleaveRow8Neon>,
+        &deinterleavePlane<uint16_t, &deinterleaveRow16Neon>,
+        &interleavePlane<uint8_t, &interleaveRow8Neon>,
+        &interleavePlane<uint16_t, &interleaveRow16Neon>,
+        &shiftPlane<&shiftRowNeon>,
+        &interleaveShiftPlane<&interleaveShiftRowNeon>,
+        "neon",
+};
+
+// NEON is always there on AArch64.
+const YuvKernels& pickKernels() {
+    return kNeonKernels;
+}
+
+#else
+
+const YuvKernels& pickKernels() {
+    return kScalarKernels;
+}
+
+#endif
+
+}  // namespace
+
+// static
+const YuvKernels& YuvKernels::get() {
+    static const YuvKernels& sKernels = pickKernels();
+    return sKernels;
+}
+
+// static
+const YuvKernels& YuvKernels::scalar() {
+    return kScalarKernels;
+}
+
+void yuvCopyPlane(const void* src, size_t srcStride,
+                  void* dst, size_t dstStride,
+                  size_t widthBytes, int height) {
+    if (height <= 0 || widthBytes == 0) {
+        return;
+    }
+    if (srcStride == widthBytes && dstStride == widthBytes) {
+        memcpy(dst, src, widthBytes * height);
+        return;
+    }
+    const uint8_t* srcRow = static_cast<const uint8_t*>(src);
+    uint8_t* dstRow = static_cast<uint8_t*>(dst);
+    for (int y = 0; y < height; ++y) {
+        memcpy(dstRow, srcRow, widthBytes);
+        srcRow += srcStride;
+        dstRow += dstStride;
+    }
+}
+
+size_t yuvFrameSize(YuvLayout layout, int width, int height,
+                    int bytesPerSample) {
+    const size_t bytes = layout == YuvLayout::P010 ? 2 : bytesPerSample;
+    return bytes * width * height * 3 / 2;
+}
+
+bool yuvPackFrame(const YuvPlanes& src, int width, int height,
+                  YuvLayout layout, uint8_t* dst) {
+    const bool wide = src.bytesPerSample == 2;
+    if ((layout == YuvLayout::NV12 && wide) ||
+        (layout == YuvLayout::P010 && !wide)) {
+        return false;
+    }
+    const int bytes = layout == YuvLayout::P010 ? 2 : src.bytesPerSample;
+    const size_t yStride = size_t(width) * bytes;
+    const size_t ySize = yStride * height;
+    const int chromaWidth = width / 2;
+    const int chromaHeight = height / 2;
+    const size_t chromaStride = yStride / 2;
+    const YuvKernels& kernels = YuvKernels::get();
+
+    switch (layout) {
+        case YuvLayout::I420:
+        case YuvLayout::YV12: {
+            uint8_t* u = dst + ySize;
+            uint8_t* v = dst + ySize * 5 / 4;
+            if (layout == YuvLayout::YV12) {
+                std::swap(u, v);
+            }
+            yuvCopyPlane(src.y, src.yStride, dst, yStride, yStride, height);
+            yuvCopyPlane(src.u, src.uStride, u, chromaStride,
+                         chromaWidth * bytes, chromaHeight);
+            yuvCopyPlane(src.v, src.vStride, v, chromaStride,
+                         chromaWidth * bytes, chromaHeight);
+            return true;
+        }
+        case YuvLayout::NV12:
+            yuvCopyPlane(src.y, src.yStride, dst, yStride, yStride, height);
+            kernels.interleaveUV8(static_cast<const uint8_t*>(src.u), src.uStride,
+                                  static_cast<const uint8_t*>(src.v), src.vStride,
+                                  dst + ySize, yStride, chromaWidth, chromaHeight);
+            return true;
+        case YuvLayout::P010: {
+            const int shift = 16 - src.bitDepth;
+            uint16_t* y = reinterpret_cast<uint16_t*>(dst);
+            kernels.shiftLeft16(static_cast<const uint16_t*>(src.y), src.yStride / 2,
+                                y, width, width, height, shift);
+            kernels.interleaveShiftUV16(
+                    static_cast<const uint16_t*>(src.u), src.uStride / 2,
+                    static_cast<const uint16_t*>(src.v), src.vStride / 2,
+                    y + size_t(width) * height, width, chromaWidth, chromaHeight,
+                    shift);
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace emulation
+}  // namespace android
@@ -0,0 +1,83 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/YuvKernels.h"
+
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+using android::emulation::YuvKernels;
+
+// Chroma of one frame; args are luma width and height, and whether to use
+// the dispatched kernels (1) or the scalar ones (0).
+
+template <class T>
+void runDeinterleave(benchmark::State& state,
+                     void (*YuvKernels::*kernel)(const T*, int, T*, int, T*,
+                                                 int, int, int)) {
+    const int w = state.range(0) / 2;
+    const int h = state.range(1) / 2;
+    const YuvKernels& kernels =
+            state.range(2) ? YuvKernels::get() : YuvKernels::scalar();
+    std::vector<T> uv(2 * w * h, 1), u(w * h), v(w * h);
+    for (auto _ : state) {
+        (kernels.*kernel)(uv.data(), 2 * w, u.data(), w, v.data(), w, w, h);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * uv.size() * sizeof(T));
+    state.SetLabel(kernels.name);
+}
+
+template <class T>
+void runInterleave(benchmark::State& state,
+                   void (*YuvKernels::*kernel)(const T*, int, const T*, int,
+                                               T*, int, int, int)) {
+    const int w = state.range(0) / 2;
+    const int h = state.range(1) / 2;
+    const YuvKernels& kernels =
+            state.range(2) ? YuvKernels::get() : YuvKernels::scalar();
+    std::vector<T> uv(2 * w * h), u(w * h, 1), v(w * h, 2);
+    for (auto _ : state) {
+        (kernels.*kernel)(u.data(), w, v.data(), w, uv.data(), 2 * w, w, h);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * uv.size() * sizeof(T));
+    state.SetLabel(kernels.name);
+}
+
+static void BM_DeinterleaveUV8(benchmark::State& state) {
+    runDeinterleave<uint8_t>(state, &YuvKernels::deinterleaveUV8);
+}
+
+static void BM_DeinterleaveUV16(benchmark::State& state) {
+    runDeinterleave<uint16_t>(state, &YuvKernels::deinterleaveUV16);
+}
+
+static void BM_InterleaveUV8(benchmark::State& state) {
+    runInterleave<uint8_t>(state, &YuvKernels::interleaveUV8);
+}
+
+static void BM_InterleaveUV16(benchmark::State& state) {
+    runInterleave<uint16_t>(state, &YuvKernels::interleaveUV16);
+}
+
+#define YUV_SIZES ArgsProduct({{1920}, {1080}, {0, 1}})->Args({3840, 2160, 0})->Args({3840, 2160, 1})
+
+BENCHMARK(BM_DeinterleaveUV8)->YUV_SIZES;
+BENCHMARK(BM_DeinterleaveUV16)->YUV_SIZES;
+BENCHMARK(BM_InterleaveUV8)->YUV_SIZES;
+BENCHMARK(BM_InterleaveUV16)->YUV_SIZES;
+
+BENCHMARK_MAIN();
@@ -0,0 +1,228 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/YuvKernels.h"
+
+#include "host-common/YuvConverter.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <vector>
+
+using android::emulation::YuvConverter;
+using android::emulation::YuvKernels;
+using android::emulation::YuvLayout;
+using android::emulation::YuvPlanes;
+using android::emulation::yuvCopyPlane;
+using android::emulation::yuvFrameSize;
+using android::emulation::yuvPackFrame;
+
+namespace {
+
+// Widths around the vector sizes, so the scalar tails are covered too.
+constexpr int kWidths[] = {1, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 100};
+constexpr int kHeight = 5;
+constexpr int kPad = 3;
+
+template <class T>
+std::vector<T> pattern(size_t count, int seed) {
+    std::vector<T> v(count);
+    for (size_t i = 0; i < count; ++i) {
+        v[i] = static_cast<T>(i * 2654435761u + seed);
+    }
+    return v;
+}
+
+template <class T>
+void checkAgainstScalar(
+        void (*YuvKernels::*deinterleave)(const T*, int, T*, int, T*, int, int, int),
+        void (*YuvKernels::*interleave)(const T*, int, const T*, int, T*, int, int, int)) {
+    const YuvKernels& best = YuvKernels::get();
+    const YuvKernels& scalar = YuvKernels::scalar();
+    for (int width : kWidths) {
+        SCOPED_TRACE(width);
+        const int uvStride = 2 * width + kPad;
+        const int planeStride = width + kPad;
+        const std::vector<T> uv = pattern<T>(uvStride * kHeight, 1);
+
+        std::vector<T> u1(planeStride * kHeight), v1(planeStride * kHeight);
+        std::vector<T> u2(u1), v2(v1);
+        (best.*deinterleave)(uv.data(), uvStride, u1.data(), planeStride,
+                             v1.data(), planeStride, width, kHeight);
+        (scalar.*deinterleave)(uv.data(), uvStride, u2.data(), planeStride,
+                               v2.data(), planeStride, width, kHeight);
+        EXPECT_EQ(u2, u1);
+        EXPECT_EQ(v2, v1);
+
+        std::vector<T> out1(uv.size()), out2(uv.size());
+        (best.*interleave)(u1.data(), planeStride, v1.data(), planeStride,
+                           out1.data(), uvStride, width, kHeight);
+        (scalar.*interleave)(u2.data(), planeStride, v2.data(), planeStride,
+                             out2.data(), uvStride, width, kHeight);
+        EXPECT_EQ(out2, out1);
+        for (int y = 0; y < kHeight; ++y) {
+            EXPECT_EQ(0, memcmp(uv.data() + y * uvStride,
+                                out1.data() + y * uvStride,
+                                2 * width * sizeof(T)));
+        }
+    }
+}
+
+template <class T>
+void checkConverterRoundTrip(int width, int height, int pitch) {
+    const size_t size = pitch * height * 3 / 2;
+    std::vector<T> frame = pattern<T>(size, 7);
+    const T* uv = frame.data() + pitch * height;
+
+    std::vector<T> expectedU, expectedV;
+    for (int y = 0; y < height / 2; ++y) {
+        for (int x = 0; x < width / 2; ++x) {
+            expectedU.push_back(uv[y * pitch + 2 * x]);
+            expectedV.push_back(uv[y * pitch + 2 * x + 1]);
+        }
+    }
+    const std::vector<T> original = frame;
+
+    YuvConverter<T> converter(width, height);
+    converter.UVInterleavedToPlanar(frame.data(), pitch);
+    const T* pu = frame.data() + pitch * height;
+    const T* pv = pu + pitch * height / 4;
+    for (int y = 0; y < height / 2; ++y) {
+        for (int x = 0; x < width / 2; ++x) {
+            ASSERT_EQ(expectedU[y * (width / 2) + x], pu[y * pitch / 2 + x]);
+            ASSERT_EQ(expectedV[y * (width / 2) + x], pv[y * pitch / 2 + x]);
+        }
+    }
+
+    converter.PlanarToUVInterleaved(frame.data(), pitch);
+    for (int y = 0; y < height / 2; ++y) {
+        EXPECT_EQ(0, memcmp(original.data() + pitch * height + y * pitch,
+                            frame.data() + pitch * height + y * pitch,
+                            width * sizeof(T)));
+    }
+}
+
+}  // namespace
+
+// Tests that the dispatched 8-bit kernels match the scalar ones.
+TEST(YuvKernels, MatchesScalar8) {
+    checkAgainstScalar<uint8_t>(&YuvKernels::deinterleaveUV8,
+                                &YuvKernels::interleaveUV8);
+}
+
+// Tests that the dispatched 16-bit kernels match the scalar ones.
+TEST(YuvKernels, MatchesScalar16) {
+    checkAgainstScalar<uint16_t>(&YuvKernels::deinterleaveUV16,
+                                 &YuvKernels::interleaveUV16);
+}
+
+// Tests the in-place conversions YuvConverter does, with and without padding.
+TEST(YuvKernels, ConverterRoundTrip) {
+    checkConverterRoundTrip<uint8_t>(128, 64, 128);
+    checkConverterRoundTrip<uint8_t>(100, 34, 132);
+    checkConverterRoundTrip<uint16_t>(128, 64, 128);
+    checkConverterRoundTrip<uint16_t>(100, 34, 132);
+}
+
+// Tests strided and contiguous plane copies.
+TEST(YuvKernels, CopyPlane) {
+    const std::vector<uint8_t> src = pattern<uint8_t>(40 * 4, 3);
+    std::vector<uint8_t> dst(24 * 4, 0);
+    yuvCopyPlane(src.data(), 40, dst.data(), 24, 20, 4);
+    for (int y = 0; y < 4; ++y) {
+        EXPECT_EQ(0, memcmp(src.data() + y * 40, dst.data() + y * 24, 20));
+        EXPECT_EQ(0, dst[y * 24 + 20]);
+    }
+
+    std::vector<uint8_t> flat(src.size());
+    yuvCopyPlane(src.data(), 40, flat.data(), 40, 40, 4);
+    EXPECT_EQ(src, flat);
+}
+
+// Tests that the dispatched shifting kernels match the scalar ones.
+TEST(YuvKernels, MatchesScalarShift) {
+    const YuvKernels& best = YuvKernels::get();
+    const YuvKernels& scalar = YuvKernels::scalar();
+    for (int width : kWidths) {
+        SCOPED_TRACE(width);
+        const int stride = width + kPad;
+        const std::vector<uint16_t> u = pattern<uint16_t>(stride * kHeight, 1);
+        const std::vector<uint16_t> v = pattern<uint16_t>(stride * kHeight, 2);
+
+        std::vector<uint16_t> out1(stride * kHeight), out2(out1);
+        best.shiftLeft16(u.data(), stride, out1.data(), stride, width, kHeight, 6);
+        scalar.shiftLeft16(u.data(), stride, out2.data(), stride, width, kHeight, 6);
+        EXPECT_EQ(out2, out1);
+        EXPECT_EQ(uint16_t(u[0] << 6), out1[0]);
+
+        std::vector<uint16_t> uv1(2 * stride * kHeight), uv2(uv1);
+        best.interleaveShiftUV16(u.data(), stride, v.data(), stride, uv1.data(),
+                                 2 * stride, width, kHeight, 6);
+        scalar.interleaveShiftUV16(u.data(), stride, v.data(), stride,
+                                   uv2.data(), 2 * stride, width, kHeight, 6);
+        EXPECT_EQ(uv2, uv1);
+        EXPECT_EQ(uint16_t(v[0] << 6), uv1[1]);
+    }
+}
+
+// Tests packing strided planes into each layout.
+TEST(YuvKernels, PackFrame) {
+    constexpr int kW = 6, kH = 4, kStride = 10;
+    std::vector<uint8_t> y8(kStride * kH), u8(kStride * kH / 2), v8(u8);
+    std::vector<uint16_t> y16(kStride * kH), u16(kStride * kH / 2), v16(u16);
+    for (int i = 0; i < kStride * kH; ++i) {
+        y8[i] = y16[i] = i;
+    }
+    for (int i = 0; i < kStride * kH / 2; ++i) {
+        u8[i] = u16[i] = 100 + i;
+        v8[i] = v16[i] = 200 + i;
+    }
+    const YuvPlanes planes8{y8.data(), u8.data(), v8.data(), kStride, kStride,
+                            kStride};
+    YuvPlanes planes16{y16.data(), u16.data(), v16.data(), 2 * kStride,
+                       2 * kStride, 2 * kStride};
+    planes16.bytesPerSample = 2;
+    planes16.bitDepth = 10;
+
+    std::vector<uint8_t> i420(yuvFrameSize(YuvLayout::I420, kW, kH));
+    ASSERT_TRUE(yuvPackFrame(planes8, kW, kH, YuvLayout::I420, i420.data()));
+    EXPECT_EQ(kStride + 5, i420[kW + 5]);
+    EXPECT_EQ(100 + kStride + 2, i420[kW * kH + 3 + 2]);
+    EXPECT_EQ(200 + kStride, i420[kW * kH * 5 / 4 + 3]);
+
+    std::vector<uint8_t> yv12(i420.size());
+    ASSERT_TRUE(yuvPackFrame(planes8, kW, kH, YuvLayout::YV12, yv12.data()));
+    EXPECT_EQ(200, yv12[kW * kH]);
+    EXPECT_EQ(100, yv12[kW * kH * 5 / 4]);
+
+    std::vector<uint8_t> nv12(yuvFrameSize(YuvLayout::NV12, kW, kH));
+    ASSERT_TRUE(yuvPackFrame(planes8, kW, kH, YuvLayout::NV12, nv12.data()));
+    EXPECT_EQ(100 + kStride + 1, nv12[kW * kH + kW + 2]);
+    EXPECT_EQ(200 + kStride + 1, nv12[kW * kH + kW + 3]);
+
+    std::vector<uint16_t> p010(yuvFrameSize(YuvLayout::P010, kW, kH) / 2);
+    ASSERT_TRUE(yuvPackFrame(planes16, kW, kH, YuvLayout::P010,
+                             reinterpret_cast<uint8_t*>(p010.data())));
+    EXPECT_EQ((kStride + 5) << 6, p010[kW + 5]);
+    EXPECT_EQ((100 + kStride + 1) << 6, p010[kW * kH + kW + 2]);
+    EXPECT_EQ((200 + kStride + 1) << 6, p010[kW * kH + kW + 3]);
+
+    std::vector<uint8_t> i42016(yuvFrameSize(YuvLayout::I420, kW, kH, 2));
+    ASSERT_TRUE(yuvPackFrame(planes16, kW, kH, YuvLayout::I420, i42016.data()));
+    EXPECT_EQ(100 + kStride, reinterpret_cast<uint16_t*>(i42016.data())[kW * kH + 3]);
+
+    EXPECT_FALSE(yuvPackFrame(planes8, kW, kH, YuvLayout::P010, nv12.data()));
+    EXPECT_FALSE(yuvPackFrame(planes16, kW, kH, YuvLayout::NV12, nv12.data()));
+}
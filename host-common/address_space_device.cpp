@@ -13,22 +13,38 @@
 // limitations under the License.
 #include "host-common/address_space_device.h"
 #include "host-common/AddressSpaceService.h"
+#include "host-common/GpaTranslationCache.h"
 #include "host-common/address_space_graphics.h"
 #ifndef AEMU_MIN
 #include "host-common/address_space_host_media.h"
 #endif
 #include "host-common/address_space_host_memory_allocator.h"
+#include "host-common/address_space_host_stats.h"
+#include "host-common/address_space_refcount.h"
 #include "host-common/address_space_shared_slots_host_memory_allocator.h"
 #include "host-common/vm_operations.h"
 
+#include "aemu/base/containers/ConcurrentIndexMap.h"
+#include "aemu/base/containers/FlatMap.h"
+#include "aemu/base/files/MemStream.h"
+#include "aemu/base/synchronization/EpochReclaimer.h"
 #include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/threads/FunctorThread.h"
 
+#include <atomic>
 #include <map>
-#include <unordered_map>
 #include <memory>
+#include <utility>
+#include <vector>
 
 using android::base::AutoLock;
+using android::base::ConcurrentIndexMap;
+using android::base::EpochReclaimer;
+using android::base::FlatMap;
+using android::base::FunctorThread;
 using android::base::Lock;
+using android::base::LockWait;
+using android::base::MemStream;
 using android::base::Stream;
 using android::emulation::asg::AddressSpaceGraphicsContext;
 
@@ -44,12 +60,56 @@ using namespace android::emulation;
 
 const QAndroidVmOperations* sVmOps = nullptr;
 
+namespace android {
+namespace emulation {
+
+struct AddressSpaceDeferredRestore {
+    AddressSpaceDeviceType type;
+    // What the context saved; dropped once it is restored.
+    std::vector<char> payload;
+    std::atomic<AddressSpaceContextRestore> state{AddressSpaceContextRestore::Pending};
+    // Held while restoring, so a ping and the restorer don't both do it.
+    Lock lock;
+};
+
+}  // namespace emulation
+}  // namespace android
+
 namespace {
 
+// Snapshot markers for each context.
+enum : uint8_t {
+    kContextNone = 0,
+    kContextInline = 1,
+    // The payload is prefixed with its size, so the load can set it aside.
+    kContextDeferrable = 2,
+};
+
+// Contexts whose state only matters to their own pings, so they can come
+// back after the VM resumes. Host memory allocators map guest memory that is
+// used without pinging, and refcount contexts share the counts of other
+// contexts, so those are restored during the load.
+bool restoresLazily(AddressSpaceDeviceType type) {
+    switch (type) {
+        case AddressSpaceDeviceType::Graphics:
+        case AddressSpaceDeviceType::VirtioGpuGraphics:
+        case AddressSpaceDeviceType::Media:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Guest RAM through the VMM, cached per thread.
+void* physicalMemoryGetAddrCached(uint64_t gpa) {
+    thread_local GpaTranslationCache tCache;
+    return tCache.translate(gpa, [](uint64_t addr) { return sVmOps->physicalMemoryGetAddr(addr); });
+}
+
 class AddressSpaceDeviceState {
 public:
     AddressSpaceDeviceState() = default;
-    ~AddressSpaceDeviceState() = default;
+    ~AddressSpaceDeviceState() { stopRestorer(); }
 
     uint32_t genHandle() {
         AutoLock lock(mContextsLock);
@@ -75,24 +135,26 @@ public:
         {
             AutoLock lock(mContextsLock);
 
-            auto contextDescriptionIt = mContexts.find(handle);
-            if (contextDescriptionIt == mContexts.end()) return;
-            auto& contextDescription = contextDescriptionIt->second;
+            auto contextDescription = mContexts.find(handle);
+            if (!contextDescription) return;
 
-            context = std::move(contextDescription.device_context);
+            context = std::move(contextDescription->device_context);
 
-            mContexts.erase(contextDescriptionIt);
+            mContexts.erase(handle);
         }
 
-        // Destroy `context` without holding the lock.
+        // Pings that found the handle before it was erased may still be
+        // using the context. Wait for them, then destroy `context` without
+        // holding the lock.
+        EpochReclaimer::get().synchronize();
     }
 
     void tellPingInfo(uint32_t handle, uint64_t gpa) {
         AutoLock lock(mContextsLock);
-        auto& contextDesc = mContexts[handle];
+        auto& contextDesc = descriptionLocked(handle);
         contextDesc.pingInfo =
             (AddressSpaceDevicePingInfo*)
-            sVmOps->physicalMemoryGetAddr(gpa);
+            physicalMemoryGetAddrCached(gpa);
         contextDesc.pingInfoGpa = gpa;
         AS_DEVICE_DPRINT("Ping info: gpa 0x%llx @ %p\n", (unsigned long long)gpa,
                          contextDesc.pingInfo);
@@ -100,60 +162,60 @@ public:
 
     void createInstance(const struct AddressSpaceCreateInfo& create) {
         AutoLock lock(mContextsLock);
-        auto& contextDesc = mContexts[create.handle];
+        auto& contextDesc = descriptionLocked(create.handle);
         contextDesc.device_context = buildAddressSpaceDeviceContext(create);
     }
 
+    // Pings only look the handle up, without taking mContextsLock, so pings
+    // on different handles run in parallel. The guest serializes pings on
+    // the same handle, and destroyHandle() waits for the ones in flight.
     void ping(uint32_t handle) {
-        AutoLock lock(mContextsLock);
-        auto& contextDesc = mContexts[handle];
-        AddressSpaceDevicePingInfo* pingInfo = contextDesc.pingInfo;
-
-        const uint64_t phys_addr = pingInfo->phys_addr;
-
-        AS_DEVICE_DPRINT(
-                "handle %u data 0x%llx -> %p size %llu meta 0x%llx\n", handle,
-                (unsigned long long)phys_addr,
-                sVmOps->physicalMemoryGetAddr(phys_addr),
-                (unsigned long long)pingInfo->size, (unsigned long long)pingInfo->metadata);
-
-        AddressSpaceDeviceContext *device_context = contextDesc.device_context.get();
-        if (device_context) {
-            device_context->perform(pingInfo);
-        } else {
-            // The first ioctl establishes the device type
-            struct AddressSpaceCreateInfo create = {0};
-            create.type = static_cast<AddressSpaceDeviceType>(pingInfo->metadata);
-            create.physAddr = phys_addr;
-
-            contextDesc.device_context = buildAddressSpaceDeviceContext(create);
-            pingInfo->metadata = contextDesc.device_context ? 0 : -1;
-        }
+        withDescription(handle, [this, handle](AddressSpaceContextDescription& contextDesc) {
+            performPing(handle, contextDesc, contextDesc.pingInfo);
+        });
     }
 
     void pingAtHva(uint32_t handle, AddressSpaceDevicePingInfo* pingInfo) {
-        AutoLock lock(mContextsLock);
-        auto& contextDesc = mContexts[handle];
-
-        const uint64_t phys_addr = pingInfo->phys_addr;
+        withDescription(handle, [this, handle, pingInfo](AddressSpaceContextDescription& contextDesc) {
+            performPing(handle, contextDesc, pingInfo);
+        });
+    }
 
-        AS_DEVICE_DPRINT(
-                "handle %u data 0x%llx -> %p size %llu meta 0x%llx\n", handle,
-                (unsigned long long)phys_addr,
-                sVmOps->physicalMemoryGetAddr(phys_addr),
-                (unsigned long long)pingInfo->size, (unsigned long long)pingInfo->metadata);
+    // Drains every entry the guest has queued on |ring| with one lookup,
+    // instead of one ping exit per entry.
+    void pingBatch(uint32_t handle, AddressSpaceDevicePingRing* ring) {
+        if (!ring) return;
+        const uint32_t capacity = ring->capacity;
+        if (!capacity || (capacity & (capacity - 1))) {
+            fprintf(stderr, "%s: handle %u: bad ring capacity %u\n", __func__,
+                    handle, capacity);
+            return;
+        }
 
-        AddressSpaceDeviceContext *device_context = contextDesc.device_context.get();
-        if (device_context) {
-            device_context->perform(pingInfo);
-        } else {
-            struct AddressSpaceCreateInfo create = {0};
-            create.type = static_cast<AddressSpaceDeviceType>(pingInfo->metadata);
-            create.physAddr = phys_addr;
+        withDescription(handle, [this, handle, ring, capacity](
+                                        AddressSpaceContextDescription& contextDesc) {
+            AddressSpaceDevicePingInfo* entries = ring->entries();
+
+            // Entries the guest queues while these run are picked up too.
+            uint32_t tail = ring->tail;
+            for (;;) {
+                const uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+                if (tail == head) break;
+                if (head - tail > capacity) {
+                    fprintf(stderr, "pingBatch: handle %u: ring overrun (head %u tail %u)\n",
+                            handle, head, tail);
+                    break;
+                }
+                for (; tail != head; ++tail) {
+                    performPing(handle, contextDesc, &entries[tail & (capacity - 1)]);
+                }
+                __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+            }
+        });
+    }
 
-            contextDesc.device_context = buildAddressSpaceDeviceContext(create);
-            pingInfo->metadata = contextDesc.device_context ? 0 : -1;
-        }
+    void pingBatchAtGpa(uint32_t handle, uint64_t gpa) {
+        pingBatch(handle, (AddressSpaceDevicePingRing*)physicalMemoryGetAddrCached(gpa));
     }
 
     void registerDeallocationCallback(uint64_t gpa, void* context, address_space_device_deallocation_callback_t func) {
@@ -184,11 +246,11 @@ public:
     }
 
     AddressSpaceDeviceContext* handleToContext(uint32_t handle) {
-        AutoLock lock(mContextsLock);
-        if (mContexts.find(handle) == mContexts.end()) return nullptr;
+        if (!restoreHandle(handle)) return nullptr;
 
-        auto& contextDesc = mContexts[handle];
-        return contextDesc.device_context.get();
+        EpochReclaimer::ReadScope scope;
+        auto contextDesc = mContexts.find(handle);
+        return contextDesc ? contextDesc->device_context.get() : nullptr;
     }
 
     uint64_t hostmemRegister(const struct MemEntry *entry) {
@@ -199,15 +261,18 @@ public:
         sVmOps->hostmemUnregister(id);
     }
 
-    void save(Stream* stream) const {
+    void save(Stream* stream) {
+        // Pending contexts are saved as they were loaded; keep the restorer
+        // from changing them underneath.
+        const bool restoring = stopRestorer();
+
         // Pre-save
-        for (const auto &kv : mContexts) {
-            const AddressSpaceContextDescription &desc = kv.second;
+        mContexts.forEach([](uint32_t, const AddressSpaceContextDescription& desc) {
             const AddressSpaceDeviceContext *device_context = desc.device_context.get();
             if (device_context) {
                 device_context->preSave();
             }
-        }
+        });
 
         AddressSpaceGraphicsContext::globalStatePreSave();
 
@@ -218,33 +283,50 @@ public:
         stream->putBe32(mHandleIndex);
         stream->putBe32(mContexts.size());
 
-        for (const auto &kv : mContexts) {
-            const uint32_t handle = kv.first;
-            const AddressSpaceContextDescription &desc = kv.second;
+        mContexts.forEach([stream](uint32_t handle,
+                                   const AddressSpaceContextDescription& desc) {
             const AddressSpaceDeviceContext *device_context = desc.device_context.get();
 
             stream->putBe32(handle);
             stream->putBe64(desc.pingInfoGpa);
 
-            if (device_context) {
-                stream->putByte(1);
+            const AddressSpaceDeferredRestore* pending = desc.deferredRestore.get();
+            if (pending && pending->state == AddressSpaceContextRestore::Pending) {
+                stream->putByte(kContextDeferrable);
+                stream->putBe32(pending->type);
+                stream->putBe32(pending->payload.size());
+                stream->write(pending->payload.data(), pending->payload.size());
+            } else if (device_context && restoresLazily(device_context->getDeviceType())) {
+                MemStream payload;
+                device_context->save(&payload);
+                stream->putByte(kContextDeferrable);
+                stream->putBe32(device_context->getDeviceType());
+                stream->putBe32(payload.writtenSize());
+                payload.forEachSegment([stream](const char* data, size_t size) {
+                    stream->write(data, size);
+                });
+            } else if (device_context) {
+                stream->putByte(kContextInline);
                 stream->putBe32(device_context->getDeviceType());
                 device_context->save(stream);
             } else {
-                stream->putByte(0);
+                stream->putByte(kContextNone);
             }
-        }
+        });
 
         // Post save
 
         AddressSpaceGraphicsContext::globalStatePostSave();
 
-        for (const auto &kv : mContexts) {
-            const AddressSpaceContextDescription &desc = kv.second;
+        mContexts.forEach([](uint32_t, const AddressSpaceContextDescription& desc) {
             const AddressSpaceDeviceContext *device_context = desc.device_context.get();
             if (device_context) {
                 device_context->postSave();
             }
+        });
+
+        if (restoring) {
+            startRestorer();
         }
     }
 
@@ -252,6 +334,10 @@ public:
         mLoadResources = std::move(resources);
     }
 
+    void setLazyRestore(bool enabled) {
+        mLazyRestore = enabled;
+    }
+
     bool load(Stream* stream) {
         // First destroy all contexts, because
         // this can be done while an emulator is running
@@ -273,17 +359,18 @@ public:
         const uint32_t handleIndex = stream->getBe32();
         const size_t size = stream->getBe32();
 
-        Contexts contexts;
+        std::vector<std::pair<uint32_t, AddressSpaceContextDescription>> contexts;
         for (size_t i = 0; i < size; ++i) {
             const uint32_t handle = stream->getBe32();
             const uint64_t pingInfoGpa = stream->getBe64();
 
             std::unique_ptr<AddressSpaceDeviceContext> context;
+            std::shared_ptr<AddressSpaceDeferredRestore> deferred;
             switch (stream->getByte()) {
-            case 0:
+            case kContextNone:
                 break;
 
-            case 1: {
+            case kContextInline: {
                 struct AddressSpaceCreateInfo create = {0};
                 create.type = static_cast<AddressSpaceDeviceType>(stream->getBe32());
                 create.physAddr = pingInfoGpa;
@@ -296,33 +383,87 @@ public:
                 }
                 break;
 
+            case kContextDeferrable: {
+                deferred = std::make_shared<AddressSpaceDeferredRestore>();
+                deferred->type = static_cast<AddressSpaceDeviceType>(stream->getBe32());
+                deferred->payload.resize(stream->getBe32());
+                if (stream->read(deferred->payload.data(), deferred->payload.size()) !=
+                    static_cast<ssize_t>(deferred->payload.size())) {
+                    return false;
+                }
+                mPendingHandles.push_back(handle);
+                break;
+            }
+
             default:
                 return false;
             }
 
-            auto &desc = contexts[handle];
+            contexts.emplace_back(handle, AddressSpaceContextDescription());
+            auto &desc = contexts.back().second;
             desc.pingInfoGpa = pingInfoGpa;
             if (desc.pingInfoGpa == ~0ULL) {
                 fprintf(stderr, "%s: warning: restoring hva-only ping\n", __func__);
             } else {
                 desc.pingInfo = (AddressSpaceDevicePingInfo*)
-                    sVmOps->physicalMemoryGetAddr(pingInfoGpa);
+                    physicalMemoryGetAddrCached(pingInfoGpa);
             }
             desc.device_context = std::move(context);
+            desc.deferredRestore = std::move(deferred);
         }
 
         {
            AutoLock lock(mContextsLock);
            mHandleIndex = handleIndex;
-           mContexts = std::move(contexts);
+           for (auto& kv : contexts) {
+               descriptionLocked(kv.first) = std::move(kv.second);
+           }
         }
 
+        if (!mLazyRestore) {
+            return finishRestore() == 0;
+        }
+        startRestorer();
         return true;
     }
 
+    AddressSpaceContextRestore restoreState(uint32_t handle) {
+        EpochReclaimer::ReadScope scope;
+        auto contextDesc = mContexts.find(handle);
+        if (!contextDesc || !contextDesc->deferredRestore) {
+            return AddressSpaceContextRestore::Immediate;
+        }
+        return contextDesc->deferredRestore->state.load(std::memory_order_acquire);
+    }
+
+    // Restores what the restorer hasn't got to yet on this thread.
+    int finishRestore() {
+        stopRestorer();
+        int failed = 0;
+        for (uint32_t handle : mPendingHandles) {
+            if (!restoreHandle(handle)) ++failed;
+        }
+        mPendingHandles.clear();
+        return failed;
+    }
+
     void clear() {
+        stopRestorer();
+        mPendingHandles.clear();
+
+        std::vector<std::unique_ptr<AddressSpaceDeviceContext>> contexts;
+        {
+            AutoLock lock(mContextsLock);
+            mContexts.forEach([&contexts](uint32_t, AddressSpaceContextDescription& desc) {
+                contexts.push_back(std::move(desc.device_context));
+            });
+            mContexts.clear();
+        }
+        // As in destroyHandle(), and before the shared slots they may own go.
+        EpochReclaimer::get().synchronize();
+        contexts.clear();
+
         AutoLock lock(mContextsLock);
-        mContexts.clear();
         AddressSpaceSharedSlotsHostMemoryAllocatorContext::globalStateClear();
         std::vector<std::pair<uint64_t, uint64_t>> gpasSizesToErase;
         for (auto& mapping : mMemoryMappings) {
@@ -351,11 +492,194 @@ public:
         return getHostPtrLocked(gpa);
     }
 
+    void *getHostRange(uint64_t gpa, uint64_t *rangeGpa, uint64_t *rangeSize) const {
+        AutoLock lock(mMemoryMappingsLock);
+        auto i = mMemoryMappings.upper_bound(gpa);  // i->first > gpa
+        if (i == mMemoryMappings.begin()) {
+            return nullptr;
+        }
+        --i;
+        if (gpa - i->first >= i->second.second) {
+            return nullptr;
+        }
+        *rangeGpa = i->first;
+        *rangeSize = i->second.second;
+        return static_cast<char *>(i->second.first) + (gpa - i->first);
+    }
+
 private:
-    mutable Lock mContextsLock;
+    // The deferred restore of |contextDesc| if it hasn't happened yet, and
+    // the ping info gpa to restore it with. Must be called under a ReadScope.
+    static std::shared_ptr<AddressSpaceDeferredRestore> pendingRestore(
+            const AddressSpaceContextDescription& contextDesc, uint64_t* physAddr) {
+        const auto& pending = contextDesc.deferredRestore;
+        if (!pending || pending->state.load(std::memory_order_acquire) !=
+                                AddressSpaceContextRestore::Pending) {
+            return nullptr;
+        }
+        *physAddr = contextDesc.pingInfoGpa;
+        return pending;
+    }
+
+    // Whether |contextDesc|'s context was deferred and failed to restore.
+    // Must be called under a ReadScope.
+    static bool restoreFailed(const AddressSpaceContextDescription& contextDesc) {
+        const auto& pending = contextDesc.deferredRestore;
+        return pending && pending->state.load(std::memory_order_acquire) ==
+                                  AddressSpaceContextRestore::Failed;
+    }
+
+    // Restores |pending|, which belongs to |handle|, unless another thread
+    // got there first. Must not be called under a ReadScope: graphics
+    // contexts start threads and restore renderer state here, and that
+    // would hold up every destroyHandle() and clear() meanwhile. False if
+    // the context failed to restore.
+    bool restore(uint32_t handle, AddressSpaceDeferredRestore& pending, uint64_t physAddr) {
+        AutoLock restoreLock(pending.lock);
+        AddressSpaceContextRestore state = pending.state.load(std::memory_order_relaxed);
+        if (state != AddressSpaceContextRestore::Pending) {
+            return state == AddressSpaceContextRestore::Restored;
+        }
+
+        struct AddressSpaceCreateInfo create = {0};
+        create.type = pending.type;
+        create.physAddr = physAddr;
+        create.fromSnapshot = true;
+
+        std::unique_ptr<AddressSpaceDeviceContext> context =
+            buildAddressSpaceDeviceContext(create);
+        MemStream stream(std::move(pending.payload));
+        const bool ok = context && context->load(&stream);
+        if (ok) {
+            // Writers hold mContextsLock, so the lookup needs no ReadScope.
+            AutoLock lock(mContextsLock);
+            // Unless the handle was destroyed meanwhile.
+            auto contextDesc = mContexts.find(handle);
+            if (contextDesc && contextDesc->deferredRestore.get() == &pending) {
+                contextDesc->device_context = std::move(context);
+            }
+        } else {
+            AS_DEVICE_DPRINT("handle %u: failed to restore a context of type %u", handle,
+                             static_cast<uint32_t>(pending.type));
+        }
+        pending.state.store(ok ? AddressSpaceContextRestore::Restored
+                               : AddressSpaceContextRestore::Failed,
+                            std::memory_order_release);
+        return ok;
+    }
+
+    // Restores |handle|'s context if that was deferred and hasn't happened
+    // yet. False if the context failed to restore.
+    bool restoreHandle(uint32_t handle) {
+        std::shared_ptr<AddressSpaceDeferredRestore> pending;
+        uint64_t physAddr = 0;
+        {
+            EpochReclaimer::ReadScope scope;
+            auto contextDesc = mContexts.find(handle);
+            if (!contextDesc) return true;
+            pending = pendingRestore(*contextDesc, &physAddr);
+            if (!pending) return !restoreFailed(*contextDesc);
+        }
+        return restore(handle, *pending, physAddr);
+    }
+
+    // Runs |fn| on the description for |handle| under a ReadScope, once
+    // its context is restored. The restore itself runs outside the scope.
+    template <class Fn>
+    void withDescription(uint32_t handle, Fn&& fn) {
+        std::shared_ptr<AddressSpaceDeferredRestore> pending;
+        uint64_t physAddr = 0;
+        {
+            EpochReclaimer::ReadScope scope;
+            auto& contextDesc = description(handle);
+            pending = pendingRestore(contextDesc, &physAddr);
+            if (!pending) {
+                fn(contextDesc);
+                return;
+            }
+        }
+        restore(handle, *pending, physAddr);
+
+        EpochReclaimer::ReadScope scope;
+        fn(description(handle));
+    }
+
+    // Restores the pending contexts in the background, in handle order,
+    // until they are all done or stopRestorer() is called.
+    void startRestorer() {
+        if (mPendingHandles.empty()) return;
+        mStopRestorer = false;
+        mRestorer.reset(new FunctorThread([this, handles = mPendingHandles] {
+            for (uint32_t handle : handles) {
+                if (mStopRestorer.load(std::memory_order_relaxed)) return;
+                restoreHandle(handle);
+            }
+        }));
+        mRestorer->start();
+    }
+
+    // Returns whether a restorer was running; it stops after the context it
+    // is on.
+    bool stopRestorer() {
+        if (!mRestorer) return false;
+        mStopRestorer = true;
+        mRestorer->wait();
+        mRestorer.reset();
+        return true;
+    }
+
+    void performPing(uint32_t handle,
+                     AddressSpaceContextDescription& contextDesc,
+                     AddressSpaceDevicePingInfo* pingInfo) {
+        if (restoreFailed(contextDesc)) {
+            pingInfo->metadata = -1;
+            return;
+        }
+
+        const uint64_t phys_addr = pingInfo->phys_addr;
+
+        AS_DEVICE_DPRINT(
+                "handle %u data 0x%llx -> %p size %llu meta 0x%llx\n", handle,
+                (unsigned long long)phys_addr,
+                sVmOps->physicalMemoryGetAddr(phys_addr),
+                (unsigned long long)pingInfo->size, (unsigned long long)pingInfo->metadata);
+
+        AddressSpaceDeviceContext *device_context = contextDesc.device_context.get();
+        if (device_context) {
+            device_context->perform(pingInfo);
+        } else {
+            // The first ioctl establishes the device type
+            struct AddressSpaceCreateInfo create = {0};
+            create.type = static_cast<AddressSpaceDeviceType>(pingInfo->metadata);
+            create.physAddr = phys_addr;
+
+            AutoLock lock(mContextsLock);
+            contextDesc.device_context = buildAddressSpaceDeviceContext(create);
+            pingInfo->metadata = contextDesc.device_context ? 0 : -1;
+        }
+    }
+
+    // Guards everything below that changes mContexts, and the deallocation
+    // callbacks. Lookups in mContexts don't take it.
+    mutable Lock mContextsLock{"address_space_device.mContextsLock",
+                               LockWait::SpinThenPark};
     uint32_t mHandleIndex = 1;
-    typedef std::unordered_map<uint32_t, AddressSpaceContextDescription> Contexts;
-    Contexts mContexts;
+    ConcurrentIndexMap<AddressSpaceContextDescription> mContexts;
+
+    // The description for |handle|, which must be used under a ReadScope.
+    // Like the std::unordered_map::operator[] this replaces, adds an empty
+    // one if the handle is unknown.
+    AddressSpaceContextDescription& description(uint32_t handle) {
+        auto contextDesc = mContexts.find(handle);
+        if (contextDesc) return *contextDesc;
+
+        AutoLock lock(mContextsLock);
+        return descriptionLocked(handle);
+    }
+
+    AddressSpaceContextDescription& descriptionLocked(uint32_t handle) {
+        return *mContexts.emplace(handle).first;
+    }
 
     std::unique_ptr<AddressSpaceDeviceContext> buildAddressSpaceDeviceContext(
         const struct AddressSpaceCreateInfo& create) {
@@ -385,6 +709,13 @@ private:
             return DeviceContextPtr(new AddressSpaceSharedSlotsHostMemoryAllocatorContext(
                 get_address_space_device_control_ops(),
                 get_address_space_device_hw_funcs()));
+        case AddressSpaceDeviceType::Refcount:
+            return DeviceContextPtr(new AddressSpaceRefcountContext(
+                get_address_space_device_control_ops()));
+        case AddressSpaceDeviceType::HostStats:
+            return DeviceContextPtr(new AddressSpaceHostStatsContext(
+                get_address_space_device_control_ops(),
+                get_address_space_device_hw_funcs()));
 
         case AddressSpaceDeviceType::VirtioGpuGraphics:
             asg::AddressSpaceGraphicsContext::init(get_address_space_device_control_ops());
@@ -399,6 +730,7 @@ private:
     bool addMemoryMappingLocked(uint64_t gpa, void *ptr, uint64_t size) {
         if (mMemoryMappings.insert({gpa, {ptr, size}}).second) {
             sVmOps->mapUserBackedRam(gpa, ptr, size);
+            GpaTranslationCache::invalidateAll();
             return true;
         } else {
             fprintf(stderr, "%s: failed: hva %p -> gpa [0x%llx 0x%llx]\n", __func__,
@@ -412,6 +744,7 @@ private:
     bool removeMemoryMappingLocked(uint64_t gpa, uint64_t size) {
         if (mMemoryMappings.erase(gpa) > 0) {
             sVmOps->unmapUserBackedRam(gpa, size);
+            GpaTranslationCache::invalidateAll();
             return true;
         } else {
             fprintf(stderr, "%s: failed: gpa [0x%llx 0x%llx]\n", __func__,
@@ -441,7 +774,7 @@ private:
     }
 
     mutable Lock mMemoryMappingsLock;
-    std::map<uint64_t, std::pair<void *, uint64_t>> mMemoryMappings;  // do not save/load
+    FlatMap<uint64_t, std::pair<void *, uint64_t>> mMemoryMappings;  // do not save/load
 
     struct DeallocationCallbackEntry {
         void* context;
@@ -452,6 +785,12 @@ private:
 
     // Not saved/loaded. Externally owned resources used during load.
     std::optional<AddressSpaceDeviceLoadResources> mLoadResources;
+
+    // Deferred restores from the last load; see restoresLazily().
+    bool mLazyRestore = true;
+    std::vector<uint32_t> mPendingHandles;
+    std::unique_ptr<FunctorThread> mRestorer;
+    std::atomic<bool> mStopRestorer{false};
 };
 
 static AddressSpaceDeviceState* sAddressSpaceDeviceState() {
@@ -489,7 +828,14 @@ int sAddressSpaceDeviceRemoveMemoryMapping(uint64_t gpa, void *ptr, uint64_t siz
 }
 
 void* sAddressSpaceDeviceGetHostPtr(uint64_t gpa) {
-    return sAddressSpaceDeviceState()->getHostPtr(gpa);
+    thread_local GpaTranslationCache tCache;
+    return tCache.translate(gpa, [](uint64_t addr) {
+        return sAddressSpaceDeviceState()->getHostPtr(addr);
+    });
+}
+
+void* sAddressSpaceDeviceGetHostRange(uint64_t gpa, uint64_t* rangeGpa, uint64_t* rangeSize) {
+    return sAddressSpaceDeviceState()->getHostRange(gpa, rangeGpa, rangeSize);
 }
 
 static void* sAddressSpaceHandleToContext(uint32_t handle) {
@@ -513,6 +859,15 @@ static void sAddressSpaceDevicePingAtHva(uint32_t handle, void* hva) {
         handle, (AddressSpaceDevicePingInfo*)hva);
 }
 
+static void sAddressSpaceDevicePingBatch(uint32_t handle, uint64_t gpa) {
+    sAddressSpaceDeviceState()->pingBatchAtGpa(handle, gpa);
+}
+
+static void sAddressSpaceDevicePingBatchAtHva(uint32_t handle, void* hva) {
+    sAddressSpaceDeviceState()->pingBatch(
+        handle, (AddressSpaceDevicePingRing*)hva);
+}
+
 static void sAddressSpaceDeviceRegisterDeallocationCallback(
     void* context, uint64_t gpa, address_space_device_deallocation_callback_t func) {
     sAddressSpaceDeviceState()->registerDeallocationCallback(gpa, context, func);
@@ -548,6 +903,9 @@ static struct address_space_device_control_ops sAddressSpaceDeviceOps = {
     &sAddressSpaceDeviceRunDeallocationCallbacks,      // run_deallocation_callbacks
     &sAddressSpaceDeviceControlGetHwFuncs,             // control_get_hw_funcs
     &sAddressSpaceDeviceCreateInstance,                // create_instance
+    &sAddressSpaceDevicePingBatch,                     // ping_batch
+    &sAddressSpaceDevicePingBatchAtHva,                // ping_batch_at_hva
+    &sAddressSpaceDeviceGetHostRange,                  // get_host_range
 };
 
 struct address_space_device_control_ops* get_address_space_device_control_ops(void) {
@@ -569,6 +927,11 @@ const struct AddressSpaceHwFuncs* get_address_space_device_hw_funcs(void) {
 
 void address_space_set_vm_operations(const QAndroidVmOperations* vmops) {
     sVmOps = vmops;
+    GpaTranslationCache::invalidateAll();
+}
+
+void address_space_invalidate_translations(void) {
+    GpaTranslationCache::invalidateAll();
 }
 
 } // extern "C"
@@ -578,6 +941,7 @@ namespace emulation {
 
 void goldfish_address_space_set_vm_operations(const QAndroidVmOperations* vmops) {
     sVmOps = vmops;
+    GpaTranslationCache::invalidateAll();
 }
 
 const QAndroidVmOperations* goldfish_address_space_get_vm_operations() {
@@ -599,5 +963,18 @@ int goldfish_address_space_memory_state_save(android::base::Stream *stream) {
     return 0;
 }
 
+AddressSpaceContextRestore goldfish_address_space_context_restore_state(
+    uint32_t handle) {
+    return sAddressSpaceDeviceState()->restoreState(handle);
+}
+
+int goldfish_address_space_memory_state_finish_restore() {
+    return sAddressSpaceDeviceState()->finishRestore();
+}
+
+void goldfish_address_space_memory_state_set_lazy_restore(bool enabled) {
+    sAddressSpaceDeviceState()->setLazyRestore(enabled);
+}
+
 }  // namespace emulation
 }  // namespace android
@@ -0,0 +1,86 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures address space device ping throughput as the number of threads
+// pinging their own handles (one per vCPU, say) grows.
+
+#include "host-common/AddressSpaceService.h"
+#include "host-common/address_space_device.h"
+#include "host-common/address_space_shared_slots_host_memory_allocator.h"
+
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+using android::emulation::AddressSpaceDevicePingInfo;
+using android::emulation::AddressSpaceDevicePingRing;
+using android::emulation::AddressSpaceDeviceType;
+using android::emulation::AddressSpaceSharedSlotsHostMemoryAllocatorContext;
+
+void BM_PingAtHva(benchmark::State& state) {
+    address_space_device_control_ops* ops = get_address_space_device_control_ops();
+    const uint32_t handle = ops->gen_handle();
+
+    // The first ping on a handle creates its context.
+    AddressSpaceDevicePingInfo info = {};
+    info.metadata = static_cast<uint64_t>(
+        AddressSpaceDeviceType::SharedSlotsHostMemoryAllocator);
+    ops->ping_at_hva(handle, &info);
+
+    while (state.KeepRunning()) {
+        info.metadata = static_cast<uint64_t>(
+            AddressSpaceSharedSlotsHostMemoryAllocatorContext::
+                HostMemoryAllocatorCommand::CheckIfSharedSlotsSupported);
+        ops->ping_at_hva(handle, &info);
+    }
+
+    ops->destroy_handle(handle);
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_PingAtHva)->ThreadRange(1, 16)->UseRealTime();
+
+// The same command, queued |range(0)| at a time on a ping ring.
+void BM_PingBatchAtHva(benchmark::State& state) {
+    address_space_device_control_ops* ops = get_address_space_device_control_ops();
+    const uint32_t handle = ops->gen_handle();
+    const uint32_t batch = static_cast<uint32_t>(state.range(0));
+
+    AddressSpaceDevicePingInfo info = {};
+    info.metadata = static_cast<uint64_t>(
+        AddressSpaceDeviceType::SharedSlotsHostMemoryAllocator);
+    ops->ping_at_hva(handle, &info);
+
+    std::vector<uint64_t> storage(
+        (sizeof(AddressSpaceDevicePingRing) +
+         batch * sizeof(AddressSpaceDevicePingInfo)) / sizeof(uint64_t));
+    auto ring = reinterpret_cast<AddressSpaceDevicePingRing*>(storage.data());
+    ring->capacity = batch;
+
+    while (state.KeepRunning()) {
+        for (uint32_t i = 0; i < batch; ++i) {
+            ring->entries()[i].metadata = static_cast<uint64_t>(
+                AddressSpaceSharedSlotsHostMemoryAllocatorContext::
+                    HostMemoryAllocatorCommand::CheckIfSharedSlotsSupported);
+        }
+        ring->head += batch;
+        ops->ping_batch_at_hva(handle, ring);
+    }
+
+    ops->destroy_handle(handle);
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+BENCHMARK(BM_PingBatchAtHva)->RangeMultiplier(4)->Range(1, 64);
+BENCHMARK_MAIN();
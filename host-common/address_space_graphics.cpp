@@ -14,13 +14,23 @@
 
 #include "host-common/address_space_graphics.h"
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 #include <optional>
+#include <vector>
 
-#include "aemu/base/AlignedBuf.h"
 #include "aemu/base/SubAllocator.h"
+#include "aemu/base/Tracing.h"
+#ifdef AEMU_BASE_USE_LZ4
+#include "aemu/base/files/CompressingStream.h"
+#include "aemu/base/files/DecompressingStream.h"
+#endif
+#include "aemu/base/memory/BlockMemory.h"
 #include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/threads/ParallelFor.h"
 #include "host-common/GfxstreamFatalError.h"
+#include "host-common/GpaTranslationCache.h"
 #include "host-common/address_space_device.h"
 #include "host-common/address_space_device.hpp"
 #include "host-common/crash-handler.h"
@@ -37,6 +47,12 @@
 #endif
 
 using android::base::AutoLock;
+#ifdef AEMU_BASE_USE_LZ4
+using android::base::CodecOptions;
+using android::base::CompressingStream;
+using android::base::DecompressingStream;
+using android::base::PayloadClass;
+#endif
 using android::base::Lock;
 using android::base::SubAllocator;
 using emugl::ABORT_REASON_OTHER;
@@ -66,8 +82,51 @@ struct Block {
     bool usesVirtioGpuHostmem = false;
     uint64_t hostmemId = 0;
     bool external = false;
+    // Backs |buffer| unless external.
+    android::base::BlockMemory memory;
+};
+
+// How a saved block is stored.
+enum BlockSaveFormat : uint32_t {
+    kBlockEmpty = 0,
+    // Contents follow the block's metadata; older snapshots only.
+    kBlockInline = 1,
+    // Contents are in the compressed page section after all blocks.
+    kBlockPaged = 2,
 };
 
+static constexpr size_t kPagesPerBlock =
+        ADDRESS_SPACE_GRAPHICS_BLOCK_SIZE / ADDRESS_SPACE_GRAPHICS_PAGE_SIZE;
+
+static bool isZeroPage(const char* page) {
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(page);
+    for (size_t i = 0; i < ADDRESS_SPACE_GRAPHICS_PAGE_SIZE / sizeof(uint64_t);
+         ++i) {
+        if (words[i]) return false;
+    }
+    return true;
+}
+
+static bool pageIsSet(const std::vector<uint8_t>& bitmap, size_t page) {
+    return bitmap[page / 8] & (1 << (page % 8));
+}
+
+// Calls |func| with each run of pages in |bitmap| that are all set or all
+// clear: func(firstPage, pageCount, set).
+template <class Func>
+static void forEachPageRun(const std::vector<uint8_t>& bitmap, Func&& func) {
+    size_t page = 0;
+    while (page < kPagesPerBlock) {
+        const bool set = pageIsSet(bitmap, page);
+        size_t end = page + 1;
+        while (end < kPagesPerBlock && pageIsSet(bitmap, end) == set) {
+            ++end;
+        }
+        func(page, end - page, set);
+        page = end;
+    }
+}
+
 class Globals {
 public:
     Globals() :
@@ -300,17 +359,21 @@ public:
         stream->putBe64(mBufferBlocks.size());
         stream->putBe64(mCombinedBlocks.size());
 
+        std::vector<const Block*> paged;
+
         for (const auto& block: mRingBlocks) {
-            saveBlockLocked(stream, block);
+            saveBlockLocked(stream, block, &paged);
         }
 
         for (const auto& block: mBufferBlocks) {
-            saveBlockLocked(stream, block);
+            saveBlockLocked(stream, block, &paged);
         }
 
         for (const auto& block: mCombinedBlocks) {
-            saveBlockLocked(stream, block);
+            saveBlockLocked(stream, block, &paged);
         }
+
+        saveBlockPagesLocked(stream, paged);
     }
 
     void postSave() {
@@ -330,18 +393,22 @@ public:
         mBufferBlocks.resize(bufferBlockCount);
         mCombinedBlocks.resize(combinedBlockCount);
 
+        std::vector<Block*> paged;
+
         for (auto& block: mRingBlocks) {
-            loadBlockLocked(stream, resources, block);
+            loadBlockLocked(stream, resources, block, &paged);
         }
 
         for (auto& block: mBufferBlocks) {
-            loadBlockLocked(stream, resources, block);
+            loadBlockLocked(stream, resources, block, &paged);
         }
 
         for (auto& block: mCombinedBlocks) {
-            loadBlockLocked(stream, resources, block);
+            loadBlockLocked(stream, resources, block, &paged);
         }
 
+        loadBlockPagesLocked(stream, paged);
+
         return true;
     }
 
@@ -369,15 +436,18 @@ public:
 
 private:
 
+    // Saves |block|'s metadata; its contents are left to
+    // saveBlockPagesLocked(), so non-external blocks are added to |paged|.
     void saveBlockLocked(
         base::Stream* stream,
-        const Block& block) {
+        const Block& block,
+        std::vector<const Block*>* paged) {
 
         if (block.isEmpty) {
-            stream->putBe32(0);
+            stream->putBe32(kBlockEmpty);
             return;
         } else {
-            stream->putBe32(1);
+            stream->putBe32(kBlockPaged);
         }
 
         stream->putBe64(block.bufferSize);
@@ -392,17 +462,69 @@ private:
         stream->putBe64(block.hostmemId);
         block.subAlloc->save(stream);
         if (!block.external) {
-            stream->write(block.buffer, block.bufferSize);
+            paged->push_back(&block);
+        }
+    }
+
+    // Saves the contents of |blocks|: a bitmap of the pages that are not
+    // all zeroes per block, then those pages, in one parallel compressed
+    // stream when LZ4 is available. The zero page scan also runs in
+    // parallel, a block per task.
+    void saveBlockPagesLocked(base::Stream* stream,
+                              const std::vector<const Block*>& blocks) {
+        if (blocks.empty()) return;
+
+        std::vector<std::vector<uint8_t>> bitmaps(blocks.size());
+        std::vector<std::function<void()>> tasks;
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            tasks.push_back([block = blocks[i], bitmap = &bitmaps[i]] {
+                bitmap->assign((kPagesPerBlock + 7) / 8, 0);
+                for (size_t page = 0; page < kPagesPerBlock; ++page) {
+                    if (!isZeroPage(block->buffer +
+                                    page * ADDRESS_SPACE_GRAPHICS_PAGE_SIZE)) {
+                        (*bitmap)[page / 8] |= 1 << (page % 8);
+                    }
+                }
+            });
+        }
+        android::base::parallelInvokeAll(tasks);
+
+        for (const auto& bitmap : bitmaps) {
+            stream->write(bitmap.data(), bitmap.size());
+        }
+
+#ifdef AEMU_BASE_USE_LZ4
+        stream->putBe32(1);
+        CompressingStream::BlockOptions options;
+        options.codec = CodecOptions::forPayload(PayloadClass::Ram);
+        options.checksums = true;
+        CompressingStream compressed(*stream, options);
+        base::Stream& pages = compressed;
+#else
+        stream->putBe32(0);
+        base::Stream& pages = *stream;
+#endif
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            const char* buffer = blocks[i]->buffer;
+            forEachPageRun(bitmaps[i], [&pages, buffer](size_t first,
+                                                        size_t count,
+                                                        bool set) {
+                if (set) {
+                    pages.write(buffer + first * ADDRESS_SPACE_GRAPHICS_PAGE_SIZE,
+                                count * ADDRESS_SPACE_GRAPHICS_PAGE_SIZE);
+                }
+            });
         }
     }
 
     void loadBlockLocked(base::Stream* stream,
                          const std::optional<AddressSpaceDeviceLoadResources>& resources,
-                         Block& block) {
+                         Block& block,
+                         std::vector<Block*>* paged) {
         uint32_t filled = stream->getBe32();
         struct AllocationCreateInfo create = {0};
 
-        if (!filled) {
+        if (filled == kBlockEmpty) {
             block.isEmpty = true;
             return;
         } else {
@@ -451,11 +573,74 @@ private:
 
         block.subAlloc->load(stream);
 
-        if (!block.external) {
+        if (block.external) {
+            return;
+        }
+        if (filled == kBlockPaged) {
+            paged->push_back(&block);
+        } else {
             stream->read(block.buffer, block.bufferSize);
         }
     }
 
+    // Loads what saveBlockPagesLocked() saved for |blocks|. Pages that were
+    // saved as zero are cleared rather than read; compressed pages are
+    // decompressed ahead on worker threads while they are copied in.
+    void loadBlockPagesLocked(base::Stream* stream,
+                              const std::vector<Block*>& blocks) {
+        if (blocks.empty()) return;
+
+        std::vector<std::vector<uint8_t>> bitmaps(blocks.size());
+        for (auto& bitmap : bitmaps) {
+            bitmap.resize((kPagesPerBlock + 7) / 8);
+            stream->read(bitmap.data(), bitmap.size());
+        }
+
+        const bool isCompressed = stream->getBe32();
+#ifdef AEMU_BASE_USE_LZ4
+        std::optional<DecompressingStream> decompressed;
+        if (isCompressed) {
+            decompressed.emplace(*stream, DecompressingStream::BlockOptions());
+        }
+        base::Stream& pages = decompressed ? *decompressed : *stream;
+        auto failedBlock = [&decompressed]() -> std::optional<size_t> {
+            return decompressed ? decompressed->failedBlock() : std::nullopt;
+        };
+#else
+        if (isCompressed) {
+            crashhandler_die(
+                "Failed to load ASG context global block: "
+                "compressed page data needs LZ4 support.\n");
+        }
+        base::Stream& pages = *stream;
+        auto failedBlock = []() -> std::optional<size_t> { return std::nullopt; };
+#endif
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            char* buffer = blocks[i]->buffer;
+            // Freshly mapped memory is zero already.
+            const bool zeroed = blocks[i]->memory.mapped;
+            forEachPageRun(bitmaps[i], [&pages, &failedBlock, buffer, zeroed](
+                                               size_t first, size_t count,
+                                               bool set) {
+                char* dst = buffer + first * ADDRESS_SPACE_GRAPHICS_PAGE_SIZE;
+                const size_t size = count * ADDRESS_SPACE_GRAPHICS_PAGE_SIZE;
+                if (!set) {
+                    if (!zeroed) memset(dst, 0, size);
+                } else if (pages.read(dst, size) != (ssize_t)size) {
+                    if (const auto bad = failedBlock()) {
+                        crashhandler_die(
+                            "Failed to load ASG context global block: "
+                            "compressed page block %zu is corrupt.\n",
+                            *bad);
+                    }
+                    crashhandler_die(
+                        "Failed to load ASG context global block: "
+                        "truncated page data.\n");
+                }
+            });
+        }
+    }
+
     void fillAllocFromLoad(const Block& block, Allocation& alloc) {
         alloc.buffer = block.buffer + (alloc.offsetIntoPhys - block.offsetIntoPhys);
         alloc.dedicatedContextHandle = block.dedicatedContextHandle;
@@ -510,10 +695,10 @@ private:
                     }
                 }
 
-                void* buf =
-                    aligned_buf_alloc(
-                        ADDRESS_SPACE_GRAPHICS_PAGE_SIZE,
-                        ADDRESS_SPACE_GRAPHICS_BLOCK_SIZE);
+                block.memory = android::base::allocateBlockMemory(
+                        ADDRESS_SPACE_GRAPHICS_BLOCK_SIZE,
+                        ADDRESS_SPACE_GRAPHICS_PAGE_SIZE);
+                void* buf = block.memory.ptr;
 
                 mControlOps->add_memory_mapping(
                     get_address_space_device_hw_funcs()->getPhysAddrStartLocked() +
@@ -549,10 +734,13 @@ private:
 
         delete block.subAlloc;
         if (!block.external) {
-            aligned_buf_free(block.buffer);
+            android::base::freeBlockMemory(&block.memory);
         }
 
         block.isEmpty = true;
+        // Hostmem and external blocks don't go through
+        // remove_memory_mapping, which does this for the rest.
+        GpaTranslationCache::invalidateAll();
     }
 
     bool shouldDestryBlockLocked(const Block& block) const {
@@ -569,6 +757,34 @@ private:
     std::vector<Block> mCombinedBlocks;
 };
 
+// Contexts are counted by the name virtio-gpu gave them, usually that of
+// the guest process.
+static GuestTrafficStats::Source trafficSourceOf(const std::optional<std::string>& name) {
+    return GuestTrafficStats::get().source(name ? "asg:" + *name : std::string("asg"));
+}
+
+// Calls |func| with each |Xfer| in |ring| from |pos| up to |end|, skipping
+// ones the guest may have written over meanwhile.
+template <class Xfer, class Func>
+static void forEachTransfer(const struct ring_buffer* ring, uint32_t pos, uint32_t end,
+                            Func&& func) {
+    const uint32_t xferSize = sizeof(Xfer);
+    if (end - pos > RING_BUFFER_SIZE) {
+        pos = end - RING_BUFFER_SIZE;
+    }
+    for (; end - pos >= xferSize; pos += xferSize) {
+        Xfer xfer;
+        for (uint32_t i = 0; i < xferSize; ++i) {
+            reinterpret_cast<uint8_t*>(&xfer)[i] = ring->buf[(pos + i) & (RING_BUFFER_SIZE - 1)];
+        }
+        const uint32_t writePos = __atomic_load_n(&ring->write_pos, __ATOMIC_ACQUIRE);
+        if (writePos - pos > RING_BUFFER_SIZE - xferSize) {
+            continue;
+        }
+        func(xfer);
+    }
+}
+
 static Globals* sGlobals() {
     static Globals* g = new Globals;
     return g;
@@ -594,7 +810,7 @@ AddressSpaceGraphicsContext::AddressSpaceGraphicsContext(
     const struct AddressSpaceCreateInfo& create)
     : mConsumerCallbacks((ConsumerCallbacks){
           [this] { return onUnavailableRead(); },
-          [](uint64_t physAddr) { return (char*)sGlobals()->controlOps()->get_host_ptr(physAddr); },
+          [this](uint64_t physAddr) { return getXferPtr(physAddr); },
       }),
       mConsumerInterface(sGlobals()->getConsumerInterface()) {
     if (create.fromSnapshot) {
@@ -610,6 +826,7 @@ AddressSpaceGraphicsContext::AddressSpaceGraphicsContext(
         if (create.contextNameSize) {
             info.name = std::string(create.contextName, create.contextNameSize);
         }
+        mTrafficSource = trafficSourceOf(info.name);
 
         mCombinedAllocation = sGlobals()->allocRingAndBufferStorageDedicated(create);
         mRingAllocation = sGlobals()->allocRingViewIntoCombined(mCombinedAllocation);
@@ -617,6 +834,7 @@ AddressSpaceGraphicsContext::AddressSpaceGraphicsContext(
     } else {
         mRingAllocation = sGlobals()->allocRingStorage();
         mBufferAllocation = sGlobals()->allocBuffer();
+        mTrafficSource = trafficSourceOf(std::nullopt);
     }
 
     if (!mRingAllocation.buffer) {
@@ -643,6 +861,11 @@ AddressSpaceGraphicsContext::AddressSpaceGraphicsContext(
     mHostContext.ring_config->transfer_size = 0;
     mHostContext.ring_config->in_error = 0;
 
+    mFlushTuner = FlushTuner(flushTunerOptions(
+            mHostContext.ring_config->flush_interval));
+    mHostContext.ring_config->flush_interval = mFlushTuner.recommended();
+    resetSampling();
+
     mSavedConfig = *mHostContext.ring_config;
 
     if (create.createRenderThread) {
@@ -691,6 +914,12 @@ void AddressSpaceGraphicsContext::perform(AddressSpaceDevicePingInfo* info) {
         break;
     }
     case ASG_NOTIFY_AVAILABLE:
+        GuestTrafficStats::get().add(mTrafficSource, GuestTrafficStats::kWakes, 1);
+        if (mFlushTuner.adaptive()) {
+            mFlushTuner.onNotify(
+                    ring_buffer_available_read(mHostContext.to_host, nullptr) /
+                    sizeof(struct asg_type1_xfer));
+        }
         mConsumerMessages.trySend(ConsumerCommand::Wakeup);
         info->metadata = 0;
         break;
@@ -698,6 +927,15 @@ void AddressSpaceGraphicsContext::perform(AddressSpaceDevicePingInfo* info) {
         *mHostContext.ring_config = mSavedConfig;
         info->metadata = 0;
         break;
+    case ASG_CLOCK_SYNC:
+        if (info->size && mClockSyncGuestNs) {
+            base::addGuestClockSample(mClockSyncGuestNs, mClockSyncHostNs,
+                                      info->size);
+        }
+        mClockSyncGuestNs = info->phys_addr;
+        mClockSyncHostNs = base::traceTimeNs();
+        info->metadata = 0;
+        break;
     }
 }
 
@@ -705,6 +943,10 @@ int AddressSpaceGraphicsContext::onUnavailableRead() {
     static const uint32_t kMaxUnavailableReads = 8;
 
     ++mUnavailableReadCount;
+    if (mUnavailableReadCount == 1) {
+        sampleTransfers();
+        tuneFlushInterval();
+    }
     ring_buffer_yield();
 
     ConsumerCommand cmd;
@@ -723,6 +965,7 @@ sleep:
         switch (cmd) {
             case ConsumerCommand::Wakeup:
                 *(mHostContext.host_state) = ASG_HOST_STATE_CAN_CONSUME;
+                mFlushTuner.onConsumerWake();
                 break;
             case ConsumerCommand::Exit:
                 *(mHostContext.host_state) = ASG_HOST_STATE_EXIT;
@@ -745,6 +988,118 @@ sleep:
     return 0;
 }
 
+char* AddressSpaceGraphicsContext::getXferPtr(uint64_t physAddr) {
+    const address_space_device_control_ops* ops = sGlobals()->controlOps();
+    if (!ops->get_host_range) {
+        return (char*)ops->get_host_ptr(physAddr);
+    }
+    // Type 2 transfers tend to come from a few blocks, so this is usually
+    // a compare against the last mappings seen.
+    return (char*)mXferRanges.translate(
+            physAddr, [ops](uint64_t gpa, GpaRangeCache::Range* range) {
+                void* host = ops->get_host_range(gpa, &range->gpa, &range->size);
+                if (!host) {
+                    return false;
+                }
+                range->host = (char*)host - (gpa - range->gpa);
+                return true;
+            });
+}
+
+FlushTuner::Options AddressSpaceGraphicsContext::flushTunerOptions(
+        uint32_t initialInterval) const {
+    FlushTuner::Options options;
+    options.adaptive = aemu_get_android_hw()->hw_gltransport_asg_adaptiveWriteStep;
+    options.initialInterval = initialInterval;
+    // Leaves the guest room for a few steps in flight.
+    options.maxInterval =
+            std::max<uint32_t>(1, mHostContext.ring_config->buffer_size / 4);
+    options.minInterval = std::min(options.minInterval, options.maxInterval);
+    return options;
+}
+
+void AddressSpaceGraphicsContext::resetSampling() {
+    mSampledReadPos = __atomic_load_n(&mHostContext.to_host->read_pos, __ATOMIC_ACQUIRE);
+    mSampledLargeReadPos =
+            __atomic_load_n(&mHostContext.to_host_large_xfer.ring->read_pos, __ATOMIC_ACQUIRE);
+    mSampledFromHostPos =
+            __atomic_load_n(&mHostContext.from_host_large_xfer.ring->write_pos, __ATOMIC_ACQUIRE);
+}
+
+void AddressSpaceGraphicsContext::sampleTransfers() {
+    // The transfers the consumer read stay in the ring until the guest
+    // writes over them, so they're sampled here instead of in the consumer.
+    struct ring_buffer* ring = mHostContext.to_host;
+    const uint32_t readPos = __atomic_load_n(&ring->read_pos, __ATOMIC_ACQUIRE);
+    int64_t commands = 0;
+    int64_t bytesToHost = 0;
+    switch (__atomic_load_n(&mHostContext.ring_config->transfer_mode, __ATOMIC_ACQUIRE)) {
+        case 1:
+            forEachTransfer<struct asg_type1_xfer>(
+                    ring, mSampledReadPos, readPos, [&](const struct asg_type1_xfer& xfer) {
+                        ++commands;
+                        bytesToHost += xfer.size;
+                        if (mFlushTuner.adaptive()) {
+                            mFlushTuner.onTransfer(xfer.size);
+                        }
+                    });
+            break;
+        case 2:
+            forEachTransfer<struct asg_type2_xfer>(
+                    ring, mSampledReadPos, readPos, [&](const struct asg_type2_xfer& xfer) {
+                        ++commands;
+                        bytesToHost += xfer.size;
+                    });
+            break;
+    }
+    mSampledReadPos = readPos;
+
+    // Large transfers go through whole, so their positions count bytes.
+    const uint32_t largeReadPos =
+            __atomic_load_n(&mHostContext.to_host_large_xfer.ring->read_pos, __ATOMIC_ACQUIRE);
+    const uint32_t fromHostPos =
+            __atomic_load_n(&mHostContext.from_host_large_xfer.ring->write_pos, __ATOMIC_ACQUIRE);
+    bytesToHost += largeReadPos - mSampledLargeReadPos;
+    const int64_t bytesToGuest = fromHostPos - mSampledFromHostPos;
+    mSampledLargeReadPos = largeReadPos;
+    mSampledFromHostPos = fromHostPos;
+
+    GuestTrafficStats& stats = GuestTrafficStats::get();
+    if (commands) {
+        stats.add(mTrafficSource, GuestTrafficStats::kCommands, commands);
+    }
+    if (bytesToHost) {
+        stats.add(mTrafficSource, GuestTrafficStats::kBytesToHost, bytesToHost);
+    }
+    if (bytesToGuest) {
+        stats.add(mTrafficSource, GuestTrafficStats::kBytesToGuest, bytesToGuest);
+    }
+}
+
+void AddressSpaceGraphicsContext::tuneFlushInterval() {
+    if (!mFlushTuner.adaptive()) {
+        return;
+    }
+    struct ring_buffer* ring = mHostContext.to_host;
+    struct asg_ring_config* config = mHostContext.ring_config;
+    if (__atomic_load_n(&config->transfer_mode, __ATOMIC_ACQUIRE) != 1) {
+        return;
+    }
+
+    // State changes only while the ring is empty, see asg_ring_config.
+    if (__atomic_load_n(&ring->write_pos, __ATOMIC_ACQUIRE) != mSampledReadPos) {
+        return;
+    }
+    const std::optional<uint32_t> interval = mFlushTuner.toPublish(
+            config->flush_interval,
+            __atomic_load_n(&config->guest_write_pos, __ATOMIC_ACQUIRE));
+    if (interval) {
+        ASGFX_LOG("flush interval %u -> %u", config->flush_interval, *interval);
+        __atomic_store_n(&config->flush_interval, *interval, __ATOMIC_RELEASE);
+        mSavedConfig.flush_interval = *interval;
+    }
+}
+
 AddressSpaceDeviceType AddressSpaceGraphicsContext::getDeviceType() const {
     return AddressSpaceDeviceType::Graphics;
 }
@@ -808,6 +1163,7 @@ bool AddressSpaceGraphicsContext::load(base::Stream* stream) {
             info.name = stream->getString();
         }
     }
+    mTrafficSource = trafficSourceOf(mVirtioGpuInfo ? mVirtioGpuInfo->name : std::nullopt);
 
     mVersion = stream->getBe32();
     mExiting = stream->getBe32();
@@ -844,6 +1200,16 @@ bool AddressSpaceGraphicsContext::load(base::Stream* stream) {
 
     loadRingConfig(stream, mSavedConfig);
 
+    FlushTuner::Options tunerOptions =
+            flushTunerOptions(mHostContext.ring_config->flush_interval);
+    if (tunerOptions.adaptive) {
+        // A tuned interval may be in use by the guest; carry on from it.
+        tunerOptions.initialInterval = mSavedConfig.flush_interval;
+    }
+    mFlushTuner = FlushTuner(tunerOptions);
+    mHostContext.ring_config->flush_interval = mFlushTuner.recommended();
+    resetSampling();
+
     const bool hasConsumer = stream->getBe32() == 1;
     if (hasConsumer) {
         mCurrentConsumer =
@@ -0,0 +1,111 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/address_space_graphics_flush_tuner.h"
+
+#include <algorithm>
+
+namespace android {
+namespace emulation {
+namespace asg {
+
+namespace {
+
+uint32_t roundDownToPowerOfTwo(uint32_t v) {
+    uint32_t res = 1;
+    while (v / 2 >= res) {
+        res *= 2;
+    }
+    return res;
+}
+
+}  // namespace
+
+FlushTuner::FlushTuner(Options options)
+    : mOptions(options), mRecommended(options.initialInterval) {
+    if (mOptions.adaptive) {
+        mRecommended =
+                std::clamp(roundDownToPowerOfTwo(std::max(1u, mRecommended)),
+                           mOptions.minInterval, mOptions.maxInterval);
+    }
+}
+
+void FlushTuner::onTransfer(uint32_t size) {
+    ++mStats.transfers;
+    mStats.bytes += size;
+    if (!mOptions.adaptive) {
+        return;
+    }
+    ++mTransfers;
+    mBytes += size;
+    // The guest flushes a step when the next command doesn't fit, so a
+    // transfer that is three quarters full means it's filling the steps.
+    if (uint64_t(size) * 4 >= uint64_t(mRecommended) * 3) {
+        ++mFullTransfers;
+    }
+    if (mTransfers >= mOptions.samplesPerDecision) {
+        decide();
+    }
+}
+
+void FlushTuner::onNotify(uint32_t queuedTransfers) {
+    ++mNotifies;
+    mQueuedTransfers += queuedTransfers;
+}
+
+void FlushTuner::onConsumerWake() {
+    ++mStats.wakeups;
+    ++mWakeups;
+}
+
+void FlushTuner::decide() {
+    const uint32_t previous = mRecommended;
+    const bool fillingSteps = mFullTransfers * 2 >= mTransfers;
+    const bool consumerBehind =
+            mNotifies > 0 && mQueuedTransfers >= uint64_t(mNotifies) * 4;
+    // Small transfers with the consumer going back to sleep after one or
+    // two of them: latency bound.
+    const bool smallAndSparse =
+            mBytes * 8 <= uint64_t(mTransfers) * mRecommended &&
+            uint64_t(mWakeups) * 2 >= mTransfers;
+
+    if (fillingSteps || consumerBehind) {
+        mRecommended = std::min(mRecommended * 2, mOptions.maxInterval);
+    } else if (smallAndSparse) {
+        mRecommended = std::max(mRecommended / 2, mOptions.minInterval);
+    }
+    if (mRecommended != previous) {
+        ++mStats.changes;
+    }
+
+    mTransfers = 0;
+    mBytes = 0;
+    mFullTransfers = 0;
+    mWakeups = 0;
+    mNotifies = 0;
+    mQueuedTransfers = 0;
+}
+
+std::optional<uint32_t> FlushTuner::toPublish(uint32_t current,
+                                              uint32_t guestWritePos) const {
+    if (!mOptions.adaptive || mRecommended == current ||
+        guestWritePos % mRecommended != 0) {
+        return std::nullopt;
+    }
+    return mRecommended;
+}
+
+}  // namespace asg
+}  // namespace emulation
+}  // namespace android
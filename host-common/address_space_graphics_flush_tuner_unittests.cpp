@@ -0,0 +1,112 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/address_space_graphics_flush_tuner.h"
+
+#include <gtest/gtest.h>
+
+namespace android {
+namespace emulation {
+namespace asg {
+
+namespace {
+
+FlushTuner::Options adaptiveOptions() {
+    FlushTuner::Options options;
+    options.adaptive = true;
+    options.initialInterval = 4096;
+    options.minInterval = 1024;
+    options.maxInterval = 65536;
+    options.samplesPerDecision = 16;
+    return options;
+}
+
+}  // namespace
+
+TEST(FlushTuner, FixedModeKeepsInterval) {
+    FlushTuner::Options options;
+    options.initialInterval = 3000;
+    FlushTuner tuner(options);
+    for (int i = 0; i < 1000; ++i) {
+        tuner.onTransfer(3000);
+    }
+    EXPECT_EQ(3000u, tuner.recommended());
+    EXPECT_FALSE(tuner.toPublish(3000, 0));
+    EXPECT_EQ(1000u, tuner.stats().transfers);
+}
+
+TEST(FlushTuner, GrowsForFullSteps) {
+    FlushTuner tuner(adaptiveOptions());
+    for (int i = 0; i < 16; ++i) {
+        tuner.onTransfer(4000);
+    }
+    EXPECT_EQ(8192u, tuner.recommended());
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 16; ++i) {
+            tuner.onTransfer(tuner.recommended());
+        }
+    }
+    EXPECT_EQ(65536u, tuner.recommended());
+}
+
+TEST(FlushTuner, GrowsWhenConsumerIsBehind) {
+    FlushTuner tuner(adaptiveOptions());
+    tuner.onNotify(10);
+    for (int i = 0; i < 16; ++i) {
+        tuner.onTransfer(1500);
+    }
+    EXPECT_EQ(8192u, tuner.recommended());
+}
+
+TEST(FlushTuner, ShrinksForSmallSparseCommands) {
+    FlushTuner tuner(adaptiveOptions());
+    for (int round = 0; round < 5; ++round) {
+        for (int i = 0; i < 16; ++i) {
+            tuner.onConsumerWake();
+            tuner.onTransfer(64);
+        }
+    }
+    EXPECT_EQ(1024u, tuner.recommended());
+    EXPECT_EQ(2u, tuner.stats().changes);
+
+    // Small commands that keep the consumer busy leave it alone.
+    FlushTuner busy(adaptiveOptions());
+    for (int i = 0; i < 16; ++i) {
+        busy.onTransfer(64);
+    }
+    EXPECT_EQ(4096u, busy.recommended());
+}
+
+TEST(FlushTuner, PublishesOnlyAtAlignedPositions) {
+    FlushTuner tuner(adaptiveOptions());
+    for (int i = 0; i < 16; ++i) {
+        tuner.onTransfer(4096);
+    }
+    ASSERT_EQ(8192u, tuner.recommended());
+    EXPECT_FALSE(tuner.toPublish(4096, 4096));
+    EXPECT_EQ(8192u, tuner.toPublish(4096, 16384).value_or(0));
+    EXPECT_FALSE(tuner.toPublish(8192, 16384));
+}
+
+TEST(FlushTuner, ClampsInitialInterval) {
+    FlushTuner::Options options = adaptiveOptions();
+    options.initialInterval = 3000;
+    EXPECT_EQ(2048u, FlushTuner(options).recommended());
+    options.initialInterval = 1 << 20;
+    EXPECT_EQ(65536u, FlushTuner(options).recommended());
+}
+
+}  // namespace asg
+}  // namespace emulation
+}  // namespace android
@@ -0,0 +1,448 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Pushes command streams from simulated guests through asg_context rings
+// into a consumer that only copies them out, to measure the rings, the
+// notification path and consumer wakeups without a guest or a renderer.
+//
+// Each configuration is {contexts, command bytes, transfer}. Every context
+// gets its own guest thread, which sends kBytesPerContext per iteration and
+// then waits for the host to drain it. Small commands are batched into
+// flush_interval sized type 1 transfers through to_host, as the guest's
+// AddressSpaceStream does; large ones go through to_host_large_xfer as type 3
+// transfers, with ring_buffer bulk copies off (large = 1) or on for steps of
+// RING_BUFFER_BULK_COPY_THRESHOLD and up (large = 2). Besides bytes_per_second, each run reports ASG_NOTIFY_AVAILABLE
+// pings per second and the latency from a ping to the consumer it woke up.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "aemu/base/LatencyHistogram.h"
+#include "aemu/base/ring_buffer.h"
+#include "aemu/base/threads/FunctorThread.h"
+#include "host-common/AddressSpaceService.h"
+#include "host-common/GraphicsAgentFactory.h"
+#include "host-common/address_space_device.hpp"
+#include "host-common/address_space_graphics.h"
+#include "host-common/address_space_graphics_types.h"
+#include "host-common/globals.h"
+#include "host-common/testing/MockGraphicsAgentFactory.h"
+#include "testing/HostAddressSpace.h"
+
+#include "benchmark/benchmark.h"
+
+using android::HostAddressSpaceDevice;
+using android::base::FunctorThread;
+using android::base::LatencyHistogram;
+using android::emulation::AddressSpaceDevicePingInfo;
+using android::emulation::AddressSpaceDeviceType;
+using android::emulation::asg::AddressSpaceGraphicsContext;
+using android::emulation::asg::ConsumerCallbacks;
+using android::emulation::asg::ConsumerInterface;
+
+namespace {
+
+constexpr size_t kBytesPerContext = 16 << 20;
+
+enum Transfer {
+    kSmall = 0,
+    kLarge = 1,
+    kLargeBulk = 2,
+};
+
+LatencyHistogram sWakeLatencyNs;
+
+uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
+// Drains a context the way a render thread would, minus the decoding.
+class Consumer {
+public:
+    Consumer(struct asg_context context, ConsumerCallbacks callbacks)
+        : mContext(context),
+          mCallbacks(callbacks),
+          mScratch(context.ring_config->buffer_size),
+          mThread([this] { run(); }) {
+        mThread.start();
+    }
+
+    ~Consumer() { mThread.wait(); }
+
+    // Called by the guest right before it pings ASG_NOTIFY_AVAILABLE. Keeps
+    // the earliest ping the consumer has not woken up for yet.
+    void stampNotify() {
+        uint64_t expected = 0;
+        mNotifyNs.compare_exchange_strong(expected, nowNs(),
+                                          std::memory_order_relaxed);
+    }
+
+private:
+    void run() {
+        for (;;) {
+            uint32_t avail = ring_buffer_available_read(mContext.to_host, 0);
+            if (avail) {
+                readType1(avail);
+                continue;
+            }
+
+            avail = ring_buffer_available_read(
+                    mContext.to_host_large_xfer.ring,
+                    &mContext.to_host_large_xfer.view);
+            if (avail) {
+                readType3(avail);
+                continue;
+            }
+
+            const uint64_t sleepNs = nowNs();
+            const int res = mCallbacks.onUnavailableRead();
+            const uint64_t notifyNs =
+                    mNotifyNs.exchange(0, std::memory_order_relaxed);
+            if (res == -1) {
+                return;
+            }
+            // Only count pings that arrived while this call was waiting;
+            // older ones were sent while the consumer was still running.
+            if (res == 1 && notifyNs >= sleepNs) {
+                sWakeLatencyNs.record(nowNs() - notifyNs);
+            }
+        }
+    }
+
+    void readType1(uint32_t avail) {
+        for (uint32_t i = 0; i < avail / sizeof(asg_type1_xfer); ++i) {
+            asg_type1_xfer xfer;
+            ring_buffer_copy_contents(mContext.to_host, 0, sizeof(xfer),
+                                      reinterpret_cast<uint8_t*>(&xfer));
+            memcpy(mScratch.data(), mContext.buffer + xfer.offset, xfer.size);
+            mContext.ring_config->host_consumed_pos = xfer.offset;
+            ring_buffer_advance_read(mContext.to_host, sizeof(xfer), 1);
+        }
+    }
+
+    void readType3(uint32_t avail) {
+        if (avail > mScratch.size()) {
+            avail = mScratch.size();
+        }
+        ring_buffer_view_read(mContext.to_host_large_xfer.ring,
+                              &mContext.to_host_large_xfer.view,
+                              mScratch.data(), avail, 1);
+    }
+
+    struct asg_context mContext;
+    ConsumerCallbacks mCallbacks;
+    std::vector<char> mScratch;
+    std::atomic<uint64_t> mNotifyNs{0};
+    FunctorThread mThread;
+};
+
+// Set while a guest's ASG_SET_VERSION ping creates its consumer.
+Consumer* sLastConsumer = nullptr;
+
+// One guest context: the parts of the guest's AddressSpaceStream that move
+// bytes, without the encoder on top.
+class Guest {
+public:
+    explicit Guest(HostAddressSpaceDevice* device)
+        : mDevice(device), mHandle(device->open()) {
+        ping(static_cast<uint64_t>(AddressSpaceDeviceType::Graphics));
+
+        AddressSpaceDevicePingInfo ring = ping(ASG_GET_RING);
+        mRingOffset = ring.metadata;
+        mDevice->claimShared(mHandle, mRingOffset, ring.size);
+        char* ringStorage = static_cast<char*>(
+                mDevice->getHostAddr(mDevice->offsetToPhysAddr(mRingOffset)));
+
+        AddressSpaceDevicePingInfo buffer = ping(ASG_GET_BUFFER);
+        mBufferOffset = buffer.metadata;
+        mBufferMask = buffer.size - 1;
+        mDevice->claimShared(mHandle, mBufferOffset, buffer.size);
+        mBuffer = static_cast<char*>(
+                mDevice->getHostAddr(mDevice->offsetToPhysAddr(mBufferOffset)));
+
+        mContext = asg_context_create(ringStorage, mBuffer, buffer.size);
+        ping(ASG_SET_VERSION, 1);
+        mConsumer = sLastConsumer;
+        mFlushInterval = mContext.ring_config->flush_interval;
+        mWriteStart = mBuffer;
+    }
+
+    ~Guest() {
+        mDevice->unclaimShared(mHandle, mBufferOffset);
+        mDevice->unclaimShared(mHandle, mRingOffset);
+        mDevice->close(mHandle);
+    }
+
+    uint32_t flushInterval() const { return mFlushInterval; }
+    uint64_t pings() const { return mPings; }
+
+    // Sends |total| bytes as |commandSize| byte commands and returns once
+    // the host has read all of them.
+    void send(const char* data, size_t total, size_t commandSize,
+              Transfer transfer) {
+        for (size_t sent = 0; sent < total; sent += commandSize) {
+            if (transfer != kSmall) {
+                writeLarge(data, commandSize);
+            } else {
+                memcpy(allocBuffer(commandSize), data, commandSize);
+            }
+        }
+        flush();
+        waitType1Drained();
+    }
+
+private:
+    AddressSpaceDevicePingInfo ping(uint64_t metadata, uint64_t size = 0) {
+        AddressSpaceDevicePingInfo info = {};
+        info.metadata = metadata;
+        info.size = size;
+        mDevice->ping(mHandle, &info);
+        return info;
+    }
+
+    void notifyIfSleeping() {
+        if (*mContext.host_state != ASG_HOST_STATE_CAN_CONSUME) {
+            mConsumer->stampNotify();
+            ping(ASG_NOTIFY_AVAILABLE);
+            ++mPings;
+        }
+    }
+
+    char* allocBuffer(size_t size) {
+        if (mCurrentWriteBytes + size > mFlushInterval) {
+            flush();
+        }
+        char* res = mWriteStart + mCurrentWriteBytes;
+        mCurrentWriteBytes += size;
+        return res;
+    }
+
+    void flush() {
+        if (!mCurrentWriteBytes) {
+            return;
+        }
+
+        asg_type1_xfer xfer = {
+                static_cast<uint32_t>(mWriteStart - mBuffer),
+                mCurrentWriteBytes,
+        };
+        while (!ring_buffer_write(mContext.to_host, &xfer, sizeof(xfer), 1)) {
+            notifyIfSleeping();
+            ring_buffer_yield();
+        }
+        notifyIfSleeping();
+
+        while (availableForWrite() < mFlushInterval) {
+            waitConsumerProgress();
+        }
+        __atomic_add_fetch(&mContext.ring_config->guest_write_pos,
+                           mFlushInterval, __ATOMIC_SEQ_CST);
+        mWriteStart =
+                mBuffer + (mContext.ring_config->guest_write_pos & mBufferMask);
+        mCurrentWriteBytes = 0;
+    }
+
+    uint32_t availableForWrite() const {
+        uint32_t consumed;
+        __atomic_load(&mContext.ring_config->host_consumed_pos, &consumed,
+                      __ATOMIC_SEQ_CST);
+        return (consumed - mContext.ring_config->guest_write_pos - 1) &
+               mBufferMask;
+    }
+
+    void waitConsumerProgress() {
+        const uint32_t avail = ring_buffer_available_read(mContext.to_host, 0);
+        while (avail) {
+            ring_buffer_yield();
+            if (ring_buffer_available_read(mContext.to_host, 0) != avail) {
+                break;
+            }
+            if (*mContext.host_state != ASG_HOST_STATE_CAN_CONSUME) {
+                notifyIfSleeping();
+                break;
+            }
+        }
+    }
+
+    void waitType1Drained() {
+        while (ring_buffer_available_read(mContext.to_host, 0)) {
+            waitConsumerProgress();
+        }
+    }
+
+    void writeLarge(const char* data, size_t size) {
+        flush();
+        waitType1Drained();
+        mContext.ring_config->transfer_size = size;
+        mContext.ring_config->transfer_mode = 3;
+
+        const size_t chunkSize = std::min<size_t>(size, (mBufferMask + 1) / 4);
+        size_t sent = 0;
+        while (sent < size) {
+            const size_t chunk = std::min(size - sent, chunkSize);
+            const long written = ring_buffer_view_write(
+                    mContext.to_host_large_xfer.ring,
+                    &mContext.to_host_large_xfer.view, data + sent, chunk, 1);
+            notifyIfSleeping();
+            if (!written) {
+                ring_buffer_yield();
+            }
+            sent += written * chunk;
+        }
+
+        while (ring_buffer_available_read(mContext.to_host_large_xfer.ring,
+                                          &mContext.to_host_large_xfer.view)) {
+            ring_buffer_yield();
+            notifyIfSleeping();
+        }
+        mContext.ring_config->transfer_mode = 1;
+    }
+
+    HostAddressSpaceDevice* mDevice;
+    uint32_t mHandle;
+    uint64_t mRingOffset = 0;
+    uint64_t mBufferOffset = 0;
+    uint32_t mBufferMask = 0;
+    char* mBuffer = nullptr;
+    struct asg_context mContext;
+    Consumer* mConsumer = nullptr;
+    uint32_t mFlushInterval = 0;
+
+    char* mWriteStart = nullptr;
+    uint32_t mCurrentWriteBytes = 0;
+    uint64_t mPings = 0;
+};
+
+HostAddressSpaceDevice* setUpDevice() {
+    static HostAddressSpaceDevice* device = [] {
+        android::emulation::injectGraphicsAgents(
+                android::emulation::MockGraphicsAgentFactory());
+        android::emulation::goldfish_address_space_set_vm_operations(
+                getGraphicsAgents()->vm);
+        aemu_get_android_hw()->hw_gltransport_asg_writeBufferSize = 1048576;
+        aemu_get_android_hw()->hw_gltransport_asg_writeStepSize = 4096;
+
+        ConsumerInterface interface = {
+                // create
+                [](struct asg_context context, android::base::Stream*,
+                   ConsumerCallbacks callbacks, uint32_t, uint32_t,
+                   std::optional<std::string>) {
+                    sLastConsumer = new Consumer(context, callbacks);
+                    return static_cast<void*>(sLastConsumer);
+                },
+                // destroy
+                [](void* consumer) { delete static_cast<Consumer*>(consumer); },
+                // presave
+                [](void*) {},
+                // global presave
+                []() {},
+                // save
+                [](void*, android::base::Stream*) {},
+                // global postsave
+                []() {},
+                // postsave
+                [](void*) {},
+                // postload
+                [](void*) {},
+                // global preload
+                []() {},
+        };
+        AddressSpaceGraphicsContext::setConsumer(interface);
+        return HostAddressSpaceDevice::get();
+    }();
+    return device;
+}
+
+void BM_AsgThroughput(benchmark::State& state) {
+    const int contexts = state.range(0);
+    const size_t commandSize = state.range(1);
+    const Transfer transfer = static_cast<Transfer>(state.range(2));
+    ring_buffer_set_bulk_copy_threshold(transfer == kLargeBulk
+                                                ? RING_BUFFER_BULK_COPY_THRESHOLD
+                                                : RING_BUFFER_BULK_COPY_OFF);
+
+    HostAddressSpaceDevice* device = setUpDevice();
+    std::vector<std::unique_ptr<Guest>> guests;
+    for (int i = 0; i < contexts; ++i) {
+        guests.emplace_back(new Guest(device));
+    }
+    if (transfer == kSmall && commandSize > guests[0]->flushInterval()) {
+        state.SkipWithError("command larger than flush_interval");
+        guests.clear();
+        return;
+    }
+
+    const std::vector<char> data(commandSize, 0x5a);
+    const size_t perContext = kBytesPerContext / commandSize * commandSize;
+    sWakeLatencyNs.takeSummary();
+
+    for (auto _ : state) {
+        std::vector<std::unique_ptr<FunctorThread>> threads;
+        for (auto& guest : guests) {
+            Guest* g = guest.get();
+            threads.emplace_back(new FunctorThread([&data, g, perContext,
+                                                    commandSize, transfer] {
+                g->send(data.data(), perContext, commandSize, transfer);
+                return 0;
+            }));
+            threads.back()->start();
+        }
+        for (auto& thread : threads) {
+            thread->wait();
+        }
+    }
+
+    uint64_t pings = 0;
+    for (const auto& guest : guests) {
+        pings += guest->pings();
+    }
+    guests.clear();
+
+    const LatencyHistogram::Summary wake = sWakeLatencyNs.takeSummary();
+    state.SetBytesProcessed(state.iterations() * contexts * perContext);
+    state.counters["pings"] =
+            benchmark::Counter(pings, benchmark::Counter::kIsRate);
+    state.counters["wakes"] = wake.count;
+    state.counters["wake_p50_us"] = wake.p50 / 1000.0;
+    state.counters["wake_p90_us"] = wake.p90 / 1000.0;
+    state.counters["wake_p99_us"] = wake.p99 / 1000.0;
+    state.counters["wake_max_us"] = wake.max / 1000.0;
+}
+
+void asgConfigs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"contexts", "bytes", "large"});
+    for (int contexts : {1, 2, 4, 8}) {
+        for (int bytes : {16, 256, 4096}) {
+            b->Args({contexts, bytes, kSmall});
+        }
+        for (int bytes : {64 << 10, 1 << 20}) {
+            b->Args({contexts, bytes, kLarge});
+            b->Args({contexts, bytes, kLargeBulk});
+        }
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_AsgThroughput)->Apply(asgConfigs)->UseRealTime();
+BENCHMARK_MAIN();
@@ -0,0 +1,303 @@
+// Copyright 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/address_space_graphics_poller.h"
+
+#include <algorithm>
+
+#include "aemu/base/Metrics.h"
+#include "aemu/base/StatsPage.h"
+#include "aemu/base/ThreadRoles.h"
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/system/FastClock.h"
+#include "aemu/base/system/System.h"
+#include "aemu/base/threads/FunctorThread.h"
+
+using android::base::AutoLock;
+using android::base::ConditionVariable;
+using android::base::FunctorThread;
+using android::base::Lock;
+
+namespace android {
+namespace emulation {
+namespace asg {
+
+namespace {
+
+// Rings across all pollers, and those of them not parked, for StatsPage.
+const base::Stat& ringsStat() {
+    static const base::Stat sStat = base::StatsPage::get().add("asg.rings", base::StatKind::kGauge);
+    return sStat;
+}
+
+const base::Stat& activeRingsStat() {
+    static const base::Stat sStat =
+            base::StatsPage::get().add("asg.rings_active", base::StatKind::kGauge);
+    return sStat;
+}
+
+}  // namespace
+
+struct RingPoller::Ring {
+    RingId id = 0;
+    struct asg_context context = {};
+    ConsumeCallback consume;
+
+    bool parked = false;
+    // Set by notify() so that a ring polled concurrently is not parked right
+    // after the guest asked for attention.
+    bool notified = false;
+    // True while |consume| runs without the shard lock held.
+    bool busy = false;
+    uint32_t idlePolls = 0;
+    uint64_t notifyTimeUs = 0;
+    uint64_t lastPollUs = 0;
+
+    RingStats stats;
+};
+
+struct RingPoller::Shard {
+    Lock lock;
+    // Signalled when a ring becomes active or the shard is exiting.
+    ConditionVariable workCv;
+    // Signalled when a ring stops being busy.
+    ConditionVariable idleCv;
+    std::vector<std::shared_ptr<Ring>> rings;
+    size_t activeCount = 0;
+    bool exiting = false;
+    std::unique_ptr<FunctorThread> thread;
+};
+
+static bool ringHasData(const struct asg_context& context) {
+    if (ring_buffer_available_read(context.to_host, nullptr)) return true;
+    return ring_buffer_available_read(context.to_host_large_xfer.ring,
+                                      &context.to_host_large_xfer.view) != 0;
+}
+
+static void setHostState(const struct asg_context& context,
+                         asg_host_state state) {
+    __atomic_store_n((uint32_t*)context.host_state, (uint32_t)state,
+                     __ATOMIC_SEQ_CST);
+}
+
+RingPoller::RingPoller(Options options) : mOptions(options) {
+    size_t threadCount = std::max<size_t>(1, mOptions.threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        auto shard = std::make_unique<Shard>();
+        Shard* shardPtr = shard.get();
+        shard->thread = std::make_unique<FunctorThread>(
+            [this, shardPtr] { pollLoop(shardPtr); });
+        mShards.push_back(std::move(shard));
+    }
+    for (auto& shard : mShards) {
+        shard->thread->start();
+    }
+}
+
+RingPoller::~RingPoller() {
+    for (auto& shard : mShards) {
+        AutoLock lock(shard->lock);
+        shard->exiting = true;
+        shard->workCv.broadcastAndUnlock(&lock);
+    }
+    for (auto& shard : mShards) {
+        shard->thread->wait();
+        ringsStat().add(-static_cast<int64_t>(shard->rings.size()));
+        activeRingsStat().add(-static_cast<int64_t>(shard->activeCount));
+    }
+}
+
+RingPoller::Shard* RingPoller::shardFor(RingId id) const {
+    return mShards[id % mShards.size()].get();
+}
+
+std::shared_ptr<RingPoller::Ring> RingPoller::findLocked(Shard* shard,
+                                                         RingId id) const {
+    for (const auto& ring : shard->rings) {
+        if (ring->id == id) return ring;
+    }
+    return nullptr;
+}
+
+RingPoller::RingId RingPoller::add(struct asg_context context,
+                                   ConsumeCallback consume) {
+    auto ring = std::make_shared<Ring>();
+    ring->id = mNextId++;
+    ring->context = context;
+    ring->consume = std::move(consume);
+    ring->lastPollUs = base::FastClock::nowUs();
+
+    setHostState(context, ASG_HOST_STATE_CAN_CONSUME);
+
+    Shard* shard = shardFor(ring->id);
+    AutoLock lock(shard->lock);
+    shard->rings.push_back(ring);
+    ++shard->activeCount;
+    ringsStat().add(1);
+    activeRingsStat().add(1);
+    RingId id = ring->id;
+    shard->workCv.signalAndUnlock(&lock);
+    return id;
+}
+
+void RingPoller::remove(RingId id) {
+    Shard* shard = shardFor(id);
+    AutoLock lock(shard->lock);
+
+    auto it = std::find_if(shard->rings.begin(), shard->rings.end(),
+                           [id](const std::shared_ptr<Ring>& ring) { return ring->id == id; });
+    if (it == shard->rings.end()) return;
+
+    std::shared_ptr<Ring> ring = *it;
+    shard->idleCv.wait(&lock, [&ring] { return !ring->busy; });
+
+    // Look the ring up again; the vector may have changed while waiting, and
+    // a concurrent remove() of the same id may already have taken it out.
+    it = std::find(shard->rings.begin(), shard->rings.end(), ring);
+    if (it == shard->rings.end()) return;
+    if (!ring->parked) {
+        --shard->activeCount;
+        activeRingsStat().add(-1);
+    }
+    shard->rings.erase(it);
+    ringsStat().add(-1);
+}
+
+void RingPoller::notify(RingId id) {
+    Shard* shard = shardFor(id);
+    AutoLock lock(shard->lock);
+
+    auto ring = findLocked(shard, id);
+    if (!ring) return;
+
+    ring->notified = true;
+    if (!ring->parked) return;
+
+    ring->parked = false;
+    ring->idlePolls = 0;
+    ring->notifyTimeUs = base::FastClock::nowUs();
+    ++ring->stats.wakeups;
+    ++shard->activeCount;
+    activeRingsStat().add(1);
+    setHostState(ring->context, ASG_HOST_STATE_CAN_CONSUME);
+    shard->workCv.signalAndUnlock(&lock);
+}
+
+std::optional<RingPoller::RingStats> RingPoller::getStats(RingId id) const {
+    Shard* shard = shardFor(id);
+    AutoLock lock(shard->lock);
+    auto ring = findLocked(shard, id);
+    if (!ring) return std::nullopt;
+    return ring->stats;
+}
+
+void RingPoller::reportMetrics(base::MetricsLogger* logger) {
+    base::MetricEventAsgRingStats event = {};
+    for (auto& shard : mShards) {
+        AutoLock lock(shard->lock);
+        for (auto& ring : shard->rings) {
+            ++event.rings;
+            event.maxWakeLatencyUs = std::max<int64_t>(
+                event.maxWakeLatencyUs, ring->stats.maxWakeLatencyUs);
+            event.maxPollGapUs =
+                std::max<int64_t>(event.maxPollGapUs, ring->stats.maxPollGapUs);
+            ring->stats.maxWakeLatencyUs = 0;
+            ring->stats.maxPollGapUs = 0;
+        }
+    }
+    if (logger) {
+        logger->logMetricEvent(event);
+    }
+}
+
+void RingPoller::pollLoop(Shard* shard) {
+    base::ScopedThreadRole role(base::ThreadRole::kAsgConsumer);
+    AutoLock lock(shard->lock);
+
+    while (!shard->exiting) {
+        if (!shard->activeCount) {
+            shard->workCv.wait(&lock);
+            continue;
+        }
+
+        uint64_t consumedThisPass = 0;
+
+        // Rings can be added or removed while the lock is dropped below. That
+        // may cause a ring to be skipped or visited twice in this pass, which
+        // is harmless.
+        for (size_t i = 0; i < shard->rings.size() && !shard->exiting; ++i) {
+            std::shared_ptr<Ring> ring = shard->rings[i];
+            if (ring->parked) continue;
+
+            uint64_t nowUs = base::FastClock::nowUs();
+            if (ring->notifyTimeUs) {
+                uint64_t latencyUs = nowUs - ring->notifyTimeUs;
+                ring->stats.totalWakeLatencyUs += latencyUs;
+                ring->stats.maxWakeLatencyUs =
+                    std::max(ring->stats.maxWakeLatencyUs, latencyUs);
+                base::recordLatency(base::LatencyMetric::kAsgWake, latencyUs);
+                ring->notifyTimeUs = 0;
+            } else {
+                ring->stats.maxPollGapUs =
+                    std::max(ring->stats.maxPollGapUs, nowUs - ring->lastPollUs);
+            }
+            ring->notified = false;
+            ring->busy = true;
+
+            lock.unlock();
+            uint32_t consumed = ring->consume();
+            lock.lock();
+
+            ring->busy = false;
+            ring->lastPollUs = base::FastClock::nowUs();
+            ++ring->stats.polls;
+            ring->stats.bytesConsumed += consumed;
+            consumedThisPass += consumed;
+            shard->idleCv.broadcast();
+
+            if (consumed || ring->notified) {
+                ring->idlePolls = 0;
+                continue;
+            }
+
+            if (++ring->idlePolls < mOptions.idlePollsBeforePark) continue;
+
+            // Ask the guest to notify us, then look once more in case it
+            // wrote something before it could see the new state.
+            setHostState(ring->context, ASG_HOST_STATE_NEED_NOTIFY);
+            if (ringHasData(ring->context)) {
+                setHostState(ring->context, ASG_HOST_STATE_CAN_CONSUME);
+                ring->idlePolls = 0;
+                continue;
+            }
+
+            ring->parked = true;
+            ring->idlePolls = 0;
+            ++ring->stats.parks;
+            --shard->activeCount;
+            activeRingsStat().add(-1);
+        }
+
+        if (!consumedThisPass) {
+            lock.unlock();
+            ring_buffer_yield();
+            lock.lock();
+        }
+    }
+}
+
+}  // namespace asg
+}  // namespace emulation
+}  // namespace android
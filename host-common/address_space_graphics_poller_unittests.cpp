@@ -0,0 +1,205 @@
+// Copyright 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/address_space_graphics_poller.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "aemu/base/Metrics.h"
+#include "aemu/base/system/System.h"
+
+namespace android {
+namespace emulation {
+namespace asg {
+namespace {
+
+constexpr uint32_t kBufferSize = 4096;
+
+// An asg_context backed by plain host memory, standing in for a guest.
+struct FakeGuestRing {
+    FakeGuestRing()
+        : storage(sizeof(asg_ring_storage)),
+          buffer(kBufferSize),
+          context(asg_context_create(storage.data(), buffer.data(), kBufferSize)) {}
+
+    void send(uint32_t bytes) {
+        std::vector<uint8_t> data(bytes, 0xAB);
+        ring_buffer_write_fully(context.to_host, nullptr, data.data(), bytes);
+    }
+
+    // Drains what is in the to_host ring, like a render thread would.
+    uint32_t consume() {
+        uint32_t available = ring_buffer_available_read(context.to_host, nullptr);
+        if (!available) return 0;
+        ring_buffer_advance_read(context.to_host, available, 1);
+        consumed += available;
+        return available;
+    }
+
+    asg_host_state hostState() const {
+        return (asg_host_state)__atomic_load_n((uint32_t*)context.host_state,
+                                               __ATOMIC_SEQ_CST);
+    }
+
+    std::vector<char> storage;
+    std::vector<char> buffer;
+    struct asg_context context;
+    std::atomic<uint32_t> consumed{0};
+};
+
+template <class Pred>
+bool waitFor(Pred pred) {
+    for (int i = 0; i < 2000; ++i) {
+        if (pred()) return true;
+        base::sleepMs(1);
+    }
+    return pred();
+}
+
+class RecordingMetricsLogger : public base::MetricsLogger {
+public:
+    void logMetricEvent(base::MetricEventType eventType) override {
+        if (auto* stats = std::get_if<base::MetricEventAsgRingStats>(&eventType)) {
+            events.push_back(*stats);
+        }
+    }
+    void setCrashAnnotation(const char*, const char*) override {}
+
+    std::vector<base::MetricEventAsgRingStats> events;
+};
+
+TEST(RingPoller, ConsumesManyRingsWithFewThreads) {
+    RingPoller::Options options;
+    options.threadCount = 2;
+    RingPoller poller(options);
+
+    constexpr size_t kRings = 16;
+    std::vector<std::unique_ptr<FakeGuestRing>> rings;
+    std::vector<RingPoller::RingId> ids;
+    for (size_t i = 0; i < kRings; ++i) {
+        rings.push_back(std::make_unique<FakeGuestRing>());
+        FakeGuestRing* ring = rings.back().get();
+        ids.push_back(poller.add(ring->context, [ring] { return ring->consume(); }));
+    }
+
+    for (size_t i = 0; i < kRings; ++i) {
+        rings[i]->send(64 + i);
+        poller.notify(ids[i]);
+    }
+
+    for (size_t i = 0; i < kRings; ++i) {
+        EXPECT_TRUE(waitFor([&] { return rings[i]->consumed == 64 + i; }));
+    }
+
+    for (auto id : ids) {
+        poller.remove(id);
+    }
+}
+
+TEST(RingPoller, ParksIdleRingAndWakesOnNotify) {
+    RingPoller::Options options;
+    options.threadCount = 1;
+    options.idlePollsBeforePark = 4;
+    RingPoller poller(options);
+
+    FakeGuestRing ring;
+    auto id = poller.add(ring.context, [&ring] { return ring.consume(); });
+
+    EXPECT_TRUE(waitFor([&] { return ring.hostState() == ASG_HOST_STATE_NEED_NOTIFY; }));
+    EXPECT_TRUE(waitFor([&] { return poller.getStats(id)->parks == 1; }));
+
+    // While parked, data is not picked up until the guest notifies.
+    ring.send(32);
+    base::sleepMs(10);
+    EXPECT_EQ(0u, ring.consumed);
+
+    poller.notify(id);
+    EXPECT_TRUE(waitFor([&] { return ring.consumed == 32; }));
+
+    auto stats = poller.getStats(id);
+    ASSERT_TRUE(stats);
+    EXPECT_EQ(1u, stats->wakeups);
+    EXPECT_EQ(32u, stats->bytesConsumed);
+
+    RecordingMetricsLogger logger;
+    poller.reportMetrics(&logger);
+    ASSERT_EQ(1u, logger.events.size());
+    EXPECT_EQ(1, logger.events[0].rings);
+    EXPECT_EQ(0u, poller.getStats(id)->maxWakeLatencyUs);
+
+    poller.remove(id);
+    EXPECT_FALSE(poller.getStats(id));
+}
+
+TEST(RingPoller, RemoveWaitsForInFlightConsume) {
+    RingPoller::Options options;
+    options.threadCount = 1;
+    RingPoller poller(options);
+
+    FakeGuestRing ring;
+    std::atomic<bool> inConsume{false};
+    std::atomic<bool> finished{false};
+    auto id = poller.add(ring.context, [&] {
+        inConsume = true;
+        base::sleepMs(20);
+        finished = true;
+        return 0u;
+    });
+
+    EXPECT_TRUE(waitFor([&] { return inConsume.load(); }));
+    poller.remove(id);
+    EXPECT_TRUE(finished);
+}
+
+TEST(RingPoller, ConcurrentRemoveOfSameRing) {
+    RingPoller::Options options;
+    options.threadCount = 1;
+    RingPoller poller(options);
+
+    FakeGuestRing slow;
+    std::atomic<bool> inConsume{false};
+    auto slowId = poller.add(slow.context, [&] {
+        inConsume = true;
+        base::sleepMs(20);
+        return 0u;
+    });
+    FakeGuestRing other;
+    auto otherId = poller.add(other.context, [&other] { return other.consume(); });
+
+    // Both removers find the ring busy and wait for it; only one of them may
+    // take it out.
+    EXPECT_TRUE(waitFor([&] { return inConsume.load(); }));
+    std::thread first([&] { poller.remove(slowId); });
+    std::thread second([&] { poller.remove(slowId); });
+    first.join();
+    second.join();
+    EXPECT_FALSE(poller.getStats(slowId));
+    ASSERT_TRUE(poller.getStats(otherId));
+
+    // The other ring on the shard is still polled.
+    other.send(48);
+    poller.notify(otherId);
+    EXPECT_TRUE(waitFor([&] { return other.consumed == 48; }));
+    poller.remove(otherId);
+}
+
+}  // namespace
+}  // namespace asg
+}  // namespace emulation
+}  // namespace android
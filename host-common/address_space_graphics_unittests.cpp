@@ -18,10 +18,15 @@
 #include <string.h>                                          // for size_t
 #include <sys/types.h>                                       // for ssize_t
 #include <algorithm>                                         // for uniform_...
+#include <atomic>                                            // for atomic
+#include <chrono>                                            // for steady_c...
 #include <functional>                                        // for __base
 #include <random>                                            // for default_...
+#include <thread>                                            // for yield
 #include <vector>                                            // for vector
 
+#include "aemu/base/Tracing.h"                            // for guestToHo...
+#include "aemu/base/files/MemStream.h"                    // for MemStream
 #include "aemu/base/ring_buffer.h"                        // for ring_buf...
 #include "aemu/base/threads/FunctorThread.h"              // for FunctorT...
 #include "host-common/GraphicsAgentFactory.h"                                 // for getConso...
@@ -105,6 +110,8 @@ public:
             mDevice->close(mHandle);
         }
 
+        uint32_t handle() const { return mHandle; }
+
         bool isInError() const {
             return 1 == mContext.ring_config->in_error;
         }
@@ -337,6 +344,18 @@ public:
         }
 
         char* getBufferPtr() { return mBuffer; }
+        const struct asg_ring_config* ring_config() const {
+            return mContext.ring_config;
+        }
+
+        void syncClock(uint64_t guestNs, uint64_t previousReturnNs) {
+            AddressSpaceDevicePingInfo info = {};
+            info.metadata = ASG_CLOCK_SYNC;
+            info.phys_addr = guestNs;
+            info.size = previousReturnNs;
+            mDevice->ping(mHandle, &info);
+            EXPECT_EQ(0u, info.metadata);
+        }
 
     private:
 
@@ -571,6 +590,10 @@ protected:
                ConsumerCallbacks callbacks,
                uint32_t contextId, uint32_t capsetId,
                std::optional<std::string> nameOpt) {
+               if (loadStream && mHoldConsumerLoads) {
+                   mConsumerLoadHeld = true;
+                   while (mHoldConsumerLoads) std::this_thread::yield();
+               }
                Consumer* c = new Consumer(context, callbacks);
                mCurrentConsumer = c;
                return (void*)c;
@@ -604,6 +627,7 @@ protected:
         mDevice->clear();
         aemu_get_android_hw()->hw_gltransport_asg_writeBufferSize = 524288;
         aemu_get_android_hw()->hw_gltransport_asg_writeStepSize = 1024;
+        aemu_get_android_hw()->hw_gltransport_asg_adaptiveWriteStep = false;
         EXPECT_EQ(nullptr, mCurrentConsumer);
     }
 
@@ -662,6 +686,9 @@ protected:
 
     HostAddressSpaceDevice* mDevice = nullptr;
     Consumer* mCurrentConsumer = nullptr;
+    // While set, consumers created from a snapshot wait in create.
+    std::atomic<bool> mHoldConsumerLoads{false};
+    std::atomic<bool> mConsumerLoadHeld{false};
 };
 
 // Tests that we can create a client for ASG,
@@ -671,6 +698,21 @@ TEST_F(AddressSpaceGraphicsTest, Basic) {
     Client client(mDevice);
 }
 
+// Tests that clock sync pings give tracing the guest clock's offset.
+TEST_F(AddressSpaceGraphicsTest, ClockSync) {
+    Client client(mDevice);
+    // A guest clock a second behind the host's.
+    const uint64_t kBehindNs = 1000000000;
+    uint64_t returnedNs = 0;
+    for (int i = 0; i < 4; ++i) {
+        client.syncClock(base::traceTimeNs() - kBehindNs, returnedNs);
+        returnedNs = base::traceTimeNs() - kBehindNs;
+    }
+    const uint64_t guestNs = base::traceTimeNs() - kBehindNs;
+    EXPECT_NEAR(double(kBehindNs),
+                double(base::guestToHostTraceNs(guestNs) - guestNs), 5e7);
+}
+
 // Tests writing via an IOStream-like interface
 // (allocBuffer, then flush)
 TEST_F(AddressSpaceGraphicsTest, BasicWrite) {
@@ -688,6 +730,24 @@ TEST_F(AddressSpaceGraphicsTest, BasicWrite) {
     client.flush();
 }
 
+// Tests that with adaptive write steps, a guest filling every step gets a
+// larger flush interval and its data still arrives intact.
+TEST_F(AddressSpaceGraphicsTest, AdaptiveWriteStepGrows) {
+    aemu_get_android_hw()->hw_gltransport_asg_adaptiveWriteStep = true;
+    Client client(mDevice);
+    EXPECT_EQ(1024u, client.ring_config()->flush_interval);
+
+    std::vector<RoundTrip> trips(16, RoundTrip{256 * 1024, 4});
+    for (int i = 0; i < 16 && client.ring_config()->flush_interval == 1024;
+         ++i) {
+        runRoundTrips(client, trips);
+    }
+    const uint32_t interval = client.ring_config()->flush_interval;
+    EXPECT_GT(interval, 1024u);
+    EXPECT_EQ(0u, client.ring_config()->guest_write_pos % interval);
+    runRoundTrips(client, trips);
+}
+
 // Tests that further allocs result in flushing
 TEST_F(AddressSpaceGraphicsTest, FlushFromAlloc) {
     EXPECT_EQ(1024, aemu_get_android_hw()->hw_gltransport_asg_writeStepSize);
@@ -871,6 +931,89 @@ TEST_F(AddressSpaceGraphicsTest, BlockCreateDestroyRandom) {
     }
 }
 
+// Tests that the global block state survives a save and load, and saves
+// the same way again afterwards.
+TEST_F(AddressSpaceGraphicsTest, GlobalStateSaveLoad) {
+    base::MemStream saved;
+    {
+        Client client(mDevice);
+        auto buf = client.allocBuffer(1024);
+        memset(buf, ASG_TEST_WRITE_PATTERN, 1024);
+
+        AddressSpaceGraphicsContext::globalStatePreSave();
+        AddressSpaceGraphicsContext::globalStateSave(&saved);
+        AddressSpaceGraphicsContext::globalStatePostSave();
+        client.flush();
+    }
+    const std::vector<char> first = saved.buffer();
+    // Mostly zero pages, so much smaller than the blocks it describes.
+    EXPECT_LT(first.size(), ADDRESS_SPACE_GRAPHICS_BLOCK_SIZE / 16);
+
+    EXPECT_TRUE(AddressSpaceGraphicsContext::globalStateLoad(&saved,
+                                                             std::nullopt));
+    EXPECT_EQ(0, saved.readSize());
+
+    base::MemStream resaved;
+    AddressSpaceGraphicsContext::globalStateSave(&resaved);
+    EXPECT_EQ(first, resaved.buffer());
+}
+
+// Tests that a graphics context comes back from a device snapshot only
+// once its restore is asked for, and then with its consumer.
+TEST_F(AddressSpaceGraphicsTest, DeferredRestore) {
+    base::MemStream saved;
+    uint32_t handle;
+    {
+        Client client(mDevice);
+        handle = client.handle();
+        mDevice->saveSnapshot(&saved);
+    }
+    EXPECT_EQ(nullptr, mCurrentConsumer);
+
+    mDevice->loadSnapshot(&saved);
+    EXPECT_NE(AddressSpaceContextRestore::Immediate,
+              goldfish_address_space_context_restore_state(handle));
+    EXPECT_EQ(0, goldfish_address_space_memory_state_finish_restore());
+    EXPECT_EQ(AddressSpaceContextRestore::Restored,
+              goldfish_address_space_context_restore_state(handle));
+    EXPECT_NE(nullptr, mCurrentConsumer);
+    mDevice->clear();
+}
+
+// Tests that a deferred restore doesn't hold up closing another context.
+TEST_F(AddressSpaceGraphicsTest, DeferredRestoreLetsOthersClose) {
+    base::MemStream saved;
+    uint32_t handle;
+    {
+        Client client(mDevice);
+        handle = client.handle();
+        mDevice->saveSnapshot(&saved);
+    }
+
+    mHoldConsumerLoads = true;
+    mDevice->loadSnapshot(&saved);
+    while (!mConsumerLoadHeld) std::this_thread::yield();
+
+    std::atomic<bool> closed{false};
+    FunctorThread closer([this, &closed] {
+        { Client other(mDevice); }
+        closed = true;
+    });
+    closer.start();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!closed && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    EXPECT_TRUE(closed);
+
+    mHoldConsumerLoads = false;
+    closer.wait();
+    EXPECT_EQ(0, goldfish_address_space_memory_state_finish_restore());
+    EXPECT_EQ(AddressSpaceContextRestore::Restored,
+              goldfish_address_space_context_restore_state(handle));
+    mDevice->clear();
+}
+
 } // namespace asg
 } // namespace emulation
 } // namespace android
@@ -15,6 +15,8 @@
 #include "host-common/address_space_host_media.h"
 #include "host-common/vm_operations.h"
 #include "aemu/base/AlignedBuf.h"
+#include "aemu/base/LatencyHistogram.h"
+#include "aemu/base/system/System.h"
 
 #define AS_DEVICE_DEBUG 0
 
@@ -27,9 +29,16 @@
 namespace android {
 namespace emulation {
 
+static uint64_t getAddrSlot(uint64_t metadata) {
+    uint64_t ret = metadata << 8;  // get rid of typecode
+    ret = ret >> 16;               // get rid of opcode
+    return ret;
+}
+
 enum class DecoderType : uint8_t {
     Vpx = 0,
     H264 = 1,
+    Hevc = 2,
 };
 
 AddressSpaceHostMediaContext::AddressSpaceHostMediaContext(
@@ -43,11 +52,50 @@ AddressSpaceHostMediaContext::AddressSpaceHostMediaContext(
 }
 
 AddressSpaceHostMediaContext::~AddressSpaceHostMediaContext() {
+    for (const auto& kv : mStreams) {
+        MediaDecodeScheduler::get().removeStream(kv.second);
+    }
     deallocatePages(mGuestAddr, kNumPages);
 }
 
 void AddressSpaceHostMediaContext::perform(AddressSpaceDevicePingInfo *info) {
-    handleMediaRequest(info);
+    // The guest reads the results as soon as the ping returns, so wait for
+    // the decoder; what the scheduler buys is bounding and prioritizing the
+    // decode work of many streams instead of running it all on vCPUs.
+    const uint64_t startUs = base::getHighResTimeUs();
+    MediaDecodeScheduler::get().run(streamForSlot(getAddrSlot(info->metadata)),
+                                    [this, info]() { handleMediaRequest(info); });
+    base::recordLatency(base::LatencyMetric::kMediaPing,
+                        base::getHighResTimeUs() - startUs);
+}
+
+MediaDecodeScheduler::StreamId AddressSpaceHostMediaContext::streamForSlot(
+        uint64_t slot) {
+    base::AutoLock lock(mStreamsLock);
+    auto iter = mStreams.find(slot);
+    if (iter != mStreams.end()) {
+        return iter->second;
+    }
+    const MediaDecodeScheduler::StreamId id =
+            MediaDecodeScheduler::get().addStream();
+    mStreams.emplace(slot, id);
+    return id;
+}
+
+void AddressSpaceHostMediaContext::setStreamPriority(
+        uint64_t slot,
+        MediaDecodeScheduler::Priority priority) {
+    MediaDecodeScheduler::get().setPriority(streamForSlot(slot), priority);
+}
+
+std::optional<MediaDecodeScheduler::StreamStats>
+AddressSpaceHostMediaContext::getStreamStats(uint64_t slot) const {
+    base::AutoLock lock(mStreamsLock);
+    auto iter = mStreams.find(slot);
+    if (iter == mStreams.end()) {
+        return std::nullopt;
+    }
+    return MediaDecodeScheduler::get().getStats(iter->second);
 }
 
 AddressSpaceDeviceType AddressSpaceHostMediaContext::getDeviceType() const {
@@ -64,6 +112,9 @@ void AddressSpaceHostMediaContext::save(base::Stream* stream) const {
     if (mH264Decoder != nullptr) {
         ++ numActiveDecoders;
     }
+    if (mHevcDecoder != nullptr) {
+        ++ numActiveDecoders;
+    }
 
     stream->putBe32(numActiveDecoders);
     if (mVpxDecoder != nullptr) {
@@ -76,6 +127,11 @@ void AddressSpaceHostMediaContext::save(base::Stream* stream) const {
         stream->putBe32((uint32_t)DecoderType::H264);
         mH264Decoder->save(stream);
     }
+    if (mHevcDecoder != nullptr) {
+        AS_DEVICE_DPRINT("Saving HevcDecoder snapshot");
+        stream->putBe32((uint32_t)DecoderType::Hevc);
+        mHevcDecoder->save(stream);
+    }
 }
 
 bool AddressSpaceHostMediaContext::load(base::Stream* stream) {
@@ -99,6 +155,11 @@ bool AddressSpaceHostMediaContext::load(base::Stream* stream) {
         //     mH264Decoder.reset(MediaH264Decoder::create());
         //     mH264Decoder->load(stream);
         //     break;
+        // case DecoderType::Hevc:
+        //     AS_DEVICE_DPRINT("Loading HevcDecoder snapshot");
+        //     mHevcDecoder.reset(MediaHevcDecoder::create());
+        //     mHevcDecoder->load(stream);
+        //     break;
         // default:
         //     break;
         // }
@@ -156,12 +217,6 @@ MediaOperation AddressSpaceHostMediaContext::getMediaOperation(uint64_t metadata
             MediaOperation::Max : (MediaOperation)ret;
 }
 
-static uint64_t getAddrSlot(uint64_t metadata) {
-    uint64_t ret = metadata << 8;  // get rid of typecode
-    ret = ret >> 16;               // get rid of opcode
-    return ret;
-}
-
 void AddressSpaceHostMediaContext::handleMediaRequest(AddressSpaceDevicePingInfo *info) {
     auto codecType = getMediaCodecType(info->metadata);
     auto op = getMediaOperation(info->metadata);
@@ -192,6 +247,15 @@ void AddressSpaceHostMediaContext::handleMediaRequest(AddressSpaceDevicePingInfo
                     (uint8_t*)(mControlOps->get_host_ptr(info->phys_addr)) +
                             offSetAddr);
             break;
+        case MediaCodecType::HevcCodec:
+            // if (!mHevcDecoder) {
+            //     mHevcDecoder.reset(MediaHevcDecoder::create());
+            // }
+            mHevcDecoder->handlePing(
+                    codecType, op,
+                    (uint8_t*)(mControlOps->get_host_ptr(info->phys_addr)) +
+                            offSetAddr);
+            break;
         default:
             AS_DEVICE_DPRINT("codec type %d not implemented", (int)codecType);
             break;
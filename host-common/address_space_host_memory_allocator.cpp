@@ -18,6 +18,9 @@
 #include "host-common/crash-handler.h"
 #include "host-common/crash_reporter.h"
 #include "aemu/base/AlignedBuf.h"
+#include "aemu/base/StatsPage.h"
+
+#include <algorithm>
 
 namespace android {
 namespace emulation {
@@ -25,6 +28,39 @@ namespace {
 size_t align(size_t value, size_t alignment) {
     return (value + alignment - 1) & (~(alignment - 1));
 }
+
+#if defined(__APPLE__) && defined(__arm64__)
+constexpr uint64_t k_alloc_alignment = 16384;
+#else
+constexpr uint64_t k_alloc_alignment = 4096;
+#endif
+
+constexpr uint64_t k_min_slot_size = 4096;
+
+// The slot size and size class serving |size| bytes.
+uint64_t slotSizeFor(uint64_t size, int* sizeClass) {
+    uint64_t slotSize = k_min_slot_size;
+    int c = 0;
+    while (slotSize < size || slotSize < k_alloc_alignment) {
+        slotSize *= 2;
+        ++c;
+    }
+    *sizeClass = c;
+    return slotSize;
+}
+
+// Slab memory across all contexts, for StatsPage.
+struct SlabGauges {
+    const base::Stat reserved = base::StatsPage::get().add(
+            "hostmem.slab_reserved_bytes", base::StatKind::kGauge);
+    const base::Stat used = base::StatsPage::get().add(
+            "hostmem.slab_used_bytes", base::StatKind::kGauge);
+};
+
+const SlabGauges& slabGauges() {
+    static const SlabGauges sGauges;
+    return sGauges;
+}
 }
 
 AddressSpaceHostMemoryAllocatorContext::AddressSpaceHostMemoryAllocatorContext(
@@ -56,28 +92,108 @@ void AddressSpaceHostMemoryAllocatorContext::perform(AddressSpaceDevicePingInfo
     info->metadata = result;
 }
 
+void *AddressSpaceHostMemoryAllocatorContext::hostAlloc(const uint64_t size,
+                                                        Slab** slab) {
+    *slab = nullptr;
+    if (size > kMaxSlabSlotSize) {
+        return android::aligned_buf_alloc(k_alloc_alignment, size);
+    }
+
+    int sizeClass;
+    const uint64_t slotSize = slotSizeFor(size, &sizeClass);
+    auto& slabs = m_slabs[sizeClass];
+
+    // The newest slabs are the likeliest to have room.
+    auto i = std::find_if(slabs.rbegin(), slabs.rend(),
+                          [](const std::unique_ptr<Slab>& s) {
+                              return !s->freeSlots.empty();
+                          });
+    Slab* s;
+    if (i != slabs.rend()) {
+        s = i->get();
+    } else {
+        void* bits = android::aligned_buf_alloc(k_alloc_alignment, kSlabSize);
+        if (!bits) {
+            return nullptr;
+        }
+        slabs.emplace_back(new Slab);
+        s = slabs.back().get();
+        s->bits = bits;
+        s->slotSize = slotSize;
+        s->slotCount = kSlabSize / slotSize;
+        // Hand out the low slots first.
+        for (uint32_t slot = s->slotCount; slot > 0; --slot) {
+            s->freeSlots.push_back(slot - 1);
+        }
+        slabGauges().reserved.add(kSlabSize);
+    }
+
+    const uint32_t slot = s->freeSlots.back();
+    s->freeSlots.pop_back();
+    slabGauges().used.add(slotSize);
+    *slab = s;
+    return static_cast<char*>(s->bits) + uint64_t(slot) * slotSize;
+}
+
+void AddressSpaceHostMemoryAllocatorContext::hostFree(const Allocation& allocation) {
+    Slab* s = allocation.slab;
+    if (!s) {
+        android::aligned_buf_free(allocation.ptr);
+        return;
+    }
+
+    const uint64_t offset = static_cast<char*>(allocation.ptr) - static_cast<char*>(s->bits);
+    s->freeSlots.push_back(offset / s->slotSize);
+    slabGauges().used.add(-int64_t(s->slotSize));
+    if (s->freeSlots.size() < s->slotCount) {
+        return;
+    }
+
+    // Keep one empty slab per size class for the next burst.
+    int sizeClass;
+    slotSizeFor(s->slotSize, &sizeClass);
+    auto& slabs = m_slabs[sizeClass];
+    if (slabs.size() == 1) {
+        return;
+    }
+    android::aligned_buf_free(s->bits);
+    slabGauges().reserved.add(-int64_t(kSlabSize));
+    slabs.erase(std::find_if(slabs.begin(), slabs.end(),
+                             [s](const std::unique_ptr<Slab>& p) { return p.get() == s; }));
+}
+
+AddressSpaceHostMemoryAllocatorContext::SlabStats
+AddressSpaceHostMemoryAllocatorContext::slabStats() const {
+    SlabStats stats;
+    for (const auto& slabs : m_slabs) {
+        for (const auto& s : slabs) {
+            ++stats.slabs;
+            stats.reservedBytes += kSlabSize;
+            stats.usedBytes += uint64_t(s->slotCount - s->freeSlots.size()) * s->slotSize;
+        }
+    }
+    return stats;
+}
+
 void *AddressSpaceHostMemoryAllocatorContext::allocate_impl(const uint64_t phys_addr,
                                                             const uint64_t size) {
-#if defined(__APPLE__) && defined(__arm64__)
-    constexpr uint64_t k_alloc_alignment = 16384;
-#else
-    constexpr uint64_t k_alloc_alignment = 4096;
-#endif
     const uint64_t aligned_size = align(size, (*m_hw->getGuestPageSize)());
 
-    void *host_ptr = android::aligned_buf_alloc(k_alloc_alignment, aligned_size);
-    if (host_ptr) {
-        auto r = m_paddr2ptr.insert({phys_addr, {host_ptr, aligned_size}});
+    Allocation allocation;
+    allocation.size = aligned_size;
+    allocation.ptr = hostAlloc(aligned_size, &allocation.slab);
+    if (allocation.ptr) {
+        auto r = m_paddr2ptr.insert({phys_addr, allocation});
         if (r.second) {
-            if (m_ops->add_memory_mapping(phys_addr, host_ptr, aligned_size)) {
-                return host_ptr;
+            if (m_ops->add_memory_mapping(phys_addr, allocation.ptr, aligned_size)) {
+                return allocation.ptr;
             } else {
                 m_paddr2ptr.erase(r.first);
-                android::aligned_buf_free(host_ptr);
+                hostFree(allocation);
                 return nullptr;
             }
         } else {
-            android::aligned_buf_free(host_ptr);
+            hostFree(allocation);
             return nullptr;
         }
     } else {
@@ -98,11 +214,11 @@ uint64_t AddressSpaceHostMemoryAllocatorContext::unallocate(AddressSpaceDevicePi
     const uint64_t phys_addr = info->phys_addr;
     const auto i = m_paddr2ptr.find(phys_addr);
     if (i != m_paddr2ptr.end()) {
-        void* host_ptr = i->second.first;
-        const uint64_t size = i->second.second;
+        void* host_ptr = i->second.ptr;
+        const uint64_t size = i->second.size;
 
         if (m_ops->remove_memory_mapping(phys_addr, host_ptr, size)) {
-            android::aligned_buf_free(host_ptr);
+            hostFree(i->second);
             m_paddr2ptr.erase(i);
             return 0;
         } else {
@@ -123,8 +239,8 @@ void AddressSpaceHostMemoryAllocatorContext::save(base::Stream* stream) const {
 
     for (const auto &kv : m_paddr2ptr) {
         const uint64_t phys_addr = kv.first;
-        const uint64_t size = kv.second.second;
-        const void *mem = kv.second.first;
+        const uint64_t size = kv.second.size;
+        const void *mem = kv.second.ptr;
 
         stream->putBe64(phys_addr);
         stream->putBe64(size);
@@ -156,17 +272,26 @@ bool AddressSpaceHostMemoryAllocatorContext::load(base::Stream* stream) {
 void AddressSpaceHostMemoryAllocatorContext::clear() {
     for (const auto& kv : m_paddr2ptr) {
         uint64_t phys_addr = kv.first;
-        void *host_ptr = kv.second.first;
-        size_t size = kv.second.second;
+        void *host_ptr = kv.second.ptr;
+        size_t size = kv.second.size;
 
         if (m_ops->remove_memory_mapping(phys_addr, host_ptr, size)) {
-            android::aligned_buf_free(host_ptr);
+            hostFree(kv.second);
         } else {
             crashhandler_die("Failed remove a memory mapping {phys_addr=%lx, host_ptr=%p, size=%lu}",
                              phys_addr, host_ptr, size);
         }
     }
     m_paddr2ptr.clear();
+
+    // hostFree() keeps the last slab of each size class.
+    for (auto& slabs : m_slabs) {
+        for (const auto& s : slabs) {
+            android::aligned_buf_free(s->bits);
+            slabGauges().reserved.add(-int64_t(kSlabSize));
+        }
+        slabs.clear();
+    }
 }
 
 }  // namespace emulation
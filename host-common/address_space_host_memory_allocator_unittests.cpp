@@ -179,5 +179,49 @@ TEST(AddressSpaceHostMemoryAllocatorContext, UnallocateTwice) {
     EXPECT_NE(req.metadata, 0);
 }
 
+// Tests that small allocations share slabs and that emptied slabs beyond
+// the first are released.
+TEST(AddressSpaceHostMemoryAllocatorContext, Slabs) {
+    struct address_space_device_control_ops ops =
+        create_address_space_device_control_ops();
+
+    AddressSpaceHwFuncs hw_funcs = create_address_space_device_hw_funcs();
+
+    AddressSpaceHostMemoryAllocatorContext ctx(&ops, &hw_funcs);
+    using Ctx = AddressSpaceHostMemoryAllocatorContext;
+    const uint64_t slotsPerSlab = Ctx::kSlabSize / getGuestPageSize();
+
+    AddressSpaceDevicePingInfo req;
+    for (uint64_t i = 0; i <= slotsPerSlab; ++i) {
+        req = createAllocateRequest(GOOD_GPA_1 + i * getGuestPageSize());
+        ctx.perform(&req);
+        EXPECT_EQ(req.metadata, 0);
+    }
+    EXPECT_EQ(2u, ctx.slabStats().slabs);
+    EXPECT_EQ(2 * Ctx::kSlabSize, ctx.slabStats().reservedBytes);
+    EXPECT_EQ((slotsPerSlab + 1) * getGuestPageSize(), ctx.slabStats().usedBytes);
+
+    // Too big for a slab.
+    req = createAllocateRequest(GOOD_GPA_2);
+    req.size = Ctx::kMaxSlabSlotSize + 1;
+    ctx.perform(&req);
+    EXPECT_EQ(req.metadata, 0);
+    EXPECT_EQ(2u, ctx.slabStats().slabs);
+
+    for (uint64_t i = 0; i < slotsPerSlab; ++i) {
+        req = createUnallocateRequest(GOOD_GPA_1 + i * getGuestPageSize());
+        ctx.perform(&req);
+        EXPECT_EQ(req.metadata, 0);
+    }
+    EXPECT_EQ(1u, ctx.slabStats().slabs);
+    EXPECT_EQ(getGuestPageSize(), ctx.slabStats().usedBytes);
+
+    req = createUnallocateRequest(GOOD_GPA_1 + slotsPerSlab * getGuestPageSize());
+    ctx.perform(&req);
+    EXPECT_EQ(req.metadata, 0);
+    EXPECT_EQ(1u, ctx.slabStats().slabs);
+    EXPECT_EQ(0u, ctx.slabStats().usedBytes);
+}
+
 }  // namespace emulation
 } // namespace android
@@ -0,0 +1,189 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/address_space_host_stats.h"
+
+#include "aemu/base/AlignedBuf.h"
+#include "aemu/base/Metrics.h"
+
+#include <string.h>
+
+#include <variant>
+
+namespace android {
+namespace emulation {
+namespace {
+
+// Covers the largest guest page size we run with, so the page can be mapped
+// on its own.
+constexpr uint64_t kHostPageSize = 16384;
+
+size_t index(HostStat stat) {
+    return static_cast<size_t>(stat);
+}
+
+void store(AddressSpaceHostStatsPage* page, HostStat stat, uint64_t value) {
+    page->values[index(stat)].store(value, std::memory_order_relaxed);
+    page->updates.fetch_add(1, std::memory_order_release);
+}
+
+AddressSpaceHostStatsPage* statsPage();
+
+// Per-role CPU, summed into kHostCpuPermille. Roles report one at a time.
+std::atomic<int64_t> sRoleCpuPermille[static_cast<size_t>(base::ThreadRole::kCount)];
+
+struct MetricObserver {
+    void operator()(const base::MetricEventThreadRoleUsage& usage) const {
+        sRoleCpuPermille[static_cast<size_t>(usage.role)].store(usage.cpuPermille,
+                                                               std::memory_order_relaxed);
+        int64_t total = 0;
+        for (const auto& cpu : sRoleCpuPermille) {
+            total += cpu.load(std::memory_order_relaxed);
+        }
+        store(statsPage(), HostStat::kHostCpuPermille, total);
+        if (usage.role == base::ThreadRole::kAsgConsumer) {
+            store(statsPage(), HostStat::kAsgConsumerCpuPermille, usage.cpuPermille);
+        } else if (usage.role == base::ThreadRole::kMediaDecoder) {
+            store(statsPage(), HostStat::kMediaDecoderCpuPermille, usage.cpuPermille);
+        }
+    }
+
+    void operator()(const base::MetricEventLatencySummary& summary) const {
+        if (summary.metric == base::LatencyMetric::kAsgWake) {
+            store(statsPage(), HostStat::kAsgWakeP99Us, summary.p99Us);
+        } else if (summary.metric == base::LatencyMetric::kMediaDecode) {
+            store(statsPage(), HostStat::kMediaDecodeP99Us, summary.p99Us);
+        }
+    }
+
+    void operator()(const base::MetricEventAsgRingStats& stats) const {
+        store(statsPage(), HostStat::kAsgMaxWakeLatencyUs, stats.maxWakeLatencyUs);
+        store(statsPage(), HostStat::kAsgMaxPollGapUs, stats.maxPollGapUs);
+    }
+
+    void operator()(const base::MetricEventMemoryTrim& trim) const {
+        AddressSpaceHostStatsPage* page = statsPage();
+        page->values[index(HostStat::kMemoryTrims)].fetch_add(1, std::memory_order_relaxed);
+        store(page, HostStat::kMemoryPressure, static_cast<uint64_t>(trim.level));
+    }
+
+    template <class Event>
+    void operator()(const Event&) const {}
+};
+
+// Never freed: contexts may still have it mapped at exit.
+AddressSpaceHostStatsPage* statsPage() {
+    static AddressSpaceHostStatsPage* const sPage = [] {
+        void* bits = android::aligned_buf_alloc(kHostPageSize, kHostPageSize);
+        memset(bits, 0, kHostPageSize);
+        auto* page = static_cast<AddressSpaceHostStatsPage*>(bits);
+        page->magic = AddressSpaceHostStatsPage::kMagic;
+        page->version = AddressSpaceHostStatsPage::kVersion;
+        page->count = static_cast<uint32_t>(HostStat::kCount);
+        base::setMetricEventObserver([](const base::MetricEventType& event) {
+            std::visit(MetricObserver(), event);
+        });
+        return page;
+    }();
+    return sPage;
+}
+
+}  // namespace
+
+AddressSpaceHostStatsContext::AddressSpaceHostStatsContext(
+    const address_space_device_control_ops* ops, const AddressSpaceHwFuncs* hw)
+  : m_ops(ops),
+    m_hw(hw) {
+    statsPage();
+}
+
+AddressSpaceHostStatsContext::~AddressSpaceHostStatsContext() {
+    unmap();
+}
+
+void AddressSpaceHostStatsContext::perform(AddressSpaceDevicePingInfo* info) {
+    uint64_t result;
+
+    switch (static_cast<HostStatsCommand>(info->metadata)) {
+    case HostStatsCommand::Map:
+        result = map(info->phys_addr);
+        if (result == 0) {
+            info->size = mappedSize();
+        }
+        break;
+
+    case HostStatsCommand::Unmap:
+        result = unmap();
+        break;
+
+    default:
+        result = -1;
+        break;
+    }
+
+    info->metadata = result;
+}
+
+uint64_t AddressSpaceHostStatsContext::mappedSize() const {
+    const uint64_t pageSize = (*m_hw->getGuestPageSize)();
+    return pageSize > AddressSpaceHostStatsPage::kSize ? pageSize
+                                                       : AddressSpaceHostStatsPage::kSize;
+}
+
+uint64_t AddressSpaceHostStatsContext::map(uint64_t physAddr) {
+    const uint64_t size = mappedSize();
+    if (m_physAddr || !physAddr || physAddr % size || size > kHostPageSize) {
+        return -1;
+    }
+    if (!m_ops->add_memory_mapping(physAddr, statsPage(), size)) {
+        return -1;
+    }
+    m_physAddr = physAddr;
+    return 0;
+}
+
+uint64_t AddressSpaceHostStatsContext::unmap() {
+    if (!m_physAddr) {
+        return -1;
+    }
+    m_ops->remove_memory_mapping(m_physAddr, statsPage(), mappedSize());
+    m_physAddr = 0;
+    return 0;
+}
+
+AddressSpaceDeviceType AddressSpaceHostStatsContext::getDeviceType() const {
+    return AddressSpaceDeviceType::HostStats;
+}
+
+// The values are the host's, not the guest's; only the mapping is saved.
+void AddressSpaceHostStatsContext::save(base::Stream* stream) const {
+    stream->putBe64(m_physAddr);
+}
+
+bool AddressSpaceHostStatsContext::load(base::Stream* stream) {
+    unmap();
+    const uint64_t physAddr = stream->getBe64();
+    return !physAddr || map(physAddr) == 0;
+}
+
+void AddressSpaceHostStatsContext::set(HostStat stat, uint64_t value) {
+    store(statsPage(), stat, value);
+}
+
+uint64_t AddressSpaceHostStatsContext::value(HostStat stat) {
+    return statsPage()->values[index(stat)].load(std::memory_order_relaxed);
+}
+
+}  // namespace emulation
+}  // namespace android
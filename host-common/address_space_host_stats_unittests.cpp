@@ -0,0 +1,165 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/address_space_host_stats.h"
+
+#include "aemu/base/Metrics.h"
+#include "aemu/base/files/MemStream.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+namespace android {
+namespace emulation {
+
+namespace {
+constexpr uint64_t GPA = 0x10002000;
+
+// Mapped guest addresses to host pointers.
+std::map<uint64_t, void*> sMappings;
+
+int add_memory_mapping(uint64_t gpa, void* ptr, uint64_t size) {
+    return sMappings.emplace(gpa, ptr).second ? 1 : 0;
+}
+
+int remove_memory_mapping(uint64_t gpa, void* ptr, uint64_t size) {
+    return sMappings.erase(gpa) ? 1 : 0;
+}
+
+uint32_t getGuestPageSize() {
+    return 4096;
+}
+
+uint64_t perform(AddressSpaceHostStatsContext* ctx,
+                 AddressSpaceHostStatsContext::HostStatsCommand command,
+                 uint64_t phys_addr = 0,
+                 uint64_t* size = nullptr) {
+    AddressSpaceDevicePingInfo req = {};
+    req.metadata = static_cast<uint64_t>(command);
+    req.phys_addr = phys_addr;
+    ctx->perform(&req);
+    if (size) {
+        *size = req.size;
+    }
+    return req.metadata;
+}
+
+class AddressSpaceHostStatsContextTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        sMappings.clear();
+        mOps.add_memory_mapping = &add_memory_mapping;
+        mOps.remove_memory_mapping = &remove_memory_mapping;
+        mHw.getGuestPageSize = &getGuestPageSize;
+    }
+
+    const AddressSpaceHostStatsPage* mapped(uint64_t gpa) const {
+        auto it = sMappings.find(gpa);
+        return it == sMappings.end()
+                   ? nullptr
+                   : static_cast<const AddressSpaceHostStatsPage*>(it->second);
+    }
+
+    struct address_space_device_control_ops mOps = {};
+    AddressSpaceHwFuncs mHw = {};
+};
+
+}  // namespace
+
+using Command = AddressSpaceHostStatsContext::HostStatsCommand;
+
+// Tests that the page maps once per context at an aligned address, and is
+// unmapped when the context goes.
+TEST_F(AddressSpaceHostStatsContextTest, MapUnmap) {
+    {
+        AddressSpaceHostStatsContext ctx(&mOps, &mHw);
+        uint64_t size = 0;
+        EXPECT_EQ(uint64_t(-1), perform(&ctx, Command::Map, GPA + 8));
+        EXPECT_EQ(0u, perform(&ctx, Command::Map, GPA, &size));
+        EXPECT_EQ(4096u, size);
+        EXPECT_EQ(uint64_t(-1), perform(&ctx, Command::Map, GPA + 4096));
+
+        const AddressSpaceHostStatsPage* page = mapped(GPA);
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ(AddressSpaceHostStatsPage::kMagic, page->magic);
+        EXPECT_EQ(AddressSpaceHostStatsPage::kVersion, page->version);
+        EXPECT_EQ(static_cast<uint32_t>(HostStat::kCount), page->count);
+
+        // Another context shares the same page.
+        AddressSpaceHostStatsContext other(&mOps, &mHw);
+        EXPECT_EQ(0u, perform(&other, Command::Map, GPA + 4096));
+        EXPECT_EQ(page, mapped(GPA + 4096));
+        EXPECT_EQ(0u, perform(&other, Command::Unmap));
+        EXPECT_EQ(uint64_t(-1), perform(&other, Command::Unmap));
+    }
+    EXPECT_TRUE(sMappings.empty());
+}
+
+// Tests that set() values and reported metrics show up in the guest's page.
+TEST_F(AddressSpaceHostStatsContextTest, Updates) {
+    AddressSpaceHostStatsContext ctx(&mOps, &mHw);
+    ASSERT_EQ(0u, perform(&ctx, Command::Map, GPA));
+    const AddressSpaceHostStatsPage* page = mapped(GPA);
+    auto value = [page](HostStat stat) {
+        return page->values[static_cast<size_t>(stat)].load();
+    };
+
+    const uint64_t updates = page->updates.load();
+    AddressSpaceHostStatsContext::set(HostStat::kMediaDecodeQueueDepth, 7);
+    EXPECT_EQ(7u, value(HostStat::kMediaDecodeQueueDepth));
+    EXPECT_EQ(updates + 1, page->updates.load());
+
+    auto logger = base::CreateMetricsLogger();
+    logger->logMetricEvent(base::MetricEventThreadRoleUsage{
+        .role = base::ThreadRole::kAsgConsumer, .cpuPermille = 250});
+    logger->logMetricEvent(base::MetricEventThreadRoleUsage{
+        .role = base::ThreadRole::kMediaDecoder, .cpuPermille = 100});
+    EXPECT_EQ(250u, value(HostStat::kAsgConsumerCpuPermille));
+    EXPECT_EQ(100u, value(HostStat::kMediaDecoderCpuPermille));
+    EXPECT_GE(value(HostStat::kHostCpuPermille), 350u);
+
+    logger->logMetricEvent(base::MetricEventLatencySummary{
+        .metric = base::LatencyMetric::kAsgWake, .count = 1, .p99Us = 42});
+    logger->logMetricEvent(base::MetricEventAsgRingStats{
+        .rings = 2, .maxWakeLatencyUs = 90, .maxPollGapUs = 300});
+    EXPECT_EQ(42u, value(HostStat::kAsgWakeP99Us));
+    EXPECT_EQ(90u, value(HostStat::kAsgMaxWakeLatencyUs));
+    EXPECT_EQ(300u, value(HostStat::kAsgMaxPollGapUs));
+
+    const uint64_t trims = value(HostStat::kMemoryTrims);
+    logger->logMetricEvent(base::MetricEventMemoryTrim{
+        .level = base::MemoryPressureLevel::kCritical});
+    EXPECT_EQ(trims + 1, value(HostStat::kMemoryTrims));
+    EXPECT_EQ(static_cast<uint64_t>(base::MemoryPressureLevel::kCritical),
+              value(HostStat::kMemoryPressure));
+}
+
+// Tests that a snapshot brings the mapping back.
+TEST_F(AddressSpaceHostStatsContextTest, SaveLoad) {
+    base::MemStream stream;
+    {
+        AddressSpaceHostStatsContext ctx(&mOps, &mHw);
+        ASSERT_EQ(0u, perform(&ctx, Command::Map, GPA));
+        ctx.save(&stream);
+    }
+    ASSERT_TRUE(sMappings.empty());
+
+    AddressSpaceHostStatsContext ctx(&mOps, &mHw);
+    ASSERT_TRUE(ctx.load(&stream));
+    EXPECT_NE(nullptr, mapped(GPA));
+}
+
+}  // namespace emulation
+}  // namespace android
@@ -0,0 +1,191 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/address_space_refcount.h"
+#include "host-common/RefcountPipe.h"
+
+#include "aemu/base/synchronization/Lock.h"
+
+namespace android {
+namespace emulation {
+namespace {
+
+// Batches may not cross a page, since consecutive guest pages need not be
+// consecutive on the host.
+constexpr uint64_t kBatchPageSize = 4096;
+
+// Total counts over all contexts.
+struct GlobalCounts {
+    base::Lock lock;
+    std::unordered_map<uint32_t, uint32_t> counts;
+};
+
+GlobalCounts& globalCounts() {
+    static GlobalCounts* const sCounts = new GlobalCounts();
+    return *sCounts;
+}
+
+void globalAcquire(uint32_t handle, uint32_t count) {
+    GlobalCounts& global = globalCounts();
+    base::AutoLock lock(global.lock);
+    global.counts[handle] += count;
+}
+
+// Runs the last-reference callback outside the lock, since it may call
+// back into the renderer for a while.
+void globalRelease(uint32_t handle, uint32_t count) {
+    GlobalCounts& global = globalCounts();
+    {
+        base::AutoLock lock(global.lock);
+        auto it = global.counts.find(handle);
+        if (it == global.counts.end()) {
+            return;
+        }
+        if (it->second > count) {
+            it->second -= count;
+            return;
+        }
+        global.counts.erase(it);
+    }
+    onLastColorBufferRef(handle);
+}
+
+}  // namespace
+
+AddressSpaceRefcountContext::AddressSpaceRefcountContext(
+    const address_space_device_control_ops *ops)
+  : m_ops(ops) {}
+
+AddressSpaceRefcountContext::~AddressSpaceRefcountContext() {
+    clear();
+}
+
+void AddressSpaceRefcountContext::perform(AddressSpaceDevicePingInfo *info) {
+    uint64_t result;
+
+    switch (static_cast<RefcountCommand>(info->metadata)) {
+    case RefcountCommand::Acquire:
+        result = acquire(static_cast<uint32_t>(info->size));
+        break;
+
+    case RefcountCommand::Release:
+        result = release(static_cast<uint32_t>(info->size));
+        break;
+
+    case RefcountCommand::AcquireBatch:
+    case RefcountCommand::ReleaseBatch: {
+        const uint32_t* handles = guestHandles(info);
+        if (!handles) {
+            result = -1;
+            break;
+        }
+        const bool isAcquire =
+            static_cast<RefcountCommand>(info->metadata) == RefcountCommand::AcquireBatch;
+        result = 0;
+        for (uint64_t i = 0; i < info->size; ++i) {
+            if ((isAcquire ? acquire(handles[i]) : release(handles[i])) != 0) {
+                result = -1;
+            }
+        }
+        break;
+    }
+
+    default:
+        result = -1;
+        break;
+    }
+
+    info->metadata = result;
+}
+
+uint64_t AddressSpaceRefcountContext::acquire(uint32_t handle) {
+    if (!handle) {
+        return -1;
+    }
+    ++m_counts[handle];
+    globalAcquire(handle, 1);
+    return 0;
+}
+
+uint64_t AddressSpaceRefcountContext::release(uint32_t handle) {
+    const auto i = m_counts.find(handle);
+    if (i == m_counts.end()) {
+        return -1;
+    }
+    if (!--i->second) {
+        m_counts.erase(i);
+    }
+    globalRelease(handle, 1);
+    return 0;
+}
+
+const uint32_t* AddressSpaceRefcountContext::guestHandles(
+        const AddressSpaceDevicePingInfo *info) const {
+    const uint64_t bytes = info->size * sizeof(uint32_t);
+    if (!info->size || info->size > kBatchPageSize / sizeof(uint32_t) ||
+        (info->phys_addr % kBatchPageSize) + bytes > kBatchPageSize ||
+        info->phys_addr % sizeof(uint32_t) || !m_ops->get_host_ptr) {
+        return nullptr;
+    }
+    return static_cast<const uint32_t*>(m_ops->get_host_ptr(info->phys_addr));
+}
+
+AddressSpaceDeviceType AddressSpaceRefcountContext::getDeviceType() const {
+    return AddressSpaceDeviceType::Refcount;
+}
+
+void AddressSpaceRefcountContext::save(base::Stream* stream) const {
+    stream->putBe32(m_counts.size());
+
+    for (const auto &kv : m_counts) {
+        stream->putBe32(kv.first);
+        stream->putBe32(kv.second);
+    }
+}
+
+bool AddressSpaceRefcountContext::load(base::Stream* stream) {
+    clear();
+
+    const size_t numHandles = stream->getBe32();
+
+    for (size_t i = 0; i < numHandles; ++i) {
+        const uint32_t handle = stream->getBe32();
+        const uint32_t count = stream->getBe32();
+        if (!handle || !count) {
+            return false;
+        }
+        m_counts[handle] += count;
+        globalAcquire(handle, count);
+    }
+
+    return true;
+}
+
+uint32_t AddressSpaceRefcountContext::globalCount(uint32_t handle) {
+    GlobalCounts& global = globalCounts();
+    base::AutoLock lock(global.lock);
+    const auto it = global.counts.find(handle);
+    return it == global.counts.end() ? 0 : it->second;
+}
+
+void AddressSpaceRefcountContext::clear() {
+    std::unordered_map<uint32_t, uint32_t> counts;
+    counts.swap(m_counts);
+    for (const auto &kv : counts) {
+        globalRelease(kv.first, kv.second);
+    }
+}
+
+}  // namespace emulation
+}  // namespace android
@@ -0,0 +1,164 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/address_space_refcount.h"
+#include "host-common/RefcountPipe.h"
+
+#include "aemu/base/files/MemStream.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace android {
+namespace emulation {
+
+namespace {
+constexpr uint64_t BATCH_GPA = 0x10001000;
+
+uint32_t sBatch[1024];
+std::vector<uint32_t> sLastRefs;
+
+void* get_host_ptr(uint64_t gpa) {
+    if (gpa < BATCH_GPA || gpa >= BATCH_GPA + sizeof(sBatch)) {
+        return nullptr;
+    }
+    return reinterpret_cast<char*>(sBatch) + (gpa - BATCH_GPA);
+}
+
+struct address_space_device_control_ops create_address_space_device_control_ops() {
+    struct address_space_device_control_ops ops = {};
+
+    ops.get_host_ptr = &get_host_ptr;
+
+    return ops;
+}
+
+AddressSpaceDevicePingInfo createRequest(
+        AddressSpaceRefcountContext::RefcountCommand command,
+        uint64_t size,
+        uint64_t phys_addr = 0) {
+    AddressSpaceDevicePingInfo req = {};
+
+    req.metadata = static_cast<uint64_t>(command);
+    req.phys_addr = phys_addr;
+    req.size = size;
+
+    return req;
+}
+
+uint64_t perform(AddressSpaceRefcountContext* ctx,
+                 AddressSpaceRefcountContext::RefcountCommand command,
+                 uint64_t size,
+                 uint64_t phys_addr = 0) {
+    AddressSpaceDevicePingInfo req = createRequest(command, size, phys_addr);
+    ctx->perform(&req);
+    return req.metadata;
+}
+
+class AddressSpaceRefcountContextTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        sLastRefs.clear();
+        registerOnLastRefCallback([](uint32_t handle) { sLastRefs.push_back(handle); });
+    }
+    void TearDown() override { registerOnLastRefCallback(nullptr); }
+
+    struct address_space_device_control_ops mOps =
+        create_address_space_device_control_ops();
+};
+
+using Command = AddressSpaceRefcountContext::RefcountCommand;
+}  // namespace
+
+TEST_F(AddressSpaceRefcountContextTest, getDeviceType) {
+    AddressSpaceRefcountContext ctx(&mOps);
+    EXPECT_EQ(ctx.getDeviceType(), AddressSpaceDeviceType::Refcount);
+}
+
+// Tests that the callback runs once the last reference in any context
+// goes away, and that unknown handles are rejected.
+TEST_F(AddressSpaceRefcountContextTest, LastReferenceAcrossContexts) {
+    AddressSpaceRefcountContext a(&mOps);
+    AddressSpaceRefcountContext b(&mOps);
+
+    EXPECT_EQ(perform(&a, Command::Acquire, 7), 0u);
+    EXPECT_EQ(perform(&a, Command::Acquire, 7), 0u);
+    EXPECT_EQ(perform(&b, Command::Acquire, 7), 0u);
+    EXPECT_EQ(AddressSpaceRefcountContext::globalCount(7), 3u);
+
+    EXPECT_EQ(perform(&a, Command::Release, 7), 0u);
+    EXPECT_EQ(perform(&a, Command::Release, 7), 0u);
+    EXPECT_EQ(perform(&a, Command::Release, 7), uint64_t(-1));
+    EXPECT_TRUE(sLastRefs.empty());
+
+    EXPECT_EQ(perform(&b, Command::Release, 7), 0u);
+    EXPECT_EQ(sLastRefs, std::vector<uint32_t>{7});
+    EXPECT_EQ(AddressSpaceRefcountContext::globalCount(7), 0u);
+
+    EXPECT_EQ(perform(&a, Command::Acquire, 0), uint64_t(-1));
+}
+
+// Tests that a context going away releases whatever it still holds.
+TEST_F(AddressSpaceRefcountContextTest, DestroyReleases) {
+    AddressSpaceRefcountContext b(&mOps);
+    perform(&b, Command::Acquire, 2);
+    {
+        AddressSpaceRefcountContext a(&mOps);
+        perform(&a, Command::Acquire, 1);
+        perform(&a, Command::Acquire, 1);
+        perform(&a, Command::Acquire, 2);
+    }
+    EXPECT_EQ(sLastRefs, std::vector<uint32_t>{1});
+    EXPECT_EQ(AddressSpaceRefcountContext::globalCount(2), 1u);
+}
+
+// Tests handles passed through guest memory, within one page.
+TEST_F(AddressSpaceRefcountContextTest, Batch) {
+    AddressSpaceRefcountContext ctx(&mOps);
+    for (uint32_t i = 0; i < 100; ++i) {
+        sBatch[i] = i + 100;
+    }
+    EXPECT_EQ(perform(&ctx, Command::AcquireBatch, 100, BATCH_GPA), 0u);
+    EXPECT_EQ(AddressSpaceRefcountContext::globalCount(150), 1u);
+
+    EXPECT_EQ(perform(&ctx, Command::ReleaseBatch, 50, BATCH_GPA + 200), 0u);
+    EXPECT_EQ(sLastRefs.size(), 50u);
+    EXPECT_EQ(sLastRefs.front(), 150u);
+
+    EXPECT_EQ(perform(&ctx, Command::ReleaseBatch, 2, BATCH_GPA + 4094), uint64_t(-1));
+    EXPECT_EQ(perform(&ctx, Command::ReleaseBatch, 1025, BATCH_GPA), uint64_t(-1));
+    EXPECT_EQ(perform(&ctx, Command::ReleaseBatch, 1, 0x1234000), uint64_t(-1));
+}
+
+TEST_F(AddressSpaceRefcountContextTest, SaveLoad) {
+    base::MemStream stream;
+    {
+        AddressSpaceRefcountContext ctx(&mOps);
+        perform(&ctx, Command::Acquire, 3);
+        perform(&ctx, Command::Acquire, 3);
+        perform(&ctx, Command::Acquire, 4);
+        ctx.save(&stream);
+    }
+    sLastRefs.clear();
+
+    AddressSpaceRefcountContext ctx(&mOps);
+    EXPECT_TRUE(ctx.load(&stream));
+    EXPECT_EQ(AddressSpaceRefcountContext::globalCount(3), 2u);
+    EXPECT_EQ(perform(&ctx, Command::Release, 4), 0u);
+    EXPECT_EQ(sLastRefs, std::vector<uint32_t>{4});
+}
+
+}  // namespace emulation
+}  // namespace android
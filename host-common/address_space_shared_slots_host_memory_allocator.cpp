@@ -17,8 +17,13 @@
 #include "host-common/vm_operations.h"
 #include "host-common/crash-handler.h"
 #include "host-common/crash_reporter.h"
-#include "aemu/base/AlignedBuf.h"
+#include "aemu/base/StatsPage.h"
+#include "aemu/base/memory/BlockMemory.h"
+#include "aemu/base/memory/MemoryHints.h"
+#include "aemu/base/memory/MemoryPressure.h"
 #include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/system/System.h"
+#include <atomic>
 #include <map>
 #include <unordered_set>
 #include <unordered_map>
@@ -36,7 +41,9 @@ typedef ASSSHMAC::MemBlock MemBlock;
 typedef MemBlock::FreeSubblocks_t FreeSubblocks_t;
 
 using base::AutoLock;
-using base::Lock;
+using base::AutoReadLock;
+using base::AutoWriteLock;
+using base::ReadWriteLock;
 
 #if defined(__APPLE__) && defined(__arm64__)
 constexpr uint32_t kAllocAlignment = 16384;
@@ -76,15 +83,61 @@ int freeAddressBlock(const AddressSpaceHwFuncs* hw, uint64_t phys) {
     return hw->freeSharedHostRegionLocked(phys - start);
 }
 
+// Readers of g_blocks may allocate from and free into a block while holding
+// its own lock; adding or removing blocks takes g_blocksLock for writing.
 std::map<uint64_t, MemBlock> g_blocks;
-Lock g_blocksLock;
+// Blocks restored from a snapshot, by the physBase they had when saved.
+std::map<uint64_t, MemBlock*> g_blocksByPhysBaseLoaded;
+ReadWriteLock g_blocksLock("shared_slots.g_blocksLock");
+std::atomic<uint64_t> g_lastMaintenanceUs{0};
+// Set under critical memory pressure: the next maintenance frees every
+// empty block. That unmaps guest memory, so it isn't done by the trimmer.
+std::atomic<bool> g_dropEmptyBlocks{false};
+
+struct BlockGauges {
+    const base::Stat blocks = base::StatsPage::get().add(
+            "shared_slots.blocks", base::StatKind::kGauge);
+    const base::Stat reserved = base::StatsPage::get().add(
+            "shared_slots.reserved_bytes", base::StatKind::kGauge);
+    const base::Stat used = base::StatsPage::get().add(
+            "shared_slots.used_bytes", base::StatKind::kGauge);
+    const base::Stat fragmentation = base::StatsPage::get().add(
+            "shared_slots.fragmentation_permille", base::StatKind::kGauge);
+    const base::Stat released = base::StatsPage::get().add(
+            "shared_slots.released_bytes", base::StatKind::kCounter);
+};
+
+const BlockGauges& blockGauges() {
+    static const BlockGauges sGauges;
+    return sGauges;
+}
+
+void registerMemoryTrimmer() {
+    static base::MemoryTrimmer sTrimmer(
+            "shared_slots", base::TrimCost::kCheap, 0,
+            [](base::MemoryPressureLevel level) { return ASSSHMAC::trim(level); });
+}
+
+uint64_t releaseFreeMemoryOfBlocks() {
+    uint64_t released = 0;
+    AutoReadLock lock(g_blocksLock);
+    for (auto& kv : g_blocks) {
+        AutoLock blockLock(kv.second.lock);
+        released += kv.second.releaseFreeMemory();
+    }
+    blockGauges().released.add(released);
+    return released;
+}
 
 std::pair<uint64_t, MemBlock*> translatePhysAddr(uint64_t p) {
-    for (auto& kv: g_blocks) {
-        MemBlock& block = kv.second;
-        if (p >= block.physBaseLoaded && p < block.physBaseLoaded + block.bitsSize) {
-            return {block.physBase + (p - block.physBaseLoaded), &block};
-        }
+    auto i = g_blocksByPhysBaseLoaded.upper_bound(p);
+    if (i == g_blocksByPhysBaseLoaded.begin()) {
+        return {0, nullptr};
+    }
+
+    MemBlock& block = *std::prev(i)->second;
+    if (p < block.physBaseLoaded + block.bitsSize) {
+        return {block.physBase + (p - block.physBaseLoaded), &block};
     }
 
     return {0, nullptr};
@@ -93,7 +146,8 @@ std::pair<uint64_t, MemBlock*> translatePhysAddr(uint64_t p) {
 
 MemBlock::MemBlock(const address_space_device_control_ops* o, const AddressSpaceHwFuncs* h, uint32_t sz)
         : ops(o), hw(h) {
-    bits = android::aligned_buf_alloc(kAllocAlignment, sz);
+    memory = base::allocateBlockMemory(sz, kAllocAlignment);
+    bits = memory.ptr;
     bitsSize = sz;
     physBase = allocateAddressSpaceBlock(hw, sz);
     if (!physBase) {
@@ -104,9 +158,8 @@ MemBlock::MemBlock(const address_space_device_control_ops* o, const AddressSpace
         crashhandler_die("%s:%d: add_memory_mapping", __func__, __LINE__);
     }
 
-    if (!freeSubblocks.insert({0, sz}).second) {
-        crashhandler_die("%s:%d: freeSubblocks.insert", __func__, __LINE__);
-    }
+    insertFreeSubblock(0, sz);
+    emptySinceUs = base::getHighResTimeUs();
 }
 
 MemBlock::MemBlock(MemBlock&& rhs)
@@ -116,7 +169,12 @@ MemBlock::MemBlock(MemBlock&& rhs)
       physBaseLoaded(std::exchange(rhs.physBaseLoaded, 0)),
       bits(std::exchange(rhs.bits, nullptr)),
       bitsSize(std::exchange(rhs.bitsSize, 0)),
-      freeSubblocks(std::move(rhs.freeSubblocks)) {
+      memory(std::exchange(rhs.memory, base::BlockMemory())),
+      freeSubblocks(std::move(rhs.freeSubblocks)),
+      freeSizes(std::move(rhs.freeSizes)),
+      usedBytes(std::exchange(rhs.usedBytes, 0)),
+      emptySinceUs(std::exchange(rhs.emptySinceUs, 0)),
+      freedSinceRelease(std::exchange(rhs.freedSinceRelease, false)) {
 }
 
 MemBlock& MemBlock::operator=(MemBlock rhs) {
@@ -128,7 +186,7 @@ MemBlock::~MemBlock() {
     if (physBase) {
         ops->remove_memory_mapping(physBase, bits, bitsSize);
         freeAddressBlock(hw, physBase);
-        android::aligned_buf_free(bits);
+        base::freeBlockMemory(&memory);
     }
 }
 
@@ -139,7 +197,12 @@ void swap(MemBlock& lhs, MemBlock& rhs) {
     swap(lhs.physBaseLoaded,    rhs.physBaseLoaded);
     swap(lhs.bits,              rhs.bits);
     swap(lhs.bitsSize,          rhs.bitsSize);
+    swap(lhs.memory,            rhs.memory);
     swap(lhs.freeSubblocks,     rhs.freeSubblocks);
+    swap(lhs.freeSizes,         rhs.freeSizes);
+    swap(lhs.usedBytes,         rhs.usedBytes);
+    swap(lhs.emptySinceUs,      rhs.emptySinceUs);
+    swap(lhs.freedSinceRelease, rhs.freedSinceRelease);
 }
 
 
@@ -152,22 +215,47 @@ bool MemBlock::isAllFree() const {
     }
 }
 
+uint32_t MemBlock::largestFreeSubblock() const {
+    return freeSizes.empty() ? 0 : freeSizes.rbegin()->first;
+}
+
+FreeSubblocks_t::iterator MemBlock::insertFreeSubblock(const uint32_t offset,
+                                                       const uint32_t size) {
+    auto r = freeSubblocks.insert({offset, size});
+    if (!r.second) {
+        crashhandler_die("%s:%d: freeSubblocks.insert", __func__, __LINE__);
+    }
+    freeSizes.insert({size, offset});
+    return r.first;
+}
+
+void MemBlock::eraseFreeSubblock(FreeSubblocks_t::iterator i) {
+    freeSizes.erase({i->second, i->first});
+    freeSubblocks.erase(i);
+}
+
 uint64_t MemBlock::allocate(const size_t requestedSize) {
-    FreeSubblocks_t::iterator i = findFreeSubblock(&freeSubblocks, requestedSize);
-    if (i == freeSubblocks.end()) {
+    if (requestedSize > bitsSize) {
+        return 0;
+    }
+
+    // Best fit: the smallest free subblock that is large enough, lowest
+    // offset first among equals.
+    const auto best = freeSizes.lower_bound({uint32_t(requestedSize), 0});
+    if (best == freeSizes.end()) {
         return 0;
     }
 
-    const uint32_t subblockOffset = i->first;
-    const uint32_t subblockSize = i->second;
+    const uint32_t subblockSize = best->first;
+    const uint32_t subblockOffset = best->second;
 
-    freeSubblocks.erase(i);
+    eraseFreeSubblock(freeSubblocks.find(subblockOffset));
     if (subblockSize > requestedSize) {
-        if (!freeSubblocks.insert({subblockOffset + requestedSize,
-                                   subblockSize - requestedSize}).second) {
-            crashhandler_die("%s:%d: freeSubblocks.insert", __func__, __LINE__);
-        }
+        insertFreeSubblock(subblockOffset + requestedSize,
+                           subblockSize - requestedSize);
     }
+    usedBytes += requestedSize;
+    emptySinceUs = 0;
 
     return physBase + subblockOffset;
 }
@@ -178,19 +266,52 @@ void MemBlock::unallocate(
         crashhandler_die("%s:%d: phys >= physBase + bitsSize", __func__, __LINE__);
     }
 
-    auto r = freeSubblocks.insert({phys - physBase, subblockSize});
-    if (!r.second) {
+    uint32_t offset = phys - physBase;
+    uint32_t size = subblockSize;
+
+    // Coalesce with the free neighbours before indexing the result.
+    auto next = freeSubblocks.lower_bound(offset);
+    if (next != freeSubblocks.end() && next->first == offset) {
         crashhandler_die("%s:%d: freeSubblocks.insert", __func__, __LINE__);
     }
+    if (next != freeSubblocks.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            eraseFreeSubblock(prev);
+        }
+    }
+    if (next != freeSubblocks.end() && offset + size == next->first) {
+        size += next->second;
+        eraseFreeSubblock(next);
+    }
 
-    FreeSubblocks_t::iterator i = r.first;
-    if (i != freeSubblocks.begin()) {
-        i = tryMergeSubblocks(&freeSubblocks, i, std::prev(i), i);
+    insertFreeSubblock(offset, size);
+    usedBytes -= subblockSize;
+    freedSinceRelease = true;
+    if (!usedBytes) {
+        emptySinceUs = base::getHighResTimeUs();
     }
-    FreeSubblocks_t::iterator next = std::next(i);
-    if (next != freeSubblocks.end()) {
-        i = tryMergeSubblocks(&freeSubblocks, i, i, next);
+}
+
+uint64_t MemBlock::releaseFreeMemory() {
+    if (!freedSinceRelease || !memory.mapped) {
+        return 0;
+    }
+    freedSinceRelease = false;
+
+    uint64_t released = 0;
+    for (const auto& kv : freeSubblocks) {
+        const uint64_t begin = align(kv.first, base::kBlockHugePageSize);
+        const uint64_t end = (uint64_t(kv.first) + kv.second) & ~(base::kBlockHugePageSize - 1);
+        if (end > begin &&
+            base::memoryHint(static_cast<char*>(bits) + begin, end - begin,
+                             base::MemoryHint::DontNeed)) {
+            released += end - begin;
+        }
     }
+    return released;
 }
 
 FreeSubblocks_t::iterator MemBlock::findFreeSubblock(FreeSubblocks_t* fsb,
@@ -202,7 +323,7 @@ FreeSubblocks_t::iterator MemBlock::findFreeSubblock(FreeSubblocks_t* fsb,
         size_t bestSize = ~size_t(0);
 
         for (auto i = fsb->begin(); i != fsb->end(); ++i) {
-            if (i->second >= sz && sz < bestSize) {
+            if (i->second >= sz && i->second < bestSize) {
                 best = i;
                 bestSize = i->second;
             }
@@ -251,43 +372,46 @@ bool MemBlock::load(base::Stream* stream,
                     MemBlock* block) {
     const uint64_t physBaseLoaded = stream->getBe64();
     const uint32_t bitsSize = stream->getBe32();
-    void* const bits = android::aligned_buf_alloc(kAllocAlignment, bitsSize);
+    base::BlockMemory memory = base::allocateBlockMemory(bitsSize, kAllocAlignment);
+    void* const bits = memory.ptr;
     if (!bits) {
         return false;
     }
     if (stream->read(bits, bitsSize) != static_cast<ssize_t>(bitsSize)) {
-        android::aligned_buf_free(bits);
+        base::freeBlockMemory(&memory);
         return false;
     }
     const uint64_t physBase = allocateAddressSpaceBlockFixed(physBaseLoaded, hw, bitsSize);
     if (!physBase) {
-        android::aligned_buf_free(bits);
+        base::freeBlockMemory(&memory);
         return false;
     }
     if (!ops->add_memory_mapping(physBase, bits, bitsSize)) {
         freeAddressBlock(hw, physBase);
-        android::aligned_buf_free(bits);
+        base::freeBlockMemory(&memory);
         return false;
     }
 
-    FreeSubblocks_t freeSubblocks;
-    for (uint32_t freeSubblocksSize = stream->getBe32();
-         freeSubblocksSize > 0;
-         --freeSubblocksSize) {
-        const uint32_t off = stream->getBe32();
-        const uint32_t sz = stream->getBe32();
-        if (!freeSubblocks.insert({off, sz}).second) {
-            crashhandler_die("%s:%d: freeSubblocks.insert", __func__, __LINE__);
-        }
-    }
-
     block->hw = hw;
     block->ops = ops;
     block->physBase = physBase;
     block->physBaseLoaded = physBaseLoaded;
     block->bits = bits;
     block->bitsSize = bitsSize;
-    block->freeSubblocks = std::move(freeSubblocks);
+    block->memory = memory;
+    block->freeSubblocks.clear();
+    block->freeSizes.clear();
+    block->usedBytes = bitsSize;
+
+    for (uint32_t freeSubblocksSize = stream->getBe32();
+         freeSubblocksSize > 0;
+         --freeSubblocksSize) {
+        const uint32_t off = stream->getBe32();
+        const uint32_t sz = stream->getBe32();
+        block->insertFreeSubblock(off, sz);
+        block->usedBytes -= sz;
+    }
+    block->emptySinceUs = block->usedBytes ? 0 : base::getHighResTimeUs();
 
     return true;
 }
@@ -295,7 +419,9 @@ bool MemBlock::load(base::Stream* stream,
 AddressSpaceSharedSlotsHostMemoryAllocatorContext::AddressSpaceSharedSlotsHostMemoryAllocatorContext(
     const address_space_device_control_ops *ops, const AddressSpaceHwFuncs* hw)
   : m_ops(ops),
-    m_hw(hw) {}
+    m_hw(hw) {
+    registerMemoryTrimmer();
+}
 
 AddressSpaceSharedSlotsHostMemoryAllocatorContext::~AddressSpaceSharedSlotsHostMemoryAllocatorContext() {
     clear();
@@ -330,14 +456,45 @@ AddressSpaceSharedSlotsHostMemoryAllocatorContext::allocate(
         AddressSpaceDevicePingInfo *info) {
     const uint32_t alignedSize = align(info->size, (*m_hw->getGuestPageSize)());
 
-    AutoLock lock(g_blocksLock);
-    for (auto& kv : g_blocks) {
-        uint64_t physAddr = kv.second.allocate(alignedSize);
-        if (physAddr) {
-            return populatePhysAddr(info, physAddr, alignedSize, &kv.second);
+    {
+        AutoReadLock lock(g_blocksLock);
+
+        // The fullest block with room, so that the emptier ones drain and
+        // can be freed.
+        MemBlock* fullest = nullptr;
+        uint32_t fullestUsed = 0;
+        for (auto& kv : g_blocks) {
+            MemBlock& block = kv.second;
+            AutoLock blockLock(block.lock);
+            if (block.largestFreeSubblock() >= alignedSize &&
+                (!fullest || block.usedBytes > fullestUsed)) {
+                fullest = &block;
+                fullestUsed = block.usedBytes;
+            }
+        }
+        if (fullest) {
+            AutoLock blockLock(fullest->lock);
+            uint64_t physAddr = fullest->allocate(alignedSize);
+            if (physAddr) {
+                return populatePhysAddr(info, physAddr, alignedSize, fullest);
+            }
+        }
+
+        // Another context took the room in the meantime.
+        for (auto& kv : g_blocks) {
+            MemBlock& block = kv.second;
+            AutoLock blockLock(block.lock);
+            if (block.largestFreeSubblock() < alignedSize) {
+                continue;
+            }
+            uint64_t physAddr = block.allocate(alignedSize);
+            if (physAddr) {
+                return populatePhysAddr(info, physAddr, alignedSize, &block);
+            }
         }
     }
 
+    AutoWriteLock lock(g_blocksLock);
     const uint32_t defaultSize = 64u << 20;
     MemBlock newBlock(m_ops, m_hw, std::max(alignedSize, defaultSize));
     const uint64_t physAddr = newBlock.allocate(alignedSize);
@@ -357,32 +514,37 @@ AddressSpaceSharedSlotsHostMemoryAllocatorContext::allocate(
 uint64_t
 AddressSpaceSharedSlotsHostMemoryAllocatorContext::unallocate(
         const uint64_t physAddr) {
-    AutoLock lock(g_blocksLock);
-
     auto i = m_allocations.find(physAddr);
     if (i == m_allocations.end()) {
         return -1;
     }
 
-    MemBlock* block = i->second.second;
-    block->unallocate(physAddr, i->second.first);
-    m_allocations.erase(physAddr);
-
-    if (block->isAllFree()) {
-        gcEmptyBlocks(1);
+    {
+        AutoReadLock lock(g_blocksLock);
+        MemBlock* block = i->second.second;
+        AutoLock blockLock(block->lock);
+        block->unallocate(physAddr, i->second.first);
     }
+    m_allocations.erase(i);
 
+    maybeRunMaintenance();
     return 0;
 }
 
-void AddressSpaceSharedSlotsHostMemoryAllocatorContext::gcEmptyBlocks(int allowedEmpty) {
+void AddressSpaceSharedSlotsHostMemoryAllocatorContext::gcEmptyBlocks(int allowedEmpty,
+                                                                      uint64_t lingerUs,
+                                                                      uint64_t nowUs) {
     auto i = g_blocks.begin();
     while (i != g_blocks.end()) {
         if (i->second.isAllFree()) {
-            if (allowedEmpty > 0) {
+            if (allowedEmpty > 0 ||
+                nowUs - i->second.emptySinceUs < lingerUs) {
                 --allowedEmpty;
                 ++i;
             } else {
+                if (i->second.physBaseLoaded) {
+                    g_blocksByPhysBaseLoaded.erase(i->second.physBaseLoaded);
+                }
                 i = g_blocks.erase(i);
             }
         } else {
@@ -391,6 +553,69 @@ void AddressSpaceSharedSlotsHostMemoryAllocatorContext::gcEmptyBlocks(int allowe
     }
 }
 
+void AddressSpaceSharedSlotsHostMemoryAllocatorContext::maybeRunMaintenance() {
+    const uint64_t nowUs = base::getHighResTimeUs();
+    uint64_t last = g_lastMaintenanceUs.load(std::memory_order_relaxed);
+    if ((nowUs - last < kMaintenanceIntervalUs &&
+         !g_dropEmptyBlocks.load(std::memory_order_relaxed)) ||
+        !g_lastMaintenanceUs.compare_exchange_strong(last, nowUs)) {
+        return;
+    }
+    runMaintenance(nowUs);
+}
+
+void AddressSpaceSharedSlotsHostMemoryAllocatorContext::runMaintenance(uint64_t nowUs) {
+    {
+        AutoWriteLock lock(g_blocksLock);
+        if (g_dropEmptyBlocks.exchange(false)) {
+            gcEmptyBlocks(0, 0, nowUs);
+        } else {
+            gcEmptyBlocks(1, kEmptyBlockLingerUs, nowUs);
+        }
+    }
+
+    releaseFreeMemoryOfBlocks();
+
+    const BlockStats stats = blockStats();
+    const BlockGauges& gauges = blockGauges();
+    gauges.blocks.set(stats.blocks);
+    gauges.reserved.set(stats.reservedBytes);
+    gauges.used.set(stats.usedBytes);
+    gauges.fragmentation.set(stats.fragmentationPermille);
+}
+
+uint64_t AddressSpaceSharedSlotsHostMemoryAllocatorContext::trim(
+        base::MemoryPressureLevel level) {
+    if (level == base::MemoryPressureLevel::kCritical) {
+        g_dropEmptyBlocks = true;
+    }
+    return releaseFreeMemoryOfBlocks();
+}
+
+ASSSHMAC::BlockStats AddressSpaceSharedSlotsHostMemoryAllocatorContext::blockStats() {
+    BlockStats stats;
+    uint64_t strandedBytes = 0;
+
+    AutoReadLock lock(g_blocksLock);
+    for (auto& kv : g_blocks) {
+        MemBlock& block = kv.second;
+        AutoLock blockLock(block.lock);
+        ++stats.blocks;
+        if (!block.usedBytes) {
+            ++stats.emptyBlocks;
+        }
+        stats.reservedBytes += block.bitsSize;
+        stats.usedBytes += block.usedBytes;
+        const uint64_t freeBytes = block.bitsSize - block.usedBytes;
+        stats.freeBytes += freeBytes;
+        strandedBytes += freeBytes - block.largestFreeSubblock();
+    }
+    if (stats.freeBytes) {
+        stats.fragmentationPermille = strandedBytes * 1000 / stats.freeBytes;
+    }
+    return stats;
+}
+
 uint64_t AddressSpaceSharedSlotsHostMemoryAllocatorContext::populatePhysAddr(
         AddressSpaceDevicePingInfo *info,
         const uint64_t physAddr,
@@ -409,8 +634,6 @@ AddressSpaceDeviceType AddressSpaceSharedSlotsHostMemoryAllocatorContext::getDev
 }
 
 void AddressSpaceSharedSlotsHostMemoryAllocatorContext::save(base::Stream* stream) const {
-    AutoLock lock(g_blocksLock);
-
     stream->putBe32(m_allocations.size());
     for (const auto& kv: m_allocations) {
         stream->putBe64(kv.first);
@@ -421,7 +644,7 @@ void AddressSpaceSharedSlotsHostMemoryAllocatorContext::save(base::Stream* strea
 bool AddressSpaceSharedSlotsHostMemoryAllocatorContext::load(base::Stream* stream) {
     clear();
 
-    AutoLock lock(g_blocksLock);
+    AutoReadLock lock(g_blocksLock);
     for (uint32_t sz = stream->getBe32(); sz > 0; --sz) {
         const uint64_t phys = stream->getBe64();
         const uint32_t size = stream->getBe32();
@@ -439,16 +662,17 @@ bool AddressSpaceSharedSlotsHostMemoryAllocatorContext::load(base::Stream* strea
 }
 
 void AddressSpaceSharedSlotsHostMemoryAllocatorContext::clear() {
-    AutoLock lock(g_blocksLock);
+    AutoReadLock lock(g_blocksLock);
     for (const auto& kv: m_allocations) {
         MemBlock* block = kv.second.second;
+        AutoLock blockLock(block->lock);
         block->unallocate(kv.first, kv.second.first);
     }
     m_allocations.clear();
 }
 
 void AddressSpaceSharedSlotsHostMemoryAllocatorContext::globalStateSave(base::Stream* stream) {
-    AutoLock lock(g_blocksLock);
+    AutoWriteLock lock(g_blocksLock);
 
     stream->putBe32(g_blocks.size());
     for (const auto& kv: g_blocks) {
@@ -462,23 +686,26 @@ bool AddressSpaceSharedSlotsHostMemoryAllocatorContext::globalStateLoad(
         base::Stream* stream,
         const address_space_device_control_ops *ops,
         const AddressSpaceHwFuncs* hw) {
-    AutoLock lock(g_blocksLock);
+    AutoWriteLock lock(g_blocksLock);
 
     for (uint32_t sz = stream->getBe32(); sz > 0; --sz) {
         MemBlock block;
         if (!MemBlock::load(stream, ops, hw, &block)) { return false; }
 
         const uint64_t physBase = block.physBase;
-        if (!g_blocks.insert({physBase, std::move(block)}).second) {
+        auto r = g_blocks.insert({physBase, std::move(block)});
+        if (!r.second) {
             crashhandler_die("%s:%d: block->unallocate", __func__, __LINE__);
         }
+        g_blocksByPhysBaseLoaded[r.first->second.physBaseLoaded] = &r.first->second;
     }
 
     return true;
 }
 
 void AddressSpaceSharedSlotsHostMemoryAllocatorContext::globalStateClear() {
-    AutoLock lock(g_blocksLock);
+    AutoWriteLock lock(g_blocksLock);
+    g_blocksByPhysBaseLoaded.clear();
     g_blocks.clear();
 }
 
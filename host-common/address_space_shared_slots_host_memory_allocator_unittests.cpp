@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "host-common/address_space_shared_slots_host_memory_allocator.h"
+#include "aemu/base/system/System.h"
 #include <gtest/gtest.h>
 
 namespace android {
@@ -50,6 +51,19 @@ int freeSharedHostRegionLocked(uint64_t offset) {
     return 0;
 }
 
+// Hands out distinct regions, for tests that make several blocks.
+uint64_t g_nextRegionOffset = 0;
+
+int allocSharedHostRegionLockedDistinct(uint64_t page_aligned_size, uint64_t* offset) {
+    *offset = g_nextRegionOffset;
+    g_nextRegionOffset += page_aligned_size;
+    return 0;
+}
+
+uint32_t getGuestPageSize() {
+    return 4096;
+}
+
 AddressSpaceHwFuncs create_AddressSpaceHwFuncs() {
     AddressSpaceHwFuncs hw = {};
 
@@ -180,5 +194,117 @@ TEST(MemBlock, unallocate) {
     EXPECT_TRUE(block.isAllFree());
 }
 
+TEST(MemBlock, allocateBestFit) {
+    const struct address_space_device_control_ops ops =
+        create_address_space_device_control_ops();
+
+    const AddressSpaceHwFuncs hw = create_AddressSpaceHwFuncs();
+
+    MemBlock block(&ops, &hw, 100);
+    const uint64_t base = block.physBase;
+
+    const uint64_t off0 = block.allocate(30);
+    const uint64_t off30 = block.allocate(10);
+    const uint64_t off40 = block.allocate(20);
+    const uint64_t off60 = block.allocate(10);
+    EXPECT_EQ(off0, base);
+    EXPECT_EQ(off30, base + 30);
+    EXPECT_EQ(off40, base + 40);
+    EXPECT_EQ(off60, base + 60);
+
+    // Free subblocks: [0, 30), [40, 60) and [70, 100).
+    block.unallocate(off0, 30);
+    block.unallocate(off40, 20);
+    EXPECT_EQ(block.largestFreeSubblock(), 30);
+
+    // The 20-byte hole is the tightest fit, even though [0, 30) comes first.
+    EXPECT_EQ(block.allocate(15), base + 40);
+    // Equal sizes go to the lower offset.
+    EXPECT_EQ(block.allocate(30), base);
+    EXPECT_EQ(block.allocate(30), base + 70);
+    EXPECT_EQ(block.largestFreeSubblock(), 5);
+
+    block.unallocate(base + 40, 15);
+    block.unallocate(base, 30);
+    block.unallocate(off30, 10);
+    block.unallocate(off60, 10);
+    block.unallocate(base + 70, 30);
+    EXPECT_TRUE(block.isAllFree());
+    EXPECT_EQ(block.freeSizes.size(), 1);
+}
+
+// Tests that allocations go to the fullest block with room and that empty
+// blocks are only freed once they have lingered.
+TEST(AddressSpaceSharedSlotsHostMemoryAllocatorContext, BlockPolicy) {
+    const struct address_space_device_control_ops ops =
+        create_address_space_device_control_ops();
+    AddressSpaceHwFuncs hw = create_AddressSpaceHwFuncs();
+    hw.allocSharedHostRegionLocked = &allocSharedHostRegionLockedDistinct;
+    hw.getGuestPageSize = &getGuestPageSize;
+    const AddressSpaceHwFuncs* prevHw = address_space_set_hw_funcs(&hw);
+    ASSSHMAC::globalStateClear();
+
+    const uint64_t kMb = 1024 * 1024;
+    auto allocate = [](ASSSHMAC* ctx, uint64_t size) {
+        AddressSpaceDevicePingInfo info = {};
+        info.metadata = static_cast<uint64_t>(
+            ASSSHMAC::HostMemoryAllocatorCommand::Allocate);
+        info.size = size;
+        ctx->perform(&info);
+        EXPECT_EQ(0, info.metadata);
+        return getPhysAddrStartLocked() + info.phys_addr;
+    };
+    auto unallocate = [](ASSSHMAC* ctx, uint64_t phys) {
+        AddressSpaceDevicePingInfo info = {};
+        info.metadata = static_cast<uint64_t>(
+            ASSSHMAC::HostMemoryAllocatorCommand::Unallocate);
+        info.phys_addr = phys;
+        ctx->perform(&info);
+        EXPECT_EQ(0, info.metadata);
+    };
+
+    {
+        ASSSHMAC ctx(&ops, &hw);
+
+        // Two 64 MB blocks, the second fuller than the first.
+        const uint64_t a = allocate(&ctx, 32 * kMb);
+        const uint64_t b = allocate(&ctx, 48 * kMb);
+        EXPECT_EQ(2u, ASSSHMAC::blockStats().blocks);
+        EXPECT_EQ(80 * kMb, ASSSHMAC::blockStats().usedBytes);
+
+        const uint64_t small = allocate(&ctx, 4096);
+        EXPECT_EQ(b + 48 * kMb, small);
+
+        // Fragment the first block.
+        const uint64_t c = allocate(&ctx, 8 * kMb);
+        EXPECT_EQ(b + 48 * kMb + 4096, c);
+        unallocate(&ctx, a);
+        EXPECT_EQ(1u, ASSSHMAC::blockStats().emptyBlocks);
+
+        unallocate(&ctx, small);
+        unallocate(&ctx, b);
+        EXPECT_GT(ASSSHMAC::blockStats().fragmentationPermille, 0u);
+        unallocate(&ctx, c);
+        EXPECT_EQ(0u, ASSSHMAC::blockStats().fragmentationPermille);
+    }
+
+    const uint64_t nowUs = base::getHighResTimeUs();
+    ASSSHMAC::runMaintenance(nowUs);
+    EXPECT_EQ(2u, ASSSHMAC::blockStats().blocks);
+    EXPECT_EQ(2u, ASSSHMAC::blockStats().emptyBlocks);
+
+    ASSSHMAC::runMaintenance(nowUs + ASSSHMAC::kEmptyBlockLingerUs);
+    EXPECT_EQ(1u, ASSSHMAC::blockStats().blocks);
+
+    // Under critical memory pressure the next maintenance keeps none.
+    base::trimMemory(base::MemoryPressureLevel::kCritical);
+    EXPECT_EQ(1u, ASSSHMAC::blockStats().blocks);
+    ASSSHMAC::runMaintenance(nowUs + ASSSHMAC::kEmptyBlockLingerUs);
+    EXPECT_EQ(0u, ASSSHMAC::blockStats().blocks);
+
+    ASSSHMAC::globalStateClear();
+    address_space_set_hw_funcs(prevHw);
+}
+
 }  // namespace emulation
 } // namespace android
@@ -16,6 +16,8 @@
 
 #include "host-common/crash_reporter.h"
 
+#include "host-common/logging.h"
+
 #include <stdio.h>
 #include <inttypes.h>
 
@@ -25,6 +27,7 @@ static void doCrash() {
 }
 
 void default_crash_reporter(const char* format, ...) {
+    gfxstream_flush_logs();
     fprintf(stderr, "%s: FATAL: [%s]\n", __func__, format);
     doCrash();
 }
@@ -18,10 +18,25 @@
 static void* defaultDmaGetHostAddr(uint64_t guest_paddr) { return nullptr; }
 static void defaultDmaUnlock(uint64_t addr) { }
 
+static void defaultDmaGetHostAddrs(const uint64_t* guest_paddrs, size_t count,
+                                   void** host_addrs) {
+    for (size_t i = 0; i < count; ++i) {
+        host_addrs[i] = emugl::g_emugl_dma_get_host_addr(guest_paddrs[i]);
+    }
+}
+
+static void defaultDmaUnlockMany(const uint64_t* addrs, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        emugl::g_emugl_dma_unlock(addrs[i]);
+    }
+}
+
 namespace emugl {
 
 emugl_dma_get_host_addr_t g_emugl_dma_get_host_addr = defaultDmaGetHostAddr;
 emugl_dma_unlock_t g_emugl_dma_unlock = defaultDmaUnlock;
+emugl_dma_get_host_addrs_t g_emugl_dma_get_host_addrs = defaultDmaGetHostAddrs;
+emugl_dma_unlock_many_t g_emugl_dma_unlock_many = defaultDmaUnlockMany;
 
 void set_emugl_dma_get_host_addr(emugl_dma_get_host_addr_t f) {
     g_emugl_dma_get_host_addr = f;
@@ -31,4 +46,12 @@ void set_emugl_dma_unlock(emugl_dma_unlock_t f) {
     g_emugl_dma_unlock = f;
 }
 
+void set_emugl_dma_get_host_addrs(emugl_dma_get_host_addrs_t f) {
+    g_emugl_dma_get_host_addrs = f;
+}
+
+void set_emugl_dma_unlock_many(emugl_dma_unlock_many_t f) {
+    g_emugl_dma_unlock_many = f;
+}
+
 }  // namespace emugl
@@ -18,10 +18,37 @@
 #include "Features.h"
 #include "FeatureControl.h"
 
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+static constexpr int kFeatureCount = [] {
+    int count = 0;
+#define FEATURE_CONTROL_ITEM(item, idx) count = idx >= count ? idx + 1 : count;
+#include "FeatureControlDefHost.h"
+#include "FeatureControlDefGuest.h"
+#undef FEATURE_CONTROL_ITEM
+    return count;
+}();
+static_assert(kFeatureCount <= FEATURE_SNAPSHOT_WORDS * 64,
+              "FEATURE_SNAPSHOT_WORDS is too small for every feature");
+
+// One bit per feature, so queries are a relaxed load and a bit test with
+// no lock or lookup. Writers are serialized by |lock| and bump
+// |generation| to odd before changing bits and to even after, so a
+// snapshot can tell that it saw every bit from the same generation.
+struct FeatureState {
+    std::mutex lock;
+    std::atomic<uint64_t> generation{0};
+    std::atomic<uint64_t> bits[FEATURE_SNAPSHOT_WORDS] = {};
+};
+
+static FeatureState& featureState() {
+    static FeatureState* const sState = new FeatureState();
+    return *sState;
+}
 
 namespace android {
 namespace featurecontrol {
@@ -29,21 +56,36 @@ namespace featurecontrol {
 static std::function<bool(Feature)> sFeatureEnabledCb;
 
 void setFeatureEnabledCallback(std::function<bool(Feature)> cb) {
+    FeatureState& state = featureState();
+    std::lock_guard<std::mutex> lock(state.lock);
     sFeatureEnabledCb = cb;
+    // Snapshots taken from the old source are stale.
+    state.generation.fetch_add(2, std::memory_order_release);
 }
 }  // namespace featurecontrol
 }  // namespace android
 
-struct FeatureState {
-    std::unordered_map<Feature, bool> enabled{
-#define FEATURE_CONTROL_ITEM(item, idx) {  kFeature_##item, false },
-#include "FeatureControlDefHost.h"
-#include "FeatureControlDefGuest.h"
-#undef FEATURE_CONTROL_ITEM
-       };
-};
+static bool isValidFeature(Feature feature) {
+    return feature >= 0 && feature < kFeatureCount;
+}
 
-static FeatureState sFeatureState;
+static void setFeatureBit(Feature feature, bool enable) {
+    if (!isValidFeature(feature)) {
+        return;
+    }
+    FeatureState& state = featureState();
+    std::lock_guard<std::mutex> lock(state.lock);
+    std::atomic<uint64_t>& word = state.bits[feature / 64];
+    const uint64_t mask = uint64_t(1) << (feature % 64);
+    const uint64_t old = word.load(std::memory_order_relaxed);
+    if (((old & mask) != 0) == enable) {
+        return;
+    }
+    state.generation.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    word.store(enable ? old | mask : old & ~mask, std::memory_order_relaxed);
+    state.generation.fetch_add(1, std::memory_order_release);
+}
 
 // Call this function first to initialize the feature control.
 void feature_initialize() { }
@@ -54,25 +96,72 @@ bool feature_is_enabled(Feature feature) {
        return android::featurecontrol::sFeatureEnabledCb(
             static_cast<android::featurecontrol::Feature>(feature));
 
-    return sFeatureState.enabled[feature];
+    if (!isValidFeature(feature)) {
+        return false;
+    }
+    return (featureState().bits[feature / 64].load(std::memory_order_relaxed) >>
+            (feature % 64)) & 1;
 }
 
 void feature_set_enabled_override(Feature feature, bool isEnabled) {
-    sFeatureState.enabled[feature] = isEnabled;
+    setFeatureBit(feature, isEnabled);
 }
 
 void feature_reset_enabled_to_default(Feature feature) {
-    sFeatureState.enabled[feature] = false;
+    setFeatureBit(feature, false);
 }
 
 // Set the feature if it is not user-overriden.
 void feature_set_if_not_overridden(Feature feature, bool enable) {
-    sFeatureState.enabled[feature] = enable;
+    setFeatureBit(feature, enable);
 }
 
 // Set the feature if it is not user-overriden or disabled from the guest.
 void feature_set_if_not_overridden_or_guest_disabled(Feature feature, bool enable) {
-    sFeatureState.enabled[feature] = enable;
+    setFeatureBit(feature, enable);
+}
+
+uint64_t feature_generation() {
+    return featureState().generation.load(std::memory_order_acquire) & ~uint64_t(1);
+}
+
+void feature_get_snapshot(FeatureSnapshot* snapshot) {
+    if (android::featurecontrol::sFeatureEnabledCb) {
+        // The callback has no generation of its own; ask it about each one.
+        snapshot->generation = feature_generation();
+        for (int i = 0; i < FEATURE_SNAPSHOT_WORDS; ++i) {
+            snapshot->bits[i] = 0;
+        }
+        for (int i = 0; i < kFeatureCount; ++i) {
+            if (feature_is_enabled(static_cast<Feature>(i))) {
+                snapshot->bits[i / 64] |= uint64_t(1) << (i % 64);
+            }
+        }
+        return;
+    }
+
+    FeatureState& state = featureState();
+    for (;;) {
+        const uint64_t before = state.generation.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        for (int i = 0; i < FEATURE_SNAPSHOT_WORDS; ++i) {
+            snapshot->bits[i] = state.bits[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (state.generation.load(std::memory_order_relaxed) == before) {
+            snapshot->generation = before;
+            return;
+        }
+    }
+}
+
+bool feature_snapshot_is_enabled(const FeatureSnapshot* snapshot, Feature feature) {
+    if (!isValidFeature(feature)) {
+        return false;
+    }
+    return (snapshot->bits[feature / 64] >> (feature % 64)) & 1;
 }
 
 // Runs applyCachedServerFeaturePatterns then
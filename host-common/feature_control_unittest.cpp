@@ -0,0 +1,86 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host-common/feature_control.h"
+#include "host-common/FeatureControl.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+class FeatureControlTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        android::featurecontrol::setFeatureEnabledCallback(nullptr);
+        feature_reset_enabled_to_default(kFeature_GLPipeChecksum);
+        feature_reset_enabled_to_default(kFeature_VirtioDualModeMouse);
+    }
+};
+
+// Tests that only real changes move the generation.
+TEST_F(FeatureControlTest, SetAndReset) {
+    const uint64_t start = feature_generation();
+    EXPECT_FALSE(feature_is_enabled(kFeature_VirtioDualModeMouse));
+    feature_set_enabled_override(kFeature_VirtioDualModeMouse, true);
+    EXPECT_TRUE(feature_is_enabled(kFeature_VirtioDualModeMouse));
+    EXPECT_FALSE(feature_is_enabled(kFeature_GLPipeChecksum));
+    const uint64_t enabled = feature_generation();
+    EXPECT_GT(enabled, start);
+
+    feature_set_if_not_overridden(kFeature_VirtioDualModeMouse, true);
+    EXPECT_EQ(enabled, feature_generation());
+
+    feature_reset_enabled_to_default(kFeature_VirtioDualModeMouse);
+    EXPECT_FALSE(feature_is_enabled(kFeature_VirtioDualModeMouse));
+    EXPECT_GT(feature_generation(), enabled);
+
+    EXPECT_FALSE(feature_is_enabled(kFeature_unknown));
+    feature_set_enabled_override(kFeature_unknown, true);
+    EXPECT_FALSE(feature_is_enabled(kFeature_unknown));
+}
+
+TEST_F(FeatureControlTest, Snapshot) {
+    feature_set_enabled_override(kFeature_GLPipeChecksum, true);
+    feature_set_enabled_override(kFeature_VirtioDualModeMouse, true);
+
+    FeatureSnapshot snapshot;
+    feature_get_snapshot(&snapshot);
+    EXPECT_EQ(feature_generation(), snapshot.generation);
+    EXPECT_TRUE(feature_snapshot_is_enabled(&snapshot, kFeature_GLPipeChecksum));
+    EXPECT_TRUE(feature_snapshot_is_enabled(&snapshot, kFeature_VirtioDualModeMouse));
+    EXPECT_FALSE(feature_snapshot_is_enabled(&snapshot, kFeature_ForceANGLE));
+
+    // Later changes leave the snapshot alone, but make it stale.
+    feature_reset_enabled_to_default(kFeature_GLPipeChecksum);
+    EXPECT_TRUE(feature_snapshot_is_enabled(&snapshot, kFeature_GLPipeChecksum));
+    EXPECT_NE(feature_generation(), snapshot.generation);
+}
+
+TEST_F(FeatureControlTest, Callback) {
+    const uint64_t start = feature_generation();
+    android::featurecontrol::setFeatureEnabledCallback(
+            [](android::featurecontrol::Feature feature) {
+                return feature == android::featurecontrol::ForceANGLE;
+            });
+    EXPECT_GT(feature_generation(), start);
+    EXPECT_TRUE(feature_is_enabled(kFeature_ForceANGLE));
+    EXPECT_FALSE(feature_is_enabled(kFeature_GLPipeChecksum));
+
+    FeatureSnapshot snapshot;
+    feature_get_snapshot(&snapshot);
+    EXPECT_TRUE(feature_snapshot_is_enabled(&snapshot, kFeature_ForceANGLE));
+    EXPECT_FALSE(feature_snapshot_is_enabled(&snapshot, kFeature_GLPipeChecksum));
+}
+
+}  // namespace
@@ -15,59 +15,71 @@
 #include "host-common/goldfish_sync.h"
 #include "host-common/GoldfishSyncCommandQueue.h"
 
-#include "aemu/base/containers/Lookup.h"
-#include "aemu/base/synchronization/ConditionVariable.h"
-#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/synchronization/AddressWait.h"
 
-#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <vector>
 
-using android::base::AutoLock;
-using android::base::ConditionVariable;
-using android::base::Lock;
-using android::base::StaticLock;
+using android::base::waitOnAddress;
+using android::base::wakeAddress;
 using android::GoldfishSyncCommandQueue;
 
 // Commands can be tagged with with unique id's,
 // so that for the commands that require a reply
 // from the guest, we signal them properly.
-static uint64_t sUniqueId = 0;
-// When we track command completion, we need to be
-// careful about concurrent access.
-// |sCommandReplyLock| protects
-// |sUniqueId| and |wait_map|, including
-// the |CommandWaitInfo| structures within.
-static StaticLock sCommandReplyLock = {};
+static std::atomic<uint64_t> sUniqueId{0};
 
 uint64_t next_unique_id() {
-    AutoLock lock(sCommandReplyLock);
-    uint64_t res = sUniqueId;
-    sUniqueId += 1;
-    return res;
+    return sUniqueId.fetch_add(1, std::memory_order_relaxed);
 }
 
-struct CommandWaitInfo {
-    Lock lock; // protects other parts of this struct
-    bool done = false;
-    ConditionVariable cvDone;
-    uint64_t return_value;
+// Commands in flight that require a reply from the guest wait in one of a
+// fixed number of slots. A command's hostcmd_handle is a fresh unique id,
+// never 0 so that 0 keeps meaning "no reply needed", and its slot is the id
+// modulo the pool size, so neither sending nor replying takes a lock or
+// allocates.
+static constexpr uint32_t kCommandWaitSlots = 64;
+
+// Set in |CommandWaitSlot::id| by the one reply that gets to fill the slot.
+static constexpr uint64_t kCommandReplied = 1ull << 63;
+
+struct CommandWaitSlot {
+    // The hostcmd_handle waiting here, possibly with kCommandReplied, or 0
+    // while the slot is free.
+    std::atomic<uint64_t> id{0};
+    uint64_t return_value = 0;
+    // Becomes 1 once |return_value| is set; the waiter sleeps on it.
+    std::atomic<uint32_t> done{0};
 };
 
-// |wait_map| keeps track of all the commands in flight
-// that require a reply from the guest.
-static std::unordered_map<uint64_t, std::unique_ptr<CommandWaitInfo> >
-    wait_map;
-
-static CommandWaitInfo* allocWait(uint64_t id) {
-    AutoLock lock(sCommandReplyLock);
-    std::unique_ptr<CommandWaitInfo>& res =
-        wait_map[id];
-    res.reset(new CommandWaitInfo);
-    return res.get();
+static CommandWaitSlot sCommandWaits[kCommandWaitSlots];
+
+// Claims a slot and sets |*id| to the hostcmd_handle to send.
+static CommandWaitSlot* allocWait(uint64_t* id) {
+    for (uint32_t attempt = 1;; ++attempt) {
+        *id = sUniqueId.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (*id & kCommandReplied) {
+            continue;
+        }
+        CommandWaitSlot* slot = &sCommandWaits[*id % kCommandWaitSlots];
+        uint64_t free = 0;
+        if (slot->id.compare_exchange_strong(free, *id,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+            return slot;
+        }
+        // The slot is taken by another command; try the next id. Only when
+        // every slot is busy is there anything worth yielding to.
+        if (attempt % kCommandWaitSlots == 0) {
+            std::this_thread::yield();
+        }
+    }
 }
 
-static void freeWait(uint64_t id) {
-    AutoLock lock(sCommandReplyLock);
-    wait_map.erase(id);
+static void freeWait(CommandWaitSlot* slot) {
+    slot->done.store(0, std::memory_order_relaxed);
+    slot->id.store(0, std::memory_order_release);
 }
 
 static GoldfishSyncDeviceInterface* sGoldfishSyncHwFuncs = NULL;
@@ -107,19 +119,28 @@ static void sendCommand(uint32_t cmd,
 // upon receiving a reply from the guest for the host->guest
 // commands that require replies.
 //
-// The implementation is that such commands will use a condition
-// variable that waits on the result.
+// The implementation is that such commands sleep on their wait slot
+// until the result is stored there.
 void goldfish_sync_receive_hostcmd_result(uint32_t cmd,
                                           uint64_t handle,
                                           uint32_t time_arg,
                                           uint64_t hostcmd_handle) {
-    if (auto elt = android::base::find(wait_map, hostcmd_handle)) {
-        CommandWaitInfo* wait_info = elt->get();
-        AutoLock lock(wait_info->lock);
-        wait_info->return_value = handle;
-        wait_info->done = true;
-        wait_info->cvDone.broadcast();
+    if (!hostcmd_handle || (hostcmd_handle & kCommandReplied)) {
+        return;
+    }
+    CommandWaitSlot* slot = &sCommandWaits[hostcmd_handle % kCommandWaitSlots];
+    // Stale and duplicate replies fail here, so the slot is never written
+    // after its waiter has moved on.
+    uint64_t expected = hostcmd_handle;
+    if (!slot->id.compare_exchange_strong(expected,
+                                          hostcmd_handle | kCommandReplied,
+                                          std::memory_order_acquire,
+                                          std::memory_order_relaxed)) {
+        return;
     }
+    slot->return_value = handle;
+    slot->done.store(1, std::memory_order_release);
+    wakeAddress(&slot->done, true);
 }
 
 // |sendCommandAndGetResult| uses |sendCommand| and
@@ -127,27 +148,21 @@ void goldfish_sync_receive_hostcmd_result(uint32_t cmd,
 // commands that require replies from the guest.
 static uint64_t sendCommandAndGetResult(uint64_t cmd,
                                         uint64_t handle,
-                                        uint64_t time_arg,
-                                        uint64_t hostcmd_handle) {
+                                        uint64_t time_arg) {
+    // Set up the wait before the command can possibly be answered.
+    uint64_t id;
+    CommandWaitSlot* slot = allocWait(&id);
 
     // queue a signal to the device
     GoldfishSyncCommandQueue::hostSignal
-        (cmd, handle, time_arg, hostcmd_handle);
+        (cmd, handle, time_arg, id);
 
-    CommandWaitInfo* waitInfo = allocWait(hostcmd_handle);
-
-    uint64_t res;
-
-    {
-        AutoLock lock(waitInfo->lock);
-        while (!waitInfo->done) {
-            waitInfo->cvDone.wait(&waitInfo->lock);
-        }
-
-        res = waitInfo->return_value;
+    while (!slot->done.load(std::memory_order_acquire)) {
+        waitOnAddress(&slot->done, 0);
     }
+    uint64_t res = slot->return_value;
 
-    freeWait(hostcmd_handle);
+    freeWait(slot);
 
     return res;
 }
@@ -155,19 +170,30 @@ static uint64_t sendCommandAndGetResult(uint64_t cmd,
 // Goldfish sync host-side interface implementation/////////////////////////////
 
 uint64_t goldfish_sync_create_timeline() {
-    return sendCommandAndGetResult(CMD_CREATE_SYNC_TIMELINE,
-                                   0, 0, next_unique_id());
+    return sendCommandAndGetResult(CMD_CREATE_SYNC_TIMELINE, 0, 0);
 }
 
 int goldfish_sync_create_fence(uint64_t timeline, uint32_t pt) {
     return (int)sendCommandAndGetResult(CMD_CREATE_SYNC_FENCE,
-                                        timeline, pt, next_unique_id());
+                                        timeline, pt);
 }
 
 void goldfish_sync_timeline_inc(uint64_t timeline, uint32_t howmuch) {
     sendCommand(CMD_SYNC_TIMELINE_INC, timeline, howmuch);
 }
 
+void goldfish_sync_timeline_inc_batch(const GoldfishSyncTimelineInc* incs,
+                                      uint32_t count) {
+    std::vector<GoldfishSyncHostCommand> cmds(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        cmds[i].handle = incs[i].timeline;
+        cmds[i].hostcmd_handle = 0;
+        cmds[i].cmd = CMD_SYNC_TIMELINE_INC;
+        cmds[i].time_arg = incs[i].howmuch;
+    }
+    GoldfishSyncCommandQueue::hostSignalBatch(cmds.data(), cmds.size());
+}
+
 void goldfish_sync_destroy_timeline(uint64_t timeline) {
     sendCommand(CMD_DESTROY_SYNC_TIMELINE, timeline, 0);
 }
@@ -189,5 +215,7 @@ void goldfish_sync_set_hw_funcs(GoldfishSyncDeviceInterface* hw_funcs) {
     sGoldfishSyncHwFuncs = hw_funcs;
     GoldfishSyncCommandQueue::setQueueCommand
         (sGoldfishSyncHwFuncs->doHostCommand);
+    GoldfishSyncCommandQueue::setQueueCommands
+        (sGoldfishSyncHwFuncs->doHostCommands);
 }
 
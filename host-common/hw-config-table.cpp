@@ -0,0 +1,582 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/hw-config-table.h"
+
+#include "aemu/base/Hash.h"
+#include "aemu/base/StringParse.h"
+#include "aemu/base/misc/FileUtils.h"
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+#include "aemu/base/system/Win32UnicodeString.h"
+#endif
+
+namespace {
+
+constexpr HwConfigKey kKeys[] = {
+#define HWCFG_BOOL(n, s, d, a, t) {s, HWCFG_TYPE_BOOL, offsetof(AndroidHwConfig, n)},
+#define HWCFG_INT(n, s, d, a, t) {s, HWCFG_TYPE_INT, offsetof(AndroidHwConfig, n)},
+#define HWCFG_STRING(n, s, d, a, t) {s, HWCFG_TYPE_STRING, offsetof(AndroidHwConfig, n)},
+#define HWCFG_DOUBLE(n, s, d, a, t) {s, HWCFG_TYPE_DOUBLE, offsetof(AndroidHwConfig, n)},
+#define HWCFG_DISKSIZE(n, s, d, a, t) {s, HWCFG_TYPE_DISKSIZE, offsetof(AndroidHwConfig, n)},
+#include "host-common/hw-config-defs.h"
+};
+
+// The same names as string_views, which constexpr code can read.
+constexpr std::string_view kKeyNames[] = {
+#define HWCFG_BOOL(n, s, d, a, t) s,
+#define HWCFG_INT(n, s, d, a, t) s,
+#define HWCFG_STRING(n, s, d, a, t) s,
+#define HWCFG_DOUBLE(n, s, d, a, t) s,
+#define HWCFG_DISKSIZE(n, s, d, a, t) s,
+#include "host-common/hw-config-defs.h"
+};
+
+constexpr size_t kKeyCount = std::size(kKeys);
+
+// Hash and displace: a key's bucket picks a displacement, and the key's
+// hash mixed with that displacement picks its slot. The displacements are
+// searched at compile time so that no two keys share a slot.
+constexpr size_t kSlotCount = 256;
+constexpr size_t kBucketCount = 128;
+static_assert(kKeyCount <= kSlotCount, "grow kSlotCount");
+static_assert(kKeyCount < UINT16_MAX, "slots hold 16-bit key indices");
+
+constexpr uint64_t hashName(std::string_view name) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+constexpr uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+constexpr size_t bucketFor(uint64_t hash) {
+    return (mix(hash) >> 32) & (kBucketCount - 1);
+}
+
+constexpr size_t slotFor(uint64_t hash, uint16_t displacement) {
+    return mix(hash + displacement * 0x9e3779b97f4a7c15ull) & (kSlotCount - 1);
+}
+
+struct PerfectHash {
+    uint16_t displacements[kBucketCount];
+    // Key index plus one, or 0 for an empty slot.
+    uint16_t slots[kSlotCount];
+};
+
+// Not constexpr: reaching it stops compilation, e.g. on a duplicate key.
+inline void displacementSearchFailed() {}
+
+constexpr bool tryDisplacement(PerfectHash& table,
+                               const uint64_t* hashes,
+                               size_t bucket,
+                               uint16_t displacement) {
+    size_t taken[kKeyCount] = {};
+    size_t takenCount = 0;
+    for (size_t i = 0; i < kKeyCount; ++i) {
+        if (bucketFor(hashes[i]) != bucket) {
+            continue;
+        }
+        const size_t slot = slotFor(hashes[i], displacement);
+        if (table.slots[slot]) {
+            return false;
+        }
+        for (size_t j = 0; j < takenCount; ++j) {
+            if (taken[j] == slot) {
+                return false;
+            }
+        }
+        taken[takenCount++] = slot;
+    }
+    takenCount = 0;
+    for (size_t i = 0; i < kKeyCount; ++i) {
+        if (bucketFor(hashes[i]) == bucket) {
+            table.slots[taken[takenCount++]] = static_cast<uint16_t>(i + 1);
+        }
+    }
+    table.displacements[bucket] = displacement;
+    return true;
+}
+
+constexpr PerfectHash buildPerfectHash() {
+    PerfectHash table = {};
+    uint64_t hashes[kKeyCount] = {};
+    size_t bucketSizes[kBucketCount] = {};
+    size_t largestBucket = 0;
+    for (size_t i = 0; i < kKeyCount; ++i) {
+        hashes[i] = hashName(kKeyNames[i]);
+        const size_t size = ++bucketSizes[bucketFor(hashes[i])];
+        largestBucket = size > largestBucket ? size : largestBucket;
+    }
+    // Place the largest buckets first, while the table is emptiest.
+    for (size_t size = largestBucket; size > 0; --size) {
+        for (size_t bucket = 0; bucket < kBucketCount; ++bucket) {
+            if (bucketSizes[bucket] != size) {
+                continue;
+            }
+            uint16_t displacement = 0;
+            while (!tryDisplacement(table, hashes, bucket, displacement)) {
+                if (++displacement == UINT16_MAX) {
+                    displacementSearchFailed();
+                }
+            }
+        }
+    }
+    return table;
+}
+
+constexpr PerfectHash kPerfectHash = buildPerfectHash();
+
+constexpr size_t findKeyIndex(std::string_view name) {
+    const uint64_t hash = hashName(name);
+    const uint16_t entry = kPerfectHash.slots[slotFor(
+            hash, kPerfectHash.displacements[bucketFor(hash)])];
+    return entry && kKeyNames[entry - 1] == name ? entry - 1 : kKeyCount;
+}
+
+constexpr bool everyKeyFound() {
+    for (size_t i = 0; i < kKeyCount; ++i) {
+        if (findKeyIndex(kKeyNames[i]) != i) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(everyKeyFound(), "broken hw-config perfect hash");
+
+// Identifies the layout of AndroidHwConfig, so that an image written by a
+// build with different hw-config-defs.h is not loaded.
+constexpr uint64_t layoutHash() {
+    uint64_t hash = hashName("AndroidHwConfig") ^ sizeof(AndroidHwConfig);
+    for (const HwConfigKey& key : kKeys) {
+        hash = mix(hash ^ hashName(key.name));
+        hash = mix(hash ^ (static_cast<uint64_t>(key.type) << 32 | key.offset));
+    }
+    return hash;
+}
+
+constexpr uint32_t kCacheMagic = 0x43434848;  // "HHCC"
+constexpr uint32_t kCacheVersion = 1;
+constexpr uint32_t kNullString = UINT32_MAX;
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t layoutHash;
+    uint64_t iniSize;
+    int64_t iniMtime;
+    uint64_t iniHash;
+    uint32_t payloadSize;
+    uint32_t payloadCrc;
+};
+
+template <class T>
+T& field(AndroidHwConfig* config, const HwConfigKey& key) {
+    return *reinterpret_cast<T*>(reinterpret_cast<char*>(config) + key.offset);
+}
+
+template <class T>
+const T& field(const AndroidHwConfig* config, const HwConfigKey& key) {
+    return *reinterpret_cast<const T*>(reinterpret_cast<const char*>(config) +
+                                       key.offset);
+}
+
+bool equalsIgnoreCase(std::string_view a, const char* b) {
+    const size_t length = strlen(b);
+    if (a.size() != length) {
+        return false;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        if (tolower(static_cast<unsigned char>(a[i])) != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parseBool(const char* value, hw_bool_t* out) {
+    const std::string_view text(value);
+    if (text == "1" || equalsIgnoreCase(text, "yes") ||
+        equalsIgnoreCase(text, "true")) {
+        *out = 1;
+        return true;
+    }
+    if (text == "0" || equalsIgnoreCase(text, "no") ||
+        equalsIgnoreCase(text, "false")) {
+        *out = 0;
+        return true;
+    }
+    return false;
+}
+
+bool parseInt(const char* value, hw_int_t* out) {
+    const auto result = android::base::parseInt<int32_t>(value);
+    if (!result) {
+        return false;
+    }
+    *out = static_cast<hw_int_t>(*result);
+    return true;
+}
+
+// Locale-independent: "0.5" is a half whatever LC_NUMERIC says.
+bool parseDouble(const char* value, hw_double_t* out) {
+    const auto result = android::base::parseDouble(value);
+    if (!result) {
+        return false;
+    }
+    *out = *result;
+    return true;
+}
+
+// A byte count with an optional k, m or g suffix, as in "512m".
+bool parseDiskSize(const char* value, hw_disksize_t* out) {
+    std::string_view text = value;
+    int64_t result = 0;
+    if (!android::base::consumeInt(&text, &result) || result < 0) {
+        return false;
+    }
+    int shift = 0;
+    if (text == "k" || text == "K") {
+        shift = 10;
+    } else if (text == "m" || text == "M") {
+        shift = 20;
+    } else if (text == "g" || text == "G") {
+        shift = 30;
+    } else if (!text.empty()) {
+        return false;
+    }
+    if (result > (INT64_MAX >> shift)) {
+        return false;
+    }
+    *out = static_cast<hw_disksize_t>(result) << shift;
+    return true;
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && isspace(static_cast<unsigned char>(text.front()))) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && isspace(static_cast<unsigned char>(text.back()))) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+bool statFile(const char* path, uint64_t* size, int64_t* mtime) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return false;
+    }
+    *size = static_cast<uint64_t>(st.st_size);
+    *mtime = static_cast<int64_t>(st.st_mtime);
+    return true;
+}
+
+void appendBytes(std::string* out, const void* data, size_t size) {
+    out->append(static_cast<const char*>(data), size);
+}
+
+std::string encodeConfig(const AndroidHwConfig* config) {
+    std::string payload;
+    for (const HwConfigKey& key : kKeys) {
+        switch (key.type) {
+            case HWCFG_TYPE_BOOL:
+                appendBytes(&payload, &field<hw_bool_t>(config, key),
+                            sizeof(hw_bool_t));
+                break;
+            case HWCFG_TYPE_INT:
+                appendBytes(&payload, &field<hw_int_t>(config, key),
+                            sizeof(hw_int_t));
+                break;
+            case HWCFG_TYPE_DOUBLE:
+                appendBytes(&payload, &field<hw_double_t>(config, key),
+                            sizeof(hw_double_t));
+                break;
+            case HWCFG_TYPE_DISKSIZE:
+                appendBytes(&payload, &field<hw_disksize_t>(config, key),
+                            sizeof(hw_disksize_t));
+                break;
+            case HWCFG_TYPE_STRING: {
+                const char* value = field<hw_string_t>(config, key);
+                const uint32_t length =
+                        value ? static_cast<uint32_t>(strlen(value))
+                              : kNullString;
+                appendBytes(&payload, &length, sizeof(length));
+                if (value) {
+                    appendBytes(&payload, value, length);
+                }
+                break;
+            }
+        }
+    }
+    return payload;
+}
+
+void freeStrings(AndroidHwConfig* config) {
+    for (const HwConfigKey& key : kKeys) {
+        if (key.type == HWCFG_TYPE_STRING) {
+            free(field<hw_string_t>(config, key));
+            field<hw_string_t>(config, key) = nullptr;
+        }
+    }
+}
+
+// Decodes |payload| into the zeroed |config|. On failure the strings
+// decoded so far are left for the caller to free.
+bool decodeConfig(std::string_view payload, AndroidHwConfig* config) {
+    auto take = [&payload](void* out, size_t size) {
+        if (payload.size() < size) {
+            return false;
+        }
+        memcpy(out, payload.data(), size);
+        payload.remove_prefix(size);
+        return true;
+    };
+    for (const HwConfigKey& key : kKeys) {
+        bool ok = false;
+        switch (key.type) {
+            case HWCFG_TYPE_BOOL:
+                ok = take(&field<hw_bool_t>(config, key), sizeof(hw_bool_t));
+                break;
+            case HWCFG_TYPE_INT:
+                ok = take(&field<hw_int_t>(config, key), sizeof(hw_int_t));
+                break;
+            case HWCFG_TYPE_DOUBLE:
+                ok = take(&field<hw_double_t>(config, key),
+                          sizeof(hw_double_t));
+                break;
+            case HWCFG_TYPE_DISKSIZE:
+                ok = take(&field<hw_disksize_t>(config, key),
+                          sizeof(hw_disksize_t));
+                break;
+            case HWCFG_TYPE_STRING: {
+                uint32_t length = 0;
+                if (!take(&length, sizeof(length))) {
+                    break;
+                }
+                if (length == kNullString) {
+                    ok = true;
+                    break;
+                }
+                if (payload.size() < length) {
+                    break;
+                }
+                char* value = static_cast<char*>(malloc(length + 1));
+                memcpy(value, payload.data(), length);
+                value[length] = '\0';
+                payload.remove_prefix(length);
+                field<hw_string_t>(config, key) = value;
+                ok = true;
+                break;
+            }
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return payload.empty();
+}
+
+bool replaceFile(const std::string& tmpPath, const char* path) {
+#ifdef _WIN32
+    return ::MoveFileExW(android::base::Win32UnicodeString(tmpPath).c_str(),
+                         android::base::Win32UnicodeString(path).c_str(),
+                         MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return ::rename(tmpPath.c_str(), path) == 0;
+#endif
+}
+
+}  // namespace
+
+size_t androidHwConfig_keyCount(void) {
+    return kKeyCount;
+}
+
+const HwConfigKey* androidHwConfig_keyAt(size_t index) {
+    return index < kKeyCount ? &kKeys[index] : nullptr;
+}
+
+const HwConfigKey* androidHwConfig_findKey(const char* name, size_t length) {
+    const size_t index = findKeyIndex(std::string_view(name, length));
+    return index < kKeyCount ? &kKeys[index] : nullptr;
+}
+
+int androidHwConfig_setValue(AndroidHwConfig* config,
+                             const HwConfigKey* key,
+                             const char* value) {
+    bool ok = false;
+    switch (key->type) {
+        case HWCFG_TYPE_BOOL:
+            ok = parseBool(value, &field<hw_bool_t>(config, *key));
+            break;
+        case HWCFG_TYPE_INT:
+            ok = parseInt(value, &field<hw_int_t>(config, *key));
+            break;
+        case HWCFG_TYPE_DOUBLE:
+            ok = parseDouble(value, &field<hw_double_t>(config, *key));
+            break;
+        case HWCFG_TYPE_DISKSIZE:
+            ok = parseDiskSize(value, &field<hw_disksize_t>(config, *key));
+            break;
+        case HWCFG_TYPE_STRING: {
+            hw_string_t& str = field<hw_string_t>(config, *key);
+            free(str);
+            str = strdup(value);
+            ok = true;
+            break;
+        }
+    }
+    return ok ? 0 : -1;
+}
+
+int androidHwConfig_parseIni(AndroidHwConfig* config,
+                             const char* text,
+                             size_t length) {
+    int count = 0;
+    std::string_view rest(text, length);
+    std::string value;
+    while (!rest.empty()) {
+        const size_t eol = rest.find('\n');
+        std::string_view line = trim(rest.substr(0, eol));
+        rest.remove_prefix(eol == std::string_view::npos ? rest.size()
+                                                         : eol + 1);
+        if (line.empty() || line[0] == '#' || line[0] == ';') {
+            continue;
+        }
+        const size_t equals = line.find('=');
+        if (equals == std::string_view::npos) {
+            continue;
+        }
+        const std::string_view name = trim(line.substr(0, equals));
+        const HwConfigKey* key =
+                androidHwConfig_findKey(name.data(), name.size());
+        if (!key) {
+            continue;
+        }
+        value.assign(trim(line.substr(equals + 1)));
+        if (androidHwConfig_setValue(config, key, value.c_str()) == 0) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+int androidHwConfig_saveCache(const AndroidHwConfig* config,
+                              const char* iniPath,
+                              const char* cachePath) {
+    CacheHeader header = {};
+    const auto ini = android::readFileIntoString(iniPath);
+    if (!ini || !statFile(iniPath, &header.iniSize, &header.iniMtime) ||
+        header.iniSize != ini->size()) {
+        return -1;
+    }
+    const std::string payload = encodeConfig(config);
+    header.magic = kCacheMagic;
+    header.version = kCacheVersion;
+    header.layoutHash = layoutHash();
+    header.iniHash = android::base::xxh3Hash64(ini->data(), ini->size());
+    header.payloadSize = static_cast<uint32_t>(payload.size());
+    header.payloadCrc =
+            android::base::crc32c(payload.data(), payload.size());
+
+    // Write a new file and rename it over the old one, so that a reader
+    // never sees half an image.
+    const std::string tmpPath = std::string(cachePath) + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(payload.data(), payload.size());
+        if (!out.flush()) {
+            out.close();
+            remove(tmpPath.c_str());
+            return -1;
+        }
+    }
+    if (!replaceFile(tmpPath, cachePath)) {
+        remove(tmpPath.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+int androidHwConfig_loadCache(AndroidHwConfig* config,
+                              const char* iniPath,
+                              const char* cachePath) {
+    const auto image = android::readFileIntoString(cachePath);
+    CacheHeader header;
+    if (!image || image->size() < sizeof(header)) {
+        return -1;
+    }
+    memcpy(&header, image->data(), sizeof(header));
+    if (header.magic != kCacheMagic || header.version != kCacheVersion ||
+        header.layoutHash != layoutHash() ||
+        image->size() - sizeof(header) != header.payloadSize) {
+        return -1;
+    }
+
+    // Size and time rule out most edits before reading the file; the hash
+    // catches the rest, such as an edit within the same second.
+    uint64_t iniSize = 0;
+    int64_t iniMtime = 0;
+    if (!statFile(iniPath, &iniSize, &iniMtime) ||
+        iniSize != header.iniSize || iniMtime != header.iniMtime) {
+        return -1;
+    }
+    const auto ini = android::readFileIntoString(iniPath);
+    if (!ini || android::base::xxh3Hash64(ini->data(), ini->size()) !=
+                        header.iniHash) {
+        return -1;
+    }
+
+    const std::string_view payload(image->data() + sizeof(header),
+                                   header.payloadSize);
+    if (android::base::crc32c(payload.data(), payload.size()) !=
+        header.payloadCrc) {
+        return -1;
+    }
+    AndroidHwConfig loaded = {};
+    if (!decodeConfig(payload, &loaded)) {
+        freeStrings(&loaded);
+        return -1;
+    }
+    freeStrings(config);
+    *config = loaded;
+    return 0;
+}
@@ -0,0 +1,141 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "host-common/hw-config-table.h"
+
+#include "aemu/base/testing/TestTempDir.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+void writeFile(const std::string& path, const std::string& contents) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << contents;
+}
+
+void freeStrings(AndroidHwConfig* config) {
+    for (size_t i = 0; i < androidHwConfig_keyCount(); ++i) {
+        const HwConfigKey* key = androidHwConfig_keyAt(i);
+        if (key->type == HWCFG_TYPE_STRING) {
+            auto* str = reinterpret_cast<hw_string_t*>(
+                    reinterpret_cast<char*>(config) + key->offset);
+            free(*str);
+            *str = nullptr;
+        }
+    }
+}
+
+const char kIni[] =
+        "# A comment\n"
+        "hw.cpu.arch = x86_64\n"
+        "hw.cpu.ncore=4\n"
+        "hw.keyboard = yes\n"
+        "hw.ramSize = 2048\n"
+        "disk.dataPartition.size = 2g\n"
+        "hw.cpu.ncore.bogus = 1\n"
+        "hw.lcd.density = not-a-number\n";
+
+}  // namespace
+
+// Tests that every key is found through the perfect hash, and nothing else.
+TEST(HwConfigTable, FindKey) {
+    ASSERT_GT(androidHwConfig_keyCount(), 100u);
+    for (size_t i = 0; i < androidHwConfig_keyCount(); ++i) {
+        const HwConfigKey* key = androidHwConfig_keyAt(i);
+        EXPECT_EQ(key, androidHwConfig_findKey(key->name, strlen(key->name)));
+    }
+    const HwConfigKey* ram = androidHwConfig_findKey("hw.ramSize", 10);
+    ASSERT_NE(nullptr, ram);
+    EXPECT_EQ(HWCFG_TYPE_INT, ram->type);
+    EXPECT_EQ(offsetof(AndroidHwConfig, hw_ramSize), ram->offset);
+
+    EXPECT_EQ(nullptr, androidHwConfig_findKey("hw.ramSiz", 9));
+    EXPECT_EQ(nullptr, androidHwConfig_findKey("hw.ramSize2", 11));
+    EXPECT_EQ(nullptr, androidHwConfig_findKey("", 0));
+    EXPECT_EQ(nullptr, androidHwConfig_keyAt(androidHwConfig_keyCount()));
+}
+
+TEST(HwConfigTable, ParseIni) {
+    AndroidHwConfig config = {};
+    config.hw_lcd_density = 160;
+    EXPECT_EQ(5, androidHwConfig_parseIni(&config, kIni, strlen(kIni)));
+    EXPECT_STREQ("x86_64", config.hw_cpu_arch);
+    EXPECT_EQ(4, config.hw_cpu_ncore);
+    EXPECT_EQ(1, config.hw_keyboard);
+    EXPECT_EQ(2048, config.hw_ramSize);
+    EXPECT_EQ(2LL << 30, config.disk_dataPartition_size);
+    EXPECT_EQ(160, config.hw_lcd_density);
+
+    const HwConfigKey* keyboard = androidHwConfig_findKey("hw.keyboard", 11);
+    EXPECT_EQ(0, androidHwConfig_setValue(&config, keyboard, "FALSE"));
+    EXPECT_EQ(0, config.hw_keyboard);
+    EXPECT_EQ(-1, androidHwConfig_setValue(&config, keyboard, "maybe"));
+    EXPECT_EQ(0, config.hw_keyboard);
+    freeStrings(&config);
+}
+
+TEST(HwConfigTable, Cache) {
+    android::base::TestTempDir dir("hw-config-cache");
+    const std::string iniPath = dir.makeSubPath("config.ini");
+    const std::string cachePath = dir.makeSubPath("config.ini.cache");
+    writeFile(iniPath, kIni);
+
+    AndroidHwConfig config = {};
+    EXPECT_EQ(-1, androidHwConfig_loadCache(&config, iniPath.c_str(),
+                                            cachePath.c_str()));
+    androidHwConfig_parseIni(&config, kIni, strlen(kIni));
+    ASSERT_EQ(0, androidHwConfig_saveCache(&config, iniPath.c_str(),
+                                           cachePath.c_str()));
+
+    AndroidHwConfig loaded = {};
+    ASSERT_EQ(0, androidHwConfig_loadCache(&loaded, iniPath.c_str(),
+                                           cachePath.c_str()));
+    EXPECT_STREQ("x86_64", loaded.hw_cpu_arch);
+    EXPECT_EQ(nullptr, loaded.hw_cpu_model);
+    EXPECT_EQ(4, loaded.hw_cpu_ncore);
+    EXPECT_EQ(2LL << 30, loaded.disk_dataPartition_size);
+    freeStrings(&loaded);
+
+    // An edit of the same size, possibly within the same second, is caught
+    // by the hash.
+    std::string edited = kIni;
+    edited.replace(edited.find("ncore=4"), 7, "ncore=8");
+    writeFile(iniPath, edited);
+    EXPECT_EQ(-1, androidHwConfig_loadCache(&loaded, iniPath.c_str(),
+                                            cachePath.c_str()));
+    EXPECT_EQ(nullptr, loaded.hw_cpu_arch);
+
+    // So is a damaged image.
+    writeFile(iniPath, kIni);
+    ASSERT_EQ(0, androidHwConfig_saveCache(&config, iniPath.c_str(),
+                                           cachePath.c_str()));
+    {
+        std::fstream image(cachePath,
+                           std::ios::binary | std::ios::in | std::ios::out);
+        image.seekp(-1, std::ios::end);
+        image.put('\x7f');
+    }
+    EXPECT_EQ(-1, androidHwConfig_loadCache(&loaded, iniPath.c_str(),
+                                            cachePath.c_str()));
+    freeStrings(&config);
+}
@@ -38,6 +38,8 @@ enum AddressSpaceDeviceType {
     GenericPipe = 4,
     HostMemoryAllocator = 5,
     SharedSlotsHostMemoryAllocator = 6,
+    Refcount = 7,
+    HostStats = 8,
     VirtioGpuGraphics = 10,
 };
 
@@ -50,6 +52,23 @@ struct AddressSpaceDevicePingInfo {
     uint32_t direction;
 };
 
+// Batched pings: the guest fills |capacity| AddressSpaceDevicePingInfo
+// entries, which follow this header in guest memory, advances |head| and
+// makes one ping_batch call. The host performs entries in order from |tail|
+// up to |head|, writing each one's results back in place the way a single
+// ping does, then advances |tail|. Both indices count entries and wrap at
+// 2^32; |capacity| must be a power of two.
+struct AddressSpaceDevicePingRing {
+    uint32_t capacity;
+    uint32_t head;  // written by the guest
+    uint32_t tail;  // written by the host
+    uint32_t reserved;
+
+    AddressSpaceDevicePingInfo* entries() {
+        return reinterpret_cast<AddressSpaceDevicePingInfo*>(this + 1);
+    }
+};
+
 class AddressSpaceDeviceContext {
 public:
     virtual ~AddressSpaceDeviceContext() {}
@@ -62,10 +81,16 @@ public:
     virtual void postSave() const { }
 };
 
+// A context loaded from a snapshot whose restore was deferred to its first
+// use; defined in address_space_device.cpp.
+struct AddressSpaceDeferredRestore;
+
 struct AddressSpaceContextDescription {
     AddressSpaceDevicePingInfo* pingInfo = nullptr;
     uint64_t pingInfoGpa = 0;  // for snapshots
     std::unique_ptr<AddressSpaceDeviceContext> device_context;
+    // Set, and kept, for contexts loaded with a deferred restore.
+    std::shared_ptr<AddressSpaceDeferredRestore> deferredRestore;
 };
 
 } // namespace emulation
@@ -14,8 +14,11 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include "aemu/base/files/Stream.h"
+#include "GuestTrafficStats.h"
+#include "android_pipe_bulk.h"
 #include "android_pipe_common.h"
 #include "VmLock.h"
 
@@ -79,6 +82,32 @@ public:
 
     static void initThreadingForTest(VmLock* lock, base::Looper* looper);
 
+    // Instead of the "pipe:<name>[:<args>]" string, a guest may connect
+    // with a binary message that names the service by id:
+    //
+    //    "PIPB" <le32 Service::idForName(name)> <le32 size> <size bytes of args>
+    //
+    // which the host looks up without parsing or comparing any strings.
+    static constexpr char kBinaryConnectMagic[4] = {'P', 'I', 'P', 'B'};
+    static constexpr size_t kBinaryConnectHeaderSize = 12;
+
+    // The same, asking for bulk mode (see android_pipe_bulk.h) with the
+    // rings at guest physical address |gpa|:
+    //
+    //    "PIPK" <le32 service id> <le32 size> <le64 gpa> <size bytes of args>
+    //
+    // Services that don't allow it, see Service::canUseBulkRing(), get a
+    // plain pipe.
+    static constexpr char kBulkConnectMagic[4] = {'P', 'I', 'P', 'K'};
+    static constexpr size_t kBulkConnectHeaderSize = 20;
+
+    // Set next to the pending wake flags in a pipe's saved state when the
+    // ring address follows them.
+    static constexpr uint32_t kSavedBulkRing = 1u << 31;
+
+    // Writes pipe state captured earlier, see onSaveDeferred().
+    using DeferredSave = std::function<void(android::base::Stream*)>;
+
     // A base class for all AndroidPipe services, which is in charge
     // of creating new instances when a guest client connects to the
     // service.
@@ -113,6 +142,15 @@ public:
             pipe->onSave(stream);
         }
 
+        // Like savePipe(), for snapshots that resume the VM before pipe
+        // state is written out: returns a function that writes the same
+        // bytes later, on another thread, or nothing to have savePipe()
+        // called right away instead. Services that override savePipe()
+        // must override this too.
+        virtual DeferredSave savePipeDeferred(AndroidPipe* pipe) {
+            return pipe->onSaveDeferred();
+        }
+
         // Returns true if loading pipe instances from a stream is
         // supported. If true, the load() method will be called to load
         // every pipe instance state from the stream, if false, the
@@ -121,6 +159,20 @@ public:
         // false.
         virtual bool canLoad() const { return false; }
 
+        // Returns true if preSave(), postSave(), preLoad(), postLoad() and
+        // savePipe() may be called from a worker thread, concurrently with
+        // the same calls for other services. Snapshots then save such
+        // services, and their pipes, into separate buffers in parallel. The
+        // default implementation returns false.
+        virtual bool canSnapshotConcurrently() const { return false; }
+
+        // Returns true if pipes of this service may run in bulk mode, where
+        // onGuestSend() and onGuestRecv() get spans of the shared rings
+        // instead of guest buffers, up to a whole ring at a time. They must
+        // not replace the pipe through |newPipePtr| then. The default
+        // implementation returns false.
+        virtual bool canUseBulkRing() const { return false; }
+
         // Load a pipe instance from input |stream|. Only called if
         // canLoad() returns true. Default implementation returns nullptr
         // to indicate an error loading the instance.
@@ -139,6 +191,16 @@ public:
         // end of a unit-test.
         static void resetAll();
 
+        // The id guests use for |name| in binary connect messages: its
+        // 32-bit FNV-1a hash, so they can compute it at build time.
+        static constexpr uint32_t idForName(const char* name) {
+            uint32_t hash = 2166136261u;
+            for (; *name; ++name) {
+                hash = (hash ^ static_cast<uint8_t>(*name)) * 16777619u;
+            }
+            return hash;
+        }
+
     protected:
         // No default constructor.
         Service() = delete;
@@ -195,6 +257,14 @@ public:
     // false. TODO(digit): Is this always called from the device thread?
     virtual void onSave(android::base::Stream* stream){};
 
+    // Lets snapshots resume the VM before this pipe's state is written out:
+    // returns a function that writes what onSave() would write now. It runs
+    // on another thread while the pipe keeps going, so it may only use what
+    // it captured, e.g. a base::CowBuffer::View of pending data that the
+    // pipe's next write copies instead of changing. The default returns
+    // nothing, and onSave() is called as usual.
+    virtual DeferredSave onSaveDeferred() { return {}; }
+
     // Method used to signal the guest that the events corresponding to the
     // PIPE_WAKE_XXX bits in |flags| occurred. NOTE: This can be called from
     // any thread.
@@ -220,6 +290,39 @@ public:
     // Save an AndroidPipe instance state to a file |stream|.
     void saveToStream(android::base::Stream* stream);
 
+    // The two halves of saveToStream(): the service name, then the pipe's
+    // own state, which saveToStream() wraps in a length-prefixed buffer.
+    // Only saveState() may run off the device thread, and only if
+    // canSnapshotConcurrently() is true.
+    void saveServiceName(android::base::Stream* stream);
+    void saveState(android::base::Stream* stream);
+    bool canSnapshotConcurrently() const;
+
+    // saveState() as a function that may run later on any thread, or
+    // nothing if the service can't defer savePipe().
+    DeferredSave saveStateDeferred();
+
+    // What the device calls for guest reads and writes: onGuestRecv() and
+    // onGuestSend(), or in bulk mode, the doorbells that move data through
+    // the rings.
+    int guestRecv(AndroidPipeBuffer* buffers, int numBuffers);
+    int guestSend(const AndroidPipeBuffer* buffers,
+                  int numBuffers,
+                  void** newPipePtr);
+
+    // Switches to bulk mode with the rings at |gpa|, which must be in
+    // address space device memory. With |reset|, as when connecting, the
+    // rings start out empty and the header is marked accepted; otherwise,
+    // as after loading a snapshot, they are taken as they are. If the guest
+    // unmaps the rings later, the pipe's reads and writes fail with
+    // PIPE_ERROR_IO.
+    bool attachBulkRing(uint64_t gpa, bool reset);
+    bool hasBulkRing() const { return mBulkGpa != 0; }
+
+    // Counts the pipe's traffic under its service name and |args|, which
+    // it was opened with, instead of the service name alone.
+    void setTrafficArgs(const char* args);
+
     // Load an AndroidPipe instance from its saved state from |stream|.
     // |hwPipe| is the hardware-side view of the pipe. On success, return
     // a new instance pointer and sets |*pForceClose| to 0 or 1. A value
@@ -251,12 +354,36 @@ protected:
 
     // Constructor used by derived classes only.
     AndroidPipe(void* hwPipe, Service* service)
-        : mHwPipe(hwPipe), mService(service) {}
+        : mHwPipe(hwPipe),
+          mService(service),
+          mTrafficSource(trafficSourceOf(service, nullptr)) {}
 
     void* const mHwPipe = nullptr;
     Service* mService = nullptr;
     std::string mArgs;
     AndroidPipeFlags mFlags = ANDROID_PIPE_DEFAULT;
+
+private:
+    int bulkRecv(AndroidPipeBuffer* buffers, int numBuffers);
+    int bulkSend(const AndroidPipeBuffer* buffers,
+                 int numBuffers,
+                 void** newPipePtr);
+
+    static emulation::GuestTrafficStats::Source trafficSourceOf(const Service* service,
+                                                                const char* args);
+
+    // Checks that the rings are still where mBulk says, and moves mBulk
+    // along if the mapping changed.
+    bool bulkRingMapped();
+
+    // In bulk mode, where the rings are; 0 otherwise.
+    uint64_t mBulkGpa = 0;
+    uint32_t mBulkRingSize = 0;
+    // The GpaTranslationCache generation mBulk was looked up at. Its header
+    // is null once the rings are gone.
+    uint64_t mBulkGeneration = 0;
+    android_pipe_bulk_rings mBulk = {};
+    emulation::GuestTrafficStats::Source mTrafficSource;
 };
 
 }  // namespace android
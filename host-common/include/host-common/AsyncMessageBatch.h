@@ -0,0 +1,166 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/files/Stream.h"
+#include "aemu/base/logging/Log.h"
+#include "host-common/AndroidAsyncMessagePipe.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace android {
+
+// A message inside a received batch, pointing into the batch's bytes.
+struct AsyncMessageView {
+    const uint8_t* data;
+    size_t size;
+};
+
+// Framing for carrying several AndroidAsyncMessagePipe messages in one
+// packet. Like the pipe's own framing, everything is little-endian:
+//
+//   <uint32 kMagic> <uint16 kVersion> <uint16 count>
+//   count * (<uint32 length> <length bytes of data>)
+//
+// Nothing is batched until the guest asks for it: a guest that supports
+// batches sends hello() as its first message and the host answers with
+// hello(). From then on every packet in both directions is a batch, even
+// one holding a single message, so a batch is never mistaken for an
+// ordinary message.
+class AsyncMessageBatch {
+public:
+    static constexpr uint32_t kMagic = 0x31424d41;  // 'AMB1'
+    static constexpr uint16_t kVersion = 1;
+    static constexpr size_t kHeaderSize = 8;
+    static constexpr size_t kMaxMessages = 0xffff;
+
+    static std::vector<uint8_t> hello();
+    static bool isHello(const uint8_t* data, size_t size);
+
+    // Size of the batch holding messages of |totalBytes| bytes in all.
+    static size_t encodedSize(size_t count, size_t totalBytes) {
+        return kHeaderSize + count * sizeof(uint32_t) + totalBytes;
+    }
+
+    // Appends a batch of up to kMaxMessages messages to |out|. Returns the
+    // number of messages encoded.
+    static size_t encode(const AsyncMessageView* messages,
+                         size_t count,
+                         std::vector<uint8_t>* out);
+    static size_t encode(const std::vector<uint8_t>* messages,
+                         size_t count,
+                         std::vector<uint8_t>* out);
+
+    // Splits a batch into |out|, replacing its contents. The views point
+    // into |data|; reuse |out| across calls to avoid allocating. Returns
+    // false, with |out| empty, if |data| is not a well-formed batch.
+    static bool decode(const uint8_t* data,
+                       size_t size,
+                       std::vector<AsyncMessageView>* out);
+};
+
+// An AndroidAsyncMessagePipe that speaks AsyncMessageBatch framing with
+// guests that ask for it and plain messages with the rest. Derived
+// classes implement onBatchedMessage(), which sees each message once
+// either way, and send with sendBatch() or sendMessage() instead of
+// send(), which would bypass the framing.
+class BatchingAsyncMessagePipe : public AndroidAsyncMessagePipe {
+public:
+    BatchingAsyncMessagePipe(AndroidPipe::Service* service, PipeArgs&& args)
+        : AndroidAsyncMessagePipe(service, std::move(args)) {}
+
+    // Sends |count| messages, in one transfer per kMaxMessages once the
+    // guest has agreed to batching, one by one otherwise. Thread-safe.
+    void sendBatch(const std::vector<uint8_t>* messages, size_t count) {
+        std::lock_guard<std::mutex> lock(mSendMutex);
+        if (!mBatching.load(std::memory_order_relaxed)) {
+            for (size_t i = 0; i < count; ++i) {
+                send(messages[i]);
+            }
+            return;
+        }
+        while (count) {
+            std::vector<uint8_t> packet;
+            const size_t encoded =
+                    AsyncMessageBatch::encode(messages, count, &packet);
+            send(std::move(packet));
+            messages += encoded;
+            count -= encoded;
+        }
+    }
+
+    void sendMessage(std::vector<uint8_t>&& message) {
+        {
+            std::lock_guard<std::mutex> lock(mSendMutex);
+            if (!mBatching.load(std::memory_order_relaxed)) {
+                send(std::move(message));
+                return;
+            }
+        }
+        sendBatch(&message, 1);
+    }
+
+    bool batching() const { return mBatching.load(std::memory_order_acquire); }
+
+    void onSave(base::Stream* stream) override {
+        AndroidAsyncMessagePipe::onSave(stream);
+        stream->putByte(batching());
+    }
+
+    void onLoad(base::Stream* stream) override {
+        AndroidAsyncMessagePipe::onLoad(stream);
+        mBatching.store(stream->getByte() != 0, std::memory_order_release);
+    }
+
+protected:
+    // Called for each message received. |data| is only valid for the call.
+    virtual void onBatchedMessage(const uint8_t* data, size_t size) = 0;
+
+private:
+    void onMessage(const std::vector<uint8_t>& data) final {
+        if (!batching()) {
+            if (AsyncMessageBatch::isHello(data.data(), data.size())) {
+                std::lock_guard<std::mutex> lock(mSendMutex);
+                send(AsyncMessageBatch::hello());
+                mBatching.store(true, std::memory_order_release);
+                return;
+            }
+            onBatchedMessage(data.data(), data.size());
+            return;
+        }
+        if (!AsyncMessageBatch::decode(data.data(), data.size(),
+                                       &mReceived)) {
+            derror("Dropping malformed message batch of %zu bytes",
+                   data.size());
+            return;
+        }
+        for (const AsyncMessageView& message : mReceived) {
+            onBatchedMessage(message.data, message.size);
+        }
+    }
+
+    std::mutex mSendMutex;
+    std::atomic<bool> mBatching{false};
+    // Reused across batches; only touched on the receiving thread.
+    std::vector<AsyncMessageView> mReceived;
+};
+
+}  // namespace android
@@ -0,0 +1,49 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace android {
+
+// Scheduling shared by SnapshotGraph and StartupGraph: named nodes that
+// depend on other nodes by name, run in dependency order with the ones that
+// don't depend on each other in parallel.
+
+// Fills |deps| with, for each node, the indices of the nodes it depends on.
+// Names in |dependsOn| that aren't in |names| count as met. Returns false if
+// the dependencies are circular.
+bool resolveDependencyGraph(const std::vector<std::string>& names,
+                            const std::vector<const std::vector<std::string>*>& dependsOn,
+                            std::vector<std::vector<size_t>>* deps);
+
+// Runs |fn| for each node |i| with |active[i]|, after all its active
+// dependencies in |deps|, on up to |threads| threads, or one per core if 0.
+// Nodes with |concurrent[i]| false run on the calling thread, interleaved
+// with the parallel ones. Fills |durationsUs| with the time each node took,
+// 0 for inactive ones.
+void runDependencyGraph(const std::vector<std::vector<size_t>>& deps,
+                        const std::vector<bool>& active,
+                        const std::vector<bool>& concurrent,
+                        int threads,
+                        const std::function<void(size_t)>& fn,
+                        std::vector<uint64_t>* durationsUs);
+
+}  // namespace android
@@ -18,10 +18,13 @@
 #include "host-common/VmLock.h"
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <vector>
 
+#include <stddef.h>
+
 namespace android {
 // All operations that change the global VM state (e.g.
 // virtual device operations) should happen in a thread
@@ -56,6 +59,12 @@ namespace android {
 //   and run later. Hence the void return type of
 //   queueDeviceOperation; it is run asynchronously, so
 //   you cannot expect a return value.
+//
+// Queueing never blocks: operations go on a lock-free list and only
+// the first one after a drain starts the timer. Each timer event hands
+// the whole drained batch, in queue order, to
+// performDeviceOperations(), which devices can override to handle many
+// operations at once.
 
 enum class ContextRunMode {
     DeferIfNotLocked,
@@ -103,34 +112,82 @@ public:
     }
 
 protected:
+    DeviceContextRunner() = default;
+    // |lockName| names mLock for contention profiling; see LockProfiler.h.
+    explicit DeviceContextRunner(const char* lockName) : mLock(lockName) {}
+
     // Disable delete-through-interface.
     ~DeviceContextRunner() {
         mTimerInterface.uninstallFunc(this);
+        Node* node = mHead.load(std::memory_order_acquire);
+        while (node) {
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
     }
 
     // To be implemented by the class that derives DeviceContextRunner:
     // the method that actually touches the virtual device.
     virtual void performDeviceOperation(const T& op) = 0;
 
+    // Performs |count| queued operations from one timer event, in queue
+    // order. The default calls performDeviceOperation() for each.
+    virtual void performDeviceOperations(const T* ops, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            performDeviceOperation(ops[i]);
+        }
+    }
+
     // queueDeviceOperation: If the VM lock is currently held,
     // we are OK to actually perform device operations.
     // Otherwise, we need to add the request to a pending
     // set of requests, to be finished later when we do have the VM lock.
     void queueDeviceOperation(const T& op) {
-        if (mContextRunMode == ContextRunMode::DeferIfNotLocked &&
-            mVmLock->isLockedBySelf()) {
+        if (willRunImmediately()) {
             // Perform the operation correctly since the current thread
             // already holds the lock that protects the global VM state.
             performDeviceOperation(op);
-        } else {
-            // Queue the operation in the mPendingMap structure, then
-            // restart the timer.
-            AutoLock lock(mLock);
-            mPending.push_back(op);
-            lock.unlock();
+            return;
+        }
+
+        Node* node = new Node{op, mHead.load(std::memory_order_relaxed)};
+        while (!mHead.compare_exchange_weak(node->next, node,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+        }
+
+        // NOTE: See TODO above why this is thread-safe when used with
+        // QEMU1 and QEMU2.
+        if (!mTimerArmed.exchange(true, std::memory_order_acq_rel)) {
+            mTimerInterface.startWithTimeoutFunc(this, 0);
+        }
+    }
+
+    // Queues |count| operations at once, in order, like that many
+    // queueDeviceOperation() calls but with a single list update.
+    void queueDeviceOperations(const T* ops, size_t count) {
+        if (!count) {
+            return;
+        }
+        if (willRunImmediately()) {
+            performDeviceOperations(ops, count);
+            return;
+        }
+
+        // Link the chain newest first, as the list expects.
+        Node* first = new Node{ops[0], nullptr};
+        Node* last = first;
+        for (size_t i = 1; i < count; ++i) {
+            last = new Node{ops[i], last};
+        }
+        first->next = mHead.load(std::memory_order_relaxed);
+        while (!mHead.compare_exchange_weak(first->next, last,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+        }
 
-            // NOTE: See TODO above why this is thread-safe when used with
-            // QEMU1 and QEMU2.
+        if (!mTimerArmed.exchange(true, std::memory_order_acq_rel)) {
             mTimerInterface.startWithTimeoutFunc(this, 0);
         }
     }
@@ -139,6 +196,7 @@ protected:
     template <class Predicate>
     void removeAllPendingOperations(const Predicate& op) {
         AutoLock lock(mLock);
+        stagePendingLocked();
         mPending.erase(std::remove_if(mPending.begin(), mPending.end(), op),
                        mPending.end());
     }
@@ -147,29 +205,72 @@ protected:
     template <class Func>
     void forEachPendingOperation(const Func& op) const {
         AutoLock lock(mLock);
+        stagePendingLocked();
         for (const auto& p : mPending) { op(p); }
     }
 
 protected:
+    // True if queueDeviceOperation() called from this thread would perform
+    // the operation right away.
+    bool willRunImmediately() const {
+        return mContextRunMode == ContextRunMode::DeferIfNotLocked &&
+               mVmLock->isLockedBySelf();
+    }
+
     size_t numPending() const {
         AutoLock lock(mLock);
+        stagePendingLocked();
         return mPending.size();
     }
 
 private:
+    struct Node {
+        T op;
+        Node* next;
+    };
+
+    // Moves everything producers pushed so far to the end of mPending, in
+    // the order it was queued.
+    void stagePendingLocked() const {
+        Node* node = mHead.exchange(nullptr, std::memory_order_acquire);
+        Node* reversed = nullptr;
+        while (node) {
+            Node* next = node->next;
+            node->next = reversed;
+            reversed = node;
+            node = next;
+        }
+        while (reversed) {
+            Node* next = reversed->next;
+            mPending.push_back(std::move(reversed->op));
+            delete reversed;
+            reversed = next;
+        }
+    }
+
     void onTimerEvent() {
-        AutoLock lock(mLock);
-        for (const auto& elt : mPending) {
-            performDeviceOperation(elt);
+        // Disarm first, so anything queued from here on starts a new timer.
+        mTimerArmed.store(false, std::memory_order_release);
+        PendingList batch;
+        {
+            AutoLock lock(mLock);
+            stagePendingLocked();
+            batch.swap(mPending);
+        }
+        if (!batch.empty()) {
+            performDeviceOperations(batch.data(), batch.size());
         }
-        mPending.clear();
     }
 
     VmLock* mVmLock = nullptr;
     ContextRunMode mContextRunMode = ContextRunMode::DeferIfNotLocked;
 
+    // Producers push here without locking; newest first.
+    mutable std::atomic<Node*> mHead{nullptr};
+    std::atomic<bool> mTimerArmed{false};
+    // Staged operations, oldest first.
     mutable Lock mLock;
-    PendingList mPending;
+    mutable PendingList mPending;
     TimerInterface mTimerInterface;
 };
 
@@ -0,0 +1,139 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/synchronization/Lock.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct QAndroidDisplayAgent;
+
+namespace android {
+namespace emulation {
+
+struct DamageRect {
+    int x = 0;
+    int y = 0;
+    int w = 0;
+    int h = 0;
+
+    bool empty() const { return w <= 0 || h <= 0; }
+    int64_t area() const { return empty() ? 0 : int64_t(w) * h; }
+    int right() const { return x + w; }
+    int bottom() const { return y + h; }
+
+    bool contains(const DamageRect& other) const {
+        return x <= other.x && y <= other.y && right() >= other.right() &&
+               bottom() >= other.bottom();
+    }
+    bool operator==(const DamageRect& other) const {
+        return x == other.x && y == other.y && w == other.w && h == other.h;
+    }
+};
+
+// The part of a display that changed during one frame, as a short list of
+// rectangles. Each new rect absorbs the ones it covers and merges with
+// those it overlaps or touches when their bounding box wastes little; past
+// |maxRects|, the pair that wastes the fewest pixels is merged. The result
+// covers everything added, possibly a bit more, and rects may overlap.
+class DamageRegion {
+public:
+    static constexpr size_t kMaxRects = 16;
+
+    explicit DamageRegion(size_t maxRects = kMaxRects);
+
+    void add(const DamageRect& rect);
+    void clear() { mRects.clear(); }
+
+    bool empty() const { return mRects.empty(); }
+    const std::vector<DamageRect>& rects() const { return mRects; }
+    // The pixels covered, counting overlaps twice.
+    int64_t area() const;
+    DamageRect bounds() const;
+
+private:
+    void mergeAt(size_t i, size_t j);
+
+    size_t mMaxRects;
+    std::vector<DamageRect> mRects;
+};
+
+// Accumulates qframebuffer_update()-style damage per display and hands each
+// display's coalesced region to the listeners once per frame, when the
+// display's producer or vsync calls flush(), instead of once per rect. A
+// frame that changed most of a display is reported as the whole display.
+class DisplayDamageTracker {
+public:
+    using Listener =
+            std::function<void(uint32_t displayId, const DamageRegion& region)>;
+
+    // Above this fraction of the display the region becomes the full display.
+    static constexpr int kFullDisplayPercent = 75;
+
+    DisplayDamageTracker() = default;
+    ~DisplayDamageTracker();
+
+    static DisplayDamageTracker& get();
+
+    // Rects are clipped to the size, and a size change damages everything.
+    void setDisplaySize(uint32_t displayId, int width, int height);
+
+    void addDamage(uint32_t displayId, int x, int y, int w, int h);
+    // E.g. after a rotation or when a new client needs a full frame. Until
+    // the size is known that is {0, 0, INT_MAX, INT_MAX}.
+    void invalidate(uint32_t displayId);
+
+    // Reports and clears the damage of every display that has some.
+    void flush();
+    void flush(uint32_t displayId);
+
+    int addListener(Listener listener);
+    void removeListener(int id);
+
+    // Feeds the agent's display updates in as display 0. Only one tracker
+    // can be attached to an agent at a time.
+    void attach(const QAndroidDisplayAgent* agent);
+    void detach();
+
+private:
+    struct Display {
+        int width = 0;
+        int height = 0;
+        DamageRegion region;
+    };
+
+    static void onDisplayUpdate(void* opaque, int x, int y, int w, int h);
+
+    void addDamageLocked(Display* display, DamageRect rect);
+    void takeRegionLocked(uint32_t displayId,
+                          Display* display,
+                          std::vector<std::pair<uint32_t, DamageRegion>>* out);
+    void notify(const std::vector<std::pair<uint32_t, DamageRegion>>& regions);
+
+    base::Lock mLock;
+    std::unordered_map<uint32_t, Display> mDisplays;
+    std::vector<std::pair<int, Listener>> mListeners;
+    int mNextListenerId = 1;
+    const QAndroidDisplayAgent* mAgent = nullptr;
+};
+
+}  // namespace emulation
+}  // namespace android
@@ -15,12 +15,17 @@
 #pragma once
 
 #include "aemu/base/Compiler.h"
+#include "aemu/base/containers/FlatMap.h"
 #include "aemu/base/files/Stream.h"
 #include "aemu/base/Optional.h"
 #include "aemu/base/synchronization/Lock.h"
 
-#include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include <inttypes.h>
+#include <stddef.h>
 
 using android::base::Optional;
 using android::base::kNullopt;
@@ -31,10 +36,28 @@ struct DmaBufferInfo {
     void* hwpipe = nullptr;
     uint64_t guestAddr = 0;
     uint64_t bufferSize = 0;
+    // Guarded by |lock|.
     Optional<void*> currHostAddr = kNullopt;
+
+    // Readers check these without |lock|: |hostAddr| mirrors currHostAddr
+    // and is current while |mappedGeneration| matches the DmaMap's
+    // generation. 0 means unmapped.
+    std::atomic<void*> hostAddr{nullptr};
+    std::atomic<uint64_t> mappedGeneration{0};
+    // Serializes creating and removing this buffer's mapping.
+    android::base::Lock lock;
 };
 
-using DmaBufferMap = std::unordered_map<uint64_t, DmaBufferInfo>;
+// Entries are heap allocated so their address, and atomics, are stable.
+using DmaBufferMap =
+        android::base::FlatHashMap<uint64_t, std::unique_ptr<DmaBufferInfo>>;
+
+// Maps guest DMA buffers into the host lazily.
+//
+// mLock only guards the set of buffers; looking one up takes it shared.
+// Each buffer remembers the generation its host mapping was made in, so
+// invalidateHostMappings() just bumps the generation and stale mappings
+// are redone on their next use, under that buffer's own lock.
 
 class DmaMap {
 public:
@@ -47,9 +70,24 @@ public:
     void addBuffer(void* hwpipe, uint64_t addr, uint64_t bufferSize);
     void removeBuffer(uint64_t addr);
     void* getHostAddr(uint64_t addr);
+    // Makes sure the |count| buffers at |addrs| have current host mappings,
+    // e.g. after a snapshot load or a memory layout change, under a single
+    // lookup of the buffer set. Host addresses go to |hostAddrs| if not
+    // null, with nullptr for unknown buffers. Returns how many were found.
+    size_t prefetchHostAddrs(const uint64_t* addrs,
+                             size_t count,
+                             void** hostAddrs = nullptr);
+    // O(1); mappings are redone lazily.
     void invalidateHostMappings();
     void resetHostMappings();
     void* getPipeInstance(uint64_t addr);
+    // Sets |pipes[i]| to the pipe of the buffer at |addrs[i]|, or nullptr,
+    // under a single lookup of the buffer set.
+    void getPipeInstances(const uint64_t* addrs, size_t count, void** pipes);
+
+    // Changes whenever a host address returned earlier may have become
+    // wrong: on invalidation and whenever buffers come and go.
+    uint64_t version() const { return mVersion.load(std::memory_order_acquire); }
 
     // get() / set are NOT thread-safe,
     // but we don't expect multiple threads to call this
@@ -63,6 +101,7 @@ public:
     void load(android::base::Stream* stream);
 protected:
 
+    // Called with info->lock held.
     virtual void createMappingLocked(DmaBufferInfo* info);
     virtual void removeMappingLocked(DmaBufferInfo* info);
 
@@ -72,8 +111,42 @@ protected:
     virtual void doUnmap(void* mapped, uint64_t bufferSize) = 0;
 
     DmaBufferMap mDmaBuffers;
-    android::base::ReadWriteLock mLock;
+    android::base::ReadWriteLock mLock{"DmaMap.mLock"};
+
+private:
+    // Returns info's host address, mapping it first if it is stale. Called
+    // with mLock held in either mode.
+    void* currentHostAddr(DmaBufferInfo* info);
+
+    void bumpVersion() { mVersion.fetch_add(1, std::memory_order_acq_rel); }
+
+    // Starts at 1 so that an entry's 0 means unmapped.
+    std::atomic<uint64_t> mGeneration{1};
+    std::atomic<uint64_t> mVersion{1};
     DISALLOW_COPY_ASSIGN_AND_MOVE(DmaMap);
 };
 
+// The host addresses of one pipe's DMA buffers, as of a DmaMap::version().
+// While the version holds, lookups take no DmaMap lock; otherwise every
+// buffer asked for is resolved again with one prefetchHostAddrs() call.
+// Not thread-safe: each pipe keeps its own.
+class DmaMappingCache {
+public:
+    explicit DmaMappingCache(DmaMap* dmaMap = DmaMap::get()) : mDmaMap(dmaMap) {}
+
+    // Sets |hostAddrs[i]| for the buffer at |addrs[i]|, nullptr if unknown.
+    void getHostAddrs(const uint64_t* addrs, size_t count, void** hostAddrs);
+    void* getHostAddr(uint64_t addr);
+
+    void clear();
+
+private:
+    DmaMap* mDmaMap;
+    uint64_t mVersion = 0;
+    android::base::FlatHashMap<uint64_t, void*> mHostAddrs;
+    // Scratch space for the addresses missing from |mHostAddrs|.
+    std::vector<uint64_t> mMissAddrs;
+    std::vector<void*> mMissHostAddrs;
+};
+
 } // namespace android
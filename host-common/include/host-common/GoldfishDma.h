@@ -17,6 +17,7 @@
 #include "aemu/base/files/Stream.h"
 
 #include <inttypes.h>
+#include <stddef.h>
 
 static const uint32_t kDmaBufSizeMB = 32;
 // GOLDFISH DMA
@@ -61,6 +62,15 @@ void (*reset_host_mappings)(void);
 // For snapshots.
 void (*save_mappings)(android::base::Stream* stream);
 void (*load_mappings)(android::base::Stream* stream);
+// get_host_addrs():
+// get_host_addr() for |count| buffers at once, looking them up in the
+// DMA map together; |host_addrs[i]| is nullptr for unknown buffers.
+void (*get_host_addrs)(const uint64_t* guest_paddrs, size_t count,
+                       void** host_addrs);
+// unlock_many():
+// unlock() for |count| buffers at once. Each pipe is woken once even if
+// several of the buffers belong to it.
+void (*unlock_many)(const uint64_t* guest_paddrs, size_t count);
 } GoldfishDmaOps;
 
 extern const GoldfishDmaOps android_goldfish_dma_ops;
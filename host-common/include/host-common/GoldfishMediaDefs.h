@@ -34,7 +34,11 @@ enum class MediaOperation : uint8_t {
     Flush = 4,
     Reset = 5,
     SendMetadata = 6,
-    Max = 7,
+    // Guest hands the host the buffer it reads decoded frames from, so they
+    // can be decoded straight into it. The guest must not reuse the buffer
+    // while a frame decoded into it is still waiting for GetImage.
+    SetOutputBuffer = 7,
+    Max = 8,
 };
 
 struct MetadataParam {
@@ -21,20 +21,6 @@
 
 #include <vector>
 
-#define DEBUG 0
-
-#if DEBUG
-#define DPRINT(...) do { \
-    if (!VERBOSE_CHECK(goldfishsync)) VERBOSE_ENABLE(goldfishsync); \
-    VERBOSE_TID_FUNCTION_DPRINT(goldfishsync, __VA_ARGS__); } while(0)
-#else
-#define DPRINT(...)
-#endif
-
-#define ERR(...) do { \
-    derror(__VA_ARGS__); \
-} while(0)
-
 namespace android {
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -54,12 +40,7 @@ namespace android {
 // that actually raises IRQ's, and that |initThreading| has been called
 // in a main loop context, preferably in qemu-setup.cpp.
 
-struct GoldfishSyncWakeInfo {
-    uint64_t handle;
-    uint64_t hostcmd_handle;
-    uint32_t cmd;
-    uint32_t time_arg;
-};
+using GoldfishSyncWakeInfo = GoldfishSyncHostCommand;
 
 class GoldfishSyncCommandQueue final :
     public DeviceContextRunner<GoldfishSyncWakeInfo> {
@@ -73,6 +54,8 @@ public:
     // Goldfish sync virtual device will give out its own
     // callback for queueing commands to it.
     static void setQueueCommand(queue_device_command_t fx);
+    // And optionally one for queueing many at once.
+    static void setQueueCommands(queue_device_commands_t fx);
 
     // Main interface for all Goldfish sync device
     // communications.
@@ -80,6 +63,15 @@ public:
                            uint64_t handle,
                            uint32_t time_arg,
                            uint64_t hostcmd_handle);
+    // Queues |count| commands in order, to reach the device together.
+    static void hostSignalBatch(const GoldfishSyncWakeInfo* cmds,
+                                size_t count);
+
+    // Merges each timeline increment in |cmds| that needs no reply into an
+    // earlier increment of the same timeline, unless another command for
+    // that timeline comes between them. Order is otherwise kept. Returns
+    // the new count.
+    static size_t coalesce(GoldfishSyncWakeInfo* cmds, size_t count);
 
     // Save/load pending operations.
     static void save(android::base::Stream* stream);
@@ -88,8 +80,11 @@ public:
 private:
 
     virtual void performDeviceOperation(const GoldfishSyncWakeInfo& cmd) override;
+    void performDeviceOperations(const GoldfishSyncWakeInfo* cmds,
+                                 size_t count) override;
 
     queue_device_command_t tellSyncDevice = nullptr;
+    queue_device_commands_t tellSyncDeviceBatch = nullptr;
 };
 
 } // namespace android
@@ -0,0 +1,126 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+namespace android {
+namespace emulation {
+
+// A software TLB for guest physical addresses: a small direct-mapped cache
+// from guest page frame to host address, in front of a slower translation
+// such as a locked map lookup or a call into the VMM. Meant to be kept per
+// thread, e.g. in a thread_local, so lookups take no lock.
+//
+// Every cache is invalidated at once by bumping a global generation, which
+// must happen whenever any translation may change: mappings added or
+// removed, or the VMM's memory map changing.
+class GpaTranslationCache {
+public:
+    static constexpr uint64_t kPageSize = 4096;
+    static constexpr size_t kEntries = 64;
+
+    // Makes every cache in the process miss from now on.
+    static void invalidateAll() { sGeneration.fetch_add(1, std::memory_order_acq_rel); }
+    static uint64_t generation() { return sGeneration.load(std::memory_order_acquire); }
+
+    // Returns |translate(gpa)|. A page is cached only when its first and
+    // last bytes translate to the two ends of one contiguous host page, so
+    // a miss costs two translations; pages that aren't, e.g. the edge of a
+    // mapping that isn't page aligned, are translated every time.
+    template <class Translate>
+    void* translate(uint64_t gpa, Translate&& translate) {
+        // Read before translating, so a change racing with a miss leaves
+        // the entry stale rather than current.
+        const uint64_t generation = sGeneration.load(std::memory_order_acquire);
+        const uint64_t frame = gpa / kPageSize;
+        const uint64_t offset = gpa % kPageSize;
+        Entry& entry = mEntries[frame % kEntries];
+        if (entry.generation == generation && entry.frame == frame) {
+            return entry.hostPage + offset;
+        }
+
+        char* const first = static_cast<char*>(translate(frame * kPageSize));
+        char* const last = static_cast<char*>(translate(frame * kPageSize + kPageSize - 1));
+        if (first && last == first + kPageSize - 1) {
+            entry = {frame, first, generation};
+            return first + offset;
+        }
+        return translate(gpa);
+    }
+
+private:
+    struct Entry {
+        uint64_t frame;
+        char* hostPage;
+        // 0 never matches; sGeneration starts at 1.
+        uint64_t generation;
+    };
+
+    Entry mEntries[kEntries] = {};
+
+    static std::atomic<uint64_t> sGeneration;
+};
+
+// Whole mappings rather than pages, for a single user that translates many
+// addresses inside a few large mappings, like the type 2 transfers of one
+// ASG context. Not thread safe. Shares GpaTranslationCache's generation, so
+// invalidateAll() empties it too.
+class GpaRangeCache {
+public:
+    static constexpr size_t kEntries = 4;
+
+    struct Range {
+        uint64_t gpa;
+        uint64_t size;
+        char* host;  // where |gpa| maps to
+    };
+
+    // Returns the host address of |gpa|. On a miss, |lookup(gpa, &range)|
+    // fills in the mapping holding |gpa| and returns false if there is none.
+    template <class Lookup>
+    void* translate(uint64_t gpa, Lookup&& lookup) {
+        const uint64_t generation = GpaTranslationCache::generation();
+        for (Entry& entry : mEntries) {
+            if (entry.generation == generation && gpa - entry.range.gpa < entry.range.size) {
+                return entry.range.host + (gpa - entry.range.gpa);
+            }
+        }
+
+        Range range;
+        if (!lookup(gpa, &range) || gpa - range.gpa >= range.size) {
+            return nullptr;
+        }
+        mEntries[mNext] = {range, generation};
+        mNext = (mNext + 1) % kEntries;
+        return range.host + (gpa - range.gpa);
+    }
+
+private:
+    struct Entry {
+        Range range;
+        uint64_t generation;
+    };
+
+    Entry mEntries[kEntries] = {};
+    size_t mNext = 0;
+};
+
+}  // namespace emulation
+}  // namespace android
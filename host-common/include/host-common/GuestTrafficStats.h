@@ -0,0 +1,125 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "aemu/base/ShardedCounter.h"
+#include "aemu/base/StatsPage.h"
+#include "aemu/base/containers/FlatMap.h"
+#include "aemu/base/synchronization/Lock.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace android {
+namespace emulation {
+
+// Which guest process keeps the host renderer and pipes busy.
+//
+// Traffic is counted per source, a name that every context or pipe of the
+// same guest process shares: "asg:<virtio-gpu context name>" for address
+// space graphics contexts, "pipe:<service>" for pipes. Updates go to
+// per-thread counters, so the device and render threads never contend.
+//
+// The global instance keeps the stats page current: totals under
+// "guest_traffic.*", and each source's bytes under "guest_traffic.<name>"
+// for the first kMaxPageSources sources. While tracing, each source's bytes
+// are also recorded as a trace counter. top() and report() rank sources by
+// their traffic since the last call, like top(1).
+class GuestTrafficStats {
+public:
+    enum Counter : uint32_t {
+        kBytesToHost = 0,
+        kBytesToGuest = 1,
+        kCommands = 2,
+        kWakes = 3,
+        kNumCounters = 4,
+    };
+
+    using Source = uint32_t;
+    // Unnamed traffic, and that of sources past the limit.
+    static constexpr Source kOther = 0;
+    static constexpr size_t kMaxSources = 128;
+    static constexpr size_t kMaxPageSources = 16;
+    // Longer names are truncated.
+    static constexpr size_t kMaxNameSize = 64;
+
+    // |publish| keeps the stats page and traces current.
+    explicit GuestTrafficStats(size_t maxSources = kMaxSources, bool publish = false);
+    ~GuestTrafficStats();
+
+    static GuestTrafficStats& get();
+
+    // The source named |name|, added on first use.
+    Source source(std::string_view name);
+
+    void add(Source source, Counter counter, int64_t delta) {
+        if (source >= mMaxSources) {
+            source = kOther;
+        }
+        if (mCounts.add(source * kNumCounters + counter, delta) && mPublish) {
+            publish();
+        }
+    }
+
+    struct Usage {
+        std::string name;
+        // Since the source was added, and since the previous top().
+        int64_t total[kNumCounters] = {};
+        int64_t recent[kNumCounters] = {};
+
+        int64_t recentBytes() const {
+            return recent[kBytesToHost] + recent[kBytesToGuest];
+        }
+    };
+
+    // The |count| sources with the most bytes since the previous call,
+    // busiest first; idle sources are left out.
+    std::vector<Usage> top(size_t count);
+
+    // top(count) as a table, one source per line.
+    std::string report(size_t count = 10);
+
+private:
+    struct SourceInfo {
+        std::string name;
+        // "guest_traffic.<name>", and where it lives for traceCounter(),
+        // which keeps the pointer.
+        std::string statName;
+        base::Stat bytes;
+        int64_t lastBytes = 0;
+    };
+
+    // Sums the counters, then updates the page and trace counters.
+    std::vector<int64_t> publish();
+
+    const size_t mMaxSources;
+    const bool mPublish;
+    base::ShardedCounter mCounts;
+
+    base::Lock mLock;
+    // All guarded by |mLock|.
+    base::FlatHashMap<std::string, Source> mSourcesByName;
+    std::vector<std::unique_ptr<SourceInfo>> mSources;
+    // Sums as of the previous top().
+    std::vector<int64_t> mTopSums;
+    base::Stat mTotals[kNumCounters];
+};
+
+}  // namespace emulation
+}  // namespace android
@@ -17,8 +17,10 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace android {
 namespace emulation {
@@ -101,6 +103,47 @@ static H264NaluType getFrameNaluType(const uint8_t* frame, size_t szBytes, uint8
 // Finds the position of the next start code header. Returns null if not found, otherwise returns
 // a pointer to the beginning of the next start code header.
 static const uint8_t* getNextStartCodeHeader(const uint8_t* frame, size_t szBytes);
+
+private:
+static const std::string kNaluTypesStrings[];
+};
+
+// The NALUs of one packet, found in a single pass over it, so callers that
+// need to know several things about a packet don't each scan it again.
+// Reparsing into the same list reuses its storage.
+class H264NaluList {
+public:
+    using H264NaluType = H264NaluParser::H264NaluType;
+
+    struct Nalu {
+        H264NaluType type;
+        // The start code header; the NALU is the |size| bytes from here up
+        // to the next start code or the end of the packet.
+        const uint8_t* start;
+        size_t size;
+        // The NALU header byte, right after the start code.
+        const uint8_t* data;
+    };
+
+    // With |stopAtFirstSlice|, parsing ends at the first coded slice, which
+    // is taken to run to the end of the packet. The parameter sets and SEI
+    // that classify a packet come before it, and its slice data, the bulk of
+    // the packet, is left unscanned.
+    void parse(const uint8_t* frame, size_t szBytes,
+               bool stopAtFirstSlice = false);
+
+    const std::vector<Nalu>& nalus() const { return mNalus; }
+    bool empty() const { return mNalus.empty(); }
+    bool contains(H264NaluType type) const {
+        return mTypes & (uint64_t(1) << static_cast<uint8_t>(type));
+    }
+    H264NaluType firstType() const {
+        return mNalus.empty() ? H264NaluType::Undefined : mNalus[0].type;
+    }
+
+private:
+    std::vector<Nalu> mNalus;
+    uint64_t mTypes = 0;  // a bit per H264NaluType seen
 };
 
 }  // namespace emulation
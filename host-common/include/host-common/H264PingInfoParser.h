@@ -80,6 +80,14 @@ public:
         uint8_t* pDecodedFrame;
     };
 
+    struct SetOutputBufferParam {
+        // input
+        uint64_t hostDecoderId;
+        // nullptr when the guest no longer offers a buffer
+        uint8_t* pOutputBuffer;
+        size_t size;
+    };
+
 public:
     // get the decoder id on the host side that
     // is requested to do the work by the guest
@@ -91,6 +99,7 @@ public:
     void parseGetImageParams(void* ptr, GetImageParam& param);
     void parseResetParams(void* ptr, ResetParam& param);
     void parseMetadataParams(void* ptr, MetadataParam& param);
+    void parseSetOutputBufferParams(void* ptr, SetOutputBufferParam& param);
 
 public:
     explicit H264PingInfoParser(void* ptr);
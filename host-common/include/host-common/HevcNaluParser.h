@@ -0,0 +1,103 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Splits H.265 (HEVC) Annex B packets from the guest into their Network
+// Abstraction Layer Units (NALUs).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace android {
+namespace emulation {
+
+// HEVC NALUs start with the same 00 00 01 / 00 00 00 01 start codes as
+// H.264, but the header after them is two bytes:
+//
+// ===========================================================================
+// | forbidden zero bit | nal_unit_type | nuh_layer_id | nuh_temporal_id_plus1 |
+// | 1 bit              | 6 bits        | 6 bits       | 3 bits                |
+// ===========================================================================
+enum class HevcNaluType : uint8_t {
+    TrailN = 0,
+    TrailR = 1,
+    // 2-15: other non-IRAP slices (TSA, STSA, RADL, RASL, reserved)
+    BlaWLp = 16,
+    BlaWRadl = 17,
+    BlaNLp = 18,
+    IdrWRadl = 19,
+    IdrNLp = 20,
+    Cra = 21,
+    // 22-31: reserved IRAP and non-IRAP VCL types
+    VPS = 32,
+    SPS = 33,
+    PPS = 34,
+    AccessUnitDelimiter = 35,
+    EndOfSequence = 36,
+    EndOfBitstream = 37,
+    FillerData = 38,
+    PrefixSEI = 39,
+    SuffixSEI = 40,
+    // 41-63: reserved and unspecified
+};
+
+inline bool hevcIsSlice(HevcNaluType type) {
+    return static_cast<uint8_t>(type) < 32;
+}
+
+// Intra random access points: a decoder can start at these.
+inline bool hevcIsIrap(HevcNaluType type) {
+    return type >= HevcNaluType::BlaWLp &&
+           static_cast<uint8_t>(type) <= 23;
+}
+
+// The NALUs of one packet, found in a single pass over it; the HEVC
+// counterpart of H264NaluList.
+class HevcNaluList {
+public:
+    struct Nalu {
+        HevcNaluType type;
+        // The start code header; the NALU is the |size| bytes from here up
+        // to the next start code or the end of the packet.
+        const uint8_t* start;
+        size_t size;
+        // The first NALU header byte, right after the start code.
+        const uint8_t* data;
+    };
+
+    // With |stopAtFirstSlice|, parsing ends at the first coded slice, which
+    // is taken to run to the end of the packet.
+    void parse(const uint8_t* frame, size_t szBytes,
+               bool stopAtFirstSlice = false);
+
+    const std::vector<Nalu>& nalus() const { return mNalus; }
+    bool empty() const { return mNalus.empty(); }
+    bool contains(HevcNaluType type) const {
+        return mTypes & (uint64_t(1) << static_cast<uint8_t>(type));
+    }
+    bool containsSlice() const { return (mTypes & 0xffffffffu) != 0; }
+    // Whether decoding can start at this packet: it carries parameter sets
+    // or an IRAP picture.
+    bool isKeyFrame() const;
+
+private:
+    std::vector<Nalu> mNalus;
+    uint64_t mTypes = 0;  // a bit per HevcNaluType seen
+};
+
+}  // namespace emulation
+}  // namespace android
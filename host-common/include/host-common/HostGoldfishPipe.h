@@ -16,6 +16,7 @@
 #include "aemu/base/Result.h"
 #include "aemu/base/files/Stream.h"
 #include "host-common/android_pipe_base.h"
+#include "host-common/android_pipe_common.h"
 
 #include <cstdint>
 #include <functional>
@@ -44,6 +45,13 @@ public:
 
     // Opens/closes pipe services.
     int connect(const char* name);
+    // Connects with a binary message naming the service by id, see
+    // AndroidPipe::kBinaryConnectMagic.
+    int connectById(uint32_t serviceId, const char* args = nullptr);
+    // Connects asking for bulk mode with the rings at |ringGpa|, see
+    // AndroidPipe::kBulkConnectMagic. The caller sets up the header first
+    // and checks it to see whether the host agreed.
+    int connectWithBulkRing(uint32_t serviceId, uint64_t ringGpa, const char* args = nullptr);
     void close(int fd);
 
     // Read/write for a particular pipe, along with C++ versions.
@@ -51,6 +59,16 @@ public:
     ssize_t write(int fd, const void* buffer, size_t len);
     ReadResult read(int fd, size_t maxLength);
     WriteResult write(int fd, const std::vector<uint8_t>& data);
+
+    // Scatter/gather versions: |buffers| is passed straight to the pipe's
+    // onGuestRecv()/onGuestSend(), with no intermediate copy.
+    ssize_t readv(int fd, AndroidPipeBuffer* buffers, int numBuffers);
+    ssize_t writev(int fd, const AndroidPipeBuffer* buffers, int numBuffers);
+
+    // Reads up to |maxLength| bytes into |*buffer|, which is resized to the
+    // amount read. Reusing the same vector across calls avoids allocating
+    // once its capacity has grown to |maxLength|.
+    ssize_t read(int fd, std::vector<uint8_t>* buffer, size_t maxLength);
     unsigned poll(int fd) const;
 
     // Sets a callback that will be invoked when the pipe is signaled by the
@@ -77,6 +95,8 @@ public:
 
 private:
     void initialize();
+    int connectWithHandshake(const std::vector<uint8_t>& handshake,
+                             const char* name);
 
     struct InternalPipe {};
 
@@ -112,7 +132,8 @@ private:
                                InternalPipe* hostPipe);
     bool eraseFdInfo(int fd);
 
-    ssize_t writeInternal(InternalPipe** pipe, const void* buffer, size_t len);
+    ssize_t writeInternal(InternalPipe** pipe, const AndroidPipeBuffer* buffers,
+                          int numBuffers);
 
     void setErrno(ssize_t res);
 
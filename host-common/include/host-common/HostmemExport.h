@@ -0,0 +1,78 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include "aemu/base/ManagedDescriptor.hpp"
+#include "host-common/HostmemIdMapping.h"
+
+#include <optional>
+#include <type_traits>
+
+#include <stdint.h>
+
+// Hands the memory behind a hostmem id to a helper process on the same host,
+// such as a recorder or a streaming encoder, as a descriptor it can map,
+// instead of copying frames to it through a socket.
+//
+// Anything registered with HostmemIdMapping::addDescriptorInfo() can be
+// exported: blobs, and color buffers the renderer registers that way. The
+// emulator calls hostmemSendDescriptor() on a connected Unix domain socket;
+// the helper calls hostmemRecvDescriptor() on the other end and maps what it
+// gets (a memfd, shm or dma-buf fd, passed with SCM_RIGHTS). On Windows the
+// handle is duplicated into the helper's process with DuplicateHandle() and
+// only its value goes through the socket.
+//
+// Every export is a reference of its own to the memory, held by the helper's
+// descriptor. The memory goes away once the id is unregistered and every
+// helper has closed what it got, in any order.
+
+namespace android {
+namespace emulation {
+
+// Sent along with each descriptor.
+struct HostmemExportInfo {
+    static constexpr uint32_t kMagic = 0x484d4558;  // 'HMEX'
+    static constexpr uint32_t kVersion = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint64_t id;
+    // Of the host mapping, or 0 if |id| has a descriptor but no mapping.
+    uint64_t size;
+    // STREAM_HANDLE_TYPE_MEM_*.
+    uint32_t handleType;
+    uint32_t caching;
+    // Windows only: the handle's value in the receiving process.
+    uint64_t handle;
+    uint32_t hasVulkanInfo;
+    VulkanInfo vulkanInfo;
+};
+static_assert(std::is_trivially_copyable<HostmemExportInfo>::value,
+              "HostmemExportInfo is sent as raw bytes");
+
+// Sends a duplicate of the descriptor of |id| over |socket|. Returns 0,
+// -ENOENT if |id| has no descriptor, or another -errno value.
+#ifdef _WIN32
+int hostmemSendDescriptor(int socket, uint64_t id, HANDLE peerProcess);
+#else
+int hostmemSendDescriptor(int socket, uint64_t id);
+#endif
+
+// Receives a descriptor sent by hostmemSendDescriptor() and what goes with
+// it. Returns nullopt if the socket was closed or didn't carry one.
+std::optional<base::ManagedDescriptor> hostmemRecvDescriptor(int socket,
+                                                             HostmemExportInfo* info);
+
+}  // namespace emulation
+}  // namespace android
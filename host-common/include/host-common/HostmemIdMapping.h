@@ -17,6 +17,7 @@
 #include "aemu/base/containers/StaticMap.h"
 #include "aemu/base/export.h"
 #include "aemu/base/ManagedDescriptor.hpp"
+#include "aemu/base/synchronization/Lock.h"
 #include "vm_operations.h"
 
 #include <atomic>
@@ -34,6 +35,12 @@
 // This is currently used only in conjunction with virtio-gpu-next and Vulkan /
 // address space device, though there are possible other consumers of this, so
 // it becomes a global object. It exports methods into VmOperations.
+//
+// Ids are handed out densely, so entries live in a table indexed by id,
+// grown in chunks that are never moved. get() is wait-free: it reads the
+// slot inside an EpochReclaimer::ReadScope and never takes a lock.
+// Writers serialize on a lock and retire replaced entries. Fixed ids past
+// the table fall back to a locked map.
 
 using android::base::ManagedDescriptor;
 
@@ -66,7 +73,8 @@ struct ManagedDescriptorInfo {
 
 class HostmemIdMapping {
 public:
-    HostmemIdMapping() = default;
+    HostmemIdMapping();
+    ~HostmemIdMapping();
 
     AEMU_EXPORT static HostmemIdMapping* get();
 
@@ -88,6 +96,13 @@ public:
 
     std::optional<ManagedDescriptorInfo> removeDescriptorInfo(Id id);
 
+    // A copy of the descriptor info of |id|, with a duplicate of its
+    // descriptor that the caller owns, e.g. to hand to another process; see
+    // HostmemExport.h. The memory stays alive as long as any duplicate is
+    // open, whether or not |id| is still registered. Returns nullopt if |id|
+    // has no descriptor or it can't be duplicated.
+    std::optional<ManagedDescriptorInfo> dupDescriptorInfo(Id id) const;
+
     // If id == kInvalidHostmemId or not found in map,
     // returns entry with id == kInvalidHostmemId,
     // hva == 0, and size == 0.
@@ -97,9 +112,26 @@ public:
     AEMU_EXPORT void clear();
 
 private:
+    static constexpr size_t kChunkBits = 12;
+    static constexpr size_t kChunkSize = size_t(1) << kChunkBits;
+    // 16M ids before falling back to mOverflow.
+    static constexpr size_t kMaxChunks = 4096;
+
+    struct Chunk {
+        std::atomic<Entry*> slots[kChunkSize];
+    };
+
+    // Returns the table slot for |id|, or nullptr if it is past the table
+    // or its chunk doesn't exist and |create| is false.
+    std::atomic<Entry*>* slot(Id id, bool create) const;
+    // Replaces the entry for |id|; a null |entry| erases it.
+    void store(Id id, const Entry* entry);
+
     std::atomic<Id> mCurrentId {1};
-    base::StaticMap<Id, Entry> mEntries;
-    std::unordered_map<Id, ManagedDescriptor> mDescriptors;
+    // Guards writes to the table and mDescriptorInfos.
+    mutable base::Lock mLock{"HostmemIdMapping", base::LockWait::SpinThenPark};
+    mutable std::atomic<Chunk*> mChunks[kMaxChunks];
+    base::StaticMap<Id, Entry> mOverflow;
     std::unordered_map<Id, ManagedDescriptorInfo> mDescriptorInfos;
     DISALLOW_COPY_ASSIGN_AND_MOVE(HostmemIdMapping);
 };
@@ -0,0 +1,103 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "host-common/VmLock.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+
+// A VmLock that forwards to another one and records, per caller site, how
+// often the lock was taken, how long callers waited for it and how long
+// they held it. Install it over the embedder's lock with
+//
+//     InstrumentedVmLock::install();
+//
+// and read the numbers back with stats(). Sites are named by a
+// ScopedVmLockSite on the calling thread; locks taken outside one are
+// counted under "unknown". Only locking that goes through VmLock is seen:
+// vCPU threads taking the global mutex inside QEMU are not.
+//
+// It also answers isLockedBySelf() from a thread-local depth when the
+// calling thread locked through it, which is the common case for device
+// code deciding whether to defer, and only asks the wrapped lock
+// otherwise.
+class InstrumentedVmLock : public VmLock {
+public:
+    struct SiteStats {
+        std::string site;
+        uint64_t count = 0;
+        uint64_t totalWaitUs = 0;
+        uint64_t maxWaitUs = 0;
+        uint64_t totalHoldUs = 0;
+        uint64_t maxHoldUs = 0;
+    };
+
+    // Wraps |inner|, which must outlive this object.
+    explicit InstrumentedVmLock(VmLock* inner);
+    ~InstrumentedVmLock() override;
+
+    // Wraps the current VmLock::get() and makes the result current. Not
+    // thread-safe, like VmLock::set(). Returns the installed lock; calling
+    // it again returns the same one.
+    static InstrumentedVmLock* install();
+
+    void lock() override;
+    void unlock() override;
+    bool isLockedBySelf() const override;
+
+    // Per-site numbers so far, busiest (longest total hold) first.
+    std::vector<SiteStats> stats() const;
+    void resetStats();
+
+    VmLock* inner() const { return mInner; }
+
+private:
+    void record(const char* site, uint64_t waitUs, uint64_t holdUs);
+
+    VmLock* const mInner;
+    mutable base::Lock mStatsLock;
+    // Keyed by the site string's address; sites are string literals.
+    std::unordered_map<const char*, SiteStats> mStats;
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(InstrumentedVmLock);
+};
+
+// Names the code that takes the VM lock on this thread while in scope, for
+// InstrumentedVmLock. |site| must be a string literal or otherwise live
+// forever. Scopes nest; the innermost one wins.
+class ScopedVmLockSite {
+public:
+    explicit ScopedVmLockSite(const char* site);
+    ~ScopedVmLockSite();
+
+    // The innermost site on this thread, or nullptr.
+    static const char* current();
+
+private:
+    const char* const mPrevious;
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(ScopedVmLockSite);
+};
+
+}  // namespace android
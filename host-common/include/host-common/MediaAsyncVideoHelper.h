@@ -0,0 +1,88 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/threads/WorkerThread.h"
+#include "host-common/MediaVideoHelper.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace android {
+namespace emulation {
+
+// Runs another MediaVideoHelper on its own thread. decode() copies the
+// packet into a queue and returns, so the guest can send the next packet
+// while this one decodes; hardware decoders get to keep several packets in
+// flight. At most kMaxPacketsInFlight are queued, after which decode()
+// waits for the oldest. Decoded frames show up in receiveFrame() once the
+// worker is done with them; flush() and drain() wait for everything queued.
+//
+// good(), error() and fatal() report the state after the last packet the
+// worker finished, so a failure shows up a packet or so later than with
+// the synchronous helper. Output buffer offers are not passed on; frames
+// always land in pool buffers.
+class MediaAsyncVideoHelper : public MediaVideoHelper {
+public:
+    static constexpr size_t kMaxPacketsInFlight = 4;
+
+    explicit MediaAsyncVideoHelper(std::unique_ptr<MediaVideoHelper> helper);
+    ~MediaAsyncVideoHelper() override;
+
+    bool init() override;
+    void decode(const uint8_t* frame,
+                size_t szBytes,
+                uint64_t inputPts) override;
+    void flush() override;
+    void deInit() override;
+    void drain() override;
+    bool resetForReuse() override;
+
+    bool receiveFrame(MediaSnapshotState::FrameInfo* pFrameInfo) override;
+
+    int error() const override { return mError.load(std::memory_order_acquire); }
+    bool good() const override { return mGood.load(std::memory_order_acquire); }
+    bool fatal() const override { return mFatal.load(std::memory_order_acquire); }
+
+private:
+    struct Work {
+        enum class Op { Decode, Flush, Stop };
+        Op op = Op::Decode;
+        std::vector<uint8_t> packet;
+        uint64_t pts = 0;
+        bool ignoreOutput = false;
+    };
+
+    base::WorkerProcessingResult process(Work&& work);
+    void stopWorker();
+
+    std::unique_ptr<MediaVideoHelper> mHelper;  // only used by the worker
+    std::atomic<int> mError{0};
+    std::atomic<bool> mGood{true};
+    std::atomic<bool> mFatal{false};
+    // Guards mSavedDecodedFrames, which the worker fills.
+    base::Lock mFramesLock;
+    std::deque<std::future<void>> mInFlight;
+    bool mRunning = false;
+    base::WorkerThread<Work> mWorker;
+};
+
+}  // namespace emulation
+}  // namespace android
@@ -30,12 +30,26 @@ extern "C" {
 #include <stddef.h>
 
 namespace android {
+
+class StartupGraph;
+
 namespace emulation {
 
 class MediaCudaDriverHelper {
 public:
     // cuda related methods
+    // Loads and probes the CUDA driver, once: later calls return the first
+    // result. Waits for startInitCudaDrivers() if that already began.
     static bool initCudaDrivers();
+    // Starts initCudaDrivers() on a background thread and returns, so that
+    // loading the driver library stays off the caller's critical path.
+    static void startInitCudaDrivers();
+    // Adds a "media-cuda-probe" stage that calls startInitCudaDrivers().
+    static void addStartupStage(StartupGraph* graph);
+    // Identifies the host's NVIDIA driver and GPUs and the CUDA API this
+    // was built for, without loading the driver, for keying
+    // MediaDecoderCapabilityCache entries.
+    static std::string driverFingerprint();
     static bool s_isCudaInitialized;
 };
 
@@ -15,6 +15,8 @@
 #pragma once
 
 #include <cstdint>
+#include <mutex>
+#include <unordered_map>
 
 extern "C" {
 #include "host-common/dynlink_cuda.h"
@@ -39,6 +41,13 @@ struct media_cuda_utils_copy_context {
 
     unsigned int dest_width;
     unsigned int dest_height;
+
+    // A MediaCudaTextureRegistry to keep textures registered across
+    // frames; if null, each copy registers and unregisters its texture.
+    void* texture_registry;
+
+    // Set to 1 by the updater once both planes were copied.
+    int copied;
 };
 
 void media_cuda_utils_nv12_updater(void* privData,
@@ -46,3 +55,35 @@ void media_cuda_utils_nv12_updater(void* privData,
                                    uint32_t* textures,
                                    void* callerData);
 }
+
+// From dynlink_cudaGL.h, which the callers of this header don't all need.
+struct CUgraphicsResource_st;
+
+namespace android {
+namespace emulation {
+
+// Keeps GL textures registered with CUDA across frames. Registering a
+// texture costs far more than copying a frame into it, and the texture
+// pool hands the same textures out again and again.
+class MediaCudaTextureRegistry {
+public:
+    explicit MediaCudaTextureRegistry(CUcontext context) : mContext(context) {}
+    ~MediaCudaTextureRegistry() { clear(); }
+
+    // Returns the registration of the 2D texture |texture|, registering it
+    // first if needed; null if CUDA can't use it. Needs the GL context that
+    // owns |texture| to be current.
+    CUgraphicsResource_st* get(uint32_t texture);
+
+    // Unregisters |textures|, which GL is about to delete.
+    void forget(const uint32_t* textures, size_t count);
+    void clear();
+
+private:
+    CUcontext mContext;
+    std::mutex mLock;
+    std::unordered_map<uint32_t, CUgraphicsResource_st*> mResources;
+};
+
+}  // namespace emulation
+}  // namespace android
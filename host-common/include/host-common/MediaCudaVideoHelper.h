@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include "host-common/MediaCudaUtils.h"
 #include "host-common/MediaSnapshotState.h"
 #include "host-common/MediaTexturePool.h"
 #include "host-common/MediaVideoHelper.h"
@@ -21,6 +22,7 @@
 
 #include <cstdint>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -64,9 +66,7 @@ public:
     void flush() override;
     void deInit() override;
 
-    void resetTexturePool(MediaTexturePool* pool = nullptr) {
-        mTexturePool = pool;
-    }
+    void resetTexturePool(MediaTexturePool* pool = nullptr);
 
     virtual int error() const override { return mErrorCode; }
     virtual bool good() const override { return mIsGood; }
@@ -107,6 +107,8 @@ private:
     CUvideoctxlock mCtxLock;
     CUvideoparser mCudaParser = nullptr;
     CUvideodecoder mCudaDecoder = nullptr;
+    // Pool textures stay registered with CUDA until the pool deletes them.
+    std::unique_ptr<MediaCudaTextureRegistry> mTextureRegistry;
 
     cudaVideoCodec mCudaVideoCodecType;
 
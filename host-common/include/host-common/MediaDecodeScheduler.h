@@ -0,0 +1,132 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/threads/FunctorThread.h"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+namespace emulation {
+
+// Runs media decode work for many streams on a small shared pool of
+// threads, instead of on whichever vCPU thread pinged the device.
+//
+// Tasks of one stream run one at a time, in the order they were posted.
+// Different streams run in parallel, up to the thread count. Streams marked
+// OnScreen are picked before Background ones, except that a waiting
+// Background stream still gets every kOnScreenBurst + 1th turn so it can't
+// starve.
+class MediaDecodeScheduler {
+public:
+    struct Options {
+        size_t threadCount = 4;
+    };
+
+    enum class Priority { Background = 0, OnScreen = 1 };
+
+    using StreamId = uint64_t;
+    using Task = std::function<void()>;
+
+    static constexpr uint32_t kOnScreenBurst = 4;
+
+    // Decode times are bucketed by these upper bounds, in microseconds; the
+    // last bucket holds everything slower.
+    static constexpr std::array<uint64_t, 9> kDecodeTimeBucketLimitsUs = {
+            250, 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000};
+    static constexpr size_t kDecodeTimeBuckets =
+            kDecodeTimeBucketLimitsUs.size() + 1;
+
+    struct StreamStats {
+        // Tasks posted and not yet finished, including a running one.
+        size_t queueDepth = 0;
+        size_t maxQueueDepth = 0;
+        uint64_t tasksRun = 0;
+        std::array<uint64_t, kDecodeTimeBuckets> decodeTimeHistogram = {};
+    };
+
+    explicit MediaDecodeScheduler(Options options);
+    MediaDecodeScheduler() : MediaDecodeScheduler(Options()) {}
+    ~MediaDecodeScheduler();
+
+    // Shared by all media contexts, with a thread per host core (2 to 8).
+    static MediaDecodeScheduler& get();
+
+    StreamId addStream(Priority priority = Priority::Background);
+
+    // Waits for the stream's queued tasks to finish, then forgets it. Must
+    // not be called from one of its tasks.
+    void removeStream(StreamId id);
+
+    void setPriority(StreamId id, Priority priority);
+
+    // Queues |task| behind the stream's earlier tasks. The future is ready
+    // once it ran; for an unknown stream it is ready right away and |task|
+    // is dropped.
+    std::future<void> post(StreamId id, Task task);
+
+    // post(), then waits for |task|. Must not be called from a task.
+    void run(StreamId id, Task task);
+
+    std::optional<StreamStats> getStats(StreamId id) const;
+
+private:
+    struct Command {
+        Task task;
+        std::promise<void> done;
+    };
+
+    struct Stream {
+        Priority priority;
+        std::deque<Command> commands;
+        bool running = false;
+        // Whether the stream is in one of mReady.
+        bool ready = false;
+        StreamStats stats;
+    };
+
+    void workerLoop();
+    // Picks the next ready stream, honoring priorities. mReady must not be
+    // empty.
+    StreamId takeReadyLocked();
+    void makeReadyLocked(StreamId id, Stream& stream);
+
+    mutable base::Lock mLock;
+    base::ConditionVariable mWorkAvailable;
+    base::ConditionVariable mStreamIdle;
+    std::unordered_map<StreamId, Stream> mStreams;
+    // Ready streams by priority, each in FIFO order so equal streams take
+    // turns.
+    std::deque<StreamId> mReady[2];
+    uint32_t mOnScreenInARow = 0;
+    // Tasks queued or running across all streams.
+    uint64_t mQueued = 0;
+    StreamId mNextId = 1;
+    bool mStopping = false;
+    std::vector<std::unique_ptr<base::FunctorThread>> mThreads;
+};
+
+}  // namespace emulation
+}  // namespace android
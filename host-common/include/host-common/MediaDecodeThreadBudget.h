@@ -0,0 +1,96 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/synchronization/Lock.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace android {
+namespace emulation {
+
+// Hands out software decode threads to libvpx instances from one budget
+// shared by every stream, so several 4K decoders don't each spawn a thread
+// per core.
+//
+// select() sizes a stream by its pixel count: VP9 gets about one thread per
+// 1080p worth of pixels, with row-based multithreading from 1080p up so the
+// threads have work even when the encoder used few tile columns. VP8 only
+// threads over token partitions, so it stays at two. Lease grants what is
+// left of the budget, never less than one thread.
+class MediaDecodeThreadBudget {
+public:
+    struct Settings {
+        uint32_t threads = 1;
+        bool rowMt = false;
+
+        bool operator==(const Settings& other) const {
+            return threads == other.threads && rowMt == other.rowMt;
+        }
+        bool operator!=(const Settings& other) const { return !(*this == other); }
+    };
+
+    // Threads shared by all streams.
+    explicit MediaDecodeThreadBudget(uint32_t budget);
+
+    // Budgeted at one thread per host core.
+    static MediaDecodeThreadBudget& get();
+
+    // What a stream of |vpxVersion| (8 or 9) at |width| x |height| asks for
+    // on a host with |hostCores|, ignoring other streams.
+    static Settings select(int vpxVersion, uint32_t width, uint32_t height,
+                           uint32_t hostCores);
+
+    // Threads taken from a budget; given back on destruction.
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other);
+        Lease& operator=(Lease&& other);
+        ~Lease();
+
+        const Settings& settings() const { return mSettings; }
+
+    private:
+        friend class MediaDecodeThreadBudget;
+        Lease(MediaDecodeThreadBudget* owner, Settings settings, uint32_t taken);
+        void release();
+
+        MediaDecodeThreadBudget* mOwner = nullptr;
+        Settings mSettings;
+        uint32_t mTaken = 0;
+    };
+
+    // select()s settings for the stream, trimmed to what the budget has
+    // left.
+    Lease acquire(int vpxVersion, uint32_t width, uint32_t height);
+
+    uint32_t budget() const { return mBudget; }
+    uint32_t inUse() const;
+
+private:
+    void giveBack(uint32_t threads, bool rowMt);
+
+    const uint32_t mBudget;
+    mutable base::Lock mLock;
+    uint32_t mInUse = 0;
+    uint32_t mStreams = 0;
+    uint32_t mRowMtStreams = 0;
+};
+
+}  // namespace emulation
+}  // namespace android
@@ -0,0 +1,70 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/synchronization/Lock.h"
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace android {
+namespace emulation {
+
+// Remembers, across launches, whether a decoder backend worked on this
+// host, so startup can skip probes that are known to fail: loading a
+// driver library, or a hardware session that died.
+//
+// Each entry carries a fingerprint of what its answer depends on, such as
+// the GPU and driver and library versions. lookup() only returns entries
+// whose fingerprint still matches, so an upgrade reprobes. The file is a
+// few lines of text, rewritten whole on every store().
+class MediaDecoderCapabilityCache {
+public:
+    // Backed by |path|; empty keeps entries in memory only.
+    explicit MediaDecoderCapabilityCache(std::string path);
+
+    // In the emulator's home directory ($ANDROID_EMULATOR_HOME, or .android
+    // in the user's home). Setting ANDROID_EMU_MEDIA_CAPS_CACHE=0 makes it
+    // memory only.
+    static MediaDecoderCapabilityCache& get();
+
+    // The result stored for |name| under |fingerprint|, if any.
+    std::optional<bool> lookup(const std::string& name,
+                               const std::string& fingerprint);
+    void store(const std::string& name,
+               const std::string& fingerprint,
+               bool available);
+
+    const std::string& path() const { return mPath; }
+
+private:
+    struct Entry {
+        std::string fingerprint;
+        bool available;
+    };
+
+    void loadLocked();
+    void saveLocked() const;
+
+    const std::string mPath;
+    base::Lock mLock;
+    bool mLoaded = false;
+    std::unordered_map<std::string, Entry> mEntries;
+};
+
+}  // namespace emulation
+}  // namespace android
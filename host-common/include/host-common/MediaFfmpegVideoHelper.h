@@ -58,12 +58,13 @@ public:
                 uint64_t inputPts) override;
     void flush() override;
     void deInit() override;
+    bool resetForReuse() override;
 
     // this is special helper function, mostly used by apple vtb
     // to reorder the output frames
     int frameReorderBufferSize() const;
 private:
-    std::vector<uint8_t> mDecodedFrame;
+    MediaFrameBuffer mDecodedFrame;
 
     int mType = 0;
     int mThreadCount = 1;
@@ -0,0 +1,182 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "aemu/base/synchronization/Lock.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace android {
+namespace emulation {
+
+// Recycles the page-aligned buffers that hold decoded frames, so decoders
+// producing a frame per vsync don't malloc and fault in a few MB each time.
+// Buffers are kept per capacity (the size rounded up to whole pages); one
+// process-wide pool is shared by all decoder instances.
+class MediaFrameBufferPool {
+public:
+    static constexpr size_t kPageSize = 4096;
+    // Free buffers kept per capacity; more than that are freed.
+    static constexpr size_t kMaxFreePerCapacity = 8;
+
+    static MediaFrameBufferPool& get();
+
+    // Returns a buffer of at least |size| bytes, with uninitialized contents.
+    // It goes back to the pool when the last reference is dropped.
+    std::shared_ptr<uint8_t> acquire(size_t size, size_t* capacity);
+
+    // Frees every buffer not in use.
+    void trim();
+
+    size_t freeCount() const;
+
+private:
+    void release(uint8_t* bytes, size_t capacity);
+
+    mutable base::Lock mLock;
+    std::unordered_map<size_t, std::vector<uint8_t*>> mFree;  // by capacity
+};
+
+// The bytes of one decoded frame, in a buffer from MediaFrameBufferPool.
+// Copies share the same bytes, so passing frames around doesn't copy them.
+class MediaFrameBuffer {
+public:
+    MediaFrameBuffer() = default;
+    explicit MediaFrameBuffer(size_t size) { resize(size); }
+    // For producers that still fill a std::vector.
+    MediaFrameBuffer(const std::vector<uint8_t>& bytes);
+    // Refers to |size| bytes owned by someone else, such as guest memory,
+    // without taking ownership. Growing it moves to a pool buffer.
+    static MediaFrameBuffer wrap(uint8_t* bytes, size_t size);
+
+    MediaFrameBuffer(const MediaFrameBuffer&) = default;
+    MediaFrameBuffer& operator=(const MediaFrameBuffer&) = default;
+    MediaFrameBuffer(MediaFrameBuffer&& other)
+        : mBytes(std::move(other.mBytes)),
+          mSize(std::exchange(other.mSize, 0)),
+          mCapacity(std::exchange(other.mCapacity, 0)) {}
+    MediaFrameBuffer& operator=(MediaFrameBuffer&& other) {
+        mBytes = std::move(other.mBytes);
+        mSize = std::exchange(other.mSize, 0);
+        mCapacity = std::exchange(other.mCapacity, 0);
+        return *this;
+    }
+
+    uint8_t* data() { return mBytes.get(); }
+    const uint8_t* data() const { return mBytes.get(); }
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    // Keeps the first min(size(), |size|) bytes. Only takes another buffer
+    // from the pool if the current one is too small.
+    void resize(size_t size);
+    // Drops this reference to the buffer.
+    void clear();
+
+private:
+    std::shared_ptr<uint8_t> mBytes;
+    size_t mSize = 0;
+    size_t mCapacity = 0;
+};
+
+// A FIFO of frames in a ring over a vector that only grows. Popped slots
+// are reused in place, so a steady stream of frames doesn't allocate.
+template <class T>
+class MediaFrameQueue {
+public:
+    MediaFrameQueue() = default;
+    MediaFrameQueue(const MediaFrameQueue&) = default;
+    MediaFrameQueue& operator=(const MediaFrameQueue&) = default;
+    MediaFrameQueue(MediaFrameQueue&& other) { swap(other); }
+    MediaFrameQueue& operator=(MediaFrameQueue&& other) {
+        MediaFrameQueue tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    bool empty() const { return mCount == 0; }
+    size_t size() const { return mCount; }
+
+    T& front() { return mSlots[mHead]; }
+    const T& front() const { return mSlots[mHead]; }
+
+    T& operator[](size_t i) { return mSlots[(mHead + i) % mSlots.size()]; }
+    const T& operator[](size_t i) const {
+        return mSlots[(mHead + i) % mSlots.size()];
+    }
+
+    void push_back(T value) {
+        if (mCount == mSlots.size()) {
+            grow();
+        }
+        mSlots[(mHead + mCount) % mSlots.size()] = std::move(value);
+        ++mCount;
+    }
+
+    void pop_front() {
+        // Reset so the slot doesn't hold on to the frame's buffer.
+        mSlots[mHead] = T();
+        mHead = (mHead + 1) % mSlots.size();
+        --mCount;
+    }
+
+    void clear() {
+        while (!empty()) {
+            pop_front();
+        }
+        mHead = 0;
+    }
+
+    void swap(MediaFrameQueue& other) {
+        mSlots.swap(other.mSlots);
+        std::swap(mHead, other.mHead);
+        std::swap(mCount, other.mCount);
+    }
+
+    // Calls |func(frame)| from front to back.
+    template <class Func>
+    void forEach(Func&& func) const {
+        for (size_t i = 0; i < mCount; ++i) {
+            func((*this)[i]);
+        }
+    }
+
+private:
+    void grow() {
+        std::vector<T> slots(mSlots.empty() ? 4 : mSlots.size() * 2);
+        for (size_t i = 0; i < mCount; ++i) {
+            slots[i] = std::move((*this)[i]);
+        }
+        mSlots.swap(slots);
+        mHead = 0;
+    }
+
+    std::vector<T> mSlots;
+    size_t mHead = 0;
+    size_t mCount = 0;
+};
+
+template <class T>
+void swap(MediaFrameQueue<T>& lhs, MediaFrameQueue<T>& rhs) {
+    lhs.swap(rhs);
+}
+
+}  // namespace emulation
+}  // namespace android
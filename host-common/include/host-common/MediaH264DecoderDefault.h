@@ -28,7 +28,11 @@ namespace emulation {
 
 class MediaH264DecoderDefault : public MediaH264Decoder {
 public:
-    MediaH264DecoderDefault() = default;
+    // Also serves HEVC, which shares the H.264 ping protocol, when |codec|
+    // is MediaCodecType::HevcCodec.
+    explicit MediaH264DecoderDefault(
+            MediaCodecType codec = MediaCodecType::H264Codec)
+        : mCodec(codec) {}
     virtual ~MediaH264DecoderDefault() = default;
 
     // This is the entry point
@@ -39,6 +43,7 @@ public:
     virtual bool load(base::Stream* stream) override;
 
 private:
+    const MediaCodecType mCodec;
     std::mutex mIdLock{};
     std::mutex mMapLock{};
     uint64_t mId = 0;
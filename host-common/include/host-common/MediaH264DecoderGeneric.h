@@ -15,12 +15,15 @@
 #pragma once
 
 #include "host-common/GoldfishMediaDefs.h"
+#include "host-common/H264NaluParser.h"
 #include "host-common/H264PingInfoParser.h"
 #include "host-common/MediaFfmpegVideoHelper.h"
 #include "host-common/MediaH264DecoderPlugin.h"
 #include "host-common/MediaHostRenderer.h"
+#include "host-common/MediaHwSessionArbiter.h"
 #include "host-common/MediaSnapshotHelper.h"
 #include "host-common/MediaSnapshotState.h"
+#include "host-common/MediaVideoHelperPool.h"
 
 #include <cstdint>
 #include <string>
@@ -44,11 +47,17 @@ public:
     virtual void flush(void* ptr) override;
     virtual void getImage(void* ptr) override;
     virtual void sendMetadata(void* ptr) override;
+    virtual void setOutputBuffer(void* ptr) override;
 
     virtual void save(base::Stream* stream) const override;
     virtual bool load(base::Stream* stream) override;
 
-    explicit MediaH264DecoderGeneric(uint64_t id, H264PingInfoParser parser);
+    // HEVC streams use the same guest protocol and backends, so |codec| may
+    // also be MediaCodecType::HevcCodec.
+    explicit MediaH264DecoderGeneric(
+            uint64_t id,
+            H264PingInfoParser parser,
+            MediaCodecType codec = MediaCodecType::H264Codec);
     virtual ~MediaH264DecoderGeneric();
 
     virtual int type() const override { return PLUGIN_TYPE_GENERIC; }
@@ -68,6 +77,10 @@ private:
                                  PixelFormat pixFmt);
     uint64_t mId = 0;
     H264PingInfoParser mParser;
+    MediaCodecType mCodec = MediaCodecType::H264Codec;
+    bool isHevc() const { return mCodec == MediaCodecType::HevcCodec; }
+    // The codec number MediaFfmpegVideoHelper takes.
+    int ffmpegCodec() const { return isHevc() ? 265 : 264; }
     MediaHostRenderer mRenderer;
     // image props
     unsigned int mWidth = 0;
@@ -85,6 +98,8 @@ private:
 
 private:
     std::unique_ptr<MediaSnapshotHelper> mSnapshotHelper;
+    // The NALUs of the packet being decoded, parsed once for all who ask.
+    H264NaluList mNalus;
     bool mUseGpuTexture = false;
 
     // at any point of time, only one of the following is valid
@@ -94,10 +109,30 @@ private:
 
     bool mTrialPeriod = true;
 
+    // This decoder's share of the host's hardware sessions. mHwCapable says
+    // whether the stream has a hardware backend at all, granted or not.
+    MediaHwSessionArbiter::Session mHwSession;
+    bool mHwCapable = false;
+
+    // Guest buffer registered with SetOutputBuffer. Not saved: the host
+    // address of guest memory can change across a snapshot load, so we fall
+    // back to copying until the guest registers again.
+    uint8_t* mGuestOutputBuffer = nullptr;
+    size_t mGuestOutputBufferSize = 0;
+
 private:
     void fetchAllFrames();
+    // Lets the current helper decode the next frame into the guest's buffer,
+    // if it has one and no earlier frame is still waiting there.
+    void offerGuestOutputBuffer();
+    void withdrawGuestOutputBuffer();
 
     void createAndInitSoftVideoHelper();
+    void createHwVideoHelper();
+    // Moves an H.264 stream that fell back to software onto the hardware at
+    // a key frame, once the arbiter grants it a session.
+    void maybeUpgradeToHw();
+    MediaVideoHelperPool::Key softVideoHelperKey() const;
 
     void oneShotDecode(const uint8_t* data, size_t len, uint64_t pts);
 };  // MediaH264DecoderGeneric
@@ -40,6 +40,9 @@ public:
     virtual void flush(void* ptr) = 0;
     virtual void getImage(void* ptr) = 0;
     virtual void sendMetadata(void* ptr) = 0;
+    // Optional; plugins that can't decode into guest memory ignore it and
+    // keep copying in getImage.
+    virtual void setOutputBuffer(void* ptr) {}
 
     virtual void save(base::Stream* stream) const {};
     virtual bool load(base::Stream* stream) {return true;};
@@ -0,0 +1,50 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "host-common/GoldfishMediaDefs.h"
+#include "host-common/MediaH264DecoderDefault.h"
+#include "host-common/MediaHevcDecoder.h"
+
+namespace android {
+namespace emulation {
+
+// HEVC over the H.264 guest protocol: the guest driver sends the same pings
+// for both, so the H.264 plugin framework does the work with HEVC backends.
+class MediaHevcDecoderDefault : public MediaHevcDecoder {
+public:
+    MediaHevcDecoderDefault() = default;
+    virtual ~MediaHevcDecoderDefault() = default;
+
+    virtual void handlePing(MediaCodecType type,
+                            MediaOperation op,
+                            void* ptr) override {
+        mDecoders.handlePing(type, op, ptr);
+    }
+
+    virtual void save(base::Stream* stream) const override {
+        mDecoders.save(stream);
+    }
+    virtual bool load(base::Stream* stream) override {
+        return mDecoders.load(stream);
+    }
+
+private:
+    MediaH264DecoderDefault mDecoders{MediaCodecType::HevcCodec};
+};
+
+}  // namespace emulation
+}  // namespace android
@@ -14,12 +14,17 @@
 
 #pragma once
 
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/threads/WorkerThread.h"
 #include "host-common/GoldfishMediaDefs.h"
+#include "host-common/MediaFrameBufferPool.h"
 #include "host-common/MediaTexturePool.h"
 #include "host-common/opengles.h"
 
 #include <stddef.h>
 #include <stdint.h>
+#include <deque>
+#include <future>
 #include <list>
 
 namespace android {
@@ -58,6 +63,19 @@ public:
                                  uint8_t* decodedFrame,
                                  void* metadata = nullptr);
 
+    // Same, but only copies the |frameBytes| bytes of |decodedFrame| into
+    // one of kUploadSlots staging buffers and returns; an upload thread
+    // moves it into the color buffer. The decoder fills the next staging
+    // buffer while the previous frame uploads, and waits only when all of
+    // them are still in flight. Use waitForColorBuffer() before reading
+    // the color buffer.
+    void renderToHostColorBufferAsync(int hostColorBufferId,
+                                      unsigned int outputWidth,
+                                      unsigned int outputHeight,
+                                      const uint8_t* decodedFrame,
+                                      size_t frameBytes,
+                                      void* metadata = nullptr);
+
     // render decoded frame stored in GPU texture; recycle the swapped
     // out texture from colorbuffer into framepool
     void renderToHostColorBufferWithTextures(
@@ -70,8 +88,49 @@ public:
     MediaHostRenderer();
     ~MediaHostRenderer();
 
+    static constexpr size_t kUploadSlots = 2;
+
+    // Blocks until every upload queued for |hostColorBufferId|, by any
+    // renderer, has reached the color buffer. Meant for the compositor
+    // before it samples a color buffer a decoder may still be writing.
+    static void waitForColorBuffer(int hostColorBufferId);
+
+    // Blocks until all uploads queued by this renderer are done.
+    void waitForUploads();
+
+    // Time from queuing an async upload to its color buffer update
+    // finishing; at 60fps the mean has to stay well under 16ms per stream.
+    struct UploadStats {
+        uint64_t frames = 0;
+        uint64_t lastUs = 0;
+        uint64_t maxUs = 0;
+        uint64_t totalUs = 0;
+    };
+    UploadStats getUploadStats() const;
+
 private:
+    struct Upload {
+        bool stop = false;
+        int hostColorBufferId = -1;
+        unsigned int width = 0;
+        unsigned int height = 0;
+        size_t slot = 0;
+        uint64_t queuedUs = 0;
+    };
+
+    base::WorkerProcessingResult upload(Upload&& upload);
+    void stopUploads();
+
     AndroidVirtioGpuOps* mVirtioGpuOps = nullptr;
+    // Slot i is only written by the decoder once the upload reading it has
+    // finished, i.e. its future in mUploadsInFlight is ready.
+    MediaFrameBuffer mStaging[kUploadSlots];
+    size_t mNextSlot = 0;
+    std::deque<std::future<void>> mUploadsInFlight;
+    bool mUploading = false;
+    mutable base::Lock mStatsLock;
+    UploadStats mStats;
+    base::WorkerThread<Upload> mUploader;
 };
 
 }  // namespace emulation
@@ -0,0 +1,128 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "aemu/base/synchronization/Lock.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace android {
+namespace emulation {
+
+// Shares the host's hardware video decode sessions between every emulator
+// instance on it. NVDEC and VideoToolbox only run so many sessions at once;
+// left alone, whichever emulators start decoding first take them all and the
+// one the user is looking at falls back to software.
+//
+// Each process keeps a slot in a small file: its priority, the sessions it
+// holds and the sessions it wants. Every change happens under an exclusive
+// lock on that file, and slots of processes that died are reclaimed. A
+// session is granted while the host is under budget and no process that
+// outranks this one is waiting. A granted session is preempted when the
+// budget is spent and a higher-priority process is waiting; its decoder
+// carries on in software and may take a session back at the next key frame.
+//
+// With no budget (the default) every session is granted and the file is
+// never touched.
+class MediaHwSessionArbiter {
+public:
+    enum class Priority : uint32_t {
+        kBackground = 0,
+        kForeground = 1,
+    };
+
+    // Sessions shared by the processes that use |path|, or 0 for no limit.
+    // |pid| identifies this process in the file. Sessions check whether
+    // they are preempted at most every |pollInterval|.
+    MediaHwSessionArbiter(std::string path,
+                          uint32_t budget,
+                          Priority priority,
+                          int pid,
+                          std::chrono::milliseconds pollInterval);
+    ~MediaHwSessionArbiter();
+
+    // Budgeted by ANDROID_EMU_MEDIA_HW_SESSIONS, shared through the
+    // emulator home directory. ANDROID_EMU_MEDIA_HW_PRIORITY=background
+    // starts this process at background priority.
+    static MediaHwSessionArbiter& get();
+
+    // A hardware session, or a place in line for one. Given back on
+    // destruction.
+    class Session {
+    public:
+        Session() = default;
+        Session(Session&& other);
+        Session& operator=(Session&& other);
+        ~Session();
+
+        bool granted() const { return mGranted; }
+
+        // Takes a session if a waiting one may have it now.
+        bool tryUpgrade();
+
+        // Whether a granted session has to make way for a higher-priority
+        // process. If so it goes back to waiting, and the caller should
+        // drop its hardware decoder.
+        bool preempted();
+
+        void release();
+
+    private:
+        friend class MediaHwSessionArbiter;
+        Session(MediaHwSessionArbiter* owner, bool granted);
+        bool due();
+
+        MediaHwSessionArbiter* mOwner = nullptr;
+        bool mGranted = false;
+        std::chrono::steady_clock::time_point mNextPoll;
+    };
+
+    // Asks for a session; check granted() before using the hardware.
+    Session acquire();
+
+    // Changes this process's priority, e.g. as its window gains or loses
+    // focus.
+    void setPriority(Priority priority);
+
+    // Sessions held and waited for by every process sharing the budget.
+    struct Usage {
+        uint32_t held = 0;
+        uint32_t waiting = 0;
+    };
+    Usage usage();
+
+    uint32_t budget() const { return mBudget; }
+
+private:
+    // Runs |update| on this process's slot with the file locked, then
+    // writes the table back. False if the file can't be used.
+    template <typename Update>
+    bool withTable(Update&& update);
+
+    bool enabled() const { return mBudget > 0; }
+
+    const std::string mPath;
+    const uint32_t mBudget;
+    const int mPid;
+    const std::chrono::milliseconds mPollInterval;
+    base::Lock mLock;
+    Priority mPriority;
+    int mFd = -1;
+};
+
+}  // namespace emulation
+}  // namespace android
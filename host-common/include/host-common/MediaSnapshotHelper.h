@@ -15,6 +15,8 @@
 #pragma once
 
 #include "aemu/base/files/Stream.h"
+#include "host-common/H264NaluParser.h"
+#include "host-common/HevcNaluParser.h"
 #include "host-common/MediaSnapshotState.h"
 
 #include <cstdint>
@@ -41,13 +43,43 @@ public:
         HEVC = 4,
     };
 
+    struct Options {
+        // Packet history kept since the last key frame. Past this, the
+        // history is dropped and snapshots fall back to the reference frame.
+        size_t maxPacketHistoryBytes = 32 * 1024 * 1024;
+        // Save the last decoded frame instead of the packet history, so
+        // loading doesn't replay a whole GOP. Until the next key frame, the
+        // loaded decoder repeats that frame rather than decoding packets it
+        // has no references for.
+        bool saveReferenceFrame = false;
+        // LZ4-compress the decoded frames in the snapshot.
+        bool compressFrames = true;
+    };
+
 public:
-    MediaSnapshotHelper(CodecType type) : mType(type) {}
+    // Options come from the environment: ANDROID_EMU_MEDIA_SNAPSHOT_FRAMES=1
+    // turns on saveReferenceFrame.
+    MediaSnapshotHelper(CodecType type);
+    MediaSnapshotHelper(CodecType type, Options options)
+        : mType(type), mOptions(options) {}
     ~MediaSnapshotHelper() = default;
 
 public:
 public:
-    void savePacket(const uint8_t* compressedFrame, size_t len, uint64_t pts);
+    // H.264 callers that parsed the packet already can pass its |nalus|;
+    // otherwise the packet is parsed here.
+    void savePacket(const uint8_t* compressedFrame,
+                    size_t len,
+                    uint64_t pts,
+                    const H264NaluList* nalus = nullptr);
+
+    // Call before decoding a packet. While a loaded decoder still waits for
+    // a key frame, queues the reference frame with |pts| in place of the
+    // packet's output and returns true: the packet must not be decoded.
+    bool repeatReferenceFrame(const uint8_t* compressedFrame,
+                              size_t len,
+                              uint64_t pts,
+                              const H264NaluList* nalus = nullptr);
 
     void save(base::Stream* stream) const;
 
@@ -89,14 +121,32 @@ public:
 
 private:
     CodecType mType = CodecType::H264;
+    Options mOptions;
     mutable MediaSnapshotState mSnapshotState;
+    // The history no longer reaches back to a key frame, so it can't be
+    // replayed.
+    bool mHistoryTruncated = false;
+    // Loaded from a reference frame and no key frame decoded since.
+    bool mAwaitingKeyFrame = false;
+
+    H264NaluList mNalus;
+    HevcNaluList mHevcNalus;
+
+    const H264NaluList& naluList(const uint8_t* compressedFrame,
+                                 size_t len,
+                                 const H264NaluList* nalus);
+    bool isKeyFrame(const uint8_t* compressedFrame,
+                    size_t len,
+                    const H264NaluList* nalus);
+    void capPacketHistory();
 
     void saveVPXPacket(const uint8_t* compressedFrame,
                        size_t len,
                        uint64_t pts);
     void saveH264Packet(const uint8_t* compressedFrame,
                         size_t len,
-                        uint64_t pts);
+                        uint64_t pts,
+                        const H264NaluList& nalus);
     void saveHEVCPacket(const uint8_t* compressedFrame,
                         size_t len,
                         uint64_t pts);
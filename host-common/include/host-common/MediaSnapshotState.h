@@ -14,9 +14,9 @@
 
 #pragma once
 #include "aemu/base/files/Stream.h"
+#include "host-common/MediaFrameBufferPool.h"
 
 #include <stddef.h>
-#include <list>
 #include <vector>
 
 namespace android {
@@ -39,7 +39,7 @@ public:
     };
 
     struct FrameInfo {
-        std::vector<uint8_t> data;
+        MediaFrameBuffer data;
         std::vector<uint32_t> texture;
         int width;
         int height;
@@ -51,7 +51,13 @@ public:
     void saveSps(std::vector<uint8_t> xsps) { sps = std::move(xsps); }
     void savePps(std::vector<uint8_t> xpps) { pps = std::move(xpps); }
 
-    void saveDecodedFrame(std::vector<uint8_t> data,
+    void saveDecodedFrame(MediaFrameBuffer data,
+                          int width = 0,
+                          int height = 0,
+                          uint64_t pts = 0,
+                          ColorAspects xcolor = ColorAspects{});
+
+    void saveDecodedFrame(const std::vector<uint8_t>& data,
                           int width = 0,
                           int height = 0,
                           uint64_t pts = 0,
@@ -67,9 +73,27 @@ public:
         savedFrames.push_back(std::move(frame));
     }
 
-    void save(base::Stream* stream) const;
+    // With |saveReference|, the packet history is left out and the last
+    // decoded frame is saved in its place, so loading needs no replay.
+    // With |compressFrames|, decoded frames go through LZ4.
+    void save(base::Stream* stream,
+              bool saveReference = false,
+              bool compressFrames = false) const;
     void load(base::Stream* stream);
 
+    // Bytes of packet data in the history.
+    size_t packetBytes() const { return savedPacketBytes; }
+    void clearPackets() {
+        savedPackets.clear();
+        savedPacketBytes = 0;
+    }
+
+    // The newest decoded frame with bytes, if any: the back of the queue or
+    // else the last one discarded.
+    const FrameInfo* referenceFrame() const;
+    // Whether the last load() restored a reference frame instead of packets.
+    bool loadedReference() const { return mLoadedReference; }
+
     FrameInfo* frontFrame() {
         if (savedFrames.empty()) {
             return nullptr;
@@ -79,6 +103,10 @@ public:
 
     void discardFrontFrame() {
         if (!savedFrames.empty()) {
+            // Keep it around (without copying) as a reference frame.
+            if (!savedFrames.front().data.empty()) {
+                mLastFrame = std::move(savedFrames.front());
+            }
             savedFrames.pop_front();
         }
     }
@@ -89,8 +117,11 @@ private:
     std::vector<uint8_t> sps;  // sps NALU
     std::vector<uint8_t> pps;  // pps NALU
     std::vector<PacketInfo> savedPackets;
+    size_t savedPacketBytes = 0;
     FrameInfo savedDecodedFrame;  // only one or nothing
-    std::list<FrameInfo> savedFrames;
+    MediaFrameQueue<FrameInfo> savedFrames;
+    FrameInfo mLastFrame{};
+    bool mLoadedReference = false;
 
 private:
     bool savePacket(const uint8_t* frame, size_t size, uint64_t pts = 0);
@@ -105,6 +136,9 @@ private:
 
     void loadFrameInfo(base::Stream* stream, FrameInfo& frame);
 
+    void saveFrames(base::Stream* stream, bool saveReference) const;
+    void loadFrames(base::Stream* stream, bool loadReference);
+
     void loadPacketInfo(base::Stream* stream, PacketInfo& pkt);
 
     void loadColor(base::Stream* stream, ColorAspects& color) const;
@@ -16,17 +16,27 @@
 
 #include "host-common/GoldfishMediaDefs.h"
 #include "host-common/opengles.h"
+#include "aemu/base/memory/MemoryPressure.h"
 
 #include <stddef.h>
 #include <stdint.h>
-#include <list>
-#include <map>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <vector>
 
 namespace android {
 namespace emulation {
 
 // This is a helper class to render decoded frames
 // to host color buffer
+//
+// Textures are pooled per frame size. Sizes that have been idle longest
+// lose their free textures first once the pool holds more than
+// memoryBudget() bytes, so resolution changes don't keep stale sizes
+// alive until cleanUpTextures(). Under memory pressure, the free frames of
+// idle sizes (of every size, when critical) go too; as the pool is only used
+// on its decoder's thread, that happens on its next call.
 class MediaTexturePool {
 public:
     // for now, there is only NV12
@@ -35,6 +45,15 @@ public:
         uint32_t UVtex;
     };
 
+    struct Stats {
+        uint64_t hits = 0;       // served from a free texture
+        uint64_t misses = 0;     // had to create textures
+        uint64_t evictions = 0;  // frames destroyed to stay within budget
+        size_t bytes = 0;        // every texture the pool owns, free or not
+    };
+
+    static constexpr size_t kDefaultMemoryBudget = 256 * 1024 * 1024;
+
     // get a TextureFrame structure to hold decoded frame
     TextureFrame getTextureFrame(int w, int h);
 
@@ -48,16 +67,61 @@ public:
 
     void cleanUpTextures();
 
+    // Textures in use always stay, so the pool can exceed its budget while
+    // frames are out.
+    void setMemoryBudget(size_t bytes);
+    size_t memoryBudget() const { return mBudget; }
+
+    const Stats& stats() const { return mStats; }
+
+    // Called with the textures about to be destroyed, so users that
+    // registered them elsewhere (with CUDA, say) can let go first; GL reuses
+    // the names of deleted textures.
+    using ReleaseHook =
+            std::function<void(const uint32_t* textures, size_t count)>;
+    void setReleaseHook(ReleaseHook hook) { mReleaseHook = std::move(hook); }
+
 private:
-    using TexSizes = std::pair<int, int>;
-    using TexFrame = std::pair<uint32_t, uint32_t>;
-    using Pool = std::list<TextureFrame>;
-    using PoolHandle = std::list<TextureFrame>*;
-    std::map<TexSizes, PoolHandle> m_WH_to_PoolHandle;
-    std::map<TexFrame, TexSizes> m_Frame_to_WH;
-    std::map<TexFrame, PoolHandle> m_Frame_to_PoolHandle;
+    struct SizeClass {
+        int width;
+        int height;
+        // LIFO, so the most recently used (and cached) textures go first.
+        std::vector<TextureFrame> free;
+        // Frames of this size the pool owns, free or in use.
+        size_t frames = 0;
+        uint64_t lastUsed = 0;
+    };
+
+    static uint64_t sizeKey(int w, int h) {
+        return (uint64_t(uint32_t(w)) << 32) | uint32_t(h);
+    }
+    static uint64_t frameKey(TextureFrame frame) {
+        return (uint64_t(frame.Ytex) << 32) | frame.UVtex;
+    }
+    static size_t frameBytes(const SizeClass& sizeClass) {
+        return size_t(sizeClass.width) * sizeClass.height * 3 / 2;
+    }
 
     void deleteTextures(TextureFrame frame);
+    // Destroys |frameCount| frames given as Y and UV texture pairs.
+    void destroyTextures(const uint32_t* textures, size_t frameCount);
+    // Destroys the free frames of |key|'s size class, dropping the class if
+    // nothing of it is left in use.
+    void releaseFreeFrames(uint64_t key);
+    // Evicts idle size classes, least recently used first, other than the
+    // one |keep| is in.
+    void trimToBudget(uint64_t keep);
+    // Does what the memory pressure trimmer asked for since the last call.
+    void applyRequestedTrim();
+
+    std::unordered_map<uint64_t, SizeClass> mSizeClasses;  // by sizeKey
+    std::unordered_map<uint64_t, uint64_t> mFrameToSize;   // frameKey -> sizeKey
+    uint64_t mClock = 0;
+    // Size of the last getTextureFrame, which is never trimmed.
+    uint64_t mCurrentSize = ~uint64_t(0);
+    size_t mBudget = kDefaultMemoryBudget;
+    Stats mStats;
+    ReleaseHook mReleaseHook;
 
     int m_id = 0;
 
@@ -67,6 +131,10 @@ public:
 
 private:
     AndroidVirtioGpuOps* mVirtioGpuOps = nullptr;
+    // The highest MemoryPressureLevel asked for, not yet applied.
+    std::atomic<int> mRequestedTrim{0};
+    // Last, so it is gone before the rest of the pool.
+    base::MemoryTrimmer mTrimmer;
 };
 
 }  // namespace emulation
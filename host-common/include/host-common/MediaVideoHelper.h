@@ -41,19 +41,39 @@ public:
                         uint64_t inputPts) {}
     virtual void flush() {}
     virtual void deInit() {}
+    // Waits until every packet passed to decode() has been decoded, for
+    // helpers that decode asynchronously.
+    virtual void drain() {}
+    // Brings an initialized helper back to the state init() left it in, so
+    // a new stream can use it without the cost of another init(). Returns
+    // false if this helper can't do that.
+    virtual bool resetForReuse() { return false; }
 
-    bool receiveFrame(MediaSnapshotState::FrameInfo* pFrameInfo);
+    virtual bool receiveFrame(MediaSnapshotState::FrameInfo* pFrameInfo);
     void setIgnoreDecodedFrames() { mIgnoreDecoderOutput = true; }
     void setSaveDecodedFrames() { mIgnoreDecoderOutput = false; }
 
+    // Offers |buffer| for the next decoded frame that fits in |size| bytes,
+    // once; nullptr withdraws it. Helpers that can't use it just ignore it.
+    void setOutputBuffer(uint8_t* buffer, size_t size) {
+        mOutputBuffer = buffer;
+        mOutputBufferSize = size;
+    }
+
     virtual int error() const { return 0; }
     virtual bool good() const { return true; }
     virtual bool fatal() const { return false; }
 
 protected:
+    // Returns the offered output buffer if |size| fits, and withdraws it;
+    // otherwise an empty buffer.
+    MediaFrameBuffer takeOutputBuffer(size_t size);
+
     bool mIgnoreDecoderOutput = false;
+    uint8_t* mOutputBuffer = nullptr;
+    size_t mOutputBufferSize = 0;
 
-    mutable std::list<MediaSnapshotState::FrameInfo> mSavedDecodedFrames;
+    mutable MediaFrameQueue<MediaSnapshotState::FrameInfo> mSavedDecodedFrames;
 
 };  // MediaVideoHelper
 
@@ -0,0 +1,99 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "aemu/base/synchronization/Lock.h"
+#include "host-common/MediaVideoHelper.h"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace android {
+namespace base {
+class MetricsLogger;
+}  // namespace base
+
+namespace emulation {
+
+// Keeps initialized video helpers that decoders are done with, so the next
+// decoder with the same configuration skips backend setup. Guests tear down
+// and recreate decoders on every seek and resolution switch, and setting up
+// a backend costs tens of milliseconds. Only helpers whose resetForReuse()
+// succeeds are kept; the rest are destroyed as before.
+class MediaVideoHelperPool {
+public:
+    struct Key {
+        enum class Backend : uint8_t { Ffmpeg, Cuda, VideoToolBox };
+        Backend backend;
+        int codec;    // 264, 265, 8 or 9
+        int variant;  // backend specific, e.g. the ffmpeg thread count
+
+        bool operator<(const Key& other) const {
+            return std::tie(backend, codec, variant) <
+                   std::tie(other.backend, other.codec, other.variant);
+        }
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        // Longest time acquire() took, hits and misses alike.
+        int64_t maxStartupUs = 0;
+    };
+
+    static constexpr size_t kMaxIdlePerKey = 2;
+    static constexpr size_t kMaxIdle = 8;
+    // Stats are logged and reset after this many acquire() calls.
+    static constexpr uint64_t kReportInterval = 64;
+
+    static MediaVideoHelperPool& get();
+
+    // For keys that depend on the frame size: 0 up to 720p, 1 up to 1080p,
+    // 2 above.
+    static int resolutionClass(int width, int height);
+
+    // Returns an idle helper for |key|, or else whatever |create| returns;
+    // |create| is expected to init() the helper it makes.
+    std::unique_ptr<MediaVideoHelper> acquire(
+            const Key& key,
+            const std::function<MediaVideoHelper*()>& create);
+
+    // Keeps |helper| for later if it is healthy, resets for reuse and there
+    // is room; otherwise deInit()s and destroys it.
+    void release(const Key& key, std::unique_ptr<MediaVideoHelper> helper);
+
+    // Destroys every idle helper.
+    void clear();
+
+    Stats stats() const;
+    size_t idleCount() const;
+
+    // Logs the hit rate and worst startup time since the previous report,
+    // then starts a new window.
+    void reportMetrics(base::MetricsLogger* logger);
+
+private:
+    mutable base::Lock mLock;
+    std::map<Key, std::vector<std::unique_ptr<MediaVideoHelper>>> mIdle;
+    size_t mIdleCount = 0;
+    Stats mStats;
+};
+
+}  // namespace emulation
+}  // namespace android
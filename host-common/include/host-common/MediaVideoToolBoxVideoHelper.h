@@ -19,7 +19,6 @@
 #include "host-common/MediaSnapshotState.h"
 #include "host-common/MediaTexturePool.h"
 #include "host-common/MediaVideoHelper.h"
-#include "host-common/YuvConverter.h"
 
 // this is apple's video tool box header
 #include <VideoToolbox/VideoToolbox.h>
@@ -94,9 +93,10 @@ private:
                                                 void* buffer,
                                                 size_t sz);
 
-    void copyFrame();
-    void copyFrameToTextures();
-    void copyFrameToCPU();
+    // Converts a frame leaving the reorder buffer, then releases it.
+    void emitFrame(CVPixelBufferRef buffer, uint64_t pts);
+    void copyFrameToTextures(CVPixelBufferRef buffer);
+    void copyFrameToCPU(CVPixelBufferRef buffer);
     void createCMFormatDescription();
     void recreateDecompressionSession();
     void getOutputWH();
@@ -149,9 +149,6 @@ private:
     uint64_t mOutputPts = 0;
     bool mImageReady = false;
 
-    // used in vtb callback to saved decoded frame
-    std::vector<uint8_t> mSavedDecodedFrame;
-
     // TODO: get color aspects from some where
     MediaSnapshotState::ColorAspects mColorAspects{0};
 
@@ -167,8 +164,6 @@ private:
     // The VideoToolbox decoder session: this could fail to
     // create due to incompatible formats coming from android guest
     VTDecompressionSessionRef mDecoderSession = nullptr;
-    // where the decoded frame is stored
-    CVPixelBufferRef mDecodedFrame = nullptr;
 
     // need this ffmpeg helper to get the w/h/colorspace info
     // TODO: replace it with webrtc h264 parser once it is built
@@ -181,7 +176,10 @@ private:
     // the video could see jumps all the times
     int mVtbBufferSize = 8;
     using PtsPair = std::pair<uint64_t, uint64_t>;
-    std::map<PtsPair, MediaSnapshotState::FrameInfo> mVtbBufferMap;
+    // Decoded frames waiting for their turn, as retained decoder buffers.
+    // At most mVtbBufferSize + 1 are held; the session's pool recycles them
+    // once released.
+    std::map<PtsPair, CVPixelBufferRef> mVtbBufferMap;
 
 };  // MediaVideoToolBoxVideoHelper
 
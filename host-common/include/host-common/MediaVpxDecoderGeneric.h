@@ -16,6 +16,7 @@
 
 #include "host-common/GoldfishMediaDefs.h"
 #include "host-common/MediaHostRenderer.h"
+#include "host-common/MediaHwSessionArbiter.h"
 #include "host-common/MediaSnapshotHelper.h"
 #include "host-common/MediaSnapshotState.h"
 #include "host-common/MediaVideoHelper.h"
@@ -75,6 +76,7 @@ private:
     std::unique_ptr<MediaVideoHelper> mHwVideoHelper;
     std::unique_ptr<MediaVideoHelper> mSwVideoHelper;
     std::unique_ptr<MediaVideoHelper> mVideoHelper;
+    MediaHwSessionArbiter::Session mHwSession;
 
     void fetchAllFrames();
     void createAndInitSoftVideoHelper();
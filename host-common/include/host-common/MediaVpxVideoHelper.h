@@ -14,8 +14,10 @@
 
 #pragma once
 
+#include "host-common/MediaDecodeThreadBudget.h"
 #include "host-common/MediaSnapshotState.h"
 #include "host-common/MediaVideoHelper.h"
+#include "host-common/YuvKernels.h"
 
 #include <cstdint>
 #include <list>
@@ -39,6 +41,10 @@ extern "C" {
 namespace android {
 namespace emulation {
 
+// Decodes VP8/VP9 with libvpx. With |threads| of 1 the decoder stays single
+// threaded; otherwise its thread count and row-MT come from
+// MediaDecodeThreadBudget and follow the stream resolution, re-picked at
+// each key frame that changes it.
 class MediaVpxVideoHelper : public MediaVideoHelper {
 public:
     MediaVpxVideoHelper(int type, int threads);
@@ -52,12 +58,22 @@ public:
     void flush() override;
     void deInit() override;
 
+    // Layout of the frames handed out; I420 by default. 10-bit streams get
+    // P010 instead of NV12 and 8-bit ones the reverse.
+    void setOutputLayout(YuvLayout layout) { mOutputLayout = layout; }
+
 private:
     int mType = 0;
     int mThreadCount = 1;
+    YuvLayout mOutputLayout = YuvLayout::I420;
 
     // vpx stuff
     std::unique_ptr<vpx_codec_ctx_t> mCtx;
+    MediaDecodeThreadBudget::Lease mLease;
+    MediaDecodeThreadBudget::Settings mSettings;
+    // Of the last key frame.
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
 
     // Owned by the vpx context. Needs to be initialized to nullptr on the first
     // vpx_codec_get_frame() call.
@@ -68,20 +84,13 @@ private:
     vpx_image_t* mImg = nullptr;
 
     void fetchAllFrames();
+    vpx_codec_iface_t* codecInterface() const;
+    // Replaces mCtx with one set up for |width| x |height|; 0 if unknown.
+    bool createContext(uint32_t width, uint32_t height);
+    // Resizes the context if |data| is a key frame of a new resolution.
+    void maybeResize(const uint8_t* data, size_t len);
     // helper methods
-    void copyImgToGuest(vpx_image_t* mImg, std::vector<uint8_t>& byteBuffer);
-    void copyYV12FrameToOutputBuffer(size_t outputBufferWidth,
-                                     size_t outputBufferHeight,
-                                     size_t imgWidth,
-                                     size_t imgHeight,
-                                     int32_t bpp,
-                                     uint8_t* dst,
-                                     const uint8_t* srcY,
-                                     const uint8_t* srcU,
-                                     const uint8_t* srcV,
-                                     size_t srcYStride,
-                                     size_t srcUStride,
-                                     size_t srcVStride);
+    void copyImgToGuest(vpx_image_t* mImg, MediaFrameBuffer& byteBuffer);
 
 };  // MediaVpxVideoHelper
 
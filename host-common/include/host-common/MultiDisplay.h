@@ -17,13 +17,16 @@
 #pragma once
 
 #include "aemu/base/EventNotificationSupport.h"
+#include "aemu/base/LayoutResolver.h"
+#include "aemu/base/containers/FlatMap.h"
 #include "aemu/base/files/Stream.h"
 #include "aemu/base/synchronization/Lock.h"
 #include "host-common/record_screen_agent.h"
 #include "host-common/vm_operations.h"
 #include "host-common/window_agent.h"
 
-#include <map>
+#include <atomic>
+#include <vector>
 
 namespace android {
 
@@ -67,8 +70,9 @@ public:
                  const QAndroidRecordScreenAgent* const recordAgent,
                  const QAndroidVmOperations* const vmAgent,
                  bool isGuestMode);
+    ~MultiDisplay();
     static MultiDisplay* getInstance();
-    bool isMultiDisplayEnabled() { base::AutoLock lock(mLock); return mMultiDisplay.size() > 1; }
+    bool isMultiDisplayEnabled();
     int setMultiDisplay(uint32_t id,
                          int32_t x,
                          int32_t y,
@@ -138,13 +142,38 @@ public:
     static constexpr uint32_t s_invalidIdMultiDisplay = 0xFFFFFFAB;
 
 private:
+    // What the per-frame and per-input lookups need, copied out of
+    // |mMultiDisplay| whenever it changes so that they can run without
+    // |mLock|. Never modified once published.
+    struct Layout {
+        struct Region {
+            uint32_t id;
+            // Top-left origin, the way the UI reports input.
+            uint32_t x;
+            uint32_t y;
+            uint32_t width;
+            uint32_t height;
+        };
+        size_t displayCount = 0;
+        // Displays that are shown, in id order.
+        std::vector<Region> regions;
+        // (color buffer, display id), sorted.
+        std::vector<std::pair<uint32_t, uint32_t>> colorBuffers;
+    };
+
     const QAndroidEmulatorWindowAgent* mWindowAgent;
     const QAndroidRecordScreenAgent* mRecordAgent;
     const QAndroidVmOperations* mVmAgent;
     bool mGuestMode;
     int32_t  mRotation { 0 };
-    std::map<uint32_t, MultiDisplayInfo> mMultiDisplay;
+    base::FlatMap<uint32_t, MultiDisplayInfo> mMultiDisplay;
     android::base::Lock mLock;
+    std::atomic<const Layout*> mLayout{nullptr};
+    // Requires |mLock|; remembers recent layouts across hotplugs.
+    android::base::LayoutResolver mLayoutResolver;
+
+    // Requires |mLock|; call after every change to |mMultiDisplay|.
+    void publishLayoutLocked();
 
     void performRotationLocked(int rot);
     void recomputeLayoutLocked();
@@ -161,7 +190,7 @@ private:
                          bool* enabled);
     int getNumberActiveMultiDisplaysLocked();
 
-    std::map<uint32_t, MultiDisplayInfo> parseConfig();
+    base::FlatMap<uint32_t, MultiDisplayInfo> parseConfig();
     bool hotPlugDisplayEnabled();
 };
 } // namespace android
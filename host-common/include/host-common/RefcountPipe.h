@@ -56,5 +56,8 @@ void registerRefcountPipeService();
 
 void registerOnLastRefCallback(OnLastColorBufferRef func);
 
+// Runs the callback registered above, if any, for |handle|.
+void onLastColorBufferRef(uint32_t handle);
+
 }  // namespace emulation
 }  // namespace android
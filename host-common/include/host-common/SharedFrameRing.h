@@ -0,0 +1,206 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/memory/SharedMemory.h"
+#include "host-common/DisplayDamage.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+namespace emulation {
+
+// Describes one published frame. |damage| lists what changed since the
+// previous frame; a |damageCount| of 0 means the whole frame.
+struct SharedFrameInfo {
+    uint64_t sequence = 0;
+    uint64_t timestampUs = 0;
+    uint32_t displayId = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t stride = 0;
+    // Pixel format, as agreed between producer and consumers.
+    uint32_t format = 0;
+    uint32_t size = 0;
+    uint32_t damageCount = 0;
+    uint32_t reserved = 0;
+    DamageRect damage[DamageRegion::kMaxRects];
+
+    // Fills |damage| from |region|, or marks the whole frame if it has
+    // more rects than fit.
+    void setDamage(const DamageRegion& region);
+};
+
+// A versioned ring of frame slots in one SharedMemory region, written by
+// the emulator and read by any number of consumers (screen recording,
+// streaming, screenshots) in this or other processes.
+//
+// The producer renders straight into a slot returned by beginFrame() and
+// then publish()es it, so frames are never copied on the way in. Each slot
+// is a seqlock: its lock word is odd while the producer writes it and
+// carries the frame's sequence number once published. Consumers read slot
+// memory in place and release() tells them whether the frame was
+// overwritten while they held it, so a torn frame is always detected.
+//
+// Each consumer has its own cursor in the region. The producer avoids
+// slots a consumer currently holds, so with more slots than concurrent
+// readers nobody is torn; with fewer, the oldest frame is reused anyway
+// and the reader finds out from release(). Consumers poll at their own
+// rate; there is no wakeup.
+//
+//   // Emulator side:
+//   auto ring = SharedFrameRing::create("aemu-frames-1234", 3, w * h * 4);
+//   uint8_t* pixels = ring->beginFrame();
+//   ... render into |pixels| ...
+//   ring->publish(info);
+//
+//   // Consumer side, on receiving ring->offer():
+//   auto ring = SharedFrameRing::acceptOffer(offer);
+//   auto consumer = ring->addConsumer();
+//   SharedFrameRing::Frame frame;
+//   if (consumer->acquireNext(&frame)) {
+//       encode(frame.data, frame.info);
+//       consumer->release();
+//   }
+class SharedFrameRing {
+public:
+    static constexpr uint32_t kDefaultSlotCount = 3;
+    static constexpr uint32_t kMaxSlots = 16;
+    static constexpr uint32_t kMaxConsumers = 8;
+
+    struct Frame {
+        SharedFrameInfo info;
+        const uint8_t* data = nullptr;
+    };
+
+    // A reader with its own position in the ring. Only one thread may use
+    // a consumer at a time.
+    class Consumer {
+    public:
+        ~Consumer();
+
+        // Holds the oldest frame newer than the last one acquired. Returns
+        // false if there is none.
+        bool acquireNext(Frame* frame);
+        // Holds the newest frame, skipping any older ones not yet seen.
+        bool acquireLatest(Frame* frame);
+        // Lets go of the held frame. Returns false if it was overwritten
+        // while held, in which case its contents must be discarded.
+        bool release();
+
+        // Frames published but never acquired by this consumer.
+        uint64_t dropped() const { return mDropped; }
+
+    private:
+        friend class SharedFrameRing;
+        Consumer(SharedFrameRing* ring, uint32_t index);
+
+        bool acquire(Frame* frame, bool latest);
+
+        SharedFrameRing* mRing;
+        const uint32_t mIndex;
+        uint64_t mHeldLock = 0;
+        uint64_t mDropped = 0;
+        // Whether the last frame acquired was released intact, which is
+        // what the next frame's damage is relative to.
+        bool mHavePrevious = false;
+
+        DISALLOW_COPY_AND_ASSIGN(Consumer);
+    };
+
+    ~SharedFrameRing();
+
+    // Creates region |name| with |slotCount| slots of |maxFrameBytes|
+    // each. Returns null if the arguments are out of range or the region
+    // can't be created.
+    static std::unique_ptr<SharedFrameRing> create(const std::string& name,
+                                                   uint32_t slotCount,
+                                                   uint32_t maxFrameBytes,
+                                                   mode_t mode = 0600);
+
+    // Opens a ring made by create() for reading. Returns null if it doesn't
+    // exist or doesn't match.
+    static std::unique_ptr<SharedFrameRing> open(const std::string& name,
+                                                 uint32_t slotCount,
+                                                 uint32_t maxFrameBytes);
+
+    // A single line that describes this ring to acceptOffer().
+    std::string offer() const;
+    static std::unique_ptr<SharedFrameRing> acceptOffer(
+            std::string_view offer);
+
+    // Producer side, only on the ring that create()d the region. Returns
+    // the slot to render the next frame into, |maxFrameBytes()| long and
+    // page aligned. Calling it again before publish() returns the same slot.
+    uint8_t* beginFrame();
+    // Publishes the slot from beginFrame() as frame |info|. The sequence
+    // number is assigned here and returned.
+    uint64_t publish(const SharedFrameInfo& info);
+    // Copies |data| into a slot and publishes it.
+    uint64_t publish(const void* data, const SharedFrameInfo& info);
+
+    // Registers a consumer, which starts after the newest frame. Returns
+    // null if kMaxConsumers are already registered.
+    std::unique_ptr<Consumer> addConsumer();
+
+    // Sequence number of the newest published frame, 0 if none yet.
+    uint64_t latestSequence() const;
+    // Whether the producer has gone away.
+    bool producerClosed() const;
+
+    const std::string& name() const { return mName; }
+    uint32_t slotCount() const { return mSlotCount; }
+    uint32_t maxFrameBytes() const { return mMaxFrameBytes; }
+
+private:
+    struct Header;
+    struct Slot;
+
+    SharedFrameRing(const std::string& name,
+                    uint32_t slotCount,
+                    uint32_t maxFrameBytes,
+                    bool producer);
+
+    static bool validSize(uint32_t slotCount, uint32_t maxFrameBytes);
+    static size_t slotStride(uint32_t maxFrameBytes);
+    static size_t dataOffset();
+    static size_t regionSize(uint32_t slotCount, uint32_t maxFrameBytes);
+    void attach();
+    uint8_t* slotData(uint32_t index) const;
+    bool slotHeld(uint64_t lock) const;
+
+    std::string mName;
+    const uint32_t mSlotCount;
+    const uint32_t mMaxFrameBytes;
+    const bool mProducer;
+    base::SharedMemory mMemory;
+    Header* mHeader = nullptr;
+    Slot* mSlots = nullptr;
+    // Producer only: the slot being written, or -1.
+    int mWriting = -1;
+    uint32_t mNextSlot = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(SharedFrameRing);
+};
+
+}  // namespace emulation
+}  // namespace android
@@ -0,0 +1,102 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/files/Stream.h"
+#include "aemu/base/synchronization/Lock.h"
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace android {
+
+// Saves and loads the state of many devices, running the ones that don't
+// depend on each other in parallel, so that pausing the VM for a snapshot
+// takes about as long as the slowest device rather than the sum of all of
+// them.
+//
+// Each device registers its save and load functions and the names of the
+// devices that must be saved, and loaded, before it. Every device writes
+// to its own stream; save() then writes an indexed container:
+//
+//   <be32 kMagic> <be32 kVersion> <be32 count>
+//   count * (<string name> <be64 size>)
+//   the sections, in the same order
+//
+// so load() can hand each device exactly its own bytes, skip sections no
+// registered device claims, and run independent loads in parallel too.
+//
+// Devices that must run on the calling thread, e.g. because they touch
+// state only the VM thread may, set |concurrent| to false; they still run
+// in dependency order, interleaved with the parallel ones.
+class SnapshotGraph {
+public:
+    static constexpr uint32_t kMagic = 0x47504e53;  // 'SNPG'
+    static constexpr uint32_t kVersion = 1;
+
+    using SaveFunction = std::function<void(base::Stream*)>;
+    using LoadFunction = std::function<void(base::Stream*)>;
+
+    struct Device {
+        std::string name;
+        SaveFunction save;
+        LoadFunction load;
+        std::vector<std::string> dependsOn;
+        bool concurrent = true;
+    };
+
+    struct Timing {
+        std::string name;
+        uint64_t durationUs;
+    };
+
+    // Returns false if a device with that name is already registered.
+    bool add(Device device);
+    bool remove(const std::string& name);
+
+    // Saves every registered device to |stream| using up to |threads|
+    // threads, or one per core if 0. Dependencies on devices that aren't
+    // registered count as met. Returns false, writing nothing, if the
+    // dependencies are circular.
+    bool save(base::Stream* stream, int threads = 0);
+
+    // Loads what save() wrote. A registered device without a section in
+    // |stream| is not called, and dependencies on it count as met. Returns
+    // false if |stream| is not a container or the dependencies are circular.
+    bool load(base::Stream* stream, int threads = 0);
+
+    // How long each device took in the last save() or load(), in
+    // registration order, and how long the whole run took.
+    std::vector<Timing> lastTimings() const;
+    uint64_t lastTotalUs() const;
+
+private:
+    // Runs |fn| for each index in |active| with all its active
+    // dependencies done first.
+    bool run(const std::vector<bool>& active,
+             int threads,
+             const std::function<void(size_t)>& fn);
+
+    mutable base::Lock mLock;
+    std::vector<Device> mDevices;
+    std::vector<uint64_t> mLastUs;
+    uint64_t mLastTotalUs = 0;
+};
+
+}  // namespace android
@@ -0,0 +1,44 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+namespace emulation {
+
+// Searches Annex B bitstreams (H.264, HEVC) for the 00 00 01 that starts
+// every NALU, a vector at a time. The payload between start codes is
+// emulation-prevented, so the whole packet has to be looked at once per
+// parse; this makes that pass cheap on large 4K packets.
+struct StartCodeScanner {
+    // Returns the first 00 00 01 in the |size| bytes at |data|, or nullptr.
+    // A four byte start code is found at its second byte.
+    const uint8_t* (*find)(const uint8_t* data, size_t size);
+    const char* name;
+
+    // The fastest scanner this CPU supports, picked on first use.
+    static const StartCodeScanner& get();
+    // A plain C++ loop, for comparison.
+    static const StartCodeScanner& scalar();
+};
+
+inline const uint8_t* findStartCode(const uint8_t* data, size_t size) {
+    return StartCodeScanner::get().find(data, size);
+}
+
+}  // namespace emulation
+}  // namespace android
@@ -0,0 +1,88 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/synchronization/Lock.h"
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace android {
+
+class VmLock;
+
+// Runs the emulator's startup initializers in dependency order, the ones
+// that don't depend on each other in parallel, so that startup takes about
+// as long as its longest chain rather than the sum of all the stages.
+//
+//     StartupGraph graph;
+//     addHostCommonStartupStages(&graph, vmLock);
+//     graph.add({"address-space", [] { ... }, {"hostmem-id-mapping"}});
+//     graph.run();
+//
+// Stages that must run on the calling thread, e.g. because they register
+// with the main loop, set |concurrent| to false. Anything too slow for the
+// critical path, such as probing a driver library, should instead start in
+// the background from its stage and be waited for on first use.
+class StartupGraph {
+public:
+    struct Stage {
+        std::string name;
+        std::function<void()> init;
+        std::vector<std::string> dependsOn;
+        bool concurrent = true;
+    };
+
+    struct Timing {
+        std::string name;
+        uint64_t durationUs;
+    };
+
+    // Returns false if a stage with that name is already added.
+    bool add(Stage stage);
+
+    // Runs every stage added since the last run() using up to |threads|
+    // threads, or one per core if 0. Dependencies on stages that aren't
+    // added, or already ran, count as met. Returns false, running nothing,
+    // if the dependencies are circular.
+    bool run(int threads = 0);
+
+    // How long each stage of the last run() took, in the order they were
+    // added, and how long the whole run took.
+    std::vector<Timing> lastTimings() const;
+    uint64_t lastTotalUs() const;
+
+private:
+    mutable base::Lock mLock;
+    std::vector<Stage> mStages;
+    std::vector<Timing> mLastTimings;
+    uint64_t mLastTotalUs = 0;
+};
+
+// Adds the stages for the host-common subsystems that need no arguments
+// from the embedder beyond |vmLock|:
+//
+//   android-pipe         AndroidPipe::initThreading, on the calling thread
+//   goldfish-sync        GoldfishSyncCommandQueue::initThreading, likewise
+//   hostmem-id-mapping   creates the HostmemIdMapping singleton
+//
+// Media plugins add their own, e.g. MediaCudaDriverHelper::addStartupStage().
+void addHostCommonStartupStages(StartupGraph* graph, VmLock* vmLock);
+
+}  // namespace android
@@ -0,0 +1,96 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "host-common/VmLock.h"
+
+#include <atomic>
+#include <functional>
+
+#include <stddef.h>
+
+namespace android {
+
+// Collects device callbacks from any number of subsystems and runs them
+// together under a single VM lock acquisition, instead of each subsystem
+// taking the lock on its own.
+//
+// run() performs a callback right away if the calling thread already
+// holds the VM lock. Otherwise it goes on a lock-free list, and the first
+// callback after a drain arranges the next drain:
+//
+// - If the glue installed a kick with setKick(), that is called, and the
+//   glue calls drain() from a thread holding the VM lock, typically once
+//   per vCPU exit or main-loop iteration.
+// - Without a kick the queuing thread takes the VM lock itself and
+//   drains, so whatever other threads queued in the meantime runs in the
+//   same acquisition.
+//
+// Callbacks run in the order they were queued. They may call run()
+// themselves; since the lock is held, those run immediately.
+class VmLockBatch {
+public:
+    using Callback = std::function<void()>;
+
+    VmLockBatch() = default;
+    ~VmLockBatch();
+
+    // The process-wide batch.
+    static VmLockBatch& get();
+
+    // The lock to check and take; VmLock::get() by default.
+    void setVmLock(VmLock* vmLock) { mVmLock = vmLock; }
+    // |kick| is called, from the queuing thread, whenever the batch goes
+    // from empty to non-empty. Pass nullptr to drain on the queuing thread.
+    // Must be set before callbacks are queued.
+    void setKick(Callback kick);
+
+    void run(Callback callback);
+
+    // Runs everything queued so far. The caller must hold the VM lock.
+    // Returns the number of callbacks run.
+    size_t drain();
+
+    // Callbacks run by drain() so far, and the number of drains that ran
+    // at least one, for judging how well calls are being batched.
+    uint64_t callbacksRun() const {
+        return mCallbacksRun.load(std::memory_order_relaxed);
+    }
+    uint64_t batchesRun() const {
+        return mBatchesRun.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Node {
+        Callback callback;
+        Node* next;
+    };
+
+    VmLock* vmLock() const { return mVmLock ? mVmLock : VmLock::get(); }
+
+    VmLock* mVmLock = nullptr;
+    Callback mKick;
+    // Producers push here without locking; newest first.
+    std::atomic<Node*> mHead{nullptr};
+    std::atomic<bool> mArmed{false};
+    std::atomic<uint64_t> mCallbacksRun{0};
+    std::atomic<uint64_t> mBatchesRun{0};
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(VmLockBatch);
+};
+
+}  // namespace android
@@ -14,9 +14,13 @@
 
 #pragma once
 
+#include "host-common/YuvKernels.h"
+
 namespace android {
 namespace emulation {
 
+// Converts the chroma of a frame in place between I420 and NV12. T is
+// uint8_t, or uint16_t for 10-bit formats.
 template <typename T>
 class YuvConverter {
 public:
@@ -29,21 +33,12 @@ public:
             nPitch = nWidth;
         }
         T* puv = pFrame + nPitch * nHeight;
-        if (nPitch == nWidth) {
-            memcpy(pQuad, puv, nWidth * nHeight / 4 * sizeof(T));
-        } else {
-            for (int i = 0; i < nHeight / 2; i++) {
-                memcpy(pQuad + nWidth / 2 * i, puv + nPitch / 2 * i,
-                       nWidth / 2 * sizeof(T));
-            }
-        }
+        yuvCopyPlane(puv, nPitch / 2 * sizeof(T), pQuad,
+                     nWidth / 2 * sizeof(T), nWidth / 2 * sizeof(T),
+                     nHeight / 2);
         T* pv = puv + (nPitch / 2) * (nHeight / 2);
-        for (int y = 0; y < nHeight / 2; y++) {
-            for (int x = 0; x < nWidth / 2; x++) {
-                puv[y * nPitch + x * 2] = pQuad[y * nWidth / 2 + x];
-                puv[y * nPitch + x * 2 + 1] = pv[y * nPitch / 2 + x];
-            }
-        }
+        yuvInterleaveUV(pQuad, nWidth / 2, pv, nPitch / 2, puv, nPitch,
+                        nWidth / 2, nHeight / 2);
     }
     void UVInterleavedToPlanar(T* pFrame, int nPitch = 0) {
         if (nPitch == 0) {
@@ -51,20 +46,11 @@ public:
         }
         T *puv = pFrame + nPitch * nHeight, *pu = puv,
           *pv = puv + nPitch * nHeight / 4;
-        for (int y = 0; y < nHeight / 2; y++) {
-            for (int x = 0; x < nWidth / 2; x++) {
-                pu[y * nPitch / 2 + x] = puv[y * nPitch + x * 2];
-                pQuad[y * nWidth / 2 + x] = puv[y * nPitch + x * 2 + 1];
-            }
-        }
-        if (nPitch == nWidth) {
-            memcpy(pv, pQuad, nWidth * nHeight / 4 * sizeof(T));
-        } else {
-            for (int i = 0; i < nHeight / 2; i++) {
-                memcpy(pv + nPitch / 2 * i, pQuad + nWidth / 2 * i,
-                       nWidth / 2 * sizeof(T));
-            }
-        }
+        yuvDeinterleaveUV(puv, nPitch, pu, nPitch / 2, pQuad, nWidth / 2,
+                          nWidth / 2, nHeight / 2);
+        yuvCopyPlane(pQuad, nWidth / 2 * sizeof(T), pv,
+                     nPitch / 2 * sizeof(T), nWidth / 2 * sizeof(T),
+                     nHeight / 2);
     }
 
 private:
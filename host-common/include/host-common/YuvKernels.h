@@ -0,0 +1,137 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+namespace emulation {
+
+// Chroma plane kernels for NV12 <-> I420/YV12, in 8-bit and 16-bit (10-bit
+// in 16-bit containers) flavors. |width| and |height| are in chroma samples,
+// strides in elements. Rows are processed top to bottom and every chunk is
+// read before it is written, so they can work in place the way YuvConverter
+// does, with the destination at or before the source.
+struct YuvKernels {
+    // Splits interleaved UV into separate U and V planes.
+    void (*deinterleaveUV8)(const uint8_t* uv, int uvStride,
+                            uint8_t* u, int uStride,
+                            uint8_t* v, int vStride,
+                            int width, int height);
+    void (*deinterleaveUV16)(const uint16_t* uv, int uvStride,
+                             uint16_t* u, int uStride,
+                             uint16_t* v, int vStride,
+                             int width, int height);
+    // Merges separate U and V planes into interleaved UV.
+    void (*interleaveUV8)(const uint8_t* u, int uStride,
+                          const uint8_t* v, int vStride,
+                          uint8_t* uv, int uvStride,
+                          int width, int height);
+    void (*interleaveUV16)(const uint16_t* u, int uStride,
+                           const uint16_t* v, int vStride,
+                           uint16_t* uv, int uvStride,
+                           int width, int height);
+    // Shifts 16-bit samples left by |shift| bits, e.g. from the low bits
+    // libvpx uses to the high bits P010 uses.
+    void (*shiftLeft16)(const uint16_t* src, int srcStride,
+                        uint16_t* dst, int dstStride,
+                        int width, int height, int shift);
+    // interleaveUV16, shifting each sample like shiftLeft16.
+    void (*interleaveShiftUV16)(const uint16_t* u, int uStride,
+                                const uint16_t* v, int vStride,
+                                uint16_t* uv, int uvStride,
+                                int width, int height, int shift);
+    const char* name;
+
+    // The fastest kernels this CPU supports, picked on first use.
+    static const YuvKernels& get();
+    // Plain C++ loops, for comparison.
+    static const YuvKernels& scalar();
+};
+
+// Copies |height| rows of |widthBytes| bytes between strided planes, with a
+// single memcpy when both are contiguous. memcpy is already vectorized, so
+// this needs no kernels of its own.
+void yuvCopyPlane(const void* src, size_t srcStride,
+                  void* dst, size_t dstStride,
+                  size_t widthBytes, int height);
+
+// Packed frame layouts, each with chroma planes of width/2 x height/2.
+enum class YuvLayout {
+    I420,  // Y, U, V
+    YV12,  // Y, V, U
+    NV12,  // Y, interleaved UV; 8-bit only
+    P010,  // Y, interleaved UV; 16-bit samples with the value in the high bits
+};
+
+// A decoded picture in separate planes. Strides are in bytes; 16-bit samples
+// keep their |bitDepth| bits in the low bits, the way libvpx and FFmpeg
+// return them.
+struct YuvPlanes {
+    const void* y;
+    const void* u;
+    const void* v;
+    size_t yStride;
+    size_t uStride;
+    size_t vStride;
+    int bytesPerSample = 1;
+    int bitDepth = 8;
+};
+
+// Bytes yuvPackFrame() writes for a source of |bytesPerSample|.
+size_t yuvFrameSize(YuvLayout layout, int width, int height,
+                    int bytesPerSample = 1);
+
+// Writes |src| to |dst| in |layout|. I420 and YV12 keep the sample size;
+// NV12 needs 8-bit samples and P010 16-bit ones. Returns false for other
+// combinations.
+bool yuvPackFrame(const YuvPlanes& src, int width, int height,
+                  YuvLayout layout, uint8_t* dst);
+
+inline void yuvDeinterleaveUV(const uint8_t* uv, int uvStride,
+                              uint8_t* u, int uStride,
+                              uint8_t* v, int vStride,
+                              int width, int height) {
+    YuvKernels::get().deinterleaveUV8(uv, uvStride, u, uStride, v, vStride,
+                                      width, height);
+}
+
+inline void yuvDeinterleaveUV(const uint16_t* uv, int uvStride,
+                              uint16_t* u, int uStride,
+                              uint16_t* v, int vStride,
+                              int width, int height) {
+    YuvKernels::get().deinterleaveUV16(uv, uvStride, u, uStride, v, vStride,
+                                       width, height);
+}
+
+inline void yuvInterleaveUV(const uint8_t* u, int uStride,
+                            const uint8_t* v, int vStride,
+                            uint8_t* uv, int uvStride,
+                            int width, int height) {
+    YuvKernels::get().interleaveUV8(u, uStride, v, vStride, uv, uvStride,
+                                    width, height);
+}
+
+inline void yuvInterleaveUV(const uint16_t* u, int uStride,
+                            const uint16_t* v, int vStride,
+                            uint16_t* uv, int uvStride,
+                            int width, int height) {
+    YuvKernels::get().interleaveUV16(u, uStride, v, vStride, uv, uvStride,
+                                     width, height);
+}
+
+}  // namespace emulation
+}  // namespace android
@@ -41,12 +41,17 @@ typedef void (*address_space_device_ping_t)(uint32_t handle);
 typedef int (*address_space_device_add_memory_mapping_t)(uint64_t gpa, void *ptr, uint64_t size);
 typedef int (*address_space_device_remove_memory_mapping_t)(uint64_t gpa, void *ptr, uint64_t size);
 typedef void* (*address_space_device_get_host_ptr_t)(uint64_t gpa);
+// Like get_host_ptr, also returning the whole mapping that holds |gpa|.
+typedef void* (*address_space_device_get_host_range_t)(uint64_t gpa, uint64_t* range_gpa, uint64_t* range_size);
 typedef void* (*address_space_device_handle_to_context_t)(uint32_t handle);
 typedef void (*address_space_device_clear_t)(void);
 // virtio-gpu-next
 typedef uint64_t (*address_space_device_hostmem_register_t)(const struct MemEntry *entry);
 typedef void (*address_space_device_hostmem_unregister_t)(uint64_t id);
 typedef void (*address_space_device_ping_at_hva_t)(uint32_t handle, void* hva);
+// batched pings: |gpa| / |hva| is an AddressSpaceDevicePingRing
+typedef void (*address_space_device_ping_batch_t)(uint32_t handle, uint64_t gpa);
+typedef void (*address_space_device_ping_batch_at_hva_t)(uint32_t handle, void* hva);
 // deallocation callbacks
 typedef void (*address_space_device_deallocation_callback_t)(void* context, uint64_t gpa);
 typedef void (*address_space_device_register_deallocation_callback_t)(void* context, uint64_t gpa, address_space_device_deallocation_callback_t);
@@ -70,6 +75,9 @@ struct address_space_device_control_ops {
     address_space_device_run_deallocation_callbacks_t run_deallocation_callbacks;
     address_space_device_control_get_hw_funcs_t control_get_hw_funcs;
     address_space_device_create_instance_t create_instance;
+    address_space_device_ping_batch_t ping_batch;
+    address_space_device_ping_batch_at_hva_t ping_batch_at_hva;
+    address_space_device_get_host_range_t get_host_range;
 };
 
 struct address_space_device_control_ops*
@@ -78,6 +86,11 @@ get_address_space_device_control_ops(void);
 struct QAndroidVmOperations;
 void address_space_set_vm_operations(const QAndroidVmOperations* vmops);
 
+/* Translations from guest physical addresses are cached per thread. The VMM
+ * calls this whenever its guest memory map changes, so that no cache hands
+ * out a stale host address; add/remove_memory_mapping do it themselves. */
+void address_space_invalidate_translations(void);
+
 struct AddressSpaceHwFuncs {
     /* Called by the host to reserve a shared region. Guest users can then
      * suballocate into this region. This saves us a lot of KVM slots.
@@ -49,5 +49,28 @@ struct AddressSpaceDeviceLoadResources {
 int goldfish_address_space_memory_state_set_load_resources(
     AddressSpaceDeviceLoadResources resources);
 
+// Graphics and media contexts are loaded as their saved bytes only, and
+// restored on the first ping on their handle or by a background thread
+// started by the load, whichever comes first. A context that fails to
+// restore fails its pings instead of the whole load.
+enum class AddressSpaceContextRestore {
+    // Restored during the load, created since, or unknown.
+    Immediate,
+    Pending,
+    Restored,
+    Failed,
+};
+
+AddressSpaceContextRestore goldfish_address_space_context_restore_state(
+    uint32_t handle);
+
+// Restores every context still pending from the last load now. Returns how
+// many failed.
+int goldfish_address_space_memory_state_finish_restore();
+
+// With |enabled| false, loads restore every context before returning and
+// fail on the first that can't be. On by default.
+void goldfish_address_space_memory_state_set_lazy_restore(bool enabled);
+
 }  // namespace emulation
 }  // namespace android
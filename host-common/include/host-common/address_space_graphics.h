@@ -18,8 +18,11 @@
 #include <vector>
 
 #include "AddressSpaceService.h"
+#include "GpaTranslationCache.h"
+#include "GuestTrafficStats.h"
 #include "address_space_device.h"
 #include "address_space_device.hpp"
+#include "address_space_graphics_flush_tuner.h"
 #include "address_space_graphics_types.h"
 #include "aemu/base/ring_buffer.h"
 #include "aemu/base/synchronization/MessageChannel.h"
@@ -90,6 +93,16 @@ private:
 
     // For ConsumerCallbacks
     int onUnavailableRead();
+    char* getXferPtr(uint64_t physAddr);
+
+    FlushTuner::Options flushTunerOptions(uint32_t initialInterval) const;
+    // Counts what the consumer read and wrote since the last call in
+    // GuestTrafficStats, and feeds the type 1 transfers to the tuner.
+    void sampleTransfers();
+    // Publishes a new flush_interval if the ring is empty.
+    void tuneFlushInterval();
+    // Starts sampling from where the rings are now.
+    void resetSampling();
 
     // Data layout
     uint32_t mVersion = 1;
@@ -117,6 +130,22 @@ private:
     std::optional<VirtioGpuInfo> mVirtioGpuInfo;
     // To save the ring config if it is cleared on hostmem map
     struct asg_ring_config mSavedConfig;
+
+    // Type 2 transfer translations, used by the consumer thread only.
+    GpaRangeCache mXferRanges;
+
+    FlushTuner mFlushTuner;
+    // How far sampleTransfers() got: to_host and to_host_large_xfer
+    // read_pos, and from_host_large_xfer write_pos.
+    uint32_t mSampledReadPos = 0;
+    uint32_t mSampledLargeReadPos = 0;
+    uint32_t mSampledFromHostPos = 0;
+    emulation::GuestTrafficStats::Source mTrafficSource = emulation::GuestTrafficStats::kOther;
+
+    // The previous ASG_CLOCK_SYNC: the guest clock before it, and the
+    // host's when it ran. Not saved, as clocks change across snapshots.
+    uint64_t mClockSyncGuestNs = 0;
+    uint64_t mClockSyncHostNs = 0;
 };
 
 }  // namespace asg
@@ -0,0 +1,93 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+namespace android {
+namespace emulation {
+namespace asg {
+
+// FlushTuner picks the flush_interval of an asg_ring_config from what the
+// host sees of the ring. Guests of commands-heavy workloads such as UI send
+// many small type 1 transfers and want a small interval, so each flush is
+// handed to the consumer quickly; texture uploads fill every step and want a
+// large one, so there are fewer transfers to process.
+//
+// The host context feeds the type 1 transfers the consumer read, the queue
+// of transfers found at each ASG_NOTIFY_AVAILABLE and the consumer's wakeups.
+// After every |samplesPerDecision| transfers the recommendation doubles or
+// halves. In fixed mode it stays at |initialInterval|.
+class FlushTuner {
+public:
+    struct Options {
+        bool adaptive = false;
+        uint32_t initialInterval = 4096;
+        // Powers of two; intervals stay within them.
+        uint32_t minInterval = 1024;
+        uint32_t maxInterval = 256 * 1024;
+        uint32_t samplesPerDecision = 256;
+    };
+
+    struct Stats {
+        uint64_t transfers = 0;
+        uint64_t bytes = 0;
+        uint64_t wakeups = 0;
+        uint64_t changes = 0;
+    };
+
+    explicit FlushTuner(Options options);
+    FlushTuner() : FlushTuner(Options()) {}
+
+    bool adaptive() const { return mOptions.adaptive; }
+
+    // A type 1 transfer of |size| bytes.
+    void onTransfer(uint32_t size);
+    // The guest notified the host with |queuedTransfers| already waiting.
+    void onNotify(uint32_t queuedTransfers);
+    // The consumer woke up after sleeping on an empty ring.
+    void onConsumerWake();
+
+    uint32_t recommended() const { return mRecommended; }
+
+    // The interval to publish in place of |current|, if any. The caller
+    // only asks while the ring is empty; the guest's next write position
+    // |guestWritePos| has to be a multiple of the new interval so that its
+    // next step stays inside the buffer.
+    std::optional<uint32_t> toPublish(uint32_t current,
+                                      uint32_t guestWritePos) const;
+
+    const Stats& stats() const { return mStats; }
+
+private:
+    void decide();
+
+    Options mOptions;
+    uint32_t mRecommended;
+    Stats mStats;
+
+    // Since the last decision.
+    uint32_t mTransfers = 0;
+    uint64_t mBytes = 0;
+    uint32_t mFullTransfers = 0;
+    uint32_t mWakeups = 0;
+    uint32_t mNotifies = 0;
+    uint64_t mQueuedTransfers = 0;
+};
+
+}  // namespace asg
+}  // namespace emulation
+}  // namespace android
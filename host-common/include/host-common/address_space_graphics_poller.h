@@ -0,0 +1,112 @@
+// Copyright 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "address_space_graphics_types.h"
+
+namespace android {
+namespace base {
+
+class MetricsLogger;
+
+}  // namespace base
+}  // namespace android
+
+namespace android {
+namespace emulation {
+namespace asg {
+
+// RingPoller services many asg_context rings from a small, fixed pool of
+// threads, instead of one consumer thread per context sleeping in
+// onUnavailableRead().
+//
+// Each ring is pinned to one polling thread. A thread repeatedly visits its
+// active rings, calling the ring's ConsumeCallback once per visit. A ring that
+// comes up empty |idlePollsBeforePark| visits in a row is parked: its
+// host_state is set to ASG_HOST_STATE_NEED_NOTIFY so that the guest pings
+// ASG_NOTIFY_AVAILABLE (forwarded here via notify()) before sending more. A
+// thread with no active rings sleeps until one of its rings is notified.
+class RingPoller {
+public:
+    struct Options {
+        // Number of polling threads. Rings are spread evenly across them.
+        size_t threadCount = 2;
+        // Consecutive empty polls after which a ring is parked.
+        uint32_t idlePollsBeforePark = 8;
+    };
+
+    // Called on a polling thread whenever the ring may have data. It should
+    // do a bounded amount of work so that the other rings on the same thread
+    // get their turn, and return the number of bytes consumed; 0 counts as an
+    // empty poll.
+    using ConsumeCallback = std::function<uint32_t()>;
+
+    using RingId = uint64_t;
+
+    struct RingStats {
+        uint64_t polls = 0;
+        uint64_t bytesConsumed = 0;
+        uint64_t parks = 0;
+        uint64_t wakeups = 0;
+        // Time from notify() of a parked ring to its next poll.
+        uint64_t totalWakeLatencyUs = 0;
+        uint64_t maxWakeLatencyUs = 0;
+        // Longest time the ring waited between polls while active.
+        uint64_t maxPollGapUs = 0;
+    };
+
+    explicit RingPoller(Options options);
+    RingPoller() : RingPoller(Options()) {}
+    ~RingPoller();
+
+    // Starts polling |context| on behalf of |consume|. The ring starts out
+    // active with host_state ASG_HOST_STATE_CAN_CONSUME.
+    RingId add(struct asg_context context, ConsumeCallback consume);
+
+    // Stops polling the ring. Waits for an in-flight ConsumeCallback to
+    // return, so it is safe to destroy the consumer afterwards. Must not be
+    // called from a ConsumeCallback.
+    void remove(RingId id);
+
+    // Wakes up a parked ring. To be called on ASG_NOTIFY_AVAILABLE.
+    void notify(RingId id);
+
+    std::optional<RingStats> getStats(RingId id) const;
+
+    // Logs the worst wake latency and poll gap across all rings since the
+    // previous report, then resets those maxima.
+    void reportMetrics(base::MetricsLogger* logger);
+
+private:
+    struct Ring;
+    struct Shard;
+
+    void pollLoop(Shard* shard);
+    Shard* shardFor(RingId id) const;
+    std::shared_ptr<Ring> findLocked(Shard* shard, RingId id) const;
+
+    const Options mOptions;
+    std::vector<std::unique_ptr<Shard>> mShards;
+    std::atomic<RingId> mNextId{1};
+};
+
+}  // namespace asg
+}  // namespace emulation
+}  // namespace android
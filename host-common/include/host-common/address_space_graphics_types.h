@@ -13,6 +13,7 @@
 // limitations under the License.
 #pragma once
 
+#include "aemu/base/InplaceFunction.h"
 #include "aemu/base/ring_buffer.h"
 
 #include <functional>
@@ -236,7 +237,10 @@ struct asg_ring_config {
     // config[0]: size of the auxiliary buffer
     uint32_t buffer_size;
 
-    // config[1]: flush interval for the auxiliary buffer
+    // config[1]: flush interval for the auxiliary buffer. With
+    // hw.gltransport.asg.adaptiveWriteStep the host may change it while the
+    // ring is empty and guest_write_pos is a multiple of the new value;
+    // guests pick it up at their next step.
     uint32_t flush_interval;
 
     // the position of the interval in the auxiliary buffer
@@ -283,17 +287,19 @@ namespace asg {
 //
 // The consumer type is fixed at startup. The interface is as follows:
 
-// Called by the consumer, implemented in AddressSpaceGraphicsContext:
+// Called by the consumer, implemented in AddressSpaceGraphicsContext. These
+// run for every ring read, so they never allocate or go through more than
+// one indirect call:
 //
 // Called when the consumer doesn't find anything to
 // read in to_host. Will make the consumer sleep
 // until another Ping(NotifyAvailable).
 using OnUnavailableReadCallback =
-    std::function<int()>;
+    base::InplaceFunction<int()>;
 
 // Unpacks a type 2 transfer into host pointer and size.
 using GetPtrCallback =
-    std::function<char*(uint64_t)>;
+    base::InplaceFunction<char*(uint64_t)>;
 
 struct ConsumerCallbacks {
     OnUnavailableReadCallback onUnavailableRead;
@@ -376,6 +382,16 @@ enum asg_command {
 
     // Retrieve the config.
     ASG_GET_CONFIG = 4,
+
+    // Ping(clock_sync): Aligns guest trace timestamps with the host's.
+    // The guest sends these now and then, reading its clock right before
+    // each one and right after it returns:
+    // phys_addr (in): the guest clock right before this ping
+    // size (in): the guest clock right after the previous clock_sync ping
+    // returned, or 0
+    // The host reads its trace clock on each one, so the previous ping
+    // makes a complete sample for base::addGuestClockSample().
+    ASG_CLOCK_SYNC = 5,
 };
 
 } // extern "C"
@@ -16,10 +16,12 @@
 #include "host-common/AddressSpaceService.h"
 #include "host-common/address_space_device.h"
 #include "host-common/GoldfishMediaDefs.h"
+#include "host-common/MediaDecodeScheduler.h"
 #include "host-common/MediaVpxDecoder.h"
 #include "host-common/MediaH264Decoder.h"
 #include "host-common/MediaHevcDecoder.h"
 
+#include <optional>
 #include <unordered_map>
 
 namespace android {
@@ -36,7 +38,15 @@ public:
  void save(base::Stream* stream) const override;
  bool load(base::Stream* stream) override;
 
+ // Each slot of the context's memory is one decoder instance, and runs as
+ // its own stream on MediaDecodeScheduler. The embedder can boost the ones
+ // currently shown.
+ void setStreamPriority(uint64_t slot, MediaDecodeScheduler::Priority priority);
+ std::optional<MediaDecodeScheduler::StreamStats> getStreamStats(
+         uint64_t slot) const;
+
 private:
+    MediaDecodeScheduler::StreamId streamForSlot(uint64_t slot);
     void allocatePages(uint64_t phys_addr, int num_pages);
     void deallocatePages(uint64_t phys_addr, int num_pages);
     void handleMediaRequest(AddressSpaceDevicePingInfo *info);
@@ -60,6 +70,9 @@ private:
     void* mHostBuffer = nullptr;
     const address_space_device_control_ops* mControlOps = 0;
     uint64_t mGuestAddr = 0;
+
+    mutable base::Lock mStreamsLock;
+    std::unordered_map<uint64_t, MediaDecodeScheduler::StreamId> mStreams;  // by slot
 };
 
 }  // namespace emulation
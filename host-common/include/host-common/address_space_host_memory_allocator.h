@@ -16,7 +16,9 @@
 #include "host-common/AddressSpaceService.h"
 #include "host-common/address_space_device.h"
 
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 namespace android {
 namespace emulation {
@@ -44,13 +46,46 @@ public:
                                 const AddressSpaceHwFuncs* hw);
     static void globalStateClear();
 
+    // Requests up to kMaxSlabSlotSize are served from slots carved out of
+    // kSlabSize host buffers, one set of slabs per power-of-two slot size,
+    // instead of a host allocation each. The guest picks the physical
+    // address, so every request still gets its own memory mapping.
+    static constexpr uint64_t kSlabSize = 1024 * 1024;
+    static constexpr uint64_t kMaxSlabSlotSize = 64 * 1024;
+
+    struct SlabStats {
+        uint32_t slabs = 0;
+        uint64_t reservedBytes = 0;  // in slabs
+        uint64_t usedBytes = 0;      // in handed out slots
+    };
+    SlabStats slabStats() const;
+
 private:
+    struct Slab {
+        void* bits = nullptr;
+        uint32_t slotSize = 0;
+        uint32_t slotCount = 0;
+        std::vector<uint32_t> freeSlots;
+    };
+
+    struct Allocation {
+        void* ptr = nullptr;
+        size_t size = 0;
+        Slab* slab = nullptr;  // null if allocated on its own
+    };
+
+    static constexpr int kSlabClasses = 5;  // 4 KiB .. 64 KiB slots
+
     uint64_t allocate(AddressSpaceDevicePingInfo *info);
     uint64_t unallocate(AddressSpaceDevicePingInfo *info);
     void *allocate_impl(uint64_t phys_addr, uint64_t size);
     void clear();
 
-    std::unordered_map<uint64_t, std::pair<void *, size_t>> m_paddr2ptr;
+    void* hostAlloc(uint64_t size, Slab** slab);
+    void hostFree(const Allocation& allocation);
+
+    std::unordered_map<uint64_t, Allocation> m_paddr2ptr;
+    std::vector<std::unique_ptr<Slab>> m_slabs[kSlabClasses];
     const address_space_device_control_ops *m_ops;  // do not save/load
     const AddressSpaceHwFuncs* m_hw;
 };
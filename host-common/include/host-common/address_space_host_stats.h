@@ -0,0 +1,117 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "host-common/AddressSpaceService.h"
+#include "host-common/address_space_device.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace android {
+namespace emulation {
+
+// Values in the host stats page; the index of each in
+// AddressSpaceHostStatsPage::values. Part of the guest ABI: only append.
+enum class HostStat : uint32_t {
+    // Thousandths of a core used by ASG consumer threads.
+    kAsgConsumerCpuPermille = 0,
+    // p99 of the time from a guest doorbell to its consumer waking.
+    kAsgWakeP99Us = 1,
+    // Longest wake latency and poll gap across polled rings.
+    kAsgMaxWakeLatencyUs = 2,
+    kAsgMaxPollGapUs = 3,
+    // Thousandths of a core used by media decoder threads.
+    kMediaDecoderCpuPermille = 4,
+    kMediaDecodeP99Us = 5,
+    // Decode tasks queued or running across all streams.
+    kMediaDecodeQueueDepth = 6,
+    // Thousandths of a core used by all the emulator's tagged threads.
+    kHostCpuPermille = 7,
+    // MemoryPressureLevel of the last trim, and how many trims there were.
+    kMemoryPressure = 8,
+    kMemoryTrims = 9,
+
+    kCount
+};
+
+// What the guest sees. The host writes each value with a relaxed store and
+// then bumps |updates|, so a guest that reads |updates|, the values it
+// wants and |updates| again can tell whether it raced with a write.
+// Nothing is ever read back from the page.
+struct AddressSpaceHostStatsPage {
+    static constexpr uint32_t kMagic = 0x53545348;  // "HSTS"
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kSize = 4096;
+    static constexpr uint32_t kMaxValues = (kSize - 24) / sizeof(uint64_t);
+
+    uint32_t magic;
+    uint32_t version;
+    // Values the host fills in; later versions only add to them.
+    uint32_t count;
+    uint32_t reserved;
+    std::atomic<uint64_t> updates;
+    std::atomic<uint64_t> values[kMaxValues];
+};
+
+static_assert(sizeof(AddressSpaceHostStatsPage) == AddressSpaceHostStatsPage::kSize,
+              "The stats page is one 4 KiB page");
+static_assert(static_cast<uint32_t>(HostStat::kCount) <=
+                  AddressSpaceHostStatsPage::kMaxValues,
+              "Too many host stats");
+
+// Maps a read-only page of host load figures into the guest, so graphics
+// and media drivers can see that the renderer or decoder is saturated and
+// back off, without pinging the host to ask.
+//
+// There is one page for the whole emulator; every context that maps it
+// sees the same host memory. Values come from the metrics reports (thread
+// role usage, latency summaries, ring stats and memory trims, as often as
+// those are reported) and from set() calls by subsystems that keep a
+// figure of their own.
+class AddressSpaceHostStatsContext : public AddressSpaceDeviceContext {
+public:
+    enum class HostStatsCommand {
+        // Maps the page at |phys_addr|, which must be guest-page aligned;
+        // |size| comes back as the bytes mapped.
+        Map = 1,
+        Unmap = 2,
+    };
+
+    AddressSpaceHostStatsContext(const address_space_device_control_ops* ops,
+                                 const AddressSpaceHwFuncs* hw);
+    ~AddressSpaceHostStatsContext();
+
+    void perform(AddressSpaceDevicePingInfo* info) override;
+
+    AddressSpaceDeviceType getDeviceType() const override;
+    void save(base::Stream* stream) const override;
+    bool load(base::Stream* stream) override;
+
+    static void set(HostStat stat, uint64_t value);
+    static uint64_t value(HostStat stat);
+
+private:
+    uint64_t map(uint64_t physAddr);
+    uint64_t unmap();
+    uint64_t mappedSize() const;
+
+    uint64_t m_physAddr = 0;  // 0 when not mapped
+    const address_space_device_control_ops* m_ops;  // do not save/load
+    const AddressSpaceHwFuncs* m_hw;
+};
+
+}  // namespace emulation
+}  // namespace android
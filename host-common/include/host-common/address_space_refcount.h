@@ -0,0 +1,71 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "host-common/AddressSpaceService.h"
+#include "host-common/address_space_device.h"
+
+#include <unordered_map>
+
+namespace android {
+namespace emulation {
+
+// Tracks guest references to color buffers, replacing a "refcount" pipe per
+// gralloc buffer with one address space context per guest process.
+//
+// The guest acquires a handle when it allocates or imports a buffer and
+// releases it when done. Counts are kept per context and summed across
+// all of them; when the total for a handle drops to zero the callback set
+// with registerOnLastRefCallback() runs, just as when the last refcount
+// pipe for it closes. Destroying a context, e.g. because its process died,
+// releases everything it still holds.
+//
+// The batch commands take |phys_addr| pointing to |size| 32-bit handles in
+// guest memory, so a process can queue up many releases in a shared page
+// and ring the doorbell once.
+class AddressSpaceRefcountContext : public AddressSpaceDeviceContext {
+public:
+    enum class RefcountCommand {
+        // |size| is the handle.
+        Acquire = 1,
+        Release = 2,
+        AcquireBatch = 3,
+        ReleaseBatch = 4,
+    };
+
+    AddressSpaceRefcountContext(const address_space_device_control_ops *ops);
+    ~AddressSpaceRefcountContext();
+
+    void perform(AddressSpaceDevicePingInfo *info) override;
+
+    AddressSpaceDeviceType getDeviceType() const override;
+    void save(base::Stream* stream) const override;
+    bool load(base::Stream* stream) override;
+
+    // The total count for |handle| across all contexts.
+    static uint32_t globalCount(uint32_t handle);
+
+private:
+    uint64_t acquire(uint32_t handle);
+    uint64_t release(uint32_t handle);
+    const uint32_t* guestHandles(const AddressSpaceDevicePingInfo *info) const;
+    void clear();
+
+    std::unordered_map<uint32_t, uint32_t> m_counts;
+    const address_space_device_control_ops *m_ops;  // do not save/load
+};
+
+}  // namespace emulation
+}  // namespace android
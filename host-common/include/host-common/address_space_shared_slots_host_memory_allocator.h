@@ -15,7 +15,11 @@
 
 #include "host-common/AddressSpaceService.h"
 #include "host-common/address_space_device.h"
+#include "aemu/base/memory/BlockMemory.h"
+#include "aemu/base/memory/MemoryPressure.h"
+#include "aemu/base/synchronization/Lock.h"
 #include <map>
+#include <set>
 #include <unordered_map>
 
 namespace android {
@@ -31,6 +35,7 @@ public:
 
     struct MemBlock {
         typedef std::map<uint32_t, uint32_t> FreeSubblocks_t;  // offset -> size
+        typedef std::set<std::pair<uint32_t, uint32_t>> FreeSizes_t;  // {size, offset}
 
         MemBlock() = default;
         MemBlock(const address_space_device_control_ops* o,
@@ -45,6 +50,18 @@ public:
         bool isAllFree() const;
         uint64_t allocate(size_t requestedSize);
         void unallocate(uint64_t phys, uint32_t subblockSize);
+        uint32_t largestFreeSubblock() const;
+
+        // Gives the pages of free subblocks back to the host with
+        // MemoryHint::DontNeed, in kBlockHugePageSize aligned pieces so huge
+        // pages are not split. The guest sees zeroes there if it touches
+        // them again. Only done for mmap()ed memory. Returns the bytes
+        // released.
+        uint64_t releaseFreeMemory();
+
+        // Keep freeSubblocks and freeSizes in sync.
+        FreeSubblocks_t::iterator insertFreeSubblock(uint32_t offset, uint32_t size);
+        void eraseFreeSubblock(FreeSubblocks_t::iterator i);
 
         static
         FreeSubblocks_t::iterator findFreeSubblock(FreeSubblocks_t* fsb, size_t sz);
@@ -67,7 +84,18 @@ public:
         uint64_t physBaseLoaded = 0;
         void* bits = nullptr;
         uint32_t bitsSize = 0;
+        base::BlockMemory memory;  // backs |bits|
         FreeSubblocks_t freeSubblocks;
+        FreeSizes_t freeSizes;  // the same subblocks as freeSubblocks, by size
+        uint32_t usedBytes = 0;
+        // When the block last became all free, 0 while it is in use.
+        uint64_t emptySinceUs = 0;
+        // Set when memory is freed, cleared by releaseFreeMemory().
+        bool freedSinceRelease = false;
+
+        // Guards freeSubblocks and freeSizes while g_blocksLock is only held
+        // for reading. Not moved or swapped with the rest of the block.
+        base::Lock lock;
 
         MemBlock(const MemBlock&) = delete;
         MemBlock& operator=(const MemBlock&) = delete;
@@ -89,10 +117,41 @@ public:
                                 const AddressSpaceHwFuncs* hw);
     static void globalStateClear();
 
+    // Occupancy of all blocks, for the StatsPage.
+    struct BlockStats {
+        uint32_t blocks = 0;
+        uint32_t emptyBlocks = 0;
+        uint64_t reservedBytes = 0;
+        uint64_t usedBytes = 0;
+        uint64_t freeBytes = 0;
+        // Free bytes outside the largest free subblock of their block, in
+        // thousandths of |freeBytes|: 0 when every block has one hole.
+        uint32_t fragmentationPermille = 0;
+    };
+    static BlockStats blockStats();
+
+    // Blocks stay around this long after they empty, so a guest that frees
+    // and reallocates doesn't churn memory mappings.
+    static constexpr uint64_t kEmptyBlockLingerUs = 10 * 1000 * 1000;
+    static constexpr uint64_t kMaintenanceIntervalUs = 1000 * 1000;
+
+    // Frees blocks that have been empty for kEmptyBlockLingerUs, except
+    // one, releases the memory of free subblocks and updates the
+    // "shared_slots.*" gauges. Unallocating runs this at most every
+    // kMaintenanceIntervalUs; an idle VMM can call it on a timer too.
+    static void runMaintenance(uint64_t nowUs);
+
+    // The memory pressure trimmer: gives back the pages of free subblocks
+    // now and, under critical pressure, has the next maintenance free every
+    // empty block. Returns the bytes given back now.
+    static uint64_t trim(base::MemoryPressureLevel level);
+
 private:
     uint64_t allocate(AddressSpaceDevicePingInfo *info);
     uint64_t unallocate(uint64_t phys);
-    void gcEmptyBlocks(int allowedEmpty);
+    // Frees the blocks empty for |lingerUs|, except |allowedEmpty| of them.
+    static void gcEmptyBlocks(int allowedEmpty, uint64_t lingerUs, uint64_t nowUs);
+    static void maybeRunMaintenance();
     void clear();
 
     uint64_t populatePhysAddr(AddressSpaceDevicePingInfo *info,
@@ -101,7 +160,8 @@ private:
                               MemBlock*);
     uint64_t unallocateLocked(uint64_t phys, int allowedEmpty);
 
-    // physAddr->{size, owner}
+    // physAddr->{size, owner}. Only touched through this context, whose calls
+    // the device serializes, so it is not guarded by the global blocks lock.
     std::unordered_map<uint64_t, std::pair<uint32_t, MemBlock*>> m_allocations;
     const address_space_device_control_ops *m_ops;  // do not save/load
     const AddressSpaceHwFuncs* m_hw;
@@ -0,0 +1,95 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "aemu/base/ring_buffer.h"
+
+#include <stdint.h>
+
+// Bulk mode for generic pipes, shared between guest and host.
+//
+// A guest that moves a lot of data through a pipe (adb push/pull, logcat)
+// can ask for a pair of rings when it connects, see
+// AndroidPipe::kBulkConnectMagic. The payload then goes through the rings,
+// in address space device memory, and the pipe only carries doorbells:
+//
+// - Guest to host: the guest writes into |to_host|, then writes anything
+//   to the pipe. The host hands what the ring holds to the pipe's
+//   onGuestSend(). PIPE_ERROR_AGAIN means some of it is still there: wait
+//   for PIPE_WAKE_WRITE and write again.
+//
+// - Host to guest: the guest reads from the pipe, at least 4 bytes. The
+//   host fills |from_host| from the pipe's onGuestRecv() and returns the
+//   number of bytes it added, le32. PIPE_ERROR_AGAIN means there was
+//   nothing to add: wait for PIPE_WAKE_READ and read again.
+//
+// A ring full of data is one doorbell, where the plain pipe protocol takes
+// a transaction per few guest pages.
+//
+// Layout, from a page aligned guest physical address:
+//
+//   page 0: struct android_pipe_bulk_header
+//   page 1: struct ring_buffer of |to_host|
+//   page 2: struct ring_buffer of |from_host|
+//   |ring_size| bytes of |to_host| data
+//   |ring_size| bytes of |from_host| data
+//
+// The guest fills in the header, with |status| ANDROID_PIPE_BULK_OFFERED,
+// before connecting. The host sets up the rings and sets |status| to
+// ANDROID_PIPE_BULK_ACCEPTED before the connect returns; if it didn't,
+// the pipe works as usual and the rings are unused.
+
+#define ANDROID_PIPE_BULK_MAGIC 0x4b4c4250  // "PBLK"
+#define ANDROID_PIPE_BULK_VERSION 1
+#define ANDROID_PIPE_BULK_PAGE_SIZE 4096
+#define ANDROID_PIPE_BULK_MIN_RING_SIZE 4096
+#define ANDROID_PIPE_BULK_MAX_RING_SIZE (16 * 1024 * 1024)
+
+enum android_pipe_bulk_status {
+    ANDROID_PIPE_BULK_OFFERED = 0,
+    ANDROID_PIPE_BULK_ACCEPTED = 1,
+};
+
+struct android_pipe_bulk_header {
+    uint32_t magic;
+    uint32_t version;
+    // Bytes of data in each direction, a power of two.
+    uint32_t ring_size;
+    // enum android_pipe_bulk_status, set by the host.
+    uint32_t status;
+};
+
+struct android_pipe_bulk_rings {
+    struct android_pipe_bulk_header* header;
+    struct ring_buffer_with_view to_host;
+    struct ring_buffer_with_view from_host;
+};
+
+static inline uint64_t android_pipe_bulk_storage_size(uint32_t ring_size) {
+    return 3 * ANDROID_PIPE_BULK_PAGE_SIZE + 2 * (uint64_t)ring_size;
+}
+
+// Views |storage|, which holds the layout above, without changing it.
+static inline struct android_pipe_bulk_rings android_pipe_bulk_rings_create(
+        char* storage, uint32_t ring_size) {
+    struct android_pipe_bulk_rings rings;
+    rings.header = (struct android_pipe_bulk_header*)storage;
+    rings.to_host.ring = (struct ring_buffer*)(storage + ANDROID_PIPE_BULK_PAGE_SIZE);
+    rings.from_host.ring = (struct ring_buffer*)(storage + 2 * ANDROID_PIPE_BULK_PAGE_SIZE);
+    char* data = storage + 3 * ANDROID_PIPE_BULK_PAGE_SIZE;
+    ring_buffer_init_view_only(&rings.to_host.view, (uint8_t*)data, ring_size);
+    ring_buffer_init_view_only(&rings.from_host.view, (uint8_t*)data + ring_size, ring_size);
+    return rings;
+}
@@ -137,6 +137,29 @@ ANDROID_PIPE_DEVICE_EXPORT void android_pipe_guest_post_save(Stream* file);
 ANDROID_PIPE_DEVICE_EXPORT void android_pipe_guest_save(
     void* internal_pipe, Stream* file);
 
+// Save the state of |count| Android pipes to |file|. The result is the same
+// as calling |before_each(opaque, i, file)| and then
+// android_pipe_guest_save(internal_pipes[i], file) for each pipe in order,
+// but pipes whose service allows it are serialized in parallel first.
+// |before_each| may be NULL.
+ANDROID_PIPE_DEVICE_EXPORT void android_pipe_guest_save_all(
+    void* const* internal_pipes, int count, Stream* file,
+    void (*before_each)(void* opaque, int index, Stream* file), void* opaque);
+
+// Like android_pipe_guest_save_all(), in two steps so the VM can resume in
+// between. The first only captures state: pipes that support it (see
+// AndroidPipe::onSaveDeferred()) hand over immutable views of their data,
+// the others, and |before_each|, are serialized into memory right away.
+// A background thread then serializes the views. The second step waits
+// for that, writes to |file| exactly what android_pipe_guest_save_all()
+// would have, and frees |job|; it may be called on any thread.
+typedef struct AndroidPipeSaveJob AndroidPipeSaveJob;
+ANDROID_PIPE_DEVICE_EXPORT AndroidPipeSaveJob* android_pipe_guest_save_all_begin(
+    void* const* internal_pipes, int count,
+    void (*before_each)(void* opaque, int index, Stream* file), void* opaque);
+ANDROID_PIPE_DEVICE_EXPORT void android_pipe_guest_save_all_end(
+    AndroidPipeSaveJob* job, Stream* file);
+
 // Load the state of an Android pipe from a stream. |file| is the input stream,
 // |hwpipe| is the hardware-side pipe descriptor. On success, return a new
 // internal pipe instance (similar to one returned by
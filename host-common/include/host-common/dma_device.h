@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 #ifdef _MSC_VER
@@ -32,6 +33,9 @@
 // accessing Goldfish DMA regions at a specified offset.
 typedef void* (*emugl_dma_get_host_addr_t)(uint64_t);
 typedef void (*emugl_dma_unlock_t)(uint64_t);
+// Batch variants: resolve or unlock |count| regions with one lookup.
+typedef void (*emugl_dma_get_host_addrs_t)(const uint64_t*, size_t, void**);
+typedef void (*emugl_dma_unlock_many_t)(const uint64_t*, size_t);
 
 typedef struct {
     emugl_dma_get_host_addr_t get_host_addr;
@@ -42,8 +46,13 @@ namespace emugl {
 
 EMUGL_COMMON_API extern emugl_dma_get_host_addr_t g_emugl_dma_get_host_addr;
 EMUGL_COMMON_API extern emugl_dma_unlock_t g_emugl_dma_unlock;
+// Until set, these loop over g_emugl_dma_get_host_addr / g_emugl_dma_unlock.
+EMUGL_COMMON_API extern emugl_dma_get_host_addrs_t g_emugl_dma_get_host_addrs;
+EMUGL_COMMON_API extern emugl_dma_unlock_many_t g_emugl_dma_unlock_many;
 
 EMUGL_COMMON_API void set_emugl_dma_get_host_addr(emugl_dma_get_host_addr_t);
 EMUGL_COMMON_API void set_emugl_dma_unlock(emugl_dma_unlock_t);
+EMUGL_COMMON_API void set_emugl_dma_get_host_addrs(emugl_dma_get_host_addrs_t);
+EMUGL_COMMON_API void set_emugl_dma_unlock_many(emugl_dma_unlock_many_t);
 
 }  // namespace emugl
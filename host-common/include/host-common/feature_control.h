@@ -17,6 +17,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "aemu/base/c_header.h"
 
@@ -53,4 +54,19 @@ void feature_update_from_server();
 const char* feature_name(Feature feature);
 Feature feature_from_name(const char* name);
 
+// Goes up every time a feature changes state.
+uint64_t feature_generation();
+
+// The enabled features at one point in time, for callers that need several
+// of them to agree with each other. Stale once feature_generation() moves
+// past |generation|.
+#define FEATURE_SNAPSHOT_WORDS 2
+typedef struct {
+    uint64_t generation;
+    uint64_t bits[FEATURE_SNAPSHOT_WORDS];
+} FeatureSnapshot;
+
+void feature_get_snapshot(FeatureSnapshot* snapshot);
+bool feature_snapshot_is_enabled(const FeatureSnapshot* snapshot, Feature feature);
+
 ANDROID_END_HEADER
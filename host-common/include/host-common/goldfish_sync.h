@@ -127,6 +127,19 @@ int goldfish_sync_create_fence(uint64_t timeline, uint32_t pt);
 // Thus, this may end up changing some fence objects to signaled state.
 void goldfish_sync_timeline_inc(uint64_t timeline, uint32_t howmuch);
 
+// One timeline increment for |goldfish_sync_timeline_inc_batch|.
+typedef struct GoldfishSyncTimelineInc {
+    uint64_t timeline;
+    uint32_t howmuch;
+} GoldfishSyncTimelineInc;
+
+// |goldfish_sync_timeline_inc_batch| performs |count| timeline increments
+// as one queued batch, so the device can deliver them with one interrupt.
+// Increments of the same timeline that are still waiting for the device
+// are merged into one command.
+void goldfish_sync_timeline_inc_batch(const GoldfishSyncTimelineInc* incs,
+                                      uint32_t count);
+
 // |goldfish_sync_destroy_timeline| removes the key |timeline|
 // from the global timeline map.
 // Any fence objects whose only timeline-id-value (t, v) is such that
@@ -149,6 +162,18 @@ typedef void (*queue_device_command_t)
     (uint32_t cmd, uint64_t handle, uint32_t time_arg,
      uint64_t hostcmd_handle);
 
+// A host->guest command, as passed to |queue_device_commands_t|.
+typedef struct GoldfishSyncHostCommand {
+    uint64_t handle;
+    uint64_t hostcmd_handle;
+    uint32_t cmd;
+    uint32_t time_arg;
+} GoldfishSyncHostCommand;
+
+// Queues |count| commands and raises the interrupt once for all of them.
+typedef void (*queue_device_commands_t)
+    (const GoldfishSyncHostCommand* cmds, uint32_t count);
+
 typedef struct GoldfishSyncDeviceInterface {
     // Callback for all communications with virtual device
     queue_device_command_t doHostCommand;
@@ -156,6 +181,9 @@ typedef struct GoldfishSyncDeviceInterface {
     // Callbacks to register other callbacks for triggering
     // OpenGL waits from the guest
     void (*registerTriggerWait)(trigger_wait_fn_t);
+
+    // Optional; if null, batches go through |doHostCommand| one at a time.
+    queue_device_commands_t doHostCommands;
 } GoldfishSyncDeviceInterface;
 
 // The virtual device will call |goldfish_sync_set_hw_funcs|
@@ -307,6 +307,13 @@ HWCFG_INT(
   "For address space graphics, the max size of each guest-to-host transaction.",
   "")
 
+HWCFG_BOOL(
+  hw_gltransport_asg_adaptiveWriteStep,
+  "hw.gltransport.asg.adaptiveWriteStep",
+  "no",
+  "For address space graphics, let the host tune the write step size",
+  "Starts from writeStepSize and publishes larger steps for bulk transfers and smaller ones for small commands. Keep off for reproducible runs.")
+
 HWCFG_INT(
   hw_gltransport_asg_dataRingSize,
   "hw.gltransport.asg.dataRingSize",
@@ -0,0 +1,89 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "host-common/hw-config.h"
+#include "aemu/base/c_header.h"
+
+#include <stddef.h>
+
+ANDROID_BEGIN_HEADER
+
+/* Field types of hw-config-defs.h entries. */
+typedef enum {
+    HWCFG_TYPE_BOOL,
+    HWCFG_TYPE_INT,
+    HWCFG_TYPE_STRING,
+    HWCFG_TYPE_DOUBLE,
+    HWCFG_TYPE_DISKSIZE,
+} HwConfigType;
+
+/* Describes one hw-config-defs.h entry. */
+typedef struct HwConfigKey {
+    const char*  name;    /* config.ini key, e.g. "hw.ramSize" */
+    HwConfigType type;
+    size_t       offset;  /* of the field in AndroidHwConfig */
+} HwConfigKey;
+
+/* Returns the number of entries in hw-config-defs.h. */
+size_t androidHwConfig_keyCount(void);
+
+/* Returns the |index|-th entry, in hw-config-defs.h order, or NULL. */
+const HwConfigKey* androidHwConfig_keyAt(size_t index);
+
+/* Returns the entry for the config.ini key |name| of |length| bytes, or
+ * NULL if there is none. The lookup goes through a perfect hash table
+ * built at compile time from hw-config-defs.h, so it costs one hash and
+ * one string comparison whatever the key.
+ */
+const HwConfigKey* androidHwConfig_findKey(const char* name, size_t length);
+
+/* Parses |value| the way config.ini spells it and stores it in the field
+ * |key| of |config|. String fields are owned by |config|, as
+ * androidHwConfig_init() leaves them: the old value is freed and |value|
+ * copied. Returns 0 on success, or -1 if |value| is malformed, in which
+ * case the field is unchanged.
+ */
+int androidHwConfig_setValue(AndroidHwConfig* config,
+                             const HwConfigKey* key,
+                             const char* value);
+
+/* Applies every "key = value" line of the config.ini text |text| of
+ * |length| bytes to |config|. Comments, blank lines, unknown keys and
+ * malformed values are skipped. Returns the number of fields set.
+ */
+int androidHwConfig_parseIni(AndroidHwConfig* config,
+                             const char* text,
+                             size_t length);
+
+/* Writes |config| to |cachePath|, normally next to the AVD's config.ini
+ * |iniPath|. The image is tagged with the size, modification time and hash
+ * of |iniPath| as it is now, and with the layout of hw-config-defs.h.
+ * Returns 0 on success, -1 on failure.
+ */
+int androidHwConfig_saveCache(const AndroidHwConfig* config,
+                              const char* iniPath,
+                              const char* cachePath);
+
+/* Loads the image written by androidHwConfig_saveCache() into |config|,
+ * unless |iniPath| changed since, hw-config-defs.h changed, or the image
+ * is damaged. Returns 0 on success. Returns -1 otherwise, leaving |config|
+ * unchanged; the caller then parses |iniPath| and saves a new image.
+ */
+int androidHwConfig_loadCache(AndroidHwConfig* config,
+                              const char* iniPath,
+                              const char* cachePath);
+
+ANDROID_END_HEADER
@@ -25,6 +25,25 @@ void set_gfxstream_logger(gfxstream_logger_t f);
 void set_gfxstream_enable_verbose_logs();
 void set_gfxstream_enable_log_colors();
 
+// Hands log lines to a writer thread instead of writing them on the calling
+// thread. Each thread buffers up to 64KB of lines; past that, lines are
+// dropped and counted. Fatal lines, and everything before them, are still
+// written synchronously. Disabling writes out what is still buffered.
+void set_gfxstream_enable_async_logs(bool enable);
+// Limits each call site (file, line and severity) to |burst| lines at once
+// and |linesPerSecond| after that, so a device stuck repeating an error
+// doesn't spend its time formatting and writing it. Lines over the limit
+// are dropped before they are formatted; the next line from the site that
+// goes out is preceded by "suppressed N similar messages", and flushing
+// reports the rest. Fatal lines are never limited. 0 lines per second, the
+// default, turns limiting off.
+void set_gfxstream_log_rate_limit(uint32_t burst, uint32_t linesPerSecond);
+// Writes out the buffered lines now, e.g. from a crash handler, after
+// reporting lines suppressed by the rate limit.
+void gfxstream_flush_logs();
+uint64_t get_gfxstream_dropped_log_count();
+uint64_t get_gfxstream_suppressed_log_count();
+
 // Outputs a log line using Google's standard prefix. (http://go/logging#prefix)
 //
 // Do not use this function directly. Instead, use one of the logging macros below.
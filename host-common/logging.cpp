@@ -14,22 +14,31 @@
 
 #include "logging.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <chrono>
 #include <cinttypes>
+#include <condition_variable>
 #include <cstdarg>
+#include <cstdlib>
 #include <cstring>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <vector>
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
 #endif
 
 #ifdef __linux__
 #include <sys/syscall.h>
 #include <sys/types.h>
-#include <unistd.h>
 #endif
 
 namespace {
@@ -86,6 +95,508 @@ const char* GetFileBasename(const char* file) {
     return file;
 }
 
+// Writes the standard Google logging prefix, without the trailing space.
+// See also:
+// https://github.com/google/glog/blob/9dc1107f88d3a1613d61b80040d83c1c1acbac3d/src/logging.cc#L1612-L1615
+int formatPrefix(char* prefix, size_t size, char severity, int64_t timestamp_us,
+                 const char* threadId, const char* file, unsigned int line) {
+    std::time_t timestamp_s = timestamp_us / 1000000;
+
+    // Break down the timestamp into the individual time parts
+    std::tm ts_parts = {};
+#if defined(_WIN32)
+    localtime_s(&ts_parts, &timestamp_s);
+#else
+    localtime_r(&timestamp_s, &ts_parts);
+#endif
+
+    // Get the microseconds part of the timestamp since it's not available in the tm struct
+    int64_t microseconds = timestamp_us % 1000000;
+
+    return snprintf(prefix, size, "%c%02d%02d %02d:%02d:%02d.%06" PRId64 " %7s %s:%d]", severity,
+                    ts_parts.tm_mon + 1, ts_parts.tm_mday, ts_parts.tm_hour, ts_parts.tm_min,
+                    ts_parts.tm_sec, microseconds, threadId, file, line);
+}
+
+const char* colorTagFor(char severity) {
+    // Colorize errors and warnings
+    if (severity == 'E' || severity == 'F') {
+        return "\x1B[31m";  // Red
+    } else if (severity == 'W') {
+        return "\x1B[33m";  // Yellow
+    }
+    return "";
+}
+
+constexpr const char* kColorTagReset = "\x1B[0m";
+
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+}
+
+// Asynchronous output. Each logging thread appends records to its own ring,
+// which only it writes and only the writer thread reads, so logging takes
+// no locks. The writer thread formats the prefixes and writes each batch
+// with as few writev() calls as it can. A full ring drops the record.
+constexpr size_t kLogRingBytes = 64 * 1024;
+constexpr size_t kMaxLogMessage = 2048;
+constexpr size_t kMaxLogFile = 256;
+constexpr auto kLogWriterWakeup = std::chrono::milliseconds(50);
+
+struct LogRecord {
+    int64_t timestampUs;
+    FILE* stream;
+    uint32_t line;
+    // Includes the terminating zero.
+    uint16_t fileLen;
+    // Includes the trailing newline.
+    uint16_t messageLen;
+    // 0 marks the rest of the ring as unused, when a record didn't fit.
+    char severity;
+    char threadId[kMaxThreadIdLength + 1];
+};
+
+size_t recordBytes(size_t fileLen, size_t messageLen) {
+    return (sizeof(LogRecord) + fileLen + messageLen + 7) & ~size_t(7);
+}
+
+struct LogRing {
+    // Byte counts; they only grow.
+    std::atomic<uint64_t> head{0};  // read up to, by the writer
+    std::atomic<uint64_t> tail{0};  // written up to, by the owner
+    std::atomic<bool> retired{false};
+    alignas(8) char data[kLogRingBytes];
+};
+
+std::atomic<bool> sAsyncLogs{false};
+
+class AsyncLogger {
+public:
+    static AsyncLogger& get() {
+        static AsyncLogger* sLogger = new AsyncLogger;
+        return *sLogger;
+    }
+
+    void enable() {
+        std::call_once(mStarted, [this] {
+            std::thread([this] { run(); }).detach();
+            std::atexit([] { AsyncLogger::get().flush(); });
+        });
+    }
+
+    void log(FILE* stream, char severity, const char* file, unsigned int line,
+             int64_t timestamp_us, const char* message, size_t messageLen) {
+        LogRing* ring = threadRing();
+        // Keeps the terminating zero.
+        const size_t fileLen = std::min<size_t>(strlen(file), kMaxLogFile - 1) + 1;
+        messageLen = std::min(messageLen, kMaxLogMessage - 1);
+        const size_t bytes = recordBytes(fileLen, messageLen + 1);
+
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        const size_t offset = tail & (kLogRingBytes - 1);
+        const size_t skip = kLogRingBytes - offset < bytes ? kLogRingBytes - offset : 0;
+        if (tail + skip + bytes - head > kLogRingBytes) {
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        LogRecord record = {};
+        if (skip >= sizeof(LogRecord)) {
+            memcpy(ring->data + offset, &record, sizeof(record));
+        }
+        tail += skip;
+
+        record.timestampUs = timestamp_us;
+        record.stream = stream;
+        record.line = line;
+        record.fileLen = fileLen;
+        record.messageLen = messageLen + 1;
+        record.severity = severity;
+        strncpy(record.threadId, getCachedThreadID(), kMaxThreadIdLength);
+
+        char* out = ring->data + (tail & (kLogRingBytes - 1));
+        memcpy(out, &record, sizeof(record));
+        memcpy(out + sizeof(record), file, fileLen - 1);
+        out[sizeof(record) + fileLen - 1] = 0;
+        memcpy(out + sizeof(record) + fileLen, message, messageLen);
+        out[sizeof(record) + fileLen + messageLen] = '\n';
+        ring->tail.store(tail + bytes, std::memory_order_release);
+
+        if (!mPending.exchange(true, std::memory_order_acq_rel)) {
+            mWakeup.notify_one();
+        }
+    }
+
+    // Writes out everything logged so far, on the calling thread.
+    void flush() {
+        std::lock_guard<std::mutex> drainLock(mDrainLock);
+        drain();
+    }
+
+    uint64_t dropped() const { return mDropped.load(std::memory_order_relaxed); }
+
+private:
+    struct ThreadRing {
+        ~ThreadRing() {
+            if (ring) {
+                ring->retired.store(true, std::memory_order_release);
+            }
+        }
+        LogRing* ring = nullptr;
+    };
+
+    struct Pending {
+        LogRecord record;
+        const char* file;
+        const char* message;
+    };
+
+    LogRing* threadRing() {
+        static thread_local ThreadRing tThreadRing;
+        if (!tThreadRing.ring) {
+            tThreadRing.ring = new LogRing;
+            std::lock_guard<std::mutex> lock(mRingsLock);
+            mRings.push_back(tThreadRing.ring);
+        }
+        return tThreadRing.ring;
+    }
+
+    void run() {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mWakeLock);
+                mWakeup.wait_for(lock, kLogWriterWakeup,
+                                 [this] { return mPending.load(std::memory_order_acquire); });
+            }
+            mPending.store(false, std::memory_order_release);
+            flush();
+        }
+    }
+
+    // Needs mDrainLock.
+    void drain() {
+        mBatch.clear();
+        mEnds.clear();
+        {
+            std::lock_guard<std::mutex> lock(mRingsLock);
+            for (LogRing* ring : mRings) {
+                const uint64_t end = ring->tail.load(std::memory_order_acquire);
+                uint64_t pos = ring->head.load(std::memory_order_relaxed);
+                while (pos < end) {
+                    const size_t offset = pos & (kLogRingBytes - 1);
+                    const size_t toEnd = kLogRingBytes - offset;
+                    Pending pending;
+                    if (toEnd < sizeof(LogRecord)) {
+                        pos += toEnd;
+                        continue;
+                    }
+                    const char* in = ring->data + offset;
+                    memcpy(&pending.record, in, sizeof(LogRecord));
+                    if (pending.record.severity == 0) {
+                        pos += toEnd;
+                        continue;
+                    }
+                    pending.file = in + sizeof(LogRecord);
+                    pending.message = pending.file + pending.record.fileLen;
+                    mBatch.push_back(pending);
+                    pos += recordBytes(pending.record.fileLen, pending.record.messageLen);
+                }
+                mEnds.push_back(end);
+            }
+        }
+
+        // Lines from different threads go out in time order.
+        std::stable_sort(mBatch.begin(), mBatch.end(),
+                         [](const Pending& a, const Pending& b) {
+                             return a.record.timestampUs < b.record.timestampUs;
+                         });
+        for (size_t begin = 0, end = 0; begin < mBatch.size(); begin = end) {
+            FILE* stream = mBatch[begin].record.stream;
+            for (end = begin + 1; end < mBatch.size() && mBatch[end].record.stream == stream;
+                 ++end) {
+            }
+            write(stream, begin, end);
+        }
+
+        std::lock_guard<std::mutex> lock(mRingsLock);
+        for (size_t i = 0; i < mEnds.size(); ++i) {
+            mRings[i]->head.store(mEnds[i], std::memory_order_release);
+        }
+        // Rings of exited threads go once they are empty.
+        mRings.erase(std::remove_if(mRings.begin(), mRings.end(),
+                                    [](LogRing* ring) {
+                                        if (!ring->retired.load(std::memory_order_acquire) ||
+                                            ring->head.load(std::memory_order_relaxed) !=
+                                                    ring->tail.load(std::memory_order_acquire)) {
+                                            return false;
+                                        }
+                                        delete ring;
+                                        return true;
+                                    }),
+                     mRings.end());
+    }
+
+    // Writes mBatch[begin, end), which all go to |stream|.
+    void write(FILE* stream, size_t begin, size_t end) {
+        const bool colors = sEnableColors;
+        mPrefixes.clear();
+        std::vector<size_t> prefixEnds;
+        prefixEnds.reserve(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            const LogRecord& record = mBatch[i].record;
+            char prefix[1024];
+            if (colors) {
+                mPrefixes += colorTagFor(record.severity);
+            }
+            int len = formatPrefix(prefix, sizeof(prefix), record.severity, record.timestampUs,
+                                   record.threadId, mBatch[i].file, record.line);
+            mPrefixes.append(prefix, std::min<size_t>(std::max(len, 0), sizeof(prefix) - 1));
+            mPrefixes += ' ';
+            prefixEnds.push_back(mPrefixes.size());
+        }
+
+        // Anything the stream buffered goes first.
+        fflush(stream);
+        size_t prefixBegin = 0;
+#ifdef _WIN32
+        for (size_t i = begin; i < end; ++i) {
+            const LogRecord& record = mBatch[i].record;
+            fwrite(mPrefixes.data() + prefixBegin, 1, prefixEnds[i - begin] - prefixBegin, stream);
+            fwrite(mBatch[i].message, 1, record.messageLen, stream);
+            if (colors) {
+                fputs(kColorTagReset, stream);
+            }
+            prefixBegin = prefixEnds[i - begin];
+        }
+        fflush(stream);
+#else
+        mIovecs.clear();
+        for (size_t i = begin; i < end; ++i) {
+            mIovecs.push_back({const_cast<char*>(mPrefixes.data()) + prefixBegin,
+                               prefixEnds[i - begin] - prefixBegin});
+            mIovecs.push_back({const_cast<char*>(mBatch[i].message), mBatch[i].record.messageLen});
+            if (colors) {
+                mIovecs.push_back({const_cast<char*>(kColorTagReset), strlen(kColorTagReset)});
+            }
+            prefixBegin = prefixEnds[i - begin];
+        }
+        writeFully(fileno(stream), mIovecs.data(), mIovecs.size());
+#endif
+    }
+
+#ifndef _WIN32
+    static void writeFully(int fd, struct iovec* iov, size_t count) {
+        constexpr size_t kMaxIovecs = 1024;
+        while (count > 0) {
+            ssize_t written = writev(fd, iov, std::min(count, kMaxIovecs));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            // Skip what went out, and retry the rest of a short write.
+            while (count > 0 && size_t(written) >= iov->iov_len) {
+                written -= iov->iov_len;
+                ++iov;
+                --count;
+            }
+            if (count > 0) {
+                iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+                iov->iov_len -= written;
+            }
+        }
+    }
+#endif
+
+    std::once_flag mStarted;
+    std::mutex mWakeLock;
+    std::condition_variable mWakeup;
+    std::atomic<bool> mPending{false};
+    std::atomic<uint64_t> mDropped{0};
+
+    std::mutex mRingsLock;
+    std::vector<LogRing*> mRings;
+
+    // Only touched with mDrainLock held.
+    std::mutex mDrainLock;
+    std::vector<Pending> mBatch;
+    std::vector<uint64_t> mEnds;
+    std::string mPrefixes;
+#ifndef _WIN32
+    std::vector<struct iovec> mIovecs;
+#endif
+};
+
+// Per call site rate limiting. Each (file, line, severity) gets a token
+// bucket, kept as the single timestamp of the generic cell rate algorithm so
+// that admitting a line is one compare-and-swap. Sites live in a fixed open
+// addressed table and are never removed; a site that finds no free slot is
+// not limited. |file| is compared by pointer, which is what __FILE__ gives
+// each call site.
+constexpr size_t kLogSites = 1024;
+constexpr size_t kLogSiteProbes = 8;
+
+struct LogSite {
+    std::atomic<uint64_t> key{0};
+    // When the bucket will be full again, in steady clock nanoseconds.
+    std::atomic<int64_t> fullAtNs{0};
+    std::atomic<uint32_t> suppressed{0};
+    // Set after |key| is claimed, for summaries written from flushes.
+    std::atomic<FILE*> stream{nullptr};
+    std::atomic<const char*> file{nullptr};
+    std::atomic<uint32_t> line{0};
+    std::atomic<char> severity{0};
+};
+
+class LogRateLimiter {
+public:
+    static LogRateLimiter& get() {
+        static LogRateLimiter* sLimiter = new LogRateLimiter;
+        return *sLimiter;
+    }
+
+    void configure(uint32_t burst, uint32_t linesPerSecond) {
+        const int64_t intervalNs = linesPerSecond ? 1000000000LL / linesPerSecond : 0;
+        mBurstNs.store(intervalNs * std::max<uint32_t>(burst, 1), std::memory_order_relaxed);
+        mIntervalNs.store(intervalNs, std::memory_order_release);
+    }
+
+    // Whether a line from this site may go out. If it may, |*suppressed| is
+    // how many before it didn't, for the caller to report.
+    bool admit(FILE* stream, char severity, const char* file, unsigned int line,
+               uint32_t* suppressed) {
+        *suppressed = 0;
+        const int64_t intervalNs = mIntervalNs.load(std::memory_order_acquire);
+        if (!intervalNs || severity == 'F') {
+            return true;
+        }
+        LogSite* site = find(stream, severity, file, line);
+        if (!site) {
+            return true;
+        }
+
+        const int64_t now = nowNs();
+        const int64_t burstNs = mBurstNs.load(std::memory_order_relaxed);
+        int64_t fullAt = site->fullAtNs.load(std::memory_order_relaxed);
+        for (;;) {
+            const int64_t next = std::max(fullAt, now) + intervalNs;
+            if (next - now > burstNs) {
+                site->suppressed.fetch_add(1, std::memory_order_relaxed);
+                mSuppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (site->fullAtNs.compare_exchange_weak(fullAt, next, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        *suppressed = site->suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Calls |report| for each site with lines suppressed since its last
+    // report.
+    template <class Report>
+    void collectSuppressed(Report&& report) {
+        for (LogSite& site : mSites) {
+            const char* file = site.file.load(std::memory_order_acquire);
+            if (!file || !site.suppressed.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            const uint32_t count = site.suppressed.exchange(0, std::memory_order_relaxed);
+            if (count) {
+                report(site.stream.load(std::memory_order_relaxed),
+                       site.severity.load(std::memory_order_relaxed), file,
+                       site.line.load(std::memory_order_relaxed), count);
+            }
+        }
+    }
+
+    uint64_t suppressed() const { return mSuppressed.load(std::memory_order_relaxed); }
+
+private:
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+    }
+
+    LogSite* find(FILE* stream, char severity, const char* file, unsigned int line) {
+        uint64_t key = reinterpret_cast<uintptr_t>(file) ^ (uint64_t(line) << 40) ^
+                       (uint64_t(uint8_t(severity)) << 32) ^
+                       (reinterpret_cast<uintptr_t>(stream) << 16);
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key |= 1;  // 0 marks a free slot
+        for (size_t i = 0; i < kLogSiteProbes; ++i) {
+            LogSite& site = mSites[(key + i) & (kLogSites - 1)];
+            uint64_t current = site.key.load(std::memory_order_relaxed);
+            if (current == key) {
+                return &site;
+            }
+            if (current == 0 &&
+                site.key.compare_exchange_strong(current, key, std::memory_order_relaxed)) {
+                site.stream.store(stream, std::memory_order_relaxed);
+                site.line.store(line, std::memory_order_relaxed);
+                site.severity.store(severity, std::memory_order_relaxed);
+                site.file.store(file, std::memory_order_release);
+                return &site;
+            }
+            if (current == key) {
+                return &site;
+            }
+        }
+        return nullptr;
+    }
+
+    std::atomic<int64_t> mIntervalNs{0};
+    std::atomic<int64_t> mBurstNs{0};
+    std::atomic<uint64_t> mSuppressed{0};
+    LogSite mSites[kLogSites];
+};
+
+// Writes a formatted line to the logger, the async rings or |stream|.
+void writeLog(FILE* stream, char severity, const char* file, unsigned int line,
+              int64_t timestamp_us, const char* message, size_t messageLen) {
+    if (sLogger) {
+        sLogger(severity, file, line, timestamp_us, message);
+        return;
+    }
+
+    if (sAsyncLogs.load(std::memory_order_relaxed)) {
+        if (severity != 'F') {
+            AsyncLogger::get().log(stream, severity, GetFileBasename(file), line, timestamp_us,
+                                   message, messageLen);
+            return;
+        }
+        // The process is about to go down; get everything before this out.
+        AsyncLogger::get().flush();
+    }
+
+    char prefix[1024];
+    formatPrefix(prefix, sizeof(prefix), severity, timestamp_us, getCachedThreadID(),
+                 GetFileBasename(file), line);
+
+    // Output prefix and the message with a newline
+    if (sEnableColors) {
+        fprintf(stream, "%s%s %s\n%s", colorTagFor(severity), prefix, message, kColorTagReset);
+    } else {
+        fprintf(stream, "%s %s\n", prefix, message);
+    }
+}
+
+void writeSuppressed(FILE* stream, char severity, const char* file, unsigned int line,
+                     int64_t timestamp_us, uint32_t count) {
+    char message[64];
+    const int len = snprintf(message, sizeof(message), "suppressed %u similar messages", count);
+    writeLog(stream, severity, file, line, timestamp_us, message,
+             std::min<size_t>(std::max(len, 0), sizeof(message) - 1));
+}
+
 }  // namespace
 
 gfxstream_logger_t get_gfx_stream_logger() { return sLogger; };
@@ -95,52 +606,46 @@ void set_gfxstream_enable_verbose_logs() { sEnableVerbose = true; }
 
 void set_gfxstream_enable_log_colors() { sEnableColors = true; }
 
+void set_gfxstream_enable_async_logs(bool enable) {
+    if (enable) {
+        AsyncLogger::get().enable();
+        sAsyncLogs.store(true, std::memory_order_release);
+    } else if (sAsyncLogs.exchange(false, std::memory_order_acq_rel)) {
+        AsyncLogger::get().flush();
+    }
+}
+
+void set_gfxstream_log_rate_limit(uint32_t burst, uint32_t linesPerSecond) {
+    LogRateLimiter::get().configure(burst, linesPerSecond);
+}
+
+void gfxstream_flush_logs() {
+    LogRateLimiter::get().collectSuppressed(
+        [](FILE* stream, char severity, const char* file, unsigned int line, uint32_t count) {
+            writeSuppressed(stream, severity, file, line, nowUs(), count);
+        });
+    if (sAsyncLogs.load(std::memory_order_acquire)) {
+        AsyncLogger::get().flush();
+    }
+}
+
+uint64_t get_gfxstream_dropped_log_count() { return AsyncLogger::get().dropped(); }
+
+uint64_t get_gfxstream_suppressed_log_count() { return LogRateLimiter::get().suppressed(); }
+
 void OutputLog(FILE* stream, char severity, const char* file, unsigned int line,
                int64_t timestamp_us, const char* format, ...) {
-    if (sLogger) {
-        char formatted_message[2048];
-        va_list args;
-        va_start(args, format);
-        int ret = vsnprintf(formatted_message, sizeof(formatted_message), format, args);
-        va_end(args);
-        if (timestamp_us == 0) {
-            timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
-                               std::chrono::system_clock::now().time_since_epoch())
-                               .count();
-        }
-
-        sLogger(severity, file, line, timestamp_us, formatted_message);
+    if (!sLogger && severity == 'V' && !sEnableVerbose) {
         return;
     }
-
-    if (severity == 'V' && !sEnableVerbose) {
+    // Before formatting: a suppressed line costs one hash and one CAS.
+    uint32_t suppressed = 0;
+    if (!LogRateLimiter::get().admit(stream, severity, file, line, &suppressed)) {
         return;
     }
     if (timestamp_us == 0) {
-        timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
-                           std::chrono::system_clock::now().time_since_epoch())
-                           .count();
+        timestamp_us = nowUs();
     }
-    std::time_t timestamp_s = timestamp_us / 1000000;
-
-    // Break down the timestamp into the individual time parts
-    std::tm ts_parts = {};
-#if defined(_WIN32)
-    localtime_s(&ts_parts, &timestamp_s);
-#else
-    localtime_r(&timestamp_s, &ts_parts);
-#endif
-
-    // Get the microseconds part of the timestamp since it's not available in the tm struct
-    int64_t microseconds = timestamp_us % 1000000;
-
-    // Standard Google logging prefix
-    // See also:
-    // https://github.com/google/glog/blob/9dc1107f88d3a1613d61b80040d83c1c1acbac3d/src/logging.cc#L1612-L1615
-    char prefix[1024];
-    snprintf(prefix, sizeof(prefix), "%c%02d%02d %02d:%02d:%02d.%06" PRId64 " %7s %s:%d]", severity,
-             ts_parts.tm_mon + 1, ts_parts.tm_mday, ts_parts.tm_hour, ts_parts.tm_min,
-             ts_parts.tm_sec, microseconds, getCachedThreadID(), GetFileBasename(file), line);
 
     // Actual log message
     va_list args;
@@ -148,22 +653,11 @@ void OutputLog(FILE* stream, char severity, const char* file, unsigned int line,
     char formatted_message[2048];
     int ret = vsnprintf(formatted_message, sizeof(formatted_message), format, args);
     formatted_message[sizeof(formatted_message) - 1] = 0;
+    va_end(args);
 
-    // Output prefix and the message with a newline
-    if (sEnableColors) {
-        const char* colorTag = "";
-        const char* colorTagReset = "\x1B[0m";
-
-        // Colorize errors and warnings
-        if (severity == 'E' || severity == 'F') {
-            colorTag = "\x1B[31m";  // Red
-        } else if (severity == 'W') {
-            colorTag = "\x1B[33m";  // Yellow
-        }
-
-        fprintf(stream, "%s%s %s\n%s", colorTag, prefix, formatted_message, colorTagReset);
-    } else {
-        fprintf(stream, "%s %s\n", prefix, formatted_message);
+    if (suppressed) {
+        writeSuppressed(stream, severity, file, line, timestamp_us, suppressed);
     }
-    va_end(args);
+    writeLog(stream, severity, file, line, timestamp_us, formatted_message,
+             ret < 0 ? 0 : std::min<size_t>(ret, sizeof(formatted_message) - 1));
 }
@@ -29,6 +29,10 @@ void set_gfxstream_logger(gfxstream_logger_t f) {}
 void set_gfxstream_fine_logger(gfxstream_logger_t f) {}
 void set_gfxstream_enable_log_colors() {}
 void set_gfxstream_enable_verbose_logs() { sEnableVerbose = true; }
+// absl does its own buffering.
+void set_gfxstream_enable_async_logs(bool enable) {}
+void gfxstream_flush_logs() {}
+uint64_t get_gfxstream_dropped_log_count() { return 0; }
 
 void gfx_stream_logger(char severity, const char* file, unsigned int line, int64_t timestamp_us,
                        const char* msg) {
@@ -16,7 +16,9 @@
 
 #include "host-common/logging.h"
 
+#include <string>
 #include <thread>
+#include <vector>
 
 #include "aemu/base/testing/TestUtils.h"
 
@@ -129,4 +131,93 @@ TEST(Logging, OutputsDifferentThreadIdsOnDifferentThreads) {
     EXPECT_NE(tid1, tid2);
 }
 
+TEST(Logging, AsyncLogsOnFlush) {
+    CaptureStderr();
+    set_gfxstream_enable_async_logs(true);
+    INFO("hello %s %d", "async", 1);
+    gfxstream_flush_logs();
+    std::string log = GetCapturedStderr();
+    set_gfxstream_enable_async_logs(false);
+    EXPECT_THAT(
+        log, MatchesStdRegex(
+                 R"re(I\d{4} \d{2}:\d{2}:\d{2}\.\d{6} +\w+ logging_unittest.cpp:\d+\] hello async 1\n)re"));
+}
+
+TEST(Logging, AsyncLogsKeepOrderAndCountDrops) {
+    constexpr int kThreads = 4;
+    constexpr int kLines = 2000;
+    const uint64_t droppedBefore = get_gfxstream_dropped_log_count();
+
+    CaptureStderr();
+    set_gfxstream_enable_async_logs(true);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < kLines; ++i) {
+                INFO("thread %d line %d", t, i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    set_gfxstream_enable_async_logs(false);
+    std::string log = GetCapturedStderr();
+
+    // Every line is either written, in order per thread, or counted.
+    int lines = 0;
+    for (int t = 0; t < kThreads; ++t) {
+        const std::string tag = "] thread " + std::to_string(t) + " line ";
+        int last = -1;
+        for (size_t pos = log.find(tag); pos != std::string::npos;
+             pos = log.find(tag, pos + 1)) {
+            int line = atoi(log.c_str() + pos + tag.size());
+            EXPECT_GT(line, last);
+            last = line;
+            ++lines;
+        }
+    }
+    EXPECT_EQ(uint64_t(kThreads * kLines),
+              lines + (get_gfxstream_dropped_log_count() - droppedBefore));
+}
+
+TEST(Logging, AsyncLogsWriteFatalSynchronously) {
+    CaptureStderr();
+    set_gfxstream_enable_async_logs(true);
+    INFO("before fatal");
+    OutputLog(stderr, 'F', "file", 1, 0, "fatal");
+    std::string log = GetCapturedStderr();
+    set_gfxstream_enable_async_logs(false);
+    EXPECT_THAT(log, MatchesStdRegex(R"re(I.*\] before fatal\nF.*\] fatal\n)re"));
+}
+
+// Tests that repeats from one site are limited and summarized, while other
+// sites and fatal lines go through.
+TEST(Logging, RateLimitCollapsesRepeats) {
+    const uint64_t suppressedBefore = get_gfxstream_suppressed_log_count();
+    set_gfxstream_log_rate_limit(2, 1);
+
+    CaptureStderr();
+    for (int i = 0; i < 10; ++i) {
+        ERR("not alloced %d", i);
+    }
+    WARN("another site");
+    for (int i = 0; i < 3; ++i) {
+        OutputLog(stderr, 'F', "file", 1, 0, "fatal %d", i);
+    }
+    std::string log = GetCapturedStderr();
+    EXPECT_THAT(log, HasSubstr("] not alloced 0\n"));
+    EXPECT_THAT(log, HasSubstr("] not alloced 1\n"));
+    EXPECT_THAT(log, Not(HasSubstr("] not alloced 2\n")));
+    EXPECT_THAT(log, HasSubstr("] another site\n"));
+    EXPECT_THAT(log, HasSubstr("] fatal 2\n"));
+    EXPECT_EQ(8u, get_gfxstream_suppressed_log_count() - suppressedBefore);
+
+    CaptureStderr();
+    gfxstream_flush_logs();
+    log = GetCapturedStderr();
+    set_gfxstream_log_rate_limit(0, 0);
+    EXPECT_THAT(log, MatchesStdRegex(R"re(E.*\] suppressed 8 similar messages\n)re"));
+}
+
 }  // namespace
@@ -0,0 +1,279 @@
+/*
+* Copyright (C) 2026 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "snapshot/PostCopyRamLoader.h"
+
+#include "aemu/base/EintrWrapper.h"
+#include "aemu/base/memory/MemoryHints.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/userfaultfd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using android::base::AutoLock;
+
+namespace android {
+namespace snapshot {
+
+PostCopyRamLoader::PostCopyRamLoader(std::vector<base::StdioStream*> chain,
+                                     std::vector<RamBlock> blocks,
+                                     RamPageStore* store)
+    : mChain(std::move(chain)), mBlocks(std::move(blocks)), mStore(store) {}
+
+PostCopyRamLoader::~PostCopyRamLoader() {
+    join();
+}
+
+void PostCopyRamLoader::setAccessOrderHint(std::vector<uint64_t> pages) {
+    mHint = std::move(pages);
+}
+
+std::vector<uint64_t> PostCopyRamLoader::accessOrder() const {
+    AutoLock lock(mOrderLock);
+    return mAccessOrder;
+}
+
+bool PostCopyRamLoader::readPage(size_t block, uint32_t page, uint8_t* out) {
+    const RamPageSource& source = mSources[block][page];
+    const uint32_t size = mIndex.blocks[block].pageBytes(page);
+    if (source.delta < 0 || source.kind == RamPageKind::Zero) {
+        memset(out, 0, size);
+        return true;
+    }
+    if (source.kind == RamPageKind::Stored) {
+        return mStore && mStore->get(source.pos, out, size);
+    }
+
+    AutoLock lock(mReadLock);
+    FILE* const file = mChain[source.delta]->get();
+    return !HANDLE_EINTR(fseeko(file, source.pos, SEEK_SET)) &&
+           fread(out, 1, size, file) == size;
+}
+
+bool PostCopyRamLoader::start() {
+    RamDeltaIndex index;
+    std::vector<std::vector<RamPageSource>> sources;
+    if (!resolveRamDeltaChain(mChain, &index, &sources) || !index.parentId.empty() ||
+        index.blocks.size() != mBlocks.size()) {
+        mError = true;
+        return false;
+    }
+
+    // Put the index in the order of |mBlocks|.
+    mIndex.id = index.id;
+    mIndex.blocks.resize(mBlocks.size());
+    mSources.resize(mBlocks.size());
+    size_t totalPages = 0;
+    for (size_t b = 0; b < mBlocks.size(); ++b) {
+        size_t i = 0;
+        while (i < index.blocks.size() && index.blocks[i].id != mBlocks[b].id) {
+            ++i;
+        }
+        if (i == index.blocks.size() || index.blocks[i].totalSize != mBlocks[b].totalSize ||
+            index.blocks[i].pageSize != mBlocks[b].pageSize) {
+            mError = true;
+            return false;
+        }
+        mIndex.blocks[b] = std::move(index.blocks[i]);
+        mSources[b] = std::move(sources[i]);
+        mFirstPage.push_back(totalPages);
+        totalPages += mIndex.blocks[b].pageCount();
+    }
+    mFilled.reset(new std::atomic<uint8_t>[totalPages]());
+
+#ifdef __linux__
+    const uint64_t hostPage = base::memoryPageSize();
+    bool canPostCopy = true;
+    for (const RamBlock& block : mBlocks) {
+        canPostCopy &= reinterpret_cast<uintptr_t>(block.hostPtr) % hostPage == 0 &&
+                       block.totalSize % hostPage == 0 && block.pageSize % hostPage == 0 &&
+                       !(block.flags & SNAPSHOT_RAM_MAPPED);
+    }
+    if (canPostCopy) {
+        mUffd = syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+    }
+    if (mUffd >= 0) {
+        struct uffdio_api api = {};
+        api.api = UFFD_API;
+        bool ok = ioctl(mUffd, UFFDIO_API, &api) == 0;
+        size_t registered = 0;
+        for (; ok && registered < mBlocks.size(); ++registered) {
+            const RamBlock& block = mBlocks[registered];
+            // Registered pages only fault while they are missing.
+            base::memoryHint(block.hostPtr, block.totalSize, base::MemoryHint::DontNeed);
+            struct uffdio_register reg = {};
+            reg.range.start = reinterpret_cast<uintptr_t>(block.hostPtr);
+            reg.range.len = block.totalSize;
+            reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+            ok = ioctl(mUffd, UFFDIO_REGISTER, &reg) == 0;
+        }
+        if (ok) {
+            mStopFd = eventfd(0, EFD_CLOEXEC);
+            ok = mStopFd >= 0;
+        }
+        if (!ok) {
+            // Unregistering the blocks is implied by closing.
+            close(mUffd);
+            mUffd = -1;
+        }
+    }
+    if (mUffd >= 0) {
+        mHandler.reset(new base::FunctorThread([this] { handleFaults(); }));
+        mPrefetcher.reset(new base::FunctorThread([this] { prefetch(); }));
+        mHandler->start();
+        mPrefetcher->start();
+        return true;
+    }
+#endif
+
+    // Eager: everything before the guest runs, on as many threads as help.
+    if (!loadResolvedRamPages(mChain, mIndex.blocks, mSources, mBlocks, mStore)) {
+        mError = true;
+    }
+    return !mError;
+}
+
+void PostCopyRamLoader::fillPage(size_t block, uint32_t page, uint8_t* buffer) {
+#ifdef __linux__
+    // Whoever claims the page fills it; UFFDIO_COPY wakes any thread
+    // faulting on it meanwhile.
+    uint8_t expected = 0;
+    if (!mFilled[mFirstPage[block] + page].compare_exchange_strong(expected, 1)) {
+        return;
+    }
+
+    const RamDeltaBlock& index = mIndex.blocks[block];
+    const uintptr_t dst = reinterpret_cast<uintptr_t>(mBlocks[block].hostPtr) +
+                          uint64_t(page) * index.pageSize;
+    const RamPageSource& source = mSources[block][page];
+    int res;
+    if (source.delta < 0 || source.kind == RamPageKind::Zero) {
+        struct uffdio_zeropage zero = {};
+        zero.range.start = dst;
+        zero.range.len = index.pageSize;
+        res = ioctl(mUffd, UFFDIO_ZEROPAGE, &zero);
+    } else {
+        if (!readPage(block, page, buffer)) {
+            mError = true;
+            memset(buffer, 0, index.pageSize);
+        }
+        struct uffdio_copy copy = {};
+        copy.dst = dst;
+        copy.src = reinterpret_cast<uintptr_t>(buffer);
+        copy.len = index.pageSize;
+        res = ioctl(mUffd, UFFDIO_COPY, &copy);
+    }
+    if (res && errno != EEXIST) {
+        mError = true;
+    }
+#endif
+}
+
+void PostCopyRamLoader::handleFaults() {
+#ifdef __linux__
+    std::vector<uint8_t> buffer;
+    for (;;) {
+        struct pollfd fds[2] = {{mUffd, POLLIN, 0}, {mStopFd, POLLIN, 0}};
+        if (HANDLE_EINTR(poll(fds, 2, -1)) < 0 || (fds[1].revents & POLLIN)) {
+            return;
+        }
+
+        struct uffd_msg msg;
+        while (read(mUffd, &msg, sizeof(msg)) == sizeof(msg)) {
+            if (msg.event != UFFD_EVENT_PAGEFAULT) {
+                continue;
+            }
+            const uintptr_t addr = msg.arg.pagefault.address;
+            for (size_t b = 0; b < mBlocks.size(); ++b) {
+                const uintptr_t start = reinterpret_cast<uintptr_t>(mBlocks[b].hostPtr);
+                if (addr < start || addr >= start + mBlocks[b].totalSize) {
+                    continue;
+                }
+                const uint32_t page = (addr - start) / mBlocks[b].pageSize;
+                {
+                    AutoLock lock(mOrderLock);
+                    mAccessOrder.push_back((uint64_t(b) << 32) | page);
+                }
+                buffer.resize(mBlocks[b].pageSize);
+                fillPage(b, page, buffer.data());
+                break;
+            }
+        }
+    }
+#endif
+}
+
+void PostCopyRamLoader::prefetch() {
+#ifdef __linux__
+    std::vector<uint8_t> buffer;
+    auto fill = [this, &buffer](size_t b, uint32_t page) {
+        buffer.resize(mBlocks[b].pageSize);
+        fillPage(b, page, buffer.data());
+    };
+    for (uint64_t hinted : mHint) {
+        const size_t b = hinted >> 32;
+        const uint32_t page = static_cast<uint32_t>(hinted);
+        if (b < mBlocks.size() && page < mIndex.blocks[b].pageCount()) {
+            fill(b, page);
+        }
+    }
+    for (size_t b = 0; b < mBlocks.size(); ++b) {
+        for (uint32_t page = 0; page < mIndex.blocks[b].pageCount(); ++page) {
+            fill(b, page);
+        }
+    }
+
+    for (const RamBlock& block : mBlocks) {
+        struct uffdio_range range = {};
+        range.start = reinterpret_cast<uintptr_t>(block.hostPtr);
+        range.len = block.totalSize;
+        ioctl(mUffd, UFFDIO_UNREGISTER, &range);
+    }
+    const uint64_t one = 1;
+    HANDLE_EINTR(write(mStopFd, &one, sizeof(one)));
+#endif
+}
+
+void PostCopyRamLoader::join() {
+    if (mPrefetcher) {
+        mPrefetcher->wait();
+        mPrefetcher.reset();
+    }
+    if (mHandler) {
+        mHandler->wait();
+        mHandler.reset();
+    }
+#ifdef __linux__
+    if (mUffd >= 0) {
+        close(mUffd);
+        close(mStopFd);
+        mUffd = -1;
+        mStopFd = -1;
+    }
+#endif
+}
+
+}  // namespace snapshot
+}  // namespace android
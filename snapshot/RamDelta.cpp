@@ -0,0 +1,729 @@
+/*
+* Copyright (C) 2026 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "snapshot/RamDelta.h"
+
+#include "aemu/base/EintrWrapper.h"
+#include "aemu/base/memory/MemoryHints.h"
+#include "aemu/base/system/System.h"
+#include "aemu/base/threads/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RAM_DELTA_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RAM_DELTA_NEON 1
+#endif
+
+using android::base::AutoLock;
+using android::base::Hash128;
+
+namespace android {
+namespace snapshot {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x4152444c;  // "ARDL"
+constexpr uint32_t kVersion = 2;
+constexpr uint32_t kStoreMagic = 0x41525053;  // "ARPS"
+constexpr uint32_t kStoreVersion = 1;
+constexpr int64_t kStoreHeaderSize = 8;
+constexpr int64_t kStoreRecordHeaderSize = 20;
+
+bool sameLayout(const RamDeltaBlock& a, const RamDeltaBlock& b) {
+    return a.totalSize == b.totalSize && a.pageSize == b.pageSize;
+}
+
+void writeIndex(base::Stream* stream, const RamDeltaIndex& index) {
+    stream->putBe32(kMagic);
+    stream->putBe32(kVersion);
+    stream->putString(index.id);
+    stream->putString(index.parentId);
+    stream->putBe32(index.blocks.size());
+    for (const RamDeltaBlock& block : index.blocks) {
+        stream->putString(block.id);
+        stream->putBe64(block.totalSize);
+        stream->putBe32(block.pageSize);
+        stream->putBe32(block.changedPages.size());
+        stream->putBe32Array(block.changedPages.data(), block.changedPages.size());
+        stream->write(block.pageKinds.data(), block.pageKinds.size());
+        stream->putBe32(block.storeOffsets.size());
+        stream->putBe64Array(block.storeOffsets.data(), block.storeOffsets.size());
+        stream->putBe64Array(block.pageHashes.data(), block.pageHashes.size());
+    }
+}
+
+// Checks that |next| was made against |prev|, with the same blocks.
+bool linked(const RamDeltaIndex& prev, const RamDeltaIndex& next) {
+    if (next.parentId != prev.id || next.blocks.size() != prev.blocks.size()) {
+        return false;
+    }
+    for (const RamDeltaBlock& block : next.blocks) {
+        const RamDeltaBlock* prevBlock = prev.findBlock(block.id);
+        if (!prevBlock || !sameLayout(*prevBlock, block)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Zeroes [offset, offset + size) of |ram|, preferably by dropping the pages.
+void zeroRange(const RamBlock& ram, int64_t offset, int64_t size) {
+    uint8_t* const start = ram.hostPtr + offset;
+#ifdef __linux__
+    const uint64_t hostPage = base::memoryPageSize();
+    if (!(ram.flags & SNAPSHOT_RAM_MAPPED) &&
+        reinterpret_cast<uintptr_t>(start) % hostPage == 0 && size % hostPage == 0 &&
+        base::memoryHint(start, size, base::MemoryHint::DontNeed)) {
+        return;
+    }
+#endif
+    memset(start, 0, size);
+}
+
+bool writeAll(FILE* file, const void* data, size_t size) {
+    return fwrite(data, 1, size, file) == size;
+}
+
+void putBe32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (24 - 8 * i));
+    }
+}
+
+void putBe64(uint8_t* out, uint64_t value) {
+    putBe32(out, static_cast<uint32_t>(value >> 32));
+    putBe32(out + 4, static_cast<uint32_t>(value));
+}
+
+uint32_t getBe32(const uint8_t* in) {
+    return (uint32_t(in[0]) << 24) | (uint32_t(in[1]) << 16) | (uint32_t(in[2]) << 8) |
+           uint32_t(in[3]);
+}
+
+uint64_t getBe64(const uint8_t* in) {
+    return (uint64_t(getBe32(in)) << 32) | getBe32(in + 4);
+}
+
+// Reads |size| bytes at |pos| of |stream|. With pread() the stream's
+// position stays put and readers don't wait for each other; elsewhere they
+// take turns seeking under |lock|.
+bool readAt(base::StdioStream* stream, base::Lock* lock, int64_t pos, void* out, size_t size) {
+#ifndef _WIN32
+    const int fd = fileno(stream->get());
+    uint8_t* dst = static_cast<uint8_t*>(out);
+    while (size > 0) {
+        const ssize_t got = HANDLE_EINTR(pread(fd, dst, size, pos));
+        if (got <= 0) {
+            return false;
+        }
+        dst += got;
+        pos += got;
+        size -= got;
+    }
+    return true;
+#else
+    AutoLock autoLock(*lock);
+    FILE* const file = stream->get();
+    return !HANDLE_EINTR(fseeko(file, pos, SEEK_SET)) && fread(out, 1, size, file) == size;
+#endif
+}
+
+bool isZeroSource(const RamPageSource& source) {
+    return source.delta < 0 || source.kind == RamPageKind::Zero;
+}
+
+}  // namespace
+
+bool isRamPageZero(const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* const end = p + size;
+#if RAM_DELTA_SSE2
+    for (; end - p >= 64; p += 64) {
+        const __m128i* v = reinterpret_cast<const __m128i*>(p);
+        const __m128i any = _mm_or_si128(
+                _mm_or_si128(_mm_loadu_si128(v), _mm_loadu_si128(v + 1)),
+                _mm_or_si128(_mm_loadu_si128(v + 2), _mm_loadu_si128(v + 3)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())) != 0xffff) {
+            return false;
+        }
+    }
+#elif RAM_DELTA_NEON
+    for (; end - p >= 64; p += 64) {
+        const uint8x16_t any = vorrq_u8(vorrq_u8(vld1q_u8(p), vld1q_u8(p + 16)),
+                                        vorrq_u8(vld1q_u8(p + 32), vld1q_u8(p + 48)));
+        if (vmaxvq_u8(any)) {
+            return false;
+        }
+    }
+#endif
+    for (; p < end; ++p) {
+        if (*p) {
+            return false;
+        }
+    }
+    return true;
+}
+
+RamPageStore::RamPageStore(base::StdioStream&& file) : mFile(std::move(file)) {}
+
+bool RamPageStore::open() {
+    AutoLock lock(mLock);
+    FILE* const file = mFile.get();
+    if (!file || HANDLE_EINTR(fseeko(file, 0, SEEK_END))) {
+        return false;
+    }
+    const int64_t size = ftello(file);
+    HANDLE_EINTR(fseeko(file, 0, SEEK_SET));
+
+    uint8_t header[kStoreRecordHeaderSize];
+    if (size == 0) {
+        putBe32(header, kStoreMagic);
+        putBe32(header + 4, kStoreVersion);
+        if (!writeAll(file, header, kStoreHeaderSize)) {
+            return false;
+        }
+        mEnd = kStoreHeaderSize;
+        return true;
+    }
+    if (fread(header, 1, kStoreHeaderSize, file) != size_t(kStoreHeaderSize) ||
+        getBe32(header) != kStoreMagic || getBe32(header + 4) != kStoreVersion) {
+        return false;
+    }
+
+    // A record cut short by a crash is dropped and overwritten.
+    int64_t pos = kStoreHeaderSize;
+    while (size - pos >= kStoreRecordHeaderSize) {
+        if (HANDLE_EINTR(fseeko(file, pos, SEEK_SET)) ||
+            fread(header, 1, kStoreRecordHeaderSize, file) != size_t(kStoreRecordHeaderSize)) {
+            break;
+        }
+        const uint32_t pageSize = getBe32(header + 16);
+        if (size - pos - kStoreRecordHeaderSize < pageSize) {
+            break;
+        }
+        mOffsets.emplace(Hash128{getBe64(header), getBe64(header + 8)}, pos);
+        pos += kStoreRecordHeaderSize + pageSize;
+    }
+    mEnd = pos;
+    return true;
+}
+
+bool RamPageStore::contains(const Hash128& hash) const {
+    AutoLock lock(mLock);
+    return mOffsets.count(hash) != 0;
+}
+
+uint64_t RamPageStore::put(const void* data, uint32_t size) {
+    const Hash128 hash = base::xxh3Hash128(data, size);
+
+    AutoLock lock(mLock);
+    auto it = mOffsets.find(hash);
+    if (it != mOffsets.end()) {
+        return it->second;
+    }
+
+    FILE* const file = mFile.get();
+    uint8_t header[kStoreRecordHeaderSize];
+    putBe64(header, hash.low);
+    putBe64(header + 8, hash.high);
+    putBe32(header + 16, size);
+    if (HANDLE_EINTR(fseeko(file, mEnd, SEEK_SET)) ||
+        !writeAll(file, header, sizeof(header)) || !writeAll(file, data, size) ||
+        fflush(file)) {
+        return 0;
+    }
+    const uint64_t offset = mEnd;
+    mEnd += kStoreRecordHeaderSize + size;
+    mOffsets.emplace(hash, offset);
+    return offset;
+}
+
+bool RamPageStore::get(uint64_t offset, void* data, uint32_t size) {
+    AutoLock lock(mLock);
+    FILE* const file = mFile.get();
+    uint8_t header[kStoreRecordHeaderSize];
+    if (offset < uint64_t(kStoreHeaderSize) || offset + kStoreRecordHeaderSize > uint64_t(mEnd) ||
+        HANDLE_EINTR(fseeko(file, offset, SEEK_SET)) ||
+        fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        getBe32(header + 16) != size || fread(data, 1, size, file) != size) {
+        return false;
+    }
+    return base::xxh3Hash128(data, size) == Hash128{getBe64(header), getBe64(header + 8)};
+}
+
+size_t RamPageStore::pageCount() const {
+    AutoLock lock(mLock);
+    return mOffsets.size();
+}
+
+const RamDeltaBlock* RamDeltaIndex::findBlock(const std::string& blockId) const {
+    for (const RamDeltaBlock& block : blocks) {
+        if (block.id == blockId) {
+            return &block;
+        }
+    }
+    return nullptr;
+}
+
+bool saveRamDelta(base::Stream* stream,
+                  const std::string& id,
+                  const std::vector<RamBlock>& blocks,
+                  const RamDeltaIndex* parent,
+                  const std::vector<std::vector<bool>>* dirtyPages,
+                  RamDeltaIndex* written,
+                  RamPageStore* store) {
+    RamDeltaIndex index;
+    index.id = id;
+    index.parentId = parent ? parent->id : std::string();
+    if (parent && parent->blocks.size() != blocks.size()) {
+        return false;
+    }
+
+    // How often each changed page's contents occur, by hash, to find the
+    // duplicates worth putting in |store|.
+    std::unordered_map<uint64_t, uint32_t> occurrences;
+
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const RamBlock& ram = blocks[b];
+        RamDeltaBlock block;
+        block.id = ram.id;
+        block.totalSize = ram.totalSize;
+        block.pageSize = ram.pageSize;
+        const uint32_t pageCount = block.pageCount();
+
+        const RamDeltaBlock* parentBlock = parent ? parent->findBlock(ram.id) : nullptr;
+        if (parent && (!parentBlock || !sameLayout(*parentBlock, block))) {
+            return false;
+        }
+        const std::vector<bool>* dirty =
+                parentBlock && dirtyPages && b < dirtyPages->size() ? &(*dirtyPages)[b]
+                                                                     : nullptr;
+        if (dirty && dirty->size() != pageCount) {
+            return false;
+        }
+
+        if (dirty) {
+            block.pageHashes = parentBlock->pageHashes;
+            for (uint32_t page = 0; page < pageCount; ++page) {
+                if ((*dirty)[page]) {
+                    block.pageHashes[page] = base::xxh3Hash64(
+                            ram.hostPtr + int64_t(page) * ram.pageSize, block.pageBytes(page));
+                }
+            }
+        } else {
+            block.pageHashes = base::xxh3HashChunks(ram.hostPtr, ram.totalSize, ram.pageSize);
+        }
+
+        for (uint32_t page = 0; page < pageCount; ++page) {
+            if (parentBlock && block.pageHashes[page] == parentBlock->pageHashes[page]) {
+                continue;
+            }
+            const uint8_t* data = ram.hostPtr + int64_t(page) * ram.pageSize;
+            block.changedPages.push_back(page);
+            if (isRamPageZero(data, block.pageBytes(page))) {
+                block.pageKinds.push_back(RamPageKind::Zero);
+            } else {
+                block.pageKinds.push_back(RamPageKind::Inline);
+                ++occurrences[block.pageHashes[page]];
+            }
+        }
+        index.blocks.push_back(std::move(block));
+    }
+
+    if (store) {
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            RamDeltaBlock& block = index.blocks[b];
+            for (size_t i = 0; i < block.changedPages.size(); ++i) {
+                if (block.pageKinds[i] != RamPageKind::Inline) {
+                    continue;
+                }
+                const uint32_t page = block.changedPages[i];
+                const uint8_t* data = blocks[b].hostPtr + int64_t(page) * block.pageSize;
+                const uint32_t size = block.pageBytes(page);
+                if (occurrences[block.pageHashes[page]] < 2 &&
+                    !store->contains(base::xxh3Hash128(data, size))) {
+                    continue;
+                }
+                const uint64_t offset = store->put(data, size);
+                if (offset) {
+                    block.pageKinds[i] = RamPageKind::Stored;
+                    block.storeOffsets.push_back(offset);
+                }
+            }
+        }
+    }
+
+    writeIndex(stream, index);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const RamDeltaBlock& block = index.blocks[b];
+        for (size_t i = 0; i < block.changedPages.size(); ++i) {
+            if (block.pageKinds[i] == RamPageKind::Inline) {
+                const uint32_t page = block.changedPages[i];
+                stream->write(blocks[b].hostPtr + int64_t(page) * block.pageSize,
+                              block.pageBytes(page));
+            }
+        }
+    }
+
+    if (written) {
+        *written = std::move(index);
+    }
+    return true;
+}
+
+bool readRamDeltaIndex(base::Stream* stream, RamDeltaIndex* index) {
+    if (stream->getBe32() != kMagic || stream->getBe32() != kVersion) {
+        return false;
+    }
+    index->id = stream->getString();
+    index->parentId = stream->getString();
+    index->blocks.resize(stream->getBe32());
+    for (RamDeltaBlock& block : index->blocks) {
+        block.id = stream->getString();
+        block.totalSize = stream->getBe64();
+        block.pageSize = stream->getBe32();
+        if (block.totalSize < 0 || block.pageSize <= 0) {
+            return false;
+        }
+        const uint32_t changed = stream->getBe32();
+        if (changed > block.pageCount()) {
+            return false;
+        }
+        block.changedPages.resize(changed);
+        block.pageKinds.resize(changed);
+        if (!stream->getBe32Array(block.changedPages.data(), changed) ||
+            stream->read(block.pageKinds.data(), changed) != static_cast<ssize_t>(changed)) {
+            return false;
+        }
+        uint32_t stored = 0;
+        for (uint32_t i = 0; i < changed; ++i) {
+            if (block.changedPages[i] >= block.pageCount() ||
+                (i && block.changedPages[i] <= block.changedPages[i - 1]) ||
+                block.pageKinds[i] > RamPageKind::Stored) {
+                return false;
+            }
+            stored += block.pageKinds[i] == RamPageKind::Stored;
+        }
+        if (stream->getBe32() != stored) {
+            return false;
+        }
+        block.storeOffsets.resize(stored);
+        block.pageHashes.resize(block.pageCount());
+        if (!stream->getBe64Array(block.storeOffsets.data(), stored) ||
+            !stream->getBe64Array(block.pageHashes.data(), block.pageHashes.size())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool loadRamDeltaChain(const std::vector<base::Stream*>& chain,
+                       const std::vector<RamBlock>& blocks,
+                       RamPageStore* store) {
+    std::unordered_map<std::string, const RamBlock*> byId;
+    for (const RamBlock& block : blocks) {
+        byId[block.id] = &block;
+    }
+
+    RamDeltaIndex prev;
+    for (size_t i = 0; i < chain.size(); ++i) {
+        RamDeltaIndex index;
+        if (!readRamDeltaIndex(chain[i], &index)) {
+            return false;
+        }
+        if (i == 0 ? !index.parentId.empty() : !linked(prev, index)) {
+            return false;
+        }
+
+        for (const RamDeltaBlock& block : index.blocks) {
+            auto it = byId.find(block.id);
+            if (it == byId.end() || it->second->totalSize != block.totalSize ||
+                it->second->pageSize != block.pageSize ||
+                (!store && !block.storeOffsets.empty())) {
+                return false;
+            }
+        }
+        for (const RamDeltaBlock& block : index.blocks) {
+            const RamBlock& ram = *byId[block.id];
+            size_t stored = 0;
+            // Consecutive zero pages are dropped together.
+            int64_t zeroStart = 0;
+            int64_t zeroEnd = 0;
+            for (size_t p = 0; p < block.changedPages.size(); ++p) {
+                const uint32_t page = block.changedPages[p];
+                const int64_t offset = int64_t(page) * block.pageSize;
+                const uint32_t size = block.pageBytes(page);
+                if (block.pageKinds[p] == RamPageKind::Zero) {
+                    if (offset != zeroEnd) {
+                        if (zeroEnd > zeroStart) {
+                            zeroRange(ram, zeroStart, zeroEnd - zeroStart);
+                        }
+                        zeroStart = offset;
+                    }
+                    zeroEnd = offset + size;
+                } else if (block.pageKinds[p] == RamPageKind::Stored) {
+                    if (!store->get(block.storeOffsets[stored++], ram.hostPtr + offset, size)) {
+                        return false;
+                    }
+                } else if (chain[i]->read(ram.hostPtr + offset, size) !=
+                           static_cast<ssize_t>(size)) {
+                    return false;
+                }
+            }
+            if (zeroEnd > zeroStart) {
+                zeroRange(ram, zeroStart, zeroEnd - zeroStart);
+            }
+        }
+        prev = std::move(index);
+    }
+    return !chain.empty();
+}
+
+bool resolveRamDeltaChain(const std::vector<base::StdioStream*>& chain,
+                          RamDeltaIndex* newest,
+                          std::vector<std::vector<RamPageSource>>* sources) {
+    if (chain.empty()) {
+        return false;
+    }
+
+    std::vector<RamDeltaIndex> indices(chain.size());
+    std::vector<int64_t> dataStart(chain.size());
+    for (size_t i = 0; i < chain.size(); ++i) {
+        if (!readRamDeltaIndex(chain[i], &indices[i]) ||
+            (i && !linked(indices[i - 1], indices[i]))) {
+            return false;
+        }
+        dataStart[i] = ftello(chain[i]->get());
+    }
+
+    const RamDeltaIndex& last = indices.back();
+    sources->assign(last.blocks.size(), {});
+    for (size_t i = 0; i < chain.size(); ++i) {
+        int64_t filePos = dataStart[i];
+        for (const RamDeltaBlock& block : indices[i].blocks) {
+            size_t b = 0;
+            while (last.blocks[b].id != block.id) {
+                ++b;
+            }
+            std::vector<RamPageSource>& blockSources = (*sources)[b];
+            blockSources.resize(block.pageCount());
+            size_t stored = 0;
+            for (size_t p = 0; p < block.changedPages.size(); ++p) {
+                const uint32_t page = block.changedPages[p];
+                RamPageSource& source = blockSources[page];
+                source.delta = int32_t(i);
+                source.kind = block.pageKinds[p];
+                if (source.kind == RamPageKind::Inline) {
+                    source.pos = filePos;
+                    filePos += block.pageBytes(page);
+                } else if (source.kind == RamPageKind::Stored) {
+                    source.pos = block.storeOffsets[stored++];
+                }
+            }
+        }
+    }
+
+    *newest = std::move(indices.back());
+    newest->parentId = indices.front().parentId;
+    return true;
+}
+
+bool loadRamDeltaChainParallel(const std::vector<base::StdioStream*>& chain,
+                               const std::vector<RamBlock>& blocks,
+                               RamPageStore* store,
+                               const RamLoadOptions& options) {
+    RamDeltaIndex index;
+    std::vector<std::vector<RamPageSource>> sources;
+    if (!resolveRamDeltaChain(chain, &index, &sources) || !index.parentId.empty() ||
+        index.blocks.size() != blocks.size()) {
+        return false;
+    }
+
+    // Put the index in the order of |blocks|.
+    std::vector<RamDeltaBlock> layouts(blocks.size());
+    std::vector<std::vector<RamPageSource>> ordered(blocks.size());
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        size_t i = 0;
+        while (i < index.blocks.size() && index.blocks[i].id != blocks[b].id) {
+            ++i;
+        }
+        if (i == index.blocks.size()) {
+            return false;
+        }
+        layouts[b] = std::move(index.blocks[i]);
+        ordered[b] = std::move(sources[i]);
+    }
+    return loadResolvedRamPages(chain, layouts, ordered, blocks, store, options);
+}
+
+bool loadResolvedRamPages(const std::vector<base::StdioStream*>& chain,
+                          const std::vector<RamDeltaBlock>& layouts,
+                          const std::vector<std::vector<RamPageSource>>& sources,
+                          const std::vector<RamBlock>& blocks,
+                          RamPageStore* store,
+                          const RamLoadOptions& options) {
+    if (layouts.size() != blocks.size() || sources.size() != blocks.size()) {
+        return false;
+    }
+
+    struct Chunk {
+        size_t block;
+        uint32_t begin;
+        uint32_t end;
+    };
+    std::vector<Chunk> chunks;
+    const uint32_t chunkPages = std::max<uint32_t>(options.chunkPages, 1);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const RamDeltaBlock& layout = layouts[b];
+        if (layout.totalSize != blocks[b].totalSize || layout.pageSize != blocks[b].pageSize ||
+            sources[b].size() != layout.pageCount()) {
+            return false;
+        }
+        for (uint32_t page = 0; page < layout.pageCount(); page += chunkPages) {
+            chunks.push_back({b, page, std::min(layout.pageCount(), page + chunkPages)});
+        }
+    }
+
+    std::atomic<bool> failed{false};
+    base::Lock readLock;
+    auto loadChunk = [&](size_t c) {
+        if (failed.load(std::memory_order_relaxed)) {
+            return;
+        }
+        const Chunk& chunk = chunks[c];
+        const RamBlock& ram = blocks[chunk.block];
+        const RamDeltaBlock& layout = layouts[chunk.block];
+        const std::vector<RamPageSource>& pages = sources[chunk.block];
+        for (uint32_t page = chunk.begin; page < chunk.end;) {
+            const RamPageSource& first = pages[page];
+            const bool zero = isZeroSource(first);
+            const int64_t offset = int64_t(page) * layout.pageSize;
+            int64_t size = layout.pageBytes(page);
+            uint32_t end = page + 1;
+            // Zero pages go together, and so do inline pages that follow
+            // each other in one delta.
+            while (end < chunk.end && first.kind != RamPageKind::Stored) {
+                const RamPageSource& next = pages[end];
+                if (zero ? !isZeroSource(next)
+                         : next.kind != RamPageKind::Inline || next.delta != first.delta ||
+                                   next.pos != first.pos + uint64_t(size)) {
+                    break;
+                }
+                size += layout.pageBytes(end);
+                ++end;
+            }
+
+            bool ok = true;
+            if (zero) {
+                zeroRange(ram, offset, size);
+            } else if (first.kind == RamPageKind::Stored) {
+                ok = store && store->get(first.pos, ram.hostPtr + offset, size);
+            } else {
+                ok = size_t(first.delta) < chain.size() &&
+                     readAt(chain[first.delta], &readLock, first.pos, ram.hostPtr + offset,
+                            size);
+            }
+            if (!ok) {
+                failed.store(true, std::memory_order_relaxed);
+                return;
+            }
+            page = end;
+        }
+    };
+
+    int threads = options.threads > 0 ? options.threads : std::max(1, base::getCpuCoreCount());
+    threads = std::min(threads, std::max(1, options.maxReadsInFlight));
+    threads = static_cast<int>(std::min<size_t>(threads, chunks.size()));
+    if (threads > 1) {
+        base::ThreadPool<std::function<void()>> pool(
+                threads, [](std::function<void()>&& task) { task(); });
+        if (pool.start()) {
+            for (size_t c = 0; c < chunks.size(); ++c) {
+                pool.enqueue([&loadChunk, c] { loadChunk(c); });
+            }
+            pool.done();
+            pool.join();
+            return !failed;
+        }
+    }
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        loadChunk(c);
+    }
+    return !failed;
+}
+
+bool mergeRamDeltas(const std::vector<base::StdioStream*>& chain, base::Stream* out) {
+    RamDeltaIndex merged;
+    std::vector<std::vector<RamPageSource>> sources;
+    if (!resolveRamDeltaChain(chain, &merged, &sources)) {
+        return false;
+    }
+
+    for (size_t b = 0; b < merged.blocks.size(); ++b) {
+        RamDeltaBlock& block = merged.blocks[b];
+        block.changedPages.clear();
+        block.pageKinds.clear();
+        block.storeOffsets.clear();
+        for (uint32_t page = 0; page < block.pageCount(); ++page) {
+            const RamPageSource& source = sources[b][page];
+            if (source.delta < 0) {
+                continue;
+            }
+            block.changedPages.push_back(page);
+            block.pageKinds.push_back(source.kind);
+            if (source.kind == RamPageKind::Stored) {
+                block.storeOffsets.push_back(source.pos);
+            }
+        }
+    }
+
+    writeIndex(out, merged);
+    std::vector<uint8_t> buffer;
+    for (size_t b = 0; b < merged.blocks.size(); ++b) {
+        const RamDeltaBlock& block = merged.blocks[b];
+        buffer.resize(block.pageSize);
+        for (uint32_t page : block.changedPages) {
+            const RamPageSource& source = sources[b][page];
+            if (source.kind != RamPageKind::Inline) {
+                continue;
+            }
+            FILE* file = chain[source.delta]->get();
+            const uint32_t size = block.pageBytes(page);
+            if (HANDLE_EINTR(fseeko(file, source.pos, SEEK_SET)) ||
+                fread(buffer.data(), 1, size, file) != size) {
+                return false;
+            }
+            out->write(buffer.data(), size);
+        }
+    }
+    return true;
+}
+
+}  // namespace snapshot
+}  // namespace android
@@ -0,0 +1,94 @@
+/*
+* Copyright (C) 2026 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "snapshot/RestoreAheadWorker.h"
+
+#include <utility>
+
+using android::base::AutoLock;
+
+namespace android {
+namespace snapshot {
+
+RestoreAheadWorker::~RestoreAheadWorker() {
+    stop();
+}
+
+void RestoreAheadWorker::addTask(int priority, std::function<void()> restore) {
+    AutoLock lock(mLock);
+    mTasks.push({priority, mNextSeq++, std::move(restore)});
+    mCv.broadcastAndUnlock(&lock);
+}
+
+void RestoreAheadWorker::start() {
+    AutoLock lock(mLock);
+    if (mThread) {
+        return;
+    }
+    mStopping = false;
+    mThread.reset(new base::FunctorThread([this] { workerLoop(); }));
+    mThread->start();
+}
+
+void RestoreAheadWorker::stop() {
+    std::unique_ptr<base::FunctorThread> thread;
+    {
+        AutoLock lock(mLock);
+        mStopping = true;
+        mTasks = {};
+        thread = std::move(mThread);
+        mCv.broadcastAndUnlock(&lock);
+    }
+    if (thread) {
+        thread->wait();
+    }
+}
+
+void RestoreAheadWorker::waitIdle() {
+    AutoLock lock(mLock);
+    mCv.wait(&lock, [this] { return mStopping || (mTasks.empty() && !mBusy); });
+}
+
+size_t RestoreAheadWorker::pending() const {
+    AutoLock lock(mLock);
+    return mTasks.size();
+}
+
+void RestoreAheadWorker::workerLoop() {
+    AutoLock lock(mLock);
+    for (;;) {
+        mCv.wait(&lock, [this] { return mStopping || !mTasks.empty(); });
+        if (mStopping) {
+            return;
+        }
+        // top() is const; the task is popped right away.
+        std::function<void()> restore = std::move(const_cast<Task&>(mTasks.top()).restore);
+        mTasks.pop();
+        mBusy = true;
+        lock.unlock();
+
+        restore();
+
+        lock.lock();
+        mBusy = false;
+        if (mTasks.empty()) {
+            mCv.broadcast();
+        }
+    }
+}
+
+}  // namespace snapshot
+}  // namespace android
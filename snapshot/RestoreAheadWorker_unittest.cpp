@@ -0,0 +1,193 @@
+/*
+* Copyright (C) 2026 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "snapshot/RestoreAheadWorker.h"
+
+#include <gtest/gtest.h>
+
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/threads/FunctorThread.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace snapshot {
+namespace {
+
+using base::AutoLock;
+using base::FunctorThread;
+using base::Lock;
+
+// Records the order objects were touched in.
+class TouchLog {
+public:
+    void record(int id) {
+        AutoLock lock(mLock);
+        mIds.push_back(id);
+    }
+
+    std::vector<int> ids() const {
+        AutoLock lock(mLock);
+        return mIds;
+    }
+
+private:
+    mutable Lock mLock;
+    std::vector<int> mIds;
+};
+
+// Stands in for a LazySnapshotObj. touch() waits while |hold| is set.
+struct FakeObj {
+    FakeObj(TouchLog* log, int id) : log(log), id(id) {}
+
+    void touch() {
+        entered = true;
+        while (hold) std::this_thread::yield();
+        log->record(id);
+    }
+
+    TouchLog* log;
+    int id;
+    std::atomic<bool> hold{false};
+    std::atomic<bool> entered{false};
+};
+
+std::vector<std::shared_ptr<FakeObj>> makeObjs(TouchLog* log, int count) {
+    std::vector<std::shared_ptr<FakeObj>> objs;
+    for (int i = 0; i < count; ++i) {
+        objs.push_back(std::make_shared<FakeObj>(log, i));
+    }
+    return objs;
+}
+
+// Tests that higher priorities go first, and equal ones in the order added.
+TEST(RestoreAheadWorker, PriorityOrder) {
+    TouchLog log;
+    auto objs = makeObjs(&log, 5);
+
+    RestoreAheadWorker worker;
+    worker.add(objs[0], 0);
+    worker.add(objs[1], 2);
+    worker.add(objs[2], 1);
+    worker.add(objs[3], 2);
+    worker.add(objs[4], 0);
+    EXPECT_EQ(5u, worker.pending());
+
+    worker.start();
+    worker.waitIdle();
+    EXPECT_EQ((std::vector<int>{1, 3, 2, 0, 4}), log.ids());
+    EXPECT_EQ(0u, worker.pending());
+}
+
+// Tests that objects destroyed before their turn are skipped.
+TEST(RestoreAheadWorker, SkipsDestroyedObjects) {
+    TouchLog log;
+    auto objs = makeObjs(&log, 3);
+
+    RestoreAheadWorker worker;
+    for (auto& obj : objs) {
+        worker.add(obj);
+    }
+    objs[1].reset();
+
+    worker.start();
+    worker.waitIdle();
+    EXPECT_EQ((std::vector<int>{0, 2}), log.ids());
+}
+
+// Tests that objects added after start() are restored too.
+TEST(RestoreAheadWorker, AddAfterStart) {
+    TouchLog log;
+    auto objs = makeObjs(&log, 2);
+
+    RestoreAheadWorker worker;
+    worker.start();
+    worker.add(objs[0]);
+    worker.waitIdle();
+    worker.add(objs[1]);
+    worker.waitIdle();
+    EXPECT_EQ((std::vector<int>{0, 1}), log.ids());
+}
+
+// Tests that stop() waits for the restore in progress and drops the rest.
+TEST(RestoreAheadWorker, StopMidQueue) {
+    TouchLog log;
+    auto objs = makeObjs(&log, 4);
+    objs[0]->hold = true;
+
+    RestoreAheadWorker worker;
+    for (auto& obj : objs) {
+        worker.add(obj);
+    }
+    worker.start();
+    while (!objs[0]->entered) std::this_thread::yield();
+
+    std::atomic<bool> stopped{false};
+    FunctorThread stopper([&worker, &stopped] {
+        worker.stop();
+        stopped = true;
+    });
+    stopper.start();
+    while (worker.pending()) std::this_thread::yield();
+    EXPECT_FALSE(stopped);
+
+    objs[0]->hold = false;
+    stopper.wait();
+    EXPECT_TRUE(stopped);
+    EXPECT_EQ((std::vector<int>{0}), log.ids());
+
+    // Nothing more once stopped, and waitIdle() doesn't hang.
+    worker.add(objs[1]);
+    worker.waitIdle();
+    EXPECT_EQ((std::vector<int>{0}), log.ids());
+}
+
+// Tests that waitIdle() returns only once the last restore has finished,
+// not when the queue empties.
+TEST(RestoreAheadWorker, WaitIdleWaitsForLastRestore) {
+    TouchLog log;
+    auto objs = makeObjs(&log, 2);
+    objs[1]->hold = true;
+
+    RestoreAheadWorker worker;
+    for (auto& obj : objs) {
+        worker.add(obj);
+    }
+    worker.start();
+    while (!objs[1]->entered) std::this_thread::yield();
+    EXPECT_EQ(0u, worker.pending());
+
+    std::atomic<bool> idle{false};
+    FunctorThread waiter([&worker, &idle] {
+        worker.waitIdle();
+        idle = true;
+    });
+    waiter.start();
+    for (int i = 0; i < 100; ++i) std::this_thread::yield();
+    EXPECT_FALSE(idle);
+
+    objs[1]->hold = false;
+    waiter.wait();
+    EXPECT_TRUE(idle);
+    EXPECT_EQ((std::vector<int>{0, 1}), log.ids());
+}
+
+}  // namespace
+}  // namespace snapshot
+}  // namespace android
@@ -0,0 +1,467 @@
+/*
+* Copyright (C) 2026 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "snapshot/SaveProfile.h"
+
+#include "aemu/base/files/StdioStream.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+using android::base::CodecOptions;
+using android::base::CompressionCodec;
+using android::base::StdioStream;
+
+namespace android {
+namespace snapshot {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x53505246;  // "SPRF"
+constexpr uint32_t kVersion = 1;
+
+constexpr double kMB = 1024.0 * 1024.0;
+
+// Bytes per microsecond, i.e. MB/s, when there is nothing to go by.
+constexpr double kDefaultDiskRate = 200.0;
+
+// The codecs plan() picks from, with what to expect of them on a single
+// thread until saves with them have been recorded.
+struct CodecGuess {
+    CompressionCodec codec;
+    int level;
+    double rate;  // input bytes per CPU microsecond
+    double ratio;  // output bytes per input byte
+};
+
+constexpr CodecGuess kCodecGuesses[] = {
+        {CompressionCodec::Lz4, 0, 400.0, 0.50},
+        {CompressionCodec::Zstd, 1, 250.0, 0.38},
+        {CompressionCodec::Zstd, 3, 120.0, 0.33},
+        {CompressionCodec::Lz4Hc, 0, 40.0, 0.42},
+};
+
+// What the recent records say about this machine and this guest.
+struct SaveRates {
+    bool known = false;
+    double diskRate = kDefaultDiskRate;
+    // Per kCodecGuesses entry.
+    double codecRate[std::size(kCodecGuesses)];
+    double codecRatio[std::size(kCodecGuesses)];
+    // Raw bytes per stage of a full save.
+    uint64_t rawBytes[kSaveStages] = {};
+    // The part of guest RAM an incremental save writes.
+    double dirtyFraction = 1.0;
+    // Per stage time spent on neither compression nor writing, such as
+    // texture readbacks and device serialization.
+    uint64_t otherUs[kSaveStages] = {};
+};
+
+size_t findCodec(CompressionCodec codec, int level) {
+    for (size_t i = 0; i < std::size(kCodecGuesses); ++i) {
+        if (kCodecGuesses[i].codec == codec && kCodecGuesses[i].level == level) {
+            return i;
+        }
+    }
+    return std::size(kCodecGuesses);
+}
+
+// The larger of compressing and writing, which overlap, plus the rest.
+uint64_t stageBoundUs(const SaveStageRecord& stage, uint32_t workers) {
+    return std::max(stage.compressUs / std::max(workers, 1u), stage.writeUs);
+}
+
+SaveRates computeRates(const std::vector<SaveRecord>& records) {
+    SaveRates rates;
+    for (size_t i = 0; i < std::size(kCodecGuesses); ++i) {
+        rates.codecRate[i] = kCodecGuesses[i].rate;
+        rates.codecRatio[i] = kCodecGuesses[i].ratio;
+    }
+    if (records.empty()) {
+        return rates;
+    }
+    rates.known = true;
+
+    const size_t first = records.size() > SaveProfile::kRecentRecords
+                                 ? records.size() - SaveProfile::kRecentRecords
+                                 : 0;
+    uint64_t written = 0;
+    uint64_t writeUs = 0;
+    uint64_t codecRaw[std::size(kCodecGuesses)] = {};
+    uint64_t codecWritten[std::size(kCodecGuesses)] = {};
+    uint64_t codecUs[std::size(kCodecGuesses)] = {};
+    for (size_t r = first; r < records.size(); ++r) {
+        const SaveRecord& record = records[r];
+        const size_t codec = findCodec(record.codec, record.level);
+        for (const SaveStageRecord& stage : record.stages) {
+            written += stage.writtenBytes;
+            writeUs += stage.writeUs;
+            if (codec < std::size(kCodecGuesses)) {
+                codecRaw[codec] += stage.rawBytes;
+                codecWritten[codec] += stage.writtenBytes;
+                codecUs[codec] += stage.compressUs;
+            }
+        }
+    }
+    if (written && writeUs) {
+        rates.diskRate = double(written) / writeUs;
+    }
+    // Codecs not used lately are assumed to compare to a measured one as
+    // the guesses do, since the data matters more than the codec.
+    double rateScale = 1.0;
+    double ratioScale = 1.0;
+    for (size_t i = 0; i < std::size(kCodecGuesses); ++i) {
+        if (codecRaw[i] && codecUs[i]) {
+            rateScale = double(codecRaw[i]) / codecUs[i] / kCodecGuesses[i].rate;
+            ratioScale = double(codecWritten[i]) / codecRaw[i] /
+                         kCodecGuesses[i].ratio;
+            break;
+        }
+    }
+    for (size_t i = 0; i < std::size(kCodecGuesses); ++i) {
+        if (codecRaw[i] && codecUs[i]) {
+            rates.codecRate[i] = double(codecRaw[i]) / codecUs[i];
+            rates.codecRatio[i] = double(codecWritten[i]) / codecRaw[i];
+        } else {
+            rates.codecRate[i] *= rateScale;
+            rates.codecRatio[i] = std::min(1.0, rates.codecRatio[i] * ratioScale);
+        }
+    }
+
+    // Sizes and fixed costs follow the guest, so only the last save counts.
+    const SaveRecord& last = records.back();
+    for (size_t s = 0; s < kSaveStages; ++s) {
+        const SaveStageRecord& stage = last.stages[s];
+        rates.rawBytes[s] = stage.rawBytes;
+        const uint64_t boundUs = stageBoundUs(stage, last.workers);
+        rates.otherUs[s] = stage.durationUs > boundUs ? stage.durationUs - boundUs
+                                                      : 0;
+    }
+    const size_t ram = static_cast<size_t>(SaveStage::Ram);
+    if (last.incremental) {
+        rates.rawBytes[ram] = last.ramSize;
+    }
+    for (auto it = records.rbegin(); it != records.rend(); ++it) {
+        if (it->incremental && it->ramSize) {
+            rates.dirtyFraction =
+                    std::min(1.0, double(it->stages[ram].rawBytes) / it->ramSize);
+            break;
+        }
+    }
+    return rates;
+}
+
+struct StagePrediction {
+    uint64_t rawBytes = 0;
+    uint64_t bytes = 0;
+    uint64_t compressUs = 0;  // wall time, over all workers
+    uint64_t writeUs = 0;
+    uint64_t us = 0;
+};
+
+StagePrediction predictStage(const SaveRates& rates,
+                             size_t stage,
+                             size_t codec,
+                             uint32_t workers,
+                             bool incremental) {
+    StagePrediction prediction;
+    prediction.rawBytes = rates.rawBytes[stage];
+    if (incremental && stage == static_cast<size_t>(SaveStage::Ram)) {
+        prediction.rawBytes = uint64_t(prediction.rawBytes * rates.dirtyFraction);
+    }
+    prediction.bytes = uint64_t(prediction.rawBytes * rates.codecRatio[codec]);
+    prediction.compressUs = uint64_t(prediction.rawBytes /
+                                     (rates.codecRate[codec] * workers));
+    prediction.writeUs = uint64_t(prediction.bytes / rates.diskRate);
+    prediction.us = rates.otherUs[stage] +
+                    std::max(prediction.compressUs, prediction.writeUs);
+    return prediction;
+}
+
+std::string formatReason(SaveStage stage,
+                         const SaveStageRecord& actual,
+                         uint32_t workers,
+                         const StagePrediction* expected) {
+    char buf[256];
+    const uint64_t compressWallUs = actual.compressUs / std::max(workers, 1u);
+    const uint64_t boundUs = std::max(compressWallUs, actual.writeUs);
+    if (expected && expected->rawBytes &&
+        actual.rawBytes > expected->rawBytes + expected->rawBytes / 4) {
+        snprintf(buf, sizeof(buf), "%s: %.0f MB to save, expected %.0f MB",
+                 saveStageName(stage), actual.rawBytes / kMB,
+                 expected->rawBytes / kMB);
+    } else if (actual.durationUs > 2 * boundUs) {
+        snprintf(buf, sizeof(buf),
+                 "%s: %.0f ms outside compression and writing",
+                 saveStageName(stage), (actual.durationUs - boundUs) / 1000.0);
+    } else if (actual.writeUs >= compressWallUs) {
+        const double rate =
+                actual.writeUs ? double(actual.writtenBytes) / actual.writeUs : 0;
+        const double expectedRate =
+                expected && expected->writeUs
+                        ? double(expected->bytes) / expected->writeUs
+                        : 0;
+        snprintf(buf, sizeof(buf),
+                 "%s: disk bound, %.0f MB at %.0f MB/s, expected %.0f MB/s",
+                 saveStageName(stage), actual.writtenBytes / kMB, rate,
+                 expectedRate);
+    } else {
+        const double rate =
+                compressWallUs ? double(actual.rawBytes) / compressWallUs : 0;
+        const double expectedRate =
+                expected && expected->compressUs
+                        ? double(expected->rawBytes) / expected->compressUs
+                        : 0;
+        snprintf(buf, sizeof(buf),
+                 "%s: compression bound, %.0f MB at %.0f MB/s on %u threads, "
+                 "expected %.0f MB/s",
+                 saveStageName(stage), actual.rawBytes / kMB, rate, workers,
+                 expectedRate);
+    }
+    return buf;
+}
+
+void writeStage(base::Stream* stream, const SaveStageRecord& stage) {
+    stream->putBe64(stage.rawBytes);
+    stream->putBe64(stage.writtenBytes);
+    stream->putBe64(stage.compressUs);
+    stream->putBe64(stage.writeUs);
+    stream->putBe64(stage.durationUs);
+}
+
+void readStage(base::Stream* stream, SaveStageRecord* stage) {
+    stage->rawBytes = stream->getBe64();
+    stage->writtenBytes = stream->getBe64();
+    stage->compressUs = stream->getBe64();
+    stage->writeUs = stream->getBe64();
+    stage->durationUs = stream->getBe64();
+}
+
+}  // namespace
+
+const char* saveStageName(SaveStage stage) {
+    switch (stage) {
+        case SaveStage::Ram:
+            return "ram";
+        case SaveStage::Textures:
+            return "textures";
+        case SaveStage::Devices:
+            return "devices";
+    }
+    return "unknown";
+}
+
+uint64_t SaveRecord::totalUs() const {
+    uint64_t total = 0;
+    for (const SaveStageRecord& s : stages) {
+        total += s.durationUs;
+    }
+    return total;
+}
+
+SaveProfile::SaveProfile(std::string path) : mPath(std::move(path)) {}
+
+bool SaveProfile::load() {
+    mRecords.clear();
+    FILE* file = fopen(mPath.c_str(), "rb");
+    if (!file) {
+        return true;
+    }
+    StdioStream stream(file, StdioStream::kOwner);
+    if (stream.getBe32() != kMagic || stream.getBe32() != kVersion) {
+        return false;
+    }
+    const uint32_t count = stream.getBe32();
+    if (count > kMaxRecords) {
+        return false;
+    }
+    mRecords.resize(count);
+    for (SaveRecord& record : mRecords) {
+        record.codec = static_cast<CompressionCodec>(stream.getBe32());
+        record.level = static_cast<int32_t>(stream.getBe32());
+        record.workers = stream.getBe32();
+        record.incremental = stream.getByte() != 0;
+        record.ramSize = stream.getBe64();
+        for (SaveStageRecord& stage : record.stages) {
+            readStage(&stream, &stage);
+        }
+    }
+    if (ferror(stream.get()) || feof(stream.get())) {
+        mRecords.clear();
+        return false;
+    }
+    return true;
+}
+
+bool SaveProfile::save() const {
+    const std::string tmpPath = mPath + ".tmp";
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    {
+        StdioStream stream(file, StdioStream::kOwner);
+        stream.putBe32(kMagic);
+        stream.putBe32(kVersion);
+        stream.putBe32(mRecords.size());
+        for (const SaveRecord& record : mRecords) {
+            stream.putBe32(static_cast<uint32_t>(record.codec));
+            stream.putBe32(static_cast<uint32_t>(record.level));
+            stream.putBe32(record.workers);
+            stream.putByte(record.incremental);
+            stream.putBe64(record.ramSize);
+            for (const SaveStageRecord& stage : record.stages) {
+                writeStage(&stream, stage);
+            }
+        }
+        if (fflush(stream.get()) != 0 || ferror(stream.get())) {
+            stream.close();
+            remove(tmpPath.c_str());
+            return false;
+        }
+    }
+#ifdef _WIN32
+    remove(mPath.c_str());
+#endif
+    return rename(tmpPath.c_str(), mPath.c_str()) == 0;
+}
+
+void SaveProfile::add(const SaveRecord& record) {
+    mRecords.push_back(record);
+    if (mRecords.size() > kMaxRecords) {
+        mRecords.erase(mRecords.begin(),
+                       mRecords.begin() + (mRecords.size() - kMaxRecords));
+    }
+}
+
+SavePlan SaveProfile::plan(uint64_t budgetUs,
+                           uint32_t maxWorkers,
+                           bool canIncremental) const {
+    maxWorkers = std::max(maxWorkers, 1u);
+    const SaveRates rates = computeRates(mRecords);
+    if (!rates.known) {
+        // Nothing to go by: a codec that is cheap everywhere, all threads.
+        SavePlan plan;
+        plan.codec = CodecOptions::forPayload(base::PayloadClass::Ram);
+        plan.workers = maxWorkers;
+        plan.incremental = canIncremental;
+        return plan;
+    }
+
+    SavePlan best;
+    bool haveBest = false;
+    for (size_t codec = 0; codec < std::size(kCodecGuesses); ++codec) {
+        if (!base::isCodecAvailable(kCodecGuesses[codec].codec)) {
+            continue;
+        }
+        for (int incremental = 0; incremental <= int(canIncremental);
+             ++incremental) {
+            // Fewer threads leave more CPU to the rest of the emulator, so
+            // try them first and keep them on ties.
+            for (uint32_t workers = 1; workers <= maxWorkers;
+                 workers = workers == maxWorkers ? maxWorkers + 1
+                                                 : std::min(workers * 2,
+                                                            maxWorkers)) {
+                SavePlan candidate;
+                candidate.codec.codec = kCodecGuesses[codec].codec;
+                candidate.codec.level = kCodecGuesses[codec].level;
+                candidate.workers = workers;
+                candidate.incremental = incremental != 0;
+                for (size_t s = 0; s < kSaveStages; ++s) {
+                    const StagePrediction stage = predictStage(
+                            rates, s, codec, workers, candidate.incremental);
+                    candidate.predictedUs += stage.us;
+                    candidate.predictedBytes += stage.bytes;
+                }
+                candidate.fitsBudget = candidate.predictedUs <= budgetUs;
+
+                bool better;
+                if (!haveBest) {
+                    better = true;
+                } else if (candidate.fitsBudget != best.fitsBudget) {
+                    better = candidate.fitsBudget;
+                } else if (candidate.fitsBudget) {
+                    better = candidate.predictedBytes < best.predictedBytes;
+                } else {
+                    better = candidate.predictedUs < best.predictedUs;
+                }
+                if (better) {
+                    best = candidate;
+                    haveBest = true;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+SaveBudgetReport SaveProfile::check(const SaveRecord& record,
+                                    const SavePlan& plan,
+                                    uint64_t budgetUs) const {
+    SaveBudgetReport report;
+    report.budgetUs = budgetUs;
+    report.actualUs = record.totalUs();
+    report.missed = report.actualUs > budgetUs;
+    if (!report.missed) {
+        return report;
+    }
+
+    const SaveRates rates = computeRates(mRecords);
+    const size_t codec = findCodec(record.codec, record.level);
+    const bool havePrediction =
+            rates.known && codec < std::size(kCodecGuesses);
+    StagePrediction expected[kSaveStages];
+    int64_t worstOverrun = INT64_MIN;
+    for (size_t s = 0; s < kSaveStages; ++s) {
+        if (havePrediction) {
+            expected[s] = predictStage(rates, s, codec,
+                                       std::max(record.workers, 1u),
+                                       record.incremental);
+        }
+        const int64_t overrun = int64_t(record.stages[s].durationUs) -
+                                int64_t(expected[s].us);
+        if (overrun > worstOverrun) {
+            worstOverrun = overrun;
+            report.stage = static_cast<SaveStage>(s);
+        }
+    }
+
+    const size_t s = static_cast<size_t>(report.stage);
+    report.reason = formatReason(report.stage, record.stages[s],
+                                 record.workers,
+                                 havePrediction ? &expected[s] : nullptr);
+    if (!plan.fitsBudget) {
+        report.reason += "; no settings were expected to fit the budget";
+    }
+    return report;
+}
+
+bool SaveProfile::areSavesSlow(uint64_t budgetUs) const {
+    const size_t first = mRecords.size() > kRecentRecords
+                                 ? mRecords.size() - kRecentRecords
+                                 : 0;
+    size_t slow = 0;
+    for (size_t r = first; r < mRecords.size(); ++r) {
+        slow += mRecords[r].totalUs() > budgetUs;
+    }
+    return slow * 2 > mRecords.size() - first;
+}
+
+}  // namespace snapshot
+}  // namespace android
@@ -0,0 +1,218 @@
+/*
+* Copyright (C) 2026 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "snapshot/SharedRamImage.h"
+
+#include "aemu/base/EintrWrapper.h"
+#include "aemu/base/files/MemStream.h"
+#include "aemu/base/memory/MemoryHints.h"
+
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace android {
+namespace snapshot {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x41525349;  // "ARSI"
+constexpr uint32_t kVersion = 1;
+// Covers the largest host page size, so every block can be mapped.
+constexpr int64_t kBlockAlignment = 64 * 1024;
+
+struct ImageBlock {
+    std::string id;
+    int64_t totalSize = 0;
+    int32_t pageSize = 0;
+    int64_t offset = 0;
+};
+
+struct ImageHeader {
+    std::string id;
+    std::vector<ImageBlock> blocks;
+};
+
+int64_t alignUp(int64_t value) {
+    return (value + kBlockAlignment - 1) & ~(kBlockAlignment - 1);
+}
+
+void writeHeader(base::Stream* stream, const ImageHeader& header) {
+    stream->putBe32(kMagic);
+    stream->putBe32(kVersion);
+    stream->putString(header.id);
+    stream->putBe32(header.blocks.size());
+    for (const ImageBlock& block : header.blocks) {
+        stream->putString(block.id);
+        stream->putBe64(block.totalSize);
+        stream->putBe32(block.pageSize);
+        stream->putBe64(block.offset);
+    }
+}
+
+bool readHeader(const std::string& path, ImageHeader* header) {
+    base::StdioStream file(fopen(path.c_str(), "rb"), base::StdioStream::kOwner);
+    if (!file.get() || file.getBe32() != kMagic || file.getBe32() != kVersion) {
+        return false;
+    }
+    header->id = file.getString();
+    header->blocks.resize(file.getBe32());
+    for (ImageBlock& block : header->blocks) {
+        block.id = file.getString();
+        block.totalSize = file.getBe64();
+        block.pageSize = file.getBe32();
+        block.offset = file.getBe64();
+        if (block.totalSize < 0 || block.pageSize <= 0 || block.offset % kBlockAlignment) {
+            return false;
+        }
+    }
+    return !ferror(file.get()) && !feof(file.get());
+}
+
+}  // namespace
+
+std::string sharedRamImageId(const std::string& path) {
+    ImageHeader header;
+    return readHeader(path, &header) ? header.id : std::string();
+}
+
+bool prepareSharedRamImage(const std::vector<base::StdioStream*>& chain,
+                           const std::string& path,
+                           RamPageStore* store) {
+#ifdef _WIN32
+    return false;
+#else
+    RamDeltaIndex index;
+    std::vector<std::vector<RamPageSource>> sources;
+    if (!resolveRamDeltaChain(chain, &index, &sources) || !index.parentId.empty()) {
+        return false;
+    }
+    if (sharedRamImageId(path) == index.id) {
+        return true;
+    }
+
+    // The offsets are fixed width, so the header's size doesn't depend on
+    // them.
+    ImageHeader header;
+    header.id = index.id;
+    for (const RamDeltaBlock& block : index.blocks) {
+        header.blocks.push_back({block.id, block.totalSize, block.pageSize, 0});
+    }
+    base::MemStream headerBytes;
+    writeHeader(&headerBytes, header);
+    int64_t size = alignUp(headerBytes.writtenSize());
+    for (ImageBlock& block : header.blocks) {
+        block.offset = size;
+        size = alignUp(size + block.totalSize);
+    }
+    headerBytes = base::MemStream();
+    writeHeader(&headerBytes, header);
+
+    const std::string tempPath = path + ".tmp";
+    const int fd =
+            HANDLE_EINTR(open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+    if (fd < 0) {
+        return false;
+    }
+    void* mapping = MAP_FAILED;
+    if (!ftruncate(fd, size)) {
+        mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    bool ok = mapping != MAP_FAILED;
+    if (ok) {
+        // Restore into the file as if it were guest RAM. Zero pages are
+        // dropped from the mapping, which leaves the file's holes alone.
+        std::vector<RamBlock> blocks;
+        for (const ImageBlock& block : header.blocks) {
+            RamBlock ram = {};
+            ram.id = block.id;
+            ram.hostPtr = static_cast<uint8_t*>(mapping) + block.offset;
+            ram.totalSize = block.totalSize;
+            ram.pageSize = block.pageSize;
+            blocks.push_back(std::move(ram));
+        }
+        ok = loadResolvedRamPages(chain, index.blocks, sources, blocks, store);
+        ok = !msync(mapping, size, MS_SYNC) && ok;
+        munmap(mapping, size);
+    }
+    // The header goes last, so an image cut short has none.
+    const std::vector<char>& bytes = headerBytes.buffer();
+    ok = ok && HANDLE_EINTR(pwrite(fd, bytes.data(), bytes.size(), 0)) == ssize_t(bytes.size()) &&
+         !fsync(fd);
+    close(fd);
+    if (!ok || rename(tempPath.c_str(), path.c_str())) {
+        unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool mapSharedRamImage(const std::string& path, const std::vector<RamBlock>& blocks) {
+#ifdef _WIN32
+    return false;
+#else
+    ImageHeader header;
+    if (!readHeader(path, &header)) {
+        return false;
+    }
+    const int fd = HANDLE_EINTR(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st)) {
+        close(fd);
+        return false;
+    }
+
+    const uint64_t hostPage = base::memoryPageSize();
+    std::vector<const ImageBlock*> found;
+    for (const RamBlock& ram : blocks) {
+        const ImageBlock* block = nullptr;
+        for (const ImageBlock& candidate : header.blocks) {
+            if (candidate.id == ram.id) {
+                block = &candidate;
+            }
+        }
+        if (!block || block->totalSize != ram.totalSize || block->pageSize != ram.pageSize ||
+            block->offset + block->totalSize > st.st_size ||
+            reinterpret_cast<uintptr_t>(ram.hostPtr) % hostPage ||
+            (ram.flags & SNAPSHOT_RAM_MAPPED)) {
+            close(fd);
+            return false;
+        }
+        found.push_back(block);
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < blocks.size() && ok; ++i) {
+        ok = mmap(blocks[i].hostPtr, blocks[i].totalSize, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_FIXED, fd, found[i]->offset) != MAP_FAILED;
+    }
+    // The mappings keep the file open.
+    close(fd);
+    return ok;
+#endif
+}
+
+}  // namespace snapshot
+}  // namespace android
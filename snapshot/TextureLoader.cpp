@@ -17,18 +17,61 @@
 #include "snapshot/TextureLoader.h"
 
 #include "aemu/base/EintrWrapper.h"
+#include "aemu/base/Hash.h"
 #include "aemu/base/files/DecompressingStream.h"
+#include "aemu/base/memory/MemoryHints.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
 
 using android::base::DecompressingStream;
 
 namespace android {
 namespace snapshot {
 
+namespace {
+
+// Number of hinted textures kept prefetched ahead of the one being loaded.
+constexpr size_t kPrefetchAhead = 16;
+
+// Reads a texture straight out of the mapped file.
+class SpanStream : public android::base::Stream {
+public:
+    SpanStream(const char* data, uint64_t size) : mData(data), mSize(size) {}
+
+    ssize_t read(void* buffer, size_t size) override {
+        size = std::min<uint64_t>(size, mSize - mPos);
+        memcpy(buffer, mData + mPos, size);
+        mPos += size;
+        return size;
+    }
+    ssize_t write(const void*, size_t) override { return -EPERM; }
+
+private:
+    const char* mData;
+    uint64_t mSize;
+    uint64_t mPos = 0;
+};
+
+}  // namespace
+
 TextureLoader::TextureLoader(android::base::StdioStream&& stream)
     : mStream(std::move(stream)) {}
 
+TextureLoader::~TextureLoader() {
+    unmap();
+}
+
 bool TextureLoader::start() {
     if (mStarted) {
         return !mHasError;
@@ -40,18 +83,57 @@ bool TextureLoader::start() {
         mHasError = true;
         return false;
     }
+    map();
+    android::base::AutoLock scopedLock(mLock);
+    prefetchAfter(0);
     return true;
 }
 
 void TextureLoader::loadTexture(uint32_t texId, const loader_t& loader) {
     android::base::AutoLock scopedLock(mLock);
     assert(mIndex.count(texId));
-    HANDLE_EINTR(fseeko(mStream.get(), mIndex[texId], SEEK_SET));
+    const Texture& tex = mIndex[texId];
+    mAccessOrder.push_back(texId);
+    auto hinted = mHintPos.find(texId);
+    if (hinted != mHintPos.end()) {
+        prefetchAfter(hinted->second + 1);
+    }
+
+    if (mMapping) {
+        if (!checkTextureLocked(texId, tex, mMapping + tex.filePos)) {
+            return;
+        }
+        SpanStream span(mMapping + tex.filePos, tex.size);
+        if (mVersion == 1) {
+            loader(&span);
+        } else {
+            DecompressingStream stream(span);
+            loader(&stream);
+        }
+        return;
+    }
+
+    HANDLE_EINTR(fseeko(mStream.get(), tex.filePos, SEEK_SET));
+    if (tex.checksum) {
+        // Read whole, to be checked before anything is decoded.
+        std::vector<char> data(tex.size);
+        if (mStream.read(data.data(), data.size()) != (ssize_t)data.size()) {
+            mHasError = true;
+            return;
+        }
+        if (checkTextureLocked(texId, tex, data.data())) {
+            SpanStream span(data.data(), data.size());
+            DecompressingStream stream(span);
+            loader(&stream);
+        }
+        return;
+    }
     switch (mVersion) {
         case 1:
             loader(&mStream);
             break;
-        case 2: {
+        case 2:
+        case 3: {
             DecompressingStream stream(mStream);
             loader(&stream);
         }
@@ -61,6 +143,112 @@ void TextureLoader::loadTexture(uint32_t texId, const loader_t& loader) {
     }
 }
 
+void TextureLoader::setAccessOrderHint(std::vector<uint32_t> texIds) {
+    android::base::AutoLock scopedLock(mLock);
+    mHint = std::move(texIds);
+    mHintPos.clear();
+    mHintPos.reserve(mHint.size());
+    for (size_t i = 0; i < mHint.size(); i++) {
+        mHintPos.emplace(mHint[i], i);
+    }
+    mPrefetchedUntil = 0;
+    if (mStarted) {
+        prefetchAfter(0);
+    }
+}
+
+std::vector<uint32_t> TextureLoader::corruptTextures() const {
+    android::base::AutoLock scopedLock(mLock);
+    return mCorruptTextures;
+}
+
+bool TextureLoader::checkTextureLocked(uint32_t texId,
+                                       const Texture& tex,
+                                       const char* data) {
+    // Far cheaper than the decompression and upload that follow.
+    if (!tex.checksum || base::xxh3Hash64(data, tex.size) == *tex.checksum) {
+        return true;
+    }
+    mHasError = true;
+    mCorruptTextures.push_back(texId);
+    return false;
+}
+
+std::vector<uint32_t> TextureLoader::accessOrder() const {
+    android::base::AutoLock scopedLock(mLock);
+    return mAccessOrder;
+}
+
+const void* TextureLoader::mappedTexture(uint32_t texId, size_t* size) {
+    android::base::AutoLock scopedLock(mLock);
+    auto it = mIndex.find(texId);
+    if (!mMapping || mVersion != 1 || it == mIndex.end()) {
+        return nullptr;
+    }
+    mAccessOrder.push_back(texId);
+    *size = it->second.size;
+    return mMapping + it->second.filePos;
+}
+
+void TextureLoader::prefetchAfter(size_t pos) {
+    if (!mMapping) {
+        return;
+    }
+    const uint64_t pageMask = base::memoryPageSize() - 1;
+    const size_t end = std::min(pos + kPrefetchAhead, mHint.size());
+    for (size_t i = std::max(pos, mPrefetchedUntil); i < end; i++) {
+        auto it = mIndex.find(mHint[i]);
+        if (it == mIndex.end()) {
+            continue;
+        }
+        const uint64_t begin = uint64_t(it->second.filePos) & ~pageMask;
+        const uint64_t length = it->second.filePos + it->second.size - begin;
+        base::memoryHint(const_cast<char*>(mMapping) + begin, length,
+                         base::MemoryHint::WillNeed);
+    }
+    mPrefetchedUntil = std::max(mPrefetchedUntil, end);
+}
+
+void TextureLoader::map() {
+    if (!mDiskSize) {
+        return;
+    }
+#ifdef _WIN32
+    HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(mStream.get())));
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        return;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    // The view keeps the mapping object alive.
+    CloseHandle(mapping);
+    if (!data) {
+        return;
+    }
+#else
+    void* data = mmap(nullptr, mDiskSize, PROT_READ, MAP_PRIVATE,
+                      fileno(mStream.get()), 0);
+    if (data == MAP_FAILED) {
+        return;
+    }
+#endif
+    mMapping = static_cast<const char*>(data);
+    mMappingSize = mDiskSize;
+}
+
+void TextureLoader::unmap() {
+    if (!mMapping) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(mMapping);
+#else
+    munmap(const_cast<char*>(mMapping), mMappingSize);
+#endif
+    mMapping = nullptr;
+    mMappingSize = 0;
+}
+
 bool TextureLoader::readIndex() {
 #if SNAPSHOT_PROFILE > 1
     auto start = android::base::System::get()->getHighResTimeUs();
@@ -73,15 +261,41 @@ bool TextureLoader::readIndex() {
     auto indexPos = mStream.getBe64();
     HANDLE_EINTR(fseeko(mStream.get(), static_cast<int64_t>(indexPos), SEEK_SET));
     mVersion = mStream.getBe32();
-    if (mVersion < 1 || mVersion > 2) {
+    if (mVersion < 1 || mVersion > 4) {
         return false;
     }
     uint32_t texCount = mStream.getBe32();
-    mIndex.reserve(texCount);
+    std::vector<std::pair<uint32_t, Texture>> textures;
+    textures.reserve(texCount);
     for (uint32_t i = 0; i < texCount; i++) {
         uint32_t tex = mStream.getBe32();
-        uint64_t filePos = mStream.getBe64();
-        mIndex.emplace(tex, filePos);
+        Texture entry = {};
+        entry.filePos = static_cast<int64_t>(mStream.getBe64());
+        if (mVersion >= 3) {
+            // Generation of the texture; only needed when saving.
+            mStream.getBe64();
+        }
+        if (mVersion >= 4) {
+            entry.checksum = mStream.getBe64();
+        }
+        textures.emplace_back(tex, entry);
+    }
+
+    // Textures are stored back to back, followed by the index.
+    std::sort(textures.begin(), textures.end(), [](const auto& a, const auto& b) {
+        return a.second.filePos < b.second.filePos;
+    });
+    mIndex.reserve(texCount);
+    for (size_t i = 0; i < textures.size(); i++) {
+        Texture& entry = textures[i].second;
+        const int64_t end = i + 1 < textures.size()
+                                    ? textures[i + 1].second.filePos
+                                    : static_cast<int64_t>(indexPos);
+        if (end < entry.filePos || (mDiskSize && uint64_t(end) > mDiskSize)) {
+            return false;
+        }
+        entry.size = uint64_t(end - entry.filePos);
+        mIndex.emplace(textures[i].first, entry);
     }
 #if SNAPSHOT_PROFILE > 1
     printf("Texture readIndex() time: %.03f\n",
@@ -16,23 +16,82 @@
 
 #include "snapshot/TextureSaver.h"
 
+#include "aemu/base/EintrWrapper.h"
+#include "aemu/base/Hash.h"
 #include "aemu/base/files/CompressingStream.h"
+#include "aemu/base/files/MemStream.h"
 #include "aemu/base/system/System.h"
+#include "aemu/base/threads/FunctorThread.h"
+#include "aemu/base/threads/ThreadPool.h"
 
 #include <algorithm>
 #include <cassert>
 #include <iterator>
 #include <utility>
 
+using android::base::AutoLock;
 using android::base::CompressingStream;
+using android::base::FunctorThread;
+using android::base::MemStream;
+using android::base::ThreadPool;
 
 namespace android {
 namespace snapshot {
 
-TextureSaver::TextureSaver(android::base::StdioStream&& stream)
-    : mStream(std::move(stream)) {
+namespace {
+
+// Records what a saver writes, keeping the boundaries of the write() calls:
+// the legacy compressed format is one LZ4 block per write(), and the loader
+// reads it back block by block, so the writes have to be replayed as is.
+class WriteRecorder : public android::base::Stream {
+public:
+    ssize_t read(void*, size_t) override { return -EPERM; }
+    ssize_t write(const void* buffer, size_t size) override {
+        if (!size) {
+            return 0;
+        }
+        auto data = static_cast<const char*>(buffer);
+        mData.insert(mData.end(), data, data + size);
+        mWrites.push_back(size);
+        return size;
+    }
+
+    void replay(Stream* stream) const {
+        const char* data = mData.data();
+        for (size_t size : mWrites) {
+            stream->write(data, size);
+            data += size;
+        }
+    }
+
+private:
+    std::vector<char> mData;
+    std::vector<size_t> mWrites;
+};
+
+}  // namespace
+
+struct TextureSaver::Job {
+    uint32_t texId;
+    uint64_t generation;
+    // Set if the texture is copied over from the previous file instead.
+    const PreviousTexture* previous = nullptr;
+    WriteRecorder recorded;
+    MemStream encoded;
+    // Of the bytes written to the file.
+    uint64_t checksum = 0;
+    // Guarded by mLock.
+    bool ready = false;
+};
+
+TextureSaver::TextureSaver(android::base::StdioStream&& stream,
+                           android::base::StdioStream&& previous)
+    : mStream(std::move(stream)), mPrevious(std::move(previous)) {
     // Put a placeholder for the index offset right now.
     mStream.putBe64(0);
+    if (mPrevious.get()) {
+        readPreviousIndex();
+    }
 }
 
 TextureSaver::~TextureSaver() {
@@ -40,26 +99,247 @@ TextureSaver::~TextureSaver() {
 }
 
 void TextureSaver::saveTexture(uint32_t texId, const saver_t& saver) {
+    saveTexture(texId, 0, saver);
+}
 
+void TextureSaver::saveTexture(uint32_t texId, uint64_t generation,
+                               const saver_t& saver) {
+    if (auto job = startJob(texId, generation)) {
+        runSaver(job.get(), saver);
+        enqueueJob(std::move(job));
+    }
+}
+
+void TextureSaver::saveTextureAsync(uint32_t texId, uint64_t generation,
+                                    const readback_t& readback) {
+    auto job = startJob(texId, generation);
+    if (!job) {
+        return;
+    }
+    const uint64_t start = base::getHighResTimeUs();
+    mReadbacks.push_back({std::move(job), readback()});
+    mReadbackUs += base::getHighResTimeUs() - start;
+    // The oldest readback has had the time of the newer ones to complete.
+    if (mReadbacks.size() > kReadbackWindow) {
+        finishOldestReadback();
+    }
+}
+
+void TextureSaver::finishReadbacks() {
+    while (!mReadbacks.empty()) {
+        finishOldestReadback();
+    }
+}
+
+void TextureSaver::finishOldestReadback() {
+    Readback oldest = std::move(mReadbacks.front());
+    mReadbacks.pop_front();
+    runSaver(oldest.job.get(), oldest.saver);
+    enqueueJob(std::move(oldest.job));
+}
+
+std::unique_ptr<TextureSaver::Job> TextureSaver::startJob(uint32_t texId,
+                                                          uint64_t generation) {
     if (!mStartTime) {
         mStartTime = base::getHighResTimeUs();
     }
 
-    assert(mIndex.textures.end() ==
-           std::find_if(mIndex.textures.begin(), mIndex.textures.end(),
-                        [texId](FileIndex::Texture& tex) {
-                            return tex.texId == texId;
-                        }));
-    mIndex.textures.push_back({texId, ftello(mStream.get())});
+    auto job = std::make_unique<Job>();
+    job->texId = texId;
+    job->generation = generation;
+    auto it = mPreviousIndex.find(texId);
+    if (generation && it != mPreviousIndex.end() &&
+        it->second.generation == generation) {
+        job->previous = &it->second;
+        ++mReusedCount;
+        enqueueJob(std::move(job));
+        return nullptr;
+    }
+    return job;
+}
+
+void TextureSaver::runSaver(Job* job, const saver_t& saver) {
+    const uint64_t start = base::getHighResTimeUs();
+    saver(&job->recorded, &mBuffer);
+    mReadbackUs += base::getHighResTimeUs() - start;
+}
+
+void TextureSaver::enqueueJob(std::unique_ptr<Job> job) {
+    if (!mWriter) {
+        const int threads = std::max(1, base::getCpuCoreCount() - 1);
+        mPool = std::make_unique<ThreadPool<Job*>>(
+            threads, [this](Job*&& job) { encodeJob(job); });
+        if (!mPool->start()) {
+            // Encode on the calling thread instead.
+            mPool.reset();
+        }
+        mWriter = std::make_unique<FunctorThread>([this] { writerLoop(); });
+        mWriter->start();
+    }
+
+    Job* raw = job.get();
+    {
+        // Bound the memory held by recorded and encoded textures.
+        const size_t maxPending =
+            2 * std::max(1, base::getCpuCoreCount());
+        AutoLock lock(mLock);
+        mCv.wait(&lock, [this, maxPending] { return mJobs.size() < maxPending; });
+        assert(std::none_of(mJobs.begin(), mJobs.end(),
+                            [raw](const std::unique_ptr<Job>& queued) {
+                                return queued->texId == raw->texId;
+                            }));
+        raw->ready = raw->previous != nullptr;
+        mJobs.push_back(std::move(job));
+        if (raw->ready) {
+            mCv.broadcastAndUnlock(&lock);
+            return;
+        }
+    }
+    if (mPool) {
+        mPool->enqueue(std::move(raw));
+    } else {
+        encodeJob(raw);
+    }
+}
+
+void TextureSaver::encodeJob(Job* job) {
+    const uint64_t start = base::getHighResTimeUs();
+    {
+        CompressingStream stream(job->encoded);
+        job->recorded.replay(&stream);
+    }
+    job->recorded = WriteRecorder();
+    const auto& encoded = job->encoded.buffer();
+    job->checksum = base::xxh3Hash64(encoded.data(), encoded.size());
+    mEncodeUs.fetch_add(base::getHighResTimeUs() - start,
+                        std::memory_order_relaxed);
+    AutoLock lock(mLock);
+    job->ready = true;
+    mCv.broadcastAndUnlock(&lock);
+}
+
+void TextureSaver::writerLoop() {
+    for (;;) {
+        std::unique_ptr<Job> job;
+        {
+            AutoLock lock(mLock);
+            mCv.wait(&lock, [this] {
+                return (!mJobs.empty() && mJobs.front()->ready) ||
+                       (mJobs.empty() && mStopWriter);
+            });
+            if (mJobs.empty()) {
+                return;
+            }
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+            mCv.broadcastAndUnlock(&lock);
+        }
 
-    CompressingStream stream(mStream);
-    saver(&stream, &mBuffer);
+        const uint64_t start = base::getHighResTimeUs();
+        const int64_t pos = ftello(mStream.get());
+        bool written;
+        if (job->previous) {
+            written = copyFromPrevious(job.get());
+        } else {
+            const auto& data = job->encoded.buffer();
+            written = mStream.write(data.data(), data.size()) ==
+                      (ssize_t)data.size();
+        }
+        mWriteUs += base::getHighResTimeUs() - start;
+        if (!written) {
+            mWriteFailed = true;
+            continue;
+        }
+        mIndex.textures.push_back(
+                {job->texId, pos, job->generation, job->checksum});
+    }
+}
+
+// Also hashes what it copies: a version 3 file has no checksums to carry
+// over, and a texture that went bad in the previous file shouldn't be
+// vouched for in this one.
+bool TextureSaver::copyFromPrevious(Job* job) {
+    char buffer[64 * 1024];
+    if (HANDLE_EINTR(fseeko(mPrevious.get(), job->previous->filePos, SEEK_SET))) {
+        return false;
+    }
+    base::Xxh3Hasher hasher;
+    uint64_t remaining = job->previous->size;
+    while (remaining) {
+        const size_t chunk = std::min<uint64_t>(remaining, sizeof(buffer));
+        if (mPrevious.read(buffer, chunk) != (ssize_t)chunk ||
+            mStream.write(buffer, chunk) != (ssize_t)chunk) {
+            return false;
+        }
+        hasher.update(buffer, chunk);
+        remaining -= chunk;
+    }
+    job->checksum = hasher.digest64();
+    return !job->previous->checksum || *job->previous->checksum == job->checksum;
+}
+
+void TextureSaver::readPreviousIndex() {
+    // Only a version 3 index knows what generation each texture was saved at.
+    const uint64_t indexPos = mPrevious.getBe64();
+    if (HANDLE_EINTR(fseeko(mPrevious.get(), static_cast<int64_t>(indexPos),
+                            SEEK_SET))) {
+        return;
+    }
+    const uint32_t version = mPrevious.getBe32();
+    if (version != 3 && version != 4) {
+        return;
+    }
+    const uint32_t texCount = mPrevious.getBe32();
+    std::vector<std::pair<uint32_t, PreviousTexture>> textures;
+    textures.reserve(texCount);
+    for (uint32_t i = 0; i < texCount; i++) {
+        PreviousTexture tex = {};
+        const uint32_t texId = mPrevious.getBe32();
+        tex.filePos = static_cast<int64_t>(mPrevious.getBe64());
+        tex.generation = mPrevious.getBe64();
+        if (version >= 4) {
+            tex.checksum = mPrevious.getBe64();
+        }
+        textures.emplace_back(texId, tex);
+    }
+    if (ferror(mPrevious.get())) {
+        return;
+    }
+
+    // Textures are stored back to back, followed by the index.
+    std::sort(textures.begin(), textures.end(),
+              [](const auto& a, const auto& b) {
+                  return a.second.filePos < b.second.filePos;
+              });
+    for (size_t i = 0; i < textures.size(); i++) {
+        const int64_t end = i + 1 < textures.size() ? textures[i + 1].second.filePos
+                                                    : static_cast<int64_t>(indexPos);
+        if (end < textures[i].second.filePos) {
+            mPreviousIndex.clear();
+            return;
+        }
+        textures[i].second.size = end - textures[i].second.filePos;
+        mPreviousIndex.emplace(textures[i].first, textures[i].second);
+    }
 }
 
 void TextureSaver::done() {
     if (mFinished) {
         return;
     }
+    finishReadbacks();
+    if (mWriter) {
+        {
+            AutoLock lock(mLock);
+            mStopWriter = true;
+            mCv.broadcastAndUnlock(&lock);
+        }
+        mWriter->wait();
+        if (mPool) {
+            mPool->done();
+            mPool->join();
+        }
+    }
     mIndex.startPosInFile = ftello(mStream.get());
     writeIndex();
     mEndTime = base::getHighResTimeUs();
@@ -67,9 +347,10 @@ void TextureSaver::done() {
     printf("Texture saving time: %.03f\n",
            (mEndTime - mStartTime) / 1000.0);
 #endif
-    mHasError = ferror(mStream.get()) != 0;
+    mHasError = mWriteFailed || ferror(mStream.get()) != 0;
     mFinished = true;
     mStream.close();
+    mPrevious.close();
 }
 
 void TextureSaver::writeIndex() {
@@ -82,6 +363,8 @@ void TextureSaver::writeIndex() {
     for (const FileIndex::Texture& b : mIndex.textures) {
         mStream.putBe32(b.texId);
         mStream.putBe64(static_cast<uint64_t>(b.filePos));
+        mStream.putBe64(b.generation);
+        mStream.putBe64(b.checksum);
     }
     auto end = ftello(mStream.get());
     mDiskSize = uint64_t(end);
@@ -19,6 +19,8 @@
 #include "aemu/base/Compiler.h"
 #include "aemu/base/synchronization/Lock.h"
 
+#include <atomic>
+
 namespace android {
 
 namespace base { class Stream; }
@@ -34,6 +36,10 @@ namespace snapshot {
 // An example is for texture lazy loading. On load it only reads the data from
 // disk but does not load them into GPU. On restore it performs the heavy-weight
 // GPU data loading.
+//
+// Once restored, touch() and needRestore() are a single acquire load, so
+// objects can be touched on every use. See RestoreAheadWorker for restoring
+// them in the background before they are first used.
 
 template <class Derived>
 class LazySnapshotObj {
@@ -44,22 +50,24 @@ public:
     LazySnapshotObj(base::Stream*) : mNeedRestore(true) {}
 
     void touch() {
+        if (!mNeedRestore.load(std::memory_order_acquire)) {
+            return;
+        }
         base::AutoLock lock(mMutex);
-        if (!mNeedRestore) {
+        if (!mNeedRestore.load(std::memory_order_relaxed)) {
             return;
         }
         static_cast<Derived*>(this)->restore();
-        mNeedRestore = false;
+        mNeedRestore.store(false, std::memory_order_release);
     }
 
     bool needRestore() const {
-        base::AutoLock lock(mMutex);
-        return mNeedRestore;
+        return mNeedRestore.load(std::memory_order_acquire);
     }
 
 protected:
     ~LazySnapshotObj() = default;
-    bool mNeedRestore = false;
+    std::atomic<bool> mNeedRestore{false};
 
 private:
     mutable base::Lock mMutex;
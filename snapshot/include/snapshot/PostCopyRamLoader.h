@@ -0,0 +1,95 @@
+/*
+* Copyright (C) 2026 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/export.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/threads/FunctorThread.h"
+#include "snapshot/RamDelta.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace android {
+namespace snapshot {
+
+// Restores guest RAM from a chain of RAM deltas after the VM has resumed.
+//
+// On Linux, start() drops the pages of |blocks|, registers them with
+// userfaultfd and returns: a handler thread fills each page from the
+// snapshot the first time the guest touches it, while a prefetcher fills
+// the rest, first in the order of the access order hint (usually
+// accessOrder() of the previous load) and then front to back. The blocks
+// must be private anonymous memory that nothing else fills meanwhile.
+//
+// Elsewhere, or if userfaultfd is unavailable, start() loads everything
+// before returning, on several threads with loadResolvedRamPages().
+class PostCopyRamLoader {
+    DISALLOW_COPY_AND_ASSIGN(PostCopyRamLoader);
+
+public:
+    // |chain| and |store| must outlive the loader.
+    AEMU_EXPORT PostCopyRamLoader(std::vector<base::StdioStream*> chain,
+                                  std::vector<RamBlock> blocks,
+                                  RamPageStore* store = nullptr);
+    // Finishes the restore first, as the guest can't run without its RAM.
+    AEMU_EXPORT ~PostCopyRamLoader();
+
+    // Pages as (block index << 32) | page index.
+    AEMU_EXPORT void setAccessOrderHint(std::vector<uint64_t> pages);
+
+    AEMU_EXPORT bool start();
+    // Waits until every page is in.
+    AEMU_EXPORT void join();
+
+    AEMU_EXPORT bool postCopy() const { return mUffd >= 0; }
+    AEMU_EXPORT bool hasError() const { return mError; }
+    // The pages the guest faulted on, in order.
+    AEMU_EXPORT std::vector<uint64_t> accessOrder() const;
+
+private:
+    bool readPage(size_t block, uint32_t page, uint8_t* out);
+    // Fills a page through userfaultfd unless it's in already.
+    void fillPage(size_t block, uint32_t page, uint8_t* buffer);
+    void handleFaults();
+    void prefetch();
+
+    std::vector<base::StdioStream*> mChain;
+    std::vector<RamBlock> mBlocks;
+    RamPageStore* mStore;
+    RamDeltaIndex mIndex;
+    std::vector<std::vector<RamPageSource>> mSources;
+    std::vector<uint64_t> mHint;
+
+    int mUffd = -1;
+    int mStopFd = -1;
+    std::unique_ptr<std::atomic<uint8_t>[]> mFilled;  // one per page
+    std::vector<size_t> mFirstPage;                   // of each block in mFilled
+    std::atomic<bool> mError{false};
+
+    base::Lock mReadLock;  // the chain's files
+    mutable base::Lock mOrderLock;
+    std::vector<uint64_t> mAccessOrder;
+
+    std::unique_ptr<base::FunctorThread> mHandler;
+    std::unique_ptr<base::FunctorThread> mPrefetcher;
+};
+
+}  // namespace snapshot
+}  // namespace android
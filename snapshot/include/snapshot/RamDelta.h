@@ -0,0 +1,207 @@
+/*
+* Copyright (C) 2026 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/Hash.h"
+#include "aemu/base/export.h"
+#include "aemu/base/files/StdioStream.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "snapshot/common.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+namespace snapshot {
+
+// Incremental RAM snapshots. A delta holds the pages of each RAM block that
+// changed since its parent snapshot, named by id, along with the hashes of
+// all pages so that the next delta can be computed from this one's index
+// alone. A delta without a parent holds every page. Restoring takes the
+// chain from that full snapshot to the wanted one; mergeRamDeltas()
+// collapses a chain so that it doesn't grow without bound.
+//
+// Changed pages that are all zero are not written, and with a RamPageStore
+// pages that occur more than once are written there once and referenced.
+//
+// On disk: the index (magic, version, id, parent id, then per block its
+// id, size, page size, changed pages with their kinds, store offsets and
+// page hashes), then the bytes of the inline pages, block by block.
+enum class RamPageKind : uint8_t {
+    Inline = 0,
+    Zero = 1,
+    Stored = 2,
+};
+
+struct RamDeltaBlock {
+    std::string id;
+    int64_t totalSize = 0;
+    int32_t pageSize = 0;
+    std::vector<uint32_t> changedPages;  // ascending
+    std::vector<RamPageKind> pageKinds;  // one per changed page
+    std::vector<uint64_t> storeOffsets;  // one per Stored page, in order
+    std::vector<uint64_t> pageHashes;    // one per page
+
+    uint32_t pageCount() const {
+        return static_cast<uint32_t>((totalSize + pageSize - 1) / pageSize);
+    }
+    // The last page may be short.
+    uint32_t pageBytes(uint32_t page) const {
+        const int64_t rest = totalSize - int64_t(page) * pageSize;
+        return static_cast<uint32_t>(rest < pageSize ? rest : pageSize);
+    }
+};
+
+struct RamDeltaIndex {
+    std::string id;
+    std::string parentId;  // empty for a full snapshot
+    std::vector<RamDeltaBlock> blocks;
+
+    const RamDeltaBlock* findBlock(const std::string& blockId) const;
+};
+
+// True if |size| bytes at |data| are all zero. Checks 64 bytes at a time
+// with SSE2 or NEON where available.
+AEMU_EXPORT bool isRamPageZero(const void* data, size_t size);
+
+// Content addressed pages shared by the snapshots of one AVD, in a single
+// append-only file of {xxh3Hash128, size, bytes} records. Pages are found
+// by their 128-bit hash and read back by the offset put() returned, which
+// stays valid as the file grows. Thread safe.
+class RamPageStore {
+    DISALLOW_COPY_AND_ASSIGN(RamPageStore);
+
+public:
+    // |file| must be open for reading and writing, e.g. "r+b", or "w+b"
+    // for a new store.
+    AEMU_EXPORT explicit RamPageStore(base::StdioStream&& file);
+
+    // Reads the hashes of the pages already in the file. False if it isn't
+    // a page store.
+    AEMU_EXPORT bool open();
+
+    AEMU_EXPORT bool contains(const base::Hash128& hash) const;
+    // The offset of a page with these contents, writing it if it's new.
+    // 0 on a write error.
+    AEMU_EXPORT uint64_t put(const void* data, uint32_t size);
+    // Reads the page at |offset|, checking its size and hash.
+    AEMU_EXPORT bool get(uint64_t offset, void* data, uint32_t size);
+
+    AEMU_EXPORT size_t pageCount() const;
+
+private:
+    struct HashHasher {
+        size_t operator()(const base::Hash128& hash) const {
+            return static_cast<size_t>(hash.low ^ hash.high);
+        }
+    };
+
+    mutable base::Lock mLock;
+    base::StdioStream mFile;
+    int64_t mEnd = 0;
+    std::unordered_map<base::Hash128, uint64_t, HashHasher> mOffsets;
+};
+
+// Writes |blocks| as snapshot |id| to |stream|: the pages whose hash
+// differs from |parent|'s, or all pages if |parent| is null. With
+// |dirtyPages| from VMM dirty logging, one flag per page of each block,
+// only dirty pages are hashed and clean ones keep |parent|'s hash. Stores
+// the index written in |written|, if not null, to diff the next save
+// against. With |store|, changed pages that are already in it or occur
+// more than once among the changed pages go there. Returns false if
+// |parent| describes different blocks.
+AEMU_EXPORT bool saveRamDelta(base::Stream* stream,
+                              const std::string& id,
+                              const std::vector<RamBlock>& blocks,
+                              const RamDeltaIndex* parent,
+                              const std::vector<std::vector<bool>>* dirtyPages = nullptr,
+                              RamDeltaIndex* written = nullptr,
+                              RamPageStore* store = nullptr);
+
+// Reads the index of a delta, leaving |stream| at the start of its pages.
+AEMU_EXPORT bool readRamDeltaIndex(base::Stream* stream, RamDeltaIndex* index);
+
+// Restores |blocks| from |chain|, a full snapshot followed by deltas each
+// made against the one before it. Stored pages are read from |store|.
+// Zero pages in RAM that isn't file backed (no SNAPSHOT_RAM_MAPPED flag)
+// are dropped with MemoryHint::DontNeed on Linux, so they read back as
+// zero without taking memory. Fails, possibly after restoring part of the
+// chain, if the links or blocks don't match.
+AEMU_EXPORT bool loadRamDeltaChain(const std::vector<base::Stream*>& chain,
+                                   const std::vector<RamBlock>& blocks,
+                                   RamPageStore* store = nullptr);
+
+struct RamLoadOptions {
+    // Threads reading pages; 0 for one per core.
+    int threads = 0;
+    // Caps |threads|: each has one read in flight, and past an NVMe
+    // queue's worth more only contend.
+    int maxReadsInFlight = 32;
+    // Pages per work item. Runs of pages that are contiguous in a delta go
+    // in one read, up to a work item.
+    uint32_t chunkPages = 256;
+};
+
+// Like loadRamDeltaChain(), but resolves |chain| first so that each page
+// is written once, from the newest delta that has it, and restores the
+// blocks in chunks on several threads. Inline pages are read with pread()
+// straight into guest memory; zero pages are dropped as in
+// loadRamDeltaChain(). |chain| must start with a full snapshot.
+AEMU_EXPORT bool loadRamDeltaChainParallel(const std::vector<base::StdioStream*>& chain,
+                                           const std::vector<RamBlock>& blocks,
+                                           RamPageStore* store = nullptr,
+                                           const RamLoadOptions& options = {});
+
+// Where the newest copy of a page in a chain of deltas is: the file
+// position of an inline page in delta |delta|, or the store offset of a
+// stored one. |delta| is -1 for pages that no delta in the chain has.
+struct RamPageSource {
+    int32_t delta = -1;
+    RamPageKind kind = RamPageKind::Inline;
+    uint64_t pos = 0;
+};
+
+// Reads the indices of |chain|, deltas each made against the one before
+// it, and finds the source of every page: |sources| has one vector per
+// block of the newest index. |newest| gets that index, with the parent of
+// the first one, as if the chain were a single delta.
+AEMU_EXPORT bool resolveRamDeltaChain(const std::vector<base::StdioStream*>& chain,
+                                      RamDeltaIndex* newest,
+                                      std::vector<std::vector<RamPageSource>>* sources);
+
+// The loading half of loadRamDeltaChainParallel(), for a chain resolved
+// already: |layouts| and |sources| have one entry per block of |blocks|,
+// in the same order.
+AEMU_EXPORT bool loadResolvedRamPages(const std::vector<base::StdioStream*>& chain,
+                                      const std::vector<RamDeltaBlock>& layouts,
+                                      const std::vector<std::vector<RamPageSource>>& sources,
+                                      const std::vector<RamBlock>& blocks,
+                                      RamPageStore* store = nullptr,
+                                      const RamLoadOptions& options = {});
+
+// Writes |chain|, deltas each made against the one before it, as a single
+// delta against the first one's parent: a full snapshot if the chain
+// starts with one. Stored pages stay references to the same store. Only
+// reads |chain|, so it can run on a background thread while the VM keeps
+// going.
+AEMU_EXPORT bool mergeRamDeltas(const std::vector<base::StdioStream*>& chain,
+                                base::Stream* out);
+
+}  // namespace snapshot
+}  // namespace android
@@ -0,0 +1,97 @@
+/*
+* Copyright (C) 2026 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "aemu/base/Compiler.h"
+#include "aemu/base/export.h"
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
+#include "aemu/base/threads/FunctorThread.h"
+
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+
+namespace android {
+namespace snapshot {
+
+// Restores LazySnapshotObjs on a background thread after a snapshot load,
+// highest priority first and in the order added among equals, so that most
+// of them are ready before their first touch(). Objects are held weakly:
+// the ones destroyed in the meantime are skipped, and the ones already
+// touched cost a single load.
+//
+//     RestoreAheadWorker worker;
+//     for (auto& texture : textures) {
+//         worker.add(texture, texture->isRenderTarget() ? 1 : 0);
+//     }
+//     worker.start();
+class RestoreAheadWorker {
+    DISALLOW_COPY_AND_ASSIGN(RestoreAheadWorker);
+
+public:
+    AEMU_EXPORT RestoreAheadWorker() = default;
+    // Stops, restoring nothing more.
+    AEMU_EXPORT ~RestoreAheadWorker();
+
+    template <class T>
+    void add(const std::shared_ptr<T>& obj, int priority = 0) {
+        addTask(priority, [weak = std::weak_ptr<T>(obj)] {
+            if (auto locked = weak.lock()) {
+                locked->touch();
+            }
+        });
+    }
+
+    // Starts restoring in the background. Objects may be added before or
+    // after.
+    AEMU_EXPORT void start();
+    // Waits for the restore in progress, if any, and drops the rest.
+    AEMU_EXPORT void stop();
+    // Waits until everything added so far has been restored.
+    AEMU_EXPORT void waitIdle();
+
+    AEMU_EXPORT size_t pending() const;
+
+private:
+    struct Task {
+        int priority;
+        uint64_t seq;
+        std::function<void()> restore;
+
+        bool operator<(const Task& other) const {
+            // std::priority_queue pops the largest.
+            return priority != other.priority ? priority < other.priority
+                                              : seq > other.seq;
+        }
+    };
+
+    AEMU_EXPORT void addTask(int priority, std::function<void()> restore);
+    void workerLoop();
+
+    mutable base::Lock mLock;
+    base::ConditionVariable mCv;
+    std::priority_queue<Task> mTasks;
+    uint64_t mNextSeq = 0;
+    bool mBusy = false;
+    bool mStopping = false;
+    std::unique_ptr<base::FunctorThread> mThread;
+};
+
+}  // namespace snapshot
+}  // namespace android
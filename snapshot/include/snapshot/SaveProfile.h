@@ -0,0 +1,146 @@
+/*
+* Copyright (C) 2026 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "aemu/base/export.h"
+#include "aemu/base/files/CompressionCodec.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace snapshot {
+
+// How past saves of an AVD went, kept next to its snapshots so that the
+// next save can pick settings that fit a pause-time budget, rather than
+// just learning that saves are slow (androidSnapshot_areSavesSlow()).
+//
+// Each save adds a SaveRecord with the bytes and time of every stage.
+// plan() estimates, from the most recent records, what each codec, worker
+// count and full vs incremental RAM save would cost, and picks the
+// smallest output that fits the budget. check() then compares the save
+// that happened with the budget and says what went over.
+//
+// On disk: magic, version, record count, then each record's settings and
+// stages.
+enum class SaveStage : uint8_t {
+    Ram = 0,
+    Textures = 1,
+    Devices = 2,
+};
+constexpr size_t kSaveStages = 3;
+
+AEMU_EXPORT const char* saveStageName(SaveStage stage);
+
+struct SaveStageRecord {
+    uint64_t rawBytes = 0;
+    // After compression; also what went to disk.
+    uint64_t writtenBytes = 0;
+    // CPU time spent compressing, summed over the workers.
+    uint64_t compressUs = 0;
+    // Time spent writing to disk.
+    uint64_t writeUs = 0;
+    // Wall time of the whole stage.
+    uint64_t durationUs = 0;
+};
+
+struct SaveRecord {
+    base::CompressionCodec codec = base::CompressionCodec::Lz4;
+    int level = 0;
+    uint32_t workers = 1;
+    // RAM was saved as a delta; Ram.rawBytes then counts changed pages only.
+    bool incremental = false;
+    // The guest RAM size, so incremental saves can be scaled.
+    uint64_t ramSize = 0;
+    SaveStageRecord stages[kSaveStages];
+
+    const SaveStageRecord& stage(SaveStage s) const {
+        return stages[static_cast<size_t>(s)];
+    }
+    SaveStageRecord& stage(SaveStage s) {
+        return stages[static_cast<size_t>(s)];
+    }
+    uint64_t totalUs() const;
+};
+
+struct SavePlan {
+    base::CodecOptions codec;
+    uint32_t workers = 1;
+    bool incremental = false;
+    // What the history says this will take; 0 without any history.
+    uint64_t predictedUs = 0;
+    uint64_t predictedBytes = 0;
+    // The settings fit the budget, as far as the history can tell.
+    bool fitsBudget = true;
+};
+
+struct SaveBudgetReport {
+    bool missed = false;
+    uint64_t budgetUs = 0;
+    uint64_t actualUs = 0;
+    // The stage that went over its estimate the most.
+    SaveStage stage = SaveStage::Ram;
+    // E.g. "ram: disk bound, 812 MB at 95 MB/s, expected 150 MB/s".
+    std::string reason;
+};
+
+class SaveProfile {
+public:
+    // Records beyond this many are dropped, oldest first.
+    static constexpr size_t kMaxRecords = 16;
+    // How many recent records the estimates are taken from.
+    static constexpr size_t kRecentRecords = 4;
+
+    AEMU_EXPORT explicit SaveProfile(std::string path);
+
+    // Reads the profile file. False if it exists but isn't a profile; a
+    // missing file is an empty history.
+    AEMU_EXPORT bool load();
+    // Writes the profile file, replacing it atomically.
+    AEMU_EXPORT bool save() const;
+
+    AEMU_EXPORT void add(const SaveRecord& record);
+    const std::vector<SaveRecord>& records() const { return mRecords; }
+
+    // The settings for the next save: the candidate with the fewest
+    // predicted bytes that fits |budgetUs|, using at most |maxWorkers|
+    // compression threads, or the fastest one if none fits. Incremental
+    // RAM saves are only considered with |canIncremental|, i.e. when
+    // there is a parent to diff against.
+    AEMU_EXPORT SavePlan plan(uint64_t budgetUs,
+                              uint32_t maxWorkers,
+                              bool canIncremental) const;
+
+    // Whether |record|, saved following |plan|, went over |budgetUs|, and
+    // if so which stage was to blame and why. Call it before add()ing
+    // |record|, so that it is compared with what was expected of it.
+    AEMU_EXPORT SaveBudgetReport check(const SaveRecord& record,
+                                       const SavePlan& plan,
+                                       uint64_t budgetUs) const;
+
+    // Whether the recent saves took longer than |budgetUs|, usually.
+    AEMU_EXPORT bool areSavesSlow(uint64_t budgetUs) const;
+
+private:
+    std::string mPath;
+    std::vector<SaveRecord> mRecords;  // oldest first
+};
+
+}  // namespace snapshot
+}  // namespace android
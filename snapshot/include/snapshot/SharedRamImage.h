@@ -0,0 +1,62 @@
+/*
+* Copyright (C) 2026 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "aemu/base/export.h"
+#include "snapshot/RamDelta.h"
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace snapshot {
+
+// Guest RAM shared by many emulators booting from the same snapshot.
+//
+// prepareSharedRamImage() expands a chain of RAM deltas, once, into a
+// flat image. mapSharedRamImage() then maps the blocks of that image over
+// each instance's guest RAM, MAP_PRIVATE. Every instance reads the same
+// page cache copy, and only the pages its guest writes become its own.
+//
+// On disk: a header (magic, version, snapshot id, then per block its id,
+// size, page size and file offset), then the bytes of each block at a
+// 64 KiB aligned offset. Zero pages are never written, so they stay holes
+// where the file system's writeback allows.
+//
+// POSIX only; elsewhere these fail and the caller loads RAM as usual.
+
+// Writes the image of |chain|, which starts with a full snapshot, to
+// |path|. Writes a temporary file and renames it into place, so a reader
+// never sees half an image. Does nothing if |path| already holds the image
+// of the same snapshot id. Stored pages are read from |store|.
+AEMU_EXPORT bool prepareSharedRamImage(const std::vector<base::StdioStream*>& chain,
+                                       const std::string& path,
+                                       RamPageStore* store = nullptr);
+
+// The snapshot id of the image at |path|, or empty if it isn't one.
+AEMU_EXPORT std::string sharedRamImageId(const std::string& path);
+
+// Maps the image at |path| copy-on-write over |blocks|, replacing what
+// they held. Each block must be in the image with the same size and page
+// size, start on a host page boundary and not be file backed
+// (SNAPSHOT_RAM_MAPPED). Checks every block before mapping any. Call it
+// before the memory is handed to the hypervisor, since the mapping under
+// |hostPtr| changes.
+AEMU_EXPORT bool mapSharedRamImage(const std::string& path, const std::vector<RamBlock>& blocks);
+
+}  // namespace snapshot
+}  // namespace android
@@ -26,7 +26,9 @@
 
 #include <functional>
 #include <memory>
+#include <optional>
 #include <unordered_map>
+#include <vector>
 
 namespace android {
 namespace snapshot {
@@ -52,15 +54,38 @@ public:
     virtual bool compressed() const = 0;
     virtual void join() = 0;
     virtual void interrupt() = 0;
+
+    // The order textures are expected to be loaded in, usually accessOrder()
+    // of the previous run. Lets the loader read them in ahead of time.
+    virtual void setAccessOrderHint(std::vector<uint32_t> texIds) {}
+    // The order textures have been loaded in so far.
+    virtual std::vector<uint32_t> accessOrder() const { return {}; }
 };
 
+// Loads textures saved by TextureSaver. start() maps the whole file into
+// memory where possible, so that loading a texture does not need to seek and
+// read; with an access order hint, the textures about to be loaded are
+// prefetched while the current one is being uploaded. If the file can't be
+// mapped it is read through |stream| instead.
 class TextureLoader final : public ITextureLoader {
 public:
     AEMU_EXPORT TextureLoader(android::base::StdioStream&& stream);
+    AEMU_EXPORT ~TextureLoader();
 
     AEMU_EXPORT bool start() override;
     AEMU_EXPORT void loadTexture(uint32_t texId, const loader_t& loader) override;
+    AEMU_EXPORT void setAccessOrderHint(std::vector<uint32_t> texIds) override;
+    AEMU_EXPORT std::vector<uint32_t> accessOrder() const override;
+
+    // Returns the data of |texId| in the mapped file, or nullptr if the file
+    // isn't mapped or the texture is compressed. The span stays valid until
+    // join() or interrupt().
+    AEMU_EXPORT const void* mappedTexture(uint32_t texId, size_t* size);
     AEMU_EXPORT bool hasError() const override { return mHasError; }
+    // Textures whose data didn't match the checksum it was saved with, and
+    // so weren't handed to their loader. Files before version 4 have no
+    // checksums.
+    AEMU_EXPORT std::vector<uint32_t> corruptTextures() const;
     AEMU_EXPORT uint64_t diskSize() const override { return mDiskSize; }
     AEMU_EXPORT bool compressed() const override { return mVersion > 1; }
 
@@ -73,6 +98,7 @@ public:
             mLoaderThread->wait();
             mLoaderThread.reset();
         }
+        unmap();
         mStream.close();
         mEndTime = base::getHighResTimeUs();
     }
@@ -83,6 +109,7 @@ public:
             mLoaderThread->wait();
             mLoaderThread.reset();
         }
+        unmap();
         mStream.close();
         mEndTime = base::getHighResTimeUs();
     }
@@ -103,11 +130,33 @@ public:
     }
 
 private:
+    struct Texture {
+        int64_t filePos;
+        // Up to the next texture or the index.
+        uint64_t size;
+        std::optional<uint64_t> checksum;
+    };
+
     bool readIndex();
+    // Whether the |size| bytes of |tex| at |data| are what was saved.
+    bool checkTextureLocked(uint32_t texId, const Texture& tex, const char* data);
+    void map();
+    void unmap();
+    // Prefetches the hinted textures following hint position |pos|.
+    void prefetchAfter(size_t pos);
 
     android::base::StdioStream mStream;
-    std::unordered_map<uint32_t, int64_t> mIndex;
-    android::base::Lock mLock;
+    std::unordered_map<uint32_t, Texture> mIndex;
+    mutable android::base::Lock mLock;
+
+    const char* mMapping = nullptr;
+    uint64_t mMappingSize = 0;
+    std::vector<uint32_t> mHint;
+    std::unordered_map<uint32_t, size_t> mHintPos;
+    // Hint position up to which textures have been prefetched.
+    size_t mPrefetchedUntil = 0;
+    std::vector<uint32_t> mAccessOrder;
+    std::vector<uint32_t> mCorruptTextures;
     bool mStarted = false;
     bool mHasError = false;
     int mVersion = 0;
@@ -19,12 +19,29 @@
 #include "aemu/base/containers/SmallVector.h"
 #include "aemu/base/export.h"
 #include "aemu/base/files/StdioStream.h"
+#include "aemu/base/synchronization/ConditionVariable.h"
+#include "aemu/base/synchronization/Lock.h"
 #include "aemu/base/system/System.h"
 #include "snapshot/common.h"
 
+#include <atomic>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
+namespace android {
+namespace base {
+
+class FunctorThread;
+template <class ItemT>
+class ThreadPool;
+
+}  // namespace base
+}  // namespace android
+
 namespace android {
 namespace snapshot {
 
@@ -42,21 +59,86 @@ public:
 
     // Save texture to a stream as well as update the index
     virtual void saveTexture(uint32_t texId, const saver_t& saver) = 0;
+
+    // Same as above, with a content hash or generation number of the
+    // texture. If it matches the one the texture had in the previous
+    // snapshot, the saver may reuse the old data instead of calling |saver|.
+    // 0 means unknown and always saves.
+    virtual void saveTexture(uint32_t texId, uint64_t generation,
+                             const saver_t& saver) {
+        saveTexture(texId, saver);
+    }
+
+    // Starts an asynchronous readback and returns the saver that writes
+    // its result, e.g. issues glReadPixels() into a PBO with a fence, and
+    // returns a saver that maps the PBO.
+    using readback_t = std::function<saver_t()>;
+
+    // Like saveTexture(), but |readback| only starts reading the texture
+    // back, so the GPU copies several textures while earlier ones are
+    // written out. The saver it returns runs later on this same thread,
+    // when enough readbacks are in flight or from finishReadbacks().
+    virtual void saveTextureAsync(uint32_t texId, uint64_t generation,
+                                  const readback_t& readback) {
+        saveTexture(texId, generation,
+                    [&readback](android::base::Stream* stream, Buffer* buffer) {
+                        readback()(stream, buffer);
+                    });
+    }
+    // Runs the savers of all readbacks started by saveTextureAsync(). Call
+    // it on the thread that started them before the save completes.
+    virtual void finishReadbacks() {}
     virtual bool hasError() const = 0;
     virtual uint64_t diskSize() const = 0;
     virtual bool compressed() const = 0;
     virtual bool getDuration(uint64_t* duration) = 0;
 };
 
+// Saves textures into a single file: a placeholder for the index position,
+// the textures one after another and then the index.
+//
+// saveTexture() runs |saver| on the calling thread, as it usually has to read
+// the texture back from the GPU, but only records what it writes. The data is
+// compressed on a worker pool and appended to the file, in the order the
+// textures were saved, by a single writer thread. saveTextureAsync() keeps up
+// to kReadbackWindow readbacks in flight before running the oldest one's
+// saver, so the GPU, the encoders and the disk all work at once.
+//
+// If |previous| is the texture file of the last snapshot, textures saved with
+// the same non-zero generation as in there are copied over from it without
+// calling their saver. |previous| must be a different file than |stream|.
 class TextureSaver final : public ITextureSaver {
     DISALLOW_COPY_AND_ASSIGN(TextureSaver);
 
 public:
-    AEMU_EXPORT TextureSaver(android::base::StdioStream&& stream);
+    AEMU_EXPORT TextureSaver(android::base::StdioStream&& stream,
+                             android::base::StdioStream&& previous =
+                                 android::base::StdioStream());
     AEMU_EXPORT ~TextureSaver();
     AEMU_EXPORT void saveTexture(uint32_t texId, const saver_t& saver) override;
+    AEMU_EXPORT void saveTexture(uint32_t texId, uint64_t generation,
+                                 const saver_t& saver) override;
+    AEMU_EXPORT void saveTextureAsync(uint32_t texId, uint64_t generation,
+                                      const readback_t& readback) override;
+    AEMU_EXPORT void finishReadbacks() override;
+    // Also finishes the readbacks still in flight, so it must run on the
+    // thread that started them unless finishReadbacks() already has.
     AEMU_EXPORT void done();
 
+    // Readbacks kept in flight by saveTextureAsync().
+    static constexpr size_t kReadbackWindow = 4;
+
+    // Time spent in each stage, in microseconds. Encoding is summed over
+    // the workers, so the stages can add up to more than the total.
+    struct StageDurations {
+        uint64_t readbackUs = 0;
+        uint64_t encodeUs = 0;
+        uint64_t writeUs = 0;
+    };
+
+    // Number of textures copied from |previous| so far.
+    AEMU_EXPORT size_t reusedTextureCount() const { return mReusedCount; }
+
     AEMU_EXPORT bool hasError() const override { return mHasError; }
     AEMU_EXPORT uint64_t diskSize() const override { return mDiskSize; }
     AEMU_EXPORT bool compressed() const override { return mIndex.version > 1; }
@@ -75,32 +157,96 @@ public:
         }
         return true;
     }
+    // The same, and the time per stage if |stages| is not null.
+    AEMU_EXPORT bool getDuration(uint64_t* duration, StageDurations* stages) {
+        if (!getDuration(duration)) {
+            return false;
+        }
+        if (stages) {
+            stages->readbackUs = mReadbackUs;
+            stages->encodeUs = mEncodeUs.load(std::memory_order_relaxed);
+            stages->writeUs = mWriteUs;
+        }
+        return true;
+    }
 
 private:
     struct FileIndex {
         struct Texture {
             uint32_t texId;
             int64_t filePos;
+            // Added in version 3.
+            uint64_t generation;
+            // Added in version 4: xxh3Hash64() of the bytes stored.
+            uint64_t checksum;
         };
 
         int64_t startPosInFile;
-        int32_t version = 2;
+        int32_t version = 4;
         std::vector<Texture> textures;
     };
 
+    // Where a texture of the previous file is, and what it was saved as.
+    struct PreviousTexture {
+        int64_t filePos;
+        uint64_t size;
+        uint64_t generation;
+        // Only known for a version 4 index.
+        std::optional<uint64_t> checksum;
+    };
+
+    struct Job;
+
+    // A readback started by saveTextureAsync(), waiting for its saver to run.
+    struct Readback {
+        std::unique_ptr<Job> job;
+        saver_t saver;
+    };
+
+    // Starts the job of a texture, or returns null if it is reused from
+    // |previous| and has been queued already.
+    std::unique_ptr<Job> startJob(uint32_t texId, uint64_t generation);
+    void runSaver(Job* job, const saver_t& saver);
+    void finishOldestReadback();
+    void enqueueJob(std::unique_ptr<Job> job);
+    void encodeJob(Job* job);
+    void writerLoop();
+    bool copyFromPrevious(Job* job);
+    void readPreviousIndex();
     void writeIndex();
 
     android::base::StdioStream mStream;
+    android::base::StdioStream mPrevious;
+    std::unordered_map<uint32_t, PreviousTexture> mPreviousIndex;
     // A buffer for fetching data from GPU memory to RAM.
     android::base::SmallFixedVector<unsigned char, 128> mBuffer;
-
+    // Oldest first; only touched by the thread saving textures.
+    std::deque<Readback> mReadbacks;
+
+    std::unique_ptr<android::base::ThreadPool<Job*>> mPool;
+    std::unique_ptr<android::base::FunctorThread> mWriter;
+    android::base::Lock mLock;
+    // Signalled when a job is encoded or written, and on shutdown.
+    android::base::ConditionVariable mCv;
+    // Guarded by |mLock|: jobs in save order, front first to be written.
+    std::deque<std::unique_ptr<Job>> mJobs;
+    bool mStopWriter = false;
+
+    // Only touched by the writer thread until done() has joined it.
     FileIndex mIndex;
+    bool mWriteFailed = false;
+
+    size_t mReusedCount = 0;
     uint64_t mDiskSize = 0;
     bool mFinished = false;
     bool mHasError = false;
 
     uint64_t mStartTime = 0;
     uint64_t mEndTime = 0;
+    uint64_t mReadbackUs = 0;
+    std::atomic<uint64_t> mEncodeUs{0};
+    // Written by the writer thread.
+    uint64_t mWriteUs = 0;
 };
 
 }  // namespace snapshot
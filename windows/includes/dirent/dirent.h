@@ -45,8 +45,9 @@ extern "C" {
  * @note **Windows-Specific Behavior:**
  *   - Filenames are stored in `d_name` as **UTF-8** encoded strings.
  *   - Extended-length paths (longer than `MAX_PATH`) are supported using the `\\?\` prefix.
- *   - The implementation uses the Windows API (`FindFirstFileW`, `FindNextFileW`, etc.)
- *     internally.
+ *   - Entries are read in batches with `GetFileInformationByHandleEx(FileIdBothDirectoryInfo)`,
+ *     falling back to `FindFirstFileW`/`FindNextFileW` on file systems that don't
+ *     support it.
  *   - The `DIR` type is an opaque pointer to an internal structure.
  */
 
@@ -66,8 +67,9 @@ struct dirent {
      * @brief File ID (from the Windows file index).
      *
      * This is not a true POSIX inode number but can be used as a unique file
-     * identifier on Windows. It is obtained using `GetFileInformationByHandle`
-     * and represents a file's unique ID within a volume.
+     * identifier on Windows. It comes with the batched directory listing (or from
+     * `GetFileInformationByHandle` in the fallback path) and represents a file's
+     * unique ID within a volume.
      * @warning This field might not be fully unique across different volumes or over time.
      */
     uint64_t d_ino;
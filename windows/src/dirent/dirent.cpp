@@ -112,12 +112,6 @@ std::wstring utf8_to_wide(const std::string& input) {
     return converter.from_bytes(input);
 }
 
-// Convert wide string to UTF-8
-std::string wide_to_utf8(const std::wstring& input) {
-    std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
-    return converter.to_bytes(input);
-}
-
 // Prepare directory path for Windows API
 std::wstring prepare_dir_path(const std::wstring& path) {
     // Check if path already has extended-length prefix
@@ -141,10 +135,25 @@ std::wstring create_search_path(const std::wstring& dir_path) {
 
 }  // namespace
 
+// Size of the buffer GetFileInformationByHandleEx() fills per call; large
+// enough for several hundred entries of a typical directory.
+constexpr DWORD kDirBufferSize = 64 * 1024;
+
 // Internal DIR structure (hidden from users)
 struct InternalDir {
+    // Directory handle queried with GetFileInformationByHandleEx(), which
+    // returns a whole batch of entries, file ids included, per call.
+    HANDLE dir_handle;
+    std::unique_ptr<uint64_t[]> buffer;  // 8-byte aligned as the API needs
+    const FILE_ID_BOTH_DIR_INFO* next_info;  // next unread entry in buffer
+    bool restart;
+
+    // Fallback for file systems that don't support the batch query:
+    // FindFirstFileW/FindNextFileW, with one extra open per entry for d_ino.
+    bool use_find;
     HANDLE handle;
     WIN32_FIND_DATAW find_data;
+
     dirent entry;
     std::wstring path;         // Original path (wide)
     std::wstring search_path;  // Search path with pattern
@@ -154,12 +163,22 @@ struct InternalDir {
 
     // Constructor
     InternalDir()
-        : handle(INVALID_HANDLE_VALUE), first(true), end_reached(false), current_position(0) {
+        : dir_handle(INVALID_HANDLE_VALUE),
+          next_info(nullptr),
+          restart(true),
+          use_find(false),
+          handle(INVALID_HANDLE_VALUE),
+          first(true),
+          end_reached(false),
+          current_position(0) {
         memset(&entry, 0, sizeof(dirent));
     }
 
     // Destructor
     ~InternalDir() {
+        if (dir_handle != INVALID_HANDLE_VALUE) {
+            CloseHandle(dir_handle);
+        }
         if (handle != INVALID_HANDLE_VALUE) {
             FindClose(handle);
         }
@@ -183,6 +202,106 @@ struct DIR {
     DIR& operator=(const DIR&) = delete;
 };
 
+namespace {
+
+bool is_dot_or_dot_dot(const wchar_t* name, size_t len) {
+    return (len == 1 && name[0] == L'.') ||
+           (len == 2 && name[0] == L'.' && name[1] == L'.');
+}
+
+// Converts |len| UTF-16 characters straight into entry.d_name.
+bool set_entry_name(InternalDir* impl, const wchar_t* name, size_t len) {
+    int out = WideCharToMultiByte(CP_UTF8, 0, name, static_cast<int>(len),
+                                  impl->entry.d_name,
+                                  sizeof(impl->entry.d_name) - 1, nullptr, nullptr);
+    if (out <= 0) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    impl->entry.d_name[out] = '\0';
+    return true;
+}
+
+// Starts the FindFirstFileW fallback.
+bool start_find(InternalDir* impl) {
+    if (impl->handle != INVALID_HANDLE_VALUE) {
+        FindClose(impl->handle);
+    }
+    impl->handle = FindFirstFileW(impl->search_path.c_str(), &impl->find_data);
+    if (impl->handle == INVALID_HANDLE_VALUE) {
+        errno = translate_windows_error_to_errno(GetLastError());
+        return false;
+    }
+    impl->first = true;
+    return true;
+}
+
+// Refills the entry buffer. Returns false at the end of the directory or on
+// error, with errno set in the latter case. May switch |impl| to the find
+// fallback if the file system rejects the batch query on its first use.
+bool fill_buffer(InternalDir* impl) {
+    const bool restart = impl->restart;
+    impl->restart = false;
+    impl->next_info = nullptr;
+    if (GetFileInformationByHandleEx(
+                impl->dir_handle,
+                restart ? FileIdBothDirectoryRestartInfo : FileIdBothDirectoryInfo,
+                impl->buffer.get(), kDirBufferSize)) {
+        impl->next_info = reinterpret_cast<const FILE_ID_BOTH_DIR_INFO*>(impl->buffer.get());
+        return true;
+    }
+
+    DWORD lastError = GetLastError();
+    if (lastError == ERROR_NO_MORE_FILES) {
+        impl->end_reached = true;
+        return false;
+    }
+    if (restart && (lastError == ERROR_INVALID_PARAMETER ||
+                    lastError == ERROR_INVALID_LEVEL ||
+                    lastError == ERROR_NOT_SUPPORTED)) {
+        impl->use_find = true;
+        return start_find(impl);
+    }
+    errno = translate_windows_error_to_errno(lastError);
+    return false;
+}
+
+struct dirent* readdir_find(InternalDir* impl) {
+    while (true) {
+        if (!impl->first && !FindNextFileW(impl->handle, &impl->find_data)) {
+            DWORD lastError = GetLastError();
+            if (lastError == ERROR_NO_MORE_FILES) {
+                impl->end_reached = true;
+                return nullptr;
+            } else {
+                errno = translate_windows_error_to_errno(lastError);
+                return nullptr;
+            }
+        }
+        impl->first = false;
+
+        const wchar_t* name = impl->find_data.cFileName;
+        const size_t len = wcslen(name);
+        // Skip "." and ".." entries
+        if (is_dot_or_dot_dot(name, len)) {
+            continue;
+        }
+        if (!set_entry_name(impl, name, len)) {
+            return nullptr;
+        }
+
+        // Get file index information
+        impl->entry.d_ino = get_file_index(impl->path + L"\\" + name);
+
+        // Increment position after successfully reading an entry
+        impl->current_position++;
+
+        return &impl->entry;
+    }
+}
+
+}  // namespace
+
 DIR* opendir(const char* name) {
     if (!name) {
         errno = EINVAL;
@@ -211,9 +330,6 @@ DIR* opendir(const char* name) {
     // Prepare directory path
     std::wstring dir_path = prepare_dir_path(wide_path);
 
-    // Create search path
-    std::wstring search_path = create_search_path(dir_path);
-
     // Allocate and initialize DIR structure using unique_ptr
     std::unique_ptr<DIR> dir = std::make_unique<DIR>();
     if (!dir) {
@@ -221,17 +337,24 @@ DIR* opendir(const char* name) {
         return nullptr;
     }
 
-    // Initialize InternalDir structure
-    dir->pImpl->handle = FindFirstFileW(search_path.c_str(), &dir->pImpl->find_data);
-    if (dir->pImpl->handle == INVALID_HANDLE_VALUE) {
+    InternalDir* impl = dir->pImpl.get();
+    impl->path = dir_path;
+    impl->search_path = create_search_path(dir_path);
+    impl->dir_handle = CreateFileW(dir_path.c_str(), FILE_LIST_DIRECTORY,
+                                   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                   nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (impl->dir_handle == INVALID_HANDLE_VALUE) {
         errno = translate_windows_error_to_errno(GetLastError());
         return nullptr;
     }
+    impl->buffer.reset(new uint64_t[kDirBufferSize / sizeof(uint64_t)]);
 
-    dir->pImpl->path = dir_path;
-    dir->pImpl->search_path = search_path;
-    dir->pImpl->first = true;
-    dir->pImpl->end_reached = false;
+    // Read the first batch now so that errors surface from opendir() like
+    // they did with FindFirstFileW().
+    errno = 0;
+    if (!fill_buffer(impl) && errno) {
+        return nullptr;
+    }
 
     return dir.release();  // Release ownership to the caller
 }
@@ -242,53 +365,42 @@ struct dirent* readdir(DIR* dirp) {
         return nullptr;
     }
 
-    if (dirp->pImpl->end_reached) {
+    InternalDir* impl = dirp->pImpl.get();
+    if (impl->end_reached) {
         return nullptr;
     }
+    if (impl->use_find) {
+        return readdir_find(impl);
+    }
 
     while (true) {
-        if (!dirp->pImpl->first && !FindNextFileW(dirp->pImpl->handle, &dirp->pImpl->find_data)) {
-            DWORD lastError = GetLastError();
-            if (lastError == ERROR_NO_MORE_FILES) {
-                dirp->pImpl->end_reached = true;
-                return nullptr;
-            } else {
-                errno = translate_windows_error_to_errno(lastError);
-                return nullptr;
-            }
+        if (!impl->next_info && !fill_buffer(impl)) {
+            return nullptr;
+        }
+        if (impl->use_find) {
+            return readdir_find(impl);
         }
-        dirp->pImpl->first = false;
 
+        const FILE_ID_BOTH_DIR_INFO* info = impl->next_info;
+        impl->next_info = info->NextEntryOffset
+                ? reinterpret_cast<const FILE_ID_BOTH_DIR_INFO*>(
+                          reinterpret_cast<const char*>(info) + info->NextEntryOffset)
+                : nullptr;
+
+        const size_t len = info->FileNameLength / sizeof(WCHAR);
         // Skip "." and ".." entries
-        if (wcscmp(dirp->pImpl->find_data.cFileName, L".") == 0 ||
-            wcscmp(dirp->pImpl->find_data.cFileName, L"..") == 0) {
+        if (is_dot_or_dot_dot(info->FileName, len)) {
             continue;
         }
-
-        // Convert filename to UTF-8
-        std::string utf8_filename = wide_to_utf8(dirp->pImpl->find_data.cFileName);
-        if (utf8_filename.empty() && !std::wstring(dirp->pImpl->find_data.cFileName).empty()) {
-            errno = ENAMETOOLONG;
-            return nullptr;
-        }
-
-        // Copy filename to dirent structure, with bounds checking
-        if (utf8_filename.length() >= sizeof(dirp->pImpl->entry.d_name)) {
-            errno = ENAMETOOLONG;
+        if (!set_entry_name(impl, info->FileName, len)) {
             return nullptr;
         }
-        strcpy(dirp->pImpl->entry.d_name, utf8_filename.c_str());
-
-        // Get full path for the current file
-        std::wstring fullPath = dirp->pImpl->path + L"\\" + dirp->pImpl->find_data.cFileName;
-
-        // Get file index information
-        dirp->pImpl->entry.d_ino = get_file_index(fullPath);
+        impl->entry.d_ino = static_cast<uint64_t>(info->FileId.QuadPart);
 
         // Increment position after successfully reading an entry
-        dirp->pImpl->current_position++;
+        impl->current_position++;
 
-        return &dirp->pImpl->entry;
+        return &impl->entry;
     }
 }
 
@@ -311,18 +423,17 @@ void rewinddir(DIR* dirp) {
         return;
     }
 
-    if (dirp->pImpl->handle != INVALID_HANDLE_VALUE) {
-        FindClose(dirp->pImpl->handle);
-    }
-
-    dirp->pImpl->handle = FindFirstFileW(dirp->pImpl->search_path.c_str(), &dirp->pImpl->find_data);
-    if (dirp->pImpl->handle == INVALID_HANDLE_VALUE) {
-        errno = translate_windows_error_to_errno(GetLastError());
-        return;
+    InternalDir* impl = dirp->pImpl.get();
+    if (impl->use_find) {
+        if (!start_find(impl)) {
+            return;
+        }
+    } else {
+        impl->restart = true;
+        impl->next_info = nullptr;
     }
-    dirp->pImpl->first = true;
-    dirp->pImpl->end_reached = false;
-    dirp->pImpl->current_position = 0;  // Reset position
+    impl->end_reached = false;
+    impl->current_position = 0;  // Reset position
 }
 
 long telldir(DIR* dirp) {